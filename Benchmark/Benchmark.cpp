@@ -0,0 +1,579 @@
+// Delegate round trip latency benchmarks.
+//
+// Measures synchronous delegate calls, DelegateAsync enqueue cost, DelegateAsyncWait
+// round trips and MulticastDelegateSafe broadcasts. The asynchronous cases run on a
+// WorkerThread of each queue policy and, when built with IT_ENABLE, on the Logger
+// thread.
+//
+// Each case runs a warm up sample, then a number of timed samples of a fixed batch
+// of operations. The nanoseconds per operation of every sample are reduced to min,
+// median, p90, mean and standard deviation, so a one off scheduling delay shifts
+// the mean but not the median.
+//
+// Where the platform provides them, the cycles, instructions, cache misses, branch
+// misses and context switches of the benchmark thread are counted over the timed
+// samples and reported per operation below each case, see PerfCounters.h. They
+// explain a result, e.g. the cache misses of a broadcast. --no-counters skips them.
+//
+// Usage: DelegateBenchmark [--samples N] [--json FILE] [--save-baseline DIR]
+//                          [--compare FILE] [--threshold PCT] [--no-counters]
+//
+// A table is printed to stdout. --json also writes the results to FILE. The
+// results carry the schema version, the git commit the build was configured at
+// and the machine name, plus every sample, so runs are comparable later.
+// --save-baseline writes the results to DIR/<machine>-<commit>.json.
+//
+// --compare reads a baseline written by --json or --save-baseline and tests each
+// case for a regression: a median more than --threshold percent (default 5) above
+// the baseline median, with a one sided Mann-Whitney U test over the samples
+// significant at p < 0.01. Regressions are listed and the exit code is 2, so a
+// build step fails when a Delegate or Logger hot path gets slower. Compare against
+// a baseline from the same machine.
+
+#include "DelegateLib.h"
+#include "WorkerThreadStd.h"
+#include "PerfCounters.h"
+#ifdef IT_ENABLE
+#include "Logger.h"
+#endif
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#ifndef BENCH_GIT_SHA
+#define BENCH_GIT_SHA "unknown"
+#endif
+
+using namespace DelegateLib;
+using namespace std;
+
+/// Summary of the per operation times of all samples
+struct Result
+{
+	std::string name;
+	std::string thread;
+	size_t subscribers;
+	size_t samples;
+	size_t batch;
+	double min;
+	double median;
+	double p90;
+	double mean;
+	double stddev;
+	std::vector<double> perOp;
+
+	/// Counts per operation of the available counters, see PerfCounters
+	PerfCounters::Counts counters;
+};
+
+/// Version of the JSON result layout
+static const int SCHEMA_VERSION = 2;
+
+static std::vector<Result> results;
+static size_t sampleCount = 20;
+
+/// The counters of the benchmark thread, or nullptr if not read
+static PerfCounters* perfCounters = nullptr;
+
+/// Counts of the timed regions since Measure() last reset them
+static PerfCounters::Counts regionCounts;
+
+/// Incremented by the target functions
+static std::atomic<uint64_t> invoked(0);
+
+/// Keeps the synchronous target from being optimized away
+static volatile int sink;
+
+static void Target(int value)
+{
+	sink = value;
+	invoked.fetch_add(1, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// WaitInvoked
+//----------------------------------------------------------------------------
+static void WaitInvoked(uint64_t count)
+{
+	while (invoked.load(std::memory_order_relaxed) < count)
+		std::this_thread::yield();
+}
+
+//----------------------------------------------------------------------------
+// Measure
+//----------------------------------------------------------------------------
+/// Run a warm up sample then the timed samples and record the result
+/// @param[in] name - the case name
+/// @param[in] thread - the name of the thread invoking the target, or empty
+/// @param[in] subscribers - the number of broadcast subscribers, or 0
+/// @param[in] batch - the operations per sample
+/// @param[in] sample - runs batch operations and returns the time they took
+static void Measure(const std::string& name, const std::string& thread, size_t subscribers,
+	size_t batch, const std::function<std::chrono::nanoseconds(size_t)>& sample)
+{
+	sample(batch);
+
+	regionCounts = PerfCounters::Counts();
+	std::vector<double> perOp;
+	for (size_t i = 0; i < sampleCount; i++)
+		perOp.push_back((double)sample(batch).count() / (double)batch);
+	std::sort(perOp.begin(), perOp.end());
+
+	double sum = 0;
+	for (double t : perOp)
+		sum += t;
+	double mean = sum / (double)perOp.size();
+	double variance = 0;
+	for (double t : perOp)
+		variance += (t - mean) * (t - mean);
+	variance /= (double)perOp.size();
+
+	Result result;
+	result.name = name;
+	result.thread = thread;
+	result.subscribers = subscribers;
+	result.samples = perOp.size();
+	result.batch = batch;
+	result.min = perOp.front();
+	result.median = perOp[perOp.size() / 2];
+	result.p90 = perOp[std::min(perOp.size() - 1, perOp.size() * 9 / 10)];
+	result.mean = mean;
+	result.stddev = std::sqrt(variance);
+	result.perOp = perOp;
+	for (int i = 0; i < PerfCounters::COUNTERS; i++)
+		result.counters.value[i] = regionCounts.value[i] / (double)(sampleCount * batch);
+	results.push_back(result);
+
+	printf("%-24s %-16s %6zu %10.1f %10.1f %10.1f %10.1f %8.1f\n", name.c_str(),
+		thread.empty() ? "-" : thread.c_str(), subscribers, result.min, result.median,
+		result.p90, result.mean, result.stddev);
+	if (perfCounters)
+	{
+		printf("  per op:");
+		for (int i = 0; i < PerfCounters::COUNTERS; i++)
+		{
+			if (perfCounters->IsAvailable((PerfCounters::Counter)i))
+				printf(" %s %.3f", PerfCounters::GetName((PerfCounters::Counter)i), result.counters.value[i]);
+		}
+		if (perfCounters->IsAvailable(PerfCounters::CYCLES) && perfCounters->IsAvailable(PerfCounters::INSTRUCTIONS) &&
+			result.counters.value[PerfCounters::CYCLES] > 0)
+		{
+			printf(" ipc %.2f", result.counters.value[PerfCounters::INSTRUCTIONS] / result.counters.value[PerfCounters::CYCLES]);
+		}
+		printf("\n");
+	}
+}
+
+//----------------------------------------------------------------------------
+// Elapsed
+//----------------------------------------------------------------------------
+/// Time a region, adding its counts to regionCounts
+template <class F>
+static std::chrono::nanoseconds Elapsed(F&& f)
+{
+	if (perfCounters)
+		perfCounters->Start();
+	auto start = std::chrono::steady_clock::now();
+	f();
+	auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+	if (perfCounters)
+		perfCounters->Stop(regionCounts);
+	return elapsed;
+}
+
+//----------------------------------------------------------------------------
+// BenchSync
+//----------------------------------------------------------------------------
+static void BenchSync()
+{
+	auto delegate = MakeDelegate(&Target);
+	Measure("sync_call", "", 0, 100000, [&](size_t batch) {
+		return Elapsed([&]() {
+			for (size_t i = 0; i < batch; i++)
+				delegate((int)i);
+		});
+	});
+}
+
+//----------------------------------------------------------------------------
+// BenchAsync
+//----------------------------------------------------------------------------
+static void BenchAsync(DelegateThread& thread, const std::string& threadName)
+{
+	// Only the enqueue is timed. The queue drains before the next sample.
+	auto async = MakeDelegate(&Target, thread);
+	Measure("async_enqueue", threadName, 0, 1000, [&](size_t batch) {
+		uint64_t target = invoked.load() + batch;
+		auto elapsed = Elapsed([&]() {
+			for (size_t i = 0; i < batch; i++)
+				async((int)i);
+		});
+		WaitInvoked(target);
+		return elapsed;
+	});
+
+	auto asyncWait = MakeDelegate(&Target, thread, WAIT_INFINITE);
+	Measure("async_wait_round_trip", threadName, 0, 200, [&](size_t batch) {
+		return Elapsed([&]() {
+			for (size_t i = 0; i < batch; i++)
+				asyncWait((int)i);
+		});
+	});
+}
+
+//----------------------------------------------------------------------------
+// BenchBroadcast
+//----------------------------------------------------------------------------
+static void BenchBroadcast()
+{
+	const size_t SUBSCRIBERS[] = { 1, 10, 100, 1000 };
+	for (size_t subscribers : SUBSCRIBERS)
+	{
+		MulticastDelegateSafe<void(int)> multicast;
+		for (size_t i = 0; i < subscribers; i++)
+			multicast += MakeDelegate(&Target);
+
+		// Keep the subscriber calls per sample roughly constant
+		size_t batch = std::max<size_t>(10, 100000 / subscribers);
+		Measure("multicast_safe_broadcast", "", subscribers, batch, [&](size_t batch) {
+			return Elapsed([&]() {
+				for (size_t i = 0; i < batch; i++)
+					multicast((int)i);
+			});
+		});
+	}
+}
+
+//----------------------------------------------------------------------------
+// GetMachine
+//----------------------------------------------------------------------------
+static std::string GetMachine()
+{
+	char name[256] = "";
+#if defined(__linux__) || defined(__APPLE__)
+	if (gethostname(name, sizeof(name) - 1) != 0)
+		name[0] = 0;
+#else
+	if (const char* computer = getenv("COMPUTERNAME"))
+		strncpy(name, computer, sizeof(name) - 1);
+#endif
+	std::string machine = name[0] ? name : "unknown";
+	std::replace_if(machine.begin(), machine.end(), [](char c) { return !isalnum((unsigned char)c) && c != '-' && c != '.'; }, '_');
+	return machine;
+}
+
+//----------------------------------------------------------------------------
+// GetKey
+//----------------------------------------------------------------------------
+static std::string GetKey(const Result& r)
+{
+	return r.name + "/" + (r.thread.empty() ? "-" : r.thread) + "/" + std::to_string(r.subscribers);
+}
+
+//----------------------------------------------------------------------------
+// WriteJson
+//----------------------------------------------------------------------------
+static bool WriteJson(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"schema\": %d,\n  \"git_sha\": \"%s\",\n  \"machine\": \"%s\",\n"
+		"  \"unit\": \"ns_per_op\",\n  \"hardware_threads\": %u,\n  \"benchmarks\": [\n",
+		SCHEMA_VERSION, BENCH_GIT_SHA, GetMachine().c_str(), std::thread::hardware_concurrency());
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(file, "    { \"name\": \"%s\", \"thread\": \"%s\", \"subscribers\": %zu, "
+			"\"samples\": %zu, \"batch\": %zu, \"min\": %.2f, \"median\": %.2f, \"p90\": %.2f, "
+			"\"mean\": %.2f, \"stddev\": %.2f, \"samples_ns\": [", r.name.c_str(), r.thread.c_str(), r.subscribers,
+			r.samples, r.batch, r.min, r.median, r.p90, r.mean, r.stddev);
+		for (size_t j = 0; j < r.perOp.size(); j++)
+			fprintf(file, "%s%.2f", j ? ", " : "", r.perOp[j]);
+		fprintf(file, "]");
+		for (int j = 0; perfCounters && j < PerfCounters::COUNTERS; j++)
+		{
+			if (perfCounters->IsAvailable((PerfCounters::Counter)j))
+				fprintf(file, ", \"%s_per_op\": %.4f", PerfCounters::GetName((PerfCounters::Counter)j), r.counters.value[j]);
+		}
+		fprintf(file, " }%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+//----------------------------------------------------------------------------
+// GetField
+//----------------------------------------------------------------------------
+/// Get the text of a field from one line of the JSON written by WriteJson()
+static bool GetField(const std::string& line, const char* field, std::string& value)
+{
+	std::string key = std::string("\"") + field + "\": ";
+	size_t pos = line.find(key);
+	if (pos == std::string::npos)
+		return false;
+	pos += key.size();
+	size_t end;
+	if (line[pos] == '"')
+		end = line.find('"', ++pos);
+	else if (line[pos] == '[')
+		end = line.find(']', ++pos);
+	else
+		end = line.find_first_of(",}", pos);
+	if (end == std::string::npos)
+		return false;
+	value = line.substr(pos, end - pos);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// LoadBaseline
+//----------------------------------------------------------------------------
+/// Read the results of a JSON file written by WriteJson()
+/// @param[in] path - the file to read
+/// @param[out] baseline - the results keyed by GetKey()
+/// @param[out] sha - the commit of the baseline
+/// @param[out] machine - the machine of the baseline
+/// @return True if the file held results of this schema.
+static bool LoadBaseline(const char* path, std::map<std::string, Result>& baseline,
+	std::string& sha, std::string& machine)
+{
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return false;
+
+	int schema = 0;
+	std::string line, value;
+	char buffer[4096];
+	while (fgets(buffer, sizeof(buffer), file))
+	{
+		line += buffer;
+		if (line.back() != '\n' && !feof(file))
+			continue;
+
+		if (GetField(line, "schema", value))
+			schema = atoi(value.c_str());
+		else if (GetField(line, "git_sha", value))
+			sha = value;
+		else if (GetField(line, "machine", value))
+			machine = value;
+		else if (GetField(line, "samples_ns", value))
+		{
+			Result r;
+			GetField(line, "name", r.name);
+			GetField(line, "thread", r.thread);
+			GetField(line, "subscribers", value);
+			r.subscribers = strtoull(value.c_str(), nullptr, 10);
+			GetField(line, "median", value);
+			r.median = atof(value.c_str());
+			GetField(line, "samples_ns", value);
+			for (const char* p = value.c_str(); *p; )
+			{
+				char* end = nullptr;
+				double sample = strtod(p, &end);
+				if (end == p)
+					break;
+				r.perOp.push_back(sample);
+				p = end;
+				while (*p == ',' || *p == ' ')
+					p++;
+			}
+			baseline[GetKey(r)] = r;
+		}
+		line.clear();
+	}
+	fclose(file);
+	return schema == SCHEMA_VERSION;
+}
+
+//----------------------------------------------------------------------------
+// MannWhitneyGreater
+//----------------------------------------------------------------------------
+/// One sided Mann-Whitney U test that the current samples tend to be larger
+/// than the baseline samples, by the normal approximation with a tie correction
+/// @return The p-value.
+static double MannWhitneyGreater(const std::vector<double>& baseline, const std::vector<double>& current)
+{
+	const double n1 = (double)baseline.size();
+	const double n2 = (double)current.size();
+	if (n1 == 0 || n2 == 0)
+		return 1.0;
+
+	// Rank the pooled samples, ties taking their average rank
+	std::vector<std::pair<double, int>> pooled;
+	for (double v : baseline)
+		pooled.push_back({ v, 0 });
+	for (double v : current)
+		pooled.push_back({ v, 1 });
+	std::sort(pooled.begin(), pooled.end());
+
+	double currentRanks = 0;
+	double tieTerm = 0;
+	for (size_t i = 0; i < pooled.size(); )
+	{
+		size_t j = i;
+		while (j < pooled.size() && pooled[j].first == pooled[i].first)
+			j++;
+		double rank = (double)(i + j + 1) / 2.0;
+		for (size_t k = i; k < j; k++)
+		{
+			if (pooled[k].second)
+				currentRanks += rank;
+		}
+		double ties = (double)(j - i);
+		tieTerm += ties * ties * ties - ties;
+		i = j;
+	}
+
+	const double u = currentRanks - n2 * (n2 + 1) / 2.0;
+	const double n = n1 + n2;
+	const double variance = n1 * n2 / 12.0 * ((n + 1) - tieTerm / (n * (n - 1)));
+	if (variance <= 0)
+		return 1.0;
+	const double z = (u - n1 * n2 / 2.0 - 0.5) / std::sqrt(variance);
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+//----------------------------------------------------------------------------
+// Compare
+//----------------------------------------------------------------------------
+/// Compare the results with a baseline
+/// @return The number of regressed cases, or -1 if the baseline cannot be read.
+static int Compare(const char* path, double threshold)
+{
+	static const double ALPHA = 0.01;
+
+	std::map<std::string, Result> baseline;
+	std::string sha, machine;
+	if (!LoadBaseline(path, baseline, sha, machine))
+	{
+		fprintf(stderr, "Cannot read baseline %s\n", path);
+		return -1;
+	}
+	printf("\ncompare with %s at %s on %s, threshold %.1f%%\n", path, sha.c_str(), machine.c_str(), threshold);
+	if (machine != GetMachine())
+		printf("warning: baseline from another machine\n");
+
+	int regressions = 0;
+	for (const Result& r : results)
+	{
+		auto it = baseline.find(GetKey(r));
+		if (it == baseline.end())
+		{
+			printf("%-40s new\n", GetKey(r).c_str());
+			continue;
+		}
+		const Result& base = it->second;
+		double change = base.median > 0 ? (r.median - base.median) * 100.0 / base.median : 0.0;
+		double p = MannWhitneyGreater(base.perOp, r.perOp);
+		bool regressed = change > threshold && p < ALPHA;
+		if (regressed)
+			regressions++;
+		printf("%-40s %10.1f %10.1f %+7.1f%%  p %.4f%s\n", GetKey(r).c_str(), base.median, r.median,
+			change, p, regressed ? "  REGRESSED" : "");
+	}
+	printf("%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+	return regressions;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	const char* jsonPath = nullptr;
+	const char* baselineDir = nullptr;
+	const char* comparePath = nullptr;
+	double threshold = 5.0;
+	bool counters = true;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+			jsonPath = argv[++i];
+		else if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc)
+			sampleCount = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--save-baseline") == 0 && i + 1 < argc)
+			baselineDir = argv[++i];
+		else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+			comparePath = argv[++i];
+		else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+			threshold = std::max(0.0, atof(argv[++i]));
+		else if (strcmp(argv[i], "--no-counters") == 0)
+			counters = false;
+		else
+		{
+			fprintf(stderr, "Usage: %s [--samples N] [--json FILE] [--save-baseline DIR]\n"
+				"    [--compare FILE] [--threshold PCT] [--no-counters]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	// Opened on the thread running every case
+	PerfCounters threadCounters;
+	if (counters && threadCounters.IsAnyAvailable())
+		perfCounters = &threadCounters;
+	else if (counters)
+		printf("hardware counters not available\n");
+
+	printf("%-24s %-16s %6s %10s %10s %10s %10s %8s\n", "benchmark", "thread", "subs",
+		"min ns", "median ns", "p90 ns", "mean ns", "stddev");
+
+	BenchSync();
+
+	WorkerThread mutexThread("BenchMutex");
+	mutexThread.CreateThread();
+	BenchAsync(mutexThread, "WorkerThread");
+
+	WorkerThread ringThread("BenchRing", WorkerThread::QueuePolicy::RING);
+	ringThread.CreateThread();
+	BenchAsync(ringThread, "WorkerThreadRing");
+
+#ifdef IT_ENABLE
+	BenchAsync(Logger::GetInstance(), "Logger");
+#endif
+
+	BenchBroadcast();
+
+	mutexThread.ExitThread();
+	ringThread.ExitThread();
+
+	if (jsonPath && !WriteJson(jsonPath))
+	{
+		fprintf(stderr, "Cannot write %s\n", jsonPath);
+		return 1;
+	}
+	if (baselineDir)
+	{
+		std::string path = std::string(baselineDir) + "/" + GetMachine() + "-" + BENCH_GIT_SHA + ".json";
+		if (!WriteJson(path.c_str()))
+		{
+			fprintf(stderr, "Cannot write %s\n", path.c_str());
+			return 1;
+		}
+		printf("baseline saved to %s\n", path.c_str());
+	}
+	if (comparePath)
+	{
+		int regressions = Compare(comparePath, threshold);
+		if (regressions < 0)
+			return 1;
+		if (regressions > 0)
+			return 2;
+	}
+	return 0;
+}
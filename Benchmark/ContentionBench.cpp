@@ -0,0 +1,310 @@
+// Producer contention scaling benchmark.
+//
+// Producer threads dispatch to one consumer flat out, sweeping the producer count
+// and payload size, for each queue the framework offers:
+//
+// * WorkerThread with QueuePolicy::MUTEX and QueuePolicy::RING, fed asynchronous
+//   delegates taking a std::string payload through DispatchDelegate()
+// * Logger::Write() in the queue, lock-free, staged and per-CPU write modes
+//
+// Each case reports the messages/s accepted, the latency percentiles of the
+// producer call, and the voluntary plus involuntary context switches of the whole
+// process per message, from the start of the case until its messages are drained.
+// A queue that stops scaling shows falling messages/s per producer, rising tail
+// latency and context switches per message. The Logger cases write LogData.txt
+// to the working directory at full rate, so run from a scratch directory.
+//
+// Usage: ContentionBench [options]
+//   --max-threads N      the largest producer count, swept in powers of two
+//                        (default twice the hardware threads)
+//   --sizes LIST         comma separated payload sizes in bytes (default 16,128,1024)
+//   --duration S         seconds each case runs (default 0.25)
+//   --json FILE          also write the results to FILE
+
+#include "DelegateLib.h"
+#include "WorkerThreadStd.h"
+#include "Logger.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+using namespace DelegateLib;
+using namespace std;
+
+/// The result of one queue, producer count and payload size
+struct Result
+{
+	std::string queue;
+	int producers;
+	size_t size;
+	uint64_t messages;
+	double seconds;
+	LatencyHistogram latency;
+	uint64_t switches;
+};
+
+static std::vector<Result> results;
+static double duration = 0.25;
+
+/// Incremented by the WorkerThread target function
+static std::atomic<uint64_t> consumed(0);
+
+static std::atomic<bool> stopProducers(false);
+
+static void Consume(std::string payload)
+{
+	(void)payload;
+	consumed.fetch_add(1, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// GetContextSwitches
+//----------------------------------------------------------------------------
+static uint64_t GetContextSwitches()
+{
+#if defined(__linux__)
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return (uint64_t)usage.ru_nvcsw + (uint64_t)usage.ru_nivcsw;
+#else
+	return 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Run
+//----------------------------------------------------------------------------
+/// Run producers flat out for the case duration, drain and record the result
+/// @param[in] queue - the queue name
+/// @param[in] producers - the number of producer threads
+/// @param[in] size - the payload size in bytes
+/// @param[in] send - sends one payload, called by each producer thread
+/// @param[in] drain - waits until every sent message is consumed
+static void Run(const std::string& queue, int producers, size_t size,
+	const std::function<void(const std::string&)>& send, const std::function<void()>& drain)
+{
+	std::vector<uint64_t> counts(producers);
+	std::vector<LatencyHistogram> latencies(producers);
+	std::vector<std::thread> threads;
+
+	stopProducers = false;
+	const uint64_t startSwitches = GetContextSwitches();
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < producers; i++)
+	{
+		threads.emplace_back([&, i]() {
+			const std::string payload(size, 'a' + (char)(i % 26));
+			while (!stopProducers.load(std::memory_order_relaxed))
+			{
+				auto sent = std::chrono::steady_clock::now();
+				send(payload);
+				latencies[i].Record(std::chrono::steady_clock::now() - sent);
+				counts[i]++;
+			}
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+	stopProducers = true;
+	for (auto& thread : threads)
+		thread.join();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	drain();
+
+	Result result;
+	result.queue = queue;
+	result.producers = producers;
+	result.size = size;
+	result.messages = 0;
+	for (int i = 0; i < producers; i++)
+	{
+		result.messages += counts[i];
+		result.latency.Merge(latencies[i]);
+	}
+	result.seconds = seconds;
+	result.switches = GetContextSwitches() - startSwitches;
+	results.push_back(result);
+
+	printf("%-18s %5d %6zu %12.0f %8lld %8lld %8lld %10.4f\n", queue.c_str(), producers, size,
+		(double)result.messages / seconds,
+		(long long)result.latency.GetPercentile(50).count(),
+		(long long)result.latency.GetPercentile(99).count(),
+		(long long)result.latency.GetPercentile(99.9).count(),
+		result.messages ? (double)result.switches / (double)result.messages : 0.0);
+	fflush(stdout);
+}
+
+//----------------------------------------------------------------------------
+// BenchWorkerThread
+//----------------------------------------------------------------------------
+static void BenchWorkerThread(const std::string& queue, WorkerThread::QueuePolicy policy,
+	const std::vector<int>& producers, const std::vector<size_t>& sizes)
+{
+	WorkerThread thread("ContentionBench", policy);
+	thread.CreateThread();
+	auto async = MakeDelegate(&Consume, thread);
+
+	for (size_t size : sizes)
+	{
+		for (int count : producers)
+		{
+			uint64_t sent = consumed.load();
+			std::atomic<uint64_t> dispatched(0);
+			Run(queue, count, size, [&](const std::string& payload) {
+				async(payload);
+				dispatched.fetch_add(1, std::memory_order_relaxed);
+			}, [&]() {
+				while (consumed.load(std::memory_order_relaxed) < sent + dispatched.load())
+					std::this_thread::yield();
+			});
+		}
+	}
+	thread.ExitThread();
+}
+
+//----------------------------------------------------------------------------
+// BenchLogger
+//----------------------------------------------------------------------------
+static void BenchLogger(const std::string& mode, const std::vector<int>& producers,
+	const std::vector<size_t>& sizes)
+{
+	Logger& logger = Logger::GetInstance();
+	logger.SetLockFreeWrite(mode == "lockfree");
+	logger.SetStagedWrite(mode == "staged");
+	logger.SetPerCpuWrite(mode == "percpu");
+
+	for (size_t size : sizes)
+	{
+		for (int count : producers)
+		{
+			Run("Logger_" + mode, count, size, [&](const std::string& payload) {
+				logger.Write(std::string_view(payload));
+			}, [&]() {
+				logger.Flush();
+				logger.WriteDurable("ContentionBench drained").get();
+			});
+		}
+	}
+	logger.SetLockFreeWrite(false);
+	logger.SetStagedWrite(false);
+	logger.SetPerCpuWrite(false);
+}
+
+//----------------------------------------------------------------------------
+// WriteJson
+//----------------------------------------------------------------------------
+static bool WriteJson(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"hardware_threads\": %u, \"seconds_per_case\": %.3f,\n  \"results\": [\n",
+		std::thread::hardware_concurrency(), duration);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(file, "    { \"queue\": \"%s\", \"producers\": %d, \"size\": %zu, \"messages\": %llu, "
+			"\"messages_per_s\": %.0f, \"p50_ns\": %lld, \"p99_ns\": %lld, \"p99_9_ns\": %lld, "
+			"\"switches_per_message\": %.6f }%s\n", r.queue.c_str(), r.producers, r.size,
+			(unsigned long long)r.messages, (double)r.messages / r.seconds,
+			(long long)r.latency.GetPercentile(50).count(), (long long)r.latency.GetPercentile(99).count(),
+			(long long)r.latency.GetPercentile(99.9).count(),
+			r.messages ? (double)r.switches / (double)r.messages : 0.0, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+//----------------------------------------------------------------------------
+// ParseSizes
+//----------------------------------------------------------------------------
+static bool ParseSizes(const char* list, std::vector<size_t>& sizes)
+{
+	sizes.clear();
+	for (const char* p = list; *p; )
+	{
+		char* end = nullptr;
+		unsigned long long size = strtoull(p, &end, 10);
+		if (end == p || size == 0)
+			return false;
+		sizes.push_back((size_t)size);
+		p = *end == ',' ? end + 1 : end;
+		if (*end && *end != ',')
+			return false;
+	}
+	return !sizes.empty();
+}
+
+//----------------------------------------------------------------------------
+// Usage
+//----------------------------------------------------------------------------
+static int Usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [--max-threads N] [--sizes LIST] [--duration S] [--json FILE]\n", program);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int maxThreads = (int)std::max(1u, std::thread::hardware_concurrency()) * 2;
+	std::vector<size_t> sizes = { 16, 128, 1024 };
+	const char* jsonPath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return Usage(argv[0]);
+		if (strcmp(argv[i], "--max-threads") == 0)
+			maxThreads = std::max(1, atoi(value));
+		else if (strcmp(argv[i], "--sizes") == 0)
+		{
+			if (!ParseSizes(value, sizes))
+				return Usage(argv[0]);
+		}
+		else if (strcmp(argv[i], "--duration") == 0)
+			duration = std::max(0.01, atof(value));
+		else if (strcmp(argv[i], "--json") == 0)
+			jsonPath = value;
+		else
+			return Usage(argv[0]);
+		i++;
+	}
+
+	std::vector<int> producers;
+	for (int count = 1; count < maxThreads; count *= 2)
+		producers.push_back(count);
+	producers.push_back(maxThreads);
+
+	printf("%-18s %5s %6s %12s %8s %8s %8s %10s\n", "queue", "prod", "bytes",
+		"msgs/s", "p50 ns", "p99 ns", "p99.9 ns", "csw/msg");
+
+	BenchWorkerThread("WorkerThread", WorkerThread::QueuePolicy::MUTEX, producers, sizes);
+	BenchWorkerThread("WorkerThreadRing", WorkerThread::QueuePolicy::RING, producers, sizes);
+	BenchLogger("queue", producers, sizes);
+	BenchLogger("lockfree", producers, sizes);
+	BenchLogger("staged", producers, sizes);
+	BenchLogger("percpu", producers, sizes);
+
+	if (jsonPath && !WriteJson(jsonPath))
+	{
+		fprintf(stderr, "Cannot write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
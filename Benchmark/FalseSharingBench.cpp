@@ -0,0 +1,246 @@
+// False sharing microbenchmark.
+//
+// Compares the layouts the framework's queues choose between: fields written by
+// different threads packed on one cache line, or each aligned to CACHE_LINE_SIZE
+// as in ActiveObject, LockFreeQueue, LogSignalRing and the Logger and
+// WorkerThread counters.
+//
+// * counters - each thread increments its own counter flat out, as producers
+//   and the consumer update their statistics
+// * spsc - one producer and one consumer pass integers through a ring, the
+//   producer writing the enqueue position and the consumer the dequeue position
+//
+// Each case reports the operations/s of the packed and padded layouts and the
+// speedup padding gives. Threads are not pinned, so run on an idle machine.
+//
+// Usage: FalseSharingBench [options]
+//   --threads N          the counter threads (default the hardware threads, at most 8)
+//   --duration S         seconds each case runs (default 0.5)
+//   --json FILE          also write the results to FILE
+
+#include "CacheLine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/// The result of one case and layout
+struct Result
+{
+	std::string name;
+	bool padded;
+	int threads;
+	uint64_t operations;
+	double seconds;
+};
+
+static std::vector<Result> results;
+static double duration = 0.5;
+
+static std::atomic<bool> stopThreads(false);
+
+/// Sum of the values the spsc consumer received, so the reads are kept
+static std::atomic<int64_t> checksum(0);
+
+/// A counter sharing its cache line with its neighbours
+struct PackedCounter
+{
+	std::atomic<uint64_t> value{ 0 };
+};
+
+/// A counter alone on its cache line
+struct alignas(CACHE_LINE_SIZE) PaddedCounter
+{
+	std::atomic<uint64_t> value{ 0 };
+};
+
+static constexpr size_t RING_SIZE = 1024;
+
+/// Ring positions on one cache line
+struct PackedRing
+{
+	std::atomic<size_t> enqueuePos{ 0 };
+	std::atomic<size_t> dequeuePos{ 0 };
+	int slots[RING_SIZE];
+};
+
+/// Ring positions on separate cache lines
+struct PaddedRing
+{
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> enqueuePos{ 0 };
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> dequeuePos{ 0 };
+	alignas(CACHE_LINE_SIZE) int slots[RING_SIZE];
+};
+
+//----------------------------------------------------------------------------
+// Report
+//----------------------------------------------------------------------------
+static void Report(const std::string& name, bool padded, int threads, uint64_t operations, double seconds)
+{
+	results.push_back({ name, padded, threads, operations, seconds });
+	printf("%-10s %-7s %7d %14.0f", name.c_str(), padded ? "padded" : "packed", threads,
+		(double)operations / seconds);
+	if (padded && results.size() >= 2)
+	{
+		const Result& packed = results[results.size() - 2];
+		double packedRate = (double)packed.operations / packed.seconds;
+		printf(" %8.2fx", packedRate > 0 ? ((double)operations / seconds) / packedRate : 0.0);
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+//----------------------------------------------------------------------------
+// BenchCounters
+//----------------------------------------------------------------------------
+template <class Counter>
+static void BenchCounters(bool padded, int threadCount)
+{
+	std::unique_ptr<Counter[]> counters(new Counter[threadCount]);
+	std::vector<std::thread> threads;
+
+	stopThreads = false;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < threadCount; i++)
+	{
+		threads.emplace_back([&counters, i]() {
+			std::atomic<uint64_t>& value = counters[i].value;
+			while (!stopThreads.load(std::memory_order_relaxed))
+				value.fetch_add(1, std::memory_order_relaxed);
+		});
+	}
+	std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+	stopThreads = true;
+	for (auto& thread : threads)
+		thread.join();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	uint64_t operations = 0;
+	for (int i = 0; i < threadCount; i++)
+		operations += counters[i].value.load();
+	Report("counters", padded, threadCount, operations, seconds);
+}
+
+//----------------------------------------------------------------------------
+// BenchSpsc
+//----------------------------------------------------------------------------
+template <class Ring>
+static void BenchSpsc(bool padded)
+{
+	std::unique_ptr<Ring> ring(new Ring());
+	uint64_t received = 0;
+
+	stopThreads = false;
+	const auto start = std::chrono::steady_clock::now();
+	std::thread producer([&ring]() {
+		size_t pos = 0;
+		while (!stopThreads.load(std::memory_order_relaxed))
+		{
+			if (pos - ring->dequeuePos.load(std::memory_order_acquire) == RING_SIZE)
+				continue;
+			ring->slots[pos % RING_SIZE] = (int)pos;
+			ring->enqueuePos.store(++pos, std::memory_order_release);
+		}
+	});
+	std::thread consumer([&ring, &received]() {
+		size_t pos = 0;
+		int64_t sum = 0;
+		for (;;)
+		{
+			if (pos == ring->enqueuePos.load(std::memory_order_acquire))
+			{
+				if (stopThreads.load(std::memory_order_relaxed) &&
+					pos == ring->enqueuePos.load(std::memory_order_acquire))
+					break;
+				continue;
+			}
+			sum += ring->slots[pos % RING_SIZE];
+			ring->dequeuePos.store(++pos, std::memory_order_release);
+		}
+		received = pos;
+		checksum = sum;
+	});
+	std::this_thread::sleep_for(std::chrono::duration<double>(duration));
+	stopThreads = true;
+	producer.join();
+	consumer.join();
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	Report("spsc", padded, 2, received, seconds);
+}
+
+//----------------------------------------------------------------------------
+// WriteJson
+//----------------------------------------------------------------------------
+static bool WriteJson(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"hardware_threads\": %u, \"cache_line_size\": %zu, \"seconds_per_case\": %.3f,\n  \"results\": [\n",
+		std::thread::hardware_concurrency(), CACHE_LINE_SIZE, duration);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(file, "    { \"case\": \"%s\", \"layout\": \"%s\", \"threads\": %d, \"operations\": %llu, "
+			"\"operations_per_s\": %.0f }%s\n", r.name.c_str(), r.padded ? "padded" : "packed", r.threads,
+			(unsigned long long)r.operations, (double)r.operations / r.seconds, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+//----------------------------------------------------------------------------
+// Usage
+//----------------------------------------------------------------------------
+static int Usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [--threads N] [--duration S] [--json FILE]\n", program);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	int threads = (int)std::min(8u, std::max(2u, std::thread::hardware_concurrency()));
+	const char* jsonPath = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return Usage(argv[0]);
+		if (strcmp(argv[i], "--threads") == 0)
+			threads = std::max(2, atoi(value));
+		else if (strcmp(argv[i], "--duration") == 0)
+			duration = std::max(0.01, atof(value));
+		else if (strcmp(argv[i], "--json") == 0)
+			jsonPath = value;
+		else
+			return Usage(argv[0]);
+		i++;
+	}
+
+	printf("%-10s %-7s %7s %14s %9s\n", "case", "layout", "threads", "ops/s", "speedup");
+
+	BenchCounters<PackedCounter>(false, threads);
+	BenchCounters<PaddedCounter>(true, threads);
+	BenchSpsc<PackedRing>(false);
+	BenchSpsc<PaddedRing>(true);
+
+	if (jsonPath && !WriteJson(jsonPath))
+	{
+		fprintf(stderr, "Cannot write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,334 @@
+// LogData flush I/O benchmark matrix.
+//
+// Drives LogWriter::Write(), the flush path of LogData, directly on the calling
+// thread, sweeping the records per flush, record size, interval between flushes,
+// sink and sync policy. The sinks are Backend::FILE in each LogFile::WriteMode
+// (buffered stdio, vectored writev and O_DIRECT), the memory-mapped
+// Backend::SEGMENT and the io_uring Backend::URING. Each case writes into a fresh
+// directory below the target directory and reports:
+//
+// * the flush latency percentiles and the bytes/s written during flushes
+// * write syscalls per flush, the syscw count of /proc/self/io. fsync(2), msync(2)
+//   and io_uring_enter(2) are not counted, so read the count as write(2) and
+//   writev(2) calls.
+// * the fsync cost, the median flush latency syncing on every flush less the
+//   median of the same case without syncing
+//
+// Point --dir at each storage tier to characterize it. A file system without
+// O_DIRECT support, e.g. tmpfs, runs the direct cases buffered. URING runs as
+// FILE where io_uring is unsupported and is then reported as uring(file).
+//
+// Usage: FlushBench [options]
+//   --dir DIR            the target directory (default .)
+//   --records LIST       comma separated records per flush (default 100,1000)
+//   --sizes LIST         comma separated record sizes in bytes (default 64,512)
+//   --intervals LIST     comma separated milliseconds between flushes (default 0,10)
+//   --sinks LIST         comma separated buffered, vectored, direct, segment and
+//                        uring (default all)
+//   --flushes N          timed flushes per case (default 20)
+//   --json FILE          also write the results to FILE
+
+#include "LogWriter.h"
+#include "LogUring.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/// A sink under test
+struct Sink
+{
+	const char* name;
+	LogWriter::Backend backend;
+	LogFile::WriteMode mode;
+};
+
+static const Sink SINKS[] = {
+	{ "buffered", LogWriter::Backend::FILE, LogFile::WriteMode::BUFFERED },
+	{ "vectored", LogWriter::Backend::FILE, LogFile::WriteMode::VECTORED },
+	{ "direct", LogWriter::Backend::FILE, LogFile::WriteMode::DIRECT },
+	{ "segment", LogWriter::Backend::SEGMENT, LogFile::WriteMode::BUFFERED },
+	{ "uring", LogWriter::Backend::URING, LogFile::WriteMode::BUFFERED },
+};
+
+/// One case of the matrix
+struct Result
+{
+	std::string sink;
+	bool sync;
+	size_t records;
+	size_t size;
+	size_t interval;
+	size_t flushes;
+	size_t failed;
+	LatencyHistogram latency;
+	double bytesPerSecond;
+	double syscallsPerFlush;
+	double fsyncNs;
+};
+
+static std::vector<Result> results;
+static std::string targetDir = ".";
+static size_t flushCount = 20;
+
+//----------------------------------------------------------------------------
+// GetWriteSyscalls
+//----------------------------------------------------------------------------
+static uint64_t GetWriteSyscalls()
+{
+#if defined(__linux__)
+	FILE* file = fopen("/proc/self/io", "r");
+	if (!file)
+		return 0;
+	char line[128];
+	unsigned long long syscw = 0;
+	while (fgets(line, sizeof(line), file))
+	{
+		if (sscanf(line, "syscw: %llu", &syscw) == 1)
+			break;
+	}
+	fclose(file);
+	return syscw;
+#else
+	return 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Run
+//----------------------------------------------------------------------------
+/// Run the timed flushes of one case after an untimed warm up flush
+static Result Run(const Sink& sink, bool sync, size_t records, size_t size, size_t interval, int index)
+{
+	std::error_code ec;
+	std::filesystem::path dir = std::filesystem::path(targetDir) / ("flushbench." + std::to_string(index));
+	std::filesystem::remove_all(dir, ec);
+	std::filesystem::create_directories(dir, ec);
+
+	Result result;
+	result.sink = sink.name;
+	if (sink.backend == LogWriter::Backend::URING && !LogUring::IsSupported())
+		result.sink = "uring(file)";
+	result.sync = sync;
+	result.records = records;
+	result.size = size;
+	result.interval = interval;
+	result.flushes = flushCount;
+	result.failed = 0;
+	result.fsyncNs = 0;
+
+	uint64_t bytes = 0;
+	std::chrono::nanoseconds elapsed(0);
+	uint64_t syscalls = 0;
+	{
+		LogWriter writer((dir / "FlushBench.txt").string(), (dir / "FlushBench.hwm").string(),
+			(dir / "FlushBench.seg").string());
+		writer.SetBackend(sink.backend);
+		writer.SetWriteMode(sink.mode);
+		writer.SetSyncPolicy(sync ? LogFile::SyncPolicy::PER_FLUSH : LogFile::SyncPolicy::NONE,
+			std::chrono::milliseconds(0));
+
+		LogBuffer buffer;
+		const std::string record(size, 'r');
+		for (size_t i = 0; i < records; i++)
+			buffer.Append(record);
+		writer.Write(buffer);
+
+		for (size_t i = 0; i < flushCount; i++)
+		{
+			if (interval)
+				std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+
+			uint64_t startSyscalls = GetWriteSyscalls();
+			auto start = std::chrono::steady_clock::now();
+			LogWriter::Result write = writer.Write(buffer);
+			auto flush = std::chrono::steady_clock::now() - start;
+			syscalls += GetWriteSyscalls() - startSyscalls;
+
+			result.latency.Record(flush);
+			elapsed += flush;
+			bytes += write.bytes;
+			if (!write.success)
+				result.failed++;
+		}
+	}
+	std::filesystem::remove_all(dir, ec);
+
+	result.bytesPerSecond = elapsed.count() ? (double)bytes * 1e9 / (double)elapsed.count() : 0.0;
+	result.syscallsPerFlush = (double)syscalls / (double)flushCount;
+	return result;
+}
+
+//----------------------------------------------------------------------------
+// Print
+//----------------------------------------------------------------------------
+static void Print(const Result& r)
+{
+	printf("%-12s %-5s %8zu %6zu %5zu %10.1f %10.1f %10.1f %8.1f %10.1f%s\n", r.sink.c_str(),
+		r.sync ? "flush" : "none", r.records, r.size, r.interval,
+		(double)r.latency.GetPercentile(50).count() / 1000.0,
+		(double)r.latency.GetPercentile(99).count() / 1000.0,
+		r.bytesPerSecond / (1024.0 * 1024.0), r.syscallsPerFlush, r.fsyncNs / 1000.0,
+		r.failed ? "  FAILED" : "");
+	fflush(stdout);
+}
+
+//----------------------------------------------------------------------------
+// WriteJson
+//----------------------------------------------------------------------------
+static bool WriteJson(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"dir\": \"%s\", \"flushes_per_case\": %zu,\n  \"results\": [\n",
+		targetDir.c_str(), flushCount);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(file, "    { \"sink\": \"%s\", \"sync\": \"%s\", \"records\": %zu, \"size\": %zu, "
+			"\"interval_ms\": %zu, \"p50_ns\": %lld, \"p99_ns\": %lld, \"bytes_per_s\": %.0f, "
+			"\"syscalls_per_flush\": %.2f, \"fsync_ns\": %.0f, \"failed\": %zu }%s\n",
+			r.sink.c_str(), r.sync ? "flush" : "none", r.records, r.size, r.interval,
+			(long long)r.latency.GetPercentile(50).count(), (long long)r.latency.GetPercentile(99).count(),
+			r.bytesPerSecond, r.syscallsPerFlush, r.fsyncNs, r.failed, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+//----------------------------------------------------------------------------
+// ParseList
+//----------------------------------------------------------------------------
+static bool ParseList(const char* list, std::vector<size_t>& values, bool allowZero)
+{
+	values.clear();
+	for (const char* p = list; *p; )
+	{
+		char* end = nullptr;
+		unsigned long long value = strtoull(p, &end, 10);
+		if (end == p || (value == 0 && !allowZero) || (*end && *end != ','))
+			return false;
+		values.push_back((size_t)value);
+		p = *end ? end + 1 : end;
+	}
+	return !values.empty();
+}
+
+//----------------------------------------------------------------------------
+// ParseSinks
+//----------------------------------------------------------------------------
+static bool ParseSinks(const char* list, std::vector<const Sink*>& sinks)
+{
+	sinks.clear();
+	std::string names(list);
+	size_t pos = 0;
+	while (pos <= names.size())
+	{
+		size_t end = std::min(names.find(',', pos), names.size());
+		std::string name = names.substr(pos, end - pos);
+		const Sink* found = nullptr;
+		for (const Sink& sink : SINKS)
+		{
+			if (name == sink.name)
+				found = &sink;
+		}
+		if (!found)
+			return false;
+		sinks.push_back(found);
+		pos = end + 1;
+	}
+	return !sinks.empty();
+}
+
+//----------------------------------------------------------------------------
+// Usage
+//----------------------------------------------------------------------------
+static int Usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [--dir DIR] [--records LIST] [--sizes LIST] [--intervals LIST]\n"
+		"    [--sinks buffered,vectored,direct,segment,uring] [--flushes N] [--json FILE]\n", program);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	std::vector<size_t> records = { 100, 1000 };
+	std::vector<size_t> sizes = { 64, 512 };
+	std::vector<size_t> intervals = { 0, 10 };
+	std::vector<const Sink*> sinks;
+	for (const Sink& sink : SINKS)
+		sinks.push_back(&sink);
+	const char* jsonPath = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return Usage(argv[0]);
+		bool valid = true;
+		if (strcmp(argv[i], "--dir") == 0)
+			targetDir = value;
+		else if (strcmp(argv[i], "--records") == 0)
+			valid = ParseList(value, records, false);
+		else if (strcmp(argv[i], "--sizes") == 0)
+			valid = ParseList(value, sizes, false);
+		else if (strcmp(argv[i], "--intervals") == 0)
+			valid = ParseList(value, intervals, true);
+		else if (strcmp(argv[i], "--sinks") == 0)
+			valid = ParseSinks(value, sinks);
+		else if (strcmp(argv[i], "--flushes") == 0)
+			flushCount = (size_t)std::max(1, atoi(value));
+		else if (strcmp(argv[i], "--json") == 0)
+			jsonPath = value;
+		else
+			valid = false;
+		if (!valid)
+			return Usage(argv[0]);
+		i++;
+	}
+
+	printf("%-12s %-5s %8s %6s %5s %10s %10s %10s %8s %10s\n", "sink", "sync", "records", "bytes",
+		"ms", "p50 us", "p99 us", "MB/s", "sysc/fl", "fsync us");
+
+	int index = 0;
+	for (const Sink* sink : sinks)
+	{
+		for (size_t recordCount : records)
+		{
+			for (size_t size : sizes)
+			{
+				for (size_t interval : intervals)
+				{
+					Result unsynced = Run(*sink, false, recordCount, size, interval, index++);
+					Result synced = Run(*sink, true, recordCount, size, interval, index++);
+					synced.fsyncNs = std::max(0.0, (double)synced.latency.GetPercentile(50).count() -
+						(double)unsynced.latency.GetPercentile(50).count());
+					Print(unsynced);
+					Print(synced);
+					results.push_back(unsynced);
+					results.push_back(synced);
+				}
+			}
+		}
+	}
+
+	if (jsonPath && !WriteJson(jsonPath))
+	{
+		fprintf(stderr, "Cannot write %s\n", jsonPath);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,372 @@
+// Logger workload replay tool.
+//
+// Replays captured production traffic into Logger::Write() so Logger changes are
+// measured against real record sizes, bursts and thread counts rather than
+// synthetic strings. The input is either:
+//
+// * a LogData text file. Lines starting with the "YYYY-MM-DDTHH:MM:SS.uuuuuuZ "
+//   stamp are replayed at their original spacing with the stamp removed, and
+//   lines without a stamp at the time of the previous stamped line.
+//   The file holds no producer, so records are dealt round robin to --threads
+//   producers.
+// * a binary trace of records, each a 64-bit timestamp in nanoseconds, a 32-bit
+//   producer ID and a 32-bit length followed by the record bytes, all in host
+//   byte order. Each distinct producer ID is replayed by its own thread.
+//
+// Every producer sleeps until each record's time, offset from the first record and
+// divided by --speed, then writes it. The run reports the records/s and bytes/s
+// accepted, the Write() latency, how late each write started against its
+// schedule (a late replay no longer reproduces the original load), the bytes/s
+// flushed and the drain time until the last record is on disk.
+//
+// Usage: LogReplay (--log FILE | --trace FILE) [options]
+//   --threads N          producers for a log file (default 1)
+//   --speed X            replay speed, 2 for twice as fast, 0 for flat out (default 1)
+//   --mode MODE          queue, lockfree, staged or percpu write path (default queue)
+//   --json FILE          also write the results to FILE
+//
+// The replayed records are written to LogData.txt in the working directory, so
+// run from a scratch directory and never from the directory of the input.
+
+#include "Logger.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/// Replay settings
+struct Options
+{
+	const char* logPath = nullptr;
+	const char* tracePath = nullptr;
+	int threads = 1;
+	double speed = 1;
+	std::string mode = "queue";
+	const char* jsonPath = nullptr;
+};
+
+/// A captured record and its time relative to the first record
+struct Record
+{
+	int64_t timeNs;
+	std::string text;
+};
+
+/// The records of one producer and its results
+struct Producer
+{
+	std::vector<Record> records;
+	uint64_t bytes = 0;
+	LatencyHistogram writeLatency;
+	LatencyHistogram lateness;
+};
+
+//----------------------------------------------------------------------------
+// DaysFromCivil
+//----------------------------------------------------------------------------
+/// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t DaysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+	const int64_t era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = (unsigned)(y - era * 400);
+	const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (int64_t)doe - 719468;
+}
+
+//----------------------------------------------------------------------------
+// ParseStamp
+//----------------------------------------------------------------------------
+/// Parse the "YYYY-MM-DDTHH:MM:SS.uuuuuuZ " stamp LogData prefixes records with
+/// @param[in] line - the log line
+/// @param[out] timeNs - the stamp time in nanoseconds since the epoch
+/// @param[out] length - the stamp length including the trailing space
+/// @return True if the line starts with a stamp.
+static bool ParseStamp(const std::string& line, int64_t& timeNs, size_t& length)
+{
+	int year, month, day, hour, minute, second, count = 0;
+	if (sscanf(line.c_str(), "%4d-%2d-%2dT%2d:%2d:%2d.%n", &year, &month, &day, &hour, &minute, &second, &count) != 6 ||
+		count != 20)
+		return false;
+
+	// Fraction of any precision, then "Z "
+	size_t pos = (size_t)count;
+	int64_t fractionNs = 0, scale = 100000000;
+	while (pos < line.size() && line[pos] >= '0' && line[pos] <= '9')
+	{
+		fractionNs += (line[pos++] - '0') * scale;
+		scale /= 10;
+	}
+	if (pos + 1 >= line.size() || line[pos] != 'Z' || line[pos + 1] != ' ')
+		return false;
+
+	int64_t seconds = DaysFromCivil(year, (unsigned)month, (unsigned)day) * 86400 + hour * 3600 + minute * 60 + second;
+	timeNs = seconds * 1000000000 + fractionNs;
+	length = pos + 2;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// LoadLog
+//----------------------------------------------------------------------------
+static bool LoadLog(const Options& options, std::vector<Producer>& producers)
+{
+	FILE* file = fopen(options.logPath, "rb");
+	if (!file)
+		return false;
+
+	producers.resize(options.threads);
+	std::string line;
+	int64_t firstNs = 0, timeNs = 0;
+	bool stamped = false;
+	size_t index = 0;
+	char buf[4096];
+	while (fgets(buf, sizeof(buf), file))
+	{
+		line.append(buf);
+		if (line.back() != '\n' && !feof(file))
+			continue;
+		if (line.back() == '\n')
+			line.pop_back();
+
+		int64_t stampNs;
+		size_t length = 0;
+		if (ParseStamp(line, stampNs, length))
+		{
+			if (!stamped)
+				firstNs = stampNs;
+			stamped = true;
+			timeNs = stampNs - firstNs;
+		}
+		producers[index++ % producers.size()].records.push_back({ timeNs, line.substr(length) });
+		line.clear();
+	}
+	fclose(file);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// LoadTrace
+//----------------------------------------------------------------------------
+static bool LoadTrace(const Options& options, std::vector<Producer>& producers)
+{
+	FILE* file = fopen(options.tracePath, "rb");
+	if (!file)
+		return false;
+
+	std::map<uint32_t, size_t> producerIndex;
+	bool first = true;
+	int64_t firstNs = 0;
+	bool success = true;
+	for (;;)
+	{
+		uint64_t timeNs;
+		uint32_t producer, length;
+		if (fread(&timeNs, sizeof(timeNs), 1, file) != 1)
+			break;
+		std::string text;
+		if (fread(&producer, sizeof(producer), 1, file) != 1 || fread(&length, sizeof(length), 1, file) != 1)
+		{
+			success = false;
+			break;
+		}
+		text.resize(length);
+		if (length && fread(&text[0], 1, length, file) != length)
+		{
+			success = false;
+			break;
+		}
+		if (first)
+			firstNs = (int64_t)timeNs;
+		first = false;
+
+		auto it = producerIndex.find(producer);
+		if (it == producerIndex.end())
+		{
+			it = producerIndex.emplace(producer, producers.size()).first;
+			producers.emplace_back();
+		}
+		producers[it->second].records.push_back({ (int64_t)timeNs - firstNs, std::move(text) });
+	}
+	fclose(file);
+	if (!success)
+		fprintf(stderr, "Truncated trace record in %s\n", options.tracePath);
+	return success;
+}
+
+//----------------------------------------------------------------------------
+// Replay
+//----------------------------------------------------------------------------
+static void Replay(const Options& options, std::chrono::steady_clock::time_point start, Producer& producer)
+{
+	Logger& logger = Logger::GetInstance();
+	for (Record& record : producer.records)
+	{
+		auto scheduled = start;
+		if (options.speed > 0)
+		{
+			scheduled += std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::nanoseconds((int64_t)((double)record.timeNs / options.speed)));
+			std::this_thread::sleep_until(scheduled);
+		}
+
+		size_t size = record.text.size();
+		auto written = std::chrono::steady_clock::now();
+		logger.Write(std::move(record.text));
+		auto now = std::chrono::steady_clock::now();
+		producer.writeLatency.Record(now - written);
+		if (options.speed > 0)
+			producer.lateness.Record(written - scheduled);
+		producer.bytes += size;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Usage
+//----------------------------------------------------------------------------
+static int Usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s (--log FILE | --trace FILE) [--threads N] [--speed X]\n"
+		"    [--mode queue|lockfree|staged|percpu] [--json FILE]\n", program);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return Usage(argv[0]);
+		if (strcmp(argv[i], "--log") == 0)
+			options.logPath = value;
+		else if (strcmp(argv[i], "--trace") == 0)
+			options.tracePath = value;
+		else if (strcmp(argv[i], "--threads") == 0)
+			options.threads = std::max(1, atoi(value));
+		else if (strcmp(argv[i], "--speed") == 0)
+			options.speed = std::max(0.0, atof(value));
+		else if (strcmp(argv[i], "--mode") == 0)
+			options.mode = value;
+		else if (strcmp(argv[i], "--json") == 0)
+			options.jsonPath = value;
+		else
+			return Usage(argv[0]);
+		i++;
+	}
+	if (!options.logPath == !options.tracePath ||
+		(options.mode != "queue" && options.mode != "lockfree" && options.mode != "staged" &&
+		options.mode != "percpu"))
+		return Usage(argv[0]);
+
+	// Load the whole capture first so reading it does not disturb the replay
+	std::vector<Producer> producers;
+	if (!(options.logPath ? LoadLog(options, producers) : LoadTrace(options, producers)))
+	{
+		fprintf(stderr, "Cannot read %s\n", options.logPath ? options.logPath : options.tracePath);
+		return 1;
+	}
+	uint64_t records = 0;
+	int64_t spanNs = 0;
+	for (const Producer& producer : producers)
+	{
+		records += producer.records.size();
+		if (!producer.records.empty())
+			spanNs = std::max(spanNs, producer.records.back().timeNs);
+	}
+	if (records == 0)
+	{
+		fprintf(stderr, "No records to replay\n");
+		return 1;
+	}
+
+	Logger& logger = Logger::GetInstance();
+	logger.SetLockFreeWrite(options.mode == "lockfree");
+	logger.SetStagedWrite(options.mode == "staged");
+	logger.SetPerCpuWrite(options.mode == "percpu");
+	logger.SetCoalesceStatus(true);
+	const Logger::Stats startStats = logger.GetStats();
+
+	// Producers start together a little in the future so none is late to start
+	std::vector<std::thread> threads;
+	const auto start = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+	for (Producer& producer : producers)
+		threads.emplace_back(Replay, std::cref(options), start, std::ref(producer));
+	for (auto& thread : threads)
+		thread.join();
+	const double replaySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Wait for everything written to reach the disk
+	logger.Flush();
+	logger.WriteDurable("LogReplay done").get();
+	const double drainSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	LatencyHistogram writeLatency, lateness;
+	uint64_t bytes = 0;
+	for (const Producer& producer : producers)
+	{
+		writeLatency.Merge(producer.writeLatency);
+		lateness.Merge(producer.lateness);
+		bytes += producer.bytes;
+	}
+	const Logger::Stats stats = logger.GetStats();
+	const uint64_t flushedBytes = stats.flushedBytes - startStats.flushedBytes;
+
+	const double PERCENTILES[] = { 50, 90, 99, 99.9, 99.99 };
+	const char* NAMES[] = { "p50", "p90", "p99", "p99_9", "p99_99" };
+
+	printf("%s, %zu producers, %llu records over %.3f s captured, speed %s, mode %s, replayed in %.3f s\n",
+		options.logPath ? options.logPath : options.tracePath, producers.size(), (unsigned long long)records,
+		(double)spanNs / 1e9, options.speed > 0 ? std::to_string(options.speed).c_str() : "flat out",
+		options.mode.c_str(), replaySeconds);
+	printf("records/s %.0f  bytes/s %.0f  flushed bytes/s %.0f  drain %.2f s\n", records / replaySeconds,
+		bytes / replaySeconds, flushedBytes / drainSeconds, drainSeconds - replaySeconds);
+	printf("write latency ns   ");
+	for (size_t i = 0; i < 5; i++)
+		printf(" %s %lld", NAMES[i], (long long)writeLatency.GetPercentile(PERCENTILES[i]).count());
+	if (options.speed > 0)
+	{
+		printf("\nlate start us      ");
+		for (size_t i = 0; i < 5; i++)
+			printf(" %s %lld", NAMES[i], (long long)lateness.GetPercentile(PERCENTILES[i]).count() / 1000);
+	}
+	printf("\npeak queue depth %zu  dropped %llu\n", stats.peakQueueDepth,
+		(unsigned long long)(stats.dropped - startStats.dropped + logger.GetDropCount()));
+
+	if (options.jsonPath)
+	{
+		FILE* file = fopen(options.jsonPath, "w");
+		if (!file)
+		{
+			fprintf(stderr, "Cannot write %s\n", options.jsonPath);
+			return 1;
+		}
+		fprintf(file, "{\n  \"producers\": %zu, \"records\": %llu, \"captured_seconds\": %.3f, \"speed\": %.3f, \"mode\": \"%s\", \"seconds\": %.3f,\n",
+			producers.size(), (unsigned long long)records, (double)spanNs / 1e9, options.speed, options.mode.c_str(), replaySeconds);
+		fprintf(file, "  \"records_per_s\": %.0f, \"bytes_per_s\": %.0f, \"flushed_bytes_per_s\": %.0f,\n",
+			records / replaySeconds, bytes / replaySeconds, flushedBytes / drainSeconds);
+		fprintf(file, "  \"write_latency_ns\": {");
+		for (size_t i = 0; i < 5; i++)
+			fprintf(file, "%s \"%s\": %lld", i ? "," : "", NAMES[i], (long long)writeLatency.GetPercentile(PERCENTILES[i]).count());
+		fprintf(file, " },\n  \"late_start_ns\": {");
+		for (size_t i = 0; i < 5; i++)
+			fprintf(file, "%s \"%s\": %lld", i ? "," : "", NAMES[i], (long long)lateness.GetPercentile(PERCENTILES[i]).count());
+		fprintf(file, " },\n  \"peak_queue_depth\": %zu\n}\n", stats.peakQueueDepth);
+		if (fclose(file) != 0)
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,383 @@
+// Logger throughput and tail latency load generator.
+//
+// Producer threads call Logger::Write() flat out or at a fixed rate per thread
+// with messages drawn from a size distribution. The run reports:
+//
+// * sustained records/s and bytes/s accepted by Write() and bytes/s flushed to disk
+// * the latency histogram of Write() itself
+// * the end to end latency of sampled records until synced to disk. Every Nth
+//   record of a producer is written with WriteDurable() and timed until its
+//   future is set.
+// * the process resident memory growth and the Logger peak queue depth
+//
+// Usage: LoggerLoad [options]
+//   --threads N          producer threads (default 4)
+//   --rate R             records/s per thread, 0 for flat out (default 0)
+//   --duration S         seconds to run (default 10)
+//   --size DIST          fixed:N, uniform:MIN:MAX or exp:MEAN bytes (default fixed:64)
+//   --durable-every N    sample end to end latency every N records, 0 to disable (default 1000)
+//   --mode MODE          queue, lockfree, staged, percpu or assist write path, assist being
+//                        the queue with producer assist over 256 queued records (default queue)
+//   --json FILE          also write the results to FILE
+
+#include "Logger.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/// Load generator settings
+struct Options
+{
+	int threads = 4;
+	double rate = 0;
+	double duration = 10;
+	std::string size = "fixed:64";
+	uint64_t durableEvery = 1000;
+	std::string mode = "queue";
+	const char* jsonPath = nullptr;
+};
+
+/// @brief Draws message sizes from the --size distribution
+class size_distribution
+{
+public:
+	bool Parse(const std::string& spec)
+	{
+		if (sscanf(spec.c_str(), "fixed:%zu", &m_min) == 1)
+		{
+			m_kind = FIXED;
+			m_max = m_min;
+		}
+		else if (sscanf(spec.c_str(), "uniform:%zu:%zu", &m_min, &m_max) == 2 && m_min <= m_max)
+			m_kind = UNIFORM;
+		else if (sscanf(spec.c_str(), "exp:%zu", &m_min) == 1 && m_min > 0)
+		{
+			m_kind = EXPONENTIAL;
+			m_max = m_min * 16;
+		}
+		else
+			return false;
+		return m_max > 0;
+	}
+
+	/// Get the largest size drawn
+	size_t GetMax() const { return m_max; }
+
+	size_t operator()(std::mt19937_64& random) const
+	{
+		switch (m_kind)
+		{
+		case UNIFORM:
+			return std::uniform_int_distribution<size_t>(m_min, m_max)(random);
+		case EXPONENTIAL:
+			return std::min(m_max, std::max<size_t>(1,
+				(size_t)std::exponential_distribution<double>(1.0 / (double)m_min)(random)));
+		default:
+			return m_min;
+		}
+	}
+
+private:
+	enum Kind { FIXED, UNIFORM, EXPONENTIAL };
+	Kind m_kind = FIXED;
+	size_t m_min = 0;
+	size_t m_max = 0;
+};
+
+/// A sampled durable record waiting to reach the disk
+struct DurableRecord
+{
+	std::chrono::steady_clock::time_point written;
+	std::future<bool> synced;
+};
+
+/// @brief Times sampled durable records until their futures are set. Runs on
+/// its own thread so producers never wait for the disk.
+class durable_collector
+{
+public:
+	durable_collector() : m_thread(&durable_collector::Process, this) {}
+
+	/// Wait for the queued records then exit the collector thread
+	void Finish()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_cv.notify_one();
+		m_thread.join();
+	}
+
+	void Add(DurableRecord&& record)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_records.push_back(std::move(record));
+		}
+		m_cv.notify_one();
+	}
+
+	const LatencyHistogram& GetLatency() const { return m_latency; }
+	uint64_t GetFailed() const { return m_failed; }
+
+private:
+	void Process()
+	{
+		while (1)
+		{
+			DurableRecord record;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_cv.wait(lock, [this]() { return !m_records.empty() || m_exit; });
+				if (m_records.empty())
+					return;
+				record = std::move(m_records.front());
+				m_records.pop_front();
+			}
+
+			// Records sync in order, so the oldest future is set first
+			if (record.synced.get())
+				m_latency.Record(std::chrono::steady_clock::now() - record.written);
+			else
+				m_failed++;
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::deque<DurableRecord> m_records;
+	bool m_exit = false;
+	LatencyHistogram m_latency;
+	uint64_t m_failed = 0;
+	std::thread m_thread;
+};
+
+/// Per producer results
+struct ProducerResult
+{
+	uint64_t records = 0;
+	uint64_t bytes = 0;
+	LatencyHistogram writeLatency;
+};
+
+static std::atomic<bool> stopProducers(false);
+
+//----------------------------------------------------------------------------
+// GetResidentBytes
+//----------------------------------------------------------------------------
+static uint64_t GetResidentBytes()
+{
+#if defined(__linux__)
+	unsigned long size = 0, resident = 0;
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (!file)
+		return 0;
+	if (fscanf(file, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	fclose(file);
+	return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Produce
+//----------------------------------------------------------------------------
+static void Produce(int index, const Options& options, const size_distribution& sizes,
+	durable_collector& collector, ProducerResult& result)
+{
+	std::mt19937_64 random(0x5eed + (uint64_t)index);
+	const std::string payload(sizes.GetMax(), 'a' + (char)(index % 26));
+
+	const auto start = std::chrono::steady_clock::now();
+	const auto interval = options.rate > 0 ?
+		std::chrono::duration<double>(1.0 / options.rate) : std::chrono::duration<double>(0);
+	Logger& logger = Logger::GetInstance();
+
+	for (uint64_t i = 0; !stopProducers.load(std::memory_order_relaxed); i++)
+	{
+		// Fixed rate producers keep to a schedule so a slow Write() is not hidden
+		if (options.rate > 0)
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval * (double)i));
+
+		std::string msg(payload.data(), sizes(random));
+		size_t size = msg.size();
+		bool durable = options.durableEvery && i % options.durableEvery == 0;
+
+		auto written = std::chrono::steady_clock::now();
+		std::future<bool> synced;
+		if (durable)
+			synced = logger.WriteDurable(std::move(msg));
+		else
+			logger.Write(std::move(msg));
+		result.writeLatency.Record(std::chrono::steady_clock::now() - written);
+
+		if (durable)
+			collector.Add(DurableRecord{ written, std::move(synced) });
+		result.records++;
+		result.bytes += size;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Usage
+//----------------------------------------------------------------------------
+static int Usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [--threads N] [--rate R] [--duration S] [--size fixed:N|uniform:MIN:MAX|exp:MEAN]\n"
+		"    [--durable-every N] [--mode queue|lockfree|staged|percpu|assist] [--json FILE]\n", program);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return Usage(argv[0]);
+		if (strcmp(argv[i], "--threads") == 0)
+			options.threads = std::max(1, atoi(value));
+		else if (strcmp(argv[i], "--rate") == 0)
+			options.rate = atof(value);
+		else if (strcmp(argv[i], "--duration") == 0)
+			options.duration = atof(value);
+		else if (strcmp(argv[i], "--size") == 0)
+			options.size = value;
+		else if (strcmp(argv[i], "--durable-every") == 0)
+			options.durableEvery = strtoull(value, nullptr, 10);
+		else if (strcmp(argv[i], "--mode") == 0)
+			options.mode = value;
+		else if (strcmp(argv[i], "--json") == 0)
+			options.jsonPath = value;
+		else
+			return Usage(argv[0]);
+		i++;
+	}
+
+	size_distribution sizes;
+	if (!sizes.Parse(options.size) ||
+		(options.mode != "queue" && options.mode != "lockfree" && options.mode != "staged" &&
+		options.mode != "percpu" && options.mode != "assist"))
+		return Usage(argv[0]);
+
+	Logger& logger = Logger::GetInstance();
+	logger.SetLockFreeWrite(options.mode == "lockfree");
+	logger.SetStagedWrite(options.mode == "staged");
+	logger.SetPerCpuWrite(options.mode == "percpu");
+	logger.SetProducerAssist(options.mode == "assist" ? 256 : 0);
+	logger.SetCoalesceStatus(true);
+
+	const uint64_t startResident = GetResidentBytes();
+	uint64_t peakResident = startResident;
+	const Logger::Stats startStats = logger.GetStats();
+
+	durable_collector collector;
+	std::vector<ProducerResult> producerResults(options.threads);
+	std::vector<std::thread> producers;
+	const auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < options.threads; i++)
+		producers.emplace_back(Produce, i, std::cref(options), std::cref(sizes), std::ref(collector), std::ref(producerResults[i]));
+
+	// Sample memory while the producers run
+	const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(options.duration));
+	while (std::chrono::steady_clock::now() < end)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		peakResident = std::max(peakResident, GetResidentBytes());
+	}
+	stopProducers = true;
+	for (auto& producer : producers)
+		producer.join();
+	const double produceSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Wait for everything written to reach the disk
+	logger.Flush();
+	logger.WriteDurable("LoggerLoad done").get();
+	collector.Finish();
+	const double drainSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	const uint64_t endResident = GetResidentBytes();
+	peakResident = std::max(peakResident, endResident);
+
+	LatencyHistogram writeLatency;
+	uint64_t records = 0, bytes = 0;
+	for (const auto& result : producerResults)
+	{
+		writeLatency.Merge(result.writeLatency);
+		records += result.records;
+		bytes += result.bytes;
+	}
+	const Logger::Stats stats = logger.GetStats();
+	const uint64_t flushedBytes = stats.flushedBytes - startStats.flushedBytes;
+
+	const double PERCENTILES[] = { 50, 90, 99, 99.9, 99.99 };
+	const char* NAMES[] = { "p50", "p90", "p99", "p99_9", "p99_99" };
+
+	printf("mode %s, threads %d, rate %s, size %s, %.1f s\n", options.mode.c_str(), options.threads,
+		options.rate > 0 ? std::to_string((long long)options.rate).c_str() : "flat out", options.size.c_str(), produceSeconds);
+	printf("records/s %.0f  bytes/s %.0f  flushed bytes/s %.0f  drain %.2f s\n", records / produceSeconds,
+		bytes / produceSeconds, flushedBytes / drainSeconds, drainSeconds - produceSeconds);
+	printf("write latency ns   ");
+	for (size_t i = 0; i < 5; i++)
+		printf(" %s %lld", NAMES[i], (long long)writeLatency.GetPercentile(PERCENTILES[i]).count());
+	printf("\nend to end us      ");
+	for (size_t i = 0; i < 5; i++)
+		printf(" %s %lld", NAMES[i], (long long)collector.GetLatency().GetPercentile(PERCENTILES[i]).count() / 1000);
+	printf(" (%llu samples, %llu failed)\n", (unsigned long long)collector.GetLatency().GetCount(),
+		(unsigned long long)collector.GetFailed());
+	printf("resident start %llu KB peak %llu KB end %llu KB  peak queue depth %zu  dropped %llu  assisted %llu\n",
+		(unsigned long long)startResident / 1024, (unsigned long long)peakResident / 1024,
+		(unsigned long long)endResident / 1024, stats.peakQueueDepth,
+		(unsigned long long)(stats.dropped - startStats.dropped + logger.GetDropCount()),
+		(unsigned long long)(stats.assisted - startStats.assisted));
+
+	if (options.jsonPath)
+	{
+		FILE* file = fopen(options.jsonPath, "w");
+		if (!file)
+		{
+			fprintf(stderr, "Cannot write %s\n", options.jsonPath);
+			return 1;
+		}
+		fprintf(file, "{\n  \"mode\": \"%s\", \"threads\": %d, \"rate\": %.0f, \"size\": \"%s\", \"seconds\": %.3f,\n",
+			options.mode.c_str(), options.threads, options.rate, options.size.c_str(), produceSeconds);
+		fprintf(file, "  \"records\": %llu, \"records_per_s\": %.0f, \"bytes_per_s\": %.0f, \"flushed_bytes_per_s\": %.0f,\n",
+			(unsigned long long)records, records / produceSeconds, bytes / produceSeconds, flushedBytes / drainSeconds);
+		fprintf(file, "  \"write_latency_ns\": {");
+		for (size_t i = 0; i < 5; i++)
+			fprintf(file, "%s \"%s\": %lld", i ? "," : "", NAMES[i], (long long)writeLatency.GetPercentile(PERCENTILES[i]).count());
+		fprintf(file, " },\n  \"end_to_end_ns\": {");
+		for (size_t i = 0; i < 5; i++)
+			fprintf(file, "%s \"%s\": %lld", i ? "," : "", NAMES[i], (long long)collector.GetLatency().GetPercentile(PERCENTILES[i]).count());
+		fprintf(file, " },\n  \"resident_start\": %llu, \"resident_peak\": %llu, \"resident_end\": %llu, \"peak_queue_depth\": %zu\n}\n",
+			(unsigned long long)startResident, (unsigned long long)peakResident, (unsigned long long)endResident, stats.peakQueueDepth);
+		if (fclose(file) != 0)
+			return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,196 @@
+#ifndef _PERF_COUNTERS_H
+#define _PERF_COUNTERS_H
+
+// Hardware performance counters of the calling thread around a measured region.
+//
+// On Linux each counter is opened with perf_event_open() for the calling thread
+// on any CPU: cycles, instructions, cache misses, branch misses and context
+// switches. A counter the kernel or the CPU does not provide, e.g. within a VM
+// or with kernel.perf_event_paranoid above 2, is reported unavailable and the
+// others are still read. Counters multiplexed onto fewer hardware counters are
+// scaled by their enabled and running times. Kernel time is counted when the
+// paranoid level allows it, otherwise user time only.
+//
+// On Windows only cycles are available, read with QueryThreadCycleTime().
+// Elsewhere no counter is available.
+//
+// Only the calling thread is counted, so an asynchronous case counts the
+// sending side, not the destination thread.
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#elif defined(WIN32)
+#include <Windows.h>
+#endif
+
+class PerfCounters
+{
+public:
+	/// The counters read
+	enum Counter
+	{
+		CYCLES,
+		INSTRUCTIONS,
+		CACHE_MISSES,
+		BRANCH_MISSES,
+		CONTEXT_SWITCHES,
+		COUNTERS
+	};
+
+	/// Counts accumulated over one or more regions
+	struct Counts
+	{
+		double value[COUNTERS] = {};
+	};
+
+	/// Open the counters for the calling thread
+	PerfCounters()
+	{
+#if defined(__linux__)
+		static const struct { uint32_t type; uint64_t config; } EVENTS[COUNTERS] = {
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+			{ PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+			{ PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+		};
+		for (int i = 0; i < COUNTERS; i++)
+		{
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = EVENTS[i].type;
+			attr.config = EVENTS[i].config;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.exclude_hv = 1;
+			m_fd[i] = Open(attr);
+			if (m_fd[i] < 0)
+			{
+				// Unprivileged processes may only count user time
+				attr.exclude_kernel = 1;
+				m_fd[i] = Open(attr);
+			}
+		}
+#endif
+	}
+
+	~PerfCounters()
+	{
+#if defined(__linux__)
+		for (int fd : m_fd)
+		{
+			if (fd >= 0)
+				close(fd);
+		}
+#endif
+	}
+
+	/// Check if a counter is read
+	bool IsAvailable(Counter counter) const
+	{
+#if defined(__linux__)
+		return m_fd[counter] >= 0;
+#elif defined(WIN32)
+		return counter == CYCLES;
+#else
+		(void)counter;
+		return false;
+#endif
+	}
+
+	/// Check if any counter is read
+	bool IsAnyAvailable() const
+	{
+		for (int i = 0; i < COUNTERS; i++)
+		{
+			if (IsAvailable((Counter)i))
+				return true;
+		}
+		return false;
+	}
+
+	/// Get the name of a counter
+	static const char* GetName(Counter counter)
+	{
+		static const char* const NAMES[COUNTERS] = {
+			"cycles", "instructions", "cache_misses", "branch_misses", "context_switches"
+		};
+		return NAMES[counter];
+	}
+
+	/// Read the counters at the start of a region
+	void Start() { Read(m_start); }
+
+	/// Read the counters at the end of a region and add the counts since Start()
+	/// @param[in,out] counts - the counts the region is added to
+	void Stop(Counts& counts)
+	{
+		Sample end[COUNTERS];
+		Read(end);
+		for (int i = 0; i < COUNTERS; i++)
+		{
+			uint64_t running = end[i].running - m_start[i].running;
+			uint64_t enabled = end[i].enabled - m_start[i].enabled;
+			if (running == 0)
+				continue;
+			double delta = (double)(end[i].value - m_start[i].value);
+			counts.value[i] += running < enabled ? delta * (double)enabled / (double)running : delta;
+		}
+	}
+
+private:
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/// A counter value with the times it was enabled and counting
+	struct Sample
+	{
+		uint64_t value = 0;
+		uint64_t enabled = 0;
+		uint64_t running = 0;
+	};
+
+#if defined(__linux__)
+	static int Open(perf_event_attr& attr)
+	{
+		return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+	}
+#endif
+
+	void Read(Sample* samples)
+	{
+#if defined(__linux__)
+		for (int i = 0; i < COUNTERS; i++)
+		{
+			uint64_t values[3];
+			if (m_fd[i] >= 0 && read(m_fd[i], values, sizeof(values)) == (ssize_t)sizeof(values))
+			{
+				samples[i].value = values[0];
+				samples[i].enabled = values[1];
+				samples[i].running = values[2];
+			}
+		}
+#elif defined(WIN32)
+		ULONG64 cycles = 0;
+		QueryThreadCycleTime(GetCurrentThread(), &cycles);
+		samples[CYCLES].value = cycles;
+
+		// Never multiplexed, so any equal advancing times do
+		samples[CYCLES].enabled = samples[CYCLES].running = cycles;
+#else
+		(void)samples;
+#endif
+	}
+
+#if defined(__linux__)
+	int m_fd[COUNTERS];
+#endif
+	Sample m_start[COUNTERS];
+};
+
+#endif
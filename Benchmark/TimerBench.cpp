@@ -0,0 +1,336 @@
+// Timer subsystem scale benchmark.
+//
+// Creates a growing number of timers in one TimerSet, with periods drawn
+// log-uniformly between --min-period and --max-period, and services the set on
+// one thread the way a WorkerThread does: ProcessTimers(), then a wait until the
+// next expiration. Churn WorkerThreads meanwhile stop, start and restart random
+// timers at a fixed rate. Each timer count reports:
+//
+// * the time to start every timer
+// * the ProcessTimers() cost per service tick and the timers expired per tick
+// * the expiry jitter, the time from the requested deadline until the Expired
+//   callback runs
+// * the Start() and Stop() latency on the churn threads. The calls hold
+//   TimerSet::m_lock for all of their work, so the latency is the lock hold time
+//   plus the wait for ProcessTimers() or another churn thread to release it.
+//
+// Usage: TimerBench [options]
+//   --max-timers N       the largest timer count, swept in powers of ten from 100
+//                        (default 1000000)
+//   --min-period MS      the shortest timer period (default 100)
+//   --max-period MS      the longest timer period (default 60000)
+//   --churn-threads N    WorkerThreads starting and stopping timers (default 4)
+//   --churn-rate R       starts and stops per second per churn thread (default 10000)
+//   --duration S         seconds each timer count runs (default 2)
+//   --json FILE          also write the results to FILE
+
+#include "DelegateLib.h"
+#include "WorkerThreadStd.h"
+#include "Timer.h"
+#include "LatencyHistogram.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace DelegateLib;
+using namespace std;
+
+/// Benchmark settings
+struct Options
+{
+	size_t maxTimers = 1000000;
+	int64_t minPeriod = 100;
+	int64_t maxPeriod = 60000;
+	int churnThreads = 4;
+	double churnRate = 10000;
+	double duration = 2;
+	const char* jsonPath = nullptr;
+};
+
+/// The result of one timer count
+struct Result
+{
+	size_t timers;
+	double startSeconds;
+	uint64_t ticks;
+	uint64_t expired;
+	LatencyHistogram tickCost;
+	LatencyHistogram jitter;
+	LatencyHistogram churnLatency;
+	uint64_t churnOps;
+};
+
+static std::vector<Result> results;
+
+/// Expiry jitter, only recorded by the servicing thread
+static LatencyHistogram* jitterHistogram = nullptr;
+static uint64_t expiredCount = 0;
+
+static std::atomic<bool> stopChurn(false);
+
+/// @brief A timer that records how late each expiration runs
+class BenchTimer
+{
+public:
+	BenchTimer(TimerSet& timers, std::chrono::microseconds period) :
+		m_timer(timers), m_period(period)
+	{
+		m_timer.Expired = MakeDelegate(this, &BenchTimer::OnExpired);
+	}
+
+	void Start()
+	{
+		m_deadline.store(Timer::GetTime().count() + m_period.count(), std::memory_order_relaxed);
+		m_timer.Start(m_period);
+	}
+
+	void Stop()
+	{
+		m_timer.Stop();
+		m_deadline.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	void OnExpired()
+	{
+		int64_t now = Timer::GetTime().count();
+		int64_t deadline = m_deadline.load(std::memory_order_relaxed);
+		if (deadline == 0)
+			return;
+		jitterHistogram->Record(std::chrono::microseconds(std::max<int64_t>(0, now - deadline)));
+		expiredCount++;
+
+		// A periodic timer that falls behind skips the missed expirations
+		int64_t next = deadline + m_period.count();
+		if (next <= now)
+			next += ((now - next) / m_period.count() + 1) * m_period.count();
+		m_deadline.compare_exchange_strong(deadline, next, std::memory_order_relaxed);
+	}
+
+	Timer m_timer;
+	const std::chrono::microseconds m_period;
+
+	/// The requested deadline of the next expiration in ticks, or 0 if stopped
+	std::atomic<int64_t> m_deadline{ 0 };
+};
+
+/// Per churn thread results
+struct ChurnResult
+{
+	LatencyHistogram latency;
+	uint64_t ops = 0;
+};
+
+//----------------------------------------------------------------------------
+// Churn
+//----------------------------------------------------------------------------
+/// Stop, start and restart random timers until stopped. Runs on a churn WorkerThread.
+static void Churn(std::deque<BenchTimer>& timers, double rate, int index, ChurnResult& result)
+{
+	std::mt19937_64 random(0xc0ffee + (uint64_t)index);
+	std::uniform_int_distribution<size_t> pick(0, timers.size() - 1);
+	const auto interval = std::chrono::duration<double>(rate > 0 ? 1.0 / rate : 0.0);
+	const auto start = std::chrono::steady_clock::now();
+
+	for (uint64_t i = 0; !stopChurn.load(std::memory_order_relaxed); i++)
+	{
+		if (rate > 0 && i % 16 == 0)
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval * (double)i));
+
+		BenchTimer& timer = timers[pick(random)];
+		bool stop = random() % 3 == 0;
+		auto called = std::chrono::steady_clock::now();
+		if (stop)
+			timer.Stop();
+		else
+			timer.Start();
+		result.latency.Record(std::chrono::steady_clock::now() - called);
+		result.ops++;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Run
+//----------------------------------------------------------------------------
+static Result Run(size_t count, const Options& options)
+{
+	Result result;
+	result.timers = count;
+	result.ticks = 0;
+	result.churnOps = 0;
+	jitterHistogram = &result.jitter;
+	expiredCount = 0;
+
+	TimerSet timers;
+	std::deque<BenchTimer> benchTimers;
+	{
+		std::mt19937_64 random(count);
+		std::uniform_real_distribution<double> logPeriod(std::log((double)options.minPeriod), std::log((double)options.maxPeriod));
+		for (size_t i = 0; i < count; i++)
+			benchTimers.emplace_back(timers, std::chrono::microseconds((int64_t)(std::exp(logPeriod(random)) * 1000.0)));
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	for (BenchTimer& timer : benchTimers)
+		timer.Start();
+	result.startSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Churn from WorkerThreads while this thread services the set
+	stopChurn = false;
+	std::vector<std::unique_ptr<WorkerThread>> churnThreads;
+	std::vector<ChurnResult> churnResults(options.churnThreads);
+	for (int i = 0; i < options.churnThreads; i++)
+	{
+		churnThreads.push_back(std::make_unique<WorkerThread>("TimerChurn" + std::to_string(i)));
+		churnThreads.back()->CreateThread();
+		std::function<void()> churn = [&benchTimers, &options, &churnResults, i]() {
+			Churn(benchTimers, options.churnRate, i, churnResults[i]);
+		};
+		MakeDelegate(churn, *churnThreads.back())();
+	}
+
+	const auto end = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(options.duration));
+	while (std::chrono::steady_clock::now() < end)
+	{
+		auto tick = std::chrono::steady_clock::now();
+		timers.ProcessTimers();
+		result.tickCost.Record(std::chrono::steady_clock::now() - tick);
+		result.ticks++;
+
+		// Wait for the next expiration, waking at least every millisecond for
+		// timers the churn threads start earlier
+		std::chrono::microseconds next;
+		auto wait = std::chrono::microseconds(1000);
+		if (timers.GetNextExpiration(next))
+			wait = std::min(wait, next - Timer::GetTime());
+		if (wait > std::chrono::microseconds(0))
+			std::this_thread::sleep_for(wait);
+	}
+
+	stopChurn = true;
+	for (auto& thread : churnThreads)
+		thread->ExitThread();
+	for (const ChurnResult& churn : churnResults)
+	{
+		result.churnLatency.Merge(churn.latency);
+		result.churnOps += churn.ops;
+	}
+	result.expired = expiredCount;
+	jitterHistogram = nullptr;
+	return result;
+}
+
+//----------------------------------------------------------------------------
+// Print
+//----------------------------------------------------------------------------
+static void Print(const Result& r)
+{
+	printf("%8zu %9.1f %8llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", r.timers, r.startSeconds * 1000.0,
+		(unsigned long long)r.ticks, r.ticks ? (double)r.expired / (double)r.ticks : 0.0,
+		(double)r.tickCost.GetPercentile(50).count() / 1000.0,
+		(double)r.tickCost.GetPercentile(99).count() / 1000.0,
+		(double)r.jitter.GetPercentile(50).count() / 1000.0,
+		(double)r.jitter.GetPercentile(99).count() / 1000.0,
+		(double)r.churnLatency.GetPercentile(50).count() / 1000.0,
+		(double)r.churnLatency.GetPercentile(99).count() / 1000.0);
+	fflush(stdout);
+}
+
+//----------------------------------------------------------------------------
+// WriteJson
+//----------------------------------------------------------------------------
+static bool WriteJson(const Options& options)
+{
+	FILE* file = fopen(options.jsonPath, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"min_period_ms\": %lld, \"max_period_ms\": %lld, \"churn_threads\": %d, "
+		"\"churn_rate\": %.0f, \"seconds\": %.3f,\n  \"results\": [\n", (long long)options.minPeriod,
+		(long long)options.maxPeriod, options.churnThreads, options.churnRate, options.duration);
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const Result& r = results[i];
+		fprintf(file, "    { \"timers\": %zu, \"start_all_s\": %.6f, \"ticks\": %llu, \"expired\": %llu, "
+			"\"tick_p50_ns\": %lld, \"tick_p99_ns\": %lld, \"jitter_p50_ns\": %lld, \"jitter_p99_ns\": %lld, "
+			"\"churn_ops\": %llu, \"churn_p50_ns\": %lld, \"churn_p99_ns\": %lld }%s\n",
+			r.timers, r.startSeconds, (unsigned long long)r.ticks, (unsigned long long)r.expired,
+			(long long)r.tickCost.GetPercentile(50).count(), (long long)r.tickCost.GetPercentile(99).count(),
+			(long long)r.jitter.GetPercentile(50).count(), (long long)r.jitter.GetPercentile(99).count(),
+			(unsigned long long)r.churnOps, (long long)r.churnLatency.GetPercentile(50).count(),
+			(long long)r.churnLatency.GetPercentile(99).count(), i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+	return fclose(file) == 0;
+}
+
+//----------------------------------------------------------------------------
+// Usage
+//----------------------------------------------------------------------------
+static int Usage(const char* program)
+{
+	fprintf(stderr, "Usage: %s [--max-timers N] [--min-period MS] [--max-period MS]\n"
+		"    [--churn-threads N] [--churn-rate R] [--duration S] [--json FILE]\n", program);
+	return 1;
+}
+
+//------------------------------------------------------------------------------
+// main
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+	Options options;
+	for (int i = 1; i < argc; i++)
+	{
+		const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+		if (!value)
+			return Usage(argv[0]);
+		if (strcmp(argv[i], "--max-timers") == 0)
+			options.maxTimers = (size_t)std::max(100LL, atoll(value));
+		else if (strcmp(argv[i], "--min-period") == 0)
+			options.minPeriod = std::max(1LL, atoll(value));
+		else if (strcmp(argv[i], "--max-period") == 0)
+			options.maxPeriod = std::max(1LL, atoll(value));
+		else if (strcmp(argv[i], "--churn-threads") == 0)
+			options.churnThreads = std::max(0, atoi(value));
+		else if (strcmp(argv[i], "--churn-rate") == 0)
+			options.churnRate = atof(value);
+		else if (strcmp(argv[i], "--duration") == 0)
+			options.duration = std::max(0.1, atof(value));
+		else if (strcmp(argv[i], "--json") == 0)
+			options.jsonPath = value;
+		else
+			return Usage(argv[0]);
+		i++;
+	}
+	if (options.minPeriod > options.maxPeriod)
+		return Usage(argv[0]);
+
+	printf("%8s %9s %8s %9s %9s %9s %9s %9s %9s %9s\n", "timers", "start ms", "ticks", "exp/tick",
+		"tick50 us", "tick99 us", "jit50 us", "jit99 us", "ctl50 us", "ctl99 us");
+
+	for (size_t count = 100; count <= options.maxTimers; count *= 10)
+	{
+		results.push_back(Run(count, options));
+		Print(results.back());
+	}
+
+	if (options.jsonPath && !WriteJson(options))
+	{
+		fprintf(stderr, "Cannot write %s\n", options.jsonPath);
+		return 1;
+	}
+	return 0;
+}
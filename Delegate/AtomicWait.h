@@ -0,0 +1,166 @@
+#ifndef _DELEGATELIB_ATOMIC_WAIT_H
+#define _DELEGATELIB_ATOMIC_WAIT_H
+
+/// @file
+/// @brief Sleep until a 32-bit atomic word changes, on the platform's native wait.
+///
+/// @details `AtomicWait()` sleeps while a word holds an expected value and
+/// `AtomicWake()` wakes the threads sleeping on it, like C++20 `std::atomic::wait()`
+/// with a timeout. The waker changes the word before waking, so a wake between the
+/// waiter's last check and its sleep is never lost. A wait may return spuriously,
+/// so the caller checks the word again.
+///
+/// The backend is selected at build time, see `DELEGATE_WAIT_BACKEND` in
+/// CMakeLists.txt. Unless one of these is defined, the first available is used:
+///
+/// * `DELEGATE_WAIT_FUTEX` - a private futex on Linux.
+/// * `DELEGATE_WAIT_ADDRESS` - `WaitOnAddress()` on Windows 8 and later.
+/// * `DELEGATE_WAIT_ATOMIC` - `std::atomic::wait()` on C++20 libraries. A timed
+///   wait, which the standard does not provide, sleeps on a parking bucket instead.
+/// * `DELEGATE_WAIT_CONDVAR` - a mutex and condition variable from a table of
+///   parking buckets hashed on the word's address. Portable.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+#if !defined(DELEGATE_WAIT_FUTEX) && !defined(DELEGATE_WAIT_ADDRESS) && \
+	!defined(DELEGATE_WAIT_ATOMIC) && !defined(DELEGATE_WAIT_CONDVAR)
+	#if defined(__linux__)
+		#define DELEGATE_WAIT_FUTEX
+	#elif defined(_WIN32)
+		#define DELEGATE_WAIT_ADDRESS
+	#elif defined(__cpp_lib_atomic_wait)
+		#define DELEGATE_WAIT_ATOMIC
+	#else
+		#define DELEGATE_WAIT_CONDVAR
+	#endif
+#endif
+
+#if defined(DELEGATE_WAIT_FUTEX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <climits>
+#include <ctime>
+#elif defined(DELEGATE_WAIT_ADDRESS)
+#include <Windows.h>
+#pragma comment(lib, "Synchronization.lib")
+#endif
+
+namespace DelegateLib {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t) && std::atomic<uint32_t>::is_always_lock_free,
+	"AtomicWait() sleeps on the atomic word's address");
+
+namespace detail {
+	/// A mutex and condition variable shared by the words hashed to it
+	struct ParkingBucket
+	{
+		std::mutex lock;
+		std::condition_variable cv;
+
+		/// The number of threads sleeping on the bucket
+		std::atomic<uint32_t> sleepers{ 0 };
+	};
+
+	inline ParkingBucket& GetParkingBucket(const void* address) noexcept
+	{
+		// Never destroyed, since threads exit during static destruction
+		static const size_t BUCKETS = 64;
+		static ParkingBucket* const buckets = new ParkingBucket[BUCKETS];
+		uintptr_t key = reinterpret_cast<uintptr_t>(address);
+		return buckets[(key >> 4 ^ key >> 10) % BUCKETS];
+	}
+
+	inline void ParkWait(const std::atomic<uint32_t>& word, uint32_t expected,
+		const std::chrono::nanoseconds* timeout)
+	{
+		ParkingBucket& bucket = GetParkingBucket(&word);
+		std::unique_lock<std::mutex> lk(bucket.lock);
+		bucket.sleepers.fetch_add(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		auto changed = [&word, expected]() { return word.load(std::memory_order_acquire) != expected; };
+		if (timeout)
+			bucket.cv.wait_for(lk, *timeout, changed);
+		else
+			bucket.cv.wait(lk, changed);
+		bucket.sleepers.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	inline void ParkWake(const std::atomic<uint32_t>& word)
+	{
+		ParkingBucket& bucket = GetParkingBucket(&word);
+
+		// Pairs with the sleeper count increment before the waiter checks the word
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (bucket.sleepers.load(std::memory_order_relaxed) == 0)
+			return;
+
+		// Words sharing the bucket are woken too and go back to sleep
+		std::lock_guard<std::mutex> lk(bucket.lock);
+		bucket.cv.notify_all();
+	}
+}
+
+/// @brief Sleep while a word holds the expected value.
+/// @param[in] word The word to sleep on.
+/// @param[in] expected The value to sleep on.
+/// @param[in] timeout The longest time to sleep, or `nullptr` for no limit.
+inline void AtomicWait(const std::atomic<uint32_t>& word, uint32_t expected,
+	const std::chrono::nanoseconds* timeout = nullptr)
+{
+#if defined(DELEGATE_WAIT_FUTEX)
+	struct timespec ts;
+	if (timeout)
+	{
+		ts.tv_sec = (time_t)(timeout->count() / 1000000000);
+		ts.tv_nsec = (long)(timeout->count() % 1000000000);
+	}
+	syscall(SYS_futex, reinterpret_cast<const uint32_t*>(&word), FUTEX_WAIT_PRIVATE, expected,
+		timeout ? &ts : nullptr, nullptr, 0);
+#elif defined(DELEGATE_WAIT_ADDRESS)
+	DWORD ms = INFINITE;
+	if (timeout)
+		ms = (DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(*timeout).count() + 1;
+	WaitOnAddress(const_cast<std::atomic<uint32_t>*>(&word), &expected, sizeof(expected), ms);
+#elif defined(DELEGATE_WAIT_ATOMIC)
+	if (timeout)
+		detail::ParkWait(word, expected, timeout);
+	else
+		word.wait(expected, std::memory_order_acquire);
+#else
+	detail::ParkWait(word, expected, timeout);
+#endif
+}
+
+/// @brief Wake the threads sleeping on a word. Called after changing the word.
+/// @param[in] word The word slept on.
+/// @param[in] all True to wake every sleeping thread, false to wake one.
+inline void AtomicWake(std::atomic<uint32_t>& word, bool all = true)
+{
+#if defined(DELEGATE_WAIT_FUTEX)
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE, all ? INT_MAX : 1,
+		nullptr, nullptr, 0);
+#elif defined(DELEGATE_WAIT_ADDRESS)
+	if (all)
+		WakeByAddressAll(&word);
+	else
+		WakeByAddressSingle(&word);
+#elif defined(DELEGATE_WAIT_ATOMIC)
+	if (all)
+		word.notify_all();
+	else
+		word.notify_one();
+	detail::ParkWake(word);
+#else
+	(void)all;
+	detail::ParkWake(word);
+#endif
+}
+
+}
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef _DELEGATELIB_CLOCK_H
+#define _DELEGATELIB_CLOCK_H
+
+/// @file
+/// @brief Replaceable time source for timers, timeouts and flush deadlines.
+///
+/// @details Timers, the Logger flush and staging deadlines, `SignalThread` waits and
+/// `AsyncWait` timeouts read the time from `Clock::Now()`. By default this is the
+/// steady clock. A test installs a `VirtualClock` with `Clock::Set()` and moves time
+/// forward with `VirtualClock::Advance()`, so timer driven behavior runs without
+/// waiting in real time. While a virtual clock is installed, time stands still
+/// between advances.
+///
+/// A thread blocked until a deadline converts it with `Clock::ToSteady()` and
+/// registers an advanced hook that wakes it, so an advance is seen at once.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace DelegateLib {
+
+/// @brief A time source. The installed clock is used by all threads.
+class Clock
+{
+public:
+	typedef std::chrono::steady_clock::time_point time_point;
+
+	/// Called after the installed clock changes or advances
+	typedef void (*AdvancedHook)(void* context);
+
+	virtual ~Clock() = default;
+
+	/// Get the time of this clock
+	/// @return The current time.
+	virtual time_point GetNow() const = 0;
+
+	/// Get the time of the installed clock
+	/// @return The current time. The steady clock time if no clock is installed.
+	static time_point Now()
+	{
+		const Clock* clock = Installed().load(std::memory_order_acquire);
+		return clock ? clock->GetNow() : std::chrono::steady_clock::now();
+	}
+
+	/// Install a clock. The clock must outlive its use, so install it before the
+	/// threads reading the time and restore the steady clock before destroying it.
+	/// @param[in] clock - the clock, or nullptr for the steady clock
+	static void Set(const Clock* clock)
+	{
+		Installed().store(clock, std::memory_order_release);
+		NotifyAdvanced();
+	}
+
+	/// Check if a clock other than the steady clock is installed
+	/// @return True if a virtual clock is installed.
+	static bool IsVirtual() { return Installed().load(std::memory_order_acquire) != nullptr; }
+
+	/// Convert a deadline of the installed clock into a steady clock deadline for
+	/// waiting on a condition variable. A virtual clock maps the remaining time onto
+	/// real time so a waiter not woken by an advance still wakes eventually and
+	/// rechecks the deadline.
+	/// @param[in] deadline - the deadline of the installed clock
+	/// @return The steady clock deadline.
+	static time_point ToSteady(time_point deadline)
+	{
+		const Clock* clock = Installed().load(std::memory_order_acquire);
+		if (!clock || deadline == time_point::max())
+			return deadline;
+		auto now = clock->GetNow();
+		return std::chrono::steady_clock::now() + (deadline > now ? deadline - now : time_point::duration(0));
+	}
+
+	/// Get a count incremented each time the installed clock changes or advances.
+	/// A waiter stops waiting when the count changes.
+	/// @return The advance count.
+	static uint64_t GetAdvances() { return Advances().load(std::memory_order_acquire); }
+
+	/// Add a function called after the installed clock changes or advances. A hook
+	/// already added with the same context is not added again.
+	/// @param[in] hook - the function to call
+	/// @param[in] context - the argument passed to the hook
+	static void AddAdvancedHook(AdvancedHook hook, void* context)
+	{
+		const std::lock_guard<std::mutex> lock(HooksLock());
+		for (auto& entry : Hooks())
+		{
+			if (entry.first == hook && entry.second == context)
+				return;
+		}
+		Hooks().emplace_back(hook, context);
+	}
+
+	/// Remove a function added with AddAdvancedHook()
+	/// @param[in] hook - the function to remove
+	/// @param[in] context - the argument passed to the hook
+	static void RemoveAdvancedHook(AdvancedHook hook, void* context)
+	{
+		const std::lock_guard<std::mutex> lock(HooksLock());
+		auto& hooks = Hooks();
+		for (auto it = hooks.begin(); it != hooks.end(); ++it)
+		{
+			if (it->first == hook && it->second == context)
+			{
+				hooks.erase(it);
+				return;
+			}
+		}
+	}
+
+protected:
+	/// Count an advance and call the advanced hooks
+	static void NotifyAdvanced()
+	{
+		Advances().fetch_add(1, std::memory_order_acq_rel);
+		const std::lock_guard<std::mutex> lock(HooksLock());
+		for (auto& entry : Hooks())
+			entry.first(entry.second);
+	}
+
+private:
+	static std::atomic<const Clock*>& Installed()
+	{
+		static std::atomic<const Clock*> clock{ nullptr };
+		return clock;
+	}
+
+	static std::atomic<uint64_t>& Advances()
+	{
+		static std::atomic<uint64_t> advances{ 0 };
+		return advances;
+	}
+
+	static std::mutex& HooksLock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	static std::vector<std::pair<AdvancedHook, void*>>& Hooks()
+	{
+		static std::vector<std::pair<AdvancedHook, void*>> hooks;
+		return hooks;
+	}
+};
+
+/// @brief A clock that only moves when advanced. Used by tests to run timer
+/// driven behavior instantly.
+class VirtualClock : public Clock
+{
+public:
+	/// Constructor
+	/// @param[in] start - the initial time
+	explicit VirtualClock(time_point start = std::chrono::steady_clock::now()) :
+		m_now(start.time_since_epoch().count())
+	{
+	}
+
+	/// Get the time of this clock
+	/// @return The current virtual time.
+	virtual time_point GetNow() const override
+	{
+		return time_point(time_point::duration(m_now.load(std::memory_order_acquire)));
+	}
+
+	/// Move the time forward and wake the threads waiting on a deadline
+	/// @param[in] duration - the time to advance
+	void Advance(std::chrono::nanoseconds duration)
+	{
+		m_now.fetch_add(std::chrono::duration_cast<time_point::duration>(duration).count(),
+			std::memory_order_acq_rel);
+		NotifyAdvanced();
+	}
+
+private:
+	std::atomic<time_point::rep> m_now;
+};
+
+}
+
+#endif
@@ -9,22 +9,31 @@
 /// @brief Delegate series of classes are used to invoke a function synchronously. 
 /// @details Delgates support binding to free functions, class instance functions, class 
 /// static function, and std::function targets. Lambda functions can be bound to a delegate 
-/// when assigned to a `std::function`. The classes are not thread safe.
+/// directly or when assigned to a `std::function`. The classes are not thread safe.
 /// 
 /// Limitations:
 /// 
 /// * Cannot insert `DelegateMember` into an ordered container. e.g. `std::list` ok, 
 /// `std::set` not ok.
 /// 
-/// * `std::function` compares the function signature type, not the underlying object instance.
-/// See `DelegateFunction<>` class for more info.
+/// * `DelegateFunction<>` compares the type of the bound callable, not the underlying object
+/// instance. See `DelegateFunction<>` class for more info. Built without RTTI, two non-empty
+/// `DelegateFunction<>` instances bound to a `std::function` of the same signature always
+/// compare equal.
 
 #include <functional>
 #include <memory>
+#include <cstddef>
+#include <new>
+#include <memory_resource>
 #include "DelegateOpt.h"
+#include "DelegateTypeId.h"
+#include "inline_function.h"
 
 namespace DelegateLib {
 
+class DelegateThread;
+
 /// @brief Non-template base class for all delegates.
 class DelegateBase {
 public:
@@ -53,6 +62,12 @@ public:
     /// @return `true` if the objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& other) const = 0;
 
+    /// @brief Check if this delegate is of a type or derived from it. Used in 
+    /// place of `dynamic_cast`. See `delegate_cast()`.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept { (void)typeId; return false; }
+
     /// @brief Clone a delegate instance.
     /// @details Use Clone() to provide a deep copy using a base pointer. Covariant 
     /// overloading is used so that a Clone() method return type is a more 
@@ -67,6 +82,15 @@ public:
     XALLOCATOR
 };
 
+/// @brief Cast a delegate to a derived delegate type without RTTI
+/// @tparam T The derived delegate type.
+/// @param[in] delegate The delegate to cast.
+/// @return The delegate as `T`, or `nullptr` if the delegate is not a `T`.
+template <class T>
+const T* delegate_cast(const DelegateBase* delegate) noexcept {
+    return delegate && delegate->IsType(type_id<T>()) ? static_cast<const T*>(delegate) : nullptr;
+}
+
 template <class R>
 struct Delegate; // Not defined
 
@@ -86,6 +110,64 @@ public:
     /// @return A new Delegate instance created on the heap. 
     /// @post The caller is responsible for deleting the instance.
     virtual Delegate* Clone() const = 0;
+
+    /// @brief Clone a Delegate instance within caller supplied storage. Used by 
+    /// containers to store delegates inline rather than on the heap.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return The instance within `buffer`, or `nullptr` if not supported or it does 
+    /// not fit. Use `Clone()` instead if `nullptr`.
+    /// @post The caller is responsible for calling the instance destructor. Do not delete it.
+    virtual Delegate* CloneTo(void* buffer, size_t size) const { (void)buffer; (void)size; return nullptr; }
+
+    /// @brief Get the storage size `CloneTo()` needs.
+    /// @return The size in bytes, or 0 if `CloneTo()` is not supported.
+    virtual size_t CloneSize() const { return 0; }
+
+    /// @brief Clone a Delegate instance within storage taken from a memory resource.
+    /// @param[in] resource The memory resource.
+    /// @return The instance, or `nullptr` if `CloneTo()` is not supported. Use `Clone()` 
+    /// instead if `nullptr`.
+    /// @throws std::bad_alloc If the resource is exhausted.
+    /// @post The caller is responsible for releasing the instance with `Destroy()`.
+    Delegate* Clone(std::pmr::memory_resource& resource) const {
+        size_t size = CloneSize();
+        if (size == 0)
+            return nullptr;
+        void* buffer = resource.allocate(size, alignof(std::max_align_t));
+        Delegate* clone = nullptr;
+        DELEGATE_TRY {
+            clone = CloneTo(buffer, size);
+        } DELEGATE_CATCH(...) {
+            resource.deallocate(buffer, size, alignof(std::max_align_t));
+            DELEGATE_RETHROW();
+        }
+        if (!clone)
+            resource.deallocate(buffer, size, alignof(std::max_align_t));
+        return clone;
+    }
+
+    /// @brief Destroy an instance from `Clone(std::pmr::memory_resource&)`.
+    /// @param[in] clone The instance, or `nullptr`.
+    /// @param[in] resource The memory resource passed to `Clone()`.
+    static void Destroy(Delegate* clone, std::pmr::memory_resource& resource) noexcept {
+        if (!clone)
+            return;
+        size_t size = clone->CloneSize();
+        clone->~Delegate();
+        resource.deallocate(clone, size, alignof(std::max_align_t));
+    }
+
+    /// @brief Get the destination thread of a non-blocking asynchronous delegate. Lets a 
+    /// multicast broadcast send one message per thread for all of its delegates bound to 
+    /// that thread. See `MulticastAsync`.
+    /// @return The destination thread, or `nullptr` if not a non-blocking asynchronous delegate.
+    virtual DelegateThread* GetAsyncThread() const noexcept { return nullptr; }
+
+    /// @brief Get the synchronous invoker a non-blocking asynchronous delegate calls on 
+    /// its destination thread.
+    /// @return The invoker, or `nullptr` if not a non-blocking asynchronous delegate.
+    virtual std::shared_ptr<Delegate> GetAsyncInvoker() const { return nullptr; }
 };
 
 template <class R>
@@ -145,6 +227,19 @@ public:
         return new(std::nothrow) ClassType(*this); 
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assigns the state of one object to another.
     /// @details Copy the state from the `rhs` (right-hand side) object to the
     /// current object.
@@ -189,11 +284,18 @@ public:
         return Clear();
     }
 
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_func == derivedRhs->m_func;
     }
@@ -354,6 +456,19 @@ public:
         return new(std::nothrow) ClassType(*this);
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assigns the state of one object to another.
     /// @details Copy the state from the `rhs` (right-hand side) object to the
     /// current object.
@@ -404,11 +519,18 @@ public:
         return Clear();
     }
 
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_func == derivedRhs->m_func &&
             m_object == derivedRhs->m_object;
@@ -470,11 +592,240 @@ private:
     MemberFunc m_func = nullptr;
 };
 
+template <class C, class R>
+struct DelegateMemberWeak; // Not defined
+
+/// @brief `DelegateMemberWeak<>` class synchronously invokes a class member target 
+/// function using a class object weak pointer.
+/// @details The delegate does not keep the object alive. Each call promotes the weak
+/// pointer for the duration of the call. Once the object is destroyed the delegate is
+/// empty and a call does nothing and returns a default return value.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class TClass, class RetType, class... Args>
+class DelegateMemberWeak<TClass, RetType(Args...)> : public Delegate<RetType(Args...)> {
+public:
+    typedef std::weak_ptr<TClass> WeakPtr;
+    typedef RetType(TClass::* MemberFunc)(Args...);
+    typedef RetType(TClass::* ConstMemberFunc)(Args...) const;
+    using ClassType = DelegateMemberWeak<TClass, RetType(Args...)>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object weak pointer to store.
+    /// @param[in] func The target member function to store.
+    DelegateMemberWeak(WeakPtr object, MemberFunc func) { Bind(std::move(object), func); }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object weak pointer to store.
+    /// @param[in] func The target const member function to store.
+    DelegateMemberWeak(WeakPtr object, ConstMemberFunc func) { Bind(std::move(object), func); }
+
+    /// @brief Copy constructor that creates a copy of the given instance.
+    /// @param[in] rhs The object to copy from.
+    DelegateMemberWeak(const ClassType& rhs) { Assign(rhs); }
+
+    /// @brief Move constructor that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    DelegateMemberWeak(ClassType&& rhs) noexcept : m_object(std::move(rhs.m_object)), m_func(rhs.m_func) { rhs.Clear(); }
+
+    /// @brief Default constructor creates an empty delegate.
+    DelegateMemberWeak() = default;
+
+    /// @brief Destructor ensures empty when destroyed.
+    ~DelegateMemberWeak() { Clear(); }
+
+    /// @brief Bind a member function to the delegate.
+    /// @param[in] object The target object weak pointer.
+    /// @param[in] func The member function to bind to the delegate. This function must 
+    /// match the signature of the delegate.
+    void Bind(WeakPtr object, MemberFunc func) {
+        static_assert(!std::is_const<TClass>::value, "Cannot bind non-const function to const object.");
+        m_object = std::move(object);
+        m_func = func;
+    }
+
+    /// @brief Bind a const member function to the delegate.
+    /// @param[in] object The target object weak pointer.
+    /// @param[in] func The const member function to bind to the delegate. This function 
+    /// must match the signature of the delegate.
+    void Bind(WeakPtr object, ConstMemberFunc func) {
+        m_object = std::move(object);
+        m_func = reinterpret_cast<MemberFunc>(func);
+    }
+
+    /// @brief Creates a copy of the current object.
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Assigns the state of one object to another.
+    /// @param[in] rhs The object whose state is to be copied.
+    void Assign(const ClassType& rhs) {
+        m_object = rhs.m_object;
+        m_func = rhs.m_func;
+    }
+
+    /// @brief Invoke the bound delegate function synchronously if the object still 
+    /// exists. Always safe to call.
+    /// @param[in] args - the function arguments, if any.
+    /// @return The bound function return value, if any. If empty delegate or the 
+    /// object is destroyed, default return type returned.
+    virtual RetType operator()(Args... args) override {
+        auto object = m_object.lock();
+        if (!object || !m_func)
+            return RetType();
+
+        if constexpr (std::is_const<TClass>::value) 
+            return std::invoke(reinterpret_cast<ConstMemberFunc>(m_func), object, std::forward<Args>(args)...);
+        else
+            return std::invoke(m_func, object, std::forward<Args>(args)...);
+    }
+
+    /// @brief Assignment operator that assigns the state of one object to another.
+    /// @param[in] rhs The object whose state is to be assigned to the current object.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) {
+        if (&rhs != this) {
+            Assign(rhs);
+        }
+        return *this;
+    }
+
+    /// @brief Move assignment operator that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    /// @return A reference to the current object.
+    ClassType& operator=(ClassType&& rhs) noexcept {
+        if (&rhs != this) {
+            m_object = std::move(rhs.m_object);
+            m_func = rhs.m_func;
+            rhs.Clear();
+        }
+        return *this;
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept {
+        return Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
+    /// @brief Compares two delegate objects for equality. Delegates bound to the same 
+    /// object and function are equal even once the object is destroyed, so an expired 
+    /// delegate can still be removed from a container.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        return derivedRhs &&
+            m_func == derivedRhs->m_func &&
+            !m_object.owner_before(derivedRhs->m_object) &&
+            !derivedRhs->m_object.owner_before(m_object);
+    }
+
+    /// Compares two delegate objects for equality.
+    /// @return `true` if the objects are equal, `false` otherwise.
+    bool operator==(const ClassType& rhs) const noexcept { return Equal(rhs); }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override {
+        return Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override {
+        return !Empty();
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    friend bool operator==(std::nullptr_t, const ClassType& rhs) noexcept {
+        return rhs.Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    friend bool operator!=(std::nullptr_t, const ClassType& rhs) noexcept {
+        return !rhs.Empty();
+    }
+
+    /// @brief Check if the delegate is bound to a target function of an object that
+    /// still exists.
+    /// @return `true` if the delegate has no target function or the object is destroyed.
+    bool Empty() const noexcept { return !m_func || m_object.expired(); }
+
+    /// @brief Clear the target function.
+    /// @post The delegate is empty.
+    void Clear() noexcept { m_object.reset(); m_func = nullptr; }
+
+    /// @brief Implicit conversion operator to `bool`.
+    /// @return `true` if the object is not empty, `false` if the object is empty.
+    explicit operator bool() const noexcept { return !Empty(); }
+
+private:
+    /// Not allowed since comparing member function pointers for operator< not allowed in C++.
+    bool operator<(const ClassType& rhs) const = delete; 
+
+    /// Weak pointer to a class object, representing the bound target instance.
+    WeakPtr m_object;
+
+    /// Pointer to a member function, representing the bound target function.
+    MemberFunc m_func = nullptr;
+};
+
 template <class R>
 class DelegateFunction; // Not defined
 
-/// @brief `DelegateFunction<>` class synchronously invokes a `std::function` target function.
-/// @details Caution when binding to a `std::function` using this class. `std::function` cannot be 
+/// @brief `true` if `F` is a callable object, other than a delegate, that can be bound to
+/// a `DelegateFunction<RetType(Args...)>`.
+template <class F, class RetType, class... Args>
+constexpr bool is_function_target_v = !std::is_base_of_v<DelegateBase, std::decay_t<F>> &&
+    std::is_invocable_r_v<RetType, std::decay_t<F>&, Args...>;
+
+/// @brief `true` if `MakeDelegate()` deduces the signature of callable `F`, such as a
+/// non-generic lambda. A `std::function` has its own `MakeDelegate()` overloads.
+template <class F, class = void>
+struct is_deducible_function_target : std::false_type {};
+
+template <class F>
+struct is_deducible_function_target<F, std::void_t<typename callable_signature<std::decay_t<F>>::type>> :
+    std::bool_constant<!std::is_base_of_v<DelegateBase, std::decay_t<F>> && !is_std_function<std::decay_t<F>>::value> {};
+
+/// @brief `DelegateFunction<>` class synchronously invokes a callable target function, such
+/// as a lambda or a `std::function`.
+/// @details The callable is held by an `inline_function<>`. A callable of up to 
+/// `DELEGATE_FUNCTION_SIZE` bytes, such as a lambda with a few captures, is stored within
+/// the delegate, so binding, cloning for an asynchronous call and invoking it do not
+/// allocate. Bind a lambda directly rather than through a `std::function`, since copying
+/// a `std::function` may allocate its own copy of the lambda.
+///
+/// Two delegates compare equal if their callables are of the same type. Different lambdas
+/// are different types, but two copies of a lambda with different captures compare equal.
+///
+/// Caution when binding to a `std::function` using this class. `std::function` cannot be 
 /// compared for equality directly in a meaningful way using `operator==`. Therefore, the delegate
 /// library uses `target_type()` for comparison. `target_type()` only compares the types of the 
 /// stored callable objects, but the not actual instances. The code below shows the issue.
@@ -502,7 +853,12 @@ public:
 
     /// @brief Constructor to create a class instance.
     /// @param[in] func The target `std::function` to store.
-    DelegateFunction(FunctionType func) { Bind(func); }
+    DelegateFunction(FunctionType func) { Bind(std::move(func)); }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] func The target callable, such as a lambda, to store.
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    DelegateFunction(F&& func) { Bind(std::forward<F>(func)); }
 
     /// @brief Copy constructor that creates a copy of the given instance.
     /// @details This constructor initializes a new object as a copy of the 
@@ -513,7 +869,7 @@ public:
 
     /// @brief Move constructor that transfers ownership of resources.
     /// @param[in] rhs The object to move from.
-    DelegateFunction(ClassType&& rhs) noexcept : m_func(rhs.m_func) { rhs.Clear(); }
+    DelegateFunction(ClassType&& rhs) noexcept : m_func(std::move(rhs.m_func)) { rhs.Clear(); }
 
     /// @brief Default constructor creates an empty delegate.
     DelegateFunction() = default;
@@ -526,14 +882,14 @@ public:
     /// Once the function is bound, the delegate can be used to invoke the function.
     /// @param[in] func The `std::function` to bind to the delegate. This function must 
     /// match the signature of the delegate.
-    void Bind(FunctionType func) {
-        try {
-            m_func = func;
-        }
-        catch (const std::bad_alloc&) {
-            BAD_ALLOC();
-        }
-    }
+    void Bind(FunctionType func) { Store(std::move(func)); }
+
+    /// @brief Bind a callable, such as a lambda, to the delegate.
+    /// @param[in] func The callable to bind to the delegate. Stored inline if it fits 
+    /// within `DELEGATE_FUNCTION_SIZE` bytes.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    void Bind(F&& func) { Store(std::forward<F>(func)); }
 
     /// Compares two ClassType objects using the '<' operator.
     /// @param rhs The object to compare with.
@@ -552,6 +908,19 @@ public:
         return new(std::nothrow) ClassType(*this); 
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assigns the state of one object to another.
     /// @details Copy the state from the `rhs` (right-hand side) object to the
     /// current object.
@@ -585,7 +954,7 @@ public:
     /// @return A reference to the current object.
     ClassType& operator=(ClassType&& rhs) noexcept {
         if (&rhs != this) {
-            m_func = rhs.m_func;
+            m_func = std::move(rhs.m_func);
             rhs.Clear();
         }
         return *this;
@@ -596,23 +965,39 @@ public:
         return Clear();
     }
 
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         if (derivedRhs) {
             // If both delegates are empty, they are equal
             if (Empty() && derivedRhs->Empty())
                 return true;
 
-            if (m_func && derivedRhs->m_func)
-                return m_func.target_type() == derivedRhs->m_func.target_type();
+            if (m_func && derivedRhs->m_func) {
+                if (m_func.target_type() != derivedRhs->m_func.target_type())
+                    return false;
+#if defined(__cpp_rtti) || defined(__GXX_RTTI) || defined(_CPPRTTI)
+                // Compare the targets of two std::function callables
+                auto func = m_func.template target<FunctionType>();
+                if (func)
+                    return func->target_type() == derivedRhs->m_func.template target<FunctionType>()->target_type();
+#endif
+                return true;
+            }
 
             return false;
         }
 
-        return false;  // Return false if dynamic cast failed
+        return false;  // Return false if cast failed
     }
 
     /// Compares two delegate objects for equality.
@@ -656,8 +1041,19 @@ public:
     explicit operator bool() const noexcept { return !Empty(); }
 
 private:
-    /// A std::function instance, representing the bound target function.
-    FunctionType m_func;
+    /// Store a callable as the target function.
+    template <class F>
+    void Store(F&& func) {
+        DELEGATE_TRY {
+            m_func = inline_function<RetType(Args...)>(std::forward<F>(func));
+        }
+        DELEGATE_CATCH(const std::bad_alloc&) {
+            BAD_ALLOC();
+        }
+    }
+
+    /// The callable instance, representing the bound target function.
+    inline_function<RetType(Args...)> m_func;
 };
 
 /// @brief Creates a delegate that binds to a free function.
@@ -730,6 +1126,30 @@ auto MakeDelegate(std::shared_ptr<TClass> object, RetType(TClass::* func)(Args..
     return DelegateMember<TClass, RetType(Args...)>(object, func);
 }
 
+/// @brief Creates a delegate that binds to a non-const member function with a weak pointer to the object.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A weak pointer to the instance of `TClass`. The delegate does not keep it alive.
+/// @param[in] func A pointer to the non-const member function of `TClass` to bind to the delegate.
+/// @return A `DelegateMemberWeak` object bound to the specified non-const member function.
+template <class TClass, class RetType, class... Args>
+auto MakeDelegate(std::weak_ptr<TClass> object, RetType(TClass::* func)(Args... args)) {
+    return DelegateMemberWeak<TClass, RetType(Args...)>(std::move(object), func);
+}
+
+/// @brief Creates a delegate that binds to a const member function with a weak pointer to the object.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A weak pointer to the instance of `TClass`. The delegate does not keep it alive.
+/// @param[in] func A pointer to the const member function of `TClass` to bind to the delegate.
+/// @return A `DelegateMemberWeak` object bound to the specified const member function.
+template <class TClass, class RetType, class... Args>
+auto MakeDelegate(std::weak_ptr<TClass> object, RetType(TClass::* func)(Args... args) const) {
+    return DelegateMemberWeak<TClass, RetType(Args...)>(std::move(object), func);
+}
+
 /// @brief Creates a delegate that binds to a `std::function`.
 /// @tparam RetType The return type of the `std::function`.
 /// @tparam Args The types of the function arguments.
@@ -740,6 +1160,17 @@ auto MakeDelegate(std::function<RetType(Args...)> func) {
     return DelegateFunction<RetType(Args...)>(func);
 }
 
+/// @brief Creates a delegate that binds to a lambda or other callable object with one 
+/// non-template `operator()`. The callable is stored inline if it fits within 
+/// `DELEGATE_FUNCTION_SIZE` bytes.
+/// @tparam F The callable type. The delegate signature is that of `F::operator()`.
+/// @param[in] func The callable to bind to the delegate.
+/// @return A `DelegateFunction` object bound to the specified callable.
+template <class F, class = std::enable_if_t<is_deducible_function_target<F>::value>>
+auto MakeDelegate(F&& func) {
+    return DelegateFunction<typename callable_signature<std::decay_t<F>>::type>(std::forward<F>(func));
+}
+
 }
 
 #endif
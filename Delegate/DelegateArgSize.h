@@ -0,0 +1,92 @@
+#ifndef _DELEGATE_ARG_SIZE_H
+#define _DELEGATE_ARG_SIZE_H
+
+/// @file
+/// @brief Argument size trait used to account the bytes held by queued delegate messages.
+///
+/// @details An asynchronous delegate message stores a copy of each argument inline,
+/// so `sizeof` the message covers the arguments themselves. An argument owning heap
+/// memory, e.g. a `std::vector` or `std::string`, holds more than its `sizeof`.
+/// `arg_size<T>::Size()` returns the heap bytes a copy of a `T` argument owns, and
+/// `arg_bytes()` sums them over a call's arguments. A `DelegateThread` with a byte
+/// budget charges each queued message its `DelegateMsg::GetPayloadSize()`, the
+/// message size plus these bytes, so the budget holds whatever the payload mix.
+///
+/// The trait covers strings, vectors, `std::unique_ptr` and pointer arguments, whose
+/// pointed to object is copied. Other types count as owning no heap memory.
+/// Specialize `arg_size` for an argument type that owns heap memory:
+///
+/// `template <> struct DelegateLib::arg_size<Image> {`
+/// `    static size_t Size(const Image& image) { return image.Bytes(); }`
+/// `};`
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace DelegateLib {
+
+/// @brief The heap bytes owned by a copy of a T argument. Specialize for types
+/// owning heap memory.
+template <class T>
+struct arg_size
+{
+	static size_t Size(const T&) { return 0; }
+};
+
+template <class Char, class Traits, class Alloc>
+struct arg_size<std::basic_string<Char, Traits, Alloc>>
+{
+	static size_t Size(const std::basic_string<Char, Traits, Alloc>& s)
+	{
+		// A short string is held within the object
+		const char* data = reinterpret_cast<const char*>(s.data());
+		const char* object = reinterpret_cast<const char*>(&s);
+		if (data >= object && data < object + sizeof(s))
+			return 0;
+		return (s.size() + 1) * sizeof(Char);
+	}
+};
+
+template <class T, class Alloc>
+struct arg_size<std::vector<T, Alloc>>
+{
+	static size_t Size(const std::vector<T, Alloc>& v)
+	{
+		size_t bytes = v.size() * sizeof(T);
+		if constexpr (!std::is_trivially_copyable<T>::value)
+		{
+			for (const T& element : v)
+				bytes += arg_size<T>::Size(element);
+		}
+		return bytes;
+	}
+};
+
+template <class T, class Deleter>
+struct arg_size<std::unique_ptr<T, Deleter>>
+{
+	static size_t Size(const std::unique_ptr<T, Deleter>& p) { return p ? sizeof(T) + arg_size<T>::Size(*p) : 0; }
+};
+
+/// A pointer argument points to a copy of the object within the message
+template <class T>
+struct arg_size<T*>
+{
+	static size_t Size(T* p) { return p ? arg_size<std::remove_cv_t<T>>::Size(*p) : 0; }
+};
+
+/// @brief Sum the heap bytes owned by copies of the arguments
+/// @param[in] args - the function arguments
+/// @return The bytes beyond the inline copies.
+template <class... Args>
+size_t arg_bytes(const Args&... args)
+{
+	return (size_t(0) + ... + arg_size<std::remove_cv_t<std::remove_reference_t<Args>>>::Size(args));
+}
+
+}
+
+#endif
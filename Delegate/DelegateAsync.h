@@ -8,18 +8,27 @@
 /// @file
 /// @brief Delegate "`Async`" series of classes used to invoke a function asynchronously. 
 /// 
-/// @details The classes are not thread safe. Invoking a function asynchronously requires 
-/// sending a clone of the object to the destination thread message queue. The destination 
-/// thread calls `Invoke()` to invoke the target function.
+/// @details The classes are not thread safe. Invoking a function asynchronously sends a 
+/// message to the destination thread message queue. Each message refers to an invoker, a 
+/// synchronous clone of the delegate created when the target is bound and shared by every
+/// call and copy of the delegate. The destination thread calls `Invoke()` to invoke the 
+/// target function.
 /// 
 /// `RetType operator()(Args... args)` - called by the source thread to initiate the async
 /// function call. May throw `std::bad_alloc` if dynamic storage allocation fails and USE_ASSERTS 
 /// is not defined. Clone() may also throw `std::bad_alloc`. All other delegate class functions do 
 /// not throw exceptions.
 ///
+/// `bool AsyncInvokeAfter(delay, args...)` and `bool AsyncInvokeAt(due, args...)` - same as 
+/// `operator()` but the destination thread invokes the target function once the delay elapses
+/// or the due time is reached. See `DelegateThread::DispatchDelegateAt()`.
+///
 /// `void Invoke(std::shared_ptr<DelegateMsg> msg)` - called by the destination
 /// thread to invoke the target function. The destination thread must not call any other
 /// delegate instance functions.
+///
+/// Invocation policies listed after the signature, e.g. `DelegateFreeAsync<void(int),
+/// CountPolicy>`, intercept the calls at compile time. See DelegatePolicy.h.
 /// 
 /// Limitations:
 /// 
@@ -28,7 +37,9 @@
 /// 
 /// * Cannot use a `void*` as a target function argument.
 /// 
-/// * Cannot use rvalue reference (T&&) as a target function argument.
+/// * A by value or rvalue reference (T&&) argument passed as an rvalue is moved into 
+/// the message instead of copied. Move-only types such as `std::unique_ptr` may be passed 
+/// this way. The caller must not use a moved from argument after the call.
 /// 
 /// * Cannot insert `DelegateMemberAsync` into an ordered container. e.g. `std::list` ok, 
 /// `std::set` not ok.
@@ -44,13 +55,22 @@
 
 #include "Delegate.h"
 #include "DelegateThread.h"
+#include "DispatchScope.h"
 #include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include "DelegatePolicy.h"
+#include "make_tuple_inline.h"
+#include "Trace.h"
+#include "Profile.h"
+#include "Metrics.h"
+#include "Clock.h"
 #include <tuple>
+#include <chrono>
 
 namespace DelegateLib {
 
 /// @brief Stores all function arguments suitable for non-blocking asynchronous calls.
-/// Argument data is stored in the heap.
+/// Argument data is copied inline within the message.
 /// @tparam Args The argument types of the bound delegate function.
 template <class...Args>
 class DelegateAsyncMsg : public DelegateMsg
@@ -59,38 +79,89 @@ public:
     /// Constructor
     /// @param[in] invoker - the invoker instance
     /// @param[in] args - a parameter pack of all target function arguments
-    /// @throws std::bad_alloc If make_tuble_heap() fails to obtain memory and USE_ASSERTS not defined.
-    DelegateAsyncMsg(std::shared_ptr<IDelegateInvoker> invoker, Args... args) : DelegateMsg(invoker),
-        m_args(make_tuple_heap(m_heapMem, m_start, std::forward<Args>(args)...)) { }
+    DelegateAsyncMsg(std::shared_ptr<IDelegateInvoker> invoker, Args... args) : 
+        DelegateMsg(invoker, type_id<DelegateAsyncMsg>(), sizeof(DelegateAsyncMsg) + arg_bytes<Args...>(args...)),
+        m_args(std::forward<Args>(args)...) { }
 
     virtual ~DelegateAsyncMsg() = default;
 
-    /// Get all function arguments that were created on the heap
+    /// Get all function arguments that were copied into the message. By value 
+    /// arguments are moved out, so call once.
     /// @return A tuple of all function arguments
-    std::tuple<Args...>& GetArgs() { return m_args; }
+    std::tuple<Args...> GetArgs() { return m_args.get(); }
+
+#ifdef PROFILE_ENABLE
+    /// The `Profiler::Now()` time the message was sent, or 0 if not profiled
+    uint64_t m_sent = 0;
+#endif
 
 private:
-    /// A list of heap allocated argument memory blocks
-    xlist<std::shared_ptr<heap_arg_deleter_base>> m_heapMem;
+    /// A copy of each argument stored within the message
+    inline_args<Args...> m_args;
+};
 
-    /// An empty starting tuple
-    std::tuple<> m_start;
+/// @brief Releases an invoker borrowed by the messages dispatched before it. Sent to
+/// an ordered thread, see `DelegateThread::IsOrdered()`, once the last owner of the
+/// invoker lets go, so the invoker outlives every message referring to it.
+class DelegateRetireMsg : public DelegateMsg
+{
+public:
+    /// Constructor
+    /// @param[in] keep - the invoker to release
+    explicit DelegateRetireMsg(std::shared_ptr<void> keep) :
+        DelegateMsg(NoopInvoker(), type_id<DelegateRetireMsg>()), m_keep(std::move(keep)) { }
+
+    /// @brief The shared_ptr deleter of a borrowed invoker. Allocation was done up 
+    /// front by the constructor so releasing only queues the message.
+    struct Deleter
+    {
+        DelegateThread* thread;
+        std::shared_ptr<DelegateRetireMsg> msg;
+
+        void operator()(void*) noexcept {
+            DELEGATE_TRY {
+                thread->DispatchDelegate(msg);
+            }
+            DELEGATE_CATCH(const std::bad_alloc&) {
+                // Messages may still borrow the invoker. Keep it forever.
+                msg->m_self = msg;
+            }
+            DELEGATE_CATCH(...) {
+                // Thread not running so nothing is queued. Release at once.
+            }
+            msg = nullptr;
+        }
+    };
+
+private:
+    class Noop : public IDelegateInvoker
+    {
+    public:
+        virtual bool Invoke(std::shared_ptr<DelegateMsg>) override { return true; }
+    };
+
+    static std::shared_ptr<IDelegateInvoker> NoopInvoker() {
+        static const std::shared_ptr<IDelegateInvoker> noop = std::make_shared<Noop>();
+        return noop;
+    }
 
-    /// A tuple with each element stored within the heap
-    std::tuple<Args...> m_args;
+    std::shared_ptr<void> m_keep;
+    std::shared_ptr<DelegateMsg> m_self;
 };
 
-template <class R>
+template <class R, class... Policies>
 struct DelegateFreeAsync; // Not defined
 
 /// @brief `DelegateFreeAsync<>` class asynchronously invokes a free target function.
 /// @tparam RetType The return type of the bound delegate function.
 /// @tparam Args The argument types of the bound delegate function.
-template <class RetType, class... Args>
-class DelegateFreeAsync<RetType(Args...)> : public DelegateFree<RetType(Args...)>, public IDelegateInvoker {
+/// @tparam Policies The invocation policies, see DelegatePolicy.h.
+template <class RetType, class... Args, class... Policies>
+class DelegateFreeAsync<RetType(Args...), Policies...> : public DelegateFree<RetType(Args...)>, public IDelegateInvoker {
 public:
     typedef RetType(*FreeFunc)(Args...);
-    using ClassType = DelegateFreeAsync<RetType(Args...)>;
+    using ClassType = DelegateFreeAsync<RetType(Args...), Policies...>;
+    using PolicyType = delegate_policies<Policies...>;
     using BaseType = DelegateFree<RetType(Args...)>;
 
     /// @brief Constructor to create a class instance.
@@ -115,6 +186,7 @@ public:
     /// @param[in] rhs The object to move from.
     DelegateFreeAsync(ClassType&& rhs) noexcept : 
         BaseType(rhs), m_thread(rhs.m_thread) {
+        m_invoker = rhs.m_invoker;
         rhs.Clear();
     }
 
@@ -129,6 +201,7 @@ public:
     void Bind(FreeFunc func, DelegateThread& thread) {
         m_thread = &thread;
         BaseType::Bind(func);
+        BindInvoker();
     }
 
     // <common_code>
@@ -139,6 +212,7 @@ public:
     /// @param[in] rhs The object whose state is to be copied.
     void Assign(const ClassType& rhs) {
         m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
         BaseType::Assign(rhs);
     }
     /// @brief Creates a copy of the current object.
@@ -151,6 +225,19 @@ public:
         return new(std::nothrow) ClassType(*this);
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assignment operator that assigns the state of one object to another.
     /// @param[in] rhs The object whose state is to be assigned to the current object.
     /// @return A reference to the current object.
@@ -169,6 +256,7 @@ public:
         if (&rhs != this) {
             BaseType::operator=(std::move(rhs));
             m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
         }
         return *this;
     }
@@ -178,11 +266,24 @@ public:
         return this->Clear();
     }
 
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_thread == derivedRhs->m_thread &&
             BaseType::Equal(rhs);
@@ -222,10 +323,12 @@ public:
     /// destination thread message queue. `Invoke()` must be called by the destination 
     /// thread to invoke the target function. Always safe to call.
     /// 
-    /// The `DelegateAsyncMsg` duplicates and copies the function arguments into heap memory. 
+    /// The `DelegateAsyncMsg` duplicates and copies the function arguments into the message. 
     /// The source thread is not required to place function arguments into the heap. The delegate
-    /// library performs all necessary heap and argument coping for the caller. Ensure complex
-    /// argument data types can be safely copied by creating a copy constructor if necessary. 
+    /// library performs all necessary argument coping for the caller. Ensure complex argument 
+    /// data types can be safely copied by creating a copy constructor if necessary. The message
+    /// is allocated from `pool_allocator` and refers to the invoker created at bind time, so 
+    /// steady-state calls do not use the heap.
     /// @param[in] args The function arguments, if any.
     /// @return A default return value. The return value is *not* returned from the 
     /// target function. Do not use the return value.
@@ -237,24 +340,61 @@ public:
 
         // Synchronously invoke the target function?
         if (m_sync) {
-            // Invoke the target function directly
-            return BaseType::operator()(std::forward<Args>(args)...);
+            // Invoke the target function directly within the policies
+            return PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
         } else {
-            // Create a clone instance of this delegate 
-            auto delegate = std::shared_ptr<ClassType>(Clone());
-            if (!delegate)
-                BAD_ALLOC();
+            // Drop a call a policy filters out. Compiles to nothing without policies.
+            if (!PolicyType::Send(args...))
+                return RetType();
 
-            // Create a new message instance for sending to the destination thread
-            auto msg = std::make_shared<DelegateAsyncMsg<Args...>>(delegate, std::forward<Args>(args)...);
+            TRACE_SCOPE("DelegateAsync::operator()");
+            static MetricCounter& callsMetric = Metrics::GetCounter("delegate.async.calls");
+            callsMetric.Add();
+
+            // Invoke the target function directly if called on a destination thread
+            // that allows inline calls
+            auto thread = this->GetThread();
+            if (thread && thread->IsInlineCall()) {
+                static MetricCounter& inlineMetric = Metrics::GetCounter("delegate.async.inline_calls");
+                inlineMetric.Add();
+                PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
+                return RetType();
+            }
+
+            // Let the policies see the queued call while the arguments are intact
+            if (thread)
+                PolicyType::Dispatch(*thread, args...);
+
+            // Create a new message instance for sending to the destination thread, from
+            // the thread's memory resource or NUMA node. A borrowed invoker is not 
+            // reference counted per message unless the message is held back by a 
+            // dispatch scope.
+            auto scope = DispatchScope::Current();
+            bool borrow = m_invoker->m_borrowed && !scope;
+            auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+                thread ? pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()) :
+                    pool_allocator<DelegateAsyncMsg<Args...>>(), 
+                borrow ? nullptr : m_invoker, std::forward<Args>(args)...);
             if (!msg)
                 BAD_ALLOC();
+            if (borrow)
+                msg->BorrowInvoker(m_invoker.get());
+
+#ifdef PROFILE_ENABLE
+            if (m_invoker->m_profile && Profiler::IsEnabled()) {
+                msg->m_sent = Profiler::Now();
+                m_invoker->m_profile->Sent(sizeof(inline_args<Args...>));
+            }
+#endif
 
-            auto thread = this->GetThread();
             if (thread) {
                 // Dispatch message onto the callback destination thread. Invoke()
                 // will be called by the destintation thread. 
-                thread->DispatchDelegate(msg);
+                TRACE_FLOW_BEGIN(reinterpret_cast<uintptr_t>(msg.get()));
+                if (scope)
+                    scope->Add(thread, std::move(msg));
+                else
+                    thread->DispatchDelegate(msg);
             }
 
             // Do not wait for destination thread return value from async function call
@@ -278,6 +418,47 @@ public:
         operator()(std::forward<Args>(args)...);
     }
 
+    /// @brief Invoke the delegate function asynchronously once a due time is reached. 
+    /// Do not wait for return value. Called by the source thread. Always safe to call.
+    /// @details The destination thread holds the message until the due time, see 
+    /// `DelegateThread::DispatchDelegateAt()`, so no timer is created per call. The call 
+    /// is never invoked inline nor held back by a `DispatchScope`.
+    /// @param[in] due The `Clock::Now()` time to invoke the target function at.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled. `false` if the delegate is empty or 
+    /// synchronous, a policy filtered out the call, or the destination thread does not 
+    /// support scheduled dispatch.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAt(Clock::time_point due, Args... args) {
+        auto thread = GetAsyncThread();
+        if (this->Empty() || !thread)
+            return false;
+        if (!PolicyType::Send(args...))
+            return false;
+
+        static MetricCounter& scheduledMetric = Metrics::GetCounter("delegate.async.scheduled_calls");
+        scheduledMetric.Add();
+        PolicyType::Dispatch(*thread, args...);
+
+        // A held message owns a reference to the invoker instead of borrowing it
+        auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+            pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()), 
+            m_invoker, std::forward<Args>(args)...);
+        if (!msg)
+            BAD_ALLOC();
+        return thread->DispatchDelegateAt(std::move(msg), due);
+    }
+
+    /// @brief Invoke the delegate function asynchronously once a delay elapses. See 
+    /// `AsyncInvokeAt()`.
+    /// @param[in] delay The time from now to invoke the target function after.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAfter(std::chrono::nanoseconds delay, Args... args) {
+        return AsyncInvokeAt(Clock::Now() + delay, std::forward<Args>(args)...);
+    }
+
     /// @brief Invoke the delegate function on the destination thread. Called by the 
     /// destintation thread.
     /// @details Each source thread call to `operator()` generate a call to `Invoke()` 
@@ -288,12 +469,22 @@ public:
     /// @return `true` if target function invoked; `false` if error. 
     virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
         // Typecast the base pointer to back correct derived to instance
-        auto delegateMsg = std::dynamic_pointer_cast<DelegateAsyncMsg<Args...>>(msg);
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncMsg<Args...>>(msg);
         if (delegateMsg == nullptr)
             return false;
 
-        // Invoke the delegate function synchronously
-        m_sync = true;
+        TRACE_SCOPE("DelegateAsync::Invoke");
+        TRACE_FLOW_END(reinterpret_cast<uintptr_t>(msg.get()));
+
+#ifdef PROFILE_ENABLE
+        if (m_profile && delegateMsg->m_sent) {
+            uint64_t start = Profiler::Now();
+            std::apply(&BaseType::operator(), 
+                std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+            m_profile->Invoked(start - delegateMsg->m_sent, Profiler::Now() - start);
+            return true;
+        }
+#endif
 
         // Invoke the target function using the source thread supplied function arguments
         std::apply(&BaseType::operator(), 
@@ -301,35 +492,128 @@ public:
         return true;
     }
 
+    /// @brief Name the profile row of the target, see Profile.h. Delegates given the
+    /// same name share a row. Copies taken afterwards use the name; a later bind 
+    /// restores the default row. Does nothing unless `PROFILE_ENABLE` is defined.
+    /// @param[in] name The row name, e.g. the target function name.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetProfileName(const std::string& name) {
+#ifdef PROFILE_ENABLE
+        // A new invoker so messages already queued and earlier copies keep their row
+        BindInvoker();
+        if (m_invoker)
+            m_invoker->m_profile = Profiler::GetEntry(name);
+#else
+        (void)name;
+#endif
+    }
+
+    /// @brief Let messages borrow the invoker instead of each holding a reference to 
+    /// it, removing two contended reference count updates per call. The delegate and 
+    /// its copies own the invoker; once the last lets go, a message sent to the 
+    /// destination thread releases it after the messages already queued. Takes effect
+    /// only on an ordered thread, see `DelegateThread::IsOrdered()`, and on a bound 
+    /// delegate. Copies taken afterwards and later binds keep the setting.
+    /// @param[in] borrowed `true` to borrow, `false` to reference count each message.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetBorrowedInvoker(bool borrowed) {
+        // A new invoker so messages already queued and earlier copies are unaffected
+        if (m_invoker && m_invoker->m_borrowed != borrowed)
+            BindInvoker(borrowed);
+    }
+
     ///@brief Get the destination thread that the target function is invoked on.
     // @return The target thread.
     DelegateThread* GetThread() noexcept { return m_thread; }
 
+    /// @brief Get the destination thread. Lets a multicast broadcast send one message 
+    /// per thread for all of its delegates bound to that thread.
+    /// @return The destination thread, or `nullptr` if invoked synchronously.
+    virtual DelegateThread* GetAsyncThread() const noexcept override {
+        return m_sync || !m_invoker ? nullptr : m_thread;
+    }
+
+    /// @brief Get the synchronous invoker called on the destination thread.
+    /// @return The invoker shared by every call.
+    virtual std::shared_ptr<Delegate<RetType(Args...)>> GetAsyncInvoker() const override {
+        return m_invoker;
+    }
+
 private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        BindInvoker(m_invoker && m_invoker->m_borrowed);
+    }
+
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies.
+    /// @param[in] borrowed `true` if messages borrow the invoker.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker(bool borrowed) {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+#ifdef PROFILE_ENABLE
+        invoker->m_profile = Profiler::GetEntry<ClassType>();
+#endif
+        if (borrowed && m_thread && m_thread->IsOrdered()) {
+            // Owners share a handle whose deleter retires the invoker through the thread
+            invoker->m_borrowed = true;
+            auto retire = std::make_shared<DelegateRetireMsg>(invoker);
+            if (!retire)
+                BAD_ALLOC();
+            m_invoker = std::shared_ptr<ClassType>(invoker.get(), DelegateRetireMsg::Deleter{ m_thread, std::move(retire) });
+        }
+        else
+            m_invoker = invoker;
+    }
+
     /// The target thread to invoke the delegate function.
     DelegateThread* m_thread = nullptr;   
 
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
     /// Flag to control synchronous vs asynchronous target invoke behavior.
     bool m_sync = false;        
 
+    /// True if messages borrow this invoker. Set on the invoker only.
+    bool m_borrowed = false;
+
+#ifdef PROFILE_ENABLE
+    /// The profile row of the target. Set on the invoker only.
+    profile_entry* m_profile = nullptr;
+#endif
+
     // </common_code>
 };
 
-template <class C, class R>
+template <class C, class R, class... Policies>
 struct DelegateMemberAsync; // Not defined
 
 /// @brief `DelegateMemberAsync<>` class asynchronously invokes a class member target function.
 /// @tparam TClass The class type that contains the member function.
 /// @tparam RetType The return type of the bound delegate function.
 /// @tparam Args The argument types of the bound delegate function.
-template <class TClass, class RetType, class... Args>
-class DelegateMemberAsync<TClass, RetType(Args...)> : public DelegateMember<TClass, RetType(Args...)>, public IDelegateInvoker {
+/// @tparam Policies The invocation policies, see DelegatePolicy.h.
+template <class TClass, class RetType, class... Args, class... Policies>
+class DelegateMemberAsync<TClass, RetType(Args...), Policies...> : public DelegateMember<TClass, RetType(Args...)>, public IDelegateInvoker {
 public:
     typedef TClass* ObjectPtr;
     typedef std::shared_ptr<TClass> SharedPtr;
     typedef RetType(TClass::* MemberFunc)(Args...);
     typedef RetType(TClass::* ConstMemberFunc)(Args...) const;
-    using ClassType = DelegateMemberAsync<TClass, RetType(Args...)>;
+    using ClassType = DelegateMemberAsync<TClass, RetType(Args...), Policies...>;
+    using PolicyType = delegate_policies<Policies...>;
     using BaseType = DelegateMember<TClass, RetType(Args...)>;
 
     /// @brief Constructor to create a class instance.
@@ -378,6 +662,7 @@ public:
     /// @param[in] rhs The object to move from.
     DelegateMemberAsync(ClassType&& rhs) noexcept :
         BaseType(rhs), m_thread(rhs.m_thread) {
+        m_invoker = rhs.m_invoker;
         rhs.Clear();
     }
 
@@ -393,6 +678,7 @@ public:
     void Bind(SharedPtr object, MemberFunc func, DelegateThread& thread) {
         m_thread = &thread;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     /// @brief Bind a member function to the delegate.
@@ -405,6 +691,7 @@ public:
     void Bind(SharedPtr object, ConstMemberFunc func, DelegateThread& thread) {
         m_thread = &thread;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     /// @brief Bind a const member function to the delegate.
@@ -417,6 +704,7 @@ public:
     void Bind(ObjectPtr object, MemberFunc func, DelegateThread& thread) {
         m_thread = &thread;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     /// @brief Bind a member function to the delegate.
@@ -429,6 +717,7 @@ public:
     void Bind(ObjectPtr object, ConstMemberFunc func, DelegateThread& thread) {
         m_thread = &thread;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     // <common_code>
@@ -439,6 +728,7 @@ public:
     /// @param[in] rhs The object whose state is to be copied.
     void Assign(const ClassType& rhs) {
         m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
         BaseType::Assign(rhs);
     }
     /// @brief Creates a copy of the current object.
@@ -451,6 +741,19 @@ public:
         return new(std::nothrow) ClassType(*this);
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assignment operator that assigns the state of one object to another.
     /// @param[in] rhs The object whose state is to be assigned to the current object.
     /// @return A reference to the current object.
@@ -469,6 +772,7 @@ public:
         if (&rhs != this) {
             BaseType::operator=(std::move(rhs));
             m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
         }
         return *this;
     }
@@ -478,11 +782,24 @@ public:
         return this->Clear();
     }
 
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_thread == derivedRhs->m_thread &&
             BaseType::Equal(rhs);
@@ -522,10 +839,12 @@ public:
     /// destination thread message queue. `Invoke()` must be called by the destination 
     /// thread to invoke the target function. Always safe to call.
     /// 
-    /// The `DelegateAsyncMsg` duplicates and copies the function arguments into heap memory. 
+    /// The `DelegateAsyncMsg` duplicates and copies the function arguments into the message. 
     /// The source thread is not required to place function arguments into the heap. The delegate
-    /// library performs all necessary heap and argument coping for the caller. Ensure complex
-    /// argument data types can be safely copied by creating a copy constructor if necessary. 
+    /// library performs all necessary argument coping for the caller. Ensure complex argument 
+    /// data types can be safely copied by creating a copy constructor if necessary. The message
+    /// is allocated from `pool_allocator` and refers to the invoker created at bind time, so 
+    /// steady-state calls do not use the heap.
     /// @param[in] args The function arguments, if any.
     /// @return A default return value. The return value is *not* returned from the 
     /// target function. Do not use the return value.
@@ -537,24 +856,533 @@ public:
 
         // Synchronously invoke the target function?
         if (m_sync) {
-            // Invoke the target function directly
-            return BaseType::operator()(std::forward<Args>(args)...);
+            // Invoke the target function directly within the policies
+            return PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
         } else {
-            // Create a clone instance of this delegate 
-            auto delegate = std::shared_ptr<ClassType>(Clone());
-            if (!delegate)
-                BAD_ALLOC();
+            // Drop a call a policy filters out. Compiles to nothing without policies.
+            if (!PolicyType::Send(args...))
+                return RetType();
+
+            TRACE_SCOPE("DelegateAsync::operator()");
+            static MetricCounter& callsMetric = Metrics::GetCounter("delegate.async.calls");
+            callsMetric.Add();
 
-            // Create a new message instance for sending to the destination thread
-            auto msg = std::make_shared<DelegateAsyncMsg<Args...>>(delegate, std::forward<Args>(args)...);
+            // Invoke the target function directly if called on a destination thread
+            // that allows inline calls
+            auto thread = this->GetThread();
+            if (thread && thread->IsInlineCall()) {
+                static MetricCounter& inlineMetric = Metrics::GetCounter("delegate.async.inline_calls");
+                inlineMetric.Add();
+                PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
+                return RetType();
+            }
+
+            // Let the policies see the queued call while the arguments are intact
+            if (thread)
+                PolicyType::Dispatch(*thread, args...);
+
+            // Create a new message instance for sending to the destination thread, from
+            // the thread's memory resource or NUMA node. A borrowed invoker is not 
+            // reference counted per message unless the message is held back by a 
+            // dispatch scope.
+            auto scope = DispatchScope::Current();
+            bool borrow = m_invoker->m_borrowed && !scope;
+            auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+                thread ? pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()) :
+                    pool_allocator<DelegateAsyncMsg<Args...>>(), 
+                borrow ? nullptr : m_invoker, std::forward<Args>(args)...);
             if (!msg)
                 BAD_ALLOC();
+            if (borrow)
+                msg->BorrowInvoker(m_invoker.get());
+
+#ifdef PROFILE_ENABLE
+            if (m_invoker->m_profile && Profiler::IsEnabled()) {
+                msg->m_sent = Profiler::Now();
+                m_invoker->m_profile->Sent(sizeof(inline_args<Args...>));
+            }
+#endif
+
+            if (thread) {
+                // Dispatch message onto the callback destination thread. Invoke()
+                // will be called by the destintation thread. 
+                TRACE_FLOW_BEGIN(reinterpret_cast<uintptr_t>(msg.get()));
+                if (scope)
+                    scope->Add(thread, std::move(msg));
+                else
+                    thread->DispatchDelegate(msg);
+            }
+
+            // Do not wait for destination thread return value from async function call
+            return RetType();
+
+            // Check if any argument is a shared_ptr with wrong usage
+            // std::shared_ptr reference arguments are not allowed with asynchronous delegates as the behavior is 
+            // undefined. In other words:
+            // void MyFunc(std::shared_ptr<T> data)		// Ok!
+            // void MyFunc(std::shared_ptr<T>& data)	// Error if DelegateAsync or DelegateSpAsync target!
+            static_assert(!(std::disjunction_v<is_shared_ptr<Args>...> &&
+                (std::disjunction_v<std::is_lvalue_reference<Args>, std::is_pointer<Args>> || ...)),
+                "std::shared_ptr reference argument not allowed");
+        }
+    }
+
+    /// @brief Invoke delegate function asynchronously. Do not wait for return value.
+    /// Called by the source thread. Always safe to call.
+    /// @param[in] args The function arguments, if any.
+    void AsyncInvoke(Args... args) {
+        operator()(std::forward<Args>(args)...);
+    }
+
+    /// @brief Invoke the delegate function asynchronously once a due time is reached. 
+    /// Do not wait for return value. Called by the source thread. Always safe to call.
+    /// @details The destination thread holds the message until the due time, see 
+    /// `DelegateThread::DispatchDelegateAt()`, so no timer is created per call. The call 
+    /// is never invoked inline nor held back by a `DispatchScope`.
+    /// @param[in] due The `Clock::Now()` time to invoke the target function at.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled. `false` if the delegate is empty or 
+    /// synchronous, a policy filtered out the call, or the destination thread does not 
+    /// support scheduled dispatch.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAt(Clock::time_point due, Args... args) {
+        auto thread = GetAsyncThread();
+        if (this->Empty() || !thread)
+            return false;
+        if (!PolicyType::Send(args...))
+            return false;
+
+        static MetricCounter& scheduledMetric = Metrics::GetCounter("delegate.async.scheduled_calls");
+        scheduledMetric.Add();
+        PolicyType::Dispatch(*thread, args...);
+
+        // A held message owns a reference to the invoker instead of borrowing it
+        auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+            pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()), 
+            m_invoker, std::forward<Args>(args)...);
+        if (!msg)
+            BAD_ALLOC();
+        return thread->DispatchDelegateAt(std::move(msg), due);
+    }
+
+    /// @brief Invoke the delegate function asynchronously once a delay elapses. See 
+    /// `AsyncInvokeAt()`.
+    /// @param[in] delay The time from now to invoke the target function after.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAfter(std::chrono::nanoseconds delay, Args... args) {
+        return AsyncInvokeAt(Clock::Now() + delay, std::forward<Args>(args)...);
+    }
+
+    /// @brief Invoke the delegate function on the destination thread. Called by the 
+    /// destintation thread.
+    /// @details Each source thread call to `operator()` generate a call to `Invoke()` 
+    /// on the destination thread. Unlike `DelegateAsyncWait`, a lock is not required between 
+    /// source and destination `delegateMsg` access because the source thread is not waiting 
+    /// for the function call to complete.
+    /// @param[in] msg The delegate message created and sent within `operator()(Args... args)`.
+    /// @return `true` if target function invoked; `false` if error. 
+    virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+        // Typecast the base pointer to back correct derived to instance
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncMsg<Args...>>(msg);
+        if (delegateMsg == nullptr)
+            return false;
+
+        TRACE_SCOPE("DelegateAsync::Invoke");
+        TRACE_FLOW_END(reinterpret_cast<uintptr_t>(msg.get()));
+
+#ifdef PROFILE_ENABLE
+        if (m_profile && delegateMsg->m_sent) {
+            uint64_t start = Profiler::Now();
+            std::apply(&BaseType::operator(), 
+                std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+            m_profile->Invoked(start - delegateMsg->m_sent, Profiler::Now() - start);
+            return true;
+        }
+#endif
+
+        // Invoke the target function using the source thread supplied function arguments
+        std::apply(&BaseType::operator(), 
+            std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+        return true;
+    }
+
+    /// @brief Name the profile row of the target, see Profile.h. Delegates given the
+    /// same name share a row. Copies taken afterwards use the name; a later bind 
+    /// restores the default row. Does nothing unless `PROFILE_ENABLE` is defined.
+    /// @param[in] name The row name, e.g. the target function name.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetProfileName(const std::string& name) {
+#ifdef PROFILE_ENABLE
+        // A new invoker so messages already queued and earlier copies keep their row
+        BindInvoker();
+        if (m_invoker)
+            m_invoker->m_profile = Profiler::GetEntry(name);
+#else
+        (void)name;
+#endif
+    }
+
+    /// @brief Let messages borrow the invoker instead of each holding a reference to 
+    /// it, removing two contended reference count updates per call. The delegate and 
+    /// its copies own the invoker; once the last lets go, a message sent to the 
+    /// destination thread releases it after the messages already queued. Takes effect
+    /// only on an ordered thread, see `DelegateThread::IsOrdered()`, and on a bound 
+    /// delegate. Copies taken afterwards and later binds keep the setting.
+    /// @param[in] borrowed `true` to borrow, `false` to reference count each message.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetBorrowedInvoker(bool borrowed) {
+        // A new invoker so messages already queued and earlier copies are unaffected
+        if (m_invoker && m_invoker->m_borrowed != borrowed)
+            BindInvoker(borrowed);
+    }
+
+    ///@brief Get the destination thread that the target function is invoked on.
+    // @return The target thread.
+    DelegateThread* GetThread() noexcept { return m_thread; }
+
+    /// @brief Get the destination thread. Lets a multicast broadcast send one message 
+    /// per thread for all of its delegates bound to that thread.
+    /// @return The destination thread, or `nullptr` if invoked synchronously.
+    virtual DelegateThread* GetAsyncThread() const noexcept override {
+        return m_sync || !m_invoker ? nullptr : m_thread;
+    }
+
+    /// @brief Get the synchronous invoker called on the destination thread.
+    /// @return The invoker shared by every call.
+    virtual std::shared_ptr<Delegate<RetType(Args...)>> GetAsyncInvoker() const override {
+        return m_invoker;
+    }
+
+private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        BindInvoker(m_invoker && m_invoker->m_borrowed);
+    }
+
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies.
+    /// @param[in] borrowed `true` if messages borrow the invoker.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker(bool borrowed) {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+#ifdef PROFILE_ENABLE
+        invoker->m_profile = Profiler::GetEntry<ClassType>();
+#endif
+        if (borrowed && m_thread && m_thread->IsOrdered()) {
+            // Owners share a handle whose deleter retires the invoker through the thread
+            invoker->m_borrowed = true;
+            auto retire = std::make_shared<DelegateRetireMsg>(invoker);
+            if (!retire)
+                BAD_ALLOC();
+            m_invoker = std::shared_ptr<ClassType>(invoker.get(), DelegateRetireMsg::Deleter{ m_thread, std::move(retire) });
+        }
+        else
+            m_invoker = invoker;
+    }
+
+    /// The target thread to invoke the delegate function.
+    DelegateThread* m_thread = nullptr;   
+
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
+    /// Flag to control synchronous vs asynchronous target invoke behavior.
+    bool m_sync = false;        
+
+    /// True if messages borrow this invoker. Set on the invoker only.
+    bool m_borrowed = false;
+
+#ifdef PROFILE_ENABLE
+    /// The profile row of the target. Set on the invoker only.
+    profile_entry* m_profile = nullptr;
+#endif
+
+    // </common_code>
+};
+
+template <class C, class R, class... Policies>
+struct DelegateMemberWeakAsync; // Not defined
+
+/// @brief `DelegateMemberWeakAsync<>` class asynchronously invokes a class member target 
+/// function using a class object weak pointer.
+/// @details Neither the delegate nor its queued messages keep the object alive. The 
+/// destination thread promotes the weak pointer when it invokes the message and drops 
+/// the message if the object is destroyed, so an object may be destroyed without 
+/// synchronizing with messages still queued for it. A call made once the object is 
+/// destroyed dispatches no message.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+/// @tparam Policies The invocation policies, see DelegatePolicy.h.
+template <class TClass, class RetType, class... Args, class... Policies>
+class DelegateMemberWeakAsync<TClass, RetType(Args...), Policies...> : public DelegateMemberWeak<TClass, RetType(Args...)>, public IDelegateInvoker {
+public:
+    typedef std::weak_ptr<TClass> WeakPtr;
+    typedef RetType(TClass::* MemberFunc)(Args...);
+    typedef RetType(TClass::* ConstMemberFunc)(Args...) const;
+    using ClassType = DelegateMemberWeakAsync<TClass, RetType(Args...), Policies...>;
+    using PolicyType = delegate_policies<Policies...>;
+    using BaseType = DelegateMemberWeak<TClass, RetType(Args...)>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object weak pointer to store.
+    /// @param[in] func The target member function to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateMemberWeakAsync(WeakPtr object, MemberFunc func, DelegateThread& thread) : m_thread(&thread) {
+        Bind(std::move(object), func, thread);
+    }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object weak pointer to store.
+    /// @param[in] func The target const member function to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateMemberWeakAsync(WeakPtr object, ConstMemberFunc func, DelegateThread& thread) : m_thread(&thread) {
+        Bind(std::move(object), func, thread);
+    }
+
+    /// @brief Copy constructor that creates a copy of the given instance.
+    /// @param[in] rhs The object to copy from.
+    DelegateMemberWeakAsync(const ClassType& rhs) :
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        Assign(rhs);
+    }
+
+    /// @brief Move constructor that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    DelegateMemberWeakAsync(ClassType&& rhs) noexcept :
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        m_invoker = rhs.m_invoker;
+        rhs.Clear();
+    }
+
+    DelegateMemberWeakAsync() = default;
+
+    /// @brief Bind a member function to the delegate.
+    /// @param[in] object The target object weak pointer.
+    /// @param[in] func The member function to bind to the delegate. This function must 
+    /// match the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(WeakPtr object, MemberFunc func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(std::move(object), func);
+        BindInvoker();
+    }
+
+    /// @brief Bind a const member function to the delegate.
+    /// @param[in] object The target object weak pointer.
+    /// @param[in] func The const member function to bind to the delegate. This function 
+    /// must match the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(WeakPtr object, ConstMemberFunc func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(std::move(object), func);
+        BindInvoker();
+    }
+
+    // <common_code>
+
+    /// @brief Assigns the state of one object to another.
+    /// @details Copy the state from the `rhs` (right-hand side) object to the
+    /// current object.
+    /// @param[in] rhs The object whose state is to be copied.
+    void Assign(const ClassType& rhs) {
+        m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
+        BaseType::Assign(rhs);
+    }
+    /// @brief Creates a copy of the current object.
+    /// @details Clones the current instance of the class by creating a new object
+    /// and copying the state of the current object to it. 
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Assignment operator that assigns the state of one object to another.
+    /// @param[in] rhs The object whose state is to be assigned to the current object.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) {
+        if (&rhs != this) {
+            BaseType::operator=(rhs);
+            Assign(rhs);
+        }
+        return *this;
+    }
+
+    /// @brief Move assignment operator that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    /// @return A reference to the current object.
+    ClassType& operator=(ClassType&& rhs) noexcept {
+        if (&rhs != this) {
+            BaseType::operator=(std::move(rhs));
+            m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
+        }
+        return *this;
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept override {
+        return this->Clear();
+    }
+
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
+    /// @brief Compares two delegate objects for equality.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        return derivedRhs &&
+            m_thread == derivedRhs->m_thread &&
+            BaseType::Equal(rhs);
+    }
+
+    /// Compares two delegate objects for equality.
+    /// @return `true` if the objects are equal, `false` otherwise.
+    bool operator==(const ClassType& rhs) const noexcept { return Equal(rhs); }
 
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override {
+        return this->Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override {
+        return !this->Empty();
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    friend bool operator==(std::nullptr_t, const ClassType& rhs) noexcept {
+        return rhs.Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    friend bool operator!=(std::nullptr_t, const ClassType& rhs) noexcept {
+        return !rhs.Empty();
+    }
+
+    /// @brief Invoke the bound delegate function asynchronously. Called by the source thread.
+    /// @details Invoke delegate function asynchronously and do not wait for return value.
+    /// This function is called by the source thread. Dispatches the delegate data into the 
+    /// destination thread message queue. `Invoke()` must be called by the destination 
+    /// thread to invoke the target function. Always safe to call.
+    /// 
+    /// The `DelegateAsyncMsg` duplicates and copies the function arguments into the message. 
+    /// The source thread is not required to place function arguments into the heap. The delegate
+    /// library performs all necessary argument coping for the caller. Ensure complex argument 
+    /// data types can be safely copied by creating a copy constructor if necessary. The message
+    /// is allocated from `pool_allocator` and refers to the invoker created at bind time, so 
+    /// steady-state calls do not use the heap.
+    /// @param[in] args The function arguments, if any.
+    /// @return A default return value. The return value is *not* returned from the 
+    /// target function. Do not use the return value.
+    /// @post Do not use the return value as its not valid.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual RetType operator()(Args... args) override {
+        if (this->Empty())
+            return RetType();
+
+        // Synchronously invoke the target function?
+        if (m_sync) {
+            // Invoke the target function directly within the policies
+            return PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
+        } else {
+            // Drop a call a policy filters out. Compiles to nothing without policies.
+            if (!PolicyType::Send(args...))
+                return RetType();
+
+            TRACE_SCOPE("DelegateAsync::operator()");
+            static MetricCounter& callsMetric = Metrics::GetCounter("delegate.async.calls");
+            callsMetric.Add();
+
+            // Invoke the target function directly if called on a destination thread
+            // that allows inline calls
             auto thread = this->GetThread();
+            if (thread && thread->IsInlineCall()) {
+                static MetricCounter& inlineMetric = Metrics::GetCounter("delegate.async.inline_calls");
+                inlineMetric.Add();
+                PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
+                return RetType();
+            }
+
+            // Let the policies see the queued call while the arguments are intact
+            if (thread)
+                PolicyType::Dispatch(*thread, args...);
+
+            // Create a new message instance for sending to the destination thread, from
+            // the thread's memory resource or NUMA node. A borrowed invoker is not 
+            // reference counted per message unless the message is held back by a 
+            // dispatch scope.
+            auto scope = DispatchScope::Current();
+            bool borrow = m_invoker->m_borrowed && !scope;
+            auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+                thread ? pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()) :
+                    pool_allocator<DelegateAsyncMsg<Args...>>(), 
+                borrow ? nullptr : m_invoker, std::forward<Args>(args)...);
+            if (!msg)
+                BAD_ALLOC();
+            if (borrow)
+                msg->BorrowInvoker(m_invoker.get());
+
+#ifdef PROFILE_ENABLE
+            if (m_invoker->m_profile && Profiler::IsEnabled()) {
+                msg->m_sent = Profiler::Now();
+                m_invoker->m_profile->Sent(sizeof(inline_args<Args...>));
+            }
+#endif
+
             if (thread) {
                 // Dispatch message onto the callback destination thread. Invoke()
                 // will be called by the destintation thread. 
-                thread->DispatchDelegate(msg);
+                TRACE_FLOW_BEGIN(reinterpret_cast<uintptr_t>(msg.get()));
+                if (scope)
+                    scope->Add(thread, std::move(msg));
+                else
+                    thread->DispatchDelegate(msg);
             }
 
             // Do not wait for destination thread return value from async function call
@@ -578,6 +1406,47 @@ public:
         operator()(std::forward<Args>(args)...);
     }
 
+    /// @brief Invoke the delegate function asynchronously once a due time is reached. 
+    /// Do not wait for return value. Called by the source thread. Always safe to call.
+    /// @details The destination thread holds the message until the due time, see 
+    /// `DelegateThread::DispatchDelegateAt()`, so no timer is created per call. The call 
+    /// is never invoked inline nor held back by a `DispatchScope`.
+    /// @param[in] due The `Clock::Now()` time to invoke the target function at.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled. `false` if the delegate is empty or 
+    /// synchronous, a policy filtered out the call, or the destination thread does not 
+    /// support scheduled dispatch.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAt(Clock::time_point due, Args... args) {
+        auto thread = GetAsyncThread();
+        if (this->Empty() || !thread)
+            return false;
+        if (!PolicyType::Send(args...))
+            return false;
+
+        static MetricCounter& scheduledMetric = Metrics::GetCounter("delegate.async.scheduled_calls");
+        scheduledMetric.Add();
+        PolicyType::Dispatch(*thread, args...);
+
+        // A held message owns a reference to the invoker instead of borrowing it
+        auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+            pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()), 
+            m_invoker, std::forward<Args>(args)...);
+        if (!msg)
+            BAD_ALLOC();
+        return thread->DispatchDelegateAt(std::move(msg), due);
+    }
+
+    /// @brief Invoke the delegate function asynchronously once a delay elapses. See 
+    /// `AsyncInvokeAt()`.
+    /// @param[in] delay The time from now to invoke the target function after.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAfter(std::chrono::nanoseconds delay, Args... args) {
+        return AsyncInvokeAt(Clock::Now() + delay, std::forward<Args>(args)...);
+    }
+
     /// @brief Invoke the delegate function on the destination thread. Called by the 
     /// destintation thread.
     /// @details Each source thread call to `operator()` generate a call to `Invoke()` 
@@ -588,12 +1457,22 @@ public:
     /// @return `true` if target function invoked; `false` if error. 
     virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
         // Typecast the base pointer to back correct derived to instance
-        auto delegateMsg = std::dynamic_pointer_cast<DelegateAsyncMsg<Args...>>(msg);
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncMsg<Args...>>(msg);
         if (delegateMsg == nullptr)
             return false;
 
-        // Invoke the delegate function synchronously
-        m_sync = true;
+        TRACE_SCOPE("DelegateAsync::Invoke");
+        TRACE_FLOW_END(reinterpret_cast<uintptr_t>(msg.get()));
+
+#ifdef PROFILE_ENABLE
+        if (m_profile && delegateMsg->m_sent) {
+            uint64_t start = Profiler::Now();
+            std::apply(&BaseType::operator(), 
+                std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+            m_profile->Invoked(start - delegateMsg->m_sent, Profiler::Now() - start);
+            return true;
+        }
+#endif
 
         // Invoke the target function using the source thread supplied function arguments
         std::apply(&BaseType::operator(), 
@@ -601,21 +1480,112 @@ public:
         return true;
     }
 
+    /// @brief Name the profile row of the target, see Profile.h. Delegates given the
+    /// same name share a row. Copies taken afterwards use the name; a later bind 
+    /// restores the default row. Does nothing unless `PROFILE_ENABLE` is defined.
+    /// @param[in] name The row name, e.g. the target function name.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetProfileName(const std::string& name) {
+#ifdef PROFILE_ENABLE
+        // A new invoker so messages already queued and earlier copies keep their row
+        BindInvoker();
+        if (m_invoker)
+            m_invoker->m_profile = Profiler::GetEntry(name);
+#else
+        (void)name;
+#endif
+    }
+
+    /// @brief Let messages borrow the invoker instead of each holding a reference to 
+    /// it, removing two contended reference count updates per call. The delegate and 
+    /// its copies own the invoker; once the last lets go, a message sent to the 
+    /// destination thread releases it after the messages already queued. Takes effect
+    /// only on an ordered thread, see `DelegateThread::IsOrdered()`, and on a bound 
+    /// delegate. Copies taken afterwards and later binds keep the setting.
+    /// @param[in] borrowed `true` to borrow, `false` to reference count each message.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetBorrowedInvoker(bool borrowed) {
+        // A new invoker so messages already queued and earlier copies are unaffected
+        if (m_invoker && m_invoker->m_borrowed != borrowed)
+            BindInvoker(borrowed);
+    }
+
     ///@brief Get the destination thread that the target function is invoked on.
     // @return The target thread.
     DelegateThread* GetThread() noexcept { return m_thread; }
 
+    /// @brief Get the destination thread. Lets a multicast broadcast send one message 
+    /// per thread for all of its delegates bound to that thread.
+    /// @return The destination thread, or `nullptr` if invoked synchronously.
+    virtual DelegateThread* GetAsyncThread() const noexcept override {
+        return m_sync || !m_invoker ? nullptr : m_thread;
+    }
+
+    /// @brief Get the synchronous invoker called on the destination thread.
+    /// @return The invoker shared by every call.
+    virtual std::shared_ptr<Delegate<RetType(Args...)>> GetAsyncInvoker() const override {
+        return m_invoker;
+    }
+
 private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        BindInvoker(m_invoker && m_invoker->m_borrowed);
+    }
+
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies.
+    /// @param[in] borrowed `true` if messages borrow the invoker.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker(bool borrowed) {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+#ifdef PROFILE_ENABLE
+        invoker->m_profile = Profiler::GetEntry<ClassType>();
+#endif
+        if (borrowed && m_thread && m_thread->IsOrdered()) {
+            // Owners share a handle whose deleter retires the invoker through the thread
+            invoker->m_borrowed = true;
+            auto retire = std::make_shared<DelegateRetireMsg>(invoker);
+            if (!retire)
+                BAD_ALLOC();
+            m_invoker = std::shared_ptr<ClassType>(invoker.get(), DelegateRetireMsg::Deleter{ m_thread, std::move(retire) });
+        }
+        else
+            m_invoker = invoker;
+    }
+
     /// The target thread to invoke the delegate function.
     DelegateThread* m_thread = nullptr;   
 
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
     /// Flag to control synchronous vs asynchronous target invoke behavior.
     bool m_sync = false;        
 
+    /// True if messages borrow this invoker. Set on the invoker only.
+    bool m_borrowed = false;
+
+#ifdef PROFILE_ENABLE
+    /// The profile row of the target. Set on the invoker only.
+    profile_entry* m_profile = nullptr;
+#endif
+
     // </common_code>
 };
 
-template <class R>
+template <class R, class... Policies>
 struct DelegateFunctionAsync; // Not defined
 
 /// @brief `DelegateFunctionAsync<>` class asynchronously invokes a `std::function` target function.
@@ -627,19 +1597,30 @@ struct DelegateFunctionAsync; // Not defined
 /// 
 /// @tparam RetType The return type of the bound delegate function.
 /// @tparam Args The argument types of the bound delegate function.
-template <class RetType, class... Args>
-class DelegateFunctionAsync<RetType(Args...)> : public DelegateFunction<RetType(Args...)>, public IDelegateInvoker {
+/// @tparam Policies The invocation policies, see DelegatePolicy.h.
+template <class RetType, class... Args, class... Policies>
+class DelegateFunctionAsync<RetType(Args...), Policies...> : public DelegateFunction<RetType(Args...)>, public IDelegateInvoker {
 public:
     using FunctionType = std::function<RetType(Args...)>;
-    using ClassType = DelegateFunctionAsync<RetType(Args...)>;
+    using ClassType = DelegateFunctionAsync<RetType(Args...), Policies...>;
+    using PolicyType = delegate_policies<Policies...>;
     using BaseType = DelegateFunction<RetType(Args...)>;
 
     /// @brief Constructor to create a class instance.
     /// @param[in] func The target `std::function` to store.
     /// @param[in] thread The execution thread to invoke `func`.
     DelegateFunctionAsync(FunctionType func, DelegateThread& thread) :
-        BaseType(func), m_thread(&thread) {
-        Bind(func, thread);
+        m_thread(&thread) {
+        Bind(std::move(func), thread);
+    }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] func The target callable, such as a lambda, to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    DelegateFunctionAsync(F&& func, DelegateThread& thread) :
+        m_thread(&thread) {
+        Bind(std::forward<F>(func), thread);
     }
 
     /// @brief Copy constructor that creates a copy of the given instance.
@@ -656,6 +1637,7 @@ public:
     /// @param[in] rhs The object to move from.
     DelegateFunctionAsync(ClassType&& rhs) noexcept :
         BaseType(rhs), m_thread(rhs.m_thread) {
+        m_invoker = rhs.m_invoker;
         rhs.Clear();
     }
 
@@ -669,7 +1651,19 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     void Bind(FunctionType func, DelegateThread& thread) {
         m_thread = &thread;
-        BaseType::Bind(func);
+        BaseType::Bind(std::move(func));
+        BindInvoker();
+    }
+
+    /// @brief Bind a callable, such as a lambda, to the delegate.
+    /// @param[in] func The callable to bind to the delegate. Stored inline if it fits 
+    /// within `DELEGATE_FUNCTION_SIZE` bytes.
+    /// @param[in] thread The execution thread to invoke `func`.
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    void Bind(F&& func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(std::forward<F>(func));
+        BindInvoker();
     }
 
     // <common_code>
@@ -680,6 +1674,7 @@ public:
     /// @param[in] rhs The object whose state is to be copied.
     void Assign(const ClassType& rhs) {
         m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
         BaseType::Assign(rhs);
     }
     /// @brief Creates a copy of the current object.
@@ -692,6 +1687,19 @@ public:
         return new(std::nothrow) ClassType(*this);
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assignment operator that assigns the state of one object to another.
     /// @param[in] rhs The object whose state is to be assigned to the current object.
     /// @return A reference to the current object.
@@ -710,6 +1718,7 @@ public:
         if (&rhs != this) {
             BaseType::operator=(std::move(rhs));
             m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
         }
         return *this;
     }
@@ -719,11 +1728,24 @@ public:
         return this->Clear();
     }
 
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_thread == derivedRhs->m_thread &&
             BaseType::Equal(rhs);
@@ -763,10 +1785,12 @@ public:
     /// destination thread message queue. `Invoke()` must be called by the destination 
     /// thread to invoke the target function. Always safe to call.
     /// 
-    /// The `DelegateAsyncMsg` duplicates and copies the function arguments into heap memory. 
+    /// The `DelegateAsyncMsg` duplicates and copies the function arguments into the message. 
     /// The source thread is not required to place function arguments into the heap. The delegate
-    /// library performs all necessary heap and argument coping for the caller. Ensure complex
-    /// argument data types can be safely copied by creating a copy constructor if necessary. 
+    /// library performs all necessary argument coping for the caller. Ensure complex argument 
+    /// data types can be safely copied by creating a copy constructor if necessary. The message
+    /// is allocated from `pool_allocator` and refers to the invoker created at bind time, so 
+    /// steady-state calls do not use the heap.
     /// @param[in] args The function arguments, if any.
     /// @return A default return value. The return value is *not* returned from the 
     /// target function. Do not use the return value.
@@ -778,24 +1802,61 @@ public:
 
         // Synchronously invoke the target function?
         if (m_sync) {
-            // Invoke the target function directly
-            return BaseType::operator()(std::forward<Args>(args)...);
+            // Invoke the target function directly within the policies
+            return PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
         } else {
-            // Create a clone instance of this delegate 
-            auto delegate = std::shared_ptr<ClassType>(Clone());
-            if (!delegate)
-                BAD_ALLOC();
+            // Drop a call a policy filters out. Compiles to nothing without policies.
+            if (!PolicyType::Send(args...))
+                return RetType();
+
+            TRACE_SCOPE("DelegateAsync::operator()");
+            static MetricCounter& callsMetric = Metrics::GetCounter("delegate.async.calls");
+            callsMetric.Add();
 
-            // Create a new message instance for sending to the destination thread
-            auto msg = std::make_shared<DelegateAsyncMsg<Args...>>(delegate, std::forward<Args>(args)...);
+            // Invoke the target function directly if called on a destination thread
+            // that allows inline calls
+            auto thread = this->GetThread();
+            if (thread && thread->IsInlineCall()) {
+                static MetricCounter& inlineMetric = Metrics::GetCounter("delegate.async.inline_calls");
+                inlineMetric.Add();
+                PolicyType::Invoke([&]() -> RetType { return BaseType::operator()(std::forward<Args>(args)...); });
+                return RetType();
+            }
+
+            // Let the policies see the queued call while the arguments are intact
+            if (thread)
+                PolicyType::Dispatch(*thread, args...);
+
+            // Create a new message instance for sending to the destination thread, from
+            // the thread's memory resource or NUMA node. A borrowed invoker is not 
+            // reference counted per message unless the message is held back by a 
+            // dispatch scope.
+            auto scope = DispatchScope::Current();
+            bool borrow = m_invoker->m_borrowed && !scope;
+            auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+                thread ? pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()) :
+                    pool_allocator<DelegateAsyncMsg<Args...>>(), 
+                borrow ? nullptr : m_invoker, std::forward<Args>(args)...);
             if (!msg)
                 BAD_ALLOC();
+            if (borrow)
+                msg->BorrowInvoker(m_invoker.get());
+
+#ifdef PROFILE_ENABLE
+            if (m_invoker->m_profile && Profiler::IsEnabled()) {
+                msg->m_sent = Profiler::Now();
+                m_invoker->m_profile->Sent(sizeof(inline_args<Args...>));
+            }
+#endif
 
-            auto thread = this->GetThread();
             if (thread) {
                 // Dispatch message onto the callback destination thread. Invoke()
                 // will be called by the destintation thread. 
-                thread->DispatchDelegate(msg);
+                TRACE_FLOW_BEGIN(reinterpret_cast<uintptr_t>(msg.get()));
+                if (scope)
+                    scope->Add(thread, std::move(msg));
+                else
+                    thread->DispatchDelegate(msg);
             }
 
             // Do not wait for destination thread return value from async function call
@@ -819,6 +1880,47 @@ public:
         operator()(std::forward<Args>(args)...);
     }
 
+    /// @brief Invoke the delegate function asynchronously once a due time is reached. 
+    /// Do not wait for return value. Called by the source thread. Always safe to call.
+    /// @details The destination thread holds the message until the due time, see 
+    /// `DelegateThread::DispatchDelegateAt()`, so no timer is created per call. The call 
+    /// is never invoked inline nor held back by a `DispatchScope`.
+    /// @param[in] due The `Clock::Now()` time to invoke the target function at.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled. `false` if the delegate is empty or 
+    /// synchronous, a policy filtered out the call, or the destination thread does not 
+    /// support scheduled dispatch.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAt(Clock::time_point due, Args... args) {
+        auto thread = GetAsyncThread();
+        if (this->Empty() || !thread)
+            return false;
+        if (!PolicyType::Send(args...))
+            return false;
+
+        static MetricCounter& scheduledMetric = Metrics::GetCounter("delegate.async.scheduled_calls");
+        scheduledMetric.Add();
+        PolicyType::Dispatch(*thread, args...);
+
+        // A held message owns a reference to the invoker instead of borrowing it
+        auto msg = std::allocate_shared<DelegateAsyncMsg<Args...>>(
+            pool_allocator<DelegateAsyncMsg<Args...>>(thread->GetMemoryResource(), thread->GetNumaNode()), 
+            m_invoker, std::forward<Args>(args)...);
+        if (!msg)
+            BAD_ALLOC();
+        return thread->DispatchDelegateAt(std::move(msg), due);
+    }
+
+    /// @brief Invoke the delegate function asynchronously once a delay elapses. See 
+    /// `AsyncInvokeAt()`.
+    /// @param[in] delay The time from now to invoke the target function after.
+    /// @param[in] args The function arguments, if any.
+    /// @return `true` if the call is scheduled.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    bool AsyncInvokeAfter(std::chrono::nanoseconds delay, Args... args) {
+        return AsyncInvokeAt(Clock::Now() + delay, std::forward<Args>(args)...);
+    }
+
     /// @brief Invoke the delegate function on the destination thread. Called by the 
     /// destintation thread.
     /// @details Each source thread call to `operator()` generate a call to `Invoke()` 
@@ -829,12 +1931,22 @@ public:
     /// @return `true` if target function invoked; `false` if error. 
     virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
         // Typecast the base pointer to back correct derived to instance
-        auto delegateMsg = std::dynamic_pointer_cast<DelegateAsyncMsg<Args...>>(msg);
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncMsg<Args...>>(msg);
         if (delegateMsg == nullptr)
             return false;
 
-        // Invoke the delegate function synchronously
-        m_sync = true;
+        TRACE_SCOPE("DelegateAsync::Invoke");
+        TRACE_FLOW_END(reinterpret_cast<uintptr_t>(msg.get()));
+
+#ifdef PROFILE_ENABLE
+        if (m_profile && delegateMsg->m_sent) {
+            uint64_t start = Profiler::Now();
+            std::apply(&BaseType::operator(), 
+                std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+            m_profile->Invoked(start - delegateMsg->m_sent, Profiler::Now() - start);
+            return true;
+        }
+#endif
 
         // Invoke the target function using the source thread supplied function arguments
         std::apply(&BaseType::operator(), 
@@ -842,17 +1954,108 @@ public:
         return true;
     }
 
+    /// @brief Name the profile row of the target, see Profile.h. Delegates given the
+    /// same name share a row. Copies taken afterwards use the name; a later bind 
+    /// restores the default row. Does nothing unless `PROFILE_ENABLE` is defined.
+    /// @param[in] name The row name, e.g. the target function name.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetProfileName(const std::string& name) {
+#ifdef PROFILE_ENABLE
+        // A new invoker so messages already queued and earlier copies keep their row
+        BindInvoker();
+        if (m_invoker)
+            m_invoker->m_profile = Profiler::GetEntry(name);
+#else
+        (void)name;
+#endif
+    }
+
+    /// @brief Let messages borrow the invoker instead of each holding a reference to 
+    /// it, removing two contended reference count updates per call. The delegate and 
+    /// its copies own the invoker; once the last lets go, a message sent to the 
+    /// destination thread releases it after the messages already queued. Takes effect
+    /// only on an ordered thread, see `DelegateThread::IsOrdered()`, and on a bound 
+    /// delegate. Copies taken afterwards and later binds keep the setting.
+    /// @param[in] borrowed `true` to borrow, `false` to reference count each message.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void SetBorrowedInvoker(bool borrowed) {
+        // A new invoker so messages already queued and earlier copies are unaffected
+        if (m_invoker && m_invoker->m_borrowed != borrowed)
+            BindInvoker(borrowed);
+    }
+
     ///@brief Get the destination thread that the target function is invoked on.
     // @return The target thread.
     DelegateThread* GetThread() noexcept { return m_thread; }
 
+    /// @brief Get the destination thread. Lets a multicast broadcast send one message 
+    /// per thread for all of its delegates bound to that thread.
+    /// @return The destination thread, or `nullptr` if invoked synchronously.
+    virtual DelegateThread* GetAsyncThread() const noexcept override {
+        return m_sync || !m_invoker ? nullptr : m_thread;
+    }
+
+    /// @brief Get the synchronous invoker called on the destination thread.
+    /// @return The invoker shared by every call.
+    virtual std::shared_ptr<Delegate<RetType(Args...)>> GetAsyncInvoker() const override {
+        return m_invoker;
+    }
+
 private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        BindInvoker(m_invoker && m_invoker->m_borrowed);
+    }
+
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies.
+    /// @param[in] borrowed `true` if messages borrow the invoker.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker(bool borrowed) {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+#ifdef PROFILE_ENABLE
+        invoker->m_profile = Profiler::GetEntry<ClassType>();
+#endif
+        if (borrowed && m_thread && m_thread->IsOrdered()) {
+            // Owners share a handle whose deleter retires the invoker through the thread
+            invoker->m_borrowed = true;
+            auto retire = std::make_shared<DelegateRetireMsg>(invoker);
+            if (!retire)
+                BAD_ALLOC();
+            m_invoker = std::shared_ptr<ClassType>(invoker.get(), DelegateRetireMsg::Deleter{ m_thread, std::move(retire) });
+        }
+        else
+            m_invoker = invoker;
+    }
+
     /// The target thread to invoke the delegate function.
     DelegateThread* m_thread = nullptr;   
 
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
     /// Flag to control synchronous vs asynchronous target invoke behavior.
     bool m_sync = false;        
 
+    /// True if messages borrow this invoker. Set on the invoker only.
+    bool m_borrowed = false;
+
+#ifdef PROFILE_ENABLE
+    /// The profile row of the target. Set on the invoker only.
+    profile_entry* m_profile = nullptr;
+#endif
+
     // </common_code>
 };
 
@@ -933,6 +2136,32 @@ auto MakeDelegate(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args...
     return DelegateMemberAsync<TClass, RetVal(Args...)>(object, func, thread);
 }
 
+/// @brief Creates an asynchronous delegate that binds to a non-const member function using a weak pointer.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetVal The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A weak pointer to the instance of `TClass`. Queued calls do not keep it alive.
+/// @param[in] func A pointer to the non-const member function of `TClass` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateMemberWeakAsync` object bound to the specified non-const member function and thread.
+template <class TClass, class RetVal, class... Args>
+auto MakeDelegate(std::weak_ptr<TClass> object, RetVal(TClass::* func)(Args... args), DelegateThread& thread) {
+    return DelegateMemberWeakAsync<TClass, RetVal(Args...)>(std::move(object), func, thread);
+}
+
+/// @brief Creates an asynchronous delegate that binds to a const member function using a weak pointer.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetVal The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A weak pointer to the instance of `TClass`. Queued calls do not keep it alive.
+/// @param[in] func A pointer to the const member function of `TClass` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateMemberWeakAsync` object bound to the specified const member function and thread.
+template <class TClass, class RetVal, class... Args>
+auto MakeDelegate(std::weak_ptr<TClass> object, RetVal(TClass::* func)(Args... args) const, DelegateThread& thread) {
+    return DelegateMemberWeakAsync<TClass, RetVal(Args...)>(std::move(object), func, thread);
+}
+
 /// @brief Creates an asynchronous delegate that binds to a `std::function`.
 /// @tparam RetType The return type of the `std::function`.
 /// @tparam Args The types of the function arguments.
@@ -944,6 +2173,18 @@ auto MakeDelegate(std::function<RetType(Args...)> func, DelegateThread& thread)
     return DelegateFunctionAsync<RetType(Args...)>(func, thread);
 }
 
+/// @brief Creates an asynchronous delegate that binds to a lambda or other callable object
+/// with one non-template `operator()`. The callable is stored inline if it fits within
+/// `DELEGATE_FUNCTION_SIZE` bytes.
+/// @tparam F The callable type. The delegate signature is that of `F::operator()`.
+/// @param[in] func The callable to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateFunctionAsync` object bound to the specified callable and thread.
+template <class F, class = std::enable_if_t<is_deducible_function_target<F>::value>>
+auto MakeDelegate(F&& func, DelegateThread& thread) {
+    return DelegateFunctionAsync<typename callable_signature<std::decay_t<F>>::type>(std::forward<F>(func), thread);
+}
+
 }
 
 #endif
@@ -0,0 +1,347 @@
+#ifndef _DELEGATE_ASYNC_BATCH_H
+#define _DELEGATE_ASYNC_BATCH_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Asynchronous delegate that accumulates calls and invokes the target once
+/// per batch of arguments.
+///
+/// @details `DelegateAsyncBatch<>` is called like a `DelegateAsync<void(T)>`, but each
+/// call appends its argument to a buffer shared with the destination thread instead of
+/// dispatching a message. At most one message per delegate waits in the destination
+/// thread queue. When the destination thread invokes it, the message takes every
+/// argument buffered so far and invokes the target with them as one span, so queueing
+/// and wakeups are paid once per batch rather than once per call.
+///
+/// A message is dispatched when none is queued and the buffer reaches `maxBatch`
+/// arguments, when the oldest buffered argument is older than `maxDelay`, or when
+/// `Flush()` is called. The default `maxDelay` of zero dispatches on the first call,
+/// so batches form only while the destination thread is busy. With a non-zero
+/// `maxDelay`, call `Flush()` once the producer goes idle so the last arguments are not
+/// left buffered. The target is called with at most `maxBatch` arguments per span.
+///
+/// The span is `std::span<const T>` when the standard library provides it and
+/// `batch_span<T>` otherwise. It refers to the buffer only during the target call.
+///
+/// Code example:
+///
+/// `void OnSamples(batch_span<int> samples);`
+/// `auto sample = MakeDelegateBatch(MakeDelegate(&OnSamples), workerThread, 1024);`
+/// `for (int i = 0; i < 1000000; i++)`
+/// `    sample(i);      // OnSamples() called once per batch of up to 1024 samples`
+
+#include "Delegate.h"
+#include "DelegateThread.h"
+#include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+#if __has_include(<span>)
+#include <span>
+#endif
+
+namespace DelegateLib {
+
+#if defined(__cpp_lib_span)
+/// @brief The arguments of one batch
+template <class T>
+using batch_span = std::span<const T>;
+#else
+/// @brief The arguments of one batch. A read-only view of contiguous elements.
+/// @tparam T The element type.
+template <class T>
+class batch_span
+{
+public:
+    constexpr batch_span() noexcept = default;
+    constexpr batch_span(const T* data, size_t size) noexcept : m_data(data), m_size(size) { }
+
+    constexpr const T* data() const noexcept { return m_data; }
+    constexpr size_t size() const noexcept { return m_size; }
+    constexpr bool empty() const noexcept { return m_size == 0; }
+    constexpr const T* begin() const noexcept { return m_data; }
+    constexpr const T* end() const noexcept { return m_data + m_size; }
+    constexpr const T& operator[](size_t index) const noexcept { return m_data[index]; }
+
+private:
+    const T* m_data = nullptr;
+    size_t m_size = 0;
+};
+#endif
+
+template <class R>
+class DelegateAsyncBatch; // Not defined
+
+/// @brief Asynchronously invokes a target delegate once per batch of call arguments.
+/// @tparam T The argument type of each call.
+template <class T>
+class DelegateAsyncBatch<void(batch_span<T>)> : public Delegate<void(T)> {
+public:
+    using DelegateType = Delegate<void(T)>;
+    using TargetType = Delegate<void(batch_span<T>)>;
+    using ClassType = DelegateAsyncBatch<void(batch_span<T>)>;
+
+    /// Default largest batch passed to the target
+    static const size_t DEFAULT_MAX_BATCH = 1024;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] target The synchronous delegate to invoke on `thread`. Copied.
+    /// @param[in] thread The execution thread to invoke `target`.
+    /// @param[in] maxBatch The most arguments passed to the target per call, and the
+    /// buffered arguments dispatching a message.
+    /// @param[in] maxDelay The longest an argument is buffered before a call dispatches.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    DelegateAsyncBatch(const TargetType& target, DelegateThread& thread, size_t maxBatch = DEFAULT_MAX_BATCH,
+        std::chrono::nanoseconds maxDelay = std::chrono::nanoseconds(0)) {
+        Bind(target, thread, maxBatch, maxDelay);
+    }
+
+    /// @brief Copy constructor. The copy shares the buffer of `rhs`.
+    /// @param[in] rhs The object to copy from.
+    DelegateAsyncBatch(const ClassType& rhs) = default;
+
+    /// @brief Copy assignment. The object shares the buffer of `rhs`.
+    /// @param[in] rhs The object to copy from.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) = default;
+
+    DelegateAsyncBatch() = default;
+
+    /// @brief Bind a target delegate.
+    /// @param[in] target The synchronous delegate to invoke on `thread`. Copied.
+    /// @param[in] thread The execution thread to invoke `target`.
+    /// @param[in] maxBatch The most arguments passed to the target per call.
+    /// @param[in] maxDelay The longest an argument is buffered before a call dispatches.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void Bind(const TargetType& target, DelegateThread& thread, size_t maxBatch = DEFAULT_MAX_BATCH,
+        std::chrono::nanoseconds maxDelay = std::chrono::nanoseconds(0)) {
+        m_state = nullptr;
+        if (target == nullptr)
+            return;
+
+        std::unique_ptr<TargetType> targetClone(target.Clone());
+        if (!targetClone)
+            BAD_ALLOC();
+        m_state = std::allocate_shared<State>(pool_allocator<State>(), std::move(targetClone), thread,
+            std::max<size_t>(maxBatch, 1), maxDelay);
+        if (!m_state)
+            BAD_ALLOC();
+    }
+
+    /// @brief Creates a copy of the current object sharing its buffer.
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Buffer an argument for the next batch, dispatching a message if due.
+    /// Called by the source thread. Always safe to call.
+    /// @param[in] arg The argument. Moved into the buffer.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual void operator()(T arg) override {
+        if (Empty())
+            return;
+
+        State& state = *m_state;
+        {
+            std::lock_guard<std::mutex> lock(state.m_lock);
+            if (state.m_pending.empty())
+                state.m_first = std::chrono::steady_clock::now();
+            state.m_pending.push_back(std::move(arg));
+            if (state.m_queued || !state.IsDue())
+                return;
+            state.m_queued = true;
+        }
+        Dispatch();
+    }
+
+    /// @brief Buffer an argument for the next batch. Called by the source thread.
+    /// @param[in] arg The argument.
+    void AsyncInvoke(T arg) {
+        operator()(std::move(arg));
+    }
+
+    /// @brief Dispatch the buffered arguments unless a message is already queued.
+    /// Called by the source thread.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void Flush() {
+        if (Empty())
+            return;
+
+        State& state = *m_state;
+        {
+            std::lock_guard<std::mutex> lock(state.m_lock);
+            if (state.m_queued || state.m_pending.empty())
+                return;
+            state.m_queued = true;
+        }
+        Dispatch();
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept { Clear(); }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
+    /// @brief Compares two delegate objects for equality. Equal if bound to equal
+    /// targets and the same thread.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        if (!derivedRhs)
+            return false;
+        if (!m_state || !derivedRhs->m_state)
+            return !m_state && !derivedRhs->m_state;
+        return m_state == derivedRhs->m_state ||
+            (m_state->m_thread == derivedRhs->m_state->m_thread &&
+             m_state->m_target->Equal(*derivedRhs->m_state->m_target));
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override { return Empty(); }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override { return !Empty(); }
+
+    /// @brief Check if the delegate is bound to a target function.
+    /// @return `true` if the delegate has a target function, `false` otherwise.
+    bool Empty() const noexcept { return !m_state; }
+
+    /// @brief Clear the target function.
+    /// @post The delegate is empty. A queued batch still invokes the target.
+    void Clear() noexcept { m_state = nullptr; }
+
+    /// @brief Implicit conversion operator to `bool`.
+    /// @return `true` if the object is not empty, `false` if the object is empty.
+    explicit operator bool() const noexcept { return !Empty(); }
+
+private:
+    /// The queued message. The arguments are taken from the state when invoked.
+    class Msg : public DelegateMsg
+    {
+    public:
+        explicit Msg(std::shared_ptr<IDelegateInvoker> invoker) : DelegateMsg(invoker, type_id<Msg>()) { }
+    };
+
+    /// The target and argument buffer shared by a delegate and its copies.
+    class State : public IDelegateInvoker
+    {
+    public:
+        State(std::unique_ptr<TargetType> target, DelegateThread& thread, size_t maxBatch,
+            std::chrono::nanoseconds maxDelay) :
+            m_target(std::move(target)), m_thread(&thread), m_maxBatch(maxBatch), m_maxDelay(maxDelay) { }
+
+        /// @brief Invoke the target with every buffered argument. Called by the
+        /// destination thread.
+        /// @param[in] msg The message dispatched by the source thread.
+        /// @return `true` if the target function invoked.
+        virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+            if (delegate_msg_cast<Msg>(msg) == nullptr)
+                return false;
+
+            // Take the buffer. Later calls fill the spare and dispatch a new message.
+            std::vector<T> batch;
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                batch.swap(m_pending);
+                m_pending.swap(m_spare);
+                m_queued = false;
+            }
+
+            for (size_t i = 0; i < batch.size(); i += m_maxBatch)
+                (*m_target)(batch_span<T>(batch.data() + i, std::min(m_maxBatch, batch.size() - i)));
+
+            // Keep the storage for the next batch
+            batch.clear();
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_spare.capacity() < batch.capacity())
+                m_spare.swap(batch);
+            return true;
+        }
+
+        /// @return `true` if the buffered arguments are due for dispatch. Called with
+        /// `m_lock` held.
+        bool IsDue() const {
+            return m_pending.size() >= m_maxBatch || m_maxDelay.count() <= 0 ||
+                std::chrono::steady_clock::now() - m_first >= m_maxDelay;
+        }
+
+        const std::unique_ptr<TargetType> m_target;
+        DelegateThread* const m_thread;
+        const size_t m_maxBatch;
+        const std::chrono::nanoseconds m_maxDelay;
+
+        std::mutex m_lock;
+
+        /// The arguments of the next batch and the storage reused for the batch after
+        std::vector<T> m_pending;
+        std::vector<T> m_spare;
+
+        /// The time the first argument of `m_pending` was buffered
+        std::chrono::steady_clock::time_point m_first;
+
+        /// `true` while a message is queued and not yet invoked
+        bool m_queued = false;
+    };
+
+    /// Send a message taking the buffered arguments
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void Dispatch() {
+        auto msg = std::allocate_shared<Msg>(pool_allocator<Msg>(), m_state);
+        if (!msg) {
+            std::lock_guard<std::mutex> lock(m_state->m_lock);
+            m_state->m_queued = false;
+            BAD_ALLOC();
+        }
+        m_state->m_thread->DispatchDelegate(msg);
+    }
+
+    /// The shared state, or nullptr if empty.
+    std::shared_ptr<State> m_state;
+};
+
+/// @brief Creates an asynchronous delegate that invokes the target once per batch of
+/// call arguments.
+/// @tparam T The argument type of each call.
+/// @param[in] target The synchronous delegate to invoke on `thread`, e.g. from `MakeDelegate()`.
+/// @param[in] thread The `DelegateThread` on which the target will be invoked asynchronously.
+/// @param[in] maxBatch The most arguments passed to the target per call.
+/// @param[in] maxDelay The longest an argument is buffered before a call dispatches.
+/// @return A `DelegateAsyncBatch` object bound to the specified target and thread.
+template <class T>
+auto MakeDelegateBatch(const Delegate<void(batch_span<T>)>& target, DelegateThread& thread,
+    size_t maxBatch = DelegateAsyncBatch<void(batch_span<T>)>::DEFAULT_MAX_BATCH,
+    std::chrono::nanoseconds maxDelay = std::chrono::nanoseconds(0)) {
+    return DelegateAsyncBatch<void(batch_span<T>)>(target, thread, maxBatch, maxDelay);
+}
+
+}
+
+#endif
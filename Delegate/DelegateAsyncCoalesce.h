@@ -0,0 +1,259 @@
+#ifndef _DELEGATE_ASYNC_COALESCE_H
+#define _DELEGATE_ASYNC_COALESCE_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Asynchronous delegate that coalesces calls made while a previous call is
+/// still queued.
+///
+/// @details `DelegateAsyncCoalesce<>` invokes a target delegate on a destination thread
+/// like `DelegateAsync<>`, except that at most one message per delegate waits in the
+/// destination thread queue. A call made while the previous message is still queued
+/// replaces the arguments of that message in place rather than dispatching another, so
+/// the target function is invoked once with the latest arguments. Use it for periodic
+/// status or progress notifications where only the latest value matters.
+///
+/// A copy of the delegate, such as the copy stored by a multicast container, shares the
+/// pending message of the delegate it was copied from. Once the destination thread starts
+/// invoking the message, the next call dispatches a new message.
+///
+/// Arguments are copied as with `DelegateAsync<>`. See `inline_args<>`.
+///
+/// Code example:
+///
+/// `auto status = MakeDelegateCoalesce(MakeDelegate(&ui, &UI::OnStatus), uiThread);`
+/// `for (int i = 0; i < 1000; i++)`
+/// `    status(i);      // OnStatus() called at least once, last with 999`
+
+#include "Delegate.h"
+#include "DelegateThread.h"
+#include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include "make_tuple_inline.h"
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace DelegateLib {
+
+template <class R>
+class DelegateAsyncCoalesce; // Not defined
+
+/// @brief Asynchronously invokes a target delegate, coalescing calls made while a
+/// previous call is queued.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class RetType, class... Args>
+class DelegateAsyncCoalesce<RetType(Args...)> : public Delegate<RetType(Args...)> {
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+    using ClassType = DelegateAsyncCoalesce<RetType(Args...)>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] target The synchronous delegate to invoke on `thread`. Copied.
+    /// @param[in] thread The execution thread to invoke `target`.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    DelegateAsyncCoalesce(const DelegateType& target, DelegateThread& thread) { Bind(target, thread); }
+
+    /// @brief Copy constructor. The copy shares the pending message of `rhs`.
+    /// @param[in] rhs The object to copy from.
+    DelegateAsyncCoalesce(const ClassType& rhs) = default;
+
+    /// @brief Copy assignment. The object shares the pending message of `rhs`.
+    /// @param[in] rhs The object to copy from.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) = default;
+
+    DelegateAsyncCoalesce() = default;
+
+    /// @brief Bind a target delegate.
+    /// @param[in] target The synchronous delegate to invoke on `thread`. Copied.
+    /// @param[in] thread The execution thread to invoke `target`.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void Bind(const DelegateType& target, DelegateThread& thread) {
+        m_state = nullptr;
+        if (target == nullptr)
+            return;
+
+        std::unique_ptr<DelegateType> targetClone(target.Clone());
+        if (!targetClone)
+            BAD_ALLOC();
+        m_state = std::allocate_shared<State>(pool_allocator<State>(), std::move(targetClone), thread);
+        if (!m_state)
+            BAD_ALLOC();
+    }
+
+    /// @brief Creates a copy of the current object sharing its pending message.
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Invoke the target asynchronously, or replace the arguments of the call
+    /// still queued. Called by the source thread. Always safe to call.
+    /// @param[in] args The function arguments, if any.
+    /// @return A default return value. The return value is *not* returned from the
+    /// target function. Do not use the return value.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual RetType operator()(Args... args) override {
+        if (Empty())
+            return RetType();
+
+        State& state = *m_state;
+        std::shared_ptr<Msg> msg;
+        {
+            std::lock_guard<std::mutex> lock(state.m_lock);
+            msg = state.m_pending.lock();
+            if (msg) {
+                // Still queued. Replace its arguments.
+                msg->m_args.reset();
+                msg->m_args.emplace(std::forward<Args>(args)...);
+                return RetType();
+            }
+
+            msg = std::allocate_shared<Msg>(pool_allocator<Msg>(), m_state, std::forward<Args>(args)...);
+            if (!msg)
+                BAD_ALLOC();
+            state.m_pending = msg;
+        }
+        state.m_thread->DispatchDelegate(msg);
+        return RetType();
+    }
+
+    /// @brief Invoke the target asynchronously. Called by the source thread.
+    /// @param[in] args The function arguments, if any.
+    void AsyncInvoke(Args... args) {
+        operator()(std::forward<Args>(args)...);
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept { Clear(); }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
+    /// @brief Compares two delegate objects for equality. Equal if bound to equal
+    /// targets and the same thread.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        if (!derivedRhs)
+            return false;
+        if (!m_state || !derivedRhs->m_state)
+            return !m_state && !derivedRhs->m_state;
+        return m_state == derivedRhs->m_state ||
+            (m_state->m_thread == derivedRhs->m_state->m_thread &&
+             m_state->m_target->Equal(*derivedRhs->m_state->m_target));
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override { return Empty(); }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override { return !Empty(); }
+
+    /// @brief Check if the delegate is bound to a target function.
+    /// @return `true` if the delegate has a target function, `false` otherwise.
+    bool Empty() const noexcept { return !m_state; }
+
+    /// @brief Clear the target function.
+    /// @post The delegate is empty. A queued call still invokes the target.
+    void Clear() noexcept { m_state = nullptr; }
+
+    /// @brief Implicit conversion operator to `bool`.
+    /// @return `true` if the object is not empty, `false` if the object is empty.
+    explicit operator bool() const noexcept { return !Empty(); }
+
+private:
+    class State;
+
+    /// The queued message. Its arguments are replaced while it is pending.
+    class Msg : public DelegateMsg
+    {
+    public:
+        Msg(std::shared_ptr<IDelegateInvoker> invoker, Args... args) :
+            DelegateMsg(invoker, type_id<Msg>()) {
+            m_args.emplace(std::forward<Args>(args)...);
+        }
+
+        /// The latest arguments. Written by the source thread under `State::m_lock`
+        /// while the message is pending.
+        std::optional<inline_args<Args...>> m_args;
+    };
+
+    /// The target and pending message shared by a delegate and its copies.
+    class State : public IDelegateInvoker
+    {
+    public:
+        State(std::unique_ptr<DelegateType> target, DelegateThread& thread) :
+            m_target(std::move(target)), m_thread(&thread) { }
+
+        /// @brief Invoke the target with the latest arguments of a message. Called by
+        /// the destination thread.
+        /// @param[in] msg The message dispatched within `operator()`.
+        /// @return `true` if the target function invoked.
+        virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+            auto coalesceMsg = delegate_msg_cast<Msg>(msg);
+            if (coalesceMsg == nullptr)
+                return false;
+
+            // The message is no longer pending. Later calls dispatch a new message.
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (m_pending.lock().get() == coalesceMsg)
+                    m_pending.reset();
+            }
+
+            std::apply([this](auto&&... args) { (*m_target)(std::forward<decltype(args)>(args)...); },
+                coalesceMsg->m_args->get());
+            return true;
+        }
+
+        const std::unique_ptr<DelegateType> m_target;
+        DelegateThread* const m_thread;
+        std::mutex m_lock;
+        std::weak_ptr<Msg> m_pending;
+    };
+
+    /// The shared state, or nullptr if empty.
+    std::shared_ptr<State> m_state;
+};
+
+/// @brief Creates an asynchronous delegate that coalesces calls made while a previous
+/// call is still queued.
+/// @tparam RetType The return type of the target.
+/// @tparam Args The types of the function arguments.
+/// @param[in] target The synchronous delegate to invoke on `thread`, e.g. from `MakeDelegate()`.
+/// @param[in] thread The `DelegateThread` on which the target will be invoked asynchronously.
+/// @return A `DelegateAsyncCoalesce` object bound to the specified target and thread.
+template <class RetType, class... Args>
+auto MakeDelegateCoalesce(const Delegate<RetType(Args...)>& target, DelegateThread& thread) {
+    return DelegateAsyncCoalesce<RetType(Args...)>(target, thread);
+}
+
+}
+
+#endif
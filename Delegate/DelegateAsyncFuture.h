@@ -0,0 +1,1353 @@
+#ifndef _DELEGATE_ASYNC_FUTURE_H
+#define _DELEGATE_ASYNC_FUTURE_H
+
+// DelegateAsyncFuture.h
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Delegate "`AsyncFuture`" series of classes used to invoke a function asynchronously
+/// and obtain the return value later through a `DelegateFuture<>`. 
+/// 
+/// @details The classes are not thread safe. Invoking a function asynchronously sends a 
+/// message to the destination thread message queue. Each message refers to an invoker, a 
+/// synchronous clone of the delegate created when the target is bound and shared by every
+/// call and copy of the delegate. The destination thread calls `Invoke()` to invoke the 
+/// target function.
+/// 
+/// `DelegateFuture<RetType> AsyncInvoke(Args... args)` - called by the source thread to initiate
+/// the async function call. Returns at once with a future the destination thread completes once
+/// the target function returns. Unlike `DelegateAsyncWait`, the source thread is not blocked so 
+/// many calls may be in flight at once. May throw `std::bad_alloc` if dynamic storage allocation 
+/// fails and USE_ASSERTS is not defined. All other delegate class functions do not throw exceptions.
+///
+/// `RetType operator()(Args... args)` - same as `AsyncInvoke()` but the future is discarded,
+/// matching `DelegateAsync`.
+///
+/// `void Invoke(std::shared_ptr<DelegateMsg> msg)` - called by the destination
+/// thread to invoke the target function. The destination thread must not call any other
+/// delegate instance functions.
+/// 
+/// Limitations:
+/// 
+/// * A future is never completed if the destination thread discards the message, e.g. 
+/// `ExitThread()` with a drop mode or a message past its deadline. Use `DelegateFuture::Wait()` with a timeout if the destination 
+/// thread may exit first.
+/// 
+/// * Cannot use a `void*` as a target function argument.
+/// 
+/// * Cannot return a reference. Move-only return values such as `std::unique_ptr` are allowed.
+/// 
+/// * A by value or rvalue reference (T&&) argument passed as an rvalue is moved into 
+/// the message instead of copied. Move-only types such as `std::unique_ptr` may be passed 
+/// this way. The caller must not use a moved from argument after the call.
+/// 
+/// * Cannot insert `DelegateMemberAsyncFuture` into an ordered container. e.g. `std::list` ok, 
+/// `std::set` not ok.
+/// 
+/// * `std::function` compares the function signature type, not the underlying object instance.
+/// See `DelegateFunction<>` class for more info.
+/// 
+/// Code within `<common_code>` and `</common_code>` is updated using sync_src.py. Manually update 
+/// the code within the `DelegateFreeAsyncFuture` `common_code` tags, then run the script to 
+/// propagate to the remaining delegate classes to simplify code maintenance.
+/// 
+/// `python src_dup.py DelegateAsyncFuture.h`
+
+#include "Delegate.h"
+#include "DelegateThread.h"
+#include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include "DelegateAsyncWait.h"
+#include "make_tuple_inline.h"
+#include <tuple>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <optional>
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#endif
+
+namespace DelegateLib {
+
+/// @brief The return value of an asynchronous call, shared by a `DelegateFuture<>` and 
+/// the message it waits on. Completed once by the destination thread.
+/// @tparam RetType The return type of the bound delegate function.
+template <class RetType>
+class DelegateFutureState
+{
+public:
+    static_assert(!std::is_reference<RetType>::value, "Reference return value not allowed");
+
+    DelegateFutureState() = default;
+
+    /// Store the return value and wake the waiters. Called once by the destination thread.
+    /// @param[in] value The target function return value, if any.
+    template <class... Value>
+    void SetValue(Value&&... value) {
+        std::function<void()> continuation;
+        {
+            std::lock_guard<std::mutex> lk(m_lock);
+            m_value.emplace(std::forward<Value>(value)...);
+            m_ready.store(true, std::memory_order_release);
+            continuation = std::move(m_continuation);
+        }
+        m_cv.notify_all();
+
+        // Run outside the lock since the continuation may resume a coroutine
+        if (continuation)
+            continuation();
+    }
+
+    /// @return `true` if the return value is stored.
+    bool IsReady() const noexcept { return m_ready.load(std::memory_order_acquire); }
+
+    /// Wait for the return value
+    /// @param[in] timeout - the longest time to wait, or `WAIT_INFINITE`
+    /// @return `true` if the return value is stored, `false` on timeout.
+    bool Wait(std::chrono::nanoseconds timeout) {
+        if (IsReady())
+            return true;
+        auto ready = [this]() { return IsReady(); };
+        if (timeout == WAIT_INFINITE) {
+            std::unique_lock<std::mutex> lk(m_lock);
+            m_cv.wait(lk, ready);
+            return true;
+        }
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+        std::unique_lock<std::mutex> lk(m_lock);
+        return m_cv.wait_until(lk, deadline, ready);
+    }
+
+    /// Get the return value. By value so call once.
+    /// @pre `IsReady()` returns `true`.
+    RetType Get() {
+        if constexpr (std::is_void<RetType>::value == false)
+            return std::move(*m_value);
+    }
+
+    /// Store a callback run by the destination thread once the return value is stored
+    /// @param[in] continuation - the callback
+    /// @return `true` if stored. `false` if the return value is already stored and 
+    ///     the callback was not stored.
+    bool SetContinuation(std::function<void()> continuation) {
+        std::lock_guard<std::mutex> lk(m_lock);
+        if (IsReady())
+            return false;
+        m_continuation = std::move(continuation);
+        return true;
+    }
+
+private:
+    // Prevent copying objects
+    DelegateFutureState(const DelegateFutureState&) = delete;
+    DelegateFutureState& operator=(const DelegateFutureState&) = delete;
+
+    using ValueType = std::conditional_t<std::is_void<RetType>::value, bool, RetType>;
+
+    std::atomic<bool> m_ready{ false };
+    std::optional<ValueType> m_value;
+    std::function<void()> m_continuation;
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+};
+
+/// @brief A handle to the pending return value of an asynchronous call. Cheap to copy; 
+/// copies refer to the same return value.
+/// @details Block with `Wait()` or `Get()`, poll with `IsReady()`, or register a 
+/// callback with `Then()`. Under C++20 a `DelegateFuture<>` may be `co_await`ed; the
+/// coroutine resumes on the destination thread once the target function returns.
+/// @tparam RetType The return type of the bound delegate function.
+template <class RetType>
+class DelegateFuture
+{
+public:
+    DelegateFuture() = default;
+
+    /// Constructor
+    /// @param[in] state - the return value state completed by the destination thread
+    explicit DelegateFuture(std::shared_ptr<DelegateFutureState<RetType>> state) : 
+        m_state(std::move(state)) { }
+
+    /// @return `true` if the future refers to an asynchronous call.
+    bool IsValid() const noexcept { return m_state != nullptr; }
+
+    /// @return `true` if the target function has returned.
+    bool IsReady() const noexcept { return m_state && m_state->IsReady(); }
+
+    /// Wait for the target function to return
+    /// @param[in] timeout - the longest time to wait, or `WAIT_INFINITE`
+    /// @return `true` if the target function returned, `false` on timeout or if not valid.
+    bool Wait(std::chrono::nanoseconds timeout = WAIT_INFINITE) const {
+        return m_state && m_state->Wait(timeout);
+    }
+
+    /// Wait for the target function to return and get the return value. By value 
+    /// so call once.
+    /// @return The target function return value, or a default value if not valid.
+    RetType Get() {
+        if (!m_state)
+            return RetType();
+        m_state->Wait(WAIT_INFINITE);
+        return m_state->Get();
+    }
+
+    /// Invoke a callback once the target function returns. The callback runs on the 
+    /// destination thread, or at once on the calling thread if already returned. One
+    /// callback per asynchronous call.
+    /// @param[in] callback - the callback. Must not block the destination thread.
+    void Then(std::function<void()> callback) {
+        if (m_state && !m_state->SetContinuation(callback))
+            callback();
+    }
+
+#if defined(__cpp_impl_coroutine)
+    bool await_ready() const noexcept { return !m_state || m_state->IsReady(); }
+    bool await_suspend(std::coroutine_handle<> handle) {
+        return m_state->SetContinuation([handle]() { handle.resume(); });
+    }
+    RetType await_resume() { return Get(); }
+#endif
+
+private:
+    std::shared_ptr<DelegateFutureState<RetType>> m_state;
+};
+
+/// @brief Stores all function arguments and the return value state of a non-blocking 
+/// asynchronous call. Argument data is copied inline within the message.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class RetType, class...Args>
+class DelegateAsyncFutureMsg : public DelegateMsg
+{
+public:
+    /// Constructor
+    /// @param[in] invoker - the invoker instance
+    /// @param[in] args - a parameter pack of all target function arguments
+    DelegateAsyncFutureMsg(std::shared_ptr<IDelegateInvoker> invoker, Args... args) : 
+        DelegateMsg(invoker, type_id<DelegateAsyncFutureMsg>()), m_args(std::forward<Args>(args)...) { }
+
+    virtual ~DelegateAsyncFutureMsg() = default;
+
+    /// Get all function arguments that were copied into the message. By value 
+    /// arguments are moved out, so call once.
+    /// @return A tuple of all function arguments
+    std::tuple<Args...> GetArgs() { return m_args.get(); }
+
+    /// Get the return value state completed by the destination thread
+    DelegateFutureState<RetType>& GetState() { return m_state; }
+
+private:
+    /// A copy of each argument stored within the message
+    inline_args<Args...> m_args;
+
+    /// The return value state. Futures share ownership of the message to hold it.
+    DelegateFutureState<RetType> m_state;
+};
+
+
+template <class R>
+struct DelegateFreeAsyncFuture; // Not defined
+
+/// @brief `DelegateFreeAsyncFuture<>` class asynchronously invokes a free target function and 
+/// returns a future for the return value.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class RetType, class... Args>
+class DelegateFreeAsyncFuture<RetType(Args...)> : public DelegateFree<RetType(Args...)>, public IDelegateInvoker {
+public:
+    typedef RetType(*FreeFunc)(Args...);
+    using ClassType = DelegateFreeAsyncFuture<RetType(Args...)>;
+    using BaseType = DelegateFree<RetType(Args...)>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] func The target free function to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateFreeAsyncFuture(FreeFunc func, DelegateThread& thread) :
+        BaseType(func), m_thread(&thread) { 
+        Bind(func, thread); 
+    }
+
+    /// @brief Copy constructor that creates a copy of the given instance.
+    /// @details This constructor initializes a new object as a copy of the 
+    /// provided `rhs` (right-hand side) object. The `rhs` object is used to 
+    /// set the state of the new instance.
+    /// @param[in] rhs The object to copy from.
+    DelegateFreeAsyncFuture(const ClassType& rhs) :
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        Assign(rhs);
+    }
+
+    /// @brief Move constructor that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    DelegateFreeAsyncFuture(ClassType&& rhs) noexcept : 
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        m_invoker = rhs.m_invoker;
+        rhs.Clear();
+    }
+
+    DelegateFreeAsyncFuture() = default;
+
+    /// @brief Bind a free function to the delegate.
+    /// @details This method associates a free function (`func`) with the delegate. 
+    /// Once the function is bound, the delegate can be used to invoke the function.
+    /// @param[in] func The free function to bind to the delegate. This function must 
+    /// match the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(FreeFunc func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(func);
+        BindInvoker();
+    }
+
+    // <common_code>
+
+    /// @brief Assigns the state of one object to another.
+    /// @details Copy the state from the `rhs` (right-hand side) object to the
+    /// current object.
+    /// @param[in] rhs The object whose state is to be copied.
+    void Assign(const ClassType& rhs) {
+        m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
+        BaseType::Assign(rhs);
+    }
+    /// @brief Creates a copy of the current object.
+    /// @details Clones the current instance of the class by creating a new object
+    /// and copying the state of the current object to it. 
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Assignment operator that assigns the state of one object to another.
+    /// @param[in] rhs The object whose state is to be assigned to the current object.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) {
+        if (&rhs != this) {
+            BaseType::operator=(rhs);
+            Assign(rhs);
+        }
+        return *this;
+    }
+
+    /// @brief Move assignment operator that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    /// @return A reference to the current object.
+    ClassType& operator=(ClassType&& rhs) noexcept {
+        if (&rhs != this) {
+            BaseType::operator=(std::move(rhs));
+            m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
+        }
+        return *this;
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept override {
+        return this->Clear();
+    }
+
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
+    /// @brief Compares two delegate objects for equality.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        return derivedRhs &&
+            m_thread == derivedRhs->m_thread &&
+            BaseType::Equal(rhs);
+    }
+
+    /// Compares two delegate objects for equality.
+    /// @return `true` if the objects are equal, `false` otherwise.
+    bool operator==(const ClassType& rhs) const noexcept { return Equal(rhs); }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override {
+        return this->Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override {
+        return !this->Empty();
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    friend bool operator==(std::nullptr_t, const ClassType& rhs) noexcept {
+        return rhs.Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    friend bool operator!=(std::nullptr_t, const ClassType& rhs) noexcept {
+        return !rhs.Empty();
+    }
+
+    /// @brief Invoke the bound delegate function asynchronously. Called by the source thread.
+    /// @details Same as `AsyncInvoke()` but the future is discarded. Always safe to call.
+    /// @param[in] args The function arguments, if any.
+    /// @return A default return value. The return value is *not* returned from the 
+    /// target function. Use `AsyncInvoke()` to obtain the return value.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual RetType operator()(Args... args) override {
+        // Synchronously invoke the target function?
+        if (m_sync)
+            return BaseType::operator()(std::forward<Args>(args)...);
+
+        AsyncInvoke(std::forward<Args>(args)...);
+        return RetType();
+    }
+
+    /// @brief Invoke the bound delegate function asynchronously and return a future for 
+    /// the return value. Called by the source thread.
+    /// @details Dispatches the delegate data into the destination thread message queue and 
+    /// returns at once. `Invoke()` must be called by the destination thread to invoke the 
+    /// target function and complete the future. Always safe to call.
+    /// 
+    /// The `DelegateAsyncFutureMsg` duplicates and copies the function arguments into the 
+    /// message, as `DelegateAsync` does, and holds the return value. The future shares ownership
+    /// of the message so no further allocation is required. The message is allocated 
+    /// from `pool_allocator` and refers to the invoker created at bind time, so steady-state calls 
+    /// do not use the heap.
+    /// @param[in] args The function arguments, if any.
+    /// @return A future for the target function return value. Not valid if the delegate 
+    /// is empty.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    DelegateFuture<RetType> AsyncInvoke(Args... args) {
+        if (this->Empty())
+            return DelegateFuture<RetType>();
+
+        // Synchronously invoke the target function?
+        if (m_sync) {
+            // Invoke the target function directly and return a completed future
+            auto state = std::make_shared<DelegateFutureState<RetType>>();
+            if constexpr (std::is_void<RetType>::value == true) {
+                BaseType::operator()(std::forward<Args>(args)...);
+                state->SetValue();
+            } else {
+                state->SetValue(BaseType::operator()(std::forward<Args>(args)...));
+            }
+            return DelegateFuture<RetType>(state);
+        } else {
+
+            // Create a new message instance for sending to the destination thread
+            auto msg = std::allocate_shared<DelegateAsyncFutureMsg<RetType, Args...>>(
+                pool_allocator<DelegateAsyncFutureMsg<RetType, Args...>>(), m_invoker, std::forward<Args>(args)...);
+            if (!msg)
+                BAD_ALLOC();
+
+            // The future shares ownership of the message holding the return value state
+            DelegateFuture<RetType> future(std::shared_ptr<DelegateFutureState<RetType>>(msg, &msg->GetState()));
+
+            auto thread = this->GetThread();
+            if (thread) {
+                // Dispatch message onto the callback destination thread. Invoke()
+                // will be called by the destintation thread. 
+                thread->DispatchDelegate(msg);
+            }
+            return future;
+
+            // Check if any argument is a shared_ptr with wrong usage
+            // std::shared_ptr reference arguments are not allowed with asynchronous delegates as the behavior is 
+            // undefined. In other words:
+            // void MyFunc(std::shared_ptr<T> data)		// Ok!
+            // void MyFunc(std::shared_ptr<T>& data)	// Error if DelegateAsyncFuture target!
+            static_assert(!(std::disjunction_v<is_shared_ptr<Args>...> &&
+                (std::disjunction_v<std::is_lvalue_reference<Args>, std::is_pointer<Args>> || ...)),
+                "std::shared_ptr reference argument not allowed");
+        }
+    }
+
+    /// @brief Invoke the delegate function on the destination thread. Called by the 
+    /// destintation thread.
+    /// @details Each source thread call to `AsyncInvoke()` generate a call to `Invoke()` 
+    /// on the destination thread. The target function return value is stored in the 
+    /// message, which completes the future and runs any continuation on this thread.
+    /// @param[in] msg The delegate message created and sent within `AsyncInvoke(Args... args)`.
+    /// @return `true` if target function invoked; `false` if error. 
+    virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+        // Typecast the base pointer to back correct derived to instance
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncFutureMsg<RetType, Args...>>(msg);
+        if (delegateMsg == nullptr)
+            return false;
+
+
+        // Invoke the target function using the source thread supplied function arguments
+        // and complete the future
+        if constexpr (std::is_void<RetType>::value == true) {
+            std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+            delegateMsg->GetState().SetValue();
+        } else {
+            delegateMsg->GetState().SetValue(
+                std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs())));
+        }
+        return true;
+    }
+
+    ///@brief Get the destination thread that the target function is invoked on.
+    // @return The target thread.
+    DelegateThread* GetThread() noexcept { return m_thread; }
+
+private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+        m_invoker = invoker;
+    }
+
+    /// The target thread to invoke the delegate function.
+    DelegateThread* m_thread = nullptr;   
+
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
+    /// Flag to control synchronous vs asynchronous target invoke behavior.
+    bool m_sync = false;        
+
+    // </common_code>
+};
+
+template <class C, class R>
+struct DelegateMemberAsyncFuture; // Not defined
+
+/// @brief `DelegateMemberAsyncFuture<>` class asynchronously invokes a class member target function and 
+/// returns a future for the return value.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class TClass, class RetType, class... Args>
+class DelegateMemberAsyncFuture<TClass, RetType(Args...)> : public DelegateMember<TClass, RetType(Args...)>, public IDelegateInvoker {
+public:
+    typedef TClass* ObjectPtr;
+    typedef std::shared_ptr<TClass> SharedPtr;
+    typedef RetType(TClass::* MemberFunc)(Args...);
+    typedef RetType(TClass::* ConstMemberFunc)(Args...) const;
+    using ClassType = DelegateMemberAsyncFuture<TClass, RetType(Args...)>;
+    using BaseType = DelegateMember<TClass, RetType(Args...)>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object pointer to store.
+    /// @param[in] func The target member function to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateMemberAsyncFuture(SharedPtr object, MemberFunc func, DelegateThread& thread) : BaseType(object, func), m_thread(&thread) {
+        Bind(object, func, thread);
+    }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object pointer to store.
+    /// @param[in] func The target const member function to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateMemberAsyncFuture(SharedPtr object, ConstMemberFunc func, DelegateThread& thread) : BaseType(object, func), m_thread(&thread) {
+        Bind(object, func, thread);
+    }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object pointer to store.
+    /// @param[in] func The target member function to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateMemberAsyncFuture(ObjectPtr object, MemberFunc func, DelegateThread& thread) : BaseType(object, func), m_thread(&thread) {
+        Bind(object, func, thread);
+    }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target object pointer to store.
+    /// @param[in] func The target const member function to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateMemberAsyncFuture(ObjectPtr object, ConstMemberFunc func, DelegateThread& thread) : BaseType(object, func), m_thread(&thread) {
+        Bind(object, func, thread);
+    }
+
+    /// @brief Copy constructor that creates a copy of the given instance.
+    /// @details This constructor initializes a new object as a copy of the 
+    /// provided `rhs` (right-hand side) object. The `rhs` object is used to 
+    /// set the state of the new instance.
+    /// @param[in] rhs The object to copy from.
+    DelegateMemberAsyncFuture(const ClassType& rhs) :
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        Assign(rhs);
+    }
+
+    /// @brief Move constructor that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    DelegateMemberAsyncFuture(ClassType&& rhs) noexcept :
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        m_invoker = rhs.m_invoker;
+        rhs.Clear();
+    }
+
+    DelegateMemberAsyncFuture() = default;
+
+    /// @brief Bind a const member function to the delegate.
+    /// @details This method associates a member function (`func`) with the delegate. 
+    /// Once the function is bound, the delegate can be used to invoke the function.
+    /// @param[in] object The target object instance.
+    /// @param[in] func The function to bind to the delegate. This function must match 
+    /// the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(SharedPtr object, MemberFunc func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(object, func);
+        BindInvoker();
+    }
+
+    /// @brief Bind a member function to the delegate.
+    /// @details This method associates a member function (`func`) with the delegate. 
+    /// Once the function is bound, the delegate can be used to invoke the function.
+    /// @param[in] object The target object instance.
+    /// @param[in] func The member function to bind to the delegate. This function must 
+    /// match the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(SharedPtr object, ConstMemberFunc func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(object, func);
+        BindInvoker();
+    }
+
+    /// @brief Bind a const member function to the delegate.
+    /// @details This method associates a member function (`func`) with the delegate. 
+    /// Once the function is bound, the delegate can be used to invoke the function.
+    /// @param[in] object The target object instance.
+    /// @param[in] func The function to bind to the delegate. This function must match 
+    /// the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(ObjectPtr object, MemberFunc func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(object, func);
+        BindInvoker();
+    }
+
+    /// @brief Bind a member function to the delegate.
+    /// @details This method associates a member function (`func`) with the delegate. 
+    /// Once the function is bound, the delegate can be used to invoke the function.
+    /// @param[in] object The target object instance.
+    /// @param[in] func The member function to bind to the delegate. This function must 
+    /// match the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(ObjectPtr object, ConstMemberFunc func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(object, func);
+        BindInvoker();
+    }
+
+    // <common_code>
+
+    /// @brief Assigns the state of one object to another.
+    /// @details Copy the state from the `rhs` (right-hand side) object to the
+    /// current object.
+    /// @param[in] rhs The object whose state is to be copied.
+    void Assign(const ClassType& rhs) {
+        m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
+        BaseType::Assign(rhs);
+    }
+    /// @brief Creates a copy of the current object.
+    /// @details Clones the current instance of the class by creating a new object
+    /// and copying the state of the current object to it. 
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Assignment operator that assigns the state of one object to another.
+    /// @param[in] rhs The object whose state is to be assigned to the current object.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) {
+        if (&rhs != this) {
+            BaseType::operator=(rhs);
+            Assign(rhs);
+        }
+        return *this;
+    }
+
+    /// @brief Move assignment operator that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    /// @return A reference to the current object.
+    ClassType& operator=(ClassType&& rhs) noexcept {
+        if (&rhs != this) {
+            BaseType::operator=(std::move(rhs));
+            m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
+        }
+        return *this;
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept override {
+        return this->Clear();
+    }
+
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
+    /// @brief Compares two delegate objects for equality.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        return derivedRhs &&
+            m_thread == derivedRhs->m_thread &&
+            BaseType::Equal(rhs);
+    }
+
+    /// Compares two delegate objects for equality.
+    /// @return `true` if the objects are equal, `false` otherwise.
+    bool operator==(const ClassType& rhs) const noexcept { return Equal(rhs); }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override {
+        return this->Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override {
+        return !this->Empty();
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    friend bool operator==(std::nullptr_t, const ClassType& rhs) noexcept {
+        return rhs.Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    friend bool operator!=(std::nullptr_t, const ClassType& rhs) noexcept {
+        return !rhs.Empty();
+    }
+
+    /// @brief Invoke the bound delegate function asynchronously. Called by the source thread.
+    /// @details Same as `AsyncInvoke()` but the future is discarded. Always safe to call.
+    /// @param[in] args The function arguments, if any.
+    /// @return A default return value. The return value is *not* returned from the 
+    /// target function. Use `AsyncInvoke()` to obtain the return value.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual RetType operator()(Args... args) override {
+        // Synchronously invoke the target function?
+        if (m_sync)
+            return BaseType::operator()(std::forward<Args>(args)...);
+
+        AsyncInvoke(std::forward<Args>(args)...);
+        return RetType();
+    }
+
+    /// @brief Invoke the bound delegate function asynchronously and return a future for 
+    /// the return value. Called by the source thread.
+    /// @details Dispatches the delegate data into the destination thread message queue and 
+    /// returns at once. `Invoke()` must be called by the destination thread to invoke the 
+    /// target function and complete the future. Always safe to call.
+    /// 
+    /// The `DelegateAsyncFutureMsg` duplicates and copies the function arguments into the 
+    /// message, as `DelegateAsync` does, and holds the return value. The future shares ownership
+    /// of the message so no further allocation is required. The message is allocated 
+    /// from `pool_allocator` and refers to the invoker created at bind time, so steady-state calls 
+    /// do not use the heap.
+    /// @param[in] args The function arguments, if any.
+    /// @return A future for the target function return value. Not valid if the delegate 
+    /// is empty.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    DelegateFuture<RetType> AsyncInvoke(Args... args) {
+        if (this->Empty())
+            return DelegateFuture<RetType>();
+
+        // Synchronously invoke the target function?
+        if (m_sync) {
+            // Invoke the target function directly and return a completed future
+            auto state = std::make_shared<DelegateFutureState<RetType>>();
+            if constexpr (std::is_void<RetType>::value == true) {
+                BaseType::operator()(std::forward<Args>(args)...);
+                state->SetValue();
+            } else {
+                state->SetValue(BaseType::operator()(std::forward<Args>(args)...));
+            }
+            return DelegateFuture<RetType>(state);
+        } else {
+
+            // Create a new message instance for sending to the destination thread
+            auto msg = std::allocate_shared<DelegateAsyncFutureMsg<RetType, Args...>>(
+                pool_allocator<DelegateAsyncFutureMsg<RetType, Args...>>(), m_invoker, std::forward<Args>(args)...);
+            if (!msg)
+                BAD_ALLOC();
+
+            // The future shares ownership of the message holding the return value state
+            DelegateFuture<RetType> future(std::shared_ptr<DelegateFutureState<RetType>>(msg, &msg->GetState()));
+
+            auto thread = this->GetThread();
+            if (thread) {
+                // Dispatch message onto the callback destination thread. Invoke()
+                // will be called by the destintation thread. 
+                thread->DispatchDelegate(msg);
+            }
+            return future;
+
+            // Check if any argument is a shared_ptr with wrong usage
+            // std::shared_ptr reference arguments are not allowed with asynchronous delegates as the behavior is 
+            // undefined. In other words:
+            // void MyFunc(std::shared_ptr<T> data)		// Ok!
+            // void MyFunc(std::shared_ptr<T>& data)	// Error if DelegateAsyncFuture target!
+            static_assert(!(std::disjunction_v<is_shared_ptr<Args>...> &&
+                (std::disjunction_v<std::is_lvalue_reference<Args>, std::is_pointer<Args>> || ...)),
+                "std::shared_ptr reference argument not allowed");
+        }
+    }
+
+    /// @brief Invoke the delegate function on the destination thread. Called by the 
+    /// destintation thread.
+    /// @details Each source thread call to `AsyncInvoke()` generate a call to `Invoke()` 
+    /// on the destination thread. The target function return value is stored in the 
+    /// message, which completes the future and runs any continuation on this thread.
+    /// @param[in] msg The delegate message created and sent within `AsyncInvoke(Args... args)`.
+    /// @return `true` if target function invoked; `false` if error. 
+    virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+        // Typecast the base pointer to back correct derived to instance
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncFutureMsg<RetType, Args...>>(msg);
+        if (delegateMsg == nullptr)
+            return false;
+
+
+        // Invoke the target function using the source thread supplied function arguments
+        // and complete the future
+        if constexpr (std::is_void<RetType>::value == true) {
+            std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+            delegateMsg->GetState().SetValue();
+        } else {
+            delegateMsg->GetState().SetValue(
+                std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs())));
+        }
+        return true;
+    }
+
+    ///@brief Get the destination thread that the target function is invoked on.
+    // @return The target thread.
+    DelegateThread* GetThread() noexcept { return m_thread; }
+
+private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+        m_invoker = invoker;
+    }
+
+    /// The target thread to invoke the delegate function.
+    DelegateThread* m_thread = nullptr;   
+
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
+    /// Flag to control synchronous vs asynchronous target invoke behavior.
+    bool m_sync = false;        
+
+    // </common_code>
+};
+
+template <class R>
+struct DelegateFunctionAsyncFuture; // Not defined
+
+/// @brief `DelegateFunctionAsyncFuture<>` class asynchronously invokes a `std::function` target function and 
+/// returns a future for the return value.
+/// @details Caution when binding to a `std::function` using this class. `std::function` cannot be 
+/// compared for equality directly in a meaningful way using `operator==`. Therefore, the delegate
+/// library used 
+/// 
+/// See `DelegateFunction<>` base class for important usage limitations.
+/// 
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class RetType, class... Args>
+class DelegateFunctionAsyncFuture<RetType(Args...)> : public DelegateFunction<RetType(Args...)>, public IDelegateInvoker {
+public:
+    using FunctionType = std::function<RetType(Args...)>;
+    using ClassType = DelegateFunctionAsyncFuture<RetType(Args...)>;
+    using BaseType = DelegateFunction<RetType(Args...)>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] func The target `std::function` to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    DelegateFunctionAsyncFuture(FunctionType func, DelegateThread& thread) :
+        m_thread(&thread) {
+        Bind(std::move(func), thread);
+    }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] func The target callable, such as a lambda, to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    DelegateFunctionAsyncFuture(F&& func, DelegateThread& thread) :
+        m_thread(&thread) {
+        Bind(std::forward<F>(func), thread);
+    }
+
+    /// @brief Copy constructor that creates a copy of the given instance.
+    /// @details This constructor initializes a new object as a copy of the 
+    /// provided `rhs` (right-hand side) object. The `rhs` object is used to 
+    /// set the state of the new instance.
+    /// @param[in] rhs The object to copy from.
+    DelegateFunctionAsyncFuture(const ClassType& rhs) :
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        Assign(rhs);
+    }
+
+    /// @brief Move constructor that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    DelegateFunctionAsyncFuture(ClassType&& rhs) noexcept :
+        BaseType(rhs), m_thread(rhs.m_thread) {
+        m_invoker = rhs.m_invoker;
+        rhs.Clear();
+    }
+
+    DelegateFunctionAsyncFuture() = default;
+
+    /// @brief Bind a `std::function` to the delegate.
+    /// @details This method associates a member function (`func`) with the delegate. 
+    /// Once the function is bound, the delegate can be used to invoke the function.
+    /// @param[in] func The `std::function` to bind to the delegate. This function must match 
+    /// the signature of the delegate.
+    /// @param[in] thread The execution thread to invoke `func`.
+    void Bind(FunctionType func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(std::move(func));
+        BindInvoker();
+    }
+
+    /// @brief Bind a callable, such as a lambda, to the delegate.
+    /// @param[in] func The callable to bind to the delegate. Stored inline if it fits 
+    /// within `DELEGATE_FUNCTION_SIZE` bytes.
+    /// @param[in] thread The execution thread to invoke `func`.
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    void Bind(F&& func, DelegateThread& thread) {
+        m_thread = &thread;
+        BaseType::Bind(std::forward<F>(func));
+        BindInvoker();
+    }
+
+    // <common_code>
+
+    /// @brief Assigns the state of one object to another.
+    /// @details Copy the state from the `rhs` (right-hand side) object to the
+    /// current object.
+    /// @param[in] rhs The object whose state is to be copied.
+    void Assign(const ClassType& rhs) {
+        m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
+        BaseType::Assign(rhs);
+    }
+    /// @brief Creates a copy of the current object.
+    /// @details Clones the current instance of the class by creating a new object
+    /// and copying the state of the current object to it. 
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Assignment operator that assigns the state of one object to another.
+    /// @param[in] rhs The object whose state is to be assigned to the current object.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) {
+        if (&rhs != this) {
+            BaseType::operator=(rhs);
+            Assign(rhs);
+        }
+        return *this;
+    }
+
+    /// @brief Move assignment operator that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    /// @return A reference to the current object.
+    ClassType& operator=(ClassType&& rhs) noexcept {
+        if (&rhs != this) {
+            BaseType::operator=(std::move(rhs));
+            m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
+        }
+        return *this;
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept override {
+        return this->Clear();
+    }
+
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
+    /// @brief Compares two delegate objects for equality.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        return derivedRhs &&
+            m_thread == derivedRhs->m_thread &&
+            BaseType::Equal(rhs);
+    }
+
+    /// Compares two delegate objects for equality.
+    /// @return `true` if the objects are equal, `false` otherwise.
+    bool operator==(const ClassType& rhs) const noexcept { return Equal(rhs); }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override {
+        return this->Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override {
+        return !this->Empty();
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    friend bool operator==(std::nullptr_t, const ClassType& rhs) noexcept {
+        return rhs.Empty();
+    }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    friend bool operator!=(std::nullptr_t, const ClassType& rhs) noexcept {
+        return !rhs.Empty();
+    }
+
+    /// @brief Invoke the bound delegate function asynchronously. Called by the source thread.
+    /// @details Same as `AsyncInvoke()` but the future is discarded. Always safe to call.
+    /// @param[in] args The function arguments, if any.
+    /// @return A default return value. The return value is *not* returned from the 
+    /// target function. Use `AsyncInvoke()` to obtain the return value.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual RetType operator()(Args... args) override {
+        // Synchronously invoke the target function?
+        if (m_sync)
+            return BaseType::operator()(std::forward<Args>(args)...);
+
+        AsyncInvoke(std::forward<Args>(args)...);
+        return RetType();
+    }
+
+    /// @brief Invoke the bound delegate function asynchronously and return a future for 
+    /// the return value. Called by the source thread.
+    /// @details Dispatches the delegate data into the destination thread message queue and 
+    /// returns at once. `Invoke()` must be called by the destination thread to invoke the 
+    /// target function and complete the future. Always safe to call.
+    /// 
+    /// The `DelegateAsyncFutureMsg` duplicates and copies the function arguments into the 
+    /// message, as `DelegateAsync` does, and holds the return value. The future shares ownership
+    /// of the message so no further allocation is required. The message is allocated 
+    /// from `pool_allocator` and refers to the invoker created at bind time, so steady-state calls 
+    /// do not use the heap.
+    /// @param[in] args The function arguments, if any.
+    /// @return A future for the target function return value. Not valid if the delegate 
+    /// is empty.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    DelegateFuture<RetType> AsyncInvoke(Args... args) {
+        if (this->Empty())
+            return DelegateFuture<RetType>();
+
+        // Synchronously invoke the target function?
+        if (m_sync) {
+            // Invoke the target function directly and return a completed future
+            auto state = std::make_shared<DelegateFutureState<RetType>>();
+            if constexpr (std::is_void<RetType>::value == true) {
+                BaseType::operator()(std::forward<Args>(args)...);
+                state->SetValue();
+            } else {
+                state->SetValue(BaseType::operator()(std::forward<Args>(args)...));
+            }
+            return DelegateFuture<RetType>(state);
+        } else {
+
+            // Create a new message instance for sending to the destination thread
+            auto msg = std::allocate_shared<DelegateAsyncFutureMsg<RetType, Args...>>(
+                pool_allocator<DelegateAsyncFutureMsg<RetType, Args...>>(), m_invoker, std::forward<Args>(args)...);
+            if (!msg)
+                BAD_ALLOC();
+
+            // The future shares ownership of the message holding the return value state
+            DelegateFuture<RetType> future(std::shared_ptr<DelegateFutureState<RetType>>(msg, &msg->GetState()));
+
+            auto thread = this->GetThread();
+            if (thread) {
+                // Dispatch message onto the callback destination thread. Invoke()
+                // will be called by the destintation thread. 
+                thread->DispatchDelegate(msg);
+            }
+            return future;
+
+            // Check if any argument is a shared_ptr with wrong usage
+            // std::shared_ptr reference arguments are not allowed with asynchronous delegates as the behavior is 
+            // undefined. In other words:
+            // void MyFunc(std::shared_ptr<T> data)		// Ok!
+            // void MyFunc(std::shared_ptr<T>& data)	// Error if DelegateAsyncFuture target!
+            static_assert(!(std::disjunction_v<is_shared_ptr<Args>...> &&
+                (std::disjunction_v<std::is_lvalue_reference<Args>, std::is_pointer<Args>> || ...)),
+                "std::shared_ptr reference argument not allowed");
+        }
+    }
+
+    /// @brief Invoke the delegate function on the destination thread. Called by the 
+    /// destintation thread.
+    /// @details Each source thread call to `AsyncInvoke()` generate a call to `Invoke()` 
+    /// on the destination thread. The target function return value is stored in the 
+    /// message, which completes the future and runs any continuation on this thread.
+    /// @param[in] msg The delegate message created and sent within `AsyncInvoke(Args... args)`.
+    /// @return `true` if target function invoked; `false` if error. 
+    virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+        // Typecast the base pointer to back correct derived to instance
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncFutureMsg<RetType, Args...>>(msg);
+        if (delegateMsg == nullptr)
+            return false;
+
+
+        // Invoke the target function using the source thread supplied function arguments
+        // and complete the future
+        if constexpr (std::is_void<RetType>::value == true) {
+            std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+            delegateMsg->GetState().SetValue();
+        } else {
+            delegateMsg->GetState().SetValue(
+                std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs())));
+        }
+        return true;
+    }
+
+    ///@brief Get the destination thread that the target function is invoked on.
+    // @return The target thread.
+    DelegateThread* GetThread() noexcept { return m_thread; }
+
+private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+        m_invoker = invoker;
+    }
+
+    /// The target thread to invoke the delegate function.
+    DelegateThread* m_thread = nullptr;   
+
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
+    /// Flag to control synchronous vs asynchronous target invoke behavior.
+    bool m_sync = false;        
+
+    // </common_code>
+};
+
+/// @brief Creates an asynchronous future delegate that binds to a free function.
+/// @tparam RetType The return type of the free function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] func A pointer to the free function to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateFreeAsyncFuture` object bound to the specified free function and thread.
+template <class RetType, class... Args>
+auto MakeDelegateFuture(RetType(*func)(Args... args), DelegateThread& thread) {
+    return DelegateFreeAsyncFuture<RetType(Args...)>(func, thread);
+}
+
+/// @brief Creates an asynchronous future delegate that binds to a non-const member function.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A pointer to the instance of `TClass` that will be used for the delegate.
+/// @param[in] func A pointer to the non-const member function of `TClass` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateMemberAsyncFuture` object bound to the specified non-const member function and thread.
+template <class TClass, class RetType, class... Args>
+auto MakeDelegateFuture(TClass* object, RetType(TClass::* func)(Args... args), DelegateThread& thread) {
+    return DelegateMemberAsyncFuture<TClass, RetType(Args...)>(object, func, thread);
+}
+
+/// @brief Creates an asynchronous future delegate that binds to a const member function.
+/// @tparam TClass The class type that contains the const member function.
+/// @tparam RetType The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A pointer to the instance of `TClass` that will be used for the delegate.
+/// @param[in] func A pointer to the const member function of `TClass` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateMemberAsyncFuture` object bound to the specified const member function and thread.
+template <class TClass, class RetType, class... Args>
+auto MakeDelegateFuture(TClass* object, RetType(TClass::* func)(Args... args) const, DelegateThread& thread) {
+    return DelegateMemberAsyncFuture<TClass, RetType(Args...)>(object, func, thread);
+}
+
+/// @brief Creates an asynchronous future delegate that binds to a const member function.
+/// @tparam TClass The const class type that contains the const member function.
+/// @tparam RetType The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A pointer to the instance of `TClass` that will be used for the delegate.
+/// @param[in] func A pointer to the non-const member function of `TClass` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateMemberAsyncFuture` object bound to the specified non-const member function.
+template <class TClass, class RetType, class... Args>
+auto MakeDelegateFuture(const TClass* object, RetType(TClass::* func)(Args... args) const, DelegateThread& thread) {
+    return DelegateMemberAsyncFuture<const TClass, RetType(Args...)>(object, func, thread);
+}
+
+/// @brief Creates an asynchronous future delegate that binds to a non-const member function using a shared pointer.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A shared pointer to the instance of `TClass` that will be used for the delegate.
+/// @param[in] func A pointer to the non-const member function of `TClass` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateMemberAsyncFuture` shared pointer bound to the specified non-const member function and thread.
+template <class TClass, class RetVal, class... Args>
+auto MakeDelegateFuture(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args... args), DelegateThread& thread) {
+    return DelegateMemberAsyncFuture<TClass, RetVal(Args...)>(object, func, thread);
+}
+
+
+/// @brief Creates an asynchronous future delegate that binds to a const member function using a shared pointer.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetVal The return type of the member function.
+/// @tparam Args The types of the function arguments.
+/// @param[in] object A shared pointer to the instance of `TClass` that will be used for the delegate.
+/// @param[in] func A pointer to the const member function of `TClass` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateMemberAsyncFuture` shared pointer bound to the specified const member function and thread.
+template <class TClass, class RetVal, class... Args>
+auto MakeDelegateFuture(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args... args) const, DelegateThread& thread) {
+    return DelegateMemberAsyncFuture<TClass, RetVal(Args...)>(object, func, thread);
+}
+
+/// @brief Creates an asynchronous future delegate that binds to a `std::function`.
+/// @tparam RetType The return type of the `std::function`.
+/// @tparam Args The types of the function arguments.
+/// @param[in] func The `std::function` to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateFunctionAsyncFuture` object bound to the specified `std::function` and thread.
+template <class RetType, class... Args>
+auto MakeDelegateFuture(std::function<RetType(Args...)> func, DelegateThread& thread) {
+    return DelegateFunctionAsyncFuture<RetType(Args...)>(func, thread);
+}
+
+/// @brief Creates an asynchronous future delegate that binds to a lambda or other callable
+/// object with one non-template `operator()`. The callable is stored inline if it fits
+/// within `DELEGATE_FUNCTION_SIZE` bytes.
+/// @tparam F The callable type. The delegate signature is that of `F::operator()`.
+/// @param[in] func The callable to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @return A `DelegateFunctionAsyncFuture` object bound to the specified callable and thread.
+template <class F, class = std::enable_if_t<is_deducible_function_target<F>::value>>
+auto MakeDelegateFuture(F&& func, DelegateThread& thread) {
+    return DelegateFunctionAsyncFuture<typename callable_signature<std::decay_t<F>>::type>(std::forward<F>(func), thread);
+}
+
+}
+
+#endif
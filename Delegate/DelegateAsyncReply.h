@@ -0,0 +1,269 @@
+#ifndef _DELEGATE_ASYNC_REPLY_H
+#define _DELEGATE_ASYNC_REPLY_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Asynchronous delegate that replies with the target function return value
+/// through a continuation delegate.
+///
+/// @details `DelegateAsyncReply<>` invokes a target delegate on a destination thread
+/// like `DelegateAsync<>`, then passes the return value to a reply delegate. Bind the
+/// reply to the caller's thread with `MakeDelegate(..., thread)` and the return value
+/// is posted back to that thread: call, then reply to my thread. Unlike
+/// `DelegateAsyncWait<>`, no thread blocks and no semaphore is held while the call is
+/// outstanding, so any number of calls may be in flight at once.
+///
+/// Arguments are copied or moved into the message as with `DelegateAsync<>`. The
+/// return value is moved into the reply. A void target replies with no arguments once
+/// it returns. A message discarded by the destination thread, e.g. by
+/// `WorkerThread::ExitThread()` with a drop mode, is never replied to.
+///
+/// Code example:
+///
+/// `auto read = MakeDelegateReply(MakeDelegate(&store, &Store::Read), storeThread,`
+/// `    MakeDelegate(&client, &Client::OnRead, clientThread));`
+/// `read(key);      // Store::Read() on storeThread, then Client::OnRead() on clientThread`
+
+#include "Delegate.h"
+#include "DelegateThread.h"
+#include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include "make_tuple_inline.h"
+#include <memory>
+#include <type_traits>
+
+namespace DelegateLib {
+
+/// @brief The reply delegate type of a target function return type
+/// @tparam RetType The return type of the target function.
+template <class RetType>
+struct DelegateReplyType { using Type = Delegate<void(RetType)>; };
+
+template <>
+struct DelegateReplyType<void> { using Type = Delegate<void()>; };
+
+template <class R>
+class DelegateAsyncReply; // Not defined
+
+/// @brief Asynchronously invokes a target delegate and passes its return value to a
+/// reply delegate.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class RetType, class... Args>
+class DelegateAsyncReply<RetType(Args...)> : public Delegate<void(Args...)> {
+public:
+    static_assert(!std::is_reference<RetType>::value, "Reference return value not allowed");
+
+    using DelegateType = Delegate<void(Args...)>;
+    using TargetType = Delegate<RetType(Args...)>;
+    using ReplyType = typename DelegateReplyType<RetType>::Type;
+    using ClassType = DelegateAsyncReply<RetType(Args...)>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] target The synchronous delegate to invoke on `thread`. Copied.
+    /// @param[in] thread The execution thread to invoke `target`.
+    /// @param[in] reply The delegate passed the return value, normally bound to the
+    /// caller's thread. Copied. Invoked on `thread`.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    DelegateAsyncReply(const TargetType& target, DelegateThread& thread, const ReplyType& reply) {
+        Bind(target, thread, reply);
+    }
+
+    /// @brief Copy constructor. The copy shares the target and reply of `rhs`.
+    /// @param[in] rhs The object to copy from.
+    DelegateAsyncReply(const ClassType& rhs) = default;
+
+    /// @brief Copy assignment. The object shares the target and reply of `rhs`.
+    /// @param[in] rhs The object to copy from.
+    /// @return A reference to the current object.
+    ClassType& operator=(const ClassType& rhs) = default;
+
+    DelegateAsyncReply() = default;
+
+    /// @brief Bind a target delegate and its reply.
+    /// @param[in] target The synchronous delegate to invoke on `thread`. Copied.
+    /// @param[in] thread The execution thread to invoke `target`.
+    /// @param[in] reply The delegate passed the return value. Copied.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void Bind(const TargetType& target, DelegateThread& thread, const ReplyType& reply) {
+        m_state = nullptr;
+        if (target == nullptr)
+            return;
+
+        std::unique_ptr<TargetType> targetClone(target.Clone());
+        if (!targetClone)
+            BAD_ALLOC();
+        std::unique_ptr<ReplyType> replyClone;
+        if (reply != nullptr) {
+            replyClone.reset(reply.Clone());
+            if (!replyClone)
+                BAD_ALLOC();
+        }
+        m_state = std::allocate_shared<State>(pool_allocator<State>(), std::move(targetClone), thread, std::move(replyClone));
+        if (!m_state)
+            BAD_ALLOC();
+    }
+
+    /// @brief Creates a copy of the current object sharing its target and reply.
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Invoke the target asynchronously. Called by the source thread. Returns
+    /// at once; the return value is passed to the reply delegate. Always safe to call.
+    /// @param[in] args The function arguments, if any.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual void operator()(Args... args) override {
+        if (Empty())
+            return;
+
+        auto msg = std::allocate_shared<Msg>(pool_allocator<Msg>(), m_state, std::forward<Args>(args)...);
+        if (!msg)
+            BAD_ALLOC();
+        m_state->m_thread->DispatchDelegate(msg);
+    }
+
+    /// @brief Invoke the target asynchronously. Called by the source thread.
+    /// @param[in] args The function arguments, if any.
+    void AsyncInvoke(Args... args) {
+        operator()(std::forward<Args>(args)...);
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept { Clear(); }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
+    /// @brief Compares two delegate objects for equality. Equal if bound to equal
+    /// targets, the same thread and equal replies.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        if (!derivedRhs)
+            return false;
+        if (!m_state || !derivedRhs->m_state)
+            return !m_state && !derivedRhs->m_state;
+        if (m_state == derivedRhs->m_state)
+            return true;
+
+        const State& l = *m_state;
+        const State& r = *derivedRhs->m_state;
+        if (l.m_thread != r.m_thread || !l.m_target->Equal(*r.m_target))
+            return false;
+        if (!l.m_reply || !r.m_reply)
+            return !l.m_reply && !r.m_reply;
+        return l.m_reply->Equal(*r.m_reply);
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override { return Empty(); }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override { return !Empty(); }
+
+    /// @brief Check if the delegate is bound to a target function.
+    /// @return `true` if the delegate has a target function, `false` otherwise.
+    bool Empty() const noexcept { return !m_state; }
+
+    /// @brief Clear the target function.
+    /// @post The delegate is empty. A queued call still invokes the target and replies.
+    void Clear() noexcept { m_state = nullptr; }
+
+    /// @brief Implicit conversion operator to `bool`.
+    /// @return `true` if the object is not empty, `false` if the object is empty.
+    explicit operator bool() const noexcept { return !Empty(); }
+
+private:
+    /// The queued call
+    class Msg : public DelegateMsg
+    {
+    public:
+        Msg(std::shared_ptr<IDelegateInvoker> invoker, Args... args) :
+            DelegateMsg(invoker, type_id<Msg>()), m_args(std::forward<Args>(args)...) { }
+
+        /// A copy of each argument stored within the message
+        inline_args<Args...> m_args;
+    };
+
+    /// The target and reply shared by a delegate and its copies. Invoked only by the
+    /// destination thread, so the reply is never called concurrently.
+    class State : public IDelegateInvoker
+    {
+    public:
+        State(std::unique_ptr<TargetType> target, DelegateThread& thread, std::unique_ptr<ReplyType> reply) :
+            m_target(std::move(target)), m_thread(&thread), m_reply(std::move(reply)) { }
+
+        /// @brief Invoke the target, then the reply with the return value. Called by
+        /// the destination thread.
+        /// @param[in] msg The message dispatched within `operator()`.
+        /// @return `true` if the target function invoked.
+        virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+            auto replyMsg = delegate_msg_cast<Msg>(msg);
+            if (replyMsg == nullptr)
+                return false;
+
+            auto call = [this](auto&&... args) { return (*m_target)(std::forward<decltype(args)>(args)...); };
+            if constexpr (std::is_void<RetType>::value) {
+                std::apply(call, replyMsg->m_args.get());
+                if (m_reply)
+                    (*m_reply)();
+            } else {
+                RetType result = std::apply(call, replyMsg->m_args.get());
+                if (m_reply)
+                    (*m_reply)(std::move(result));
+            }
+            return true;
+        }
+
+        const std::unique_ptr<TargetType> m_target;
+        DelegateThread* const m_thread;
+        const std::unique_ptr<ReplyType> m_reply;
+    };
+
+    /// The shared state, or nullptr if empty.
+    std::shared_ptr<State> m_state;
+};
+
+/// @brief Creates an asynchronous delegate that passes the target function return value
+/// to a reply delegate.
+/// @tparam RetType The return type of the target.
+/// @tparam Args The types of the function arguments.
+/// @param[in] target The synchronous delegate to invoke on `thread`, e.g. from `MakeDelegate()`.
+/// @param[in] thread The `DelegateThread` on which the target will be invoked asynchronously.
+/// @param[in] reply The delegate passed the return value, e.g. from `MakeDelegate()` bound
+/// to the caller's thread.
+/// @return A `DelegateAsyncReply` object bound to the specified target, thread and reply.
+template <class RetType, class... Args>
+auto MakeDelegateReply(const Delegate<RetType(Args...)>& target, DelegateThread& thread,
+    const typename DelegateReplyType<RetType>::Type& reply) {
+    return DelegateAsyncReply<RetType(Args...)>(target, thread, reply);
+}
+
+}
+
+#endif
@@ -14,11 +14,12 @@
 /// asynchronous call succeeded before using the return value and outgoing argument values.
 /// 
 /// Delegate "`AsyncWait`" series of classes used to invoke a function asynchronously and wait for 
-/// completion by the destination target thread. Invoking a function asynchronously requires making 
-/// a clone of the object to be sent to the destination thread message queue. The destination thread 
-/// calls `Invoke()` to invoke the target function. The source thread blocks on a semaphore 
+/// completion by the destination target thread. Invoking a function asynchronously sends a message to the 
+/// destination thread message queue referring to the invoker, a synchronous clone of the delegate 
+/// created at bind time and shared by every call. The destination thread calls `Invoke()` to invoke the target function. The source thread blocks on a semaphore 
 /// waiting for the destination thread to complete the function invoke. If the caller timeout expires, 
-/// the target function is not invoked. 
+/// the target function is not invoked. A call made on a destination thread whose
+/// `DelegateThread::IsInlineCall()` returns `true` invokes the target function directly.
 /// 
 /// The `m_lock` mutex is used to protect shared state data between the source and destination 
 /// threads using the two thread safe functions below:
@@ -35,8 +36,9 @@
 /// 
 /// * Cannot use rvalue reference (T&&) as a target function argument.
 /// 
-/// * The target function cannot return a `std::unique_ptr` since `AsyncWait` destination 
-/// target thread stores the return value (`m_retVal`) for later use by the calling source thread.
+/// * The target function cannot return a reference. The destination thread stores the 
+/// return value within the message and the source thread moves it out, so move-only 
+/// return values such as `std::unique_ptr` are allowed.
 /// 
 /// * Cannot insert `DelegateMemberAsyncWait` into an ordered container. e.g. `std::list` ok, 
 /// `std::set` not ok.
@@ -53,69 +55,132 @@
 #include "Delegate.h"
 #include "DelegateThread.h"
 #include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include "DelegateWaitStats.h"
+#include "Metrics.h"
 #include <optional>
-#include <any>
 #include <chrono>
 
 namespace DelegateLib {
 
 #undef max  // Prevent compiler error on next line if max is defined
-constexpr auto WAIT_INFINITE = std::chrono::milliseconds::max();
-
-/// @brief Stores all function arguments suitable for blocking asynchronous calls.
-/// Argument data is not stored in the heap.
+/// Wait with no timeout. Timeouts are held in nanoseconds, so any integral duration
+/// converts implicitly, e.g. `std::chrono::microseconds(100)`.
+constexpr auto WAIT_INFINITE = std::chrono::nanoseconds::max();
+
+/// @brief Stores all function arguments and the return value suitable for blocking 
+/// asynchronous calls. Argument data is not stored in the heap. Messages are cached
+/// per sending thread and reused once the destination thread releases them, so a 
+/// call normally allocates nothing. A message abandoned on timeout stays shared with
+/// the destination thread queue until taken and the next call allocates another.
+/// @tparam RetType The target function return type.
 /// @tparam Args The target function arguments.
-template <class...Args>
+template <class RetType, class...Args>
 class DelegateAsyncWaitMsg : public DelegateMsg
 {
 public:
+    static_assert(!std::is_reference<RetType>::value, "Reference return value not allowed");
+
+    /// The stored return value type. A `void` return stores nothing.
+    using RetValType = std::conditional_t<std::is_void<RetType>::value, bool, RetType>;
+
     /// Constructor
     /// @param[in] invoker - the invoker instance
     /// @param[in] args - a parameter pack of all target function arguments
-    DelegateAsyncWaitMsg(std::shared_ptr<IDelegateInvoker> invoker, Args... args) : DelegateMsg(invoker),
-        m_args(std::forward<Args>(args)...) {}
+    DelegateAsyncWaitMsg(std::shared_ptr<IDelegateInvoker> invoker, Args... args) : DelegateMsg(invoker, type_id<DelegateAsyncWaitMsg>()),
+        m_args(std::in_place, std::forward<Args>(args)...) {}
 
     virtual ~DelegateAsyncWaitMsg() {}
 
+    /// Get a message for a call from the calling thread's cache, or allocate one if 
+    /// every cached message is still held by a destination thread, e.g. one abandoned
+    /// on timeout and not yet taken from the queue. Called by the sending thread.
+    /// @param[in] invoker - the invoker instance
+    /// @param[in] args - a parameter pack of all target function arguments
+    /// @return The message, referenced by the cache until replaced.
+    /// @throws std::bad_alloc If dynamic memory allocation fails.
+    static std::shared_ptr<DelegateAsyncWaitMsg> Acquire(std::shared_ptr<IDelegateInvoker> invoker, Args... args) {
+        static thread_local std::shared_ptr<DelegateAsyncWaitMsg> cache[CACHE_SIZE];
+        static thread_local size_t next = 0;
+
+        // A message only the cache holds was released by its destination thread
+        for (auto& cached : cache) {
+            if (cached && cached.use_count() == 1) {
+                std::atomic_thread_fence(std::memory_order_acquire);
+                cached->Rearm(std::move(invoker), std::forward<Args>(args)...);
+                return cached;
+            }
+        }
+
+        static MetricCounter& allocMetric = Metrics::GetCounter("delegate.async_wait.msg_allocs");
+        allocMetric.Add();
+        auto msg = std::make_shared<DelegateAsyncWaitMsg>(std::move(invoker), std::forward<Args>(args)...);
+        cache[next++ % CACHE_SIZE] = msg;
+        return msg;
+    }
+
+    /// Release the arguments and invoker of a completed call. Called by the sending
+    /// thread once `InvokeSignal::Wait()` returns `true`, after which the receiving 
+    /// thread no longer accesses them.
+    void Release() {
+        m_args.reset();
+        DelegateMsg::Rearm(nullptr);
+    }
+
     /// Get all function arguments 
     /// @return A tuple of all function arguments
-    std::tuple<Args...>& GetArgs() { return m_args; }
-
-    /// Get the semaphore used to signal the sending thread that the receiving 
-    /// thread has invoked the target function. 
-    /// @return The semaphore reference.
-    Semaphore& GetSema() { return m_sema; }
+    std::tuple<Args...>& GetArgs() { return *m_args; }
+
+    /// Cancel a call the sending thread stopped waiting for and destroy the arguments.
+    /// Called by the sending thread once `InvokeSignal::Wait()` returns `false`, after 
+    /// which the receiving thread never accesses the arguments.
+    void Abandon() {
+        Cancel();
+        m_args.reset();
+    }
 
-    /// Get a mutex shared between sender and receiver threads.
-    /// @return The lock reference.
-    std::mutex& GetLock() { return m_lock; }
+    /// Get the signal shared by the sending and receiving threads. The receiving
+    /// thread claims the call with `BeginInvoke()` and signals the sending thread
+    /// with `EndInvoke()`. A call the sending thread stopped waiting for is not invoked.
+    /// @return The signal reference.
+    InvokeSignal& GetSignal() { return m_signal; }
 
-    /// True if the sending thread is waiting for the receiver thread to call the function.
-    /// False if the sending thread delegate timeout occurred and is not waiting.
-    /// @return `true` if the sending thread is waiting for the receiving thread to complete
-    /// the target function invoke.
-    bool GetInvokerWaiting() { return m_invokerWaiting; }
+    /// Store the target function return value. Called by the receiving thread 
+    /// between `BeginInvoke()` and `EndInvoke()`.
+    /// @param[in] retVal - the return value
+    template <class Value>
+    void SetRetVal(Value&& retVal) { m_retVal.emplace(std::forward<Value>(retVal)); }
 
-    /// Set to true when source thread is waiting for destination thread to complete the 
-    /// function call.
-    /// @param[in] invokerWaiting The status of the invoker waiting flag.
-    void SetInvokerWaiting(bool invokerWaiting) { m_invokerWaiting = invokerWaiting; }
+    /// Get the target function return value. Valid once `InvokeSignal::Wait()` 
+    /// returns `true`.
+    /// @return The return value, or empty if not stored.
+    std::optional<RetValType>& GetRetVal() { return m_retVal; }
 
 private:
     /// An empty starting tuple
     std::tuple<> m_start;
 
-    /// A tuple with each function argument element 
-    std::tuple<Args...> m_args;
+    /// A tuple with each function argument element. Empty once abandoned.
+    std::optional<std::tuple<Args...>> m_args;
+
+    /// Invoke state and completion signal of the call
+    InvokeSignal m_signal;
 
-    /// Semaphore to signal waiting thread
-    Semaphore m_sema;
+    /// Target function return value written by the receiving thread
+    std::optional<RetValType> m_retVal;
 
-    /// Lock to protect shared data 
-    std::mutex m_lock;                       
+    /// Messages cached per sending thread. A call reuses a cached message released
+    /// by its destination thread. Two, since the destination thread may still hold
+    /// the previous call's message briefly after the sender wakes.
+    static const size_t CACHE_SIZE = 2;
 
-    /// True if source thread is waiting for destination thread invoke to complete
-    bool m_invokerWaiting = false;          
+    /// Prepare a cached message for a new call
+    void Rearm(std::shared_ptr<IDelegateInvoker> invoker, Args... args) {
+        DelegateMsg::Rearm(std::move(invoker));
+        m_signal.Reset();
+        m_retVal.reset();
+        m_args.emplace(std::forward<Args>(args)...);
+    }
 };
 
 template <class R>
@@ -136,9 +201,9 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    DelegateFreeAsyncWait(FreeFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) :
+    DelegateFreeAsyncWait(FreeFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) :
         BaseType(func), m_thread(&thread), m_timeout(timeout) {
-        Bind(func, thread);
+        Bind(func, thread, timeout);
     }
 
     /// @brief Copy constructor that creates a copy of the given instance.
@@ -154,7 +219,8 @@ public:
     /// @brief Move constructor that transfers ownership of resources.
     /// @param[in] rhs The object to move from.
     DelegateFreeAsyncWait(ClassType&& rhs) noexcept :
-        BaseType(rhs), m_thread(rhs.m_thread), m_timeout(rhs.m_timeout), m_success(rhs.m_success), m_retVal(rhs.m_retVal) {
+        BaseType(rhs), m_thread(rhs.m_thread), m_success(rhs.m_success), m_timeout(rhs.m_timeout) {
+        m_invoker = rhs.m_invoker;
         rhs.Clear();
     }
 
@@ -168,10 +234,11 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    void Bind(FreeFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) {
+    void Bind(FreeFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) {
         m_thread = &thread;
         m_timeout = timeout;
         BaseType::Bind(func);
+        BindInvoker();
     }
 
     // <common_code>
@@ -182,9 +249,9 @@ public:
     /// @param[in] rhs The object whose state is to be copied.
     void Assign(const ClassType& rhs) {
         m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
         m_timeout = rhs.m_timeout;
         m_success = rhs.m_success;
-        m_retVal = rhs.m_retVal;
         BaseType::Assign(rhs);
     }
 
@@ -198,6 +265,19 @@ public:
         return new(std::nothrow) ClassType(*this);
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assignment operator that assigns the state of one object to another.
     /// @param[in] rhs The object whose state is to be assigned to the current object.
     /// @return A reference to the current object.
@@ -216,9 +296,9 @@ public:
         if (&rhs != this) {
             BaseType::operator=(std::move(rhs));
             m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
             m_timeout = rhs.m_timeout;    
             m_success = rhs.m_success;
-            m_retVal = rhs.m_retVal;
         }
         return *this;
     }
@@ -228,11 +308,24 @@ public:
         return this->Clear();
     }
 
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_thread == derivedRhs->m_thread &&
             m_timeout == derivedRhs->m_timeout &&
@@ -283,8 +376,8 @@ public:
     /// 
     /// The `DelegateAsyncWaitMsg` does not duplicated and copy the function arguments into heap
     /// memory. The source thread waits on the destintation thread to complete, therefore argument
-    /// data is shared between the source and destination threads and simultaneous access is prevented
-    /// using a mutex.
+    /// data is shared between the source and destination threads. Once the destination thread 
+    /// starts the call the source thread waits for it to complete even if the timeout expires.
     /// @param[in] args The function arguments, if any.
     /// @return The bound function return value, if any. Use `IsSuccess()` to determine if 
     /// the return value is valid before use.
@@ -297,40 +390,53 @@ public:
             // Invoke the target function directly
             return BaseType::operator()(std::forward<Args>(args)...);
         } else {
-            // Create a clone instance of this delegate 
-            auto delegate = std::shared_ptr<ClassType>(Clone());
-            if (!delegate)
-                BAD_ALLOC();
+
+            // Invoke the target function directly if called on a destination thread
+            // that allows inline calls. Waiting on the own queue would block until timeout.
+            auto thread = this->GetThread();
+            if (thread && thread->IsInlineCall()) {
+                static MetricCounter& inlineMetric = Metrics::GetCounter("delegate.async_wait.inline_calls");
+                inlineMetric.Add();
+                m_success = true;
+                return BaseType::operator()(std::forward<Args>(args)...);
+            }
 
             // Create a new message instance for sending to the destination thread.
-            auto msg = std::make_shared<DelegateAsyncWaitMsg<Args...>>(delegate, std::forward<Args>(args)...);
+            auto msg = DelegateAsyncWaitMsg<RetType, Args...>::Acquire(m_invoker, std::forward<Args>(args)...);
             if (!msg)
                 BAD_ALLOC();
-            msg->SetInvokerWaiting(true);
 
-            auto thread = this->GetThread();
             if (thread) {
+                // The wait is only timed for a thread collecting statistics
+                DelegateWaitStats* stats = thread->GetWaitStats();
+                auto start = stats ? Clock::Now() : std::chrono::steady_clock::time_point();
+
                 // Dispatch message onto the callback destination thread. Invoke()
                 // will be called by the destination thread. 
                 thread->DispatchDelegate(msg);
 
-                // Wait for destination thread to execute the delegate function and get return value
-                if ((m_success = msg->GetSema().Wait(m_timeout)))
-                    m_retVal = delegate->m_retVal;
+                // Wait for destination thread to execute the delegate function and get return value.
+                // On timeout the call is abandoned unless the destination thread has started it.
+                m_success = msg->GetSignal().Wait(m_timeout);
+                if (stats)
+                    stats->Record(m_success, Clock::Now() - start, m_timeout);
+
+                // Let the destination thread discard the message unseen
+                if (!m_success) {
+                    static MetricCounter& timeoutsMetric = Metrics::GetCounter("delegate.async_wait.timeouts");
+                    timeoutsMetric.Add();
+                    msg->Abandon();
+                } else {
+                    msg->Release();
+                }
             }
 
-            // Protect data shared between source and destination threads
-            const std::lock_guard<std::mutex> lock(msg->GetLock());
-
-            // Set flag that source is not waiting anymore
-            msg->SetInvokerWaiting(false);
-
             // Does the target function have a return value?
             if constexpr (std::is_void<RetType>::value == false) {
                 // Is the return value valid? 
-                if (m_retVal.has_value()) {
-                    // Return the destination thread target function return value
-                    return GetRetVal();
+                if (m_success && msg->GetRetVal().has_value()) {
+                    // Move the destination thread target function return value out of the message
+                    return std::move(*msg->GetRetVal());
                 } else {
                     // Return a default return value
                     return RetType{};
@@ -347,40 +453,33 @@ public:
     /// the target function return value.
     auto AsyncInvoke(Args... args) {
         if constexpr (std::is_void<RetType>::value == true) {
-            operator()(args...);
+            operator()(std::forward<Args>(args)...);
             return IsSuccess() ? std::optional<bool>(true) : std::optional<bool>();
         } else {
-            auto retVal = operator()(args...);
-            return IsSuccess() ? std::optional<RetType>(retVal) : std::optional<RetType>();
+            auto retVal = operator()(std::forward<Args>(args)...);
+            return IsSuccess() ? std::optional<RetType>(std::move(retVal)) : std::optional<RetType>();
         }
     }
 
     /// @brief Invoke the delegate function on the destination thread. Called by the 
     /// destination thread.
     /// @details Each source thread call to `operator()` generate a call to `Invoke()` 
-    /// on the destination thread. A lock is used to protect source and destination thread shared 
-    /// data. A semaphore is used to signal the source thread when the destination thread 
-    /// completes the target function call.
+    /// on the destination thread. An `InvokeSignal` decides whether the source thread is still 
+    /// waiting and signals the source thread when the destination thread completes the target 
+    /// function call.
     /// 
     /// If source thread timeout expires and before the destination thread invokes the 
     /// target function, the target function is not called.
     /// @param[in] msg The delegate message created and sent within `operator()(Args... args)`.
     /// @return `true` if target function invoked or timeout expired; `false` if error. 
     virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
-        static_assert(!(is_unique_ptr<RetType>::value), "std::unique_ptr return value not allowed");
-
         // Typecast the base pointer to back correct derived to instance
-        auto delegateMsg = std::dynamic_pointer_cast<DelegateAsyncWaitMsg<Args...>>(msg);
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncWaitMsg<RetType, Args...>>(msg);
         if (delegateMsg == nullptr)
             return false;
 
-        // Protect data shared between source and destination threads
-        const std::lock_guard<std::mutex> lock(delegateMsg->GetLock());
-
         // Is the source thread waiting for the target function invoke to complete?
-        if (delegateMsg->GetInvokerWaiting()) {
-            // Invoke the delegate function synchronously
-            m_sync = true;
+        if (delegateMsg->GetSignal().BeginInvoke()) {
 
             // Does target function have a void return value?
             if constexpr (std::is_void<RetType>::value == true) {
@@ -388,12 +487,16 @@ public:
                 std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
             } else {
                 // Invoke the target function using the source thread supplied function arguments 
-                // and get the return value
-                m_retVal = std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+                // and store the return value in the message
+                delegateMsg->SetRetVal(std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs())));
             }
 
             // Signal the source thread that the destination thread function call is complete
-            delegateMsg->GetSema().Signal();
+            delegateMsg->GetSignal().EndInvoke();
+        } else if (m_thread) {
+            // The source thread gave up before the call was taken from the queue
+            if (DelegateWaitStats* stats = m_thread->GetWaitStats())
+                stats->Discarded();
         }
         return true;
     }
@@ -403,25 +506,34 @@ public:
     /// the timeout expired before the target function could be invoked.
     bool IsSuccess() noexcept { return m_success; }
 
-    /// Get the asynchronous function return value
-    /// @return The destination thraed target function return value
-    RetType GetRetVal() noexcept {
-        try {
-            return std::any_cast<RetType>(m_retVal);
-        }
-        catch (const std::bad_any_cast&) {
-            return RetType{};  // Return a default value if error
-        }
-    }
-
     ///@brief Get the destination thread that the target function is invoked on.
     // @return The target thread.
     DelegateThread* GetThread() noexcept { return m_thread; }
 
 private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+        m_invoker = invoker;
+    }
+
     /// The target thread to invoke the delegate function.
     DelegateThread* m_thread = nullptr;
 
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
     /// Flag to control synchronous vs asynchronous target invoke behavior.
     bool m_sync = false;
 
@@ -429,10 +541,7 @@ private:
     bool m_success = false;			        
 
     /// Time in mS to wait for async function to invoke
-    std::chrono::milliseconds m_timeout = WAIT_INFINITE;    
-
-    /// Return value of the target invoked function
-    std::any m_retVal;                      
+    std::chrono::nanoseconds m_timeout = WAIT_INFINITE;    
 
     // </common_code>
 };
@@ -460,9 +569,9 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    DelegateMemberAsyncWait(SharedPtr object, MemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) :
+    DelegateMemberAsyncWait(SharedPtr object, MemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) :
         BaseType(object, func), m_thread(&thread), m_timeout(timeout) {
-        Bind(object, func, thread);
+        Bind(object, func, thread, timeout);
     }
 
     /// @brief Constructor to create a class instance.
@@ -471,9 +580,9 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    DelegateMemberAsyncWait(SharedPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout) :
+    DelegateMemberAsyncWait(SharedPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout) :
         BaseType(object, func), m_thread(&thread), m_timeout(timeout) {
-        Bind(object, func, thread);
+        Bind(object, func, thread, timeout);
     }
 
     /// @brief Constructor to create a class instance.
@@ -482,9 +591,9 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    DelegateMemberAsyncWait(ObjectPtr object, MemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) :
+    DelegateMemberAsyncWait(ObjectPtr object, MemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) :
         BaseType(object, func), m_thread(&thread), m_timeout(timeout) {
-        Bind(object, func, thread);
+        Bind(object, func, thread, timeout);
     }
 
     /// @brief Constructor to create a class instance.
@@ -493,9 +602,9 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    DelegateMemberAsyncWait(ObjectPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout) :
+    DelegateMemberAsyncWait(ObjectPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout) :
         BaseType(object, func), m_thread(&thread), m_timeout(timeout) {
-        Bind(object, func, thread);
+        Bind(object, func, thread, timeout);
     }
 
     /// @brief Copy constructor that creates a copy of the given instance.
@@ -511,7 +620,8 @@ public:
     /// @brief Move constructor that transfers ownership of resources.
     /// @param[in] rhs The object to move from.
     DelegateMemberAsyncWait(ClassType&& rhs) noexcept :
-        BaseType(rhs), m_thread(rhs.m_thread), m_timeout(rhs.m_timeout), m_success(rhs.m_success), m_retVal(rhs.m_retVal) {
+        BaseType(rhs), m_thread(rhs.m_thread), m_success(rhs.m_success), m_timeout(rhs.m_timeout) {
+        m_invoker = rhs.m_invoker;
         rhs.Clear();
     }
 
@@ -526,10 +636,11 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    void Bind(SharedPtr object, MemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) {
+    void Bind(SharedPtr object, MemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) {
         m_thread = &thread;
         m_timeout = timeout;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     /// @brief Bind a member function to the delegate.
@@ -541,10 +652,11 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    void Bind(SharedPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) {
+    void Bind(SharedPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) {
         m_thread = &thread;
         m_timeout = timeout;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     /// @brief Bind a const member function to the delegate.
@@ -556,10 +668,11 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    void Bind(ObjectPtr object, MemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) {
+    void Bind(ObjectPtr object, MemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) {
         m_thread = &thread;
         m_timeout = timeout;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     /// @brief Bind a member function to the delegate.
@@ -571,10 +684,11 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    void Bind(ObjectPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) {
+    void Bind(ObjectPtr object, ConstMemberFunc func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) {
         m_thread = &thread;
         m_timeout = timeout;
         BaseType::Bind(object, func);
+        BindInvoker();
     }
 
     // <common_code>
@@ -585,9 +699,9 @@ public:
     /// @param[in] rhs The object whose state is to be copied.
     void Assign(const ClassType& rhs) {
         m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
         m_timeout = rhs.m_timeout;
         m_success = rhs.m_success;
-        m_retVal = rhs.m_retVal;
         BaseType::Assign(rhs);
     }
 
@@ -601,6 +715,19 @@ public:
         return new(std::nothrow) ClassType(*this);
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assignment operator that assigns the state of one object to another.
     /// @param[in] rhs The object whose state is to be assigned to the current object.
     /// @return A reference to the current object.
@@ -619,9 +746,9 @@ public:
         if (&rhs != this) {
             BaseType::operator=(std::move(rhs));
             m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
             m_timeout = rhs.m_timeout;    
             m_success = rhs.m_success;
-            m_retVal = rhs.m_retVal;
         }
         return *this;
     }
@@ -631,11 +758,24 @@ public:
         return this->Clear();
     }
 
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_thread == derivedRhs->m_thread &&
             m_timeout == derivedRhs->m_timeout &&
@@ -686,8 +826,8 @@ public:
     /// 
     /// The `DelegateAsyncWaitMsg` does not duplicated and copy the function arguments into heap
     /// memory. The source thread waits on the destintation thread to complete, therefore argument
-    /// data is shared between the source and destination threads and simultaneous access is prevented
-    /// using a mutex.
+    /// data is shared between the source and destination threads. Once the destination thread 
+    /// starts the call the source thread waits for it to complete even if the timeout expires.
     /// @param[in] args The function arguments, if any.
     /// @return The bound function return value, if any. Use `IsSuccess()` to determine if 
     /// the return value is valid before use.
@@ -700,40 +840,53 @@ public:
             // Invoke the target function directly
             return BaseType::operator()(std::forward<Args>(args)...);
         } else {
-            // Create a clone instance of this delegate 
-            auto delegate = std::shared_ptr<ClassType>(Clone());
-            if (!delegate)
-                BAD_ALLOC();
+
+            // Invoke the target function directly if called on a destination thread
+            // that allows inline calls. Waiting on the own queue would block until timeout.
+            auto thread = this->GetThread();
+            if (thread && thread->IsInlineCall()) {
+                static MetricCounter& inlineMetric = Metrics::GetCounter("delegate.async_wait.inline_calls");
+                inlineMetric.Add();
+                m_success = true;
+                return BaseType::operator()(std::forward<Args>(args)...);
+            }
 
             // Create a new message instance for sending to the destination thread.
-            auto msg = std::make_shared<DelegateAsyncWaitMsg<Args...>>(delegate, std::forward<Args>(args)...);
+            auto msg = DelegateAsyncWaitMsg<RetType, Args...>::Acquire(m_invoker, std::forward<Args>(args)...);
             if (!msg)
                 BAD_ALLOC();
-            msg->SetInvokerWaiting(true);
 
-            auto thread = this->GetThread();
             if (thread) {
+                // The wait is only timed for a thread collecting statistics
+                DelegateWaitStats* stats = thread->GetWaitStats();
+                auto start = stats ? Clock::Now() : std::chrono::steady_clock::time_point();
+
                 // Dispatch message onto the callback destination thread. Invoke()
                 // will be called by the destination thread. 
                 thread->DispatchDelegate(msg);
 
-                // Wait for destination thread to execute the delegate function and get return value
-                if ((m_success = msg->GetSema().Wait(m_timeout)))
-                    m_retVal = delegate->m_retVal;
+                // Wait for destination thread to execute the delegate function and get return value.
+                // On timeout the call is abandoned unless the destination thread has started it.
+                m_success = msg->GetSignal().Wait(m_timeout);
+                if (stats)
+                    stats->Record(m_success, Clock::Now() - start, m_timeout);
+
+                // Let the destination thread discard the message unseen
+                if (!m_success) {
+                    static MetricCounter& timeoutsMetric = Metrics::GetCounter("delegate.async_wait.timeouts");
+                    timeoutsMetric.Add();
+                    msg->Abandon();
+                } else {
+                    msg->Release();
+                }
             }
 
-            // Protect data shared between source and destination threads
-            const std::lock_guard<std::mutex> lock(msg->GetLock());
-
-            // Set flag that source is not waiting anymore
-            msg->SetInvokerWaiting(false);
-
             // Does the target function have a return value?
             if constexpr (std::is_void<RetType>::value == false) {
                 // Is the return value valid? 
-                if (m_retVal.has_value()) {
-                    // Return the destination thread target function return value
-                    return GetRetVal();
+                if (m_success && msg->GetRetVal().has_value()) {
+                    // Move the destination thread target function return value out of the message
+                    return std::move(*msg->GetRetVal());
                 } else {
                     // Return a default return value
                     return RetType{};
@@ -750,40 +903,33 @@ public:
     /// the target function return value.
     auto AsyncInvoke(Args... args) {
         if constexpr (std::is_void<RetType>::value == true) {
-            operator()(args...);
+            operator()(std::forward<Args>(args)...);
             return IsSuccess() ? std::optional<bool>(true) : std::optional<bool>();
         } else {
-            auto retVal = operator()(args...);
-            return IsSuccess() ? std::optional<RetType>(retVal) : std::optional<RetType>();
+            auto retVal = operator()(std::forward<Args>(args)...);
+            return IsSuccess() ? std::optional<RetType>(std::move(retVal)) : std::optional<RetType>();
         }
     }
 
     /// @brief Invoke the delegate function on the destination thread. Called by the 
     /// destination thread.
     /// @details Each source thread call to `operator()` generate a call to `Invoke()` 
-    /// on the destination thread. A lock is used to protect source and destination thread shared 
-    /// data. A semaphore is used to signal the source thread when the destination thread 
-    /// completes the target function call.
+    /// on the destination thread. An `InvokeSignal` decides whether the source thread is still 
+    /// waiting and signals the source thread when the destination thread completes the target 
+    /// function call.
     /// 
     /// If source thread timeout expires and before the destination thread invokes the 
     /// target function, the target function is not called.
     /// @param[in] msg The delegate message created and sent within `operator()(Args... args)`.
     /// @return `true` if target function invoked or timeout expired; `false` if error. 
     virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
-        static_assert(!(is_unique_ptr<RetType>::value), "std::unique_ptr return value not allowed");
-
         // Typecast the base pointer to back correct derived to instance
-        auto delegateMsg = std::dynamic_pointer_cast<DelegateAsyncWaitMsg<Args...>>(msg);
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncWaitMsg<RetType, Args...>>(msg);
         if (delegateMsg == nullptr)
             return false;
 
-        // Protect data shared between source and destination threads
-        const std::lock_guard<std::mutex> lock(delegateMsg->GetLock());
-
         // Is the source thread waiting for the target function invoke to complete?
-        if (delegateMsg->GetInvokerWaiting()) {
-            // Invoke the delegate function synchronously
-            m_sync = true;
+        if (delegateMsg->GetSignal().BeginInvoke()) {
 
             // Does target function have a void return value?
             if constexpr (std::is_void<RetType>::value == true) {
@@ -791,12 +937,16 @@ public:
                 std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
             } else {
                 // Invoke the target function using the source thread supplied function arguments 
-                // and get the return value
-                m_retVal = std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+                // and store the return value in the message
+                delegateMsg->SetRetVal(std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs())));
             }
 
             // Signal the source thread that the destination thread function call is complete
-            delegateMsg->GetSema().Signal();
+            delegateMsg->GetSignal().EndInvoke();
+        } else if (m_thread) {
+            // The source thread gave up before the call was taken from the queue
+            if (DelegateWaitStats* stats = m_thread->GetWaitStats())
+                stats->Discarded();
         }
         return true;
     }
@@ -806,25 +956,34 @@ public:
     /// the timeout expired before the target function could be invoked.
     bool IsSuccess() noexcept { return m_success; }
 
-    /// Get the asynchronous function return value
-    /// @return The destination thraed target function return value
-    RetType GetRetVal() noexcept {
-        try {
-            return std::any_cast<RetType>(m_retVal);
-        }
-        catch (const std::bad_any_cast&) {
-            return RetType{};  // Return a default value if error
-        }
-    }
-
     ///@brief Get the destination thread that the target function is invoked on.
     // @return The target thread.
     DelegateThread* GetThread() noexcept { return m_thread; }
 
 private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+        m_invoker = invoker;
+    }
+
     /// The target thread to invoke the delegate function.
     DelegateThread* m_thread = nullptr;
 
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
     /// Flag to control synchronous vs asynchronous target invoke behavior.
     bool m_sync = false;
 
@@ -832,10 +991,7 @@ private:
     bool m_success = false;			        
 
     /// Time in mS to wait for async function to invoke
-    std::chrono::milliseconds m_timeout = WAIT_INFINITE;    
-
-    /// Return value of the target invoked function
-    std::any m_retVal;                      
+    std::chrono::nanoseconds m_timeout = WAIT_INFINITE;    
 
     // </common_code>
 };
@@ -861,9 +1017,20 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    DelegateFunctionAsyncWait(FunctionType func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) :
-        BaseType(func), m_thread(&thread), m_timeout(timeout) {
-        Bind(func, thread);
+    DelegateFunctionAsyncWait(FunctionType func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) :
+        m_thread(&thread), m_timeout(timeout) {
+        Bind(std::move(func), thread, timeout);
+    }
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] func The target callable, such as a lambda, to store.
+    /// @param[in] thread The execution thread to invoke `func`.
+    /// @param[in] timeout The calling thread timeout for destination thread to
+    /// invoke the target function. 
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    DelegateFunctionAsyncWait(F&& func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) :
+        m_thread(&thread), m_timeout(timeout) {
+        Bind(std::forward<F>(func), thread, timeout);
     }
 
     /// @brief Copy constructor that creates a copy of the given instance.
@@ -879,7 +1046,8 @@ public:
     /// @brief Move constructor that transfers ownership of resources.
     /// @param[in] rhs The object to move from.
     DelegateFunctionAsyncWait(ClassType&& rhs) noexcept :
-        BaseType(rhs), m_thread(rhs.m_thread), m_timeout(rhs.m_timeout), m_success(rhs.m_success), m_retVal(rhs.m_retVal) {
+        BaseType(rhs), m_thread(rhs.m_thread), m_success(rhs.m_success), m_timeout(rhs.m_timeout) {
+        m_invoker = rhs.m_invoker;
         rhs.Clear();
     }
 
@@ -893,10 +1061,25 @@ public:
     /// @param[in] thread The execution thread to invoke `func`.
     /// @param[in] timeout The calling thread timeout for destination thread to
     /// invoke the target function. 
-    void Bind(FunctionType func, DelegateThread& thread, std::chrono::milliseconds timeout = WAIT_INFINITE) {
+    void Bind(FunctionType func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) {
         m_thread = &thread;
         m_timeout = timeout;
-        BaseType::Bind(func);
+        BaseType::Bind(std::move(func));
+        BindInvoker();
+    }
+
+    /// @brief Bind a callable, such as a lambda, to the delegate.
+    /// @param[in] func The callable to bind to the delegate. Stored inline if it fits 
+    /// within `DELEGATE_FUNCTION_SIZE` bytes.
+    /// @param[in] thread The execution thread to invoke `func`.
+    /// @param[in] timeout The calling thread timeout for destination thread to
+    /// invoke the target function. 
+    template <class F, class = std::enable_if_t<is_function_target_v<F, RetType, Args...>>>
+    void Bind(F&& func, DelegateThread& thread, std::chrono::nanoseconds timeout = WAIT_INFINITE) {
+        m_thread = &thread;
+        m_timeout = timeout;
+        BaseType::Bind(std::forward<F>(func));
+        BindInvoker();
     }
 
     // <common_code>
@@ -907,9 +1090,9 @@ public:
     /// @param[in] rhs The object whose state is to be copied.
     void Assign(const ClassType& rhs) {
         m_thread = rhs.m_thread;
+        m_invoker = rhs.m_invoker;
         m_timeout = rhs.m_timeout;
         m_success = rhs.m_success;
-        m_retVal = rhs.m_retVal;
         BaseType::Assign(rhs);
     }
 
@@ -923,6 +1106,19 @@ public:
         return new(std::nothrow) ClassType(*this);
     }
 
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
     /// @brief Assignment operator that assigns the state of one object to another.
     /// @param[in] rhs The object whose state is to be assigned to the current object.
     /// @return A reference to the current object.
@@ -941,9 +1137,9 @@ public:
         if (&rhs != this) {
             BaseType::operator=(std::move(rhs));
             m_thread = rhs.m_thread;    // Use the resource
+            m_invoker = std::move(rhs.m_invoker);
             m_timeout = rhs.m_timeout;    
             m_success = rhs.m_success;
-            m_retVal = rhs.m_retVal;
         }
         return *this;
     }
@@ -953,11 +1149,24 @@ public:
         return this->Clear();
     }
 
+    /// @brief Clear the target function and release the shared invoker.
+    void Clear() noexcept {
+        m_invoker = nullptr;
+        BaseType::Clear();
+    }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>() || BaseType::IsType(typeId);
+    }
+
     /// @brief Compares two delegate objects for equality.
     /// @param[in] rhs The `DelegateBase` object to compare with the current object.
     /// @return `true` if the two delegate objects are equal, `false` otherwise.
     virtual bool Equal(const DelegateBase& rhs) const override {
-        auto derivedRhs = dynamic_cast<const ClassType*>(&rhs);
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
         return derivedRhs &&
             m_thread == derivedRhs->m_thread &&
             m_timeout == derivedRhs->m_timeout &&
@@ -1008,8 +1217,8 @@ public:
     /// 
     /// The `DelegateAsyncWaitMsg` does not duplicated and copy the function arguments into heap
     /// memory. The source thread waits on the destintation thread to complete, therefore argument
-    /// data is shared between the source and destination threads and simultaneous access is prevented
-    /// using a mutex.
+    /// data is shared between the source and destination threads. Once the destination thread 
+    /// starts the call the source thread waits for it to complete even if the timeout expires.
     /// @param[in] args The function arguments, if any.
     /// @return The bound function return value, if any. Use `IsSuccess()` to determine if 
     /// the return value is valid before use.
@@ -1022,40 +1231,53 @@ public:
             // Invoke the target function directly
             return BaseType::operator()(std::forward<Args>(args)...);
         } else {
-            // Create a clone instance of this delegate 
-            auto delegate = std::shared_ptr<ClassType>(Clone());
-            if (!delegate)
-                BAD_ALLOC();
+
+            // Invoke the target function directly if called on a destination thread
+            // that allows inline calls. Waiting on the own queue would block until timeout.
+            auto thread = this->GetThread();
+            if (thread && thread->IsInlineCall()) {
+                static MetricCounter& inlineMetric = Metrics::GetCounter("delegate.async_wait.inline_calls");
+                inlineMetric.Add();
+                m_success = true;
+                return BaseType::operator()(std::forward<Args>(args)...);
+            }
 
             // Create a new message instance for sending to the destination thread.
-            auto msg = std::make_shared<DelegateAsyncWaitMsg<Args...>>(delegate, std::forward<Args>(args)...);
+            auto msg = DelegateAsyncWaitMsg<RetType, Args...>::Acquire(m_invoker, std::forward<Args>(args)...);
             if (!msg)
                 BAD_ALLOC();
-            msg->SetInvokerWaiting(true);
 
-            auto thread = this->GetThread();
             if (thread) {
+                // The wait is only timed for a thread collecting statistics
+                DelegateWaitStats* stats = thread->GetWaitStats();
+                auto start = stats ? Clock::Now() : std::chrono::steady_clock::time_point();
+
                 // Dispatch message onto the callback destination thread. Invoke()
                 // will be called by the destination thread. 
                 thread->DispatchDelegate(msg);
 
-                // Wait for destination thread to execute the delegate function and get return value
-                if ((m_success = msg->GetSema().Wait(m_timeout)))
-                    m_retVal = delegate->m_retVal;
+                // Wait for destination thread to execute the delegate function and get return value.
+                // On timeout the call is abandoned unless the destination thread has started it.
+                m_success = msg->GetSignal().Wait(m_timeout);
+                if (stats)
+                    stats->Record(m_success, Clock::Now() - start, m_timeout);
+
+                // Let the destination thread discard the message unseen
+                if (!m_success) {
+                    static MetricCounter& timeoutsMetric = Metrics::GetCounter("delegate.async_wait.timeouts");
+                    timeoutsMetric.Add();
+                    msg->Abandon();
+                } else {
+                    msg->Release();
+                }
             }
 
-            // Protect data shared between source and destination threads
-            const std::lock_guard<std::mutex> lock(msg->GetLock());
-
-            // Set flag that source is not waiting anymore
-            msg->SetInvokerWaiting(false);
-
             // Does the target function have a return value?
             if constexpr (std::is_void<RetType>::value == false) {
                 // Is the return value valid? 
-                if (m_retVal.has_value()) {
-                    // Return the destination thread target function return value
-                    return GetRetVal();
+                if (m_success && msg->GetRetVal().has_value()) {
+                    // Move the destination thread target function return value out of the message
+                    return std::move(*msg->GetRetVal());
                 } else {
                     // Return a default return value
                     return RetType{};
@@ -1072,40 +1294,33 @@ public:
     /// the target function return value.
     auto AsyncInvoke(Args... args) {
         if constexpr (std::is_void<RetType>::value == true) {
-            operator()(args...);
+            operator()(std::forward<Args>(args)...);
             return IsSuccess() ? std::optional<bool>(true) : std::optional<bool>();
         } else {
-            auto retVal = operator()(args...);
-            return IsSuccess() ? std::optional<RetType>(retVal) : std::optional<RetType>();
+            auto retVal = operator()(std::forward<Args>(args)...);
+            return IsSuccess() ? std::optional<RetType>(std::move(retVal)) : std::optional<RetType>();
         }
     }
 
     /// @brief Invoke the delegate function on the destination thread. Called by the 
     /// destination thread.
     /// @details Each source thread call to `operator()` generate a call to `Invoke()` 
-    /// on the destination thread. A lock is used to protect source and destination thread shared 
-    /// data. A semaphore is used to signal the source thread when the destination thread 
-    /// completes the target function call.
+    /// on the destination thread. An `InvokeSignal` decides whether the source thread is still 
+    /// waiting and signals the source thread when the destination thread completes the target 
+    /// function call.
     /// 
     /// If source thread timeout expires and before the destination thread invokes the 
     /// target function, the target function is not called.
     /// @param[in] msg The delegate message created and sent within `operator()(Args... args)`.
     /// @return `true` if target function invoked or timeout expired; `false` if error. 
     virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
-        static_assert(!(is_unique_ptr<RetType>::value), "std::unique_ptr return value not allowed");
-
         // Typecast the base pointer to back correct derived to instance
-        auto delegateMsg = std::dynamic_pointer_cast<DelegateAsyncWaitMsg<Args...>>(msg);
+        auto delegateMsg = delegate_msg_cast<DelegateAsyncWaitMsg<RetType, Args...>>(msg);
         if (delegateMsg == nullptr)
             return false;
 
-        // Protect data shared between source and destination threads
-        const std::lock_guard<std::mutex> lock(delegateMsg->GetLock());
-
         // Is the source thread waiting for the target function invoke to complete?
-        if (delegateMsg->GetInvokerWaiting()) {
-            // Invoke the delegate function synchronously
-            m_sync = true;
+        if (delegateMsg->GetSignal().BeginInvoke()) {
 
             // Does target function have a void return value?
             if constexpr (std::is_void<RetType>::value == true) {
@@ -1113,12 +1328,16 @@ public:
                 std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
             } else {
                 // Invoke the target function using the source thread supplied function arguments 
-                // and get the return value
-                m_retVal = std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs()));
+                // and store the return value in the message
+                delegateMsg->SetRetVal(std::apply(&BaseType::operator(), std::tuple_cat(std::make_tuple(this), delegateMsg->GetArgs())));
             }
 
             // Signal the source thread that the destination thread function call is complete
-            delegateMsg->GetSema().Signal();
+            delegateMsg->GetSignal().EndInvoke();
+        } else if (m_thread) {
+            // The source thread gave up before the call was taken from the queue
+            if (DelegateWaitStats* stats = m_thread->GetWaitStats())
+                stats->Discarded();
         }
         return true;
     }
@@ -1128,25 +1347,34 @@ public:
     /// the timeout expired before the target function could be invoked.
     bool IsSuccess() noexcept { return m_success; }
 
-    /// Get the asynchronous function return value
-    /// @return The destination thraed target function return value
-    RetType GetRetVal() noexcept {
-        try {
-            return std::any_cast<RetType>(m_retVal);
-        }
-        catch (const std::bad_any_cast&) {
-            return RetType{};  // Return a default value if error
-        }
-    }
-
     ///@brief Get the destination thread that the target function is invoked on.
     // @return The target thread.
     DelegateThread* GetThread() noexcept { return m_thread; }
 
 private:
+    /// @brief Create the invoker shared by every message dispatched by this delegate 
+    /// and its copies. Called on each bind so the invoker always matches the target.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    void BindInvoker() {
+        m_invoker = nullptr;
+        if (this->Empty())
+            return;
+
+        // The invoker is a synchronous copy only used to call the target function on 
+        // the destination thread. It never changes so messages and threads may share it.
+        auto invoker = std::allocate_shared<ClassType>(pool_allocator<ClassType>(), *this);
+        if (!invoker)
+            BAD_ALLOC();
+        invoker->m_sync = true;
+        m_invoker = invoker;
+    }
+
     /// The target thread to invoke the delegate function.
     DelegateThread* m_thread = nullptr;
 
+    /// The invoker shared by every message dispatched by this delegate and its copies.
+    std::shared_ptr<ClassType> m_invoker;
+
     /// Flag to control synchronous vs asynchronous target invoke behavior.
     bool m_sync = false;
 
@@ -1154,10 +1382,7 @@ private:
     bool m_success = false;			        
 
     /// Time in mS to wait for async function to invoke
-    std::chrono::milliseconds m_timeout = WAIT_INFINITE;    
-
-    /// Return value of the target invoked function
-    std::any m_retVal;                      
+    std::chrono::nanoseconds m_timeout = WAIT_INFINITE;    
 
     // </common_code>
 };
@@ -1170,7 +1395,7 @@ private:
 /// @param[in] timeout The duration to wait for the function to complete before returning.
 /// @return A `DelegateFreeAsyncWait` object bound to the specified free function, thread, and timeout.
 template <class RetType, class... Args>
-auto MakeDelegate(RetType(*func)(Args... args), DelegateThread& thread, std::chrono::milliseconds timeout) {
+auto MakeDelegate(RetType(*func)(Args... args), DelegateThread& thread, std::chrono::nanoseconds timeout) {
     return DelegateFreeAsyncWait<RetType(Args...)>(func, thread, timeout);
 }
 
@@ -1184,7 +1409,7 @@ auto MakeDelegate(RetType(*func)(Args... args), DelegateThread& thread, std::chr
 /// @param[in] timeout The duration to wait for the function to complete before returning.
 /// @return A `DelegateMemberAsyncWait` object bound to the specified non-const member function, thread, and timeout.
 template <class TClass, class RetType, class... Args>
-auto MakeDelegate(TClass* object, RetType(TClass::*func)(Args... args), DelegateThread& thread, std::chrono::milliseconds timeout) {
+auto MakeDelegate(TClass* object, RetType(TClass::*func)(Args... args), DelegateThread& thread, std::chrono::nanoseconds timeout) {
     return DelegateMemberAsyncWait<TClass, RetType(Args...)>(object, func, thread, timeout);
 }
 
@@ -1198,7 +1423,7 @@ auto MakeDelegate(TClass* object, RetType(TClass::*func)(Args... args), Delegate
 /// @param[in] timeout The duration to wait for the function to complete before returning.
 /// @return A `DelegateMemberAsyncWait` object bound to the specified const member function, thread, and timeout.
 template <class TClass, class RetType, class... Args>
-auto MakeDelegate(TClass* object, RetType(TClass::*func)(Args... args) const, DelegateThread& thread, std::chrono::milliseconds timeout) {
+auto MakeDelegate(TClass* object, RetType(TClass::*func)(Args... args) const, DelegateThread& thread, std::chrono::nanoseconds timeout) {
     return DelegateMemberAsyncWait<TClass, RetType(Args...)>(object, func, thread, timeout);
 }
 
@@ -1212,7 +1437,7 @@ auto MakeDelegate(TClass* object, RetType(TClass::*func)(Args... args) const, De
 /// @param[in] timeout The duration to wait for the function to complete before returning.
 /// @return A `DelegateMemberAsyncWait` object bound to the specified non-const member function.
 template <class TClass, class RetType, class... Args>
-auto MakeDelegate(const TClass* object, RetType(TClass::* func)(Args... args) const, DelegateThread& thread, std::chrono::milliseconds timeout) {
+auto MakeDelegate(const TClass* object, RetType(TClass::* func)(Args... args) const, DelegateThread& thread, std::chrono::nanoseconds timeout) {
     return DelegateMemberAsyncWait<const TClass, RetType(Args...)>(object, func, thread, timeout);
 }
 
@@ -1227,7 +1452,7 @@ auto MakeDelegate(const TClass* object, RetType(TClass::* func)(Args... args) co
 /// @param[in] timeout The duration to wait for the function to complete before returning.
 /// @return A `DelegateMemberAsyncWait` shared pointer bound to the specified non-const member function, thread, and timeout.
 template <class TClass, class RetVal, class... Args>
-auto MakeDelegate(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args... args), DelegateThread& thread, std::chrono::milliseconds timeout) {
+auto MakeDelegate(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args... args), DelegateThread& thread, std::chrono::nanoseconds timeout) {
     return DelegateMemberAsyncWait<TClass, RetVal(Args...)>(object, func, thread, timeout);
 }
 
@@ -1241,7 +1466,7 @@ auto MakeDelegate(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args...
 /// @param[in] timeout The duration to wait for the function to complete before returning.
 /// @return A `DelegateMemberAsyncWait` shared pointer bound to the specified const member function, thread, and timeout.
 template <class TClass, class RetVal, class... Args>
-auto MakeDelegate(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args... args) const, DelegateThread& thread, std::chrono::milliseconds timeout) {
+auto MakeDelegate(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args... args) const, DelegateThread& thread, std::chrono::nanoseconds timeout) {
     return DelegateMemberAsyncWait<TClass, RetVal(Args...)>(object, func, thread, timeout);
 }
 
@@ -1253,10 +1478,23 @@ auto MakeDelegate(std::shared_ptr<TClass> object, RetVal(TClass::* func)(Args...
 /// @param[in] timeout The duration to wait for the function to complete before returning.
 /// @return A `DelegateFunctionAsyncWait` object bound to the specified `std::function`, thread, and timeout.
 template <class RetType, class... Args>
-auto MakeDelegate(std::function<RetType(Args...)> func, DelegateThread& thread, std::chrono::milliseconds timeout) {
+auto MakeDelegate(std::function<RetType(Args...)> func, DelegateThread& thread, std::chrono::nanoseconds timeout) {
     return DelegateFunctionAsyncWait<RetType(Args...)>(func, thread, timeout);
 }
 
+/// @brief Creates an asynchronous delegate that binds to a lambda or other callable object
+/// with one non-template `operator()`, with a wait and timeout. The callable is stored
+/// inline if it fits within `DELEGATE_FUNCTION_SIZE` bytes.
+/// @tparam F The callable type. The delegate signature is that of `F::operator()`.
+/// @param[in] func The callable to bind to the delegate.
+/// @param[in] thread The `DelegateThread` on which the function will be invoked asynchronously.
+/// @param[in] timeout The duration to wait for the function to complete before returning.
+/// @return A `DelegateFunctionAsyncWait` object bound to the specified callable, thread, and timeout.
+template <class F, class = std::enable_if_t<is_deducible_function_target<F>::value>>
+auto MakeDelegate(F&& func, DelegateThread& thread, std::chrono::nanoseconds timeout) {
+    return DelegateFunctionAsyncWait<typename callable_signature<std::decay_t<F>>::type>(std::forward<F>(func), thread, timeout);
+}
+
 } 
 
 #endif
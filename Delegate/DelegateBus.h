@@ -0,0 +1,249 @@
+#ifndef _DELEGATE_BUS_H
+#define _DELEGATE_BUS_H
+
+/// @file
+/// @brief Topic based publish/subscribe bus built on `MulticastDelegateSafe`.
+///
+/// @details A `Topic<>` names an event and fixes its signature. The topic ID is a
+/// hash of the name computed at compile time. A publisher and its subscribers share
+/// only the topic, not a delegate container member of the publishing subsystem.
+///
+/// `DelegateBus` routes each topic ID through a flat open addressed table to a
+/// `MulticastDelegateSafe` holding the subscribers. A table slot is filled once by the
+/// first subscriber and never cleared, so `Publish()` finds the subscribers with a few
+/// atomic loads and no lock, then broadcasts as `MulticastDelegateSafe` does. Each
+/// subscriber chooses its target thread by subscribing an asynchronous delegate, and
+/// a broadcast sends one message per destination thread for all of its subscribers.
+///
+/// `Subscribe()` refuses a topic whose ID collides with another topic name or whose
+/// signature differs from a topic already subscribed, and refuses new topics once the
+/// table is full. Publishing a topic with no subscribers does nothing.
+///
+/// Code example:
+///
+/// `constexpr Topic<void(std::chrono::milliseconds, size_t, size_t)> FlushTime("logdata.flush_time");`
+/// `bus.Subscribe(FlushTime, MakeDelegate(&OnFlushTime, uiThread));`
+/// `bus.Publish(FlushTime, elapsed, records, bytes);`
+
+#include "MulticastDelegateSafe.h"
+#include "DelegateTypeId.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace DelegateLib {
+
+/// @brief Hash a topic name. FNV-1a, never 0.
+/// @param[in] name The topic name.
+/// @return The topic ID.
+constexpr uint32_t TopicHash(const char* name) noexcept {
+    uint32_t hash = 2166136261u;
+    while (*name)
+        hash = (hash ^ static_cast<uint8_t>(*name++)) * 16777619u;
+    return hash ? hash : 1;
+}
+
+template <class R>
+class Topic; // Not defined
+
+/// @brief A named event with the signature of its subscribers.
+/// @tparam RetType The return type of the subscribers.
+/// @tparam Args The argument types of the subscribers.
+template <class RetType, class... Args>
+class Topic<RetType(Args...)>
+{
+public:
+    /// @brief Constructor. Evaluated at compile time for a `constexpr` topic.
+    /// @param[in] name The topic name. Must have static storage duration.
+    constexpr explicit Topic(const char* name) noexcept : m_name(name), m_id(TopicHash(name)) { }
+
+    /// @return The topic name.
+    constexpr const char* GetName() const noexcept { return m_name; }
+
+    /// @return The hash of the topic name.
+    constexpr uint32_t GetId() const noexcept { return m_id; }
+
+private:
+    const char* m_name;
+    uint32_t m_id;
+};
+
+/// @brief Routes published topics to their subscribers. Class is thread safe.
+/// @tparam Capacity The number of topics the bus holds. Must be a power of 2.
+template <size_t Capacity = 256>
+class DelegateBusT
+{
+public:
+    static_assert(Capacity && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+
+    DelegateBusT() = default;
+    DelegateBusT(const DelegateBusT&) = delete;
+    DelegateBusT& operator=(const DelegateBusT&) = delete;
+
+    /// @brief Subscribe a delegate to a topic.
+    /// @param[in] topic The topic.
+    /// @param[in] delegate The delegate invoked for each publish, e.g. bound to the
+    /// subscriber's thread with `MakeDelegate(..., thread)`. Copied.
+    /// @return The subscription passed to `Unsubscribe()`, or an empty subscription if
+    /// the topic collides with another or the bus is full.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class RetType, class... Args>
+    typename MulticastDelegateSafe<RetType(Args...)>::Subscription
+        Subscribe(const Topic<RetType(Args...)>& topic, const Delegate<RetType(Args...)>& delegate) {
+        auto subscribers = Insert<RetType(Args...)>(topic.GetId(), topic.GetName());
+        if (!subscribers)
+            return typename MulticastDelegateSafe<RetType(Args...)>::Subscription();
+        return subscribers->PushBack(delegate);
+    }
+
+    /// @brief Unsubscribe a delegate from a topic.
+    /// @param[in] topic The topic.
+    /// @param[in] subscription The subscription returned by `Subscribe()`.
+    /// @return `true` if the delegate was subscribed.
+    template <class RetType, class... Args>
+    bool Unsubscribe(const Topic<RetType(Args...)>& topic,
+        const typename MulticastDelegateSafe<RetType(Args...)>::Subscription& subscription) {
+        auto subscribers = Find<RetType(Args...)>(topic.GetId());
+        return subscribers && subscribers->Remove(subscription);
+    }
+
+    /// @brief Unsubscribe the first delegate equal to `delegate` from a topic.
+    /// @param[in] topic The topic.
+    /// @param[in] delegate The delegate to remove.
+    template <class RetType, class... Args>
+    void Unsubscribe(const Topic<RetType(Args...)>& topic, const Delegate<RetType(Args...)>& delegate) {
+        if (auto subscribers = Find<RetType(Args...)>(topic.GetId()))
+            subscribers->Remove(delegate);
+    }
+
+    /// @brief Invoke every subscriber of a topic. Lock-free; the subscribers are
+    /// invoked as a `MulticastDelegateSafe` broadcast.
+    /// @param[in] topic The topic.
+    /// @param[in] args The arguments passed to each subscriber.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class RetType, class... Args, class... Params>
+    void Publish(const Topic<RetType(Args...)>& topic, Params&&... args) {
+        if (auto subscribers = Find<RetType(Args...)>(topic.GetId()))
+            (*subscribers)(std::forward<Params>(args)...);
+    }
+
+    /// @brief Send one broadcast payload shared by every destination thread instead
+    /// of one copy per thread. See `MulticastDelegateSafe::SetSharedPayload()`.
+    /// @param[in] topic The topic. Ignored until first subscribed.
+    /// @param[in] shared `true` to share the payload.
+    template <class RetType, class... Args>
+    void SetSharedPayload(const Topic<RetType(Args...)>& topic, bool shared) {
+        if (auto subscribers = Find<RetType(Args...)>(topic.GetId()))
+            subscribers->SetSharedPayload(shared);
+    }
+
+    /// @param[in] topic The topic.
+    /// @return The number of subscribers.
+    template <class RetType, class... Args>
+    size_t GetSubscriberCount(const Topic<RetType(Args...)>& topic) const {
+        auto subscribers = Find<RetType(Args...)>(topic.GetId());
+        return subscribers ? subscribers->Size() : 0;
+    }
+
+    /// @return The number of topics ever subscribed.
+    size_t GetTopicCount() const {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        return m_entries.size();
+    }
+
+private:
+    /// The subscribers of one topic
+    struct Entry
+    {
+        virtual ~Entry() = default;
+        const char* name = nullptr;
+        const void* signature = nullptr;
+    };
+
+    template <class Signature>
+    struct TypedEntry : Entry
+    {
+        MulticastDelegateSafe<Signature> subscribers;
+    };
+
+    /// One table slot. `id` is stored after `entry` and both never change once set.
+    struct Slot
+    {
+        std::atomic<uint32_t> id{ 0 };
+        std::atomic<Entry*> entry{ nullptr };
+    };
+
+    /// Find the subscribers of a topic. Lock-free.
+    /// @param[in] id The topic ID.
+    /// @return The subscribers, or nullptr if the topic was never subscribed.
+    template <class Signature>
+    MulticastDelegateSafe<Signature>* Find(uint32_t id) const noexcept {
+        for (size_t i = 0; i < Capacity; i++) {
+            const Slot& slot = m_slots[(id + i) & (Capacity - 1)];
+            uint32_t slotId = slot.id.load(std::memory_order_acquire);
+            if (slotId == 0)
+                return nullptr;
+            if (slotId == id) {
+                Entry* entry = slot.entry.load(std::memory_order_relaxed);
+                if (entry->signature != type_id<Signature>())
+                    return nullptr;
+                return &static_cast<TypedEntry<Signature>*>(entry)->subscribers;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Find the subscribers of a topic, inserting the topic if new.
+    /// @param[in] id The topic ID.
+    /// @param[in] name The topic name.
+    /// @return The subscribers, or nullptr if the topic collides or the table is full.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class Signature>
+    MulticastDelegateSafe<Signature>* Insert(uint32_t id, const char* name) {
+        const std::lock_guard<std::mutex> lock(m_lock);
+        for (size_t i = 0; i < Capacity; i++) {
+            Slot& slot = m_slots[(id + i) & (Capacity - 1)];
+            uint32_t slotId = slot.id.load(std::memory_order_relaxed);
+            if (slotId == id) {
+                Entry* entry = slot.entry.load(std::memory_order_relaxed);
+                if (entry->signature != type_id<Signature>() || std::strcmp(entry->name, name) != 0)
+                    return nullptr;
+                return &static_cast<TypedEntry<Signature>*>(entry)->subscribers;
+            }
+            if (slotId == 0) {
+                std::unique_ptr<TypedEntry<Signature>> entry(new(std::nothrow) TypedEntry<Signature>());
+                if (!entry)
+                    BAD_ALLOC();
+                entry->name = name;
+                entry->signature = type_id<Signature>();
+                auto subscribers = &entry->subscribers;
+                m_entries.push_back(std::move(entry));
+
+                // Publish the entry before the ID a reader matches
+                slot.entry.store(m_entries.back().get(), std::memory_order_relaxed);
+                slot.id.store(id, std::memory_order_release);
+                return subscribers;
+            }
+        }
+        return nullptr;
+    }
+
+    std::array<Slot, Capacity> m_slots;
+
+    /// Owns the entries referred to by m_slots. Protected by m_lock.
+    std::vector<std::unique_ptr<Entry>> m_entries;
+
+    /// Lock serializing topic inserts. Never held by `Publish()`.
+    mutable std::mutex m_lock;
+};
+
+/// @brief A bus holding up to 256 topics
+using DelegateBus = DelegateBusT<>;
+
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef _DELEGATE_COROUTINE_H
+#define _DELEGATE_COROUTINE_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief C++20 coroutine support for delegate threads.
+///
+/// @details `co_await ResumeOn(thread)` suspends the calling coroutine and resumes it
+/// on the destination thread of control. The resumption is dispatched as a
+/// `DelegateResumeMsg` holding only the coroutine handle, so unlike an asynchronous
+/// delegate no target function is cloned and no argument tuple is built. A delegate
+/// call onto another thread is awaited by `co_await`ing the `DelegateFuture<>` returned
+/// by an `AsyncFuture` delegate; the coroutine then continues on the destination thread.
+/// A multi-step workflow spanning several threads thus runs without a thread blocked
+/// in a `DelegateAsyncWait` call. `DelegateTask` is a fire-and-forget coroutine return
+/// type for such workflows.
+///
+/// A resume message discarded by the destination thread, e.g. expired by a deadline
+/// budget or dropped by `WorkerThread::ExitThread()`, never resumes its coroutine, so
+/// the coroutine frame is leaked. The tree builds as C++17, so everything below is only
+/// compiled when coroutines are available. Configure with -DENABLE_CXX20=ON.
+///
+/// Example:
+///
+/// `DelegateTask Workflow() {`
+/// `    co_await ResumeOn(workerThread1);`
+/// `    int value = co_await MakeDelegateFuture(&Read, workerThread2).AsyncInvoke();`
+/// `    co_await ResumeOn(workerThread1);`
+/// `    Store(value);`
+/// `}`
+
+#include "DelegateMsg.h"
+#include "DelegateThread.h"
+#include "DelegateTypeId.h"
+#include "DelegatePool.h"
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#endif
+
+namespace DelegateLib {
+
+#if defined(__cpp_impl_coroutine)
+
+/// @brief Message resuming a suspended coroutine on the destination thread
+class DelegateResumeMsg : public DelegateMsg
+{
+public:
+    /// Constructor
+    /// @param[in] invoker - the shared resume invoker
+    /// @param[in] handle - the suspended coroutine
+    DelegateResumeMsg(std::shared_ptr<IDelegateInvoker> invoker, std::coroutine_handle<> handle) :
+        DelegateMsg(invoker, type_id<DelegateResumeMsg>()), m_handle(handle)
+    {
+    }
+
+    /// @return The suspended coroutine.
+    std::coroutine_handle<> GetHandle() const noexcept { return m_handle; }
+
+private:
+    std::coroutine_handle<> m_handle;
+};
+
+/// @brief Invoker shared by all resume messages. Stateless, so one instance serves
+/// every thread.
+class DelegateResumeInvoker : public IDelegateInvoker
+{
+public:
+    /// Get the shared invoker
+    /// @return The invoker instance.
+    static const std::shared_ptr<IDelegateInvoker>& Instance() {
+        static const std::shared_ptr<IDelegateInvoker> invoker = std::make_shared<DelegateResumeInvoker>();
+        return invoker;
+    }
+
+    /// Resume the coroutine of a `DelegateResumeMsg` on the destination thread
+    /// @param[in] msg - the resume message
+    /// @return `true` if the coroutine was resumed.
+    virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+        auto resumeMsg = delegate_msg_cast<DelegateResumeMsg>(msg);
+        if (resumeMsg == nullptr)
+            return false;
+        resumeMsg->GetHandle().resume();
+        return true;
+    }
+};
+
+/// @brief Awaitable returned by `ResumeOn()`
+class DelegateResumeAwaiter
+{
+public:
+    explicit DelegateResumeAwaiter(DelegateThread& thread) : m_thread(thread) {}
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        auto msg = std::allocate_shared<DelegateResumeMsg>(
+            pool_allocator<DelegateResumeMsg>(), DelegateResumeInvoker::Instance(), handle);
+        m_thread.DispatchDelegate(msg);
+    }
+    void await_resume() const noexcept {}
+
+private:
+    DelegateThread& m_thread;
+};
+
+/// Suspend the calling coroutine and resume it on a thread of control. Always
+/// dispatches, even if already on the destination thread, so the coroutine yields
+/// to the messages queued ahead of it.
+/// @param[in] thread - the destination thread
+/// @return The awaitable to `co_await`.
+inline DelegateResumeAwaiter ResumeOn(DelegateThread& thread) {
+    return DelegateResumeAwaiter(thread);
+}
+
+/// @brief Fire-and-forget coroutine return type. The coroutine starts at once on the
+/// calling thread and its frame is freed when it completes. An exception escaping
+/// the coroutine calls `std::terminate()`.
+struct DelegateTask
+{
+    struct promise_type
+    {
+        DelegateTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+#endif
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef _DELEGATE_ERROR_H
+#define _DELEGATE_ERROR_H
+
+/// @file
+/// @brief Error reporting of the delegate library with exceptions enabled or disabled.
+///
+/// @details With exceptions enabled, the library throws `std::bad_alloc` and
+/// `std::invalid_argument` as documented by each function. Built with exceptions
+/// disabled, e.g. `-fno-exceptions` or MSVC `/EHs-c-`, or with `DELEGATE_NO_EXCEPTIONS`
+/// defined, the library has no `throw`, `try` or `catch` and reports errors to the
+/// handler set by `SetDelegateErrorHandler()` instead:
+///
+/// * `DelegateError::BAD_ALLOC` and `DelegateError::INVALID_MESSAGE` are fatal. The
+///   handler is called, then `std::abort()` if the handler returns.
+/// * `DelegateError::THREAD_NOT_RUNNING` is not. The handler is called and the message
+///   dispatched to a thread not created is discarded.
+///
+/// Define `DELEGATE_NO_EXCEPTIONS` the same way for every translation unit including
+/// the library, see `ENABLE_NO_EXCEPTIONS` in CMakeLists.txt.
+
+#include <atomic>
+#include <cstdlib>
+
+#if !defined(DELEGATE_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+    #define DELEGATE_NO_EXCEPTIONS
+#endif
+
+namespace DelegateLib
+{
+
+/// Errors reported to the handler set by `SetDelegateErrorHandler()`
+enum class DelegateError
+{
+    BAD_ALLOC,              ///< Dynamic memory allocation failed. Fatal.
+    THREAD_NOT_RUNNING,     ///< A message was dispatched to a thread not created. Discarded.
+    INVALID_MESSAGE         ///< A thread received an unknown message. Fatal.
+};
+
+/// Called with each error reported while exceptions are disabled
+typedef void (*DelegateErrorHandler)(DelegateError error);
+
+namespace detail {
+    inline std::atomic<DelegateErrorHandler>& ErrorHandler() noexcept {
+        static std::atomic<DelegateErrorHandler> handler{ nullptr };
+        return handler;
+    }
+}
+
+/// @brief Set the function called with each error reported while exceptions are
+/// disabled, e.g. to log or count it. Function call is thread-safe.
+/// @param[in] handler The function to call, or `nullptr` for none.
+/// @return The previous handler.
+inline DelegateErrorHandler SetDelegateErrorHandler(DelegateErrorHandler handler) noexcept {
+    return detail::ErrorHandler().exchange(handler, std::memory_order_acq_rel);
+}
+
+/// @brief Report an error the caller recovers from.
+/// @param[in] error The error.
+inline void ReportDelegateError(DelegateError error) noexcept {
+    DelegateErrorHandler handler = detail::ErrorHandler().load(std::memory_order_acquire);
+    if (handler)
+        handler(error);
+}
+
+/// @brief Report an error the caller cannot recover from, then abort.
+/// @param[in] error The error.
+[[noreturn]] inline void DelegateFail(DelegateError error) noexcept {
+    ReportDelegateError(error);
+    std::abort();
+}
+
+}
+
+#ifdef DELEGATE_NO_EXCEPTIONS
+    // A try block always runs and its handlers never do
+    #define DELEGATE_TRY if (true)
+    #define DELEGATE_CATCH(...) else if (false)
+    #define DELEGATE_RETHROW() ((void)0)
+    #define DELEGATE_THROW(error, exception) ::DelegateLib::DelegateFail(error)
+#else
+    #define DELEGATE_TRY try
+    #define DELEGATE_CATCH(...) catch (__VA_ARGS__)
+    #define DELEGATE_RETHROW() throw
+    #define DELEGATE_THROW(error, exception) throw exception
+#endif
+
+#endif
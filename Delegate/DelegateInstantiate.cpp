@@ -0,0 +1,8 @@
+// Explicit instantiation of the delegate templates declared extern by
+// DelegateInstantiate.h.
+
+#define DELEGATE_INSTANTIATE
+#include "DelegateInstantiate.h"
+
+#define DELEGATE_DEFINE_SIGNATURE(SIG) DELEGATE_INSTANTIATE_CLASSES(, SIG)
+DELEGATE_INSTANTIATE_SIGNATURES(DELEGATE_DEFINE_SIGNATURE)
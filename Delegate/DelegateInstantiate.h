@@ -0,0 +1,46 @@
+#ifndef _DELEGATE_INSTANTIATE_H
+#define _DELEGATE_INSTANTIATE_H
+
+/// @file
+/// @brief Explicit instantiation of the delegate templates for common signatures.
+///
+/// @details Every translation unit including DelegateLib.h otherwise instantiates
+/// the delegate class templates it uses. For the signatures listed here the
+/// templates are instantiated once, in DelegateInstantiate.cpp built into the
+/// `DelegateLib` library, and other translation units only declare them `extern`.
+/// Targets linking `DelegateLib` get `DELEGATE_EXTERN_TEMPLATES` defined; without
+/// it this file declares nothing and each translation unit instantiates as before.
+///
+/// Member function delegates depend on the target class and are not listed.
+/// To add a signature, add it to DELEGATE_INSTANTIATE_SIGNATURES.
+
+#include "DelegateLib.h"
+#include <string>
+
+/// The signatures instantiated by `DelegateLib`. `X` is applied to each.
+#define DELEGATE_INSTANTIATE_SIGNATURES(X) \
+    X(void()) \
+    X(bool()) \
+    X(void(int)) \
+    X(void(const std::string&))
+
+/// The class templates instantiated for each signature
+#define DELEGATE_INSTANTIATE_CLASSES(EXTERN, SIG) \
+    EXTERN template class DelegateLib::DelegateFree<SIG>; \
+    EXTERN template class DelegateLib::DelegateFunction<SIG>; \
+    EXTERN template class DelegateLib::DelegateFreeAsync<SIG>; \
+    EXTERN template class DelegateLib::DelegateFunctionAsync<SIG>; \
+    EXTERN template class DelegateLib::DelegateFreeAsyncWait<SIG>; \
+    EXTERN template class DelegateLib::DelegateFunctionAsyncWait<SIG>; \
+    EXTERN template class DelegateLib::MulticastDelegate<SIG>; \
+    EXTERN template class DelegateLib::MulticastDelegateSafe<SIG>; \
+    EXTERN template class DelegateLib::UnicastDelegate<SIG>; \
+    EXTERN template class DelegateLib::UnicastDelegateSafe<SIG>;
+
+#if defined(DELEGATE_EXTERN_TEMPLATES) && !defined(DELEGATE_INSTANTIATE)
+#define DELEGATE_EXTERN_SIGNATURE(SIG) DELEGATE_INSTANTIATE_CLASSES(extern, SIG)
+DELEGATE_INSTANTIATE_SIGNATURES(DELEGATE_EXTERN_SIGNATURE)
+#undef DELEGATE_EXTERN_SIGNATURE
+#endif
+
+#endif
@@ -14,6 +14,7 @@
 /// or asynchronously on a user specified thread of control.
 /// 
 /// Asynchronous function calls support both non-blocking and blocking modes with a timeout. 
+/// The `AsyncFuture` variants return at once with a `DelegateFuture` for the return value.
 /// The library supports all types of target functions, including free functions, class 
 /// member functions, static class functions, lambdas, and `std::function`. It is capable of 
 /// handling any function signature, regardless of the number of arguments or return value. 
@@ -46,7 +47,7 @@
 /// forget' functionality, allowing the caller to avoid waiting or worrying about 
 /// out-of-scope stack variables being accessed by the target thread.
 /// 
-/// The `Async` and `AsyncWait` class variants may throw `std::bad_alloc` if heap allocation 
+/// The `Async`, `AsyncWait` and `AsyncFuture` class variants may throw `std::bad_alloc` if heap allocation 
 /// fails within `operator()(Args... args)`. Alternatively, define `USE_ASSERTS` to use `assert`
 /// as opposed to exceptions. All other delegate class functions do not throw exceptions.
 /// 
@@ -56,9 +57,22 @@
 /// See README.md, DETAILS.md, and source code Doxygen comments for more information.
 
 #include "DelegateOpt.h"
+#include "MulticastDelegate.h"
 #include "MulticastDelegateSafe.h"
 #include "UnicastDelegate.h"
+#include "UnicastDelegateSafe.h"
+#include "StaticDelegate.h"
 #include "DelegateAsync.h"
 #include "DelegateAsyncWait.h"
+#include "DelegateAsyncFuture.h"
+#include "DelegateAsyncCoalesce.h"
+#include "DelegateAsyncBatch.h"
+#include "DelegateAsyncReply.h"
+#include "DelegateCoroutine.h"
+#include "DispatchScope.h"
+#include "DelegateRemote.h"
+#include "DelegateRecord.h"
+#include "DelegateBus.h"
+#include "DelegateInstantiate.h"
 
 #endif
@@ -5,8 +5,12 @@
 /// @brief Delegate inter-thread message base class. 
 
 #include "Fault.h"
+#include "DelegateArgSize.h"
 #include "DelegateInvoker.h"
 #include "DelegateOpt.h"
+#include "DelegateOrigin.h"
+#include "DelegateTraceContext.h"
+#include "DelegateTypeId.h"
 #include "Semaphore.h"
 #include "make_tuple_heap.h"
 #include <tuple>
@@ -14,6 +18,8 @@
 #include <memory>
 #include <mutex>
 #include <stdexcept>
+#include <atomic>
+#include <chrono>
 
 namespace DelegateLib {
 
@@ -23,23 +29,131 @@ class DelegateMsg
 public:
 	/// Constructor
 	/// @param[in] invoker - the invoker instance the delegate is registered with.
-	DelegateMsg(std::shared_ptr<IDelegateInvoker> invoker) :
-		m_invoker(invoker)
+	/// @param[in] typeId - the type_id<>() of the most derived message class
+	/// @param[in] payloadSize - the bytes the message holds. See GetPayloadSize().
+	DelegateMsg(std::shared_ptr<IDelegateInvoker> invoker, const void* typeId = nullptr,
+		size_t payloadSize = sizeof(DelegateMsg)) :
+		m_invoker(invoker), m_typeId(typeId), m_payloadSize(payloadSize)
 	{
 	}
 
 	virtual ~DelegateMsg() = default;
 
 	/// Get the delegate invoker instance the delegate is registered with.
-	/// @return The invoker instance. 
-	std::shared_ptr<IDelegateInvoker> GetDelegateInvoker() const { return m_invoker; }
+	/// @return The invoker instance, valid while the message is held. 
+	IDelegateInvoker* GetDelegateInvoker() const { return m_invoker ? m_invoker.get() : m_borrowed; }
+
+	/// Refer to an invoker without owning it. Called by the sender before the message 
+	/// is dispatched, in place of passing the invoker to the constructor. The sender 
+	/// must keep the invoker alive until the destination thread is done with the 
+	/// message, e.g. by releasing it with a later message to an ordered thread. 
+	/// See `DelegateThread::IsOrdered()`.
+	/// @param[in] invoker - the invoker instance
+	void BorrowInvoker(IDelegateInvoker* invoker) noexcept { m_borrowed = invoker; }
+
+	/// Get the type_id<>() of the most derived message class
+	/// @return The message type identifier, or nullptr if not set.
+	const void* GetTypeId() const { return m_typeId; }
+
+	/// Cancel the message. The destination thread discards a cancelled message when
+	/// it reaches the front of the queue without calling the invoker. Called by any thread.
+	void Cancel() noexcept { m_cancelled.store(true, std::memory_order_release); }
+
+	/// Check if the message was cancelled
+	/// @return True if Cancel() was called.
+	bool IsCancelled() const noexcept { return m_cancelled.load(std::memory_order_acquire); }
+
+	/// Set the time the target function must start by. The destination thread 
+	/// discards the message if it is taken from the queue later. Called by the sender
+	/// before the message is dispatched.
+	/// @param[in] deadline - the absolute deadline, or time_point::max() for none
+	void SetDeadline(std::chrono::steady_clock::time_point deadline) noexcept { m_deadline = deadline; }
+
+	/// Get the time the target function must start by
+	/// @return The deadline, or time_point::max() if the message has none.
+	std::chrono::steady_clock::time_point GetDeadline() const noexcept { return m_deadline; }
+
+	/// Set the origin the message is attributed to, in place of the sending 
+	/// thread's origin. Called by the sender before the message is dispatched.
+	/// @param[in] origin - the origin. See DelegateOrigin.h.
+	void SetOrigin(OriginId origin) noexcept { m_origin = origin; }
+
+	/// Get the origin the message is attributed to
+	/// @return The origin, by default the sending thread's origin when created.
+	OriginId GetOrigin() const noexcept { return m_origin; }
+
+	/// Set the trace context the destination thread makes current while the 
+	/// target runs. Called by the sender before the message is dispatched.
+	/// @param[in] context - the trace context. See DelegateTraceContext.h.
+	void SetTraceContext(const TraceContext& context) noexcept { m_trace = context; }
+
+	/// Get the trace context of the call
+	/// @return The context, by default a child span of the sending thread's
+	///		trace, or a new trace subject to sampling.
+	const TraceContext& GetTraceContext() const noexcept { return m_trace; }
+
+	/// Get the bytes the message holds, charged against the byte budget of the
+	/// destination thread's queue
+	/// @return The message size plus the heap bytes owned by its argument copies.
+	///		See DelegateArgSize.h.
+	size_t GetPayloadSize() const noexcept { return m_payloadSize; }
+
+protected:
+	/// Prepare a message for reuse by a new call. Only called while no other thread
+	/// holds the message.
+	/// @param[in] invoker - the invoker instance, or nullptr to release it
+	void Rearm(std::shared_ptr<IDelegateInvoker> invoker) noexcept
+	{
+		m_invoker = std::move(invoker);
+		m_borrowed = nullptr;
+		m_cancelled.store(false, std::memory_order_relaxed);
+		m_deadline = std::chrono::steady_clock::time_point::max();
+		m_origin = GetThreadOrigin();
+		m_trace = NewSpan();
+	}
 
 private:
 	/// The IDelegateInvoker instance used to invoke the target function 
     /// on the destination thread of control
 	std::shared_ptr<IDelegateInvoker> m_invoker;
+
+	/// The invoker set by BorrowInvoker(), used if m_invoker is null
+	IDelegateInvoker* m_borrowed = nullptr;
+
+	/// The message type identifier checked before a static cast
+	const void* m_typeId;
+
+	/// Set by Cancel()
+	std::atomic<bool> m_cancelled = false;
+
+	/// Set by SetDeadline(). No deadline by default.
+	std::chrono::steady_clock::time_point m_deadline = std::chrono::steady_clock::time_point::max();
+
+	/// Set by SetOrigin(). The sending thread's origin by default.
+	OriginId m_origin = GetThreadOrigin();
+
+	/// Set by SetTraceContext(). A span of the sending thread's trace by default.
+	TraceContext m_trace = NewSpan();
+
+	/// Set by the constructor
+	const size_t m_payloadSize;
+
+public:
+	// Optional fixed block allocator for messages created on the heap using
+	// operator new(). See USE_ALLOCATOR in DelegateOpt.h.
+	XALLOCATOR
 };
 
+/// Cast a delegate message to its derived message class without RTTI
+/// @param[in] msg - the delegate message
+/// @return The derived message, or nullptr if the message is not a T. Valid 
+///		while msg is held.
+template <class T>
+T* delegate_msg_cast(const std::shared_ptr<DelegateMsg>& msg)
+{
+	return msg && msg->GetTypeId() == type_id<T>() ? static_cast<T*>(msg.get()) : nullptr;
+}
+
 }
 
 #endif
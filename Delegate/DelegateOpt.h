@@ -7,11 +7,17 @@
 // Define this macro to switch between assert or exception handling
 //#define USE_ASSERTS  // Comment this out to use asserts
 
+// Built with exceptions disabled, BAD_ALLOC() reports DelegateError::BAD_ALLOC to
+// the handler set by SetDelegateErrorHandler() and aborts. See DelegateError.h.
+#include "DelegateError.h"
+
 #ifdef USE_ASSERTS
     #include <cassert>
     // Use assert error handling. Change assert to a different error 
     // handler as required by the target application.
     #define BAD_ALLOC() assert(false && "Memory allocation failed!")
+#elif defined(DELEGATE_NO_EXCEPTIONS)
+    #define BAD_ALLOC() ::DelegateLib::DelegateFail(::DelegateLib::DelegateError::BAD_ALLOC)
 #else
     #include <new>
     // Use exception error handling
@@ -21,8 +27,12 @@
 // If USE_ASSERTS defined above, consider defining USE_ALLOCATOR to prevent 
 // std::list usage within delegate library from throwing a std::bad_alloc 
 // exception. The std_allocator calls assert if out of memory. 
+// Define USE_ALLOCATOR for every translation unit (see ENABLE_ALLOCATOR in 
+// CMakeLists.txt) since it changes the operator new() of delegate classes.
+//#define USE_ALLOCATOR
 #ifdef USE_ALLOCATOR
     // Use stl_allocator fixed block allocator for dynamic storage allocation
+    #include "xallocator.h"
     #include "xlist.h"
     #include "stl_allocator.h"
 #else
@@ -35,4 +45,10 @@
     #define XALLOCATOR
 #endif
 
+// Inline storage in bytes for the target of a DelegateFunction. A lambda whose
+// captures fit is bound, copied and invoked without dynamic allocation.
+#ifndef DELEGATE_FUNCTION_SIZE
+    #define DELEGATE_FUNCTION_SIZE 40
+#endif
+
 #endif
@@ -0,0 +1,110 @@
+#ifndef _DELEGATE_ORIGIN_H
+#define _DELEGATE_ORIGIN_H
+
+/// @file
+/// @brief Origin tags attributing delegate messages to the subsystem that sent them.
+///
+/// @details Each thread has a current origin, `NO_ORIGIN` unless set. A delegate
+/// message is tagged with the sending thread's origin when created, and
+/// `DelegateMsg::SetOrigin()` overrides the tag explicitly. A destination thread
+/// may account the work of each message to its origin, see
+/// `WorkerThread::SetOriginAccounting()`, and runs the target with the message's
+/// origin current, so the calls the target makes are attributed to the same origin.
+///
+/// Code example:
+///
+/// `static const OriginId storage = RegisterOrigin("Storage");`
+/// `OriginScope scope(storage);`
+/// `read(id);    // Dispatched as a Storage message`
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DelegateLib {
+
+/// An origin identifier returned by RegisterOrigin()
+typedef uint16_t OriginId;
+
+/// The origin of messages sent by a thread without an origin
+constexpr OriginId NO_ORIGIN = 0;
+
+/// The number of origin identifiers, including NO_ORIGIN
+constexpr size_t MAX_ORIGINS = 64;
+
+namespace detail {
+	/// The origin names indexed by identifier. Never destroyed.
+	struct OriginNames
+	{
+		std::mutex lock;
+		std::vector<std::string> names{ "unattributed" };
+	};
+
+	inline OriginNames& GetOriginNames()
+	{
+		static OriginNames* names = new OriginNames();
+		return *names;
+	}
+
+	inline OriginId& CurrentOrigin() noexcept
+	{
+		static thread_local OriginId origin = NO_ORIGIN;
+		return origin;
+	}
+}
+
+/// @brief Get the identifier of an origin name, registering it on first use.
+/// Function call is thread-safe.
+/// @param[in] name The origin name, e.g. the subsystem name.
+/// @return The identifier, or NO_ORIGIN once MAX_ORIGINS names are registered.
+inline OriginId RegisterOrigin(const std::string& name)
+{
+	detail::OriginNames& origins = detail::GetOriginNames();
+	std::lock_guard<std::mutex> lock(origins.lock);
+	for (size_t i = 1; i < origins.names.size(); i++)
+	{
+		if (origins.names[i] == name)
+			return (OriginId)i;
+	}
+	if (origins.names.size() >= MAX_ORIGINS)
+		return NO_ORIGIN;
+	origins.names.push_back(name);
+	return (OriginId)(origins.names.size() - 1);
+}
+
+/// @brief Get the name of an origin. Function call is thread-safe.
+/// @param[in] origin The origin identifier.
+/// @return The name, or an empty string if not registered.
+inline std::string GetOriginName(OriginId origin)
+{
+	detail::OriginNames& origins = detail::GetOriginNames();
+	std::lock_guard<std::mutex> lock(origins.lock);
+	return origin < origins.names.size() ? origins.names[origin] : std::string();
+}
+
+/// @brief Get the calling thread's origin
+inline OriginId GetThreadOrigin() noexcept { return detail::CurrentOrigin(); }
+
+/// @brief Set the calling thread's origin, e.g. once at the start of a subsystem's thread
+/// @param[in] origin The origin the thread's messages are tagged with.
+inline void SetThreadOrigin(OriginId origin) noexcept { detail::CurrentOrigin() = origin; }
+
+/// @brief Sets the calling thread's origin for the lifetime of the scope
+class OriginScope
+{
+public:
+	explicit OriginScope(OriginId origin) noexcept : m_previous(GetThreadOrigin()) { SetThreadOrigin(origin); }
+	~OriginScope() { SetThreadOrigin(m_previous); }
+
+private:
+	OriginScope(const OriginScope&) = delete;
+	OriginScope& operator=(const OriginScope&) = delete;
+
+	const OriginId m_previous;
+};
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef _DELEGATE_POLICY_H
+#define _DELEGATE_POLICY_H
+
+/// @file
+/// @brief Compile-time invocation policies for asynchronous delegates.
+///
+/// @details A policy intercepts the calls of a `DelegateAsync` delegate without a
+/// virtual call or a runtime check. Policies are passed after the signature, e.g.
+/// `DelegateFreeAsync<void(int), CountPolicy, TimePolicy>`, and their hooks are
+/// inlined into `operator()` and `Invoke()`. Without policies the hooks compile to
+/// nothing and the delegate is unchanged.
+///
+/// A policy derives from `DelegatePolicy` and hides the static hooks it uses:
+///
+/// * `Send(const A&... args)` is called by the source thread for each asynchronous
+/// call before a message is created. Return `false` to drop the call.
+///
+/// * `Dispatch(DelegateThread& thread, const A&... args)` is called by the source
+/// thread for each call about to be queued onto `thread`, after `Send()` and not
+/// for calls invoked inline. `RecordPolicy` in DelegateRecord.h captures the calls.
+///
+/// * `Invoke(Call&& call)` is called on the destination thread around the target
+/// function and returns what `call()` returns. A policy listed first wraps those
+/// listed after it.
+///
+/// Code example:
+///
+/// `struct CountPolicy : DelegatePolicy {`
+/// `    static inline std::atomic<uint64_t> calls{ 0 };`
+/// `    template <class Call> static decltype(auto) Invoke(Call&& call) { calls++; return call(); }`
+/// `};`
+/// `DelegateFreeAsync<void(int), CountPolicy> d(&Handler, workerThread);`
+
+#include <utility>
+
+namespace DelegateLib {
+
+class DelegateThread;
+
+/// @brief The hooks of a policy that intercepts nothing. Derive a policy from it.
+struct DelegatePolicy
+{
+    /// @brief Called by the source thread before an asynchronous call is sent.
+    /// @param[in] args The function arguments.
+    /// @return `true` to send the call, `false` to drop it.
+    template <class... A>
+    static constexpr bool Send(const A&...) noexcept { return true; }
+
+    /// @brief Called by the source thread before a call is queued onto a thread.
+    /// @param[in] thread The destination thread.
+    /// @param[in] args The function arguments.
+    template <class... A>
+    static constexpr void Dispatch(DelegateThread&, const A&...) noexcept { }
+
+    /// @brief Called by the destination thread to invoke the target function.
+    /// @param[in] call Invokes the target function, or the next policy.
+    /// @return The value returned by `call()`.
+    template <class Call>
+    static decltype(auto) Invoke(Call&& call) { return call(); }
+};
+
+/// @brief Composes policies, the first listed outermost.
+/// @tparam Policies The policies, each derived from `DelegatePolicy`.
+template <class... Policies>
+struct delegate_policies : DelegatePolicy { };
+
+template <class Policy, class... Rest>
+struct delegate_policies<Policy, Rest...>
+{
+    template <class... A>
+    static bool Send(const A&... args) {
+        return Policy::Send(args...) && delegate_policies<Rest...>::Send(args...);
+    }
+
+    template <class... A>
+    static void Dispatch(DelegateThread& thread, const A&... args) {
+        Policy::Dispatch(thread, args...);
+        delegate_policies<Rest...>::Dispatch(thread, args...);
+    }
+
+    template <class Call>
+    static decltype(auto) Invoke(Call&& call) {
+        return Policy::Invoke([&]() -> decltype(auto) { return delegate_policies<Rest...>::Invoke(call); });
+    }
+};
+
+}
+
+#endif
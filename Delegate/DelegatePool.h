@@ -0,0 +1,33 @@
+#ifndef _DELEGATE_POOL_H
+#define _DELEGATE_POOL_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Fixed block pools used to allocate asynchronous delegate messages.
+///
+/// @details Each async invocation allocates a message, which is freed by the destination 
+/// thread once the target function is invoked, and each bind allocates the delegate invoker. `pool_allocator`
+/// takes these blocks from the fixed block allocator in `xallocator.h`, so steady-state
+/// async invocation does not call `operator new()` and mostly touches only the calling
+/// thread's block cache. Use with `std::allocate_shared()` to place the object and its
+/// control block in one block. A message allocated with `pool_allocator<T>(node)` is
+/// placed on the NUMA node of the destination thread, see `DelegateThread::GetNumaNode()`.
+/// A thread returning a resource from `DelegateThread::GetMemoryResource()` has its 
+/// messages allocated with `pool_allocator<T>(resource)` from that resource instead.
+
+#include "stl_allocator.h"
+
+namespace DelegateLib
+{
+
+/// @brief A standard allocator for the messages and invokers of asynchronous
+/// delegates. See `stl_allocator`.
+/// @tparam T The allocated type.
+template <class T>
+using pool_allocator = stl_allocator<T>;
+
+}
+
+#endif
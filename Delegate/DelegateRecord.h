@@ -0,0 +1,296 @@
+#ifndef _DELEGATE_RECORD_H
+#define _DELEGATE_RECORD_H
+
+/// @file
+/// @brief Capture and replay of the calls dispatched to a thread.
+///
+/// @details A `DelegateRecorder` captures asynchronous calls into a compact binary
+/// trace. Each record holds the remote function id of the target, the time the call
+/// was dispatched and the arguments serialized as by `DelegateRemote<>`. A delegate
+/// opts in at compile time with `RecordPolicy<Id>`. Its calls are captured while
+/// the destination thread has a recorder attached, e.g. with
+/// `WorkerThread::SetRecorder()`. A delegate without the policy, or a thread without
+/// a recorder, costs nothing extra.
+///
+/// A `DelegateReplay` later re-drives the trace. It invokes the delegates registered
+/// under the recorded ids, at the original rate, faster, or as fast as possible.
+/// Register async delegates onto the subsystem's thread to reproduce a production
+/// workload against it or to benchmark a fix.
+///
+/// Recorded arguments must be types `remote_arg` serializes. The replayed target
+/// functions must return `void`. A trace uses the host byte order and type layout.
+///
+/// Code example:
+///
+/// `// Capture`
+/// `DelegateMemberAsync<Logger, void(const std::string&), RecordPolicy<LOG_WRITE_ID>> write(&logger, &Logger::Write, loggerThread);`
+/// `DelegateRecorder recorder(1024 * 1024);`
+/// `loggerThread.SetRecorder(&recorder);`
+/// `...`
+/// `loggerThread.SetRecorder(nullptr);`
+/// `recorder.Save("capture.trace");`
+/// `// Replay at twice the original rate`
+/// `DelegateReplay replay;`
+/// `replay.Load("capture.trace");`
+/// `replay.Register(LOG_WRITE_ID, MakeDelegate(&logger, &Logger::Write, loggerThread));`
+/// `replay.Run(2.0);`
+
+#include "DelegatePolicy.h"
+#include "DelegateRemote.h"
+#include "DelegateThread.h"
+#include "Clock.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace DelegateLib {
+
+/// @brief The header of each trace record. The serialized arguments follow.
+struct DelegateRecordHeader
+{
+    /// Nanoseconds from the start of the capture until the call was dispatched
+    uint64_t time;
+
+    /// The remote function id of the target
+    uint32_t id;
+
+    /// The serialized argument size in bytes
+    uint32_t size;
+};
+
+/// @brief Captures dispatched calls into a fixed capacity trace buffer. Any number of
+/// source threads record concurrently without a lock. Records past the capacity are
+/// counted and dropped.
+class DelegateRecorder
+{
+public:
+    /// The first bytes of a saved trace
+    static constexpr uint32_t MAGIC = 0x31545244; // "DRT1"
+
+    /// @brief Constructor. The capture starts now.
+    /// @param[in] capacity The trace buffer size in bytes.
+    /// @throws std::bad_alloc If dynamic memory allocation fails.
+    explicit DelegateRecorder(size_t capacity) :
+        m_buffer(new unsigned char[capacity]), m_capacity(capacity), m_start(Clock::Now()) { }
+
+    /// @brief Record a call. Called by the source thread, see `RecordPolicy`.
+    /// @param[in] id The remote function id of the target.
+    /// @param[in] args The function arguments.
+    template <class... A>
+    void Record(uint32_t id, const A&... args) noexcept {
+        size_t argsSize = (size_t(0) + ... + remote_arg<A>::Size(args));
+        size_t size = sizeof(DelegateRecordHeader) + argsSize;
+
+        // Reserve the record within the buffer
+        size_t pos = m_reserved.load(std::memory_order_relaxed);
+        do {
+            if (size > m_capacity - pos) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        } while (!m_reserved.compare_exchange_weak(pos, pos + size, std::memory_order_relaxed));
+
+        DelegateRecordHeader header;
+        header.time = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            Clock::Now() - m_start).count());
+        header.id = id;
+        header.size = static_cast<uint32_t>(argsSize);
+        unsigned char* dst = m_buffer.get() + pos;
+        memcpy(dst, &header, sizeof(header));
+        dst += sizeof(header);
+        ((dst = remote_arg<A>::Write(dst, args)), ...);
+
+        m_committed.fetch_add(size, std::memory_order_release);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// @brief Check that no record is being written. Records written concurrently
+    /// complete out of order, so read the trace once complete.
+    /// @return `true` if every reserved record is written.
+    bool IsComplete() const noexcept {
+        return m_committed.load(std::memory_order_acquire) == m_reserved.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Get the trace. Records are in reservation order, which may differ
+    /// slightly from time order between source threads.
+    /// @return The trace bytes. Valid until `Clear()`.
+    /// @pre `IsComplete()` returns `true`.
+    const unsigned char* GetData() const noexcept { return m_buffer.get(); }
+
+    /// @brief Get the trace size.
+    /// @return The number of bytes written.
+    size_t GetSize() const noexcept { return m_committed.load(std::memory_order_acquire); }
+
+    /// @brief Get the number of recorded calls.
+    uint64_t GetCount() const noexcept { return m_count.load(std::memory_order_relaxed); }
+
+    /// @brief Get the number of calls dropped once the buffer was full.
+    uint64_t GetDropped() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+
+    /// @brief Save the trace to a file.
+    /// @param[in] path The file to write.
+    /// @return `true` if written.
+    /// @pre `IsComplete()` returns `true`.
+    bool Save(const std::string& path) const {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file)
+            return false;
+        uint32_t magic = MAGIC;
+        size_t size = GetSize();
+        bool written = fwrite(&magic, sizeof(magic), 1, file) == 1 &&
+            (size == 0 || fwrite(m_buffer.get(), size, 1, file) == 1);
+        return fclose(file) == 0 && written;
+    }
+
+    /// @brief Discard the trace and restart the capture. Must not be called while
+    /// a source thread records.
+    void Clear() noexcept {
+        m_reserved.store(0, std::memory_order_relaxed);
+        m_committed.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_dropped.store(0, std::memory_order_relaxed);
+        m_start = Clock::Now();
+    }
+
+private:
+    DelegateRecorder(const DelegateRecorder&) = delete;
+    DelegateRecorder& operator=(const DelegateRecorder&) = delete;
+
+    std::unique_ptr<unsigned char[]> m_buffer;
+    const size_t m_capacity;
+
+    /// Time zero of the record timestamps
+    Clock::time_point m_start;
+
+    /// Bytes reserved by source threads and bytes written
+    std::atomic<size_t> m_reserved{ 0 };
+    std::atomic<size_t> m_committed{ 0 };
+
+    std::atomic<uint64_t> m_count{ 0 };
+    std::atomic<uint64_t> m_dropped{ 0 };
+};
+
+/// @brief A delegate policy capturing each call queued onto a thread with a recorder.
+/// @tparam Id The remote function id recorded for the target.
+template <uint32_t Id>
+struct RecordPolicy : DelegatePolicy
+{
+    template <class... A>
+    static void Dispatch(DelegateThread& thread, const A&... args) noexcept {
+        if (DelegateRecorder* recorder = thread.GetRecorder())
+            recorder->Record(Id, args...);
+    }
+};
+
+/// @brief Re-drives a captured trace into the delegates registered for its ids.
+class DelegateReplay
+{
+public:
+    /// @brief Load a trace saved by `DelegateRecorder::Save()`.
+    /// @param[in] path The file to read.
+    /// @return `true` if the file held a complete trace.
+    bool Load(const std::string& path) {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file)
+            return false;
+        uint32_t magic = 0;
+        std::vector<unsigned char> data;
+        bool read = fread(&magic, sizeof(magic), 1, file) == 1 && magic == DelegateRecorder::MAGIC;
+        unsigned char buffer[4096];
+        size_t size;
+        while (read && (size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            data.insert(data.end(), buffer, buffer + size);
+        fclose(file);
+        return read && Load(data.data(), data.size());
+    }
+
+    /// @brief Load a trace from memory, e.g. a `DelegateRecorder`. The data is copied.
+    /// @param[in] data The trace bytes.
+    /// @param[in] size The trace size in bytes.
+    /// @return `true` if the data held whole records.
+    bool Load(const unsigned char* data, size_t size) {
+        m_data.assign(data, data + size);
+        m_records.clear();
+        size_t pos = 0;
+        while (size - pos >= sizeof(DelegateRecordHeader)) {
+            DelegateRecordHeader header;
+            memcpy(&header, m_data.data() + pos, sizeof(header));
+            pos += sizeof(header);
+            if (size - pos < header.size)
+                break;
+            m_records.push_back({ header, pos });
+            pos += header.size;
+        }
+
+        // Replay in time order
+        std::stable_sort(m_records.begin(), m_records.end(), [](const Record& a, const Record& b) {
+            return a.header.time < b.header.time;
+        });
+        return pos == size;
+    }
+
+    /// @brief Register the delegate invoked for a recorded id. An async delegate
+    /// re-drives the call onto its thread.
+    /// @param[in] id The remote function id.
+    /// @param[in] target The delegate to invoke. Copied.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class... Args>
+    void Register(uint32_t id, const Delegate<void(Args...)>& target) {
+        m_registry.Register(id, target);
+    }
+
+    /// @brief Replay the trace on the calling thread.
+    /// @param[in] speed The rate relative to the capture, e.g. 2.0 for twice as
+    /// fast, or 0 to replay without waiting.
+    /// @return The number of calls invoked. Records of unregistered ids or with
+    /// mismatched arguments are skipped and counted by `GetSkipped()`.
+    size_t Run(double speed = 1.0) {
+        size_t invoked = 0;
+        m_skipped = 0;
+        auto start = Clock::Now();
+        for (const Record& record : m_records) {
+            if (speed > 0) {
+                auto offset = std::chrono::nanoseconds(static_cast<int64_t>(record.header.time / speed));
+                auto deadline = start + std::chrono::duration_cast<Clock::time_point::duration>(offset);
+                if (deadline > Clock::Now())
+                    std::this_thread::sleep_until(Clock::ToSteady(deadline));
+            }
+            if (m_registry.Invoke(record.header.id, m_data.data() + record.offset, record.header.size))
+                invoked++;
+            else
+                m_skipped++;
+        }
+        return invoked;
+    }
+
+    /// @brief Get the number of loaded records.
+    size_t GetCount() const noexcept { return m_records.size(); }
+
+    /// @brief Get the number of records the last `Run()` skipped.
+    size_t GetSkipped() const noexcept { return m_skipped; }
+
+private:
+    struct Record
+    {
+        DelegateRecordHeader header;
+
+        /// The offset of the serialized arguments within m_data
+        size_t offset;
+    };
+
+    std::vector<unsigned char> m_data;
+    std::vector<Record> m_records;
+    DelegateRemoteRegistry m_registry;
+    size_t m_skipped = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef _DELEGATE_REMOTE_H
+#define _DELEGATE_REMOTE_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Delegate invoking a target function within another process.
+///
+/// @details `DelegateRemote<>` sends a call to a remote function identified by a
+/// numeric id. Invoking it dispatches a `DelegateRemoteMsg` to a transport thread, such
+/// as `ShmDelegateThread`, which serializes the arguments straight from the caller into
+/// its transport. The receiving process deserializes the arguments with
+/// `remote_invoke()` and calls the delegate registered under the same id, which may
+/// itself be an asynchronous delegate onto a local thread.
+///
+/// The message refers to the caller's arguments rather than copying them, so the
+/// transport thread must serialize the message within `DispatchDelegate()`. A
+/// `DelegateRemote<>` is not bound to a `WorkerThread` or another queueing thread.
+///
+/// Arguments must be trivially copyable types other than pointers, sent byte for byte,
+/// or `std::string`, sent length prefixed. Both processes must agree on the layout
+/// of every argument type. The target function return type must be `void`.
+///
+/// Code example:
+///
+/// `// Sending process`
+/// `DelegateRemote<void(int, const std::string&)> remote(LOG_WRITE_ID, shmThread);`
+/// `remote(1, "Hello");`
+/// `// Receiving process`
+/// `receiver.Register(LOG_WRITE_ID, MakeDelegate(&logger, &Logger::Write, loggerThread));`
+///
+/// Transports: `ShmDelegateThread` between processes on one host, `SocketDelegateThread`
+/// between hosts over TCP. Both use `DelegateRemoteRegistry` on the receiving side.
+
+#include "Delegate.h"
+#include "DelegateThread.h"
+#include "DelegatePool.h"
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+
+namespace DelegateLib {
+
+/// @brief Serializes one remote argument type. Specialized for trivially copyable
+/// non-pointer types and `std::string`; other types do not compile.
+template <class T, class = void>
+struct remote_arg; // Not defined
+
+template <class T>
+struct remote_arg<T, std::enable_if_t<std::is_trivially_copyable_v<T> && !std::is_pointer_v<T>>>
+{
+    static size_t Size(const T&) noexcept { return sizeof(T); }
+
+    static unsigned char* Write(unsigned char* dst, const T& value) noexcept {
+        memcpy(dst, &value, sizeof(T));
+        return dst + sizeof(T);
+    }
+
+    /// @return The next read position, or nullptr if the data is truncated.
+    static const unsigned char* Read(const unsigned char* src, const unsigned char* end, T& value) noexcept {
+        if (static_cast<size_t>(end - src) < sizeof(T))
+            return nullptr;
+        memcpy(&value, src, sizeof(T));
+        return src + sizeof(T);
+    }
+};
+
+template <>
+struct remote_arg<std::string>
+{
+    static size_t Size(const std::string& value) noexcept { return sizeof(uint32_t) + value.size(); }
+
+    static unsigned char* Write(unsigned char* dst, const std::string& value) noexcept {
+        uint32_t length = static_cast<uint32_t>(value.size());
+        memcpy(dst, &length, sizeof(length));
+        memcpy(dst + sizeof(length), value.data(), length);
+        return dst + sizeof(length) + length;
+    }
+
+    /// @return The next read position, or nullptr if the data is truncated.
+    static const unsigned char* Read(const unsigned char* src, const unsigned char* end, std::string& value) {
+        uint32_t length;
+        if (static_cast<size_t>(end - src) < sizeof(length))
+            return nullptr;
+        memcpy(&length, src, sizeof(length));
+        src += sizeof(length);
+        if (static_cast<size_t>(end - src) < length)
+            return nullptr;
+        value.assign(reinterpret_cast<const char*>(src), length);
+        return src + length;
+    }
+};
+
+/// @brief Message dispatched by `DelegateRemote<>` to a transport thread. It has no
+/// invoker and is never invoked locally.
+class DelegateRemoteMsg : public DelegateMsg
+{
+public:
+    /// @param[in] id The remote function id.
+    explicit DelegateRemoteMsg(uint32_t id) :
+        DelegateMsg(nullptr, type_id<DelegateRemoteMsg>()), m_id(id) { }
+
+    /// Get the remote function id
+    uint32_t GetId() const noexcept { return m_id; }
+
+    /// Get the serialized argument size
+    /// @return The number of bytes written by `Serialize()`.
+    virtual size_t GetSize() const noexcept = 0;
+
+    /// Serialize the arguments. Only valid within `DelegateThread::DispatchDelegate()`.
+    /// @param[out] dst Storage of at least `GetSize()` bytes.
+    virtual void Serialize(unsigned char* dst) const noexcept = 0;
+
+private:
+    const uint32_t m_id;
+};
+
+/// @brief A `DelegateRemoteMsg` referring to the caller's arguments.
+/// @tparam Args The target function argument types.
+template <class... Args>
+class DelegateRemoteArgsMsg : public DelegateRemoteMsg
+{
+public:
+    DelegateRemoteArgsMsg(uint32_t id, const std::decay_t<Args>&... args) :
+        DelegateRemoteMsg(id), m_args(args...) { }
+
+    virtual size_t GetSize() const noexcept override {
+        return std::apply([](const auto&... args) {
+            return (size_t(0) + ... + remote_arg<std::decay_t<decltype(args)>>::Size(args));
+        }, m_args);
+    }
+
+    virtual void Serialize(unsigned char* dst) const noexcept override {
+        std::apply([dst](const auto&... args) mutable {
+            ((dst = remote_arg<std::decay_t<decltype(args)>>::Write(dst, args)), ...);
+        }, m_args);
+    }
+
+private:
+    /// The caller's arguments, valid while the caller is within `operator()`
+    std::tuple<const std::decay_t<Args>&...> m_args;
+};
+
+/// @brief Deserialize remote arguments and invoke a target delegate.
+/// @param[in] target The delegate to invoke.
+/// @param[in] data The serialized arguments.
+/// @param[in] size The serialized argument size in bytes.
+/// @return `true` if the data held exactly the arguments and the target was invoked.
+template <class... Args>
+bool remote_invoke(Delegate<void(Args...)>& target, const unsigned char* data, size_t size) {
+    std::tuple<std::decay_t<Args>...> args;
+    const unsigned char* end = data + size;
+    const unsigned char* pos = data;
+    std::apply([&](auto&... arg) {
+        ((pos = pos ? remote_arg<std::decay_t<decltype(arg)>>::Read(pos, end, arg) : nullptr), ...);
+    }, args);
+    if (pos != end)
+        return false;
+    std::apply(target, args);
+    return true;
+}
+
+/// @brief The delegates invoked by a receiving process, keyed on remote function id.
+class DelegateRemoteRegistry
+{
+public:
+    /// @brief Register the delegate invoked for a remote function id. An async delegate
+    /// forwards the call onto a local thread. Not thread safe; register before receiving.
+    /// @param[in] id The remote function id.
+    /// @param[in] target The delegate to invoke. Copied.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class... Args>
+    void Register(uint32_t id, const Delegate<void(Args...)>& target) {
+        std::shared_ptr<Delegate<void(Args...)>> targetClone(target.Clone());
+        if (!targetClone)
+            BAD_ALLOC();
+        m_targets[id] = [targetClone](const unsigned char* data, size_t size) {
+            return remote_invoke(*targetClone, data, size);
+        };
+    }
+
+    /// @brief Invoke the delegate registered for a remote call.
+    /// @param[in] id The remote function id.
+    /// @param[in] data The serialized arguments.
+    /// @param[in] size The serialized argument size in bytes.
+    /// @return `true` if a delegate is registered for `id` and the data held its arguments.
+    bool Invoke(uint32_t id, const unsigned char* data, size_t size) const {
+        auto target = m_targets.find(id);
+        return target != m_targets.end() && target->second(data, size);
+    }
+
+private:
+    std::unordered_map<uint32_t, std::function<bool(const unsigned char*, size_t)>> m_targets;
+};
+
+template <class R>
+class DelegateRemote; // Not defined
+
+/// @brief Invokes a remote function by dispatching its arguments to a transport thread.
+/// @tparam Args The argument types of the remote function.
+template <class... Args>
+class DelegateRemote<void(Args...)> : public Delegate<void(Args...)> {
+public:
+    using ClassType = DelegateRemote<void(Args...)>;
+    using MsgType = DelegateRemoteArgsMsg<Args...>;
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] id The remote function id registered by the receiving process.
+    /// @param[in] thread The transport thread serializing the call.
+    DelegateRemote(uint32_t id, DelegateThread& thread) noexcept : m_id(id), m_thread(&thread) { }
+
+    DelegateRemote(const ClassType& rhs) = default;
+    ClassType& operator=(const ClassType& rhs) = default;
+    DelegateRemote() = default;
+
+    /// @brief Bind a remote function.
+    /// @param[in] id The remote function id registered by the receiving process.
+    /// @param[in] thread The transport thread serializing the call.
+    void Bind(uint32_t id, DelegateThread& thread) noexcept {
+        m_id = id;
+        m_thread = &thread;
+    }
+
+    /// @brief Creates a copy of the current object.
+    /// @return A pointer to a new `ClassType` instance.
+    /// @post The caller is responsible for deleting the clone object.
+    virtual ClassType* Clone() const override {
+        return new(std::nothrow) ClassType(*this);
+    }
+
+    /// @brief Creates a copy of the current object within caller supplied storage.
+    /// @param[in] buffer Storage aligned to `alignof(std::max_align_t)`.
+    /// @param[in] size The storage size in bytes.
+    /// @return A pointer to the `ClassType` copy within `buffer`, or `nullptr` if it does not fit.
+    /// @post The caller is responsible for calling the copy's destructor. Do not delete it.
+    virtual ClassType* CloneTo(void* buffer, size_t size) const override {
+        if (size < sizeof(ClassType) || alignof(ClassType) > alignof(std::max_align_t))
+            return nullptr;
+        return new(buffer) ClassType(*this);
+    }
+
+    virtual size_t CloneSize() const override { return sizeof(ClassType); }
+
+    /// @brief Send the call to the remote function. Returns once the transport thread
+    /// has serialized the arguments.
+    /// @param[in] args The function arguments, if any.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    virtual void operator()(Args... args) override {
+        if (Empty())
+            return;
+
+        auto msg = std::allocate_shared<MsgType>(pool_allocator<MsgType>(), m_id, args...);
+        if (!msg)
+            BAD_ALLOC();
+        m_thread->DispatchDelegate(msg);
+    }
+
+    /// @brief Send the call to the remote function.
+    /// @param[in] args The function arguments, if any.
+    void AsyncInvoke(Args... args) {
+        operator()(std::forward<Args>(args)...);
+    }
+
+    /// @brief Clear the target function.
+    virtual void operator=(std::nullptr_t) noexcept { Clear(); }
+
+    /// @brief Check if this delegate is of a type or derived from it.
+    /// @param[in] typeId The `type_id<>()` of the type.
+    /// @return `true` if this delegate is the type or derives from it.
+    virtual bool IsType(const void* typeId) const noexcept override {
+        return typeId == type_id<ClassType>();
+    }
+
+    /// @brief Compares two delegate objects for equality. Equal if bound to the same
+    /// remote function id and transport thread.
+    /// @param[in] rhs The `DelegateBase` object to compare with the current object.
+    /// @return `true` if the two delegate objects are equal, `false` otherwise.
+    virtual bool Equal(const DelegateBase& rhs) const override {
+        auto derivedRhs = delegate_cast<ClassType>(&rhs);
+        return derivedRhs && m_id == derivedRhs->m_id && m_thread == derivedRhs->m_thread;
+    }
+
+    /// Overload operator== to compare the delegate to nullptr
+    /// @return `true` if delegate is null.
+    virtual bool operator==(std::nullptr_t) const noexcept override { return Empty(); }
+
+    /// Overload operator!= to compare the delegate to nullptr
+    /// @return `true` if delegate is not null.
+    virtual bool operator!=(std::nullptr_t) const noexcept override { return !Empty(); }
+
+    /// @brief Get the remote function id.
+    /// @return The remote function id.
+    uint32_t GetId() const noexcept { return m_id; }
+
+    /// @brief Check if the delegate is bound to a transport thread.
+    /// @return `true` if the delegate is not bound.
+    bool Empty() const noexcept { return m_thread == nullptr; }
+
+    /// @brief Clear the target function.
+    void Clear() noexcept { m_thread = nullptr; }
+
+    /// @brief Implicit conversion operator to `bool`.
+    /// @return `true` if the object is not empty, `false` if the object is empty.
+    explicit operator bool() const noexcept { return !Empty(); }
+
+private:
+    /// The remote function id
+    uint32_t m_id = 0;
+
+    /// The transport thread, or nullptr if empty
+    DelegateThread* m_thread = nullptr;
+};
+
+}
+
+#endif
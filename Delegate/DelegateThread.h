@@ -2,9 +2,16 @@
 #define _DELEGATE_THREAD_H
 
 #include "DelegateMsg.h"
+#include <memory>
+#include <cstddef>
+#include <chrono>
+#include <memory_resource>
 
 namespace DelegateLib {
 
+class DelegateRecorder;
+class DelegateWaitStats;
+
 /// @file
 /// @brief A base class for a delegate enabled execution thread. 
 /// 
@@ -26,6 +33,73 @@ public:
 	/// @pre Caller *must* create the DelegateMsg argument dynamically.
 	/// @post The destination thread calls DelegateInvoke().
 	virtual void DispatchDelegate(std::shared_ptr<DelegateMsg> msg) = 0;
+
+	/// Dispatch several DelegateMsgs onto this thread in order. The default 
+	/// implementation calls `DispatchDelegate()` for each message. Implementers
+	/// may override to queue the whole batch with one lock and a single wakeup.
+	/// @param[in] msgs - the callback messages. The messages are moved from.
+	/// @param[in] count - the number of messages
+	virtual void DispatchDelegates(std::shared_ptr<DelegateMsg>* msgs, size_t count)
+	{
+		for (size_t i = 0; i < count; i++)
+			DispatchDelegate(std::move(msgs[i]));
+	}
+
+	/// Dispatch a DelegateMsg onto this thread once a due time is reached, e.g. 
+	/// by `DelegateAsync::AsyncInvokeAfter()`. Implementers hold the message in a 
+	/// timer structure of their own and invoke it once the installed `Clock` reaches 
+	/// the due time. The default implementation returns `false` without 
+	/// dispatching.
+	/// @param[in] msg - the callback message. Must be created dynamically.
+	/// @param[in] due - the `Clock::Now()` time to invoke the message at. A time 
+	///		already passed invokes the message as soon as possible.
+	/// @return `true` if the message is scheduled, `false` if the thread does not 
+	///		support scheduled dispatch.
+	virtual bool DispatchDelegateAt(std::shared_ptr<DelegateMsg> msg, std::chrono::steady_clock::time_point due)
+	{
+		(void)msg;
+		(void)due;
+		return false;
+	}
+
+	/// Check if an asynchronous delegate call targeting this thread may invoke the 
+	/// target function directly on the calling thread instead of dispatching. 
+	/// Implementers return `true` only when the caller already runs on this thread 
+	/// and the thread opted in. The default implementation returns `false`.
+	/// @return `true` to invoke the target function inline.
+	virtual bool IsInlineCall() const { return false; }
+
+	/// Check if the thread handles messages in dispatch order. Implementers return 
+	/// `true` only when a message dispatched after `DispatchDelegate()` returned for 
+	/// another is always invoked or discarded after it, e.g. a single FIFO queue. 
+	/// Lets a message borrow an invoker released by a later message. The default 
+	/// implementation returns `false`.
+	/// @return `true` if messages are handled in dispatch order.
+	virtual bool IsOrdered() const { return false; }
+
+	/// Get the NUMA node the thread is placed on. Messages dispatched to the thread 
+	/// are allocated from memory local to the node. The default implementation 
+	/// returns -1.
+	/// @return The NUMA node, or -1 for none.
+	virtual int GetNumaNode() const { return -1; }
+
+	/// Get the memory resource the messages dispatched to the thread are allocated 
+	/// from, e.g. a pool owned by the thread. The resource must outlive every message 
+	/// dispatched to the thread. The default implementation returns `nullptr`.
+	/// @return The resource, or `nullptr` for the fixed block allocator.
+	virtual std::pmr::memory_resource* GetMemoryResource() const { return nullptr; }
+
+	/// Get the recorder capturing the calls dispatched to the thread. Only 
+	/// delegates with a `RecordPolicy` are captured, see DelegateRecord.h. The 
+	/// default implementation returns `nullptr`.
+	/// @return The recorder, or `nullptr` if not capturing.
+	virtual DelegateRecorder* GetRecorder() const { return nullptr; }
+
+	/// Get the statistics of the blocking asynchronous calls dispatched to the 
+	/// thread, see DelegateWaitStats.h. The default implementation returns 
+	/// `nullptr`.
+	/// @return The statistics, or `nullptr` if not collected.
+	virtual DelegateWaitStats* GetWaitStats() const { return nullptr; }
 };
 
 }
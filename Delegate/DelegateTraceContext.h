@@ -0,0 +1,143 @@
+#ifndef _DELEGATE_TRACE_CONTEXT_H
+#define _DELEGATE_TRACE_CONTEXT_H
+
+/// @file
+/// @brief Trace context carried by delegate messages across threads, with head sampling.
+///
+/// @details Each thread has a current trace context, not sampled unless set. A
+/// delegate message created on a thread within a sampled trace carries a child
+/// span of the thread's context, and the destination thread makes the message's
+/// context current while the target runs. The calls the target makes then carry
+/// the same trace, so a chain of calls across threads shares one trace ID, and
+/// `Logger` tags the records written within a sampled call with it. Each span
+/// records the trace's start time, so every hop knows the time since the head.
+///
+/// A message created outside a sampled trace starts a new trace 1 in N times,
+/// with N set by `SetTraceSampling()`. Sampling is off by default, which costs a
+/// thread local read and a relaxed load per message. `StartTrace()` makes the
+/// sampling decision explicitly at the head of a request instead.
+///
+/// Code example:
+///
+/// `SetTraceSampling(1000);`
+/// `TraceContextScope scope(StartTrace());`
+/// `store(id);    // Sampled 1 in 1000 requests`
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+
+namespace DelegateLib {
+
+/// @brief The trace and span a call belongs to
+struct TraceContext
+{
+	/// The trace identifier, or 0 if not sampled
+	uint64_t traceId = 0;
+
+	/// The span identifier of this call
+	uint64_t spanId = 0;
+
+	/// The span identifier of the calling span, or 0 at the head of the trace
+	uint64_t parentId = 0;
+
+	/// The steady clock time the trace started, in nanoseconds since its epoch
+	int64_t startNs = 0;
+
+	/// Check if the call is sampled
+	bool IsSampled() const noexcept { return traceId != 0; }
+};
+
+namespace detail {
+	inline std::atomic<uint32_t>& TraceSampling() noexcept
+	{
+		static std::atomic<uint32_t> sampling{ 0 };
+		return sampling;
+	}
+
+	inline TraceContext& CurrentTrace() noexcept
+	{
+		static thread_local TraceContext context;
+		return context;
+	}
+
+	/// Get a new non-zero identifier, unique within the process and unlikely
+	/// to repeat across processes
+	inline uint64_t NextTraceId() noexcept
+	{
+		static const uint64_t seed = std::random_device()() * 0x100000001ull;
+		static std::atomic<uint64_t> counter{ 0 };
+		uint64_t z = seed + counter.fetch_add(1, std::memory_order_relaxed) * 0x9E3779B97F4A7C15ull;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		z ^= z >> 31;
+		return z ? z : 1;
+	}
+
+	/// Decide whether a new trace is sampled
+	inline bool SampleTrace() noexcept
+	{
+		static std::atomic<uint32_t> heads{ 0 };
+		uint32_t sampling = TraceSampling().load(std::memory_order_relaxed);
+		return sampling != 0 && heads.fetch_add(1, std::memory_order_relaxed) % sampling == 0;
+	}
+}
+
+/// @brief Sample 1 in N new traces. Function call is thread-safe.
+/// @param[in] n The sampling interval. 1 samples every trace and 0 none.
+inline void SetTraceSampling(uint32_t n) noexcept { detail::TraceSampling().store(n, std::memory_order_relaxed); }
+
+/// @brief Get the trace sampling interval set by SetTraceSampling()
+inline uint32_t GetTraceSampling() noexcept { return detail::TraceSampling().load(std::memory_order_relaxed); }
+
+/// @brief Get the calling thread's trace context
+inline const TraceContext& GetTraceContext() noexcept { return detail::CurrentTrace(); }
+
+/// @brief Start a trace, subject to sampling
+/// @return The head span if sampled, otherwise an unsampled context.
+inline TraceContext StartTrace() noexcept
+{
+	TraceContext context;
+	if (detail::SampleTrace())
+	{
+		context.traceId = detail::NextTraceId();
+		context.spanId = detail::NextTraceId();
+		context.startNs = std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+	return context;
+}
+
+/// @brief Get the context of a call the calling thread makes: a child span of
+/// the thread's trace, or a new trace subject to sampling
+inline TraceContext NewSpan() noexcept
+{
+	const TraceContext& current = detail::CurrentTrace();
+	if (!current.IsSampled())
+		return GetTraceSampling() ? StartTrace() : TraceContext();
+	TraceContext context = current;
+	context.parentId = current.spanId;
+	context.spanId = detail::NextTraceId();
+	return context;
+}
+
+/// @brief Sets the calling thread's trace context for the lifetime of the scope
+class TraceContextScope
+{
+public:
+	explicit TraceContextScope(const TraceContext& context) noexcept : m_previous(detail::CurrentTrace())
+	{
+		detail::CurrentTrace() = context;
+	}
+	~TraceContextScope() { detail::CurrentTrace() = m_previous; }
+
+private:
+	TraceContextScope(const TraceContextScope&) = delete;
+	TraceContextScope& operator=(const TraceContextScope&) = delete;
+
+	const TraceContext m_previous;
+};
+
+}
+
+#endif
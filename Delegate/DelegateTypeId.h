@@ -0,0 +1,32 @@
+#ifndef _DELEGATE_TYPE_ID_H
+#define _DELEGATE_TYPE_ID_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Compile-time type identifiers used in place of RTTI.
+///
+/// @details `type_id<T>()` returns an address unique to `T`. Delegates and delegate
+/// messages compare these identifiers and then `static_cast`, so the library needs
+/// neither `dynamic_cast` nor `typeid` and builds with RTTI disabled.
+
+namespace DelegateLib
+{
+
+/// @brief Holds one object per type whose address identifies the type
+template <class T>
+struct type_id_tag
+{
+    static constexpr char value = 0;
+};
+
+/// @brief Get the identifier of a type
+/// @tparam T The type.
+/// @return An address unique to `T`.
+template <class T>
+constexpr const void* type_id() noexcept { return &type_id_tag<T>::value; }
+
+}
+
+#endif
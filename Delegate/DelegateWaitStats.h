@@ -0,0 +1,88 @@
+#ifndef _DELEGATE_WAIT_STATS_H
+#define _DELEGATE_WAIT_STATS_H
+
+#include "Metrics.h"
+#include <chrono>
+#include <string>
+
+namespace DelegateLib {
+
+/// @file
+/// @brief Outcome and wait time statistics of the blocking asynchronous calls
+/// targeting one thread.
+///
+/// @details A `DelegateThread` returning a `DelegateWaitStats` from
+/// `GetWaitStats()` has each `DelegateAsyncWait` call dispatched to it counted
+/// in the metrics registry under the stats name:
+///
+/// * `<name>.calls` - calls dispatched to the thread
+/// * `<name>.completions` - calls whose target function ran
+/// * `<name>.timeouts` - calls the caller abandoned once its timeout expired
+/// * `<name>.overran` - completions that ended after the caller's timeout
+///   expired. The caller keeps waiting for a call the thread started.
+/// * `<name>.discarded` - abandoned calls the thread later took from its queue
+///   and discarded without invoking. Counted by `DelegateAsyncWait::Invoke()` 
+///   and by threads that drop cancelled messages before invoking them.
+/// * `<name>.wait_ns` - histogram of the time each caller waited
+///
+/// Many timeouts and discards with short waits for the completions point at
+/// timeouts set too tight. Long completion waits and overruns point at an
+/// overloaded thread.
+class DelegateWaitStats
+{
+public:
+	/// Constructor
+	/// @param[in] name - the metric name prefix, e.g. "delegate.async_wait.<thread>"
+	explicit DelegateWaitStats(const std::string& name) :
+		m_calls(Metrics::GetCounter(name + ".calls")),
+		m_completions(Metrics::GetCounter(name + ".completions")),
+		m_timeouts(Metrics::GetCounter(name + ".timeouts")),
+		m_overran(Metrics::GetCounter(name + ".overran")),
+		m_discarded(Metrics::GetCounter(name + ".discarded")),
+		m_waitTime(Metrics::GetHistogram(name + ".wait_ns"))
+	{
+	}
+
+	/// Record the outcome of a call. Called by the sending thread.
+	/// @param[in] success - true if the target function ran
+	/// @param[in] waited - the time the caller waited
+	/// @param[in] timeout - the caller's timeout, or nanoseconds::max() for none
+	void Record(bool success, std::chrono::nanoseconds waited, std::chrono::nanoseconds timeout)
+	{
+		m_calls.Add();
+		m_waitTime.Record(waited);
+		if (!success)
+		{
+			m_timeouts.Add();
+			return;
+		}
+		m_completions.Add();
+		if (waited > timeout)
+			m_overran.Add();
+	}
+
+	/// Record an abandoned call discarded by the thread. Called by the thread.
+	void Discarded() { m_discarded.Add(); }
+
+	uint64_t GetCalls() const { return m_calls.GetValue(); }
+	uint64_t GetCompletions() const { return m_completions.GetValue(); }
+	uint64_t GetTimeouts() const { return m_timeouts.GetValue(); }
+	uint64_t GetOverran() const { return m_overran.GetValue(); }
+	uint64_t GetDiscarded() const { return m_discarded.GetValue(); }
+	MetricHistogram::Summary GetWaitTime() const { return m_waitTime.GetSummary(); }
+
+private:
+	DelegateWaitStats(const DelegateWaitStats&) = delete;
+	DelegateWaitStats& operator=(const DelegateWaitStats&) = delete;
+
+	MetricCounter& m_calls;
+	MetricCounter& m_completions;
+	MetricCounter& m_timeouts;
+	MetricCounter& m_overran;
+	MetricCounter& m_discarded;
+	MetricHistogram& m_waitTime;
+};
+
+}
+
+#endif
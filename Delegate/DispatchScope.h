@@ -0,0 +1,81 @@
+#ifndef _DISPATCH_SCOPE_H
+#define _DISPATCH_SCOPE_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Defers the non-blocking async delegate calls made by the current thread
+/// and dispatches them in one batch per destination thread.
+///
+/// @details While a `DispatchScope` is alive on a thread, each `DelegateAsync` call
+/// made by that thread is collected instead of dispatched. When the scope ends the
+/// calls are handed to `DelegateThread::DispatchDelegates()`, once per destination
+/// thread, so each destination is locked and woken once for the whole scope. Calls
+/// to one destination keep their order. Blocking `AsyncWait` calls are never
+/// deferred. Scopes nest; an inner scope commits into nothing but its own batches.
+/// Unlike `DispatchBatch`, delegates need not be bound to the scope, so calls made
+/// by code that does not know about batching, e.g. timer callbacks, are batched.
+
+#include "DelegateThread.h"
+#include "DelegateMsg.h"
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace DelegateLib {
+
+class DispatchScope
+{
+public:
+    /// Start collecting the calls of the current thread
+    DispatchScope() : m_outer(Current()) { Current() = this; }
+
+    /// Dispatch the collected calls and restore the enclosing scope
+    ~DispatchScope() {
+        Current() = m_outer;
+        Commit();
+    }
+
+    /// Get the innermost scope of the current thread
+    /// @return The scope, or `nullptr` if calls are dispatched at once.
+    static DispatchScope*& Current() {
+        static thread_local DispatchScope* scope = nullptr;
+        return scope;
+    }
+
+    /// Collect a call
+    /// @param[in] thread - the destination thread
+    /// @param[in] msg - the delegate message
+    void Add(DelegateThread* thread, std::shared_ptr<DelegateMsg> msg) {
+        // Few destinations per scope, so a linear search beats a map
+        for (auto& batch : m_batches) {
+            if (batch.first == thread) {
+                batch.second.push_back(std::move(msg));
+                return;
+            }
+        }
+        m_batches.emplace_back(thread, std::vector<std::shared_ptr<DelegateMsg>>());
+        m_batches.back().second.push_back(std::move(msg));
+    }
+
+    /// Dispatch the calls collected so far, one batch per destination thread
+    void Commit() {
+        for (auto& batch : m_batches) {
+            if (!batch.second.empty())
+                batch.first->DispatchDelegates(batch.second.data(), batch.second.size());
+        }
+        m_batches.clear();
+    }
+
+private:
+    DispatchScope(const DispatchScope&) = delete;
+    DispatchScope& operator=(const DispatchScope&) = delete;
+
+    DispatchScope* m_outer;
+    std::vector<std::pair<DelegateThread*, std::vector<std::shared_ptr<DelegateMsg>>>> m_batches;
+};
+
+}
+
+#endif
@@ -0,0 +1,319 @@
+#ifndef _DELEGATELIB_LOCK_PROFILE_H
+#define _DELEGATELIB_LOCK_PROFILE_H
+
+/// @file
+/// @brief Per site lock contention profiling of the framework's blocking locks.
+///
+/// @details The framework's queue and registry locks are declared as `SiteMutex`
+/// and created with `LockSite()`, naming their site, e.g. `Logger.m_mutex`. With
+/// `LOCK_PROFILE_ENABLE` defined, see `ENABLE_LOCK_PROFILE` in CMakeLists.txt, a
+/// `SiteMutex` is a `ProfiledMutex` that records into the row of its site the
+/// acquisitions, the contended acquisitions, i.e. those that found the lock held,
+/// the time waited for the lock and the time it was held. The condition variables
+/// waiting on a site lock are `SiteCondition`, which is then a
+/// `std::condition_variable_any`. `LockProfiler::WriteReport()` prints the rows as
+/// a table sorted by any column, to find the locks that hurt under load.
+///
+/// Without `LOCK_PROFILE_ENABLE` a `SiteMutex` is a `std::mutex`, a `SiteCondition`
+/// a `std::condition_variable`, and the site name is discarded. Once compiled in,
+/// recording is on until `LockProfiler::SetEnabled(false)`. An uncontended
+/// acquisition reads the clock when acquired and released; counters are relaxed
+/// atomics.
+///
+/// Mutexes sharing a site name share one row, e.g. every `WorkerThread` of the
+/// same name.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace DelegateLib {
+
+/// @brief The totals of one lock site
+struct LockSample
+{
+	std::string name;
+
+	/// Acquisitions, and those that found the lock held
+	uint64_t acquisitions;
+	uint64_t contended;
+
+	/// Nanoseconds waiting to acquire, summed and the worst
+	uint64_t waitNs;
+	uint64_t maxWaitNs;
+
+	/// Nanoseconds held, summed and the worst
+	uint64_t holdNs;
+	uint64_t maxHoldNs;
+};
+
+/// @brief The column a report is sorted by, largest first
+enum class LockSort { ACQUISITIONS, CONTENDED, WAIT_TIME, HOLD_TIME, NAME };
+
+/// @brief The counters of one lock site. Written by any thread.
+class lock_site
+{
+public:
+	explicit lock_site(const std::string& name) : m_name(name) {}
+
+	/// Record an acquisition
+	/// @param[in] waitNs - the nanoseconds waited, or 0 if uncontended
+	/// @param[in] contended - true if the lock was held by another thread
+	void Acquired(uint64_t waitNs, bool contended)
+	{
+		m_acquisitions.fetch_add(1, std::memory_order_relaxed);
+		if (!contended)
+			return;
+		m_contended.fetch_add(1, std::memory_order_relaxed);
+		m_waitNs.fetch_add(waitNs, std::memory_order_relaxed);
+		StoreMax(m_maxWaitNs, waitNs);
+	}
+
+	/// Record a release
+	/// @param[in] holdNs - the nanoseconds the lock was held
+	void Released(uint64_t holdNs)
+	{
+		m_holdNs.fetch_add(holdNs, std::memory_order_relaxed);
+		StoreMax(m_maxHoldNs, holdNs);
+	}
+
+	/// Copy the counters
+	LockSample Sample() const
+	{
+		return LockSample{ m_name, m_acquisitions.load(std::memory_order_relaxed),
+			m_contended.load(std::memory_order_relaxed), m_waitNs.load(std::memory_order_relaxed),
+			m_maxWaitNs.load(std::memory_order_relaxed), m_holdNs.load(std::memory_order_relaxed),
+			m_maxHoldNs.load(std::memory_order_relaxed) };
+	}
+
+	/// Zero the counters
+	void Reset()
+	{
+		for (auto* counter : { &m_acquisitions, &m_contended, &m_waitNs, &m_maxWaitNs, &m_holdNs, &m_maxHoldNs })
+			counter->store(0, std::memory_order_relaxed);
+	}
+
+private:
+	lock_site(const lock_site&) = delete;
+	lock_site& operator=(const lock_site&) = delete;
+
+	static void StoreMax(std::atomic<uint64_t>& max, uint64_t value)
+	{
+		uint64_t current = max.load(std::memory_order_relaxed);
+		while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+			;
+	}
+
+	const std::string m_name;
+	std::atomic<uint64_t> m_acquisitions{ 0 };
+	std::atomic<uint64_t> m_contended{ 0 };
+	std::atomic<uint64_t> m_waitNs{ 0 };
+	std::atomic<uint64_t> m_maxWaitNs{ 0 };
+	std::atomic<uint64_t> m_holdNs{ 0 };
+	std::atomic<uint64_t> m_maxHoldNs{ 0 };
+};
+
+/// @brief The lock site registry. All functions are thread safe.
+class LockProfiler
+{
+public:
+	/// Start or stop recording
+	/// @param[in] enable - true to record
+	static void SetEnabled(bool enable) { Enabled().store(enable, std::memory_order_relaxed); }
+
+	/// Check if acquisitions are recorded
+	/// @return True if recording.
+	static bool IsEnabled() { return Enabled().load(std::memory_order_relaxed); }
+
+	/// Get the profile time
+	/// @return Nanoseconds of the steady clock.
+	static uint64_t Now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// Get the row of a site, inserting it if new. Called when a lock is created.
+	/// @param[in] name - the site name
+	/// @return The row, valid for the life of the program.
+	static lock_site* GetSite(const std::string& name)
+	{
+		Registry& registry = GetRegistry();
+		const std::lock_guard<std::mutex> lock(registry.lock);
+		auto& site = registry.sites[name];
+		if (!site)
+			site.reset(new lock_site(name));
+		return site.get();
+	}
+
+	/// Copy every row
+	/// @param[in] sort - the column to sort by, largest first
+	/// @return The rows.
+	static std::vector<LockSample> GetSamples(LockSort sort = LockSort::WAIT_TIME)
+	{
+		std::vector<LockSample> samples;
+		{
+			Registry& registry = GetRegistry();
+			const std::lock_guard<std::mutex> lock(registry.lock);
+			for (const auto& site : registry.sites)
+				samples.push_back(site.second->Sample());
+		}
+
+		auto key = [sort](const LockSample& s) {
+			switch (sort)
+			{
+			case LockSort::ACQUISITIONS: return s.acquisitions;
+			case LockSort::CONTENDED: return s.contended;
+			case LockSort::HOLD_TIME: return s.holdNs;
+			default: return s.waitNs;
+			}
+		};
+		if (sort != LockSort::NAME)
+			std::stable_sort(samples.begin(), samples.end(),
+				[&key](const LockSample& a, const LockSample& b) { return key(a) > key(b); });
+		return samples;
+	}
+
+	/// Write every site acquired at least once as a table
+	/// @param[in] out - the stream to write
+	/// @param[in] sort - the column to sort by, largest first
+	/// @return True if written.
+	static bool WriteReport(std::ostream& out, LockSort sort = LockSort::WAIT_TIME)
+	{
+		char line[160];
+		snprintf(line, sizeof(line), "%12s %10s %8s %12s %10s %12s %10s  %s\n",
+			"acquired", "contended", "percent", "wait ms", "max us", "hold ms", "max us", "site");
+		out << line;
+		for (const auto& s : GetSamples(sort))
+		{
+			if (s.acquisitions == 0)
+				continue;
+			snprintf(line, sizeof(line), "%12llu %10llu %7.2f%% %12.3f %10.3f %12.3f %10.3f  ",
+				(unsigned long long)s.acquisitions, (unsigned long long)s.contended,
+				100.0 * s.contended / s.acquisitions, s.waitNs / 1e6, s.maxWaitNs / 1e3,
+				s.holdNs / 1e6, s.maxHoldNs / 1e3);
+			out << line << s.name << "\n";
+		}
+		return out.good();
+	}
+
+	/// Zero every row. Rows are kept, as locks refer to them.
+	static void Clear()
+	{
+		Registry& registry = GetRegistry();
+		const std::lock_guard<std::mutex> lock(registry.lock);
+		for (auto& site : registry.sites)
+			site.second->Reset();
+	}
+
+private:
+	static std::atomic<bool>& Enabled()
+	{
+		static std::atomic<bool> enabled{ true };
+		return enabled;
+	}
+
+	/// Never destroyed, since static objects release their locks during exit
+	struct Registry
+	{
+		std::mutex lock;
+		std::map<std::string, std::unique_ptr<lock_site>> sites;
+	};
+
+	static Registry& GetRegistry()
+	{
+		static Registry* registry = new Registry();
+		return *registry;
+	}
+};
+
+/// @brief A mutex recording its acquisitions into the row of its site. Meets
+/// Lockable, so std::unique_lock and std::condition_variable_any use it.
+class ProfiledMutex
+{
+public:
+	/// Constructor
+	/// @param[in] site - the lock site name
+	explicit ProfiledMutex(const std::string& site) : m_site(LockProfiler::GetSite(site)) {}
+
+	void lock()
+	{
+		if (!LockProfiler::IsEnabled())
+		{
+			m_mutex.lock();
+			m_acquired = 0;
+			return;
+		}
+		if (m_mutex.try_lock())
+		{
+			m_acquired = LockProfiler::Now();
+			m_site->Acquired(0, false);
+			return;
+		}
+		uint64_t start = LockProfiler::Now();
+		m_mutex.lock();
+		m_acquired = LockProfiler::Now();
+		m_site->Acquired(m_acquired - start, true);
+	}
+
+	bool try_lock()
+	{
+		if (!m_mutex.try_lock())
+			return false;
+		m_acquired = LockProfiler::IsEnabled() ? LockProfiler::Now() : 0;
+		if (m_acquired)
+			m_site->Acquired(0, false);
+		return true;
+	}
+
+	void unlock()
+	{
+		// Written by the owner while held, so read before releasing
+		uint64_t acquired = m_acquired;
+		if (acquired)
+			m_site->Released(LockProfiler::Now() - acquired);
+		m_mutex.unlock();
+	}
+
+private:
+	ProfiledMutex(const ProfiledMutex&) = delete;
+	ProfiledMutex& operator=(const ProfiledMutex&) = delete;
+
+	std::mutex m_mutex;
+	lock_site* const m_site;
+
+	/// Time the owner acquired the lock, or 0 if not recorded
+	uint64_t m_acquired = 0;
+};
+
+#ifdef LOCK_PROFILE_ENABLE
+/// The mutex of a profiled lock site
+typedef ProfiledMutex SiteMutex;
+
+/// A condition variable waiting on a SiteMutex lock
+typedef std::condition_variable_any SiteCondition;
+
+/// Create the mutex of a lock site. Used to initialize a SiteMutex.
+/// @param[in] site - the lock site name
+inline ProfiledMutex LockSite(const std::string& site) { return ProfiledMutex(site); }
+#else
+typedef std::mutex SiteMutex;
+typedef std::condition_variable SiteCondition;
+
+// Takes the name by template so a literal is not copied into a string
+template <class Name>
+inline std::mutex LockSite(const Name&) { return std::mutex(); }
+#endif
+
+}
+
+#endif
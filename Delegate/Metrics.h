@@ -0,0 +1,358 @@
+#ifndef _DELEGATELIB_METRICS_H
+#define _DELEGATELIB_METRICS_H
+
+/// @file
+/// @brief Process wide registry of counters, gauges and latency histograms.
+///
+/// @details Subsystems look a metric up by name once, keep the reference, and
+/// update it on the hot path. Counters and histograms are sharded per thread:
+/// each thread updates its own cache line with a relaxed atomic add and the
+/// shards are summed on read. A gauge is a function polled on read, so existing
+/// counters and queue depths are published without touching the hot path.
+///
+/// `Metrics::Snapshot()` reads every metric. `MetricsExporter` (Port) takes a
+/// snapshot periodically on its own thread.
+///
+/// Code example:
+///
+/// `static MetricCounter& writes = Metrics::GetCounter("logdata.writes");`
+/// `writes.Add();`
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace DelegateLib {
+
+/// @brief Shard selection shared by all sharded metrics
+class metric_shard
+{
+public:
+	/// Number of shards. Threads beyond this share shards.
+	static const size_t COUNT = 8;
+
+	/// Get the shard of the calling thread
+	static size_t Index()
+	{
+		static std::atomic<size_t> next{ 0 };
+		thread_local size_t index = next.fetch_add(1, std::memory_order_relaxed) % COUNT;
+		return index;
+	}
+};
+
+/// @brief A monotonic counter
+class MetricCounter
+{
+public:
+	MetricCounter() = default;
+
+	/// Add to the counter. Called by any thread.
+	/// @param[in] value - the amount to add
+	void Add(uint64_t value = 1)
+	{
+		m_shards[metric_shard::Index()].value.fetch_add(value, std::memory_order_relaxed);
+	}
+
+	/// Get the sum of all shards
+	/// @return The counter value.
+	uint64_t GetValue() const
+	{
+		uint64_t sum = 0;
+		for (const auto& shard : m_shards)
+			sum += shard.value.load(std::memory_order_relaxed);
+		return sum;
+	}
+
+private:
+	MetricCounter(const MetricCounter&) = delete;
+	MetricCounter& operator=(const MetricCounter&) = delete;
+
+	struct alignas(64) Shard
+	{
+		std::atomic<uint64_t> value{ 0 };
+	};
+	Shard m_shards[metric_shard::COUNT];
+};
+
+/// @brief A log-linear histogram of values, typically nanoseconds. Each power
+/// of 2 range is split into 8 buckets so percentiles are within 12.5%.
+class MetricHistogram
+{
+public:
+	static const int SUB_BITS = 3;
+	static const int SUB_BUCKETS = 1 << SUB_BITS;
+	static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+	MetricHistogram() = default;
+
+	/// Record a value. Called by any thread.
+	/// @param[in] value - the value to record
+	void Record(uint64_t value)
+	{
+		Shard& shard = *GetShard(metric_shard::Index());
+		shard.buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+		shard.sum.fetch_add(value, std::memory_order_relaxed);
+		uint64_t max = shard.max.load(std::memory_order_relaxed);
+		while (value > max && !shard.max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	/// Record a duration in nanoseconds
+	/// @param[in] duration - the duration to record
+	void Record(std::chrono::nanoseconds duration)
+	{
+		Record(duration.count() > 0 ? (uint64_t)duration.count() : 0);
+	}
+
+	/// Summary of the recorded values aggregated across the shards
+	struct Summary
+	{
+		uint64_t count = 0;
+		uint64_t sum = 0;
+		uint64_t max = 0;
+		uint64_t p50 = 0;
+		uint64_t p90 = 0;
+		uint64_t p99 = 0;
+		uint64_t p999 = 0;
+	};
+
+	/// Aggregate the shards
+	/// @return The summary. Percentiles are bucket upper bounds.
+	Summary GetSummary() const
+	{
+		std::vector<uint64_t> buckets(BUCKETS, 0);
+		Summary summary;
+		for (size_t s = 0; s < metric_shard::COUNT; s++)
+		{
+			const Shard* shard = m_shards[s].load(std::memory_order_acquire);
+			if (!shard)
+				continue;
+			for (int i = 0; i < BUCKETS; i++)
+				buckets[i] += shard->buckets[i].load(std::memory_order_relaxed);
+			summary.sum += shard->sum.load(std::memory_order_relaxed);
+			summary.max = std::max(summary.max, shard->max.load(std::memory_order_relaxed));
+		}
+		for (uint64_t count : buckets)
+			summary.count += count;
+
+		summary.p50 = Percentile(buckets, summary.count, 50);
+		summary.p90 = Percentile(buckets, summary.count, 90);
+		summary.p99 = Percentile(buckets, summary.count, 99);
+		summary.p999 = Percentile(buckets, summary.count, 99.9);
+		return summary;
+	}
+
+	~MetricHistogram()
+	{
+		for (auto& shard : m_shards)
+			delete shard.load(std::memory_order_relaxed);
+	}
+
+private:
+	MetricHistogram(const MetricHistogram&) = delete;
+	MetricHistogram& operator=(const MetricHistogram&) = delete;
+
+	struct Shard
+	{
+		std::atomic<uint64_t> buckets[BUCKETS] = {};
+		std::atomic<uint64_t> sum{ 0 };
+		std::atomic<uint64_t> max{ 0 };
+	};
+
+	/// Get a shard, allocated by the first thread recording into it
+	Shard* GetShard(size_t index)
+	{
+		Shard* shard = m_shards[index].load(std::memory_order_acquire);
+		if (shard)
+			return shard;
+		Shard* created = new Shard();
+		if (m_shards[index].compare_exchange_strong(shard, created, std::memory_order_acq_rel))
+			return created;
+		delete created;
+		return shard;
+	}
+
+	static uint64_t Percentile(const std::vector<uint64_t>& buckets, uint64_t total, double percentile)
+	{
+		if (total == 0)
+			return 0;
+		uint64_t rank = std::min(total - 1, (uint64_t)(percentile / 100.0 * (double)total));
+		uint64_t seen = 0;
+		for (int i = 0; i < BUCKETS; i++)
+		{
+			seen += buckets[i];
+			if (seen > rank)
+				return BucketUpperBound(i);
+		}
+		return BucketUpperBound(BUCKETS - 1);
+	}
+
+	static int BucketIndex(uint64_t value)
+	{
+		if (value < SUB_BUCKETS)
+			return (int)value;
+		int exponent = 63;
+		while (!(value >> exponent))
+			exponent--;
+		int sub = (int)((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+		return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+	}
+
+	static uint64_t BucketUpperBound(int index)
+	{
+		if (index < SUB_BUCKETS)
+			return (uint64_t)index;
+		int exponent = index / SUB_BUCKETS + SUB_BITS - 1;
+		uint64_t sub = (uint64_t)(index % SUB_BUCKETS);
+		int shift = exponent - SUB_BITS;
+		return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+	}
+
+	std::atomic<Shard*> m_shards[metric_shard::COUNT] = {};
+};
+
+/// @brief One metric read by Metrics::Snapshot()
+struct MetricSample
+{
+	enum class Type { COUNTER, GAUGE, HISTOGRAM };
+
+	std::string name;
+	Type type;
+
+	/// Counter or gauge value
+	double value = 0;
+
+	/// Histogram summary
+	MetricHistogram::Summary histogram;
+};
+
+/// @brief The metrics registry. All functions are thread safe.
+class Metrics
+{
+public:
+	/// Polled for a gauge value on each snapshot
+	typedef std::function<double()> GaugeFunction;
+
+	/// Get or create a counter. The counter lives until program exit.
+	/// @param[in] name - the metric name
+	/// @return The counter.
+	static MetricCounter& GetCounter(const std::string& name)
+	{
+		const std::lock_guard<std::mutex> lock(GetLock());
+		auto& counter = GetRegistry().counters[name];
+		if (!counter)
+			counter.reset(new MetricCounter());
+		return *counter;
+	}
+
+	/// Get or create a histogram. The histogram lives until program exit.
+	/// @param[in] name - the metric name
+	/// @return The histogram.
+	static MetricHistogram& GetHistogram(const std::string& name)
+	{
+		const std::lock_guard<std::mutex> lock(GetLock());
+		auto& histogram = GetRegistry().histograms[name];
+		if (!histogram)
+			histogram.reset(new MetricHistogram());
+		return *histogram;
+	}
+
+	/// Add or replace a gauge
+	/// @param[in] name - the metric name
+	/// @param[in] gauge - the function returning the gauge value. Called with the
+	///		registry lock held so it must not use the registry.
+	static void SetGauge(const std::string& name, GaugeFunction gauge)
+	{
+		const std::lock_guard<std::mutex> lock(GetLock());
+		GetRegistry().gauges[name] = std::move(gauge);
+	}
+
+	/// Remove a gauge. Once removed the gauge function is no longer called.
+	/// @param[in] name - the metric name
+	static void RemoveGauge(const std::string& name)
+	{
+		const std::lock_guard<std::mutex> lock(GetLock());
+		GetRegistry().gauges.erase(name);
+	}
+
+	/// Read every metric in name order
+	/// @return The metric values.
+	static std::vector<MetricSample> Snapshot()
+	{
+		std::vector<MetricSample> samples;
+		const std::lock_guard<std::mutex> lock(GetLock());
+		Registry& registry = GetRegistry();
+		for (auto& counter : registry.counters)
+		{
+			samples.push_back(MetricSample{ counter.first, MetricSample::Type::COUNTER,
+				(double)counter.second->GetValue(), {} });
+		}
+		for (auto& gauge : registry.gauges)
+		{
+			samples.push_back(MetricSample{ gauge.first, MetricSample::Type::GAUGE, gauge.second(), {} });
+		}
+		for (auto& histogram : registry.histograms)
+		{
+			samples.push_back(MetricSample{ histogram.first, MetricSample::Type::HISTOGRAM, 0,
+				histogram.second->GetSummary() });
+		}
+		std::sort(samples.begin(), samples.end(),
+			[](const MetricSample& a, const MetricSample& b) { return a.name < b.name; });
+		return samples;
+	}
+
+	/// Write a snapshot as "name value" lines. A histogram writes name.count,
+	/// name.sum, name.max and its percentiles.
+	/// @param[in] out - the stream to write
+	/// @param[in] samples - the snapshot to write
+	static void WriteText(std::ostream& out, const std::vector<MetricSample>& samples)
+	{
+		for (const auto& sample : samples)
+		{
+			if (sample.type != MetricSample::Type::HISTOGRAM)
+			{
+				out << sample.name << " " << sample.value << "\n";
+				continue;
+			}
+			const auto& h = sample.histogram;
+			out << sample.name << ".count " << h.count << "\n" << sample.name << ".sum " << h.sum << "\n"
+				<< sample.name << ".max " << h.max << "\n" << sample.name << ".p50 " << h.p50 << "\n"
+				<< sample.name << ".p90 " << h.p90 << "\n" << sample.name << ".p99 " << h.p99 << "\n"
+				<< sample.name << ".p999 " << h.p999 << "\n";
+		}
+	}
+
+private:
+	struct Registry
+	{
+		std::map<std::string, std::unique_ptr<MetricCounter>> counters;
+		std::map<std::string, std::unique_ptr<MetricHistogram>> histograms;
+		std::map<std::string, GaugeFunction> gauges;
+	};
+
+	static std::mutex& GetLock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	/// Never destroyed so metrics stay valid for threads running at exit
+	static Registry& GetRegistry()
+	{
+		static Registry* registry = new Registry();
+		return *registry;
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef _MULTICAST_ASYNC_H
+#define _MULTICAST_ASYNC_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Broadcasts to the delegates of a multicast container, grouping the
+/// non-blocking asynchronous delegates by destination thread.
+///
+/// @details A `DelegateAsync` delegate invoked alone dispatches its own message with its
+/// own copy of the arguments. When two or more are bound to the same thread, the
+/// broadcast instead dispatches one message to the thread. The message carries one copy
+/// of the arguments and the invokers of all of those delegates. The destination thread
+/// calls them in container order. Reference and pointer arguments are copied once and
+/// shared by the delegates of the message.
+///
+/// The arguments are passed through the broadcast by reference. A by-value argument is
+/// copied once per synchronous delegate, into the target function's own parameter, and
+/// once per asynchronous message, which its last target moves from.
+///
+/// `BroadcastShared()` instead copies the arguments once per broadcast into an immutable
+/// payload. Every message of the broadcast, one per destination thread, references the
+/// payload, so a large reference or pointer argument fans out to any number of threads
+/// without further copies. The targets then share the argument objects concurrently and
+/// must not modify them.
+
+#include "Delegate.h"
+#include "DelegateThread.h"
+#include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include "make_tuple_inline.h"
+#include <vector>
+
+namespace DelegateLib {
+
+template <class R>
+class MulticastAsync; // Not defined
+
+/// @brief Broadcasts to delegates sending one message per destination thread.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class RetType, class... Args>
+class MulticastAsync<RetType(Args...)> : public IDelegateInvoker
+{
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+
+    /// @brief Invoke delegates. Synchronous delegates are called at once. Asynchronous
+    /// delegates are grouped into one message per destination thread.
+    /// @param[in] first The first delegate. `*first` dereferences to a delegate.
+    /// @param[in] last One past the last delegate.
+    /// @param[in] args The function arguments, if any. Referenced, not copied, by the
+    /// broadcast. A by-value argument may be moved from by its last use.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class Iterator>
+    static void Broadcast(Iterator first, Iterator last, Args&... args) {
+        Send(first, last, false, args...);
+    }
+
+    /// @brief Invoke delegates sharing one copy of the arguments between all of the
+    /// destination threads. See `Broadcast()`.
+    /// @param[in] first The first delegate. `*first` dereferences to a delegate.
+    /// @param[in] last One past the last delegate.
+    /// @param[in] args The function arguments, if any. Copied once into the payload
+    /// shared by the asynchronous delegates, which must not modify them.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    template <class Iterator>
+    static void BroadcastShared(Iterator first, Iterator last, Args&... args) {
+        Send(first, last, true, args...);
+    }
+
+    /// @brief Call every delegate of a grouped message. Called by the destination thread.
+    /// @param[in] msg The message dispatched within `Broadcast()`.
+    /// @return `true` if the message is a grouped broadcast message.
+    virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+        if (auto sharedMsg = delegate_msg_cast<SharedMsg>(msg)) {
+            for (auto& target : sharedMsg->m_targets)
+                std::apply([&target](auto&... arg) { (*target)(arg...); }, sharedMsg->m_payload->m_args);
+            return true;
+        }
+
+        auto groupMsg = delegate_msg_cast<Msg>(msg);
+        if (groupMsg == nullptr)
+            return false;
+
+        // Each target gets its own copy of a by-value argument except the last,
+        // which takes the message's copy
+        auto args = groupMsg->m_args.get();
+        auto& targets = groupMsg->m_targets;
+        for (size_t i = 0; i + 1 < targets.size(); i++)
+            std::apply([&target = targets[i]](auto&... arg) { (*target)(arg...); }, args);
+        if (!targets.empty())
+            std::apply([&target = targets.back()](auto&... arg) { (*target)(std::forward<Args>(arg)...); }, args);
+        return true;
+    }
+
+private:
+    /// An asynchronous delegate of the broadcast
+    struct Binding
+    {
+        DelegateThread* thread;
+        DelegateType* delegate;
+    };
+
+    /// The arguments of a `BroadcastShared()`, copied once. Not modified by the targets.
+    struct Payload
+    {
+        explicit Payload(Args&... args) : m_storage(args...), m_args(m_storage.get()) { }
+
+        Payload(const Payload&) = delete;
+        Payload& operator=(const Payload&) = delete;
+
+        /// The argument copies
+        inline_args<Args...> m_storage;
+
+        /// The arguments passed to each target. Reference and pointer elements
+        /// refer into m_storage.
+        std::tuple<Args...> m_args;
+    };
+
+    /// Call the synchronous delegates, then dispatch the asynchronous delegates
+    /// grouped by destination thread
+    template <class Iterator>
+    static void Send(Iterator first, Iterator last, bool shared, Args&... args) {
+        // Call the synchronous delegates and count the asynchronous ones
+        size_t asyncCount = 0;
+        for (auto it = first; it != last; ++it) {
+            DelegateType& delegate = **it;
+            if (delegate.GetAsyncThread() != nullptr)
+                asyncCount++;
+            else
+                delegate(args...);
+        }
+
+        // Nothing to group?
+        if (asyncCount < 2) {
+            for (auto it = first; asyncCount > 0 && it != last; ++it) {
+                DelegateType& delegate = **it;
+                if (delegate.GetAsyncThread() != nullptr) {
+                    // The only asynchronous delegate is the last use of the arguments
+                    delegate(std::forward<Args>(args)...);
+                    asyncCount--;
+                }
+            }
+            return;
+        }
+
+        std::shared_ptr<Payload> payload;
+        if (shared) {
+            payload = std::allocate_shared<Payload>(pool_allocator<Payload>(), args...);
+            if (!payload)
+                BAD_ALLOC();
+        }
+
+        std::vector<Binding> async;
+        async.reserve(asyncCount);
+        for (auto it = first; it != last; ++it) {
+            DelegateType& delegate = **it;
+            DelegateThread* thread = delegate.GetAsyncThread();
+            if (thread != nullptr)
+                async.push_back(Binding{ thread, &delegate });
+        }
+
+        for (size_t i = 0; i < async.size(); i++) {
+            DelegateThread* thread = async[i].thread;
+            if (thread == nullptr)
+                continue;
+
+            // Count the delegates of this thread not yet dispatched
+            size_t group = 1;
+            for (size_t j = i + 1; j < async.size(); j++)
+                group += async[j].thread == thread;
+
+            if (payload) {
+                auto msg = std::allocate_shared<SharedMsg>(pool_allocator<SharedMsg>(), GetInvoker(), payload);
+                if (!msg)
+                    BAD_ALLOC();
+                AddTargets(msg->m_targets, async, i, group);
+                thread->DispatchDelegate(msg);
+                continue;
+            }
+
+            if (group == 1) {
+                (*async[i].delegate)(args...);
+                continue;
+            }
+
+            auto msg = std::allocate_shared<Msg>(pool_allocator<Msg>(), GetInvoker(), args...);
+            if (!msg)
+                BAD_ALLOC();
+            AddTargets(msg->m_targets, async, i, group);
+            thread->DispatchDelegate(msg);
+        }
+    }
+
+    /// Move the delegates bound to the thread of `async[first]` to a message
+    /// @param[out] targets The message's synchronous invokers.
+    /// @param[in,out] async The asynchronous delegates. Those added are marked dispatched.
+    /// @param[in] first The first delegate of the thread.
+    /// @param[in] group The number of delegates of the thread.
+    static void AddTargets(std::vector<std::shared_ptr<DelegateType>>& targets, 
+        std::vector<Binding>& async, size_t first, size_t group) {
+        DelegateThread* thread = async[first].thread;
+        targets.reserve(group);
+        for (size_t j = first; j < async.size(); j++) {
+            if (async[j].thread == thread) {
+                targets.push_back(async[j].delegate->GetAsyncInvoker());
+                async[j].thread = nullptr;
+            }
+        }
+    }
+
+    /// Message invoking every delegate of one destination thread
+    class Msg : public DelegateMsg
+    {
+    public:
+        Msg(std::shared_ptr<IDelegateInvoker> invoker, Args&... args) :
+            DelegateMsg(invoker, type_id<Msg>()), m_args(args...) { }
+
+        /// A copy of each argument shared by the targets
+        inline_args<Args...> m_args;
+
+        /// The synchronous invokers of the delegates, in container order
+        std::vector<std::shared_ptr<DelegateType>> m_targets;
+    };
+
+    /// Message invoking every delegate of one destination thread with a shared payload
+    class SharedMsg : public DelegateMsg
+    {
+    public:
+        SharedMsg(std::shared_ptr<IDelegateInvoker> invoker, std::shared_ptr<Payload> payload) :
+            DelegateMsg(invoker, type_id<SharedMsg>()), m_payload(std::move(payload)) { }
+
+        /// The arguments shared by every message of the broadcast
+        std::shared_ptr<Payload> m_payload;
+
+        /// The synchronous invokers of the delegates, in container order
+        std::vector<std::shared_ptr<DelegateType>> m_targets;
+    };
+
+    /// Get the invoker of the grouped messages of this signature. It has no state.
+    static std::shared_ptr<IDelegateInvoker> GetInvoker() {
+        static std::shared_ptr<IDelegateInvoker> invoker = std::make_shared<MulticastAsync>();
+        return invoker;
+    }
+};
+
+}
+
+#endif
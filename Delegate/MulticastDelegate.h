@@ -6,25 +6,178 @@
 /// delegate instances. Class is not thread-safe.
 
 #include "Delegate.h"
-#include <list>
+#include "ParallelBroadcast.h"
+#include "MulticastAsync.h"
+#include <vector>
+#include <memory_resource>
 #include <algorithm>
 #include <memory>
+#include <cstddef>
+#include <cstdint>
 
 namespace DelegateLib {
 
+/// Selects how `MulticastDelegate::Remove()` closes the gap left by a removed delegate
+enum class RemovePolicy
+{
+    KEEP_ORDER,     ///< Shift the later delegates down. Invocation order is kept.
+    SWAP_AND_POP    ///< Move the last delegate into the gap. Constant time, order not kept.
+};
+
+/// @brief Storage for one delegate of an invocation list. The delegate is copied
+/// inline with `CloneTo()` if it fits within `InlineSize` bytes, otherwise into the
+/// memory resource if any, or onto the heap with `Clone()`.
+/// @tparam DelegateType The stored delegate base type.
+/// @tparam InlineSize The inline storage size in bytes.
+template <class DelegateType, size_t InlineSize>
+class delegate_slot
+{
+public:
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    explicit delegate_slot(const DelegateType& delegate, std::pmr::memory_resource* resource = nullptr) : 
+        m_resource(resource) { Store(delegate); }
+    delegate_slot(const delegate_slot& rhs) : m_resource(rhs.m_resource) { Store(*rhs.m_delegate); }
+
+    /// A heap delegate is taken from `rhs`. An inline delegate is copied since 
+    /// delegates are only copyable through their base.
+    delegate_slot(delegate_slot&& rhs) : m_resource(rhs.m_resource) {
+        if (rhs.m_heap) {
+            m_delegate = rhs.m_delegate;
+            m_heap = true;
+            m_pooled = rhs.m_pooled;
+            rhs.m_delegate = nullptr;
+            rhs.m_heap = false;
+        } else {
+            Store(*rhs.m_delegate);
+        }
+    }
+
+    delegate_slot& operator=(const delegate_slot& rhs) {
+        if (&rhs != this) {
+            Reset();
+            m_resource = rhs.m_resource;
+            Store(*rhs.m_delegate);
+        }
+        return *this;
+    }
+
+    delegate_slot& operator=(delegate_slot&& rhs) {
+        if (&rhs != this) {
+            Reset();
+            m_resource = rhs.m_resource;
+            if (rhs.m_heap) {
+                m_delegate = rhs.m_delegate;
+                m_heap = true;
+                m_pooled = rhs.m_pooled;
+                rhs.m_delegate = nullptr;
+                rhs.m_heap = false;
+            } else {
+                Store(*rhs.m_delegate);
+            }
+        }
+        return *this;
+    }
+
+    ~delegate_slot() { Reset(); }
+
+    /// Get the stored delegate
+    DelegateType& operator*() const noexcept { return *m_delegate; }
+
+private:
+    void Store(const DelegateType& delegate) {
+        m_delegate = delegate.CloneTo(m_storage, sizeof(m_storage));
+        if (m_delegate == nullptr && m_resource) {
+            m_delegate = delegate.Clone(*m_resource);
+            m_heap = m_pooled = m_delegate != nullptr;
+        }
+        if (m_delegate == nullptr) {
+            m_delegate = delegate.Clone();
+            if (m_delegate == nullptr)
+                BAD_ALLOC();
+            m_heap = true;
+        }
+    }
+
+    void Reset() noexcept {
+        if (m_pooled)
+            DelegateType::Destroy(m_delegate, *m_resource);
+        else if (m_heap)
+            delete m_delegate;
+        else if (m_delegate)
+            m_delegate->~DelegateType();
+        m_delegate = nullptr;
+        m_heap = false;
+        m_pooled = false;
+    }
+
+    alignas(std::max_align_t) unsigned char m_storage[InlineSize];
+    DelegateType* m_delegate = nullptr;
+
+    /// The resource a delegate too large to store inline is copied into, or 
+    /// `nullptr` for the heap
+    std::pmr::memory_resource* m_resource = nullptr;
+    bool m_heap = false;
+
+    /// `true` if the heap delegate was copied into m_resource
+    bool m_pooled = false;
+};
+
 template <class R>
 struct MulticastDelegate; // Not defined
 
 /// @brief Not thread-safe multicast delegate container class. The class has a list of 
 /// `Delegate<>` instances. When invoked, each `Delegate` instance within the invocation 
 /// list is called. 
+/// @details The invocation list is a contiguous array. Each delegate is stored inline 
+/// within its array element when it fits within `INLINE_SIZE` bytes, which holds every 
+/// delegate class of the library, so a broadcast walks one block of memory. Do not 
+/// insert or remove delegates from a target function during a broadcast, including
+/// `ParallelBroadcast()`.
+///
+/// Insert returns a `Subscription` handle. `Remove(Subscription)` finds the delegate 
+/// through a handle table rather than comparing it with each stored delegate, so with
+/// `RemovePolicy::SWAP_AND_POP` an unsubscribe takes constant time however many 
+/// delegates are stored.
+///
+/// A container constructed with a `std::pmr::memory_resource` takes the invocation 
+/// list, the handle table and the delegates too large to store inline from the 
+/// resource, e.g. a monotonic buffer per request. A copy uses the same resource. 
+/// The resource must outlive the container and its copies.
 template<class RetType, class... Args>
 class MulticastDelegate<RetType(Args...)>
 {
 public:
     using DelegateType = Delegate<RetType(Args...)>;
 
+    /// Inline storage size in bytes of each stored delegate
+    static const size_t INLINE_SIZE = 96;
+
+    /// @brief Identifies one inserted delegate. Valid until the delegate is removed or
+    /// the container cleared, after which `Remove()` ignores it. Not valid for another
+    /// container, including after the container is assigned.
+    class Subscription
+    {
+    public:
+        Subscription() = default;
+
+        /// @return `true` if returned by an insert.
+        explicit operator bool() const noexcept { return m_generation != 0; }
+
+    private:
+        friend class MulticastDelegate;
+        Subscription(size_t handle, uint32_t generation) : m_handle(handle), m_generation(generation) { }
+
+        size_t m_handle = 0;
+        uint32_t m_generation = 0;
+    };
+
     MulticastDelegate() = default;
+
+    /// @brief Constructor.
+    /// @param[in] resource The memory resource the container allocates from.
+    explicit MulticastDelegate(std::pmr::memory_resource* resource) : m_resource(resource), 
+        m_delegates(resource), m_handleOf(resource), m_handles(resource), m_freeHandles(resource) { }
+
     ~MulticastDelegate() { Clear(); }
 
     /// @brief Copy constructor that creates a copy of the given instance.
@@ -32,34 +185,60 @@ public:
     /// provided `rhs` (right-hand side) object. The `rhs` object is used to 
     /// set the state of the new instance.
     /// @param[in] rhs The object to copy from.
-    MulticastDelegate(const MulticastDelegate& rhs) { CopyFrom(rhs); }
+    MulticastDelegate(const MulticastDelegate& rhs) : m_resource(rhs.m_resource), 
+        m_delegates(rhs.m_delegates, rhs.GetMemoryResource()), m_handleOf(rhs.m_handleOf, rhs.GetMemoryResource()), 
+        m_handles(rhs.m_handles, rhs.GetMemoryResource()), m_freeHandles(rhs.m_freeHandles, rhs.GetMemoryResource()) { 
+        m_freeHandles.reserve(m_handles.capacity());
+    }
 
     /// @brief Move constructor that transfers ownership of resources.
     /// @param[in] rhs The object to move from.
-    MulticastDelegate(MulticastDelegate&& rhs) noexcept : m_delegates(std::move(rhs.m_delegates)) { }
+    MulticastDelegate(MulticastDelegate&& rhs) noexcept : m_resource(rhs.m_resource), m_delegates(std::move(rhs.m_delegates)),
+        m_handleOf(std::move(rhs.m_handleOf)), m_handles(std::move(rhs.m_handles)), 
+        m_freeHandles(std::move(rhs.m_freeHandles)) { }
 
     /// Invoke all bound target functions. A void return value is used 
     /// since multiple targets invoked.
     /// @param[in] args The arguments used when invoking the target functions
     void operator()(Args... args) {
-        for (auto delegate : m_delegates)
-            (*delegate)(args...);	// Invoke delegate callback
+        // Invoke delegate callbacks, one message per thread for async delegates
+        MulticastAsync<RetType(Args...)>::Broadcast(m_delegates.begin(), m_delegates.end(), args...);
     }
 
     /// Invoke all bound target functions. A void return value is used 
     /// since multiple targets invoked.
     /// @param[in] args The arguments used when invoking the target functions
     void Broadcast(Args... args) {
-        (*this)(args...);
+        operator()(std::forward<Args>(args)...);
+    }
+
+    /// Invoke all bound target functions concurrently on a thread and wait for all of 
+    /// them. Bound to a `WorkerThreadPool`, the event completes in about the time of the
+    /// slowest target function. See `ParallelBroadcastInvoker`.
+    /// @param[in] thread The thread the target functions are dispatched to.
+    /// @param[in] args The arguments used when invoking the target functions. Shared by 
+    /// all target functions, which must not modify them.
+    /// @return Per delegate, in invocation order, `true` if the target function returned 
+    /// or `false` if it threw an exception.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    std::vector<bool> ParallelBroadcast(DelegateThread& thread, Args... args) {
+        std::vector<DelegateType*> delegates;
+        delegates.reserve(m_delegates.size());
+        for (const auto& delegate : m_delegates)
+            delegates.push_back(&*delegate);
+        return ParallelBroadcastInvoker<RetType(Args...)>::Run(thread, delegates.data(), 
+            delegates.size(), std::forward<Args>(args)...);
     }
 
     /// Insert a delegate into the container.
     /// @param[in] delegate A delegate target to insert
-    void operator+=(const DelegateType& delegate) { PushBack(delegate); }
+    /// @return The handle removing the delegate.
+    Subscription operator+=(const DelegateType& delegate) { return PushBack(delegate); }
 
     /// Insert a delegate into the container.
     /// @param[in] delegate A delegate target to insert
-    void operator+=(DelegateType&& delegate) { PushBack(delegate); }
+    /// @return The handle removing the delegate.
+    Subscription operator+=(DelegateType&& delegate) { return PushBack(delegate); }
 
     /// Remove a delegate from the container.
     /// @param[in] delegate A delegate target to remove
@@ -74,18 +253,25 @@ public:
     /// @return A reference to the current object.
     MulticastDelegate& operator=(const MulticastDelegate& rhs) {
         if (&rhs != this) {
-            Clear();
-            CopyFrom(rhs);
+            m_delegates = rhs.m_delegates;
+            m_handleOf = rhs.m_handleOf;
+            m_handles = rhs.m_handles;
+            m_freeHandles = rhs.m_freeHandles;
+            m_freeHandles.reserve(m_handles.capacity());
         }
         return *this;
     }
 
-    /// @brief Move assignment operator that transfers ownership of resources.
+    /// @brief Move assignment operator that transfers ownership of resources. The 
+    /// container keeps its memory resource, so delegates are copied if `rhs` uses another.
     /// @param[in] rhs The object to move from.
     /// @return A reference to the current object.
     MulticastDelegate& operator=(MulticastDelegate&& rhs) noexcept {
         if (&rhs != this) {
-            m_delegates = rhs.m_delegates;
+            m_delegates = std::move(rhs.m_delegates);
+            m_handleOf = std::move(rhs.m_handleOf);
+            m_handles = std::move(rhs.m_handles);
+            m_freeHandles = std::move(rhs.m_freeHandles);
             rhs.Clear();
         }
         return *this;
@@ -96,33 +282,66 @@ public:
 
     /// Insert a delegate into the container.
     /// @param[in] delegate A delegate target to insert
-    void PushBack(const DelegateType& delegate) { 
-        auto delegateClone = delegate.Clone();
-        if (!delegateClone)
-            BAD_ALLOC();
+    /// @return The handle removing the delegate.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    Subscription PushBack(const DelegateType& delegate) { 
+        DELEGATE_TRY {
+            if (m_freeHandles.empty()) {
+                m_handles.push_back(Handle{ 0, 1 });
 
-        try {
-            std::shared_ptr<DelegateType> sharedDelegate(delegateClone);
-            m_delegates.push_back(std::forward<std::shared_ptr<DelegateType>>(sharedDelegate));
+                // Keep room for every handle so releasing one never allocates
+                m_freeHandles.reserve(m_handles.capacity());
+                m_freeHandles.push_back(m_handles.size() - 1);
+            }
+
+            size_t handle = m_freeHandles.back();
+            m_handleOf.push_back(handle);
+            DELEGATE_TRY {
+                m_delegates.emplace_back(delegate, m_resource);
+            }
+            DELEGATE_CATCH(...) {
+                m_handleOf.pop_back();
+                DELEGATE_RETHROW();
+            }
+
+            m_freeHandles.pop_back();
+            m_handles[handle].position = m_delegates.size() - 1;
+            return Subscription(handle, m_handles[handle].generation);
         }
-        catch (const std::bad_alloc&) {
+        DELEGATE_CATCH(const std::bad_alloc&) {
             BAD_ALLOC();
         }
+        return Subscription();
     }
 
     /// Remove a delegate into the container.
     /// @param[in] delegate The delegate target to remove.
-    void Remove(const DelegateType& delegate) {
+    /// @param[in] policy How the gap left by the delegate is closed.
+    void Remove(const DelegateType& delegate, RemovePolicy policy = RemovePolicy::KEEP_ORDER) {
         // Use std::find_if to locate the matching delegate
         auto it = std::find_if(m_delegates.begin(), m_delegates.end(),
-            [&delegate](const std::shared_ptr<DelegateType>& item) {
+            [&delegate](const Slot& item) {
                 return *item == delegate;
             });
 
         // If found, erase the delegate
-        if (it != m_delegates.end()) {
-            m_delegates.erase(it);
-        }
+        if (it != m_delegates.end())
+            RemoveAt(it - m_delegates.begin(), policy);
+    }
+
+    /// Remove the delegate of a subscription without comparing delegates.
+    /// @param[in] subscription The handle returned when the delegate was inserted.
+    /// @param[in] policy How the gap left by the delegate is closed. 
+    /// `RemovePolicy::SWAP_AND_POP` takes constant time.
+    /// @return `true` if the delegate was removed, `false` if already removed.
+    bool Remove(const Subscription& subscription, RemovePolicy policy = RemovePolicy::KEEP_ORDER) {
+        if (!subscription || subscription.m_handle >= m_handles.size())
+            return false;
+        const Handle& handle = m_handles[subscription.m_handle];
+        if (handle.generation != subscription.m_generation)
+            return false;
+        RemoveAt(handle.position, policy);
+        return true;
     }
 
     /// Any registered delegates?
@@ -130,7 +349,12 @@ public:
     bool Empty() const { return m_delegates.empty(); }
 
     /// Removal all registered delegates.
-    void Clear() { m_delegates.clear(); }
+    void Clear() { 
+        m_delegates.clear();
+        for (size_t handle : m_handleOf)
+            ReleaseHandle(handle);
+        m_handleOf.clear();
+    }
 
     /// Get the number of delegates stored.
     /// @return The number of delegates stored.
@@ -140,27 +364,66 @@ public:
     /// @return `true` if the container is not empty, `false` if the container is empty.
     explicit operator bool() const { return !Empty(); }
 
+    /// Get the memory resource the container allocates from
+    /// @return The resource.
+    std::pmr::memory_resource* GetMemoryResource() const { return m_delegates.get_allocator().resource(); }
+
 private:
-    /// Copy all delegate container objects.
-    /// @param[in] other The container to copy from
-    void CopyFrom(const MulticastDelegate& other) {
-        for (auto delegate : other.m_delegates) {
-            auto delegateClone = delegate->Clone();
-            if (!delegateClone)
-                BAD_ALLOC();
+    using Slot = delegate_slot<DelegateType, INLINE_SIZE>;
 
-            try {
-                std::shared_ptr<DelegateType> sharedDelegate(delegateClone);
-                m_delegates.push_back(sharedDelegate);
-            }
-            catch (const std::bad_alloc&) {
-                BAD_ALLOC();
+    /// A subscription handle table entry
+    struct Handle
+    {
+        /// Position of the delegate within m_delegates while subscribed
+        size_t position;
+
+        /// Advanced when the delegate is removed so older handles are ignored
+        uint32_t generation;
+    };
+
+    /// Remove the delegate at a position and release its handle
+    void RemoveAt(size_t position, RemovePolicy policy) {
+        size_t handle = m_handleOf[position];
+        if (policy == RemovePolicy::SWAP_AND_POP) {
+            size_t last = m_delegates.size() - 1;
+            if (position != last) {
+                m_delegates[position] = std::move(m_delegates.back());
+                m_handleOf[position] = m_handleOf[last];
+                m_handles[m_handleOf[position]].position = position;
             }
+            m_delegates.pop_back();
+            m_handleOf.pop_back();
+        } else {
+            m_delegates.erase(m_delegates.begin() + position);
+            m_handleOf.erase(m_handleOf.begin() + position);
+            for (size_t i = position; i < m_handleOf.size(); i++)
+                m_handles[m_handleOf[i]].position = i;
         }
+        ReleaseHandle(handle);
+    }
+
+    /// Invalidate the subscriptions of a handle and make it available for reuse
+    void ReleaseHandle(size_t handle) noexcept {
+        // Generation 0 marks an empty Subscription
+        if (++m_handles[handle].generation == 0)
+            m_handles[handle].generation = 1;
+        m_freeHandles.push_back(handle);
     }
 
+    /// The resource delegates too large to store inline are copied into, or 
+    /// `nullptr` for the heap
+    std::pmr::memory_resource* m_resource = nullptr;
+
     /// List of registered delegates
-    xlist<std::shared_ptr<DelegateType>> m_delegates;
+    std::pmr::vector<Slot> m_delegates;
+
+    /// Subscription handle of each delegate, by position within m_delegates
+    std::pmr::vector<size_t> m_handleOf;
+
+    /// Subscription handle table, and the handles not in use. m_freeHandles has 
+    /// capacity for every handle.
+    std::pmr::vector<Handle> m_handles;
+    std::pmr::vector<size_t> m_freeHandles;
 };
 
 }
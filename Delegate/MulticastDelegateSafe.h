@@ -2,80 +2,150 @@
 #define _MULTICAST_DELEGATE_SAFE_H
 
 /// @file
-/// @brief Delegate container for storing and iterating over a collection of 
+/// @brief Delegate container for storing and iterating over a collection of
 /// delegate instances. Class is thread safe.
 
-#include "MulticastDelegate.h"
+#include "Delegate.h"
+#include "ParallelBroadcast.h"
+#include "MulticastAsync.h"
+#include "LockProfile.h"
+#include <vector>
+#include <memory>
 #include <mutex>
+#include <atomic>
+#include <algorithm>
 
 namespace DelegateLib {
 
 template <class R>
 struct MulticastDelegateSafe; // Not defined
 
-/// @brief Thread-safe multicast delegate container class. 
+/// @brief Thread-safe multicast delegate container class.
+/// @details The invocation list is an immutable snapshot published atomically. A broadcast
+/// takes the current snapshot and invokes it without holding a lock, so a slow target
+/// function blocks neither other broadcasts nor insert and remove. Insert and remove
+/// build a new copy of the list under a writer lock and publish it.
+///
+/// A broadcast in progress completes on the snapshot it took. A delegate removed during
+/// the broadcast may therefore still be invoked once by that broadcast, and a delegate
+/// inserted is invoked from the next broadcast. A target function may insert or remove
+/// delegates of the container that invoked it.
+///
+/// Insert returns a `Subscription` handle. `Remove(Subscription)` finds the delegate by
+/// its stored identity rather than comparing it with each stored delegate.
 template<class RetType, class... Args>
-class MulticastDelegateSafe<RetType(Args...)> : public MulticastDelegate<RetType(Args...)>
+class MulticastDelegateSafe<RetType(Args...)>
 {
 public:
     using DelegateType = Delegate<RetType(Args...)>;
-    using BaseType = MulticastDelegate<RetType(Args...)>;
 
     MulticastDelegateSafe() = default;
-    ~MulticastDelegateSafe() = default; 
+    ~MulticastDelegateSafe() = default;
     MulticastDelegateSafe(const MulticastDelegateSafe& rhs) = delete;
     MulticastDelegateSafe(MulticastDelegateSafe&& rhs) = delete;
 
+    /// @brief Identifies one inserted delegate. `Remove()` ignores it once the delegate
+    /// is removed.
+    class Subscription
+    {
+    public:
+        Subscription() = default;
+
+        /// @return `true` if returned by an insert.
+        explicit operator bool() const noexcept { return m_inserted; }
+
+    private:
+        friend class MulticastDelegateSafe;
+        explicit Subscription(const std::shared_ptr<DelegateType>& delegate) : 
+            m_delegate(delegate), m_inserted(true) { }
+
+        /// The stored delegate. Expires once no invocation list holds it.
+        std::weak_ptr<DelegateType> m_delegate;
+        bool m_inserted = false;
+    };
+
     /// Invoke the bound target function for all stored delegate instances.
     /// A void return value is used since multiple targets invoked.
     /// @param[in] args The arguments used when invoking the target functions
     void operator()(Args... args) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::operator ()(args...);
+        auto delegates = Snapshot();
+        if (!delegates)
+            return;
+        // Invoke delegate callbacks, one message per thread for async delegates
+        if (m_sharedPayload.load(std::memory_order_relaxed))
+            MulticastAsync<RetType(Args...)>::BroadcastShared(delegates->begin(), delegates->end(), args...);
+        else
+            MulticastAsync<RetType(Args...)>::Broadcast(delegates->begin(), delegates->end(), args...);
     }
 
-    /// Invoke all bound target functions. A void return value is used 
+    /// Invoke all bound target functions. A void return value is used
     /// since multiple targets invoked.
     /// @param[in] args The arguments used when invoking the target functions
     void Broadcast(Args... args) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::Broadcast(args...);
+        operator()(std::forward<Args>(args)...);
+    }
+
+    /// Share one copy of the arguments of each broadcast between all of the asynchronous
+    /// delegates, rather than copying them once per destination thread. The targets 
+    /// then access the same argument objects concurrently and must not modify them.
+    /// See `MulticastAsync::BroadcastShared()`. Function call is thread-safe.
+    /// @param[in] enable `true` to share the arguments. Disabled by default.
+    void SetSharedPayload(bool enable) { m_sharedPayload.store(enable, std::memory_order_relaxed); }
+
+    /// Invoke all bound target functions concurrently on a thread and wait for all of 
+    /// them. Bound to a `WorkerThreadPool`, the event completes in about the time of the
+    /// slowest target function. See `ParallelBroadcastInvoker`.
+    /// @param[in] thread The thread the target functions are dispatched to.
+    /// @param[in] args The arguments used when invoking the target functions. Shared by 
+    /// all target functions, which must not modify them.
+    /// @return Per delegate, in invocation order, `true` if the target function returned 
+    /// or `false` if it threw an exception.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    std::vector<bool> ParallelBroadcast(DelegateThread& thread, Args... args) {
+        auto snapshot = Snapshot();
+        std::vector<DelegateType*> delegates;
+        if (snapshot) {
+            delegates.reserve(snapshot->size());
+            for (const auto& delegate : *snapshot)
+                delegates.push_back(delegate.get());
+        }
+        return ParallelBroadcastInvoker<RetType(Args...)>::Run(thread, delegates.data(), 
+            delegates.size(), std::forward<Args>(args)...);
     }
 
     /// Insert a delegate into the container.
     /// @param[in] delegate A delegate target to insert
-    void operator+=(const Delegate<RetType(Args...)>& delegate) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::operator +=(delegate);
-    }
+    /// @return The handle removing the delegate.
+    Subscription operator+=(const DelegateType& delegate) { return PushBack(delegate); }
 
     /// Insert a delegate into the container.
     /// @param[in] delegate A delegate target to insert
-    void operator+=(Delegate<RetType(Args...)>&& delegate) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::operator +=(delegate);
-    }
+    /// @return The handle removing the delegate.
+    Subscription operator+=(DelegateType&& delegate) { return PushBack(delegate); }
 
     /// Remove a delegate from the container.
     /// @param[in] delegate A delegate target to remove
-    void operator-=(const Delegate<RetType(Args...)>& delegate) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::operator -=(delegate);
-    }
+    void operator-=(const DelegateType& delegate) { Remove(delegate); }
 
     /// Remove a delegate from the container.
     /// @param[in] delegate A delegate target to remove
-    void operator-=(Delegate<RetType(Args...)>&& delegate) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::operator -=(delegate);
-    }
+    void operator-=(DelegateType&& delegate) { Remove(delegate); }
 
     /// @brief Assignment operator that assigns the state of one object to another.
     /// @param[in] rhs The object whose state is to be assigned to the current object.
     /// @return A reference to the current object.
     MulticastDelegateSafe& operator=(const MulticastDelegateSafe& rhs) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::operator=(rhs);
+        if (&rhs != this) {
+            auto delegates = std::make_shared<DelegateList>();
+            auto source = rhs.Snapshot();
+            if (source) {
+                for (const auto& delegate : *source)
+                    delegates->push_back(CloneDelegate(*delegate));
+            }
+
+            const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+            Publish(std::move(delegates));
+        }
         return *this;
     }
 
@@ -83,61 +153,157 @@ public:
     /// @param[in] rhs The object to move from.
     /// @return A reference to the current object.
     MulticastDelegateSafe& operator=(MulticastDelegateSafe&& rhs) noexcept {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        BaseType::operator=(std::forward<MulticastDelegateSafe>(rhs));
+        if (&rhs != this) {
+            std::shared_ptr<const DelegateList> delegates;
+            {
+                const std::lock_guard<DelegateLib::SiteMutex> lock(rhs.m_lock);
+                delegates = rhs.Snapshot();
+                rhs.Publish(nullptr);
+            }
+
+            const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+            Publish(std::move(delegates));
+        }
         return *this;
     }
 
     /// @brief Clear the all target functions.
-    virtual void operator=(std::nullptr_t) noexcept { 
-        const std::lock_guard<std::mutex> lock(m_lock);
-        return BaseType::Clear(); 
-    }
+    virtual void operator=(std::nullptr_t) noexcept { Clear(); }
 
     /// Insert a delegate into the container.
     /// @param[in] delegate A delegate target to insert
-    void PushBack(const DelegateType& delegate) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        return BaseType::PushBack(delegate);
+    /// @return The handle removing the delegate.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    Subscription PushBack(const DelegateType& delegate) {
+        auto sharedDelegate = CloneDelegate(delegate);
+        Subscription subscription(sharedDelegate);
+
+        const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+        auto delegates = Copy();
+        delegates->push_back(std::move(sharedDelegate));
+        Publish(std::move(delegates));
+        return subscription;
     }
 
     /// Remove a delegate into the container.
     /// @param[in] delegate The delegate target to remove.
     void Remove(const DelegateType& delegate) {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        return BaseType::Remove(delegate);
+        const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+        auto current = Snapshot();
+        if (!current)
+            return;
+
+        // Use std::find_if to locate the matching delegate
+        auto it = std::find_if(current->begin(), current->end(),
+            [&delegate](const std::shared_ptr<DelegateType>& item) {
+                return *item == delegate;
+            });
+
+        // If found, publish a copy without the delegate
+        if (it != current->end()) {
+            auto delegates = Copy();
+            delegates->erase(delegates->begin() + (it - current->begin()));
+            Publish(std::move(delegates));
+        }
+    }
+
+    /// Remove the delegate of a subscription without comparing delegates.
+    /// @param[in] subscription The handle returned when the delegate was inserted.
+    /// @return `true` if the delegate was removed, `false` if already removed.
+    bool Remove(const Subscription& subscription) {
+        // An expired delegate is in no invocation list
+        auto target = subscription.m_delegate.lock();
+        if (!target)
+            return false;
+
+        const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+        auto current = Snapshot();
+        if (!current)
+            return false;
+
+        auto it = std::find(current->begin(), current->end(), target);
+        if (it == current->end())
+            return false;
+
+        auto delegates = Copy();
+        delegates->erase(delegates->begin() + (it - current->begin()));
+        Publish(std::move(delegates));
+        return true;
     }
 
     /// Any registered delegates?
     /// @return `true` if delegate container is empty.
-    bool Empty() {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        return BaseType::Empty();
+    bool Empty() const {
+        auto delegates = Snapshot();
+        return !delegates || delegates->empty();
     }
 
     /// Removal all registered delegates.
     void Clear() {
-       const std::lock_guard<std::mutex> lock(m_lock);
-       BaseType::Clear();
+        const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+        Publish(nullptr);
     }
 
     /// Get the number of delegates stored.
     /// @return The number of delegates stored.
-    std::size_t Size() { 
-        const std::lock_guard<std::mutex> lock(m_lock);
-        return BaseType::Size(); 
+    std::size_t Size() const {
+        auto delegates = Snapshot();
+        return delegates ? delegates->size() : 0;
     }
 
     /// @brief Implicit conversion operator to `bool`.
     /// @return `true` if the container is not empty, `false` if the container is empty.
-    explicit operator bool() {
-        const std::lock_guard<std::mutex> lock(m_lock);
-        return BaseType::operator bool();
-    }
+    explicit operator bool() const { return !Empty(); }
 
 private:
-    /// Lock to make the class thread-safe
-    std::mutex m_lock;
+    using DelegateList = std::vector<std::shared_ptr<DelegateType>>;
+
+    /// Get the current invocation list. Lock-free for the caller; the list is never
+    /// modified once published.
+    /// @return The invocation list, or nullptr if empty.
+    std::shared_ptr<const DelegateList> Snapshot() const {
+        return std::atomic_load_explicit(&m_delegates, std::memory_order_acquire);
+    }
+
+    /// Copy the current invocation list for modification. Called with m_lock held.
+    /// @return A new list holding the current delegates.
+    std::shared_ptr<DelegateList> Copy() const {
+        auto current = Snapshot();
+        return current ? std::make_shared<DelegateList>(*current) : std::make_shared<DelegateList>();
+    }
+
+    /// Publish a new invocation list. Called with m_lock held.
+    /// @param[in] delegates The new list, or nullptr if empty.
+    void Publish(std::shared_ptr<const DelegateList> delegates) noexcept {
+        std::atomic_store_explicit(&m_delegates, std::move(delegates), std::memory_order_release);
+    }
+
+    /// Clone a delegate for storage within the container.
+    /// @param[in] delegate The delegate to clone.
+    /// @return The stored delegate.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    static std::shared_ptr<DelegateType> CloneDelegate(const DelegateType& delegate) {
+        auto delegateClone = delegate.Clone();
+        if (!delegateClone)
+            BAD_ALLOC();
+
+        DELEGATE_TRY {
+            return std::shared_ptr<DelegateType>(delegateClone);
+        }
+        DELEGATE_CATCH(const std::bad_alloc&) {
+            BAD_ALLOC();
+        }
+        return nullptr;
+    }
+
+    /// The published invocation list. Read with `Snapshot()`, written with `Publish()`.
+    std::shared_ptr<const DelegateList> m_delegates;
+
+    /// Lock serializing writers. Never held during a broadcast.
+    SiteMutex m_lock = LockSite("MulticastDelegateSafe::m_lock");
+
+    /// Set by `SetSharedPayload()`
+    std::atomic<bool> m_sharedPayload{ false };
 };
 
 }
@@ -0,0 +1,164 @@
+#ifndef _PARALLEL_BROADCAST_H
+#define _PARALLEL_BROADCAST_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Invokes the delegates of a multicast container concurrently on a
+/// `DelegateThread` and waits for all of them.
+///
+/// @details Each delegate except the first is dispatched to the thread as one message,
+/// all in one `DispatchDelegates()` batch. Bound to a `WorkerThreadPool`, the
+/// delegates run concurrently on the pool workers. The calling thread runs the first
+/// delegate itself, then claims and runs any delegate no worker has started yet, so
+/// the broadcast completes even if the thread is busy or is the calling thread.
+///
+/// The arguments are copied once and each delegate is passed the same copy, so the
+/// delegates must not modify reference or pointer arguments.
+
+#include "Delegate.h"
+#include "DelegateThread.h"
+#include "DelegateInvoker.h"
+#include "DelegatePool.h"
+#include <tuple>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+namespace DelegateLib {
+
+template <class R>
+class ParallelBroadcastInvoker; // Not defined
+
+/// @brief Shares one parallel broadcast between the calling thread and the messages
+/// dispatched for it. Messages outliving the broadcast find their delegate already
+/// claimed and do nothing.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+template <class RetType, class... Args>
+class ParallelBroadcastInvoker<RetType(Args...)> : public IDelegateInvoker
+{
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+
+    /// @brief Invoke delegates concurrently on a thread and wait for all of them.
+    /// @param[in] thread The thread the delegates are dispatched to.
+    /// @param[in] delegates The delegates to invoke. Must stay valid until return.
+    /// @param[in] count The number of delegates.
+    /// @param[in] args The function arguments, if any.
+    /// @return Per delegate, in order, `true` if the delegate returned or `false` if
+    /// it threw an exception.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    static std::vector<bool> Run(DelegateThread& thread, DelegateType* const* delegates, size_t count, Args... args) {
+        std::vector<bool> success(count, false);
+        if (count == 0)
+            return success;
+
+        auto invoker = std::make_shared<ParallelBroadcastInvoker>(delegates, count, std::forward<Args>(args)...);
+        if (!invoker)
+            BAD_ALLOC();
+
+        if (count > 1) {
+            std::vector<std::shared_ptr<DelegateMsg>> msgs;
+            msgs.reserve(count - 1);
+            for (size_t i = 1; i < count; i++)
+                msgs.push_back(std::allocate_shared<Msg>(pool_allocator<Msg>(), invoker, i));
+
+            DELEGATE_TRY {
+                thread.DispatchDelegates(msgs.data(), msgs.size());
+            }
+            DELEGATE_CATCH(...) {
+                // The thread is not running; the calling thread runs the delegates below
+            }
+        }
+
+        // Run the first delegate, then any the thread has not started from the back,
+        // which the thread reaches last
+        invoker->Claim(0);
+        for (size_t i = count - 1; i > 0; i--)
+            invoker->Claim(i);
+        invoker->Wait();
+
+        for (size_t i = 0; i < count; i++)
+            success[i] = invoker->m_tasks[i].success;
+        return success;
+    }
+
+    /// Constructor. Use `Run()`.
+    ParallelBroadcastInvoker(DelegateType* const* delegates, size_t count, Args... args) :
+        m_tasks(new Task[count]), m_remaining(count), m_args(std::forward<Args>(args)...) {
+        for (size_t i = 0; i < count; i++)
+            m_tasks[i].delegate = delegates[i];
+    }
+
+    /// @brief Run the delegate of a message if not claimed yet. Called by the
+    /// destination thread.
+    /// @param[in] msg The message dispatched within `Run()`.
+    /// @return `true` if the message is a broadcast message.
+    virtual bool Invoke(std::shared_ptr<DelegateMsg> msg) override {
+        auto broadcastMsg = delegate_msg_cast<Msg>(msg);
+        if (broadcastMsg == nullptr)
+            return false;
+        Claim(broadcastMsg->GetIndex());
+        return true;
+    }
+
+private:
+    /// Message invoking one delegate of the broadcast
+    class Msg : public DelegateMsg
+    {
+    public:
+        Msg(std::shared_ptr<IDelegateInvoker> invoker, size_t index) :
+            DelegateMsg(invoker, type_id<Msg>()), m_index(index) { }
+        size_t GetIndex() const { return m_index; }
+    private:
+        const size_t m_index;
+    };
+
+    struct Task
+    {
+        DelegateType* delegate = nullptr;
+        std::atomic<bool> claimed{ false };
+        bool success = false;
+    };
+
+    /// Run a delegate unless another thread has claimed it
+    /// @param[in] index The delegate index.
+    void Claim(size_t index) {
+        Task& task = m_tasks[index];
+        if (task.claimed.exchange(true, std::memory_order_acquire))
+            return;
+
+        DELEGATE_TRY {
+            std::apply([&task](auto&... args) { (*task.delegate)(args...); }, m_args);
+            task.success = true;
+        }
+        DELEGATE_CATCH(...) {
+            task.success = false;
+        }
+
+        // Wake the calling thread once the last delegate returns
+        if (m_remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            { std::lock_guard<std::mutex> lk(m_lock); }
+            m_cv.notify_all();
+        }
+    }
+
+    /// Wait until every delegate has returned. Called by the calling thread.
+    void Wait() {
+        std::unique_lock<std::mutex> lk(m_lock);
+        m_cv.wait(lk, [this]() { return m_remaining.load(std::memory_order_acquire) == 0; });
+    }
+
+    std::unique_ptr<Task[]> m_tasks;
+    std::atomic<size_t> m_remaining;
+    std::tuple<Args...> m_args;
+    std::mutex m_lock;
+    std::condition_variable m_cv;
+};
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+#ifndef _DELEGATELIB_PROFILE_H
+#define _DELEGATELIB_PROFILE_H
+
+/// @file
+/// @brief Per target profiling of asynchronous delegate calls.
+///
+/// @details Each `DelegateAsync` target is given a profile row when bound. A row
+/// counts the invocations and sums the time each message waited in the destination
+/// thread queue, the time the target executed and the argument bytes copied into
+/// messages. `Profiler::WriteReport()` prints the rows as a table sorted by any
+/// column, to find the cross-thread calls absorbing the most time.
+///
+/// Rows are keyed by name. `SetProfileName()` on an asynchronous delegate names its
+/// row, and delegates given the same name share one row. An unnamed target is
+/// profiled under its delegate type, e.g. `DelegateLib::DelegateMemberAsync<Store,
+/// int (int)>`, if RTTI is enabled.
+///
+/// The profile points compile to nothing unless `PROFILE_ENABLE` is defined. Once
+/// compiled in, recording is on until `Profiler::SetEnabled(false)`. Counters are
+/// relaxed atomics, so recording takes no lock.
+///
+/// Code example:
+///
+/// `auto read = MakeDelegate(&store, &Store::Read, storeThread);`
+/// `read.SetProfileName("Store::Read");`
+/// `Profiler::WriteReport(std::cout, ProfileSort::EXEC_TIME);`
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+namespace DelegateLib {
+
+/// @brief The totals of one profile row
+struct ProfileSample
+{
+	std::string name;
+
+	/// Messages sent and targets invoked
+	uint64_t sends;
+	uint64_t calls;
+
+	/// Nanoseconds queued before invoke, summed and the worst
+	uint64_t queueNs;
+	uint64_t maxQueueNs;
+
+	/// Nanoseconds executing the target, summed and the worst
+	uint64_t execNs;
+	uint64_t maxExecNs;
+
+	/// Argument bytes copied into sent messages
+	uint64_t copyBytes;
+};
+
+/// @brief The column a report is sorted by, largest first
+enum class ProfileSort { CALLS, QUEUE_TIME, EXEC_TIME, COPY_BYTES, NAME };
+
+/// @brief The counters of one profile row. Written by any thread.
+class profile_entry
+{
+public:
+	explicit profile_entry(const std::string& name) : m_name(name) {}
+
+	/// Record a message sent by the source thread
+	/// @param[in] bytes - the argument bytes copied into the message
+	void Sent(size_t bytes)
+	{
+		m_sends.fetch_add(1, std::memory_order_relaxed);
+		m_copyBytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	/// Record a target invoked by the destination thread
+	/// @param[in] queueNs - the nanoseconds the message was queued
+	/// @param[in] execNs - the nanoseconds the target executed
+	void Invoked(uint64_t queueNs, uint64_t execNs)
+	{
+		m_calls.fetch_add(1, std::memory_order_relaxed);
+		m_queueNs.fetch_add(queueNs, std::memory_order_relaxed);
+		m_execNs.fetch_add(execNs, std::memory_order_relaxed);
+		StoreMax(m_maxQueueNs, queueNs);
+		StoreMax(m_maxExecNs, execNs);
+	}
+
+	/// Copy the counters
+	ProfileSample Sample() const
+	{
+		return ProfileSample{ m_name, m_sends.load(std::memory_order_relaxed),
+			m_calls.load(std::memory_order_relaxed), m_queueNs.load(std::memory_order_relaxed),
+			m_maxQueueNs.load(std::memory_order_relaxed), m_execNs.load(std::memory_order_relaxed),
+			m_maxExecNs.load(std::memory_order_relaxed), m_copyBytes.load(std::memory_order_relaxed) };
+	}
+
+	/// Zero the counters
+	void Reset()
+	{
+		for (auto* counter : { &m_sends, &m_calls, &m_queueNs, &m_maxQueueNs, &m_execNs, &m_maxExecNs, &m_copyBytes })
+			counter->store(0, std::memory_order_relaxed);
+	}
+
+private:
+	profile_entry(const profile_entry&) = delete;
+	profile_entry& operator=(const profile_entry&) = delete;
+
+	static void StoreMax(std::atomic<uint64_t>& max, uint64_t value)
+	{
+		uint64_t current = max.load(std::memory_order_relaxed);
+		while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed))
+			;
+	}
+
+	const std::string m_name;
+	std::atomic<uint64_t> m_sends{ 0 };
+	std::atomic<uint64_t> m_calls{ 0 };
+	std::atomic<uint64_t> m_queueNs{ 0 };
+	std::atomic<uint64_t> m_maxQueueNs{ 0 };
+	std::atomic<uint64_t> m_execNs{ 0 };
+	std::atomic<uint64_t> m_maxExecNs{ 0 };
+	std::atomic<uint64_t> m_copyBytes{ 0 };
+};
+
+/// @brief The profile row registry. All functions are thread safe.
+class Profiler
+{
+public:
+	/// Start or stop recording
+	/// @param[in] enable - true to record
+	static void SetEnabled(bool enable) { Enabled().store(enable, std::memory_order_relaxed); }
+
+	/// Check if calls are recorded
+	/// @return True if recording.
+	static bool IsEnabled() { return Enabled().load(std::memory_order_relaxed); }
+
+	/// Get the profile time
+	/// @return Nanoseconds of the steady clock.
+	static uint64_t Now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// Get the row of a name, inserting it if new. Called when a delegate is bound
+	/// or named, not per call.
+	/// @param[in] name - the row name
+	/// @return The row, valid for the life of the program.
+	static profile_entry* GetEntry(const std::string& name)
+	{
+		const std::lock_guard<std::mutex> lock(RegistryLock());
+		auto& entry = Entries()[name];
+		if (!entry)
+			entry.reset(new profile_entry(name));
+		return entry.get();
+	}
+
+	/// Get the row of an unnamed target
+	/// @tparam T The delegate type.
+	/// @return The row named after `T`.
+	template <class T>
+	static profile_entry* GetEntry()
+	{
+		static profile_entry* entry = GetEntry(TypeName<T>());
+		return entry;
+	}
+
+	/// Copy every row
+	/// @param[in] sort - the column to sort by, largest first
+	/// @return The rows.
+	static std::vector<ProfileSample> GetSamples(ProfileSort sort = ProfileSort::EXEC_TIME)
+	{
+		std::vector<ProfileSample> samples;
+		{
+			const std::lock_guard<std::mutex> lock(RegistryLock());
+			for (const auto& entry : Entries())
+				samples.push_back(entry.second->Sample());
+		}
+
+		auto key = [sort](const ProfileSample& s) {
+			switch (sort)
+			{
+			case ProfileSort::CALLS: return s.calls;
+			case ProfileSort::QUEUE_TIME: return s.queueNs;
+			case ProfileSort::COPY_BYTES: return s.copyBytes;
+			default: return s.execNs;
+			}
+		};
+		if (sort != ProfileSort::NAME)
+			std::stable_sort(samples.begin(), samples.end(),
+				[&key](const ProfileSample& a, const ProfileSample& b) { return key(a) > key(b); });
+		return samples;
+	}
+
+	/// Write every row called at least once as a table
+	/// @param[in] out - the stream to write
+	/// @param[in] sort - the column to sort by, largest first
+	/// @return True if written.
+	static bool WriteReport(std::ostream& out, ProfileSort sort = ProfileSort::EXEC_TIME)
+	{
+		char line[160];
+		snprintf(line, sizeof(line), "%10s %12s %10s %10s %10s %10s %12s  %s\n",
+			"calls", "exec ms", "exec us", "max us", "queue us", "max us", "copy bytes", "name");
+		out << line;
+		for (const auto& s : GetSamples(sort))
+		{
+			if (s.sends == 0 && s.calls == 0)
+				continue;
+			double calls = s.calls ? (double)s.calls : 1.0;
+			snprintf(line, sizeof(line), "%10llu %12.3f %10.3f %10.3f %10.3f %10.3f %12llu  ",
+				(unsigned long long)s.calls, s.execNs / 1e6, s.execNs / calls / 1e3, s.maxExecNs / 1e3,
+				s.queueNs / calls / 1e3, s.maxQueueNs / 1e3, (unsigned long long)s.copyBytes);
+			out << line << s.name << "\n";
+		}
+		return out.good();
+	}
+
+	/// Zero every row. Rows are kept, as bound delegates refer to them.
+	static void Clear()
+	{
+		const std::lock_guard<std::mutex> lock(RegistryLock());
+		for (auto& entry : Entries())
+			entry.second->Reset();
+	}
+
+private:
+	template <class T>
+	static std::string TypeName()
+	{
+#if !defined(__cpp_rtti) && !defined(__GXX_RTTI) && !defined(_CPPRTTI)
+		return "unnamed";
+#elif defined(__GNUG__)
+		int status = 0;
+		std::unique_ptr<char, void(*)(void*)> name(abi::__cxa_demangle(typeid(T).name(), nullptr, nullptr, &status), std::free);
+		return status == 0 && name ? name.get() : typeid(T).name();
+#else
+		return typeid(T).name();
+#endif
+	}
+
+	static std::atomic<bool>& Enabled()
+	{
+		static std::atomic<bool> enabled{ true };
+		return enabled;
+	}
+
+	static std::mutex& RegistryLock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	static std::map<std::string, std::unique_ptr<profile_entry>>& Entries()
+	{
+		static std::map<std::string, std::unique_ptr<profile_entry>> entries;
+		return entries;
+	}
+};
+
+}
+
+#endif
@@ -5,16 +5,22 @@
 /// @brief Delegate library semaphore wrapper class. 
 
 #include "DelegateOpt.h"
-#include <condition_variable>
-#include <mutex>
+#include "Clock.h"
+#include "AtomicWait.h"
 #include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <thread>
 
 // Fix compiler error on Windows
 #undef max
 
 namespace DelegateLib {
 
-/// @brief A semaphore wrapper class. 
+/// @brief A semaphore wrapper class. A binary semaphore on one atomic word, so
+/// Signal() with no thread waiting takes no lock and makes no system call. A 
+/// waiting thread sleeps with AtomicWait().
 class Semaphore
 {
 public:
@@ -22,52 +28,191 @@ public:
 	~Semaphore() = default;
 
 	/// Called to wait on a semaphore to be signaled.
-	/// @param[in] timeout - timeout in milliseconds
+	/// @param[in] timeout - the longest time to wait, or nanoseconds::max() for no limit
 	/// @return Return true if semaphore signaled, false if timeout occurred. 
-	bool Wait(std::chrono::milliseconds timeout)
+	bool Wait(std::chrono::nanoseconds timeout)
 	{
-        std::unique_lock<std::mutex> lk(m_lock);
-        if (timeout == std::chrono::milliseconds::max())
-        {
-            m_sema.wait(lk, [this] { return m_signaled; });
-        }
-        else
-        {
-            if (!m_sema.wait_for(lk, timeout, [this] { return m_signaled; }))
-            {
-                return false; // Timeout occurred
-            }
-        }
-
-        if (m_signaled)
-        {
-            m_signaled = false;
-            return true;
-        }
-        else
-        {
-            return false;
-        }
+		const bool infinite = timeout == std::chrono::nanoseconds::max();
+		const auto deadline = infinite ? std::chrono::steady_clock::time_point::max() :
+			std::chrono::steady_clock::now() + timeout;
+
+		uint32_t state = m_state.load(std::memory_order_relaxed);
+		while (1)
+		{
+			// Take the signal, leaving the sleeper flag for any other waiter
+			if (state & SIGNALED)
+			{
+				if (m_state.compare_exchange_weak(state, state & ~SIGNALED, 
+					std::memory_order_acquire, std::memory_order_relaxed))
+					return true;
+				continue;
+			}
+
+			if (!(state & SLEEPER))
+			{
+				if (!m_state.compare_exchange_weak(state, state | SLEEPER, std::memory_order_relaxed))
+					continue;
+				state |= SLEEPER;
+			}
+
+			if (infinite)
+				AtomicWait(m_state, state);
+			else
+			{
+				auto now = std::chrono::steady_clock::now();
+				if (now >= deadline)
+					return false; // Timeout occurred
+				auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+				AtomicWait(m_state, state, &remaining);
+			}
+			state = m_state.load(std::memory_order_relaxed);
+		}
 	}
 
 	/// Called to signal a semaphore.
-    void Signal()
-    {
-        {
-            std::unique_lock<std::mutex> lk(m_lock);
-            m_signaled = true;
-        }
-        m_sema.notify_one();
-    }
+	void Signal()
+	{
+		// Clearing the sleeper flag makes each woken waiter set it again
+		if (m_state.exchange(SIGNALED, std::memory_order_release) & SLEEPER)
+			AtomicWake(m_state);
+	}
 
 private:
 	// Prevent copying objects
 	Semaphore(const Semaphore&) = delete;
 	Semaphore& operator=(const Semaphore&) = delete;
 
-	std::condition_variable m_sema;
-	std::mutex m_lock;
-	bool m_signaled = false;
+	static const uint32_t SIGNALED = 1;
+
+	/// Set while a waiter may be sleeping
+	static const uint32_t SLEEPER = 2;
+
+	std::atomic<uint32_t> m_state{ 0 };
+};
+
+/// @brief A binary semaphore signaling the completion of a blocking cross-thread 
+/// call. The semaphore and the invoker waiting flag share one atomic word, so an
+/// uncontended call takes no lock and makes no system call.
+/// 
+/// @details The sending thread calls Wait() and the receiving thread brackets the
+/// target function call with BeginInvoke() and EndInvoke(). If the wait times out 
+/// before BeginInvoke() the call is abandoned and BeginInvoke() returns false. Once
+/// BeginInvoke() succeeds, Wait() does not return until EndInvoke(), since the 
+/// target function may use arguments owned by the sending thread. The sender sleeps
+/// with AtomicWait(), i.e. on a futex on Linux and WaitOnAddress() on Windows.
+class InvokeSignal
+{
+public:
+	InvokeSignal() = default;
+	~InvokeSignal() = default;
+
+	/// Prepare the signal for a new call. Only called while no receiving thread
+	/// holds the signal.
+	void Reset() noexcept { m_state.store(WAITING, std::memory_order_relaxed); }
+
+	/// Called by the receiving thread before invoking the target function
+	/// @return True if the sender is waiting and the target function must be called.
+	bool BeginInvoke()
+	{
+		uint32_t state = m_state.load(std::memory_order_relaxed);
+		while ((state & STATE_MASK) == WAITING)
+		{
+			if (m_state.compare_exchange_weak(state, (state & ~STATE_MASK) | INVOKING, 
+				std::memory_order_acquire, std::memory_order_relaxed))
+				return true;
+		}
+		return false;
+	}
+
+	/// Called by the receiving thread once the target function returns
+	void EndInvoke()
+	{
+		if (m_state.exchange(DONE, std::memory_order_acq_rel) & SLEEPER)
+			Wake();
+	}
+
+	/// Called by the sending thread to wait for the target function to complete
+	/// @param[in] timeout - the longest time to wait, or nanoseconds::max() for no
+	///		limit. Measured from the call, including the initial polling.
+	/// @return True if the target function was invoked, false if the call was 
+	///		abandoned on timeout.
+	bool Wait(std::chrono::nanoseconds timeout)
+	{
+		const bool infinite = timeout == std::chrono::nanoseconds::max();
+		const auto deadline = infinite ? std::chrono::steady_clock::time_point::max() :
+			Clock::Now() + timeout;
+
+		// Poll briefly since short target functions complete before a sleep pays off
+		for (int i = 0; i < SPIN_COUNT; i++)
+		{
+			if ((m_state.load(std::memory_order_acquire) & STATE_MASK) == DONE)
+				return true;
+			std::this_thread::yield();
+		}
+		while (1)
+		{
+			uint32_t state = m_state.fetch_or(SLEEPER, std::memory_order_acquire) | SLEEPER;
+			if ((state & STATE_MASK) == DONE)
+				return true;
+
+			if (infinite || (state & STATE_MASK) == INVOKING)
+			{
+				SleepOn(state, nullptr);
+				continue;
+			}
+
+			auto now = Clock::Now();
+			if (now >= deadline)
+			{
+				// Abandon the call unless the receiver has already started it
+				if (m_state.compare_exchange_strong(state, ABANDONED, std::memory_order_acquire))
+					return false;
+				continue;
+			}
+
+			// Advancing a virtual clock does not wake the sender, so sleep in short 
+			// slices to notice the timeout soon after
+			auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+			if (Clock::IsVirtual())
+				remaining = std::min(remaining, VIRTUAL_SLICE);
+			SleepOn(state, &remaining);
+		}
+	}
+
+private:
+	// Prevent copying objects
+	InvokeSignal(const InvokeSignal&) = delete;
+	InvokeSignal& operator=(const InvokeSignal&) = delete;
+
+	static const uint32_t WAITING = 0;
+	static const uint32_t INVOKING = 1;
+	static const uint32_t DONE = 2;
+	static const uint32_t ABANDONED = 3;
+	static const uint32_t STATE_MASK = 3;
+
+	/// Set while the sender may be sleeping
+	static const uint32_t SLEEPER = 4;
+
+	static const int SPIN_COUNT = 64;
+
+	/// Longest sleep while a virtual clock is installed
+	static constexpr std::chrono::nanoseconds VIRTUAL_SLICE{ 1000000 };
+
+	/// Sleep while the state word equals the expected value
+	/// @param[in] expected - the state word value to sleep on
+	/// @param[in] timeout - the longest time to sleep, or nullptr for no limit
+	void SleepOn(uint32_t expected, const std::chrono::nanoseconds* timeout)
+	{
+		AtomicWait(m_state, expected, timeout);
+	}
+
+	/// Wake the sleeping sender
+	void Wake()
+	{
+		AtomicWake(m_state);
+	}
+
+	std::atomic<uint32_t> m_state{ WAITING };
 };
 
 }
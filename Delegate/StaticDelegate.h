@@ -0,0 +1,150 @@
+#ifndef _STATIC_DELEGATE_H
+#define _STATIC_DELEGATE_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Delegates whose target function is fixed at compile time.
+///
+/// @details `StaticDelegate<&Func>` and `StaticMemberDelegate<&Class::Func>` encode the
+/// target function as a template argument. `operator()` is not virtual and calls the
+/// target directly, so the compiler inlines it like a direct call. A `StaticDelegate`
+/// holds no state and a `StaticMemberDelegate` holds only the object pointer. Neither
+/// is cloned or allocated.
+///
+/// Both convert to the equivalent `DelegateFree<>` or `DelegateMember<>` for use with
+/// the delegate containers. The converted delegate compares equal to one created with
+/// `MakeDelegate()`, so a static delegate inserted into a `MulticastDelegate` can be
+/// removed with `MakeDelegate()`, and the other way round. The container invokes its
+/// stored copy through the usual virtual `operator()`.
+///
+/// Code example:
+///
+/// `StaticDelegate<&FreeFunc> d1;`
+/// `d1(123);                                   // Direct call to FreeFunc(123)`
+/// `StaticMemberDelegate<&TestClass::Func> d2(&testClass);`
+/// `d2(123);                                   // Direct call to testClass.Func(123)`
+/// `MulticastDelegate<void(int)> multicast;`
+/// `multicast += d1;`
+/// `multicast -= MakeDelegate(&FreeFunc);     // Removes d1`
+
+#include "Delegate.h"
+#include <utility>
+
+namespace DelegateLib {
+
+template <auto Func>
+class StaticDelegate; // Not defined
+
+/// @brief A delegate bound at compile time to a free function.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+/// @tparam Func The target free function.
+template <class RetType, class... Args, RetType(*Func)(Args...)>
+class StaticDelegate<Func> {
+public:
+    typedef RetType(*FreeFunc)(Args...);
+    using DelegateType = DelegateFree<RetType(Args...)>;
+
+    static_assert(Func != nullptr, "StaticDelegate target function is nullptr");
+
+    /// @brief Invoke the target function.
+    /// @param[in] args The function arguments, if any.
+    /// @return The target function return value, if any.
+    RetType operator()(Args... args) const {
+        return Func(std::forward<Args>(args)...);
+    }
+
+    /// @brief Get the target function.
+    /// @return The target free function.
+    static constexpr FreeFunc GetFunc() noexcept { return Func; }
+
+    /// @brief Convert to a `DelegateFree<>` bound to the target function, e.g. to insert
+    /// into a delegate container.
+    /// @return The equivalent `DelegateFree<>`.
+    operator DelegateType() const { return DelegateType(Func); }
+};
+
+template <auto Func>
+class StaticMemberDelegate; // Not defined
+
+/// @brief A delegate bound at compile time to a non-const member function.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+/// @tparam Func The target member function.
+template <class TClass, class RetType, class... Args, RetType(TClass::*Func)(Args...)>
+class StaticMemberDelegate<Func> {
+public:
+    typedef RetType(TClass::*MemberFunc)(Args...);
+    using DelegateType = DelegateMember<TClass, RetType(Args...)>;
+
+    static_assert(Func != nullptr, "StaticMemberDelegate target function is nullptr");
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target instance. Must outlive every call.
+    explicit StaticMemberDelegate(TClass* object) noexcept : m_object(object) { }
+
+    /// @brief Invoke the target function. The object must not be nullptr.
+    /// @param[in] args The function arguments, if any.
+    /// @return The target function return value, if any.
+    RetType operator()(Args... args) const {
+        return (m_object->*Func)(std::forward<Args>(args)...);
+    }
+
+    /// @brief Get the target instance.
+    /// @return The target instance.
+    TClass* GetObject() const noexcept { return m_object; }
+
+    /// @brief Convert to a `DelegateMember<>` bound to the target instance and function,
+    /// e.g. to insert into a delegate container.
+    /// @return The equivalent `DelegateMember<>`.
+    operator DelegateType() const { return DelegateType(m_object, Func); }
+
+private:
+    /// Pointer to a class object, representing the bound target instance.
+    TClass* m_object;
+};
+
+/// @brief A delegate bound at compile time to a const member function.
+/// @tparam TClass The class type that contains the member function.
+/// @tparam RetType The return type of the bound delegate function.
+/// @tparam Args The argument types of the bound delegate function.
+/// @tparam Func The target const member function.
+template <class TClass, class RetType, class... Args, RetType(TClass::*Func)(Args...) const>
+class StaticMemberDelegate<Func> {
+public:
+    typedef RetType(TClass::*ConstMemberFunc)(Args...) const;
+    using DelegateType = DelegateMember<const TClass, RetType(Args...)>;
+
+    static_assert(Func != nullptr, "StaticMemberDelegate target function is nullptr");
+
+    /// @brief Constructor to create a class instance.
+    /// @param[in] object The target instance. Must outlive every call.
+    explicit StaticMemberDelegate(const TClass* object) noexcept : m_object(object) { }
+
+    /// @brief Invoke the target function. The object must not be nullptr.
+    /// @param[in] args The function arguments, if any.
+    /// @return The target function return value, if any.
+    RetType operator()(Args... args) const {
+        return (m_object->*Func)(std::forward<Args>(args)...);
+    }
+
+    /// @brief Get the target instance.
+    /// @return The target instance.
+    const TClass* GetObject() const noexcept { return m_object; }
+
+    /// @brief Convert to a `DelegateMember<>` bound to the target instance and function,
+    /// e.g. to insert into a delegate container.
+    /// @return The equivalent `DelegateMember<>`.
+    operator DelegateType() const { return DelegateType(m_object, Func); }
+
+private:
+    /// Pointer to a class object, representing the bound target instance.
+    const TClass* m_object;
+};
+
+}
+
+#endif
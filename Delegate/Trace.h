@@ -0,0 +1,351 @@
+#ifndef _DELEGATELIB_TRACE_H
+#define _DELEGATELIB_TRACE_H
+
+/// @file
+/// @brief Lightweight hot path tracing exported as Chrome trace JSON.
+///
+/// @details Scoped trace macros record events into a lock-free ring buffer owned
+/// by the calling thread, so tracing takes no lock and the buffers never grow.
+/// Once full, a buffer overwrites its oldest events. `Trace::WriteChromeJson()`
+/// dumps every buffer at any time as a Chrome trace, which also opens in Perfetto
+/// (ui.perfetto.dev) and chrome://tracing. Flow events link a `DelegateAsync`
+/// call to its invocation on the destination thread.
+///
+/// The macros compile to nothing unless `TRACE_ENABLE` is defined. Once compiled in,
+/// recording is off until `Trace::SetEnabled(true)` so a production build carries
+/// only a relaxed load per trace point.
+///
+/// Event names must be string literals or otherwise have static storage duration.
+///
+/// Code example:
+///
+/// `void Process() { TRACE_SCOPE("Process"); ... }`
+/// `Trace::SetEnabled(true);`
+/// `Trace::WriteChromeJson("trace.json");`
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace DelegateLib {
+
+/// @brief A ring of trace events written by one thread. Readers may copy the
+/// events at any time and discard those overwritten while copying.
+class trace_buffer
+{
+public:
+	/// Events held per thread. Must be a power of 2.
+	static const size_t CAPACITY = 8192;
+
+	/// A copied event
+	struct Event
+	{
+		const char* name;
+		uint64_t start;
+		uint64_t duration;
+		uint64_t id;
+		char phase;
+	};
+
+	explicit trace_buffer(uint32_t tid) : m_tid(tid), m_events(new Slot[CAPACITY]) {}
+
+	/// Add an event. Called by the owning thread only.
+	void Add(char phase, const char* name, uint64_t start, uint64_t duration, uint64_t id)
+	{
+		// Claim the slot first so a reader knows it may be overwritten
+		uint64_t head = m_claimed.load(std::memory_order_relaxed);
+		m_claimed.store(head + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		Slot& slot = m_events[head & (CAPACITY - 1)];
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.start.store(start, std::memory_order_relaxed);
+		slot.duration.store(duration, std::memory_order_relaxed);
+		slot.id.store(id, std::memory_order_relaxed);
+		slot.phase.store(phase, std::memory_order_relaxed);
+		m_published.store(head + 1, std::memory_order_release);
+	}
+
+	/// Copy the events not overwritten, oldest first. Called by any thread.
+	void Copy(std::vector<Event>& events) const
+	{
+		uint64_t published = m_published.load(std::memory_order_acquire);
+		uint64_t first = published > CAPACITY ? published - CAPACITY : 0;
+		size_t start = events.size();
+		for (uint64_t i = first; i < published; i++)
+		{
+			const Slot& slot = m_events[i & (CAPACITY - 1)];
+			events.push_back(Event{ slot.name.load(std::memory_order_relaxed),
+				slot.start.load(std::memory_order_relaxed), slot.duration.load(std::memory_order_relaxed),
+				slot.id.load(std::memory_order_relaxed), slot.phase.load(std::memory_order_relaxed) });
+		}
+
+		// Drop the oldest events if the writer claimed their slots while copying
+		std::atomic_thread_fence(std::memory_order_acquire);
+		uint64_t claimed = m_claimed.load(std::memory_order_relaxed);
+		uint64_t valid = claimed > CAPACITY ? claimed - CAPACITY : 0;
+		if (valid > first)
+			events.erase(events.begin() + start, events.begin() + start + (size_t)std::min(valid - first, published - first));
+	}
+
+	/// Discard the events. Called by the owning thread, or while it is not tracing.
+	void Clear()
+	{
+		m_published.store(0, std::memory_order_relaxed);
+		m_claimed.store(0, std::memory_order_relaxed);
+	}
+
+	uint32_t GetTid() const { return m_tid; }
+
+	/// Thread name shown in the trace. Protected by the Trace registry lock.
+	std::string name;
+
+private:
+	trace_buffer(const trace_buffer&) = delete;
+	trace_buffer& operator=(const trace_buffer&) = delete;
+
+	struct Slot
+	{
+		std::atomic<const char*> name{ nullptr };
+		std::atomic<uint64_t> start{ 0 };
+		std::atomic<uint64_t> duration{ 0 };
+		std::atomic<uint64_t> id{ 0 };
+		std::atomic<char> phase{ 0 };
+	};
+
+	const uint32_t m_tid;
+	std::unique_ptr<Slot[]> m_events;
+	std::atomic<uint64_t> m_claimed{ 0 };
+	std::atomic<uint64_t> m_published{ 0 };
+};
+
+/// @brief The trace recorder. All functions are thread safe.
+class Trace
+{
+public:
+	/// Start or stop recording trace events
+	/// @param[in] enable - true to record
+	static void SetEnabled(bool enable) { Enabled().store(enable, std::memory_order_relaxed); }
+
+	/// Check if trace events are recorded
+	/// @return True if recording.
+	static bool IsEnabled() { return Enabled().load(std::memory_order_relaxed); }
+
+	/// Get the trace time
+	/// @return Nanoseconds of the steady clock.
+	static uint64_t Now()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// Name the calling thread in the trace
+	/// @param[in] name - the thread name
+	static void SetThreadName(const std::string& name)
+	{
+		trace_buffer& buffer = GetThreadBuffer();
+		const std::lock_guard<std::mutex> lock(RegistryLock());
+		buffer.name = name;
+	}
+
+	/// Record a slice of the calling thread
+	/// @param[in] name - the slice name
+	/// @param[in] start - the Now() time the slice started
+	/// @param[in] end - the Now() time the slice ended
+	static void Complete(const char* name, uint64_t start, uint64_t end)
+	{
+		GetThreadBuffer().Add('X', name, start, end - start, 0);
+	}
+
+	/// Record an instant event on the calling thread
+	/// @param[in] name - the event name
+	static void Instant(const char* name) { GetThreadBuffer().Add('i', name, Now(), 0, 0); }
+
+	/// Start a flow from the enclosing slice, e.g. a message send
+	/// @param[in] id - the flow id shared with FlowEnd()
+	static void FlowBegin(uint64_t id) { GetThreadBuffer().Add('s', "flow", Now(), 0, id); }
+
+	/// End a flow at the enclosing slice, e.g. the message invoke
+	/// @param[in] id - the flow id passed to FlowBegin()
+	static void FlowEnd(uint64_t id) { GetThreadBuffer().Add('f', "flow", Now(), 0, id); }
+
+	/// Discard the recorded events. The buffers of exited threads are released.
+	static void Clear()
+	{
+		const std::lock_guard<std::mutex> lock(RegistryLock());
+		auto& buffers = Buffers();
+		buffers.erase(std::remove_if(buffers.begin(), buffers.end(),
+			[](const std::shared_ptr<trace_buffer>& buffer) { return buffer.use_count() == 1; }), buffers.end());
+		for (auto& buffer : buffers)
+			buffer->Clear();
+	}
+
+	/// Write the recorded events as Chrome trace JSON
+	/// @param[in] out - the stream to write
+	/// @return True if written.
+	static bool WriteChromeJson(std::ostream& out)
+	{
+		std::vector<std::shared_ptr<trace_buffer>> buffers;
+		std::vector<std::string> names;
+		{
+			const std::lock_guard<std::mutex> lock(RegistryLock());
+			buffers = Buffers();
+			for (auto& buffer : buffers)
+				names.push_back(buffer->name);
+		}
+
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		bool first = true;
+		std::vector<trace_buffer::Event> events;
+		for (size_t b = 0; b < buffers.size(); b++)
+		{
+			uint32_t tid = buffers[b]->GetTid();
+			if (!names[b].empty())
+			{
+				out << (first ? "" : ",") << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << tid
+					<< ",\"args\":{\"name\":\"" << Escape(names[b]) << "\"}}";
+				first = false;
+			}
+
+			events.clear();
+			buffers[b]->Copy(events);
+			for (const auto& e : events)
+			{
+				char ts[32];
+				snprintf(ts, sizeof(ts), "%.3f", (double)e.start / 1000.0);
+				out << (first ? "" : ",") << "\n{\"ph\":\"" << e.phase << "\",\"name\":\""
+					<< Escape(e.name ? e.name : "") << "\",\"cat\":\"delegate\",\"pid\":1,\"tid\":" << tid
+					<< ",\"ts\":" << ts;
+				if (e.phase == 'X')
+				{
+					snprintf(ts, sizeof(ts), "%.3f", (double)e.duration / 1000.0);
+					out << ",\"dur\":" << ts;
+				}
+				else if (e.phase == 's' || e.phase == 'f')
+					out << ",\"id\":" << e.id << (e.phase == 'f' ? ",\"bp\":\"e\"" : "");
+				else if (e.phase == 'i')
+					out << ",\"s\":\"t\"";
+				out << "}";
+				first = false;
+			}
+		}
+		out << "\n]}\n";
+		return out.good();
+	}
+
+	/// Write the recorded events as Chrome trace JSON
+	/// @param[in] path - the file to write
+	/// @return True if written.
+	static bool WriteChromeJson(const std::string& path)
+	{
+		std::ofstream out(path, std::ios::trunc);
+		return out && WriteChromeJson(out);
+	}
+
+private:
+	static trace_buffer& GetThreadBuffer()
+	{
+		thread_local std::shared_ptr<trace_buffer> buffer;
+		if (!buffer)
+		{
+			const std::lock_guard<std::mutex> lock(RegistryLock());
+			static uint32_t nextTid = 1;
+			buffer = std::make_shared<trace_buffer>(nextTid++);
+			Buffers().push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	static std::string Escape(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			if ((unsigned char)c >= 0x20)
+				escaped += c;
+		}
+		return escaped;
+	}
+
+	static std::atomic<bool>& Enabled()
+	{
+		static std::atomic<bool> enabled{ false };
+		return enabled;
+	}
+
+	static std::mutex& RegistryLock()
+	{
+		static std::mutex lock;
+		return lock;
+	}
+
+	static std::vector<std::shared_ptr<trace_buffer>>& Buffers()
+	{
+		static std::vector<std::shared_ptr<trace_buffer>> buffers;
+		return buffers;
+	}
+};
+
+/// @brief Records a slice from construction to destruction. Used by TRACE_SCOPE.
+class trace_scope
+{
+public:
+	explicit trace_scope(const char* name) : m_name(Trace::IsEnabled() ? name : nullptr)
+	{
+		if (m_name)
+			m_start = Trace::Now();
+	}
+
+	~trace_scope()
+	{
+		if (m_name)
+			Trace::Complete(m_name, m_start, Trace::Now());
+	}
+
+private:
+	trace_scope(const trace_scope&) = delete;
+	trace_scope& operator=(const trace_scope&) = delete;
+
+	const char* m_name;
+	uint64_t m_start = 0;
+};
+
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef TRACE_ENABLE
+/// Record the enclosing scope as a slice
+#define TRACE_SCOPE(name) DelegateLib::trace_scope TRACE_CONCAT(_traceScope, __LINE__)(name)
+
+/// Record an instant event
+#define TRACE_INSTANT(name) do { if (DelegateLib::Trace::IsEnabled()) DelegateLib::Trace::Instant(name); } while (0)
+
+/// Start a flow from the enclosing slice
+#define TRACE_FLOW_BEGIN(id) do { if (DelegateLib::Trace::IsEnabled()) DelegateLib::Trace::FlowBegin(id); } while (0)
+
+/// End a flow at the enclosing slice
+#define TRACE_FLOW_END(id) do { if (DelegateLib::Trace::IsEnabled()) DelegateLib::Trace::FlowEnd(id); } while (0)
+
+/// Name the calling thread in the trace
+#define TRACE_THREAD_NAME(name) DelegateLib::Trace::SetThreadName(name)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_INSTANT(name) do { } while (0)
+#define TRACE_FLOW_BEGIN(id) do { } while (0)
+#define TRACE_FLOW_END(id) do { } while (0)
+#define TRACE_THREAD_NAME(name) do { } while (0)
+#endif
+
+#endif
@@ -43,13 +43,13 @@ public:
     /// @param[in] args The arguments used when invoking the target function
     /// @return The target function return value. 
     RetType operator()(Args... args) {
-        return (*m_delegate)(args...);	// Invoke delegate callback
+        return (*m_delegate)(std::forward<Args>(args)...);	// Invoke delegate callback
     }
 
     /// Invoke the bound target functions. 
     /// @param[in] args The arguments used when invoking the target function
     void Broadcast(Args... args) {
-        (*this)(args...);
+        (*this)(std::forward<Args>(args)...);
     }
 
     /// Assign a delegate to the container.
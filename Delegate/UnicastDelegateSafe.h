@@ -0,0 +1,152 @@
+#ifndef _UNICAST_DELEGATE_SAFE_H
+#define _UNICAST_DELEGATE_SAFE_H
+
+/// @file
+/// @brief Delegate container for storing an invoking a single delegate instance.
+/// Class is thread safe.
+
+#include "Delegate.h"
+#include <memory>
+#include <atomic>
+#include <type_traits>
+
+namespace DelegateLib {
+
+template <class R>
+struct UnicastDelegateSafe; // Not defined
+
+/// @brief A thread-safe delegate container storing one delegate. Void and
+/// non-void return values supported.
+/// @details The delegate is an immutable instance published atomically. An invocation
+/// takes the current delegate and invokes it without holding a lock, so the delegate
+/// may be reassigned or cleared by another thread, or by the target function itself,
+/// while it is being invoked. An invocation in progress completes with the delegate
+/// it took.
+template<class RetType, class... Args>
+class UnicastDelegateSafe<RetType(Args...)>
+{
+public:
+    using DelegateType = Delegate<RetType(Args...)>;
+
+    UnicastDelegateSafe() = default;
+    ~UnicastDelegateSafe() = default;
+
+    /// @brief Copy constructor that creates a copy of the given instance.
+    /// @param[in] rhs The object to copy from.
+    UnicastDelegateSafe(const UnicastDelegateSafe& rhs) {
+        auto delegate = rhs.Snapshot();
+        if (delegate)
+            Publish(CloneDelegate(*delegate));
+    }
+
+    UnicastDelegateSafe(UnicastDelegateSafe&& rhs) = delete;
+
+    /// Invoke the bound target. Does nothing if the container is empty.
+    /// @param[in] args The arguments used when invoking the target function
+    /// @return The target function return value, or a value-initialized `RetType` if
+    /// the container is empty.
+    RetType operator()(Args... args) {
+        auto delegate = Snapshot();
+        if (!delegate) {
+            if constexpr (std::is_void_v<RetType>)
+                return;
+            else
+                return RetType();
+        }
+        return (*delegate)(std::forward<Args>(args)...);	// Invoke delegate callback
+    }
+
+    /// Invoke the bound target functions.
+    /// @param[in] args The arguments used when invoking the target function
+    void Broadcast(Args... args) {
+        (*this)(std::forward<Args>(args)...);
+    }
+
+    /// Assign a delegate to the container.
+    /// @param[in] rhs A delegate target to assign
+    void operator=(const DelegateType& rhs) { Publish(CloneDelegate(rhs)); }
+
+    /// Assign a delegate to the container.
+    /// @param[in] rhs A delegate target to assign
+    void operator=(DelegateType&& rhs) { Publish(CloneDelegate(rhs)); }
+
+    /// @brief Assignment operator that assigns the state of one object to another.
+    /// @param[in] rhs The object whose state is to be assigned to the current object.
+    /// @return A reference to the current object.
+    UnicastDelegateSafe& operator=(const UnicastDelegateSafe& rhs) {
+        if (&rhs != this) {
+            auto delegate = rhs.Snapshot();
+            Publish(delegate ? CloneDelegate(*delegate) : nullptr);
+        }
+        return *this;
+    }
+
+    /// @brief Move assignment operator that transfers ownership of resources.
+    /// @param[in] rhs The object to move from.
+    /// @return A reference to the current object.
+    UnicastDelegateSafe& operator=(UnicastDelegateSafe&& rhs) noexcept {
+        if (&rhs != this) {
+            auto delegate = std::atomic_exchange_explicit(&rhs.m_delegate,
+                std::shared_ptr<DelegateType>(), std::memory_order_acq_rel);
+            Publish(std::move(delegate));
+        }
+        return *this;
+    }
+
+    /// @brief Clear the all target functions.
+    virtual void operator=(std::nullptr_t) noexcept { Clear(); }
+
+    /// Any registered delegates?
+    /// @return `true` if delegate container is empty.
+    bool Empty() const { return !Snapshot(); }
+
+    /// Remove the registered delegate
+    void Clear() noexcept { Publish(nullptr); }
+
+    /// Get the number of delegates stored.
+    /// @return The number of delegates stored.
+    std::size_t Size() const { return Empty() ? 0 : 1; }
+
+    /// @brief Implicit conversion operator to `bool`.
+    /// @return `true` if the container is not empty, `false` if the container is empty.
+    explicit operator bool() const { return !Empty(); }
+
+private:
+    /// Get the registered delegate. The delegate is never replaced in place once published.
+    /// @return The delegate, or nullptr if empty.
+    std::shared_ptr<DelegateType> Snapshot() const {
+        return std::atomic_load_explicit(&m_delegate, std::memory_order_acquire);
+    }
+
+    /// Publish a new delegate. The previous delegate is destroyed once the last
+    /// invocation using it returns.
+    /// @param[in] delegate The new delegate, or nullptr if empty.
+    void Publish(std::shared_ptr<DelegateType> delegate) noexcept {
+        std::atomic_store_explicit(&m_delegate, std::move(delegate), std::memory_order_release);
+    }
+
+    /// Clone a delegate for storage within the container.
+    /// @param[in] delegate The delegate to clone.
+    /// @return The stored delegate.
+    /// @throws std::bad_alloc If dynamic memory allocation fails and USE_ASSERTS not defined.
+    static std::shared_ptr<DelegateType> CloneDelegate(const DelegateType& delegate) {
+        auto delegateClone = delegate.Clone();
+        if (!delegateClone)
+            BAD_ALLOC();
+
+        DELEGATE_TRY {
+            return std::shared_ptr<DelegateType>(delegateClone);
+        }
+        DELEGATE_CATCH(const std::bad_alloc&) {
+            BAD_ALLOC();
+        }
+        return nullptr;
+    }
+
+    /// Registered delegate. Read with `Snapshot()`, written with `Publish()`.
+    std::shared_ptr<DelegateType> m_delegate;
+};
+
+}
+
+#endif
@@ -0,0 +1,236 @@
+#ifndef _INLINE_FUNCTION_H
+#define _INLINE_FUNCTION_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief A callable wrapper storing its target inline, used by `DelegateFunction<>`.
+///
+/// @details `inline_function<>` holds any copyable callable object, such as a lambda,
+/// a function pointer or a `std::function`. A callable of up to `Size` bytes is stored
+/// within the wrapper itself, so binding, copying and invoking a capturing lambda
+/// allocates nothing. A larger or over-aligned callable, or one whose move constructor
+/// may throw, is stored on the heap. `DELEGATE_FUNCTION_SIZE` in `DelegateOpt.h` sets
+/// the default `Size`.
+///
+/// `target_type()` identifies the type of the stored callable with `type_id<>()`, so
+/// two wrappers can be compared without RTTI. Binding an empty `std::function` or a
+/// null function pointer leaves the wrapper empty.
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "DelegateOpt.h"
+#include "DelegateTypeId.h"
+
+namespace DelegateLib
+{
+
+template <class F>
+struct is_std_function : std::false_type {};
+
+template <class R, class... Args>
+struct is_std_function<std::function<R(Args...)>> : std::true_type {};
+
+/// @brief Deduce the function signature of a callable object with one non-template
+/// `operator()`, such as a non-generic lambda. `type` is undefined otherwise.
+template <class F, class = void>
+struct callable_signature {};
+
+template <class F>
+struct callable_signature<F, std::void_t<decltype(&F::operator())>> :
+    callable_signature<decltype(&F::operator())> {};
+
+template <class C, class R, class... Args>
+struct callable_signature<R(C::*)(Args...)> { using type = R(Args...); };
+
+template <class C, class R, class... Args>
+struct callable_signature<R(C::*)(Args...) const> { using type = R(Args...); };
+
+template <class C, class R, class... Args>
+struct callable_signature<R(C::*)(Args...) noexcept> { using type = R(Args...); };
+
+template <class C, class R, class... Args>
+struct callable_signature<R(C::*)(Args...) const noexcept> { using type = R(Args...); };
+
+template <class Sig, size_t Size = DELEGATE_FUNCTION_SIZE>
+class inline_function; // Not defined
+
+/// @brief A copyable callable wrapper with inline storage for its target.
+/// @tparam RetType The return type of the target.
+/// @tparam Args The argument types of the target.
+/// @tparam Size The inline storage size in bytes.
+template <class RetType, class... Args, size_t Size>
+class inline_function<RetType(Args...), Size>
+{
+    static_assert(Size >= sizeof(void*), "inline_function Size too small");
+
+    /// Alignment of the inline storage. Kept to that of a pointer or `double` so the 
+    /// wrapper adds no padding to a delegate.
+    static constexpr size_t ALIGN = alignof(void*) > alignof(double) ? alignof(void*) : alignof(double);
+
+    /// `true` if a callable of type `F` is stored inline
+    template <class F>
+    static constexpr bool IS_INLINE = sizeof(F) <= Size &&
+        alignof(F) <= ALIGN && std::is_nothrow_move_constructible_v<F>;
+
+public:
+    inline_function() noexcept = default;
+    inline_function(std::nullptr_t) noexcept {}
+
+    /// @brief Constructor storing a copy of a callable.
+    /// @param[in] func The callable to store.
+    /// @throws std::bad_alloc If the callable is stored on the heap and the heap is exhausted.
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, inline_function> &&
+        std::is_invocable_r_v<RetType, std::decay_t<F>&, Args...>>>
+    inline_function(F&& func) { Store(std::forward<F>(func)); }
+
+    inline_function(const inline_function& rhs) {
+        if (rhs.m_ops) {
+            rhs.m_ops->copy(rhs.Storage(), Storage());
+            m_ops = rhs.m_ops;
+        }
+    }
+
+    inline_function(inline_function&& rhs) noexcept {
+        if (rhs.m_ops) {
+            rhs.m_ops->move(rhs.Storage(), Storage());
+            m_ops = rhs.m_ops;
+            rhs.m_ops = nullptr;
+        }
+    }
+
+    ~inline_function() { Reset(); }
+
+    inline_function& operator=(const inline_function& rhs) {
+        if (&rhs != this) {
+            inline_function copy(rhs);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    inline_function& operator=(inline_function&& rhs) noexcept {
+        if (&rhs != this) {
+            Reset();
+            if (rhs.m_ops) {
+                rhs.m_ops->move(rhs.Storage(), Storage());
+                m_ops = rhs.m_ops;
+                rhs.m_ops = nullptr;
+            }
+        }
+        return *this;
+    }
+
+    inline_function& operator=(std::nullptr_t) noexcept {
+        Reset();
+        return *this;
+    }
+
+    /// @brief Invoke the target. The wrapper must not be empty.
+    /// @param[in] args The function arguments, if any.
+    /// @return The target return value, if any.
+    RetType operator()(Args... args) const {
+        return m_ops->invoke(const_cast<void*>(Storage()), std::forward<Args>(args)...);
+    }
+
+    /// @return `true` if a target is stored.
+    explicit operator bool() const noexcept { return m_ops != nullptr; }
+
+    /// @brief Get the type of the stored target.
+    /// @return The `type_id<>()` of the target type, or nullptr if empty.
+    const void* target_type() const noexcept { return m_ops ? m_ops->type : nullptr; }
+
+    /// @brief Get the stored target.
+    /// @tparam T The target type.
+    /// @return The target, or nullptr if empty or not a `T`.
+    template <class T>
+    const T* target() const noexcept {
+        if (target_type() != type_id<T>())
+            return nullptr;
+        return IS_INLINE<T> ? static_cast<const T*>(Storage()) : *static_cast<T* const*>(Storage());
+    }
+
+private:
+    /// Operations on a stored target of one type
+    struct Ops
+    {
+        RetType (*invoke)(void* storage, Args&&... args);
+        void (*copy)(const void* src, void* dst);
+        void (*move)(void* src, void* dst) noexcept;
+        void (*destroy)(void* storage) noexcept;
+        const void* type;
+    };
+
+    /// The `Ops` of a target of type `F` stored inline
+    template <class F>
+    struct InlineOps
+    {
+        static RetType Invoke(void* storage, Args&&... args) {
+            return static_cast<RetType>(std::invoke(*static_cast<F*>(storage), std::forward<Args>(args)...));
+        }
+        static void Copy(const void* src, void* dst) { new(dst) F(*static_cast<const F*>(src)); }
+        static void Move(void* src, void* dst) noexcept {
+            new(dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        }
+        static void Destroy(void* storage) noexcept { static_cast<F*>(storage)->~F(); }
+        static constexpr Ops OPS = { &Invoke, &Copy, &Move, &Destroy, type_id<F>() };
+    };
+
+    /// The `Ops` of a target of type `F` stored on the heap
+    template <class F>
+    struct HeapOps
+    {
+        static F*& Get(void* storage) noexcept { return *static_cast<F**>(storage); }
+        static RetType Invoke(void* storage, Args&&... args) {
+            return static_cast<RetType>(std::invoke(*Get(storage), std::forward<Args>(args)...));
+        }
+        static void Copy(const void* src, void* dst) {
+            new(dst) F*(new F(**static_cast<F* const*>(src)));
+        }
+        static void Move(void* src, void* dst) noexcept {
+            new(dst) F*(Get(src));
+            Get(src) = nullptr;
+        }
+        static void Destroy(void* storage) noexcept { delete Get(storage); }
+        static constexpr Ops OPS = { &Invoke, &Copy, &Move, &Destroy, type_id<F>() };
+    };
+
+    template <class F>
+    void Store(F&& func) {
+        using T = std::decay_t<F>;
+        if constexpr (std::is_pointer_v<T> || std::is_member_pointer_v<T> || is_std_function<T>::value) {
+            if (!func)
+                return;
+        }
+        if constexpr (IS_INLINE<T>) {
+            new(Storage()) T(std::forward<F>(func));
+            m_ops = &InlineOps<T>::OPS;
+        }
+        else {
+            new(Storage()) T*(new T(std::forward<F>(func)));
+            m_ops = &HeapOps<T>::OPS;
+        }
+    }
+
+    void Reset() noexcept {
+        if (m_ops) {
+            m_ops->destroy(Storage());
+            m_ops = nullptr;
+        }
+    }
+
+    void* Storage() noexcept { return m_storage; }
+    const void* Storage() const noexcept { return m_storage; }
+
+    alignas(ALIGN) unsigned char m_storage[Size];
+    const Ops* m_ops = nullptr;
+};
+
+}
+
+#endif
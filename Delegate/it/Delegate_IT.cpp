@@ -0,0 +1,1042 @@
+// Integration tests for the Delegate library
+//
+// @see https://github.com/endurodave/IntegrationTestFramework
+//
+// All tests run within the IntegrationTest thread context. Asynchronous
+// delegates under test are invoked on Port library threads. The Google Test
+// library is used to execute tests and collect results.
+
+#include "DelegateLib.h"
+#include "WorkerThreadStd.h"
+#include "LockProfile.h"
+#include "WorkerThreadPool.h"
+#include "xallocator.h"
+#include <cstring>
+#include <future>
+#include <set>
+#include <sstream>
+#include <thread>
+#include "IT_Util.h"		// Include this last
+
+using namespace std;
+using namespace std::chrono;
+using namespace DelegateLib;
+
+static std::vector<DelegateError> delegateErrors;
+static void RecordDelegateError(DelegateError error) { delegateErrors.push_back(error); }
+static void ErrorTarget(int) {}
+
+// Test delegate errors reach the error handler, and throw while exceptions are enabled
+TEST(Delegate_IT, DelegateErrorHandler)
+{
+	EXPECT_EQ(SetDelegateErrorHandler(&RecordDelegateError), nullptr);
+	ReportDelegateError(DelegateError::THREAD_NOT_RUNNING);
+	ASSERT_EQ(delegateErrors.size(), 1u);
+	EXPECT_EQ(delegateErrors[0], DelegateError::THREAD_NOT_RUNNING);
+
+	// A thread not created rejects messages
+	WorkerThread thread("ErrorThread");
+#ifdef DELEGATE_NO_EXCEPTIONS
+	MakeDelegate(&ErrorTarget, thread).AsyncInvoke(1);
+	EXPECT_EQ(delegateErrors.size(), 2u);
+#else
+	EXPECT_THROW(MakeDelegate(&ErrorTarget, thread).AsyncInvoke(1), std::invalid_argument);
+	EXPECT_EQ(delegateErrors.size(), 1u);
+#endif
+
+	EXPECT_EQ(SetDelegateErrorHandler(nullptr), &RecordDelegateError);
+	delegateErrors.clear();
+}
+
+// Test the semaphore and the atomic word wait hand off between threads and time out
+TEST(Delegate_IT, AtomicWait)
+{
+	DelegateLib::Semaphore sema;
+	EXPECT_FALSE(sema.Wait(std::chrono::milliseconds(1)));
+	sema.Signal();
+	EXPECT_TRUE(sema.Wait(std::chrono::nanoseconds::max()));
+
+	// Each signal wakes the waiting thread once
+	const int HANDOFFS = 1000;
+	DelegateLib::Semaphore ping, pong;
+	std::thread partner([&]() {
+		for (int i = 0; i < HANDOFFS; i++)
+		{
+			ping.Wait(std::chrono::nanoseconds::max());
+			pong.Signal();
+		}
+	});
+	int handoffs = 0;
+	for (int i = 0; i < HANDOFFS; i++)
+	{
+		ping.Signal();
+		if (pong.Wait(std::chrono::seconds(5)))
+			handoffs++;
+	}
+	partner.join();
+	EXPECT_EQ(handoffs, HANDOFFS);
+
+	// A word changed before the wake is seen by the sleeping thread
+	std::atomic<uint32_t> word{ 0 };
+	std::thread waker([&]() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		word.store(1, std::memory_order_release);
+		DelegateLib::AtomicWake(word);
+	});
+	while (word.load(std::memory_order_acquire) == 0)
+		DelegateLib::AtomicWait(word, 0);
+	waker.join();
+	std::chrono::nanoseconds timeout = std::chrono::milliseconds(1);
+	DelegateLib::AtomicWait(word, 1, &timeout);
+	EXPECT_EQ(word.load(), 1u);
+}
+
+// Test the lock contention profiler
+TEST(Delegate_IT, LockProfile)
+{
+	// A ProfiledMutex records without LOCK_PROFILE_ENABLE too
+	static ProfiledMutex mutex("Delegate_IT.LockProfile");
+	lock_site* site = LockProfiler::GetSite("Delegate_IT.LockProfile");
+	site->Reset();
+	EXPECT_EQ(site, LockProfiler::GetSite("Delegate_IT.LockProfile"));
+
+	// Hold the lock while a second thread waits for it
+	std::atomic<bool> waiting{ false };
+	std::thread waiter;
+	{
+		std::lock_guard<ProfiledMutex> lock(mutex);
+		waiter = std::thread([&waiting]() {
+			waiting = true;
+			std::lock_guard<ProfiledMutex> inner(mutex);
+		});
+		while (!waiting)
+			std::this_thread::yield();
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+	waiter.join();
+	EXPECT_TRUE(mutex.try_lock());
+	mutex.unlock();
+
+	LockSample sample = site->Sample();
+	EXPECT_EQ(sample.acquisitions, 3u);
+	EXPECT_EQ(sample.contended, 1u);
+	EXPECT_GE(sample.waitNs, 10000000u);
+	EXPECT_EQ(sample.maxWaitNs, sample.waitNs);
+	EXPECT_GE(sample.holdNs, 20000000u);
+	EXPECT_GE(sample.maxHoldNs, 20000000u);
+
+	// Disabled acquisitions are not recorded
+	LockProfiler::SetEnabled(false);
+	mutex.lock();
+	mutex.unlock();
+	LockProfiler::SetEnabled(true);
+	EXPECT_EQ(site->Sample().acquisitions, 3u);
+
+	std::ostringstream report;
+	EXPECT_TRUE(LockProfiler::WriteReport(report, LockSort::CONTENDED));
+	EXPECT_NE(report.str().find("contended"), string::npos);
+	EXPECT_NE(report.str().find("Delegate_IT.LockProfile"), string::npos);
+
+	auto samples = LockProfiler::GetSamples(LockSort::NAME);
+	for (size_t i = 1; i < samples.size(); i++)
+		EXPECT_LT(samples[i - 1].name, samples[i].name);
+
+	site->Reset();
+	EXPECT_EQ(site->Sample().acquisitions, 0u);
+}
+
+static std::atomic<int> broadcastCalls{ 0 };
+static std::atomic<int> broadcastSum{ 0 };
+
+static void BroadcastTarget(int value)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	broadcastSum += value;
+	broadcastCalls++;
+}
+
+// Test a parallel broadcast runs the targets concurrently on a pool and returns
+// once all of them have run, and runs them on the calling thread when the
+// thread is not running
+TEST(Delegate_IT, ParallelBroadcast)
+{
+	static const int TARGETS = 4;
+
+	MulticastDelegateSafe<void(int)> event;
+	for (int i = 0; i < TARGETS; i++)
+		event += MakeDelegate(&BroadcastTarget);
+
+	WorkerThreadPool pool("ParallelBroadcast", TARGETS);
+	ASSERT_TRUE(pool.CreateThread());
+	auto start = steady_clock::now();
+	std::vector<bool> success = event.ParallelBroadcast(pool, 2);
+	auto elapsed = steady_clock::now() - start;
+	EXPECT_EQ(broadcastCalls, TARGETS);
+	EXPECT_EQ(broadcastSum, TARGETS * 2);
+	ASSERT_EQ(success.size(), (size_t)TARGETS);
+	for (bool ok : success)
+		EXPECT_TRUE(ok);
+
+	// Serially the targets take TARGETS * 50ms
+	EXPECT_LT(elapsed, milliseconds(50 * TARGETS));
+	pool.ExitThread();
+
+	// A thread not running leaves every target to the calling thread
+	WorkerThread stopped("ParallelBroadcastStopped");
+	broadcastCalls = 0;
+	success = event.ParallelBroadcast(stopped, 1);
+	EXPECT_EQ(broadcastCalls, TARGETS);
+	EXPECT_EQ(success, std::vector<bool>(TARGETS, true));
+}
+
+#ifdef USE_ALLOCATOR
+static void XallocTarget(int) {}
+#endif
+
+// Test the fixed block allocator rounds requests to its size classes, reuses
+// freed blocks, and frees blocks on a thread other than the allocating one
+TEST(Delegate_IT, Xallocator)
+{
+	// Size classes step by 16 bytes to 256, then by powers of two
+	EXPECT_EQ(xalloc_class_size(xalloc_class(1)), 16u);
+	EXPECT_EQ(xalloc_class_size(xalloc_class(16)), 16u);
+	EXPECT_EQ(xalloc_class_size(xalloc_class(17)), 32u);
+	EXPECT_EQ(xalloc_class_size(xalloc_class(256)), 256u);
+	EXPECT_EQ(xalloc_class_size(xalloc_class(257)), 512u);
+	EXPECT_EQ(xalloc_class_size(xalloc_class(XALLOC_MAX_BLOCK)), XALLOC_MAX_BLOCK);
+	EXPECT_EQ(xalloc_class(XALLOC_MAX_BLOCK), XALLOC_CLASSES - 1);
+
+	// A freed block is the next block of its size class
+	void* block = xmalloc(40);
+	ASSERT_NE(block, nullptr);
+	EXPECT_EQ((uintptr_t)block % XALLOC_ALIGN, 0u);
+	memset(block, 0xA5, 40);
+	xfree(block, 40);
+	EXPECT_EQ(xmalloc(48), block);
+	xfree(block, 48);
+
+	// Blocks are distinct and aligned, and once freed are reused rather than
+	// taken from the heap
+	static const int BLOCKS = 32;
+	std::set<void*> first;
+	for (int i = 0; i < BLOCKS; i++)
+	{
+		void* ptr = xmalloc(64);
+		EXPECT_EQ((uintptr_t)ptr % XALLOC_ALIGN, 0u);
+		memset(ptr, i, 64);
+		first.insert(ptr);
+	}
+	EXPECT_EQ(first.size(), (size_t)BLOCKS);
+	for (void* ptr : first)
+		xfree(ptr, 64);
+	std::set<void*> second;
+	for (int i = 0; i < BLOCKS; i++)
+		second.insert(xmalloc(64));
+	EXPECT_EQ(second, first);
+
+	// Blocks freed on another thread return to the central free list
+	std::thread freer([&second]() {
+		for (void* ptr : second)
+			xfree(ptr, 64);
+	});
+	freer.join();
+
+	// Requests above the largest block and NUMA node pools
+	void* large = xmalloc(XALLOC_MAX_BLOCK + 1);
+	ASSERT_NE(large, nullptr);
+	memset(large, 0, XALLOC_MAX_BLOCK + 1);
+	xfree(large, XALLOC_MAX_BLOCK + 1);
+	void* local = xmalloc(64, 0);
+	ASSERT_NE(local, nullptr);
+	xfree(local, 64, 0);
+	EXPECT_EQ(xmalloc(64, 0), local);
+	xfree(local, 64, 0);
+
+#ifdef USE_ALLOCATOR
+	// Delegates are allocated from the fixed block allocator
+	auto delegate = MakeDelegate(&XallocTarget);
+	auto clone = delegate.Clone();
+	void* address = clone;
+	delete clone;
+	clone = delegate.Clone();
+	EXPECT_EQ((void*)clone, address);
+	delete clone;
+#endif
+}
+
+static int staticSum = 0;
+
+static int StaticFree(int value)
+{
+	staticSum += value;
+	return value * 2;
+}
+
+class StaticTarget
+{
+public:
+	int Add(int value) { m_sum += value; return m_sum; }
+	int Get(int offset) const { return m_sum + offset; }
+private:
+	int m_sum = 0;
+};
+
+// Test static delegates call their compile time targets directly and convert
+// to delegates equal to those created with MakeDelegate()
+TEST(Delegate_IT, StaticDelegate)
+{
+	staticSum = 0;
+	StaticDelegate<&StaticFree> free;
+	EXPECT_EQ(free(3), 6);
+	EXPECT_EQ(staticSum, 3);
+	EXPECT_EQ(free.GetFunc(), &StaticFree);
+	static_assert(std::is_empty<StaticDelegate<&StaticFree>>::value, "StaticDelegate holds state");
+
+	StaticTarget target;
+	StaticMemberDelegate<&StaticTarget::Add> add(&target);
+	StaticMemberDelegate<&StaticTarget::Get> get(&target);
+	EXPECT_EQ(add(5), 5);
+	EXPECT_EQ(add(2), 7);
+	EXPECT_EQ(get(1), 8);
+	EXPECT_EQ(add.GetObject(), &target);
+	static_assert(sizeof(add) == sizeof(StaticTarget*), "StaticMemberDelegate holds more than the object");
+
+	// Converted delegates compare equal to MakeDelegate() delegates
+	DelegateFree<int(int)> freeDelegate = free;
+	EXPECT_TRUE(freeDelegate == MakeDelegate(&StaticFree));
+	DelegateMember<StaticTarget, int(int)> addDelegate = add;
+	EXPECT_TRUE(addDelegate == MakeDelegate(&target, &StaticTarget::Add));
+	EXPECT_EQ(addDelegate(1), 8);
+
+	// Insert into a container and remove with MakeDelegate()
+	MulticastDelegate<int(int)> multicast;
+	multicast += free;
+	multicast += add;
+	EXPECT_EQ(multicast.Size(), 2u);
+	multicast(10);
+	EXPECT_EQ(staticSum, 13);
+	EXPECT_EQ(get(0), 18);
+	multicast -= MakeDelegate(&StaticFree);
+	multicast -= MakeDelegate(&target, &StaticTarget::Add);
+	EXPECT_TRUE(multicast.Empty());
+}
+
+static std::atomic<int> busSum{ 0 };
+static std::atomic<int> busCalls{ 0 };
+static std::thread::id busThread;
+
+static void BusTarget(int value)
+{
+	busSum += value;
+	busThread = std::this_thread::get_id();
+	busCalls++;
+}
+
+static void BusOther(int) {}
+static void BusText(const std::string&) {}
+
+// Test topics route published events to their subscribers, and topics whose
+// ID collides with another name or signature are refused
+TEST(Delegate_IT, DelegateBus)
+{
+	static constexpr Topic<void(int)> Value("Delegate_IT.value");
+	static constexpr Topic<void(int)> Unsubscribed("Delegate_IT.unsubscribed");
+
+	// Known FNV-1a collisions
+	static constexpr Topic<void(int)> Costarring("costarring");
+	static constexpr Topic<void(int)> Liquid("liquid");
+	static_assert(Costarring.GetId() == Liquid.GetId(), "Topic IDs do not collide");
+
+	DelegateBus bus;
+	WorkerThread thread("DelegateBus");
+	ASSERT_TRUE(thread.CreateThread());
+	busSum = 0;
+	busCalls = 0;
+
+	// A synchronous and an asynchronous subscriber
+	auto sync = bus.Subscribe(Value, MakeDelegate(&BusTarget));
+	auto async = bus.Subscribe(Value, MakeDelegate(&BusTarget, thread));
+	EXPECT_TRUE(sync);
+	EXPECT_TRUE(async);
+	EXPECT_EQ(bus.GetSubscriberCount(Value), 2u);
+	EXPECT_EQ(bus.GetTopicCount(), 1u);
+	bus.Publish(Value, 5);
+	for (int i = 0; i < 500 && busCalls < 2; i++)
+		std::this_thread::sleep_for(milliseconds(1));
+	EXPECT_EQ(busCalls, 2);
+	EXPECT_EQ(busSum, 10);
+	EXPECT_EQ(busThread, thread.GetThreadId());
+
+	// Publishing a topic without subscribers does nothing
+	bus.Publish(Unsubscribed, 1);
+	EXPECT_EQ(bus.GetSubscriberCount(Unsubscribed), 0u);
+	EXPECT_EQ(bus.GetTopicCount(), 1u);
+
+	// Unsubscribed delegates are no longer invoked
+	EXPECT_TRUE(bus.Unsubscribe(Value, async));
+	EXPECT_FALSE(bus.Unsubscribe(Value, async));
+	bus.Unsubscribe(Value, MakeDelegate(&BusTarget));
+	EXPECT_EQ(bus.GetSubscriberCount(Value), 0u);
+	bus.Publish(Value, 5);
+	EXPECT_EQ(busCalls, 2);
+
+	// A colliding name or a different signature under the same name is refused
+	EXPECT_TRUE(bus.Subscribe(Costarring, MakeDelegate(&BusOther)));
+	EXPECT_FALSE(bus.Subscribe(Liquid, MakeDelegate(&BusOther)));
+	static constexpr Topic<void(const std::string&)> ValueText("Delegate_IT.value");
+	EXPECT_FALSE(bus.Subscribe(ValueText, MakeDelegate(&BusText)));
+	EXPECT_EQ(bus.GetTopicCount(), 2u);
+
+	// A full bus refuses new topics
+	DelegateBusT<2> small;
+	EXPECT_TRUE(small.Subscribe(Value, MakeDelegate(&BusOther)));
+	EXPECT_TRUE(small.Subscribe(Costarring, MakeDelegate(&BusOther)));
+	EXPECT_FALSE(small.Subscribe(Unsubscribed, MakeDelegate(&BusOther)));
+	thread.ExitThread();
+}
+
+static std::mutex batchMutex;
+static std::vector<int> batchValues;
+static std::vector<size_t> batchSizes;
+
+static void BatchTarget(batch_span<int> values)
+{
+	std::lock_guard<std::mutex> lock(batchMutex);
+	batchSizes.push_back(values.size());
+	for (int value : values)
+		batchValues.push_back(value);
+}
+
+static void BatchSleep(int ms)
+{
+	std::this_thread::sleep_for(milliseconds(ms));
+}
+
+static size_t BatchWaitValues(size_t count)
+{
+	for (int i = 0; i < 500; i++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(batchMutex);
+			if (batchValues.size() >= count)
+				return batchValues.size();
+		}
+		std::this_thread::sleep_for(milliseconds(5));
+	}
+	std::lock_guard<std::mutex> lock(batchMutex);
+	return batchValues.size();
+}
+
+// Test a batch delegate passes the calls made while its thread is busy to the
+// target as one span, and holds calls until Flush() within the batch delay
+TEST(Delegate_IT, DelegateAsyncBatch)
+{
+	static const int CALLS = 1000;
+	static const size_t MAX_BATCH = 64;
+
+	WorkerThread thread("DelegateAsyncBatch");
+	ASSERT_TRUE(thread.CreateThread());
+	batchValues.clear();
+	batchSizes.clear();
+
+	// Calls made while the thread sleeps form batches of at most MAX_BATCH
+	auto batch = MakeDelegateBatch(MakeDelegate(&BatchTarget), thread, MAX_BATCH);
+	MakeDelegate(&BatchSleep, thread).AsyncInvoke(50);
+	for (int i = 0; i < CALLS; i++)
+		batch(i);
+	ASSERT_EQ(BatchWaitValues(CALLS), (size_t)CALLS);
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		for (int i = 0; i < CALLS; i++)
+			EXPECT_EQ(batchValues[i], i);
+		EXPECT_LT(batchSizes.size(), (size_t)CALLS);
+		for (size_t size : batchSizes)
+			EXPECT_LE(size, MAX_BATCH);
+		batchValues.clear();
+		batchSizes.clear();
+	}
+
+	// Calls within the delay stay buffered until flushed
+	auto delayed = MakeDelegateBatch(MakeDelegate(&BatchTarget), thread, MAX_BATCH, std::chrono::hours(1));
+	for (int i = 0; i < 10; i++)
+		delayed(i);
+	std::this_thread::sleep_for(milliseconds(50));
+	EXPECT_EQ(BatchWaitValues(0), 0u);
+	delayed.Flush();
+	ASSERT_EQ(BatchWaitValues(10), 10u);
+	{
+		std::lock_guard<std::mutex> lock(batchMutex);
+		ASSERT_EQ(batchSizes.size(), 1u);
+		EXPECT_EQ(batchSizes[0], 10u);
+	}
+
+	// A full batch dispatches without a flush
+	for (int i = 0; i < (int)MAX_BATCH; i++)
+		delayed(i);
+	EXPECT_EQ(BatchWaitValues(10 + MAX_BATCH), 10 + MAX_BATCH);
+	thread.ExitThread();
+}
+
+static std::vector<std::string> recordCalls;
+
+static void RecordTarget(int value, const std::string& text)
+{
+	recordCalls.push_back(std::to_string(value) + text);
+}
+
+static void RecordOther(int) {}
+
+// Test calls of delegates with a RecordPolicy are captured while their thread
+// has a recorder, and a saved trace replays them in order
+TEST(Delegate_IT, DelegateRecord)
+{
+	static const uint32_t TARGET_ID = 1;
+	static const uint32_t OTHER_ID = 2;
+	static const int CALLS = 10;
+	static const char* TRACE = "Delegate_IT.trace";
+
+	WorkerThread thread("DelegateRecord");
+	ASSERT_TRUE(thread.CreateThread());
+	DelegateRecorder recorder(64 * 1024);
+	DelegateFreeAsync<void(int, const std::string&), RecordPolicy<TARGET_ID>> recorded(&RecordTarget, thread);
+	DelegateFreeAsync<void(int), RecordPolicy<OTHER_ID>> other(&RecordOther, thread);
+	auto unrecorded = MakeDelegate(&RecordTarget, thread);
+	auto drain = [&thread]() { MakeDelegate(&RecordOther, thread, WAIT_INFINITE).AsyncInvoke(0); };
+
+	// Calls are captured only while the recorder is set
+	recorded(-1, "before");
+	thread.SetRecorder(&recorder);
+	for (int i = 0; i < CALLS; i++)
+		recorded(i, "recorded");
+	other(0);
+	unrecorded(0, "unrecorded");
+	thread.SetRecorder(nullptr);
+	recorded(-1, "after");
+	drain();
+	EXPECT_TRUE(recorder.IsComplete());
+	EXPECT_EQ(recorder.GetCount(), (uint64_t)CALLS + 1);
+	EXPECT_EQ(recorder.GetDropped(), 0u);
+	ASSERT_TRUE(recorder.Save(TRACE));
+
+	// Replay the saved trace. The unregistered id is skipped.
+	recordCalls.clear();
+	DelegateReplay replay;
+	ASSERT_TRUE(replay.Load(TRACE));
+	EXPECT_EQ(replay.GetCount(), (size_t)CALLS + 1);
+	replay.Register(TARGET_ID, MakeDelegate(&RecordTarget));
+	EXPECT_EQ(replay.Run(0), (size_t)CALLS);
+	EXPECT_EQ(replay.GetSkipped(), 1u);
+	ASSERT_EQ(recordCalls.size(), (size_t)CALLS);
+	for (int i = 0; i < CALLS; i++)
+		EXPECT_EQ(recordCalls[i], std::to_string(i) + "recorded");
+
+	// Records past the capacity are dropped
+	DelegateRecorder small(64);
+	thread.SetRecorder(&small);
+	for (int i = 0; i < CALLS; i++)
+		recorded(i, "recorded");
+	thread.SetRecorder(nullptr);
+	drain();
+	EXPECT_GT(small.GetDropped(), 0u);
+	EXPECT_EQ(small.GetCount() + small.GetDropped(), (uint64_t)CALLS);
+
+	thread.ExitThread();
+	remove(TRACE);
+}
+
+// Hold a thread within a call until the returned promise is set, so messages
+// dispatched meanwhile stay queued
+static std::shared_ptr<promise<void>> HoldThread(WorkerThread& thread)
+{
+	auto started = std::make_shared<promise<void>>();
+	auto release = std::make_shared<promise<void>>();
+	shared_future<void> released = release->get_future().share();
+	MakeDelegate(std::function<void()>([started, released]() {
+		started->set_value();
+		released.wait();
+	}), thread)();
+	started->get_future().wait();
+	return release;
+}
+
+static atomic<int> borrowedSum(0);
+
+static void BorrowedDrain(int) {}
+
+// Make a delegate borrowing its invoker, whose target holds token
+static DelegateFunctionAsync<void(int)> MakeBorrowed(const std::shared_ptr<int>& token, DelegateThread& thread)
+{
+	auto async = MakeDelegate(std::function<void(int)>([token](int value) { borrowedSum += value; }), thread);
+	async.SetBorrowedInvoker(true);
+	return async;
+}
+
+// Test messages borrowing the invoker keep it alive past the last delegate copy
+// until they ran, and fall back to sharing it when held by a dispatch scope
+TEST(Delegate_IT, BorrowedInvoker)
+{
+	WorkerThread thread("BorrowedInvoker");
+	ASSERT_TRUE(thread.CreateThread());
+	auto drain = [&thread]() { MakeDelegate(&BorrowedDrain, thread, WAIT_INFINITE).AsyncInvoke(0); };
+	auto token = std::make_shared<int>(0);
+	borrowedSum = 0;
+
+	// Hold the thread so dispatched messages stay queued
+	auto release = HoldThread(thread);
+
+	// Copies share the handle, and the invoker outlives the last of them until 
+	// the queued calls ran
+	{
+		auto async = MakeBorrowed(token, thread);
+		auto copy = async;
+		EXPECT_EQ(copy.GetAsyncInvoker(), async.GetAsyncInvoker());
+		async(1);
+		copy(2);
+		async = nullptr;
+		copy(4);
+	}
+	EXPECT_GT(token.use_count(), 1);
+	EXPECT_EQ(borrowedSum.load(), 0);
+	release->set_value();
+	drain();
+	EXPECT_EQ(borrowedSum.load(), 7);
+	EXPECT_EQ(token.use_count(), 1);
+
+	// A call held by a dispatch scope shares the invoker, so it is retired only
+	// after the scope dispatched the call and it ran
+	{
+		DispatchScope scope;
+		MakeBorrowed(token, thread)(8);
+		EXPECT_GT(token.use_count(), 1);
+	}
+	drain();
+	EXPECT_EQ(borrowedSum.load(), 15);
+
+	// The call's message retires the invoker as it is freed, behind the first drain
+	drain();
+	EXPECT_EQ(token.use_count(), 1);
+	thread.ExitThread();
+
+	// Released at once while the thread is not running, as nothing is queued
+	SetDelegateErrorHandler(&RecordDelegateError);
+	MakeBorrowed(token, thread);
+	EXPECT_EQ(token.use_count(), 1);
+	SetDelegateErrorHandler(nullptr);
+	delegateErrors.clear();
+	EXPECT_EQ(borrowedSum.load(), 15);
+}
+
+static atomic<int> cancelInstances(0);
+static atomic<int> cancelCalls(0);
+
+// An argument counting its live instances
+struct CancelArg
+{
+	CancelArg() { cancelInstances++; }
+	CancelArg(const CancelArg&) { cancelInstances++; }
+	~CancelArg() { cancelInstances--; }
+};
+
+static void CancelTarget(CancelArg) { cancelCalls++; }
+
+// Test a blocking call that times out while queued is cancelled: its arguments
+// are destroyed at the timeout and the target is never invoked
+TEST(Delegate_IT, AsyncWaitCancel)
+{
+	WorkerThread thread("AsyncWaitCancel");
+	ASSERT_TRUE(thread.CreateThread());
+	cancelCalls = 0;
+
+	// Hold the thread so the call stays queued past its timeout
+	auto release = HoldThread(thread);
+
+	{
+		CancelArg arg;
+		auto wait = MakeDelegate(&CancelTarget, thread, milliseconds(20));
+		wait(arg);
+		EXPECT_FALSE(wait.IsSuccess());
+		EXPECT_EQ(cancelInstances.load(), 1);
+	}
+	EXPECT_EQ(cancelInstances.load(), 0);
+
+	release->set_value();
+	MakeDelegate(&BorrowedDrain, thread, WAIT_INFINITE).AsyncInvoke(0);
+	EXPECT_EQ(cancelCalls.load(), 0);
+	EXPECT_EQ(cancelInstances.load(), 0);
+	thread.ExitThread();
+}
+
+// Values received by CoalesceTarget. Only accessed by the destination thread
+// until it is drained.
+static std::vector<int> coalesceValues;
+
+static void CoalesceTarget(int value) { coalesceValues.push_back(value); }
+
+// Test calls made while the previous call is queued replace its arguments, also
+// through a copy held by a multicast container, so the target runs once with the
+// last arguments
+TEST(Delegate_IT, DelegateAsyncCoalesce)
+{
+	static const int CALLS = 100;
+
+	WorkerThread thread("DelegateAsyncCoalesce");
+	ASSERT_TRUE(thread.CreateThread());
+	auto drain = [&thread]() { MakeDelegate(&BorrowedDrain, thread, WAIT_INFINITE).AsyncInvoke(0); };
+	coalesceValues.clear();
+
+	// A burst while the thread is held is invoked once with the last arguments
+	auto status = MakeDelegateCoalesce(MakeDelegate(&CoalesceTarget), thread);
+	auto release = HoldThread(thread);
+	for (int i = 0; i < CALLS; i++)
+		status(i);
+	release->set_value();
+	drain();
+	ASSERT_EQ(coalesceValues.size(), 1u);
+	EXPECT_EQ(coalesceValues[0], CALLS - 1);
+
+	// A copy held by a multicast container shares the pending call of the original
+	MulticastDelegateSafe<void(int)> multicast;
+	multicast += status;
+	release = HoldThread(thread);
+	status(1);
+	multicast(2);
+	status(3);
+	multicast(4);
+	release->set_value();
+	drain();
+	ASSERT_EQ(coalesceValues.size(), 2u);
+	EXPECT_EQ(coalesceValues[1], 4);
+
+	// Once invoked, the next call dispatches a new message
+	status(5);
+	drain();
+	ASSERT_EQ(coalesceValues.size(), 3u);
+	EXPECT_EQ(coalesceValues[2], 5);
+	thread.ExitThread();
+}
+
+static atomic<int> weakSum(0);
+
+class WeakTarget
+{
+public:
+	void Add(int value) { weakSum += value; }
+};
+
+// Test weak pointer delegates drop the calls queued for an object destroyed
+// before they are invoked, and still compare equal once the object expired so
+// they can be removed from a multicast container
+TEST(Delegate_IT, WeakDelegate)
+{
+	WorkerThread thread("WeakDelegate");
+	ASSERT_TRUE(thread.CreateThread());
+	auto drain = [&thread]() { MakeDelegate(&BorrowedDrain, thread, WAIT_INFINITE).AsyncInvoke(0); };
+	weakSum = 0;
+
+	auto object = std::make_shared<WeakTarget>();
+	std::weak_ptr<WeakTarget> weak = object;
+	auto sync = MakeDelegate(weak, &WeakTarget::Add);
+	auto async = MakeDelegate(weak, &WeakTarget::Add, thread);
+	MulticastDelegateSafe<void(int)> multicast;
+	multicast += sync;
+	multicast += async;
+
+	// The delegates do not keep the object alive
+	sync(1);
+	async(2);
+	drain();
+	EXPECT_EQ(weakSum.load(), 3);
+	EXPECT_EQ(object.use_count(), 1);
+
+	// Calls queued when the object expires are dropped by the destination thread
+	auto release = HoldThread(thread);
+	async(4);
+	multicast(8);
+	EXPECT_EQ(weakSum.load(), 11);
+	object.reset();
+	release->set_value();
+	drain();
+	EXPECT_EQ(weakSum.load(), 11);
+
+	// Expired delegates do nothing when called
+	EXPECT_TRUE(sync.Empty());
+	EXPECT_TRUE(async.Empty());
+	sync(16);
+	async(16);
+	multicast(16);
+	drain();
+	EXPECT_EQ(weakSum.load(), 11);
+
+	// And still equal a delegate bound to the same object and function
+	EXPECT_TRUE(sync.Equal(MakeDelegate(weak, &WeakTarget::Add)));
+	EXPECT_TRUE(async.Equal(MakeDelegate(weak, &WeakTarget::Add, thread)));
+	EXPECT_FALSE(sync.Equal(MakeDelegate(std::weak_ptr<WeakTarget>(std::make_shared<WeakTarget>()), &WeakTarget::Add)));
+	EXPECT_EQ(multicast.Size(), 2u);
+	multicast -= MakeDelegate(weak, &WeakTarget::Add);
+	multicast -= MakeDelegate(weak, &WeakTarget::Add, thread);
+	EXPECT_EQ(multicast.Size(), 0u);
+	thread.ExitThread();
+}
+
+static atomic<int> payloadCopies(0);
+
+// A large result counting its copies
+struct ReplyPayload
+{
+	ReplyPayload() = default;
+	ReplyPayload(const ReplyPayload& rhs) : data(rhs.data) { payloadCopies++; }
+	ReplyPayload(ReplyPayload&&) = default;
+	ReplyPayload& operator=(const ReplyPayload& rhs) { data = rhs.data; payloadCopies++; return *this; }
+	ReplyPayload& operator=(ReplyPayload&&) = default;
+	std::vector<int> data;
+};
+
+// Replies and the thread each ran on. Only accessed by the reply thread until
+// it is drained.
+static std::vector<std::string> replyTexts;
+static std::vector<std::thread::id> replyThreads;
+static size_t replyPayloadSize = 0;
+static int replyDone = 0;
+
+static std::unique_ptr<std::string> ReplyUpper(std::unique_ptr<std::string> text)
+{
+	for (char& c : *text)
+		c = (char)toupper(c);
+	return text;
+}
+
+static void ReplyText(std::unique_ptr<std::string> text)
+{
+	replyTexts.push_back(*text);
+	replyThreads.push_back(std::this_thread::get_id());
+}
+
+static ReplyPayload ReplyMake(size_t size)
+{
+	ReplyPayload payload;
+	payload.data.resize(size);
+	return payload;
+}
+
+static void ReplyReceive(ReplyPayload payload)
+{
+	replyPayloadSize = payload.data.size();
+	replyThreads.push_back(std::this_thread::get_id());
+}
+
+static void ReplyTouch(int) {}
+
+static void ReplyDone()
+{
+	replyDone++;
+	replyThreads.push_back(std::this_thread::get_id());
+}
+
+static void ReplyGetThreadId(std::thread::id* id) { *id = std::this_thread::get_id(); }
+
+// Test a reply delegate is passed the target's return value on its own thread,
+// moving a move-only result and a large result without copies, and is called 
+// with no arguments once a void target returns
+TEST(Delegate_IT, DelegateAsyncReply)
+{
+	WorkerThread thread("DelegateAsyncReply");
+	WorkerThread replyThread("DelegateAsyncReplyTo");
+	ASSERT_TRUE(thread.CreateThread());
+	ASSERT_TRUE(replyThread.CreateThread());
+	auto drain = [&thread, &replyThread]() {
+		MakeDelegate(&BorrowedDrain, thread, WAIT_INFINITE).AsyncInvoke(0);
+		MakeDelegate(&BorrowedDrain, replyThread, WAIT_INFINITE).AsyncInvoke(0);
+	};
+	std::thread::id replyId;
+	MakeDelegate(&ReplyGetThreadId, replyThread, WAIT_INFINITE).AsyncInvoke(&replyId);
+	replyTexts.clear();
+	replyThreads.clear();
+	replyDone = 0;
+
+	// A move-only argument and result round trip onto the reply thread
+	auto upper = MakeDelegateReply(MakeDelegate(&ReplyUpper), thread, MakeDelegate(&ReplyText, replyThread));
+	upper(std::make_unique<std::string>("reply"));
+	upper(std::make_unique<std::string>("twice"));
+	drain();
+	EXPECT_EQ(replyTexts, (std::vector<std::string>{ "REPLY", "TWICE" }));
+
+	// A large result reaches the reply thread without a copy
+	payloadCopies = 0;
+	auto make = MakeDelegateReply(MakeDelegate(&ReplyMake), thread, MakeDelegate(&ReplyReceive, replyThread));
+	make(100000);
+	drain();
+	EXPECT_EQ(replyPayloadSize, 100000u);
+	EXPECT_EQ(payloadCopies.load(), 0);
+
+	// A void target replies with no arguments
+	auto touch = MakeDelegateReply(MakeDelegate(&ReplyTouch), thread, MakeDelegate(&ReplyDone, replyThread));
+	touch(1);
+	touch(2);
+	drain();
+	EXPECT_EQ(replyDone, 2);
+
+	ASSERT_EQ(replyThreads.size(), 5u);
+	for (auto id : replyThreads)
+		EXPECT_EQ(id, replyId);
+	thread.ExitThread();
+	replyThread.ExitThread();
+}
+
+static std::vector<int> subscriptionCalls;
+
+static void SubscriptionA(int value) { subscriptionCalls.push_back(value + 1); }
+static void SubscriptionB(int value) { subscriptionCalls.push_back(value + 2); }
+static void SubscriptionC(int value) { subscriptionCalls.push_back(value + 3); }
+
+// Test subscription handles remove the delegate they were returned for, also
+// among equal delegates, and are ignored once the delegate is removed, the
+// handle reused or the container cleared
+TEST(Delegate_IT, MulticastSubscription)
+{
+	using Multicast = MulticastDelegate<void(int)>;
+	Multicast multicast;
+	EXPECT_FALSE(Multicast::Subscription());
+	auto a = multicast += MakeDelegate(&SubscriptionA);
+	auto b = multicast += MakeDelegate(&SubscriptionB);
+	auto c = multicast += MakeDelegate(&SubscriptionC);
+	EXPECT_TRUE(a && b && c);
+
+	// Swap and pop keeps the handles of the moved delegates valid
+	EXPECT_TRUE(multicast.Remove(a, RemovePolicy::SWAP_AND_POP));
+	EXPECT_FALSE(multicast.Remove(a));
+	subscriptionCalls.clear();
+	multicast(10);
+	EXPECT_EQ(subscriptionCalls, (std::vector<int>{ 13, 12 }));
+
+	// The freed handle is reused by the next insert without reviving the old one
+	auto d = multicast += MakeDelegate(&SubscriptionA);
+	EXPECT_FALSE(multicast.Remove(a));
+	EXPECT_EQ(multicast.Size(), 3u);
+	EXPECT_TRUE(multicast.Remove(c, RemovePolicy::SWAP_AND_POP));
+	EXPECT_TRUE(multicast.Remove(b));
+	subscriptionCalls.clear();
+	multicast(10);
+	EXPECT_EQ(subscriptionCalls, (std::vector<int>{ 11 }));
+
+	// Clearing invalidates every handle
+	multicast.Clear();
+	EXPECT_FALSE(multicast.Remove(d));
+	EXPECT_TRUE(multicast.Empty());
+
+	// A thread-safe container removes the exact delegate of the handle
+	MulticastDelegateSafe<void(int)> safe;
+	auto first = safe += MakeDelegate(&SubscriptionA);
+	auto second = safe += MakeDelegate(&SubscriptionA);
+	EXPECT_TRUE(safe.Remove(first));
+	EXPECT_FALSE(safe.Remove(first));
+	EXPECT_EQ(safe.Size(), 1u);
+	safe.Clear();
+	EXPECT_FALSE(safe.Remove(second));
+}
+
+static int FutureSquare(int value) { return value * value; }
+static std::unique_ptr<int> FutureMake(int value) { return std::unique_ptr<int>(new int(value)); }
+
+// Test a future completes once the target returns, waits time out while the call
+// is queued, Then() runs on the destination thread and move-only results are moved
+TEST(Delegate_IT, DelegateFuture)
+{
+	static const int CALLS = 50;
+
+	WorkerThread thread("DelegateFuture");
+	ASSERT_TRUE(thread.CreateThread());
+
+	EXPECT_FALSE(DelegateFuture<int>().IsValid());
+	EXPECT_FALSE(DelegateFuture<int>().Wait(milliseconds(1)));
+	auto square = MakeDelegateFuture(&FutureSquare, thread);
+	EXPECT_EQ(square.AsyncInvoke(7).Get(), 49);
+
+	// Not ready until the held thread reaches the call
+	auto release = HoldThread(thread);
+	auto future = square.AsyncInvoke(3);
+	EXPECT_TRUE(future.IsValid());
+	EXPECT_FALSE(future.Wait(milliseconds(20)));
+	EXPECT_FALSE(future.IsReady());
+	promise<std::thread::id> continuation;
+	future.Then([&continuation]() { continuation.set_value(std::this_thread::get_id()); });
+	release->set_value();
+	EXPECT_TRUE(future.Wait(seconds(5)));
+	EXPECT_TRUE(future.IsReady());
+	EXPECT_EQ(future.Get(), 9);
+	EXPECT_EQ(continuation.get_future().get(), thread.GetThreadId());
+
+	// Then() on a completed future runs at once on the calling thread
+	std::thread::id ready;
+	future.Then([&ready]() { ready = std::this_thread::get_id(); });
+	EXPECT_EQ(ready, std::this_thread::get_id());
+
+	// A move-only result is moved to the caller
+	std::unique_ptr<int> made = MakeDelegateFuture(&FutureMake, thread).AsyncInvoke(5).Get();
+	ASSERT_TRUE(made);
+	EXPECT_EQ(*made, 5);
+
+	// Many calls in flight complete independently
+	std::vector<DelegateFuture<int>> futures;
+	for (int i = 0; i < CALLS; i++)
+		futures.push_back(square.AsyncInvoke(i));
+	for (int i = CALLS - 1; i >= 0; i--)
+		EXPECT_EQ(futures[i].Get(), i * i);
+	thread.ExitThread();
+}
+
+static int UnicastOne(int value) { return value + 1; }
+static int UnicastTwo(int value) { return value + 2; }
+
+// Test a thread-safe unicast container returns a default value when empty, lets
+// the target reassign the container while running, and is reassigned by one
+// thread while another invokes it
+TEST(Delegate_IT, UnicastDelegateSafe)
+{
+	static const int CALLS = 10000;
+
+	UnicastDelegateSafe<int(int)> unicast;
+	EXPECT_TRUE(unicast.Empty());
+	EXPECT_EQ(unicast(5), 0);
+	unicast = MakeDelegate(&UnicastOne);
+	EXPECT_TRUE(unicast);
+	EXPECT_EQ(unicast(5), 6);
+
+	// A copy holds its own delegate
+	UnicastDelegateSafe<int(int)> copy(unicast);
+	unicast = MakeDelegate(&UnicastTwo);
+	EXPECT_EQ(copy(5), 6);
+	EXPECT_EQ(unicast(5), 7);
+
+	// The running call completes with the captures of the delegate it replaced
+	std::string captured(64, 'x');
+	unicast = MakeDelegate(std::function<int(int)>([&unicast, captured](int value) {
+		unicast = MakeDelegate(&UnicastOne);
+		return value + (int)captured.size();
+	}));
+	EXPECT_EQ(unicast(5), 69);
+	EXPECT_EQ(unicast(5), 6);
+
+	// Each invocation sees one of the delegates while another thread reassigns
+	std::atomic<bool> done(false);
+	std::atomic<int> unexpected(0);
+	std::thread invoker([&]() {
+		while (!done)
+		{
+			int result = unicast(5);
+			if (result != 6 && result != 7)
+				unexpected++;
+		}
+	});
+	for (int i = 0; i < CALLS; i++)
+		unicast = MakeDelegate(i % 2 ? &UnicastOne : &UnicastTwo);
+	done = true;
+	invoker.join();
+	EXPECT_EQ(unexpected, 0);
+
+	unicast.Clear();
+	EXPECT_EQ(unicast.Size(), 0u);
+	EXPECT_EQ(unicast(5), 0);
+}
+
+// Dummy function to force linker to keep the code in this file
+void Delegate_IT_ForceLink() { }
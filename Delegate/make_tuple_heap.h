@@ -14,13 +14,18 @@
 /// pointer, pointer-to-pointer, and reference.
 /// 
 /// The destination thread uses `std::apply()` to invoke the target function using
-/// the tuple of arguments. See `Invoke()` and `DelegateAsyncMsg()` in the
-/// file `DelegateAsync.h` for example usage.
+/// the tuple of arguments.
+///
+/// Each reference and pointer argument costs a heap copy, a deleter and a list
+/// node. `DelegateAsyncMsg` in `DelegateAsync.h` instead uses `inline_args<>` from
+/// `make_tuple_inline.h`, which holds the copies of all arguments in one aligned
+/// block within the message and destroys them in a single pass.
 
 #include <tuple>
 #include <list>
 #include <memory>
 #include <type_traits>
+#include <memory_resource>
 #include "DelegateOpt.h"
 
 namespace DelegateLib 
@@ -63,17 +68,54 @@ public:
     XALLOCATOR
 };
 
+/// @brief Create a heap argument copy.
+/// @param[in] resource The memory resource to allocate from, or `nullptr` to use 
+/// `operator new()`.
+/// @param[in] init The constructor arguments.
+/// @return The copy, or `nullptr` if `operator new()` fails.
+/// @throws std::bad_alloc If the resource is exhausted.
+template <typename T, typename... Init>
+T* heap_arg_new(std::pmr::memory_resource* resource, Init&&... init)
+{
+    if (!resource)
+        return new(std::nothrow) T(std::forward<Init>(init)...);
+    void* block = resource->allocate(sizeof(T), alignof(T));
+    DELEGATE_TRY {
+        return new(block) T(std::forward<Init>(init)...);
+    }
+    DELEGATE_CATCH(...) {
+        resource->deallocate(block, sizeof(T), alignof(T));
+        DELEGATE_RETHROW();
+    }
+}
+
+/// @brief Destroy a heap argument copy from `heap_arg_new()`.
+/// @param[in] resource The memory resource passed to `heap_arg_new()`.
+/// @param[in] arg The copy, or `nullptr`.
+template <typename T>
+void heap_arg_delete(std::pmr::memory_resource* resource, T* arg) noexcept
+{
+    if (!resource) {
+        delete arg;
+    }
+    else if (arg) {
+        arg->~T();
+        resource->deallocate(const_cast<std::remove_cv_t<T>*>(arg), sizeof(T), alignof(T));
+    }
+}
+
 /// @brief Frees heap memory for reference heap argument
 template<typename T>
 class heap_arg_deleter : public heap_arg_deleter_base
 {
 public:
-    heap_arg_deleter(T& arg) : m_arg(arg) { }
+    heap_arg_deleter(T& arg, std::pmr::memory_resource* resource = nullptr) : m_arg(arg), m_resource(resource) { }
     virtual ~heap_arg_deleter() { 
-        delete &m_arg; 
+        heap_arg_delete(m_resource, &m_arg);
     }
 private:
     T& m_arg;
+    std::pmr::memory_resource* m_resource;
 };
 
 /// @brief Frees heap memory for pointer heap argument
@@ -81,12 +123,13 @@ template<typename T>
 class heap_arg_deleter<T*> : public heap_arg_deleter_base
 {
 public:
-    heap_arg_deleter(T* arg) : m_arg(arg) { }
+    heap_arg_deleter(T* arg, std::pmr::memory_resource* resource = nullptr) : m_arg(arg), m_resource(resource) { }
     virtual ~heap_arg_deleter() { 
-        delete m_arg; 
+        heap_arg_delete(m_resource, m_arg);
     }
 private:
     T* m_arg;
+    std::pmr::memory_resource* m_resource;
 };
 
 /// @brief Frees heap memory for pointer to pointer heap argument
@@ -94,144 +137,190 @@ template<typename T>
 class heap_arg_deleter<T**> : public heap_arg_deleter_base
 {
 public:
-    heap_arg_deleter(T** arg) : m_arg(arg) {}
+    heap_arg_deleter(T** arg, std::pmr::memory_resource* resource = nullptr) : m_arg(arg), m_resource(resource) {}
     virtual ~heap_arg_deleter() {
-        delete *m_arg;
-        delete m_arg;
+        heap_arg_delete(m_resource, *m_arg);
+        heap_arg_delete(m_resource, m_arg);
     }
 private:
     T** m_arg;
+    std::pmr::memory_resource* m_resource;
 };
 
+/// @brief Create the deleter of a heap argument copy.
+/// @param[in] resource The memory resource the copy and the deleter are allocated 
+/// from, or `nullptr` to use `operator new()`.
+/// @param[in] heap_arg The copy.
+/// @return The deleter, or `nullptr` if `operator new()` fails.
+/// @throws std::bad_alloc If the resource is exhausted.
+template <typename T>
+std::shared_ptr<heap_arg_deleter_base> make_heap_arg_deleter(std::pmr::memory_resource* resource, T heap_arg)
+{
+    if (!resource)
+        return std::shared_ptr<heap_arg_deleter_base>(new(std::nothrow) heap_arg_deleter<T>(heap_arg));
+    return std::allocate_shared<heap_arg_deleter<T>>(
+        std::pmr::polymorphic_allocator<heap_arg_deleter<T>>(resource), heap_arg, resource);
+}
+
 /// @brief Append a pointer to pointer argument to the tuple
 template <typename Arg, typename... TupleElem>
-auto tuple_append(xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, const std::tuple<TupleElem...> &tup, Arg** arg)
+auto tuple_append(std::pmr::memory_resource* resource, xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, 
+    const std::tuple<TupleElem...> &tup, Arg** arg)
 {
     Arg** heap_arg = nullptr;
 
     // Check if arg is nullptr or *arg is nullptr
     if (arg != nullptr && *arg != nullptr) {
         // Allocate memory for heap_arg and copy the value
-        heap_arg = new(std::nothrow) Arg * ();
+        heap_arg = heap_arg_new<Arg*>(resource);
         if (!heap_arg) {
             BAD_ALLOC();
         }
             
-        *heap_arg = new(std::nothrow) Arg(**arg);
+        DELEGATE_TRY {
+            *heap_arg = heap_arg_new<Arg>(resource, **arg);
+        }
+        DELEGATE_CATCH(...) {
+            heap_arg_delete(resource, heap_arg);
+            DELEGATE_RETHROW();
+        }
         if (!*heap_arg) {
-            delete heap_arg;
+            heap_arg_delete(resource, heap_arg);
             BAD_ALLOC();
         }
     }
     else {
         // If arg is nullptr or *arg is nullptr, create heap_arg as nullptr
-        heap_arg = new(std::nothrow) Arg * (nullptr);
+        heap_arg = heap_arg_new<Arg*>(resource, nullptr);
         if (!heap_arg) {
             BAD_ALLOC();
         }
     }
-    std::shared_ptr<heap_arg_deleter_base> deleter(new(std::nothrow) heap_arg_deleter<Arg**>(heap_arg));
+    std::shared_ptr<heap_arg_deleter_base> deleter = make_heap_arg_deleter(resource, heap_arg);
     if (!deleter) {
         BAD_ALLOC();
     }
-    try {
+    DELEGATE_TRY {
         heapArgs.push_back(deleter);
-        return std::tuple_cat(tup, std::make_tuple(heap_arg));
     } 
-    catch (const std::bad_alloc&) {
+    DELEGATE_CATCH(const std::bad_alloc&) {
         BAD_ALLOC();
-        throw;
+        DELEGATE_RETHROW();
     }
+    return std::tuple_cat(tup, std::make_tuple(heap_arg));
 }
 
 /// @brief Append a pointer argument to the tuple
 template <typename Arg, typename... TupleElem>
-auto tuple_append(xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, const std::tuple<TupleElem...> &tup, Arg* arg)
+auto tuple_append(std::pmr::memory_resource* resource, xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, 
+    const std::tuple<TupleElem...> &tup, Arg* arg)
 {
     Arg* heap_arg = nullptr;
     if (arg != nullptr) {
-        heap_arg = new(std::nothrow) Arg(*arg);  // Only create a new Arg if arg is not nullptr
+        heap_arg = heap_arg_new<Arg>(resource, *arg);  // Only create a new Arg if arg is not nullptr
         if (!heap_arg) {
             BAD_ALLOC();
         }
     }
-    std::shared_ptr<heap_arg_deleter_base> deleter(new(std::nothrow) heap_arg_deleter<Arg*>(heap_arg));
+    std::shared_ptr<heap_arg_deleter_base> deleter = make_heap_arg_deleter(resource, heap_arg);
     if (!deleter) {
         BAD_ALLOC();
     }
-    try {
+    DELEGATE_TRY {
         heapArgs.push_back(deleter);
-        return std::tuple_cat(tup, std::make_tuple(heap_arg));
     }
-    catch (const std::bad_alloc&) {
+    DELEGATE_CATCH(const std::bad_alloc&) {
         BAD_ALLOC();
-        throw;
+        DELEGATE_RETHROW();
     }
+    return std::tuple_cat(tup, std::make_tuple(heap_arg));
 }
 
 /// @brief Append a reference argument to the tuple
 template <typename Arg, typename... TupleElem>
-auto tuple_append(xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, const std::tuple<TupleElem...> &tup, Arg& arg)
+auto tuple_append(std::pmr::memory_resource* resource, xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, 
+    const std::tuple<TupleElem...> &tup, Arg& arg)
 {
-    Arg* heap_arg = new(std::nothrow) Arg(arg);
+    Arg* heap_arg = heap_arg_new<Arg>(resource, arg);
     if (!heap_arg) {
         BAD_ALLOC();
     }
-    std::shared_ptr<heap_arg_deleter_base> deleter(new(std::nothrow) heap_arg_deleter<Arg*>(heap_arg));
+    std::shared_ptr<heap_arg_deleter_base> deleter = make_heap_arg_deleter(resource, heap_arg);
     if (!deleter) {
         BAD_ALLOC();
     }
-    try {
+    DELEGATE_TRY {
         heapArgs.push_back(deleter);
-
-        auto temp = std::make_tuple(std::forward_as_tuple(*heap_arg));  // Dereference heap_arg when creating tuple element
-        auto new_type = std::get<0>(temp);
-        return std::tuple_cat(tup, new_type);
     }
-    catch (const std::bad_alloc&) {
+    DELEGATE_CATCH(const std::bad_alloc&) {
         BAD_ALLOC();
-        throw;
+        DELEGATE_RETHROW();
     }
+
+    auto temp = std::make_tuple(std::forward_as_tuple(*heap_arg));  // Dereference heap_arg when creating tuple element
+    auto new_type = std::get<0>(temp);
+    return std::tuple_cat(tup, new_type);
 }
 
 /// @brief Terminate the template metaprogramming argument loop. This function is 
 /// called when there are no more arguments to process.
+/// The memory resource and the list of deleters are unused.
 /// @tparam Ts The types of the remaining arguments.
-/// @param heapArgs The list of deleters for heap - allocated arguments.
 /// @param tup The current tuple of arguments.
 /// @return The final tuple.
 template<typename... Ts>
-auto make_tuple_heap(xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, std::tuple<Ts...> tup)
+auto make_tuple_heap(std::pmr::memory_resource*, xlist<std::shared_ptr<heap_arg_deleter_base>>&, std::tuple<Ts...> tup)
 {
     return tup;
 }
 
-/// @brief Creates a tuple with all tuple elements created on the heap using
-/// `operator new()`. 
-/// @details Call with an empty list and empty tuple. The empty tuple is concatenated
-/// with each heap element. The list contains `heap_arg_deleter_base` objects for each 
-/// argument heap memory block that will be automatically deleted after the bound
-/// function is invoked on the target thread.
+/// @brief Creates a tuple with all tuple elements created within a memory resource.
+/// @details See `make_tuple_heap()` below. The argument copies and their deleters 
+/// are allocated from `resource`, e.g. a monotonic buffer per request, which must 
+/// outlive the deleters.
 /// @tparam Arg1 The type of the first argument.
 /// @tparam Args The types of the remaining arguments.
 /// @tparam Ts The types of the existing tuple elements.
+/// @param resource The memory resource to allocate from, or `nullptr` to use 
+/// `operator new()`.
 /// @param heapArgs The list of deleters for heap - allocated arguments.
 /// @param tup The existing tuple of arguments. Typically call with an empty tuple. 
 /// @param arg1 The first argument to append to the tuple.
 /// @param args The remaining arguments to append to the tuple.
 /// @return A new tuple with all arguments appended.
-/// @throws std::bad_alloc If dynamic allocation of arguments created on the heap
-/// for appending to the tuple fails and USE_ASSERTS not defined.
+/// @throws std::bad_alloc If dynamic allocation of arguments fails and USE_ASSERTS 
+/// not defined, or the resource is exhausted.
 template<typename Arg1, typename... Args, typename... Ts>
-auto make_tuple_heap(xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, std::tuple<Ts...> tup, Arg1 arg1, Args... args)
+auto make_tuple_heap(std::pmr::memory_resource* resource, xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, 
+    std::tuple<Ts...> tup, Arg1 arg1, Args... args)
 {
     static_assert(!(
         (is_shared_ptr<Arg1>::value && (std::is_lvalue_reference_v<Arg1> || std::is_pointer_v<Arg1>))),
         "std::shared_ptr reference argument not allowed");
     static_assert(!std::is_same<Arg1, void*>::value, "void* argument not allowed");
 
-    auto new_tup = tuple_append(heapArgs, tup, arg1);
-    return make_tuple_heap(heapArgs, new_tup, args...);
+    auto new_tup = tuple_append(resource, heapArgs, tup, arg1);
+    return make_tuple_heap(resource, heapArgs, new_tup, args...);
+}
+
+/// @brief Creates a tuple with all tuple elements created on the heap using
+/// `operator new()`. 
+/// @details Call with an empty list and empty tuple. The empty tuple is concatenated
+/// with each heap element. The list contains `heap_arg_deleter_base` objects for each 
+/// argument heap memory block that will be automatically deleted after the bound
+/// function is invoked on the target thread.
+/// @tparam Args The types of the arguments.
+/// @tparam Ts The types of the existing tuple elements.
+/// @param heapArgs The list of deleters for heap - allocated arguments.
+/// @param tup The existing tuple of arguments. Typically call with an empty tuple. 
+/// @param args The arguments to append to the tuple.
+/// @return A new tuple with all arguments appended.
+/// @throws std::bad_alloc If dynamic allocation of arguments created on the heap
+/// for appending to the tuple fails and USE_ASSERTS not defined.
+template<typename... Args, typename... Ts>
+auto make_tuple_heap(xlist<std::shared_ptr<heap_arg_deleter_base>>& heapArgs, std::tuple<Ts...> tup, Args... args)
+{
+    return make_tuple_heap<Args...>(static_cast<std::pmr::memory_resource*>(nullptr), heapArgs, tup, args...);
 }
 
 }
@@ -0,0 +1,122 @@
+#ifndef _MAKE_TUPLE_INLINE_H
+#define _MAKE_TUPLE_INLINE_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Helper classes for storing copies of function arguments inline within
+/// an asynchronous delegate message.
+///
+/// @details `inline_args<>` copies each function argument into storage held by
+/// value, so a message holding the arguments needs no allocation beyond itself.
+/// The copy semantics match `make_tuple_heap()`: by value and reference arguments
+/// are copied, a pointer argument points to a copy of the pointed to object or is
+/// `nullptr`, and a pointer-to-pointer argument points to a pointer to a copy of
+/// the object. By value and rvalue reference arguments passed as rvalues are moved
+/// in rather than copied, so move-only types such as `std::unique_ptr` are allowed.
+/// `get()` returns the tuple passed to the target function on the destination thread.
+
+#include <tuple>
+#include <optional>
+#include <type_traits>
+#include "make_tuple_heap.h"
+
+namespace DelegateLib
+{
+
+/// @brief Storage for a by value argument
+template <typename Arg>
+class inline_arg
+{
+public:
+    inline_arg(Arg arg) : m_arg(std::move(arg)) { }
+    Arg&& get() { return std::move(m_arg); }
+private:
+    Arg m_arg;
+};
+
+/// @brief Storage for an rvalue reference argument
+template <typename Arg>
+class inline_arg<Arg&&>
+{
+public:
+    inline_arg(Arg&& arg) : m_arg(std::move(arg)) { }
+    Arg&& get() { return std::move(m_arg); }
+private:
+    std::remove_const_t<Arg> m_arg;
+};
+
+/// @brief Storage for a reference argument
+template <typename Arg>
+class inline_arg<Arg&>
+{
+public:
+    inline_arg(Arg& arg) : m_arg(arg) { }
+    Arg& get() { return m_arg; }
+private:
+    std::remove_const_t<Arg> m_arg;
+};
+
+/// @brief Storage for a pointer argument
+template <typename Arg>
+class inline_arg<Arg*>
+{
+public:
+    inline_arg(Arg* arg) {
+        if (arg != nullptr)
+            m_arg.emplace(*arg);
+    }
+    Arg* get() { return m_arg ? &*m_arg : nullptr; }
+private:
+    std::optional<std::remove_const_t<Arg>> m_arg;
+};
+
+/// @brief Storage for a pointer to pointer argument
+template <typename Arg>
+class inline_arg<Arg**>
+{
+public:
+    inline_arg(Arg** arg) {
+        if (arg != nullptr && *arg != nullptr)
+            m_arg.emplace(**arg);
+        m_ptr = m_arg ? &*m_arg : nullptr;
+    }
+
+    // m_ptr points into this object so it must not be copied
+    inline_arg(const inline_arg&) = delete;
+    inline_arg& operator=(const inline_arg&) = delete;
+
+    Arg** get() { return &m_ptr; }
+private:
+    std::optional<std::remove_const_t<Arg>> m_arg;
+    Arg* m_ptr;
+};
+
+/// @brief Copies of all function arguments stored inline
+/// @tparam Args The argument types of the bound delegate function.
+template <typename... Args>
+class inline_args
+{
+public:
+    static_assert(!(std::is_same_v<Args, void*> || ...), "void* argument not allowed");
+    static_assert(!((is_shared_ptr<Args>::value && (std::is_lvalue_reference_v<Args> || std::is_pointer_v<Args>)) || ...),
+        "std::shared_ptr reference argument not allowed");
+
+    inline_args(Args... args) : m_args(std::forward<Args>(args)...) { }
+
+    /// @brief Get the arguments to pass to the target function. Reference and
+    /// pointer elements refer to the copies held by this object. By value 
+    /// arguments are moved out, so call once.
+    /// @return A tuple of all function arguments.
+    std::tuple<Args...> get() {
+        return std::apply([](auto&... arg) { return std::tuple<Args...>(arg.get()...); }, m_args);
+    }
+
+private:
+    std::tuple<inline_arg<Args>...> m_args;
+};
+
+}
+
+#endif
@@ -0,0 +1,95 @@
+#ifndef _STL_ALLOCATOR_H
+#define _STL_ALLOCATOR_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief A standard allocator taking storage from the fixed block allocator.
+///
+/// @details `stl_allocator` works with standard containers, such as `xlist`, and with
+/// `std::allocate_shared()`, which places the object and its control block in one
+/// block. Types aligned beyond `XALLOC_ALIGN` use the heap. An allocator constructed
+/// with a NUMA node takes storage local to that node, see `xmalloc()`. An allocator
+/// constructed with a `std::pmr::memory_resource` takes storage from the resource
+/// instead, e.g. a monotonic buffer per request or a bounded arena.
+
+#include "xallocator.h"
+#include "DelegateError.h"
+#include <cstddef>
+#include <new>
+#include <memory_resource>
+
+namespace DelegateLib
+{
+
+/// @brief A standard allocator using `xmalloc()` and `xfree()`, or a memory resource.
+/// @tparam T The allocated type.
+template <class T>
+class stl_allocator
+{
+public:
+    typedef T value_type;
+
+    stl_allocator() noexcept = default;
+
+    /// @brief Constructor.
+    /// @param[in] node The NUMA node to allocate from, or -1 for none.
+    explicit stl_allocator(int node) noexcept : m_node(node) {}
+
+    /// @brief Constructor.
+    /// @param[in] resource The memory resource to allocate from, or `nullptr` for 
+    /// the fixed block allocator.
+    /// @param[in] node The NUMA node to allocate from if `resource` is `nullptr`.
+    explicit stl_allocator(std::pmr::memory_resource* resource, int node = -1) noexcept : 
+        m_resource(resource), m_node(node) {}
+
+    template <class U>
+    stl_allocator(const stl_allocator<U>& rhs) noexcept : m_resource(rhs.resource()), m_node(rhs.node()) {}
+
+    /// @return The NUMA node allocated from, or -1 for none.
+    int node() const noexcept { return m_node; }
+
+    /// @return The memory resource allocated from, or `nullptr` for none.
+    std::pmr::memory_resource* resource() const noexcept { return m_resource; }
+
+    /// @brief Allocate storage for `n` objects.
+    /// @param[in] n The number of objects.
+    /// @return The uninitialized storage.
+    /// @throws std::bad_alloc If the heap is exhausted.
+    T* allocate(size_t n) {
+        if (n > static_cast<size_t>(-1) / sizeof(T))
+            DELEGATE_THROW(DelegateError::BAD_ALLOC, std::bad_array_new_length());
+        if (m_resource)
+            return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignof(T)));
+        if (alignof(T) > XALLOC_ALIGN)
+            return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+        return static_cast<T*>(xmalloc(n * sizeof(T), m_node));
+    }
+
+    /// @brief Free storage taken from `allocate()`.
+    /// @param[in] ptr The storage.
+    /// @param[in] n The number of objects passed to `allocate()`.
+    void deallocate(T* ptr, size_t n) noexcept {
+        if (m_resource)
+            m_resource->deallocate(ptr, n * sizeof(T), alignof(T));
+        else if (alignof(T) > XALLOC_ALIGN)
+            ::operator delete(ptr, std::align_val_t(alignof(T)));
+        else
+            xfree(ptr, n * sizeof(T), m_node);
+    }
+
+    template <class U>
+    bool operator==(const stl_allocator<U>& rhs) const noexcept { return m_resource == rhs.resource() && m_node == rhs.node(); }
+
+    template <class U>
+    bool operator!=(const stl_allocator<U>& rhs) const noexcept { return !(*this == rhs); }
+
+private:
+    std::pmr::memory_resource* m_resource = nullptr;
+    int m_node = -1;
+};
+
+}
+
+#endif
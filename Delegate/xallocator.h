@@ -0,0 +1,426 @@
+#ifndef _XALLOCATOR_H
+#define _XALLOCATOR_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief Fixed block allocator used for all dynamic storage of the delegate library.
+///
+/// @details `xmalloc()` rounds a request up to one of `XALLOC_CLASSES` block sizes and
+/// takes a block of that size class. Every size class has a central free list shared by
+/// all threads, refilled by carving a slab of blocks from the heap, and each thread has
+/// a cache of free blocks per size class. Most allocations and frees only touch the
+/// calling thread's cache. The cache exchanges a batch of blocks with the central free
+/// list when it runs empty or full, so a message allocated on one thread and freed on
+/// another costs one lock per batch rather than one per block.
+///
+/// Slabs are never returned to the heap. Once the pools reach the peak usage of the
+/// application, allocation no longer calls `operator new()` and the heap does not
+/// fragment. Requests larger than `XALLOC_MAX_BLOCK` bytes are passed to the heap.
+///
+/// Each NUMA node below `XALLOC_NODES` has its own central free lists and thread cache
+/// lists. `xmalloc(size, node)` takes a block from memory bound to the node, so a
+/// message read by a thread placed on the node is local to it whichever thread
+/// allocates it. Node slabs are bound on Linux only, elsewhere they come from the heap.
+///
+/// `xalloc_set_huge_pages()` carves later slabs from 2 MB regions backed by huge pages,
+/// so pools spanning hundreds of MB need few TLB entries.
+///
+/// The size and node passed to `xfree()` must equal those passed to `xmalloc()`. Define
+/// `USE_ALLOCATOR` for `XALLOCATOR` to route `operator new()` and `operator delete()`
+/// of a class to this allocator.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include "DelegateError.h"
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace DelegateLib
+{
+
+/// Alignment of every block
+constexpr size_t XALLOC_ALIGN = alignof(std::max_align_t);
+
+/// Largest block size. Larger requests use the heap.
+constexpr size_t XALLOC_MAX_BLOCK = 4096;
+
+/// Number of size classes: 16 byte steps to 256 bytes, then powers of two
+constexpr size_t XALLOC_CLASSES = 20;
+
+/// Number of NUMA nodes with their own pools. Higher nodes use the default pool.
+constexpr int XALLOC_NODES = 8;
+
+/// Number of pools: the default pool, then one per NUMA node
+constexpr size_t XALLOC_POOLS = XALLOC_NODES + 1;
+
+/// Size and alignment of the regions slabs are carved from while huge pages are enabled
+constexpr size_t XALLOC_HUGE_REGION = 2 * 1024 * 1024;
+
+/// @brief Get the flag set by `xalloc_set_huge_pages()`.
+inline std::atomic<bool>& xalloc_huge_pages() noexcept {
+    static std::atomic<bool> enabled(false);
+    return enabled;
+}
+
+/// @brief Carve the slabs allocated from now on from regions backed by huge pages:
+/// reserved huge pages (MAP_HUGETLB) if any, otherwise transparent huge pages
+/// (MADV_HUGEPAGE). Linux only, elsewhere slabs come from the heap. Call at startup
+/// before the pools fill. Slabs already carved keep their pages.
+/// @param[in] enable True to use huge pages.
+inline void xalloc_set_huge_pages(bool enable) noexcept {
+    xalloc_huge_pages().store(enable, std::memory_order_relaxed);
+}
+
+/// @brief Get the pool of a NUMA node.
+/// @param[in] node The NUMA node, or -1 for none.
+/// @return The pool index, 0 for the default pool.
+inline size_t xalloc_pool(int node) noexcept {
+    return node >= 0 && node < XALLOC_NODES ? static_cast<size_t>(node) + 1 : 0;
+}
+
+/// @brief Get the size class of a request.
+/// @param[in] size The request size in bytes. Must not exceed `XALLOC_MAX_BLOCK`.
+/// @return The size class index.
+inline size_t xalloc_class(size_t size) noexcept {
+    if (size <= 256)
+        return size == 0 ? 0 : (size - 1) / 16;
+    size_t cls = 16;
+    for (size_t blockSize = 512; blockSize < size; blockSize <<= 1)
+        cls++;
+    return cls;
+}
+
+/// @brief Get the block size of a size class.
+/// @param[in] cls The size class index.
+/// @return The block size in bytes.
+inline size_t xalloc_class_size(size_t cls) noexcept {
+    return cls < 16 ? (cls + 1) * 16 : size_t(512) << (cls - 16);
+}
+
+/// @brief The central free lists of a pool, one per size class, shared by all threads.
+class xalloc_central
+{
+public:
+    struct Block { Block* next; };
+
+    /// @brief Get the central free lists of a pool. Never destroyed so blocks may be
+    /// freed during static destruction.
+    /// @param[in] pool The pool index from `xalloc_pool()`.
+    static xalloc_central& instance(size_t pool = 0) {
+        static xalloc_central* centrals = [] {
+            auto pools = new xalloc_central[XALLOC_POOLS];
+            for (size_t i = 0; i < XALLOC_POOLS; i++)
+                pools[i].m_node = static_cast<int>(i) - 1;
+            return pools;
+        }();
+        return centrals[pool];
+    }
+
+    /// @brief Take blocks of a size class, carving a new slab if the free list is empty.
+    /// @param[in] cls The size class index.
+    /// @param[in] count The number of blocks wanted.
+    /// @param[out] taken The number of blocks returned, from 1 to `count`.
+    /// @return A chain of blocks linked through `Block::next`.
+    /// @throws std::bad_alloc If the heap is exhausted.
+    Block* take(size_t cls, size_t count, size_t& taken) {
+        FreeList& list = m_lists[cls];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        if (!list.head)
+            carve(list, xalloc_class_size(cls), count);
+
+        Block* first = list.head;
+        Block* last = first;
+        taken = 1;
+        while (taken < count && last->next) {
+            last = last->next;
+            taken++;
+        }
+        list.head = last->next;
+        last->next = nullptr;
+        return first;
+    }
+
+    /// @brief Return a chain of blocks of a size class.
+    /// @param[in] cls The size class index.
+    /// @param[in] first The first block of the chain.
+    /// @param[in] last The last block of the chain.
+    void give(size_t cls, Block* first, Block* last) noexcept {
+        FreeList& list = m_lists[cls];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        last->next = list.head;
+        list.head = first;
+    }
+
+private:
+    struct FreeList
+    {
+        std::mutex mutex;
+        Block* head = nullptr;
+    };
+
+    xalloc_central() = default;
+
+    /// Carve a slab of at least `count` blocks onto an empty free list
+    void carve(FreeList& list, size_t blockSize, size_t count) {
+        const size_t SLAB_SIZE = m_node < 0 ? 16384 : 65536;
+        size_t blocks = SLAB_SIZE / blockSize > count ? SLAB_SIZE / blockSize : count;
+        char* slab = static_cast<char*>(slab_alloc(blocks * blockSize));
+        for (size_t i = blocks; i > 0; i--) {
+            Block* block = reinterpret_cast<Block*>(slab + (i - 1) * blockSize);
+            block->next = list.head;
+            list.head = block;
+        }
+    }
+
+    /// Allocate slab memory, bound to the pool's NUMA node if any. Bound before the
+    /// pages are first touched, so they are placed on the node.
+    void* slab_alloc(size_t size) {
+        const int node = m_node;
+#if defined(__linux__)
+        if (xalloc_huge_pages().load(std::memory_order_relaxed) && size <= XALLOC_HUGE_REGION) {
+            // Slabs are never freed, so a region is handed out front to back
+            std::lock_guard<std::mutex> lock(m_regionMutex);
+            if (m_regionLeft < size) {
+                m_regionNext = static_cast<char*>(huge_region_alloc(node));
+                m_regionLeft = m_regionNext ? XALLOC_HUGE_REGION : 0;
+            }
+            if (m_regionLeft >= size) {
+                void* slab = m_regionNext;
+                m_regionNext += size;
+                m_regionLeft -= size;
+                return slab;
+            }
+        }
+        if (node >= 0) {
+            void* slab = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (slab == MAP_FAILED)
+                DELEGATE_THROW(DelegateError::BAD_ALLOC, std::bad_alloc());
+
+            // MPOL_PREFERRED falls back to other nodes once the node is full. Binding
+            // fails harmlessly on a kernel without NUMA support.
+            const int MPOL_PREFERRED_MODE = 1;
+            unsigned long mask = 1UL << node;
+            syscall(SYS_mbind, slab, size, MPOL_PREFERRED_MODE, &mask, sizeof(mask) * 8, 0);
+            return slab;
+        }
+#endif
+        (void)node;
+        return ::operator new(size);
+    }
+
+#if defined(__linux__)
+    /// Map an aligned huge page region bound to a NUMA node if `node` is not -1
+    /// @return The region, or nullptr if it cannot be mapped.
+    static void* huge_region_alloc(int node) {
+        void* region = mmap(nullptr, XALLOC_HUGE_REGION, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (region == MAP_FAILED) {
+            // Map twice the size and unmap the unaligned head and tail
+            char* map = static_cast<char*>(mmap(nullptr, XALLOC_HUGE_REGION * 2,
+                PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+            if (map == MAP_FAILED)
+                return nullptr;
+            char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(map) +
+                XALLOC_HUGE_REGION - 1) & ~(uintptr_t)(XALLOC_HUGE_REGION - 1));
+            if (aligned > map)
+                munmap(map, aligned - map);
+            munmap(aligned + XALLOC_HUGE_REGION, map + XALLOC_HUGE_REGION - aligned);
+            madvise(aligned, XALLOC_HUGE_REGION, MADV_HUGEPAGE);
+            region = aligned;
+        }
+        if (node >= 0) {
+            const int MPOL_PREFERRED_MODE = 1;
+            unsigned long mask = 1UL << node;
+            syscall(SYS_mbind, region, XALLOC_HUGE_REGION, MPOL_PREFERRED_MODE, &mask, sizeof(mask) * 8, 0);
+        }
+        return region;
+    }
+#endif
+
+    FreeList m_lists[XALLOC_CLASSES];
+
+    /// The unused part of the huge page region slabs are carved from
+    std::mutex m_regionMutex;
+    char* m_regionNext = nullptr;
+    size_t m_regionLeft = 0;
+
+    /// The NUMA node of the pool, or -1 for the default pool
+    int m_node = -1;
+};
+
+/// @brief A thread's cache of free blocks, one list per pool and size class.
+class xalloc_cache
+{
+public:
+    using Block = xalloc_central::Block;
+
+    xalloc_cache() = default;
+    xalloc_cache(const xalloc_cache&) = delete;
+    xalloc_cache& operator=(const xalloc_cache&) = delete;
+
+    /// Return all cached blocks to the central free lists at thread exit
+    ~xalloc_cache() {
+        for (size_t pool = 0; pool < XALLOC_POOLS; pool++) {
+            for (size_t cls = 0; cls < XALLOC_CLASSES; cls++) {
+                List& list = m_lists[pool][cls];
+                if (list.head) {
+                    Block* last = list.head;
+                    while (last->next)
+                        last = last->next;
+                    xalloc_central::instance(pool).give(cls, list.head, last);
+                    list.head = nullptr;
+                    list.count = 0;
+                }
+            }
+        }
+        destroyed() = true;
+    }
+
+    /// @brief Allocate a block of a size class
+    /// @param[in] cls The size class index.
+    /// @param[in] pool The pool index from `xalloc_pool()`.
+    /// @return The block.
+    /// @throws std::bad_alloc If the heap is exhausted.
+    void* allocate(size_t cls, size_t pool = 0) {
+        List& list = m_lists[pool][cls];
+        if (!list.head)
+            list.head = xalloc_central::instance(pool).take(cls, batch(cls), list.count);
+        Block* block = list.head;
+        list.head = block->next;
+        list.count--;
+        return block;
+    }
+
+    /// @brief Free a block of a size class
+    /// @param[in] ptr The block.
+    /// @param[in] cls The size class index.
+    /// @param[in] pool The pool index passed to `allocate()`.
+    void deallocate(void* ptr, size_t cls, size_t pool = 0) noexcept {
+        List& list = m_lists[pool][cls];
+        Block* block = static_cast<Block*>(ptr);
+        block->next = list.head;
+        list.head = block;
+        list.count++;
+
+        // Keep one batch for the next allocations and return the rest
+        const size_t keep = batch(cls);
+        if (list.count >= keep * 2) {
+            Block* last = list.head;
+            for (size_t i = 1; i < keep; i++)
+                last = last->next;
+            Block* first = last->next;
+            Block* tail = first;
+            while (tail->next)
+                tail = tail->next;
+            last->next = nullptr;
+            list.count = keep;
+            xalloc_central::instance(pool).give(cls, first, tail);
+        }
+    }
+
+    /// @brief Get the calling thread's cache.
+    /// @return The cache, or nullptr once the thread's cache is destroyed at thread exit.
+    static xalloc_cache* thread() noexcept {
+        if (destroyed())
+            return nullptr;
+        thread_local xalloc_cache cache;
+        return &cache;
+    }
+
+private:
+    struct List
+    {
+        Block* head = nullptr;
+        size_t count = 0;
+    };
+
+    /// Blocks moved between a thread cache and the central free list at a time
+    static size_t batch(size_t cls) noexcept {
+        size_t count = 8192 / xalloc_class_size(cls);
+        return count < 4 ? 4 : (count > 32 ? 32 : count);
+    }
+
+    /// Set once the thread's cache is destroyed. Trivially destructible so it stays
+    /// valid for frees made by later thread_local destructors.
+    static bool& destroyed() noexcept {
+        thread_local bool isDestroyed = false;
+        return isDestroyed;
+    }
+
+    List m_lists[XALLOC_POOLS][XALLOC_CLASSES];
+};
+
+/// @brief Allocate a block aligned to `XALLOC_ALIGN`.
+/// @param[in] size The size in bytes.
+/// @param[in] node The NUMA node to allocate from, or -1 for none.
+/// @return The block.
+/// @throws std::bad_alloc If the heap is exhausted.
+inline void* xmalloc(size_t size, int node = -1) {
+    if (size > XALLOC_MAX_BLOCK)
+        return ::operator new(size);
+
+    const size_t cls = xalloc_class(size);
+    const size_t pool = xalloc_pool(node);
+    if (xalloc_cache* cache = xalloc_cache::thread())
+        return cache->allocate(cls, pool);
+
+    size_t taken = 0;
+    return xalloc_central::instance(pool).take(cls, 1, taken);
+}
+
+/// @brief Free a block taken from `xmalloc()`.
+/// @param[in] ptr The block, or nullptr.
+/// @param[in] size The size passed to `xmalloc()`.
+/// @param[in] node The NUMA node passed to `xmalloc()`.
+inline void xfree(void* ptr, size_t size, int node = -1) noexcept {
+    if (!ptr)
+        return;
+    if (size > XALLOC_MAX_BLOCK) {
+        ::operator delete(ptr);
+        return;
+    }
+
+    const size_t cls = xalloc_class(size);
+    const size_t pool = xalloc_pool(node);
+    if (xalloc_cache* cache = xalloc_cache::thread()) {
+        cache->deallocate(ptr, cls, pool);
+        return;
+    }
+
+    auto block = static_cast<xalloc_central::Block*>(ptr);
+    xalloc_central::instance(pool).give(cls, block, block);
+}
+
+}
+
+#ifdef USE_ALLOCATOR
+    /// Class `operator new()` and `operator delete()` using `xmalloc()` and `xfree()`.
+    /// Declared within a class, the class and all its derived classes are allocated
+    /// from the fixed block allocator. The placement forms are declared too, since a
+    /// class `operator new()` hides the global ones.
+    #define XALLOCATOR \
+        public: \
+            static void* operator new(size_t size) { \
+                return DelegateLib::xmalloc(size); \
+            } \
+            static void* operator new(size_t size, const std::nothrow_t&) noexcept { \
+                DELEGATE_TRY { return DelegateLib::xmalloc(size); } \
+                DELEGATE_CATCH(...) { } \
+                return nullptr; \
+            } \
+            static void* operator new(size_t, void* place) noexcept { return place; } \
+            static void operator delete(void* ptr, size_t size) noexcept { \
+                DelegateLib::xfree(ptr, size); \
+            } \
+            static void operator delete(void*, void*) noexcept { }
+#endif
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef _XLIST_H
+#define _XLIST_H
+
+// @see https://github.com/endurodave/cpp-async-delegate
+// David Lafreniere, Aug 2020.
+
+/// @file
+/// @brief `std::list` with nodes taken from the fixed block allocator.
+
+#include "stl_allocator.h"
+#include <list>
+
+template <typename T, typename Alloc = DelegateLib::stl_allocator<T>>
+using xlist = std::list<T, Alloc>;
+
+#endif
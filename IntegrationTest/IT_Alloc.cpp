@@ -0,0 +1,167 @@
+#include "IT_Alloc.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// Replacement global operator new and operator delete. Linked into the 
+// application with IntegrationTestLib when a test uses IT_Alloc.h. The counters
+// are trivially initialized, so counting is safe before and during static
+// initialization and on any thread.
+
+namespace
+{
+	thread_local uint64_t threadAllocs = 0;
+	thread_local uint64_t threadFrees = 0;
+	thread_local uint64_t threadBytes = 0;
+
+	std::atomic<uint64_t> processAllocs{ 0 };
+	std::atomic<uint64_t> processFrees{ 0 };
+	std::atomic<uint64_t> processBytes{ 0 };
+
+	void CountAlloc(size_t size)
+	{
+		threadAllocs++;
+		threadBytes += size;
+		processAllocs.fetch_add(1, std::memory_order_relaxed);
+		processBytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	void CountFree(void* ptr)
+	{
+		if (!ptr)
+			return;
+		threadFrees++;
+		processFrees.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void* Alloc(size_t size)
+	{
+		void* ptr = malloc(size ? size : 1);
+		if (ptr)
+			CountAlloc(size);
+		return ptr;
+	}
+
+	void* AllocAligned(size_t size, std::align_val_t align)
+	{
+		size_t alignment = static_cast<size_t>(align);
+		if (alignment < sizeof(void*))
+			alignment = sizeof(void*);
+#ifdef _WIN32
+		void* ptr = _aligned_malloc(size ? size : 1, alignment);
+#else
+		void* ptr = nullptr;
+		if (posix_memalign(&ptr, alignment, size ? size : 1) != 0)
+			ptr = nullptr;
+#endif
+		if (ptr)
+			CountAlloc(size);
+		return ptr;
+	}
+
+	void Free(void* ptr)
+	{
+		CountFree(ptr);
+		free(ptr);
+	}
+
+	void FreeAligned(void* ptr)
+	{
+		CountFree(ptr);
+#ifdef _WIN32
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+}
+
+//----------------------------------------------------------------------------
+// GetThreadAllocs
+//----------------------------------------------------------------------------
+AllocCounts GetThreadAllocs()
+{
+	AllocCounts counts;
+	counts.allocs = threadAllocs;
+	counts.frees = threadFrees;
+	counts.bytes = threadBytes;
+	return counts;
+}
+
+//----------------------------------------------------------------------------
+// GetProcessAllocs
+//----------------------------------------------------------------------------
+AllocCounts GetProcessAllocs()
+{
+	AllocCounts counts;
+	counts.allocs = processAllocs.load(std::memory_order_relaxed);
+	counts.frees = processFrees.load(std::memory_order_relaxed);
+	counts.bytes = processBytes.load(std::memory_order_relaxed);
+	return counts;
+}
+
+//----------------------------------------------------------------------------
+// operator new
+//----------------------------------------------------------------------------
+void* operator new(size_t size)
+{
+	void* ptr = Alloc(size);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return Alloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return Alloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t align)
+{
+	void* ptr = AllocAligned(size, align);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t align)
+{
+	return operator new(size, align);
+}
+
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	return AllocAligned(size, align);
+}
+
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	return AllocAligned(size, align);
+}
+
+//----------------------------------------------------------------------------
+// operator delete
+//----------------------------------------------------------------------------
+void operator delete(void* ptr) noexcept { Free(ptr); }
+void operator delete[](void* ptr) noexcept { Free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { Free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { Free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { Free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { Free(ptr); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { FreeAligned(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { FreeAligned(ptr); }
@@ -0,0 +1,59 @@
+#ifndef _IT_ALLOC_H
+#define _IT_ALLOC_H
+
+// Heap allocation tracking for integration tests. IT_Alloc.cpp replaces the
+// global operator new and operator delete with versions that count each
+// allocation on the calling thread and process wide, so a test can assert that
+// a hot path does not allocate once warmed up. See EXPECT_NO_ALLOC() and 
+// EXPECT_ALLOCS_LE() in IT_Util.h.
+//
+// Only allocations through operator new are counted. malloc() calls, e.g. by
+// the C library, are not.
+
+#include <cstdint>
+
+// Allocation counts, either running totals or the difference over a scope
+struct AllocCounts
+{
+	uint64_t allocs = 0;
+	uint64_t frees = 0;
+	uint64_t bytes = 0;
+
+	AllocCounts operator-(const AllocCounts& rhs) const
+	{
+		AllocCounts diff;
+		diff.allocs = allocs - rhs.allocs;
+		diff.frees = frees - rhs.frees;
+		diff.bytes = bytes - rhs.bytes;
+		return diff;
+	}
+};
+
+// Get the allocations made by the calling thread since it started
+AllocCounts GetThreadAllocs();
+
+// Get the allocations made by all threads since the process started
+AllocCounts GetProcessAllocs();
+
+// Counts the allocations made from construction until Get(). By default only
+// the calling thread's allocations are counted, so other threads running 
+// concurrently do not disturb the count. Count all threads to include the work
+// a call causes on a destination thread, e.g. an asynchronous delegate's target
+// function, with no other thread active.
+class AllocScope
+{
+public:
+	explicit AllocScope(bool allThreads = false) :
+		m_allThreads(allThreads), m_start(Now()) {}
+
+	// Get the allocations made since construction
+	AllocCounts Get() const { return Now() - m_start; }
+
+private:
+	AllocCounts Now() const { return m_allThreads ? GetProcessAllocs() : GetThreadAllocs(); }
+
+	const bool m_allThreads;
+	const AllocCounts m_start;
+};
+
+#endif
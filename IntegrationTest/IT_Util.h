@@ -3,14 +3,23 @@
 
 // Common utilities used within the integration test modules
 
+#include "IntegrationTest.h"
+#include "LatencyHistogram.h"
+#include "IT_Alloc.h"
+
 // Prevent conflict with GoogleTest ASSERT_TRUE macro definition between 
 // gtest.h and Fault.h
 #ifdef ASSERT_TRUE
 #undef ASSERT_TRUE
 #endif
 
+#include <algorithm>
 #include <chrono>
+#include <optional>
+#include <type_traits>
 #include <utility>
+#include <variant>
+#include <vector>
 #include <gtest/gtest.h>
 
 // Helper function to simplify asynchronous function invoke within a test
@@ -26,4 +35,144 @@ auto AsyncInvoke(C obj, F func, T& thread, M timeout, Args&&... args)
 	return retVal;
 }
 
+// Asynchronously invoke a target function count times without waiting for each
+// call, then wait for all of the calls with one aggregate timeout. The calls are 
+// pipelined through the thread's queue instead of making one round trip at a time.
+// Returns the return value of each call in call order, std::monostate for a void
+// function. A call not complete within the timeout has no value and fails the 
+// test once.
+template <typename C, typename F, typename T, typename M = std::chrono::milliseconds, typename... Args>
+auto AsyncInvokeMany(size_t count, C obj, F func, T& thread, M timeout, Args&&... args)
+{
+	auto delegate = MakeDelegateFuture(obj, func, thread);
+	using Future = decltype(delegate.AsyncInvoke(args...));
+	using RetType = decltype(std::declval<Future&>().Get());
+	using Value = std::conditional_t<std::is_void_v<RetType>, std::monostate, RetType>;
+
+	std::vector<Future> futures;
+	futures.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		futures.push_back(delegate.AsyncInvoke(args...));
+
+	// Wait for every call until the shared deadline
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+	std::vector<std::optional<Value>> results(count);
+	size_t incomplete = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+		if (!futures[i].IsReady() && !futures[i].Wait(std::max(remaining, std::chrono::milliseconds(0))))
+		{
+			incomplete++;
+			continue;
+		}
+		if constexpr (std::is_void_v<RetType>)
+			results[i].emplace();
+		else
+			results[i] = futures[i].Get();
+	}
+
+	// Check that every call completed within the timeout specified
+	EXPECT_EQ(incomplete, 0u) << "Async invokes not complete within the timeout";
+
+	return results;
+}
+
+// Latencies and total time of an operation repeated by MeasureRepeated() or
+// AsyncInvokeRepeated(). Percentiles are bucket upper bounds, within 12.5% above 
+// the recorded latency.
+struct PerfResult
+{
+	LatencyHistogram latency;
+	std::chrono::nanoseconds elapsed = std::chrono::nanoseconds(0);
+	size_t count = 0;
+	size_t failed = 0;
+
+	// Get the operations completed per second
+	double Throughput() const 
+	{
+		return elapsed.count() > 0 ? (double)count * 1e9 / (double)elapsed.count() : 0.0;
+	}
+};
+
+// Time an operation count times after count / 10 untimed warm up runs. The warm
+// up keeps one off costs such as first allocations out of the percentiles.
+template <typename F>
+PerfResult MeasureRepeated(size_t count, F&& operation)
+{
+	for (size_t i = 0; i < std::max<size_t>(1, count / 10); i++)
+		operation();
+
+	PerfResult result;
+	auto start = std::chrono::steady_clock::now();
+	auto last = start;
+	for (size_t i = 0; i < count; i++)
+	{
+		operation();
+		auto now = std::chrono::steady_clock::now();
+		result.latency.Record(now - last);
+		last = now;
+	}
+	result.elapsed = last - start;
+	result.count = count;
+	return result;
+}
+
+// Asynchronously invoke a target function count times like AsyncInvoke() and
+// time each round trip. A call that does not complete within the timeout is
+// counted as failed and fails the test once.
+template <typename C, typename F, typename T, typename M = std::chrono::milliseconds, typename... Args>
+PerfResult AsyncInvokeRepeated(size_t count, C obj, F func, T& thread, M timeout, Args&&... args) 
+{
+	auto delegate = MakeDelegate(obj, func, thread, timeout);
+	size_t failed = 0;
+	PerfResult result = MeasureRepeated(count, [&]() {
+		if (!delegate.AsyncInvoke(args...).has_value())
+			failed++;
+	});
+	result.failed = failed;
+	EXPECT_EQ(result.failed, 0u) << "Async invokes timed out";
+	return result;
+}
+
+// Check a latency percentile of a PerfResult is at most a duration
+#define EXPECT_LATENCY_LE(result, percentile, limit) \
+	EXPECT_LE((result).latency.GetPercentile(percentile).count(), \
+		std::chrono::duration_cast<std::chrono::nanoseconds>(limit).count()) \
+		<< "p" << (percentile) << " latency in nS over budget"
+
+#define EXPECT_LATENCY_P50_LE(result, limit) EXPECT_LATENCY_LE(result, 50, limit)
+#define EXPECT_LATENCY_P99_LE(result, limit) EXPECT_LATENCY_LE(result, 99, limit)
+
+// Check the operations per second of a PerfResult is at least a rate
+#define EXPECT_THROUGHPUT_GE(result, opsPerSecond) \
+	EXPECT_GE((result).Throughput(), (double)(opsPerSecond)) << "Operations per second under budget"
+
+// Count the calling thread's heap allocations over count runs of an operation,
+// after count / 10 uncounted warm up runs that make one off allocations such as
+// pool blocks and lazily grown buffers.
+template <typename F>
+AllocCounts MeasureAllocs(size_t count, F&& operation)
+{
+	for (size_t i = 0; i < std::max<size_t>(1, count / 10); i++)
+		operation();
+
+	AllocScope scope;
+	for (size_t i = 0; i < count; i++)
+		operation();
+	return scope.Get();
+}
+
+// Check a statement makes at most n heap allocations on the calling thread, 
+// e.g. EXPECT_ALLOCS_LE(1, { delegate(1, 2); }). Warm the path up first.
+#define EXPECT_ALLOCS_LE(n, ...) \
+	do { \
+		AllocScope itAllocScope; \
+		__VA_ARGS__; \
+		EXPECT_LE(itAllocScope.Get().allocs, (uint64_t)(n)) << "Heap allocations over budget in: " #__VA_ARGS__; \
+	} while (0)
+
+// Check a statement makes no heap allocation on the calling thread
+#define EXPECT_NO_ALLOC(...) EXPECT_ALLOCS_LE(0, __VA_ARGS__)
+
 #endif
\ No newline at end of file
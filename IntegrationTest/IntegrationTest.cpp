@@ -1,4 +1,7 @@
 #include "IntegrationTest.h"
+#include "IT_Alloc.h"
+#include "MetricsExporter.h"
+#include "ThreadRegistry.h"
 
 // Prevent conflict with GoogleTest ASSERT_TRUE macro definition
 #ifdef ASSERT_TRUE
@@ -6,6 +9,261 @@
 #endif
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <set>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+//----------------------------------------------------------------------------
+// GetExclusive
+//----------------------------------------------------------------------------
+std::map<std::string, std::string>& IntegrationTest::GetExclusive()
+{
+	static std::map<std::string, std::string> exclusive;
+	return exclusive;
+}
+
+//----------------------------------------------------------------------------
+// GetResets
+//----------------------------------------------------------------------------
+std::vector<IntegrationTest::ResetHook>& IntegrationTest::GetResets()
+{
+	static std::vector<ResetHook> resets;
+	return resets;
+}
+
+//----------------------------------------------------------------------------
+// ResetSubsystems
+//----------------------------------------------------------------------------
+void IntegrationTest::ResetSubsystems()
+{
+	for (const ResetHook& hook : GetResets())
+	{
+		auto retVal = MakeDelegate(hook.reset, hook.thread(), RESET_TIMEOUT).AsyncInvoke();
+		if (!retVal.has_value())
+			std::cout << "[ RESET    ] " << hook.subsystem << " reset timed out" << std::endl;
+	}
+}
+
+//----------------------------------------------------------------------------
+// GetWorkloads
+//----------------------------------------------------------------------------
+std::vector<IntegrationTest::Workload>& IntegrationTest::GetWorkloads()
+{
+	static std::vector<Workload> workloads;
+	return workloads;
+}
+
+// Resets the registered subsystems once each test ends
+class ResetListener : public ::testing::EmptyTestEventListener
+{
+	virtual void OnTestEnd(const ::testing::TestInfo&) override
+	{
+		IntegrationTest::ResetSubsystems();
+	}
+};
+
+// The resources used by the process up to a point in time
+struct ResourceSample
+{
+	std::chrono::steady_clock::time_point time;
+	double cpuMs = 0;
+	AllocCounts allocs;
+	uint64_t switches = 0;
+	long maxResidentKb = 0;
+	uint64_t logBytes = 0;
+
+	// CPU time of each framework thread keyed by native thread ID
+	std::map<uint64_t, std::pair<std::string, std::chrono::nanoseconds>> threads;
+
+	static ResourceSample Take()
+	{
+		static DelegateLib::MetricCounter& logBytesMetric = DelegateLib::Metrics::GetCounter("logdata.flushed_bytes");
+
+		ResourceSample sample;
+		sample.time = std::chrono::steady_clock::now();
+		sample.allocs = GetProcessAllocs();
+		sample.logBytes = logBytesMetric.GetValue();
+#if defined(__linux__)
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+		{
+			sample.cpuMs = (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+				(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+			sample.switches = (uint64_t)usage.ru_nvcsw + (uint64_t)usage.ru_nivcsw;
+			sample.maxResidentKb = usage.ru_maxrss;
+		}
+#endif
+		for (const ThreadRegistry::ThreadInfo& info : ThreadRegistry::GetThreads())
+			sample.threads[info.nativeId] = { info.name, info.cpuTime };
+		return sample;
+	}
+};
+
+// The resources one test used
+struct ResourceRow
+{
+	std::string test;
+	bool failed;
+	double wallMs;
+	double cpuMs;
+	uint64_t allocs;
+	uint64_t allocBytes;
+	uint64_t switches;
+	long maxResidentKb;
+	uint64_t logBytes;
+
+	// CPU time of each framework thread name, the subsystem
+	std::map<std::string, double> threadCpuMs;
+};
+
+// Writes the report of IT_REPORT. Joined before the run completes.
+static std::thread reportWriter;
+
+// Records the resources each test uses, see IT_REPORT
+class ResourceListener : public ::testing::EmptyTestEventListener
+{
+public:
+	explicit ResourceListener(const std::string& base) : m_base(base) {}
+
+	virtual void OnTestStart(const ::testing::TestInfo&) override
+	{
+		m_start = ResourceSample::Take();
+	}
+
+	virtual void OnTestEnd(const ::testing::TestInfo& info) override
+	{
+		ResourceSample end = ResourceSample::Take();
+		ResourceRow row;
+		row.test = std::string(info.test_suite_name()) + "." + info.name();
+		row.failed = info.result()->Failed();
+		row.wallMs = std::chrono::duration<double, std::milli>(end.time - m_start.time).count();
+		row.cpuMs = end.cpuMs - m_start.cpuMs;
+		row.allocs = end.allocs.allocs - m_start.allocs.allocs;
+		row.allocBytes = end.allocs.bytes - m_start.allocs.bytes;
+		row.switches = end.switches - m_start.switches;
+		row.maxResidentKb = end.maxResidentKb - m_start.maxResidentKb;
+		row.logBytes = end.logBytes - m_start.logBytes;
+
+		// A thread started within the test used all of its CPU time in the test
+		for (const auto& thread : end.threads)
+		{
+			auto cpu = thread.second.second;
+			auto start = m_start.threads.find(thread.first);
+			if (start != m_start.threads.end())
+				cpu -= start->second.second;
+			row.threadCpuMs[thread.second.first] += std::chrono::duration<double, std::milli>(cpu).count();
+		}
+		m_rows.push_back(std::move(row));
+	}
+
+	virtual void OnTestProgramEnd(const ::testing::UnitTest&) override
+	{
+		if (reportWriter.joinable())
+			reportWriter.join();
+		reportWriter = std::thread(&ResourceListener::Write, m_base, std::move(m_rows));
+		m_rows.clear();
+	}
+
+private:
+	static void Write(std::string base, std::vector<ResourceRow> rows)
+	{
+		std::ofstream csv(base + ".csv");
+		csv << "test,failed,wall_ms,cpu_ms,allocs,alloc_bytes,context_switches,peak_rss_delta_kb,logdata_bytes,thread_cpu_ms\n";
+		for (const ResourceRow& row : rows)
+		{
+			csv << row.test << "," << row.failed << "," << row.wallMs << "," << row.cpuMs << "," <<
+				row.allocs << "," << row.allocBytes << "," << row.switches << "," << row.maxResidentKb <<
+				"," << row.logBytes << ",";
+			const char* separator = "";
+			for (const auto& thread : row.threadCpuMs)
+			{
+				csv << separator << thread.first << "=" << thread.second;
+				separator = ";";
+			}
+			csv << "\n";
+		}
+
+		std::ofstream json(base + ".json");
+		json << "[\n";
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			const ResourceRow& row = rows[i];
+			json << "  { \"test\": \"" << row.test << "\", \"failed\": " << (row.failed ? "true" : "false") <<
+				", \"wall_ms\": " << row.wallMs << ", \"cpu_ms\": " << row.cpuMs << ", \"allocs\": " << row.allocs <<
+				", \"alloc_bytes\": " << row.allocBytes << ", \"context_switches\": " << row.switches <<
+				", \"peak_rss_delta_kb\": " << row.maxResidentKb << ", \"logdata_bytes\": " << row.logBytes <<
+				", \"thread_cpu_ms\": {";
+			const char* separator = " ";
+			for (const auto& thread : row.threadCpuMs)
+			{
+				json << separator << "\"" << thread.first << "\": " << thread.second;
+				separator = ", ";
+			}
+			json << " } }" << (i + 1 < rows.size() ? "," : "") << "\n";
+		}
+		json << "]\n";
+	}
+
+	const std::string m_base;
+	ResourceSample m_start;
+	std::vector<ResourceRow> m_rows;
+};
+
+#if defined(__linux__)
+// The results pipe of a zygote child, or -1 if not a zygote child
+static int zygotePipe = -1;
+
+// The tests run by a zygote child
+static std::string zygoteFilter;
+
+// Reports each test result of a zygote child over its results pipe
+class ZygoteListener : public ::testing::EmptyTestEventListener
+{
+	virtual void OnTestEnd(const ::testing::TestInfo& info) override
+	{
+		// A line shorter than PIPE_BUF is written atomically
+		std::string line = std::string(info.test_suite_name()) + "." + info.name() + 
+			(info.result()->Failed() ? " FAILED " : " PASSED ") + 
+			std::to_string(info.result()->elapsed_time()) + "\n";
+		ssize_t written = write(zygotePipe, line.data(), line.size());
+		(void)written;
+	}
+};
+
+// Get the number of threads of this process
+static size_t CountThreads()
+{
+	size_t count = 0;
+	if (DIR* dir = opendir("/proc/self/task"))
+	{
+		while (dirent* entry = readdir(dir))
+		{
+			if (entry->d_name[0] != '.')
+				count++;
+		}
+		closedir(dir);
+	}
+	return count;
+}
+#endif
 
 //----------------------------------------------------------------------------
 // GetInstance
@@ -23,10 +281,6 @@ IntegrationTest::IntegrationTest() :
 	m_thread("IntegrationTestThread")
 {
 	m_thread.CreateThread();
-
-	// Start integration tests 500mS after system startup
-	m_timer.Expired = MakeDelegate(this, &IntegrationTest::Run, m_thread);
-	m_timer.Start(std::chrono::milliseconds(500));
 }
 
 //----------------------------------------------------------------------------
@@ -34,7 +288,25 @@ IntegrationTest::IntegrationTest() :
 //----------------------------------------------------------------------------
 IntegrationTest::~IntegrationTest()
 {
-	m_timer.Expired = 0;
+}
+
+//----------------------------------------------------------------------------
+// Ready
+//----------------------------------------------------------------------------
+void IntegrationTest::Ready()
+{
+	// Start the integration tests on the first call
+	if (!m_ready.exchange(true))
+		MakeDelegate(this, &IntegrationTest::Run, m_thread)();
+}
+
+//----------------------------------------------------------------------------
+// WaitComplete
+//----------------------------------------------------------------------------
+void IntegrationTest::WaitComplete()
+{
+	std::unique_lock<std::mutex> lock(m_completeLock);
+	m_completeCv.wait(lock, [this]() { return m_complete.load(); });
 }
 
 //----------------------------------------------------------------------------
@@ -42,16 +314,703 @@ IntegrationTest::~IntegrationTest()
 //----------------------------------------------------------------------------
 void IntegrationTest::Run()
 {
-	m_timer.Stop();
-
 	// Initialize Google Test
 	::testing::InitGoogleTest();
+	if (!GetResets().empty())
+		::testing::UnitTest::GetInstance()->listeners().Append(new ResetListener());
+	const char* report = std::getenv("IT_REPORT");
+	bool child = std::getenv("IT_SHARD") != nullptr;
+#if defined(__linux__)
+	child = child || zygotePipe >= 0;
+#endif
+	if (report && *report && !child)
+		::testing::UnitTest::GetInstance()->listeners().Append(new ResourceListener(report));
 
-	// Run all tests and return the result
-	int retVal = RUN_ALL_TESTS();
+	// Run all tests and return the result. A shard child runs its own filter 
+	// and a zygote child the filter it was forked for.
+	const char* jobs = std::getenv("IT_JOBS");
+	bool soak = std::getenv("IT_SOAK_SECONDS") || std::getenv("IT_SOAK_ITERATIONS");
+	int retVal;
+#if defined(__linux__)
+	if (zygotePipe >= 0)
+	{
+		GTEST_FLAG_SET(filter, zygoteFilter);
+		::testing::UnitTest::GetInstance()->listeners().Append(new ZygoteListener());
+		retVal = RUN_ALL_TESTS();
+	}
+	else
+#endif
+	if (soak && !std::getenv("IT_SHARD"))
+		retVal = RunSoak();
+	else if (jobs && std::atoi(jobs) > 1 && !std::getenv("IT_SHARD") && !std::getenv("GTEST_FILTER"))
+		retVal = RunSharded((unsigned)std::atoi(jobs));
+	else
+		retVal = RUN_ALL_TESTS();
 
+	if (reportWriter.joinable())
+		reportWriter.join();
 	std::cout << "RUN_ALL_TESTS() return value: " << retVal << std::endl;
 
+	std::lock_guard<std::mutex> lock(m_completeLock);
 	m_complete = true;
+	m_completeCv.notify_all();
+}
+
+// Get an integer environment variable
+static long GetEnvInt(const char* name, long defaultValue)
+{
+	const char* value = std::getenv(name);
+	return value ? std::atol(value) : defaultValue;
+}
+
+// Get the resident memory of this process
+static double GetResidentBytes()
+{
+#if defined(__linux__)
+	long pages = 0, resident = 0;
+	std::ifstream statm("/proc/self/statm");
+	if (statm >> pages >> resident)
+		return (double)resident * sysconf(_SC_PAGESIZE);
+#endif
+	return 0;
+}
+
+//----------------------------------------------------------------------------
+// RunSoak
+//----------------------------------------------------------------------------
+int IntegrationTest::RunSoak()
+{
+	using namespace std::chrono;
+
+	const long seconds = GetEnvInt("IT_SOAK_SECONDS", 0);
+	const long iterations = GetEnvInt("IT_SOAK_ITERATIONS", 0);
+	const long threads = GetEnvInt("IT_SOAK_THREADS", 0);
+	const long sampleMs = std::max(GetEnvInt("IT_SOAK_SAMPLE_MS", 1000), 1L);
+	const double growth = (double)GetEnvInt("IT_SOAK_GROWTH", 20);
+	const char* watchEnv = std::getenv("IT_SOAK_WATCH");
+	const std::string watch = watchEnv ? watchEnv : "resident,queue_depth,queue_size,.p99,.p999";
+
+	// Sample the metrics registry on the exporter thread
+	struct Sample
+	{
+		double elapsed;
+		std::vector<DelegateLib::MetricSample> metrics;
+	};
+	std::vector<Sample> samples;
+	std::mutex samplesLock;
+	const auto start = steady_clock::now();
+	DelegateLib::Metrics::SetGauge("process.resident_bytes", &GetResidentBytes);
+	MetricsExporter exporter;
+	exporter.Start(milliseconds(sampleMs), [&](const std::vector<DelegateLib::MetricSample>& metrics) {
+		std::lock_guard<std::mutex> lock(samplesLock);
+		samples.push_back({ duration<double>(steady_clock::now() - start).count(), metrics });
+	});
+
+	std::atomic<bool> stop(false);
+	std::vector<std::thread> workers;
+	if (!GetWorkloads().empty())
+	{
+		for (long i = 0; i < threads; i++)
+		{
+			workers.emplace_back([&stop]() {
+				while (!stop.load(std::memory_order_relaxed))
+				{
+					for (const Workload& workload : GetWorkloads())
+						workload.run();
+				}
+			});
+		}
+	}
+
+	std::cout << "[ SOAK     ] " << (seconds ? std::to_string(seconds) + " s " : std::string()) <<
+		(iterations ? std::to_string(iterations) + " iterations " : std::string()) << "with " << 
+		workers.size() << " workload threads" << std::endl;
+
+	// Repeat the selected tests until a limit is reached
+	long iteration = 0;
+	long failedIterations = 0;
+	const auto end = start + std::chrono::seconds(seconds);
+	while ((!iterations || iteration < iterations) && (!seconds || steady_clock::now() < end))
+	{
+		if (RUN_ALL_TESTS() != 0)
+			failedIterations++;
+		iteration++;
+
+		// Only the workloads run when no test is selected
+		if (::testing::UnitTest::GetInstance()->test_to_run_count() == 0)
+			std::this_thread::sleep_for(milliseconds(std::min(sampleMs, 100L)));
+	}
+
+	stop = true;
+	for (auto& worker : workers)
+		worker.join();
+	exporter.Stop();
+	DelegateLib::Metrics::RemoveGauge("process.resident_bytes");
+
+	// Write each sampled gauge, counter and latency percentile as a column
+	std::vector<std::string> columns;
+	std::vector<std::map<std::string, double>> rows;
+	for (const Sample& sample : samples)
+	{
+		std::map<std::string, double> row;
+		for (const auto& metric : sample.metrics)
+		{
+			if (metric.type == DelegateLib::MetricSample::Type::HISTOGRAM)
+			{
+				// An empty histogram has no percentiles
+				if (metric.histogram.count == 0)
+					continue;
+				row[metric.name + ".p50"] = (double)metric.histogram.p50;
+				row[metric.name + ".p99"] = (double)metric.histogram.p99;
+				row[metric.name + ".p999"] = (double)metric.histogram.p999;
+			}
+			else
+				row[metric.name] = metric.value;
+		}
+		for (const auto& value : row)
+		{
+			if (std::find(columns.begin(), columns.end(), value.first) == columns.end())
+				columns.push_back(value.first);
+		}
+		rows.push_back(std::move(row));
+	}
+
+	std::ofstream csv("it_soak.csv");
+	csv << "elapsed_s";
+	for (const auto& column : columns)
+		csv << "," << column;
+	csv << "\n";
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		csv << samples[i].elapsed;
+		for (const auto& column : columns)
+		{
+			csv << ",";
+			auto value = rows[i].find(column);
+			if (value != rows[i].end())
+				csv << value->second;
+		}
+		csv << "\n";
+	}
+
+	// Compare the mean of the first and last quarter of the samples. Many 
+	// gauges publish totals that only grow, so only metrics whose name contains
+	// an IT_SOAK_WATCH entry are flagged.
+	size_t quarter = std::max(rows.size() / 4, (size_t)1);
+	int flagged = 0;
+	for (const auto& column : columns)
+	{
+		double first = 0, last = 0;
+		size_t firstCount = 0, lastCount = 0;
+		for (size_t i = 0; i < rows.size(); i++)
+		{
+			auto value = rows[i].find(column);
+			if (value == rows[i].end())
+				continue;
+			if (i < quarter)
+			{
+				first += value->second;
+				firstCount++;
+			}
+			if (i >= rows.size() - quarter)
+			{
+				last += value->second;
+				lastCount++;
+			}
+		}
+		if (!firstCount || !lastCount)
+			continue;
+		first /= firstCount;
+		last /= lastCount;
+
+		bool watched = false;
+		std::istringstream entries(watch);
+		std::string entry;
+		while (std::getline(entries, entry, ','))
+			watched |= !entry.empty() && column.find(entry) != std::string::npos;
+		bool grew = watched && rows.size() >= 4 && last > first && 
+			(first == 0 || (last - first) * 100 / first > growth);
+		if (grew)
+			flagged++;
+		std::cout << (grew ? "[ GROWTH   ] " : "[ TREND    ] ") << column << " " << first << " -> " << last << std::endl;
+	}
+
+	std::cout << "[ SOAK     ] " << iteration << " iterations, " << failedIterations << " failed, " << 
+		samples.size() << " samples, " << flagged << " growing metrics. Samples in it_soak.csv" << std::endl;
+	return failedIterations == 0 ? 0 : 1;
+}
+
+#if defined(__linux__)
+// Get the path of the test duration history
+static std::string GetDurationsPath()
+{
+	const char* path = std::getenv("IT_DURATIONS");
+	return path && *path ? path : "it_durations.txt";
 }
 
+// Load the duration history: the milliseconds each test took in past runs
+static std::map<std::string, double> LoadDurations()
+{
+	std::map<std::string, double> durations;
+	std::ifstream file(GetDurationsPath());
+	std::string name;
+	double ms;
+	while (file >> name >> ms)
+		durations[name] = ms;
+	return durations;
+}
+
+// Add the durations measured by this run to the history. A test's duration is 
+// averaged with its previous one to smooth out timing noise. Tests not run 
+// keep their history.
+static void SaveDurations(const std::map<std::string, double>& measured)
+{
+	if (measured.empty())
+		return;
+	std::map<std::string, double> durations = LoadDurations();
+	for (auto& test : measured)
+	{
+		auto previous = durations.find(test.first);
+		durations[test.first] = previous == durations.end() ? test.second : (previous->second + test.second) / 2;
+	}
+
+	// Replace the file only once complete, since concurrent runs may read it
+	std::string path = GetDurationsPath();
+	std::string temp = path + ".tmp";
+	std::ofstream file(temp);
+	for (auto& test : durations)
+		file << test.first << " " << test.second << "\n";
+	file.close();
+	if (file)
+		rename(temp.c_str(), path.c_str());
+	else
+		remove(temp.c_str());
+}
+
+// Estimate the duration of the tests a filter of "Suite.*" and "Suite.Test" 
+// patterns selects. A test without history is estimated as long as the longest
+// known test, so new tests start early.
+static double EstimateDuration(const std::string& filter, const std::map<std::string, double>& durations)
+{
+	double unknown = 0;
+	for (auto& test : durations)
+		unknown = std::max(unknown, test.second);
+
+	std::set<std::string> patterns;
+	std::istringstream stream(filter);
+	std::string pattern;
+	while (std::getline(stream, pattern, ':'))
+		patterns.insert(pattern);
+
+	double estimate = 0;
+	auto unitTest = ::testing::UnitTest::GetInstance();
+	for (int i = 0; i < unitTest->total_test_suite_count(); i++)
+	{
+		auto suite = unitTest->GetTestSuite(i);
+		bool wholeSuite = patterns.count(std::string(suite->name()) + ".*") != 0;
+		for (int j = 0; j < suite->total_test_count(); j++)
+		{
+			std::string name = std::string(suite->name()) + "." + suite->GetTestInfo(j)->name();
+			if (!wholeSuite && !patterns.count(name))
+				continue;
+			auto known = durations.find(name);
+			estimate += known != durations.end() ? known->second : unknown;
+		}
+	}
+	return estimate;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Zygote
+//----------------------------------------------------------------------------
+bool IntegrationTest::Zygote()
+{
+#if defined(__linux__)
+	const char* mode = std::getenv("IT_ZYGOTE");
+	if (!mode || std::getenv("IT_SHARD") || std::getenv("GTEST_FILTER"))
+		return false;
+	bool perTest = strcmp(mode, "test") == 0;
+	if (!perTest && strcmp(mode, "suite") != 0)
+	{
+		std::cout << "[ ZYGOTE   ] Unknown IT_ZYGOTE mode " << mode << std::endl;
+		return false;
+	}
+
+	// fork() copies only the calling thread, so no other thread may exist yet
+	if (CountThreads() > 1)
+	{
+		std::cout << "[ ZYGOTE   ] Threads already running, tests run in this process" << std::endl;
+		return false;
+	}
+
+	::testing::InitGoogleTest();
+
+	// The tests each child runs. A test of an exclusive suite never runs 
+	// concurrently with another test of the same subsystem.
+	struct Job
+	{
+		std::string filter;
+		std::string subsystem;
+		double estimate;
+	};
+	std::vector<Job> jobs;
+	if (perTest)
+	{
+		auto unitTest = ::testing::UnitTest::GetInstance();
+		for (int i = 0; i < unitTest->total_test_suite_count(); i++)
+		{
+			auto suite = unitTest->GetTestSuite(i);
+			if (strncmp(suite->name(), "DISABLED_", 9) == 0)
+				continue;
+
+			auto tag = GetExclusive().find(suite->name());
+			for (int j = 0; j < suite->total_test_count(); j++)
+			{
+				auto test = suite->GetTestInfo(j);
+				if (strncmp(test->name(), "DISABLED_", 9) == 0)
+					continue;
+				jobs.push_back({ std::string(suite->name()) + "." + test->name(), 
+					tag != GetExclusive().end() ? tag->second : std::string(), 0 });
+			}
+		}
+	}
+	else
+	{
+		for (auto& filter : GroupSuites())
+			jobs.push_back({ filter, std::string(), 0 });
+	}
+
+	// Longest processing time first: an idle slot takes the longest job not yet
+	// started, so the short jobs fill in around the long ones at the end
+	std::map<std::string, double> durations = LoadDurations();
+	for (auto& job : jobs)
+		job.estimate = EstimateDuration(job.filter, durations);
+	std::stable_sort(jobs.begin(), jobs.end(), 
+		[](const Job& a, const Job& b) { return a.estimate > b.estimate; });
+	std::map<std::string, double> measured;
+
+	const char* jobsEnv = std::getenv("IT_JOBS");
+	unsigned maxChildren = jobsEnv && std::atoi(jobsEnv) > 1 ? (unsigned)std::atoi(jobsEnv) : 1;
+
+	std::cout << "[ ZYGOTE   ] Forking " << jobs.size() << " children, " << maxChildren << " at a time" << 
+		(durations.empty() ? "" : ", longest first by " + GetDurationsPath()) << std::endl;
+
+	struct Child
+	{
+		pid_t pid;
+		int pipe;
+		size_t job;
+		FILE* output;
+		std::string results;
+	};
+	std::vector<Child> children;
+	std::vector<bool> started(jobs.size(), false);
+	std::set<std::string> busySubsystems;
+	size_t done = 0;
+	int tests = 0, failures = 0, failedChildren = 0;
+
+	while (done < jobs.size())
+	{
+		// Fork a child for every job with an idle subsystem
+		for (size_t job = 0; job < jobs.size() && children.size() < maxChildren; job++)
+		{
+			if (started[job] || busySubsystems.count(jobs[job].subsystem))
+				continue;
+
+			std::cout << std::flush;
+			FILE* output = tmpfile();
+			int fds[2] = { -1, -1 };
+			pid_t pid = output && pipe(fds) == 0 ? fork() : -1;
+			if (pid == 0)
+			{
+				// Continue startup within the child. Run() runs the job's tests.
+				close(fds[0]);
+				for (auto& child : children)
+				{
+					close(child.pipe);
+					fclose(child.output);
+				}
+				dup2(fileno(output), STDOUT_FILENO);
+				dup2(fileno(output), STDERR_FILENO);
+				fclose(output);
+				zygotePipe = fds[1];
+				zygoteFilter = jobs[job].filter;
+				return false;
+			}
+
+			started[job] = true;
+			if (fds[1] >= 0)
+				close(fds[1]);
+			if (pid < 0)
+			{
+				if (fds[0] >= 0)
+					close(fds[0]);
+				if (output)
+					fclose(output);
+				std::cout << "[ ZYGOTE   ] " << jobs[job].filter << " fork failed" << std::endl;
+				failedChildren++;
+				done++;
+				continue;
+			}
+
+			children.push_back({ pid, fds[0], job, output, std::string() });
+			if (!jobs[job].subsystem.empty())
+				busySubsystems.insert(jobs[job].subsystem);
+		}
+
+		// Collect results until a child exits and closes its pipe
+		std::vector<pollfd> polls;
+		for (auto& child : children)
+			polls.push_back({ child.pipe, POLLIN, 0 });
+		if (poll(polls.data(), polls.size(), -1) < 0)
+			continue;
+
+		for (size_t i = children.size(); i-- > 0;)
+		{
+			if (polls[i].revents == 0)
+				continue;
+
+			Child& child = children[i];
+			char buffer[4096];
+			ssize_t size = read(child.pipe, buffer, sizeof(buffer));
+			if (size > 0 || (size < 0 && errno == EINTR))
+			{
+				if (size > 0)
+					child.results.append(buffer, size);
+				continue;
+			}
+
+			close(child.pipe);
+			int status = 0;
+			waitpid(child.pid, &status, 0);
+
+			const Job& job = jobs[child.job];
+			std::cout << "[ ZYGOTE   ] " << job.filter << std::endl;
+			rewind(child.output);
+			size_t length;
+			while ((length = fread(buffer, 1, sizeof(buffer), child.output)) > 0)
+				std::cout.write(buffer, length);
+			fclose(child.output);
+
+			// A test without a result crashed its child
+			std::istringstream results(child.results);
+			std::string name, result;
+			double ms;
+			int ran = 0;
+			while (results >> name >> result >> ms)
+			{
+				ran++;
+				if (result != "PASSED")
+					failures++;
+				measured[name] = ms;
+			}
+			tests += ran;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || ran == 0)
+			{
+				std::cout << "[ ZYGOTE   ] " << job.filter << " child ";
+				if (WIFSIGNALED(status))
+					std::cout << "killed by signal " << WTERMSIG(status) << std::endl;
+				else
+					std::cout << "exited with status " << WEXITSTATUS(status) << " after " << ran << " tests" << std::endl;
+				failedChildren++;
+			}
+
+			busySubsystems.erase(job.subsystem);
+			children.erase(children.begin() + i);
+			done++;
+		}
+	}
+
+	SaveDurations(measured);
+	std::cout << "[ ZYGOTE   ] " << tests << " tests, " << failures << " failures, " << 
+		failedChildren << " failed children" << std::endl;
+	std::cout << "RUN_ALL_TESTS() return value: " << (failures == 0 && failedChildren == 0 ? 0 : 1) << std::endl;
+	return true;
+#else
+	return false;
+#endif
+}
+
+#if defined(__linux__)
+// Get an integer attribute of the first element of an XML document
+static int GetXmlAttribute(const std::string& xml, const char* name)
+{
+	std::string key = std::string(" ") + name + "=\"";
+	size_t pos = xml.find(key);
+	return pos == std::string::npos ? 0 : std::atoi(xml.c_str() + pos + key.size());
+}
+
+// Get a string attribute of the first element of an XML document
+static std::string GetXmlString(const std::string& xml, const char* name)
+{
+	std::string key = std::string(" ") + name + "=\"";
+	size_t pos = xml.find(key);
+	if (pos == std::string::npos)
+		return std::string();
+	pos += key.size();
+	return xml.substr(pos, xml.find('"', pos) - pos);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// GroupSuites
+//----------------------------------------------------------------------------
+std::vector<std::string> IntegrationTest::GroupSuites()
+{
+	// Suites sharing an exclusive subsystem share a group
+	std::vector<std::string> filters;
+	std::map<std::string, size_t> subsystemShard;
+	auto unitTest = ::testing::UnitTest::GetInstance();
+	for (int i = 0; i < unitTest->total_test_suite_count(); i++)
+	{
+		auto suite = unitTest->GetTestSuite(i);
+		if (strncmp(suite->name(), "DISABLED_", 9) == 0)
+			continue;
+
+		auto tag = GetExclusive().find(suite->name());
+		size_t shard = filters.size();
+		if (tag != GetExclusive().end())
+		{
+			auto result = subsystemShard.emplace(tag->second, shard);
+			shard = result.first->second;
+		}
+		if (shard == filters.size())
+			filters.push_back(std::string(suite->name()) + ".*");
+		else
+			filters[shard] += std::string(":") + suite->name() + ".*";
+	}
+	return filters;
+}
+
+//----------------------------------------------------------------------------
+// RunSharded
+//----------------------------------------------------------------------------
+int IntegrationTest::RunSharded(unsigned jobs)
+{
+#if defined(__linux__)
+	std::vector<std::string> filters = GroupSuites();
+
+	// Start the longest shards first so the short ones fill in at the end
+	std::map<std::string, double> durations = LoadDurations();
+	std::map<std::string, double> estimates;
+	for (auto& filter : filters)
+		estimates[filter] = EstimateDuration(filter, durations);
+	std::stable_sort(filters.begin(), filters.end(), 
+		[&estimates](const std::string& a, const std::string& b) { return estimates[a] > estimates[b]; });
+
+	// The environment of each shard. Built before fork() since only exec() follows.
+	std::vector<std::vector<std::string>> environments(filters.size());
+	for (size_t shard = 0; shard < filters.size(); shard++)
+	{
+		for (char** var = environ; *var; var++)
+		{
+			if (strncmp(*var, "GTEST_FILTER=", 13) != 0 && strncmp(*var, "GTEST_OUTPUT=", 13) != 0)
+				environments[shard].push_back(*var);
+		}
+		environments[shard].push_back("IT_SHARD=" + std::to_string(shard));
+		environments[shard].push_back("GTEST_FILTER=" + filters[shard]);
+		environments[shard].push_back("GTEST_OUTPUT=xml:results.xml");
+	}
+
+	std::cout << "[ SHARDS   ] Running " << filters.size() << " shards, " << jobs << " at a time" << std::endl;
+
+	// Start a shard whenever fewer than jobs are running
+	size_t next = 0;
+	size_t running = 0;
+	int failedShards = 0;
+	while (next < filters.size() || running > 0)
+	{
+		if (next < filters.size() && running < jobs)
+		{
+			std::string dir = "it_shard_" + std::to_string(next);
+			mkdir(dir.c_str(), 0755);
+
+			std::vector<char*> envp;
+			for (auto& var : environments[next])
+				envp.push_back(&var[0]);
+			envp.push_back(nullptr);
+			char exe[] = "/proc/self/exe";
+			char* argv[] = { exe, nullptr };
+
+			pid_t pid = fork();
+			if (pid == 0)
+			{
+				if (chdir(dir.c_str()) == 0)
+				{
+					int out = open("output.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+					dup2(out, STDOUT_FILENO);
+					dup2(out, STDERR_FILENO);
+					execve(exe, argv, envp.data());
+				}
+				_exit(127);
+			}
+			if (pid < 0)
+				failedShards++;
+			else
+				running++;
+			next++;
+			continue;
+		}
+
+		int status;
+		if (wait(&status) > 0)
+		{
+			running--;
+			if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+				failedShards++;
+		}
+	}
+
+	// Print the shard output and merge the shard results
+	int tests = 0, failures = 0, disabled = 0, errors = 0;
+	std::string suites;
+	std::map<std::string, double> measured;
+	for (size_t shard = 0; shard < filters.size(); shard++)
+	{
+		std::string dir = "it_shard_" + std::to_string(shard);
+		std::ifstream output(dir + "/output.txt");
+		std::cout << "[ SHARD " << shard << "  ] " << filters[shard] << std::endl << output.rdbuf();
+
+		std::stringstream buffer;
+		buffer << std::ifstream(dir + "/results.xml").rdbuf();
+		std::string xml = buffer.str();
+		size_t root = xml.find("<testsuites");
+		size_t body = xml.find('>', root);
+		size_t end = xml.rfind("</testsuites>");
+		if (root == std::string::npos || body == std::string::npos || end == std::string::npos)
+		{
+			std::cout << "[ SHARD " << shard << "  ] No results" << std::endl;
+			failedShards++;
+			continue;
+		}
+		tests += GetXmlAttribute(xml.substr(root, body - root), "tests");
+		failures += GetXmlAttribute(xml.substr(root, body - root), "failures");
+		disabled += GetXmlAttribute(xml.substr(root, body - root), "disabled");
+		errors += GetXmlAttribute(xml.substr(root, body - root), "errors");
+		suites += xml.substr(body + 1, end - body - 1);
+
+		// Record the duration of each test in the history
+		for (size_t pos = xml.find("<testcase "); pos != std::string::npos && pos < end; 
+			pos = xml.find("<testcase ", pos + 1))
+		{
+			std::string element = xml.substr(pos, xml.find('>', pos) - pos);
+			measured[GetXmlString(element, "classname") + "." + GetXmlString(element, "name")] = 
+				std::atof(GetXmlString(element, "time").c_str()) * 1000;
+		}
+	}
+	SaveDurations(measured);
+
+	std::ofstream merged("it_results.xml");
+	merged << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites tests=\"" << tests << 
+		"\" failures=\"" << failures << "\" disabled=\"" << disabled << "\" errors=\"" << errors << 
+		"\" name=\"AllTests\">" << suites << "</testsuites>\n";
+
+	std::cout << "[ SHARDS   ] " << tests << " tests, " << failures << " failures, " << 
+		failedShards << " failed shards. Results in it_results.xml" << std::endl;
+	return failures == 0 && errors == 0 && failedShards == 0 ? 0 : 1;
+#else
+	(void)jobs;
+	return RUN_ALL_TESTS();
+#endif
+}
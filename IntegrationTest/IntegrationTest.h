@@ -5,20 +5,130 @@
 #define _INTEGRATION_TEST_H
 
 #include "WorkerThreadStd.h"
-#include "Timer.h"
 #include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
 
 // The IntegrationTest class executes all integration tests created using the 
 // Google Test framework on a private internal thread of control. 
+//
+// Set the IT_JOBS environment variable to run test suites in up to IT_JOBS 
+// concurrent shards. Google Test runs one test at a time per process, so each 
+// shard is a child process of this executable running a GTEST_FILTER of its 
+// suites within its own it_shard_<n> working directory. Suites tagged with the 
+// same exclusive subsystem using IT_EXCLUSIVE() share a shard and run serially. 
+// The shard output is printed in shard order and the results are merged into 
+// it_results.xml. Sharding requires Linux and no GTEST_FILTER; otherwise the 
+// suites run serially.
+//
+// Set IT_ZYGOTE to "test" or "suite" to run each test, or each group of suites,
+// in a child process forked from the warm process image instead. main() calls 
+// Zygote() after constructing the subsystems but before any thread starts; each 
+// child then completes startup, runs its tests and reports the results over a 
+// pipe. Up to IT_JOBS children run at a time. Children share the working 
+// directory and the files the subsystems opened, so suites sharing a file are 
+// tagged with IT_EXCLUSIVE(). A crash fails only the tests of its child.
+//
+// Both modes record the duration of each test in it_durations.txt, or the file
+// named by IT_DURATIONS, and start the shards or children longest first by that
+// history. Since each slot takes the next job as soon as it frees up, the short
+// jobs fill in around the long ones and the run takes about the total duration 
+// divided by IT_JOBS. IT_ZYGOTE=test balances best, as a long suite is split.
+//
+// Set IT_SOAK_SECONDS and/or IT_SOAK_ITERATIONS to soak the selected tests: 
+// they run repeatedly until either limit is reached while IT_SOAK_THREADS 
+// threads (default 0) loop the workloads registered with IT_WORKLOAD(). Every 
+// IT_SOAK_SAMPLE_MS (default 1000) the metrics registry and the process 
+// resident memory are sampled. The samples are written to it_soak.csv and a 
+// trend report compares the first and last quarter of the run. It flags the 
+// metrics named by an IT_SOAK_WATCH entry (default memory, queue depths and 
+// p99/p999 latencies) that grew more than IT_SOAK_GROWTH percent (default 20).
+// Select no tests with GTEST_FILTER=-* to soak only the workloads.
+//
+// Set IT_REPORT to a file base name to report the resources each test used:
+// wall and process CPU time, the CPU time of each framework thread listed by
+// ThreadRegistry, heap allocations, context switches, the peak resident memory
+// growth and the bytes LogData flushed. The report is written as <base>.csv and
+// <base>.json on a background thread once the tests complete. Tests run in
+// IT_JOBS or IT_ZYGOTE child processes are not reported.
+//
+// Subsystems registered with IT_RESET() are reset after every test by invoking
+// their reset function on the subsystem's own thread, so state one test leaves
+// behind does not leak into the next without the cost of a process per test.
 class IntegrationTest
 {
 public:
+	/// Registers a test suite's exclusive subsystem. See IT_EXCLUSIVE().
+	struct ExclusiveTag
+	{
+		ExclusiveTag(const char* suite, const char* subsystem) { GetExclusive()[suite] = subsystem; }
+	};
+
+	/// A subsystem reset run between tests. See IT_RESET().
+	struct ResetHook
+	{
+		std::string subsystem;
+
+		/// Get the thread the reset runs on. Called at reset time so the 
+		/// subsystem is not created during static initialization.
+		DelegateLib::DelegateThread& (*thread)();
+
+		/// Reset the subsystem. Invoked on thread().
+		void (*reset)();
+	};
+
+	/// Registers a subsystem reset hook. See IT_RESET().
+	struct ResetTag
+	{
+		ResetTag(const char* subsystem, DelegateLib::DelegateThread& (*thread)(), void (*reset)())
+		{
+			GetResets().push_back(ResetHook{ subsystem, thread, reset });
+		}
+	};
+
+	/// A workload looped during a soak. See IT_WORKLOAD().
+	struct Workload
+	{
+		std::string name;
+		void (*run)();
+	};
+
+	/// Registers a soak workload. See IT_WORKLOAD().
+	struct WorkloadTag
+	{
+		WorkloadTag(const char* name, void (*run)()) { GetWorkloads().push_back(Workload{ name, run }); }
+	};
+
+	/// Time allowed for each subsystem reset
+	static constexpr std::chrono::milliseconds RESET_TIMEOUT = std::chrono::milliseconds(1000);
+
+	/// Fork the zygote children when IT_ZYGOTE is set. Call from main() before 
+	/// IntegrationTest::GetInstance() or any subsystem thread starts.
+	/// @return True within the zygote once every child completes; main() 
+	/// returns. False within a child, or if zygote mode is off; main() continues
+	/// startup and runs the tests.
+	static bool Zygote();
+
 	/// Get singleton instance of this class
 	static IntegrationTest& GetInstance();
 
+	// Called once all subsystems are instantiated to start the integration tests
+	void Ready();
+
 	// Return true if integration test is complete
 	std::atomic<bool>& IsComplete() { return m_complete; }
 
+	// Block until the integration tests complete
+	void WaitComplete();
+
+	// Reset every registered subsystem on its own thread. Called on the 
+	// integration test thread after each test.
+	static void ResetSubsystems();
+
 private:
 	IntegrationTest();
 	~IntegrationTest();
@@ -26,13 +136,56 @@ private:
 	// Called to run all integration tests
 	void Run();
 
+	// Run the selected test suites in concurrent child process shards
+	// @param[in] jobs - the maximum number of concurrent shards
+	// @return Zero if every test passed.
+	int RunSharded(unsigned jobs);
+
+	// Run the selected tests repeatedly with the workloads and report the 
+	// sampled metric trends
+	// @return Zero if every iteration passed.
+	int RunSoak();
+
+	// Get the registered soak workloads
+	static std::vector<Workload>& GetWorkloads();
+
+	// Group the selected test suites. Suites sharing an exclusive subsystem 
+	// share a group.
+	// @return The Google Test filter of each group.
+	static std::vector<std::string> GroupSuites();
+
+	// Get the exclusive subsystem of each tagged test suite
+	static std::map<std::string, std::string>& GetExclusive();
+
+	// Get the registered subsystem reset hooks
+	static std::vector<ResetHook>& GetResets();
+
 	// The integration test worker thread that executes Google Test
 	WorkerThread m_thread;
 
-	// Timer to start integration tests
-	Timer m_timer;
-
+	std::atomic<bool> m_ready = false;
 	std::atomic<bool> m_complete = false;
+
+	// Signals WaitComplete() once m_complete is set
+	std::mutex m_completeLock;
+	std::condition_variable m_completeCv;
 };
 
+/// Tag a test suite as using a subsystem exclusively. Suites sharing a subsystem
+/// never run concurrently when sharded. Use at namespace scope within the test file.
+#define IT_EXCLUSIVE(suite, subsystem) \
+	static IntegrationTest::ExclusiveTag suite##_ExclusiveTag(#suite, subsystem)
+
+/// Reset a subsystem after every test. thread is an expression evaluating to the
+/// subsystem's DelegateThread and reset a function or captureless lambda invoked
+/// on that thread. Use at namespace scope within the test file.
+#define IT_RESET(suite, thread, reset) \
+	static IntegrationTest::ResetTag suite##_ResetTag(#suite, \
+		[]() -> DelegateLib::DelegateThread& { return thread; }, reset)
+
+/// Register a soak workload. run is a function or captureless lambda looped by 
+/// each soak thread; it paces itself. Use at namespace scope within the test file.
+#define IT_WORKLOAD(name, run) \
+	static IntegrationTest::WorkloadTag name##_WorkloadTag(#name, run)
+
 #endif
\ No newline at end of file
@@ -6,52 +6,121 @@
 #include <mutex>
 #include <condition_variable>
 #include <chrono>
+#include <cstdint>
+#include "Clock.h"
 
-// The SignalThread class provides a mechanism for threads to wait for a signal with a timeout. 
-// It allows one thread to signal another thread, which can either wait for the signal or timeout 
+// The SignalThread class provides a mechanism for threads to wait for a signal with a timeout.
+// It allows one thread to signal another thread, which can either wait for the signal or timeout
 // if the signal is not set within a specified duration.
+//
+// Signals are counted. Each SetSignal() call advances a sequence number and is consumed
+// by exactly one wait, so signals set before the waiter wakes are never merged. Any number
+// of threads may wait at once.
+//
+// Timeouts are measured on DelegateLib::Clock, so a test advancing a VirtualClock
+// expires a wait without sleeping.
 class SignalThread
 {
 public:
-    // Constructor initializes the signal to false
-    SignalThread() : m_signalSet(false) { }
+    // Constructor initializes the signal count to zero
+    SignalThread()
+    {
+        DelegateLib::Clock::AddAdvancedHook(&SignalThread::ClockAdvanced, this);
+    }
+
+    ~SignalThread()
+    {
+        DelegateLib::Clock::RemoveAdvancedHook(&SignalThread::ClockAdvanced, this);
+    }
 
     // This function waits for the signal for a maximum of milliseconds. It
     // returns true if the signal was set within the timeout, false otherwise.
     // @param[in] ms - milliseconds to wait for signal
     // @return Returns true if signalled, false otherwise.
-    bool WaitForSignal(int ms) 
+    bool WaitForSignal(int ms)
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-
-        // Wait until the signal is set or the timeout expires
-        if (m_cv.wait_for(lock, std::chrono::milliseconds(ms), [this] { return m_signalSet; })) 
-        {
-            // Reset the signal
-            m_signalSet = false; 
+        return WaitForCount(1, ms);
+    }
 
-            // Signal was set within the timeout
-            return true;
-        }
-        else 
-        {
-            // Timeout expired
+    // This function waits until count signals are pending for a maximum of
+    // milliseconds and consumes them. No signal is consumed on timeout.
+    // @param[in] count - the number of signals to wait for
+    // @param[in] ms - milliseconds to wait for the signals
+    // @return Returns true if count signals were set within the timeout, false otherwise.
+    bool WaitForCount(uint64_t count, int ms)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!Wait(lock, [this, count] { return m_sequence - m_consumed >= count; }, ms))
             return false;
-        }
+        m_consumed += count;
+        return true;
+    }
+
+    // This function waits until a predicate is true for a maximum of milliseconds.
+    // The predicate is evaluated now and after every SetSignal() with the signal lock
+    // held. No signal is consumed.
+    // @param[in] predicate - returns true once the wait is satisfied
+    // @param[in] ms - milliseconds to wait for the predicate
+    // @return Returns true if the predicate became true within the timeout, false otherwise.
+    template <class Predicate>
+    bool WaitUntil(Predicate predicate, int ms)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        return Wait(lock, predicate, ms);
     }
 
-    // This function sets the signal and notifies the waiting thread.
-    void SetSignal() 
+    // This function sets the signal and notifies the waiting threads.
+    void SetSignal()
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_signalSet = true;
+        m_sequence++;
         m_cv.notify_all();
     }
 
+    // Get the number of signals set since construction
+    uint64_t GetSequence()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_sequence;
+    }
+
+    // Discard the signals not yet consumed
+    void Reset()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_consumed = m_sequence;
+    }
+
 private:
+    SignalThread(const SignalThread&) = delete;
+    SignalThread& operator=(const SignalThread&) = delete;
+
+    // Wait with the lock held until the predicate is true or ms pass on the clock
+    template <class Predicate>
+    bool Wait(std::unique_lock<std::mutex>& lock, Predicate predicate, int ms)
+    {
+        const auto deadline = DelegateLib::Clock::Now() + std::chrono::milliseconds(ms);
+        while (!predicate())
+        {
+            if (DelegateLib::Clock::Now() >= deadline)
+                return false;
+            m_cv.wait_until(lock, DelegateLib::Clock::ToSteady(deadline));
+        }
+        return true;
+    }
+
+    // Wake the waiters to recheck their timeout after the clock advances
+    static void ClockAdvanced(void* context)
+    {
+        SignalThread* signal = static_cast<SignalThread*>(context);
+        std::lock_guard<std::mutex> lock(signal->m_mutex);
+        signal->m_cv.notify_all();
+    }
+
     std::mutex m_mutex;
     std::condition_variable m_cv;
-    bool m_signalSet; // Shared state to indicate if the signal was set
+    uint64_t m_sequence = 0;    // Number of signals set
+    uint64_t m_consumed = 0;    // Number of signals consumed by waits
 };
 
-#endif
\ No newline at end of file
+#endif
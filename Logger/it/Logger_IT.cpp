@@ -11,27 +11,124 @@
 #include "Logger.h"
 #include "DelegateLib.h"
 #include "SignalThread.h"
+#include "DispatchBatch.h"
+#include "LogMerge.h"
+#include "LogReader.h"
+#include "LogEscape.h"
+#include "LogChecksum.h"
+#include "StallWatchdog.h"
+#include "ThreadRegistry.h"
+#include "HugePages.h"
+#include "LogShmSink.h"
+#include "CoreGroup.h"
+#include <cstdio>
+#include <csignal>
+#include <set>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#ifdef LOGGER_ZLIB
+#include <zlib.h>
+#endif
 #include "IT_Util.h"		// Include this last
 
 using namespace std;
 using namespace std::chrono;
 using namespace DelegateLib;
 
+// Every test uses the Logger singleton and its log files
+IT_EXCLUSIVE(Logger_IT, "Logger");
+
+// Remove the callbacks and hooks a test leaves registered before the next test
+IT_RESET(Logger_IT, Logger::GetInstance(), []() { Logger::GetInstance().ResetForTest(); });
+
+// Soak workload writing about 1000 records per second per soak thread
+IT_WORKLOAD(Logger_IT_Write, []() {
+	Logger::GetInstance().Write("Logger_IT soak workload");
+	std::this_thread::sleep_for(std::chrono::milliseconds(1));
+});
+
 // Local integration test variables
 static SignalThread signalThread;
 static vector<string> callbackStatus;
 static milliseconds flushDuration;
+static size_t flushRecords;
+static size_t flushBytes;
 static mutex mtx;
 
+// Signals used to hold the Logger thread so messages accumulate within its queues
+static SignalThread blockedSignal;
+static SignalThread releaseSignal;
+
+// Block the Logger thread until releaseSignal is set. Returns once the Logger 
+// thread is blocked.
+static bool BlockLogger()
+{
+	std::function<void(void)> BlockLoggerFunc = []() {
+		blockedSignal.SetSignal();
+		releaseSignal.WaitForSignal(2000);
+	};
+	MakeDelegate(BlockLoggerFunc, Logger::GetInstance()).AsyncInvoke();
+	return blockedSignal.WaitForSignal(500);
+}
+
+// Wait for the Logger thread to process all messages queued before this call
+static void SyncLogger()
+{
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData,
+		&LogData::GetHighWaterMark,
+		Logger::GetInstance(),
+		milliseconds(1000));
+}
+
+// Read a log file, or its compressed copy if the file has been compressed
+static bool ReadLogFile(const string& fileName, string& contents)
+{
+	char buf[1024];
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (file)
+	{
+		size_t len;
+		while ((len = fread(buf, 1, sizeof(buf), file)) > 0)
+			contents.append(buf, len);
+		fclose(file);
+		return true;
+	}
+#ifdef LOGGER_ZLIB
+	gzFile gz = gzopen((fileName + LogCompressor::SUFFIX).c_str(), "rb");
+	if (gz)
+	{
+		int len;
+		while ((len = gzread(gz, buf, sizeof(buf))) > 0)
+			contents.append(buf, len);
+		gzclose(gz);
+		return true;
+	}
+#endif
+	return false;
+}
+
+// Remove a log file, its compressed copy and its index
+static void RemoveLogFile(const string& fileName)
+{
+	remove(fileName.c_str());
+	remove((fileName + LogCompressor::SUFFIX).c_str());
+	remove((fileName + LogIndex::SUFFIX).c_str());
+}
+
 // Logger callback handler function invoked from Logger thread context
-void FlushTimeCb(milliseconds duration)
+void FlushTimeCb(milliseconds duration, size_t records, size_t bytes)
 {
 	// Protect flushTime against multiple thread access by IntegrationTest 
 	// thread and Logger thread
 	lock_guard<mutex> lock(mtx);
 
-	// Save the flush time
+	// Save the flush time and amount written
 	flushDuration = duration;
+	flushRecords = records;
+	flushBytes = bytes;
 }
 
 // Logger callback handler function invoked from Logger thread context
@@ -51,6 +148,12 @@ void LoggerStatusCb(const string& status)
 // Test the Logger::Write() subsystem public API. 
 TEST(Logger_IT, Write) 
 {
+	// Clear the status of a previous repeat
+	{
+		lock_guard<mutex> lock(mtx);
+		callbackStatus.clear();
+	}
+
 	// Register to receive a Logger status callback
 	Logger::GetInstance().SetCallback(&LoggerStatusCb);
 
@@ -116,10 +219,10 @@ TEST(Logger_IT, FlushTime)
 	// Register for a callback from Logger thread
 	Logger::GetInstance().m_logData.FlushTimeDelegate += MakeDelegate(&FlushTimeCb);
 
-	// Clear the m_msgData list on Logger thread
+	// Clear the m_msgData buffer on Logger thread
 	auto retVal1 = MakeDelegate(
 		&Logger::GetInstance().m_logData.m_msgData,	// Object instance
-		&std::list<std::string>::clear,				// Object function
+		&LogBuffer::Clear,							// Object function
 		Logger::GetInstance(),						// Thread to invoke object function
 		milliseconds(50)).AsyncInvoke();
 
@@ -182,10 +285,10 @@ TEST(Logger_IT, FlushTimeSimplified)
 	// Register for a callback from Logger thread
 	Logger::GetInstance().m_logData.FlushTimeDelegate += MakeDelegate(&FlushTimeCb);
 
-	// Clear the m_msgData list on Logger thread
+	// Clear the m_msgData buffer on Logger thread
 	auto retVal1 = AsyncInvoke(
 		&Logger::GetInstance().m_logData.m_msgData,	// Object instance
-		&std::list<std::string>::clear,				// Object function
+		&LogBuffer::Clear,							// Object function
 		Logger::GetInstance(),						// Thread to invoke object function
 		milliseconds(50));							// Wait up to 50mS for async invoke
 
@@ -231,7 +334,7 @@ TEST(Logger_IT, FlushTimeSimplified)
 TEST(Logger_IT, FlushTimeSimplifiedWithLambda)
 {
 	// Logger callback handler lambda function invoked from Logger thread context
-	auto FlushTimeLambdaCb = +[](milliseconds duration) -> void
+	auto FlushTimeLambdaCb = +[](milliseconds duration, size_t, size_t) -> void
 	{
 		// Protect flushTime against multiple thread access by IntegrationTest 
 		// thread and Logger thread
@@ -250,10 +353,10 @@ TEST(Logger_IT, FlushTimeSimplifiedWithLambda)
 	// Register for a callback from Logger thread
 	Logger::GetInstance().m_logData.FlushTimeDelegate += MakeDelegate(FlushTimeLambdaCb);
 
-	// Clear the m_msgData list on Logger thread
+	// Clear the m_msgData buffer on Logger thread
 	auto retVal1 = AsyncInvoke(
 		&Logger::GetInstance().m_logData.m_msgData,	// Object instance
-		&std::list<std::string>::clear,				// Object function
+		&LogBuffer::Clear,							// Object function
 		Logger::GetInstance(),						// Thread to invoke object function
 		milliseconds(50));							// Wait up to 50mS for async invoke
 
@@ -293,5 +396,3326 @@ TEST(Logger_IT, FlushTimeSimplifiedWithLambda)
 	Logger::GetInstance().m_logData.FlushTimeDelegate -= MakeDelegate(FlushTimeLambdaCb);
 }
 
+// Test LogData::Flush only writes records added since the last successful flush
+TEST(Logger_IT, FlushIncremental)
+{
+	const string LOG_STR = "Flush Incremental String";
+
+	{
+		// Protect access to flush results
+		lock_guard<mutex> lock(mtx);
+		flushRecords = 0;
+		flushBytes = 0;
+	}
+
+	// Register for a callback from Logger thread
+	Logger::GetInstance().m_logData.FlushTimeDelegate += MakeDelegate(&FlushTimeCb);
+
+	// Clear the m_msgData buffer on Logger thread
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+
+	// Get the high-water mark before writing
+	auto hwmStart = AsyncInvoke(
+		&Logger::GetInstance().m_logData,
+		&LogData::GetHighWaterMark,
+		Logger::GetInstance(),
+		milliseconds(50));
+
+	// Write 10 lines of log data
+	for (int i = 0; i < 10; i++)
+	{
+		AsyncInvoke(
+			&Logger::GetInstance().m_logData,
+			&LogData::Write,
+			Logger::GetInstance(),
+			milliseconds(50),
+			LOG_STR);
+	}
+
+	// Flush twice. The second flush has nothing new to write.
+	for (int i = 0; i < 2; i++)
+	{
+		auto retVal = AsyncInvoke(
+			&Logger::GetInstance().m_logData,
+			&LogData::Flush,
+			Logger::GetInstance(),
+			milliseconds(100));
+		if (retVal.has_value())
+			EXPECT_TRUE(retVal.value());
+	}
+
+	// Get the high-water mark after flushing
+	auto hwmEnd = AsyncInvoke(
+		&Logger::GetInstance().m_logData,
+		&LogData::GetHighWaterMark,
+		Logger::GetInstance(),
+		milliseconds(50));
+
+	// Check all records were written exactly once
+	if (hwmStart.has_value() && hwmEnd.has_value())
+		EXPECT_EQ(hwmEnd.value() - hwmStart.value(), 10);
+
+	{
+		// Protect access to flush results
+		lock_guard<mutex> lock(mtx);
+
+		// Check the last flush wrote nothing
+		EXPECT_EQ(flushRecords, 0);
+		EXPECT_EQ(flushBytes, 0);
+	}
+
+	// Check flushed records were dropped from memory
+	auto size = AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Size,
+		Logger::GetInstance(),
+		milliseconds(50));
+	if (size.has_value())
+		EXPECT_EQ(size.value(), 0);
+
+	// Unregister from callback
+	Logger::GetInstance().m_logData.FlushTimeDelegate -= MakeDelegate(&FlushTimeCb);
+}
+
+// Test the LogData record buffer read-only view holds each record written
+TEST(Logger_IT, WriteRecordView)
+{
+	// Clear the m_msgData buffer on Logger thread
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+
+	// Write records of varying size, including one larger than a buffer chunk
+	vector<string> records = { "", "Record View String", string(LogBuffer::DEFAULT_CHUNK_SIZE * 2, 'x') };
+	for (const string& record : records)
+	{
+		AsyncInvoke(
+			&Logger::GetInstance().m_logData,
+			&LogData::Write,
+			Logger::GetInstance(),
+			milliseconds(50),
+			record);
+	}
+
+	// Copy the stored records using the read-only iterator view on Logger thread
+	std::function<vector<string>(void)> GetRecords = []() {
+		vector<string> stored;
+		for (std::string_view record : Logger::GetInstance().m_logData.m_msgData)
+			stored.push_back(string(record));
+		return stored;
+	};
+	auto stored = MakeDelegate(GetRecords, Logger::GetInstance(), milliseconds(50)).AsyncInvoke();
+
+	// Check test results
+	EXPECT_TRUE(stored.has_value());
+	if (stored.has_value())
+		EXPECT_EQ(stored.value(), records);
+}
+
+// Test Logger::Write() from multiple threads using the lock-free write queue
+TEST(Logger_IT, WriteLockFree)
+{
+	static const int THREADS = 4;
+	static const int WRITES_PER_THREAD = 250;
+	static atomic<int> writeCount;
+	static SignalThread writeSignal;
+	writeCount = 0;
+
+	// Logger callback handler lambda function invoked from Logger thread context
+	auto WriteCountCb = +[](const string& status) -> void
+	{
+		if (status == "Write success!" && ++writeCount == THREADS * WRITES_PER_THREAD)
+			writeSignal.SetSignal();
+	};
+
+	uint64_t dropCount = Logger::GetInstance().GetDropCount();
+	Logger::GetInstance().SetCallback(WriteCountCb);
+	Logger::GetInstance().SetLockFreeWrite(true);
+
+	// Write from multiple threads concurrently
+	vector<thread> threads;
+	for (int t = 0; t < THREADS; t++)
+	{
+		threads.emplace_back([]() {
+			for (int i = 0; i < WRITES_PER_THREAD; i++)
+				Logger::GetInstance().Write("LoggerTest, WriteLockFree");
+		});
+	}
+	for (thread& t : threads)
+		t.join();
+
+	// Wait for all writes to be processed by the Logger thread
+	bool success = writeSignal.WaitForSignal(2000);
+
+	// Check test results
+	EXPECT_TRUE(success);
+	EXPECT_EQ(writeCount, THREADS * WRITES_PER_THREAD);
+	EXPECT_EQ(Logger::GetInstance().GetDropCount(), dropCount);
+	EXPECT_GE(Logger::GetInstance().GetPeakQueueDepth(), 1);
+
+	// Test cleanup
+	Logger::GetInstance().SetLockFreeWrite(false);
+	Logger::GetInstance().SetCallback(nullptr);
+}
+
+// Test the lock-free write queue overflow policies drop messages when full
+TEST(Logger_IT, WriteLockFreeOverflow)
+{
+	const int OVERFLOW_COUNT = 10;
+
+	Logger::GetInstance().SetLockFreeWrite(true);
+
+	for (auto policy : { Logger::OverflowPolicy::DROP_NEWEST, Logger::OverflowPolicy::DROP_OLDEST })
+	{
+		Logger::GetInstance().SetOverflowPolicy(policy);
+		uint64_t dropCount = Logger::GetInstance().GetDropCount();
+
+		// Block the Logger thread so the write queue is not drained
+		EXPECT_TRUE(BlockLogger());
+
+		// Write more messages than the write queue holds
+		for (size_t i = 0; i < Logger::WRITE_QUEUE_CAPACITY + OVERFLOW_COUNT; i++)
+			Logger::GetInstance().Write("LoggerTest, WriteLockFreeOverflow");
+
+		// Release the Logger thread
+		releaseSignal.SetSignal();
+
+		// Check test results
+		EXPECT_EQ(Logger::GetInstance().GetDropCount() - dropCount, OVERFLOW_COUNT);
+		EXPECT_EQ(Logger::GetInstance().GetPeakQueueDepth(), Logger::WRITE_QUEUE_CAPACITY);
+	}
+
+	// Test cleanup
+	Logger::GetInstance().SetOverflowPolicy(Logger::OverflowPolicy::BLOCK);
+	Logger::GetInstance().SetLockFreeWrite(false);
+}
+
+// Test write messages queued together produce one coalesced status callback
+TEST(Logger_IT, WriteCoalesceStatus)
+{
+	static atomic<int> writeCount;
+	writeCount = 0;
+
+	// Logger callback handler lambda function invoked from Logger thread context
+	auto WriteCountCb = +[](const string& status) -> void
+	{
+		if (status == "Write success!")
+			writeCount++;
+	};
+
+	Logger::GetInstance().SetCallback(WriteCountCb);
+	Logger::GetInstance().SetCoalesceStatus(true);
+
+	// Queue writes while the Logger thread is blocked so they drain as one batch
+	EXPECT_TRUE(BlockLogger());
+	for (int i = 0; i < 100; i++)
+		Logger::GetInstance().Write("LoggerTest, WriteCoalesceStatus");
+	releaseSignal.SetSignal();
+	SyncLogger();
+
+	// Check test results. A timer message may split the batch in two.
+	EXPECT_GE(writeCount, 1);
+	EXPECT_LE(writeCount, 2);
+
+	// Test cleanup
+	Logger::GetInstance().SetCoalesceStatus(false);
+	Logger::GetInstance().SetCallback(nullptr);
+}
+
+// Test the record count flush trigger and the explicit Logger::Flush() call
+TEST(Logger_IT, FlushTrigger)
+{
+	static atomic<int> flushCount;
+	static SignalThread flushSignal;
+	flushCount = 0;
+
+	// Logger callback handler lambda function invoked from Logger thread context
+	auto FlushCountCb = +[](const string& status) -> void
+	{
+		if (status == "Flush success!")
+		{
+			flushCount++;
+			flushSignal.SetSignal();
+		}
+	};
+
+	// Flush only on a record count threshold
+	Logger::FlushTrigger original = Logger::GetInstance().GetFlushTrigger();
+	Logger::FlushTrigger trigger;
+	trigger.maxLatency = milliseconds(0);
+	trigger.maxRecords = 5;
+	Logger::GetInstance().SetFlushTrigger(trigger);
+	Logger::GetInstance().SetCallback(FlushCountCb);
+
+	// Flush data pending from earlier tests
+	Logger::GetInstance().Flush();
+	EXPECT_TRUE(flushSignal.WaitForSignal(500));
+	flushCount = 0;
+
+	// Writes below the threshold do not flush
+	for (int i = 0; i < 4; i++)
+		Logger::GetInstance().Write("LoggerTest, FlushTrigger");
+	EXPECT_FALSE(flushSignal.WaitForSignal(100));
+	EXPECT_EQ(flushCount, 0);
+
+	// Reaching the threshold flushes
+	Logger::GetInstance().Write("LoggerTest, FlushTrigger");
+	EXPECT_TRUE(flushSignal.WaitForSignal(500));
+	EXPECT_EQ(flushCount, 1);
+
+	// An explicit flush request flushes
+	Logger::GetInstance().Write("LoggerTest, FlushTrigger");
+	Logger::GetInstance().Flush();
+	EXPECT_TRUE(flushSignal.WaitForSignal(500));
+	EXPECT_EQ(flushCount, 2);
+
+	auto pending = AsyncInvoke(
+		&Logger::GetInstance().m_logData,
+		&LogData::GetPendingRecords,
+		Logger::GetInstance(),
+		milliseconds(50));
+	if (pending.has_value())
+		EXPECT_EQ(pending.value(), 0);
+
+	// Test cleanup
+	Logger::GetInstance().SetCallback(nullptr);
+	Logger::GetInstance().SetFlushTrigger(original);
+}
+
+// Test a flush swaps the log data buffers so writes continue while the full 
+// buffer is written by the I/O thread
+TEST(Logger_IT, FlushDoubleBuffer)
+{
+	static atomic<int> flushCount;
+	static SignalThread flushSignal;
+	flushCount = 0;
+
+	// Logger callback handler lambda function invoked from Logger thread context
+	auto FlushCountCb = +[](const string& status) -> void
+	{
+		if (status == "Flush success!")
+		{
+			flushCount++;
+			flushSignal.SetSignal();
+		}
+	};
+	Logger::GetInstance().SetCallback(FlushCountCb);
+
+	// Flush data pending from earlier tests
+	Logger::GetInstance().Flush();
+	EXPECT_TRUE(flushSignal.WaitForSignal(500));
+	flushCount = 0;
+
+	auto hwmBefore = AsyncInvoke(
+		&Logger::GetInstance().m_logData,
+		&LogData::GetHighWaterMark,
+		Logger::GetInstance(),
+		milliseconds(50));
+
+	// Start a flush then write while the flush is in progress
+	std::function<size_t(void)> FlushAndWriteFunc = []() -> size_t {
+		LogData& logData = Logger::GetInstance().m_logData;
+		for (int i = 0; i < 3; i++)
+			logData.Write("LoggerTest, FlushDoubleBuffer");
+		Logger::GetInstance().FlushLogData();
+		EXPECT_TRUE(logData.IsFlushing());
+		EXPECT_EQ(logData.GetPendingRecords(), 0);
+
+		// Writes go to the active buffer while the I/O thread writes
+		logData.Write("LoggerTest, FlushDoubleBuffer");
+		return logData.GetPendingRecords();
+	};
+	auto pending = MakeDelegate(FlushAndWriteFunc, Logger::GetInstance(), milliseconds(100)).AsyncInvoke();
+	EXPECT_TRUE(pending.has_value());
+	if (pending.has_value())
+		EXPECT_EQ(pending.value(), 1);
+
+	// Completion is reported through the status callback
+	EXPECT_TRUE(flushSignal.WaitForSignal(500));
+	EXPECT_EQ(flushCount, 1);
+
+	auto hwmAfter = AsyncInvoke(
+		&Logger::GetInstance().m_logData,
+		&LogData::GetHighWaterMark,
+		Logger::GetInstance(),
+		milliseconds(50));
+	EXPECT_TRUE(hwmBefore.has_value() && hwmAfter.has_value());
+	if (hwmBefore.has_value() && hwmAfter.has_value())
+		EXPECT_EQ(hwmAfter.value(), hwmBefore.value() + 3);
+
+	// Test cleanup
+	Logger::GetInstance().Flush();
+	EXPECT_TRUE(flushSignal.WaitForSignal(500));
+	Logger::GetInstance().SetCallback(nullptr);
+}
+
+// Test a structured write is stored as a binary record and rendered to text
+TEST(Logger_IT, WriteStructured)
+{
+	static const LogFormat FMT_SENSOR{ 1, "Sensor %s: %d readings, %.2f%% ok, id 0x%04x" };
+
+	// Render a binary record to text
+	std::string record;
+	LogRecord::Encode(record, FMT_SENSOR, "temp", 42, 99.5, 0xbeefu);
+	EXPECT_TRUE(LogRecord::IsBinary(record));
+	EXPECT_EQ(LogRecord::GetFormatId(record), 1);
+	std::string text;
+	LogRecord::Render(record, text);
+	EXPECT_EQ(text, "Sensor temp: 42 readings, 99.50% ok, id 0xbeef");
+
+	// Missing arguments render the conversion unchanged
+	record.clear();
+	LogRecord::Encode(record, FMT_SENSOR, std::string("temp"));
+	text.clear();
+	LogRecord::Render(record, text);
+	EXPECT_EQ(text, "Sensor temp: %d readings, %.2f% ok, id 0x%04x");
+
+	// Write a structured message using public API
+	Logger::GetInstance().Write(FMT_SENSOR, "LoggerTest", 1, 2.0, 3u);
+
+	// The Logger thread stores the binary record until flushed
+	std::function<bool(void)> CheckRecordFunc = []() -> bool {
+		bool found = false;
+		for (std::string_view r : Logger::GetInstance().m_logData.m_msgData)
+			found |= LogRecord::IsBinary(r) && LogRecord::GetFormatId(r) == 1;
+		return found;
+	};
+	auto found = MakeDelegate(CheckRecordFunc, Logger::GetInstance(), milliseconds(100)).AsyncInvoke();
+	EXPECT_TRUE(found.has_value());
+	if (found.has_value())
+		EXPECT_TRUE(found.value());
+
+	// Test cleanup
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+}
+
+// Test the memory-mapped segment backend rolls records over into new segments
+TEST(Logger_IT, SegmentBackend)
+{
+	static const size_t SEGMENT_SIZE = 4096;
+	static const int RECORDS = 300;
+	static vector<string> segments;
+	segments.clear();
+
+	// Write records across several segments on the Logger thread
+	std::function<bool(void)> SegmentWriteFunc = []() -> bool {
+		LogData& logData = Logger::GetInstance().m_logData;
+		logData.m_msgData.Clear();
+		logData.SetBackend(LogWriter::Backend::SEGMENT, SEGMENT_SIZE);
+		bool success = true;
+		for (int i = 0; i < RECORDS; i++)
+		{
+			logData.Write("LoggerTest, SegmentBackend record " + to_string(i));
+			if (i % 10 == 9)
+			{
+				success &= logData.Flush();
+				const string& name = logData.m_writer.m_segment.GetFileName();
+				if (segments.empty() || segments.back() != name)
+					segments.push_back(name);
+			}
+		}
+
+		// Restoring the file backend closes and truncates the open segment
+		logData.SetBackend(LogWriter::Backend::FILE);
+		return success;
+	};
+	auto retVal = MakeDelegate(SegmentWriteFunc, Logger::GetInstance(), milliseconds(1000)).AsyncInvoke();
+	EXPECT_TRUE(retVal.has_value());
+	if (retVal.has_value())
+		EXPECT_TRUE(retVal.value());
+
+	// Records fill multiple segments
+	EXPECT_GE(segments.size(), 2);
+
+	// The segments hold all records in order
+	string expected;
+	for (int i = 0; i < RECORDS; i++)
+		expected += "LoggerTest, SegmentBackend record " + to_string(i) + "\n";
+	Logger::GetInstance().m_logData.m_writer.m_compressor.WaitIdle();
+	string actual;
+	for (const string& name : segments)
+		EXPECT_TRUE(ReadLogFile(name, actual));
+	EXPECT_EQ(actual, expected);
+
+	// Test cleanup
+	for (const string& name : segments)
+		RemoveLogFile(name);
+}
+
+// Test the io_uring log file sink writes across its registered buffers in order
+TEST(Logger_IT, UringBackend)
+{
+	static const int RECORDS = 3000;
+	static const char* FILE_NAME = "LoggerUring.txt";
+	if (!LogUring::IsSupported())
+		return;
+
+	// Records fill several buffers per flush and carry over between flushes
+	string expected;
+	remove(FILE_NAME);
+	{
+		LogUring uring;
+		ASSERT_TRUE(uring.Open(FILE_NAME, 4096));
+		uring.SetSyncPolicy(LogFile::SyncPolicy::PER_FLUSH);
+		for (int i = 0; i < RECORDS; i++)
+		{
+			string record = "LoggerTest, UringBackend record " + to_string(i) + "\n";
+			expected += record;
+			EXPECT_TRUE(uring.Write(record.data(), record.size()));
+			if (i % 500 == 499)
+				EXPECT_TRUE(uring.Flush());
+		}
+		EXPECT_EQ(uring.GetSize(), expected.size());
+	}
+	string actual;
+	EXPECT_TRUE(ReadLogFile(FILE_NAME, actual));
+	EXPECT_EQ(actual, expected);
+
+	// A reopened file is appended to
+	{
+		LogUring uring;
+		ASSERT_TRUE(uring.Open(FILE_NAME));
+		EXPECT_EQ(uring.GetSize(), expected.size());
+		EXPECT_TRUE(uring.Write("appended\n", 9));
+	}
+	actual.clear();
+	EXPECT_TRUE(ReadLogFile(FILE_NAME, actual));
+	EXPECT_EQ(actual, expected + "appended\n");
+	remove(FILE_NAME);
+
+	// LogData writes its log file through the backend
+	std::function<bool(void)> UringWriteFunc = []() -> bool {
+		LogData& logData = Logger::GetInstance().m_logData;
+		logData.SetBackend(LogWriter::Backend::URING);
+		bool success = logData.m_writer.GetBackend() == LogWriter::Backend::URING;
+		logData.Write("LoggerTest, UringBackend LogData");
+		success &= logData.Flush();
+		logData.SetBackend(LogWriter::Backend::FILE);
+		return success;
+	};
+	auto retVal = MakeDelegate(UringWriteFunc, Logger::GetInstance(), milliseconds(1000)).AsyncInvoke();
+	EXPECT_TRUE(retVal.has_value());
+	if (retVal.has_value())
+		EXPECT_TRUE(retVal.value());
+	actual.clear();
+	EXPECT_TRUE(ReadLogFile("LogData.txt", actual));
+	EXPECT_NE(actual.find("LoggerTest, UringBackend LogData\n"), string::npos);
+}
+
+// Test the memory backend captures flushed records without writing the log file
+TEST(Logger_IT, MemoryBackend)
+{
+	static const int RECORDS = 3000;
+
+	// Flush records in several windows into memory on the Logger thread
+	std::function<bool(void)> MemoryWriteFunc = []() -> bool {
+		LogData& logData = Logger::GetInstance().m_logData;
+		logData.m_msgData.Clear();
+		logData.SetBackend(LogWriter::Backend::MEMORY);
+		logData.ClearMemory();
+		bool success = true;
+		for (int i = 0; i < RECORDS; i++)
+		{
+			logData.Write("LoggerTest, MemoryBackend record " + to_string(i));
+			if (i % 100 == 99)
+				success &= logData.Flush();
+		}
+		logData.SetBackend(LogWriter::Backend::FILE);
+		return success;
+	};
+	auto retVal = MakeDelegate(MemoryWriteFunc, Logger::GetInstance(), milliseconds(1000)).AsyncInvoke();
+	EXPECT_TRUE(retVal.has_value());
+	if (retVal.has_value())
+		EXPECT_TRUE(retVal.value());
+
+	// The records are read directly, in order, without a lock
+	const LogMemory* memory = Logger::GetInstance().m_logData.GetMemory();
+	ASSERT_TRUE(memory != nullptr);
+	ASSERT_EQ(memory->Size(), (size_t)RECORDS);
+	bool inOrder = true;
+	for (int i = 0; i < RECORDS; i++)
+		inOrder &= memory->Get(i) == "LoggerTest, MemoryBackend record " + to_string(i);
+	EXPECT_TRUE(inOrder);
+	EXPECT_TRUE(memory->Contains("MemoryBackend record 2999"));
+	EXPECT_EQ(memory->GetDropped(), 0u);
+
+	// Nothing reached the log file
+	string actual;
+	ReadLogFile("LogData.txt", actual);
+	EXPECT_EQ(actual.find("LoggerTest, MemoryBackend"), string::npos);
+}
+
+// Test the vectored and direct write modes produce the same file as buffered writes
+TEST(Logger_IT, FlushWriteModes)
+{
+	static const int RECORDS = 5000;
+	static const char* FILE_NAME = "LoggerWriteMode.txt";
+
+	for (LogFile::WriteMode mode : { LogFile::WriteMode::BUFFERED, LogFile::WriteMode::VECTORED, LogFile::WriteMode::DIRECT })
+	{
+		// Stable records are referenced, copied records are not, and flushes 
+		// leave a partial block behind
+		vector<string> records;
+		string expected;
+		for (int i = 0; i < RECORDS; i++)
+		{
+			records.push_back("LoggerTest, FlushWriteModes record " + to_string(i) + "\n");
+			expected += records.back();
+		}
+		remove(FILE_NAME);
+		{
+			LogFile file;
+			file.SetWriteMode(mode);
+			file.SetPreallocation(1024 * 1024);
+			ASSERT_TRUE(file.Open(FILE_NAME, 16 * 1024));
+			for (int i = 0; i < RECORDS; i++)
+			{
+				const string& record = records[i];
+				EXPECT_TRUE(i % 3 ? file.WriteStable(record.data(), record.size()) : file.Write(record));
+				if (i % 700 == 699)
+					EXPECT_TRUE(file.Flush(i % 1400 == 1399));
+			}
+			EXPECT_TRUE(file.Flush());
+			EXPECT_EQ(file.GetSize(), expected.size());
+		}
+		string actual;
+		EXPECT_TRUE(ReadLogFile(FILE_NAME, actual));
+		EXPECT_EQ(actual.size(), expected.size()) << (int)mode;
+		EXPECT_TRUE(actual == expected) << (int)mode;
+
+		// A reopened file continues after its partial last block
+		{
+			LogFile file;
+			file.SetWriteMode(mode);
+			ASSERT_TRUE(file.Open(FILE_NAME));
+			EXPECT_TRUE(file.Write("appended\n", 9));
+		}
+		actual.clear();
+		EXPECT_TRUE(ReadLogFile(FILE_NAME, actual));
+		EXPECT_TRUE(actual == expected + "appended\n") << (int)mode;
+	}
+	remove(FILE_NAME);
+
+	// LogData writes its log file through the selected mode
+	std::function<bool(void)> WriteModeFunc = []() -> bool {
+		LogData& logData = Logger::GetInstance().m_logData;
+		logData.SetWriteMode(LogFile::WriteMode::VECTORED, 1024 * 1024);
+		logData.Write("LoggerTest, FlushWriteModes LogData");
+		bool success = logData.Flush();
+		success &= logData.m_writer.GetWriteMode() == LogFile::WriteMode::VECTORED;
+		logData.SetWriteMode(LogFile::WriteMode::BUFFERED);
+		return success;
+	};
+	auto retVal = MakeDelegate(WriteModeFunc, Logger::GetInstance(), milliseconds(1000)).AsyncInvoke();
+	EXPECT_TRUE(retVal.has_value());
+	if (retVal.has_value())
+		EXPECT_TRUE(retVal.value());
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LogData.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, FlushWriteModes LogData\n"), string::npos);
+}
+
+// Test the log file rotates at the size limit and rotated files are compressed
+TEST(Logger_IT, RotateLogFile)
+{
+	static vector<string> rotated;
+	rotated.clear();
+
+	// Rotate the log file on the Logger thread by writing past the size limit
+	std::function<bool(void)> RotateFunc = []() -> bool {
+		LogData& logData = Logger::GetInstance().m_logData;
+		LogWriter& writer = logData.m_writer;
+		logData.m_msgData.Clear();
+
+		// Start from an empty log file
+		bool success = logData.Flush();
+		writer.RotateLogFile();
+
+		LogWriter::RotationPolicy policy;
+		policy.maxBytes = 256;
+		writer.SetRotationPolicy(policy);
+		for (int i = 0; i < 3; i++)
+		{
+			for (int j = 0; j < 10; j++)
+				logData.Write("LoggerTest, RotateLogFile " + to_string(i));
+			success &= logData.Flush();
+		}
+		writer.SetRotationPolicy(LogWriter::RotationPolicy());
+		return success;
+	};
+	auto retVal = MakeDelegate(RotateFunc, Logger::GetInstance(), milliseconds(1000)).AsyncInvoke();
+	EXPECT_TRUE(retVal.has_value());
+	if (retVal.has_value())
+		EXPECT_TRUE(retVal.value());
+
+	// Each flush exceeded the size limit so each flush window is its own file.
+	// The newest rotations hold the windows in order.
+	LogCompressor& compressor = Logger::GetInstance().m_logData.m_writer.m_compressor;
+	compressor.WaitIdle();
+	vector<string> files;
+	for (int index = 1; index < 1000000; index++)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "LogData.txt.%06d", index);
+		string contents;
+		if (!ReadLogFile(name, contents))
+			break;
+		files.push_back(name);
+		rotated.push_back(contents);
+	}
+	EXPECT_GE(rotated.size(), 3);
+	if (rotated.size() >= 3)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			string expected;
+			for (int j = 0; j < 10; j++)
+				expected += "LoggerTest, RotateLogFile " + to_string(i) + "\n";
+			EXPECT_EQ(rotated[rotated.size() - 3 + i], expected);
+		}
+	}
+	if (LogCompressor::IsSupported())
+		EXPECT_GE(compressor.GetCompressedCount(), 3);
+
+	// Test cleanup
+	for (const string& name : files)
+		RemoveLogFile(name);
+}
+
+// Test per-thread staging buffers keep per-thread order and are handed off when
+// full, when the owning thread exits and when the flush latency passes
+TEST(Logger_IT, WriteStaged)
+{
+	// Start with no pending log data and no latency flush
+	Logger::FlushTrigger original = Logger::GetInstance().GetFlushTrigger();
+	Logger::FlushTrigger trigger;
+	trigger.maxLatency = milliseconds(0);
+	Logger::GetInstance().SetFlushTrigger(trigger);
+	SyncLogger();
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+
+	Logger::GetInstance().SetStagedWrite(true, 4);
+	Logger::GetInstance().SetSequenceNumbers(true);
+
+	// Each thread hands off full buffers then the remainder when it exits
+	auto WriteFunc = [](int thread) {
+		for (int i = 0; i < 10; i++)
+			Logger::GetInstance().Write("T" + to_string(thread) + " " + to_string(i));
+	};
+	std::thread t1(WriteFunc, 1);
+	std::thread t2(WriteFunc, 2);
+	t1.join();
+	t2.join();
+	SyncLogger();
+
+	auto GetRecordsFunc = std::function<vector<string>(void)>([]() -> vector<string> {
+		vector<string> records;
+		for (std::string_view record : Logger::GetInstance().m_logData.m_msgData)
+			records.emplace_back(record);
+		return records;
+	});
+	auto records = MakeDelegate(GetRecordsFunc, Logger::GetInstance(), milliseconds(100)).AsyncInvoke();
+	EXPECT_TRUE(records.has_value());
+	if (records.has_value())
+	{
+		EXPECT_EQ(records->size(), 20);
+
+		// Records keep per-thread order and sequence numbers are unique
+		int next[3] = { 0, 0, 0 };
+		set<uint64_t> sequences;
+		for (const string& record : *records)
+		{
+			unsigned long long seq = 0;
+			int thread = 0, i = 0;
+			EXPECT_EQ(sscanf(record.c_str(), "#%llu T%d %d", &seq, &thread, &i), 3);
+			if (thread < 1 || thread > 2)
+				continue;
+			EXPECT_EQ(i, next[thread]);
+			next[thread] = i + 1;
+			sequences.insert(seq);
+		}
+		EXPECT_EQ(sequences.size(), 20);
+	}
+
+	// A partly filled buffer is collected once the flush latency passes
+	trigger.maxLatency = milliseconds(50);
+	trigger.maxRecords = 1000;
+	Logger::GetInstance().SetFlushTrigger(trigger);
+	Logger::GetInstance().SetSequenceNumbers(false);
+	static SignalThread writeSignal;
+	auto WriteSuccessCb = +[](const string& status) -> void
+	{
+		if (status == "Write success!")
+			writeSignal.SetSignal();
+	};
+	Logger::GetInstance().SetCallback(WriteSuccessCb);
+	Logger::GetInstance().Write("LoggerTest, WriteStaged");
+
+	// The record is written to the log data once collected by the Logger thread
+	bool collected = writeSignal.WaitForSignal(500);
+	Logger::GetInstance().SetCallback(nullptr);
+	EXPECT_TRUE(collected);
+
+	// Test cleanup
+	Logger::GetInstance().SetStagedWrite(false);
+	Logger::GetInstance().SetFlushTrigger(original);
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+}
+
+// Test messages below a component level threshold are discarded without
+// evaluating the message arguments
+TEST(Logger_IT, WriteLevel)
+{
+	static const LogComponent COMPONENT = 3;
+	static atomic<int> writeCount;
+	static SignalThread writeSignal;
+	writeCount = 0;
+
+	auto WriteCountCb = +[](const string& status) -> void
+	{
+		if (status == "Write success!")
+		{
+			writeCount++;
+			writeSignal.SetSignal();
+		}
+	};
+	Logger::GetInstance().SetCallback(WriteCountCb);
+	Logger::GetInstance().SetLevel(COMPONENT, LogLevel::Warning);
+
+	EXPECT_FALSE(Logger::GetInstance().IsEnabled(LogLevel::Info, COMPONENT));
+	EXPECT_TRUE(Logger::GetInstance().IsEnabled(LogLevel::Warning, COMPONENT));
+	EXPECT_TRUE(Logger::GetInstance().IsEnabled(LogLevel::Info, 0));
+	EXPECT_FALSE(Logger::GetInstance().IsEnabled(LogLevel::Off, 0));
+	EXPECT_FALSE(Logger::GetInstance().IsEnabled(LogLevel::Fatal, Logger::MAX_COMPONENTS));
+
+	// Arguments of a discarded message are not evaluated
+	int evaluated = 0;
+	auto BuildMsg = [&evaluated]() { evaluated++; return string("LoggerTest, WriteLevel"); };
+	LOG_WRITE(LogLevel::Debug, COMPONENT, BuildMsg());
+	Logger::GetInstance().Write(LogLevel::Info, COMPONENT, "LoggerTest, WriteLevel");
+	EXPECT_EQ(evaluated, 0);
+	EXPECT_FALSE(writeSignal.WaitForSignal(100));
+
+	// Messages at or above the threshold are written
+	LOG_WRITE(LogLevel::Error, COMPONENT, BuildMsg());
+	EXPECT_EQ(evaluated, 1);
+	EXPECT_TRUE(writeSignal.WaitForSignal(500));
+	static const LogFormat FMT_LEVEL{ 2, "LoggerTest, WriteLevel %d" };
+	Logger::GetInstance().Write(LogLevel::Warning, COMPONENT, FMT_LEVEL, 1);
+	EXPECT_TRUE(writeSignal.WaitForSignal(500));
+	EXPECT_EQ(writeCount, 2);
+
+	// Test cleanup
+	Logger::GetInstance().SetCallback(nullptr);
+	Logger::GetInstance().SetLevel(COMPONENT, LogLevel::Trace);
+}
+
+// Test the message queue capacity limit and the Logger counters
+TEST(Logger_IT, Backpressure)
+{
+	Logger& logger = Logger::GetInstance();
+
+	// Drop messages beyond the capacity
+	Logger::Stats before = logger.GetStats();
+	EXPECT_TRUE(BlockLogger());
+	logger.SetQueueCapacity(5, Logger::BackpressurePolicy::DROP);
+	for (int i = 0; i < 10; i++)
+		logger.Write("LoggerTest, Backpressure");
+	Logger::Stats stats = logger.GetStats();
+	EXPECT_EQ(stats.queueDepth, 5);
+	EXPECT_GE(stats.peakQueueDepth, 5);
+	EXPECT_EQ(stats.enqueued - before.enqueued, 5);
+	EXPECT_EQ(stats.dropped - before.dropped, 5);
+	releaseSignal.SetSignal();
+	SyncLogger();
+	EXPECT_EQ(logger.GetStats().queueDepth, 0);
+
+	// Keep one in every two messages beyond the capacity
+	before = logger.GetStats();
+	EXPECT_TRUE(BlockLogger());
+	logger.SetQueueCapacity(2, Logger::BackpressurePolicy::SAMPLE, 2);
+	for (int i = 0; i < 10; i++)
+		logger.Write("LoggerTest, Backpressure");
+	stats = logger.GetStats();
+	EXPECT_EQ(stats.enqueued - before.enqueued, 6);
+	EXPECT_EQ(stats.dropped - before.dropped, 4);
+	releaseSignal.SetSignal();
+	SyncLogger();
+
+	// Block the writer until the Logger thread takes the queue
+	EXPECT_TRUE(BlockLogger());
+	logger.SetQueueCapacity(2, Logger::BackpressurePolicy::BLOCK);
+	atomic<bool> done(false);
+	std::thread writer([&done]() {
+		for (int i = 0; i < 3; i++)
+			Logger::GetInstance().Write("LoggerTest, Backpressure");
+		done = true;
+	});
+	this_thread::sleep_for(milliseconds(50));
+	EXPECT_FALSE(done);
+	releaseSignal.SetSignal();
+	writer.join();
+	EXPECT_TRUE(done);
+	logger.SetQueueCapacity(0);
+	SyncLogger();
+
+	// A flush updates the flushed bytes and the latency histogram
+	static SignalThread flushSignal;
+	auto FlushCb = +[](const string& status) -> void
+	{
+		if (status == "Flush success!")
+			flushSignal.SetSignal();
+	};
+	before = logger.GetStats();
+	logger.SetCallback(FlushCb);
+	logger.Write("LoggerTest, Backpressure");
+	logger.Flush();
+	EXPECT_TRUE(flushSignal.WaitForSignal(500));
+	logger.SetCallback(nullptr);
+	stats = logger.GetStats();
+	EXPECT_GT(stats.flushedBytes, before.flushedBytes);
+	uint64_t flushes = 0;
+	for (size_t i = 0; i < Logger::LATENCY_BUCKETS; i++)
+		flushes += stats.flushLatency[i] - before.flushLatency[i];
+	EXPECT_GE(flushes, 1);
+}
+
+// Test the emergency flush writes unflushed log data to the crash file, and
+// leaves out the message queue since a crash may interrupt a thread holding it
+TEST(Logger_IT, EmergencyFlush)
+{
+	// Hold a record within the log data
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData,
+		&LogData::Write,
+		Logger::GetInstance(),
+		milliseconds(50),
+		"LoggerTest, EmergencyFlush logged");
+
+	// Hold a message within the message queue
+	EXPECT_TRUE(BlockLogger());
+	Logger::GetInstance().Write("LoggerTest, EmergencyFlush queued");
+
+	string before;
+	ReadLogFile("LogData.crash.txt", before);
+	Logger::GetInstance().m_emergencyFlushed = false;
+	Logger::EmergencyFlush();
+
+	// Only the first emergency flush writes
+	Logger::EmergencyFlush();
+
+	string after;
+	EXPECT_TRUE(ReadLogFile("LogData.crash.txt", after));
+	EXPECT_EQ(after.substr(min(before.size(), after.size())), "LoggerTest, EmergencyFlush logged\n");
+
+	// Test cleanup
+	remove("LogData.crash.txt");
+	Logger::GetInstance().m_emergencyFlushed = false;
+	releaseSignal.SetSignal();
+	SyncLogger();
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+}
+
+TEST(Logger_IT, WriteDurable)
+{
+	// Durable writes queued together share one flush window
+	EXPECT_TRUE(BlockLogger());
+	vector<future<bool>> futures;
+	for (int i = 0; i < 3; i++)
+		futures.push_back(Logger::GetInstance().WriteDurable("LoggerTest, WriteDurable " + to_string(i)));
+	releaseSignal.SetSignal();
+
+	for (auto& f : futures)
+	{
+		EXPECT_EQ(f.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(f.get());
+	}
+
+	// The durable records are on disk once the futures complete
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LogData.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, WriteDurable 2\n"), string::npos);
+
+	// Test cleanup
+	SyncLogger();
+}
+
+TEST(Logger_IT, DispatchBatch)
+{
+	// Collect calls from the batch invoked on the Logger thread
+	vector<int> calls;
+	std::thread::id threadId;
+	std::function<void(int)> CallFunc = [&calls, &threadId](int call) {
+		calls.push_back(call);
+		threadId = this_thread::get_id();
+	};
+
+	EXPECT_TRUE(BlockLogger());
+	{
+		DispatchBatch batch(Logger::GetInstance());
+		auto delegate = MakeDelegate(CallFunc, batch);
+		for (int i = 0; i < 5; i++)
+			delegate(i);
+		EXPECT_EQ(batch.Size(), 5u);
+	}
+	releaseSignal.SetSignal();
+	SyncLogger();
+
+	// Batched calls are invoked in order on the Logger thread
+	EXPECT_EQ(calls, vector<int>({ 0, 1, 2, 3, 4 }));
+	EXPECT_EQ(threadId, Logger::GetInstance().GetThreadId());
+}
+
+// Test each spinning wait strategy wakes the Logger thread for queued and lock-free writes
+TEST(Logger_IT, WaitStrategy)
+{
+	static const int WRITES = 50;
+	static atomic<int> writeCount;
+	static SignalThread writeSignal;
+
+	auto WriteCountCb = +[](const string& status) -> void
+	{
+		if (status == "Write success!")
+		{
+			++writeCount;
+			writeSignal.SetSignal();
+		}
+	};
+	Logger::GetInstance().SetCallback(WriteCountCb);
+
+	for (WaitPolicy policy : { WaitPolicy::SPIN_THEN_BLOCK, WaitPolicy::BUSY_POLL, WaitPolicy::ADAPTIVE })
+	{
+		WaitStrategy strategy;
+		strategy.policy = policy;
+		strategy.spinTime = microseconds(200);
+		Logger::GetInstance().SetWaitStrategy(strategy);
+		EXPECT_EQ(Logger::GetInstance().GetWaitStrategy().policy, policy);
+
+		// Alternate queued and lock-free writes with idle gaps on both sides of the spin time
+		writeCount = 0;
+		for (int i = 0; i < WRITES; i++)
+		{
+			Logger::GetInstance().SetLockFreeWrite(i % 2 == 1);
+			Logger::GetInstance().Write("LoggerTest, WaitStrategy");
+			this_thread::sleep_for(microseconds(i % 5 == 0 ? 1000 : 20));
+		}
+		EXPECT_TRUE(writeSignal.WaitForCount(WRITES, 2000));
+		EXPECT_EQ(writeCount, WRITES);
+	}
+
+	// Test cleanup
+	Logger::GetInstance().SetWaitStrategy(WaitStrategy());
+	Logger::GetInstance().SetLockFreeWrite(false);
+	Logger::GetInstance().SetCallback(nullptr);
+}
+
+// Test the Write() and LogData::Write latency budgets
+TEST(Logger_IT, WriteLatencyBudget)
+{
+	// Round trip of a LogData::Write call on the Logger thread
+	PerfResult logDataWrite = AsyncInvokeRepeated(1000,
+		&Logger::GetInstance().m_logData,
+		&LogData::Write,
+		Logger::GetInstance(),
+		milliseconds(50),
+		"LoggerTest, WriteLatencyBudget");
+	EXPECT_EQ(logDataWrite.count, 1000u);
+	EXPECT_LATENCY_P99_LE(logDataWrite, milliseconds(5));
+	EXPECT_THROUGHPUT_GE(logDataWrite, 1000);
+
+	// Logger::Write() only queues the message so it never waits for the Logger thread
+	PerfResult write = MeasureRepeated(1000, []() {
+		Logger::GetInstance().Write("LoggerTest, WriteLatencyBudget");
+	});
+	EXPECT_LATENCY_P99_LE(write, milliseconds(1));
+	EXPECT_THROUGHPUT_GE(write, 10000);
+
+	// Test cleanup
+	SyncLogger();
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+}
+
+// Test pipelined LogData::Write calls on the Logger thread
+TEST(Logger_IT, WriteMany)
+{
+	static const size_t WRITES = 2000;
+
+	// Clear the m_msgData buffer on Logger thread
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+
+	// Issue every call then wait for all of them up to 2 seconds
+	auto results = AsyncInvokeMany(WRITES,
+		&Logger::GetInstance().m_logData,
+		&LogData::Write,
+		Logger::GetInstance(),
+		milliseconds(2000),
+		"LoggerTest, WriteMany");
+
+	// Check that every LogData::Write completed
+	EXPECT_EQ(results.size(), WRITES);
+	EXPECT_EQ(count_if(results.begin(), results.end(), [](const auto& result) { return result.has_value(); }), 
+		(ptrdiff_t)WRITES);
+
+	// Test cleanup
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+}
+
+// Sink collecting records in memory. A delay per record simulates a slow 
+// network sink.
+class MemorySink : public LogSink
+{
+public:
+	MemorySink(const string& name, size_t maxRecords, milliseconds delay) :
+		LogSink(name, maxRecords), m_delay(delay) { }
+	~MemorySink() override { Stop(); }
+
+	// Only read once the sink is stopped
+	vector<string> records;
+
+protected:
+	bool WriteRecord(string_view record) override
+	{
+		if (m_delay.count() > 0)
+			this_thread::sleep_for(m_delay);
+		if (record.find("LoggerTest, SinkFanOut") != string_view::npos)
+			records.emplace_back(record);
+		return true;
+	}
+
+private:
+	milliseconds m_delay;
+};
+
+// Test records fan out to every sink and a slow sink does not delay the others
+TEST(Logger_IT, SinkFanOut)
+{
+	static const int BATCHES = 5;
+	static const int WRITES = 10;
+
+	auto fastSink = make_shared<MemorySink>("FastSink", LogSink::DEFAULT_MAX_RECORDS, milliseconds(0));
+	auto slowSink = make_shared<MemorySink>("SlowSink", WRITES, milliseconds(20));
+	Logger::GetInstance().AddSink(fastSink);
+	Logger::GetInstance().AddSink(slowSink);
+
+	vector<string> expected;
+	for (int b = 0; b < BATCHES; b++)
+	{
+		for (int i = 0; i < WRITES; i++)
+		{
+			expected.push_back("LoggerTest, SinkFanOut " + to_string(b) + " " + to_string(i));
+			Logger::GetInstance().Write(expected.back());
+		}
+		Logger::GetInstance().Flush();
+	}
+
+	// The fast sink receives every record while the slow sink is still busy
+	auto start = steady_clock::now();
+	while (fastSink->GetStats().written < (uint64_t)(BATCHES * WRITES) && steady_clock::now() - start < seconds(2))
+		this_thread::sleep_for(milliseconds(1));
+	EXPECT_GE(fastSink->GetStats().written, (uint64_t)(BATCHES * WRITES));
+	EXPECT_EQ(fastSink->GetStats().dropped, 0u);
+
+	// The slow sink bounded buffer drops the batches it cannot hold
+	EXPECT_GT(slowSink->GetStats().dropped, 0u);
+
+	// Removing a sink writes its queued records before it stops
+	Logger::GetInstance().RemoveSink(fastSink);
+	Logger::GetInstance().RemoveSink(slowSink);
+	EXPECT_EQ(fastSink->records, expected);
+	EXPECT_EQ(slowSink->GetStats().queued, 0u);
+	EXPECT_EQ(slowSink->records.size() + slowSink->GetStats().dropped, expected.size());
+
+	// Test cleanup
+	SyncLogger();
+}
+
+// Test messages are stamped at write time and rendered as UTC time when flushed
+TEST(Logger_IT, WriteTimestamp)
+{
+	Logger::GetInstance().SetTimestamps(true);
+	auto before = system_clock::now();
+	auto durable = Logger::GetInstance().WriteDurable("LoggerTest, WriteTimestamp");
+	Logger::GetInstance().SetTimestamps(false);
+	EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+	EXPECT_TRUE(durable.get());
+
+	// "YYYY-MM-DDTHH:MM:SS.uuuuuuZ " precedes the message
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LogData.txt", contents));
+	size_t pos = contents.rfind("Z LoggerTest, WriteTimestamp\n");
+	ASSERT_NE(pos, string::npos);
+	ASSERT_GE(pos, 26u);
+	string stamp = contents.substr(pos - 26, 27);
+	EXPECT_EQ(stamp[4], '-');
+	EXPECT_EQ(stamp[10], 'T');
+	EXPECT_EQ(stamp[19], '.');
+
+	// The stamp matches the system clock to the minute before or after the write
+	auto ToMinute = [](system_clock::time_point time) {
+		time_t t = system_clock::to_time_t(time);
+		tm utc;
+#ifdef WIN32
+		gmtime_s(&utc, &t);
+#else
+		gmtime_r(&t, &utc);
+#endif
+		char minute[32];
+		strftime(minute, sizeof(minute), "%Y-%m-%dT%H:%M", &utc);
+		return string(minute);
+	};
+	string minute = stamp.substr(0, 16);
+	EXPECT_TRUE(minute == ToMinute(before) || minute == ToMinute(system_clock::now())) << stamp;
+
+	// Ticks within one second share the cached prefix
+	LogTimestamp::Formatter formatter;
+	string first, second;
+	uint64_t tick = LogTimestamp::Now();
+	formatter.AppendTime(tick, first);
+	formatter.AppendTime(tick, second);
+	EXPECT_EQ(first, second);
+}
+
+// Test repeated messages collapse and a message storm is rate limited
+TEST(Logger_IT, LogStorm)
+{
+	static const int REPEATS = 1000;
+
+	// Consecutive identical messages are written once followed by the repeat count
+	Logger::GetInstance().SetCollapseRepeats(true);
+	uint64_t collapsed = Logger::GetInstance().GetStats().collapsed;
+	for (int i = 0; i < REPEATS; i++)
+		Logger::GetInstance().Write("LoggerTest, LogStorm repeat");
+	auto durable = Logger::GetInstance().WriteDurable("LoggerTest, LogStorm collapsed");
+	EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+	Logger::GetInstance().SetCollapseRepeats(false);
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LogData.txt", contents));
+	size_t pos = contents.find("LoggerTest, LogStorm repeat\n");
+	ASSERT_NE(pos, string::npos);
+	EXPECT_EQ(contents.find("LoggerTest, LogStorm repeat\n", pos + 1), string::npos);
+	EXPECT_NE(contents.find("Last message repeated " + to_string(REPEATS - 1) + " times\nLoggerTest, LogStorm collapsed\n"), 
+		string::npos);
+	EXPECT_EQ(Logger::GetInstance().GetStats().collapsed - collapsed, (uint64_t)(REPEATS - 1));
+
+	// A storm beyond the burst is discarded before it is queued
+	Logger::GetInstance().SetRateLimit(10, 10);
+	uint64_t limited = Logger::GetInstance().GetStats().rateLimited;
+	auto start = steady_clock::now();
+	for (int i = 0; i < REPEATS * 10; i++)
+		Logger::GetInstance().Write("LoggerTest, LogStorm limited");
+	auto elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+	uint64_t admitted = REPEATS * 10 - (Logger::GetInstance().GetStats().rateLimited - limited);
+	EXPECT_GE(admitted, 10u);
+	EXPECT_LE(admitted, 11u + (uint64_t)elapsed.count() / 100);
+
+	// The next admitted message reports the suppressed count
+	this_thread::sleep_for(milliseconds(150));
+	Logger::GetInstance().Write("LoggerTest, LogStorm limited");
+	Logger::GetInstance().SetRateLimit(0);
+	durable = Logger::GetInstance().WriteDurable("LoggerTest, LogStorm limited end");
+	EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+
+	contents.clear();
+	EXPECT_TRUE(ReadLogFile("LogData.txt", contents));
+	EXPECT_NE(contents.find(" similar messages\nLoggerTest, LogStorm limited\n"), string::npos);
+
+	// Test cleanup
+	SyncLogger();
+}
+
+// Test independent Logger instances per component and merging their files
+TEST(Logger_IT, ShardedLoggers)
+{
+	static const int MSGS = 20;
+	static const LogComponent COMPONENT = 7;
+
+	RemoveLogFile("LoggerShardA.txt");
+	RemoveLogFile("LoggerShardB.txt");
+	{
+		// Each instance has its own thread and file
+		Logger shardA("LoggerShardA");
+		Logger shardB("LoggerShardB");
+		shardA.SetTimestamps(true);
+		shardB.SetTimestamps(true);
+
+		// Messages from a component are routed to its instance
+		Logger::SetComponentLogger(COMPONENT, &shardB);
+		EXPECT_EQ(&Logger::ForComponent(COMPONENT), &shardB);
+		EXPECT_EQ(&Logger::ForComponent(COMPONENT + 1), &Logger::GetInstance());
+
+		for (int i = 0; i < MSGS; i++)
+		{
+			Logger& shard = i % 2 ? shardB : shardA;
+			shard.Write("LoggerTest, ShardedLoggers " + to_string(i));
+			this_thread::sleep_for(microseconds(100));
+		}
+		LOG_WRITE(LogLevel::Error, COMPONENT, "LoggerTest, ShardedLoggers component");
+		Logger::SetComponentLogger(COMPONENT, nullptr);
+		EXPECT_EQ(&Logger::ForComponent(COMPONENT), &Logger::GetInstance());
+
+		auto durableA = shardA.WriteDurable("LoggerTest, ShardedLoggers end A");
+		auto durableB = shardB.WriteDurable("LoggerTest, ShardedLoggers end B");
+		EXPECT_EQ(durableA.wait_for(seconds(5)), future_status::ready);
+		EXPECT_EQ(durableB.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durableA.get());
+		EXPECT_TRUE(durableB.get());
+	}
+
+	string contentsA, contentsB;
+	EXPECT_TRUE(ReadLogFile("LoggerShardA.txt", contentsA));
+	EXPECT_TRUE(ReadLogFile("LoggerShardB.txt", contentsB));
+	EXPECT_NE(contentsA.find("LoggerTest, ShardedLoggers 0\n"), string::npos);
+	EXPECT_EQ(contentsA.find("LoggerTest, ShardedLoggers 1\n"), string::npos);
+	EXPECT_NE(contentsB.find("LoggerTest, ShardedLoggers 1\n"), string::npos);
+	EXPECT_NE(contentsB.find("LoggerTest, ShardedLoggers component\n"), string::npos);
+
+	// The merged output interleaves the instances in write order
+	ostringstream merged;
+	EXPECT_TRUE(LogMerge::Merge({ "LoggerShardA.txt", "LoggerShardB.txt" }, merged));
+	string contents = merged.str();
+	size_t pos = 0;
+	for (int i = 0; i < MSGS; i++)
+	{
+		size_t next = contents.find("LoggerTest, ShardedLoggers " + to_string(i) + "\n");
+		ASSERT_NE(next, string::npos);
+		EXPECT_GE(next, pos) << i;
+		pos = next;
+	}
+
+	// Test cleanup
+	RemoveLogFile("LoggerShardA.txt");
+	RemoveLogFile("LoggerShardB.txt");
+	remove("LoggerShardA.hwm");
+	remove("LoggerShardB.hwm");
+}
+
+// Test messages are routed by level to instances with their own flush cadence
+TEST(Logger_IT, LevelRouting)
+{
+	static const LogComponent COMPONENT = 9;
+
+	RemoveLogFile("LoggerErrors.txt");
+	RemoveLogFile("LoggerTraces.txt");
+	{
+		// Errors are flushed per record, traces batch for a long latency
+		Logger errors("LoggerErrors");
+		Logger traces("LoggerTraces");
+		Logger::FlushTrigger trigger;
+		trigger.maxRecords = 1;
+		errors.SetFlushTrigger(trigger);
+		trigger.maxRecords = 0;
+		trigger.maxLatency = seconds(60);
+		traces.SetFlushTrigger(trigger);
+
+		Logger::SetLevelLogger(LogLevel::Trace, &traces);
+		Logger::SetLevelLogger(LogLevel::Error, &errors);
+		EXPECT_EQ(&Logger::ForRecord(LogLevel::Debug, COMPONENT), &traces);
+		EXPECT_EQ(&Logger::ForRecord(LogLevel::Fatal, COMPONENT), &errors);
+
+		// A level route takes precedence over the component route
+		Logger::SetComponentLogger(COMPONENT, &Logger::GetInstance());
+		EXPECT_EQ(&Logger::ForRecord(LogLevel::Error, COMPONENT), &errors);
+		Logger::SetComponentLogger(COMPONENT, nullptr);
+
+		LOG_WRITE(LogLevel::Trace, COMPONENT, "LoggerTest, LevelRouting trace");
+		LOG_WRITE(LogLevel::Error, COMPONENT, "LoggerTest, LevelRouting error");
+
+		// The error reaches its file without waiting for the bulk traffic
+		string contents;
+		for (int i = 0; i < 500 && contents.find("LevelRouting error") == string::npos; i++)
+		{
+			this_thread::sleep_for(milliseconds(10));
+			ReadLogFile("LoggerErrors.txt", contents);
+		}
+		EXPECT_NE(contents.find("LoggerTest, LevelRouting error\n"), string::npos);
+		EXPECT_EQ(contents.find("LevelRouting trace"), string::npos);
+		contents.clear();
+		ReadLogFile("LoggerTraces.txt", contents);
+		EXPECT_EQ(contents.find("LevelRouting trace"), string::npos);
+
+		Logger::SetLevelLogger(LogLevel::Trace, nullptr);
+		EXPECT_EQ(&Logger::ForRecord(LogLevel::Error, COMPONENT), &Logger::GetInstance());
+
+		auto durable = traces.WriteDurable("LoggerTest, LevelRouting end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durable.get());
+	}
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerTraces.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, LevelRouting trace\n"), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerErrors.txt");
+	RemoveLogFile("LoggerTraces.txt");
+	remove("LoggerErrors.hwm");
+	remove("LoggerTraces.hwm");
+}
+
+// Test the log index skips blocks by time and keyword and finds the same lines as a scan
+TEST(Logger_IT, IndexedReader)
+{
+	static const int LINES = 20000;
+	static const int64_t START_NS = 1700000000000000000ll;
+	static const int64_t STEP_NS = 1000000;
+	static const char* FILE_NAME = "LoggerIndex.txt";
+
+	// Stamped lines 1 ms apart and an unstamped continuation line every 100 lines
+	auto Stamp = [](int64_t ns) {
+		time_t t = (time_t)(ns / 1000000000);
+		tm utc;
+#ifdef WIN32
+		gmtime_s(&utc, &t);
+#else
+		gmtime_r(&t, &utc);
+#endif
+		char stamp[64];
+		size_t len = strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", &utc);
+		snprintf(stamp + len, sizeof(stamp) - len, ".%06dZ ", (int)(ns % 1000000000 / 1000));
+		return string(stamp);
+	};
+	remove(FILE_NAME);
+	remove((string(FILE_NAME) + LogIndex::SUFFIX).c_str());
+	{
+		LogFile file;
+		LogIndex index;
+		ASSERT_TRUE(file.Open(FILE_NAME));
+		ASSERT_TRUE(index.Open(FILE_NAME, file.GetSize()));
+		for (int i = 0; i < LINES; i++)
+		{
+			int64_t ns = START_NS + i * STEP_NS;
+			string line = Stamp(ns) + "LoggerTest, IndexedReader line " + to_string(i) + (i % 1000 == 7 ? " needle" : "");
+			file.Write(line + "\n");
+			index.Add(line, ns);
+			if (i % 100 == 0)
+			{
+				line = "  continuation " + to_string(i);
+				file.Write(line + "\n");
+				index.Add(line, LogIndex::NO_TIME);
+			}
+		}
+		file.Flush();
+		index.Flush();
+	}
+
+	LogReader reader;
+	ASSERT_TRUE(reader.Open(FILE_NAME));
+	EXPECT_GT(reader.GetBlockCount(), 10u);
+	EXPECT_EQ(LogReader::ParseTime(Stamp(START_NS + 5 * STEP_NS)), START_NS + 5 * STEP_NS);
+
+	// A keyword in few blocks skips the others
+	vector<string> lines;
+	size_t matches = reader.Find({ LogIndex::NO_TIME, INT64_MAX, "needle" }, [&lines](string_view line) {
+		lines.emplace_back(line);
+		return true;
+	});
+	EXPECT_EQ(matches, (size_t)(LINES / 1000));
+	EXPECT_GT(reader.GetStats().blocksSkipped, 0u);
+	ASSERT_FALSE(lines.empty());
+	EXPECT_NE(lines[0].find("line 7 needle"), string::npos);
+
+	// A keyword is matched as a whole token
+	EXPECT_EQ(reader.Find({ LogIndex::NO_TIME, INT64_MAX, "needl" }, [](string_view) { return true; }), 0u);
+
+	// A time range reads only the blocks that overlap it. Continuation lines 
+	// have the time of the line before them.
+	LogReader::Query range;
+	range.fromNs = START_NS + 5000 * STEP_NS;
+	range.toNs = START_NS + 5099 * STEP_NS;
+	lines.clear();
+	matches = reader.Find(range, [&lines](string_view line) {
+		lines.emplace_back(line);
+		return true;
+	});
+	EXPECT_EQ(matches, 101u);
+	EXPECT_LT(reader.GetStats().bytesScanned, reader.GetSize() / 4);
+	ASSERT_EQ(lines.size(), 101u);
+	EXPECT_NE(lines.front().find("line 5000"), string::npos);
+	EXPECT_NE(lines[1].find("continuation 5000"), string::npos);
+	EXPECT_NE(lines.back().find("line 5099"), string::npos);
+
+	// Both filters together, and stopping the search early
+	range.keywords = "needle";
+	range.toNs = INT64_MAX;
+	EXPECT_EQ(reader.Find(range, [](string_view) { return true; }), (size_t)(LINES / 1000 - 5));
+	EXPECT_EQ(reader.Find({}, [](string_view) { return false; }), 1u);
+
+	// Without the index the results are the same
+	reader.Close();
+	remove((string(FILE_NAME) + LogIndex::SUFFIX).c_str());
+	ASSERT_TRUE(reader.Open(FILE_NAME));
+	EXPECT_EQ(reader.GetBlockCount(), 0u);
+	EXPECT_EQ(reader.Find({ LogIndex::NO_TIME, INT64_MAX, "needle" }, [](string_view) { return true; }), (size_t)(LINES / 1000));
+	EXPECT_EQ(reader.Find({}, [](string_view) { return true; }), (size_t)(LINES + LINES / 100));
+
+	// Test cleanup
+	reader.Close();
+	RemoveLogFile(FILE_NAME);
+}
+
+TEST(Logger_IT, LazyStart)
+{
+	RemoveLogFile("LoggerLazy.txt");
+	RemoveLogFile("LoggerEager.txt");
+	{
+		// The thread starts on the first write
+		Logger lazy("LoggerLazy");
+		EXPECT_FALSE(lazy.IsStarted());
+		Logger::StartConfig config;
+		config.eager = false;
+		lazy.Start(config);
+		EXPECT_FALSE(lazy.IsStarted());
+
+		auto durable = lazy.WriteDurable("LoggerTest, LazyStart lazy");
+		EXPECT_TRUE(lazy.IsStarted());
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durable.get());
+
+		// Buffers and the log file are prepared before the first write
+		Logger eager("LoggerEager");
+		config.eager = true;
+		config.bufferBytes = 64 * 1024;
+		config.fileExtent = 1024 * 1024;
+		eager.Start(config);
+		EXPECT_TRUE(eager.IsStarted());
+		EXPECT_TRUE(ifstream("LoggerEager.txt").good());
+
+		durable = eager.WriteDurable("LoggerTest, LazyStart eager");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durable.get());
+	}
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerLazy.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, LazyStart lazy\n"), string::npos);
+	EXPECT_TRUE(ReadLogFile("LoggerEager.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, LazyStart eager\n"), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerLazy.txt");
+	RemoveLogFile("LoggerEager.txt");
+	remove("LoggerLazy.hwm");
+	remove("LoggerEager.hwm");
+}
+
+static atomic<size_t> statusBatches(0);
+static atomic<size_t> statusRecords(0);
+static atomic<size_t> statusFlushBytes(0);
+
+static void StatusBatchCb(const Logger::StatusInfo& info)
+{
+	EXPECT_EQ(info.event, Logger::StatusEvent::BATCH_WRITTEN);
+	statusBatches++;
+	statusRecords += info.records;
+}
+
+static void StatusFlushCb(const Logger::StatusInfo& info)
+{
+	EXPECT_EQ(info.event, Logger::StatusEvent::FLUSH_SUCCESS);
+	statusFlushBytes += info.bytes;
+}
+
+TEST(Logger_IT, StatusEvents)
+{
+	static const size_t MSGS = 10;
+
+	statusBatches = 0;
+	statusRecords = 0;
+	statusFlushBytes = 0;
+	RemoveLogFile("LoggerStatus.txt");
+	{
+		Logger logger("LoggerStatus");
+		logger.Subscribe(Logger::StatusEvent::BATCH_WRITTEN, MakeDelegate(&StatusBatchCb));
+		logger.Subscribe(Logger::StatusEvent::FLUSH_SUCCESS, MakeDelegate(&StatusFlushCb));
+
+		// Batch events carry the record counts
+		for (size_t i = 0; i < MSGS; i++)
+			logger.Write("LoggerTest, StatusEvents " + to_string(i));
+		auto durable = logger.WriteDurable("LoggerTest, StatusEvents end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durable.get());
+		EXPECT_GE(statusBatches.load(), 1u);
+		EXPECT_EQ(statusRecords.load(), MSGS + 1);
+
+		// The flush event follows the durable write completion
+		for (int i = 0; i < 500 && statusFlushBytes.load() == 0; i++)
+			this_thread::sleep_for(milliseconds(1));
+		EXPECT_GT(statusFlushBytes.load(), 0u);
+
+		// Unsubscribed events are not delivered
+		logger.Unsubscribe(Logger::StatusEvent::BATCH_WRITTEN, MakeDelegate(&StatusBatchCb));
+		logger.Unsubscribe(Logger::StatusEvent::FLUSH_SUCCESS, MakeDelegate(&StatusFlushCb));
+		durable = logger.WriteDurable("LoggerTest, StatusEvents unsubscribed");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_EQ(statusRecords.load(), MSGS + 1);
+	}
+
+	// Test cleanup
+	RemoveLogFile("LoggerStatus.txt");
+	remove("LoggerStatus.hwm");
+}
+
+static mutex offThreadMutex;
+static atomic<size_t> offThreadWrites(0);
+
+static void OffThreadStatusCb(const string& status)
+{
+	// Blocks the status thread while the test holds the mutex
+	lock_guard<mutex> lock(offThreadMutex);
+	if (status == "Write success!")
+		offThreadWrites++;
+}
+
+TEST(Logger_IT, OffThreadStatus)
+{
+	static const size_t MSGS = 20;
+
+	offThreadWrites = 0;
+	RemoveLogFile("LoggerOffThread.txt");
+	WorkerThread statusThread("StatusThread");
+	statusThread.CreateThread();
+	{
+		Logger logger("LoggerOffThread");
+		logger.SetCallback(&OffThreadStatusCb, &statusThread);
+
+		// A blocked callback does not stall the Logger thread
+		{
+			unique_lock<mutex> block(offThreadMutex);
+			for (size_t i = 0; i < MSGS; i++)
+				logger.Write("LoggerTest, OffThreadStatus " + to_string(i));
+			auto durable = logger.WriteDurable("LoggerTest, OffThreadStatus end");
+			EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+			EXPECT_TRUE(durable.get());
+			EXPECT_EQ(offThreadWrites.load(), 0u);
+		}
+
+		// The queued callbacks run once unblocked
+		for (int i = 0; i < 500 && offThreadWrites.load() < MSGS + 1; i++)
+			this_thread::sleep_for(milliseconds(1));
+		EXPECT_EQ(offThreadWrites.load(), MSGS + 1);
+		logger.SetCallback(nullptr);
+	}
+	statusThread.ExitThread();
+
+	// Test cleanup
+	RemoveLogFile("LoggerOffThread.txt");
+	remove("LoggerOffThread.hwm");
+}
+
+TEST(Logger_IT, FlightRecorder)
+{
+	static const int MSGS = 200;
+
+	RemoveLogFile("LoggerRecorder.txt");
+	{
+		// Only the most recent records fit in the recorder
+		Logger logger("LoggerRecorder");
+		logger.SetFlightRecorder(4096, LogLevel::Error);
+		for (int i = 0; i < MSGS; i++)
+			logger.Write("LoggerTest, FlightRecorder " + to_string(i));
+		logger.Flush();
+
+		auto recorded = MakeDelegate(&logger.m_logData, &LogData::GetRecordedRecords, logger, seconds(5)).AsyncInvoke();
+		ASSERT_TRUE(recorded.has_value());
+		EXPECT_GT(recorded.value(), 0u);
+		EXPECT_LT(recorded.value(), (size_t)MSGS);
+
+		// Nothing was written to disk
+		auto written = MakeDelegate(&logger.m_logData, &LogData::GetHighWaterMark, logger, seconds(5)).AsyncInvoke();
+		ASSERT_TRUE(written.has_value());
+		EXPECT_EQ(written.value(), 0u);
+
+		// A message at the dump level writes the recorded context
+		logger.Write(LogLevel::Error, 0, "LoggerTest, FlightRecorder error");
+		auto durable = logger.WriteDurable("LoggerTest, FlightRecorder end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durable.get());
+
+		// The first durable write after other records dumps them. Durable
+		// messages are not recorded, so later ones find nothing to dump.
+		logger.Write("LoggerTest, FlightRecorder context");
+		std::vector<std::future<bool>> durables;
+		for (int i = 0; i < 3; i++)
+			durables.push_back(logger.WriteDurable("LoggerTest, FlightRecorder durable " + to_string(i)));
+		for (auto& future : durables)
+			EXPECT_TRUE(future.get());
+		recorded = MakeDelegate(&logger.m_logData, &LogData::GetRecordedRecords, logger, seconds(5)).AsyncInvoke();
+		ASSERT_TRUE(recorded.has_value());
+		EXPECT_EQ(recorded.value(), 0u);
+
+		// Records after the durable run are recorded again
+		logger.Write("LoggerTest, FlightRecorder after");
+		recorded = MakeDelegate(&logger.m_logData, &LogData::GetRecordedRecords, logger, seconds(5)).AsyncInvoke();
+		ASSERT_TRUE(recorded.has_value());
+		EXPECT_EQ(recorded.value(), 1u);
+	}
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerRecorder.txt", contents));
+	EXPECT_EQ(contents.find("LoggerTest, FlightRecorder 0\n"), string::npos);
+	size_t last = contents.find("LoggerTest, FlightRecorder " + to_string(MSGS - 1) + "\n");
+	size_t error = contents.find("LoggerTest, FlightRecorder error\n");
+	EXPECT_NE(last, string::npos);
+	EXPECT_NE(error, string::npos);
+	EXPECT_LT(last, error);
+	size_t context = contents.find("LoggerTest, FlightRecorder context\n");
+	EXPECT_NE(context, string::npos);
+	for (int i = 0; i < 3; i++)
+	{
+		size_t durable = contents.find("LoggerTest, FlightRecorder durable " + to_string(i) + "\n");
+		EXPECT_NE(durable, string::npos);
+		EXPECT_LT(context, durable);
+		context = durable;
+	}
+	EXPECT_EQ(contents.find("LoggerTest, FlightRecorder after\n"), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerRecorder.txt");
+	remove("LoggerRecorder.hwm");
+}
+
+// Test string_view, scatter and reserve/commit writes
+TEST(Logger_IT, ZeroCopyWrite)
+{
+	RemoveLogFile("LoggerZeroCopy.txt");
+	{
+		Logger logger("LoggerZeroCopy");
+		logger.SetTimestamps(true);
+
+		// A view into a larger buffer writes only the viewed characters
+		const char buffer[] = "LoggerTest, ZeroCopyWrite view and more";
+		logger.Write(string_view(buffer, strlen("LoggerTest, ZeroCopyWrite view")));
+
+		// Parts are gathered into one record
+		string_view parts[] = { "LoggerTest, ", "ZeroCopyWrite ", "scatter" };
+		logger.Write(parts, 3);
+
+		// A message formatted into a reserved slot
+		Logger::WriteSlot slot = logger.Reserve(64);
+		ASSERT_TRUE(slot);
+		EXPECT_EQ(slot.Capacity(), 64u);
+		int len = snprintf(slot.Data(), slot.Capacity(), "LoggerTest, ZeroCopyWrite slot %d", 42);
+		logger.Commit(slot, (size_t)len);
+		EXPECT_FALSE(slot);
+
+		// An uncommitted slot writes nothing
+		Logger::WriteSlot discarded = logger.Reserve(16);
+		memcpy(discarded.Data(), "discarded", 9);
+
+		auto durable = logger.WriteDurable("LoggerTest, ZeroCopyWrite end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durable.get());
+	}
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerZeroCopy.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, ZeroCopyWrite view\n"), string::npos);
+	EXPECT_NE(contents.find("LoggerTest, ZeroCopyWrite scatter\n"), string::npos);
+	EXPECT_NE(contents.find("Z LoggerTest, ZeroCopyWrite slot 42\n"), string::npos);
+	EXPECT_EQ(contents.find("discarded"), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerZeroCopy.txt");
+	remove("LoggerZeroCopy.hwm");
+}
+
+// Test the adaptive flush interval grows under load and shrinks when idle
+TEST(Logger_IT, AdaptiveFlush)
+{
+	RemoveLogFile("LoggerAdaptive.txt");
+	{
+		Logger logger("LoggerAdaptive");
+		Logger::FlushTrigger trigger;
+		trigger.adaptive = true;
+		trigger.minLatency = milliseconds(5);
+		trigger.maxLatency = milliseconds(200);
+		trigger.adaptiveBatchBytes = 1024;
+		logger.SetFlushTrigger(trigger);
+
+		// Large batches lengthen the interval up to the latency target
+		for (int i = 0; i < 20; i++)
+		{
+			for (int j = 0; j < 100; j++)
+				logger.Write("LoggerTest, AdaptiveFlush heavy load " + to_string(j));
+			auto durable = logger.WriteDurable("LoggerTest, AdaptiveFlush heavy");
+			EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		}
+		milliseconds heavy = logger.GetStats().flushInterval;
+		EXPECT_GT(heavy, milliseconds(50));
+		EXPECT_LE(heavy, trigger.maxLatency);
+
+		// Small batches shorten it to the minimum
+		for (int i = 0; i < 20; i++)
+		{
+			auto durable = logger.WriteDurable("LoggerTest, AdaptiveFlush light");
+			EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		}
+		EXPECT_EQ(logger.GetStats().flushInterval, trigger.minLatency);
+	}
+
+	// Test cleanup
+	RemoveLogFile("LoggerAdaptive.txt");
+	remove("LoggerAdaptive.hwm");
+}
+
+// Test records are escaped and invalid UTF-8 is replaced when written
+TEST(Logger_IT, EscapeRecords)
+{
+	string escaped;
+
+	// Clean records are not copied, within and past a vector block
+	string clean(100, 'a');
+	clean += "\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80 valid UTF-8";
+	EXPECT_EQ(LogEscape::Escape(clean, escaped).data(), clean.data());
+
+	// Special bytes at every offset of a vector block are found
+	for (size_t i = 0; i < 40; i++)
+	{
+		string record(40, 'x');
+		record[i] = '\n';
+		EXPECT_EQ(LogEscape::FindSpecial(record.data(), record.size(), false), i);
+	}
+
+	EXPECT_EQ(LogEscape::Escape("tab\tline\nesc\x1b back\\slash", escaped), "tab\\tline\\nesc\\u001b back\\\\slash");
+	EXPECT_EQ(LogEscape::Escape("say \"hi\"", escaped), "say \"hi\"");
+	EXPECT_EQ(LogEscape::Escape("say \"hi\"", escaped, true), "say \\\"hi\\\"");
+
+	// Invalid, truncated, overlong and surrogate sequences are replaced
+	EXPECT_EQ(LogEscape::Escape("a\xFF" "b", escaped), "a\xEF\xBF\xBD" "b");
+	EXPECT_EQ(LogEscape::Escape("a\xE2\x82", escaped), "a\xEF\xBF\xBD\xEF\xBF\xBD");
+	EXPECT_EQ(LogEscape::Escape("\xC0\xAF", escaped), "\xEF\xBF\xBD\xEF\xBF\xBD");
+	EXPECT_EQ(LogEscape::Escape("\xED\xA0\x80", escaped), "\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD");
+
+	// LogData escapes the log file records
+	const char* FILE_NAME = "LoggerEscape.txt";
+	RemoveLogFile(FILE_NAME);
+	{
+		LogData logData("LoggerEscape");
+		logData.SetEscape(true);
+		logData.Write("LoggerTest, EscapeRecords multi\nline \xFF");
+		EXPECT_TRUE(logData.Flush());
+	}
+	string contents;
+	EXPECT_TRUE(ReadLogFile(FILE_NAME, contents));
+	EXPECT_NE(contents.find("LoggerTest, EscapeRecords multi\\nline \xEF\xBF\xBD\n"), string::npos);
+
+	// Test cleanup
+	RemoveLogFile(FILE_NAME);
+	remove("LoggerEscape.hwm");
+}
+
+// Test the JSON output format writes one object per record with its context
+TEST(Logger_IT, JsonOutput)
+{
+	RemoveLogFile("LoggerJson.txt");
+	{
+		Logger logger("LoggerJson");
+		logger.SetTimestamps(true);
+		logger.SetOutputFormat(LogWriter::OutputFormat::JSON);
+
+		static const LogFormat FORMAT = { 1, "LoggerTest, JsonOutput %d \"%s\"" };
+		logger.Write(LogLevel::Warning, 3, "LoggerTest, JsonOutput text\n");
+		logger.Write(LogLevel::Error, 4, FORMAT, 7, "quoted");
+		logger.Write("LoggerTest, JsonOutput plain");
+		auto durable = logger.WriteDurable("LoggerTest, JsonOutput end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_TRUE(durable.get());
+	}
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerJson.txt", contents));
+	string thread = to_string(LogContext::GetThreadNumber());
+	EXPECT_NE(contents.find("Z\",\"thread\":" + thread + ",\"level\":\"warning\",\"component\":3,\"msg\":\"LoggerTest, JsonOutput text\\n\"}\n"), string::npos);
+	EXPECT_NE(contents.find(",\"thread\":" + thread + ",\"level\":\"error\",\"component\":4,\"msg\":\"LoggerTest, JsonOutput 7 \\\"quoted\\\"\"}\n"), string::npos);
+	EXPECT_NE(contents.find("Z\",\"msg\":\"LoggerTest, JsonOutput plain\"}\n"), string::npos);
+
+	// Every line is one object
+	istringstream lines(contents);
+	string line;
+	size_t count = 0;
+	while (getline(lines, line))
+	{
+		EXPECT_EQ(line.compare(0, 7, "{\"ts\":\""), 0) << line;
+		EXPECT_EQ(line.back(), '}');
+		count++;
+	}
+	EXPECT_EQ(count, 4u);
+
+	// Test cleanup
+	RemoveLogFile("LoggerJson.txt");
+	remove("LoggerJson.hwm");
+}
+
+// Test the backlog compresses sealed blocks, spills past its memory cap and 
+// gives every record back oldest first
+TEST(Logger_IT, BacklogSpill)
+{
+	const size_t BLOCKS = 8;
+	const size_t BLOCK_RECORDS = 200;
+	{
+		LogBacklog backlog("LoggerBacklog.spill");
+		backlog.SetMemoryCap(256);
+		for (size_t block = 0; block < BLOCKS; block++)
+		{
+			LogBuffer buffer;
+			for (size_t i = 0; i < BLOCK_RECORDS; i++)
+				buffer.Append("LoggerTest, BacklogSpill " + to_string(block * BLOCK_RECORDS + i));
+			backlog.Seal(buffer);
+		}
+		backlog.WaitIdle();
+		EXPECT_EQ(backlog.GetRecords(), BLOCKS * BLOCK_RECORDS);
+		EXPECT_GT(backlog.GetSpilledBytes(), 0u);
+
+		// Each block is written back in order
+		size_t expected = 0;
+		LogBuffer buffer;
+		while (backlog.TakeOldest(buffer))
+		{
+			for (auto record : buffer)
+			{
+				EXPECT_EQ(record, "LoggerTest, BacklogSpill " + to_string(expected));
+				expected++;
+			}
+			buffer.Clear();
+		}
+		EXPECT_EQ(expected, BLOCKS * BLOCK_RECORDS);
+		EXPECT_TRUE(backlog.Empty());
+		EXPECT_EQ(backlog.GetMemoryBytes(), 0u);
+	}
+
+	// LogData seals pending records past the threshold and flushes them first
+	RemoveLogFile("LoggerBacklog.txt");
+	{
+		LogData logData("LoggerBacklog");
+		logData.SetBacklogLimits(1024, 2048);
+		for (size_t i = 0; i < 500; i++)
+			logData.Write("LoggerTest, BacklogSpill record " + to_string(i));
+		EXPECT_FALSE(logData.GetBacklog().Empty());
+		EXPECT_EQ(logData.GetPendingRecords(), 500u);
+		EXPECT_TRUE(logData.Flush());
+		EXPECT_EQ(logData.GetPendingRecords(), 0u);
+	}
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerBacklog.txt", contents));
+	size_t pos = 0;
+	for (size_t i = 0; i < 500; i++)
+	{
+		pos = contents.find("LoggerTest, BacklogSpill record " + to_string(i) + "\n", pos);
+		ASSERT_NE(pos, string::npos) << i;
+	}
+
+	// Test cleanup
+	RemoveLogFile("LoggerBacklog.txt");
+	remove("LoggerBacklog.hwm");
+}
+
+// Test each flush is framed by a checksum trailer so a torn write is detected
+// and the reader resyncs at the next valid block
+TEST(Logger_IT, ChecksumFrames)
+{
+	// CRC32C check value
+	EXPECT_EQ(LogChecksum::Crc32c(0, "123456789", 9), 0xE3069283u);
+	EXPECT_EQ(LogChecksum::Crc32c(LogChecksum::Crc32c(0, "1234", 4), "56789", 5), 0xE3069283u);
+
+	const char* FILE_NAME = "LoggerChecksum.txt";
+	RemoveLogFile(FILE_NAME);
+	{
+		LogData logData("LoggerChecksum");
+		logData.SetChecksums(true);
+		logData.Write("LoggerTest, ChecksumFrames first");
+		logData.Write("LoggerTest, ChecksumFrames \x1E marker");
+		EXPECT_TRUE(logData.Flush());
+		logData.Write("LoggerTest, ChecksumFrames second");
+		EXPECT_TRUE(logData.Flush());
+	}
+	string contents;
+	EXPECT_TRUE(ReadLogFile(FILE_NAME, contents));
+
+	vector<LogChecksum::Frame> frames;
+	EXPECT_EQ(LogChecksum::Scan(contents.data(), contents.size(), frames), 2u);
+	ASSERT_EQ(frames.size(), 2u);
+	EXPECT_TRUE(frames[0].valid && frames[1].valid);
+	EXPECT_EQ(contents.substr((size_t)frames[1].offset, (size_t)frames[1].size), "LoggerTest, ChecksumFrames second\n");
+
+	// Trailers are not matched by the reader
+	{
+		LogReader reader;
+		ASSERT_TRUE(reader.Open(FILE_NAME));
+		EXPECT_EQ(reader.Find(LogReader::Query(), [](string_view) { return true; }), 3u);
+	}
+
+	// A damaged first block and a torn last write 
+	string damaged = contents;
+	damaged[3] = 'X';
+	damaged += "LoggerTest, ChecksumFrames torn";
+	frames.clear();
+	EXPECT_EQ(LogChecksum::Scan(damaged.data(), damaged.size(), frames), 1u);
+	ASSERT_EQ(frames.size(), 3u);
+	EXPECT_FALSE(frames[0].valid);
+	EXPECT_TRUE(frames[1].valid);
+	EXPECT_EQ(frames[1].offset, frames[0].size);
+	EXPECT_FALSE(frames[2].valid);
+	EXPECT_EQ(frames[2].offset + frames[2].size, damaged.size());
+
+	// Test cleanup
+	RemoveLogFile(FILE_NAME);
+	remove("LoggerChecksum.hwm");
+}
+
+static mutex stallMutex;
+static mutex stallReportsMutex;
+static vector<StallReport> stallReports;
+
+static void StallStatusCb(const string&)
+{
+	// Blocks the Logger thread while the test holds the mutex
+	lock_guard<mutex> lock(stallMutex);
+}
+
+TEST(Logger_IT, StallWatchdog)
+{
+	RemoveLogFile("LoggerStall.txt");
+	StallWatchdog::SetStallCallback([](const StallReport& report) {
+		lock_guard<mutex> lock(stallReportsMutex);
+		if (report.name == "LoggerStallThread")
+			stallReports.push_back(report);
+	});
+	EXPECT_TRUE(StallWatchdog::Start(milliseconds(100)));
+	{
+		Logger logger("LoggerStall");
+		logger.SetCallback(&StallStatusCb);
+
+		// A callback blocked on the Logger thread stalls its loop with more 
+		// messages queued behind it
+		{
+			unique_lock<mutex> block(stallMutex);
+			logger.Write("LoggerTest, StallWatchdog stalled");
+			this_thread::sleep_for(milliseconds(20));
+			logger.Write("LoggerTest, StallWatchdog queued");
+			for (int i = 0; i < 1000; i++)
+			{
+				{
+					lock_guard<mutex> lock(stallReportsMutex);
+					if (!stallReports.empty())
+						break;
+				}
+				this_thread::sleep_for(milliseconds(1));
+			}
+		}
+
+		// Reported once while stalled
+		lock_guard<mutex> lock(stallReportsMutex);
+		ASSERT_EQ(stallReports.size(), 1u);
+		EXPECT_GE(stallReports[0].stalled, milliseconds(100));
+		EXPECT_GE(stallReports[0].queueDepth, 1u);
+		logger.SetCallback(nullptr);
+	}
+	StallWatchdog::Stop();
+	StallWatchdog::SetStallCallback(nullptr);
+
+	// Test cleanup
+	RemoveLogFile("LoggerStall.txt");
+	remove("LoggerStall.hwm");
+}
+
+static const ThreadRegistry::ThreadInfo* FindThread(const vector<ThreadRegistry::ThreadInfo>& threads, const string& name)
+{
+	for (const auto& info : threads)
+	{
+		if (info.name == name)
+			return &info;
+	}
+	return nullptr;
+}
+
+TEST(Logger_IT, ThreadRegistry)
+{
+	static const size_t MSGS = 10;
+
+	RemoveLogFile("LoggerRegistry.txt");
+	{
+		// The Logger thread is listed once started
+		Logger logger("LoggerRegistry");
+		EXPECT_EQ(FindThread(ThreadRegistry::GetThreads(), "LoggerRegistryThread"), nullptr);
+		for (size_t i = 0; i < MSGS; i++)
+			logger.Write("LoggerTest, ThreadRegistry " + to_string(i));
+		auto durable = logger.WriteDurable("LoggerTest, ThreadRegistry end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+
+		auto threads = ThreadRegistry::GetThreads();
+		auto info = FindThread(threads, "LoggerRegistryThread");
+		ASSERT_NE(info, nullptr);
+		EXPECT_GE(info->processed, 2u);
+		EXPECT_NE(info->nativeId, 0u);
+
+		// The tests run on the busy integration test thread
+		info = FindThread(threads, "IntegrationTestThread");
+		ASSERT_NE(info, nullptr);
+		EXPECT_TRUE(info->busy);
+
+		ostringstream dump;
+		ThreadRegistry::Dump(dump);
+		EXPECT_NE(dump.str().find("LoggerRegistryThread"), string::npos);
+	}
+
+	// An exited thread is no longer listed
+	EXPECT_EQ(FindThread(ThreadRegistry::GetThreads(), "LoggerRegistryThread"), nullptr);
+
+	// Test cleanup
+	RemoveLogFile("LoggerRegistry.txt");
+	remove("LoggerRegistry.hwm");
+}
+
+static atomic<size_t> allocTargetCalls(0);
+
+static void AllocTarget(int value)
+{
+	allocTargetCalls += (size_t)value;
+}
+
+// Print the heap allocations per call of a hot path
+static void ReportAllocs(const char* path, const AllocCounts& counts, size_t calls)
+{
+	printf("[ ALLOCS   ] %-24s %6.2f allocs %8.1f bytes per call\n", path,
+		(double)counts.allocs / (double)calls, (double)counts.bytes / (double)calls);
+}
+
+// Test the heap allocations of the hot paths once warmed up
+TEST(Logger_IT, AllocationBudget)
+{
+	static const size_t CALLS = 1000;
+
+	// The tracker counts each allocation on the calling thread only
+	{
+		AllocScope scope;
+		auto p = make_unique<int>(1);
+		EXPECT_EQ(scope.Get().allocs, 1u);
+		EXPECT_GE(scope.Get().bytes, sizeof(int));
+	}
+	EXPECT_NO_ALLOC({ int value = 1; (void)value; });
+	EXPECT_ALLOCS_LE(2, { auto a = make_unique<int>(1); auto b = make_unique<int>(2); });
+
+	// Logger::Write() allocates the queued record. The preallocated queue does not grow.
+	AllocCounts write = MeasureAllocs(CALLS, []() {
+		Logger::GetInstance().Write("LoggerTest, AllocationBudget");
+	});
+	ReportAllocs("Logger::Write", write, CALLS);
+	EXPECT_GE(write.allocs, CALLS);
+	EXPECT_LE(write.allocs, CALLS + CALLS / 100);
+
+	// An async delegate dispatch takes its message from the fixed block pools,
+	// which only allocate to refill the calling thread's block cache
+	WorkerThread allocThread("AllocThread");
+	ASSERT_TRUE(allocThread.CreateThread());
+	auto async = MakeDelegate(&AllocTarget, allocThread);
+	AllocCounts dispatch = MeasureAllocs(CALLS, [&]() { async(1); });
+	ReportAllocs("DelegateAsync dispatch", dispatch, CALLS);
+	EXPECT_LE(dispatch.allocs, CALLS / 10);
+
+	// A broadcast to synchronous targets copies no delegate
+	MulticastDelegateSafe<void(int)> multicast;
+	for (int i = 0; i < 4; i++)
+		multicast += MakeDelegate(&AllocTarget);
+	AllocCounts broadcast = MeasureAllocs(CALLS, [&]() { multicast(1); });
+	ReportAllocs("MulticastDelegate call", broadcast, CALLS);
+	EXPECT_EQ(broadcast.allocs, 0u);
+
+	// Test cleanup
+	allocThread.ExitThread();
+	SyncLogger();
+	AsyncInvoke(
+		&Logger::GetInstance().m_logData.m_msgData,
+		&LogBuffer::Clear,
+		Logger::GetInstance(),
+		milliseconds(50));
+}
+
+// Test huge page backed log buffers, flight recorder and delegate message pools
+TEST(Logger_IT, HugePages)
+{
+	// A buffer is rounded up to whole huge pages, falling back to transparent
+	// or normal pages when no huge pages are reserved
+	const size_t pageSize = HugePages::GetPageSize();
+	HugePages::Ptr buffer = HugePages::Allocate(pageSize + 1, true);
+	ASSERT_TRUE(buffer != nullptr);
+	EXPECT_EQ(buffer.get_deleter().size, pageSize * 2);
+#if defined(__linux__) || defined(WIN32)
+	EXPECT_NE(HugePages::GetBacking(buffer), HugePages::Backing::HEAP);
+#endif
+	memset(buffer.get(), 1, pageSize * 2);
+	EXPECT_EQ(HugePages::GetBacking(HugePages::Allocate(16, false)), HugePages::Backing::HEAP);
+
+	LogBuffer logBuffer;
+	logBuffer.SetHugePages(true);
+	logBuffer.Reserve(1);
+	for (int i = 0; i < 1000; i++)
+		logBuffer.Append("LoggerTest, HugePages");
+	EXPECT_EQ(logBuffer.Size(), 1000u);
+	EXPECT_EQ(*logBuffer.begin(), "LoggerTest, HugePages");
+
+	LogRing ring;
+	ring.Reset(4096, true);
+	ring.Append("LoggerTest, HugePages");
+	EXPECT_EQ(ring.Size(), 1u);
+
+	// Slabs carved once enabled come from a few huge page regions
+	static const size_t BLOCKS = 256;
+	static const size_t BLOCK_SIZE = 4000;
+	xalloc_set_huge_pages(true);
+	vector<void*> blocks;
+	for (size_t i = 0; i < BLOCKS; i++)
+		blocks.push_back(xmalloc(BLOCK_SIZE));
+	xalloc_set_huge_pages(false);
+	set<uintptr_t> regions;
+	for (void* block : blocks)
+	{
+		memset(block, 1, BLOCK_SIZE);
+		regions.insert(reinterpret_cast<uintptr_t>(block) / XALLOC_HUGE_REGION);
+	}
+#if defined(__linux__)
+	EXPECT_LE(regions.size(), 4u);
+#endif
+	for (void* block : blocks)
+		xfree(block, BLOCK_SIZE);
+}
+
+static size_t ScratchCapacity(size_t allocate)
+{
+	ScratchArena* scratch = WorkerThread::GetScratchArena();
+	size_t capacity = scratch->GetCapacity();
+	if (allocate)
+		scratch->Allocate(allocate);
+	return capacity;
+}
+
+// Test idle threads release the memory kept since a burst
+TEST(Logger_IT, TrimMemory)
+{
+	RingQueue<int> ring;
+	for (int i = 0; i < 1000; i++)
+		ring.push(std::move(i));
+	ring.Shrink(4);
+	EXPECT_EQ(ring.capacity(), 1024u);
+	while (ring.size() > 3)
+		ring.pop();
+	ring.Shrink(4);
+	EXPECT_EQ(ring.capacity(), 4u);
+	EXPECT_EQ(ring.front(), 997);
+	ring.clear();
+	ring.Shrink(0);
+	EXPECT_EQ(ring.capacity(), 0u);
+
+	TrimPolicy policy;
+	policy.quietPeriod = milliseconds(50);
+	policy.queueLowWater = 16;
+	policy.bufferLowWater = ScratchArena::DEFAULT_BLOCK_SIZE;
+
+	// A burst grows the worker thread's scratch arena until the thread is quiet
+	WorkerThread thread("TrimMemory");
+	ASSERT_TRUE(thread.CreateThread());
+	thread.SetTrimPolicy(policy);
+	auto scratch = MakeDelegate(&ScratchCapacity, thread, milliseconds(500));
+	ASSERT_TRUE(scratch.AsyncInvoke(1024 * 1024).has_value());
+	auto capacity = scratch.AsyncInvoke(0);
+	ASSERT_TRUE(capacity.has_value());
+	EXPECT_GE(capacity.value(), 1024u * 1024u);
+	this_thread::sleep_for(milliseconds(200));
+	capacity = scratch.AsyncInvoke(0);
+	ASSERT_TRUE(capacity.has_value());
+	EXPECT_LE(capacity.value(), policy.bufferLowWater);
+	thread.ExitThread();
+
+	// The Logger queue shrinks from its preallocated size once quiet
+	RemoveLogFile("LoggerTrim.txt");
+	{
+		Logger logger("LoggerTrim");
+		logger.SetTrimPolicy(policy);
+		logger.Start();
+		for (int i = 0; i < 100; i++)
+			logger.Write("LoggerTest, TrimMemory");
+		auto durable = logger.WriteDurable("LoggerTest, TrimMemory end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_GE(logger.GetQueueCapacity(), Logger::QUEUE_RESERVE);
+		for (int i = 0; i < 100 && logger.GetQueueCapacity() != policy.queueLowWater; i++)
+			this_thread::sleep_for(milliseconds(10));
+		EXPECT_EQ(logger.GetQueueCapacity(), policy.queueLowWater);
+	}
+
+	// Test cleanup
+	RemoveLogFile("LoggerTrim.txt");
+	remove("LoggerTrim.hwm");
+}
+
+// Test records not flushed before a restart are replayed from the journal and
+// released once flushed
+TEST(Logger_IT, Journal)
+{
+	const size_t JOURNAL_BYTES = 64 * 1024;
+	RemoveLogFile("LoggerJournal.txt");
+	remove("LoggerJournal.journal");
+	{
+		LogData logData("LoggerJournal");
+		EXPECT_EQ(logData.SetJournal(JOURNAL_BYTES), 0u);
+		for (int i = 0; i < 100; i++)
+			logData.Write("LoggerTest, Journal " + to_string(i));
+		EXPECT_GT(logData.GetJournal().GetUsed(), 0u);
+
+		// Destroyed without a flush as if the process exited
+	}
+	{
+		LogData logData("LoggerJournal");
+		EXPECT_EQ(logData.SetJournal(JOURNAL_BYTES), 100u);
+		EXPECT_EQ(logData.GetPendingRecords(), 100u);
+		logData.Write("LoggerTest, Journal 100");
+		EXPECT_TRUE(logData.Flush());
+		EXPECT_EQ(logData.GetJournal().GetUsed(), 0u);
+	}
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerJournal.txt", contents));
+	size_t pos = 0;
+	for (int i = 0; i <= 100; i++)
+	{
+		pos = contents.find("LoggerTest, Journal " + to_string(i) + "\n", pos);
+		ASSERT_NE(pos, string::npos) << i;
+	}
+
+	// Records are moved into a journal of another size, and a full journal
+	// keeps the records that do not fit in memory only
+	{
+		LogData logData("LoggerJournal");
+		EXPECT_EQ(logData.SetJournal(JOURNAL_BYTES), 0u);
+		logData.Write("LoggerTest, Journal resized");
+	}
+	{
+		LogData logData("LoggerJournal");
+		EXPECT_EQ(logData.SetJournal(256), 1u);
+		for (int i = 0; i < 20; i++)
+			logData.Write("LoggerTest, Journal full " + to_string(i));
+		EXPECT_GT(logData.GetJournal().GetUnjournaled(), 0u);
+		EXPECT_EQ(logData.GetPendingRecords(), 21u);
+		EXPECT_TRUE(logData.Flush());
+	}
+	{
+		LogData logData("LoggerJournal");
+		EXPECT_EQ(logData.SetJournal(256), 0u);
+	}
+
+	// Test cleanup
+	RemoveLogFile("LoggerJournal.txt");
+	remove("LoggerJournal.hwm");
+	remove("LoggerJournal.journal");
+}
+
+static Logger* signalLogger = nullptr;
+
+static void WriteSignalHandler(int)
+{
+	static const char msg[] = "LoggerTest, WriteFromSignal handler";
+	signalLogger->WriteFromSignal(msg, sizeof(msg) - 1);
+}
+
+// Test messages written from a signal handler are copied into preallocated
+// slots and written by the Logger thread
+TEST(Logger_IT, WriteFromSignal)
+{
+	LogSignalRing ring;
+	EXPECT_FALSE(ring.Push("x", 1, false));
+	ring.Reset(3);
+	EXPECT_EQ(ring.Capacity(), 4u);
+	string longRecord(LogSignalRing::SLOT_SIZE + 10, 'a');
+	EXPECT_TRUE(ring.Push(longRecord.data(), longRecord.size(), false));
+	for (int i = 1; i < 4; i++)
+		EXPECT_TRUE(ring.Push(to_string(i).c_str(), 1, false));
+	EXPECT_FALSE(ring.Push("4", 1, false));
+	EXPECT_EQ(ring.GetDropCount(), 1u);
+	size_t count = 0;
+	ring.ForEach([&count](string_view) { count++; });
+	EXPECT_EQ(count, 4u);
+	string record;
+	ASSERT_TRUE(ring.TryPop(record));
+	EXPECT_EQ(record.size(), LogSignalRing::SLOT_SIZE);
+	for (int i = 1; i < 4; i++)
+	{
+		ASSERT_TRUE(ring.TryPop(record));
+		EXPECT_EQ(record, to_string(i));
+	}
+	EXPECT_TRUE(ring.Empty());
+
+	RemoveLogFile("LoggerSignal.txt");
+	{
+		Logger logger("LoggerSignal");
+		Logger::StartConfig config;
+		config.signalSlots = 16;
+		logger.Start(config);
+		signalLogger = &logger;
+		auto previous = signal(SIGINT, &WriteSignalHandler);
+		raise(SIGINT);
+		signal(SIGINT, previous);
+		signalLogger = nullptr;
+
+		// Picked up by the Logger thread's poll without any other message
+		for (int i = 0; i < 100 && logger.GetStats().enqueued == 0; i++)
+			this_thread::sleep_for(milliseconds(10));
+		EXPECT_EQ(logger.GetStats().enqueued, 1u);
+		auto durable = logger.WriteDurable("LoggerTest, WriteFromSignal end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+	}
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerSignal.txt", contents));
+	size_t pos = contents.find("LoggerTest, WriteFromSignal handler\n");
+	EXPECT_NE(pos, string::npos);
+	EXPECT_NE(contents.find("LoggerTest, WriteFromSignal end\n", pos), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerSignal.txt");
+	remove("LoggerSignal.hwm");
+}
+
+// Test messages written to per-CPU buffers by many threads are all written
+TEST(Logger_IT, WritePerCpu)
+{
+	EXPECT_LT(GetCurrentCpu(), std::max(1u, std::thread::hardware_concurrency()));
+
+	const int THREADS = 8;
+	const int WRITES = 200;
+	RemoveLogFile("LoggerPerCpu.txt");
+	{
+		Logger logger("LoggerPerCpu");
+		logger.SetPerCpuWrite(true);
+		logger.Start();
+		vector<std::thread> threads;
+		for (int t = 0; t < THREADS; t++)
+		{
+			threads.emplace_back([&logger, t]() {
+				for (int i = 0; i < WRITES; i++)
+					logger.Write("LoggerTest, WritePerCpu T" + to_string(t) + " " + to_string(i));
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+		auto durable = logger.WriteDurable("LoggerTest, WritePerCpu end");
+		EXPECT_EQ(durable.wait_for(seconds(5)), future_status::ready);
+		EXPECT_EQ(logger.GetStats().enqueued, (uint64_t)(THREADS * WRITES + 1));
+	}
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerPerCpu.txt", contents));
+	for (int t = 0; t < THREADS; t++)
+	{
+		for (int i = 0; i < WRITES; i++)
+			ASSERT_NE(contents.find("LoggerTest, WritePerCpu T" + to_string(t) + " " + to_string(i) + "\n"), string::npos);
+	}
+
+	// Test cleanup
+	RemoveLogFile("LoggerPerCpu.txt");
+	remove("LoggerPerCpu.hwm");
+}
+
+// Test records written with LOG_SITE carry a call site ID expanded when rendered
+TEST(Logger_IT, CallSite)
+{
+	static constexpr LogCallSite SITE{ "site.cpp", 7, "Func", "CallSite %d", LogCallSite::MakeId("site.cpp", 7, "CallSite %d") };
+	static_assert(LogCallSite::IsCallSiteId(SITE.id), "call site ID flag");
+	ASSERT_EQ(LogCallSites::Register(SITE), &SITE);
+	EXPECT_EQ(LogCallSites::Register(SITE), &SITE);
+	EXPECT_EQ(LogCallSites::Find(SITE.id), &SITE);
+
+	// The record holds the ID and arguments only
+	std::string record;
+	LogRecord::Encode(record, SITE, 42);
+	EXPECT_EQ(LogRecord::GetFormatId(record), SITE.id);
+	std::string formatRecord;
+	LogRecord::Encode(formatRecord, LogFormat{ 1, SITE.format }, 42);
+	EXPECT_EQ(record.size() + sizeof(const char*), formatRecord.size());
+	std::string text;
+	LogRecord::Render(record, text);
+	EXPECT_EQ(text, "CallSite 42");
+
+	// Another site with the same ID is not registered
+	static constexpr LogCallSite CLASH{ "other.cpp", 8, "Func", "Clash", SITE.id };
+	EXPECT_EQ(LogCallSites::Register(CLASH), nullptr);
+
+	// An unknown call site renders its ID
+	static constexpr LogCallSite UNKNOWN{ "site.cpp", 9, "Func", "Unknown", LogCallSite::MakeId("site.cpp", 9, "Unknown") };
+	record.clear();
+	LogRecord::Encode(record, UNKNOWN);
+	text.clear();
+	LogRecord::Render(record, text);
+	char expected[32];
+	snprintf(expected, sizeof(expected), "<call site %08x>", (unsigned)UNKNOWN.id);
+	EXPECT_EQ(text, expected);
+
+	// The table lists the file, line, function and escaped format
+	std::string table;
+	LogCallSites::Dump(table);
+	snprintf(expected, sizeof(expected), "%08x\tsite.cpp:7\tFunc\t", (unsigned)SITE.id);
+	EXPECT_NE(table.find(std::string(expected) + "CallSite %d\n"), std::string::npos);
+
+	// Write through the macro and flush the rendered text
+	const size_t sites = LogCallSites::GetCount();
+	for (int i = 0; i < 2; i++)
+		LOG_SITE(LogLevel::Info, 0, "LoggerTest, CallSite %d %s", i, "done");
+	EXPECT_EQ(LogCallSites::GetCount(), sites + 1);
+	EXPECT_TRUE(Logger::GetInstance().WriteDurable("LoggerTest, CallSite flushed").get());
+	std::string contents;
+	EXPECT_TRUE(ReadLogFile("LogData.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, CallSite 0 done\n"), std::string::npos);
+	EXPECT_NE(contents.find("LoggerTest, CallSite 1 done\n"), std::string::npos);
+	table.clear();
+	LogCallSites::Dump(table);
+	EXPECT_NE(table.find("Logger_IT.cpp:"), std::string::npos);
+	EXPECT_NE(table.find("LoggerTest, CallSite %d %s"), std::string::npos);
+}
+
+#ifndef WIN32
+// Test flushed records are published to a shared memory ring and a lapped
+// reader detects the records it lost
+TEST(Logger_IT, ShmSink)
+{
+	// A lapped reader skips the overwritten records and counts them
+	auto ring = LogShmRing::Create("/LoggerTestShmRing", 1024);
+	ASSERT_TRUE(ring != nullptr);
+	auto reader = LogShmRing::Open("/LoggerTestShmRing", true);
+	ASSERT_TRUE(reader != nullptr);
+	for (int i = 0; i < 100; i++)
+		ring->Write("LoggerTest, ShmSink record " + to_string(i));
+	EXPECT_EQ(ring->GetWritten(), 100u);
+	vector<uint64_t> sequences;
+	string last;
+	reader->Read([&](uint64_t sequence, string_view record) {
+		sequences.push_back(sequence);
+		last = string(record);
+	});
+	ASSERT_FALSE(sequences.empty());
+	EXPECT_LT(sequences.size(), 100u);
+	EXPECT_EQ(sequences.back(), 99u);
+	EXPECT_EQ(last, "LoggerTest, ShmSink record 99");
+	for (size_t i = 1; i < sequences.size(); i++)
+		EXPECT_EQ(sequences[i], sequences[i - 1] + 1);
+	ring->Write("LoggerTest, ShmSink record 100");
+	EXPECT_TRUE(reader->IsReady());
+	EXPECT_EQ(reader->Read([](uint64_t, string_view) {}), 1u);
+	EXPECT_EQ(reader->GetLost(), 0u);
+
+	// Lapping the reader between reads counts the lost records
+	for (int i = 101; i < 200; i++)
+		ring->Write("LoggerTest, ShmSink record " + to_string(i));
+	reader->Read([](uint64_t, string_view) {});
+	EXPECT_GT(reader->GetLost(), 0u);
+	reader.reset();
+	ring.reset();
+	EXPECT_EQ(LogShmRing::Open("/LoggerTestShmRing", true), nullptr);
+
+	// The sink publishes the records Logger flushes
+	auto sink = make_shared<LogShmSink>("/LoggerTestShmSink", 64 * 1024);
+	ASSERT_TRUE(sink->IsOpen());
+	reader = LogShmRing::Open("/LoggerTestShmSink", false);
+	ASSERT_TRUE(reader != nullptr);
+	Logger::GetInstance().AddSink(sink);
+	Logger::GetInstance().Write("LoggerTest, ShmSink published");
+	Logger::GetInstance().Flush();
+	bool found = false;
+	for (int i = 0; i < 200 && !found; i++)
+	{
+		reader->Read([&found](uint64_t, string_view record) {
+			found |= record.find("LoggerTest, ShmSink published") != string_view::npos;
+		});
+		if (!found)
+			this_thread::sleep_for(milliseconds(5));
+	}
+	EXPECT_TRUE(found);
+	EXPECT_EQ(reader->GetLost(), 0u);
+
+	// Test cleanup
+	Logger::GetInstance().RemoveSink(sink);
+}
+#endif
+
+// Test producers frame records into chunks while the Logger thread falls behind
+TEST(Logger_IT, ProducerAssist)
+{
+	RemoveLogFile("LoggerAssist.txt");
+	{
+		Logger logger("LoggerAssist");
+		logger.SetProducerAssist(4, 64);
+
+		// Hold the Logger thread so the queue builds up
+		SignalThread blocked, release;
+		std::function<void()> hold = [&]() {
+			blocked.SetSignal();
+			release.WaitForSignal(2000);
+		};
+		MakeDelegate(hold, logger).AsyncInvoke();
+		ASSERT_TRUE(blocked.WaitForSignal(500));
+
+		// Records are queued up to the threshold, then framed two per chunk
+		for (int i = 0; i < 21; i++)
+			logger.Write("LoggerTest, ProducerAssist " + to_string(i % 10));
+		Logger::Stats stats = logger.GetStats();
+		EXPECT_EQ(stats.assisted, 17u);
+		EXPECT_EQ(stats.queueDepth, 20u);
+
+		// The partly filled chunk is handed off with the next record
+		release.SetSignal();
+		logger.Write("LoggerTest, ProducerAssist end");
+		EXPECT_EQ(logger.GetStats().assisted, 18u);
+		EXPECT_TRUE(logger.WriteDurable("LoggerTest, ProducerAssist durable").get());
+	}
+
+	// Every record is written once, in order
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerAssist.txt", contents));
+	string expected;
+	for (int i = 0; i < 21; i++)
+		expected += "LoggerTest, ProducerAssist " + to_string(i % 10) + "\n";
+	expected += "LoggerTest, ProducerAssist end\nLoggerTest, ProducerAssist durable\n";
+	EXPECT_NE(contents.find(expected), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerAssist.txt");
+	remove("LoggerAssist.hwm");
+}
+
+/// A memory resource counting the blocks taken from the heap
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+	std::atomic<size_t> allocations{ 0 };
+	std::atomic<size_t> outstanding{ 0 };
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		allocations++;
+		outstanding++;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override
+	{
+		outstanding--;
+		std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+};
+
+static std::atomic<int> resourceCalls{ 0 };
+static void ResourceTarget(int value) { resourceCalls += value; }
+
+// Test delegate messages, containers and log buffers allocate from a memory resource
+TEST(Logger_IT, MemoryResource)
+{
+	// Messages dispatched to the thread come from its resource
+	CountingResource messages;
+	{
+		WorkerThread thread("ResourceThread");
+		thread.SetMemoryResource(&messages);
+		EXPECT_EQ(thread.GetMemoryResource(), &messages);
+		ASSERT_TRUE(thread.CreateThread());
+		auto delegate = MakeDelegate(&ResourceTarget, thread);
+		for (int i = 0; i < 10; i++)
+			delegate.AsyncInvoke(1);
+		EXPECT_TRUE(MakeDelegate(&ResourceTarget, thread, WAIT_INFINITE).AsyncInvoke(0).has_value());
+		thread.ExitThread();
+	}
+	EXPECT_EQ(resourceCalls.load(), 10);
+	EXPECT_EQ(messages.allocations.load(), 10u);
+	EXPECT_EQ(messages.outstanding.load(), 0u);
+
+	// A clone within a resource is released back to it
+	CountingResource clones;
+	auto freeDelegate = MakeDelegate(&ResourceTarget);
+	Delegate<void(int)>* clone = static_cast<const Delegate<void(int)>&>(freeDelegate).Clone(clones);
+	ASSERT_NE(clone, nullptr);
+	EXPECT_TRUE(*clone == freeDelegate);
+	EXPECT_EQ(clones.outstanding.load(), 1u);
+	Delegate<void(int)>::Destroy(clone, clones);
+	EXPECT_EQ(clones.outstanding.load(), 0u);
+
+	// The invocation list and its copies use the container's resource
+	CountingResource lists;
+	{
+		MulticastDelegate<void(int)> multicast(&lists);
+		EXPECT_EQ(multicast.GetMemoryResource(), &lists);
+		auto subscription = multicast += freeDelegate;
+		multicast += MakeDelegate(&ResourceTarget);
+		EXPECT_GT(lists.allocations.load(), 0u);
+		size_t allocations = lists.allocations.load();
+		MulticastDelegate<void(int)> copy(multicast);
+		EXPECT_GT(lists.allocations.load(), allocations);
+		copy(2);
+		EXPECT_EQ(resourceCalls.load(), 14);
+		EXPECT_TRUE(multicast.Remove(subscription, RemovePolicy::SWAP_AND_POP));
+		EXPECT_EQ(multicast.Size(), 1u);
+	}
+	EXPECT_EQ(lists.outstanding.load(), 0u);
+
+	// Heap argument copies come from the resource
+	CountingResource args;
+	{
+		xlist<std::shared_ptr<heap_arg_deleter_base>> heapArgs;
+		int value = 5;
+		int* pointer = &value;
+		auto tup = make_tuple_heap<int&, int*, int**>(&args, heapArgs, std::tuple<>(), value, pointer, &pointer);
+		EXPECT_EQ(std::get<0>(tup), 5);
+		EXPECT_EQ(*std::get<1>(tup), 5);
+		EXPECT_NE(std::get<1>(tup), pointer);
+		EXPECT_EQ(**std::get<2>(tup), 5);
+		EXPECT_GT(args.allocations.load(), 3u);
+	}
+	EXPECT_EQ(args.outstanding.load(), 0u);
+
+	// Log buffers come from the resource given at start
+	CountingResource buffers;
+	RemoveLogFile("LoggerResource.txt");
+	{
+		Logger logger("LoggerResource");
+		Logger::StartConfig config;
+		config.bufferBytes = 64 * 1024;
+		config.memoryResource = &buffers;
+		logger.Start(config);
+		EXPECT_GT(buffers.allocations.load(), 0u);
+		EXPECT_TRUE(logger.WriteDurable("LoggerTest, MemoryResource").get());
+	}
+	EXPECT_EQ(buffers.outstanding.load(), 0u);
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerResource.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, MemoryResource\n"), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerResource.txt");
+	remove("LoggerResource.hwm");
+}
+
+// Test shutdown writes and flushes the queued messages, and reports the messages
+// lost once the deadline passes
+TEST(Logger_IT, Shutdown)
+{
+	RemoveLogFile("LoggerShutdown.txt");
+	{
+		// The final flush writes the messages without a Flush() call
+		Logger logger("LoggerShutdown");
+		logger.Start();
+		for (int i = 0; i < 1000; i++)
+			logger.Write("LoggerTest, Shutdown " + std::to_string(i));
+		Logger::ShutdownResult result = logger.Shutdown(std::chrono::seconds(10));
+		EXPECT_TRUE(result.complete);
+		EXPECT_EQ(result.discarded, 0u);
+		EXPECT_EQ(result.unflushed, 0u);
+
+		// Writes after shutdown are dropped and the thread is not restarted
+		uint64_t dropped = logger.GetStats().dropped;
+		logger.Write("LoggerTest, Shutdown after");
+		EXPECT_EQ(logger.GetStats().dropped, dropped + 1);
+		EXPECT_FALSE(logger.WriteDurable("LoggerTest, Shutdown durable").get());
+		EXPECT_TRUE(logger.Shutdown(std::chrono::seconds(10)).complete);
+	}
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerShutdown.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, Shutdown 999\n"), string::npos);
+	EXPECT_EQ(contents.find("LoggerTest, Shutdown after"), string::npos);
+	RemoveLogFile("LoggerShutdown.txt");
+	remove("LoggerShutdown.hwm");
+
+	{
+		// A passed deadline leaves the messages not yet written or flushed
+		Logger logger("LoggerShutdown");
+		logger.Start();
+		for (int i = 0; i < 1000; i++)
+			logger.Write("LoggerTest, Shutdown " + std::to_string(i));
+		Logger::ShutdownResult result = logger.Shutdown(std::chrono::milliseconds(0));
+		EXPECT_FALSE(result.complete);
+		EXPECT_GT(result.discarded + result.unflushed, 0u);
+		EXPECT_LE(result.discarded + result.unflushed, 1000u);
+	}
+	RemoveLogFile("LoggerShutdown.txt");
+	remove("LoggerShutdown.hwm");
+}
+
+static TraceContext traceFirstHop;
+static TraceContext traceSecondHop;
+static WorkerThread* traceSecondThread = nullptr;
+static Logger* traceLogger = nullptr;
+
+static void TraceSecondHop()
+{
+	traceSecondHop = GetTraceContext();
+	traceLogger->Write("LoggerTest, TraceContext second hop");
+}
+
+static void TraceFirstHop()
+{
+	traceFirstHop = GetTraceContext();
+	MakeDelegate(&TraceSecondHop, *traceSecondThread, WAIT_INFINITE)();
+}
+
+// Test a sampled trace context follows a chain of delegate calls across
+// threads and tags the records written within it
+TEST(Logger_IT, TraceContext)
+{
+	RemoveLogFile("LoggerTrace.txt");
+	WorkerThread first("TraceFirstThread");
+	WorkerThread second("TraceSecondThread");
+	first.CreateThread();
+	second.CreateThread();
+	traceSecondThread = &second;
+	{
+		Logger logger("LoggerTrace");
+		logger.Start();
+		traceLogger = &logger;
+
+		// Not sampled while sampling is off
+		MakeDelegate(&TraceFirstHop, first, WAIT_INFINITE)();
+		EXPECT_FALSE(traceFirstHop.IsSampled());
+		EXPECT_FALSE(traceSecondHop.IsSampled());
+
+		SetTraceSampling(1);
+		EXPECT_FALSE(GetTraceContext().IsSampled());
+		MakeDelegate(&TraceFirstHop, first, WAIT_INFINITE)();
+		SetTraceSampling(0);
+		ASSERT_TRUE(traceFirstHop.IsSampled());
+		EXPECT_EQ(traceFirstHop.parentId, 0u);
+		EXPECT_EQ(traceSecondHop.traceId, traceFirstHop.traceId);
+		EXPECT_EQ(traceSecondHop.parentId, traceFirstHop.spanId);
+		EXPECT_NE(traceSecondHop.spanId, traceFirstHop.spanId);
+		EXPECT_EQ(traceSecondHop.startNs, traceFirstHop.startNs);
+
+		// The calling thread's context is restored after each call
+		EXPECT_FALSE(GetTraceContext().IsSampled());
+
+		// An explicit head is sampled 1 in N
+		SetTraceSampling(4);
+		int sampled = 0;
+		for (int i = 0; i < 100; i++)
+			sampled += StartTrace().IsSampled() ? 1 : 0;
+		SetTraceSampling(0);
+		// Other threads creating messages meanwhile take some of the samples
+		EXPECT_GE(sampled, 20);
+		EXPECT_LE(sampled, 30);
+		{
+			TraceContext head;
+			head.traceId = head.spanId = 42;
+			TraceContextScope scope(head);
+			logger.Write("LoggerTest, TraceContext head");
+		}
+		EXPECT_TRUE(logger.Shutdown(std::chrono::seconds(10)).complete);
+		traceLogger = nullptr;
+	}
+	first.ExitThread();
+	second.ExitThread();
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerTrace.txt", contents));
+	char tag[64];
+	snprintf(tag, sizeof(tag), "[trace=%016llx span=%016llx", (unsigned long long)traceSecondHop.traceId,
+		(unsigned long long)traceSecondHop.spanId);
+	size_t pos = contents.find(tag);
+	EXPECT_NE(pos, string::npos);
+	EXPECT_NE(contents.find("LoggerTest, TraceContext second hop", pos), string::npos);
+	EXPECT_NE(contents.find("[trace=000000000000002a span=000000000000002a"), string::npos);
+
+	// Only the sampled call of the two is tagged
+	EXPECT_EQ(contents.find("[trace="), pos);
+	RemoveLogFile("LoggerTrace.txt");
+	remove("LoggerTrace.hwm");
+}
+
+static std::atomic<size_t> budgetBytes{ 0 };
+static void BudgetTarget(std::vector<char> data) { budgetBytes += data.size(); }
+
+// Test byte budgets of the delegate and Logger queues
+TEST(Logger_IT, QueueByteBudget)
+{
+	// Argument copies count their heap memory
+	std::string shortString = "short";
+	std::string longString(100, 'x');
+	std::vector<int> ints(1000);
+	std::vector<std::string> strings(2, longString);
+	EXPECT_EQ(arg_size<std::string>::Size(shortString), 0u);
+	EXPECT_EQ(arg_size<std::string>::Size(longString), 101u);
+	EXPECT_EQ(arg_size<std::vector<int>>::Size(ints), 4000u);
+	EXPECT_EQ(arg_size<std::vector<std::string>>::Size(strings), 2 * sizeof(std::string) + 202);
+	size_t bytes = arg_bytes<int, const std::string&, std::vector<int>*>(1, longString, &ints);
+	EXPECT_EQ(bytes, 4101u);
+	EXPECT_EQ(arg_bytes<std::vector<int>*>(nullptr), 0u);
+
+	DelegateAsyncMsg<std::vector<char>> payload(nullptr, std::vector<char>(1000));
+	EXPECT_EQ(payload.GetPayloadSize(), sizeof(payload) + 1000);
+
+	budgetBytes = 0;
+	WorkerThread thread("QueueByteBudget");
+	ASSERT_TRUE(thread.CreateThread());
+	thread.SetQueueByteBudget(64 * 1024);
+	EXPECT_EQ(thread.GetQueueByteBudget(), 64u * 1024);
+
+	// Hold the thread so dispatched messages stay queued
+	promise<void> started;
+	promise<void> release;
+	future<void> running = started.get_future();
+	shared_future<void> released = release.get_future().share();
+	MakeDelegate(std::function<void()>([&started, released]() {
+		started.set_value();
+		released.wait();
+	}), thread)();
+	running.wait();
+
+	// A message over the budget is dropped, while smaller ones still fit
+	thread.SetQueueOverflow(WorkerThread::QueueOverflow::DROP);
+	auto async = MakeDelegate(&BudgetTarget, thread);
+	async(std::vector<char>(40 * 1024));
+	async(std::vector<char>(40 * 1024));
+	async(std::vector<char>(1024));
+	WorkerThread::Stats stats = thread.GetStats();
+	EXPECT_EQ(stats.dropped, 1u);
+	EXPECT_GT(stats.queuedBytes, 41u * 1024);
+	EXPECT_LT(stats.queuedBytes, 42u * 1024);
+
+	// Or the sender blocks until the thread takes enough bytes
+	thread.SetQueueOverflow(WorkerThread::QueueOverflow::BLOCK);
+	atomic<bool> sent(false);
+	std::thread sender([&]() {
+		async(std::vector<char>(40 * 1024));
+		sent = true;
+	});
+	this_thread::sleep_for(milliseconds(20));
+	EXPECT_FALSE(sent.load());
+	release.set_value();
+	sender.join();
+	EXPECT_TRUE(sent.load());
+
+	// A message larger than the budget is admitted to an empty queue
+	thread.SetQueueByteBudget(1024);
+	MakeDelegate(&BudgetTarget, thread, WAIT_INFINITE)(std::vector<char>(4096));
+	MakeDelegate(&BudgetTarget, thread, WAIT_INFINITE)(std::vector<char>(4096));
+	stats = thread.GetStats();
+	EXPECT_EQ(stats.queuedBytes, 0u);
+	EXPECT_GT(stats.peakQueuedBytes, 41u * 1024);
+	EXPECT_LE(stats.peakQueuedBytes, 64u * 1024);
+	thread.ExitThread();
+	EXPECT_EQ(budgetBytes.load(), 41u * 1024 + 40 * 1024 + 2 * 4096);
+
+	// A Logger writer blocked by the budget continues once the queue is taken
+	{
+		Logger logger("LoggerByteBudget");
+		logger.SetQueueByteBudget(16);
+		for (int i = 0; i < 100; i++)
+			logger.Write("LoggerTest, QueueByteBudget message longer than the budget");
+		EXPECT_TRUE(logger.Shutdown(std::chrono::seconds(10)).complete);
+		Logger::Stats loggerStats = logger.GetStats();
+		EXPECT_EQ(loggerStats.dropped, 0u);
+		EXPECT_EQ(loggerStats.queueBytes, 0u);
+	}
+	RemoveLogFile("LoggerByteBudget.txt");
+	remove("LoggerByteBudget.hwm");
+}
+
+// Test the multi-pattern record filter and router
+TEST(Logger_IT, LogFilter)
+{
+	// The first matching rule wins, whichever pattern ends first
+	{
+		LogFilter filter({ { "hers" }, { "she" }, { "he" }, { "ERROR", LogFilter::Match::PREFIX }, { "" } });
+		EXPECT_EQ(filter.Find("ushers"), &filter.GetRules()[0]);
+		EXPECT_EQ(filter.Find("usher"), &filter.GetRules()[1]);
+		EXPECT_EQ(filter.Find("the"), &filter.GetRules()[2]);
+		EXPECT_EQ(filter.Find("ERROR: disk"), &filter.GetRules()[3]);
+		EXPECT_EQ(filter.Find("an ERROR"), nullptr);
+		EXPECT_EQ(filter.Find(""), nullptr);
+		EXPECT_EQ(filter.Find("no match"), nullptr);
+
+		// A prefix matches after the timestamp
+		std::string stamped = "ERROR: stamped";
+		LogTimestamp::Stamp(stamped);
+		EXPECT_EQ(filter.Find(stamped), &filter.GetRules()[3]);
+	}
+
+	// Matches a few hundred patterns as the patterns one by one do
+	{
+		std::mt19937 random(145);
+		auto randomText = [&random](size_t length) {
+			std::string text;
+			for (size_t i = 0; i < length; i++)
+				text += (char)('a' + random() % 4);
+			return text;
+		};
+		std::vector<LogFilter::Rule> rules;
+		for (int i = 0; i < 300; i++)
+			rules.push_back({ randomText(3 + random() % 6), random() % 4 ? LogFilter::Match::SUBSTRING : LogFilter::Match::PREFIX });
+		LogFilter filter(rules);
+		for (int i = 0; i < 500; i++)
+		{
+			std::string record = randomText(random() % 40);
+			const LogFilter::Rule* expected = nullptr;
+			for (const LogFilter::Rule& rule : filter.GetRules())
+			{
+				bool match = rule.match == LogFilter::Match::PREFIX ? record.compare(0, rule.pattern.size(), rule.pattern) == 0 :
+					record.find(rule.pattern) != std::string::npos;
+				if (match)
+				{
+					expected = &rule;
+					break;
+				}
+			}
+			EXPECT_EQ(filter.Find(record), expected) << record;
+		}
+	}
+
+	RemoveLogFile("LoggerFilter.txt");
+	RemoveLogFile("LoggerFilterRoute.txt");
+	{
+		Logger route("LoggerFilterRoute");
+		Logger logger("LoggerFilter");
+		route.SetTimestamps(true);
+		route.Start();
+		logger.Start();
+		EXPECT_TRUE(logger.SetFilter(std::make_shared<LogFilter>(std::vector<LogFilter::Rule>{
+			{ "noise" }, { "PII", LogFilter::Match::PREFIX, &route } })));
+		EXPECT_NE(logger.GetFilter(), nullptr);
+
+		// A route back to the routing Logger is rejected, a route to itself keeps the record
+		EXPECT_FALSE(route.SetFilter(std::make_shared<LogFilter>(std::vector<LogFilter::Rule>{
+			{ "PII", LogFilter::Match::SUBSTRING, &logger } })));
+		EXPECT_EQ(route.GetFilter(), nullptr);
+		EXPECT_TRUE(route.SetFilter(std::make_shared<LogFilter>(std::vector<LogFilter::Rule>{
+			{ "PII", LogFilter::Match::SUBSTRING, &route } })));
+
+		logger.Write("LoggerTest, LogFilter kept");
+		logger.Write("LoggerTest, LogFilter noise");
+		logger.Write("PII LoggerTest, LogFilter routed");
+		logger.Write("LoggerTest, LogFilter batch noise");
+		logger.Write("LoggerTest, LogFilter batch kept");
+		EXPECT_TRUE(logger.WriteDurable("LoggerTest, LogFilter durable").get());
+
+		// A new filter applies to the records written after it
+		logger.SetFilter(nullptr);
+		EXPECT_EQ(logger.GetFilter(), nullptr);
+		logger.Write("LoggerTest, LogFilter noise unfiltered");
+		EXPECT_TRUE(logger.Shutdown(std::chrono::seconds(10)).complete);
+		EXPECT_TRUE(route.Shutdown(std::chrono::seconds(10)).complete);
+
+		Logger::Stats stats = logger.GetStats();
+		EXPECT_EQ(stats.filtered, 2u);
+		EXPECT_EQ(stats.routed, 1u);
+		EXPECT_EQ(stats.routeDropped, 0u);
+	}
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerFilter.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, LogFilter kept"), string::npos);
+	EXPECT_NE(contents.find("LoggerTest, LogFilter batch kept"), string::npos);
+	EXPECT_NE(contents.find("LoggerTest, LogFilter noise unfiltered"), string::npos);
+	EXPECT_EQ(contents.find("LoggerTest, LogFilter noise\n"), string::npos);
+	EXPECT_EQ(contents.find("batch noise"), string::npos);
+	EXPECT_EQ(contents.find("PII"), string::npos);
+
+	string routed;
+	EXPECT_TRUE(ReadLogFile("LoggerFilterRoute.txt", routed));
+	EXPECT_NE(routed.find("Z PII LoggerTest, LogFilter routed"), string::npos);
+	RemoveLogFile("LoggerFilter.txt");
+	RemoveLogFile("LoggerFilterRoute.txt");
+
+	// The Logger thread drops a rerouted record rather than wait for a full queue
+	{
+		Logger route("LoggerFilterRoute");
+		Logger logger("LoggerFilter");
+		route.Start();
+		logger.Start();
+		EXPECT_TRUE(logger.SetFilter(std::make_shared<LogFilter>(std::vector<LogFilter::Rule>{
+			{ "PII", LogFilter::Match::PREFIX, &route } })));
+
+		static SignalThread routeBlocked;
+		static SignalThread routeRelease;
+		std::function<void(void)> BlockRouteFunc = []() {
+			routeBlocked.SetSignal();
+			routeRelease.WaitForSignal(2000);
+		};
+		MakeDelegate(BlockRouteFunc, route).AsyncInvoke();
+		EXPECT_TRUE(routeBlocked.WaitForSignal(500));
+		route.SetQueueCapacity(1, Logger::BackpressurePolicy::BLOCK);
+
+		for (int i = 0; i < 3; i++)
+			logger.Write("PII LoggerTest, LogFilter full");
+		auto durable = logger.WriteDurable("LoggerTest, LogFilter full kept");
+		EXPECT_EQ(durable.wait_for(seconds(1)), future_status::ready);
+		routeRelease.SetSignal();
+
+		Logger::Stats stats = logger.GetStats();
+		EXPECT_EQ(stats.routed, 1u);
+		EXPECT_EQ(stats.routeDropped, 2u);
+		EXPECT_EQ(route.GetStats().dropped, 2u);
+		EXPECT_TRUE(logger.Shutdown(std::chrono::seconds(10)).complete);
+		EXPECT_TRUE(route.Shutdown(std::chrono::seconds(10)).complete);
+	}
+
+	RemoveLogFile("LoggerFilter.txt");
+	RemoveLogFile("LoggerFilterRoute.txt");
+	remove("LoggerFilter.hwm");
+	remove("LoggerFilterRoute.hwm");
+}
+
+// One Logger configuration of the LoggerMatrix suite
+struct LoggerConfig
+{
+	enum class Queue { MUTEX, LOCK_FREE, STAGED };
+	enum class Flush { LATENCY, RECORDS };
+	enum class Sink { NONE, STREAM, FILE };
+
+	Queue queue;
+	Flush flush;
+	Sink sink;
+	int threads;
+
+	std::string Name() const
+	{
+		static const char* queues[] = { "Mutex", "LockFree", "Staged" };
+		static const char* flushes[] = { "Latency", "Records" };
+		static const char* sinks[] = { "NoSink", "StreamSink", "FileSink" };
+		return std::string(queues[(int)queue]) + "_" + flushes[(int)flush] + "_" + sinks[(int)sink] + "_" +
+			std::to_string(threads) + "Threads";
+	}
+};
+
+// Runs each test over every Logger configuration and reports the timing of 
+// each combination in one table. Run one part of the matrix with a filter, 
+// e.g. GTEST_FILTER=*LoggerMatrix*Staged*. The report is written to
+// LoggerMatrix.csv, or the file named by LOGGER_MATRIX_REPORT, once the suite
+// ends within the process. LOGGER_MATRIX_RECORDS sets the records written per
+// configuration.
+class LoggerMatrix : public ::testing::TestWithParam<std::tuple<LoggerConfig::Queue, LoggerConfig::Flush, LoggerConfig::Sink, int>>
+{
+public:
+	static int GetRecords()
+	{
+		const char* records = getenv("LOGGER_MATRIX_RECORDS");
+		return records && atoi(records) > 0 ? atoi(records) : 4000;
+	}
+
+	struct Result
+	{
+		std::string name;
+		double writeMs;
+		double totalMs;
+		uint64_t written;
+		uint64_t dropped;
+	};
+
+	static LoggerConfig GetConfig(const ParamType& param)
+	{
+		return LoggerConfig{ std::get<0>(param), std::get<1>(param), std::get<2>(param), std::get<3>(param) };
+	}
+
+	static void TearDownTestSuite()
+	{
+		const char* path = getenv("LOGGER_MATRIX_REPORT");
+		std::ofstream report(path ? path : "LoggerMatrix.csv");
+		report << "config,write ms,total ms,records per second,written,dropped\n";
+		std::cout << std::left << std::setw(40) << "Logger configuration" << std::right << std::setw(12) << "Write ms"
+			<< std::setw(12) << "Total ms" << std::setw(14) << "Records/s" << std::endl;
+		for (const Result& r : GetResults())
+		{
+			double rate = r.totalMs > 0 ? r.written * 1000.0 / r.totalMs : 0;
+			report << r.name << "," << r.writeMs << "," << r.totalMs << "," << (uint64_t)rate << "," << r.written << ","
+				<< r.dropped << "\n";
+			std::cout << std::left << std::setw(40) << r.name << std::right << std::fixed << std::setprecision(2)
+				<< std::setw(12) << r.writeMs << std::setw(12) << r.totalMs << std::setw(14) << (uint64_t)rate << std::endl;
+		}
+		GetResults().clear();
+	}
+
+protected:
+	static std::vector<Result>& GetResults()
+	{
+		static std::vector<Result> results;
+		return results;
+	}
+
+	/// Apply the configuration to a Logger
+	void Configure(Logger& logger, const LoggerConfig& config)
+	{
+		logger.SetLockFreeWrite(config.queue == LoggerConfig::Queue::LOCK_FREE);
+		logger.SetStagedWrite(config.queue == LoggerConfig::Queue::STAGED);
+
+		Logger::FlushTrigger trigger;
+		if (config.flush == LoggerConfig::Flush::RECORDS)
+			trigger.maxRecords = 256;
+		logger.SetFlushTrigger(trigger);
+
+		if (config.sink == LoggerConfig::Sink::STREAM)
+			m_sink = make_shared<LogStreamSink>(m_stream);
+		else if (config.sink == LoggerConfig::Sink::FILE)
+			m_sink = make_shared<LogFileSink>("LoggerMatrixSink.txt");
+		if (m_sink)
+			logger.AddSink(m_sink);
+	}
+
+	std::ostringstream m_stream;
+	std::shared_ptr<LogSink> m_sink;
+};
+
+// Test the write throughput of each Logger configuration
+TEST_P(LoggerMatrix, Throughput)
+{
+	const LoggerConfig config = GetConfig(GetParam());
+	RemoveLogFile("LoggerMatrix.txt");
+	remove("LoggerMatrixSink.txt");
+
+	const int records = GetRecords();
+	Result result{ config.Name(), 0, 0, 0, 0 };
+	{
+		Logger logger("LoggerMatrix");
+		Configure(logger, config);
+		logger.Start();
+
+		auto start = steady_clock::now();
+		vector<std::thread> writers;
+		for (int t = 0; t < config.threads; t++)
+		{
+			writers.emplace_back([&logger, t, &config, records]() {
+				for (int i = t; i < records; i += config.threads)
+					logger.Write("LoggerTest, LoggerMatrix record " + to_string(i));
+			});
+		}
+		for (auto& writer : writers)
+			writer.join();
+		auto written = steady_clock::now();
+
+		EXPECT_TRUE(logger.Shutdown(seconds(30)).complete);
+		if (m_sink)
+			logger.RemoveSink(m_sink);
+		auto done = steady_clock::now();
+
+		Logger::Stats stats = logger.GetStats();
+		result.writeMs = duration<double, std::milli>(written - start).count();
+		result.totalMs = duration<double, std::milli>(done - start).count();
+		result.written = stats.enqueued;
+		result.dropped = stats.dropped;
+		EXPECT_EQ(stats.dropped, 0u);
+	}
+	GetResults().push_back(result);
+
+	string contents;
+	EXPECT_TRUE(ReadLogFile("LoggerMatrix.txt", contents));
+	EXPECT_NE(contents.find("LoggerTest, LoggerMatrix record " + to_string(records - 1)), string::npos);
+	RemoveLogFile("LoggerMatrix.txt");
+	remove("LoggerMatrix.hwm");
+	remove("LoggerMatrixSink.txt");
+}
+
+INSTANTIATE_TEST_SUITE_P(Logger_IT, LoggerMatrix,
+	::testing::Combine(
+		::testing::Values(LoggerConfig::Queue::MUTEX, LoggerConfig::Queue::LOCK_FREE, LoggerConfig::Queue::STAGED),
+		::testing::Values(LoggerConfig::Flush::LATENCY, LoggerConfig::Flush::RECORDS),
+		::testing::Values(LoggerConfig::Sink::NONE, LoggerConfig::Sink::STREAM, LoggerConfig::Sink::FILE),
+		::testing::Values(1, 4)),
+	[](const ::testing::TestParamInfo<LoggerMatrix::ParamType>& info) { return LoggerMatrix::GetConfig(info.param).Name(); });
+
+// Each core's Logger shard, created by the core's init function
+static std::unique_ptr<Logger> coreShards[2];
+static thread_local Logger* coreShard = nullptr;
+
+static void CoreShardWrite(int seq)
+{
+	coreShard->Write("LoggerTest, CoreShards " + to_string(seq) + " on core " +
+		to_string(CoreGroup::CurrentCore()->GetIndex()));
+}
+
+// Test each core of a thread-per-core group writes the Logger shard it owns
+TEST(Logger_IT, CoreShards)
+{
+	unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+	RemoveLogFile("LoggerCore0.txt");
+	RemoveLogFile("LoggerCore1.txt");
+	{
+		CoreGroup group("CoreShards", { 0, std::min(1u, cpus - 1) }, 64);
+
+		// Each core creates the Logger shard it writes
+		group.Start([](CoreThread& core) {
+			coreShards[core.GetIndex()].reset(new Logger("LoggerCore" + to_string(core.GetIndex())));
+			coreShard = coreShards[core.GetIndex()].get();
+		});
+		for (int i = 0; i < 2; i++)
+			MakeDelegate(&CoreShardWrite, group.GetCore(i), WAIT_INFINITE).AsyncInvoke(i);
+		group.Stop();
+
+		for (auto& shard : coreShards)
+		{
+			EXPECT_TRUE(shard->WriteDurable("LoggerTest, CoreShards end").get());
+			shard.reset();
+		}
+	}
+
+	// Each core's records are in its own shard
+	string contents0, contents1;
+	EXPECT_TRUE(ReadLogFile("LoggerCore0.txt", contents0));
+	EXPECT_TRUE(ReadLogFile("LoggerCore1.txt", contents1));
+	EXPECT_NE(contents0.find("LoggerTest, CoreShards 0 on core 0\n"), string::npos);
+	EXPECT_EQ(contents0.find("on core 1"), string::npos);
+	EXPECT_NE(contents1.find("LoggerTest, CoreShards 1 on core 1\n"), string::npos);
+	EXPECT_EQ(contents1.find("on core 0"), string::npos);
+
+	// Test cleanup
+	RemoveLogFile("LoggerCore0.txt");
+	RemoveLogFile("LoggerCore1.txt");
+	remove("LoggerCore0.hwm");
+	remove("LoggerCore1.hwm");
+}
+
+// Test writes queued while the Logger thread is awake make no wakeup
+TEST(Logger_IT, WakeupSuppression)
+{
+	static const int CALLS = 1000;
+
+	{
+		Logger logger("LoggerWakeups");
+		for (int i = 0; i < CALLS; i++)
+			logger.Write("LoggerTest, WakeupSuppression " + to_string(i));
+		EXPECT_TRUE(logger.WriteDurable("LoggerTest, WakeupSuppression end").get());
+		Logger::Stats stats = logger.GetStats();
+		EXPECT_GT(stats.wakeups, 0u);
+		EXPECT_GT(stats.wakeupsAvoided, 0u);
+		EXPECT_LT(stats.wakeups, (uint64_t)CALLS);
+	}
+	RemoveLogFile("LoggerWakeups.txt");
+	remove("LoggerWakeups.hwm");
+}
+
 // Dummy function to force linker to keep the code in this file
-void Logger_IT_ForceLink() { }
\ No newline at end of file
+void Logger_IT_ForceLink() { }
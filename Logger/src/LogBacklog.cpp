@@ -0,0 +1,349 @@
+#include "LogBacklog.h"
+#include <cstring>
+
+#ifdef LOGGER_LZ4
+#include <lz4.h>
+#elif defined(LOGGER_ZLIB)
+#include <zlib.h>
+#endif
+
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// CompressBlock
+//----------------------------------------------------------------------------
+static bool CompressBlock(const std::string& raw, std::string& out)
+{
+#ifdef LOGGER_LZ4
+	out.resize((size_t)LZ4_compressBound((int)raw.size()));
+	int size = LZ4_compress_default(raw.data(), &out[0], (int)raw.size(), (int)out.size());
+	if (size <= 0)
+		return false;
+	out.resize((size_t)size);
+	return true;
+#elif defined(LOGGER_ZLIB)
+	uLongf size = compressBound((uLong)raw.size());
+	out.resize(size);
+	if (compress2((Bytef*)&out[0], &size, (const Bytef*)raw.data(), (uLong)raw.size(), Z_BEST_SPEED) != Z_OK)
+		return false;
+	out.resize(size);
+	return true;
+#else
+	(void)raw;
+	(void)out;
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// DecompressBlock
+//----------------------------------------------------------------------------
+static bool DecompressBlock(const std::string& data, size_t rawSize, std::string& raw)
+{
+	raw.resize(rawSize);
+#ifdef LOGGER_LZ4
+	return LZ4_decompress_safe(data.data(), &raw[0], (int)data.size(), (int)rawSize) == (int)rawSize;
+#elif defined(LOGGER_ZLIB)
+	uLongf size = (uLongf)rawSize;
+	return uncompress((Bytef*)&raw[0], &size, (const Bytef*)data.data(), (uLong)data.size()) == Z_OK && size == rawSize;
+#else
+	(void)data;
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// LogBacklog
+//----------------------------------------------------------------------------
+LogBacklog::LogBacklog(const std::string& spillFileName) : m_spillFileName(spillFileName),
+	THREAD_NAME("LogBacklogThread"), m_records(0), m_bytes(0), m_memoryBytes(0), m_spilledBytes(0)
+{
+}
+
+//----------------------------------------------------------------------------
+// ~LogBacklog
+//----------------------------------------------------------------------------
+LogBacklog::~LogBacklog()
+{
+	if (m_thread)
+	{
+		{
+			std::unique_lock<std::mutex> lk(m_mutex);
+			m_exit = true;
+			m_cv.notify_all();
+		}
+		m_thread->join();
+		m_thread = nullptr;
+	}
+
+	if (m_spillFile)
+	{
+		fclose(m_spillFile);
+		remove(m_spillFileName.c_str());
+	}
+}
+
+//----------------------------------------------------------------------------
+// GetCodec
+//----------------------------------------------------------------------------
+const char* LogBacklog::GetCodec()
+{
+#ifdef LOGGER_LZ4
+	return "lz4";
+#elif defined(LOGGER_ZLIB)
+	return "zlib";
+#else
+	return "none";
+#endif
+}
+
+//----------------------------------------------------------------------------
+// SetMemoryCap
+//----------------------------------------------------------------------------
+void LogBacklog::SetMemoryCap(size_t memoryCap)
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_memoryCap = memoryCap;
+	m_cv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// MakeBlock
+//----------------------------------------------------------------------------
+LogBacklog::Block LogBacklog::MakeBlock(const LogBuffer& buffer)
+{
+	Block block;
+	block.data.reserve(buffer.Bytes() + buffer.Size() * sizeof(uint32_t));
+	for (std::string_view record : buffer)
+	{
+		uint32_t len = (uint32_t)record.size();
+		block.data.append((const char*)&len, sizeof(len));
+		block.data.append(record.data(), record.size());
+	}
+	block.rawSize = block.data.size();
+	block.records = buffer.Size();
+	block.bytes = buffer.Bytes();
+	return block;
+}
+
+//----------------------------------------------------------------------------
+// Seal
+//----------------------------------------------------------------------------
+void LogBacklog::Seal(const LogBuffer& buffer)
+{
+	if (buffer.Empty())
+		return;
+	Block block = MakeBlock(buffer);
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_blocks.push_back(std::move(block));
+	Added(m_blocks.back());
+}
+
+//----------------------------------------------------------------------------
+// PushFront
+//----------------------------------------------------------------------------
+void LogBacklog::PushFront(const LogBuffer& buffer)
+{
+	if (buffer.Empty())
+		return;
+	Block block = MakeBlock(buffer);
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_blocks.push_front(std::move(block));
+	Added(m_blocks.front());
+}
+
+//----------------------------------------------------------------------------
+// Added
+//----------------------------------------------------------------------------
+void LogBacklog::Added(const Block& block)
+{
+	m_records.fetch_add(block.records, std::memory_order_relaxed);
+	m_bytes.fetch_add(block.bytes, std::memory_order_relaxed);
+	m_memoryBytes.fetch_add(block.data.size(), std::memory_order_relaxed);
+
+	if (!m_thread)
+	{
+		m_thread = std::unique_ptr<std::thread>(new thread(&LogBacklog::Process, this));
+
+#ifdef WIN32
+		// Set the thread name so it shows in the Visual Studio Debug Location toolbar
+		std::wstring wstr(THREAD_NAME.begin(), THREAD_NAME.end());
+		SetThreadDescription(m_thread->native_handle(), wstr.c_str());
+#endif
+	}
+	m_cv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// TakeOldest
+//----------------------------------------------------------------------------
+bool LogBacklog::TakeOldest(LogBuffer& buffer)
+{
+	Block block;
+	{
+		std::unique_lock<std::mutex> lk(m_mutex);
+		if (m_blocks.empty())
+			return false;
+
+		// Wait for the background thread to finish with the block
+		m_cv.wait(lk, [this]() { return !m_blocks.front().busy; });
+		block = std::move(m_blocks.front());
+		m_blocks.pop_front();
+	}
+
+	bool success = true;
+	if (block.state == State::SPILLED)
+	{
+		const std::lock_guard<std::mutex> lock(m_fileMutex);
+		block.data.resize(block.spillSize);
+		success = m_spillFile && fseek(m_spillFile, (long)block.offset, SEEK_SET) == 0 &&
+			fread(&block.data[0], 1, block.spillSize, m_spillFile) == block.spillSize;
+	}
+
+	std::string decompressed;
+	if (success && block.compressed)
+		success = DecompressBlock(block.data, block.rawSize, decompressed);
+	if (!success)
+	{
+		// Keep the block for the next attempt
+		std::unique_lock<std::mutex> lk(m_mutex);
+		m_blocks.push_front(std::move(block));
+		return false;
+	}
+
+	const std::string& raw = block.compressed ? decompressed : block.data;
+	for (size_t offset = 0; offset + sizeof(uint32_t) <= raw.size(); )
+	{
+		uint32_t len;
+		memcpy(&len, raw.data() + offset, sizeof(len));
+		offset += sizeof(len);
+		buffer.Append(raw.data() + offset, len);
+		offset += len;
+	}
+
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_records.fetch_sub(block.records, std::memory_order_relaxed);
+	m_bytes.fetch_sub(block.bytes, std::memory_order_relaxed);
+	if (block.state == State::SPILLED)
+		m_spilledBytes.fetch_sub(block.spillSize, std::memory_order_relaxed);
+	else
+		m_memoryBytes.fetch_sub(block.data.size(), std::memory_order_relaxed);
+
+	// Reuse the spill file from the start once it holds nothing. No spill is
+	// in progress since a busy block would still be held.
+	if (m_blocks.empty())
+		m_spillEnd = 0;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// WaitIdle
+//----------------------------------------------------------------------------
+void LogBacklog::WaitIdle()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_cv.wait(lk, [this]() {
+		for (const Block& block : m_blocks)
+		{
+			if (block.busy)
+				return false;
+		}
+		return FindWork() == nullptr;
+	});
+}
+
+//----------------------------------------------------------------------------
+// FindWork
+//----------------------------------------------------------------------------
+LogBacklog::Block* LogBacklog::FindWork()
+{
+	// Compress the oldest raw block first
+	for (Block& block : m_blocks)
+	{
+		if (block.state == State::RAW && !block.busy)
+			return &block;
+	}
+
+	// Spill the newest blocks since the oldest are written to disk first
+	if (m_memoryCap && m_memoryBytes.load(std::memory_order_relaxed) > m_memoryCap && !m_spillFailed)
+	{
+		for (auto it = m_blocks.rbegin(); it != m_blocks.rend(); ++it)
+		{
+			if (it->state == State::COMPRESSED && !it->busy)
+				return &*it;
+		}
+	}
+	return nullptr;
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void LogBacklog::Process()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	while (1)
+	{
+		Block* block = nullptr;
+		m_cv.wait(lk, [this, &block]() {
+			block = FindWork();
+			return block || m_exit;
+		});
+		if (m_exit)
+			return;
+
+		// The owner waits for a busy block so its data is read without the lock
+		block->busy = true;
+		if (block->state == State::RAW)
+		{
+			lk.unlock();
+			std::string compressed;
+			bool success = CompressBlock(block->data, compressed) && compressed.size() < block->data.size();
+			lk.lock();
+
+			// Incompressible blocks are kept as they are
+			if (success)
+			{
+				m_memoryBytes.fetch_sub(block->data.size() - compressed.size(), std::memory_order_relaxed);
+				block->data.swap(compressed);
+				block->compressed = true;
+			}
+			block->state = State::COMPRESSED;
+		}
+		else
+		{
+			uint64_t offset = m_spillEnd;
+			size_t size = block->data.size();
+			m_spillEnd += size;
+			lk.unlock();
+			bool success;
+			{
+				const std::lock_guard<std::mutex> lock(m_fileMutex);
+				if (!m_spillFile)
+					m_spillFile = fopen(m_spillFileName.c_str(), "w+b");
+				success = m_spillFile && fseek(m_spillFile, (long)offset, SEEK_SET) == 0 &&
+					fwrite(block->data.data(), 1, size, m_spillFile) == size && fflush(m_spillFile) == 0;
+			}
+			lk.lock();
+
+			// Blocks stay in memory if the spill file fails so none is dropped
+			if (success)
+			{
+				block->offset = offset;
+				block->spillSize = size;
+				block->state = State::SPILLED;
+				std::string().swap(block->data);
+				m_memoryBytes.fetch_sub(size, std::memory_order_relaxed);
+				m_spilledBytes.fetch_add(size, std::memory_order_relaxed);
+			}
+			else
+				m_spillFailed = true;
+		}
+		block->busy = false;
+		m_cv.notify_all();
+	}
+}
@@ -0,0 +1,155 @@
+#ifndef _LOG_BACKLOG_H
+#define _LOG_BACKLOG_H
+
+#include "LogBuffer.h"
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+
+/// @brief LogBacklog holds sealed blocks of log records that could not be 
+/// written to disk yet, oldest first, with bounded memory. A background thread
+/// compresses each sealed block in memory, with LZ4 if the build has it 
+/// (LOGGER_LZ4), otherwise with zlib at its fastest level (LOGGER_ZLIB). Once
+/// the blocks held in memory exceed the memory cap, the newest blocks are 
+/// spilled to a temporary file. No record is dropped: blocks that cannot be 
+/// compressed or spilled stay in memory.
+///
+/// @details Seal(), PushFront() and TakeOldest() must be called from a single 
+/// owner thread. Blocks are not included in LogData::EmergencyFlush() since 
+/// restoring them allocates; spilled blocks remain in the spill file.
+class LogBacklog
+{
+public:
+	/// Constructor
+	/// @param[in] spillFileName - the temporary file spilled blocks are written to
+	explicit LogBacklog(const std::string& spillFileName);
+
+	/// Destructor. Removes the spill file.
+	~LogBacklog();
+
+	/// Get the name of the compression used by this build
+	/// @return "lz4", "zlib" or "none".
+	static const char* GetCodec();
+
+	/// Set the bytes of blocks held in memory before newer blocks are spilled
+	/// @param[in] memoryCap - the memory cap in bytes, or 0 to never spill
+	void SetMemoryCap(size_t memoryCap);
+
+	/// Copy the records of a buffer into a new block after all other blocks
+	/// @param[in] buffer - the records to seal
+	void Seal(const LogBuffer& buffer);
+
+	/// Copy the records of a buffer into a new block ahead of all other blocks,
+	/// e.g. to retry a block whose write failed
+	/// @param[in] buffer - the records to seal
+	void PushFront(const LogBuffer& buffer);
+
+	/// Remove the oldest block and append its records to a buffer
+	/// @param[out] buffer - the records are appended
+	/// @return True if a block was taken. False if the backlog is empty or the
+	///     spilled block could not be read back.
+	bool TakeOldest(LogBuffer& buffer);
+
+	/// Check if any block is held
+	/// @return True if no block is held.
+	bool Empty() const { return m_records.load(std::memory_order_relaxed) == 0; }
+
+	/// Get the number of records held
+	/// @return The record count.
+	size_t GetRecords() const { return m_records.load(std::memory_order_relaxed); }
+
+	/// Get the record payload bytes held
+	/// @return The payload byte count excluding length prefixes.
+	size_t GetBytes() const { return m_bytes.load(std::memory_order_relaxed); }
+
+	/// Get the bytes of blocks held in memory, compressed or not
+	/// @return The memory byte count.
+	size_t GetMemoryBytes() const { return m_memoryBytes.load(std::memory_order_relaxed); }
+
+	/// Get the bytes of blocks held in the spill file
+	/// @return The spilled byte count.
+	size_t GetSpilledBytes() const { return m_spilledBytes.load(std::memory_order_relaxed); }
+
+	/// Wait until every block is compressed and spilled as the cap requires
+	void WaitIdle();
+
+private:
+	LogBacklog(const LogBacklog&) = delete;
+	LogBacklog& operator=(const LogBacklog&) = delete;
+
+	/// Where the bytes of a block are held
+	enum class State
+	{
+		RAW,			///< In memory, not yet compressed.
+		COMPRESSED,		///< In memory, compressed if the build has a codec.
+		SPILLED			///< In the spill file.
+	};
+
+	struct Block
+	{
+		/// The length-prefixed records, compressed unless State::RAW
+		std::string data;
+		State state = State::RAW;
+		bool compressed = false;
+
+		/// True while the background thread works on the block
+		bool busy = false;
+
+		size_t rawSize = 0;
+		size_t records = 0;
+		size_t bytes = 0;
+
+		/// Spill file offset and size of State::SPILLED
+		uint64_t offset = 0;
+		size_t spillSize = 0;
+	};
+
+	/// Build a raw block from the records of a buffer
+	/// @param[in] buffer - the records
+	/// @return The block.
+	static Block MakeBlock(const LogBuffer& buffer);
+
+	/// Queue a block for the background thread. Called with m_mutex held.
+	/// @param[in] block - the block
+	void Added(const Block& block);
+
+	/// Find a block the background thread has work for. Called with m_mutex held.
+	/// @return The block or nullptr.
+	Block* FindWork();
+
+	/// Entry point for the background thread
+	void Process();
+
+	/// Spill file opened by the first spill. m_fileMutex serializes reads and
+	/// writes. m_spillEnd is protected by m_mutex.
+	const std::string m_spillFileName;
+	FILE* m_spillFile = nullptr;
+	std::mutex m_fileMutex;
+	uint64_t m_spillEnd = 0;
+
+	/// Set once a spill fails. Later blocks stay in memory. Protected by m_mutex.
+	bool m_spillFailed = false;
+
+	/// Oldest block first. Protected by m_mutex. Blocks are only added or 
+	/// removed at the ends so a busy block stays in place.
+	std::deque<Block> m_blocks;
+	size_t m_memoryCap = 0;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	std::unique_ptr<std::thread> m_thread;
+	const std::string THREAD_NAME;
+	bool m_exit = false;
+
+	std::atomic<size_t> m_records;
+	std::atomic<size_t> m_bytes;
+	std::atomic<size_t> m_memoryBytes;
+	std::atomic<size_t> m_spilledBytes;
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "LogBuffer.h"
+#include "Fault.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// Append
+//----------------------------------------------------------------------------
+void LogBuffer::Append(const char* data, size_t size)
+{
+	ASSERT_TRUE(size <= std::numeric_limits<LengthType>::max());
+
+	const size_t required = sizeof(LengthType) + size;
+
+	// Start a new chunk if the record does not fit in the current chunk
+	if (m_chunks.empty() || m_chunks.back().capacity - m_chunks.back().used < required)
+		m_chunks.push_back(AllocChunk(required));
+
+	Chunk& chunk = m_chunks.back();
+	LengthType len = static_cast<LengthType>(size);
+	memcpy(chunk.data.get() + chunk.used, &len, sizeof(len));
+	memcpy(chunk.data.get() + chunk.used + sizeof(len), data, size);
+	chunk.used += required;
+
+	m_records++;
+	m_bytes += size;
+}
+
+//----------------------------------------------------------------------------
+// AppendFramed
+//----------------------------------------------------------------------------
+void LogBuffer::AppendFramed(std::string_view framed, size_t records)
+{
+	// Records too large to share a chunk are stored one by one
+	if (framed.size() > m_chunkSize)
+	{
+		ForEachFramed(framed, [this](std::string_view record) { Append(record); });
+		return;
+	}
+
+	if (m_chunks.empty() || m_chunks.back().capacity - m_chunks.back().used < framed.size())
+		m_chunks.push_back(AllocChunk(framed.size()));
+
+	Chunk& chunk = m_chunks.back();
+	memcpy(chunk.data.get() + chunk.used, framed.data(), framed.size());
+	chunk.used += framed.size();
+
+	m_records += records;
+	m_bytes += framed.size() - records * sizeof(LengthType);
+}
+
+//----------------------------------------------------------------------------
+// Clear
+//----------------------------------------------------------------------------
+void LogBuffer::Clear()
+{
+	// Retain standard size chunks to avoid an allocation on the next append
+	for (Chunk& chunk : m_chunks)
+	{
+		if (m_spares.size() < m_retain && chunk.capacity == m_chunkSize)
+		{
+			chunk.used = 0;
+			m_spares.push_back(std::move(chunk));
+		}
+	}
+
+	m_chunks.clear();
+	m_records = 0;
+	m_bytes = 0;
+}
+
+//----------------------------------------------------------------------------
+// AllocChunk
+//----------------------------------------------------------------------------
+LogBuffer::Chunk LogBuffer::AllocChunk(size_t required)
+{
+	if (required <= m_chunkSize && !m_spares.empty())
+	{
+		Chunk chunk = std::move(m_spares.back());
+		m_spares.pop_back();
+		return chunk;
+	}
+
+	// Oversized records get a dedicated chunk
+	Chunk chunk;
+	chunk.capacity = required > m_chunkSize ? required : m_chunkSize;
+	chunk.data = AllocData(chunk.capacity);
+	return chunk;
+}
+
+//----------------------------------------------------------------------------
+// AllocData
+//----------------------------------------------------------------------------
+HugePages::Ptr LogBuffer::AllocData(size_t capacity)
+{
+	if (m_resource)
+		return HugePages::Allocate(capacity, *m_resource);
+	return HugePages::Allocate(capacity, m_hugePages);
+}
+
+//----------------------------------------------------------------------------
+// Reserve
+//----------------------------------------------------------------------------
+void LogBuffer::Reserve(size_t bytes)
+{
+	m_retain = std::max<size_t>(m_retain, (bytes + m_chunkSize - 1) / m_chunkSize);
+	while (m_spares.size() + m_chunks.size() < m_retain)
+	{
+		// Writing every page faults it in now rather than on the first append
+		Chunk chunk;
+		chunk.capacity = m_chunkSize;
+		chunk.data = AllocData(chunk.capacity);
+		memset(chunk.data.get(), 0, chunk.capacity);
+		m_spares.push_back(std::move(chunk));
+	}
+}
+
+//----------------------------------------------------------------------------
+// SetHugePages
+//----------------------------------------------------------------------------
+void LogBuffer::SetHugePages(bool enable)
+{
+	if (enable == m_hugePages)
+		return;
+	m_hugePages = enable;
+	if (enable)
+		m_chunkSize = HugePages::RoundUp(m_chunkSize);
+	m_spares.clear();
+}
+
+//----------------------------------------------------------------------------
+// SetMemoryResource
+//----------------------------------------------------------------------------
+void LogBuffer::SetMemoryResource(std::pmr::memory_resource* resource)
+{
+	if (resource == m_resource)
+		return;
+	m_resource = resource;
+	m_spares.clear();
+}
+
+//----------------------------------------------------------------------------
+// Trim
+//----------------------------------------------------------------------------
+void LogBuffer::Trim(size_t keepBytes)
+{
+	size_t keep = keepBytes / m_chunkSize;
+	if (m_spares.size() > keep)
+	{
+		m_spares.resize(keep);
+		m_spares.shrink_to_fit();
+	}
+}
@@ -0,0 +1,191 @@
+#ifndef _LOG_BUFFER_H
+#define _LOG_BUFFER_H
+
+#include "HugePages.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+/// @brief LogBuffer is an append-only record store built from fixed-size memory 
+/// chunks. Each record is stored length-prefixed back to back within a chunk. A 
+/// record larger than a chunk is stored within its own dedicated chunk. Memory is 
+/// reclaimed a whole chunk at a time by Clear(). LogBuffer is not thread-safe.
+class LogBuffer
+{
+private:
+	/// Length prefix stored before each record
+	typedef uint32_t LengthType;
+
+	/// A contiguous block of record storage
+	struct Chunk
+	{
+		HugePages::Ptr data;
+		size_t capacity = 0;
+		size_t used = 0;
+	};
+
+public:
+	/// Default chunk size in bytes
+	static const size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+	/// @brief Read-only forward iterator over the stored records. Each record 
+	/// is returned as a std::string_view into chunk memory. The view is valid 
+	/// until the next Clear().
+	class const_iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = std::string_view;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const std::string_view*;
+		using reference = std::string_view;
+
+		const_iterator(const std::vector<Chunk>* chunks, size_t chunk, size_t offset) :
+			m_chunks(chunks), m_chunk(chunk), m_offset(offset) { }
+
+		std::string_view operator*() const
+		{
+			const Chunk& chunk = (*m_chunks)[m_chunk];
+			LengthType len;
+			memcpy(&len, chunk.data.get() + m_offset, sizeof(len));
+			return std::string_view(chunk.data.get() + m_offset + sizeof(len), len);
+		}
+
+		const_iterator& operator++()
+		{
+			const Chunk& chunk = (*m_chunks)[m_chunk];
+			LengthType len;
+			memcpy(&len, chunk.data.get() + m_offset, sizeof(len));
+			m_offset += sizeof(len) + len;
+			if (m_offset >= chunk.used)
+			{
+				m_chunk++;
+				m_offset = 0;
+			}
+			return *this;
+		}
+
+		const_iterator operator++(int) { const_iterator tmp = *this; ++(*this); return tmp; }
+
+		bool operator==(const const_iterator& rhs) const { return m_chunk == rhs.m_chunk && m_offset == rhs.m_offset; }
+		bool operator!=(const const_iterator& rhs) const { return !(*this == rhs); }
+
+	private:
+		const std::vector<Chunk>* m_chunks;
+		size_t m_chunk;
+		size_t m_offset;
+	};
+
+	/// Constructor
+	/// @param[in] chunkSize - the size of each storage chunk in bytes
+	explicit LogBuffer(size_t chunkSize = DEFAULT_CHUNK_SIZE) : m_chunkSize(chunkSize) { }
+
+	/// Append a record
+	/// @param[in] data - the record data
+	/// @param[in] size - the record size in bytes
+	void Append(const char* data, size_t size);
+
+	/// Append a record
+	/// @param[in] str - the record
+	void Append(std::string_view str) { Append(str.data(), str.size()); }
+
+	/// Append records framed by Frame(), e.g. on another thread. The records are
+	/// copied at once when they fit within a chunk.
+	/// @param[in] framed - the framed records
+	/// @param[in] records - the number of records framed
+	void AppendFramed(std::string_view framed, size_t records);
+
+	/// Frame a record in the stored layout, for AppendFramed()
+	/// @param[in,out] framed - the framed records. The record is appended.
+	/// @param[in] record - the record
+	static void Frame(std::string& framed, std::string_view record)
+	{
+		LengthType len = static_cast<LengthType>(record.size());
+		framed.append(reinterpret_cast<const char*>(&len), sizeof(len));
+		framed.append(record.data(), record.size());
+	}
+
+	/// Call a function with each record framed by Frame()
+	/// @param[in] framed - the framed records
+	/// @param[in] f - called with each record
+	template <class F>
+	static void ForEachFramed(std::string_view framed, F f)
+	{
+		size_t offset = 0;
+		while (offset + sizeof(LengthType) <= framed.size())
+		{
+			LengthType len;
+			memcpy(&len, framed.data() + offset, sizeof(len));
+			f(framed.substr(offset + sizeof(len), len));
+			offset += sizeof(len) + len;
+		}
+	}
+
+	/// Remove all records. Chunk memory is reclaimed a whole chunk at a time 
+	/// and one chunk, or the chunks reserved by Reserve(), are retained for reuse.
+	void Clear();
+
+	/// Allocate and touch spare chunks for at least the given payload so later
+	/// appends neither allocate nor page fault. The chunks are retained by Clear().
+	/// @param[in] bytes - the bytes to reserve
+	void Reserve(size_t bytes);
+
+	/// Free the spare chunks beyond a number of bytes. Chunks holding records
+	/// are kept.
+	/// @param[in] keepBytes - the bytes of spare chunks kept
+	void Trim(size_t keepBytes);
+
+	/// Back chunks allocated from now on with huge pages, see HugePages. The
+	/// chunk size is rounded up to whole huge pages. Call before the first
+	/// Append() or Reserve(), as spare chunks of the previous size are released.
+	/// @param[in] enable - true to use huge pages
+	void SetHugePages(bool enable);
+
+	/// Allocate chunks from a memory resource from now on, e.g. a bounded arena,
+	/// instead of the heap or huge pages. The resource must outlive the buffer. 
+	/// Spare chunks are released.
+	/// @param[in] resource - the memory resource, or nullptr for the default
+	void SetMemoryResource(std::pmr::memory_resource* resource);
+
+	/// Get the number of records stored
+	/// @return The record count.
+	size_t Size() const { return m_records; }
+
+	/// Get the number of record payload bytes stored
+	/// @return The payload byte count excluding length prefixes.
+	size_t Bytes() const { return m_bytes; }
+
+	/// Check if any records are stored
+	/// @return True if no records are stored.
+	bool Empty() const { return m_records == 0; }
+
+	const_iterator begin() const { return const_iterator(&m_chunks, 0, 0); }
+	const_iterator end() const { return const_iterator(&m_chunks, m_chunks.size(), 0); }
+
+private:
+	/// Get a chunk with at least the required capacity, reusing a spare if possible
+	/// @param[in] required - the required capacity in bytes
+	/// @return The chunk.
+	Chunk AllocChunk(size_t required);
+
+	/// Allocate chunk memory from the memory resource, huge pages or the heap
+	/// @param[in] capacity - the chunk capacity in bytes
+	/// @return The chunk memory.
+	HugePages::Ptr AllocData(size_t capacity);
+
+	size_t m_chunkSize;
+	bool m_hugePages = false;
+	std::pmr::memory_resource* m_resource = nullptr;
+	std::vector<Chunk> m_chunks;
+
+	/// Empty standard size chunks and the number retained by Clear()
+	std::vector<Chunk> m_spares;
+	size_t m_retain = 1;
+	size_t m_records = 0;
+	size_t m_bytes = 0;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "LogCallSite.h"
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+// Open addressed table indexed by ID. Slots are only filled, never cleared, so a
+// lookup probes without a lock until it finds the ID or an empty slot.
+static std::atomic<const LogCallSite*> sites[LogCallSites::MAX_CALL_SITES];
+static std::atomic<size_t> siteCount(0);
+static std::mutex registerMutex;
+
+static_assert((LogCallSites::MAX_CALL_SITES & (LogCallSites::MAX_CALL_SITES - 1)) == 0,
+	"MAX_CALL_SITES must be a power of 2");
+
+//----------------------------------------------------------------------------
+// SameSite
+//----------------------------------------------------------------------------
+static bool SameSite(const LogCallSite& a, const LogCallSite& b)
+{
+	// An inline function has a descriptor in each translation unit using it
+	return &a == &b || (a.line == b.line && strcmp(a.file, b.file) == 0 && strcmp(a.format, b.format) == 0);
+}
+
+//----------------------------------------------------------------------------
+// Register
+//----------------------------------------------------------------------------
+const LogCallSite* LogCallSites::Register(const LogCallSite& site)
+{
+	if (!LogCallSite::IsCallSiteId(site.id))
+		return nullptr;
+
+	std::lock_guard<std::mutex> lock(registerMutex);
+	const size_t mask = MAX_CALL_SITES - 1;
+	for (size_t i = site.id & mask;; i = (i + 1) & mask)
+	{
+		const LogCallSite* entry = sites[i].load(std::memory_order_relaxed);
+		if (entry && entry->id == site.id)
+			return SameSite(*entry, site) ? entry : nullptr;
+		if (!entry)
+		{
+			// Half full keeps the probe sequences short
+			if (siteCount.load(std::memory_order_relaxed) >= MAX_CALL_SITES / 2)
+				return nullptr;
+			sites[i].store(&site, std::memory_order_release);
+			siteCount.fetch_add(1, std::memory_order_relaxed);
+			return &site;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Find
+//----------------------------------------------------------------------------
+const LogCallSite* LogCallSites::Find(uint32_t id)
+{
+	const size_t mask = MAX_CALL_SITES - 1;
+	for (size_t i = id & mask;; i = (i + 1) & mask)
+	{
+		const LogCallSite* entry = sites[i].load(std::memory_order_acquire);
+		if (!entry || entry->id == id)
+			return entry;
+	}
+}
+
+//----------------------------------------------------------------------------
+// GetCount
+//----------------------------------------------------------------------------
+size_t LogCallSites::GetCount()
+{
+	return siteCount.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// Dump
+//----------------------------------------------------------------------------
+void LogCallSites::Dump(std::string& text)
+{
+	for (size_t i = 0; i < MAX_CALL_SITES; i++)
+	{
+		const LogCallSite* site = sites[i].load(std::memory_order_acquire);
+		if (!site)
+			continue;
+
+		char id[16];
+		snprintf(id, sizeof(id), "%08x\t", (unsigned)site->id);
+		text.append(id);
+		text.append(site->file);
+		text.push_back(':');
+		text.append(std::to_string(site->line));
+		text.push_back('\t');
+		text.append(site->function);
+		text.push_back('\t');
+		for (const char* p = site->format; *p; p++)
+		{
+			if (*p == '\\')
+				text.append("\\\\");
+			else if (*p == '\t')
+				text.append("\\t");
+			else if (*p == '\n')
+				text.append("\\n");
+			else
+				text.push_back(*p);
+		}
+		text.push_back('\n');
+	}
+}
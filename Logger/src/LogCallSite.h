@@ -0,0 +1,83 @@
+#ifndef _LOG_CALL_SITE_H
+#define _LOG_CALL_SITE_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+/// @brief Describes a call site writing structured messages. Built at compile time
+/// by the LOG_SITE macro, one static descriptor per call site.
+///
+/// @details The ID is a hash of the file, line and format string with the top bit
+/// set, so it is stable between runs of the same build and never equals a
+/// LogFormat ID, which must be below CALL_SITE_FLAG. A record written from a
+/// registered call site carries only the ID and the arguments. The file, line,
+/// function and format string are expanded from the LogCallSites table when the
+/// record is rendered, or offline from a table saved with LogCallSites::Dump().
+struct LogCallSite
+{
+	/// Set in every call site ID
+	static constexpr uint32_t CALL_SITE_FLAG = 0x80000000u;
+
+	const char* file;
+	uint32_t line;
+	const char* function;
+	const char* format;
+	uint32_t id;
+
+	/// Compute a call site ID (32-bit FNV-1a)
+	/// @param[in] file - the source file name
+	/// @param[in] line - the source line
+	/// @param[in] format - the format string
+	/// @return The ID, with CALL_SITE_FLAG set.
+	static constexpr uint32_t MakeId(const char* file, uint32_t line, const char* format)
+	{
+		uint32_t hash = 2166136261u;
+		for (const char* p = file; *p; p++)
+			hash = (hash ^ (uint8_t)*p) * 16777619u;
+		for (int i = 0; i < 4; i++)
+			hash = (hash ^ ((line >> (i * 8)) & 0xFF)) * 16777619u;
+		for (const char* p = format; *p; p++)
+			hash = (hash ^ (uint8_t)*p) * 16777619u;
+		return hash | CALL_SITE_FLAG;
+	}
+
+	/// Check if a format ID is a call site ID
+	/// @param[in] id - the ID stored in a binary record
+	/// @return True if a call site ID.
+	static constexpr bool IsCallSiteId(uint32_t id) { return (id & CALL_SITE_FLAG) != 0; }
+};
+
+/// @brief The table of registered call sites. Each call site registers once, on
+/// its first write. Lookups are lock-free so records are rendered without a lock.
+class LogCallSites
+{
+public:
+	/// Table capacity. Registration fails once half the slots are used.
+	static constexpr size_t MAX_CALL_SITES = 8192;
+
+	/// Register a call site. Function call is thread-safe.
+	/// @param[in] site - the call site. Must have static storage duration.
+	/// @return The registered call site, or nullptr if the table is full or
+	///     another call site has the same ID. Records of an unregistered call site
+	///     are written with their format string pointer instead.
+	static const LogCallSite* Register(const LogCallSite& site);
+
+	/// Find a registered call site. Function call is thread-safe.
+	/// @param[in] id - the call site ID
+	/// @return The call site, or nullptr if not registered.
+	static const LogCallSite* Find(uint32_t id);
+
+	/// Get the number of registered call sites
+	/// @return The call site count.
+	static size_t GetCount();
+
+	/// Append the table to a string, one call site per line: the ID as 8 hex
+	/// digits, file:line, function and format string, separated by tabs.
+	/// Backslash, tab and newline within the format string are escaped as \\,
+	/// \t and \n. Used to expand the IDs of records outside the process.
+	/// @param[out] text - the table is appended
+	static void Dump(std::string& text);
+};
+
+#endif
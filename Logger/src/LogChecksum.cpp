@@ -0,0 +1,204 @@
+#include "LogChecksum.h"
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#define LOG_CHECKSUM_SSE42
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define LOG_CHECKSUM_ARM
+#endif
+
+using namespace std;
+
+// Reflected CRC32C (Castagnoli) polynomial
+static const uint32_t POLYNOMIAL = 0x82F63B78;
+
+//----------------------------------------------------------------------------
+// Crc32cTable
+//----------------------------------------------------------------------------
+static uint32_t Crc32cTable(uint32_t crc, const unsigned char* data, size_t size)
+{
+	struct Table
+	{
+		uint32_t entries[256];
+		Table()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t entry = i;
+				for (int bit = 0; bit < 8; bit++)
+					entry = (entry >> 1) ^ (entry & 1 ? POLYNOMIAL : 0);
+				entries[i] = entry;
+			}
+		}
+	};
+	static const Table table;
+
+	for (size_t i = 0; i < size; i++)
+		crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return crc;
+}
+
+#if defined(LOG_CHECKSUM_SSE42)
+//----------------------------------------------------------------------------
+// Crc32cSse42
+//----------------------------------------------------------------------------
+#ifndef _MSC_VER
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t Crc32cSse42(uint32_t crc, const unsigned char* data, size_t size)
+{
+	uint64_t crc64 = crc;
+	for (; size >= 8; size -= 8, data += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		crc64 = _mm_crc32_u64(crc64, word);
+	}
+	crc = (uint32_t)crc64;
+	for (; size > 0; size--, data++)
+		crc = _mm_crc32_u8(crc, *data);
+	return crc;
+}
+
+//----------------------------------------------------------------------------
+// HasSse42
+//----------------------------------------------------------------------------
+static bool HasSse42()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 20)) != 0;
+#else
+	return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#elif defined(LOG_CHECKSUM_ARM)
+//----------------------------------------------------------------------------
+// Crc32cArm
+//----------------------------------------------------------------------------
+static uint32_t Crc32cArm(uint32_t crc, const unsigned char* data, size_t size)
+{
+	for (; size >= 8; size -= 8, data += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, sizeof(word));
+		crc = __crc32cd(crc, word);
+	}
+	for (; size > 0; size--, data++)
+		crc = __crc32cb(crc, *data);
+	return crc;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Crc32c
+//----------------------------------------------------------------------------
+uint32_t LogChecksum::Crc32c(uint32_t crc, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	crc = ~crc;
+#if defined(LOG_CHECKSUM_SSE42)
+	static const bool sse42 = HasSse42();
+	crc = sse42 ? Crc32cSse42(crc, bytes, size) : Crc32cTable(crc, bytes, size);
+#elif defined(LOG_CHECKSUM_ARM)
+	crc = Crc32cArm(crc, bytes, size);
+#else
+	crc = Crc32cTable(crc, bytes, size);
+#endif
+	return ~crc;
+}
+
+//----------------------------------------------------------------------------
+// FormatTrailer
+//----------------------------------------------------------------------------
+void LogChecksum::FormatTrailer(char* trailer, uint64_t size, uint32_t crc)
+{
+	static const char HEX[] = "0123456789abcdef";
+	trailer[0] = MARKER;
+	for (int i = 0; i < 16; i++)
+		trailer[1 + i] = HEX[(size >> (60 - 4 * i)) & 0xF];
+	trailer[17] = ' ';
+	for (int i = 0; i < 8; i++)
+		trailer[18 + i] = HEX[(crc >> (28 - 4 * i)) & 0xF];
+	trailer[26] = '\n';
+}
+
+//----------------------------------------------------------------------------
+// ParseHex
+//----------------------------------------------------------------------------
+static bool ParseHex(const char* data, int digits, uint64_t& value)
+{
+	value = 0;
+	for (int i = 0; i < digits; i++)
+	{
+		char c = data[i];
+		uint64_t digit;
+		if (c >= '0' && c <= '9')
+			digit = c - '0';
+		else if (c >= 'a' && c <= 'f')
+			digit = c - 'a' + 10;
+		else
+			return false;
+		value = (value << 4) | digit;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// ParseTrailer
+//----------------------------------------------------------------------------
+bool LogChecksum::ParseTrailer(const char* data, size_t available, uint64_t& size, uint32_t& crc)
+{
+	if (available < TRAILER_SIZE || data[0] != MARKER || data[17] != ' ' || data[26] != '\n')
+		return false;
+	uint64_t crc64;
+	if (!ParseHex(data + 1, 16, size) || !ParseHex(data + 18, 8, crc64))
+		return false;
+	crc = (uint32_t)crc64;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Scan
+//----------------------------------------------------------------------------
+size_t LogChecksum::Scan(const char* data, size_t size, vector<Frame>& frames)
+{
+	size_t valid = 0;
+	size_t pos = 0;
+	size_t search = 0;
+	while (search < size)
+	{
+		const char* marker = static_cast<const char*>(memchr(data + search, MARKER, size - search));
+		if (!marker)
+			break;
+		size_t end = (size_t)(marker - data);
+		search = end + 1;
+
+		// A marker byte within a record or a damaged trailer is skipped. The
+		// trailer length locates its block even after a damaged range.
+		uint64_t blockSize;
+		uint32_t crc;
+		if (!ParseTrailer(marker, size - end, blockSize, crc) || blockSize > end - pos)
+			continue;
+		size_t start = end - (size_t)blockSize;
+		if (Crc32c(0, data + start, (size_t)blockSize) != crc)
+			continue;
+
+		if (start > pos)
+			frames.push_back({ pos, start - pos, false });
+		frames.push_back({ start, blockSize, true });
+		valid++;
+		pos = search = end + TRAILER_SIZE;
+	}
+
+	// The end of the file without a trailer is an unterminated block
+	if (pos < size)
+		frames.push_back({ pos, size - pos, false });
+	return valid;
+}
@@ -0,0 +1,68 @@
+#ifndef _LOG_CHECKSUM_H
+#define _LOG_CHECKSUM_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/// @brief LogChecksum frames each block of records written by one flush so a
+/// reader can detect torn writes after a crash. The block is followed by a
+/// trailer line holding the block length and its CRC32C: the MARKER byte, 16
+/// hex digits of length, a space, 8 hex digits of CRC32C and a newline.
+///
+/// @details The CRC32C is computed with the SSE4.2 crc32 instruction when the
+/// CPU supports it, with the ARMv8 CRC32 instructions when the build targets
+/// them, or with a lookup table otherwise. Since a trailer follows its block,
+/// a reader resyncs after a damaged range at the next valid trailer: its
+/// length locates the start of its block without validating the bytes before.
+class LogChecksum
+{
+public:
+	/// First byte of a trailer line, the ASCII record separator
+	static const char MARKER = '\x1E';
+
+	/// Trailer line size in bytes, including its newline
+	static const size_t TRAILER_SIZE = 27;
+
+	/// A range of a framed file
+	struct Frame
+	{
+		/// File range of the block, excluding its trailer
+		uint64_t offset;
+		uint64_t size;
+
+		/// True if the block has a matching trailer. False for a damaged or
+		/// torn range, e.g. the unterminated end of the file after a crash.
+		bool valid;
+	};
+
+	/// Update a CRC32C with more data
+	/// @param[in] crc - the CRC32C of the preceding data, or 0 to start
+	/// @param[in] data - the data
+	/// @param[in] size - the number of bytes
+	/// @return The CRC32C of the preceding data and this data.
+	static uint32_t Crc32c(uint32_t crc, const void* data, size_t size);
+
+	/// Format the trailer of a block
+	/// @param[out] trailer - receives TRAILER_SIZE bytes
+	/// @param[in] size - the block size in bytes
+	/// @param[in] crc - the block CRC32C
+	static void FormatTrailer(char* trailer, uint64_t size, uint32_t crc);
+
+	/// Parse a trailer
+	/// @param[in] data - the bytes starting with MARKER
+	/// @param[in] available - the bytes readable from data
+	/// @param[out] size - the block size in bytes
+	/// @param[out] crc - the block CRC32C
+	/// @return True if data holds a well-formed trailer.
+	static bool ParseTrailer(const char* data, size_t available, uint64_t& size, uint32_t& crc);
+
+	/// Split a framed file into valid blocks and damaged ranges, in file order
+	/// @param[in] data - the file contents
+	/// @param[in] size - the file size in bytes
+	/// @param[out] frames - the blocks and damaged ranges are appended
+	/// @return The number of valid blocks.
+	static size_t Scan(const char* data, size_t size, std::vector<Frame>& frames);
+};
+
+#endif
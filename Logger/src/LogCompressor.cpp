@@ -0,0 +1,175 @@
+#include "LogCompressor.h"
+#include <cstdio>
+
+#ifdef LOGGER_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+const char* const LogCompressor::SUFFIX = ".gz";
+
+//----------------------------------------------------------------------------
+// LogCompressor
+//----------------------------------------------------------------------------
+LogCompressor::LogCompressor() : m_thread(nullptr), THREAD_NAME("LogCompressorThread"),
+	m_compressedCount(0)
+{
+}
+
+//----------------------------------------------------------------------------
+// ~LogCompressor
+//----------------------------------------------------------------------------
+LogCompressor::~LogCompressor()
+{
+	if (!m_thread)
+		return;
+
+	{
+		std::unique_lock<std::mutex> lk(m_mutex);
+		m_exit = true;
+		m_cv.notify_all();
+	}
+
+	m_thread->join();
+	m_thread = nullptr;
+}
+
+//----------------------------------------------------------------------------
+// IsSupported
+//----------------------------------------------------------------------------
+bool LogCompressor::IsSupported()
+{
+#ifdef LOGGER_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// CompressFile
+//----------------------------------------------------------------------------
+bool LogCompressor::CompressFile(const std::string& fileName)
+{
+#ifdef LOGGER_ZLIB
+	FILE* src = fopen(fileName.c_str(), "rb");
+	if (!src)
+		return false;
+
+	std::string gzName = fileName + SUFFIX;
+	gzFile dst = gzopen(gzName.c_str(), "wb");
+	if (!dst)
+	{
+		fclose(src);
+		return false;
+	}
+
+	bool success = true;
+	char buf[64 * 1024];
+	size_t len;
+	while ((len = fread(buf, 1, sizeof(buf), src)) > 0)
+	{
+		if (gzwrite(dst, buf, (unsigned)len) != (int)len)
+		{
+			success = false;
+			break;
+		}
+	}
+	success &= !ferror(src);
+	fclose(src);
+	success &= gzclose(dst) == Z_OK;
+
+	// Keep the original file if the compressed copy is incomplete
+	if (!success)
+	{
+		remove(gzName.c_str());
+		return false;
+	}
+	return remove(fileName.c_str()) == 0;
+#else
+	(void)fileName;
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Compress
+//----------------------------------------------------------------------------
+void LogCompressor::Compress(const std::string& fileName)
+{
+	if (!IsSupported())
+		return;
+
+	std::unique_lock<std::mutex> lk(m_mutex);
+	if (!m_thread)
+	{
+		m_thread = std::unique_ptr<std::thread>(new thread(&LogCompressor::Process, this));
+
+#ifdef WIN32
+		// Set the thread name so it shows in the Visual Studio Debug Location toolbar
+		std::wstring wstr(THREAD_NAME.begin(), THREAD_NAME.end());
+		SetThreadDescription(m_thread->native_handle(), wstr.c_str());
+
+		// Compression must not compete with the Logger and application threads
+		SetThreadPriority(m_thread->native_handle(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+		// Compression must not compete with the Logger and application threads
+		sched_param param = {};
+		pthread_setschedparam(m_thread->native_handle(), SCHED_IDLE, &param);
+#endif
+	}
+
+	m_files.push_back(fileName);
+	m_busy = true;
+	m_cv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// WaitIdle
+//----------------------------------------------------------------------------
+void LogCompressor::WaitIdle()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_cv.wait(lk, [this]() { return !m_busy; });
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void LogCompressor::Process()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	while (1)
+	{
+		// Wait for a file to compress or the exit request
+		m_cv.wait(lk, [this]() { return !m_files.empty() || m_exit; });
+		if (m_exit)
+		{
+			m_busy = false;
+			m_cv.notify_all();
+			return;
+		}
+
+		std::string fileName = std::move(m_files.front());
+		m_files.pop_front();
+
+		lk.unlock();
+		if (CompressFile(fileName))
+			m_compressedCount++;
+		lk.lock();
+
+		if (m_files.empty())
+		{
+			m_busy = false;
+			m_cv.notify_all();
+		}
+	}
+}
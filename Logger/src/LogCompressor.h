@@ -0,0 +1,72 @@
+#ifndef _LOG_COMPRESSOR_H
+#define _LOG_COMPRESSOR_H
+
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+/// @brief LogCompressor compresses closed log files on a low-priority background
+/// thread. Each file is replaced by a gzip file named <fileName>.gz. Compression
+/// requires the Logger library to be built with zlib (LOGGER_ZLIB). Without zlib
+/// closed files are left uncompressed. Public functions are thread-safe.
+class LogCompressor
+{
+public:
+	/// Compressed file name suffix
+	static const char* const SUFFIX;
+
+	/// Constructor
+	LogCompressor();
+
+	/// Destructor. Completes the file being compressed. Files still queued are
+	/// left uncompressed.
+	~LogCompressor();
+
+	/// Check if compression is supported by this build
+	/// @return True if closed files are compressed.
+	static bool IsSupported();
+
+	/// Compress a file on the calling thread. The file is removed when
+	/// compression succeeds.
+	/// @param[in] fileName - the file to compress
+	/// @return True if success.
+	static bool CompressFile(const std::string& fileName);
+
+	/// Queue a closed file for compression on the background thread
+	/// @param[in] fileName - the file to compress
+	void Compress(const std::string& fileName);
+
+	/// Wait until all queued files are compressed
+	void WaitIdle();
+
+	/// Get the number of files compressed
+	/// @return The compressed file count.
+	uint64_t GetCompressedCount() const { return m_compressedCount; }
+
+private:
+	LogCompressor(const LogCompressor&) = delete;
+	LogCompressor& operator=(const LogCompressor&) = delete;
+
+	/// Entry point for the compression thread
+	void Process();
+
+	/// Compression thread created when the first file is queued
+	std::unique_ptr<std::thread> m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	const std::string THREAD_NAME;
+
+	/// Files waiting to be compressed. Protected by m_mutex.
+	std::deque<std::string> m_files;
+	bool m_busy = false;
+	bool m_exit = false;
+
+	std::atomic<uint64_t> m_compressedCount;
+};
+
+#endif
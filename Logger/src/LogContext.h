@@ -0,0 +1,99 @@
+#ifndef _LOG_CONTEXT_H
+#define _LOG_CONTEXT_H
+
+#include "LogLevel.h"
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+/// @brief LogContext tags a record with the level, component and thread that 
+/// wrote it, so structured output such as LogJson can report them. A context
+/// record is the CONTEXT_TAG byte, the level, the component, the thread number
+/// in host byte order and the original text or binary record. The context 
+/// follows the timestamp prefix of a stamped record. Text rendering drops it.
+class LogContext
+{
+public:
+	/// First byte of a context record. Text records must not start with this byte.
+	static const char CONTEXT_TAG = '\x02';
+
+	/// Size of the tag and context preceding the original record
+	static const size_t PREFIX_SIZE = 3 + sizeof(uint32_t);
+
+	/// The context of a record
+	struct Context
+	{
+		LogLevel level = LogLevel::Off;
+		LogComponent component = 0;
+		uint32_t thread = 0;
+	};
+
+	/// Get the calling thread number. Threads are numbered from 1 in the order
+	/// they first write a context record.
+	/// @return The thread number.
+	static uint32_t GetThreadNumber()
+	{
+		static std::atomic<uint32_t> nextThread(1);
+		thread_local uint32_t thread = nextThread.fetch_add(1, std::memory_order_relaxed);
+		return thread;
+	}
+
+	/// Write the context of the calling thread
+	/// @param[out] prefix - PREFIX_SIZE bytes receiving the context
+	/// @param[in] level - the record level
+	/// @param[in] component - the component writing the record
+	static void WritePrefix(char* prefix, LogLevel level, LogComponent component)
+	{
+		uint32_t thread = GetThreadNumber();
+		prefix[0] = CONTEXT_TAG;
+		prefix[1] = (char)level;
+		prefix[2] = (char)component;
+		memcpy(prefix + 3, &thread, sizeof(thread));
+	}
+
+	/// Prepend the context of the calling thread to a record
+	/// @param[in,out] record - the record
+	/// @param[in] level - the record level
+	/// @param[in] component - the component writing the record
+	static void Add(std::string& record, LogLevel level, LogComponent component)
+	{
+		char prefix[PREFIX_SIZE];
+		WritePrefix(prefix, level, component);
+		record.insert(0, prefix, PREFIX_SIZE);
+	}
+
+	/// Check if a record, after any timestamp, has a context
+	/// @param[in] record - the record
+	/// @return True if the record has a context.
+	static bool HasContext(std::string_view record)
+	{
+		return record.size() >= PREFIX_SIZE && record[0] == CONTEXT_TAG;
+	}
+
+	/// Split a record into its context and the original record
+	/// @param[in] record - the record, after any timestamp
+	/// @param[out] context - the context, or the defaults if none
+	/// @return The original record.
+	static std::string_view Split(std::string_view record, Context& context)
+	{
+		context = Context();
+		if (!HasContext(record))
+			return record;
+		context.level = (LogLevel)record[1];
+		context.component = (LogComponent)record[2];
+		memcpy(&context.thread, record.data() + 3, sizeof(context.thread));
+		return record.substr(PREFIX_SIZE);
+	}
+
+	/// Drop the context of a record, if any
+	/// @param[in] record - the record, after any timestamp
+	/// @return The original record.
+	static std::string_view Strip(std::string_view record)
+	{
+		return HasContext(record) ? record.substr(PREFIX_SIZE) : record;
+	}
+};
+
+#endif
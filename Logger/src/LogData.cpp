@@ -1,17 +1,306 @@
 #include "LogData.h"
-#include <iostream>
-#include <fstream>
-#include <list>
+#include "LogRecord.h"
+#include "LogContext.h"
+#include "LogTimestamp.h"
+#include "Trace.h"
+#include "Metrics.h"
 #include <string>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <filesystem>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 using namespace std;
 
+// File name suffixes appended to the base name
+static const char* LOG_FILE_SUFFIX = ".txt";
+static const char* HWM_FILE_SUFFIX = ".hwm";
+static const char* SEGMENT_SUFFIX = ".seg";
+static const char* CRASH_FILE_SUFFIX = ".crash.txt";
+static const char* SPILL_FILE_SUFFIX = ".spill";
+static const char* JOURNAL_FILE_SUFFIX = ".journal";
+
+//----------------------------------------------------------------------------
+// GetSpillFileName
+//----------------------------------------------------------------------------
+static std::string GetSpillFileName(const std::string& baseName)
+{
+	// The temporary directory is used since the log file disk may be the one
+	// that is unavailable
+	std::error_code ec;
+	std::filesystem::path dir = std::filesystem::temp_directory_path(ec);
+	std::string name = std::filesystem::path(baseName).filename().string() + SPILL_FILE_SUFFIX;
+	return ec ? name : (dir / name).string();
+}
+
+//----------------------------------------------------------------------------
+// WriteFd
+//----------------------------------------------------------------------------
+static void WriteFd(int fd, const char* data, size_t size)
+{
+	while (size > 0)
+	{
+#ifdef WIN32
+		int written = _write(fd, data, (unsigned int)size);
+#else
+		ssize_t written = write(fd, data, size);
+#endif
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return;
+		data += written;
+		size -= (size_t)written;
+	}
+}
+
+//----------------------------------------------------------------------------
+// LogData
+//----------------------------------------------------------------------------
+LogData::LogData(const std::string& baseName) : 
+	m_journalFileName(baseName + JOURNAL_FILE_SUFFIX), m_backlog(GetSpillFileName(baseName)),
+	m_writer(baseName + LOG_FILE_SUFFIX, baseName + HWM_FILE_SUFFIX, baseName + SEGMENT_SUFFIX)
+{
+	m_highWaterMark = m_writer.LoadHighWaterMark();
+
+	// Open the crash file now since it cannot be opened safely during a crash
+	m_crashFileName = baseName + CRASH_FILE_SUFFIX;
+#ifdef WIN32
+	m_crashFd = _open(m_crashFileName.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+	m_crashFd = open(m_crashFileName.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// ~LogData
+//----------------------------------------------------------------------------
+LogData::~LogData()
+{
+	if (m_crashFd >= 0)
+	{
+		// Leave no empty crash file behind
+#ifdef WIN32
+		bool empty = _lseeki64(m_crashFd, 0, SEEK_END) == 0;
+		_close(m_crashFd);
+#else
+		bool empty = lseek(m_crashFd, 0, SEEK_END) == 0;
+		close(m_crashFd);
+#endif
+		if (empty)
+			remove(m_crashFileName.c_str());
+	}
+}
+
+//----------------------------------------------------------------------------
+// Prepare
+//----------------------------------------------------------------------------
+void LogData::Prepare(size_t bufferBytes, size_t fileExtent, bool warmUp)
+{
+	// Both buffers of the double buffered flush are reserved
+	if (bufferBytes > 0)
+	{
+		m_msgData.Reserve(bufferBytes);
+		m_flushData.Reserve(bufferBytes);
+	}
+	m_writer.Prepare(fileExtent, warmUp);
+}
+
+//----------------------------------------------------------------------------
+// EmergencyFlush
+//----------------------------------------------------------------------------
+void LogData::EmergencyFlush() const
+{
+	m_ring.ForEach([this](std::string_view record) { EmergencyWrite(record); });
+	if (m_flushing)
+	{
+		for (std::string_view record : m_flushData)
+			EmergencyWrite(record);
+	}
+	for (std::string_view record : m_msgData)
+		EmergencyWrite(record);
+}
+
+//----------------------------------------------------------------------------
+// EmergencyWrite
+//----------------------------------------------------------------------------
+void LogData::EmergencyWrite(std::string_view record) const
+{
+	if (m_crashFd < 0)
+		return;
+
+	// Converting the tick takes a lock so the timestamp is left out
+	uint64_t tick;
+	record = LogContext::Strip(LogTimestamp::Split(record, tick));
+
+	if (LogRecord::IsBinary(record))
+	{
+		// Rendering allocates so only the format ID is written
+		char text[32] = "<binary format ";
+		size_t len = 15;
+		char digits[10];
+		size_t count = 0;
+		uint32_t id = LogRecord::GetFormatId(record);
+		do { digits[count++] = (char)('0' + id % 10); id /= 10; } while (id && count < sizeof(digits));
+		while (count)
+			text[len++] = digits[--count];
+		text[len++] = '>';
+		text[len++] = '\n';
+		WriteFd(m_crashFd, text, len);
+		return;
+	}
+
+	WriteFd(m_crashFd, record.data(), record.size());
+	WriteFd(m_crashFd, "\n", 1);
+}
+
 //----------------------------------------------------------------------------
 // Write
 //----------------------------------------------------------------------------
 void LogData::Write(const std::string& msg)
 {
-	m_msgData.push_back(msg);
+	static DelegateLib::MetricCounter& recordsMetric = DelegateLib::Metrics::GetCounter("logdata.records");
+	recordsMetric.Add();
+	if (IsRecording())
+		m_ring.Append(msg);
+	else
+	{
+		m_msgData.Append(msg);
+		m_journal.Append(msg);
+		CheckBacklog();
+	}
+}
+
+//----------------------------------------------------------------------------
+// WriteBatch
+//----------------------------------------------------------------------------
+void LogData::WriteBatch(const std::string_view* msgs, size_t count, bool record)
+{
+	static DelegateLib::MetricCounter& recordsMetric = DelegateLib::Metrics::GetCounter("logdata.records");
+	recordsMetric.Add(count);
+	if (record && IsRecording())
+	{
+		for (size_t i = 0; i < count; i++)
+			m_ring.Append(msgs[i]);
+		return;
+	}
+	for (size_t i = 0; i < count; i++)
+		m_msgData.Append(msgs[i]);
+	if (m_journal.IsOpen())
+	{
+		for (size_t i = 0; i < count; i++)
+			m_journal.Append(msgs[i]);
+	}
+	CheckBacklog();
+}
+
+//----------------------------------------------------------------------------
+// WriteFramed
+//----------------------------------------------------------------------------
+void LogData::WriteFramed(std::string_view framed, size_t count)
+{
+	static DelegateLib::MetricCounter& recordsMetric = DelegateLib::Metrics::GetCounter("logdata.records");
+	recordsMetric.Add(count);
+	if (IsRecording())
+	{
+		LogBuffer::ForEachFramed(framed, [this](std::string_view record) { m_ring.Append(record); });
+		return;
+	}
+	m_msgData.AppendFramed(framed, count);
+	if (m_journal.IsOpen())
+		LogBuffer::ForEachFramed(framed, [this](std::string_view record) { m_journal.Append(record); });
+	CheckBacklog();
+}
+
+//----------------------------------------------------------------------------
+// CheckBacklog
+//----------------------------------------------------------------------------
+void LogData::CheckBacklog()
+{
+	if (!m_backlogThreshold || m_msgData.Bytes() < m_backlogThreshold)
+		return;
+
+	// Sealed records are posted to the sinks now since they leave m_msgData
+	PostSinks(m_msgData, m_sinkPosted);
+	m_sinkPosted = 0;
+	m_backlog.Seal(m_msgData);
+	m_msgData.Clear();
+}
+
+//----------------------------------------------------------------------------
+// Trim
+//----------------------------------------------------------------------------
+void LogData::Trim(size_t keepBytes)
+{
+	m_msgData.Trim(keepBytes);
+	if (!m_flushing)
+		m_flushData.Trim(keepBytes);
+}
+
+//----------------------------------------------------------------------------
+// SetHugePages
+//----------------------------------------------------------------------------
+void LogData::SetHugePages(bool enable)
+{
+	m_hugePages = enable;
+	m_msgData.SetHugePages(enable);
+	m_flushData.SetHugePages(enable);
+}
+
+//----------------------------------------------------------------------------
+// SetMemoryResource
+//----------------------------------------------------------------------------
+void LogData::SetMemoryResource(std::pmr::memory_resource* resource)
+{
+	m_msgData.SetMemoryResource(resource);
+	m_flushData.SetMemoryResource(resource);
+}
+
+//----------------------------------------------------------------------------
+// SetJournal
+//----------------------------------------------------------------------------
+size_t LogData::SetJournal(size_t bytes)
+{
+	static DelegateLib::MetricCounter& replayedMetric = DelegateLib::Metrics::GetCounter("logdata.journal_replayed");
+	size_t replayed = 0;
+	m_journal.Open(m_journalFileName, bytes, [this, &replayed](std::string_view record) {
+		m_msgData.Append(record);
+		replayed++;
+	});
+	replayedMetric.Add(replayed);
+	CheckBacklog();
+	return replayed;
+}
+
+//----------------------------------------------------------------------------
+// SetFlightRecorder
+//----------------------------------------------------------------------------
+void LogData::SetFlightRecorder(size_t bytes)
+{
+	DumpFlightRecorder();
+	m_ring.Reset(bytes, m_hugePages);
+}
+
+//----------------------------------------------------------------------------
+// DumpFlightRecorder
+//----------------------------------------------------------------------------
+size_t LogData::DumpFlightRecorder()
+{
+	static DelegateLib::MetricCounter& overwrittenMetric = DelegateLib::Metrics::GetCounter("logdata.recorder_overwritten");
+	size_t count = m_ring.Size();
+	if (count == 0)
+		return 0;
+
+	m_ring.ForEach([this](std::string_view record) { m_msgData.Append(record); });
+	overwrittenMetric.Add(m_ring.GetOverwritten());
+	m_ring.Clear();
+	return count;
 }
 
 //----------------------------------------------------------------------------
@@ -19,28 +308,180 @@ void LogData::Write(const std::string& msg)
 //----------------------------------------------------------------------------
 bool LogData::Flush()
 {
-#ifdef IT_ENABLE
-    auto startTime = std::chrono::high_resolution_clock::now();
-#endif
+    TRACE_SCOPE("LogData::Flush");
 
-    // Write log data to disk
-    std::ofstream logFile("LogData.txt", std::ios::app);
-    if (logFile.is_open()) 
+    // The backlog is older than the pending records so it is written first
+    while (!m_backlog.Empty())
     {
-        for (const std::string& str : m_msgData) 
+        if (!m_backlog.TakeOldest(m_flushData))
+            break;
+        LogWriter::Result result = m_writer.Write(m_flushData);
+        if (!result.success)
         {
-            logFile << str << std::endl;
+            m_backlog.PushFront(m_flushData);
+            m_flushData.Clear();
+            return false;
         }
-        logFile.close();
+        m_flushData.Clear();
+        Flushed(result);
+    }
 
-#ifdef IT_ENABLE
-        auto endTime = std::chrono::high_resolution_clock::now();
-        auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+    PostSinks(m_msgData, m_sinkPosted);
+    m_sinkPosted = m_msgData.Size();
 
-        // Callback integration test with elapsed time
-        FlushTimeDelegate(elapsedTime);
-#endif
+    // Write log data added since the last flush to disk
+    LogWriter::Result result = m_writer.Write(m_msgData);
+
+    // Keep the records in memory for the next flush attempt on failure
+    if (!result.success)
+        return false;
+
+    // Records are durably written so reclaim the buffer memory
+    m_msgData.Clear();
+    m_sinkPosted = 0;
+    if (m_backlog.Empty())
+        m_journal.Release(m_journal.GetHead());
+    Flushed(result);
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// FlushAsync
+//----------------------------------------------------------------------------
+bool LogData::FlushAsync(LogWriter::CompleteCallback callback, bool forceSync)
+{
+    TRACE_SCOPE("LogData::FlushAsync");
+
+    if (m_flushing)
+        return false;
+
+    // The backlog is older than the pending records so its blocks are written
+    // first, one block per flush. Its records were posted to the sinks when sealed.
+    if (!m_backlog.Empty() && m_backlog.TakeOldest(m_flushData))
+    {
+        m_flushing = true;
+        m_flushingBacklog = true;
+        m_writer.WriteAsync(m_flushData, std::move(callback), forceSync);
+        return true;
+    }
+
+    PostSinks(m_msgData, m_sinkPosted);
+    m_sinkPosted = 0;
+
+    // The journal is released up to here once the write succeeds, unless older
+    // backlog records remain
+    m_journalFlushed = m_backlog.Empty() ? m_journal.GetHead() : 0;
+
+    // Swap buffers so new records are added while the full buffer is written
+    std::swap(m_msgData, m_flushData);
+    m_flushing = true;
+    m_writer.WriteAsync(m_flushData, std::move(callback), forceSync);
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// FlushComplete
+//----------------------------------------------------------------------------
+bool LogData::FlushComplete(const LogWriter::Result& result)
+{
+    m_flushing = false;
+
+    if (m_flushingBacklog)
+    {
+        // A failed block is kept at the front of the backlog
+        m_flushingBacklog = false;
+        if (!result.success)
+            m_backlog.PushFront(m_flushData);
+        m_flushData.Clear();
+        if (!result.success)
+            return false;
+        Flushed(result);
         return true;
     }
-    return false;
-}
\ No newline at end of file
+
+    if (!result.success)
+    {
+        // Keep the unwritten records ahead of records added since the flush started.
+        // The unwritten records were all posted to the sinks.
+        m_sinkPosted += m_flushData.Size();
+        for (std::string_view str : m_msgData)
+            m_flushData.Append(str);
+        std::swap(m_msgData, m_flushData);
+        m_flushData.Clear();
+        CheckBacklog();
+        return false;
+    }
+
+    // Records are durably written so reclaim the buffer memory
+    m_flushData.Clear();
+    m_journal.Release(m_journalFlushed);
+    Flushed(result);
+    return true;
+}
+
+//----------------------------------------------------------------------------
+// AddSink
+//----------------------------------------------------------------------------
+void LogData::AddSink(std::shared_ptr<LogSink> sink)
+{
+	if (!sink)
+		return;
+	sink->Start();
+	const std::lock_guard<std::mutex> lock(m_sinkMutex);
+	m_sinks.push_back(std::move(sink));
+}
+
+//----------------------------------------------------------------------------
+// RemoveSink
+//----------------------------------------------------------------------------
+void LogData::RemoveSink(const std::shared_ptr<LogSink>& sink)
+{
+	{
+		const std::lock_guard<std::mutex> lock(m_sinkMutex);
+		auto it = std::find(m_sinks.begin(), m_sinks.end(), sink);
+		if (it == m_sinks.end())
+			return;
+		m_sinks.erase(it);
+	}
+
+	// No batch is posted to the sink once it is removed
+	sink->Stop();
+}
+
+//----------------------------------------------------------------------------
+// PostSinks
+//----------------------------------------------------------------------------
+void LogData::PostSinks(const LogBuffer& buffer, size_t posted)
+{
+	const std::lock_guard<std::mutex> lock(m_sinkMutex);
+	if (m_sinks.empty() || buffer.Size() <= posted)
+		return;
+
+	// One copy of the records is shared by every sink
+	std::shared_ptr<LogBuffer> batch = std::make_shared<LogBuffer>();
+	size_t index = 0;
+	for (std::string_view record : buffer)
+	{
+		if (index++ >= posted)
+			batch->Append(record);
+	}
+	for (auto& sink : m_sinks)
+		sink->Post(batch);
+}
+
+//----------------------------------------------------------------------------
+// Flushed
+//----------------------------------------------------------------------------
+void LogData::Flushed(const LogWriter::Result& result)
+{
+    static DelegateLib::MetricCounter& flushedMetric = DelegateLib::Metrics::GetCounter("logdata.flushed_records");
+    static DelegateLib::MetricCounter& flushedBytesMetric = DelegateLib::Metrics::GetCounter("logdata.flushed_bytes");
+    flushedMetric.Add(result.records);
+    flushedBytesMetric.Add(result.bytes);
+    m_highWaterMark += result.records;
+
+#ifdef IT_ENABLE
+    // Callback integration test with elapsed time and amount written
+    IT_HOOK(FlushTimeDelegate, result.elapsed, result.records, result.bytes);
+#endif
+}
@@ -2,32 +2,349 @@
 #define _LOG_DATA_H
 
 #include <string>
-#include <list>
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "LogFile.h"
+#include "LogBuffer.h"
+#include "LogRing.h"
+#include "LogBacklog.h"
+#include "LogJournal.h"
+#include "LogWriter.h"
+#include "LogSink.h"
 #include "IT_Client.h"
 
 /// @brief LogData stores log data strings. LogData is not thread-safe. Must only 
 /// be called on the Logger thread of control.
+/// 
+/// @details Each Flush() writes only the records added since the last successful 
+/// flush. Records are dropped from memory once written to disk. The number of records
+/// durably written (the high-water mark) is persisted alongside the log file. The
+/// log file is opened once and kept open for the lifetime of LogData.
+///
+/// Records are double buffered. FlushAsync() swaps the active buffer with an empty
+/// one and hands the full buffer to the LogWriter I/O thread. Writes continue into
+/// the active buffer while the previous buffer is written to disk.
+///
+/// Each flush window is also posted to the registered LogSink instances as one
+/// batch shared by reference count. Sinks run on their own threads so a slow 
+/// sink never delays the log file. Records are posted to the sinks once even if
+/// the log file write fails and is retried.
+///
+/// SetBackend(LogWriter::Backend::MEMORY) captures flushed records in a
+/// LogMemory instead of the log file, so integration tests assert on the 
+/// records directly without disk I/O.
+///
+/// In flight recorder mode records are kept in a fixed-size LogRing instead and
+/// nothing is written to disk. DumpFlightRecorder() moves the recorded records
+/// to the pending log data so the next flush writes them.
+///
+/// When the disk is slow or unavailable the pending records are bounded by 
+/// SetBacklogLimits(). Pending records past the threshold are sealed into a 
+/// LogBacklog block, compressed in memory and spilled to a temporary file past
+/// the memory cap. Flushes write the backlog one block at a time, oldest 
+/// first, before the pending records.
+///
+/// SetJournal() also appends each pending record to a LogJournal, so records
+/// not yet flushed survive a process restart and are replayed into the pending
+/// records when the next LogData opens the journal. The journal is released up
+/// to the records of each successful flush. A record written from a backlog
+/// block is released only once the backlog drains, so after a crash it may be
+/// written twice but never lost.
 class LogData
 {
 public:
+	/// Default file base name. Log data is written to LogData.txt.
+	static constexpr const char* DEFAULT_BASE_NAME = "LogData";
+
+	/// Constructor
+	/// @param[in] baseName - the file base name. Log data is written to 
+	///     <baseName>.txt, the high-water mark to <baseName>.hwm, segments to
+	///     <baseName>.seg.*, crash records to <baseName>.crash.txt and the
+	///     journal to <baseName>.journal.
+	explicit LogData(const std::string& baseName = DEFAULT_BASE_NAME);
+
+	/// Destructor
+	~LogData();
+
 #ifdef IT_ENABLE
-	DelegateLib::MulticastDelegateSafe<void(std::chrono::milliseconds)> FlushTimeDelegate;
+	/// Called after each successful flush with the elapsed time, the number of 
+	/// records written and the number of bytes written. A single relaxed load 
+	/// per flush while no test is subscribed.
+	IT_Hook<void(std::chrono::milliseconds, size_t, size_t)> FlushTimeDelegate;
 #endif
 
 	/// Write log data
 	/// @param[in] msg - data to log
 	void Write(const std::string& msg);	
 
-	/// Flush log data to disk
+	/// Write a batch of log data
+	/// @param[in] msgs - the data to log
+	/// @param[in] count - the number of data strings
+	/// @param[in] record - false to write past the flight recorder to the pending
+	///     log data
+	void WriteBatch(const std::string_view* msgs, size_t count, bool record = true);
+
+	/// Write records framed by LogBuffer::Frame(), appended with a single copy
+	/// unless the flight recorder or journal takes each record
+	/// @param[in] framed - the framed records
+	/// @param[in] count - the number of records
+	void WriteFramed(std::string_view framed, size_t count);
+
+	/// Flush log data added since the last successful flush to disk. Blocks 
+	/// until the data is written.
 	/// @return True if success. 
 	bool Flush();
 
+	/// Start flushing log data added since the last flush on the I/O thread. 
+	/// FlushComplete() must be called on the Logger thread with the result 
+	/// passed to the callback before the next asynchronous flush starts.
+	/// @param[in] callback - invoked on the I/O thread when the write completes
+	/// @param[in] forceSync - true to sync the data to the storage device 
+	///     regardless of the sync policy
+	/// @return True if the flush started. False if a flush is in progress.
+	bool FlushAsync(LogWriter::CompleteCallback callback, bool forceSync = false);
+
+	/// Complete an asynchronous flush started by FlushAsync()
+	/// @param[in] result - the write result passed to the FlushAsync() callback
+	/// @return True if success. 
+	bool FlushComplete(const LogWriter::Result& result);
+
+	/// Check if an asynchronous flush is in progress
+	/// @return True if a flush is in progress.
+	bool IsFlushing() const { return m_flushing; }
+
+	/// Wait until the I/O thread completes any asynchronous write in progress
+	void WaitFlush() { m_writer.WaitIdle(); }
+
+	/// Prepare for the first write, typically at startup before the Logger 
+	/// thread runs
+	/// @param[in] bufferBytes - the record buffer bytes to preallocate, or 0
+	/// @param[in] fileExtent - open the log file now and reserve this many bytes
+	///     of file extents, or 0 to open it on the first flush
+	/// @param[in] warmUp - true to run a record through the rendering path
+	void Prepare(size_t bufferBytes, size_t fileExtent, bool warmUp);
+
+	/// Free the spare record buffer chunks beyond a number of bytes. The buffer
+	/// owned by a flush in progress is left alone.
+	/// @param[in] keepBytes - the bytes kept by each record buffer
+	void Trim(size_t keepBytes);
+
+	/// Back the record buffers and the flight recorder buffer allocated from
+	/// now on with huge pages, see HugePages. Call before Prepare().
+	/// @param[in] enable - true to use huge pages
+	void SetHugePages(bool enable);
+
+	/// Allocate the record buffer chunks from a memory resource from now on, e.g. 
+	/// a bounded arena on an embedded target. Used by the Logger thread only and 
+	/// must outlive the LogData. Call before Prepare().
+	/// @param[in] resource - the memory resource, or nullptr for the default
+	void SetMemoryResource(std::pmr::memory_resource* resource);
+
+	/// Journal the pending records in a memory-mapped file so they survive a
+	/// process restart, see LogJournal. Records left by the previous process
+	/// are replayed into the pending records first. Records in flight recorder
+	/// mode are not journaled. Call before the first write.
+	/// @param[in] bytes - the journal size. Records that do not fit are kept
+	///     in memory only.
+	/// @return The number of records replayed.
+	size_t SetJournal(size_t bytes);
+
+	/// Get the journal set by SetJournal()
+	/// @return The journal.
+	const LogJournal& GetJournal() const { return m_journal; }
+
+	/// Keep the most recent records in memory instead of writing them to disk.
+	/// Records already recorded are moved to the pending log data first.
+	/// @param[in] bytes - the flight recorder buffer size, or 0 to write 
+	///     records to disk again
+	void SetFlightRecorder(size_t bytes);
+
+	/// Check if flight recorder mode is enabled
+	/// @return True if records are kept in the flight recorder.
+	bool IsRecording() const { return m_ring.Capacity() > 0; }
+
+	/// Move the flight recorder records to the pending log data, oldest first
+	/// @return The number of records moved.
+	size_t DumpFlightRecorder();
+
+	/// Get the number of records held by the flight recorder
+	/// @return The recorded record count.
+	size_t GetRecordedRecords() const { return m_ring.Size(); }
+
+	/// Write all records not yet flushed to the preopened crash file. Async 
+	/// signal-safe: no allocation, no locks and only write system calls. Records 
+	/// of a flush in progress are included so they may also be in the log file.
+	/// Flight recorder records are written first. Backlog blocks are compressed
+	/// or spilled so they are not included.
+	/// Binary records are written as a placeholder with their format ID and
+	/// timestamps are omitted.
+	void EmergencyFlush() const;
+
+	/// Write one record to the preopened crash file. Async signal-safe.
+	/// @param[in] record - the record to write
+	void EmergencyWrite(std::string_view record) const;
+
+	/// Get the number of records waiting to be flushed, including the backlog
+	/// @return The pending record count.
+	size_t GetPendingRecords() const { return m_msgData.Size() + m_backlog.GetRecords(); }
+
+	/// Get the number of bytes waiting to be flushed, including the backlog
+	/// @return The pending payload byte count.
+	size_t GetPendingBytes() const { return m_msgData.Bytes() + m_backlog.GetBytes(); }
+
+	/// Bound the memory held by pending records while the disk cannot keep up.
+	/// Records already sealed into the backlog stay there until written.
+	/// @param[in] threshold - the pending bytes sealed into a compressed backlog
+	///     block, or 0 to never seal
+	/// @param[in] memoryCap - the backlog bytes held in memory before blocks 
+	///     are spilled to a temporary file, or 0 to never spill
+	void SetBacklogLimits(size_t threshold, size_t memoryCap)
+	{
+		m_backlogThreshold = threshold;
+		m_backlog.SetMemoryCap(memoryCap);
+	}
+
+	/// Get the backlog of sealed records
+	/// @return The backlog.
+	const LogBacklog& GetBacklog() const { return m_backlog; }
+
+	/// Check if the flush in progress writes a backlog block
+	/// @return True if the flush writes backlog records.
+	bool IsFlushingBacklog() const { return m_flushing && m_flushingBacklog; }
+
+	/// Get the total number of records durably written to disk
+	/// @return The persisted high-water mark.
+	uint64_t GetHighWaterMark() const { return m_highWaterMark; }
+
+	/// Set the log file user-space buffer size. Takes effect when the log 
+	/// file is next opened.
+	/// @param[in] bufferSize - the buffer size in bytes
+	void SetBufferSize(size_t bufferSize) { m_writer.SetBufferSize(bufferSize); }
+
+	/// Select the sink log data is written to
+	/// @param[in] backend - the text file or memory-mapped segment backend
+	/// @param[in] segmentSize - the segment file size in bytes for LogWriter::Backend::SEGMENT
+	void SetBackend(LogWriter::Backend backend, size_t segmentSize = LogSegment::DEFAULT_SEGMENT_SIZE)
+	{
+		m_writer.SetBackend(backend, segmentSize);
+	}
+
+	/// Get the records captured by LogWriter::Backend::MEMORY. May be read by any
+	/// thread, e.g. by an integration test while the Logger thread flushes.
+	/// @return The captured records, or nullptr if the backend was never selected.
+	const LogMemory* GetMemory() const { return m_writer.GetMemory(); }
+
+	/// Discard the records captured by LogWriter::Backend::MEMORY
+	void ClearMemory() { m_writer.ClearMemory(); }
+
+	/// Set the policy used to sync log data to the storage device
+	/// @param[in] policy - the sync policy
+	/// @param[in] interval - the minimum time between syncs for LogFile::SyncPolicy::INTERVAL
+	void SetSyncPolicy(LogFile::SyncPolicy policy, std::chrono::milliseconds interval = std::chrono::milliseconds(0))
+	{
+		m_writer.SetSyncPolicy(policy, interval);
+	}
+
+	/// Set how the log file is written when flushed
+	/// @param[in] mode - buffered writes, one gathered writev per flush or 
+	///     aligned O_DIRECT writes
+	/// @param[in] preallocation - the bytes of file extents reserved ahead of 
+	///     the data, or 0 to disable
+	void SetWriteMode(LogFile::WriteMode mode, size_t preallocation = 0)
+	{
+		m_writer.SetWriteMode(mode, preallocation);
+	}
+
+	/// Escape control characters and backslashes and replace invalid UTF-8 in
+	/// the log file records, so JSON and line based tooling can consume them
+	/// @param[in] enable - true to escape records
+	void SetEscape(bool enable) { m_writer.SetEscape(enable); }
+
+	/// Set the format of the log file records
+	/// @param[in] format - one text line or one JSON object per record
+	void SetOutputFormat(LogWriter::OutputFormat format) { m_writer.SetOutputFormat(format); }
+
+	/// Frame the records of each flush with a length and CRC32C trailer so a 
+	/// reader detects torn writes, see LogChecksum
+	/// @param[in] enable - true to frame flushed records
+	void SetChecksums(bool enable) { m_writer.SetChecksums(enable); }
+
+	/// Add a sink receiving every record flushed from now on, and start its 
+	/// thread. Function call is thread-safe.
+	/// @param[in] sink - the sink to add
+	void AddSink(std::shared_ptr<LogSink> sink);
+
+	/// Remove a sink and stop it once its queued records are written. Function 
+	/// call is thread-safe.
+	/// @param[in] sink - the sink to remove
+	void RemoveSink(const std::shared_ptr<LogSink>& sink);
+
 private:
 IT_PRIVATE_ACCESS:
 
-	/// List to hold log data messages
-	std::list<std::string> m_msgData;
+	/// Post the records of a buffer not yet posted to every sink as one shared 
+	/// batch
+	/// @param[in] buffer - the records to post
+	/// @param[in] posted - the number of leading records already posted
+	void PostSinks(const LogBuffer& buffer, size_t posted);
+
+	/// Crash file descriptor opened at construction for EmergencyFlush(). The
+	/// file is removed at destruction if nothing was written to it.
+	int m_crashFd = -1;
+	std::string m_crashFileName;
+
+	/// Seal the pending records into the backlog once they reach the threshold
+	void CheckBacklog();
+
+	/// Account for records written to disk and notify integration tests
+	/// @param[in] result - the successful write result
+	void Flushed(const LogWriter::Result& result);
+
+	/// Active record buffer holding log data messages not yet flushed to disk
+	LogBuffer m_msgData;
+
+	/// Record buffer being written to disk by the I/O thread
+	LogBuffer m_flushData;
+
+	/// Most recent records in flight recorder mode
+	LogRing m_ring;
+
+	/// Set by SetHugePages()
+	bool m_hugePages = false;
+
+	/// Pending records journaled for a restart, the journal file name, and the
+	/// journal position the asynchronous flush in progress releases up to
+	LogJournal m_journal;
+	std::string m_journalFileName;
+	uint64_t m_journalFlushed = 0;
+
+	/// True while m_flushData is owned by the I/O thread
+	bool m_flushing = false;
+
+	/// Sealed records older than m_msgData, and the pending bytes that seal 
+	/// m_msgData into it
+	LogBacklog m_backlog;
+	size_t m_backlogThreshold = 0;
+
+	/// True if m_flushData holds a backlog block
+	bool m_flushingBacklog = false;
+
+	/// Writes records to the log file
+	LogWriter m_writer;
+
+	/// Total number of records durably written to disk
+	uint64_t m_highWaterMark = 0;
+
+	/// Registered sinks. Protected by m_sinkMutex.
+	std::vector<std::shared_ptr<LogSink>> m_sinks;
+	std::mutex m_sinkMutex;
+
+	/// Number of leading m_msgData records already posted to the sinks by a 
+	/// failed flush
+	size_t m_sinkPosted = 0;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,202 @@
+#include "LogEscape.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define LOG_ESCAPE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LOG_ESCAPE_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define LOG_ESCAPE_NEON
+#endif
+
+using namespace std;
+
+// Check a single byte. Bytes >= 0x80 start or continue a UTF-8 sequence.
+static inline bool IsSpecial(unsigned char c, bool json)
+{
+	return c < 0x20 || c >= 0x80 || c == '\\' || (json && c == '"');
+}
+
+// Offset of the lowest set mask bit
+static inline size_t LowestBit(unsigned mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return (size_t)__builtin_ctz(mask);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// FindSpecial
+//----------------------------------------------------------------------------
+size_t LogEscape::FindSpecial(const char* data, size_t size, bool json)
+{
+	size_t i = 0;
+
+#if defined(LOG_ESCAPE_AVX2)
+	// A signed compare below 0x20 catches both control bytes and bytes >= 0x80
+	const __m256i space = _mm256_set1_epi8(0x20);
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i quote = _mm256_set1_epi8(json ? '"' : '\\');
+	for (; i + 32 <= size; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(data + i));
+		__m256i special = _mm256_or_si256(_mm256_cmpgt_epi8(space, v),
+			_mm256_or_si256(_mm256_cmpeq_epi8(v, backslash), _mm256_cmpeq_epi8(v, quote)));
+		unsigned mask = (unsigned)_mm256_movemask_epi8(special);
+		if (mask)
+			return i + LowestBit(mask);
+	}
+#elif defined(LOG_ESCAPE_SSE2)
+	const __m128i space = _mm_set1_epi8(0x20);
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i quote = _mm_set1_epi8(json ? '"' : '\\');
+	for (; i + 16 <= size; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+		__m128i special = _mm_or_si128(_mm_cmplt_epi8(v, space),
+			_mm_or_si128(_mm_cmpeq_epi8(v, backslash), _mm_cmpeq_epi8(v, quote)));
+		unsigned mask = (unsigned)_mm_movemask_epi8(special);
+		if (mask)
+			return i + LowestBit(mask);
+	}
+#elif defined(LOG_ESCAPE_NEON)
+	const uint8x16_t space = vdupq_n_u8(0x20);
+	const uint8x16_t high = vdupq_n_u8(0x80);
+	const uint8x16_t backslash = vdupq_n_u8('\\');
+	const uint8x16_t quote = vdupq_n_u8(json ? '"' : '\\');
+	for (; i + 16 <= size; i += 16)
+	{
+		uint8x16_t v = vld1q_u8((const uint8_t*)(data + i));
+		uint8x16_t special = vorrq_u8(vorrq_u8(vcltq_u8(v, space), vcgeq_u8(v, high)),
+			vorrq_u8(vceqq_u8(v, backslash), vceqq_u8(v, quote)));
+		if (vmaxvq_u8(special))
+			break;	// Located by the scalar loop
+	}
+#endif
+
+	for (; i < size; i++)
+	{
+		if (IsSpecial((unsigned char)data[i], json))
+			return i;
+	}
+	return size;
+}
+
+//----------------------------------------------------------------------------
+// Utf8Length
+//----------------------------------------------------------------------------
+size_t LogEscape::Utf8Length(const unsigned char* data, size_t size)
+{
+	// Lead byte sets the length and the valid range of the second byte, which
+	// rejects overlong forms, surrogates and code points above U+10FFFF
+	unsigned char c = data[0];
+	size_t length;
+	unsigned char low = 0x80, high = 0xBF;
+	if (c >= 0xC2 && c <= 0xDF)
+		length = 2;
+	else if (c >= 0xE0 && c <= 0xEF)
+	{
+		length = 3;
+		if (c == 0xE0)
+			low = 0xA0;
+		else if (c == 0xED)
+			high = 0x9F;
+	}
+	else if (c >= 0xF0 && c <= 0xF4)
+	{
+		length = 4;
+		if (c == 0xF0)
+			low = 0x90;
+		else if (c == 0xF4)
+			high = 0x8F;
+	}
+	else
+		return 0;
+
+	if (size < length || data[1] < low || data[1] > high)
+		return 0;
+	for (size_t i = 2; i < length; i++)
+	{
+		if ((data[i] & 0xC0) != 0x80)
+			return 0;
+	}
+	return length;
+}
+
+//----------------------------------------------------------------------------
+// Escape
+//----------------------------------------------------------------------------
+std::string_view LogEscape::Escape(std::string_view record, std::string& escaped, bool json)
+{
+	static const char HEX[] = "0123456789abcdef";
+
+	const char* data = record.data();
+	size_t size = record.size();
+	size_t pos = FindSpecial(data, size, json);
+	if (pos == size)
+		return record;
+
+	// Copied only once a byte changes, so valid UTF-8 text is not copied
+	bool changed = false;
+	size_t start = 0;
+	while (pos < size)
+	{
+		unsigned char c = (unsigned char)data[pos];
+
+		// Valid sequences stay in the clean run
+		if (c >= 0x80)
+		{
+			size_t length = Utf8Length((const unsigned char*)data + pos, size - pos);
+			if (length)
+			{
+				pos += length;
+				pos += FindSpecial(data + pos, size - pos, json);
+				continue;
+			}
+		}
+
+		if (!changed)
+			escaped.clear();
+		changed = true;
+		escaped.append(data + start, pos - start);
+
+		if (c >= 0x80)
+			escaped.append(REPLACEMENT);
+		else
+		{
+			escaped.push_back('\\');
+			switch (c)
+			{
+			case '\\': escaped.push_back('\\'); break;
+			case '"': escaped.push_back('"'); break;
+			case '\n': escaped.push_back('n'); break;
+			case '\r': escaped.push_back('r'); break;
+			case '\t': escaped.push_back('t'); break;
+			case '\b': escaped.push_back('b'); break;
+			case '\f': escaped.push_back('f'); break;
+			default:
+			{
+				char code[] = { 'u', '0', '0', HEX[c >> 4], HEX[c & 0xF] };
+				escaped.append(code, sizeof(code));
+				break;
+			}
+			}
+		}
+		start = ++pos;
+		pos += FindSpecial(data + pos, size - pos, json);
+	}
+	if (!changed)
+		return record;
+	escaped.append(data + start, size - start);
+	return escaped;
+}
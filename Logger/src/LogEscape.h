@@ -0,0 +1,46 @@
+#ifndef _LOG_ESCAPE_H
+#define _LOG_ESCAPE_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/// @brief LogEscape makes records safe for line and JSON based tooling. Control
+/// characters and backslashes are escaped JSON style, e.g. "\n" and "\u001b", 
+/// and invalid UTF-8 sequences are replaced with U+FFFD. In JSON mode double 
+/// quotes are escaped too, so the result can be placed within a JSON string.
+///
+/// @details Records are scanned 32 bytes at a time with AVX2, 16 bytes at a 
+/// time with SSE2 or NEON, or a byte at a time otherwise. A record without a
+/// byte needing attention is returned unchanged without a copy. Otherwise the
+/// clean runs between such bytes are copied in bulk and only the special bytes
+/// and multi-byte UTF-8 sequences are handled individually.
+class LogEscape
+{
+public:
+	/// The UTF-8 encoding of U+FFFD, the replacement character
+	static constexpr const char* REPLACEMENT = "\xEF\xBF\xBD";
+
+	/// Escape a record
+	/// @param[in] record - the record
+	/// @param[out] escaped - holds the escaped record if the record changes
+	/// @param[in] json - true to also escape double quotes
+	/// @return The record if unchanged, otherwise a view of escaped.
+	static std::string_view Escape(std::string_view record, std::string& escaped, bool json = false);
+
+	/// Find the first byte that is a control character, a backslash, a byte of
+	/// a multi-byte UTF-8 sequence, or in JSON mode a double quote
+	/// @param[in] data - the bytes to scan
+	/// @param[in] size - the number of bytes
+	/// @param[in] json - true to also find double quotes
+	/// @return The offset of the byte, or size if none.
+	static size_t FindSpecial(const char* data, size_t size, bool json);
+
+	/// Get the length of a valid UTF-8 sequence
+	/// @param[in] data - the sequence, starting with a byte >= 0x80
+	/// @param[in] size - the bytes available
+	/// @return The sequence length, or 0 if the sequence is invalid.
+	static size_t Utf8Length(const unsigned char* data, size_t size);
+};
+
+#endif
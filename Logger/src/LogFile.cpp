@@ -0,0 +1,378 @@
+#include "LogFile.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#include <sys/uio.h>
+#endif
+
+using namespace std;
+
+#ifndef WIN32
+/// Maximum iovec entries per writev call
+#ifdef IOV_MAX
+static const int MAX_IOV = IOV_MAX;
+#else
+static const int MAX_IOV = 1024;
+#endif
+
+//----------------------------------------------------------------------------
+// WriteAll
+//----------------------------------------------------------------------------
+static bool WriteAll(int fd, const char* data, size_t size, size_t offset)
+{
+	while (size > 0)
+	{
+		ssize_t written = pwrite(fd, data, size, (off_t)offset);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		data += written;
+		size -= (size_t)written;
+		offset += (size_t)written;
+	}
+	return true;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// ~LogFile
+//----------------------------------------------------------------------------
+LogFile::~LogFile()
+{
+	Close();
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+bool LogFile::Open(const std::string& fileName, size_t bufferSize, bool append)
+{
+	Close();
+
+	m_file = fopen(fileName.c_str(), append ? "ab" : "wb");
+	if (!m_file)
+		return false;
+
+	// Use a private user-space buffer so writes only reach the OS on Flush()
+	if (bufferSize > 0)
+	{
+		m_buffer = std::unique_ptr<char[]>(new char[bufferSize]);
+		setvbuf(m_file, m_buffer.get(), _IOFBF, bufferSize);
+	}
+	// Start the size from the existing file contents when appending
+	m_size = 0;
+	if (append && fseek(m_file, 0, SEEK_END) == 0)
+	{
+		long pos = ftell(m_file);
+		if (pos > 0)
+			m_size = (size_t)pos;
+	}
+	m_lastSync = std::chrono::steady_clock::now();
+	m_openTime = m_lastSync;
+	m_allocated = m_size;
+	Preallocate(m_size);
+
+	m_activeMode = WriteMode::BUFFERED;
+#ifndef WIN32
+	if (m_writeMode == WriteMode::VECTORED)
+		m_activeMode = WriteMode::VECTORED;
+	else if (m_writeMode == WriteMode::DIRECT)
+	{
+		// Full blocks go through the O_DIRECT descriptor. The partial last block
+		// is written through the page cache so the file size stays exact.
+		m_directFd = open(fileName.c_str(), O_RDWR | O_DIRECT | O_CLOEXEC);
+		m_tailFd = open(fileName.c_str(), O_WRONLY | O_CLOEXEC);
+		m_directCapacity = std::max(DIRECT_ALIGNMENT, (bufferSize + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT);
+		void* direct = nullptr;
+		if (m_directFd >= 0 && m_tailFd >= 0 && posix_memalign(&direct, DIRECT_ALIGNMENT, m_directCapacity) == 0)
+			m_direct = static_cast<char*>(direct);
+
+		// Load the partial last block so the next write rewrites it whole
+		m_directOffset = m_size / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+		m_directUsed = m_size - m_directOffset;
+		if (m_direct && (m_directUsed == 0 ||
+			pread(m_directFd, m_direct, DIRECT_ALIGNMENT, (off_t)m_directOffset) >= (ssize_t)m_directUsed))
+			m_activeMode = WriteMode::DIRECT;
+		else
+			CloseDirect();
+	}
+#endif
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void LogFile::Close()
+{
+	if (!m_file)
+		return;
+
+	if (m_activeMode == WriteMode::VECTORED)
+		FlushVectored();
+	else if (m_activeMode == WriteMode::DIRECT)
+		FlushDirect();
+	CloseDirect();
+	m_activeMode = WriteMode::BUFFERED;
+
+	fclose(m_file);
+	m_file = nullptr;
+	m_buffer = nullptr;
+	m_size = 0;
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+bool LogFile::Write(const char* data, size_t size)
+{
+	if (!m_file)
+		return false;
+	Preallocate(m_size + size);
+
+	if (m_activeMode == WriteMode::VECTORED)
+	{
+		// Extend the previous copied piece when possible
+		if (!m_pieces.empty() && !m_pieces.back().data)
+			m_pieces.back().size += size;
+		else
+			m_pieces.push_back(Piece{ nullptr, size, m_arena.size() });
+		m_arena.insert(m_arena.end(), data, data + size);
+		m_size += size;
+		return true;
+	}
+
+	if (m_activeMode == WriteMode::DIRECT)
+	{
+		while (size > 0)
+		{
+			size_t len = std::min(size, m_directCapacity - m_directUsed);
+			memcpy(m_direct + m_directUsed, data, len);
+			m_directUsed += len;
+			m_size += len;
+			data += len;
+			size -= len;
+			if (m_directUsed == m_directCapacity && !FlushDirect())
+				return false;
+		}
+		return true;
+	}
+
+	size_t written = fwrite(data, 1, size, m_file);
+	m_size += written;
+	return written == size;
+}
+
+//----------------------------------------------------------------------------
+// WriteStable
+//----------------------------------------------------------------------------
+bool LogFile::WriteStable(const char* data, size_t size)
+{
+	if (m_activeMode != WriteMode::VECTORED)
+		return Write(data, size);
+	if (!m_file)
+		return false;
+	Preallocate(m_size + size);
+
+	// Extend the previous piece when the data continues it
+	if (!m_pieces.empty() && m_pieces.back().data && m_pieces.back().data + m_pieces.back().size == data)
+		m_pieces.back().size += size;
+	else
+		m_pieces.push_back(Piece{ data, size, 0 });
+	m_size += size;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Flush
+//----------------------------------------------------------------------------
+bool LogFile::Flush(bool forceSync)
+{
+	if (!m_file)
+		return false;
+
+	bool written = false;
+	switch (m_activeMode)
+	{
+		case WriteMode::VECTORED:
+			written = FlushVectored();
+			break;
+		case WriteMode::DIRECT:
+			written = FlushDirect();
+			break;
+		case WriteMode::BUFFERED:
+		default:
+			written = fflush(m_file) == 0;
+			break;
+	}
+	if (!written)
+		return false;
+
+	if (forceSync)
+		return Sync();
+
+	switch (m_syncPolicy)
+	{
+		case SyncPolicy::PER_FLUSH:
+			return Sync();
+
+		case SyncPolicy::INTERVAL:
+			if (std::chrono::steady_clock::now() - m_lastSync >= m_syncInterval)
+				return Sync();
+			return true;
+
+		case SyncPolicy::NONE:
+		default:
+			return true;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Rewind
+//----------------------------------------------------------------------------
+bool LogFile::Rewind()
+{
+	if (!m_file)
+		return false;
+	return fseek(m_file, 0, SEEK_SET) == 0;
+}
+
+//----------------------------------------------------------------------------
+// Sync
+//----------------------------------------------------------------------------
+bool LogFile::Sync()
+{
+	m_lastSync = std::chrono::steady_clock::now();
+#ifdef WIN32
+	return _commit(_fileno(m_file)) == 0;
+#else
+	return fsync(fileno(m_file)) == 0;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Preallocate
+//----------------------------------------------------------------------------
+void LogFile::Preallocate(size_t end)
+{
+#ifdef __linux__
+	if (m_preallocation == 0 || end < m_allocated)
+		return;
+
+	// Reserve without changing the file size. Stop trying if unsupported.
+	size_t target = end + m_preallocation;
+	if (fallocate(fileno(m_file), FALLOC_FL_KEEP_SIZE, (off_t)m_allocated, (off_t)(target - m_allocated)) == 0)
+		m_allocated = target;
+	else
+		m_preallocation = 0;
+#else
+	(void)end;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// FlushVectored
+//----------------------------------------------------------------------------
+bool LogFile::FlushVectored()
+{
+#ifdef WIN32
+	return true;
+#else
+	// Resolve copied pieces once the arena no longer grows
+	std::vector<iovec> iov;
+	iov.reserve(std::min<size_t>(m_pieces.size(), MAX_IOV));
+	size_t piece = 0;
+	bool success = true;
+	int fd = fileno(m_file);
+	while (success && piece < m_pieces.size())
+	{
+		iov.clear();
+		for (; piece < m_pieces.size() && iov.size() < (size_t)MAX_IOV; piece++)
+		{
+			const Piece& p = m_pieces[piece];
+			const char* data = p.data ? p.data : m_arena.data() + p.offset;
+			iov.push_back(iovec{ const_cast<char*>(data), p.size });
+		}
+
+		// Continue after a partial write
+		size_t first = 0;
+		while (first < iov.size())
+		{
+			ssize_t written = writev(fd, &iov[first], (int)(iov.size() - first));
+			if (written < 0 && errno == EINTR)
+				continue;
+			if (written <= 0)
+			{
+				success = false;
+				break;
+			}
+			size_t remaining = (size_t)written;
+			while (first < iov.size() && remaining >= iov[first].iov_len)
+				remaining -= iov[first++].iov_len;
+			if (remaining > 0)
+			{
+				iov[first].iov_base = static_cast<char*>(iov[first].iov_base) + remaining;
+				iov[first].iov_len -= remaining;
+			}
+		}
+	}
+	m_pieces.clear();
+	m_arena.clear();
+	return success;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// FlushDirect
+//----------------------------------------------------------------------------
+bool LogFile::FlushDirect()
+{
+#ifdef WIN32
+	return true;
+#else
+	if (m_directUsed == 0)
+		return true;
+
+	// Whole blocks bypass the page cache. The partial last block stays in the
+	// buffer and is written again, whole, by the next flush.
+	size_t full = m_directUsed / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+	size_t tail = m_directUsed - full;
+	if (full > 0 && !WriteAll(m_directFd, m_direct, full, m_directOffset))
+		return false;
+	if (tail > 0 && !WriteAll(m_tailFd, m_direct + full, tail, m_directOffset + full))
+		return false;
+	if (full > 0)
+	{
+		memmove(m_direct, m_direct + full, tail);
+		m_directOffset += full;
+		m_directUsed = tail;
+	}
+	return true;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// CloseDirect
+//----------------------------------------------------------------------------
+void LogFile::CloseDirect()
+{
+#ifndef WIN32
+	if (m_directFd >= 0)
+		close(m_directFd);
+	if (m_tailFd >= 0)
+		close(m_tailFd);
+#endif
+	free(m_direct);
+	m_directFd = m_tailFd = -1;
+	m_direct = nullptr;
+	m_directUsed = 0;
+}
@@ -0,0 +1,199 @@
+#ifndef _LOG_FILE_H
+#define _LOG_FILE_H
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+/// @brief LogFile is a long-lived buffered file sink. The file is opened once and 
+/// kept open. Writes are collected within a user-space buffer and handed to the 
+/// operating system on Flush(). The sync policy controls when data is forced to 
+/// the storage device. LogFile is not thread-safe.
+///
+/// @details The write mode selects how a flush reaches the operating system. 
+/// BUFFERED writes the stdio buffer. VECTORED gathers the pieces written since
+/// the last flush into writev calls, so data passed to WriteStable() is never 
+/// copied. DIRECT copies into a 4 KiB aligned buffer whose whole blocks are 
+/// written with O_DIRECT, bypassing the page cache. The partial last block is
+/// written through the page cache and rewritten whole by the next flush, so 
+/// the file size is always exact. VECTORED
+/// and DIRECT are POSIX only and fall back to BUFFERED elsewhere or when the
+/// file system refuses O_DIRECT. Preallocation reserves file extents ahead of
+/// the data with fallocate on Linux so appends do not allocate blocks.
+class LogFile
+{
+public:
+	/// Policy controlling when flushed data is synchronized to the storage device
+	enum class SyncPolicy
+	{
+		NONE,		///< Never sync. The operating system writes data back.
+		PER_FLUSH,	///< Sync on every Flush() call.
+		INTERVAL	///< Sync on Flush() when the sync interval has elapsed.
+	};
+
+	/// How flushed data is handed to the operating system
+	enum class WriteMode
+	{
+		BUFFERED,	///< One write per stdio buffer.
+		VECTORED,	///< Gathered writev calls per flush.
+		DIRECT		///< Aligned O_DIRECT writes.
+	};
+
+	/// Default user-space buffer size in bytes
+	static const size_t DEFAULT_BUFFER_SIZE = 64 * 1024;
+
+	/// Block size DIRECT writes are aligned to
+	static constexpr size_t DIRECT_ALIGNMENT = 4096;
+
+	/// Constructor
+	LogFile() = default;
+
+	/// Destructor
+	~LogFile();
+
+	/// Open the file. Any previously opened file is closed first.
+	/// @param[in] fileName - the file to open
+	/// @param[in] bufferSize - the user-space buffer size in bytes
+	/// @param[in] append - true to append to the file, false to truncate it
+	/// @return True if success.
+	bool Open(const std::string& fileName, size_t bufferSize = DEFAULT_BUFFER_SIZE, bool append = true);
+
+	/// Flush and close the file.
+	void Close();
+
+	/// Check if the file is open
+	/// @return True if the file is open.
+	bool IsOpen() const { return m_file != nullptr; }
+
+	/// Write data into the user-space buffer
+	/// @param[in] data - the data to write
+	/// @param[in] size - the data size in bytes
+	/// @return True if success.
+	bool Write(const char* data, size_t size);
+
+	/// Write a string into the user-space buffer
+	/// @param[in] str - the string to write
+	/// @return True if success.
+	bool Write(const std::string& str) { return Write(str.data(), str.size()); }
+
+	/// Write data that stays valid and unchanged until the next Flush(). Only
+	/// referenced, not copied, in WriteMode::VECTORED.
+	/// @param[in] data - the data to write
+	/// @param[in] size - the data size in bytes
+	/// @return True if success.
+	bool WriteStable(const char* data, size_t size);
+
+	/// Hand buffered data to the operating system and sync according to the 
+	/// sync policy. Called once per flush window.
+	/// @param[in] forceSync - true to sync regardless of the sync policy
+	/// @return True if success.
+	bool Flush(bool forceSync = false);
+
+	/// Move the write position to the start of the file. Used to overwrite
+	/// small fixed-size files in place. WriteMode::BUFFERED only.
+	/// @return True if success.
+	bool Rewind();
+
+	/// Set the sync policy
+	/// @param[in] policy - the sync policy
+	/// @param[in] interval - the minimum time between syncs for SyncPolicy::INTERVAL
+	void SetSyncPolicy(SyncPolicy policy, std::chrono::milliseconds interval = std::chrono::milliseconds(0))
+	{
+		m_syncPolicy = policy;
+		m_syncInterval = interval;
+	}
+
+	/// Get the sync policy
+	/// @return The sync policy.
+	SyncPolicy GetSyncPolicy() const { return m_syncPolicy; }
+
+	/// Set the write mode. Takes effect when the file is next opened.
+	/// @param[in] mode - the write mode
+	void SetWriteMode(WriteMode mode) { m_writeMode = mode; }
+
+	/// Get the write mode of the open file, BUFFERED if the requested mode
+	/// is unavailable
+	/// @return The write mode.
+	WriteMode GetWriteMode() const { return m_activeMode; }
+
+	/// Set how far file extents are reserved ahead of the data. Reserved space
+	/// is not included in the file size.
+	/// @param[in] bytes - the bytes to reserve each time the data reaches the 
+	///     reserved space, or 0 to disable
+	void SetPreallocation(size_t bytes) { m_preallocation = bytes; }
+
+	/// Get the file size including data not yet flushed
+	/// @return The file size in bytes.
+	size_t GetSize() const { return m_size; }
+
+	/// Get the time the file was opened
+	/// @return The open time.
+	std::chrono::steady_clock::time_point GetOpenTime() const { return m_openTime; }
+
+private:
+	LogFile(const LogFile&) = delete;
+	LogFile& operator=(const LogFile&) = delete;
+
+	/// A piece of data written in WriteMode::VECTORED
+	struct Piece
+	{
+		/// The data, or nullptr if the data was copied to m_arena
+		const char* data;
+		size_t size;
+
+		/// Offset of copied data within m_arena
+		size_t offset;
+	};
+
+	/// Force flushed data to the storage device
+	/// @return True if success.
+	bool Sync();
+
+	/// Reserve file extents for the data up to an end offset
+	/// @param[in] end - the file size to reserve for
+	void Preallocate(size_t end);
+
+	/// Write the gathered pieces with writev
+	/// @return True if success.
+	bool FlushVectored();
+
+	/// Write the whole blocks of the aligned buffer with O_DIRECT and the 
+	/// partial last block through the page cache
+	/// @return True if success.
+	bool FlushDirect();
+
+	/// Close the O_DIRECT descriptor and release the aligned buffer
+	void CloseDirect();
+
+	FILE* m_file = nullptr;
+	std::unique_ptr<char[]> m_buffer;
+	SyncPolicy m_syncPolicy = SyncPolicy::NONE;
+	std::chrono::milliseconds m_syncInterval = std::chrono::milliseconds(0);
+	std::chrono::steady_clock::time_point m_lastSync;
+	std::chrono::steady_clock::time_point m_openTime;
+	size_t m_size = 0;
+
+	WriteMode m_writeMode = WriteMode::BUFFERED;
+	WriteMode m_activeMode = WriteMode::BUFFERED;
+
+	/// Pieces gathered since the last flush and the copied piece data
+	std::vector<Piece> m_pieces;
+	std::vector<char> m_arena;
+
+	/// O_DIRECT descriptor, partial block descriptor and aligned buffer. 
+	/// m_directOffset is the aligned file offset of the first buffer byte.
+	int m_directFd = -1;
+	int m_tailFd = -1;
+	char* m_direct = nullptr;
+	size_t m_directCapacity = 0;
+	size_t m_directUsed = 0;
+	size_t m_directOffset = 0;
+
+	/// Preallocation step and the file size reserved so far
+	size_t m_preallocation = 0;
+	size_t m_allocated = 0;
+};
+
+#endif
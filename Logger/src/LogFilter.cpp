@@ -0,0 +1,127 @@
+#include "LogFilter.h"
+#include "LogTimestamp.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// LogFilter
+//----------------------------------------------------------------------------
+LogFilter::LogFilter(std::vector<Rule> rules) : m_rules(std::move(rules))
+{
+	// Give each byte occurring in a pattern its own class
+	memset(m_class, 0, sizeof(m_class));
+	memset(m_first, 0, sizeof(m_first));
+	uint32_t classes = 1;
+	for (const Rule& rule : m_rules)
+	{
+		for (char c : rule.pattern)
+		{
+			uint16_t& byteClass = m_class[(uint8_t)c];
+			if (byteClass == 0)
+				byteClass = (uint16_t)classes++;
+		}
+	}
+	const uint32_t startClass = classes++;
+	m_classes = classes;
+
+	// Build the trie of the patterns. A prefix pattern begins with the start
+	// of the body. Missing transitions are 0 until the failure links fill them.
+	vector<uint32_t> trie(m_classes, 0);
+	m_match.assign(1, NO_RULE);
+	auto child = [this, &trie](uint32_t state, uint32_t byteClass) {
+		const size_t index = state * m_classes + byteClass;
+		if (trie[index] == 0)
+		{
+			trie[index] = (uint32_t)m_match.size();
+			m_match.push_back(NO_RULE);
+			trie.resize(trie.size() + m_classes, 0);
+		}
+		return trie[index];
+	};
+	for (uint32_t i = 0; i < m_rules.size(); i++)
+	{
+		const Rule& rule = m_rules[i];
+		if (rule.pattern.empty())
+			continue;
+		uint32_t state = 0;
+		if (rule.match == Match::PREFIX)
+			state = child(state, startClass);
+		else
+			m_first[(uint8_t)rule.pattern[0]] = 1;
+		for (char c : rule.pattern)
+			state = child(state, m_class[(uint8_t)c]);
+		m_match[state] = std::min(m_match[state], i);
+	}
+
+	// Fold the failure links into the transitions breadth first, so each state
+	// also matches the rules of its longest proper suffix in the trie
+	const size_t states = m_match.size();
+	vector<uint32_t> fail(states, 0);
+	m_delta.assign(states * m_classes, 0);
+	deque<uint32_t> queue;
+	for (uint32_t c = 0; c < m_classes; c++)
+	{
+		uint32_t next = trie[c];
+		m_delta[c] = next;
+		if (next)
+			queue.push_back(next);
+	}
+	while (!queue.empty())
+	{
+		uint32_t state = queue.front();
+		queue.pop_front();
+		m_match[state] = std::min(m_match[state], m_match[fail[state]]);
+		for (uint32_t c = 0; c < m_classes; c++)
+		{
+			uint32_t next = trie[state * m_classes + c];
+			uint32_t fallback = m_delta[fail[state] * m_classes + c];
+			if (next)
+			{
+				fail[next] = fallback;
+				m_delta[state * m_classes + c] = next;
+				queue.push_back(next);
+			}
+			else
+				m_delta[state * m_classes + c] = fallback;
+		}
+	}
+	m_start = m_delta[startClass];
+}
+
+//----------------------------------------------------------------------------
+// Find
+//----------------------------------------------------------------------------
+const LogFilter::Rule* LogFilter::Find(std::string_view record) const
+{
+	uint64_t tick;
+	string_view body = LogTimestamp::Split(record, tick);
+	const uint8_t* p = (const uint8_t*)body.data();
+	const uint8_t* end = p + body.size();
+
+	uint32_t state = m_start;
+	uint32_t best = NO_RULE;
+	while (p < end)
+	{
+		// Skip the bytes no pattern starts with while nothing is matched
+		if (state == 0)
+		{
+			while (p < end && !m_first[*p])
+				p++;
+			if (p == end)
+				break;
+		}
+
+		state = m_delta[state * m_classes + m_class[*p++]];
+		uint32_t rule = m_match[state];
+		if (rule < best)
+		{
+			best = rule;
+			if (best == 0)
+				break;
+		}
+	}
+	return best == NO_RULE ? nullptr : &m_rules[best];
+}
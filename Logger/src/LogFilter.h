@@ -0,0 +1,89 @@
+#ifndef _LOG_FILTER_H
+#define _LOG_FILTER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+class Logger;
+
+/// @brief LogFilter matches a record against a set of substring and prefix
+/// patterns in one pass, whatever the number of patterns. Logger::SetFilter()
+/// applies it to each batch of records on the Logger thread to drop records or
+/// reroute them to another Logger before the log data stores them.
+///
+/// @details The patterns are compiled by the constructor into an Aho-Corasick
+/// automaton: a transition table over the byte classes of the pattern bytes,
+/// with the failure links folded in, so matching reads one table entry per
+/// record byte. Bytes starting no pattern are skipped without a table lookup
+/// while no pattern is partly matched. A prefix pattern matches the record body,
+/// after any LogTimestamp stamp, from its first byte. Matching is case sensitive.
+/// A LogFilter is immutable once constructed, so a Logger thread may match with
+/// it while another thread builds a replacement.
+class LogFilter
+{
+public:
+	/// Where a pattern must occur
+	enum class Match
+	{
+		SUBSTRING,	///< Anywhere within the record
+		PREFIX		///< At the start of the record body
+	};
+
+	/// A pattern and the action taken on the records matching it
+	struct Rule
+	{
+		/// The bytes to match. An empty pattern never matches.
+		std::string pattern;
+
+		/// Where the pattern must occur
+		Match match = Match::SUBSTRING;
+
+		/// The Logger the record is written to instead, or nullptr to drop it
+		Logger* route = nullptr;
+	};
+
+	/// Constructor. Compiles the rules.
+	/// @param[in] rules - the rules. A record matching several rules is handled
+	///		by the first of them.
+	explicit LogFilter(std::vector<Rule> rules);
+
+	/// Find the first rule a record matches
+	/// @param[in] record - the record, optionally stamped
+	/// @return The rule, or nullptr if none matches.
+	const Rule* Find(std::string_view record) const;
+
+	/// Get the rules
+	/// @return The rules in priority order.
+	const std::vector<Rule>& GetRules() const { return m_rules; }
+
+	/// Get the automaton size
+	/// @return The number of states.
+	size_t GetStateCount() const { return m_match.size(); }
+
+private:
+	/// No rule matched
+	static constexpr uint32_t NO_RULE = UINT32_MAX;
+
+	const std::vector<Rule> m_rules;
+
+	/// The byte class of each byte. Class 0 holds the bytes in no pattern and
+	/// the last class is the start of the record body, read before its first byte.
+	uint16_t m_class[256];
+	uint32_t m_classes = 0;
+
+	/// Nonzero for the bytes a pattern starts with
+	uint8_t m_first[256];
+
+	/// The next state of each state and byte class, m_classes entries per state
+	std::vector<uint32_t> m_delta;
+
+	/// The first rule matched on reaching each state, or NO_RULE
+	std::vector<uint32_t> m_match;
+
+	/// The state after the start of the record body
+	uint32_t m_start = 0;
+};
+
+#endif
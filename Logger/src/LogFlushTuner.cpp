@@ -0,0 +1,48 @@
+#include "LogFlushTuner.h"
+#include <algorithm>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// SetLimits
+//----------------------------------------------------------------------------
+void LogFlushTuner::SetLimits(chrono::milliseconds minInterval, chrono::milliseconds maxInterval, size_t batchBytes)
+{
+	m_minInterval = max(chrono::milliseconds(1), min(minInterval, maxInterval));
+	m_maxInterval = max(m_minInterval, maxInterval);
+	m_batchBytes = batchBytes ? batchBytes : 1;
+	m_interval = min(max(m_interval, m_minInterval), GetBudget());
+}
+
+//----------------------------------------------------------------------------
+// Update
+//----------------------------------------------------------------------------
+chrono::milliseconds LogFlushTuner::Update(chrono::milliseconds flushTime, size_t bytes)
+{
+	// Smooth the flush time so a single slow flush does not halve the interval
+	m_flushTime += ((double)flushTime.count() - m_flushTime) / 4;
+
+	if (bytes >= m_batchBytes)
+	{
+		// Heavy load: grow the interval for larger batches
+		m_interval += m_interval / 2 + chrono::milliseconds(1);
+	}
+	else if (bytes < m_batchBytes / 4)
+	{
+		// Light load: flushes are cheap so write records sooner
+		m_interval /= 2;
+	}
+
+	// Stay within the limits and the latency target
+	m_interval = min(max(m_interval, m_minInterval), GetBudget());
+	return m_interval;
+}
+
+//----------------------------------------------------------------------------
+// GetBudget
+//----------------------------------------------------------------------------
+chrono::milliseconds LogFlushTuner::GetBudget() const
+{
+	auto budget = m_maxInterval - chrono::milliseconds((int64_t)m_flushTime);
+	return max(budget, m_minInterval);
+}
@@ -0,0 +1,50 @@
+#ifndef _LOG_FLUSH_TUNER_H
+#define _LOG_FLUSH_TUNER_H
+
+#include <chrono>
+#include <cstddef>
+
+/// @brief LogFlushTuner adapts the flush interval to the measured flush times 
+/// and batch sizes. Under a heavy load the interval grows so each flush writes
+/// a larger batch. Under a light load it shrinks toward the minimum so records
+/// reach the disk sooner. The interval plus the average flush time never 
+/// exceeds the maximum interval, so a slow disk shortens the interval to keep 
+/// the latency target.
+///
+/// @details Not thread-safe. Only the Logger thread uses the tuner.
+class LogFlushTuner
+{
+public:
+	/// Set the interval limits. The current interval is clamped to the limits.
+	/// @param[in] minInterval - the shortest interval
+	/// @param[in] maxInterval - the longest time a record waits to be written to
+	///     disk, including the flush time
+	/// @param[in] batchBytes - the bytes per flush above which the load is heavy
+	void SetLimits(std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval, size_t batchBytes);
+
+	/// Update the interval after a flush completes
+	/// @param[in] flushTime - the time taken by the flush
+	/// @param[in] bytes - the bytes written by the flush
+	/// @return The new interval.
+	std::chrono::milliseconds Update(std::chrono::milliseconds flushTime, size_t bytes);
+
+	/// Get the current interval
+	/// @return The interval.
+	std::chrono::milliseconds GetInterval() const { return m_interval; }
+
+private:
+	/// Longest interval meeting the latency target at the average flush time
+	std::chrono::milliseconds GetBudget() const;
+
+	std::chrono::milliseconds m_minInterval = std::chrono::milliseconds(10);
+	std::chrono::milliseconds m_maxInterval = std::chrono::milliseconds(1000);
+	size_t m_batchBytes = 64 * 1024;
+
+	/// The interval starts short and grows with the load
+	std::chrono::milliseconds m_interval = std::chrono::milliseconds(10);
+
+	/// Moving average of the flush time in milliseconds
+	double m_flushTime = 0;
+};
+
+#endif
@@ -0,0 +1,135 @@
+#include "LogIndex.h"
+#include "LogMerge.h"
+#include <cstring>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// BloomHashes
+//----------------------------------------------------------------------------
+/// Get the two base hashes of a token. Bit i is h1 + i * h2 (Kirsch-Mitzenmacher).
+static void BloomHashes(string_view token, uint64_t& h1, uint64_t& h2)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (char c : token)
+	{
+		hash ^= (uint8_t)c;
+		hash *= 1099511628211ull;
+	}
+	h1 = hash;
+	h2 = (hash >> 32) | (hash << 32) | 1;
+}
+
+//----------------------------------------------------------------------------
+// AddToken
+//----------------------------------------------------------------------------
+void LogIndex::AddToken(string_view token, uint64_t* bloom)
+{
+	uint64_t h1, h2;
+	BloomHashes(token, h1, h2);
+	for (int i = 0; i < BLOOM_HASHES; i++)
+	{
+		uint64_t bit = (h1 + (uint64_t)i * h2) % BLOOM_BITS;
+		bloom[bit / 64] |= 1ull << (bit % 64);
+	}
+}
+
+//----------------------------------------------------------------------------
+// MayContain
+//----------------------------------------------------------------------------
+bool LogIndex::MayContain(string_view token, const uint64_t* bloom)
+{
+	uint64_t h1, h2;
+	BloomHashes(token, h1, h2);
+	for (int i = 0; i < BLOOM_HASHES; i++)
+	{
+		uint64_t bit = (h1 + (uint64_t)i * h2) % BLOOM_BITS;
+		if (!(bloom[bit / 64] & (1ull << (bit % 64))))
+			return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// GetBody
+//----------------------------------------------------------------------------
+string_view LogIndex::GetBody(string_view line)
+{
+	// The stamp is followed by a space
+	if (LogMerge::GetTime(line).empty())
+		return line;
+	return line.substr(LogMerge::TIME_SIZE + (line.size() > LogMerge::TIME_SIZE ? 1 : 0));
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+bool LogIndex::Open(const string& logFileName, size_t logSize)
+{
+	Close();
+	if (!m_file.Open(logFileName + SUFFIX))
+		return false;
+
+	// Log data before logSize not covered by an entry is read linearly
+	m_timeNs = NO_TIME;
+	ResetBlock(logSize);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void LogIndex::Close()
+{
+	if (!m_file.IsOpen())
+		return;
+	if (m_block.lines > 0)
+		WriteBlock();
+	m_file.Close();
+}
+
+//----------------------------------------------------------------------------
+// Add
+//----------------------------------------------------------------------------
+void LogIndex::Add(string_view line, int64_t timeNs)
+{
+	if (!m_file.IsOpen())
+		return;
+
+	// Stamps are rendered to the microsecond so the index uses the same precision
+	if (timeNs != NO_TIME)
+		m_timeNs = timeNs - timeNs % 1000;
+	if (m_block.lines == 0 || m_timeNs < m_block.minNs)
+		m_block.minNs = m_timeNs;
+	if (m_block.lines == 0 || m_timeNs > m_block.maxNs)
+		m_block.maxNs = m_timeNs;
+	m_block.endNs = m_timeNs;
+
+	// The rendered stamp is not tokenized. Each line would add unique tokens.
+	ForEachToken(GetBody(line), [this](string_view token) { AddToken(token, m_block.bloom); });
+
+	m_block.lines++;
+	m_block.size += line.size() + 1;
+	if (m_block.size >= BLOCK_SIZE)
+		WriteBlock();
+}
+
+//----------------------------------------------------------------------------
+// WriteBlock
+//----------------------------------------------------------------------------
+void LogIndex::WriteBlock()
+{
+	m_file.Write(reinterpret_cast<const char*>(&m_block), sizeof(m_block));
+	ResetBlock(m_block.offset + m_block.size);
+}
+
+//----------------------------------------------------------------------------
+// ResetBlock
+//----------------------------------------------------------------------------
+void LogIndex::ResetBlock(uint64_t offset)
+{
+	memset(&m_block, 0, sizeof(m_block));
+	m_block.offset = offset;
+	m_block.startNs = m_timeNs;
+	m_block.endNs = m_timeNs;
+}
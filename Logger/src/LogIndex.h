@@ -0,0 +1,144 @@
+#ifndef _LOG_INDEX_H
+#define _LOG_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include "LogFile.h"
+
+/// @brief LogIndex writes a sparse side index of a text log file so LogReader
+/// can seek to a time range and skip blocks that cannot contain a keyword.
+///
+/// @details The log file is divided into blocks of about BLOCK_SIZE bytes that 
+/// end on a line boundary. One fixed-size Block entry is appended to the index 
+/// file, the log file name plus SUFFIX, when a block is complete or the index is
+/// closed. An entry holds the block's file range, its time range and a bloom 
+/// filter of the tokens of its lines. A token is a maximal run of letters, 
+/// digits and underscores. The time of a stamped line is its UTC stamp and an 
+/// unstamped line has the time of the line before it. Entries are written in 
+/// host byte order. A range of the log file not covered by an entry, e.g. the 
+/// current partial block, must be read linearly. LogIndex is not thread-safe.
+class LogIndex
+{
+public:
+	/// Appended to the log file name to form the index file name
+	static constexpr const char* SUFFIX = ".idx";
+
+	/// Log bytes covered by a block entry
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+	/// Bloom filter size in bits, and the bits set per token
+	static const size_t BLOOM_BITS = 8192;
+	static const int BLOOM_HASHES = 3;
+
+	/// Time of a line preceding any stamped line
+	static const int64_t NO_TIME = INT64_MIN;
+
+	/// An index entry
+	struct Block
+	{
+		/// Log file range of the block
+		uint64_t offset;
+		uint64_t size;
+
+		/// Lines in the block
+		uint64_t lines;
+
+		/// Time of the line before the block and of the block's last line
+		int64_t startNs;
+		int64_t endNs;
+
+		/// Earliest and latest line time in the block
+		int64_t minNs;
+		int64_t maxNs;
+
+		/// Bloom filter of the line tokens
+		uint64_t bloom[BLOOM_BITS / 64];
+	};
+
+	/// Destructor. Writes the partial block.
+	~LogIndex() { Close(); }
+
+	/// Open the index of a log file. Any previously opened index is closed first.
+	/// @param[in] logFileName - the log file name
+	/// @param[in] logSize - the log file size. The next block starts here.
+	/// @return True if success.
+	bool Open(const std::string& logFileName, size_t logSize);
+
+	/// Write the partial block and close the index
+	void Close();
+
+	/// Check if the index is open
+	/// @return True if the index is open.
+	bool IsOpen() const { return m_file.IsOpen(); }
+
+	/// Add a line written to the log file, excluding its newline
+	/// @param[in] line - the rendered line
+	/// @param[in] timeNs - the line's stamp in nanoseconds since the system clock 
+	///     epoch, or NO_TIME if the line is not stamped
+	void Add(std::string_view line, int64_t timeNs);
+
+	/// Account for log file bytes that are not a line, e.g. a LogChecksum 
+	/// trailer, so later entries keep their file ranges
+	/// @param[in] size - the bytes written
+	void Skip(size_t size)
+	{
+		if (m_file.IsOpen())
+			m_block.size += size;
+	}
+
+	/// Hand completed entries to the operating system. Called after the log 
+	/// file is flushed so entries never cover unwritten log data.
+	/// @return True if success.
+	bool Flush() { return m_file.Flush(); }
+
+	/// Call a function for each token of a text
+	/// @param[in] text - the text
+	/// @param[in] func - called with each token
+	template <class F>
+	static void ForEachToken(std::string_view text, F&& func)
+	{
+		size_t start = 0;
+		for (size_t i = 0; i <= text.size(); i++)
+		{
+			char c = i < text.size() ? text[i] : ' ';
+			bool word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+			if (word)
+				continue;
+			if (i > start)
+				func(text.substr(start, i - start));
+			start = i + 1;
+		}
+	}
+
+	/// Add a token to a bloom filter
+	/// @param[in] token - the token
+	/// @param[in,out] bloom - the filter
+	static void AddToken(std::string_view token, uint64_t* bloom);
+
+	/// Check if a bloom filter may contain a token
+	/// @param[in] token - the token
+	/// @param[in] bloom - the filter
+	/// @return False if the token is definitely not in the filter.
+	static bool MayContain(std::string_view token, const uint64_t* bloom);
+
+	/// Get the body of a line after its stamp
+	/// @param[in] line - the rendered line
+	/// @return The line without a leading "YYYY-MM-DDTHH:MM:SS.uuuuuuZ ".
+	static std::string_view GetBody(std::string_view line);
+
+private:
+	/// Append the current block entry then start the next block after it
+	void WriteBlock();
+
+	/// Start an empty block at an offset
+	void ResetBlock(uint64_t offset);
+
+	LogFile m_file;
+	Block m_block = {};
+
+	/// Time of the last line added
+	int64_t m_timeNs = NO_TIME;
+};
+
+#endif
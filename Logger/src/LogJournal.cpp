@@ -0,0 +1,262 @@
+#include "LogJournal.h"
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+bool LogJournal::Open(const std::string& fileName, size_t capacity, const std::function<void(std::string_view)>& recover)
+{
+	Close();
+	m_fileName = fileName;
+	m_unjournaled = 0;
+
+	// Too small to hold a record header
+	if (capacity <= sizeof(LengthType))
+		return false;
+
+	// A journal of the same size is reused in place so its records stay
+	// journaled until flushed
+	std::vector<std::string> moved;
+	if (Map(0))
+	{
+		if (Load())
+		{
+			if (m_capacity == capacity)
+			{
+				ForEach(recover);
+				return true;
+			}
+			ForEach([&moved](std::string_view record) { moved.emplace_back(record); });
+		}
+		Close();
+	}
+
+	if (!Map(HEADER_SIZE + capacity))
+		return false;
+
+	m_capacity = capacity;
+	m_tail = 0;
+	m_head = 0;
+	Header* header = GetHeader();
+	header->capacity = capacity;
+	header->tail = 0;
+	header->head = 0;
+
+	// The magic is stored last so a partly initialized file is never loaded
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = MAGIC;
+
+	for (const std::string& record : moved)
+	{
+		Append(record);
+		recover(record);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Map
+//----------------------------------------------------------------------------
+bool LogJournal::Map(size_t fileSize)
+{
+#ifdef WIN32
+	HANDLE file = CreateFileA(m_fileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+		NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (fileSize > 0)
+	{
+		// Truncate first so the new file is zero filled
+		size.QuadPart = 0;
+		SetFilePointerEx(file, size, NULL, FILE_BEGIN);
+		SetEndOfFile(file);
+		size.QuadPart = (LONGLONG)fileSize;
+	}
+	else if (!GetFileSizeEx(file, &size))
+		size.QuadPart = 0;
+	if ((size_t)size.QuadPart <= HEADER_SIZE)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	void* map = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, (size_t)size.QuadPart);
+	if (!map)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_mapSize = (size_t)size.QuadPart;
+#else
+	int fd = open(m_fileName.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+		return false;
+
+	size_t size = fileSize;
+	if (fileSize > 0)
+	{
+		// Truncate first so the new file is zero filled
+		if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)fileSize) != 0)
+		{
+			close(fd);
+			return false;
+		}
+	}
+	else
+	{
+		struct stat st;
+		size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0;
+	}
+	if (size <= HEADER_SIZE)
+	{
+		close(fd);
+		return false;
+	}
+	void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+	{
+		close(fd);
+		return false;
+	}
+	m_fd = fd;
+	m_mapSize = size;
+#endif
+	m_map = static_cast<char*>(map);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Load
+//----------------------------------------------------------------------------
+bool LogJournal::Load()
+{
+	const Header* header = GetHeader();
+	if (header->magic != MAGIC || header->capacity != m_mapSize - HEADER_SIZE)
+		return false;
+	if (header->head < header->tail || header->head - header->tail > header->capacity)
+		return false;
+	m_capacity = (size_t)header->capacity;
+	m_tail = header->tail;
+	m_head = header->head;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void LogJournal::Close()
+{
+	if (!m_map)
+		return;
+
+#ifdef WIN32
+	UnmapViewOfFile(m_map);
+	CloseHandle(m_mapping);
+	CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap(m_map, m_mapSize);
+	close(m_fd);
+	m_fd = -1;
+#endif
+	m_map = nullptr;
+	m_mapSize = 0;
+	m_capacity = 0;
+	m_tail = 0;
+	m_head = 0;
+}
+
+//----------------------------------------------------------------------------
+// ForEach
+//----------------------------------------------------------------------------
+void LogJournal::ForEach(const std::function<void(std::string_view)>& func) const
+{
+	const char* data = GetData();
+	uint64_t pos = m_tail;
+	while (pos < m_head)
+	{
+		size_t index = (size_t)(pos % m_capacity);
+		LengthType len = WRAP;
+		if (m_capacity - index >= sizeof(LengthType))
+			memcpy(&len, data + index, sizeof(len));
+		if (len == WRAP)
+		{
+			pos += m_capacity - index;
+			continue;
+		}
+
+		// A corrupt length ends the recovery
+		if (len > m_capacity - index - sizeof(LengthType))
+			return;
+		func(std::string_view(data + index + sizeof(LengthType), len));
+		pos += sizeof(LengthType) + len;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Append
+//----------------------------------------------------------------------------
+bool LogJournal::Append(std::string_view record)
+{
+	if (!m_map)
+		return false;
+
+	size_t size = sizeof(LengthType) + record.size();
+	size_t index = (size_t)(m_head % m_capacity);
+
+	// A record is stored contiguously so skip the end of the buffer if it does not fit
+	uint64_t start = index + size > m_capacity ? m_head + (m_capacity - index) : m_head;
+	if (size > m_capacity || start + size - m_tail > m_capacity)
+	{
+		m_unjournaled++;
+		return false;
+	}
+
+	char* data = GetData();
+	if (start != m_head && m_capacity - index >= sizeof(LengthType))
+		memcpy(data + index, &WRAP, sizeof(WRAP));
+	LengthType len = (LengthType)record.size();
+	char* dest = data + (size_t)(start % m_capacity);
+	memcpy(dest, &len, sizeof(len));
+	memcpy(dest + sizeof(len), record.data(), record.size());
+	m_head = start + size;
+
+	// Publish the head after the record bytes
+	std::atomic_thread_fence(std::memory_order_release);
+	GetHeader()->head = m_head;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Release
+//----------------------------------------------------------------------------
+void LogJournal::Release(uint64_t pos)
+{
+	if (!m_map || pos <= m_tail || pos > m_head)
+		return;
+	m_tail = pos;
+	GetHeader()->tail = pos;
+}
@@ -0,0 +1,131 @@
+#ifndef _LOG_JOURNAL_H
+#define _LOG_JOURNAL_H
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+
+/// @brief LogJournal keeps the records not yet flushed in a memory-mapped file
+/// so they survive a process restart. Appending copies a record into the
+/// mapping, so no system call is made per record and the operating system
+/// writes the pages back on its own schedule. Records are replayed when the
+/// journal is next opened.
+///
+/// @details The file holds a header followed by a circular buffer of
+/// length-prefixed records, laid out as in LogRing. The header holds the
+/// monotonic byte positions of the oldest record (the tail) and the end of the
+/// newest (the head). The head is stored after the record bytes so a journal
+/// left by a crash holds only complete records. Release() moves the tail once
+/// the records before a position are durably written elsewhere.
+///
+/// Unlike LogRing a full journal never discards records. Append() fails and
+/// the caller keeps the record in memory only. The journal survives a process
+/// crash but not a power loss, since the mapping is not synced. LogJournal is
+/// not thread-safe.
+class LogJournal
+{
+public:
+	LogJournal() = default;
+	~LogJournal() { Close(); }
+
+	/// Open the journal file, creating it if needed, and recover the records
+	/// left by the previous process. Records left in a journal of another size
+	/// are moved into the new one.
+	/// @param[in] fileName - the journal file name
+	/// @param[in] capacity - the record buffer size in bytes
+	/// @param[in] recover - called with each record recovered, oldest first
+	/// @return True if the journal is open.
+	bool Open(const std::string& fileName, size_t capacity, const std::function<void(std::string_view)>& recover);
+
+	/// Unmap and close the journal file. Records not released are kept in the
+	/// file for the next Open().
+	void Close();
+
+	/// Check if the journal is open
+	/// @return True if open.
+	bool IsOpen() const { return m_map != nullptr; }
+
+	/// Get the record buffer size
+	/// @return The capacity in bytes, or 0 if not open.
+	size_t Capacity() const { return m_capacity; }
+
+	/// Append a record
+	/// @param[in] record - the record to append
+	/// @return True if journaled. False if not open or full.
+	bool Append(std::string_view record);
+
+	/// Get the position following the newest record
+	/// @return The head position.
+	uint64_t GetHead() const { return m_head; }
+
+	/// Get the bytes held by records not yet released
+	/// @return The used bytes.
+	size_t GetUsed() const { return (size_t)(m_head - m_tail); }
+
+	/// Discard the records before a position
+	/// @param[in] pos - a position returned by GetHead()
+	void Release(uint64_t pos);
+
+	/// Get the number of records that did not fit since the journal was opened
+	/// @return The unjournaled record count.
+	uint64_t GetUnjournaled() const { return m_unjournaled; }
+
+private:
+	LogJournal(const LogJournal&) = delete;
+	LogJournal& operator=(const LogJournal&) = delete;
+
+	/// Length prefix stored before each record
+	typedef uint32_t LengthType;
+
+	/// Length prefix marking the unused end of the buffer before a wrap
+	static constexpr LengthType WRAP = 0xFFFFFFFF;
+
+	/// Identifies a journal file, "LOGJRNL1"
+	static constexpr uint64_t MAGIC = 0x314C4E524A474F4CULL;
+
+	/// File header, padded to HEADER_SIZE
+	struct Header
+	{
+		uint64_t magic;
+		uint64_t capacity;
+		uint64_t tail;
+		uint64_t head;
+	};
+	static constexpr size_t HEADER_SIZE = 64;
+
+	/// Map the journal file
+	/// @param[in] fileSize - the file size to map, or 0 to map the existing file
+	/// @return True if mapped.
+	bool Map(size_t fileSize);
+
+	/// Check the mapped header and load the positions
+	/// @return True if the mapping holds a journal with consistent positions.
+	bool Load();
+
+	/// Invoke a function for each record held, oldest first
+	void ForEach(const std::function<void(std::string_view)>& func) const;
+
+	Header* GetHeader() const { return reinterpret_cast<Header*>(m_map); }
+	char* GetData() const { return m_map + HEADER_SIZE; }
+
+	std::string m_fileName;
+	char* m_map = nullptr;
+	size_t m_mapSize = 0;
+	size_t m_capacity = 0;
+#ifdef WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+
+	/// Copies of the header positions
+	uint64_t m_tail = 0;
+	uint64_t m_head = 0;
+
+	uint64_t m_unjournaled = 0;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "LogJson.h"
+#include "LogEscape.h"
+#include "LogRecord.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// GetLevelName
+//----------------------------------------------------------------------------
+const char* LogJson::GetLevelName(LogLevel level)
+{
+	switch (level)
+	{
+	case LogLevel::Trace: return "trace";
+	case LogLevel::Debug: return "debug";
+	case LogLevel::Info: return "info";
+	case LogLevel::Warning: return "warning";
+	case LogLevel::Error: return "error";
+	case LogLevel::Fatal: return "fatal";
+	default: return "off";
+	}
+}
+
+//----------------------------------------------------------------------------
+// AppendNumber
+//----------------------------------------------------------------------------
+void LogJson::AppendNumber(std::string& text, uint32_t value)
+{
+	char digits[10];
+	size_t count = 0;
+	do { digits[count++] = (char)('0' + value % 10); value /= 10; } while (value);
+	while (count)
+		text.push_back(digits[--count]);
+}
+
+//----------------------------------------------------------------------------
+// Render
+//----------------------------------------------------------------------------
+std::string_view LogJson::Render(std::string_view record, std::string& text, LogTimestamp::Formatter& formatter)
+{
+	uint64_t tick;
+	LogContext::Context context;
+	bool stamped = LogTimestamp::IsStamped(record);
+	std::string_view body = LogTimestamp::Split(record, tick);
+	bool hasContext = LogContext::HasContext(body);
+	body = LogContext::Split(body, context);
+
+	text.clear();
+	text.push_back('{');
+	if (stamped)
+	{
+		// The time is rendered with a trailing space, replaced by the quote
+		text.append("\"ts\":\"");
+		formatter.AppendTime(tick, text);
+		text.back() = '"';
+		text.push_back(',');
+	}
+	if (hasContext)
+	{
+		text.append("\"thread\":");
+		AppendNumber(text, context.thread);
+		text.append(",\"level\":\"");
+		text.append(GetLevelName(context.level));
+		text.append("\",\"component\":");
+		AppendNumber(text, context.component);
+		text.push_back(',');
+	}
+
+	if (LogRecord::IsBinary(body))
+	{
+		m_body.clear();
+		LogRecord::Render(body, m_body);
+		body = m_body;
+	}
+	text.append("\"msg\":\"");
+	std::string_view msg = LogEscape::Escape(body, m_escaped, true);
+	text.append(msg.data(), msg.size());
+	text.append("\"}");
+	return text;
+}
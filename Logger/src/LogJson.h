@@ -0,0 +1,45 @@
+#ifndef _LOG_JSON_H
+#define _LOG_JSON_H
+
+#include "LogTimestamp.h"
+#include "LogContext.h"
+#include <string>
+#include <string_view>
+
+/// @brief LogJson renders a record as one JSON object per line:
+/// {"ts":"2024-10-01T12:00:00.000000Z","thread":3,"level":"info","component":2,"msg":"..."}
+/// The timestamp is present for stamped records and the thread, level and 
+/// component for records with a LogContext. The message is escaped with 
+/// LogEscape.
+///
+/// @details The object is appended directly into the caller's text buffer by
+/// hand, without iostreams or printf. The scratch buffers are reused, so once 
+/// they have grown to the largest record rendering allocates nothing. Not 
+/// thread-safe. Each rendering thread owns a LogJson.
+class LogJson
+{
+public:
+	/// Render a record as a JSON object
+	/// @param[in] record - the record
+	/// @param[out] text - receives the JSON object, without a trailing newline
+	/// @param[in] formatter - renders the timestamp and binary records
+	/// @return A view of text.
+	std::string_view Render(std::string_view record, std::string& text, LogTimestamp::Formatter& formatter);
+
+	/// Get the JSON name of a level
+	/// @param[in] level - the level
+	/// @return The lower case name.
+	static const char* GetLevelName(LogLevel level);
+
+private:
+	/// Append an unsigned integer in decimal
+	static void AppendNumber(std::string& text, uint32_t value);
+
+	/// Message text rendered from a binary record
+	std::string m_body;
+
+	/// Message text escaped for a JSON string
+	std::string m_escaped;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef _LOG_LEVEL_H
+#define _LOG_LEVEL_H
+
+#include <cstdint>
+
+/// Log message severity levels in increasing order of severity. Names are not
+/// upper case to avoid collisions with common macros such as ERROR and DEBUG.
+enum class LogLevel : uint8_t
+{
+	Trace,
+	Debug,
+	Info,
+	Warning,
+	Error,
+	Fatal,
+	Off		///< Threshold only. Disables all messages.
+};
+
+/// The minimum level compiled into the build. Messages written with the LOG_WRITE
+/// macro below this level compile away. Define as the numeric LogLevel value,
+/// e.g. -DLOGGER_MIN_LEVEL=2 to compile away Trace and Debug messages.
+#ifndef LOGGER_MIN_LEVEL
+#define LOGGER_MIN_LEVEL 0
+#endif
+
+/// Check if a level is compiled into the build
+/// @param[in] level - the message level
+/// @return True if messages at the level are compiled.
+constexpr bool IsLogLevelCompiled(LogLevel level)
+{
+#if LOGGER_MIN_LEVEL > 0
+	return static_cast<int>(level) >= LOGGER_MIN_LEVEL && level != LogLevel::Off;
+#else
+	return level != LogLevel::Off;
+#endif
+}
+
+/// Identifies the subsystem writing a message. Each component has its own runtime
+/// level threshold. Component 0 is the default component.
+typedef uint8_t LogComponent;
+
+#endif
@@ -0,0 +1,96 @@
+#include "LogMemory.h"
+#include <cstring>
+
+//----------------------------------------------------------------------------
+// ~LogMemory
+//----------------------------------------------------------------------------
+LogMemory::~LogMemory()
+{
+	for (auto& chunk : m_chunks)
+		delete chunk.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+bool LogMemory::Write(const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		const char* newline = static_cast<const char*>(memchr(data, '\n', size));
+		if (!newline)
+		{
+			m_partial.append(data, size);
+			break;
+		}
+
+		size_t len = newline - data;
+		m_partial.append(data, len);
+		Publish();
+		data += len + 1;
+		size -= len + 1;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Publish
+//----------------------------------------------------------------------------
+void LogMemory::Publish()
+{
+	size_t index = m_count.load(std::memory_order_relaxed);
+	size_t chunkIndex = index / CHUNK_RECORDS;
+	if (chunkIndex >= MAX_CHUNKS)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		m_partial.clear();
+		return;
+	}
+
+	Chunk* chunk = m_chunks[chunkIndex].load(std::memory_order_relaxed);
+	if (!chunk)
+	{
+		chunk = new Chunk();
+		m_chunks[chunkIndex].store(chunk, std::memory_order_release);
+	}
+
+	// A chunk reused after Clear() keeps the string capacity
+	chunk->records[index % CHUNK_RECORDS].assign(m_partial);
+	m_partial.clear();
+	m_count.store(index + 1, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// Get
+//----------------------------------------------------------------------------
+std::string_view LogMemory::Get(size_t index) const
+{
+	if (index >= Size())
+		return std::string_view();
+	const Chunk* chunk = m_chunks[index / CHUNK_RECORDS].load(std::memory_order_acquire);
+	return chunk->records[index % CHUNK_RECORDS];
+}
+
+//----------------------------------------------------------------------------
+// Contains
+//----------------------------------------------------------------------------
+bool LogMemory::Contains(std::string_view text) const
+{
+	size_t count = Size();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (Get(i).find(text) != std::string_view::npos)
+			return true;
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+// Clear
+//----------------------------------------------------------------------------
+void LogMemory::Clear()
+{
+	m_partial.clear();
+	m_count.store(0, std::memory_order_release);
+	m_dropped.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,95 @@
+#ifndef _LOG_MEMORY_H
+#define _LOG_MEMORY_H
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// @brief LogMemory captures flushed log records in memory instead of a file,
+/// for LogWriter::Backend::MEMORY. Integration tests read the records directly
+/// rather than parsing LogData.txt, so flushes run at memory speed, survive a
+/// full disk and no two tests share a file.
+///
+/// @details Records are appended by the one thread performing a write and read
+/// by any thread without a lock. Records are stored in fixed-size chunks that
+/// are never moved or freed until destruction, and each record is published by
+/// a release store of the record count, so a reader sees only complete records.
+/// Records past the capacity are counted and dropped.
+class LogMemory
+{
+public:
+	/// Records held per chunk
+	static const size_t CHUNK_RECORDS = 1024;
+
+	/// Maximum number of chunks. The capacity is CHUNK_RECORDS * MAX_CHUNKS records.
+	static const size_t MAX_CHUNKS = 1024;
+
+	LogMemory() = default;
+	~LogMemory();
+
+	/// Always open. Called by the writing thread.
+	/// @return True.
+	bool IsOpen() const { return true; }
+
+	/// Append log data. Each newline completes a record. Called by the writing
+	/// thread.
+	/// @param[in] data - the data to append
+	/// @param[in] size - the data size in bytes
+	/// @return True.
+	bool Write(const char* data, size_t size);
+
+	/// Nothing to flush as records are published when complete. Called by the
+	/// writing thread.
+	/// @param[in] forceSync - ignored
+	/// @return True.
+	bool Flush(bool forceSync = false) { (void)forceSync; return true; }
+
+	/// Get the number of records captured. Function call is thread-safe.
+	/// @return The record count.
+	size_t Size() const { return m_count.load(std::memory_order_acquire); }
+
+	/// Get a record without its newline. Function call is thread-safe.
+	/// @param[in] index - the record index, less than Size()
+	/// @return The record, valid until Clear().
+	std::string_view Get(size_t index) const;
+
+	/// Check if any record contains the text. Function call is thread-safe.
+	/// @param[in] text - the text to find
+	/// @return True if found.
+	bool Contains(std::string_view text) const;
+
+	/// Get the number of records dropped once full. Function call is thread-safe.
+	/// @return The dropped record count.
+	uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	/// Discard all records. Chunks are kept for reuse. Must not be called while
+	/// a write is in progress or another thread reads the records.
+	void Clear();
+
+private:
+	LogMemory(const LogMemory&) = delete;
+	LogMemory& operator=(const LogMemory&) = delete;
+
+	struct Chunk
+	{
+		std::string records[CHUNK_RECORDS];
+	};
+
+	/// Publish the completed record held in m_partial
+	void Publish();
+
+	/// The chunks, allocated by the writing thread as needed
+	std::atomic<Chunk*> m_chunks[MAX_CHUNKS] = {};
+
+	/// Number of published records
+	std::atomic<size_t> m_count{ 0 };
+
+	std::atomic<uint64_t> m_dropped{ 0 };
+
+	/// The record being written. Only accessed by the writing thread.
+	std::string m_partial;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "LogMerge.h"
+#include "LogChecksum.h"
+#include <fstream>
+#include <memory>
+#include <queue>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// GetTime
+//----------------------------------------------------------------------------
+string_view LogMerge::GetTime(string_view line)
+{
+	// YYYY-MM-DDTHH:MM:SS.uuuuuuZ
+	static const char PATTERN[] = "dddd-dd-ddTdd:dd:dd.ddddddZ";
+	if (line.size() < TIME_SIZE)
+		return {};
+	for (size_t i = 0; i < TIME_SIZE; i++)
+	{
+		bool match = PATTERN[i] == 'd' ? (line[i] >= '0' && line[i] <= '9') : line[i] == PATTERN[i];
+		if (!match)
+			return {};
+	}
+	return line.substr(0, TIME_SIZE);
+}
+
+//----------------------------------------------------------------------------
+// Merge
+//----------------------------------------------------------------------------
+bool LogMerge::Merge(const vector<string>& fileNames, ostream& out)
+{
+	// The next line of one input and the time it sorts by
+	struct Input
+	{
+		ifstream file;
+		string line;
+		string time;
+		size_t index = 0;
+
+		bool Next()
+		{
+			// Checksum trailers frame blocks of the input file only
+			do
+			{
+				if (!getline(file, line))
+					return false;
+			} while (!line.empty() && line[0] == LogChecksum::MARKER);
+			string_view t = GetTime(line);
+			if (!t.empty())
+				time.assign(t);
+			return true;
+		}
+	};
+
+	bool success = true;
+	vector<unique_ptr<Input>> inputs;
+	for (const string& fileName : fileNames)
+	{
+		auto input = make_unique<Input>();
+		input->file.open(fileName);
+		if (!input->file)
+		{
+			success = false;
+			continue;
+		}
+		input->index = inputs.size();
+		inputs.push_back(std::move(input));
+	}
+
+	// Earliest time first, then lowest input index
+	auto later = [](const Input* a, const Input* b) {
+		int cmp = a->time.compare(b->time);
+		return cmp != 0 ? cmp > 0 : a->index > b->index;
+	};
+	priority_queue<Input*, vector<Input*>, decltype(later)> heap(later);
+	for (auto& input : inputs)
+	{
+		if (input->Next())
+			heap.push(input.get());
+	}
+
+	while (!heap.empty())
+	{
+		Input* input = heap.top();
+		heap.pop();
+		out << input->line << '\n';
+		if (input->Next())
+			heap.push(input);
+	}
+	return success;
+}
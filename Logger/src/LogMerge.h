@@ -0,0 +1,37 @@
+#ifndef _LOG_MERGE_H
+#define _LOG_MERGE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+
+/// @brief LogMerge combines the log files of several Logger instances into one
+/// stream ordered by time.
+///
+/// @details Each file is already in time order, so the files are merged k-way
+/// by the "YYYY-MM-DDTHH:MM:SS.uuuuuuZ" prefix written by stamped records. The
+/// prefix is fixed width UTC so it orders as a string. A line without a prefix,
+/// e.g. a continuation line or an unstamped record, keeps the time of the line
+/// before it in its file. Lines with equal times are taken in input file order.
+/// LogChecksum trailer lines are dropped.
+class LogMerge
+{
+public:
+	/// Length of the time prefix of a rendered stamped record, excluding the
+	/// trailing space
+	static const size_t TIME_SIZE = 27;
+
+	/// Merge log files
+	/// @param[in] fileNames - the log files, each in time order
+	/// @param[out] out - the merged lines are written
+	/// @return True if all files were read, false if a file could not be opened.
+	static bool Merge(const std::vector<std::string>& fileNames, std::ostream& out);
+
+	/// Get the time prefix of a line
+	/// @param[in] line - the rendered log line
+	/// @return The time prefix, or empty if the line is not stamped.
+	static std::string_view GetTime(std::string_view line);
+};
+
+#endif
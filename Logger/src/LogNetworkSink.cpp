@@ -0,0 +1,301 @@
+#include "LogNetworkSink.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef int ssize_t;
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netdb.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/// RFC 5424 header with nil timestamp, host name, process ID and message ID
+static const char SYSLOG_HEADER[] = "<14>1 - - LogData - - - ";
+static const size_t SYSLOG_HEADER_LEN = sizeof(SYSLOG_HEADER) - 1;
+
+/// Datagrams sent per sendmmsg() call
+static const size_t DATAGRAM_BATCH = 64;
+
+/// Longest a TCP send blocks the sink thread before the flush is retried
+static const int SEND_TIMEOUT_MS = 1000;
+
+#ifdef MSG_NOSIGNAL
+static const int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+//----------------------------------------------------------------------------
+// CloseSocket
+//----------------------------------------------------------------------------
+static void CloseSocket(intptr_t socket)
+{
+#ifdef WIN32
+	closesocket((SOCKET)socket);
+#else
+	close((int)socket);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// LogNetworkSink
+//----------------------------------------------------------------------------
+LogNetworkSink::LogNetworkSink(Protocol protocol, const std::string& host, uint16_t port,
+	size_t maxBufferBytes, size_t maxRecords) :
+	LogSink("LogNetworkSink", maxRecords), m_protocol(protocol), m_host(host), m_port(port),
+	m_maxBufferBytes(maxBufferBytes), m_reconnectDelay(0), m_sentRecords(0), m_sentBytes(0), 
+	m_droppedRecords(0), m_connects(0), m_connected(false)
+{
+	FlushPolicy policy;
+	policy.records = 1;
+	policy.interval = DEFAULT_RETRY_INTERVAL;
+	SetFlushPolicy(policy);
+}
+
+//----------------------------------------------------------------------------
+// ~LogNetworkSink
+//----------------------------------------------------------------------------
+LogNetworkSink::~LogNetworkSink()
+{
+	Stop();
+	if (m_socket >= 0)
+		CloseSocket(m_socket);
+}
+
+//----------------------------------------------------------------------------
+// GetNetworkStats
+//----------------------------------------------------------------------------
+LogNetworkSink::NetworkStats LogNetworkSink::GetNetworkStats() const
+{
+	NetworkStats stats;
+	stats.sentRecords = m_sentRecords.load(std::memory_order_relaxed);
+	stats.sentBytes = m_sentBytes.load(std::memory_order_relaxed);
+	stats.droppedRecords = m_droppedRecords.load(std::memory_order_relaxed);
+	stats.connects = m_connects.load(std::memory_order_relaxed);
+	stats.connected = m_connected.load(std::memory_order_relaxed);
+	return stats;
+}
+
+//----------------------------------------------------------------------------
+// WriteRecord
+//----------------------------------------------------------------------------
+bool LogNetworkSink::WriteRecord(std::string_view record)
+{
+	if (m_protocol == Protocol::UDP)
+		record = record.substr(0, MAX_DATAGRAM - SYSLOG_HEADER_LEN);
+
+	// TCP frames are prefixed with the message length and a space
+	char length[24] = "";
+	size_t lengthLen = 0;
+	if (m_protocol == Protocol::TCP)
+		lengthLen = (size_t)snprintf(length, sizeof(length), "%zu ", SYSLOG_HEADER_LEN + record.size());
+
+	const size_t frameLen = lengthLen + SYSLOG_HEADER_LEN + record.size();
+	if (m_buffer.size() + frameLen > m_maxBufferBytes)
+	{
+		m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	m_frames.push_back(m_buffer.size());
+	m_buffer.append(length, lengthLen);
+	m_buffer.append(SYSLOG_HEADER, SYSLOG_HEADER_LEN);
+	m_buffer.append(record.data(), record.size());
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// FlushRecords
+//----------------------------------------------------------------------------
+bool LogNetworkSink::FlushRecords()
+{
+	if (m_frames.empty())
+		return true;
+	if (!Connect())
+		return false;
+
+	size_t frames = m_protocol == Protocol::TCP ? SendStream() : SendDatagrams();
+	m_sentRecords.fetch_add(frames, std::memory_order_relaxed);
+	Consume(frames);
+	return m_frames.empty();
+}
+
+//----------------------------------------------------------------------------
+// Connect
+//----------------------------------------------------------------------------
+bool LogNetworkSink::Connect()
+{
+	if (m_socket >= 0)
+		return true;
+	if (std::chrono::steady_clock::now() < m_nextConnect)
+		return false;
+
+#ifdef WIN32
+	static const bool started = []() { WSADATA data; return WSAStartup(MAKEWORD(2, 2), &data) == 0; }();
+	if (!started)
+		return false;
+#endif
+
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = m_protocol == Protocol::TCP ? SOCK_STREAM : SOCK_DGRAM;
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(m_host.c_str(), std::to_string(m_port).c_str(), &hints, &addresses) != 0)
+	{
+		Disconnect();
+		return false;
+	}
+
+	// A connected UDP socket lets each datagram be sent without an address
+	for (addrinfo* address = addresses; address && m_socket < 0; address = address->ai_next)
+	{
+		intptr_t s = (intptr_t)socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (s < 0)
+			continue;
+		if (connect(s, address->ai_addr, (int)address->ai_addrlen) == 0)
+			m_socket = s;
+		else
+			CloseSocket(s);
+	}
+	freeaddrinfo(addresses);
+
+	if (m_socket < 0)
+	{
+		Disconnect();
+		return false;
+	}
+
+	// Bound the time a stalled collector can block the sink thread
+#ifdef WIN32
+	DWORD timeout = SEND_TIMEOUT_MS;
+#else
+	timeval timeout = { SEND_TIMEOUT_MS / 1000, (SEND_TIMEOUT_MS % 1000) * 1000 };
+#endif
+	setsockopt(m_socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+
+	m_reconnectDelay = std::chrono::milliseconds(0);
+	m_connects.fetch_add(1, std::memory_order_relaxed);
+	m_connected = true;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Disconnect
+//----------------------------------------------------------------------------
+void LogNetworkSink::Disconnect()
+{
+	if (m_socket >= 0)
+		CloseSocket(m_socket);
+	m_socket = -1;
+	m_connected = false;
+
+	// Retry once at once then back off exponentially
+	m_nextConnect = std::chrono::steady_clock::now() + m_reconnectDelay;
+	m_reconnectDelay = m_reconnectDelay.count() == 0 ? DEFAULT_RETRY_INTERVAL :
+		std::min(m_reconnectDelay * 2, MAX_RECONNECT_DELAY);
+}
+
+//----------------------------------------------------------------------------
+// SendStream
+//----------------------------------------------------------------------------
+size_t LogNetworkSink::SendStream()
+{
+	// All frames are sent with as few system calls as the socket accepts
+	size_t sent = 0;
+	while (sent < m_buffer.size())
+	{
+		ssize_t len = send(m_socket, m_buffer.data() + sent, (int)(m_buffer.size() - sent), SEND_FLAGS);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			break;
+		sent += (size_t)len;
+	}
+	m_sentBytes.fetch_add(sent, std::memory_order_relaxed);
+	if (sent == m_buffer.size())
+		return m_frames.size();
+
+	// The collector discards the partial frame with the connection
+	Disconnect();
+	return (size_t)(std::upper_bound(m_frames.begin(), m_frames.end(), sent) - m_frames.begin()) - 1;
+}
+
+//----------------------------------------------------------------------------
+// SendDatagrams
+//----------------------------------------------------------------------------
+size_t LogNetworkSink::SendDatagrams()
+{
+	size_t frames = 0;
+#ifdef __linux__
+	// Many datagrams per system call
+	mmsghdr msgs[DATAGRAM_BATCH];
+	iovec iovs[DATAGRAM_BATCH];
+	while (frames < m_frames.size())
+	{
+		unsigned int count = (unsigned int)std::min(DATAGRAM_BATCH, m_frames.size() - frames);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			iovs[i].iov_base = &m_buffer[m_frames[frames + i]];
+			iovs[i].iov_len = FrameEnd(frames + i) - m_frames[frames + i];
+			memset(&msgs[i], 0, sizeof(msgs[i]));
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		int len = sendmmsg((int)m_socket, msgs, count, SEND_FLAGS);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+			break;
+		for (int i = 0; i < len; i++)
+			m_sentBytes.fetch_add(msgs[i].msg_len, std::memory_order_relaxed);
+		frames += (size_t)len;
+	}
+#else
+	while (frames < m_frames.size())
+	{
+		size_t frameLen = FrameEnd(frames) - m_frames[frames];
+		ssize_t len = send(m_socket, &m_buffer[m_frames[frames]], (int)frameLen, SEND_FLAGS);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len < 0)
+			break;
+		m_sentBytes.fetch_add((size_t)len, std::memory_order_relaxed);
+		frames++;
+	}
+#endif
+
+	// A connected UDP socket reports an unreachable collector on a later send
+	if (frames < m_frames.size())
+		Disconnect();
+	return frames;
+}
+
+//----------------------------------------------------------------------------
+// Consume
+//----------------------------------------------------------------------------
+void LogNetworkSink::Consume(size_t frames)
+{
+	if (frames == 0)
+		return;
+	if (frames >= m_frames.size())
+	{
+		m_buffer.clear();
+		m_frames.clear();
+		return;
+	}
+
+	const size_t offset = m_frames[frames];
+	m_buffer.erase(0, offset);
+	m_frames.erase(m_frames.begin(), m_frames.begin() + frames);
+	for (size_t& start : m_frames)
+		start -= offset;
+}
@@ -0,0 +1,134 @@
+#ifndef _LOG_NETWORK_SINK_H
+#define _LOG_NETWORK_SINK_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include "LogSink.h"
+
+/// @brief LogNetworkSink ships records to a remote syslog collector so an external
+/// agent no longer needs to tail the log file. 
+/// 
+/// @details Records are formatted as RFC 5424 syslog messages and staged back to 
+/// back in one bounded send buffer. Each flush sends the whole buffer: one send() 
+/// of RFC 6587 octet counted frames over TCP, or one sendmmsg() of many datagrams 
+/// over UDP where available. While the collector is unreachable records stay 
+/// buffered and the connection is retried with an exponential backoff. Records 
+/// that do not fit within the buffer are dropped and counted. A frame partially
+/// sent when a TCP connection fails is resent from its start on the next 
+/// connection.
+///
+/// The default flush policy flushes every batch and retries a failed flush every
+/// DEFAULT_RETRY_INTERVAL.
+class LogNetworkSink : public LogSink
+{
+public:
+	/// The transport used to reach the collector
+	enum class Protocol
+	{
+		TCP,	///< Octet counted syslog frames over one TCP connection
+		UDP		///< One syslog datagram per record
+	};
+
+	/// Default send buffer capacity in bytes
+	static constexpr size_t DEFAULT_MAX_BUFFER_BYTES = 4 * 1024 * 1024;
+
+	/// Largest UDP datagram sent. Longer records are truncated.
+	static constexpr size_t MAX_DATAGRAM = 8192;
+
+	/// Default time between flush retries while the collector is unreachable
+	static constexpr std::chrono::milliseconds DEFAULT_RETRY_INTERVAL = std::chrono::milliseconds(1000);
+
+	/// Longest time between connection attempts
+	static constexpr std::chrono::milliseconds MAX_RECONNECT_DELAY = std::chrono::milliseconds(30000);
+
+	/// Snapshot of the network counters
+	struct NetworkStats
+	{
+		/// Records delivered to the socket
+		uint64_t sentRecords = 0;
+
+		/// Bytes delivered to the socket including framing
+		uint64_t sentBytes = 0;
+
+		/// Records discarded because the send buffer was full
+		uint64_t droppedRecords = 0;
+
+		/// Successful connections, including reconnections
+		uint64_t connects = 0;
+
+		/// True while connected to the collector
+		bool connected = false;
+	};
+
+	/// Constructor
+	/// @param[in] protocol - the transport
+	/// @param[in] host - the collector host name or address
+	/// @param[in] port - the collector port
+	/// @param[in] maxBufferBytes - the send buffer capacity in bytes
+	/// @param[in] maxRecords - the bounded buffer capacity in records of LogSink
+	LogNetworkSink(Protocol protocol, const std::string& host, uint16_t port,
+		size_t maxBufferBytes = DEFAULT_MAX_BUFFER_BYTES, size_t maxRecords = DEFAULT_MAX_RECORDS);
+
+	/// Destructor
+	~LogNetworkSink() override;
+
+	/// Get a snapshot of the network counters. Function call is thread-safe.
+	/// @return The counters.
+	NetworkStats GetNetworkStats() const;
+
+protected:
+	bool WriteRecord(std::string_view record) override;
+	bool FlushRecords() override;
+
+private:
+	/// Connect to the collector unless the reconnect delay has not passed
+	/// @return True if connected.
+	bool Connect();
+
+	/// Close the connection and schedule the next connection attempt
+	void Disconnect();
+
+	/// Send the buffered frames over TCP
+	/// @return The number of whole frames sent.
+	size_t SendStream();
+
+	/// Send the buffered frames as datagrams
+	/// @return The number of whole frames sent.
+	size_t SendDatagrams();
+
+	/// Remove sent frames from the front of the send buffer
+	/// @param[in] frames - the number of frames sent
+	void Consume(size_t frames);
+
+	/// Get the end offset of a buffered frame
+	size_t FrameEnd(size_t frame) const { return frame + 1 < m_frames.size() ? m_frames[frame + 1] : m_buffer.size(); }
+
+	const Protocol m_protocol;
+	const std::string m_host;
+	const uint16_t m_port;
+	const size_t m_maxBufferBytes;
+
+	/// Socket handle or -1. Only accessed by the sink thread.
+	intptr_t m_socket = -1;
+
+	/// Formatted frames back to back and the start offset of each frame. Only 
+	/// accessed by the sink thread.
+	std::string m_buffer;
+	std::vector<size_t> m_frames;
+
+	/// Earliest time of the next connection attempt and the current backoff
+	std::chrono::steady_clock::time_point m_nextConnect;
+	std::chrono::milliseconds m_reconnectDelay;
+
+	std::atomic<uint64_t> m_sentRecords;
+	std::atomic<uint64_t> m_sentBytes;
+	std::atomic<uint64_t> m_droppedRecords;
+	std::atomic<uint64_t> m_connects;
+	std::atomic<bool> m_connected;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#include "LogRateLimiter.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// SetRate
+//----------------------------------------------------------------------------
+void LogRateLimiter::SetRate(uint32_t ratePerSecond, uint32_t burst)
+{
+	int64_t interval = 1000000000 / (ratePerSecond ? ratePerSecond : 1);
+	m_interval.store(interval, std::memory_order_relaxed);
+	m_tolerance.store(interval * (int64_t)(burst ? burst - 1 : 0), std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// Allow
+//----------------------------------------------------------------------------
+bool LogRateLimiter::Allow(uint64_t key, uint64_t& suppressed)
+{
+	Bucket& bucket = m_buckets[key & (TABLE_SIZE - 1)];
+	const int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		DelegateLib::Clock::Now().time_since_epoch()).count();
+	const int64_t interval = m_interval.load(std::memory_order_relaxed);
+	const int64_t tolerance = m_tolerance.load(std::memory_order_relaxed);
+
+	int64_t tat = bucket.tat.load(std::memory_order_relaxed);
+	while (true)
+	{
+		// Rejected messages never write the bucket state
+		if (now < tat - tolerance)
+		{
+			bucket.suppressed.fetch_add(1, std::memory_order_relaxed);
+			m_limited.Add();
+			return false;
+		}
+		int64_t next = (tat > now ? tat : now) + interval;
+		if (bucket.tat.compare_exchange_weak(tat, next, std::memory_order_relaxed))
+			break;
+	}
+
+	suppressed = bucket.suppressed.load(std::memory_order_relaxed) ? 
+		bucket.suppressed.exchange(0, std::memory_order_relaxed) : 0;
+	return true;
+}
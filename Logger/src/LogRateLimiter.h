@@ -0,0 +1,95 @@
+#ifndef _LOG_RATE_LIMITER_H
+#define _LOG_RATE_LIMITER_H
+
+#include <string_view>
+#include <atomic>
+#include <cstdint>
+#include "CacheLine.h"
+#include "Clock.h"
+#include "Metrics.h"
+
+/// @brief LogRateLimiter is a fixed-size lock-free table of token buckets keyed
+/// by a message hash or call site. Each bucket admits a sustained rate with a 
+/// burst allowance. During a storm a rejected message costs the hash, a clock 
+/// read, one atomic load and one atomic add. LogRateLimiter is thread-safe.
+///
+/// @details Each bucket is held in GCRA form: a single 64-bit theoretical arrival
+/// time updated with compare and swap. Keys are not stored so keys sharing a
+/// bucket share its rate.
+class LogRateLimiter
+{
+public:
+	/// Number of buckets. A power of 2.
+	static constexpr size_t TABLE_SIZE = 4096;
+
+	/// Constructor
+	/// @param[in] ratePerSecond - the sustained messages per second admitted per bucket
+	/// @param[in] burst - the messages admitted at once by an idle bucket
+	LogRateLimiter(uint32_t ratePerSecond = 100, uint32_t burst = 100) { SetRate(ratePerSecond, burst); }
+
+	/// Set the rate of every bucket. Function call is thread-safe.
+	/// @param[in] ratePerSecond - the sustained messages per second admitted per bucket
+	/// @param[in] burst - the messages admitted at once by an idle bucket
+	void SetRate(uint32_t ratePerSecond, uint32_t burst);
+
+	/// Take a token from the bucket of a key
+	/// @param[in] key - the message hash or call site
+	/// @param[out] suppressed - the messages of the bucket rejected since the 
+	///     last admitted message. Only set when admitted.
+	/// @return True if admitted. False if the message must be discarded.
+	bool Allow(uint64_t key, uint64_t& suppressed);
+
+	/// Get the total number of rejected messages
+	/// @return The rejected count.
+	uint64_t GetLimited() const { return m_limited.GetValue(); }
+
+	/// Hash a message with 64-bit FNV-1a
+	/// @param[in] text - the message
+	/// @return The hash.
+	static uint64_t Hash(std::string_view text)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (char c : text)
+		{
+			hash ^= (uint8_t)c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	/// Hash a call site address
+	/// @param[in] site - an address unique to the call site, e.g. a format string
+	/// @return The hash.
+	static uint64_t Hash(const void* site)
+	{
+		uint64_t hash = (uint64_t)(uintptr_t)site;
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+private:
+	LogRateLimiter(const LogRateLimiter&) = delete;
+	LogRateLimiter& operator=(const LogRateLimiter&) = delete;
+
+	struct alignas(CACHE_LINE_SIZE) Bucket
+	{
+		/// Theoretical arrival time in nanoseconds of the next admitted message
+		std::atomic<int64_t> tat{ 0 };
+
+		/// Messages rejected since the last admitted message
+		std::atomic<uint64_t> suppressed{ 0 };
+	};
+
+	Bucket m_buckets[TABLE_SIZE];
+
+	/// Nanoseconds per token and the burst tolerance in nanoseconds
+	std::atomic<int64_t> m_interval{ 0 };
+	std::atomic<int64_t> m_tolerance{ 0 };
+
+	/// Rejected messages. Sharded so a storm from many threads does not contend.
+	DelegateLib::MetricCounter m_limited;
+};
+
+#endif
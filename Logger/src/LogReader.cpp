@@ -0,0 +1,273 @@
+#include "LogReader.h"
+#include "LogMerge.h"
+#include "LogChecksum.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// DaysFromCivil
+//----------------------------------------------------------------------------
+/// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t DaysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+	y -= m <= 2;
+	const int64_t era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = (unsigned)(y - era * 400);
+	const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + (int64_t)doe - 719468;
+}
+
+//----------------------------------------------------------------------------
+// ParseTime
+//----------------------------------------------------------------------------
+int64_t LogReader::ParseTime(string_view line)
+{
+	string_view time = LogMerge::GetTime(line);
+	if (time.empty())
+		return LogIndex::NO_TIME;
+
+	// YYYY-MM-DDTHH:MM:SS.uuuuuuZ. GetTime() checked the digits.
+	auto num = [&time](size_t pos, size_t len) {
+		int64_t value = 0;
+		for (size_t i = pos; i < pos + len; i++)
+			value = value * 10 + (time[i] - '0');
+		return value;
+	};
+	int64_t days = DaysFromCivil(num(0, 4), (unsigned)num(5, 2), (unsigned)num(8, 2));
+	int64_t seconds = days * 86400 + num(11, 2) * 3600 + num(14, 2) * 60 + num(17, 2);
+	return seconds * 1000000000 + num(20, 6) * 1000;
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+bool LogReader::Open(const string& fileName)
+{
+	Close();
+
+#ifdef WIN32
+	HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+	m_size = (size_t)size.QuadPart;
+	if (m_size > 0)
+	{
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		void* map = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (!map)
+		{
+			if (mapping)
+				CloseHandle(mapping);
+			CloseHandle(file);
+			m_size = 0;
+			return false;
+		}
+		m_mapping = mapping;
+		m_data = static_cast<const char*>(map);
+	}
+	m_file = file;
+#else
+	int fd = open(fileName.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	m_size = (size_t)st.st_size;
+	if (m_size > 0)
+	{
+		void* map = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (map == MAP_FAILED)
+		{
+			close(fd);
+			m_size = 0;
+			return false;
+		}
+		madvise(map, m_size, MADV_SEQUENTIAL);
+		m_data = static_cast<const char*>(map);
+	}
+
+	// The mapping stays valid once the descriptor is closed
+	close(fd);
+#endif
+	m_open = true;
+
+	// Keep the entries that describe the mapped file, in file order
+	FILE* index = fopen((fileName + LogIndex::SUFFIX).c_str(), "rb");
+	if (index)
+	{
+		LogIndex::Block block;
+		uint64_t end = 0;
+		while (fread(&block, sizeof(block), 1, index) == 1)
+		{
+			if (block.offset < end || block.offset + block.size > m_size)
+				continue;
+			m_blocks.push_back(block);
+			end = block.offset + block.size;
+		}
+		fclose(index);
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void LogReader::Close()
+{
+	if (!m_open)
+		return;
+
+#ifdef WIN32
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	if (m_data)
+		munmap(const_cast<char*>(m_data), m_size);
+#endif
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+	m_blocks.clear();
+}
+
+//----------------------------------------------------------------------------
+// Find
+//----------------------------------------------------------------------------
+size_t LogReader::Find(const Query& query, const LineFunction& func)
+{
+	m_query = query;
+	m_tokens.clear();
+	LogIndex::ForEachToken(query.keywords, [this](string_view token) { m_tokens.emplace_back(token); });
+	m_found.assign(m_tokens.size(), false);
+	m_func = &func;
+	m_matches = 0;
+	m_stats = Stats();
+	m_stats.blocks = m_blocks.size();
+
+	// Ranges between blocks carry the time of the line before them
+	size_t pos = 0;
+	int64_t timeNs = LogIndex::NO_TIME;
+	bool more = true;
+	for (const LogIndex::Block& block : m_blocks)
+	{
+		if (block.offset > pos && !(more = Scan(pos, (size_t)block.offset, timeNs)))
+			break;
+		pos = (size_t)(block.offset + block.size);
+		if (!MayMatch(block))
+		{
+			m_stats.blocksSkipped++;
+			timeNs = block.endNs;
+			continue;
+		}
+		timeNs = block.startNs;
+		if (!(more = Scan((size_t)block.offset, pos, timeNs)))
+			break;
+	}
+	if (more && pos < m_size)
+		Scan(pos, m_size, timeNs);
+
+	m_func = nullptr;
+	return m_matches;
+}
+
+//----------------------------------------------------------------------------
+// MayMatch
+//----------------------------------------------------------------------------
+bool LogReader::MayMatch(const LogIndex::Block& block) const
+{
+	if (block.maxNs < m_query.fromNs || block.minNs > m_query.toNs)
+		return false;
+	for (const string& token : m_tokens)
+	{
+		if (!LogIndex::MayContain(token, block.bloom))
+			return false;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// MatchTokens
+//----------------------------------------------------------------------------
+bool LogReader::MatchTokens(string_view line)
+{
+	if (m_tokens.empty())
+		return true;
+
+	// A substring search rejects most lines before tokenizing
+	string_view body = LogIndex::GetBody(line);
+	for (const string& token : m_tokens)
+	{
+		if (body.find(token) == string_view::npos)
+			return false;
+	}
+
+	size_t remaining = m_tokens.size();
+	m_found.assign(m_tokens.size(), false);
+	LogIndex::ForEachToken(body, [this, &remaining](string_view word) {
+		for (size_t i = 0; i < m_tokens.size(); i++)
+		{
+			if (!m_found[i] && m_tokens[i] == word)
+			{
+				m_found[i] = true;
+				remaining--;
+			}
+		}
+	});
+	return remaining == 0;
+}
+
+//----------------------------------------------------------------------------
+// Scan
+//----------------------------------------------------------------------------
+bool LogReader::Scan(size_t begin, size_t end, int64_t& timeNs)
+{
+	m_stats.bytesScanned += end - begin;
+	while (begin < end)
+	{
+		const char* newline = static_cast<const char*>(memchr(m_data + begin, '\n', end - begin));
+		size_t lineEnd = newline ? (size_t)(newline - m_data) : end;
+		string_view line(m_data + begin, lineEnd - begin);
+		begin = lineEnd + 1;
+		if (!line.empty() && line[0] == LogChecksum::MARKER)
+			continue;
+
+		int64_t lineNs = ParseTime(line);
+		if (lineNs != LogIndex::NO_TIME)
+			timeNs = lineNs;
+		if (timeNs < m_query.fromNs || timeNs > m_query.toNs || !MatchTokens(line))
+			continue;
+
+		m_matches++;
+		if (!(*m_func)(line))
+			return false;
+	}
+	return true;
+}
@@ -0,0 +1,137 @@
+#ifndef _LOG_READER_H
+#define _LOG_READER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "LogIndex.h"
+
+/// @brief LogReader searches a text log file by time range and keywords. The 
+/// file is memory-mapped and the LogIndex side file, if any, is used to skip 
+/// blocks whose time range or bloom filter cannot match. Ranges not covered by 
+/// the index are scanned linearly, so results are the same with or without an
+/// index. LogReader is not thread-safe.
+///
+/// @details Keywords are matched as whole tokens of the line text after its 
+/// stamp, as defined by LogIndex::ForEachToken(). A line matches when it has 
+/// every keyword token and its time is within the query range. An unstamped 
+/// line has the time of the line before it. LogChecksum trailer lines never match. Compressed rotated files must be 
+/// decompressed before reading.
+class LogReader
+{
+public:
+	/// Line selection. The default query matches every line.
+	struct Query
+	{
+		/// Inclusive time range in nanoseconds since the system clock epoch
+		int64_t fromNs = LogIndex::NO_TIME;
+		int64_t toNs = INT64_MAX;
+
+		/// Space separated tokens that must all be in a matching line
+		std::string keywords;
+	};
+
+	/// The work done by the last Find()
+	struct Stats
+	{
+		/// Index blocks of the file
+		size_t blocks = 0;
+
+		/// Index blocks skipped without reading
+		size_t blocksSkipped = 0;
+
+		/// Log bytes scanned line by line
+		size_t bytesScanned = 0;
+	};
+
+	/// Called for each matching line, excluding its newline
+	/// @return False to stop the search.
+	typedef std::function<bool(std::string_view line)> LineFunction;
+
+	/// Constructor
+	LogReader() = default;
+
+	/// Destructor
+	~LogReader() { Close(); }
+
+	/// Map a log file and load its index. Any previously opened file is closed first.
+	/// @param[in] fileName - the log file name
+	/// @return True if success. An empty or missing index is not an error.
+	bool Open(const std::string& fileName);
+
+	/// Unmap the file
+	void Close();
+
+	/// Check if a file is open
+	/// @return True if a file is open.
+	bool IsOpen() const { return m_open; }
+
+	/// Get the mapped file size
+	/// @return The size in bytes.
+	size_t GetSize() const { return m_size; }
+
+	/// Get the number of usable index blocks
+	/// @return The block count.
+	size_t GetBlockCount() const { return m_blocks.size(); }
+
+	/// Call a function for each matching line in file order
+	/// @param[in] query - the lines to select
+	/// @param[in] func - called with each matching line
+	/// @return The number of matching lines.
+	size_t Find(const Query& query, const LineFunction& func);
+
+	/// Get the work done by the last Find()
+	/// @return The stats.
+	Stats GetStats() const { return m_stats; }
+
+	/// Parse the stamp of a rendered line
+	/// @param[in] line - the line
+	/// @return Nanoseconds since the system clock epoch, or LogIndex::NO_TIME if
+	///     the line is not stamped.
+	static int64_t ParseTime(std::string_view line);
+
+private:
+	LogReader(const LogReader&) = delete;
+	LogReader& operator=(const LogReader&) = delete;
+
+	/// Scan a file range line by line
+	/// @param[in] begin - the range start offset
+	/// @param[in] end - the range end offset
+	/// @param[in,out] timeNs - the time of the line before the range, updated 
+	///     to the time of the last line
+	/// @return False if the line function stopped the search.
+	bool Scan(size_t begin, size_t end, int64_t& timeNs);
+
+	/// Check if a block may hold a matching line
+	/// @param[in] block - the index block
+	/// @return False if no line of the block can match.
+	bool MayMatch(const LogIndex::Block& block) const;
+
+	/// Check if a line matches the keyword tokens
+	/// @param[in] line - the line
+	/// @return True if every token is in the line.
+	bool MatchTokens(std::string_view line);
+
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_open = false;
+#ifdef WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+
+	/// Index blocks in file order, overlapping and out of range entries removed
+	std::vector<LogIndex::Block> m_blocks;
+
+	/// The query of the running Find()
+	Query m_query;
+	std::vector<std::string> m_tokens;
+	std::vector<bool> m_found;
+	const LineFunction* m_func = nullptr;
+	size_t m_matches = 0;
+	Stats m_stats;
+};
+
+#endif
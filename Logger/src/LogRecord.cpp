@@ -0,0 +1,210 @@
+#include "LogRecord.h"
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+// Size of the record header preceding the arguments
+static const size_t HEADER_SIZE = 1 + sizeof(uint32_t) + sizeof(const char*);
+static const size_t CALL_SITE_HEADER_SIZE = 1 + sizeof(uint32_t);
+
+//----------------------------------------------------------------------------
+// Get
+//----------------------------------------------------------------------------
+template <typename T>
+static bool Get(std::string_view record, size_t& offset, T& value)
+{
+	if (offset + sizeof(value) > record.size())
+		return false;
+	memcpy(&value, record.data() + offset, sizeof(value));
+	offset += sizeof(value);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// AppendFormat
+//----------------------------------------------------------------------------
+template <typename T>
+static void AppendFormat(std::string& text, const std::string& spec, T value)
+{
+	char buf[64];
+	int len = snprintf(buf, sizeof(buf), spec.c_str(), value);
+	if (len < 0)
+		return;
+	if ((size_t)len < sizeof(buf))
+	{
+		text.append(buf, len);
+		return;
+	}
+
+	// Output is larger than the local buffer so format directly into the text
+	size_t pos = text.size();
+	text.resize(pos + len + 1);
+	snprintf(&text[pos], len + 1, spec.c_str(), value);
+	text.resize(pos + len);
+}
+
+//----------------------------------------------------------------------------
+// GetFormatId
+//----------------------------------------------------------------------------
+uint32_t LogRecord::GetFormatId(std::string_view record)
+{
+	size_t offset = 1;
+	uint32_t id = 0;
+	Get(record, offset, id);
+	return id;
+}
+
+//----------------------------------------------------------------------------
+// Render
+//----------------------------------------------------------------------------
+void LogRecord::Render(std::string_view record, std::string& text)
+{
+	if (!IsBinary(record) || record.size() < CALL_SITE_HEADER_SIZE)
+		return;
+
+	size_t offset = 1;
+	uint32_t id = 0;
+	const char* format = nullptr;
+	Get(record, offset, id);
+	if (LogCallSite::IsCallSiteId(id))
+	{
+		const LogCallSite* site = LogCallSites::Find(id);
+		if (!site)
+		{
+			char unknown[32];
+			snprintf(unknown, sizeof(unknown), "<call site %08x>", (unsigned)id);
+			text.append(unknown);
+			return;
+		}
+		format = site->format;
+	}
+	else if (record.size() < HEADER_SIZE || !Get(record, offset, format) || !format)
+		return;
+
+	std::string spec;
+	const char* p = format;
+	while (*p)
+	{
+		// Copy literal text up to the next conversion specification
+		const char* start = p;
+		while (*p && *p != '%')
+			p++;
+		text.append(start, p - start);
+		if (!*p)
+			break;
+
+		if (p[1] == '%')
+		{
+			text.push_back('%');
+			p += 2;
+			continue;
+		}
+
+		// Copy the flags, width and precision. Drop the length modifier since
+		// each argument type is known from the record.
+		spec.assign(1, '%');
+		for (p++; *p && strchr("-+ #0123456789.", *p); p++)
+			spec.push_back(*p);
+		while (*p && strchr("hlLqjzt", *p))
+			p++;
+		if (!*p)
+			break;
+		char conversion = *p++;
+
+		// Get the next argument value
+		char type = 0;
+		int64_t i = 0;
+		uint64_t u = 0;
+		double d = 0;
+		std::string_view str;
+		if (Get(record, offset, type))
+		{
+			switch (type)
+			{
+			case ARG_INT:
+				Get(record, offset, i);
+				u = (uint64_t)i;
+				d = (double)i;
+				break;
+			case ARG_UINT:
+				Get(record, offset, u);
+				i = (int64_t)u;
+				d = (double)u;
+				break;
+			case ARG_DOUBLE:
+				Get(record, offset, d);
+				i = (int64_t)d;
+				u = (uint64_t)i;
+				break;
+			case ARG_STRING:
+			{
+				uint32_t len = 0;
+				Get(record, offset, len);
+				if (offset + len > record.size())
+					len = (uint32_t)(record.size() - offset);
+				str = record.substr(offset, len);
+				offset += len;
+				break;
+			}
+			default:
+				type = 0;
+			}
+		}
+
+		// A missing argument renders the conversion specification unchanged
+		if (type == 0)
+		{
+			text.append(spec);
+			text.push_back(conversion);
+			continue;
+		}
+
+		// Render the argument using the conversion, converting the value if the
+		// argument type differs from the conversion type
+		switch (conversion)
+		{
+		case 'd': case 'i':
+			if (type == ARG_STRING)
+				text.append(str);
+			else
+				AppendFormat(text, spec + "ll" + conversion, (long long)i);
+			break;
+		case 'u': case 'o': case 'x': case 'X':
+			if (type == ARG_STRING)
+				text.append(str);
+			else
+				AppendFormat(text, spec + "ll" + conversion, (unsigned long long)u);
+			break;
+		case 'c':
+			if (type == ARG_STRING)
+				text.append(str);
+			else
+				AppendFormat(text, spec + conversion, (int)i);
+			break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			if (type == ARG_STRING)
+				text.append(str);
+			else
+				AppendFormat(text, spec + conversion, d);
+			break;
+		case 's':
+			if (type == ARG_STRING && spec.size() == 1)
+				text.append(str);
+			else if (type == ARG_STRING)
+				AppendFormat(text, spec + conversion, std::string(str).c_str());
+			else if (type == ARG_DOUBLE)
+				AppendFormat(text, spec + "g", d);
+			else if (type == ARG_UINT)
+				AppendFormat(text, spec + "llu", (unsigned long long)u);
+			else
+				AppendFormat(text, spec + "lld", (long long)i);
+			break;
+		default:
+			// Unsupported conversion renders unchanged
+			text.append(spec);
+			text.push_back(conversion);
+			break;
+		}
+	}
+}
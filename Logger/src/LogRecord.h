@@ -0,0 +1,152 @@
+#ifndef _LOG_RECORD_H
+#define _LOG_RECORD_H
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+#include <cstring>
+#include "LogCallSite.h"
+
+/// @brief Identifies a printf-style format string. The format string must have
+/// static storage duration, e.g. a string literal. The ID identifies the format
+/// string to an offline decoder and must be below LogCallSite::CALL_SITE_FLAG.
+struct LogFormat
+{
+	uint32_t id;
+	const char* format;
+};
+
+/// @brief LogRecord encodes a format string ID and typed arguments into a compact
+/// binary record and renders the record to text later. Encoding copies the argument
+/// values without formatting so the cost to the writer is small and constant.
+///
+/// @details Binary record layout:
+/// BINARY_TAG | format ID | format string pointer | arguments
+/// or for a registered LogCallSite:
+/// BINARY_TAG | call site ID | arguments
+/// Each argument is a type byte followed by the value. Integers and floating point
+/// values are stored as 64-bit values. Strings are stored as a 32-bit length and
+/// the characters. Values are stored unaligned in host byte order.
+class LogRecord
+{
+public:
+	/// First byte of a binary record. Text records must not start with this byte.
+	static const char BINARY_TAG = '\0';
+
+	/// Encode a binary record
+	/// @param[out] record - the binary record
+	/// @param[in] format - the format string to render the record with
+	/// @param[in] args - the arguments. Integral, floating point and string types
+	/// are supported.
+	template <typename... Args>
+	static void Encode(std::string& record, const LogFormat& format, const Args&... args)
+	{
+		record.clear();
+		record.push_back(BINARY_TAG);
+		Put(record, format.id);
+		Put(record, format.format);
+		(EncodeArg(record, args), ...);
+	}
+
+	/// Encode a binary record of a registered call site. The format string is
+	/// found from the call site ID when rendered.
+	/// @param[out] record - the binary record
+	/// @param[in] site - the call site, registered with LogCallSites
+	/// @param[in] args - the arguments, as for the LogFormat overload
+	template <typename... Args>
+	static void Encode(std::string& record, const LogCallSite& site, const Args&... args)
+	{
+		record.clear();
+		record.push_back(BINARY_TAG);
+		Put(record, site.id);
+		(EncodeArg(record, args), ...);
+	}
+
+	/// Check if a record is a binary record
+	/// @param[in] record - the record
+	/// @return True if binary.
+	static bool IsBinary(std::string_view record)
+	{
+		return !record.empty() && record[0] == BINARY_TAG;
+	}
+
+	/// Get the format string ID of a binary record
+	/// @param[in] record - the binary record
+	/// @return The format string ID, or the call site ID.
+	static uint32_t GetFormatId(std::string_view record);
+
+	/// Render a binary record to text. Arguments are consumed in order by the
+	/// format string conversion specifications. Width and precision given as '*'
+	/// are not supported. A call site not registered in this process renders as
+	/// "<call site ID>" with the ID in hex.
+	/// @param[in] record - the binary record
+	/// @param[out] text - the rendered text is appended
+	static void Render(std::string_view record, std::string& text);
+
+private:
+	/// Argument type stored before each argument value
+	enum ArgType : char
+	{
+		ARG_INT = 1,
+		ARG_UINT,
+		ARG_DOUBLE,
+		ARG_STRING
+	};
+
+	template <typename T>
+	static void Put(std::string& record, const T& value)
+	{
+		record.append(reinterpret_cast<const char*>(&value), sizeof(value));
+	}
+
+	static void PutString(std::string& record, std::string_view str)
+	{
+		record.push_back(ARG_STRING);
+		Put(record, static_cast<uint32_t>(str.size()));
+		record.append(str.data(), str.size());
+	}
+
+	template <typename T>
+	static void EncodeArg(std::string& record, const T& arg)
+	{
+		if constexpr (std::is_same_v<T, bool>)
+		{
+			record.push_back(ARG_UINT);
+			Put(record, static_cast<uint64_t>(arg));
+		}
+		else if constexpr (std::is_integral_v<T>)
+		{
+			if constexpr (std::is_signed_v<T>)
+			{
+				record.push_back(ARG_INT);
+				Put(record, static_cast<int64_t>(arg));
+			}
+			else
+			{
+				record.push_back(ARG_UINT);
+				Put(record, static_cast<uint64_t>(arg));
+			}
+		}
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			record.push_back(ARG_DOUBLE);
+			Put(record, static_cast<double>(arg));
+		}
+		else if constexpr (std::is_convertible_v<const T&, const char*>)
+		{
+			const char* str = arg;
+			PutString(record, str ? std::string_view(str) : std::string_view("(null)"));
+		}
+		else if constexpr (std::is_convertible_v<const T&, std::string_view>)
+		{
+			PutString(record, std::string_view(arg));
+		}
+		else
+		{
+			static_assert(std::is_integral_v<T>, "LogRecord argument type not supported");
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,87 @@
+#include "LogRing.h"
+#include <algorithm>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// Reset
+//----------------------------------------------------------------------------
+void LogRing::Reset(size_t capacity, bool hugePages)
+{
+	// Too small to hold a record header so no buffer is allocated
+	if (capacity <= sizeof(LengthType))
+		capacity = 0;
+
+	m_tail.store(0, std::memory_order_relaxed);
+	m_head.store(0, std::memory_order_release);
+	m_data = HugePages::Allocate(capacity, hugePages);
+	m_capacity = capacity;
+	m_count = 0;
+	m_overwritten = 0;
+}
+
+//----------------------------------------------------------------------------
+// Clear
+//----------------------------------------------------------------------------
+void LogRing::Clear()
+{
+	m_tail.store(m_head.load(std::memory_order_relaxed), std::memory_order_release);
+	m_count = 0;
+	m_overwritten = 0;
+}
+
+//----------------------------------------------------------------------------
+// Next
+//----------------------------------------------------------------------------
+uint64_t LogRing::Next(uint64_t pos, bool& record) const
+{
+	size_t index = (size_t)(pos % m_capacity);
+	LengthType len = WRAP;
+	if (m_capacity - index >= sizeof(LengthType))
+		memcpy(&len, m_data.get() + index, sizeof(len));
+	record = len != WRAP;
+	return record ? pos + sizeof(LengthType) + len : pos + (m_capacity - index);
+}
+
+//----------------------------------------------------------------------------
+// Append
+//----------------------------------------------------------------------------
+void LogRing::Append(std::string_view record)
+{
+	if (m_capacity == 0)
+		return;
+
+	LengthType len = (LengthType)std::min(record.size(), m_capacity - sizeof(LengthType));
+	size_t size = sizeof(LengthType) + len;
+	uint64_t head = m_head.load(std::memory_order_relaxed);
+	size_t index = (size_t)(head % m_capacity);
+
+	// A record is stored contiguously so skip the end of the buffer if it does not fit
+	uint64_t start = index + size > m_capacity ? head + (m_capacity - index) : head;
+
+	// Discard the oldest records overlapping the new record. The tail is
+	// published before the bytes are overwritten.
+	uint64_t tail = m_tail.load(std::memory_order_relaxed);
+	while (tail < head && start + size - tail > m_capacity)
+	{
+		bool discarded;
+		tail = Next(tail, discarded);
+		if (discarded)
+		{
+			m_count--;
+			m_overwritten++;
+		}
+	}
+	if (tail >= head)
+		tail = start;
+	m_tail.store(tail, std::memory_order_release);
+
+	if (start != head && m_capacity - index >= sizeof(LengthType))
+		memcpy(m_data.get() + index, &WRAP, sizeof(WRAP));
+	char* dest = m_data.get() + (size_t)(start % m_capacity);
+	memcpy(dest, &len, sizeof(len));
+	memcpy(dest + sizeof(len), record.data(), len);
+
+	m_head.store(start + size, std::memory_order_release);
+	m_count++;
+}
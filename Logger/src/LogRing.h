@@ -0,0 +1,103 @@
+#ifndef _LOG_RING_H
+#define _LOG_RING_H
+
+#include "HugePages.h"
+#include <string_view>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+
+/// @brief LogRing keeps the most recent records within a fixed-size circular
+/// byte buffer. Each record is stored length-prefixed and contiguous. Appending
+/// a record that does not fit discards the oldest records, so memory is
+/// allocated once and steady-state writes never touch the heap or disk.
+///
+/// @details Only the owning thread appends. ForEach() allocates nothing and
+/// takes no locks, so it may run within a signal handler. The record positions
+/// are published after the record bytes, so a reader interrupting an append
+/// sees only complete records.
+class LogRing
+{
+private:
+	/// Length prefix stored before each record
+	typedef uint32_t LengthType;
+
+	/// Length prefix marking the unused end of the buffer before a wrap
+	static constexpr LengthType WRAP = 0xFFFFFFFF;
+
+public:
+	LogRing() = default;
+
+	/// Discard all records and allocate a new buffer
+	/// @param[in] capacity - the buffer size in bytes, or 0 to free the buffer
+	/// @param[in] hugePages - true to back the buffer with huge pages, see HugePages
+	void Reset(size_t capacity, bool hugePages = false);
+
+	/// Get the buffer size
+	/// @return The capacity in bytes, or 0 if no buffer is allocated.
+	size_t Capacity() const { return m_capacity; }
+
+	/// Append a record, discarding the oldest records to make room. A record
+	/// larger than the buffer is truncated.
+	/// @param[in] record - the record to append
+	void Append(std::string_view record);
+
+	/// Discard all records and reset the overwritten count. The buffer is kept.
+	void Clear();
+
+	/// Get the number of records held
+	/// @return The record count.
+	size_t Size() const { return m_count; }
+
+	/// Get the number of records discarded to make room for newer records since
+	/// the last Clear()
+	/// @return The overwritten record count.
+	uint64_t GetOverwritten() const { return m_overwritten; }
+
+	/// Invoke a function for each record held, oldest first. Async signal-safe
+	/// if the function is.
+	/// @param[in] func - called with each record as a std::string_view
+	template <class Func>
+	void ForEach(Func&& func) const
+	{
+		uint64_t pos = m_tail.load(std::memory_order_acquire);
+		uint64_t head = m_head.load(std::memory_order_acquire);
+		while (pos < head)
+		{
+			size_t index = (size_t)(pos % m_capacity);
+			LengthType len = WRAP;
+			if (m_capacity - index >= sizeof(LengthType))
+				memcpy(&len, m_data.get() + index, sizeof(len));
+			if (len == WRAP)
+			{
+				pos += m_capacity - index;
+				continue;
+			}
+			if (len > m_capacity - index - sizeof(LengthType))
+				return;
+			func(std::string_view(m_data.get() + index + sizeof(LengthType), len));
+			pos += sizeof(LengthType) + len;
+		}
+	}
+
+private:
+	LogRing(const LogRing&) = delete;
+	LogRing& operator=(const LogRing&) = delete;
+
+	/// Get the position following the record or the wrap padding at a position
+	uint64_t Next(uint64_t pos, bool& record) const;
+
+	HugePages::Ptr m_data;
+	size_t m_capacity = 0;
+
+	/// Monotonic byte positions of the oldest record and the end of the newest
+	std::atomic<uint64_t> m_tail{ 0 };
+	std::atomic<uint64_t> m_head{ 0 };
+
+	size_t m_count = 0;
+	uint64_t m_overwritten = 0;
+};
+
+#endif
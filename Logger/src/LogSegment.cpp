@@ -0,0 +1,230 @@
+#include "LogSegment.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// SegmentFileName
+//----------------------------------------------------------------------------
+static std::string SegmentFileName(const std::string& baseName, uint32_t index)
+{
+	char suffix[16];
+	snprintf(suffix, sizeof(suffix), ".%06u", index);
+	return baseName + suffix;
+}
+
+//----------------------------------------------------------------------------
+// FileExists
+//----------------------------------------------------------------------------
+static bool FileExists(const std::string& fileName)
+{
+	FILE* file = fopen(fileName.c_str(), "rb");
+	if (!file)
+		return false;
+	fclose(file);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// ~LogSegment
+//----------------------------------------------------------------------------
+LogSegment::~LogSegment()
+{
+	Close();
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+bool LogSegment::Open(const std::string& baseName, size_t segmentSize)
+{
+	Close();
+
+	if (segmentSize == 0)
+		return false;
+	m_baseName = baseName;
+	m_segmentSize = segmentSize;
+
+	// Start after the highest existing segment so earlier segments are kept
+	m_index = 0;
+	while (FileExists(SegmentFileName(m_baseName, m_index)))
+		m_index++;
+
+	m_lastSync = std::chrono::steady_clock::now();
+	return OpenSegment();
+}
+
+//----------------------------------------------------------------------------
+// OpenSegment
+//----------------------------------------------------------------------------
+bool LogSegment::OpenSegment()
+{
+	m_fileName = SegmentFileName(m_baseName, m_index++);
+	m_used = 0;
+
+#ifdef WIN32
+	HANDLE file = CreateFileA(m_fileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+		NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	size.QuadPart = (LONGLONG)m_segmentSize;
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, NULL);
+	if (!mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	void* map = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, m_segmentSize);
+	if (!map)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	m_file = file;
+	m_mapping = mapping;
+	m_map = static_cast<char*>(map);
+#else
+	int fd = open(m_fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+
+	// Preallocate the whole segment so writes never extend the file
+	if (ftruncate(fd, (off_t)m_segmentSize) != 0)
+	{
+		close(fd);
+		return false;
+	}
+	void* map = mmap(nullptr, m_segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+	{
+		close(fd);
+		return false;
+	}
+	m_fd = fd;
+	m_map = static_cast<char*>(map);
+#endif
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void LogSegment::Close()
+{
+	if (!m_map)
+		return;
+
+	if (m_syncPolicy != LogFile::SyncPolicy::NONE)
+		Sync();
+
+#ifdef WIN32
+	UnmapViewOfFile(m_map);
+	CloseHandle(m_mapping);
+
+	// Drop the unwritten tail of the segment
+	LARGE_INTEGER pos;
+	pos.QuadPart = (LONGLONG)m_used;
+	SetFilePointerEx(m_file, pos, NULL, FILE_BEGIN);
+	SetEndOfFile(m_file);
+	CloseHandle(m_file);
+	m_mapping = nullptr;
+	m_file = nullptr;
+#else
+	munmap(m_map, m_segmentSize);
+
+	// Drop the unwritten tail of the segment
+	if (ftruncate(m_fd, (off_t)m_used) != 0)
+	{
+		// The zero filled tail remains. Readers stop at the first zero byte.
+	}
+	close(m_fd);
+	m_fd = -1;
+#endif
+	m_map = nullptr;
+	m_used = 0;
+	m_closed.push_back(m_fileName);
+	m_fileName.clear();
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+bool LogSegment::Write(const char* data, size_t size)
+{
+	while (size > 0)
+	{
+		if (!m_map)
+			return false;
+
+		// Roll over to the next segment when the current segment is full
+		if (m_used == m_segmentSize)
+		{
+			Close();
+			if (!OpenSegment())
+				return false;
+		}
+
+		size_t len = std::min(size, m_segmentSize - m_used);
+		memcpy(m_map + m_used, data, len);
+		m_used += len;
+		data += len;
+		size -= len;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Flush
+//----------------------------------------------------------------------------
+bool LogSegment::Flush(bool forceSync)
+{
+	if (!m_map)
+		return false;
+
+	if (forceSync)
+		return Sync();
+
+	switch (m_syncPolicy)
+	{
+		case LogFile::SyncPolicy::PER_FLUSH:
+			return Sync();
+
+		case LogFile::SyncPolicy::INTERVAL:
+			if (std::chrono::steady_clock::now() - m_lastSync >= m_syncInterval)
+				return Sync();
+			return true;
+
+		case LogFile::SyncPolicy::NONE:
+		default:
+			// Data copied into a shared mapping is already visible to readers
+			return true;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Sync
+//----------------------------------------------------------------------------
+bool LogSegment::Sync()
+{
+	m_lastSync = std::chrono::steady_clock::now();
+	if (m_used == 0)
+		return true;
+#ifdef WIN32
+	return FlushViewOfFile(m_map, m_used) && FlushFileBuffers(m_file);
+#else
+	return msync(m_map, m_used, MS_SYNC) == 0;
+#endif
+}
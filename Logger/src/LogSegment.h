@@ -0,0 +1,115 @@
+#ifndef _LOG_SEGMENT_H
+#define _LOG_SEGMENT_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "LogFile.h"
+
+/// @brief LogSegment is an append-only sink that writes into memory-mapped,
+/// preallocated segment files. Writes are copied directly into the mapping so no
+/// user-space buffering or write system call is required. When a segment fills,
+/// the writes roll over into the next segment file. LogSegment is not thread-safe.
+///
+/// @details Segment files are named <baseName>.<index> with a six digit index.
+/// Opening starts a new segment after the highest existing index. While a segment
+/// is open its file is the full segment size with the unwritten tail zero filled.
+/// A closed segment is truncated to the bytes written.
+class LogSegment
+{
+public:
+	/// Default segment size in bytes
+	static const size_t DEFAULT_SEGMENT_SIZE = 4 * 1024 * 1024;
+
+	/// Constructor
+	LogSegment() = default;
+
+	/// Destructor
+	~LogSegment();
+
+	/// Open a new segment. Any previously opened segment is closed first.
+	/// @param[in] baseName - the segment file base name
+	/// @param[in] segmentSize - the size of each segment file in bytes
+	/// @return True if success.
+	bool Open(const std::string& baseName, size_t segmentSize = DEFAULT_SEGMENT_SIZE);
+
+	/// Sync and close the segment, truncating the file to the bytes written
+	void Close();
+
+	/// Check if a segment is open
+	/// @return True if a segment is open.
+	bool IsOpen() const { return m_map != nullptr; }
+
+	/// Copy data into the segment, rolling over to a new segment when full
+	/// @param[in] data - the data to write
+	/// @param[in] size - the data size in bytes
+	/// @return True if success.
+	bool Write(const char* data, size_t size);
+
+	/// Sync the mapping to the storage device according to the sync policy.
+	/// Called once per flush window.
+	/// @param[in] forceSync - true to sync regardless of the sync policy
+	/// @return True if success.
+	bool Flush(bool forceSync = false);
+
+	/// Set the sync policy
+	/// @param[in] policy - the sync policy
+	/// @param[in] interval - the minimum time between syncs for LogFile::SyncPolicy::INTERVAL
+	void SetSyncPolicy(LogFile::SyncPolicy policy, std::chrono::milliseconds interval = std::chrono::milliseconds(0))
+	{
+		m_syncPolicy = policy;
+		m_syncInterval = interval;
+	}
+
+	/// Get the sync policy
+	/// @return The sync policy.
+	LogFile::SyncPolicy GetSyncPolicy() const { return m_syncPolicy; }
+
+	/// Get the file name of the open segment
+	/// @return The segment file name or an empty string if none is open.
+	const std::string& GetFileName() const { return m_fileName; }
+
+	/// Take the file names of segments closed since the last call
+	/// @param[out] fileNames - the closed segment file names are appended
+	void TakeClosedSegments(std::vector<std::string>& fileNames)
+	{
+		fileNames.insert(fileNames.end(), m_closed.begin(), m_closed.end());
+		m_closed.clear();
+	}
+
+private:
+	LogSegment(const LogSegment&) = delete;
+	LogSegment& operator=(const LogSegment&) = delete;
+
+	/// Create, preallocate and map the next segment file
+	/// @return True if success.
+	bool OpenSegment();
+
+	/// Force the written part of the mapping to the storage device
+	/// @return True if success.
+	bool Sync();
+
+	std::string m_baseName;
+	std::string m_fileName;
+	size_t m_segmentSize = DEFAULT_SEGMENT_SIZE;
+	uint32_t m_index = 0;
+
+	/// Segments closed since the last TakeClosedSegments() call
+	std::vector<std::string> m_closed;
+
+	char* m_map = nullptr;
+	size_t m_used = 0;
+#ifdef WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+
+	LogFile::SyncPolicy m_syncPolicy = LogFile::SyncPolicy::NONE;
+	std::chrono::milliseconds m_syncInterval = std::chrono::milliseconds(0);
+	std::chrono::steady_clock::time_point m_lastSync;
+};
+
+#endif
@@ -0,0 +1,248 @@
+#include "LogShmSink.h"
+
+#ifndef WIN32
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+using namespace std;
+
+/// Offset of the ring data within the region
+static const size_t DATA_OFFSET = 256;
+
+//----------------------------------------------------------------------------
+// Create
+//----------------------------------------------------------------------------
+std::unique_ptr<LogShmRing> LogShmRing::Create(const std::string& name, size_t capacity)
+{
+	static_assert(sizeof(Header) <= DATA_OFFSET, "Header does not fit");
+	if (capacity < 256 || (capacity & (capacity - 1)) != 0 || capacity > 0x80000000)
+		throw std::invalid_argument("Capacity must be a power of 2");
+
+	// Remove a region left behind by an earlier process
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		return nullptr;
+
+	size_t regionSize = DATA_OFFSET + capacity;
+	void* region = MAP_FAILED;
+	if (ftruncate(fd, (off_t)regionSize) == 0)
+		region = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (region == MAP_FAILED)
+	{
+		shm_unlink(name.c_str());
+		return nullptr;
+	}
+
+	Header* header = new(region) Header();
+	header->capacity = (uint32_t)capacity;
+	header->tail.store(0, std::memory_order_relaxed);
+	header->head.store(0, std::memory_order_relaxed);
+	header->sequence.store(0, std::memory_order_relaxed);
+
+	// Publish the initialized header to processes opening the region
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = MAGIC;
+
+	return std::unique_ptr<LogShmRing>(new LogShmRing(name, region, regionSize, true));
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+std::unique_ptr<LogShmRing> LogShmRing::Open(const std::string& name, bool fromOldest)
+{
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat st;
+	void* region = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size > DATA_OFFSET)
+		region = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (region == MAP_FAILED)
+		return nullptr;
+
+	size_t regionSize = (size_t)st.st_size;
+	const Header* header = static_cast<const Header*>(region);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (header->magic != MAGIC || DATA_OFFSET + header->capacity != regionSize)
+	{
+		munmap(region, regionSize);
+		return nullptr;
+	}
+
+	std::unique_ptr<LogShmRing> ring(new LogShmRing(name, region, regionSize, false));
+	ring->m_readPos = fromOldest ? header->tail.load(std::memory_order_acquire) :
+		header->head.load(std::memory_order_acquire);
+	return ring;
+}
+
+//----------------------------------------------------------------------------
+// LogShmRing
+//----------------------------------------------------------------------------
+LogShmRing::LogShmRing(const std::string& name, void* region, size_t regionSize, bool owner) :
+	m_name(name), m_region(region), m_regionSize(regionSize), m_owner(owner)
+{
+	m_header = static_cast<Header*>(region);
+	m_data = static_cast<char*>(region) + DATA_OFFSET;
+	m_capacity = m_header->capacity;
+	m_mask = m_capacity - 1;
+}
+
+//----------------------------------------------------------------------------
+// ~LogShmRing
+//----------------------------------------------------------------------------
+LogShmRing::~LogShmRing()
+{
+	munmap(m_region, m_regionSize);
+	if (m_owner)
+		shm_unlink(m_name.c_str());
+}
+
+//----------------------------------------------------------------------------
+// Evict
+//----------------------------------------------------------------------------
+void LogShmRing::Evict(uint64_t end)
+{
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+	if (end - tail <= m_capacity)
+		return;
+
+	// Walk the records from the oldest until the new record fits
+	while (end - tail > m_capacity)
+	{
+		RecordHeader record;
+		memcpy(&record, m_data + (tail & m_mask), sizeof(record));
+		tail += RecordSpace(record.size);
+	}
+	m_header->tail.store(tail, std::memory_order_relaxed);
+
+	// Readers checking the tail after copying see it moved before any of the
+	// bytes they copied were overwritten
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+void LogShmRing::Write(std::string_view record)
+{
+	size_t size = std::min(record.size(), GetMaxRecordSize());
+	size_t space = RecordSpace(size);
+	uint64_t head = m_header->head.load(std::memory_order_relaxed);
+	size_t index = (size_t)(head & m_mask);
+
+	// A record is stored contiguously so pad the end of the ring if it does not fit
+	size_t gap = index + space > m_capacity ? m_capacity - index : 0;
+	Evict(head + gap + space);
+	if (gap)
+	{
+		RecordHeader pad = { (uint32_t)(gap - RECORD_HEADER_SIZE), 1, 0 };
+		memcpy(m_data + index, &pad, sizeof(pad));
+		head += gap;
+		index = 0;
+	}
+
+	uint64_t sequence = m_header->sequence.load(std::memory_order_relaxed);
+	RecordHeader header = { (uint32_t)size, 0, sequence };
+	memcpy(m_data + index, &header, sizeof(header));
+	memcpy(m_data + index + RECORD_HEADER_SIZE, record.data(), size);
+	m_header->sequence.store(sequence + 1, std::memory_order_relaxed);
+	m_header->head.store(head + space, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// Read
+//----------------------------------------------------------------------------
+size_t LogShmRing::Read(const std::function<void(uint64_t, std::string_view)>& handler, size_t maxRecords)
+{
+	size_t count = 0;
+	uint64_t head = m_header->head.load(std::memory_order_acquire);
+	while (m_readPos < head && count < maxRecords)
+	{
+		// Lapped by the writer
+		uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+		if (m_readPos < tail)
+			m_readPos = tail;
+		if (m_readPos >= head)
+			break;
+
+		// Copy the record, then check the writer did not overwrite it meanwhile
+		RecordHeader record;
+		memcpy(&record, m_data + (m_readPos & m_mask), sizeof(record));
+		size_t size = std::min((size_t)record.size, m_capacity - RECORD_HEADER_SIZE);
+		if (!record.pad)
+			m_record.assign(m_data + (m_readPos & m_mask) + RECORD_HEADER_SIZE,
+				std::min(size, m_capacity - (size_t)(m_readPos & m_mask) - RECORD_HEADER_SIZE));
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (m_readPos < m_header->tail.load(std::memory_order_relaxed))
+			continue;
+
+		m_readPos += RecordSpace(size);
+		if (record.pad)
+			continue;
+
+		if (m_sequenceKnown && record.sequence > m_nextSequence)
+			m_lost += record.sequence - m_nextSequence;
+		m_nextSequence = record.sequence + 1;
+		m_sequenceKnown = true;
+		handler(record.sequence, m_record);
+		count++;
+	}
+	return count;
+}
+
+//----------------------------------------------------------------------------
+// IsReady
+//----------------------------------------------------------------------------
+bool LogShmRing::IsReady() const
+{
+	return m_readPos < m_header->head.load(std::memory_order_acquire);
+}
+
+//----------------------------------------------------------------------------
+// GetWritten
+//----------------------------------------------------------------------------
+uint64_t LogShmRing::GetWritten() const
+{
+	return m_header->sequence.load(std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// LogShmSink
+//----------------------------------------------------------------------------
+LogShmSink::LogShmSink(const std::string& name, size_t capacity, size_t maxRecords) :
+	LogSink("LogShmSink", maxRecords), m_ring(LogShmRing::Create(name, capacity))
+{
+}
+
+//----------------------------------------------------------------------------
+// ~LogShmSink
+//----------------------------------------------------------------------------
+LogShmSink::~LogShmSink()
+{
+	Stop();
+}
+
+//----------------------------------------------------------------------------
+// WriteRecord
+//----------------------------------------------------------------------------
+bool LogShmSink::WriteRecord(std::string_view record)
+{
+	if (!m_ring)
+		return false;
+	m_ring->Write(record);
+	return true;
+}
+
+#endif
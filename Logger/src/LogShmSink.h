@@ -0,0 +1,164 @@
+#ifndef _LOG_SHM_SINK_H
+#define _LOG_SHM_SINK_H
+
+/// @file
+/// @brief Publishes flushed log records to a named shared memory ring read by
+/// other processes, e.g. a sidecar agent that would otherwise tail the log file.
+/// POSIX only.
+
+#ifndef WIN32
+
+#include <string>
+#include <string_view>
+#include <functional>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include "LogSink.h"
+
+/// @brief A byte ring within a named shared memory region written by one process
+/// and read by any number of reader processes without a lock.
+///
+/// @details The writer never waits for readers. Once the ring is full each record
+/// overwrites the oldest. Records are length-prefixed, carry a sequence number
+/// and are padded to 16 bytes. The region header holds the monotonic byte
+/// positions of the newest record end (the head) and of the oldest intact record
+/// (the tail). The writer moves the tail past the records it is about to
+/// overwrite before writing over them, and the head once the record is written.
+///
+/// A reader keeps its own position. It copies a record out of the ring and then
+/// checks its position is still at or past the tail. A position behind the tail
+/// means the writer lapped the reader and the copy may be torn, so the reader
+/// skips to the tail instead. The sequence numbers of the records read next tell
+/// how many records were lost. Readers cost the writer nothing and may come and
+/// go at any time.
+class LogShmRing
+{
+public:
+	/// Create and own a named ring. The name is removed when the ring is destroyed.
+	/// @param[in] name - the shared memory name, e.g. "/logger"
+	/// @param[in] capacity - the ring size in bytes. Must be a power of 2.
+	/// @return The ring, or nullptr if the region cannot be created.
+	/// @throws std::invalid_argument If the capacity is not a power of 2.
+	static std::unique_ptr<LogShmRing> Create(const std::string& name, size_t capacity);
+
+	/// Open a ring created by another process to read it
+	/// @param[in] name - the shared memory name passed to Create()
+	/// @param[in] fromOldest - true to start with the oldest record held, false
+	///     to start with the next record written
+	/// @return The ring, or nullptr if the region does not exist or is not a ring.
+	static std::unique_ptr<LogShmRing> Open(const std::string& name, bool fromOldest);
+
+	/// Destructor
+	~LogShmRing();
+
+	/// Write a record, overwriting the oldest records if needed. Called by the
+	/// writer only. Records longer than GetMaxRecordSize() are truncated.
+	/// @param[in] record - the record
+	void Write(std::string_view record);
+
+	/// Read the records written since the last call. Called by a reader only.
+	/// @param[in] handler - called with the sequence number and the record, which
+	///     is valid during the call
+	/// @param[in] maxRecords - the most records to read
+	/// @return The number of records read.
+	size_t Read(const std::function<void(uint64_t, std::string_view)>& handler, size_t maxRecords = SIZE_MAX);
+
+	/// Check if records are waiting to be read. Called by a reader only.
+	bool IsReady() const;
+
+	/// Get the number of records written to the ring
+	uint64_t GetWritten() const;
+
+	/// Get the number of records the writer overwrote before this reader read them
+	uint64_t GetLost() const { return m_lost; }
+
+	/// Get the largest record size
+	size_t GetMaxRecordSize() const { return m_capacity / 2 - RECORD_HEADER_SIZE; }
+
+private:
+	/// Region header shared by every process. Positions only increase. Lock-free
+	/// atomics are address free, so they work across processes.
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t capacity;
+		alignas(64) std::atomic<uint64_t> tail;
+		std::atomic<uint64_t> head;
+		std::atomic<uint64_t> sequence;
+	};
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory atomics must be lock-free");
+
+	/// Record header
+	struct RecordHeader
+	{
+		uint32_t size;
+		uint32_t pad;
+		uint64_t sequence;
+	};
+	static constexpr size_t RECORD_HEADER_SIZE = sizeof(RecordHeader);
+	static constexpr size_t RECORD_ALIGN = 16;
+	static_assert(RECORD_HEADER_SIZE == RECORD_ALIGN, "A padding record must fit any gap");
+
+	static constexpr uint32_t MAGIC = 0x4C4F4752;
+
+	LogShmRing(const std::string& name, void* region, size_t regionSize, bool owner);
+	LogShmRing(const LogShmRing&) = delete;
+	LogShmRing& operator=(const LogShmRing&) = delete;
+
+	static size_t RecordSpace(size_t size) { return (RECORD_HEADER_SIZE + size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1); }
+
+	/// Move the tail past the records overwritten up to a position. Called by the writer.
+	void Evict(uint64_t end);
+
+	const std::string m_name;
+	void* const m_region;
+	const size_t m_regionSize;
+	const bool m_owner;
+	Header* m_header;
+	char* m_data;
+	size_t m_capacity;
+	uint64_t m_mask;
+
+	/// Reader state
+	uint64_t m_readPos = 0;
+	uint64_t m_nextSequence = 0;
+	bool m_sequenceKnown = false;
+	uint64_t m_lost = 0;
+	std::string m_record;
+};
+
+/// @brief Publishes each flushed record to a LogShmRing. Readers in other
+/// processes open the ring by name with LogShmRing::Open() and consume the
+/// records as they are flushed, without the log file round trip. The ring
+/// never blocks the sink, so a slow or absent reader only loses records.
+class LogShmSink : public LogSink
+{
+public:
+	/// Default ring size in bytes
+	static constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+	/// Constructor. The ring is created at once so readers can open it.
+	/// @param[in] name - the shared memory name, e.g. "/logger"
+	/// @param[in] capacity - the ring size in bytes. Must be a power of 2.
+	/// @param[in] maxRecords - the bounded buffer capacity in records
+	/// @throws std::invalid_argument If the capacity is not a power of 2.
+	LogShmSink(const std::string& name, size_t capacity = DEFAULT_CAPACITY, size_t maxRecords = DEFAULT_MAX_RECORDS);
+
+	/// Destructor
+	~LogShmSink() override;
+
+	/// Check if the ring was created
+	/// @return True if records are published.
+	bool IsOpen() const { return m_ring != nullptr; }
+
+protected:
+	bool WriteRecord(std::string_view record) override;
+
+private:
+	std::unique_ptr<LogShmRing> m_ring;
+};
+
+#endif
+
+#endif
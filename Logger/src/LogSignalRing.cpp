@@ -0,0 +1,104 @@
+#include "LogSignalRing.h"
+#include "LogTimestamp.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// Reset
+//----------------------------------------------------------------------------
+void LogSignalRing::Reset(size_t slots)
+{
+	m_enqueuePos.store(0, std::memory_order_relaxed);
+	m_dequeuePos.store(0, std::memory_order_relaxed);
+	if (slots == 0)
+	{
+		m_slots.reset();
+		m_mask = 0;
+		return;
+	}
+
+	size_t capacity = 2;
+	while (capacity < slots)
+		capacity *= 2;
+	m_slots.reset(new Slot[capacity]);
+	m_mask = capacity - 1;
+	for (size_t i = 0; i < capacity; i++)
+	{
+		m_slots[i].sequence.store(i, std::memory_order_relaxed);
+		m_slots[i].size = 0;
+	}
+}
+
+//----------------------------------------------------------------------------
+// Push
+//----------------------------------------------------------------------------
+bool LogSignalRing::Push(const char* data, size_t size, bool stamp)
+{
+	if (!m_slots)
+		return false;
+
+	uint64_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+	Slot* slot;
+	for (;;)
+	{
+		slot = &m_slots[pos & m_mask];
+		uint64_t seq = slot->sequence.load(std::memory_order_acquire);
+		int64_t diff = (int64_t)(seq - pos);
+		if (diff == 0)
+		{
+			if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				break;
+		}
+		else if (diff < 0)
+		{
+			// Full. Waiting could deadlock a handler interrupting the consumer.
+			m_dropCount.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		else
+			pos = m_enqueuePos.load(std::memory_order_relaxed);
+	}
+
+	size_t offset = 0;
+	if (stamp)
+	{
+		LogTimestamp::StampPrefix(slot->data);
+		offset = LogTimestamp::PREFIX_SIZE;
+	}
+	size_t len = std::min(size, SLOT_SIZE - offset);
+	memcpy(slot->data + offset, data, len);
+	slot->size = (uint32_t)(offset + len);
+	slot->sequence.store(pos + 1, std::memory_order_release);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// TryPop
+//----------------------------------------------------------------------------
+bool LogSignalRing::TryPop(std::string& record)
+{
+	if (!m_slots)
+		return false;
+
+	uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+	Slot& slot = m_slots[pos & m_mask];
+	if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+		return false;
+	record.assign(slot.data, slot.size);
+	m_dequeuePos.store(pos + 1, std::memory_order_relaxed);
+	slot.sequence.store(pos + m_mask + 1, std::memory_order_release);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Empty
+//----------------------------------------------------------------------------
+bool LogSignalRing::Empty() const
+{
+	if (!m_slots)
+		return true;
+	uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+	return m_slots[pos & m_mask].sequence.load(std::memory_order_acquire) != pos + 1;
+}
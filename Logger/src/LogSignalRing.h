@@ -0,0 +1,105 @@
+#ifndef _LOG_SIGNAL_RING_H
+#define _LOG_SIGNAL_RING_H
+
+#include "CacheLine.h"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+
+/// @brief A bounded ring of fixed-size record slots written from signal
+/// handlers and drained by one consumer, the Logger thread.
+///
+/// @details Push() is async-signal-safe: it copies the record into a slot
+/// allocated by Reset(), claims the slot with a compare-and-swap on a lock-free
+/// atomic and never blocks, allocates or makes a system call other than
+/// reading the clock. Each slot carries a sequence number handing it between
+/// producers and the consumer (D. Vyukov bounded queue algorithm, as in
+/// LockFreeQueue), so a handler interrupting a producer on the same thread
+/// claims the next slot. Records longer than SLOT_SIZE are truncated and a
+/// record pushed while every slot is full is dropped.
+class LogSignalRing
+{
+public:
+	/// Record bytes per slot, including the timestamp prefix
+	static constexpr size_t SLOT_SIZE = 256;
+
+	LogSignalRing() = default;
+
+	/// Allocate the slots, discarding any queued records. Not async-signal-safe
+	/// and not thread-safe, so call before the signal handlers are installed.
+	/// @param[in] slots - the slot count, rounded up to a power of 2, or 0 to
+	///     free the slots
+	void Reset(size_t slots);
+
+	/// Get the slot count
+	/// @return The capacity in records, or 0 if no slots are allocated.
+	size_t Capacity() const { return m_slots ? m_mask + 1 : 0; }
+
+	/// Copy a record into a free slot. Async-signal-safe and safe to call from
+	/// any thread.
+	/// @param[in] data - the record bytes
+	/// @param[in] size - the record size
+	/// @param[in] stamp - true to prefix the record with the current tick, see
+	///     LogTimestamp
+	/// @return True if queued. False if no slots are allocated or all are full.
+	bool Push(const char* data, size_t size, bool stamp);
+
+	/// Pop the oldest record. Called by the consumer thread.
+	/// @param[out] record - the popped record
+	/// @return True if a record was popped. False if the ring is empty.
+	bool TryPop(std::string& record);
+
+	/// Check if the ring is empty
+	/// @return True if no record is ready to pop.
+	bool Empty() const;
+
+	/// Invoke a function for each record ready to pop, oldest first, without
+	/// popping. Async-signal-safe if the function is.
+	/// @param[in] func - called with each record as a std::string_view
+	template <class Func>
+	void ForEach(Func&& func) const
+	{
+		if (!m_slots)
+			return;
+		for (uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);; pos++)
+		{
+			const Slot& slot = m_slots[pos & m_mask];
+			if (slot.sequence.load(std::memory_order_acquire) != pos + 1)
+				return;
+			func(std::string_view(slot.data, slot.size));
+		}
+	}
+
+	/// Get the number of records dropped because every slot was full
+	/// @return The drop count.
+	uint64_t GetDropCount() const { return m_dropCount.load(std::memory_order_relaxed); }
+
+private:
+	LogSignalRing(const LogSignalRing&) = delete;
+	LogSignalRing& operator=(const LogSignalRing&) = delete;
+
+	// A lock may not be taken within a signal handler
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Signal ring needs lock-free 64-bit atomics");
+
+	struct Slot
+	{
+		std::atomic<uint64_t> sequence;
+		uint32_t size;
+		char data[SLOT_SIZE];
+	};
+
+	std::unique_ptr<Slot[]> m_slots;
+	uint64_t m_mask = 0;
+
+	/// Written by producers
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_enqueuePos{ 0 };
+	std::atomic<uint64_t> m_dropCount{ 0 };
+
+	/// Written by the consumer
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_dequeuePos{ 0 };
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "LogSink.h"
+#include "LogTimestamp.h"
+
+using namespace std;
+using namespace DelegateLib;
+
+//----------------------------------------------------------------------------
+// LogSink
+//----------------------------------------------------------------------------
+LogSink::LogSink(const std::string& name, size_t maxRecords) :
+	m_name(name), m_maxRecords(maxRecords), m_thread(name), m_flushTimer(m_thread.GetTimers()),
+	m_running(false), m_queued(0), m_written(0), m_dropped(0), m_failed(0)
+{
+	m_flushTimer.Expired = MakeDelegate(this, &LogSink::Flush);
+}
+
+//----------------------------------------------------------------------------
+// ~LogSink
+//----------------------------------------------------------------------------
+LogSink::~LogSink()
+{
+	Stop();
+}
+
+//----------------------------------------------------------------------------
+// Start
+//----------------------------------------------------------------------------
+void LogSink::Start()
+{
+	if (m_running)
+		return;
+
+	m_thread.CreateThread();
+	if (m_flushPolicy.interval.count() > 0)
+		m_flushTimer.Start(m_flushPolicy.interval);
+	m_running = true;
+}
+
+//----------------------------------------------------------------------------
+// Stop
+//----------------------------------------------------------------------------
+void LogSink::Stop()
+{
+	if (!m_running.exchange(false))
+		return;
+
+	// Drain the queued batches then flush on this thread once the sink thread exits
+	m_flushTimer.Stop();
+	m_thread.ExitThread(WorkerThread::ExitMode::DRAIN);
+	Flush();
+}
+
+//----------------------------------------------------------------------------
+// Post
+//----------------------------------------------------------------------------
+bool LogSink::Post(const Batch& batch)
+{
+	if (!batch || batch->Empty())
+		return true;
+
+	// A slow sink drops whole batches rather than delaying the Logger thread
+	const size_t records = batch->Size();
+	if (!m_running || m_queued.load(std::memory_order_relaxed) + records > m_maxRecords)
+	{
+		m_dropped.fetch_add(records, std::memory_order_relaxed);
+		return false;
+	}
+
+	m_queued.fetch_add(records, std::memory_order_relaxed);
+	MakeDelegate(this, &LogSink::Process, m_thread)(batch);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// GetStats
+//----------------------------------------------------------------------------
+LogSink::Stats LogSink::GetStats() const
+{
+	Stats stats;
+	stats.queued = m_queued.load(std::memory_order_relaxed);
+	stats.written = m_written.load(std::memory_order_relaxed);
+	stats.dropped = m_dropped.load(std::memory_order_relaxed);
+	stats.failed = m_failed.load(std::memory_order_relaxed);
+	return stats;
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void LogSink::Process(Batch batch)
+{
+	uint64_t failed = 0;
+	for (std::string_view record : *batch)
+	{
+		// Binary and stamped records are rendered to text on the sink thread
+		record = m_formatter.Render(record, m_text);
+		if (!WriteRecord(record))
+			failed++;
+	}
+
+	const size_t records = batch->Size();
+	m_written.fetch_add(records - failed, std::memory_order_relaxed);
+	m_failed.fetch_add(failed, std::memory_order_relaxed);
+	m_queued.fetch_sub(records, std::memory_order_relaxed);
+
+	m_unflushed += records;
+	bool flushOnBatch = m_flushPolicy.records == 0 && m_flushPolicy.interval.count() == 0;
+	if (flushOnBatch || (m_flushPolicy.records && m_unflushed >= m_flushPolicy.records))
+		Flush();
+}
+
+//----------------------------------------------------------------------------
+// Flush
+//----------------------------------------------------------------------------
+void LogSink::Flush()
+{
+	if (m_unflushed == 0)
+		return;
+
+	// A failed flush is retried by the next batch or flush interval
+	if (FlushRecords())
+		m_unflushed = 0;
+	else
+		m_failed.fetch_add(1, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// LogFileSink
+//----------------------------------------------------------------------------
+LogFileSink::LogFileSink(const std::string& fileName, size_t maxRecords) :
+	LogSink("LogFileSink", maxRecords), m_fileName(fileName)
+{
+}
+
+//----------------------------------------------------------------------------
+// ~LogFileSink
+//----------------------------------------------------------------------------
+LogFileSink::~LogFileSink()
+{
+	Stop();
+}
+
+//----------------------------------------------------------------------------
+// WriteRecord
+//----------------------------------------------------------------------------
+bool LogFileSink::WriteRecord(std::string_view record)
+{
+	// Open the file once and keep it open
+	if (!m_file.IsOpen() && !m_file.Open(m_fileName))
+		return false;
+	return m_file.Write(record.data(), record.size()) && m_file.Write("\n", 1);
+}
+
+//----------------------------------------------------------------------------
+// FlushRecords
+//----------------------------------------------------------------------------
+bool LogFileSink::FlushRecords()
+{
+	return m_file.IsOpen() && m_file.Flush();
+}
+
+//----------------------------------------------------------------------------
+// LogStreamSink
+//----------------------------------------------------------------------------
+LogStreamSink::LogStreamSink(std::ostream& stream, size_t maxRecords) :
+	LogSink("LogStreamSink", maxRecords), m_stream(stream)
+{
+}
+
+//----------------------------------------------------------------------------
+// ~LogStreamSink
+//----------------------------------------------------------------------------
+LogStreamSink::~LogStreamSink()
+{
+	Stop();
+}
+
+//----------------------------------------------------------------------------
+// WriteRecord
+//----------------------------------------------------------------------------
+bool LogStreamSink::WriteRecord(std::string_view record)
+{
+	m_stream.write(record.data(), (std::streamsize)record.size());
+	m_stream.put('\n');
+	return m_stream.good();
+}
+
+//----------------------------------------------------------------------------
+// FlushRecords
+//----------------------------------------------------------------------------
+bool LogStreamSink::FlushRecords()
+{
+	return m_stream.flush().good();
+}
@@ -0,0 +1,185 @@
+#ifndef _LOG_SINK_H
+#define _LOG_SINK_H
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <ostream>
+#include "LogBuffer.h"
+#include "LogFile.h"
+#include "LogTimestamp.h"
+#include "WorkerThreadStd.h"
+#include "Timer.h"
+
+/// @brief LogSink is a destination LogData fans log records out to in addition 
+/// to its log file, e.g. a second local file, stdout or a network collector. 
+/// Each sink owns a WorkerThread, a bounded buffer and a flush policy so a slow 
+/// sink only delays itself. 
+/// 
+/// @details LogData posts each flush window as one immutable batch shared by 
+/// every sink by reference count. A batch that does not fit within the bounded 
+/// buffer is dropped and counted. Subclasses implement WriteRecord() and 
+/// FlushRecords(), which are only called on the sink thread. Binary and stamped 
+/// records are rendered to text on the sink thread before WriteRecord() is called.
+///
+/// A subclass destructor must call Stop() so queued records are written before
+/// the subclass is destroyed.
+class LogSink
+{
+public:
+	/// An immutable batch of records shared by all sinks
+	typedef std::shared_ptr<const LogBuffer> Batch;
+
+	/// Default bounded buffer capacity in records
+	static constexpr size_t DEFAULT_MAX_RECORDS = 100000;
+
+	/// Conditions that flush the records written to the sink. A zero value 
+	/// disables the condition. With both disabled every batch is flushed.
+	struct FlushPolicy
+	{
+		/// Flush once this many records are written since the last flush
+		size_t records = 0;
+
+		/// Flush records left unflushed for this long, and retry a failed flush
+		std::chrono::milliseconds interval = std::chrono::milliseconds(0);
+	};
+
+	/// Snapshot of the sink counters
+	struct Stats
+	{
+		/// Records waiting in the bounded buffer
+		size_t queued = 0;
+
+		/// Records written to the sink
+		uint64_t written = 0;
+
+		/// Records discarded because the bounded buffer was full
+		uint64_t dropped = 0;
+
+		/// Failed record writes and flushes
+		uint64_t failed = 0;
+	};
+
+	/// Constructor
+	/// @param[in] name - the sink thread name
+	/// @param[in] maxRecords - the bounded buffer capacity in records
+	LogSink(const std::string& name, size_t maxRecords = DEFAULT_MAX_RECORDS);
+
+	/// Destructor
+	virtual ~LogSink();
+
+	/// Create the sink thread. Called by LogData::AddSink().
+	void Start();
+
+	/// Write the queued records, flush the sink and exit the sink thread. Called 
+	/// by LogData::RemoveSink(). Batches posted once stopped are dropped.
+	void Stop();
+
+	/// Queue a batch for the sink thread. Function call is thread-safe.
+	/// @param[in] batch - the records to write
+	/// @return True if queued. False if dropped because the bounded buffer is full.
+	bool Post(const Batch& batch);
+
+	/// Set the flush policy. Call before Start().
+	/// @param[in] policy - the flush policy
+	void SetFlushPolicy(const FlushPolicy& policy) { m_flushPolicy = policy; }
+
+	/// Get a snapshot of the sink counters. Function call is thread-safe.
+	/// @return The counters.
+	Stats GetStats() const;
+
+	/// Get the sink thread name
+	const std::string& GetName() const { return m_name; }
+
+protected:
+	/// Write one text record. Called on the sink thread.
+	/// @param[in] record - the record without a line terminator
+	/// @return True if success.
+	virtual bool WriteRecord(std::string_view record) = 0;
+
+	/// Flush the records written since the last flush. Called on the sink thread.
+	/// @return True if success.
+	virtual bool FlushRecords() { return true; }
+
+private:
+	LogSink(const LogSink&) = delete;
+	LogSink& operator=(const LogSink&) = delete;
+
+	/// Write a batch. Invoked on the sink thread.
+	/// @param[in] batch - the records to write
+	void Process(Batch batch);
+
+	/// Flush the sink if records are unflushed. Called on the sink thread.
+	void Flush();
+
+	const std::string m_name;
+	const size_t m_maxRecords;
+	FlushPolicy m_flushPolicy;
+
+	WorkerThread m_thread;
+
+	/// Flushes records left unflushed for FlushPolicy::interval
+	Timer m_flushTimer;
+
+	std::atomic<bool> m_running;
+
+	/// Records written since the last flush. Only accessed by the sink thread.
+	size_t m_unflushed = 0;
+
+	/// Text rendered from a binary or stamped record. Only accessed by the sink thread.
+	std::string m_text;
+
+	/// Renders record timestamps. Only accessed by the sink thread.
+	LogTimestamp::Formatter m_formatter;
+
+	std::atomic<size_t> m_queued;
+	std::atomic<uint64_t> m_written;
+	std::atomic<uint64_t> m_dropped;
+	std::atomic<uint64_t> m_failed;
+};
+
+/// @brief Writes records to a text file kept open by a LogFile
+class LogFileSink : public LogSink
+{
+public:
+	/// Constructor
+	/// @param[in] fileName - the file to append records to
+	/// @param[in] maxRecords - the bounded buffer capacity in records
+	LogFileSink(const std::string& fileName, size_t maxRecords = DEFAULT_MAX_RECORDS);
+
+	/// Destructor
+	~LogFileSink() override;
+
+protected:
+	bool WriteRecord(std::string_view record) override;
+	bool FlushRecords() override;
+
+private:
+	const std::string m_fileName;
+	LogFile m_file;
+};
+
+/// @brief Writes records to a stream such as std::cout
+class LogStreamSink : public LogSink
+{
+public:
+	/// Constructor
+	/// @param[in] stream - the stream to write. Must outlive the sink.
+	/// @param[in] maxRecords - the bounded buffer capacity in records
+	LogStreamSink(std::ostream& stream, size_t maxRecords = DEFAULT_MAX_RECORDS);
+
+	/// Destructor
+	~LogStreamSink() override;
+
+protected:
+	bool WriteRecord(std::string_view record) override;
+	bool FlushRecords() override;
+
+private:
+	std::ostream& m_stream;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#include "LogTimestamp.h"
+#include "LogRecord.h"
+#include "LogContext.h"
+#include <mutex>
+#include <ctime>
+
+using namespace std;
+using namespace std::chrono;
+
+/// Baseline the tick rate is measured over before it is refined
+static const int64_t CALIBRATE_NS = 1000000;
+
+/// Minimum time between tick rate refinements
+static const int64_t REFINE_NS = 1000000000;
+
+//----------------------------------------------------------------------------
+// SteadyNs
+//----------------------------------------------------------------------------
+static int64_t SteadyNs()
+{
+	return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+//----------------------------------------------------------------------------
+// GetCalibration
+//----------------------------------------------------------------------------
+LogTimestamp::Calibration LogTimestamp::GetCalibration()
+{
+	// Calibration and the steady time its tick was captured at
+	struct State
+	{
+		Calibration calibration;
+		int64_t steady0;
+		int64_t refined;
+	};
+	static std::mutex lock;
+	static State state = []() {
+		State s;
+		s.calibration.tick0 = Now();
+		s.steady0 = SteadyNs();
+		s.calibration.system0 = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+		s.refined = s.steady0;
+#ifdef LOGGER_TSC
+		// Initial rate estimate. Refined over a growing baseline below.
+		int64_t steady;
+		while ((steady = SteadyNs()) - s.steady0 < CALIBRATE_NS)
+		{
+		}
+		s.calibration.nsPerTick = (double)(steady - s.steady0) / (double)(Now() - s.calibration.tick0);
+#endif
+		return s;
+	}();
+
+	const std::lock_guard<std::mutex> guard(lock);
+#ifdef LOGGER_TSC
+	int64_t steady = SteadyNs();
+	if (steady - state.refined >= REFINE_NS)
+	{
+		state.calibration.nsPerTick = (double)(steady - state.steady0) / (double)(Now() - state.calibration.tick0);
+		state.refined = steady;
+	}
+#endif
+	return state.calibration;
+}
+
+//----------------------------------------------------------------------------
+// Render
+//----------------------------------------------------------------------------
+std::string_view LogTimestamp::Formatter::Render(std::string_view record, std::string& text)
+{
+	// The record context is only reported by structured output
+	uint64_t tick;
+	std::string_view body = LogContext::Strip(Split(record, tick));
+	bool stamped = IsStamped(record);
+	if (!stamped && !LogRecord::IsBinary(body))
+		return body;
+
+	text.clear();
+	if (stamped)
+		AppendTime(tick, text);
+	if (LogRecord::IsBinary(body))
+		LogRecord::Render(body, text);
+	else
+		text.append(body.data(), body.size());
+	return text;
+}
+
+//----------------------------------------------------------------------------
+// AppendTime
+//----------------------------------------------------------------------------
+void LogTimestamp::Formatter::AppendTime(uint64_t tick, std::string& text)
+{
+	int64_t ns = ToSystemNs(tick, m_calibration);
+	int64_t second = ns >= 0 ? ns / 1000000000 : (ns - 999999999) / 1000000000;
+
+	// Full calendar formatting and a calibration refresh only once per second
+	if (second != m_second)
+	{
+		m_calibration = GetCalibration();
+		ns = ToSystemNs(tick, m_calibration);
+		second = ns >= 0 ? ns / 1000000000 : (ns - 999999999) / 1000000000;
+
+		time_t t = (time_t)second;
+		tm utc;
+#ifdef WIN32
+		gmtime_s(&utc, &t);
+#else
+		gmtime_r(&t, &utc);
+#endif
+		m_prefixLen = strftime(m_prefix, sizeof(m_prefix), "%Y-%m-%dT%H:%M:%S", &utc);
+		m_second = second;
+	}
+
+	// ".uuuuuuZ "
+	m_timeNs = ns;
+	char fraction[9] = { '.', 0, 0, 0, 0, 0, 0, 'Z', ' ' };
+	uint32_t us = (uint32_t)((ns - second * 1000000000) / 1000);
+	for (int i = 6; i >= 1; i--, us /= 10)
+		fraction[i] = (char)('0' + us % 10);
+	text.append(m_prefix, m_prefixLen);
+	text.append(fraction, sizeof(fraction));
+}
@@ -0,0 +1,160 @@
+#ifndef _LOG_TIMESTAMP_H
+#define _LOG_TIMESTAMP_H
+
+#include <string>
+#include <string_view>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(LOGGER_NO_TSC) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define LOGGER_TSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+/// @brief LogTimestamp stamps records with a raw tick count when written and 
+/// converts the tick to human readable UTC time only when the record is rendered.
+///
+/// @details The tick is the CPU time stamp counter on x86, calibrated against the
+/// steady and system clocks, or steady clock nanoseconds elsewhere. Define
+/// LOGGER_NO_TSC to always use the steady clock, e.g. on hardware without an 
+/// invariant TSC. A stamped record is the TIMESTAMP_TAG byte, the tick in host 
+/// byte order and the original text or binary record.
+class LogTimestamp
+{
+public:
+	/// First byte of a stamped record. Text records must not start with this byte.
+	static const char TIMESTAMP_TAG = '\x01';
+
+	/// Size of the tag and tick preceding the original record
+	static const size_t PREFIX_SIZE = 1 + sizeof(uint64_t);
+
+	/// Read the tick counter. A few nanoseconds and no system call.
+	/// @return The current tick.
+	static uint64_t Now()
+	{
+#ifdef LOGGER_TSC
+		return __rdtsc();
+#else
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	/// Prepend the current tick to a record
+	/// @param[in,out] record - the record to stamp
+	static void Stamp(std::string& record)
+	{
+		char prefix[PREFIX_SIZE];
+		StampPrefix(prefix);
+		record.insert(0, prefix, PREFIX_SIZE);
+	}
+
+	/// Write the current tick into space left for it ahead of a record, so a 
+	/// record built with room for the prefix is stamped without moving it
+	/// @param[out] prefix - the first PREFIX_SIZE bytes of the record
+	static void StampPrefix(char* prefix)
+	{
+		uint64_t tick = Now();
+		prefix[0] = TIMESTAMP_TAG;
+		memcpy(prefix + 1, &tick, sizeof(tick));
+	}
+
+	/// Check if a record is stamped
+	/// @param[in] record - the record
+	/// @return True if stamped.
+	static bool IsStamped(std::string_view record)
+	{
+		return record.size() >= PREFIX_SIZE && record[0] == TIMESTAMP_TAG;
+	}
+
+	/// Split a stamped record into its tick and the original record
+	/// @param[in] record - the record
+	/// @param[out] tick - the tick, or 0 if the record is not stamped
+	/// @return The original record.
+	static std::string_view Split(std::string_view record, uint64_t& tick)
+	{
+		tick = 0;
+		if (!IsStamped(record))
+			return record;
+		memcpy(&tick, record.data() + 1, sizeof(tick));
+		return record.substr(PREFIX_SIZE);
+	}
+
+	/// Tick to system time conversion
+	struct Calibration
+	{
+		/// A tick and the system time in nanoseconds captured together
+		uint64_t tick0 = 0;
+		int64_t system0 = 0;
+
+		/// Nanoseconds per tick
+		double nsPerTick = 1.0;
+	};
+
+	/// Get the current tick conversion. The TSC rate is refined over a growing
+	/// baseline at most once per second. Function call is thread-safe.
+	/// @return The calibration.
+	static Calibration GetCalibration();
+
+	/// Convert a tick to nanoseconds since the system clock epoch
+	/// @param[in] tick - the tick
+	/// @param[in] calibration - the conversion from GetCalibration()
+	/// @return The system time in nanoseconds.
+	static int64_t ToSystemNs(uint64_t tick, const Calibration& calibration)
+	{
+		// Records stamped before the calibration have ticks earlier than tick0
+		double elapsed = (double)(int64_t)(tick - calibration.tick0) * calibration.nsPerTick;
+		return calibration.system0 + (int64_t)elapsed;
+	}
+
+	/// Convert a tick to nanoseconds since the system clock epoch. Function call
+	/// is thread-safe.
+	/// @param[in] tick - the tick
+	/// @return The system time in nanoseconds.
+	static int64_t ToSystemNs(uint64_t tick) { return ToSystemNs(tick, GetCalibration()); }
+
+	/// @brief Renders records to text. The "YYYY-MM-DDTHH:MM:SS" prefix and the 
+	/// calibration are cached for the current second so most records only format
+	/// the microseconds, without a lock or clock read. Not thread-safe. Each 
+	/// rendering thread owns a Formatter.
+	class Formatter
+	{
+	public:
+		/// Render a record to text. Stamped records are prefixed with their UTC 
+		/// time and binary records are rendered with LogRecord::Render().
+		/// @param[in] record - the record
+		/// @param[out] text - holds the rendered text if the record is not plain text
+		/// @return The record text, either the record itself or a view of text.
+		std::string_view Render(std::string_view record, std::string& text);
+
+		/// Append "YYYY-MM-DDTHH:MM:SS.uuuuuuZ " for a tick
+		/// @param[in] tick - the tick
+		/// @param[out] text - the time is appended
+		void AppendTime(uint64_t tick, std::string& text);
+
+		/// Get the time of the last stamp rendered
+		/// @return The system time in nanoseconds.
+		int64_t GetTimeNs() const { return m_timeNs; }
+
+	private:
+		/// Calibration refreshed when the second changes
+		Calibration m_calibration;
+
+		/// The second of the cached prefix
+		int64_t m_second = INT64_MIN;
+
+		/// "YYYY-MM-DDTHH:MM:SS" of m_second
+		char m_prefix[32] = "";
+		size_t m_prefixLen = 0;
+
+		/// System time of the last stamp rendered
+		int64_t m_timeNs = 0;
+	};
+};
+
+#endif
@@ -0,0 +1,392 @@
+#include "LogUring.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef LOGGER_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+using namespace std;
+
+/// Completion tag of the fsync operation. Writes are tagged with their buffer index.
+static const uint64_t SYNC_TAG = UINT64_MAX;
+
+/// Submission queue entries. Every buffer write and an fsync fit at once.
+static const unsigned QUEUE_DEPTH = 8;
+
+//----------------------------------------------------------------------------
+// ~LogUring
+//----------------------------------------------------------------------------
+LogUring::~LogUring()
+{
+	Close();
+}
+
+#ifdef LOGGER_IO_URING
+
+//----------------------------------------------------------------------------
+// IsSupported
+//----------------------------------------------------------------------------
+bool LogUring::IsSupported()
+{
+	// Seccomp profiles and sysctls may refuse io_uring on a capable kernel
+	static const bool supported = []() {
+		io_uring_params params;
+		memset(&params, 0, sizeof(params));
+		int fd = (int)syscall(__NR_io_uring_setup, 1, &params);
+		if (fd < 0)
+			return false;
+		close(fd);
+		return true;
+	}();
+	return supported;
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+bool LogUring::Open(const std::string& fileName, size_t bufferSize, bool append)
+{
+	Close();
+	if (bufferSize == 0)
+		bufferSize = LogFile::DEFAULT_BUFFER_SIZE;
+
+	m_fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (append ? 0 : O_TRUNC), 0644);
+	if (m_fd < 0)
+		return false;
+	off_t end = lseek(m_fd, 0, SEEK_END);
+	m_size = end > 0 ? (size_t)end : 0;
+
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	m_ringFd = (int)syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params);
+	if (m_ringFd < 0)
+	{
+		Release();
+		return false;
+	}
+
+	// Map the submission and completion rings, shared in one mapping on newer kernels
+	m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single)
+		m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+	m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQ_RING);
+	if (m_sqRing == MAP_FAILED)
+	{
+		m_sqRing = nullptr;
+		Release();
+		return false;
+	}
+	m_cqRing = single ? m_sqRing : mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, 
+		m_ringFd, IORING_OFF_CQ_RING);
+	m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	m_sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ringFd, IORING_OFF_SQES);
+	if (m_cqRing == MAP_FAILED || m_sqes == MAP_FAILED)
+	{
+		if (m_cqRing == MAP_FAILED)
+			m_cqRing = nullptr;
+		if (m_sqes == MAP_FAILED)
+			m_sqes = nullptr;
+		Release();
+		return false;
+	}
+
+	char* sq = static_cast<char*>(m_sqRing);
+	char* cq = static_cast<char*>(m_cqRing);
+	m_sqHead = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+	m_sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+	m_sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+	m_sqEntries = params.sq_entries;
+	m_sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+	m_cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+	m_cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+	m_cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+	m_cqes = cq + params.cq_off.cqes;
+
+	// Register the file and the buffers so each write skips the file table
+	// lookup and the page pinning
+	m_bufferSize = bufferSize;
+	m_memory = std::unique_ptr<char[]>(new char[bufferSize * BUFFER_COUNT]);
+	iovec iov[BUFFER_COUNT];
+	for (size_t i = 0; i < BUFFER_COUNT; i++)
+	{
+		m_buffers[i] = Buffer();
+		m_buffers[i].data = m_memory.get() + i * bufferSize;
+		iov[i].iov_base = m_buffers[i].data;
+		iov[i].iov_len = bufferSize;
+	}
+	if (syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_FILES, &m_fd, 1) != 0 ||
+		syscall(__NR_io_uring_register, m_ringFd, IORING_REGISTER_BUFFERS, iov, BUFFER_COUNT) != 0)
+	{
+		Release();
+		return false;
+	}
+
+	m_current = 0;
+	m_buffers[0].offset = m_size;
+	m_queued = 0;
+	m_inFlight = 0;
+	m_failed = false;
+	m_lastSync = std::chrono::steady_clock::now();
+	m_openTime = m_lastSync;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void LogUring::Close()
+{
+	if (!IsOpen())
+		return;
+	Flush();
+	Release();
+}
+
+//----------------------------------------------------------------------------
+// Release
+//----------------------------------------------------------------------------
+void LogUring::Release()
+{
+	// Closing the ring unregisters the file and buffers
+	if (m_sqes)
+		munmap(m_sqes, m_sqesSize);
+	if (m_cqRing && m_cqRing != m_sqRing)
+		munmap(m_cqRing, m_cqRingSize);
+	if (m_sqRing)
+		munmap(m_sqRing, m_sqRingSize);
+	m_sqes = m_cqRing = m_sqRing = nullptr;
+	if (m_ringFd >= 0)
+		close(m_ringFd);
+	if (m_fd >= 0)
+		close(m_fd);
+	m_ringFd = m_fd = -1;
+	m_memory = nullptr;
+	m_size = 0;
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+bool LogUring::Write(const char* data, size_t size)
+{
+	if (!IsOpen())
+		return false;
+
+	while (size > 0)
+	{
+		Buffer& buffer = m_buffers[m_current];
+		size_t len = std::min(size, m_bufferSize - buffer.used);
+		memcpy(buffer.data + buffer.used, data, len);
+		buffer.used += len;
+		m_size += len;
+		data += len;
+		size -= len;
+
+		// Start writing the full buffer while the next one fills
+		if (buffer.used == m_bufferSize)
+		{
+			if (!QueueWrite(m_current, false) || !Submit(0) || !NextBuffer())
+				return false;
+		}
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Flush
+//----------------------------------------------------------------------------
+bool LogUring::Flush(bool forceSync)
+{
+	if (!IsOpen())
+		return false;
+
+	bool sync = forceSync || m_syncPolicy == LogFile::SyncPolicy::PER_FLUSH ||
+		(m_syncPolicy == LogFile::SyncPolicy::INTERVAL && 
+			std::chrono::steady_clock::now() - m_lastSync >= m_syncInterval);
+	Buffer& buffer = m_buffers[m_current];
+	bool pending = buffer.used > buffer.written;
+	if (pending && !QueueWrite(m_current, sync))
+		return false;
+	if (sync)
+	{
+		if (!QueueSync())
+			return false;
+		m_lastSync = std::chrono::steady_clock::now();
+	}
+
+	// One system call submits the batch and waits for it. Short writes are 
+	// resubmitted by Reap() and waited for in turn.
+	while (m_queued > 0 || m_inFlight > 0)
+	{
+		if (!Submit(m_queued + m_inFlight))
+			return false;
+	}
+
+	// The current buffer is empty and continues at the end of the file
+	buffer.used = buffer.written = 0;
+	buffer.offset = m_size;
+
+	bool success = !m_failed;
+	m_failed = false;
+	return success;
+}
+
+//----------------------------------------------------------------------------
+// QueueWrite
+//----------------------------------------------------------------------------
+bool LogUring::QueueWrite(size_t index, bool link)
+{
+	unsigned tail = *m_sqTail;
+	unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+	if (tail - head >= m_sqEntries)
+		return false;
+
+	Buffer& buffer = m_buffers[index];
+	unsigned slot = tail & m_sqMask;
+	io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + slot;
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITE_FIXED;
+	sqe->flags = IOSQE_FIXED_FILE | (link ? IOSQE_IO_LINK : 0);
+	sqe->fd = 0;
+	sqe->addr = (uint64_t)(uintptr_t)(buffer.data + buffer.written);
+	sqe->len = (uint32_t)(buffer.used - buffer.written);
+	sqe->off = buffer.offset + buffer.written;
+	sqe->buf_index = (uint16_t)index;
+	sqe->user_data = index;
+	m_sqArray[slot] = slot;
+	__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+	buffer.inFlight = true;
+	m_queued++;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// QueueSync
+//----------------------------------------------------------------------------
+bool LogUring::QueueSync()
+{
+	unsigned tail = *m_sqTail;
+	unsigned head = __atomic_load_n(m_sqHead, __ATOMIC_ACQUIRE);
+	if (tail - head >= m_sqEntries)
+		return false;
+
+	// Drain so the sync also covers buffers submitted before this flush
+	unsigned slot = tail & m_sqMask;
+	io_uring_sqe* sqe = static_cast<io_uring_sqe*>(m_sqes) + slot;
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_FSYNC;
+	sqe->flags = IOSQE_FIXED_FILE | IOSQE_IO_DRAIN;
+	sqe->fd = 0;
+	sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+	sqe->user_data = SYNC_TAG;
+	m_sqArray[slot] = slot;
+	__atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+
+	m_queued++;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Submit
+//----------------------------------------------------------------------------
+bool LogUring::Submit(unsigned waitFor)
+{
+	waitFor = std::min(waitFor, m_queued + m_inFlight);
+	while (m_queued > 0 || waitFor > 0)
+	{
+		int submitted = (int)syscall(__NR_io_uring_enter, m_ringFd, m_queued, waitFor,
+			waitFor ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+		if (submitted < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+			{
+				Reap();
+				continue;
+			}
+			m_failed = true;
+			return false;
+		}
+		m_queued -= (unsigned)submitted;
+		m_inFlight += (unsigned)submitted;
+
+		unsigned before = m_inFlight;
+		Reap();
+		unsigned completed = before - std::min(before, m_inFlight);
+		waitFor -= std::min(waitFor, completed);
+		if (waitFor == 0 && m_queued == 0)
+			break;
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Reap
+//----------------------------------------------------------------------------
+void LogUring::Reap()
+{
+	unsigned head = *m_cqHead;
+	unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++)
+	{
+		const io_uring_cqe* cqe = static_cast<const io_uring_cqe*>(m_cqes) + (head & m_cqMask);
+		m_inFlight--;
+		if (cqe->user_data == SYNC_TAG)
+		{
+			if (cqe->res < 0)
+				m_failed = true;
+			continue;
+		}
+
+		Buffer& buffer = m_buffers[cqe->user_data];
+		buffer.inFlight = false;
+		if (cqe->res <= 0)
+		{
+			m_failed = true;
+			continue;
+		}
+
+		// Write the remainder of a short write
+		buffer.written += (size_t)cqe->res;
+		if (buffer.written < buffer.used && !QueueWrite((size_t)cqe->user_data, false))
+			m_failed = true;
+	}
+	__atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+}
+
+//----------------------------------------------------------------------------
+// NextBuffer
+//----------------------------------------------------------------------------
+bool LogUring::NextBuffer()
+{
+	m_current = (m_current + 1) % BUFFER_COUNT;
+	Buffer& buffer = m_buffers[m_current];
+	while (buffer.inFlight)
+	{
+		if (!Submit(1))
+			return false;
+	}
+	buffer.used = buffer.written = 0;
+	buffer.offset = m_size;
+	return !m_failed;
+}
+
+#else
+
+bool LogUring::IsSupported() { return false; }
+bool LogUring::Open(const std::string&, size_t, bool) { return false; }
+void LogUring::Close() { }
+void LogUring::Release() { }
+bool LogUring::Write(const char*, size_t) { return false; }
+bool LogUring::Flush(bool) { return false; }
+
+#endif
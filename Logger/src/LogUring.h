@@ -0,0 +1,164 @@
+#ifndef _LOG_URING_H
+#define _LOG_URING_H
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+#include "LogFile.h"
+
+/// @brief LogUring is a long-lived log file sink written with Linux io_uring. 
+/// Writes are collected in buffers registered with the kernel. A full buffer is
+/// submitted at once while the next one fills, and Flush() submits the last 
+/// buffer linked to an fsync when the sync policy requires one, then reaps the 
+/// completions. A flush window costs one io_uring_enter system call instead of
+/// a write(2) per buffer and an fsync(2). LogUring is not thread-safe.
+///
+/// @details Available when built with LOGGER_IO_URING. Otherwise, or when the 
+/// kernel refuses io_uring, Open() fails and LogWriter falls back to LogFile.
+class LogUring
+{
+public:
+	/// Registered buffers. One fills while the others are written.
+	static const size_t BUFFER_COUNT = 4;
+
+	/// Constructor
+	LogUring() = default;
+
+	/// Destructor
+	~LogUring();
+
+	/// Check if io_uring is usable by this build and kernel
+	/// @return True if supported.
+	static bool IsSupported();
+
+	/// Open the file, create the ring and register the file and buffers. Any
+	/// previously opened file is closed first.
+	/// @param[in] fileName - the file to open
+	/// @param[in] bufferSize - the size of each registered buffer in bytes
+	/// @param[in] append - true to append to the file, false to truncate it
+	/// @return True if success.
+	bool Open(const std::string& fileName, size_t bufferSize = LogFile::DEFAULT_BUFFER_SIZE, bool append = true);
+
+	/// Flush and close the file
+	void Close();
+
+	/// Check if the file is open
+	/// @return True if the file is open.
+	bool IsOpen() const { return m_ringFd >= 0; }
+
+	/// Copy data into the registered buffers. A full buffer is submitted.
+	/// @param[in] data - the data to write
+	/// @param[in] size - the data size in bytes
+	/// @return True if success.
+	bool Write(const char* data, size_t size);
+
+	/// Submit buffered data, linked to an fsync if the sync policy requires one,
+	/// and wait for every submitted operation to complete
+	/// @param[in] forceSync - true to sync regardless of the sync policy
+	/// @return True if all writes and the sync succeeded.
+	bool Flush(bool forceSync = false);
+
+	/// Set the sync policy
+	/// @param[in] policy - the sync policy
+	/// @param[in] interval - the minimum time between syncs for SyncPolicy::INTERVAL
+	void SetSyncPolicy(LogFile::SyncPolicy policy, std::chrono::milliseconds interval = std::chrono::milliseconds(0))
+	{
+		m_syncPolicy = policy;
+		m_syncInterval = interval;
+	}
+
+	/// Get the file size including data not yet flushed
+	/// @return The file size in bytes.
+	size_t GetSize() const { return m_size; }
+
+	/// Get the time the file was opened
+	/// @return The open time.
+	std::chrono::steady_clock::time_point GetOpenTime() const { return m_openTime; }
+
+private:
+	LogUring(const LogUring&) = delete;
+	LogUring& operator=(const LogUring&) = delete;
+
+	/// A registered buffer
+	struct Buffer
+	{
+		char* data = nullptr;
+
+		/// File offset of the first byte
+		uint64_t offset = 0;
+
+		/// Bytes copied in and bytes the kernel has written
+		size_t used = 0;
+		size_t written = 0;
+
+		bool inFlight = false;
+	};
+
+	/// Queue a fixed buffer write of the unwritten part of a buffer
+	/// @param[in] index - the buffer index
+	/// @param[in] link - true to link the next queued operation to this write
+	/// @return True if queued.
+	bool QueueWrite(size_t index, bool link);
+
+	/// Queue an fsync that starts once all earlier operations complete
+	/// @return True if queued.
+	bool QueueSync();
+
+	/// Submit the queued operations and wait for completions
+	/// @param[in] waitFor - the number of completions to wait for
+	/// @return True if success.
+	bool Submit(unsigned waitFor);
+
+	/// Process the available completions
+	void Reap();
+
+	/// Make the next buffer current, waiting for its write to complete
+	/// @return True if success.
+	bool NextBuffer();
+
+	/// Release the ring, buffers and file
+	void Release();
+
+	int m_fd = -1;
+	int m_ringFd = -1;
+
+	/// Mapped ring memory
+	void* m_sqRing = nullptr;
+	size_t m_sqRingSize = 0;
+	void* m_cqRing = nullptr;
+	size_t m_cqRingSize = 0;
+	void* m_sqes = nullptr;
+	size_t m_sqesSize = 0;
+
+	/// Ring fields within the mapped memory
+	unsigned* m_sqHead = nullptr;
+	unsigned* m_sqTail = nullptr;
+	unsigned m_sqMask = 0;
+	unsigned m_sqEntries = 0;
+	unsigned* m_sqArray = nullptr;
+	unsigned* m_cqHead = nullptr;
+	unsigned* m_cqTail = nullptr;
+	unsigned m_cqMask = 0;
+	void* m_cqes = nullptr;
+
+	/// Operations queued but not yet submitted, and submitted but not completed
+	unsigned m_queued = 0;
+	unsigned m_inFlight = 0;
+
+	std::unique_ptr<char[]> m_memory;
+	size_t m_bufferSize = 0;
+	Buffer m_buffers[BUFFER_COUNT];
+	size_t m_current = 0;
+
+	/// True if an operation failed since the last Flush()
+	bool m_failed = false;
+
+	LogFile::SyncPolicy m_syncPolicy = LogFile::SyncPolicy::NONE;
+	std::chrono::milliseconds m_syncInterval = std::chrono::milliseconds(0);
+	std::chrono::steady_clock::time_point m_lastSync;
+	std::chrono::steady_clock::time_point m_openTime;
+	size_t m_size = 0;
+};
+
+#endif
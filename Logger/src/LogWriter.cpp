@@ -0,0 +1,449 @@
+#include "LogWriter.h"
+#include "LogTimestamp.h"
+#include <fstream>
+#include <cstdio>
+#include <type_traits>
+
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// LogWriter
+//----------------------------------------------------------------------------
+LogWriter::LogWriter(const std::string& logFileName, const std::string& hwmFileName, const std::string& segmentBaseName) :
+	m_logFileName(logFileName), m_hwmFileName(hwmFileName), m_segmentBaseName(segmentBaseName), m_thread(nullptr),
+	THREAD_NAME("LogWriterThread")
+{
+}
+
+//----------------------------------------------------------------------------
+// ~LogWriter
+//----------------------------------------------------------------------------
+LogWriter::~LogWriter()
+{
+	if (!m_thread)
+		return;
+
+	// Let any write in progress complete then exit the I/O thread
+	{
+		std::unique_lock<std::mutex> lk(m_mutex);
+		m_cv.wait(lk, [this]() { return !m_busy; });
+		m_exit = true;
+		m_cv.notify_all();
+	}
+
+	m_thread->join();
+	m_thread = nullptr;
+}
+
+//----------------------------------------------------------------------------
+// LoadHighWaterMark
+//----------------------------------------------------------------------------
+uint64_t LogWriter::LoadHighWaterMark()
+{
+	std::ifstream hwmFile(m_hwmFileName);
+	uint64_t highWaterMark = 0;
+	if (hwmFile >> highWaterMark)
+		m_highWaterMark = highWaterMark;
+	return m_highWaterMark;
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+LogWriter::Result LogWriter::Write(const LogBuffer& buffer)
+{
+	// The log files are owned by the I/O thread until its write completes
+	WaitIdle();
+	return WriteBuffer(buffer);
+}
+
+//----------------------------------------------------------------------------
+// WriteAsync
+//----------------------------------------------------------------------------
+void LogWriter::WriteAsync(const LogBuffer& buffer, CompleteCallback callback, bool forceSync)
+{
+	if (!m_thread)
+	{
+		m_thread = std::unique_ptr<std::thread>(new thread(&LogWriter::Process, this));
+
+#ifdef WIN32
+		// Set the thread name so it shows in the Visual Studio Debug Location toolbar
+		std::wstring wstr(THREAD_NAME.begin(), THREAD_NAME.end());
+		SetThreadDescription(m_thread->native_handle(), wstr.c_str());
+#endif
+	}
+
+	// Hand the buffer to the I/O thread
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_cv.wait(lk, [this]() { return !m_busy; });
+	m_pending = &buffer;
+	m_callback = std::move(callback);
+	m_forceSync = forceSync;
+	m_busy = true;
+	m_cv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// WaitIdle
+//----------------------------------------------------------------------------
+void LogWriter::WaitIdle()
+{
+	std::unique_lock<std::mutex> lk(m_mutex);
+	m_cv.wait(lk, [this]() { return !m_busy; });
+}
+
+//----------------------------------------------------------------------------
+// SetBufferSize
+//----------------------------------------------------------------------------
+void LogWriter::SetBufferSize(size_t bufferSize)
+{
+	WaitIdle();
+	m_bufferSize = bufferSize;
+}
+
+//----------------------------------------------------------------------------
+// SetSyncPolicy
+//----------------------------------------------------------------------------
+void LogWriter::SetSyncPolicy(LogFile::SyncPolicy policy, std::chrono::milliseconds interval)
+{
+	WaitIdle();
+	m_logFile.SetSyncPolicy(policy, interval);
+	m_uring.SetSyncPolicy(policy, interval);
+	m_segment.SetSyncPolicy(policy, interval);
+	m_hwmFile.SetSyncPolicy(policy, interval);
+}
+
+//----------------------------------------------------------------------------
+// SetWriteMode
+//----------------------------------------------------------------------------
+void LogWriter::SetWriteMode(LogFile::WriteMode mode, size_t preallocation)
+{
+	WaitIdle();
+	m_logFile.Close();
+	m_index.Close();
+	m_logFile.SetWriteMode(mode);
+	m_logFile.SetPreallocation(preallocation);
+}
+
+//----------------------------------------------------------------------------
+// SetChecksums
+//----------------------------------------------------------------------------
+void LogWriter::SetChecksums(bool enable)
+{
+	WaitIdle();
+	m_checksums = enable;
+}
+
+//----------------------------------------------------------------------------
+// SetEscape
+//----------------------------------------------------------------------------
+void LogWriter::SetEscape(bool enable)
+{
+	WaitIdle();
+	m_escape = enable;
+}
+
+//----------------------------------------------------------------------------
+// SetOutputFormat
+//----------------------------------------------------------------------------
+void LogWriter::SetOutputFormat(OutputFormat format)
+{
+	WaitIdle();
+	m_outputFormat = format;
+}
+
+//----------------------------------------------------------------------------
+// Prepare
+//----------------------------------------------------------------------------
+void LogWriter::Prepare(size_t fileExtent, bool warmUp)
+{
+	WaitIdle();
+	if (fileExtent > 0)
+	{
+		// Extents are reserved as the file opens
+		if (m_backend == Backend::URING)
+			OpenLogFile(m_uring);
+		else if (m_backend == Backend::FILE)
+		{
+			m_logFile.SetPreallocation(fileExtent);
+			OpenLogFile(m_logFile);
+		}
+	}
+
+	if (warmUp)
+	{
+		std::string record = "warm up";
+		LogTimestamp::Stamp(record);
+		m_text.reserve(256);
+		m_formatter.Render(record, m_text);
+	}
+}
+
+//----------------------------------------------------------------------------
+// SetRotationPolicy
+//----------------------------------------------------------------------------
+void LogWriter::SetRotationPolicy(const RotationPolicy& policy)
+{
+	WaitIdle();
+	m_rotationPolicy = policy;
+}
+
+//----------------------------------------------------------------------------
+// RotateLogFile
+//----------------------------------------------------------------------------
+void LogWriter::RotateLogFile()
+{
+	m_logFile.Close();
+	m_uring.Close();
+	m_index.Close();
+
+	// Find the next rotation index not used by a plain or compressed file
+	std::string rotatedName;
+	for (uint32_t index = 1; ; index++)
+	{
+		char suffix[16];
+		snprintf(suffix, sizeof(suffix), ".%06u", index);
+		rotatedName = m_logFileName + suffix;
+		std::ifstream plain(rotatedName);
+		std::ifstream compressed(rotatedName + LogCompressor::SUFFIX);
+		if (!plain && !compressed)
+			break;
+	}
+
+	if (rename(m_logFileName.c_str(), rotatedName.c_str()) == 0)
+	{
+		// The index stays uncompressed next to its log file
+		std::string indexName = m_logFileName + LogIndex::SUFFIX;
+		rename(indexName.c_str(), (rotatedName + LogIndex::SUFFIX).c_str());
+		m_compressor.Compress(rotatedName);
+	}
+}
+
+//----------------------------------------------------------------------------
+// SetBackend
+//----------------------------------------------------------------------------
+void LogWriter::SetBackend(Backend backend, size_t segmentSize)
+{
+	WaitIdle();
+	m_logFile.Close();
+	m_uring.Close();
+	m_index.Close();
+	m_segment.Close();
+
+	// Fall back to the buffered file when the build or kernel lacks io_uring
+	if (backend == Backend::URING && !LogUring::IsSupported())
+		backend = Backend::FILE;
+	m_backend = backend;
+	if (backend == Backend::MEMORY && !m_memory)
+		m_memory.reset(new LogMemory());
+
+	// The closed segment is compressed in the background
+	m_closedSegments.clear();
+	m_segment.TakeClosedSegments(m_closedSegments);
+	for (const std::string& fileName : m_closedSegments)
+		m_compressor.Compress(fileName);
+	m_segmentSize = segmentSize;
+}
+
+//----------------------------------------------------------------------------
+// ClearMemory
+//----------------------------------------------------------------------------
+void LogWriter::ClearMemory()
+{
+	WaitIdle();
+	if (m_memory)
+		m_memory->Clear();
+}
+
+//----------------------------------------------------------------------------
+// WriteBuffer
+//----------------------------------------------------------------------------
+LogWriter::Result LogWriter::WriteBuffer(const LogBuffer& buffer, bool forceSync)
+{
+	auto startTime = std::chrono::high_resolution_clock::now();
+	Result result;
+
+	bool success = false;
+	if (m_backend == Backend::SEGMENT)
+	{
+		// Open the segment once and keep it open
+		if (!m_segment.IsOpen())
+			m_segment.Open(m_segmentBaseName, m_segmentSize);
+		success = WriteRecords(m_segment, buffer, result, forceSync, nullptr);
+
+		// Segments filled by this write are compressed in the background
+		m_closedSegments.clear();
+		m_segment.TakeClosedSegments(m_closedSegments);
+		for (const std::string& fileName : m_closedSegments)
+			m_compressor.Compress(fileName);
+	}
+	else if (m_backend == Backend::MEMORY)
+		success = WriteRecords(*m_memory, buffer, result, forceSync, nullptr);
+	else if (m_backend == Backend::URING)
+		success = WriteLogFile(m_uring, buffer, result, forceSync);
+	else
+		success = WriteLogFile(m_logFile, buffer, result, forceSync);
+	if (!success)
+		return result;
+
+	// Records kept in memory are not durable so the persisted mark is unchanged
+	m_highWaterMark += result.records;
+	if (result.records > 0 && m_backend != Backend::MEMORY)
+		SaveHighWaterMark();
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+	result.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime);
+	result.success = true;
+	return result;
+}
+
+//----------------------------------------------------------------------------
+// OpenLogFile
+//----------------------------------------------------------------------------
+template <class Sink>
+void LogWriter::OpenLogFile(Sink& sink)
+{
+	if (!sink.IsOpen() && sink.Open(m_logFileName, m_bufferSize))
+		m_index.Open(m_logFileName, sink.GetSize());
+}
+
+//----------------------------------------------------------------------------
+// WriteLogFile
+//----------------------------------------------------------------------------
+template <class Sink>
+bool LogWriter::WriteLogFile(Sink& sink, const LogBuffer& buffer, Result& result, bool forceSync)
+{
+	// Open the log file once and keep it open
+	OpenLogFile(sink);
+	bool success = WriteRecords(sink, buffer, result, forceSync, &m_index);
+
+	// Rotate once the flush window is written so records are never split
+	bool sizeExceeded = m_rotationPolicy.maxBytes && sink.GetSize() >= m_rotationPolicy.maxBytes;
+	bool ageExceeded = m_rotationPolicy.maxAge.count() > 0 &&
+		std::chrono::steady_clock::now() - sink.GetOpenTime() >= m_rotationPolicy.maxAge;
+	if (success && sink.IsOpen() && (sizeExceeded || ageExceeded))
+		RotateLogFile();
+	return success;
+}
+
+//----------------------------------------------------------------------------
+// WriteRecords
+//----------------------------------------------------------------------------
+template <class Sink>
+bool LogWriter::WriteRecords(Sink& sink, const LogBuffer& buffer, Result& result, bool forceSync, LogIndex* index)
+{
+	if (!sink.IsOpen())
+		return false;
+
+	bool success = true;
+	uint64_t blockSize = 0;
+	uint32_t crc = 0;
+	for (std::string_view str : buffer)
+	{
+		// Binary and stamped records are rendered to text on the writing thread
+		bool stamped = LogTimestamp::IsStamped(str);
+		if (m_outputFormat == OutputFormat::JSON)
+			str = m_json.Render(str, m_text, m_formatter);
+		else
+		{
+			str = m_formatter.Render(str, m_text);
+			if (m_escape)
+				str = LogEscape::Escape(str, m_escaped);
+		}
+		if (index)
+			index->Add(str, stamped ? m_formatter.GetTimeNs() : LogIndex::NO_TIME);
+
+		// Records in the buffer stay valid until the flush completes so a 
+		// vectored log file references them instead of copying
+		if constexpr (std::is_same_v<Sink, LogFile>)
+		{
+			if (str.data() != m_text.data() && str.data() != m_escaped.data())
+				success &= sink.WriteStable(str.data(), str.size());
+			else
+				success &= sink.Write(str.data(), str.size());
+			success &= sink.WriteStable("\n", 1);
+		}
+		else
+		{
+			success &= sink.Write(str.data(), str.size());
+			success &= sink.Write("\n", 1);
+		}
+		if (m_checksums)
+		{
+			crc = LogChecksum::Crc32c(crc, str.data(), str.size());
+			crc = LogChecksum::Crc32c(crc, "\n", 1);
+			blockSize += str.size() + 1;
+		}
+		result.records++;
+		result.bytes += str.size() + 1;
+	}
+
+	// The trailer follows the block so a torn write leaves it missing
+	if (m_checksums && blockSize > 0)
+	{
+		char trailer[LogChecksum::TRAILER_SIZE];
+		LogChecksum::FormatTrailer(trailer, blockSize, crc);
+		success &= sink.Write(trailer, sizeof(trailer));
+		if (index)
+			index->Skip(sizeof(trailer));
+		result.bytes += sizeof(trailer);
+	}
+
+	// Single write and sync per flush window. Index entries follow the log data.
+	success &= sink.Flush(forceSync);
+	if (index && success)
+		index->Flush();
+	return success;
+}
+
+//----------------------------------------------------------------------------
+// SaveHighWaterMark
+//----------------------------------------------------------------------------
+bool LogWriter::SaveHighWaterMark()
+{
+	// Open the high-water mark file once, truncating the value loaded at startup
+	if (!m_hwmFile.IsOpen() && !m_hwmFile.Open(m_hwmFileName, 0, false))
+		return false;
+
+	// Fixed width value so each save overwrites the previous value in place
+	char hwm[32];
+	int len = snprintf(hwm, sizeof(hwm), "%020llu\n", (unsigned long long)m_highWaterMark);
+	return m_hwmFile.Rewind() && m_hwmFile.Write(hwm, len) && m_hwmFile.Flush();
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void LogWriter::Process()
+{
+	while (1)
+	{
+		const LogBuffer* buffer = nullptr;
+		CompleteCallback callback;
+		bool forceSync = false;
+		{
+			// Wait for a buffer to write or the exit request
+			std::unique_lock<std::mutex> lk(m_mutex);
+			m_cv.wait(lk, [this]() { return m_pending || m_exit; });
+			if (m_exit)
+				return;
+			buffer = m_pending;
+			callback = std::move(m_callback);
+			forceSync = m_forceSync;
+			m_pending = nullptr;
+		}
+
+		Result result = WriteBuffer(*buffer, forceSync);
+		if (callback)
+			callback(result);
+
+		// The write is complete once the owner has been notified
+		std::unique_lock<std::mutex> lk(m_mutex);
+		m_busy = false;
+		m_cv.notify_all();
+	}
+}
@@ -0,0 +1,314 @@
+#ifndef _LOG_WRITER_H
+#define _LOG_WRITER_H
+
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include "LogFile.h"
+#include "LogSegment.h"
+#include "LogCompressor.h"
+#include "LogBuffer.h"
+#include "LogTimestamp.h"
+#include "LogIndex.h"
+#include "LogEscape.h"
+#include "LogJson.h"
+#include "LogChecksum.h"
+#include "LogUring.h"
+#include "LogMemory.h"
+#include "IT_Client.h"
+
+/// @brief LogWriter writes LogBuffer records to the log file and persists the
+/// high-water mark. Binary records are rendered to text and stamped records are 
+/// prefixed with their UTC time as they are written. 
+/// A write executes either synchronously on the calling thread
+/// or asynchronously on a dedicated I/O thread so the caller continues while the
+/// disk is busy. Only one write is in progress at a time. The log file is rotated 
+/// according to the rotation policy and closed files are compressed by a 
+/// low-priority LogCompressor thread. The log file of Backend::FILE is indexed
+/// by a LogIndex side file that is renamed with the log file on rotation.
+/// Optionally the records of each write are framed by a LogChecksum trailer.
+///
+/// @details Public functions must be called from a single owner thread. An
+/// asynchronous write reads the caller's buffer until complete so the buffer
+/// must not be modified until the completion callback is invoked. The completion
+/// callback is invoked on the I/O thread.
+class LogWriter
+{
+public:
+	/// The outcome of a write
+	struct Result
+	{
+		/// True if all records were written to disk
+		bool success = false;
+
+		/// The number of records written
+		size_t records = 0;
+
+		/// The number of bytes written
+		size_t bytes = 0;
+
+		/// The time taken to write the records
+		std::chrono::milliseconds elapsed = std::chrono::milliseconds(0);
+	};
+
+	typedef std::function<void(const Result& result)> CompleteCallback;
+
+	/// The format of the log file records
+	enum class OutputFormat
+	{
+		TEXT,		///< One line of text per record.
+		JSON		///< One JSON object per line, see LogJson.
+	};
+
+	/// The sink records are written to
+	enum class Backend
+	{
+		FILE,		///< Buffered text file written with LogFile.
+		SEGMENT,	///< Memory-mapped segment files written with LogSegment.
+		URING,		///< Text file written with io_uring by LogUring. FILE if unsupported.
+		MEMORY		///< Records captured in memory by LogMemory, e.g. for tests. Nothing is written to disk.
+	};
+
+	/// Conditions that rotate the log file. A zero value disables the condition.
+	struct RotationPolicy
+	{
+		/// Rotate when the log file reaches this many bytes
+		size_t maxBytes = 0;
+
+		/// Rotate when the log file has been open this long
+		std::chrono::seconds maxAge = std::chrono::seconds(0);
+	};
+
+	/// Constructor
+	/// @param[in] logFileName - the log file name
+	/// @param[in] hwmFileName - the high-water mark file name
+	/// @param[in] segmentBaseName - the segment file base name for Backend::SEGMENT
+	LogWriter(const std::string& logFileName, const std::string& hwmFileName, const std::string& segmentBaseName);
+
+	/// Destructor. Waits for any write in progress to complete.
+	~LogWriter();
+
+	/// Read the persisted high-water mark from disk, if any
+	/// @return The high-water mark or 0 if none is persisted.
+	uint64_t LoadHighWaterMark();
+
+	/// Write all buffer records on the calling thread. Waits for any write in
+	/// progress to complete first.
+	/// @param[in] buffer - the records to write
+	/// @return The write result.
+	Result Write(const LogBuffer& buffer);
+
+	/// Start writing all buffer records on the I/O thread. Waits for any write
+	/// in progress to complete first.
+	/// @param[in] buffer - the records to write. Must not be modified until the
+	/// callback is invoked.
+	/// @param[in] callback - invoked on the I/O thread when the write completes
+	/// @param[in] forceSync - true to sync the records to the storage device 
+	///     regardless of the sync policy
+	void WriteAsync(const LogBuffer& buffer, CompleteCallback callback, bool forceSync = false);
+
+	/// Wait until no write is in progress and the completion callback returned
+	void WaitIdle();
+
+	/// Set the log file user-space buffer size. Takes effect when the log
+	/// file is next opened.
+	/// @param[in] bufferSize - the buffer size in bytes
+	void SetBufferSize(size_t bufferSize);
+
+	/// Select the sink records are written to. The previous sink is closed.
+	/// @param[in] backend - the backend
+	/// @param[in] segmentSize - the segment file size in bytes for Backend::SEGMENT
+	void SetBackend(Backend backend, size_t segmentSize = LogSegment::DEFAULT_SEGMENT_SIZE);
+
+	/// Get the sink records are written to
+	/// @return The backend.
+	Backend GetBackend() const { return m_backend; }
+
+	/// Get the records captured by Backend::MEMORY. Kept when another backend is
+	/// selected. The records may be read by any thread.
+	/// @return The captured records, or nullptr if Backend::MEMORY was never selected.
+	const LogMemory* GetMemory() const { return m_memory.get(); }
+
+	/// Discard the records captured by Backend::MEMORY. Waits for any write in
+	/// progress to complete.
+	void ClearMemory();
+
+	/// Set the conditions that rotate the log file. Closed segment files of 
+	/// Backend::SEGMENT are compressed as they roll over regardless of the policy.
+	/// @param[in] policy - the rotation policy
+	void SetRotationPolicy(const RotationPolicy& policy);
+
+	/// Get the conditions that rotate the log file
+	/// @return The rotation policy.
+	RotationPolicy GetRotationPolicy() const { return m_rotationPolicy; }
+
+	/// Set the policy used to sync log data to the storage device
+	/// @param[in] policy - the sync policy
+	/// @param[in] interval - the minimum time between syncs for LogFile::SyncPolicy::INTERVAL
+	void SetSyncPolicy(LogFile::SyncPolicy policy, std::chrono::milliseconds interval);
+
+	/// Set how Backend::FILE hands flushed records to the operating system. The
+	/// log file is closed and reopened in the new mode by the next write.
+	/// @param[in] mode - the write mode
+	/// @param[in] preallocation - the bytes of file extents reserved ahead of 
+	///     the data, or 0 to disable
+	void SetWriteMode(LogFile::WriteMode mode, size_t preallocation = 0);
+
+	/// Escape control characters and backslashes and replace invalid UTF-8 in
+	/// each record as it is written. See LogEscape.
+	/// @param[in] enable - true to escape records
+	void SetEscape(bool enable);
+
+	/// Set the format of the log file records
+	/// @param[in] format - the output format
+	void SetOutputFormat(OutputFormat format);
+
+	/// Follow the records of each write with a LogChecksum trailer holding 
+	/// their length and CRC32C
+	/// @param[in] enable - true to frame written records
+	void SetChecksums(bool enable);
+
+	/// Prepare for the first write. Waits for any write in progress to complete.
+	/// @param[in] fileExtent - open the text log file now and reserve this many
+	///     bytes of file extents ahead of the data, or 0 to open it on the first write
+	/// @param[in] warmUp - true to render a stamped record so the formatter 
+	///     calibration and text buffer are ready
+	void Prepare(size_t fileExtent, bool warmUp);
+
+	/// Get the write mode of the open log file
+	/// @return The write mode.
+	LogFile::WriteMode GetWriteMode() const { return m_logFile.GetWriteMode(); }
+
+private:
+IT_PRIVATE_ACCESS:
+	LogWriter(const LogWriter&) = delete;
+	LogWriter& operator=(const LogWriter&) = delete;
+
+	/// Write the buffer records to the log file and persist the high-water mark
+	/// @param[in] buffer - the records to write
+	/// @param[in] forceSync - true to sync regardless of the sync policy
+	/// @return The write result.
+	Result WriteBuffer(const LogBuffer& buffer, bool forceSync = false);
+
+	/// Write the buffer records to a sink
+	/// @param[in] sink - the LogFile or LogSegment to write to
+	/// @param[in] buffer - the records to write
+	/// @param[out] result - the records and bytes written
+	/// @param[in] forceSync - true to sync regardless of the sync policy
+	/// @param[in] index - the index of the sink, or nullptr
+	/// @return True if success.
+	template <class Sink>
+	bool WriteRecords(Sink& sink, const LogBuffer& buffer, Result& result, bool forceSync, LogIndex* index);
+
+	/// Open the text log file and its index if not open
+	/// @param[in] sink - the LogFile or LogUring writing the log file
+	template <class Sink>
+	void OpenLogFile(Sink& sink);
+
+	/// Write the buffer records to the text log file, then rotate it if the 
+	/// rotation policy requires
+	/// @param[in] sink - the LogFile or LogUring writing the log file
+	/// @param[in] buffer - the records to write
+	/// @param[out] result - the records and bytes written
+	/// @param[in] forceSync - true to sync regardless of the sync policy
+	/// @return True if success.
+	template <class Sink>
+	bool WriteLogFile(Sink& sink, const LogBuffer& buffer, Result& result, bool forceSync);
+
+	/// Close the log file, rename it with the next free rotation index and
+	/// queue it for compression. The log file is reopened by the next write.
+	void RotateLogFile();
+
+	/// Persist the high-water mark to disk
+	/// @return True if success.
+	bool SaveHighWaterMark();
+
+	/// Entry point for the I/O thread
+	void Process();
+
+	const std::string m_logFileName;
+	const std::string m_hwmFileName;
+	const std::string m_segmentBaseName;
+
+	/// Long-lived log file sink. Only accessed by the thread performing a write.
+	LogFile m_logFile;
+
+	/// Long-lived io_uring log file sink for Backend::URING. Only accessed by 
+	/// the thread performing a write.
+	LogUring m_uring;
+
+	/// Side index of the log file. Only accessed by the thread performing a write.
+	LogIndex m_index;
+
+	/// Long-lived memory-mapped log segment sink. Only accessed by the thread performing a write.
+	LogSegment m_segment;
+
+	/// In-memory sink created when Backend::MEMORY is first selected. Written only
+	/// by the thread performing a write.
+	std::unique_ptr<LogMemory> m_memory;
+
+	/// The sink records are written to
+	Backend m_backend = Backend::FILE;
+
+	/// Segment file size in bytes
+	size_t m_segmentSize = LogSegment::DEFAULT_SEGMENT_SIZE;
+
+	/// Log file rotation conditions
+	RotationPolicy m_rotationPolicy;
+
+	/// Compresses closed log and segment files
+	LogCompressor m_compressor;
+
+	/// Closed segment file names. Reused by each write.
+	std::vector<std::string> m_closedSegments;
+
+	/// Long-lived high-water mark file. Only accessed by the thread performing a write.
+	LogFile m_hwmFile;
+
+	/// Log file user-space buffer size in bytes
+	size_t m_bufferSize = LogFile::DEFAULT_BUFFER_SIZE;
+
+	/// Total number of records durably written to disk
+	uint64_t m_highWaterMark = 0;
+
+	/// Text rendered from a binary or stamped record. Reused by each record.
+	std::string m_text;
+
+	/// True to escape records as they are written
+	bool m_escape = false;
+
+	/// Format of the log file records
+	OutputFormat m_outputFormat = OutputFormat::TEXT;
+
+	/// True to follow each write with a LogChecksum trailer
+	bool m_checksums = false;
+
+	/// Renders JSON records. Only accessed by the thread performing a write.
+	LogJson m_json;
+
+	/// Record escaped by LogEscape. Reused by each record.
+	std::string m_escaped;
+
+	/// Renders record timestamps. Only accessed by the thread performing a write.
+	LogTimestamp::Formatter m_formatter;
+
+	/// I/O thread created on the first asynchronous write
+	std::unique_ptr<std::thread> m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+	const std::string THREAD_NAME;
+
+	/// The asynchronous write request. Protected by m_mutex.
+	const LogBuffer* m_pending = nullptr;
+	CompleteCallback m_callback;
+	bool m_forceSync = false;
+	bool m_busy = false;
+	bool m_exit = false;
+};
+
+#endif
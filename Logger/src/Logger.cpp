@@ -1,5 +1,11 @@
 #include "Logger.h"
 #include "Fault.h"
+#include "Clock.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <csignal>
+#include <future>
 
 #ifdef WIN32
 #include <Windows.h>
@@ -10,186 +16,1705 @@ using namespace std;
 // Worker thread message ID's
 #define MSG_WRITE				1
 #define MSG_EXIT_THREAD			2
-#define MSG_TIMER				3
+#define MSG_FLUSH				3
 #define MSG_DISPATCH_DELEGATE	4
+#define MSG_FLUSH_COMPLETE		5
+#define MSG_WRITE_BATCH			6
+#define MSG_WRITE_DURABLE		7
+#define MSG_SET_RECORDER		8
+#define MSG_DUMP_RECORDER		9
+#define MSG_SET_FORMAT			10
+#define MSG_WRITE_CHUNK			11
 
-// Base class for all thread queue messages
-class Msg
+// Live instances by ID. Staging buffers of an exiting thread are only handed
+// off to an instance that is still registered. Never destroyed so threads 
+// exiting after static destruction can still check it.
+static std::mutex& GetRegistryLock()
 {
-public:
-	Msg(int id) : m_id(id) { }
-	int GetId() const { return m_id; }
+	static std::mutex* lock = new std::mutex();
+	return *lock;
+}
+static std::vector<std::pair<uint64_t, Logger*>>& GetRegistry()
+{
+	static auto* registry = new std::vector<std::pair<uint64_t, Logger*>>();
+	return *registry;
+}
+static std::atomic<uint64_t> nextInstanceId(1);
+
+// Serializes SetFilter() so the route check sees every filter already set
+static std::mutex filterMutex;
+
+// Owns the calling thread's staging buffer of each instance and hands off the
+// remaining messages when the thread exits
+struct StagingHolder
+{
+	std::vector<std::pair<uint64_t, std::shared_ptr<Logger::StagingBuffer>>> buffers;
+
+	~StagingHolder()
+	{
+		const std::lock_guard<std::mutex> lock(GetRegistryLock());
+		for (auto& entry : buffers)
+		{
+			for (auto& instance : GetRegistry())
+			{
+				if (instance.first == entry.first)
+					instance.second->ReleaseStagingBuffer(entry.second);
+			}
+		}
+	}
+};
+
+static thread_local StagingHolder stagingHolder;
+
+std::atomic<Logger*> Logger::m_instance(nullptr);
+std::atomic<Logger*> Logger::m_instances[MAX_INSTANCES];
+std::atomic<Logger*> Logger::m_componentLoggers[MAX_COMPONENTS];
+std::atomic<Logger*> Logger::m_levelLoggers[static_cast<size_t>(LogLevel::Off)];
+ThreadAttributes Logger::m_threadAttributes;
+
+// Signals handled by InstallCrashHandlers()
+static const int CRASH_SIGNALS[] = {
+	SIGSEGV, SIGABRT, SIGFPE, SIGILL,
+#ifndef WIN32
+	SIGBUS
+#endif
+};
+static const size_t CRASH_SIGNAL_COUNT = sizeof(CRASH_SIGNALS) / sizeof(CRASH_SIGNALS[0]);
+
+// The handlers replaced by InstallCrashHandlers(), chained to after the flush
+#ifdef WIN32
+static void (*previousHandlers[CRASH_SIGNAL_COUNT])(int);
+#else
+static struct sigaction previousActions[CRASH_SIGNAL_COUNT];
+#endif
+static bool crashHandlersInstalled = false;
+
+//----------------------------------------------------------------------------
+// CrashSignalHandler
+//----------------------------------------------------------------------------
+static void CrashSignalHandler(int sig)
+{
+	Logger::EmergencyFlush();
+
+	// Restore the previous handler and raise the signal again. It is delivered
+	// to that handler, or terminates with the default action, once this one
+	// returns. An ignored crash signal would fault again so it terminates.
+	for (size_t i = 0; i < CRASH_SIGNAL_COUNT; i++)
+	{
+		if (CRASH_SIGNALS[i] != sig)
+			continue;
+#ifdef WIN32
+		signal(sig, previousHandlers[i] == SIG_IGN ? SIG_DFL : previousHandlers[i]);
+#else
+		struct sigaction previous = previousActions[i];
+		if (!(previous.sa_flags & SA_SIGINFO) && previous.sa_handler == SIG_IGN)
+			previous.sa_handler = SIG_DFL;
+		sigaction(sig, &previous, nullptr);
+#endif
+	}
+	raise(sig);
+}
+
+//----------------------------------------------------------------------------
+// GetInstance
+//----------------------------------------------------------------------------
+Logger& Logger::GetInstance()
+{
+	static Logger instance(LogData::DEFAULT_BASE_NAME, "LoggerThread");
+	return instance;
+}
+
+//----------------------------------------------------------------------------
+// SetComponentLogger
+//----------------------------------------------------------------------------
+void Logger::SetComponentLogger(LogComponent component, Logger* logger)
+{
+	if (component < MAX_COMPONENTS)
+		m_componentLoggers[component].store(logger, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// SetLevelLogger
+//----------------------------------------------------------------------------
+void Logger::SetLevelLogger(LogLevel minLevel, Logger* logger)
+{
+	for (size_t level = static_cast<size_t>(minLevel); level < static_cast<size_t>(LogLevel::Off); level++)
+		m_levelLoggers[level].store(logger, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// SetThreadAttributes
+//----------------------------------------------------------------------------
+bool Logger::SetThreadAttributes(const ThreadAttributes& attributes)
+{
+	Logger* instance = m_instance;
+	if (!instance)
+	{
+		m_threadAttributes = attributes;
+		return true;
+	}
+
+	// Applied now if the thread runs, otherwise when it is created
+	std::lock_guard<std::mutex> lock(instance->m_startMutex);
+	m_threadAttributes = attributes;
+	if (instance->m_thread)
+		return ApplyThreadAttributes(*instance->m_thread, attributes);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Start
+//----------------------------------------------------------------------------
+void Logger::Start(const StartConfig& config)
+{
+	std::lock_guard<std::mutex> lock(m_startMutex);
+
+	// LogData belongs to the Logger thread once it runs. On a NUMA node the buffers 
+	// are prepared by a thread placed on the node so first touch allocates them there.
+	if (!m_started.load(std::memory_order_relaxed))
+	{
+		m_logData.SetHugePages(config.hugePages);
+		m_logData.SetMemoryResource(config.memoryResource);
+		if (config.journalBytes > 0)
+			m_logData.SetJournal(config.journalBytes);
+		m_signalRing.Reset(config.signalSlots);
+		if (m_threadAttributes.numaNode >= 0)
+		{
+			ThreadAttributes placement;
+			placement.numaNode = m_threadAttributes.numaNode;
+			std::promise<void> placed;
+			std::future<void> ready = placed.get_future();
+			auto helper = StartThread(placement, [&]() {
+				ready.wait();
+				m_logData.Prepare(config.bufferBytes, config.fileExtent, config.warmUp);
+			});
+			placed.set_value();
+			helper->join();
+		}
+		else
+			m_logData.Prepare(config.bufferBytes, config.fileExtent, config.warmUp);
+	}
+
+	// The first stamp otherwise pays the tick rate calibration
+	if (config.warmUp)
+		LogTimestamp::GetCalibration();
+
+	if (config.eager && !m_started.load(std::memory_order_relaxed))
+	{
+		CreateThread();
+		m_started.store(true, std::memory_order_release);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Start
+//----------------------------------------------------------------------------
+void Logger::Start()
+{
+	Start(StartConfig());
+}
+
+//----------------------------------------------------------------------------
+// StartOnce
+//----------------------------------------------------------------------------
+void Logger::StartOnce()
+{
+	std::lock_guard<std::mutex> lock(m_startMutex);
+	if (m_started.load(std::memory_order_relaxed) || m_closing.load(std::memory_order_relaxed))
+		return;
+	CreateThread();
+	m_started.store(true, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// Logger
+//----------------------------------------------------------------------------
+Logger::Logger(const std::string& name) : Logger(name, name + "Thread")
+{
+}
+
+//----------------------------------------------------------------------------
+// Logger
+//----------------------------------------------------------------------------
+Logger::Logger(const std::string& fileBaseName, const std::string& threadName) : 
+	ActiveObject(threadName, [this]() { return m_queueDepth.load(std::memory_order_relaxed); }),
+	m_logData(fileBaseName), m_pLoggerStatusCb(nullptr), m_statusThread(nullptr), m_statusMask(0), m_started(false), THREAD_NAME(threadName),
+	m_flushRequested(false), m_adaptiveFlush(false), m_flushInterval(0), m_writeQueue(WRITE_QUEUE_CAPACITY), m_lockFreeWrite(false), m_coalesceStatus(false),
+	m_stagedWrite(false), m_stagingCapacity(STAGING_CAPACITY), m_sequenceNumbers(false), m_sequence(0), m_timestamps(false),
+	m_rateLimit(false), m_collapseRepeats(false), m_collapsed(0),
+	m_queueCapacity(0), m_backpressure(BackpressurePolicy::BLOCK), m_sampleRate(1), m_sampleCount(0),
+	m_queueDepth(0), m_peakDepth(0), m_enqueued(0), m_dropped(0), m_flushedBytes(0),
+	m_id(nextInstanceId++), m_metricsPrefix(fileBaseName == LogData::DEFAULT_BASE_NAME ? "logger." : "logger." + fileBaseName + "."),
+	m_emergencyFlushed(false), m_recorderDumpLevel(static_cast<uint8_t>(LogLevel::Off)), m_recorderBytes(0), m_outputFormat(LogWriter::OutputFormat::TEXT), m_recordContext(false), m_signals(0)
+{
+	for (auto& bucket : m_flushLatency)
+		bucket.store(0, std::memory_order_relaxed);
+
+	// Write all levels by default
+	for (auto& level : m_levels)
+		level.store(static_cast<uint8_t>(LogLevel::Trace), std::memory_order_relaxed);
+
+	// Recheck the flush deadlines when a virtual clock advances
+	DelegateLib::Clock::AddAdvancedHook(&Logger::ClockAdvanced, this);
+
+	// Publish the counters read by GetStats()
+	DelegateLib::Metrics::SetGauge(m_metricsPrefix + "queue_depth", [this]() { return (double)GetStats().queueDepth; });
+	DelegateLib::Metrics::SetGauge(m_metricsPrefix + "enqueued", [this]() { return (double)GetStats().enqueued; });
+	DelegateLib::Metrics::SetGauge(m_metricsPrefix + "dropped", [this]() { return (double)GetStats().dropped; });
+	DelegateLib::Metrics::SetGauge(m_metricsPrefix + "flushed_bytes", [this]() { return (double)GetStats().flushedBytes; });
+	DelegateLib::Metrics::SetGauge(m_metricsPrefix + "rate_limited", [this]() { return (double)GetStats().rateLimited; });
+	DelegateLib::Metrics::SetGauge(m_metricsPrefix + "collapsed", [this]() { return (double)GetStats().collapsed; });
+
+	{
+		const std::lock_guard<std::mutex> lock(GetRegistryLock());
+		GetRegistry().push_back({ m_id, this });
+	}
+
+	// Save pending log data if a software fault terminates the application
+	for (auto& instance : m_instances)
+	{
+		Logger* expected = nullptr;
+		if (instance.compare_exchange_strong(expected, this))
+			break;
+	}
+	if (fileBaseName == LogData::DEFAULT_BASE_NAME)
+		m_instance = this;
+	SetFaultHook(&Logger::EmergencyFlush);
+}
+
+//----------------------------------------------------------------------------
+// ~Logger
+//----------------------------------------------------------------------------
+Logger::~Logger()
+{
+	// Threads exiting from now on no longer hand off their staging buffers
+	{
+		const std::lock_guard<std::mutex> lock(GetRegistryLock());
+		auto& registry = GetRegistry();
+		registry.erase(std::remove(registry.begin(), registry.end(), std::make_pair(m_id, this)), registry.end());
+	}
+
+	bool others = false;
+	for (auto& instance : m_instances)
+	{
+		Logger* expected = this;
+		instance.compare_exchange_strong(expected, nullptr);
+		others |= instance.load() != nullptr;
+	}
+	if (!others)
+		SetFaultHook(nullptr);
+	if (m_instance == this)
+		m_instance = nullptr;
+
+	DelegateLib::Clock::RemoveAdvancedHook(&Logger::ClockAdvanced, this);
+	for (const char* gauge : { "queue_depth", "enqueued", "dropped", "flushed_bytes", "rate_limited", "collapsed" })
+		DelegateLib::Metrics::RemoveGauge(m_metricsPrefix + gauge);
+	Shutdown(std::chrono::milliseconds(m_shutdownTimeout.load(std::memory_order_relaxed)));
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+void Logger::Write(std::string&& msg)
+{
+	if (m_rateLimit.load(std::memory_order_relaxed) && !AdmitRate(LogRateLimiter::Hash(msg)))
+		return;
+	WriteMsg(std::move(msg));
+}
+
+//----------------------------------------------------------------------------
+// WriteParts
+//----------------------------------------------------------------------------
+void Logger::WriteParts(const std::string_view* parts, size_t count)
+{
+	size_t length = 0;
+	for (size_t i = 0; i < count; i++)
+		length += parts[i].size();
+
+	// Copy the parts once into a record with room for the timestamp
+	size_t offset = m_timestamps.load(std::memory_order_relaxed) ? LogTimestamp::PREFIX_SIZE : 0;
+	std::string record;
+	record.reserve(offset + length);
+	record.resize(offset);
+	for (size_t i = 0; i < count; i++)
+		record.append(parts[i].data(), parts[i].size());
+
+	if (m_rateLimit.load(std::memory_order_relaxed) && !AdmitRate(LogRateLimiter::Hash(LogContext::Strip(std::string_view(record).substr(offset)))))
+		return;
+	if (offset)
+		LogTimestamp::StampPrefix(&record[0]);
+	WriteMsg(std::move(record), offset != 0);
+}
+
+//----------------------------------------------------------------------------
+// Reserve
+//----------------------------------------------------------------------------
+Logger::WriteSlot Logger::Reserve(size_t bytes)
+{
+	WriteSlot slot;
+	slot.m_logger = this;
+	slot.m_offset = m_timestamps.load(std::memory_order_relaxed) ? LogTimestamp::PREFIX_SIZE : 0;
+	slot.m_record.resize(slot.m_offset + bytes);
+	return slot;
+}
+
+//----------------------------------------------------------------------------
+// Commit
+//----------------------------------------------------------------------------
+void Logger::Commit(WriteSlot& slot, size_t length)
+{
+	if (slot.m_logger != this)
+		return;
+	slot.m_logger = nullptr;
+	slot.m_record.resize(slot.m_offset + std::min(length, slot.m_record.size() - slot.m_offset));
+
+	if (m_rateLimit.load(std::memory_order_relaxed) && !AdmitRate(LogRateLimiter::Hash(std::string_view(slot.m_record).substr(slot.m_offset))))
+	{
+		slot.m_record.clear();
+		return;
+	}
+
+	// The timestamp is taken when committed, the time the message is written
+	if (slot.m_offset)
+		LogTimestamp::StampPrefix(&slot.m_record[0]);
+	WriteMsg(std::move(slot.m_record), slot.m_offset != 0);
+}
+
+//----------------------------------------------------------------------------
+// AdmitRate
+//----------------------------------------------------------------------------
+bool Logger::AdmitRate(uint64_t key)
+{
+	uint64_t suppressed = 0;
+	if (!m_rateLimiter.Allow(key, suppressed))
+		return false;
+	if (suppressed)
+		WriteMsg("Rate limit suppressed " + std::to_string(suppressed) + " similar messages");
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// AddTraceTag
+//----------------------------------------------------------------------------
+/// Tag a text record with the sampled trace of the calling thread, e.g. 
+/// "[trace=<id> span=<id> +<us>us] ", the time since the trace started. The
+/// tag follows the timestamp and context prefixes.
+/// @param[in,out] record - the record
+/// @param[in] stamped - true if the record has a timestamp prefix
+/// @param[in] trace - the sampled trace context
+static void AddTraceTag(std::string& record, bool stamped, const DelegateLib::TraceContext& trace)
+{
+	size_t offset = stamped ? LogTimestamp::PREFIX_SIZE : 0;
+	if (LogContext::HasContext(std::string_view(record).substr(std::min(offset, record.size()))))
+		offset += LogContext::PREFIX_SIZE;
+	if (offset > record.size() || (offset < record.size() && record[offset] == LogRecord::BINARY_TAG))
+		return;
+
+	long long elapsed = (long long)((std::chrono::steady_clock::now().time_since_epoch().count() - trace.startNs) / 1000);
+	char tag[80];
+	int length = snprintf(tag, sizeof(tag), "[trace=%016llx span=%016llx +%lldus] ",
+		(unsigned long long)trace.traceId, (unsigned long long)trace.spanId, elapsed);
+	if (length > 0)
+		record.insert(offset, tag, std::min((size_t)length, sizeof(tag) - 1));
+}
+
+//----------------------------------------------------------------------------
+// WriteMsg
+//----------------------------------------------------------------------------
+void Logger::WriteMsg(std::string&& msg, bool stamped)
+{
+	if (m_closing.load(std::memory_order_relaxed))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	EnsureStarted();
+
+	if (!stamped && m_timestamps.load(std::memory_order_relaxed))
+	{
+		LogTimestamp::Stamp(msg);
+		stamped = true;
+	}
+
+	// Records written within a sampled delegate call carry its trace
+	const DelegateLib::TraceContext& trace = DelegateLib::GetTraceContext();
+	if (trace.IsSampled())
+		AddTraceTag(msg, stamped, trace);
+
+	if (m_stagedWrite)
+	{
+		WriteStaged(std::move(msg));
+		return;
+	}
+
+	if (m_perCpuWrite.load(std::memory_order_relaxed))
+	{
+		WritePerCpu(std::move(msg));
+		return;
+	}
+
+	if (m_lockFreeWrite)
+	{
+		// Add message to the lock-free write queue
+		m_writeQueue.Push(std::move(msg));
+
+		// Wake the worker thread only if it is waiting for messages
+		NotifyWaiting();
+		return;
+	}
+
+	// Producers share the write pipeline while the Logger thread falls behind
+	if (m_assistThreshold.load(std::memory_order_relaxed) && WriteAssisted(msg))
+		return;
+
+	// Add write log message to queue and notify worker thread
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	if (!AdmitWrite(lk, 1, msg.size(), true))
+		return;
+	m_queue.push(Msg{ MSG_WRITE, std::move(msg) });
+	Signal();
+}
+
+//----------------------------------------------------------------------------
+// WriteRouted
+//----------------------------------------------------------------------------
+bool Logger::WriteRouted(std::string&& msg)
+{
+	if (m_closing.load(std::memory_order_relaxed))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	EnsureStarted();
+
+	if (!LogTimestamp::IsStamped(msg) && m_timestamps.load(std::memory_order_relaxed))
+		LogTimestamp::Stamp(msg);
+
+	// The routing Logger thread never waits, whatever the backpressure policy
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	if (!QueueFits(1, msg.size()))
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+	if (!AdmitWrite(lk, 1, msg.size(), false))
+		return false;
+	m_queue.push(Msg{ MSG_WRITE, std::move(msg) });
+	Signal();
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Signal
+//----------------------------------------------------------------------------
+void Logger::Signal()
+{
+	m_signals.fetch_add(1, std::memory_order_relaxed);
+	WakeLoop();
+}
+
+//----------------------------------------------------------------------------
+// ClockAdvanced
+//----------------------------------------------------------------------------
+void Logger::ClockAdvanced(void* context)
+{
+	Logger* logger = static_cast<Logger*>(context);
+	std::unique_lock<DelegateLib::SiteMutex> lk(logger->m_mutex);
+	logger->Signal();
+}
+
+//----------------------------------------------------------------------------
+// EmergencyFlush
+//----------------------------------------------------------------------------
+void Logger::EmergencyFlush()
+{
+	for (auto& instance : m_instances)
+	{
+		Logger* logger = instance.load();
+		if (logger)
+			logger->EmergencyFlushInstance();
+	}
+}
+
+//----------------------------------------------------------------------------
+// EmergencyFlushInstance
+//----------------------------------------------------------------------------
+void Logger::EmergencyFlushInstance()
+{
+	if (m_emergencyFlushed.exchange(true))
+		return;
+
+	// Log data held by the Logger thread is older than the queued messages
+	m_logData.EmergencyFlush();
+
+	// Only lock-free, already framed state is read. The message queue is not,
+	// since the crashing thread may hold its lock or be modifying it.
+	m_signalRing.ForEach([this](std::string_view record) { m_logData.EmergencyWrite(record); });
+}
+
+//----------------------------------------------------------------------------
+// InstallCrashHandlers
+//----------------------------------------------------------------------------
+void Logger::InstallCrashHandlers()
+{
+	// Installed once, so the handlers saved are never this one
+	if (crashHandlersInstalled)
+		return;
+	crashHandlersInstalled = true;
+	for (size_t i = 0; i < CRASH_SIGNAL_COUNT; i++)
+	{
+#ifdef WIN32
+		previousHandlers[i] = signal(CRASH_SIGNALS[i], &CrashSignalHandler);
+#else
+		struct sigaction action = {};
+		action.sa_handler = &CrashSignalHandler;
+		sigemptyset(&action.sa_mask);
+		sigaction(CRASH_SIGNALS[i], &action, &previousActions[i]);
+#endif
+	}
+}
+
+//----------------------------------------------------------------------------
+// AdmitWrite
+//----------------------------------------------------------------------------
+bool Logger::AdmitWrite(std::unique_lock<DelegateLib::SiteMutex>& lk, size_t count, size_t bytes, bool canBlock)
+{
+	// Writes are no longer taken once Shutdown() queued the exit message
+	if (m_closing.load(std::memory_order_relaxed))
+	{
+		m_dropped.fetch_add(count, std::memory_order_relaxed);
+		return false;
+	}
+
+	auto fits = [this, count, bytes]() { return QueueFits(count, bytes); };
+
+	size_t depth;
+	if (!fits())
+	{
+		switch (m_backpressure)
+		{
+			case BackpressurePolicy::BLOCK:
+				// The Logger thread cannot wait for itself to take the queue
+				if (canBlock && m_thread && GetCurrentThreadId() != m_thread->get_id())
+				{
+					m_spaceCv.wait(lk, [this, &fits]() {
+						return fits() || m_queueDepth.load(std::memory_order_relaxed) == 0 ||
+							m_closing.load(std::memory_order_relaxed);
+					});
+					if (m_closing.load(std::memory_order_relaxed))
+					{
+						m_dropped.fetch_add(count, std::memory_order_relaxed);
+						return false;
+					}
+				}
+				break;
+
+			case BackpressurePolicy::SAMPLE:
+				if (m_sampleCount++ % m_sampleRate == 0)
+					break;
+				m_dropped.fetch_add(count, std::memory_order_relaxed);
+				return false;
+
+			case BackpressurePolicy::DROP:
+			default:
+				m_dropped.fetch_add(count, std::memory_order_relaxed);
+				return false;
+		}
+	}
+
+	depth = m_queueDepth.load(std::memory_order_relaxed) + count;
+	m_queueDepth.store(depth, std::memory_order_relaxed);
+	m_queueBytes.store(m_queueBytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+	if (depth > m_peakDepth.load(std::memory_order_relaxed))
+		m_peakDepth.store(depth, std::memory_order_relaxed);
+	m_enqueued.fetch_add(count, std::memory_order_relaxed);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// QueueFits
+//----------------------------------------------------------------------------
+bool Logger::QueueFits(size_t count, size_t bytes) const
+{
+	// The messages fit the capacity, and the byte budget unless no bytes are queued
+	size_t queued = m_queueBytes.load(std::memory_order_relaxed);
+	return (!m_queueCapacity || m_queueDepth.load(std::memory_order_relaxed) + count <= m_queueCapacity) &&
+		(!m_queueByteBudget || queued == 0 || queued + bytes <= m_queueByteBudget);
+}
+
+//----------------------------------------------------------------------------
+// SetQueueCapacity
+//----------------------------------------------------------------------------
+void Logger::SetQueueCapacity(size_t capacity, BackpressurePolicy policy, size_t sampleRate)
+{
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_queueCapacity = capacity;
+	m_backpressure = policy;
+	m_queue.Reserve(capacity);
+	m_sampleRate = sampleRate ? sampleRate : 1;
+	m_sampleCount = 0;
+
+	// Release writers blocked by the previous capacity
+	m_spaceCv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// SetQueueByteBudget
+//----------------------------------------------------------------------------
+void Logger::SetQueueByteBudget(size_t bytes)
+{
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_queueByteBudget = bytes;
+	m_spaceCv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// GetQueueCapacity
+//----------------------------------------------------------------------------
+size_t Logger::GetQueueCapacity()
+{
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	return m_queue.capacity();
+}
+
+//----------------------------------------------------------------------------
+// GetStats
+//----------------------------------------------------------------------------
+Logger::Stats Logger::GetStats() const
+{
+	Stats stats;
+	stats.queueDepth = m_queueDepth.load(std::memory_order_relaxed) + m_writeQueue.Size();
+	stats.peakQueueDepth = std::max(m_peakDepth.load(std::memory_order_relaxed), m_writeQueue.GetPeakDepth());
+	stats.queueBytes = m_queueBytes.load(std::memory_order_relaxed);
+	stats.enqueued = m_enqueued.load(std::memory_order_relaxed);
+	stats.dropped = m_dropped.load(std::memory_order_relaxed) + m_writeQueue.GetDropCount() + m_signalRing.GetDropCount();
+	stats.flushedBytes = m_flushedBytes.load(std::memory_order_relaxed);
+	stats.rateLimited = m_rateLimiter.GetLimited();
+	stats.collapsed = m_collapsed.load(std::memory_order_relaxed);
+	stats.assisted = m_assisted.load(std::memory_order_relaxed);
+	stats.filtered = m_filtered.load(std::memory_order_relaxed);
+	stats.routed = m_routed.load(std::memory_order_relaxed);
+	stats.routeDropped = m_routeDropped.load(std::memory_order_relaxed);
+	stats.wakeups = GetWakeups();
+	stats.wakeupsAvoided = GetWakeupsAvoided();
+	for (size_t i = 0; i < LATENCY_BUCKETS; i++)
+		stats.flushLatency[i] = m_flushLatency[i].load(std::memory_order_relaxed);
+	stats.flushInterval = std::chrono::milliseconds(m_flushInterval.load(std::memory_order_relaxed));
+	return stats;
+}
+
+//----------------------------------------------------------------------------
+// WriteDurable
+//----------------------------------------------------------------------------
+std::future<bool> Logger::WriteDurable(std::string msg)
+{
+	EnsureStarted();
+
+	if (m_timestamps.load(std::memory_order_relaxed))
+		LogTimestamp::Stamp(msg);
+
+	DurableWrite durable{ std::move(msg), std::promise<bool>() };
+	std::future<bool> future = durable.promise.get_future();
+
+	// Messages staged by this thread are written first
+	if (StagingBuffer* buffer = FindStagingBuffer())
+	{
+		std::unique_lock<std::mutex> lk(buffer->mutex);
+		HandOffStagingBuffer(*buffer);
+	}
+
+	// Add durable write message to queue and notify worker thread
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	if (!AdmitWrite(lk, 1, durable.msg.size(), true))
+	{
+		durable.promise.set_value(false);
+		return future;
+	}
+	m_queue.push(Msg{ MSG_WRITE_DURABLE, std::move(durable) });
+	Signal();
+	return future;
+}
+
+//----------------------------------------------------------------------------
+// SetFlightRecorder
+//----------------------------------------------------------------------------
+void Logger::SetFlightRecorder(size_t bytes, LogLevel dumpLevel)
+{
+	EnsureStarted();
+
+	m_recorderBytes.store(bytes, std::memory_order_relaxed);
+	m_recorderDumpLevel.store(static_cast<uint8_t>(bytes ? dumpLevel : LogLevel::Off), std::memory_order_relaxed);
+
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_queue.push(Msg{ MSG_SET_RECORDER, {} });
+	Signal();
+}
+
+//----------------------------------------------------------------------------
+// SetOutputFormat
+//----------------------------------------------------------------------------
+void Logger::SetOutputFormat(LogWriter::OutputFormat format)
+{
+	EnsureStarted();
+
+	m_outputFormat.store(format, std::memory_order_relaxed);
+	m_recordContext.store(format == LogWriter::OutputFormat::JSON, std::memory_order_relaxed);
+
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_queue.push(Msg{ MSG_SET_FORMAT, {} });
+	Signal();
+}
+
+//----------------------------------------------------------------------------
+// DumpFlightRecorder
+//----------------------------------------------------------------------------
+void Logger::DumpFlightRecorder()
+{
+	EnsureStarted();
+
+	// Messages staged by this thread are included in the dump
+	if (StagingBuffer* buffer = FindStagingBuffer())
+	{
+		std::unique_lock<std::mutex> lk(buffer->mutex);
+		HandOffStagingBuffer(*buffer);
+	}
+
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_queue.push(Msg{ MSG_DUMP_RECORDER, {} });
+	Signal();
+}
+
+//----------------------------------------------------------------------------
+// GetStagingBuffer
+//----------------------------------------------------------------------------
+Logger::StagingBuffer& Logger::GetStagingBuffer()
+{
+	if (StagingBuffer* buffer = FindStagingBuffer())
+		return *buffer;
+
+	auto buffer = std::make_shared<StagingBuffer>();
+	stagingHolder.buffers.push_back({ m_id, buffer });
+	std::unique_lock<std::mutex> lk(m_stagingMutex);
+	m_stagingBuffers.push_back(buffer);
+	return *buffer;
+}
+
+//----------------------------------------------------------------------------
+// FindStagingBuffer
+//----------------------------------------------------------------------------
+Logger::StagingBuffer* Logger::FindStagingBuffer()
+{
+	for (auto& entry : stagingHolder.buffers)
+	{
+		if (entry.first == m_id)
+			return entry.second.get();
+	}
+	return nullptr;
+}
+
+//----------------------------------------------------------------------------
+// WriteStaged
+//----------------------------------------------------------------------------
+void Logger::WriteStaged(std::string&& msg)
+{
+	StagingBuffer& buffer = GetStagingBuffer();
+	std::unique_lock<std::mutex> lk(buffer.mutex);
+
+	// The sequence number follows the timestamp so the record stays stamped
+	if (m_sequenceNumbers)
+		msg.insert(LogTimestamp::IsStamped(msg) ? LogTimestamp::PREFIX_SIZE : 0, "#" + std::to_string(m_sequence++) + " ");
+
+	bool wasEmpty = buffer.msgs.empty();
+	if (wasEmpty)
+		buffer.msgs.reserve(m_stagingCapacity);
+	buffer.msgs.push_back(std::move(msg));
+
+	if (buffer.msgs.size() >= m_stagingCapacity)
+	{
+		// Hand off a full buffer with a single message queue lock
+		HandOffStagingBuffer(buffer);
+	}
+	else if (wasEmpty)
+		SetStagingDeadline(buffer);
+}
+
+//----------------------------------------------------------------------------
+// SetStagingDeadline
+//----------------------------------------------------------------------------
+void Logger::SetStagingDeadline(StagingBuffer& buffer)
+{
+	// Make sure the Logger thread collects the buffer once the latency passes
+	auto now = DelegateLib::Clock::Now();
+	buffer.firstWrite = now;
+
+	std::unique_lock<DelegateLib::SiteMutex> qlk(m_mutex);
+	if (m_flushTrigger.maxLatency.count() > 0)
+	{
+		auto deadline = now + m_flushTrigger.maxLatency;
+		if (!m_stagingDeadline || deadline < *m_stagingDeadline)
+		{
+			m_stagingDeadline = deadline;
+			Signal();
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// WriteAssisted
+//----------------------------------------------------------------------------
+bool Logger::WriteAssisted(std::string& msg)
+{
+	// Once framing, a thread keeps framing until its chunk is handed off so its
+	// records stay in order
+	bool overloaded = m_queueDepth.load(std::memory_order_relaxed) >= m_assistThreshold.load(std::memory_order_relaxed);
+	StagingBuffer* buffer = overloaded ? &GetStagingBuffer() : FindStagingBuffer();
+	if (!buffer)
+		return false;
+
+	std::unique_lock<std::mutex> lk(buffer->mutex);
+	if (!overloaded && buffer->chunk.empty())
+		return false;
+
+	size_t chunkBytes = m_assistChunkBytes.load(std::memory_order_relaxed);
+	bool wasEmpty = buffer->chunk.empty();
+	if (wasEmpty)
+		buffer->chunk.reserve(chunkBytes + sizeof(uint32_t) + msg.size());
+	LogBuffer::Frame(buffer->chunk, msg);
+	buffer->chunkRecords++;
+	m_assisted.fetch_add(1, std::memory_order_relaxed);
+
+	if (overloaded && buffer->chunk.size() < chunkBytes)
+	{
+		if (wasEmpty)
+			SetStagingDeadline(*buffer);
+		return true;
+	}
+
+	// Only this thread adds to its chunk, so the chunk is queued after the
+	// buffer mutex is released and waiting for space cannot stall a Logger 
+	// thread collecting the buffer
+	std::string records;
+	records.swap(buffer->chunk);
+	size_t count = std::exchange(buffer->chunkRecords, 0);
+	lk.unlock();
+	QueueChunk(std::move(records), count, true);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// QueueChunk
+//----------------------------------------------------------------------------
+void Logger::QueueChunk(std::string&& records, size_t count, bool canBlock)
+{
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	if (!AdmitWrite(lk, count, records.size(), canBlock))
+		return;
+	m_queue.push(Msg{ MSG_WRITE_CHUNK, Msg::WriteChunk{ std::move(records), count } });
+	Signal();
+}
+
+//----------------------------------------------------------------------------
+// HandOffStagingBuffer
+//----------------------------------------------------------------------------
+void Logger::HandOffStagingBuffer(StagingBuffer& buffer)
+{
+	if (!buffer.chunk.empty())
+	{
+		std::string records;
+		records.swap(buffer.chunk);
+		QueueChunk(std::move(records), std::exchange(buffer.chunkRecords, 0), false);
+	}
+	if (buffer.msgs.empty())
+		return;
+
+	std::vector<std::string> msgs;
+	msgs.swap(buffer.msgs);
+
+	// Queued while the buffer mutex is held so batches from one thread stay in 
+	// order. Never blocks since the Logger thread may be waiting for the buffer.
+	size_t bytes = 0;
+	for (const std::string& msg : msgs)
+		bytes += msg.size();
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	if (!AdmitWrite(lk, msgs.size(), bytes, false))
+		return;
+	m_queue.push(Msg{ MSG_WRITE_BATCH, std::move(msgs) });
+	Signal();
+}
+
+//----------------------------------------------------------------------------
+// ReleaseStagingBuffer
+//----------------------------------------------------------------------------
+void Logger::ReleaseStagingBuffer(const std::shared_ptr<StagingBuffer>& buffer)
+{
+	std::unique_lock<std::mutex> lk(m_stagingMutex);
+	{
+		std::unique_lock<std::mutex> blk(buffer->mutex);
+		if (m_thread)
+			HandOffStagingBuffer(*buffer);
+	}
+	m_stagingBuffers.erase(std::remove(m_stagingBuffers.begin(), m_stagingBuffers.end(), buffer), 
+		m_stagingBuffers.end());
+}
+
+//----------------------------------------------------------------------------
+// CollectStagingBuffers
+//----------------------------------------------------------------------------
+void Logger::CollectStagingBuffers()
+{
+	auto now = DelegateLib::Clock::Now();
+	std::chrono::milliseconds latency = GetFlushTrigger().maxLatency;
+	std::optional<std::chrono::steady_clock::time_point> next;
+
+	std::unique_lock<std::mutex> lk(m_stagingMutex);
+	for (auto& buffer : m_stagingBuffers)
+	{
+		std::unique_lock<std::mutex> blk(buffer->mutex);
+		if (buffer->msgs.empty() && buffer->chunk.empty())
+			continue;
+
+		auto deadline = buffer->firstWrite + latency;
+		if (now >= deadline || latency.count() == 0)
+			HandOffStagingBuffer(*buffer);
+		else if (!next || deadline < *next)
+			next = deadline;
+	}
+
+	// Wait for buffers not yet due. Producers may have set an earlier deadline.
+	if (next)
+	{
+		std::unique_lock<DelegateLib::SiteMutex> qlk(m_mutex);
+		if (!m_stagingDeadline || *next < *m_stagingDeadline)
+			m_stagingDeadline = next;
+	}
+}
+
+//----------------------------------------------------------------------------
+// CreateThread
+//----------------------------------------------------------------------------
+bool Logger::CreateThread()
+{
+	if (!m_thread)
+	{
+		// Preallocate the queue so queuing within its capacity never allocates
+		{
+			std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+			m_queue.Reserve(std::max(QUEUE_RESERVE, m_queueCapacity));
+		}
+
+		StartLoop(m_threadAttributes, [this]() { Process(); });
+
+#ifdef WIN32
+		// Get the thread's native Windows handle
+		auto handle = m_thread->native_handle();
+
+		// Set the thread name so it shows in the Visual Studio Debug Location toolbar
+		std::wstring wstr(THREAD_NAME.begin(), THREAD_NAME.end());
+		HRESULT hr = SetThreadDescription(handle, wstr.c_str());
+		if (FAILED(hr))
+		{
+			// Handle error if needed
+		}
+#endif
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// GetThreadId
+//----------------------------------------------------------------------------
+std::thread::id Logger::GetThreadId()
+{
+	EnsureStarted();
+	return m_thread->get_id();
+}
+
+//----------------------------------------------------------------------------
+// GetCurrentThreadId
+//----------------------------------------------------------------------------
+std::thread::id Logger::GetCurrentThreadId()
+{
+	return this_thread::get_id();
+}
+
+//----------------------------------------------------------------------------
+// Shutdown
+//----------------------------------------------------------------------------
+Logger::ShutdownResult Logger::Shutdown(std::chrono::milliseconds timeout)
+{
+	// Put exit thread message into the queue behind the writes already taken. 
+	// Writes are rejected from now on, including blocked writers, and the 
+	// thread is not started again.
+	{
+		lock_guard<mutex> startLock(m_startMutex);
+		std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+		if (m_closing.load(std::memory_order_relaxed))
+			return m_shutdownResult;
+		m_shutdownDeadline = DelegateLib::Clock::Now() + timeout;
+		m_closing.store(true, std::memory_order_release);
+		m_spaceCv.notify_all();
+		if (m_thread)
+		{
+			m_queue.push(Msg{ MSG_EXIT_THREAD, {} });
+			Signal();
+		}
+	}
+
+	JoinLoop();
+	return m_shutdownResult;
+}
+
+//----------------------------------------------------------------------------
+// DiscardWrite
+//----------------------------------------------------------------------------
+bool Logger::DiscardWrite(Msg& msg)
+{
+	uint64_t count;
+	switch (msg.id)
+	{
+		case MSG_WRITE:
+			count = 1;
+			break;
+		case MSG_WRITE_BATCH:
+			count = std::get<std::vector<std::string>>(msg.data).size();
+			break;
+		case MSG_WRITE_CHUNK:
+			count = std::get<Msg::WriteChunk>(msg.data).count;
+			break;
+		case MSG_WRITE_DURABLE:
+			std::get<DurableWrite>(msg.data).promise.set_value(false);
+			count = 1;
+			break;
+		default:
+			return false;
+	}
+	m_shutdownResult.discarded += count;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// FinishShutdown
+//----------------------------------------------------------------------------
+void Logger::FinishShutdown(RingQueue<Msg>& batch, size_t next)
+{
+	auto expired = [this]() { return DelegateLib::Clock::Now() >= m_shutdownDeadline; };
+
+	// Lock-free writes made before Shutdown()
+	if (!expired())
+	{
+		DrainWriteQueue();
+		DrainSignalRing();
+		DrainCpuBuffers();
+	}
+	else
+		m_shutdownResult.discarded += m_writeQueue.Size();
+
+	// Complete the flushes in progress. Each completion is posted to the queue
+	// before the I/O thread goes idle, and may start the flush requested since.
+	while (m_logData.IsFlushing())
+	{
+		m_logData.WaitFlush();
+		RingQueue<Msg> rest;
+		{
+			std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+			rest.swap(m_queue);
+		}
+		bool completed = false;
+		for (; next < batch.size(); next++)
+		{
+			if (batch[next].id == MSG_FLUSH_COMPLETE)
+			{
+				FlushComplete(std::get<LogWriter::Result>(batch[next].data));
+				completed = true;
+			}
+		}
+		for (size_t i = 0; i < rest.size(); i++)
+		{
+			if (rest[i].id == MSG_FLUSH_COMPLETE)
+			{
+				FlushComplete(std::get<LogWriter::Result>(rest[i].data));
+				completed = true;
+			}
+		}
+		if (!completed)
+			break;
+	}
 
-private:
-	const int m_id;
-};
+	// Flush the remaining log data at once unless the deadline passed
+	bool flushed = !m_logData.IsFlushing();
+	if (flushed && m_logData.GetPendingRecords() > 0)
+	{
+		WriteRepeatCount();
+		flushed = !expired() && m_logData.Flush();
+	}
+	if (!flushed)
+		m_shutdownResult.unflushed = m_logData.GetPendingRecords();
 
-// Log message sent through worker thread message queue
-class LogMsg : public Msg
-{
-public:
-	LogMsg(int id, const std::string& data) : Msg(id), m_data(data) { }
-	const std::string& GetMsg() { return m_data; }
+	// Durable writes are confirmed by the final flush
+	for (auto& promise : m_durableFlushing)
+		promise.set_value(false);
+	for (auto& promise : m_durablePending)
+		promise.set_value(flushed);
+	m_durableFlushing.clear();
+	m_durablePending.clear();
 
-private:
-	const std::string m_data;
-};
+	m_shutdownResult.complete = m_shutdownResult.discarded == 0 && m_shutdownResult.unflushed == 0;
+}
 
 #ifdef IT_ENABLE
-// Delegate message sent through worker thread message queue
-class DelegateMsg : public Msg
+//----------------------------------------------------------------------------
+// ResetForTest
+//----------------------------------------------------------------------------
+void Logger::ResetForTest()
 {
-public:
-	DelegateMsg(int id, std::shared_ptr<DelegateLib::DelegateMsg> data) : Msg(id), m_data(data) { }
-	std::shared_ptr<DelegateLib::DelegateMsg> GetMsg() { return m_data; }
+	// Unsubscribe everything a test registered
+	SetCallback(nullptr);
+	{
+		std::lock_guard<std::mutex> lock(m_statusMutex);
+		for (auto& events : m_statusEvents)
+			events.Clear();
+		m_statusMask.store(0, std::memory_order_relaxed);
+	}
+	m_logData.FlushTimeDelegate.Clear();
 
-private:
-	std::shared_ptr<DelegateLib::DelegateMsg> m_data;
-};
+	// Start the next test with empty buffers. An asynchronous flush in progress 
+	// completes by its own message.
+	if (!m_logData.IsFlushing() && m_logData.GetPendingRecords() > 0)
+		m_logData.Flush();
+	m_logData.ClearMemory();
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void Logger::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	EnsureStarted();
+
+	// Add dispatch delegate msg to queue and notify worker thread
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_queue.push(Msg{ MSG_DISPATCH_DELEGATE, std::move(msg) });
+	Signal();
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegates
+//----------------------------------------------------------------------------
+void Logger::DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count)
+{
+	EnsureStarted();
+
+	// Add all dispatch delegate msgs to queue and notify worker thread once
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	for (size_t i = 0; i < count; i++)
+		m_queue.push(Msg{ MSG_DISPATCH_DELEGATE, std::move(msgs[i]) });
+	Signal();
+}
 #endif
 
 //----------------------------------------------------------------------------
-// GetInstance
+// Flush
 //----------------------------------------------------------------------------
-Logger& Logger::GetInstance()
+void Logger::Flush()
 {
-	static Logger instance;
-	return instance;
+	EnsureStarted();
+
+	// Messages staged by this thread are included in the flush
+	if (StagingBuffer* buffer = FindStagingBuffer())
+	{
+		std::unique_lock<std::mutex> lk(buffer->mutex);
+		HandOffStagingBuffer(*buffer);
+	}
+
+	// Add flush msg to queue and notify worker thread
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_queue.push(Msg{ MSG_FLUSH, {} });
+	Signal();
 }
 
 //----------------------------------------------------------------------------
-// Logger
+// SetFlushTrigger
 //----------------------------------------------------------------------------
-Logger::Logger() : m_thread(nullptr), m_timerExit(false), THREAD_NAME("LoggerThread")
+void Logger::SetFlushTrigger(const FlushTrigger& trigger)
 {
-	CreateThread();
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_flushTrigger = trigger;
 }
 
 //----------------------------------------------------------------------------
-// ~Logger
+// SetTrimPolicy
 //----------------------------------------------------------------------------
-Logger::~Logger()
+void Logger::SetTrimPolicy(const TrimPolicy& policy)
 {
-	ExitThread();
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	m_trimPolicy = policy;
 }
 
 //----------------------------------------------------------------------------
-// Write
+// TrimMemory
 //----------------------------------------------------------------------------
-void Logger::Write(const std::string& msg)
+void Logger::TrimMemory(RingQueue<Msg>& batch, const TrimPolicy& policy)
 {
-	ASSERT_TRUE(m_thread);
+	{
+		std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+		m_queue.Shrink(policy.queueLowWater);
+	}
+	batch.Shrink(policy.queueLowWater);
+	m_logData.Trim(policy.bufferLowWater);
 
-	// Create a write log message
-	std::shared_ptr<LogMsg> logMsg(new LogMsg(MSG_WRITE, msg));
+	// The lock-free write buffers hold the strings of the largest drain
+	if (m_drained.size() > policy.queueLowWater)
+		m_drained.resize(policy.queueLowWater);
+	m_drained.shrink_to_fit();
+	m_writeBatch.shrink_to_fit();
+	ReleaseFreeMemory();
+}
 
-	// Add message to queue and notify worker thread
-	std::unique_lock<std::mutex> lk(m_mutex);
-	m_queue.push(logMsg);
-	m_cv.notify_one();
+//----------------------------------------------------------------------------
+// GetFlushTrigger
+//----------------------------------------------------------------------------
+Logger::FlushTrigger Logger::GetFlushTrigger()
+{
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	return m_flushTrigger;
 }
 
 //----------------------------------------------------------------------------
-// CreateThread
+// FlushLogData
 //----------------------------------------------------------------------------
-bool Logger::CreateThread()
+void Logger::FlushLogData()
 {
-	if (!m_thread)
+	// Repeat counts are flushed with the message they follow
+	WriteRepeatCount();
+
+	// Hand the pending log data to the I/O thread. The write result is posted 
+	// back to the Logger thread so the client is notified on this thread.
+	// Durable writes in this flush window share a single sync
+	bool durable = !m_durablePending.empty();
+	bool started = m_logData.FlushAsync([this](const LogWriter::Result& result) {
+		std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+		m_queue.push(Msg{ MSG_FLUSH_COMPLETE, result });
+		Signal();
+	}, durable);
+
+	// Flush again once the flush in progress completes. Durable writes wait
+	// for the flush of the pending records, after the backlog is written.
+	if (!started)
+		m_flushRequested = true;
+	else if (!m_logData.IsFlushingBacklog())
+		std::swap(m_durableFlushing, m_durablePending);
+
+	// Data written after the buffer swap waits for a new deadline
+	m_flushDeadline.reset();
+}
+
+//----------------------------------------------------------------------------
+// FlushComplete
+//----------------------------------------------------------------------------
+void Logger::FlushComplete(const LogWriter::Result& result)
+{
+	bool success = m_logData.FlushComplete(result);
+
+	// Complete the durable writes within the flush window
+	for (auto& promise : m_durableFlushing)
+		promise.set_value(success);
+	m_durableFlushing.clear();
+	if (success)
 	{
-		m_thread = std::unique_ptr<std::thread>(new thread(&Logger::Process, this));
+		// Update the flush counters
+		m_flushedBytes.fetch_add(result.bytes, std::memory_order_relaxed);
+		size_t bucket = 0;
+		while (bucket < LATENCY_BUCKETS - 1 && result.elapsed.count() >= (1LL << bucket))
+			bucket++;
+		m_flushLatency[bucket].fetch_add(1, std::memory_order_relaxed);
 
-#ifdef WIN32
-		// Get the thread's native Windows handle
-		auto handle = m_thread->native_handle();
+		// Retune the latency deadline from this flush
+		if (m_adaptiveFlush)
+			m_flushInterval.store(m_flushTuner.Update(result.elapsed, result.bytes).count(), std::memory_order_relaxed);
 
-		// Set the thread name so it shows in the Visual Studio Debug Location toolbar
-		std::wstring wstr(THREAD_NAME.begin(), THREAD_NAME.end());
-		HRESULT hr = SetThreadDescription(handle, wstr.c_str());
-		if (FAILED(hr))
+		static DelegateLib::MetricHistogram& flushMetric = DelegateLib::Metrics::GetHistogram("logger.flush_latency_ns");
+		flushMetric.Record(result.elapsed);
+
+		// Notify client of success
+		PublishStatus(StatusInfo{ StatusEvent::FLUSH_SUCCESS, result.records, result.bytes });
+	}
+	else
+	{
+		// Notify client of failure
+		PublishStatus(StatusInfo{ StatusEvent::FLUSH_FAILURE, result.records, result.bytes });
+	}
+
+	if (m_flushRequested)
+	{
+		m_flushRequested = false;
+		FlushLogData();
+	}
+}
+
+//----------------------------------------------------------------------------
+// CheckFlushTrigger
+//----------------------------------------------------------------------------
+void Logger::CheckFlushTrigger(const FlushTrigger& trigger)
+{
+	m_adaptiveFlush = trigger.adaptive && trigger.maxLatency.count() > 0;
+	if (m_adaptiveFlush)
+	{
+		m_flushTuner.SetLimits(trigger.minLatency, trigger.maxLatency, trigger.adaptiveBatchBytes);
+		m_flushInterval.store(m_flushTuner.GetInterval().count(), std::memory_order_relaxed);
+	}
+	else
+		m_flushInterval.store(0, std::memory_order_relaxed);
+
+	if (m_logData.GetPendingRecords() == 0)
+	{
+		// Nothing to flush so wait for messages without a deadline
+		m_flushDeadline.reset();
+		return;
+	}
+
+	auto now = DelegateLib::Clock::Now();
+	bool latencyExpired = m_flushDeadline && now >= *m_flushDeadline;
+	bool bytesExceeded = trigger.maxBytes && m_logData.GetPendingBytes() >= trigger.maxBytes;
+	bool recordsExceeded = trigger.maxRecords && m_logData.GetPendingRecords() >= trigger.maxRecords;
+
+	// A flush in progress delays the next flush until it completes
+	if ((latencyExpired || bytesExceeded || recordsExceeded) && !m_logData.IsFlushing())
+		FlushLogData();
+
+	// Start the latency deadline when new data is pending
+	if (!m_flushDeadline && m_logData.GetPendingRecords() > 0 && trigger.maxLatency.count() > 0)
+		m_flushDeadline = now + (m_adaptiveFlush ? m_flushTuner.GetInterval() : trigger.maxLatency);
+}
+
+//----------------------------------------------------------------------------
+// WriteLogData
+//----------------------------------------------------------------------------
+void Logger::WriteLogData(const std::string_view* msgs, size_t count, bool collapse, bool record)
+{
+	// Drop or reroute the records matching the filter
+	if (m_filtering.load(std::memory_order_acquire))
+	{
+		std::shared_ptr<const LogFilter> filter = std::atomic_load(&m_filter);
+		if (filter)
 		{
-			// Handle error if needed
+			m_filterBatch.clear();
+			for (size_t i = 0; i < count; i++)
+			{
+				const LogFilter::Rule* rule = filter->Find(msgs[i]);
+				if (!rule || rule->route == this)
+					m_filterBatch.push_back(msgs[i]);
+				else if (rule->route)
+				{
+					if (rule->route->WriteRouted(std::string(msgs[i])))
+						m_routed.fetch_add(1, std::memory_order_relaxed);
+					else
+						m_routeDropped.fetch_add(1, std::memory_order_relaxed);
+				}
+				else
+					m_filtered.fetch_add(1, std::memory_order_relaxed);
+			}
+			msgs = m_filterBatch.data();
+			count = m_filterBatch.size();
+			if (count == 0)
+				return;
 		}
-#endif
 	}
+
+	if (!m_collapseRepeats.load(std::memory_order_relaxed))
+	{
+		// Write log data as a single batch
+		m_logData.WriteBatch(msgs, count, record);
+	}
+	else
+	{
+		// Write each run of distinct messages as a single batch
+		size_t start = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			uint64_t tick;
+			std::string_view body = LogTimestamp::Split(msgs[i], tick);
+			bool repeat = m_hasLastMsg && body == m_lastMsg;
+			if (repeat && collapse)
+			{
+				m_logData.WriteBatch(msgs + start, i - start, record);
+				start = i + 1;
+				m_repeats++;
+				m_collapsed.fetch_add(1, std::memory_order_relaxed);
+				continue;
+			}
+			if (!repeat)
+			{
+				if (m_repeats)
+				{
+					m_logData.WriteBatch(msgs + start, i - start, record);
+					start = i;
+					WriteRepeatCount();
+				}
+				m_lastMsg.assign(body.data(), body.size());
+				m_hasLastMsg = true;
+			}
+		}
+		m_logData.WriteBatch(msgs + start, count - start, record);
+	}
+
+	PublishWritten(count);
+}
+
+/// Check if a filter's routes lead to a Logger, directly or through the 
+/// filters of the Loggers routed to. A rule routing to the filter's own Logger
+/// keeps the record, so is not followed.
+/// @param[in] owner - the Logger the filter is set on
+/// @param[in] filter - the filter
+/// @param[in] target - the Logger searched for
+/// @param[in,out] visited - the Loggers already followed
+/// @return True if a route leads to target.
+static bool RoutesTo(const Logger* owner, const LogFilter& filter, const Logger* target, std::vector<const Logger*>& visited)
+{
+	for (const LogFilter::Rule& rule : filter.GetRules())
+	{
+		if (!rule.route || rule.route == owner)
+			continue;
+		if (rule.route == target)
+			return true;
+		if (std::find(visited.begin(), visited.end(), rule.route) != visited.end())
+			continue;
+		visited.push_back(rule.route);
+		std::shared_ptr<const LogFilter> next = rule.route->GetFilter();
+		if (next && RoutesTo(rule.route, *next, target, visited))
+			return true;
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+// SetFilter
+//----------------------------------------------------------------------------
+bool Logger::SetFilter(std::shared_ptr<const LogFilter> filter)
+{
+	// Filters are set one at a time so two filters set at once cannot close a cycle
+	std::lock_guard<std::mutex> lock(filterMutex);
+	std::vector<const Logger*> visited;
+	if (filter && RoutesTo(this, *filter, this, visited))
+		return false;
+
+	bool filtering = filter != nullptr;
+	std::atomic_store(&m_filter, std::move(filter));
+	m_filtering.store(filtering, std::memory_order_release);
 	return true;
 }
 
 //----------------------------------------------------------------------------
-// GetThreadId
+// PublishWritten
 //----------------------------------------------------------------------------
-std::thread::id Logger::GetThreadId()
+void Logger::PublishWritten(size_t count)
 {
-	ASSERT_TRUE(m_thread != nullptr);
-	return m_thread->get_id();
+	// Notify client of success once per batch or once per message
+	PublishStatus(StatusInfo{ StatusEvent::BATCH_WRITTEN, count, 0 });
+	if (IsSubscribed(StatusEvent::RECORD_WRITTEN) || (!m_coalesceStatus && m_pLoggerStatusCb.load(std::memory_order_acquire)))
+		PublishStatus(StatusInfo{ StatusEvent::RECORD_WRITTEN, 1, 0 }, count);
 }
 
 //----------------------------------------------------------------------------
-// GetCurrentThreadId
+// Subscribe
 //----------------------------------------------------------------------------
-std::thread::id Logger::GetCurrentThreadId()
+void Logger::Subscribe(StatusEvent event, const StatusDelegate& delegate)
 {
-	return this_thread::get_id();
+	const std::lock_guard<std::mutex> lock(m_statusMutex);
+	m_statusEvents[static_cast<size_t>(event)] += delegate;
+	m_statusMask.fetch_or(1u << static_cast<unsigned>(event), std::memory_order_relaxed);
 }
 
 //----------------------------------------------------------------------------
-// ExitThread
+// Unsubscribe
 //----------------------------------------------------------------------------
-void Logger::ExitThread()
+void Logger::Unsubscribe(StatusEvent event, const StatusDelegate& delegate)
 {
-	if (!m_thread)
+	const std::lock_guard<std::mutex> lock(m_statusMutex);
+	auto& subscribers = m_statusEvents[static_cast<size_t>(event)];
+	subscribers -= delegate;
+	if (subscribers.Empty())
+		m_statusMask.fetch_and(~(1u << static_cast<unsigned>(event)), std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// PublishStatus
+//----------------------------------------------------------------------------
+void Logger::PublishStatus(const StatusInfo& info, size_t repeat)
+{
+	// The legacy callback receives shared strings, one per record written
+	// unless coalesced, and nothing for batches
+	static const std::string WRITE_SUCCESS("Write success!");
+	static const std::string FLUSH_SUCCESS("Flush success!");
+	static const std::string FLUSH_FAILURE("Flush failure!");
+	const std::string* legacy = nullptr;
+	switch (info.event)
+	{
+	case StatusEvent::RECORD_WRITTEN: legacy = m_coalesceStatus ? nullptr : &WRITE_SUCCESS; break;
+	case StatusEvent::BATCH_WRITTEN: legacy = m_coalesceStatus ? &WRITE_SUCCESS : nullptr; break;
+	case StatusEvent::FLUSH_SUCCESS: legacy = &FLUSH_SUCCESS; break;
+	case StatusEvent::FLUSH_FAILURE: legacy = &FLUSH_FAILURE; break;
+	default: break;
+	}
+
+	bool subscribed = IsSubscribed(info.event);
+	LoggerStatusCb callback = legacy ? m_pLoggerStatusCb.load(std::memory_order_acquire) : nullptr;
+	if (!subscribed && !callback)
+		return;
+
+	// Queue the callback to the client thread instead of invoking it here
+	DelegateLib::DelegateThread* thread = m_statusThread.load(std::memory_order_acquire);
+	auto& subscribers = m_statusEvents[static_cast<size_t>(info.event)];
+	for (size_t i = 0; i < repeat; i++)
+	{
+		if (subscribed)
+			subscribers(info);
+		if (callback && thread)
+			DelegateLib::MakeDelegate(callback, *thread).AsyncInvoke(*legacy);
+		else if (callback)
+			callback(*legacy);
+	}
+}
+
+//----------------------------------------------------------------------------
+// WriteRepeatCount
+//----------------------------------------------------------------------------
+void Logger::WriteRepeatCount()
+{
+	if (m_repeats == 0)
 		return;
 
-	// Create an exit thread message
-	std::shared_ptr<Msg> msg(new Msg(MSG_EXIT_THREAD));
+	std::string msg = "Last message repeated " + std::to_string(m_repeats) + " times";
+	if (m_timestamps.load(std::memory_order_relaxed))
+		LogTimestamp::Stamp(msg);
+	m_logData.Write(msg);
+	m_repeats = 0;
+}
 
-	// Put exit thread message into the queue
+//----------------------------------------------------------------------------
+// DrainWriteQueue
+//----------------------------------------------------------------------------
+void Logger::DrainWriteQueue()
+{
+	// Pop all pending messages then write them as a single batch
+	size_t count = 0;
+	for (;; count++)
 	{
-		lock_guard<mutex> lock(m_mutex);
-		m_queue.push(msg);
-		m_cv.notify_one();
+		if (count == m_drained.size())
+			m_drained.emplace_back();
+		if (!m_writeQueue.TryPop(m_drained[count]))
+			break;
 	}
+	if (count == 0)
+		return;
+	m_enqueued.fetch_add(count, std::memory_order_relaxed);
 
-    m_thread->join();
-    m_thread = nullptr;
+	m_writeBatch.clear();
+	for (size_t i = 0; i < count; i++)
+		m_writeBatch.push_back(m_drained[i]);
+	WriteLogData(m_writeBatch.data(), m_writeBatch.size());
 }
 
 //----------------------------------------------------------------------------
-// DispatchDelegate
+// SetPerCpuWrite
 //----------------------------------------------------------------------------
-#ifdef IT_ENABLE
-void Logger::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+void Logger::SetPerCpuWrite(bool enable)
 {
-	ASSERT_TRUE(m_thread);
+	if (enable && !m_cpuBuffers)
+	{
+		m_cpuBufferCount = std::max(1u, std::thread::hardware_concurrency());
+		m_cpuBuffers.reset(new CpuBuffer[m_cpuBufferCount]);
+	}
+	m_perCpuWrite.store(enable, std::memory_order_relaxed);
+}
 
-	// Create a new ThreadMsg
-	std::shared_ptr<DelegateMsg> threadMsg(new DelegateMsg(MSG_DISPATCH_DELEGATE, msg));
+//----------------------------------------------------------------------------
+// WritePerCpu
+//----------------------------------------------------------------------------
+void Logger::WritePerCpu(std::string&& msg)
+{
+	CpuBuffer& buffer = m_cpuBuffers[GetCurrentCpu() % m_cpuBufferCount];
+	while (buffer.busy.exchange(true, std::memory_order_acquire))
+		std::this_thread::yield();
+	buffer.msgs.push_back(std::move(msg));
+	bool wasEmpty = buffer.msgs.size() == 1;
+	if (wasEmpty)
+		buffer.pending.store(true, std::memory_order_relaxed);
+	buffer.busy.store(false, std::memory_order_release);
 
-	// Add dispatch delegate msg to queue and notify worker thread
-	std::unique_lock<std::mutex> lk(m_mutex);
-	m_queue.push(threadMsg);
-	m_cv.notify_one();
+	// The Logger thread takes every message of a buffer at once so it is only
+	// woken for the first
+	if (wasEmpty)
+		NotifyWaiting();
+}
+
+//----------------------------------------------------------------------------
+// HasCpuMessages
+//----------------------------------------------------------------------------
+bool Logger::HasCpuMessages() const
+{
+	for (size_t i = 0; i < m_cpuBufferCount; i++)
+	{
+		if (m_cpuBuffers[i].pending.load(std::memory_order_relaxed))
+			return true;
+	}
+	return false;
 }
-#endif
 
 //----------------------------------------------------------------------------
-// TimerThread
+// DrainCpuBuffers
 //----------------------------------------------------------------------------
-void Logger::TimerThread()
+void Logger::DrainCpuBuffers()
 {
-	// Generate timer messages until exit
-    while (!m_timerExit)
-    {
-		// Insert a timer message every 1000ms
-        std::this_thread::sleep_for(1000ms);
+	if (!m_cpuBufferCount)
+		return;
+
+	size_t first = m_cpuDrainNext;
+	m_cpuDrainNext = (first + 1) % m_cpuBufferCount;
+	for (size_t n = 0; n < m_cpuBufferCount; n++)
+	{
+		CpuBuffer& buffer = m_cpuBuffers[(first + n) % m_cpuBufferCount];
+		if (!buffer.pending.load(std::memory_order_relaxed))
+			continue;
+
+		// Swapped so both vectors keep their capacity
+		while (buffer.busy.exchange(true, std::memory_order_acquire))
+			std::this_thread::yield();
+		m_cpuDrained.swap(buffer.msgs);
+		buffer.pending.store(false, std::memory_order_relaxed);
+		buffer.busy.store(false, std::memory_order_release);
 
-		// Create a timer message
-        std::shared_ptr<Msg> msg(new Msg(MSG_TIMER));
+		m_enqueued.fetch_add(m_cpuDrained.size(), std::memory_order_relaxed);
+		m_writeBatch.clear();
+		for (const std::string& str : m_cpuDrained)
+			m_writeBatch.push_back(str);
+		WriteLogData(m_writeBatch.data(), m_writeBatch.size());
+		m_cpuDrained.clear();
+	}
+}
+
+//----------------------------------------------------------------------------
+// DrainSignalRing
+//----------------------------------------------------------------------------
+void Logger::DrainSignalRing()
+{
+	size_t count = 0;
+	for (;; count++)
+	{
+		if (count == m_drained.size())
+			m_drained.emplace_back();
+		if (!m_signalRing.TryPop(m_drained[count]))
+			break;
+	}
+	if (count == 0)
+		return;
+	m_enqueued.fetch_add(count, std::memory_order_relaxed);
 
-        // Add timer message to queue and notify worker thread
-        std::unique_lock<std::mutex> lk(m_mutex);
-        m_queue.push(msg);
-        m_cv.notify_one();
-    }
+	m_writeBatch.clear();
+	for (size_t i = 0; i < count; i++)
+		m_writeBatch.push_back(m_drained[i]);
+	WriteLogData(m_writeBatch.data(), m_writeBatch.size());
 }
 
 //----------------------------------------------------------------------------
@@ -197,85 +1722,243 @@ void Logger::TimerThread()
 //----------------------------------------------------------------------------
 void Logger::Process()
 {
-    m_timerExit = false;
-    std::thread timerThread(&Logger::TimerThread, this);
+	TRACE_THREAD_NAME(THREAD_NAME);
+
+	// Messages taken from the queue for local processing. Swapped with the
+	// queue, so both keep their buffers.
+	RingQueue<Msg> batch;
+	batch.Reserve(QUEUE_RESERVE);
 
 	while (1)
 	{
-		std::shared_ptr<Msg> msg;
+		m_heartbeat.Idle();
+		FlushTrigger trigger;
+		TrimPolicy trimPolicy;
+		bool trimDue = false;
+		bool collectStaging = false;
+		bool closing = false;
 		{
-			// Wait for a message to be added to the queue
-			std::unique_lock<std::mutex> lk(m_mutex);
-			while (m_queue.empty())
-				m_cv.wait(lk);
+			// Wait for a message to be added to either queue or the flush deadline.
+			// With no data pending there is no deadline and the thread sleeps until
+			// a message arrives. While a flush is in progress the deadline is 
+			// ignored since the flush completion message wakes the thread.
+			std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+			auto deadline = m_logData.IsFlushing() ? std::nullopt : m_flushDeadline;
+			if (m_stagingDeadline && (!deadline || *m_stagingDeadline < *deadline))
+				deadline = m_stagingDeadline;
+			if (m_trimDeadline && (!deadline || *m_trimDeadline < *deadline))
+				deadline = m_trimDeadline;
 
-			if (m_queue.empty())
-				continue;
+			// Signal handlers cannot notify the condition variable so their
+			// slots are polled
+			if (m_signalRing.Capacity() > 0)
+			{
+				auto poll = DelegateLib::Clock::Now() + SIGNAL_POLL_INTERVAL;
+				if (!deadline || poll < *deadline)
+					deadline = poll;
+			}
+
+			// A producer setting an earlier staging deadline also wakes the thread,
+			// as does advancing a virtual clock
+			uint64_t advances = DelegateLib::Clock::GetAdvances();
+			auto ready = [this, &deadline, advances]() { 
+				return !m_queue.empty() || !m_writeQueue.Empty() || !m_signalRing.Empty() || HasCpuMessages() ||
+					(m_stagingDeadline && (!deadline || *m_stagingDeadline < *deadline)) ||
+					DelegateLib::Clock::GetAdvances() != advances;
+			};
+
+			// Poll without the lock if the wait strategy spins. Any Signal() or 
+			// lock-free write ends the poll.
+			uint64_t signals = m_signals.load(std::memory_order_relaxed);
+			WaitReady(lk, deadline ? DelegateLib::Clock::ToSteady(*deadline) : std::chrono::steady_clock::time_point::max(),
+				ready, [this, signals]() {
+					return m_signals.load(std::memory_order_relaxed) != signals || !m_writeQueue.Empty() || 
+						!m_signalRing.Empty() || HasCpuMessages();
+				});
+
+			// Collect staging buffers once the oldest staged message is due
+			if (m_stagingDeadline && DelegateLib::Clock::Now() >= *m_stagingDeadline)
+			{
+				m_stagingDeadline.reset();
+				collectStaging = true;
+			}
 
-			msg = m_queue.front();
-			m_queue.pop();
+			trigger = m_flushTrigger;
+			trimPolicy = m_trimPolicy;
+			trimDue = m_trimDeadline && DelegateLib::Clock::Now() >= *m_trimDeadline;
+
+			// Take all pending messages with a single lock acquisition
+			batch.swap(m_queue);
+			closing = m_closing.load(std::memory_order_acquire);
+			m_queueDepth.store(0, std::memory_order_relaxed);
+			m_queueBytes.store(0, std::memory_order_relaxed);
+			m_spaceCv.notify_all();
 		}
+		TRACE_SCOPE("Logger::Process");
+
+		// Lock-free writes queued before these messages are processed first
+		m_heartbeat.Busy(MSG_WRITE);
+		uint64_t enqueued = m_enqueued.load(std::memory_order_relaxed);
+		DrainWriteQueue();
+		DrainSignalRing();
+		DrainCpuBuffers();
+		bool active = !batch.empty() || m_enqueued.load(std::memory_order_relaxed) != enqueued;
 
-		switch (msg->GetId())
+		for (size_t i = 0; i < batch.size(); i++)
 		{
-			case MSG_WRITE:
+			Msg& msg = batch[i];
+			m_heartbeat.Beat(msg.id);
+
+			// Writes still queued once the Shutdown() deadline passed are discarded
+			if (closing && DelegateLib::Clock::Now() >= m_shutdownDeadline && DiscardWrite(msg))
+				continue;
+			switch (msg.id)
 			{
-				// Cast base pointer to LogMsg
-				std::shared_ptr<LogMsg> logMsg = std::static_pointer_cast<LogMsg>(msg);
+				case MSG_WRITE:
+				{
+					// Append consecutive write messages to the log data as one batch
+					m_writeBatch.clear();
+					for (; i < batch.size() && batch[i].id == MSG_WRITE; i++)
+						m_writeBatch.push_back(std::get<std::string>(batch[i].data));
+					i--;
 
-				// Write log data
-				m_logData.Write(logMsg->GetMsg());
+					// Write log data and notify client
+					WriteLogData(m_writeBatch.data(), m_writeBatch.size());
+					break;
+				}
 
-				// Notify client of success
-				if (m_pLoggerStatusCb)
-					m_pLoggerStatusCb("Write success!");
-				break;
-			}
+				case MSG_WRITE_BATCH:
+				{
+					// Append a staging buffer to the log data as one batch
+					m_writeBatch.clear();
+					for (const std::string& str : std::get<std::vector<std::string>>(msg.data))
+						m_writeBatch.push_back(str);
 
-            case MSG_TIMER:
-			{
-				// Flush data to disk when timer expires
-				bool success = m_logData.Flush();
-				if (success)
+					// Write log data and notify client
+					WriteLogData(m_writeBatch.data(), m_writeBatch.size());
+					break;
+				}
+
+				case MSG_WRITE_CHUNK:
 				{
-					// Notify client of success
-					if (m_pLoggerStatusCb)
-						m_pLoggerStatusCb("Flush success!");
+					// Append the records framed by an assisting producer with a
+					// single copy. Collapsing repeats or filtering reads each record.
+					auto& chunk = std::get<Msg::WriteChunk>(msg.data);
+					if (m_collapseRepeats.load(std::memory_order_relaxed) || m_filtering.load(std::memory_order_relaxed))
+					{
+						m_writeBatch.clear();
+						LogBuffer::ForEachFramed(chunk.records, [this](std::string_view record) { m_writeBatch.push_back(record); });
+						WriteLogData(m_writeBatch.data(), m_writeBatch.size());
+					}
+					else
+					{
+						m_logData.WriteFramed(chunk.records, chunk.count);
+						PublishWritten(chunk.count);
+					}
+					break;
 				}
-				else
+
+				case MSG_WRITE_DURABLE:
 				{
-					// Notify client of failure
-					if (m_pLoggerStatusCb)
-						m_pLoggerStatusCb("Flush failure!");
+					// A durable message is written with the recorded context. Only the
+					// first durable write after other records finds any to dump, as the
+					// durable messages themselves are written past the recorder.
+					auto& durable = std::get<DurableWrite>(msg.data);
+					WriteRepeatCount();
+					if (m_logData.GetRecordedRecords() > 0)
+						m_logData.DumpFlightRecorder();
+
+					// Write log data then group commit with the next flush
+					std::string_view str = durable.msg;
+					WriteLogData(&str, 1, false, false);
+					m_durablePending.push_back(std::move(durable.promise));
+					break;
 				}
-				break;
-			}
 
-#ifdef IT_ENABLE
-			case MSG_DISPATCH_DELEGATE:
-			{
-				// Cast pointer to a DelegateMsg
-				std::shared_ptr<DelegateMsg> delegateMsg = std::static_pointer_cast<DelegateMsg>(msg);
+				case MSG_SET_RECORDER:
+				{
+					m_logData.SetFlightRecorder(m_recorderBytes.load(std::memory_order_relaxed));
+					break;
+				}
 
-				// Get the delegate message base
-				auto delegateMsgBase = delegateMsg->GetMsg();
+				case MSG_SET_FORMAT:
+				{
+					m_logData.SetOutputFormat(m_outputFormat.load(std::memory_order_relaxed));
+					break;
+				}
 
-				// Invoke the delegate target function on the target thread context
-				delegateMsgBase->GetDelegateInvoker()->Invoke(delegateMsgBase);
-				break;
-			}
+				case MSG_DUMP_RECORDER:
+				{
+					// Write the recorded log data on client request
+					if (m_logData.DumpFlightRecorder())
+						FlushLogData();
+					break;
+				}
+
+				case MSG_FLUSH:
+				{
+					// Flush data to disk on client request
+					FlushLogData();
+					break;
+				}
+
+				case MSG_FLUSH_COMPLETE:
+				{
+					// Flush to disk completed on the I/O thread
+					FlushComplete(std::get<LogWriter::Result>(msg.data));
+					break;
+				}
+
+#ifdef IT_ENABLE
+				case MSG_DISPATCH_DELEGATE:
+				{
+					// Get the delegate message base
+					auto& delegateMsgBase = std::get<std::shared_ptr<DelegateLib::DelegateMsg>>(msg.data);
+
+					// Invoke the delegate target function on the target thread context
+					// unless its sender cancelled it while queued
+					if (!delegateMsgBase->IsCancelled())
+					{
+						DelegateLib::TraceContextScope traceScope(delegateMsgBase->GetTraceContext());
+						delegateMsgBase->GetDelegateInvoker()->Invoke(delegateMsgBase);
+					}
+					break;
+				}
 #endif
 
-			case MSG_EXIT_THREAD:
-			{
-				m_timerExit = true;
-				timerThread.join();
-				return;
+				case MSG_EXIT_THREAD:
+				{
+					// Let the I/O thread finish writing before the Logger is destroyed
+					FinishShutdown(batch, i + 1);
+					return;
+				}
+
+				default:
+					ASSERT();
 			}
+		}
+		batch.clear();
 
-			default:
-				ASSERT();
+		// Trim once no message arrived for the quiet period
+		if (active && trimPolicy.quietPeriod.count() > 0)
+			m_trimDeadline = DelegateLib::Clock::Now() + trimPolicy.quietPeriod;
+		else if (active)
+			m_trimDeadline.reset();
+		else if (trimDue)
+		{
+			m_trimDeadline.reset();
+			TrimMemory(batch, trimPolicy);
 		}
+
+		// Flush when a flush trigger fires
+		CheckFlushTrigger(trigger);
+
+		// Durable writes are flushed without waiting for a flush trigger
+		if (!m_durablePending.empty() && !m_logData.IsFlushing())
+			FlushLogData();
+
+		// Staged messages handed off here are processed on the next iteration
+		if (collectStaging)
+			CollectStagingBuffers();
 	}
 }
-
@@ -2,62 +2,929 @@
 #define _LOGGER_H
 
 #include "LogData.h"
+#include "LogRecord.h"
+#include "LogCallSite.h"
+#include "LogTimestamp.h"
+#include "LogContext.h"
+#include "LogRateLimiter.h"
+#include "LogFilter.h"
+#include "LogFlushTuner.h"
+#include "LogSignalRing.h"
+#include "LogLevel.h"
+#include "LockFreeQueue.h"
+#include "ThreadAttributes.h"
+#include "ActiveObject.h"
+#include "RingQueue.h"
+#include "MemoryTrim.h"
+#include "DelegateLib.h"
 #include <thread>
-#include <queue>
+#include <vector>
+#include <string_view>
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
+#include <variant>
+#include <optional>
+#include <chrono>
+#include <future>
+#include <utility>
 #include "IT_Client.h"
 
-class Msg;
+/// @brief Message sent through the Logger thread message queue. The payload is
+/// stored in place within the queue slot so no per-message heap allocation is
+/// required.
+struct LoggerMsg
+{
+	/// A durable write message and the writer's completion
+	struct DurableWrite
+	{
+		std::string msg;
+		std::promise<bool> promise;
+	};
+
+	/// Records framed into one chunk by an assisting producer
+	struct WriteChunk
+	{
+		std::string records;
+		size_t count;
+	};
+
+#ifdef IT_ENABLE
+	typedef std::variant<std::monostate, std::string, std::vector<std::string>, LogWriter::Result,
+		DurableWrite, WriteChunk, std::shared_ptr<DelegateLib::DelegateMsg>> Data;
+#else
+	typedef std::variant<std::monostate, std::string, std::vector<std::string>, LogWriter::Result,
+		DurableWrite, WriteChunk> Data;
+#endif
+
+	int id;
+	Data data;
+};
 
 /// @brief The Logger subsystem public interface class. Logger runs in its own
 /// thread of control. 
-class Logger 
+///
+/// @details GetInstance() is the default instance writing LogData.txt. Further
+/// instances each own a thread, message queue, flush trigger and LogData files,
+/// so logging scales across cores. SetComponentLogger() routes the LOG_WRITE 
+/// messages of a component to an instance and SetLevelLogger() those of a 
+/// severity, e.g. errors to a small file flushed at once while traces batch 
+/// into a bulk file with a long flush latency. LogMerge combines the 
+/// timestamped output of several instances in time order.
+///
+/// Constructing a Logger allocates nothing on the hot path and spawns no 
+/// thread. The Logger thread starts on the first write, or when Start() is 
+/// called, which also preallocates buffers, opens the log file and warms up 
+/// the write path so the first write after boot avoids those costs.
+class Logger : private ActiveObject<LoggerMsg, RingQueue<LoggerMsg>>
 #ifdef IT_ENABLE
-	: public DelegateLib::DelegateThread
+	, public DelegateLib::DelegateThread
 #endif
 {
 public:
 	typedef void (*LoggerStatusCb)(const std::string& status);
 
-	/// Get the singleton logger instance
+	/// Typed status events published by the Logger thread
+	enum class StatusEvent
+	{
+		RECORD_WRITTEN,		///< One event per record added to the log data.
+		BATCH_WRITTEN,		///< One event per batch of records added to the log data.
+		FLUSH_SUCCESS,		///< The pending log data was written to disk.
+		FLUSH_FAILURE,		///< Writing the pending log data to disk failed.
+		COUNT
+	};
+
+	/// Status event details. Passed by reference, so publishing allocates nothing.
+	struct StatusInfo
+	{
+		StatusEvent event;
+
+		/// The records written, 1 for RECORD_WRITTEN
+		size_t records;
+
+		/// The bytes written to disk, or 0 for the write events
+		size_t bytes;
+	};
+
+	typedef DelegateLib::Delegate<void(const StatusInfo&)> StatusDelegate;
+	typedef LockFreeQueue<std::string>::OverflowPolicy OverflowPolicy;
+
+	/// Capacity of the lock-free write queue
+	static constexpr size_t WRITE_QUEUE_CAPACITY = 4096;
+
+	/// Message queue slots preallocated when the Logger thread is created. A
+	/// larger queue capacity set by SetQueueCapacity() is preallocated instead.
+	static constexpr size_t QUEUE_RESERVE = 1024;
+
+	/// Longest time a record written by WriteFromSignal() waits for the Logger
+	/// thread, which a signal handler cannot wake
+	static constexpr std::chrono::milliseconds SIGNAL_POLL_INTERVAL{ 20 };
+
+	/// Default number of messages held by a per-thread staging buffer
+	static constexpr size_t STAGING_CAPACITY = 64;
+
+	/// Default record bytes framed into a chunk by an assisting producer
+	static constexpr size_t ASSIST_CHUNK_BYTES = 16 * 1024;
+
+	/// Number of components with a runtime level threshold
+	static constexpr size_t MAX_COMPONENTS = 32;
+
+	/// Number of flush latency histogram buckets
+	static constexpr size_t LATENCY_BUCKETS = 12;
+
+	/// Action taken by Write() when the message queue is at capacity
+	enum class BackpressurePolicy
+	{
+		BLOCK,		///< Wait until the Logger thread takes the queued messages.
+		DROP,		///< Discard the new message.
+		SAMPLE		///< Keep one in every sample rate messages and discard the rest.
+	};
+
+	/// Snapshot of the Logger counters. Each counter is read with a relaxed 
+	/// atomic load so the counters are not a consistent snapshot of one instant.
+	struct Stats
+	{
+		/// Write messages currently queued for the Logger thread
+		size_t queueDepth = 0;
+
+		/// Highest queue depth seen
+		size_t peakQueueDepth = 0;
+
+		/// Message bytes of the write messages currently queued, charged against
+		/// the SetQueueByteBudget() budget. Lock-free writes are not counted.
+		size_t queueBytes = 0;
+
+		/// Write messages accepted into the queues
+		uint64_t enqueued = 0;
+
+		/// Write messages discarded by backpressure or written after Shutdown()
+		uint64_t dropped = 0;
+
+		/// Bytes written to disk by flushes
+		uint64_t flushedBytes = 0;
+
+		/// Write messages discarded by the rate limiter
+		uint64_t rateLimited = 0;
+
+		/// Repeated messages collapsed into a repeat count
+		uint64_t collapsed = 0;
+
+		/// Write messages framed into chunks by assisting producers
+		uint64_t assisted = 0;
+
+		/// Records dropped and records rerouted by the SetFilter() filter, and 
+		/// rerouted records dropped since the rule's Logger queue was full
+		uint64_t filtered = 0;
+		uint64_t routed = 0;
+		uint64_t routeDropped = 0;
+
+		/// Wakeups of the sleeping Logger thread, and queued messages and
+		/// signals that found it awake and so made none
+		uint64_t wakeups = 0;
+		uint64_t wakeupsAvoided = 0;
+
+		/// Flush latency histogram. Bucket 0 counts flushes under 1mS and bucket
+		/// i counts flushes under 2^i mS. The last bucket counts all longer flushes.
+		uint64_t flushLatency[LATENCY_BUCKETS] = {};
+
+		/// Latency deadline chosen by the adaptive flush tuning, or 0 if not used
+		std::chrono::milliseconds flushInterval = std::chrono::milliseconds(0);
+	};
+
+	/// Outcome of Shutdown()
+	struct ShutdownResult
+	{
+		/// True if every message written before Shutdown() was flushed to disk
+		/// within the deadline
+		bool complete = true;
+
+		/// Messages queued before Shutdown() and discarded once the deadline passed
+		uint64_t discarded = 0;
+
+		/// Messages written to the log data but not flushed to disk, since the
+		/// deadline passed or the final flush failed
+		uint64_t unflushed = 0;
+	};
+
+	/// Conditions that trigger a flush of pending log data to disk. A zero 
+	/// value disables the trigger.
+	struct FlushTrigger
+	{
+		/// Maximum time a written message waits before being flushed
+		std::chrono::milliseconds maxLatency = std::chrono::milliseconds(1000);
+
+		/// Flush when the pending log data reaches this many bytes
+		size_t maxBytes = 0;
+
+		/// Flush when the pending log data reaches this many records
+		size_t maxRecords = 0;
+
+		/// Tune the latency deadline between minLatency and maxLatency from the
+		/// measured flush times and batch sizes instead of always waiting 
+		/// maxLatency. See LogFlushTuner.
+		bool adaptive = false;
+
+		/// Shortest latency deadline chosen by the adaptive tuning
+		std::chrono::milliseconds minLatency = std::chrono::milliseconds(10);
+
+		/// Bytes per flush above which the adaptive tuning lengthens the deadline
+		size_t adaptiveBatchBytes = 64 * 1024;
+	};
+
+	/// Startup options for Start()
+	struct StartConfig
+	{
+		/// Start the Logger thread now instead of on the first write
+		bool eager = true;
+
+		/// Log buffer bytes allocated and touched before the first write
+		size_t bufferBytes = 0;
+
+		/// Open the log file now and reserve this many bytes of file extents 
+		/// ahead of the data, or 0 to open it on the first flush
+		size_t fileExtent = 0;
+
+		/// Calibrate the timestamp clock and run the rendering path once
+		bool warmUp = true;
+
+		/// Back the log buffers and the flight recorder with huge pages where
+		/// available. Use with a large bufferBytes. See HugePages.
+		bool hugePages = false;
+
+		/// Allocate the log buffers from this memory resource instead, e.g. a
+		/// bounded arena, or nullptr for the default. Used by the Logger thread
+		/// only. Must outlive the Logger. See LogData::SetMemoryResource().
+		std::pmr::memory_resource* memoryResource = nullptr;
+
+		/// Journal the records not yet flushed to a memory-mapped file of this
+		/// many bytes, and replay the records a previous process left there, so
+		/// long flush intervals lose nothing on a restart. 0 disables the
+		/// journal. See LogData::SetJournal().
+		size_t journalBytes = 0;
+
+		/// Preallocate this many WriteFromSignal() record slots, or 0 to disable
+		/// WriteFromSignal(). While enabled the Logger thread polls the slots
+		/// every SIGNAL_POLL_INTERVAL.
+		size_t signalSlots = 0;
+	};
+
+	/// A record buffer reserved by Reserve(). The caller formats the message into
+	/// Data() and passes the slot to Commit(), which queues the buffer itself so
+	/// the message bytes are never copied. A slot not committed is discarded.
+	class WriteSlot
+	{
+	public:
+		WriteSlot() = default;
+		WriteSlot(WriteSlot&& other) noexcept :
+			m_logger(std::exchange(other.m_logger, nullptr)), m_record(std::move(other.m_record)), m_offset(other.m_offset) { }
+		WriteSlot& operator=(WriteSlot&& other) noexcept
+		{
+			m_logger = std::exchange(other.m_logger, nullptr);
+			m_record = std::move(other.m_record);
+			m_offset = other.m_offset;
+			return *this;
+		}
+
+		/// Get the message buffer
+		/// @return The first byte of the message, or nullptr if not reserved.
+		char* Data() { return m_logger ? &m_record[m_offset] : nullptr; }
+
+		/// Get the message buffer size
+		/// @return The maximum message length in bytes.
+		size_t Capacity() const { return m_logger ? m_record.size() - m_offset : 0; }
+
+		/// Check if the slot is reserved and not yet committed
+		explicit operator bool() const { return m_logger != nullptr; }
+
+	private:
+		friend class Logger;
+
+		/// The reserving instance, or nullptr once committed
+		Logger* m_logger = nullptr;
+
+		/// The record, with room for the timestamp prefix if m_offset is set
+		std::string m_record;
+		size_t m_offset = 0;
+	};
+
+	/// Maximum number of instances flushed by EmergencyFlush()
+	static constexpr size_t MAX_INSTANCES = 32;
+
+	/// Get the default logger instance
 	static Logger& GetInstance();
 
+	/// Create a logger instance with its own thread and log files
+	/// @param[in] name - the log file base name, e.g. "Network" writes Network.txt.
+	///     The thread is named <name>Thread.
+	explicit Logger(const std::string& name);
+
+	/// Destructor. Calls Shutdown() with the timeout set by SetShutdownTimeout().
+	~Logger();
+
+	/// Prepare the logger and optionally start its thread. Buffers and the log
+	/// file are only prepared if the Logger thread has not started. Function 
+	/// call is thread-safe.
+	/// @param[in] config - the startup options
+	void Start(const StartConfig& config);
+
+	/// Start the Logger thread now with the default startup options
+	void Start();
+
+	/// Check if the Logger thread has started
+	/// @return True if started.
+	bool IsStarted() const { return m_started.load(std::memory_order_acquire); }
+
+	/// Route the LOG_WRITE messages of a component to a logger instance. 
+	/// Function call is thread-safe.
+	/// @param[in] component - the component
+	/// @param[in] logger - the instance, or nullptr for the default instance. 
+	///     Must be reset to nullptr before the instance is destroyed.
+	static void SetComponentLogger(LogComponent component, Logger* logger);
+
+	/// Get the logger instance of a component. Function call is thread-safe.
+	/// @param[in] component - the component
+	/// @return The instance set by SetComponentLogger() or the default instance.
+	static Logger& ForComponent(LogComponent component)
+	{
+		Logger* logger = component < MAX_COMPONENTS ? m_componentLoggers[component].load(std::memory_order_acquire) : nullptr;
+		return logger ? *logger : GetInstance();
+	}
+
+	/// Route the LOG_WRITE messages at or above a level to a logger instance,
+	/// whichever component writes them. A level route takes precedence over a
+	/// component route. Routing a higher level afterwards splits the range, e.g.
+	/// Warning to one instance then Error to another. Function call is 
+	/// thread-safe.
+	/// @param[in] minLevel - the lowest level routed
+	/// @param[in] logger - the instance, or nullptr to remove the level route. 
+	///     Must be reset to nullptr before the instance is destroyed.
+	static void SetLevelLogger(LogLevel minLevel, Logger* logger);
+
+	/// Get the logger instance of a message. Function call is thread-safe.
+	/// @param[in] level - the message level
+	/// @param[in] component - the component writing the message
+	/// @return The instance set by SetLevelLogger(), else ForComponent().
+	static Logger& ForRecord(LogLevel level, LogComponent component)
+	{
+		Logger* logger = level < LogLevel::Off ? m_levelLoggers[static_cast<size_t>(level)].load(std::memory_order_acquire) : nullptr;
+		return logger ? *logger : ForComponent(component);
+	}
+
+	/// Set the Logger thread CPU affinity, scheduling, stack size and NUMA 
+	/// placement. Call before the first GetInstance() call to apply all 
+	/// attributes at thread creation. Once the thread is running, all but the
+	/// stack size are applied immediately.
+	/// @param[in] attributes - the thread attributes
+	/// @return True if the attributes were stored and any immediate apply succeeded.
+	static bool SetThreadAttributes(const ThreadAttributes& attributes);
+
+	/// Set how the Logger thread waits for messages while idle. Defaults to
+	/// WaitPolicy::BLOCK. Function call is thread-safe.
+	/// @param[in] strategy - the wait strategy
+	void SetWaitStrategy(const WaitStrategy& strategy) { m_spinWait.SetStrategy(strategy); }
+
+	/// Get the idle wait strategy
+	WaitStrategy GetWaitStrategy() const { return m_spinWait.GetStrategy(); }
+
+	/// Write a message to the log. The characters are copied once, directly into
+	/// the queued record, so callers holding a char buffer or string_view need 
+	/// not build a std::string. Function call is thread-safe. 
+	/// @param[in] msg - the message string to write
+	void Write(std::string_view msg) { WriteParts(&msg, 1); }
+
 	/// Write a message to the log. Function call is thread-safe. 
+	/// @param[in] msg - the null terminated message string to write
+	void Write(const char* msg) { Write(std::string_view(msg)); }
+
+	/// Write a message gathered from several parts to the log as one record. The
+	/// parts are copied once into the queued record. Function call is thread-safe.
+	/// @param[in] parts - the message parts, written in order without separators
+	/// @param[in] count - the number of parts
+	void Write(const std::string_view* parts, size_t count) { WriteParts(parts, count); }
+
+	/// Write a message to the log. The message string is moved into the 
+	/// message queue. Function call is thread-safe. 
+	/// @param[in] msg - the message string to write
+	void Write(std::string&& msg);
+
+	/// Write a structured message to the log. The format string ID and arguments
+	/// are stored in a binary record and rendered to text when flushed to disk.
+	/// Function call is thread-safe. 
+	/// @param[in] format - the printf-style format string. Must have static 
+	///     storage duration.
+	/// @param[in] args - the format arguments. Integral, floating point and 
+	///     string types are supported.
+	template <typename... Args>
+	void Write(const LogFormat& format, const Args&... args)
+	{
+		// Structured messages are rate limited per call site before encoding
+		if (m_rateLimit.load(std::memory_order_relaxed) && !AdmitRate(LogRateLimiter::Hash(format.format)))
+			return;
+		std::string record;
+		LogRecord::Encode(record, format, args...);
+		WriteMsg(std::move(record));
+	}
+
+	/// Check if a message would be written. A single relaxed atomic load so it 
+	/// is cheap enough to call before building the message. Function call is 
+	/// thread-safe.
+	/// @param[in] level - the message level
+	/// @param[in] component - the component writing the message
+	/// @return True if the level meets the component threshold.
+	bool IsEnabled(LogLevel level, LogComponent component = 0) const
+	{
+		if (!IsLogLevelCompiled(level) || component >= MAX_COMPONENTS)
+			return false;
+		return static_cast<uint8_t>(level) >= m_levels[component].load(std::memory_order_relaxed);
+	}
+
+	/// Write a message to the log if the level meets the component threshold.
+	/// Function call is thread-safe. Use LOG_WRITE to also skip building the 
+	/// message and to compile away levels below LOGGER_MIN_LEVEL.
+	/// @param[in] level - the message level
+	/// @param[in] component - the component writing the message
+	/// @param[in] msg - the message string to write
+	void Write(LogLevel level, LogComponent component, std::string_view msg)
+	{
+		if (!IsEnabled(level, component))
+			return;
+		if (m_recordContext.load(std::memory_order_relaxed))
+		{
+			// The context precedes the message within the record
+			char context[LogContext::PREFIX_SIZE];
+			LogContext::WritePrefix(context, level, component);
+			std::string_view parts[] = { std::string_view(context, sizeof(context)), msg };
+			WriteParts(parts, 2);
+		}
+		else
+			Write(msg);
+		if (IsDumpLevel(level))
+			DumpFlightRecorder();
+	}
+
+	/// Write a structured message to the log if the level meets the component 
+	/// threshold. Function call is thread-safe. 
+	/// @param[in] level - the message level
+	/// @param[in] component - the component writing the message
+	/// @param[in] format - the printf-style format string. Must have static 
+	///     storage duration.
+	/// @param[in] args - the format arguments
+	template <typename... Args>
+	void Write(LogLevel level, LogComponent component, const LogFormat& format, const Args&... args)
+	{
+		if (!IsEnabled(level, component))
+			return;
+		if (m_recordContext.load(std::memory_order_relaxed))
+		{
+			if (m_rateLimit.load(std::memory_order_relaxed) && !AdmitRate(LogRateLimiter::Hash(format.format)))
+				return;
+			std::string record;
+			LogRecord::Encode(record, format, args...);
+			LogContext::Add(record, level, component);
+			WriteMsg(std::move(record));
+		}
+		else
+			Write(format, args...);
+		if (IsDumpLevel(level))
+			DumpFlightRecorder();
+	}
+
+	/// Write a structured message from a call site if the level meets the
+	/// component threshold. Called by LOG_SITE. Function call is thread-safe.
+	/// @param[in] level - the message level
+	/// @param[in] component - the component writing the message
+	/// @param[in] site - the registered call site, or nullptr to write the format
+	///     string pointer as a LogFormat with ID 0 does
+	/// @param[in] format - the call site format string
+	/// @param[in] args - the format arguments
+	template <typename... Args>
+	void Write(LogLevel level, LogComponent component, const LogCallSite* site, const char* format, const Args&... args)
+	{
+		if (!site)
+		{
+			Write(level, component, LogFormat{ 0, format }, args...);
+			return;
+		}
+		if (!IsEnabled(level, component))
+			return;
+		if (m_rateLimit.load(std::memory_order_relaxed) && !AdmitRate(LogRateLimiter::Hash(format)))
+			return;
+		std::string record;
+		LogRecord::Encode(record, *site, args...);
+		if (m_recordContext.load(std::memory_order_relaxed))
+			LogContext::Add(record, level, component);
+		WriteMsg(std::move(record));
+		if (IsDumpLevel(level))
+			DumpFlightRecorder();
+	}
+
+	/// Set the runtime level threshold of a component. Messages below the 
+	/// threshold are discarded before any allocation. Function call is 
+	/// thread-safe.
+	/// @param[in] component - the component, or 0 for the default component
+	/// @param[in] level - the minimum level written
+	void SetLevel(LogComponent component, LogLevel level)
+	{
+		if (component < MAX_COMPONENTS)
+			m_levels[component].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+	}
+
+	/// Set the runtime level threshold of all components. Function call is 
+	/// thread-safe.
+	/// @param[in] level - the minimum level written
+	void SetLevel(LogLevel level)
+	{
+		for (auto& componentLevel : m_levels)
+			componentLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+	}
+
+	/// Get the runtime level threshold of a component. Function call is 
+	/// thread-safe.
+	/// @param[in] component - the component
+	/// @return The minimum level written.
+	LogLevel GetLevel(LogComponent component) const
+	{
+		if (component >= MAX_COMPONENTS)
+			return LogLevel::Off;
+		return static_cast<LogLevel>(m_levels[component].load(std::memory_order_relaxed));
+	}
+
+	/// Reserve a record buffer to format a message into without copying it. 
+	/// Function call is thread-safe.
+	/// @param[in] bytes - the maximum message length
+	/// @return The reserved slot. Write the message to WriteSlot::Data() then 
+	///     call Commit().
+	WriteSlot Reserve(size_t bytes);
+
+	/// Write a message formatted into a reserved slot to the log. The slot buffer
+	/// is moved into the message queue. Function call is thread-safe.
+	/// @param[in,out] slot - the slot returned by Reserve(). Empty on return.
+	/// @param[in] length - the message length written to the slot, at most
+	///     WriteSlot::Capacity()
+	void Commit(WriteSlot& slot, size_t length);
+
+	/// Write a message to the log and get notified once it is durably written.
+	/// Durable messages queued before a flush starts are group committed by 
+	/// that flush with a single sync to the storage device. Function call is
+	/// thread-safe.
 	/// @param[in] msg - the message string to write
-	void Write(const std::string& msg);
+	/// @return A future set true once the message is synced to the storage 
+	///     device, or false if the message was dropped or the flush failed.
+	std::future<bool> WriteDurable(std::string msg);
+
+	/// Write a message from a signal handler or a FaultHandler hook. Async 
+	/// signal-safe: the message is copied into a slot preallocated by 
+	/// StartConfig::signalSlots without allocating, locking or waking the 
+	/// Logger thread, which polls the slots. Messages longer than 
+	/// LogSignalRing::SLOT_SIZE are truncated. The level, rate limit and 
+	/// repeat filters are not applied.
+	/// @param[in] msg - the message characters
+	/// @param[in] len - the message length
+	/// @return True if queued. False if the slots are disabled or all full, 
+	///     counted in Stats::dropped.
+	bool WriteFromSignal(const char* msg, size_t len)
+	{
+		return m_signalRing.Push(msg, len, m_timestamps.load(std::memory_order_relaxed));
+	}
+
+	/// Keep the most recent log data in memory and write nothing to disk. The
+	/// records are written to the log file only when dumped: by 
+	/// DumpFlightRecorder(), by a message at or above dumpLevel, by a durable
+	/// write, or to the crash file by a fault. Takes effect once the Logger 
+	/// thread processes the request. Function call is thread-safe.
+	/// @param[in] bytes - the flight recorder buffer size, or 0 to write log 
+	///     data to disk again
+	/// @param[in] dumpLevel - the minimum level of a message written with a 
+	///     level that dumps the recorder, or LogLevel::Off
+	void SetFlightRecorder(size_t bytes, LogLevel dumpLevel = LogLevel::Off);
+
+	/// Set the format of the log file records. JSON output reports the level,
+	/// component and thread of messages written with a level, so messages carry
+	/// that context while JSON output is selected. Takes effect once the Logger
+	/// thread processes the request. Function call is thread-safe.
+	/// @param[in] format - one text line or one JSON object per record
+	void SetOutputFormat(LogWriter::OutputFormat format);
+
+	/// Write the flight recorder records, including messages already written 
+	/// by the calling thread, to the log file. Function call is thread-safe.
+	void DumpFlightRecorder();
+
+	/// Write all messages not yet flushed by every instance to its crash file,
+	/// LogData.crash.txt for the default instance. 
+	/// Async signal-safe so it can be called from fault and signal handlers: 
+	/// no allocation, no locks and no blocking. Only the log data buffers and
+	/// the messages written by WriteFromSignal() are included. Messages in the
+	/// message queue, the lock-free write queue and staging buffers are not.
+	/// Only the first call writes.
+	static void EmergencyFlush();
+
+	/// Install SIGSEGV, SIGABRT, SIGBUS, SIGFPE and SIGILL handlers that call
+	/// EmergencyFlush(), then pass the signal on to the handler installed 
+	/// before, or terminate with the default signal action. Only the first
+	/// call installs.
+	static void InstallCrashHandlers();
+
+	/// Flush pending log data to disk. Function call is thread-safe. 
+	void Flush();
+
+	/// Stop accepting writes, then write and flush the messages already queued
+	/// and exit the Logger thread. The thread writes the queue in batches as 
+	/// usual and finishes with one synchronous flush. Once the timeout passes,
+	/// queued messages not yet written are discarded and the final flush is 
+	/// skipped. Messages written after the call are counted as dropped. A write
+	/// to disk already in progress when the timeout passes is completed, so the
+	/// call may return later than the timeout. Function call is thread-safe.
+	/// @param[in] timeout - the longest time spent writing and flushing
+	/// @return The messages lost. Later calls return the result of the first.
+	ShutdownResult Shutdown(std::chrono::milliseconds timeout);
+
+	/// Set the Shutdown() timeout used by the destructor. Default 5 seconds.
+	/// Function call is thread-safe.
+	/// @param[in] timeout - the longest time spent writing and flushing
+	void SetShutdownTimeout(std::chrono::milliseconds timeout)
+	{
+		m_shutdownTimeout.store(timeout.count(), std::memory_order_relaxed);
+	}
+
+	/// Set when the Logger thread returns memory kept since a burst. Once no
+	/// message has arrived for the quiet period, the message queue shrinks to 
+	/// the queue low-water mark, the spare log buffer chunks to the buffer 
+	/// low-water mark, and free heap memory is returned to the operating 
+	/// system. Function call is thread-safe. Takes effect after the next message.
+	/// @param[in] policy - the trim policy
+	void SetTrimPolicy(const TrimPolicy& policy);
+
+	/// Set the conditions that trigger a flush. Function call is thread-safe.
+	/// Takes effect the next time the Logger thread processes a message.
+	/// @param[in] trigger - the flush trigger conditions
+	void SetFlushTrigger(const FlushTrigger& trigger);
+
+	/// Get the conditions that trigger a flush. Function call is thread-safe.
+	/// @return The flush trigger conditions.
+	FlushTrigger GetFlushTrigger();
 
 	/// Register to receive a callback when the system mode changes. The callback
-	/// will be invoked on the Logger::m_thread context. 
+	/// will be invoked on the Logger::m_thread context, or asynchronously on 
+	/// thread so a callback that blocks does not stall logging. Prefer 
+	/// Subscribe(), which delivers typed events.
 	/// @param[in] callbackFunc - a pointer to a callback function 
-	void SetCallback(LoggerStatusCb callbackFunc)
+	/// @param[in] thread - the thread invoking the callback, or nullptr for the
+	///     Logger thread. Must outlive the registration.
+	void SetCallback(LoggerStatusCb callbackFunc, DelegateLib::DelegateThread* thread = nullptr)
+	{
+		m_statusThread.store(thread, std::memory_order_release);
+		m_pLoggerStatusCb.store(callbackFunc, std::memory_order_release);
+	}
+
+	/// Subscribe to a status event. A synchronous delegate is invoked on the 
+	/// Logger thread; bind an async delegate, e.g. MakeDelegate(&Func, thread),
+	/// to receive the event on a subscriber thread so the Logger thread only 
+	/// queues a message. An event with no subscribers costs a single atomic 
+	/// load. Function call is thread-safe.
+	/// @param[in] event - the event type
+	/// @param[in] delegate - the delegate to invoke
+	void Subscribe(StatusEvent event, const StatusDelegate& delegate);
+
+	/// Unsubscribe from a status event. Function call is thread-safe.
+	/// @param[in] event - the event type
+	/// @param[in] delegate - the delegate passed to Subscribe()
+	void Unsubscribe(StatusEvent event, const StatusDelegate& delegate);
+
+	/// Enable the lock-free write queue. When enabled, Write() pushes messages 
+	/// into a bounded lock-free ring instead of taking the message queue lock. 
+	/// Enable before logging starts since messages queued in different modes
+	/// are not ordered with respect to each other.
+	/// @param[in] enable - true to use the lock-free write queue
+	void SetLockFreeWrite(bool enable) { m_lockFreeWrite = enable; }
+
+	/// Enable per-thread staging buffers. When enabled, Write() appends messages to 
+	/// a buffer owned by the calling thread. The buffer is handed to the Logger 
+	/// thread in bulk when it fills, when the flush trigger latency passes, when 
+	/// the thread calls Flush() and when the thread exits. Messages from one thread
+	/// stay in order. Messages from different threads may interleave by buffer.
+	/// Enable before logging starts.
+	/// @param[in] enable - true to stage writes per thread
+	/// @param[in] capacity - the number of messages held by each staging buffer
+	void SetStagedWrite(bool enable, size_t capacity = STAGING_CAPACITY)
+	{
+		m_stagingCapacity = capacity ? capacity : 1;
+		m_stagedWrite = enable;
+	}
+
+	/// Enable per-CPU write buffers. When enabled, Write() appends messages to a 
+	/// buffer owned by the CPU the calling thread runs on, see GetCurrentCpu(),
+	/// so memory grows with the CPU count rather than the thread count and 
+	/// writers on different CPUs never share a cache line. The Logger thread 
+	/// takes the buffers round-robin each time it wakes. Messages from one 
+	/// thread stay in order unless the thread migrates between CPUs. Per-CPU
+	/// messages are not bounded by the queue capacity and are not included by
+	/// EmergencyFlush(). Enable before logging starts.
+	/// @param[in] enable - true to write to per-CPU buffers
+	void SetPerCpuWrite(bool enable);
+
+	/// Share the write pipeline with the producers while the Logger thread falls
+	/// behind. Once the message queue holds threshold write messages, Write() 
+	/// frames the calling thread's records in the log buffer layout into a chunk
+	/// of its own instead of queuing each record. A chunk is handed to the Logger
+	/// thread, which appends it with a single copy, once full, once the queue 
+	/// drains below the threshold, when the flush trigger latency passes, when 
+	/// the thread calls Flush() and when the thread exits. The Logger thread then
+	/// takes one message per chunk rather than per record, so ingestion scales 
+	/// with the producers. Handing off a full chunk applies the backpressure 
+	/// policy. Records of one thread stay in order. Applies to the message queue,
+	/// not to the lock-free, staged or per-CPU writes. Function call is 
+	/// thread-safe.
+	/// @param[in] threshold - the queued write messages at which producers 
+	///     assist, or 0 to disable
+	/// @param[in] chunkBytes - the record bytes framed into a chunk before it is
+	///     handed off
+	void SetProducerAssist(size_t threshold, size_t chunkBytes = ASSIST_CHUNK_BYTES)
+	{
+		m_assistChunkBytes = chunkBytes ? chunkBytes : 1;
+		m_assistThreshold = threshold;
+	}
+
+	/// Prefix each staged message with a global sequence number "#<n> " so 
+	/// per-thread streams can be merged in order afterwards
+	/// @param[in] enable - true to add sequence numbers
+	void SetSequenceNumbers(bool enable) { m_sequenceNumbers = enable; }
+
+	/// Stamp each message with the time it is written. The stamp is a raw tick
+	/// read without a system call and is rendered as a UTC time prefix 
+	/// "YYYY-MM-DDTHH:MM:SS.uuuuuuZ " when flushed. See LogTimestamp. Function
+	/// call is thread-safe.
+	/// @param[in] enable - true to timestamp messages
+	void SetTimestamps(bool enable) { m_timestamps = enable; }
+
+	/// Limit the rate of identical messages. Text messages are keyed by a hash 
+	/// of the text and structured messages by their format string. A message 
+	/// over the rate is discarded before it is queued. The next admitted message
+	/// of the same key is preceded by a "Rate limit suppressed N similar 
+	/// messages" message. Durable writes are never limited. Function call is 
+	/// thread-safe.
+	/// @param[in] ratePerSecond - the sustained messages per second of each key,
+	///     or 0 to disable rate limiting
+	/// @param[in] burst - the messages of a key admitted at once
+	void SetRateLimit(uint32_t ratePerSecond, uint32_t burst = 100)
 	{
-		m_pLoggerStatusCb = callbackFunc;
+		if (ratePerSecond)
+			m_rateLimiter.SetRate(ratePerSecond, burst);
+		m_rateLimit = ratePerSecond != 0;
 	}
 
+	/// Collapse consecutive identical messages on the Logger thread into one 
+	/// message followed by "Last message repeated N times". The count is written
+	/// when a different message arrives or the log data is flushed. Timestamps
+	/// are ignored when comparing messages. Function call is thread-safe.
+	/// @param[in] enable - true to collapse repeated messages
+	void SetCollapseRepeats(bool enable) { m_collapseRepeats = enable; }
+
+	/// Drop or reroute the records matching a filter's patterns before the log
+	/// data stores them. The Logger thread matches each batch of records against
+	/// the filter in one pass per record. A rerouted record keeps its timestamp,
+	/// or is stamped by the rule's Logger if unstamped, and is filtered again only
+	/// if that Logger has a filter of its own. The Logger thread never waits for
+	/// the rule's Logger: a rerouted record is dropped if its queue is full. A 
+	/// filter whose routes lead back to this Logger, directly or through the 
+	/// filters of the Loggers routed to, is rejected. A new filter is swapped in 
+	/// atomically and applies from the next batch, so patterns may be reloaded 
+	/// while logging. Function call is thread-safe.
+	/// @param[in] filter - the compiled filter, or nullptr to remove it
+	/// @return True if set. False if the filter routes in a cycle.
+	bool SetFilter(std::shared_ptr<const LogFilter> filter);
+
+	/// Get the filter set by SetFilter(). Function call is thread-safe.
+	/// @return The filter, or nullptr if none.
+	std::shared_ptr<const LogFilter> GetFilter() const { return std::atomic_load(&m_filter); }
+
+	/// Limit the number of write messages waiting in the message queue. Messages
+	/// written by the Logger thread itself and staged buffers are never blocked. 
+	/// Function call is thread-safe.
+	/// @param[in] capacity - the maximum number of queued write messages, or 0 
+	///     for no limit
+	/// @param[in] policy - the action taken when the queue is at capacity
+	/// @param[in] sampleRate - one in this many messages is kept by BackpressurePolicy::SAMPLE
+	void SetQueueCapacity(size_t capacity, BackpressurePolicy policy = BackpressurePolicy::BLOCK, size_t sampleRate = 10);
+
+	/// Limit the message bytes of the write messages waiting in the message 
+	/// queue, so a few long messages are held back like many short ones. A 
+	/// write over the budget is handled by the SetQueueCapacity() backpressure
+	/// policy. A write is always admitted once no bytes are queued, so one 
+	/// longer than the budget is not refused forever. Function call is thread-safe.
+	/// @param[in] bytes - the byte budget, or 0 for no limit
+	void SetQueueByteBudget(size_t bytes);
+
+	/// Get a snapshot of the Logger counters without taking any lock. Function 
+	/// call is thread-safe.
+	/// @return The counters.
+	Stats GetStats() const;
+
+	/// Get the message queue slots allocated. Function call is thread-safe.
+	/// @return The queue capacity.
+	size_t GetQueueCapacity();
+
+	/// Set the action taken when the lock-free write queue is full
+	/// @param[in] policy - the overflow policy
+	void SetOverflowPolicy(OverflowPolicy policy) { m_writeQueue.SetOverflowPolicy(policy); }
+
+	/// Coalesce the "Write success!" status callback into one callback per 
+	/// batch of messages written instead of one callback per message.
+	/// @param[in] coalesce - true to coalesce write status callbacks
+	void SetCoalesceStatus(bool coalesce) { m_coalesceStatus = coalesce; }
+
+	/// Get the number of messages dropped by the lock-free write queue
+	/// @return The drop count.
+	uint64_t GetDropCount() const { return m_writeQueue.GetDropCount(); }
+
+	/// Get the peak depth of the lock-free write queue
+	/// @return The peak depth.
+	size_t GetPeakQueueDepth() const { return m_writeQueue.GetPeakDepth(); }
+
+	/// Add a sink receiving every message flushed from now on in addition to 
+	/// the log file. Each sink writes on its own thread. Function call is 
+	/// thread-safe.
+	/// @param[in] sink - the sink to add, e.g. a LogFileSink or LogStreamSink
+	void AddSink(std::shared_ptr<LogSink> sink) { m_logData.AddSink(std::move(sink)); }
+
+	/// Remove a sink and stop it once its queued messages are written. Function 
+	/// call is thread-safe.
+	/// @param[in] sink - the sink to remove
+	void RemoveSink(const std::shared_ptr<LogSink>& sink) { m_logData.RemoveSink(sink); }
+
 #ifdef IT_ENABLE
+	/// Return the Logger to its idle state between integration tests. Removes 
+	/// status callbacks, status subscribers and LogData test hooks, writes the 
+	/// records a test left pending and discards records captured in memory. 
+	/// Settings are kept. Must be called on the Logger thread.
+	void ResetForTest();
+
 	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg);
+	virtual void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count);
+	virtual int GetNumaNode() const { return m_threadAttributes.numaNode; }
 #endif
 
 private:
 IT_PRIVATE_ACCESS:
 
+	typedef LoggerMsg Msg;
+	typedef LoggerMsg::DurableWrite DurableWrite;
+	typedef LoggerMsg::Data MsgData;
+
+	/// Per-CPU buffer of messages, each on its own cache line. The flag is only
+	/// contended when a writer is preempted mid-append and another thread runs
+	/// on the CPU, or while the Logger thread takes the messages.
+	struct alignas(CACHE_LINE_SIZE) CpuBuffer
+	{
+		std::atomic<bool> busy{ false };
+		std::atomic<bool> pending{ false };
+		std::vector<std::string> msgs;
+	};
+
+	/// Per-thread buffer of staged messages, or of the records framed by an 
+	/// assisting producer. The mutex is only contended when the Logger thread 
+	/// collects a buffer whose latency has passed.
+	struct StagingBuffer
+	{
+		std::mutex mutex;
+		std::vector<std::string> msgs;
+		std::string chunk;
+		size_t chunkRecords = 0;
+		std::chrono::steady_clock::time_point firstWrite;
+	};
+
 	Logger(const Logger&) = delete;
 	Logger& operator=(const Logger&) = delete;
 
 	/// Constructor
-	Logger();
-
-	/// Destructor
-	~Logger();
+	/// @param[in] fileBaseName - the LogData file base name
+	/// @param[in] threadName - the Logger thread name
+	Logger(const std::string& fileBaseName, const std::string& threadName);
 
 	/// Called once to create the worker thread
 	/// @return TRUE if thread is created. FALSE otherise. 
 	bool CreateThread();
 
-	/// Called once at program exit to exit the worker thread
-	void ExitThread();
+	/// Start the Logger thread if it has not started. A single atomic load 
+	/// once started.
+	void EnsureStarted()
+	{
+		if (!m_started.load(std::memory_order_acquire))
+			StartOnce();
+	}
+
+	/// Create the Logger thread once under the start lock
+	void StartOnce();
+
+	/// Write the lock-free queues and complete the flushes on the Logger thread
+	/// once the exit message of Shutdown() is taken
+	/// @param[in] batch - the messages taken with the exit message
+	/// @param[in] next - the index of the message following the exit message
+	void FinishShutdown(RingQueue<Msg>& batch, size_t next);
+
+	/// Discard a write message queued before Shutdown() once the deadline passed
+	/// @param[in] msg - the write message
+	/// @return True if the message was a write, false otherwise.
+	bool DiscardWrite(Msg& msg);
 
 	/// Get the ID of this thread instance
 	std::thread::id GetThreadId();
@@ -68,22 +935,400 @@ IT_PRIVATE_ACCESS:
 	/// Entry point for the thread
 	void Process();
 
-    /// Entry point for timer thread
-    void TimerThread();
+	/// Wake the Logger thread after queuing work. Called with m_mutex held.
+	void Signal();
+
+	/// Wake the Logger thread to recheck its deadlines after the clock advances
+	/// @param[in] context - the Logger instance
+	static void ClockAdvanced(void* context);
+
+	/// Start flushing log data to disk on the I/O thread
+	void FlushLogData();
+
+	/// Complete a flush started by FlushLogData() and notify the client
+	/// @param[in] result - the write result
+	void FlushComplete(const LogWriter::Result& result);
+
+	/// Release the memory kept since a burst. Called by the Logger thread.
+	/// @param[in] batch - the Logger thread's message batch
+	/// @param[in] policy - the trim policy
+	void TrimMemory(RingQueue<Msg>& batch, const TrimPolicy& policy);
+
+	/// Flush log data if a flush trigger fired and compute the next flush deadline
+	/// @param[in] trigger - the flush trigger conditions
+	void CheckFlushTrigger(const FlushTrigger& trigger);
+
+	/// Write all messages pending in the lock-free write queue
+	void DrainWriteQueue();
+
+	/// Write the messages queued by WriteFromSignal() to the log data
+	void DrainSignalRing();
+
+	/// Get the staging buffer of the calling thread, creating it on first use
+	/// @return The staging buffer.
+	StagingBuffer& GetStagingBuffer();
+
+	/// Write this instance's unflushed messages to its crash file. Called by
+	/// EmergencyFlush().
+	void EmergencyFlushInstance();
+
+	/// Get the staging buffer of the calling thread if it has one
+	/// @return The staging buffer or nullptr.
+	StagingBuffer* FindStagingBuffer();
+
+	/// Append a message to the buffer of the calling thread's CPU
+	/// @param[in] msg - the message string to write
+	void WritePerCpu(std::string&& msg);
+
+	/// Write the messages of every per-CPU buffer to the log data, starting 
+	/// from a different buffer each call
+	void DrainCpuBuffers();
+
+	/// Check if a per-CPU buffer holds messages
+	/// @return True if a buffer holds messages.
+	bool HasCpuMessages() const;
+
+	/// Append a message to the calling thread's staging buffer
+	/// @param[in] msg - the message string to write
+	void WriteStaged(std::string&& msg);
+
+	/// Hand the staged messages to the Logger thread. Must be called with the
+	/// buffer mutex held.
+	/// @param[in] buffer - the staging buffer
+	void HandOffStagingBuffer(StagingBuffer& buffer);
+
+	/// Have the Logger thread collect a staging buffer that just received its
+	/// first message once the flush trigger latency passes. Must be called with
+	/// the buffer mutex held.
+	/// @param[in] buffer - the staging buffer
+	void SetStagingDeadline(StagingBuffer& buffer);
+
+	/// Frame a record into the calling thread's assist chunk while the message
+	/// queue is over the assist threshold, or while the chunk holds records
+	/// @param[in] msg - the record. Left intact if not framed.
+	/// @return True if framed. False to queue the record.
+	bool WriteAssisted(std::string& msg);
+
+	/// Queue a chunk of framed records
+	/// @param[in] records - the framed records
+	/// @param[in] count - the number of records
+	/// @param[in] canBlock - false if the caller must not wait for space
+	void QueueChunk(std::string&& records, size_t count, bool canBlock);
+
+	/// Hand off the remaining messages and forget a staging buffer. Called
+	/// when the owning thread exits.
+	/// @param[in] buffer - the staging buffer
+	void ReleaseStagingBuffer(const std::shared_ptr<StagingBuffer>& buffer);
+
+	/// Hand off staging buffers whose latency has passed and compute the next
+	/// staging deadline. Called on the Logger thread.
+	void CollectStagingBuffers();
+
+	/// Apply the backpressure policy to write messages about to be queued. Must
+	/// be called with m_mutex held by lk.
+	/// @param[in] lk - the m_mutex lock
+	/// @param[in] count - the number of write messages
+	/// @param[in] canBlock - false if the caller must not wait for space
+	/// @return True if the messages are accepted. False if dropped.
+	bool AdmitWrite(std::unique_lock<DelegateLib::SiteMutex>& lk, size_t count, size_t bytes, bool canBlock);
+
+	/// Check if write messages fit the queue capacity and byte budget. Must be
+	/// called with m_mutex held.
+	/// @param[in] count - the number of write messages
+	/// @param[in] bytes - the bytes of the write messages
+	/// @return True if they fit.
+	bool QueueFits(size_t count, size_t bytes) const;
+
+	/// Stamp a write message and send it to the Logger thread
+	/// @param[in] msg - the message string to write
+	/// @param[in] stamped - true if the message already holds its timestamp
+	void WriteMsg(std::string&& msg, bool stamped = false);
+
+	/// Queue a record rerouted by another Logger's filter without waiting for
+	/// space. Stamps the record if unstamped and timestamps are enabled.
+	/// @param[in] msg - the record
+	/// @return True if queued. False if dropped.
+	bool WriteRouted(std::string&& msg);
+
+	/// Gather message parts into one record, leaving room for the timestamp 
+	/// ahead of the text, and send it to the Logger thread
+	/// @param[in] parts - the message parts
+	/// @param[in] count - the number of parts
+	void WriteParts(const std::string_view* parts, size_t count);
+
+	/// Take a rate limiter token for a message key. Writes the suppressed count
+	/// once a key is admitted after messages were discarded.
+	/// @param[in] key - the message hash or call site
+	/// @return True if the message is admitted. False if it must be discarded.
+	bool AdmitRate(uint64_t key);
+
+	/// Write a batch of messages to the log data and notify the client
+	/// @param[in] msgs - the message strings to write
+	/// @param[in] count - the number of message strings
+	/// @param[in] collapse - false to always write the messages even if repeated
+	/// @param[in] record - false to write past the flight recorder
+	void WriteLogData(const std::string_view* msgs, size_t count, bool collapse = true, bool record = true);
+
+	/// Write the repeat count of the last message, if any, to the log data
+	void WriteRepeatCount();
+
+	/// Notify the client of records written to the log data
+	/// @param[in] count - the number of records
+	void PublishWritten(size_t count);
+
+	/// Check if a status event has subscribers
+	bool IsSubscribed(StatusEvent event) const
+	{
+		return m_statusMask.load(std::memory_order_relaxed) & (1u << static_cast<unsigned>(event));
+	}
+
+	/// Publish a status event to its subscribers and the legacy callback
+	/// @param[in] info - the event details
+	/// @param[in] repeat - the number of times to publish the event
+	void PublishStatus(const StatusInfo& info, size_t repeat = 1);
 
 	/// Class to collect and save log data
 	LogData m_logData;
 
 	// Registered client callback function pointer
-	LoggerStatusCb m_pLoggerStatusCb;
+	std::atomic<LoggerStatusCb> m_pLoggerStatusCb;
 
-	std::unique_ptr<std::thread> m_thread;
-	std::queue<std::shared_ptr<Msg>> m_queue;
-	std::mutex m_mutex;
-	std::condition_variable m_cv;
-    std::atomic<bool> m_timerExit;
+	/// The thread invoking m_pLoggerStatusCb, or nullptr for the Logger thread
+	std::atomic<DelegateLib::DelegateThread*> m_statusThread;
+
+	/// Status event subscribers, one list per event type. A bit of m_statusMask
+	/// is set while the list of that event is not empty. m_statusMutex 
+	/// serializes Subscribe() and Unsubscribe().
+	DelegateLib::MulticastDelegateSafe<void(const StatusInfo&)> m_statusEvents[static_cast<size_t>(StatusEvent::COUNT)];
+	std::atomic<uint32_t> m_statusMask;
+	std::mutex m_statusMutex;
+
+	/// Set once the Logger thread is created. Never reset so an exited logger
+	/// is not restarted. m_startMutex serializes the creation.
+	std::atomic<bool> m_started;
+	std::mutex m_startMutex;
+
+	/// Attributes applied when the Logger thread is created
+	static ThreadAttributes m_threadAttributes;
 	const std::string THREAD_NAME;
+
+	/// Flush trigger conditions. Protected by m_mutex.
+	FlushTrigger m_flushTrigger;
+
+	/// Time the pending log data must be flushed by. Empty if nothing is
+	/// pending. Only accessed by the Logger thread.
+	std::optional<std::chrono::steady_clock::time_point> m_flushDeadline;
+
+	/// Set by SetTrimPolicy(). Protected by m_mutex.
+	TrimPolicy m_trimPolicy;
+
+	/// Time memory is trimmed unless a message arrives first. Empty once
+	/// trimmed. Only accessed by the Logger thread.
+	std::optional<std::chrono::steady_clock::time_point> m_trimDeadline;
+
+	/// True if a flush was requested while a flush is in progress. Only 
+	/// accessed by the Logger thread.
+	bool m_flushRequested;
+
+	/// Adaptive flush interval tuning, used when the flush trigger is adaptive.
+	/// Only accessed by the Logger thread. m_flushInterval is read by GetStats().
+	LogFlushTuner m_flushTuner;
+	bool m_adaptiveFlush;
+	std::atomic<int64_t> m_flushInterval;
+
+	/// Completions of durable writes waiting for the next flush. Only accessed
+	/// by the Logger thread.
+	std::vector<std::promise<bool>> m_durablePending;
+
+	/// Completions of durable writes within the flush in progress. Only 
+	/// accessed by the Logger thread.
+	std::vector<std::promise<bool>> m_durableFlushing;
+
+	/// Lock-free write queue used when m_lockFreeWrite is set
+	LockFreeQueue<std::string> m_writeQueue;
+	std::atomic<bool> m_lockFreeWrite;
+
+	/// True to notify the client once per write batch
+	std::atomic<bool> m_coalesceStatus;
+
+	/// Messages popped from the lock-free write queue. Reused by each drain.
+	std::vector<std::string> m_drained;
+
+	/// Buffers written while m_perCpuWrite is set, one per CPU, the buffer the
+	/// next drain starts from and the messages taken by the last drain
+	std::unique_ptr<CpuBuffer[]> m_cpuBuffers;
+	size_t m_cpuBufferCount = 0;
+	std::atomic<bool> m_perCpuWrite{ false };
+	size_t m_cpuDrainNext = 0;
+	std::vector<std::string> m_cpuDrained;
+
+	/// Slots written by WriteFromSignal(). Allocated by Start().
+	LogSignalRing m_signalRing;
+
+	/// The batch of messages written to the log data. Reused by each batch.
+	std::vector<std::string_view> m_writeBatch;
+
+	/// True to stage writes in per-thread buffers
+	std::atomic<bool> m_stagedWrite;
+	std::atomic<size_t> m_stagingCapacity;
+
+	/// True to prefix staged messages with a sequence number
+	std::atomic<bool> m_sequenceNumbers;
+	std::atomic<uint64_t> m_sequence;
+
+	/// True to stamp messages with the write time
+	std::atomic<bool> m_timestamps;
+
+	/// Rate limits identical messages when m_rateLimit is set
+	LogRateLimiter m_rateLimiter;
+	std::atomic<bool> m_rateLimit;
+
+	/// True to collapse repeated messages
+	std::atomic<bool> m_collapseRepeats;
+
+	/// The last message written without its timestamp, and the number of times 
+	/// it repeated since. Only accessed by the Logger thread.
+	std::string m_lastMsg;
+	bool m_hasLastMsg = false;
+	uint64_t m_repeats = 0;
+	std::atomic<uint64_t> m_collapsed;
+
+	/// Set by SetFilter(). m_filtering is true while a filter is set so the
+	/// Logger thread skips the shared pointer load otherwise. m_filterBatch holds
+	/// the records kept and is only accessed by the Logger thread.
+	std::shared_ptr<const LogFilter> m_filter;
+	std::atomic<bool> m_filtering{ false };
+	std::vector<std::string_view> m_filterBatch;
+	std::atomic<uint64_t> m_filtered{ 0 };
+	std::atomic<uint64_t> m_routed{ 0 };
+	std::atomic<uint64_t> m_routeDropped{ 0 };
+
+	/// Staging buffers of all threads that staged a write. Protected by m_stagingMutex.
+	std::vector<std::shared_ptr<StagingBuffer>> m_stagingBuffers;
+	std::mutex m_stagingMutex;
+
+	/// Queued write messages at which producers assist, or 0 if disabled, the
+	/// chunk size and the records framed by producers
+	std::atomic<size_t> m_assistThreshold{ 0 };
+	std::atomic<size_t> m_assistChunkBytes{ ASSIST_CHUNK_BYTES };
+	std::atomic<uint64_t> m_assisted{ 0 };
+
+	/// Set by Shutdown(). Writes are rejected from then on.
+	std::atomic<bool> m_closing{ false };
+
+	/// Shutdown() deadline. Written with m_mutex held before the exit message
+	/// is queued.
+	DelegateLib::Clock::time_point m_shutdownDeadline;
+
+	/// Shutdown() result. Written by the Logger thread before it exits.
+	ShutdownResult m_shutdownResult;
+
+	/// Destructor Shutdown() timeout in milliseconds
+	std::atomic<int64_t> m_shutdownTimeout{ 5000 };
+
+	/// Message queue capacity, byte budget and backpressure policy. Protected by m_mutex.
+	size_t m_queueCapacity;
+	BackpressurePolicy m_backpressure;
+	size_t m_sampleRate;
+	size_t m_sampleCount;
+	size_t m_queueByteBudget = 0;
+
+	/// Signaled when the Logger thread takes the queued messages
+	DelegateLib::SiteCondition m_spaceCv;
+
+	/// Counters read by GetStats(). m_queueDepth and m_queueBytes are only written with m_mutex held.
+	/// The counters written by producers and those written by the Logger thread
+	/// from m_flushedBytes on sit on separate cache lines.
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_queueDepth;
+	std::atomic<size_t> m_queueBytes{ 0 };
+	std::atomic<size_t> m_peakDepth;
+	std::atomic<uint64_t> m_enqueued;
+	std::atomic<uint64_t> m_dropped;
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_flushedBytes;
+	std::atomic<uint64_t> m_flushLatency[LATENCY_BUCKETS];
+
+	/// The default instance once constructed. Used by SetThreadAttributes().
+	static std::atomic<Logger*> m_instance;
+
+	/// All constructed instances. Used by EmergencyFlush().
+	static std::atomic<Logger*> m_instances[MAX_INSTANCES];
+
+	/// The instance of each component. Null for the default instance.
+	static std::atomic<Logger*> m_componentLoggers[MAX_COMPONENTS];
+
+	/// The instance of each level. Null to route by component.
+	static std::atomic<Logger*> m_levelLoggers[static_cast<size_t>(LogLevel::Off)];
+
+	/// Unique instance ID. Identifies the staging buffers of this instance.
+	const uint64_t m_id;
+
+	/// Prefix of the metrics gauge names, "logger." for the default instance
+	const std::string m_metricsPrefix;
+
+	/// True once EmergencyFlush() has written the pending messages
+	std::atomic<bool> m_emergencyFlushed;
+
+	/// Runtime level threshold of each component
+	std::atomic<uint8_t> m_levels[MAX_COMPONENTS];
+
+	/// Check if a message level dumps the flight recorder
+	bool IsDumpLevel(LogLevel level) const
+	{
+		return static_cast<uint8_t>(level) >= m_recorderDumpLevel.load(std::memory_order_relaxed);
+	}
+
+	/// Minimum message level dumping the flight recorder
+	std::atomic<uint8_t> m_recorderDumpLevel;
+
+	/// Flight recorder size applied by the Logger thread
+	std::atomic<size_t> m_recorderBytes;
+
+	/// Output format applied by the Logger thread. m_recordContext is set while
+	/// messages written with a level carry a LogContext.
+	std::atomic<LogWriter::OutputFormat> m_outputFormat;
+	std::atomic<bool> m_recordContext;
+
+	/// Time the oldest staged message must be handed off by. Protected by m_mutex.
+	std::optional<std::chrono::steady_clock::time_point> m_stagingDeadline;
+
+	/// Number of Signal() calls. Polled by the Logger thread while spinning.
+	std::atomic<uint64_t> m_signals;
+
+	friend struct StagingHolder;
 };
 
+/// Write a message at a level from a component. The message arguments are only 
+/// evaluated if the level meets the component threshold, and the call compiles
+/// away when the level is below LOGGER_MIN_LEVEL. The arguments are either a
+/// message string or a LogFormat and its format arguments.
+#define LOG_WRITE(level, component, ...) \
+	do { \
+		if constexpr (IsLogLevelCompiled(level)) { \
+			Logger& logger_ = Logger::ForRecord(level, component); \
+			if (logger_.IsEnabled(level, component)) \
+				logger_.Write(__VA_ARGS__); \
+		} \
+	} while (0)
+
+/// Expands to the first argument of a LOG_SITE argument list
+#define LOG_SITE_FORMAT_(format, ...) format
+
+/// Write a structured message at a level from a component, as LOG_WRITE does.
+/// The arguments are a printf-style format string literal and its format
+/// arguments. The file, line, function and format string are stored once in a
+/// static LogCallSite and each record carries only its ID and the arguments.
+#define LOG_SITE(level, component, ...) \
+	do { \
+		if constexpr (IsLogLevelCompiled(level)) { \
+			static constexpr LogCallSite logSite_{ __FILE__, __LINE__, __func__, LOG_SITE_FORMAT_(__VA_ARGS__, 0), \
+				LogCallSite::MakeId(__FILE__, __LINE__, LOG_SITE_FORMAT_(__VA_ARGS__, 0)) }; \
+			Logger& logger_ = Logger::ForRecord(level, component); \
+			if (logger_.IsEnabled(level, component)) { \
+				static const LogCallSite* const logSiteRegistered_ = LogCallSites::Register(logSite_); \
+				logger_.Write(level, component, logSiteRegistered_, __VA_ARGS__); \
+			} \
+		} \
+	} while (0)
+
 #endif 
 
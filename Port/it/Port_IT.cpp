@@ -0,0 +1,1710 @@
+// Integration tests for the Port subsystem
+//
+// @see https://github.com/endurodave/IntegrationTestFramework
+//
+// All tests run within the IntegrationTest thread context. The threads, timers
+// and transports under test run within their own thread contexts. The Google
+// Test library is used to execute tests and collect results.
+
+#include "DelegateLib.h"
+#include "WorkerThreadStd.h"
+#include "SignalThread.h"
+#include "DispatchBatch.h"
+#include "DeterministicScheduler.h"
+#include "DegradedThread.h"
+#include "ExecutorThread.h"
+#include "StaticWorkerThread.h"
+#include "ReactorThread.h"
+#include "SubsystemRegistry.h"
+#include "CoreGroup.h"
+#include "AsyncFile.h"
+#include "WorkerThreadPool.h"
+#include "ShmTransport.h"
+#include "SocketTransport.h"
+#include "Metrics.h"
+#include <cerrno>
+#include <cstring>
+#include <cstdio>
+#include <future>
+#include <sstream>
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include "IT_Util.h"		// Include this last
+
+using namespace std;
+using namespace std::chrono;
+using namespace DelegateLib;
+
+// Run two scheduled threads exchanging messages and a timer, returning the trace
+static vector<string> RunScheduled(uint64_t seed)
+{
+	vector<string> trace;
+	DeterministicScheduler scheduler(seed);
+	DeterministicScheduler::Install(&scheduler);
+	{
+		WorkerThread threadA("ScheduledA", WorkerThread::QueuePolicy::SCHEDULED);
+		WorkerThread threadB("ScheduledB", WorkerThread::QueuePolicy::SCHEDULED);
+		EXPECT_TRUE(threadA.CreateThread());
+		EXPECT_TRUE(threadB.CreateThread());
+
+		std::function<void(int)> pingA, pingB;
+		pingA = [&](int count) {
+			trace.push_back("A" + to_string(count));
+			if (count < 3)
+				MakeDelegate(pingB, threadB)(count + 1);
+		};
+		pingB = [&](int count) {
+			trace.push_back("B" + to_string(count));
+			if (count < 3)
+				MakeDelegate(pingA, threadA)(count + 1);
+		};
+		std::function<void(int)> other = [&](int count) { trace.push_back("C" + to_string(count)); };
+
+		Timer timer(threadA.GetTimers());
+		std::function<void()> expired = [&]() {
+			EXPECT_EQ(WorkerThread::GetCurrentThreadId(), threadA.GetThreadId());
+			trace.push_back("T");
+		};
+		timer.Expired = MakeDelegate(expired);
+		timer.Start(milliseconds(100), false);
+
+		// Nothing runs until the scheduler is driven
+		MakeDelegate(pingA, threadA)(0);
+		MakeDelegate(other, threadB)(0);
+		MakeDelegate(other, threadB)(1);
+		EXPECT_TRUE(trace.empty());
+		EXPECT_EQ(threadB.GetQueueSize(), 2u);
+
+		// A second of virtual time runs at once
+		auto start = steady_clock::now();
+		EXPECT_EQ(scheduler.RunFor(seconds(1)), 6u);
+		EXPECT_LT(steady_clock::now() - start, milliseconds(500));
+	}
+	DeterministicScheduler::Install(nullptr);
+	return trace;
+}
+
+// Test scheduled threads run deterministically without OS threads
+TEST(Port_IT, DeterministicScheduler)
+{
+	// Seed 0 runs in dispatch order, then the timer once virtual time reaches it
+	EXPECT_EQ(RunScheduled(0), vector<string>({ "A0", "C0", "C1", "B1", "A2", "B3", "T" }));
+
+	// A seed replays the same interleaving, and each thread keeps its order
+	auto trace = RunScheduled(12345);
+	EXPECT_EQ(trace, RunScheduled(12345));
+	EXPECT_EQ(trace.size(), 7u);
+	EXPECT_LT(find(trace.begin(), trace.end(), "C0"), find(trace.begin(), trace.end(), "C1"));
+
+	// No scheduler installed
+	WorkerThread thread("Unscheduled", WorkerThread::QueuePolicy::SCHEDULED);
+	EXPECT_FALSE(thread.CreateThread());
+}
+
+static atomic<int> degradedCalls(0);
+
+static int DegradedTarget(int value)
+{
+	degradedCalls++;
+	return value;
+}
+
+// Test a thread degraded by injected delays and a capacity limit
+TEST(Port_IT, DegradedThread)
+{
+	degradedCalls = 0;
+	WorkerThread thread("DegradedThread");
+	ASSERT_TRUE(thread.CreateThread());
+	DegradedThread slow(thread);
+
+	// A slow consumer times out a blocking call that waits too little
+	DegradedThread::Delay execution;
+	execution.base = milliseconds(50);
+	slow.SetExecutionDelay(execution);
+	EXPECT_FALSE(MakeDelegate(&DegradedTarget, slow, milliseconds(5)).AsyncInvoke(1).has_value());
+	auto retVal = MakeDelegate(&DegradedTarget, slow, milliseconds(500)).AsyncInvoke(2);
+	ASSERT_TRUE(retVal.has_value());
+	EXPECT_EQ(retVal.value(), 2);
+
+	// Calls past the capacity are dropped
+	execution.base = milliseconds(20);
+	slow.SetExecutionDelay(execution);
+	slow.SetCapacity(2, DegradedThread::Overflow::DROP);
+	int before = degradedCalls.load();
+	auto async = MakeDelegate(&DegradedTarget, slow);
+	for (int i = 0; i < 5; i++)
+		async(i);
+	EXPECT_EQ(slow.GetDropped(), 3u);
+	for (int i = 0; i < 200 && slow.GetInFlight() > 0; i++)
+		this_thread::sleep_for(milliseconds(5));
+	EXPECT_EQ(slow.GetInFlight(), 0u);
+	EXPECT_EQ(degradedCalls.load() - before, 2);
+
+	// Or block the sender until the consumer catches up
+	slow.SetCapacity(1, DegradedThread::Overflow::BLOCK);
+	auto start = steady_clock::now();
+	for (int i = 0; i < 3; i++)
+		async(i);
+	EXPECT_GE(steady_clock::now() - start, milliseconds(35));
+	EXPECT_GE(slow.GetBlocked(), 2u);
+
+	// A dispatch delay is spent on the sender, with seeded jitter
+	slow.SetCapacity(0);
+	execution.base = microseconds(0);
+	slow.SetExecutionDelay(execution);
+	DegradedThread::Delay dispatch;
+	dispatch.base = milliseconds(10);
+	dispatch.jitter = DegradedThread::Jitter::UNIFORM;
+	dispatch.spread = milliseconds(5);
+	slow.SetDispatchDelay(dispatch);
+	start = steady_clock::now();
+	async(0);
+	EXPECT_GE(steady_clock::now() - start, milliseconds(10));
+
+	thread.ExitThread();
+}
+
+static atomic<int> overflowCalls(0);
+
+static void OverflowTarget(int value)
+{
+	(void)value;
+	overflowCalls++;
+}
+
+TEST(Port_IT, QueueOverflow)
+{
+	// A reserved ring queues up to its capacity without allocating
+	RingQueue<ThreadMsg> ring;
+	ring.Reserve(100);
+	EXPECT_EQ(ring.capacity(), 128u);
+	EXPECT_NO_ALLOC({
+		for (int i = 0; i < 128; i++)
+			ring.push(ThreadMsg(i));
+		while (!ring.empty())
+			ring.pop();
+	});
+
+	overflowCalls = 0;
+	WorkerThread thread("QueueOverflow", WorkerThread::QueuePolicy::MUTEX, 4);
+	ASSERT_TRUE(thread.CreateThread());
+
+	// Hold the thread so dispatched messages stay queued
+	promise<void> started;
+	promise<void> release;
+	future<void> running = started.get_future();
+	shared_future<void> released = release.get_future().share();
+	MakeDelegate(std::function<void()>([&started, released]() {
+		started.set_value();
+		released.wait();
+	}), thread)();
+	running.wait();
+
+	// Messages past the lane capacity are dropped
+	thread.SetQueueOverflow(WorkerThread::QueueOverflow::DROP);
+	auto async = MakeDelegate(&OverflowTarget, thread);
+	for (int i = 0; i < 10; i++)
+		async(i);
+	EXPECT_EQ(thread.GetStats().dropped, 6u);
+
+	// Or block the sender until the thread takes a message
+	thread.SetQueueOverflow(WorkerThread::QueueOverflow::BLOCK);
+	atomic<bool> sent(false);
+	std::thread sender([&]() {
+		async(10);
+		sent = true;
+	});
+	this_thread::sleep_for(milliseconds(20));
+	EXPECT_FALSE(sent.load());
+	release.set_value();
+	sender.join();
+	EXPECT_TRUE(sent.load());
+
+	thread.ExitThread();
+	EXPECT_EQ(overflowCalls.load(), 5);
+}
+
+static atomic<int> borrowedDropCalls(0);
+
+static void BorrowedDropTarget(int value)
+{
+	(void)value;
+	borrowedDropCalls++;
+}
+
+// Test a full DROP lane still takes the message retiring a borrowed invoker, so
+// the calls queued ahead of it run on a live invoker. Build with ENABLE_ASAN to
+// catch a use after free.
+TEST(Port_IT, BorrowedInvokerDrop)
+{
+	borrowedDropCalls = 0;
+	WorkerThread thread("BorrowedInvokerDrop", WorkerThread::QueuePolicy::MUTEX, 4);
+	ASSERT_TRUE(thread.CreateThread());
+	thread.SetQueueOverflow(WorkerThread::QueueOverflow::DROP);
+
+	// Hold the thread so dispatched messages stay queued
+	promise<void> started;
+	promise<void> release;
+	future<void> running = started.get_future();
+	shared_future<void> released = release.get_future().share();
+	MakeDelegate(std::function<void()>([&started, released]() {
+		started.set_value();
+		released.wait();
+	}), thread)();
+	running.wait();
+
+	// Fill the lane with calls borrowing the invoker, then release the delegate
+	{
+		auto async = MakeDelegate(&BorrowedDropTarget, thread);
+		async.SetBorrowedInvoker(true);
+		for (int i = 0; i < 6; i++)
+			async(i);
+	}
+	EXPECT_EQ(thread.GetStats().dropped, 2u);
+
+	release.set_value();
+	thread.ExitThread();
+	EXPECT_EQ(borrowedDropCalls.load(), 4);
+}
+
+// Lane and sequence of each call taken. Only accessed by the thread under test
+// until it exits.
+static vector<pair<char, int>> laneOrder;
+
+static void LaneTarget(char lane, int sequence) { laneOrder.emplace_back(lane, sequence); }
+
+// Test the priority lanes are served by weighted round robin: the high lane
+// first, each lane in order, and the low lane within every round
+TEST(Port_IT, PriorityLanes)
+{
+	static const int CALLS = 40;
+
+	laneOrder.clear();
+	WorkerThread thread("PriorityLanes");
+	ASSERT_TRUE(thread.CreateThread());
+
+	// Hold the thread so each lane fills
+	promise<void> started;
+	promise<void> release;
+	future<void> running = started.get_future();
+	shared_future<void> released = release.get_future().share();
+	MakeDelegate(std::function<void()>([&started, released]() {
+		started.set_value();
+		released.wait();
+	}), thread)();
+	running.wait();
+
+	// Queued lowest priority first, so order only comes from the lanes
+	auto low = MakeDelegate(&LaneTarget, thread.GetPriorityThread(WorkerThread::Priority::LOW));
+	auto normal = MakeDelegate(&LaneTarget, thread.GetPriorityThread(WorkerThread::Priority::NORMAL));
+	auto high = MakeDelegate(&LaneTarget, thread.GetPriorityThread(WorkerThread::Priority::HIGH));
+	for (int i = 0; i < CALLS; i++)
+		low('L', i);
+	for (int i = 0; i < CALLS; i++)
+		normal('N', i);
+	for (int i = 0; i < CALLS; i++)
+		high('H', i);
+	release.set_value();
+	thread.ExitThread();
+	ASSERT_EQ(laneOrder.size(), (size_t)CALLS * 3);
+
+	// A round takes up to 16 high, 4 normal and 1 low message
+	const int ROUND = WorkerThread::LANE_WEIGHTS[0] + WorkerThread::LANE_WEIGHTS[1] + WorkerThread::LANE_WEIGHTS[2];
+	for (int i = 0; i < WorkerThread::LANE_WEIGHTS[0]; i++)
+		EXPECT_EQ(laneOrder[i].first, 'H') << i;
+	for (int round = 0; round < 2; round++)
+	{
+		int counts[3] = {};
+		for (int i = round * ROUND; i < (round + 1) * ROUND; i++)
+			counts[laneOrder[i].first == 'H' ? 0 : laneOrder[i].first == 'N' ? 1 : 2]++;
+		EXPECT_GE(counts[0], WorkerThread::LANE_WEIGHTS[0] - 1) << round;
+		EXPECT_GE(counts[1], WorkerThread::LANE_WEIGHTS[1] - 1) << round;
+		EXPECT_GE(counts[2], WorkerThread::LANE_WEIGHTS[2]) << round;
+	}
+
+	// Each lane keeps its order
+	int next[3] = {};
+	for (auto& call : laneOrder)
+	{
+		int lane = call.first == 'H' ? 0 : call.first == 'N' ? 1 : 2;
+		EXPECT_EQ(call.second, next[lane]++);
+	}
+}
+
+static atomic<int> deadlineCalls(0);
+
+static void DeadlineTarget(int value)
+{
+	(void)value;
+	deadlineCalls++;
+}
+
+// Test messages still queued once the deadline budget elapses are discarded
+// when taken, without calling the target, and counted as expired
+TEST(Port_IT, DeadlineBudget)
+{
+	deadlineCalls = 0;
+	WorkerThread thread("DeadlineBudget");
+	ASSERT_TRUE(thread.CreateThread());
+
+	// Hold the thread past the budget so dispatched messages stay queued
+	promise<void> started;
+	promise<void> release;
+	future<void> running = started.get_future();
+	shared_future<void> released = release.get_future().share();
+	MakeDelegate(std::function<void()>([&started, released]() {
+		started.set_value();
+		released.wait();
+	}), thread)();
+	running.wait();
+
+	uint64_t expired = thread.GetStats().expired;
+	thread.SetDeadlineBudget(milliseconds(10));
+	auto async = MakeDelegate(&DeadlineTarget, thread);
+	for (int i = 0; i < 3; i++)
+		async(i);
+	this_thread::sleep_for(milliseconds(30));
+	release.set_value();
+
+	// A message taken within the budget is invoked. A budget change leaves the
+	// deadlines stamped on queued messages.
+	thread.SetDeadlineBudget(seconds(10));
+	MakeDelegate(&DeadlineTarget, thread, WAIT_INFINITE).AsyncInvoke(3);
+	EXPECT_EQ(deadlineCalls.load(), 1);
+	EXPECT_EQ(thread.GetStats().expired - expired, 3u);
+
+	// Without a budget queued messages never expire
+	thread.SetDeadlineBudget(std::chrono::nanoseconds(0));
+	async(4);
+	MakeDelegate(&DeadlineTarget, thread, WAIT_INFINITE).AsyncInvoke(5);
+	EXPECT_EQ(deadlineCalls.load(), 3);
+	EXPECT_EQ(thread.GetStats().expired - expired, 3u);
+	thread.ExitThread();
+}
+
+static int WaitStatsTarget(int sleepMs)
+{
+	this_thread::sleep_for(milliseconds(sleepMs));
+	return sleepMs;
+}
+
+// Test the outcome and wait time of blocking calls are counted per target thread
+TEST(Port_IT, WaitStats)
+{
+	WorkerThread thread("WaitStatsThread");
+	ASSERT_TRUE(thread.CreateThread());
+	EXPECT_EQ(thread.GetWaitStats(), nullptr);
+	thread.SetWaitStats(true);
+	DelegateWaitStats* stats = thread.GetWaitStats();
+	ASSERT_NE(stats, nullptr);
+
+	// A call completed in time
+	EXPECT_TRUE(MakeDelegate(&WaitStatsTarget, thread, milliseconds(500)).AsyncInvoke(0).has_value());
+
+	// A call queued behind a slow one times out and is later discarded unseen
+	MakeDelegate(&WaitStatsTarget, thread)(50);
+	EXPECT_FALSE(MakeDelegate(&WaitStatsTarget, thread, milliseconds(5)).AsyncInvoke(0).has_value());
+	for (int i = 0; i < 100 && stats->GetDiscarded() == 0; i++)
+		this_thread::sleep_for(milliseconds(5));
+
+	// A call started in time completes after its timeout expired
+	EXPECT_TRUE(MakeDelegate(&WaitStatsTarget, thread, milliseconds(5)).AsyncInvoke(30).has_value());
+
+	EXPECT_EQ(stats->GetCalls(), 3u);
+	EXPECT_EQ(stats->GetCompletions(), 2u);
+	EXPECT_EQ(stats->GetTimeouts(), 1u);
+	EXPECT_EQ(stats->GetDiscarded(), 1u);
+	EXPECT_EQ(stats->GetOverran(), 1u);
+	auto waitTime = stats->GetWaitTime();
+	EXPECT_EQ(waitTime.count, 3u);
+	EXPECT_GE(waitTime.max, (uint64_t)duration_cast<nanoseconds>(milliseconds(30)).count());
+
+	// Published through the metrics registry
+	EXPECT_EQ(Metrics::GetCounter("delegate.async_wait.WaitStatsThread.calls").GetValue(), 3u);
+
+	thread.SetWaitStats(false);
+	EXPECT_EQ(thread.GetWaitStats(), nullptr);
+	thread.ExitThread();
+}
+
+// An executor queue standing in for an external pool, run by the test
+struct TestExecutorQueue
+{
+	vector<function<void()>> closures;
+	void RunAll()
+	{
+		auto pending = std::move(closures);
+		closures.clear();
+		for (auto& closure : pending)
+			closure();
+	}
+};
+
+// An executor with an execute() member, as Asio executors have
+struct TestExecuteExecutor
+{
+	TestExecutorQueue* queue;
+	void execute(function<void()> f) { queue->closures.push_back(std::move(f)); }
+};
+
+// An executor with an enqueue() member, as tbb::task_arena has
+struct TestEnqueueExecutor
+{
+	TestExecutorQueue* queue;
+	void enqueue(function<void()> f) { queue->closures.push_back(std::move(f)); }
+};
+
+// Async delegates copy pointed to arguments, so the calls are collected in a static
+static std::vector<int> executorCalls;
+static void ExecutorTarget(int value)
+{
+	executorCalls.push_back(value);
+}
+
+// Test async delegates run on an external executor through an ExecutorThread
+TEST(Port_IT, ExecutorThread)
+{
+	TestExecutorQueue queue;
+	std::vector<int>& calls = executorCalls;
+	calls.clear();
+
+	// Messages run when the executor runs its closures
+	ExecutorThread<TestExecuteExecutor> executeThread(TestExecuteExecutor{ &queue }, true);
+	EXPECT_TRUE(executeThread.IsOrdered());
+	MakeDelegate(&ExecutorTarget, executeThread)(1);
+	MakeDelegate(&ExecutorTarget, executeThread)(2);
+	EXPECT_TRUE(calls.empty());
+	EXPECT_EQ(queue.closures.size(), 2u);
+	queue.RunAll();
+	EXPECT_EQ(calls, (std::vector<int>{ 1, 2 }));
+
+	// A batch is posted as one closure invoking the messages in order
+	auto enqueueThread = MakeExecutorThread(TestEnqueueExecutor{ &queue });
+	EXPECT_FALSE(enqueueThread->IsOrdered());
+	{
+		DispatchBatch batch(*enqueueThread);
+		MakeDelegate(&ExecutorTarget, batch)(3);
+		MakeDelegate(&ExecutorTarget, batch)(4);
+	}
+	EXPECT_EQ(queue.closures.size(), 1u);
+	queue.RunAll();
+	EXPECT_EQ(calls, (std::vector<int>{ 1, 2, 3, 4 }));
+
+	// A callable executor forwarding to a WorkerThread pool, with a blocking call
+	WorkerThread worker("ExecutorThreadPool");
+	ASSERT_TRUE(worker.CreateThread());
+	auto forward = [&worker](function<void()> f) { MakeDelegate(std::function<void()>(std::move(f)), worker)(); };
+	auto callableThread = MakeExecutorThread(forward);
+	auto result = MakeDelegate(std::function<int(int)>([](int x) { return x * 2; }), *callableThread, milliseconds(500)).AsyncInvoke(21);
+	ASSERT_TRUE(result.has_value());
+	EXPECT_EQ(result.value(), 42);
+
+	// A blocking call abandoned while queued is discarded unseen
+	bool ran = false;
+	auto abandoned = MakeDelegate(std::function<void()>([&ran]() { ran = true; }), executeThread, milliseconds(1)).AsyncInvoke();
+	EXPECT_FALSE(abandoned.has_value());
+	queue.RunAll();
+	EXPECT_FALSE(ran);
+	worker.ExitThread();
+}
+
+// Test delayed and scheduled async delegate dispatch
+TEST(Port_IT, ScheduledDispatch)
+{
+	WorkerThread thread("ScheduledDispatch");
+	ASSERT_TRUE(thread.CreateThread());
+
+	// Calls run in due order, each once its delay elapses
+	mutex lock;
+	condition_variable cv;
+	vector<pair<string, steady_clock::duration>> calls;
+	auto start = steady_clock::now();
+	std::function<void(string)> record = [&](string name) {
+		lock_guard<mutex> lk(lock);
+		calls.emplace_back(name, steady_clock::now() - start);
+		cv.notify_all();
+	};
+	auto delegate = MakeDelegate(record, thread);
+	EXPECT_TRUE(delegate.AsyncInvokeAfter(milliseconds(60), "C"));
+	EXPECT_TRUE(delegate.AsyncInvokeAfter(milliseconds(20), "A"));
+	EXPECT_TRUE(delegate.AsyncInvokeAfter(milliseconds(40), "B"));
+	EXPECT_TRUE(delegate.AsyncInvokeAt(Clock::Now(), "now"));
+	{
+		unique_lock<mutex> lk(lock);
+		ASSERT_TRUE(cv.wait_for(lk, seconds(5), [&]() { return calls.size() == 4; }));
+	}
+	EXPECT_EQ(calls[0].first, "now");
+	EXPECT_EQ(calls[1].first, "A");
+	EXPECT_EQ(calls[2].first, "B");
+	EXPECT_EQ(calls[3].first, "C");
+	EXPECT_GE(calls[1].second, milliseconds(20));
+	EXPECT_GE(calls[3].second, milliseconds(60));
+
+	// Not delayed to a polling tick
+	EXPECT_LT(calls[1].second, milliseconds(95));
+
+	// Calls not yet due are discarded on exit
+	EXPECT_TRUE(delegate.AsyncInvokeAfter(seconds(10), "late"));
+	EXPECT_EQ(thread.GetScheduledSize(), 1u);
+	EXPECT_EQ(thread.ExitThread(), 1u);
+	EXPECT_EQ(calls.size(), 4u);
+
+	// A scheduled thread runs the call once virtual time reaches it
+	DeterministicScheduler scheduler(0);
+	DeterministicScheduler::Install(&scheduler);
+	{
+		WorkerThread scheduled("ScheduledDispatchVirtual", WorkerThread::QueuePolicy::SCHEDULED);
+		ASSERT_TRUE(scheduled.CreateThread());
+		auto virtualStart = Clock::Now();
+		steady_clock::duration ranAt(0);
+		std::function<void()> target = [&]() { ranAt = Clock::Now() - virtualStart; };
+		EXPECT_TRUE(MakeDelegate(target, scheduled).AsyncInvokeAfter(milliseconds(250)));
+		EXPECT_EQ(scheduler.RunFor(milliseconds(100)), 0u);
+		EXPECT_EQ(scheduler.RunFor(seconds(1)), 1u);
+		EXPECT_EQ(duration_cast<milliseconds>(ranAt), milliseconds(250));
+	}
+	DeterministicScheduler::Install(nullptr);
+
+	// A thread without a timer structure does not schedule
+	TestExecutorQueue queue;
+	ExecutorThread<TestExecuteExecutor> executorThread(TestExecuteExecutor{ &queue });
+	EXPECT_FALSE(MakeDelegate(record, executorThread).AsyncInvokeAfter(milliseconds(1), "executor"));
+	EXPECT_TRUE(queue.closures.empty());
+}
+
+static std::atomic<int> staticThreadSum{ 0 };
+static int StaticThreadAdd(int value) { return staticThreadSum += value; }
+static SignalThread staticThreadSignal;
+static void StaticThreadTimer() { staticThreadSignal.SetSignal(); }
+
+// Test a statically sized thread invokes delegates and timers from its own storage
+TEST(Port_IT, StaticWorkerThread)
+{
+	static StaticWorkerThread<4> thread("StaticThread");
+#ifndef DELEGATE_NO_EXCEPTIONS
+	EXPECT_THROW(MakeDelegate(&StaticThreadAdd, thread).AsyncInvoke(1), std::invalid_argument);
+#endif
+	ASSERT_TRUE(thread.CreateThread());
+	const size_t poolFree = thread.GetPoolFree();
+
+	// More messages than the queue holds wait for a free slot
+	staticThreadSum = 0;
+	auto add = MakeDelegate(&StaticThreadAdd, thread);
+	for (int i = 1; i <= 100; i++)
+		add.AsyncInvoke(i);
+	EXPECT_EQ(MakeDelegate(&StaticThreadAdd, thread, WAIT_INFINITE).AsyncInvoke(0).value_or(0), 5050);
+	EXPECT_EQ(staticThreadSum.load(), 5050);
+
+	// A timer of the thread's set expires on the thread
+	Timer timer(thread.GetTimers());
+	timer.Expired = MakeDelegate(&StaticThreadTimer);
+	timer.Start(std::chrono::milliseconds(5), false);
+	EXPECT_TRUE(staticThreadSignal.WaitForSignal(2000));
+
+	thread.ExitThread();
+	EXPECT_EQ(thread.GetQueueSize(), 0u);
+	EXPECT_EQ(thread.GetPoolFree(), poolFree);
+}
+
+#ifdef __linux__
+static SignalThread reactorTimerSignal;
+static std::atomic<bool> reactorTimerOnThread{ false };
+static std::thread::id reactorThreadId;
+static void ReactorTimerExpired()
+{
+	reactorTimerOnThread = std::this_thread::get_id() == reactorThreadId;
+	reactorTimerSignal.SetSignal();
+}
+static void ReactorGetThreadId() { reactorThreadId = std::this_thread::get_id(); }
+
+// Test reactor timers expire on the reactor thread, woken by its timerfd
+TEST(Port_IT, ReactorTimers)
+{
+	ReactorThread reactor("ReactorTimers");
+	ASSERT_TRUE(reactor.CreateThread());
+	MakeDelegate(&ReactorGetThreadId, reactor, WAIT_INFINITE).AsyncInvoke();
+
+	Timer timer(reactor.GetTimers());
+	timer.Expired = MakeDelegate(&ReactorTimerExpired);
+	auto start = std::chrono::steady_clock::now();
+	timer.Start(std::chrono::milliseconds(20), false);
+	ASSERT_TRUE(reactorTimerSignal.WaitForSignal(2000));
+	EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+	EXPECT_TRUE(reactorTimerOnThread.load());
+
+	// A periodic timer keeps expiring until stopped
+	timer.Start(std::chrono::milliseconds(2));
+	EXPECT_TRUE(reactorTimerSignal.WaitForCount(3, 2000));
+	timer.Stop();
+	reactor.ExitThread();
+}
+#endif
+
+// Test a thread's timers follow an installed VirtualClock: they never expire in
+// real time, and an advance wakes the thread to expire them at once
+TEST(Port_IT, VirtualClock)
+{
+	VirtualClock clock;
+	Clock::Set(&clock);
+	WorkerThread thread("VirtualClock");
+	EXPECT_TRUE(thread.CreateThread());
+
+	atomic<int> expirations(0);
+	auto waitFor = [&expirations](int count) {
+		auto deadline = steady_clock::now() + seconds(2);
+		while (expirations.load() < count && steady_clock::now() < deadline)
+			this_thread::sleep_for(milliseconds(1));
+		return expirations.load();
+	};
+	Timer timer(thread.GetTimers());
+	timer.Expired = MakeDelegate(std::function<void()>([&expirations]() { expirations++; }));
+	timer.Start(seconds(60));
+
+	auto start = Clock::Now();
+	this_thread::sleep_for(milliseconds(20));
+	EXPECT_EQ(Clock::Now(), start);
+	EXPECT_EQ(expirations.load(), 0);
+
+	clock.Advance(seconds(59));
+	this_thread::sleep_for(milliseconds(20));
+	EXPECT_EQ(expirations.load(), 0);
+	clock.Advance(seconds(1));
+	EXPECT_EQ(waitFor(1), 1);
+	EXPECT_EQ(Clock::Now() - start, seconds(60));
+
+	// A periodic timer advanced past several periods expires once and skips the rest
+	clock.Advance(seconds(150));
+	EXPECT_EQ(waitFor(2), 2);
+	this_thread::sleep_for(milliseconds(20));
+	EXPECT_EQ(expirations.load(), 2);
+
+	timer.Stop();
+	thread.ExitThread();
+	Clock::Set(nullptr);
+}
+
+// Test Expired callbacks run without the set lock, so a callback stops, restarts
+// or destroys another timer of its set, and a timer collected with it is skipped.
+// The set is serviced by the test thread on a virtual clock.
+TEST(Port_IT, TimerSetCallbacks)
+{
+	VirtualClock clock;
+	Clock::Set(&clock);
+	TimerSet timers;
+	vector<string> trace;
+	auto expired = [&trace](const char* name) {
+		return MakeDelegate(std::function<void()>([&trace, name]() { trace.push_back(name); }));
+	};
+
+	// A callback stops and restarts timers due in the same batch
+	Timer first(timers), stopped(timers), restarted(timers);
+	first.Expired = MakeDelegate(std::function<void()>([&]() {
+		trace.push_back("first");
+		stopped.Stop();
+		restarted.Start(milliseconds(5), false);
+	}));
+	stopped.Expired = expired("stopped");
+	restarted.Expired = expired("restarted");
+	first.Start(milliseconds(5), false);
+	stopped.Start(milliseconds(10), false);
+	restarted.Start(milliseconds(10), false);
+	clock.Advance(milliseconds(10));
+	timers.ProcessTimers();
+	EXPECT_EQ(trace, (vector<string>{ "first" }));
+	EXPECT_FALSE(stopped.Enabled());
+	clock.Advance(milliseconds(5));
+	timers.ProcessTimers();
+	EXPECT_EQ(trace, (vector<string>{ "first", "restarted" }));
+
+	// A timer destroyed by a callback while its own callback is pending is skipped
+	trace.clear();
+	Timer destroyer(timers);
+	auto destroyed = std::make_unique<Timer>(timers);
+	destroyer.Expired = MakeDelegate(std::function<void()>([&]() {
+		trace.push_back("destroyer");
+		destroyed.reset();
+	}));
+	destroyed->Expired = expired("destroyed");
+	destroyer.Start(milliseconds(5), false);
+	destroyed->Start(milliseconds(10), false);
+	clock.Advance(milliseconds(10));
+	timers.ProcessTimers();
+	EXPECT_EQ(trace, (vector<string>{ "destroyer" }));
+	EXPECT_FALSE(destroyed);
+
+	// Destroying a timer waits for its callback running on another thread
+	atomic<bool> finished(false);
+	promise<void> entered;
+	auto running = std::make_unique<Timer>(timers);
+	running->Expired = MakeDelegate(std::function<void()>([&]() {
+		entered.set_value();
+		this_thread::sleep_for(milliseconds(20));
+		finished = true;
+	}));
+	running->Start(milliseconds(1), false);
+	clock.Advance(milliseconds(1));
+	std::thread servicer([&timers]() { timers.ProcessTimers(); });
+	entered.get_future().wait();
+	running.reset();
+	EXPECT_TRUE(finished.load());
+	servicer.join();
+
+	// Timers with slack due 100us apart expire together on the next 2048us boundary
+	trace.clear();
+	clock.Advance(microseconds(2048 - Timer::GetTime().count() % 2048));
+	uint64_t start = (uint64_t)Timer::GetTime().count();
+	Timer slackA(timers), slackB(timers);
+	slackA.SetSlack(microseconds(2048));
+	slackB.SetSlack(microseconds(2048));
+	EXPECT_EQ(slackA.GetSlack(), microseconds(2048));
+	slackA.Expired = expired("slackA");
+	slackB.Expired = expired("slackB");
+	slackA.Start(microseconds(1000), false);
+	clock.Advance(microseconds(100));
+	slackB.Start(microseconds(1000), false);
+	microseconds next;
+	EXPECT_TRUE(timers.GetNextExpiration(next));
+	EXPECT_EQ((uint64_t)next.count(), start + 2048);
+	clock.Advance(microseconds(1000));
+	timers.ProcessTimers();
+	EXPECT_TRUE(trace.empty());
+	clock.Advance(microseconds(948));
+	timers.ProcessTimers();
+	EXPECT_EQ(trace, (vector<string>{ "slackA", "slackB" }));
+
+	Clock::Set(nullptr);
+}
+
+static std::atomic<int> subsystemOrder{ 0 };
+static std::atomic<int> subsystemAOrder{ 0 };
+static std::atomic<int> subsystemBOrder{ 0 };
+
+// Test the subsystem registry starts independent subsystems concurrently, a
+// subsystem only after its dependencies, and reports the subsystems not started
+TEST(Port_IT, SubsystemRegistry)
+{
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_A", {}, []() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		subsystemAOrder = ++subsystemOrder;
+	}));
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_B", { "IT_A" }, []() { subsystemBOrder = ++subsystemOrder; }));
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_C", {}, []() {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}));
+	EXPECT_FALSE(SubsystemRegistry::Register("IT_C", {}, nullptr));
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_Unknown", { "IT_Missing" }, nullptr));
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_Blocked", { "IT_Unknown" }, nullptr));
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_X", { "IT_Y" }, nullptr));
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_Y", { "IT_X" }, nullptr));
+
+	auto subsystems = SubsystemRegistry::Start(2);
+	ASSERT_EQ(subsystems.size(), 7u);
+	EXPECT_TRUE(subsystems[0].ready && subsystems[1].ready && subsystems[2].ready);
+	EXPECT_LT(subsystemAOrder.load(), subsystemBOrder.load());
+	EXPECT_GE(subsystems[1].waited, subsystems[0].readyTime);
+
+	// IT_A and IT_C sleep concurrently on the two startup threads
+	EXPECT_LT(subsystems[2].waited, subsystems[0].readyTime);
+	EXPECT_GE(subsystems[0].startTime, std::chrono::milliseconds(50));
+
+	EXPECT_FALSE(subsystems[3].ready);
+	EXPECT_EQ(subsystems[3].error, "unknown dependency IT_Missing");
+	EXPECT_EQ(subsystems[4].error, "dependency IT_Unknown not ready");
+	EXPECT_EQ(subsystems[5].error, "dependency cycle through IT_Y");
+	EXPECT_EQ(subsystems[6].error, "dependency cycle through IT_X");
+
+	// A later start may depend on a subsystem already started
+	EXPECT_FALSE(SubsystemRegistry::Register("IT_A", {}, nullptr));
+	EXPECT_TRUE(SubsystemRegistry::Register("IT_D", { "IT_B" }, nullptr));
+	subsystems = SubsystemRegistry::Start(2);
+	ASSERT_EQ(subsystems.size(), 1u);
+	EXPECT_TRUE(subsystems[0].ready);
+
+	std::ostringstream dump;
+	SubsystemRegistry::Dump(dump, subsystems);
+	EXPECT_NE(dump.str().find("IT_D"), string::npos);
+}
+
+static std::atomic<int> originNested{ 0 };
+static WorkerThread* originThread = nullptr;
+
+// Use about the given CPU time on the calling thread
+static void BurnCpu(int ms)
+{
+	auto end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+	volatile uint64_t sum = 0;
+	while (std::chrono::steady_clock::now() < end)
+		sum = sum + 1;
+}
+
+static void OriginNested()
+{
+	originNested++;
+}
+
+static void OriginWork(int ms, bool nested)
+{
+	BurnCpu(ms);
+
+	// A call the target makes carries the origin of the message invoking it
+	if (nested)
+		MakeDelegate(&OriginNested, *originThread)();
+}
+
+// Test a WorkerThread accounts the CPU time of each delegate to the origin of
+// its message
+TEST(Port_IT, OriginAccounting)
+{
+	WorkerThread thread("OriginAccountingThread");
+	thread.CreateThread();
+	thread.SetOriginAccounting(true);
+	originThread = &thread;
+
+	OriginId heavy = RegisterOrigin("IT_OriginHeavy");
+	OriginId light = RegisterOrigin("IT_OriginLight");
+	ASSERT_NE(heavy, NO_ORIGIN);
+	EXPECT_EQ(RegisterOrigin("IT_OriginHeavy"), heavy);
+	EXPECT_EQ(GetOriginName(light), "IT_OriginLight");
+
+	auto work = MakeDelegate(&OriginWork, thread);
+	{
+		OriginScope scope(heavy);
+		for (int i = 0; i < 3; i++)
+			work(20, true);
+	}
+	EXPECT_EQ(GetThreadOrigin(), NO_ORIGIN);
+	{
+		OriginScope scope(light);
+		work(1, false);
+	}
+	work(1, false);
+
+	// An explicit origin overrides the sending thread's
+	auto msg = std::make_shared<DelegateMsg>(nullptr);
+	EXPECT_EQ(msg->GetOrigin(), NO_ORIGIN);
+	msg->SetOrigin(light);
+	EXPECT_EQ(msg->GetOrigin(), light);
+
+	// The first wait follows the work, the second the nested calls it made
+	auto wait = MakeDelegate(&OriginNested, thread, WAIT_INFINITE);
+	wait();
+	wait();
+	EXPECT_EQ(originNested.load(), 5);
+
+	auto usage = thread.GetOriginUsage();
+	ASSERT_GE(usage.size(), 3u);
+	EXPECT_EQ(usage[0].origin, heavy);
+	EXPECT_EQ(usage[0].name, "IT_OriginHeavy");
+	EXPECT_EQ(usage[0].invoked, 6u);
+#ifdef __linux__
+	EXPECT_GE(usage[0].cpuTime, std::chrono::milliseconds(30));
+#endif
+	auto find = [&usage](OriginId origin) {
+		return std::find_if(usage.begin(), usage.end(), [origin](const WorkerThread::OriginUsage& u) { return u.origin == origin; });
+	};
+	ASSERT_NE(find(light), usage.end());
+	EXPECT_EQ(find(light)->invoked, 1u);
+	ASSERT_NE(find(NO_ORIGIN), usage.end());
+	EXPECT_EQ(find(NO_ORIGIN)->invoked, 3u);
+	EXPECT_LT(find(light)->cpuTime, usage[0].cpuTime);
+
+	thread.SetOriginAccounting(true);
+	EXPECT_TRUE(thread.GetOriginUsage().empty());
+	thread.ExitThread();
+}
+
+// Per-core state of the CoreGroup test, set up by each core's init function
+static std::atomic<bool> coreInitOnCore[2];
+static thread_local int coreSent = 0;
+static std::atomic<int> coreReceived{ 0 };
+static std::atomic<bool> coreInOrder{ true };
+static std::atomic<bool> coreOnTarget{ true };
+static std::atomic<bool> coreScratch{ true };
+static std::atomic<bool> coreTimerOnCore{ false };
+static CoreThread* coreTarget = nullptr;
+static SignalThread coreTimerSignal;
+
+static void CoreReceive(int seq)
+{
+	static int expected = 0;
+	coreInOrder = coreInOrder && seq == expected++;
+	coreOnTarget = coreOnTarget && CoreGroup::CurrentCore() && CoreGroup::CurrentCore()->GetIndex() == 1;
+	ScratchArena* scratch = CoreThread::GetScratchArena();
+	coreScratch = coreScratch && scratch && scratch->GetUsed() == 0 && scratch->Allocate(64, 8);
+	coreReceived++;
+}
+
+static void CoreSend(int count)
+{
+	// Far more calls than the ring holds, so most wait in the sender's backlog
+	auto receive = MakeDelegate(&CoreReceive, *coreTarget);
+	for (int i = 0; i < count; i++)
+		receive.AsyncInvoke(i);
+	coreSent += count;
+}
+
+static int CoreSent() { return coreSent; }
+
+static size_t CoreIndex() { return CoreGroup::CurrentCore() ? CoreGroup::CurrentCore()->GetIndex() : SIZE_MAX; }
+
+static std::atomic<int> coreCounted{ 0 };
+static void CoreCount() { coreCounted++; }
+static void CoreSendCounted(int count)
+{
+	auto counted = MakeDelegate(&CoreCount, *coreTarget);
+	for (int i = 0; i < count; i++)
+		counted.AsyncInvoke();
+}
+
+static void CoreTimerExpired()
+{
+	coreTimerOnCore = CoreIndex() == 0;
+	coreTimerSignal.SetSignal();
+}
+
+// Test a thread-per-core group: cross-core calls through the rings, calls from
+// outside the group, per-core state, timers and scratch arenas
+TEST(Port_IT, CoreGroup)
+{
+	static const int CALLS = 5000;
+
+	unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+	{
+		CoreGroup group("CoreGroup", { 0, std::min(1u, cpus - 1) }, 64);
+		ASSERT_EQ(group.GetCoreCount(), 2u);
+		EXPECT_EQ(CoreGroup::CurrentCore(), nullptr);
+
+		// Each core runs the init function before any call
+		group.Start([](CoreThread& core) { coreInitOnCore[core.GetIndex()] = CoreGroup::CurrentCore() == &core; });
+		CoreThread& core0 = group.GetCore(0);
+		CoreThread& core1 = group.GetCore(1);
+
+		// A blocking call from outside the group runs on the target core
+		EXPECT_EQ(MakeDelegate(&CoreIndex, core1, WAIT_INFINITE).AsyncInvoke().value(), 1u);
+
+		// Core 0 calls core 1 through their ring, in order, overflowing it
+		coreTarget = &core1;
+		MakeDelegate(&CoreSend, core0).AsyncInvoke(CALLS);
+		auto start = steady_clock::now();
+		while (coreReceived < CALLS && steady_clock::now() - start < seconds(10))
+			this_thread::sleep_for(milliseconds(1));
+		EXPECT_EQ(coreReceived.load(), CALLS);
+		EXPECT_TRUE(coreInOrder.load());
+		EXPECT_TRUE(coreOnTarget.load());
+		EXPECT_TRUE(coreScratch.load());
+		EXPECT_GT(core1.GetBacklogged(), 0u);
+		EXPECT_EQ(core1.GetQueueSize(), 0u);
+		EXPECT_TRUE(coreInitOnCore[0].load());
+		EXPECT_TRUE(coreInitOnCore[1].load());
+
+		// Per-core state is only seen on its own core
+		EXPECT_EQ(MakeDelegate(&CoreSent, core0, WAIT_INFINITE).AsyncInvoke().value(), CALLS);
+		EXPECT_EQ(MakeDelegate(&CoreSent, core1, WAIT_INFINITE).AsyncInvoke().value(), 0);
+
+		// A core's timers expire on the core
+		Timer timer(core0.GetTimers());
+		timer.Expired = MakeDelegate(&CoreTimerExpired);
+		timer.Start(milliseconds(10), false);
+		ASSERT_TRUE(coreTimerSignal.WaitForSignal(2000));
+		EXPECT_TRUE(coreTimerOnCore.load());
+		group.Stop();
+
+		// The calls a core holds for another when stopping are still invoked
+		group.Start();
+		MakeDelegate(&CoreSendCounted, core0, WAIT_INFINITE).AsyncInvoke(CALLS);
+		group.Stop();
+		EXPECT_EQ(coreCounted.load(), CALLS);
+		EXPECT_EQ(core1.GetDropped(), 0u);
+
+		// A stopped group rejects calls
+#ifndef DELEGATE_NO_EXCEPTIONS
+		EXPECT_THROW(MakeDelegate(&CoreCount, core1).AsyncInvoke(), std::invalid_argument);
+#endif
+	}
+}
+
+// Completions of the AsyncFile test, recorded on the caller's thread
+static std::vector<AsyncFile::Result> asyncFileResults;
+static std::atomic<bool> asyncFileOnCaller{ true };
+static std::thread::id asyncFileCallerId;
+static SignalThread asyncFileSignal;
+static void AsyncFileCallerId() { asyncFileCallerId = std::this_thread::get_id(); }
+static void AsyncFileDone(const AsyncFile::Result& result)
+{
+	asyncFileOnCaller = asyncFileOnCaller && std::this_thread::get_id() == asyncFileCallerId;
+	asyncFileResults.push_back(result);
+	asyncFileSignal.SetSignal();
+}
+
+// Test file operations run on the I/O thread in order and complete on the
+// caller's thread
+TEST(Port_IT, AsyncFile)
+{
+	WorkerThread caller("AsyncFileCaller");
+	ASSERT_TRUE(caller.CreateThread());
+	MakeDelegate(&AsyncFileCallerId, caller, WAIT_INFINITE).AsyncInvoke();
+	auto done = MakeDelegate(&AsyncFileDone, caller);
+
+	remove("AsyncFile.bin");
+	{
+		AsyncFile file;
+		file.Open("AsyncFile.bin", true, done);
+		file.Write("hello world", AsyncFile::APPEND, done);
+		file.Write("HELLO", 0, done);
+		file.Write(" again", AsyncFile::APPEND, done);
+		file.Sync(done);
+		file.Read(0, 100, done);
+		file.Read(6, 5, done);
+		file.Close(done);
+		file.Read(0, 1, done);
+		EXPECT_TRUE(asyncFileSignal.WaitForCount(9, 5000));
+		EXPECT_EQ(file.GetPending(), 0u);
+
+		// Opening a missing directory reports the error
+		file.Open("AsyncFileMissing/AsyncFile.bin", false, done);
+		EXPECT_TRUE(asyncFileSignal.WaitForCount(1, 5000));
+	}
+
+	// Flush the completions queued to the caller
+	MakeDelegate(&AsyncFileCallerId, caller, WAIT_INFINITE).AsyncInvoke();
+	caller.ExitThread();
+	ASSERT_EQ(asyncFileResults.size(), 10u);
+	EXPECT_TRUE(asyncFileOnCaller.load());
+
+	const auto& r = asyncFileResults;
+	EXPECT_EQ(r[0].op, AsyncFile::Op::OPEN);
+	EXPECT_TRUE(r[0].Ok());
+	EXPECT_EQ(r[1].offset, 0u);
+	EXPECT_EQ(r[1].bytes, 11u);
+	EXPECT_EQ(r[3].offset, 11u);
+	EXPECT_EQ(r[4].op, AsyncFile::Op::SYNC);
+	EXPECT_TRUE(r[4].Ok());
+	EXPECT_EQ(r[5].data, "HELLO world again");
+	EXPECT_EQ(r[6].data, "world");
+	EXPECT_EQ(r[7].op, AsyncFile::Op::CLOSE);
+	EXPECT_TRUE(r[7].Ok());
+	EXPECT_EQ(r[8].error, EBADF);
+	EXPECT_EQ(r[9].op, AsyncFile::Op::OPEN);
+	EXPECT_FALSE(r[9].Ok());
+
+	remove("AsyncFile.bin");
+}
+
+static std::atomic<int> wakeupCalls{ 0 };
+static void WakeupTarget(int sleepMs)
+{
+	this_thread::sleep_for(milliseconds(sleepMs));
+	wakeupCalls++;
+}
+
+// Test dispatches to a busy thread make no wakeup, and a dispatch to a
+// sleeping thread makes exactly one
+TEST(Port_IT, WakeupSuppression)
+{
+	static const int CALLS = 1000;
+
+	WorkerThread thread("WakeupSuppression");
+	ASSERT_TRUE(thread.CreateThread());
+	MakeDelegate(&WakeupTarget, thread, WAIT_INFINITE).AsyncInvoke(0);
+	this_thread::sleep_for(milliseconds(20));
+
+	// The first call wakes the thread, the burst queued while it runs does not
+	WorkerThread::Stats before = thread.GetStats();
+	auto target = MakeDelegate(&WakeupTarget, thread);
+	target.AsyncInvoke(50);
+	for (int i = 0; i < CALLS; i++)
+		target.AsyncInvoke(0);
+	MakeDelegate(&WakeupTarget, thread, WAIT_INFINITE).AsyncInvoke(0);
+	WorkerThread::Stats after = thread.GetStats();
+	EXPECT_EQ(wakeupCalls.load(), CALLS + 3);
+	EXPECT_LE(after.wakeups - before.wakeups, 3u);
+	EXPECT_GE(after.wakeupsAvoided - before.wakeupsAvoided, (uint64_t)CALLS - 2);
+
+	// A thread left idle sleeps, and one dispatch wakes it once
+	this_thread::sleep_for(milliseconds(20));
+	before = thread.GetStats();
+	MakeDelegate(&WakeupTarget, thread, WAIT_INFINITE).AsyncInvoke(0);
+	after = thread.GetStats();
+	EXPECT_EQ(after.wakeups - before.wakeups, 1u);
+	thread.ExitThread();
+}
+
+// Records the thread its last owner destroys it on
+struct ReclaimTracked
+{
+	~ReclaimTracked()
+	{
+		std::lock_guard<std::mutex> lock(Lock());
+		Threads().push_back(std::this_thread::get_id());
+	}
+	static std::mutex& Lock() { static std::mutex lock; return lock; }
+	static std::vector<std::thread::id>& Threads() { static std::vector<std::thread::id> threads; return threads; }
+	static std::vector<std::thread::id> Take(size_t count)
+	{
+		for (int i = 0; i < 2000; i++)
+		{
+			{
+				std::lock_guard<std::mutex> lock(Lock());
+				if (Threads().size() >= count)
+					return std::move(Threads());
+			}
+			this_thread::sleep_for(milliseconds(1));
+		}
+		std::lock_guard<std::mutex> lock(Lock());
+		return std::move(Threads());
+	}
+};
+struct ReclaimArg
+{
+	std::shared_ptr<ReclaimTracked> tracked;
+};
+static void ReclaimTarget(const ReclaimArg&) {}
+static void ReclaimSleep() { this_thread::sleep_for(milliseconds(20)); }
+static std::thread::id ReclaimThreadId() { return std::this_thread::get_id(); }
+
+// Test invoked messages are freed per call, in bulk once idle, or on the
+// reclaimer thread, as the reclaim policy selects
+TEST(Port_IT, ReclaimPolicy)
+{
+	static const int CALLS = 10;
+
+	WorkerThread thread("ReclaimPolicy");
+	ASSERT_TRUE(thread.CreateThread());
+	std::thread::id workerId = MakeDelegate(&ReclaimThreadId, thread, WAIT_INFINITE).AsyncInvoke().value();
+	auto target = MakeDelegate(&ReclaimTarget, thread);
+	auto sleep = MakeDelegate(&ReclaimSleep, thread);
+	auto dispatch = [&target, &sleep]() {
+		// Queued behind a sleep, so the sender has released its copies and
+		// the thread holds the last reference to each message
+		sleep.AsyncInvoke();
+		for (int i = 0; i < CALLS; i++)
+			target.AsyncInvoke(ReclaimArg{ std::make_shared<ReclaimTracked>() });
+	};
+
+	// INLINE frees each message on the thread without deferring
+	dispatch();
+	auto threads = ReclaimTracked::Take(CALLS);
+	ASSERT_EQ(threads.size(), (size_t)CALLS);
+	for (auto id : threads)
+		EXPECT_EQ(id, workerId);
+	EXPECT_EQ(thread.GetStats().reclaimDeferred, 0u);
+
+	// IDLE holds the messages, the sleep's too, and frees them on the thread
+	// once idle
+	thread.SetReclaimPolicy(WorkerThread::ReclaimPolicy::IDLE, 1000);
+	EXPECT_EQ(thread.GetReclaimPolicy(), WorkerThread::ReclaimPolicy::IDLE);
+	dispatch();
+	threads = ReclaimTracked::Take(CALLS);
+	ASSERT_EQ(threads.size(), (size_t)CALLS);
+	for (auto id : threads)
+		EXPECT_EQ(id, workerId);
+	EXPECT_EQ(thread.GetStats().reclaimDeferred, (uint64_t)CALLS + 1);
+
+	// BACKGROUND hands full batches to the reclaimer thread
+	thread.SetReclaimPolicy(WorkerThread::ReclaimPolicy::BACKGROUND, 4);
+	dispatch();
+	threads = ReclaimTracked::Take(CALLS);
+	ASSERT_EQ(threads.size(), (size_t)CALLS);
+	for (auto id : threads)
+	{
+		EXPECT_NE(id, workerId);
+		EXPECT_NE(id, std::this_thread::get_id());
+	}
+	EXPECT_EQ(thread.GetStats().reclaimDeferred, (uint64_t)(CALLS + 1) * 2);
+
+	// A blocking call's message is still held by the caller, so it is not deferred
+	MakeDelegate(&ReclaimThreadId, thread, WAIT_INFINITE).AsyncInvoke();
+	EXPECT_EQ(thread.GetStats().reclaimDeferred, (uint64_t)(CALLS + 1) * 2);
+	thread.ExitThread();
+}
+
+static std::mutex poolMutex;
+static std::vector<std::thread::id> poolThreads;
+static std::vector<int> poolOrder;
+static std::atomic<int> poolCalls{ 0 };
+
+static void PoolReset()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+	poolThreads.clear();
+	poolOrder.clear();
+	poolCalls = 0;
+}
+
+static void PoolRecord(int seq, int sleepMs)
+{
+	if (sleepMs > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds(sleepMs));
+	{
+		std::lock_guard<std::mutex> lock(poolMutex);
+		poolThreads.push_back(std::this_thread::get_id());
+		poolOrder.push_back(seq);
+	}
+	poolCalls++;
+}
+
+static bool PoolWaitCalls(int calls)
+{
+	for (int i = 0; i < 500 && poolCalls < calls; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	return poolCalls == calls;
+}
+
+static std::thread::id poolSpawner;
+static WorkerThreadPool* poolSpawnPool;
+
+static void PoolSpawn(int calls)
+{
+	poolSpawner = std::this_thread::get_id();
+
+	// Spawned on a worker, so queued on this worker's deque. This worker stays
+	// busy, so the idle worker must steal them.
+	for (int i = 0; i < calls; i++)
+		MakeDelegate(&PoolRecord, *poolSpawnPool).AsyncInvoke(i, 2);
+	std::this_thread::sleep_for(std::chrono::milliseconds(200));
+}
+
+// Test an idle pool worker steals the messages queued on a busy worker
+TEST(Port_IT, WorkerThreadPoolSteal)
+{
+	static const int CALLS = 20;
+
+	PoolReset();
+	WorkerThreadPool pool("PoolSteal", 2);
+	ASSERT_TRUE(pool.CreateThread());
+	EXPECT_EQ(pool.GetThreadCount(), 2u);
+	poolSpawnPool = &pool;
+	MakeDelegate(&PoolSpawn, pool).AsyncInvoke(CALLS);
+	ASSERT_TRUE(PoolWaitCalls(CALLS));
+
+	// All ran on the other worker while the spawner slept
+	std::lock_guard<std::mutex> lock(poolMutex);
+	for (auto id : poolThreads)
+		EXPECT_NE(id, poolSpawner);
+	pool.ExitThread();
+}
+
+// Test the messages dispatched through a key's ordered thread run in dispatch
+// order on one worker
+TEST(Port_IT, WorkerThreadPoolOrdered)
+{
+	static const int CALLS = 1000;
+
+	PoolReset();
+	WorkerThreadPool pool("PoolOrdered", 4);
+	ASSERT_TRUE(pool.CreateThread());
+	int key = 0;
+	DelegateThread& ordered = pool.GetOrderedThread(&key);
+	EXPECT_EQ(&pool.GetOrderedThread(&key), &ordered);
+
+	// Unordered messages keep the other workers busy meanwhile
+	for (int i = 0; i < CALLS; i++)
+	{
+		MakeDelegate(&PoolRecord, ordered).AsyncInvoke(i, 0);
+		MakeDelegate(&PoolRecord, pool).AsyncInvoke(-1, 0);
+	}
+	ASSERT_TRUE(PoolWaitCalls(CALLS * 2));
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+	int next = 0;
+	std::thread::id orderedId;
+	for (size_t i = 0; i < poolOrder.size(); i++)
+	{
+		if (poolOrder[i] < 0)
+			continue;
+		if (next == 0)
+			orderedId = poolThreads[i];
+		EXPECT_EQ(poolOrder[i], next++);
+		EXPECT_EQ(poolThreads[i], orderedId);
+	}
+	EXPECT_EQ(next, CALLS);
+	pool.ExitThread();
+}
+
+// Test an elastic pool adds workers while messages wait past the wait target
+// and retires them once idle for the idle timeout
+TEST(Port_IT, WorkerThreadPoolScaling)
+{
+	static const int CALLS = 40;
+
+	PoolReset();
+	MetricCounter& added = Metrics::GetCounter("workerthreadpool.added");
+	MetricCounter& retired = Metrics::GetCounter("workerthreadpool.retired");
+	uint64_t addedBefore = added.GetValue();
+	uint64_t retiredBefore = retired.GetValue();
+
+	WorkerThreadPool pool("PoolScaling", 1, 4, std::chrono::microseconds(1000), std::chrono::milliseconds(50));
+	ASSERT_TRUE(pool.CreateThread());
+	EXPECT_EQ(pool.GetThreadCount(), 1u);
+
+	// Scale up under a backlog of slow messages
+	size_t peak = 1;
+	for (int i = 0; i < CALLS; i++)
+	{
+		MakeDelegate(&PoolRecord, pool).AsyncInvoke(i, 5);
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		peak = std::max(peak, pool.GetThreadCount());
+	}
+	ASSERT_TRUE(PoolWaitCalls(CALLS));
+	peak = std::max(peak, pool.GetThreadCount());
+	EXPECT_GT(peak, 1u);
+	EXPECT_LE(peak, 4u);
+	EXPECT_GT(added.GetValue(), addedBefore);
+
+	// Scale down to the minimum once idle
+	for (int i = 0; i < 200 && pool.GetThreadCount() > 1; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_EQ(pool.GetThreadCount(), 1u);
+	EXPECT_EQ(retired.GetValue() - retiredBefore, added.GetValue() - addedBefore);
+
+	// The remaining worker still runs messages
+	MakeDelegate(&PoolRecord, pool).AsyncInvoke(CALLS, 0);
+	EXPECT_TRUE(PoolWaitCalls(CALLS + 1));
+	pool.ExitThread();
+}
+
+#ifndef WIN32
+// Test the shared memory ring carries records between two mappings, drops
+// records that do not fit, and skips malformed or abandoned records
+TEST(Port_IT, ShmRing)
+{
+	static const char* NAME = "/Port_IT_ShmRing";
+	static const size_t CAPACITY = 4096;
+
+	EXPECT_THROW(ShmRing::Create(NAME, 1000), std::invalid_argument);
+	auto consumer = ShmRing::Create(NAME, CAPACITY);
+	ASSERT_TRUE(consumer);
+	auto producer = ShmRing::Open(NAME);
+	ASSERT_TRUE(producer);
+	EXPECT_FALSE(ShmRing::Open("/Port_IT_ShmRingMissing"));
+	EXPECT_FALSE(consumer->IsReady());
+
+	std::vector<std::pair<uint32_t, std::string>> records;
+	auto handler = [&records](uint32_t id, const unsigned char* data, size_t size) {
+		records.push_back({ id, std::string((const char*)data, size) });
+	};
+	auto write = [](ShmRing& ring, uint32_t id, const std::string& value) {
+		return ring.Write(id, value.size(), [&value](unsigned char* data) {
+			memcpy(data, value.data(), value.size());
+		});
+	};
+
+	// Records wrap the ring many times in write order
+	for (int i = 0; i < 200; i++)
+	{
+		std::string value(1 + i % 300, (char)('a' + i % 26));
+		ASSERT_TRUE(write(*producer, (uint32_t)i, value));
+		EXPECT_TRUE(consumer->IsReady());
+		ASSERT_EQ(consumer->Read(handler), 1u);
+		EXPECT_EQ(records.back().first, (uint32_t)i);
+		EXPECT_EQ(records.back().second, value);
+	}
+	records.clear();
+
+	// A full ring drops and counts records rather than blocking
+	uint64_t dropped = producer->GetDropped();
+	std::string block(100, 'x');
+	int written = 0;
+	while (write(*producer, 1, block))
+		written++;
+	EXPECT_EQ(producer->GetDropped(), dropped + 1);
+	EXPECT_FALSE(write(*producer, 2, std::string(producer->GetMaxRecordSize() + 1, 'y')));
+	EXPECT_EQ(consumer->GetDropped(), dropped + 2);
+	EXPECT_EQ(consumer->Read(handler), (size_t)written);
+	records.clear();
+
+	// A record is written without the producer lock, so another producer can write
+	// meanwhile. The consumer stops at the record until it is published.
+	ASSERT_TRUE(producer->Write(10, 5, [&](unsigned char* data) {
+		EXPECT_TRUE(write(*consumer, 11, "second"));
+		EXPECT_FALSE(consumer->IsReady());
+		EXPECT_EQ(consumer->Read(handler), 0u);
+		memcpy(data, "first", 5);
+	}));
+	EXPECT_EQ(consumer->Read(handler), 2u);
+	ASSERT_EQ(records.size(), 2u);
+	EXPECT_EQ(records[0].second, "first");
+	EXPECT_EQ(records[1].second, "second");
+	records.clear();
+
+#ifndef DELEGATE_NO_EXCEPTIONS
+	// A record whose fill throws is skipped
+	EXPECT_THROW(producer->Write(12, 8, [](unsigned char*) { throw std::runtime_error("fill"); }),
+		std::runtime_error);
+	EXPECT_TRUE(write(*producer, 13, "after"));
+	EXPECT_EQ(consumer->Read(handler), 1u);
+	EXPECT_EQ(records.back().first, 13u);
+	records.clear();
+#endif
+
+	// A record overrunning the written records is discarded with the records
+	// behind it. The ring data follows a 256 byte region header.
+	ASSERT_TRUE(write(*producer, 14, "corrupt"));
+	ASSERT_TRUE(write(*producer, 15, "lost"));
+	int fd = shm_open(NAME, O_RDWR, 0);
+	ASSERT_GE(fd, 0);
+	size_t regionSize = 256 + CAPACITY;
+	void* region = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	ASSERT_NE(region, MAP_FAILED);
+	unsigned char* data = (unsigned char*)region + 256;
+	bool corrupted = false;
+	for (size_t offset = 0; offset < CAPACITY; offset += 8)
+	{
+		if (memcmp(data + offset + 8, "corrupt", 7) == 0)
+		{
+			uint32_t size = 1000;
+			memcpy(data + offset, &size, sizeof(size));
+			corrupted = true;
+			break;
+		}
+	}
+	munmap(region, regionSize);
+	ASSERT_TRUE(corrupted);
+	dropped = consumer->GetDropped();
+	EXPECT_EQ(consumer->Read(handler), 0u);
+	EXPECT_EQ(consumer->GetDropped(), dropped + 1);
+	EXPECT_FALSE(consumer->IsReady());
+
+	// The ring recovers
+	EXPECT_TRUE(write(*producer, 16, "recovered"));
+	EXPECT_EQ(consumer->Read(handler), 1u);
+	EXPECT_EQ(records.back().second, "recovered");
+
+	// Reserved ids are dropped
+	EXPECT_FALSE(write(*producer, 0xFFFFFFFF, "pad"));
+}
+
+static std::mutex shmMutex;
+static std::vector<std::string> shmCalls;
+
+static void ShmTarget(int value, const std::string& text)
+{
+	std::lock_guard<std::mutex> lock(shmMutex);
+	shmCalls.push_back(std::to_string(value) + text);
+}
+
+static size_t ShmCallCount()
+{
+	std::lock_guard<std::mutex> lock(shmMutex);
+	return shmCalls.size();
+}
+
+// Test remote delegates dispatched to a ShmDelegateThread are invoked by a
+// ShmDelegateReceiver, on its thread or by Poll()
+TEST(Port_IT, ShmDelegate)
+{
+	static const char* NAME = "/Port_IT_ShmDelegate";
+	static const uint32_t TARGET_ID = 1;
+	static const uint32_t UNKNOWN_ID = 2;
+	static const int CALLS = 100;
+
+	shmCalls.clear();
+	auto ring = ShmRing::Create(NAME, 1 << 16);
+	ASSERT_TRUE(ring);
+	auto senderRing = ShmRing::Open(NAME);
+	ASSERT_TRUE(senderRing);
+	ShmDelegateThread sender(*senderRing);
+	DelegateRemote<void(int, const std::string&)> remote(TARGET_ID, sender);
+	DelegateRemote<void(int, const std::string&)> unknown(UNKNOWN_ID, sender);
+
+	// Received by Poll() on the calling thread
+	{
+		ShmDelegateReceiver receiver(*ring);
+		receiver.Register(TARGET_ID, MakeDelegate(&ShmTarget));
+		remote(1, "polled");
+		unknown(2, "unknown");
+		EXPECT_EQ(receiver.Poll(), 2u);
+		EXPECT_EQ(receiver.GetRejected(), 1u);
+		ASSERT_EQ(ShmCallCount(), 1u);
+		EXPECT_EQ(shmCalls[0], "1polled");
+	}
+	shmCalls.clear();
+
+	// Received on the receiver thread from several sending threads
+	ShmDelegateReceiver receiver(*ring);
+	receiver.Register(TARGET_ID, MakeDelegate(&ShmTarget));
+	ASSERT_TRUE(receiver.CreateThread());
+	std::vector<std::thread> senders;
+	for (int t = 0; t < 4; t++)
+	{
+		senders.emplace_back([&remote, t]() {
+			for (int i = 0; i < CALLS; i++)
+				remote(t, "sent");
+		});
+	}
+	for (auto& thread : senders)
+		thread.join();
+	for (int i = 0; i < 500 && ShmCallCount() < CALLS * 4u; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_EQ(ShmCallCount(), CALLS * 4u);
+	EXPECT_EQ(ring->GetDropped(), 0u);
+
+	// Calls in the ring at exit are invoked
+	remote(9, "last");
+	receiver.ExitThread();
+	{
+		std::lock_guard<std::mutex> lock(shmMutex);
+		EXPECT_EQ(shmCalls.back(), "9last");
+	}
+
+#ifndef DELEGATE_NO_EXCEPTIONS
+	// Only remote messages can be sent
+	auto local = MakeDelegate(&ShmTarget, sender);
+	EXPECT_THROW(local(1, "local"), std::invalid_argument);
+#endif
+}
+#endif
+
+#ifndef WIN32
+static std::mutex socketMutex;
+static std::vector<std::string> socketCalls;
+
+static void SocketTarget(int value, const std::string& text)
+{
+	std::lock_guard<std::mutex> lock(socketMutex);
+	socketCalls.push_back(std::to_string(value) + text);
+}
+
+static bool SocketWaitCalls(size_t calls)
+{
+	for (int i = 0; i < 500; i++)
+	{
+		{
+			std::lock_guard<std::mutex> lock(socketMutex);
+			if (socketCalls.size() >= calls)
+				return socketCalls.size() == calls;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+	return false;
+}
+
+// Connect a plain socket to a loopback port
+static int SocketConnect(uint16_t port)
+{
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = htons(port);
+	if (s >= 0 && connect(s, (sockaddr*)&address, sizeof(address)) != 0)
+	{
+		close(s);
+		s = -1;
+	}
+	return s;
+}
+
+// Test remote delegates sent by SocketDelegateThreads over loopback are invoked
+// by a SocketDelegateReceiver, and frames carry a network order header
+TEST(Port_IT, SocketDelegate)
+{
+	static const uint32_t TARGET_ID = 1;
+	static const uint32_t UNKNOWN_ID = 2;
+	static const int CALLS = 100;
+
+	socketCalls.clear();
+	SocketDelegateReceiver receiver;
+	receiver.Register(TARGET_ID, MakeDelegate(&SocketTarget));
+	ASSERT_TRUE(receiver.Listen(0));
+	ASSERT_NE(receiver.GetPort(), 0);
+
+	// Several senders, each from its own thread
+	{
+		SocketDelegateThread senders[2];
+		std::vector<std::thread> threads;
+		for (auto& sender : senders)
+		{
+			ASSERT_TRUE(sender.Connect("127.0.0.1", receiver.GetPort()));
+			EXPECT_TRUE(sender.IsConnected());
+			threads.emplace_back([&sender]() {
+				DelegateRemote<void(int, const std::string&)> remote(TARGET_ID, sender);
+				for (int i = 0; i < CALLS; i++)
+					remote(i, "sent");
+			});
+		}
+		for (auto& thread : threads)
+			thread.join();
+
+		DelegateRemote<void(int, const std::string&)> unknown(UNKNOWN_ID, senders[0]);
+		unknown(0, "unknown");
+		for (auto& sender : senders)
+			sender.Close();
+	}
+	EXPECT_TRUE(SocketWaitCalls(CALLS * 2));
+	for (int i = 0; i < 500 && receiver.GetRejected() == 0; i++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_EQ(receiver.GetRejected(), 1u);
+
+	// A frame written by hand in network order is received
+	int s = SocketConnect(receiver.GetPort());
+	ASSERT_GE(s, 0);
+	int value = 7;
+	std::string text = "raw";
+	uint32_t length = (uint32_t)text.size();
+	std::vector<unsigned char> frame(8 + sizeof(value) + sizeof(length) + text.size());
+	uint32_t header[2] = { htonl((uint32_t)(frame.size() - 8)), htonl(TARGET_ID) };
+	memcpy(frame.data(), header, sizeof(header));
+	memcpy(frame.data() + 8, &value, sizeof(value));
+	memcpy(frame.data() + 8 + sizeof(value), &length, sizeof(length));
+	memcpy(frame.data() + 8 + sizeof(value) + sizeof(length), text.data(), text.size());
+	ASSERT_EQ(send(s, frame.data(), frame.size(), 0), (ssize_t)frame.size());
+	EXPECT_TRUE(SocketWaitCalls(CALLS * 2 + 1));
+	{
+		std::lock_guard<std::mutex> lock(socketMutex);
+		EXPECT_EQ(socketCalls.back(), "7raw");
+	}
+
+	// An oversized frame closes the connection
+	uint32_t oversized[2] = { htonl(0x7FFFFFFF), htonl(TARGET_ID) };
+	ASSERT_EQ(send(s, oversized, sizeof(oversized), 0), (ssize_t)sizeof(oversized));
+	char byte;
+	EXPECT_EQ(recv(s, &byte, 1, 0), 0);
+	close(s);
+	receiver.ExitThread();
+
+	// A sender's frame header is in network order
+	int listener = socket(AF_INET, SOCK_STREAM, 0);
+	ASSERT_GE(listener, 0);
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t addressLength = sizeof(address);
+	ASSERT_EQ(bind(listener, (sockaddr*)&address, sizeof(address)), 0);
+	ASSERT_EQ(listen(listener, 1), 0);
+	ASSERT_EQ(getsockname(listener, (sockaddr*)&address, &addressLength), 0);
+	SocketDelegateThread sender;
+	ASSERT_TRUE(sender.Connect("127.0.0.1", ntohs(address.sin_port)));
+	int accepted = accept(listener, nullptr, nullptr);
+	ASSERT_GE(accepted, 0);
+	DelegateRemote<void(int, const std::string&)> remote(TARGET_ID, sender);
+	remote(1, "x");
+	ASSERT_EQ(recv(accepted, header, sizeof(header), MSG_WAITALL), (ssize_t)sizeof(header));
+	EXPECT_EQ(ntohl(header[0]), sizeof(int) + sizeof(uint32_t) + 1);
+	EXPECT_EQ(ntohl(header[1]), TARGET_ID);
+
+	// Calls after the connection is closed are dropped
+	sender.Close();
+	EXPECT_FALSE(sender.IsConnected());
+	remote(2, "dropped");
+	EXPECT_EQ(sender.GetDropped(), 1u);
+
+#ifndef DELEGATE_NO_EXCEPTIONS
+	// Only remote messages can be sent
+	auto local = MakeDelegate(&SocketTarget, sender);
+	EXPECT_THROW(local(1, "local"), std::invalid_argument);
+#endif
+	close(accepted);
+	close(listener);
+}
+#endif
+
+// Dummy function to force linker to keep the code in this file
+void Port_IT_ForceLink() { }
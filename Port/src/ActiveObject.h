@@ -0,0 +1,211 @@
+#ifndef _ACTIVE_OBJECT_H
+#define _ACTIVE_OBJECT_H
+
+/// @file
+/// @brief The thread, message queue and idle wait shared by the thread loops.
+///
+/// @details An active object runs its own thread taking messages from a queue
+/// filled by other threads. ActiveObject holds the machinery WorkerThread and
+/// Logger share: the thread, the queue and its lock, the wake word the thread
+/// blocks on, the idle wait strategy and the Heartbeat listing the loop in
+/// the ThreadRegistry. The queue type is a template parameter, e.g. one deque or
+/// one queue per priority lane, and the wait strategy is set at runtime through
+/// the SpinWait. The message handling and the loop body remain the derived
+/// class's, so a change to the idle wait or the wakeup lands in every loop.
+
+#include "AtomicWait.h"
+#include "CacheLine.h"
+#include "LockProfile.h"
+#include "SpinWait.h"
+#include "ThreadAttributes.h"
+#include "ThreadRegistry.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+template <typename Msg, typename Queue = std::deque<Msg>>
+class ActiveObject
+{
+public:
+	typedef Msg MsgType;
+	typedef Queue QueueType;
+
+protected:
+	/// Constructor
+	/// @param[in] name - the thread name listed by the ThreadRegistry
+	/// @param[in] queueDepth - returns the number of queued messages without
+	///		taking m_mutex
+	ActiveObject(const std::string& name, Heartbeat::QueueDepth queueDepth) :
+		m_mutex(DelegateLib::LockSite(name + ".m_mutex")), m_heartbeat(name, std::move(queueDepth))
+	{
+	}
+
+	/// Destructor. The derived class joins the thread before its own members
+	/// are destroyed.
+	~ActiveObject() = default;
+
+	/// Start the thread. The loop is listed by the ThreadRegistry while the
+	/// entry point runs.
+	/// @param[in] attributes - the thread attributes
+	/// @param[in] entry - the loop entry point
+	void StartLoop(const ThreadAttributes& attributes, std::function<void()> entry)
+	{
+		m_thread = StartThread(attributes, [this, entry]() {
+			Heartbeat::ThreadScope heartbeatScope(m_heartbeat);
+			entry();
+		});
+	}
+
+	/// Wait for the thread to exit
+	void JoinLoop()
+	{
+		if (m_thread)
+		{
+			m_thread->join();
+			m_thread = nullptr;
+		}
+	}
+
+	/// Wait until work is ready or the deadline passes. Called by the thread
+	/// with m_mutex locked. Unless the wait strategy blocks at once, the lock is
+	/// released to poll first. The thread then sleeps on m_wake with m_waiting set
+	/// and m_mutex released, i.e. on a futex on Linux, see DelegateLib::AtomicWait().
+	/// @param[in] lk - the m_mutex lock
+	/// @param[in] deadline - the time to wait until, or time_point::max()
+	/// @param[in] ready - checks for work with m_mutex locked
+	/// @param[in] poll - checks for work without m_mutex while polling
+	template <typename Ready, typename Poll>
+	void WaitReady(std::unique_lock<DelegateLib::SiteMutex>& lk, std::chrono::steady_clock::time_point deadline,
+		Ready ready, Poll poll)
+	{
+		if (ready())
+			return;
+
+		if (m_spinWait.GetStrategy().policy != WaitPolicy::BLOCK)
+		{
+			lk.unlock();
+			bool spun = m_spinWait.Spin(poll, deadline);
+			lk.lock();
+			if (spun)
+				return;
+		}
+
+		bool slept = false;
+		while (1)
+		{
+			// Set again before each sleep, as the producer waking the thread
+			// clears it. Pairs with the fence in NotifyWaiting() so either the
+			// thread sees the new work before blocking or the producer sees
+			// m_waiting and notifies.
+			m_waiting.store(true, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			// Read before checking for work, so work published after the check
+			// changes the word and the sleep returns at once
+			uint32_t wake = m_wake.load(std::memory_order_acquire);
+			if (ready())
+				break;
+
+			std::chrono::nanoseconds remaining;
+			if (deadline != std::chrono::steady_clock::time_point::max())
+			{
+				auto now = std::chrono::steady_clock::now();
+				if (now >= deadline)
+					break;
+				remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+			}
+
+			lk.unlock();
+			DelegateLib::AtomicWait(m_wake, wake, deadline == std::chrono::steady_clock::time_point::max() ?
+				nullptr : &remaining);
+			lk.lock();
+			slept = true;
+		}
+		if (slept)
+			m_spinWait.Woken();
+		m_waiting.store(false, std::memory_order_relaxed);
+	}
+
+	/// Wake the thread if blocked in WaitReady(). Called with m_mutex locked
+	/// after queueing work. The thread reads the wake word and checks for work
+	/// with m_mutex locked, so the word need only change when it sleeps.
+	void WakeLoop()
+	{
+		if (m_waiting.load(std::memory_order_relaxed))
+			Wake();
+		else
+			m_wakeupsAvoided.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// Wake the thread if blocked in WaitReady(). Called after publishing work
+	/// without m_mutex, e.g. to a lock-free queue.
+	void NotifyWaiting()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_waiting.load(std::memory_order_relaxed))
+			Wake();
+		else
+			m_wakeupsAvoided.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	/// Get the wakeups made, i.e. AtomicWake() calls on a sleeping thread
+	uint64_t GetWakeups() const { return m_wakeups.load(std::memory_order_relaxed); }
+
+	/// Get the notifications that found the thread awake, or already being
+	/// woken, and so made no wakeup
+	uint64_t GetWakeupsAvoided() const { return m_wakeupsAvoided.load(std::memory_order_relaxed); }
+
+	std::unique_ptr<std::thread> m_thread;
+
+	/// Queued messages. Protected by m_mutex. Written by every producer, so kept
+	/// off the cache lines of the fields below.
+	alignas(CACHE_LINE_SIZE) Queue m_queue;
+	DelegateLib::SiteMutex m_mutex;
+
+	/// True while the thread is blocked in WaitReady(). Read by every producer
+	/// in NotifyWaiting() and rarely written, so its line stays shared.
+	alignas(CACHE_LINE_SIZE) std::atomic<bool> m_waiting{ false };
+
+	/// Changed by each wake. The thread sleeps until it changes.
+	std::atomic<uint32_t> m_wake{ 0 };
+
+	/// Counted by the producers. Off the m_waiting line, so the count does not
+	/// invalidate the line every producer reads.
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_wakeups{ 0 };
+	std::atomic<uint64_t> m_wakeupsAvoided{ 0 };
+
+	/// Idle wait polling phase. Only written by the thread.
+	alignas(CACHE_LINE_SIZE) SpinWait m_spinWait;
+
+	/// Loop progress listed by the ThreadRegistry and watched by the StallWatchdog.
+	/// The queue depth is only read while the thread runs, so the derived class
+	/// members it reads may be destroyed first once JoinLoop() returns.
+	Heartbeat m_heartbeat;
+
+private:
+	ActiveObject(const ActiveObject&) = delete;
+	ActiveObject& operator=(const ActiveObject&) = delete;
+
+	/// Wake the thread seen sleeping. Only the producer clearing m_waiting
+	/// changes the wake word and calls AtomicWake(), so the producers reaching
+	/// a sleeping thread together make one wakeup.
+	void Wake()
+	{
+		if (!m_waiting.exchange(false, std::memory_order_relaxed))
+		{
+			m_wakeupsAvoided.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		m_wake.fetch_add(1, std::memory_order_release);
+		m_wakeups.fetch_add(1, std::memory_order_relaxed);
+		DelegateLib::AtomicWake(m_wake, false);
+	}
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include "AsyncFile.h"
+#include "WorkerThreadStd.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
+#ifdef WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace DelegateLib;
+
+//----------------------------------------------------------------------------
+// SeekTo
+//----------------------------------------------------------------------------
+static int64_t SeekTo(int fd, uint64_t offset)
+{
+#ifdef WIN32
+	return offset == AsyncFile::APPEND ? _lseeki64(fd, 0, SEEK_END) : _lseeki64(fd, (int64_t)offset, SEEK_SET);
+#else
+	return offset == AsyncFile::APPEND ? (int64_t)lseek(fd, 0, SEEK_END) : (int64_t)offset;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// AsyncFile
+//----------------------------------------------------------------------------
+AsyncFile::AsyncFile() : m_ioThread(GetDefaultIoThread())
+{
+}
+
+AsyncFile::AsyncFile(DelegateLib::DelegateThread& ioThread) : m_ioThread(ioThread)
+{
+}
+
+//----------------------------------------------------------------------------
+// ~AsyncFile
+//----------------------------------------------------------------------------
+AsyncFile::~AsyncFile()
+{
+	// Queued behind the pending operations, so they complete first
+	MakeDelegate(this, &AsyncFile::DoClose, m_ioThread, WAIT_INFINITE).AsyncInvoke(nullptr);
+}
+
+//----------------------------------------------------------------------------
+// GetDefaultIoThread
+//----------------------------------------------------------------------------
+DelegateLib::DelegateThread& AsyncFile::GetDefaultIoThread()
+{
+	// Never destroyed, as files may be closed during exit
+	static WorkerThread* ioThread = [] {
+		WorkerThread* thread = new WorkerThread("AsyncFileIo");
+		thread->CreateThread();
+		return thread;
+	}();
+	return *ioThread;
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+void AsyncFile::Open(const std::string& fileName, bool truncate, const CompletionDelegate& done)
+{
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	MakeDelegate(this, &AsyncFile::DoOpen, m_ioThread).AsyncInvoke(fileName, truncate, Copy(done));
+}
+
+//----------------------------------------------------------------------------
+// Read
+//----------------------------------------------------------------------------
+void AsyncFile::Read(uint64_t offset, size_t size, const CompletionDelegate& done)
+{
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	MakeDelegate(this, &AsyncFile::DoRead, m_ioThread).AsyncInvoke(offset, size, Copy(done));
+}
+
+//----------------------------------------------------------------------------
+// Write
+//----------------------------------------------------------------------------
+void AsyncFile::Write(std::string data, uint64_t offset, const CompletionDelegate& done)
+{
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	auto shared = make_shared<std::string>(std::move(data));
+	MakeDelegate(this, &AsyncFile::DoWrite, m_ioThread).AsyncInvoke(shared, offset, Copy(done));
+}
+
+//----------------------------------------------------------------------------
+// Sync
+//----------------------------------------------------------------------------
+void AsyncFile::Sync(const CompletionDelegate& done)
+{
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	MakeDelegate(this, &AsyncFile::DoSync, m_ioThread).AsyncInvoke(Copy(done));
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void AsyncFile::Close(const CompletionDelegate& done)
+{
+	m_pending.fetch_add(1, std::memory_order_relaxed);
+	MakeDelegate(this, &AsyncFile::DoClose, m_ioThread).AsyncInvoke(Copy(done));
+}
+
+//----------------------------------------------------------------------------
+// Complete
+//----------------------------------------------------------------------------
+void AsyncFile::Complete(const Completion& done, const Result& result)
+{
+	static MetricCounter& errorsMetric = Metrics::GetCounter("asyncfile.errors");
+	if (!result.Ok())
+		errorsMetric.Add();
+	m_pending.fetch_sub(1, std::memory_order_relaxed);
+	if (done)
+		(*done)(result);
+}
+
+//----------------------------------------------------------------------------
+// CloseFile
+//----------------------------------------------------------------------------
+int AsyncFile::CloseFile()
+{
+	if (m_fd < 0)
+		return 0;
+#ifdef WIN32
+	int rc = _close(m_fd);
+#else
+	int rc = close(m_fd);
+#endif
+	m_fd = -1;
+	return rc == 0 ? 0 : errno;
+}
+
+//----------------------------------------------------------------------------
+// DoOpen
+//----------------------------------------------------------------------------
+void AsyncFile::DoOpen(std::string fileName, bool truncate, Completion done)
+{
+	Result result;
+	result.op = Op::OPEN;
+	CloseFile();
+#ifdef WIN32
+	m_fd = _open(fileName.c_str(), _O_RDWR | _O_CREAT | _O_BINARY | (truncate ? _O_TRUNC : 0),
+		_S_IREAD | _S_IWRITE);
+#else
+	m_fd = open(fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+#endif
+	if (m_fd < 0)
+		result.error = errno;
+	Complete(done, result);
+}
+
+//----------------------------------------------------------------------------
+// DoRead
+//----------------------------------------------------------------------------
+void AsyncFile::DoRead(uint64_t offset, size_t size, Completion done)
+{
+	Result result;
+	result.op = Op::READ;
+	result.offset = offset;
+	if (m_fd < 0)
+		result.error = EBADF;
+	else if (SeekTo(m_fd, offset) < 0)
+		result.error = errno;
+	else
+	{
+		result.data.resize(size);
+		while (result.bytes < size)
+		{
+			char* dest = &result.data[result.bytes];
+			size_t remaining = size - result.bytes;
+#ifdef WIN32
+			int n = _read(m_fd, dest, (unsigned)std::min<size_t>(remaining, INT_MAX));
+#else
+			ssize_t n = pread(m_fd, dest, remaining, (off_t)(offset + result.bytes));
+#endif
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0)
+				result.error = errno;
+			if (n <= 0)
+				break;
+			result.bytes += (size_t)n;
+		}
+		result.data.resize(result.bytes);
+	}
+	Complete(done, result);
+}
+
+//----------------------------------------------------------------------------
+// DoWrite
+//----------------------------------------------------------------------------
+void AsyncFile::DoWrite(std::shared_ptr<std::string> data, uint64_t offset, Completion done)
+{
+	Result result;
+	result.op = Op::WRITE;
+	result.offset = offset;
+	int64_t position = m_fd < 0 ? -1 : SeekTo(m_fd, offset);
+	if (m_fd < 0)
+		result.error = EBADF;
+	else if (position < 0)
+		result.error = errno;
+	else
+	{
+		result.offset = (uint64_t)position;
+		while (result.bytes < data->size())
+		{
+			const char* src = data->data() + result.bytes;
+			size_t remaining = data->size() - result.bytes;
+#ifdef WIN32
+			int n = _write(m_fd, src, (unsigned)std::min<size_t>(remaining, INT_MAX));
+#else
+			ssize_t n = pwrite(m_fd, src, remaining, (off_t)(position + result.bytes));
+#endif
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0)
+			{
+				result.error = errno;
+				break;
+			}
+			result.bytes += (size_t)n;
+		}
+	}
+	Complete(done, result);
+}
+
+//----------------------------------------------------------------------------
+// DoSync
+//----------------------------------------------------------------------------
+void AsyncFile::DoSync(Completion done)
+{
+	Result result;
+	result.op = Op::SYNC;
+	if (m_fd < 0)
+		result.error = EBADF;
+#ifdef WIN32
+	else if (_commit(m_fd) != 0)
+#else
+	else if (fsync(m_fd) != 0)
+#endif
+		result.error = errno;
+	Complete(done, result);
+}
+
+//----------------------------------------------------------------------------
+// DoClose
+//----------------------------------------------------------------------------
+void AsyncFile::DoClose(Completion done)
+{
+	Result result;
+	result.op = Op::CLOSE;
+	result.error = CloseFile();
+
+	// The destructor's close is not counted as pending
+	if (done)
+		Complete(done, result);
+}
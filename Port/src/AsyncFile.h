@@ -0,0 +1,141 @@
+#ifndef _ASYNC_FILE_H
+#define _ASYNC_FILE_H
+
+/// @file
+/// @brief File I/O run on an I/O thread, with completions delivered by delegate.
+///
+/// @details An AsyncFile queues each open, read, write, sync and close onto an
+/// I/O DelegateThread and returns at once. The I/O thread performs the blocking
+/// system call and invokes the completion delegate with the result. Pass an async
+/// delegate bound to the caller's thread, e.g. `MakeDelegate(&OnRead, thread)`,
+/// and the completion runs on the caller's thread, so an event loop thread never
+/// waits on the disk. A synchronous delegate runs on the I/O thread instead.
+///
+/// The operations of one file run in call order. Files constructed without a
+/// thread share one I/O WorkerThread, created on first use. A file written
+/// heavily or with slow syncs may be given a thread of its own, so it does not
+/// delay the other files.
+///
+/// Code example:
+///
+/// `AsyncFile file;`
+/// `file.Open("data.bin", true, MakeDelegate(&OnOpen, thread));`
+/// `file.Write(std::move(bytes), AsyncFile::APPEND, MakeDelegate(&OnWrite, thread));`
+/// `file.Sync(MakeDelegate(&OnSync, thread));`
+
+#include "DelegateLib.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+class AsyncFile
+{
+public:
+	/// The operation a completion reports
+	enum class Op { OPEN, READ, WRITE, SYNC, CLOSE };
+
+	/// The outcome of an operation
+	struct Result
+	{
+		Op op = Op::OPEN;
+
+		/// The file offset read or written. A write at APPEND reports the offset
+		/// it wrote at.
+		uint64_t offset = 0;
+
+		/// The bytes read or written. A read stops short at the end of the file.
+		size_t bytes = 0;
+
+		/// The errno value of the failed system call, or 0 on success
+		int error = 0;
+
+		/// The bytes read by a READ
+		std::string data;
+
+		/// Check if the operation succeeded
+		bool Ok() const { return error == 0; }
+	};
+
+	/// Invoked with the result of each operation
+	typedef DelegateLib::Delegate<void(const Result&)> CompletionDelegate;
+
+	/// The offset writing at the end of the file
+	static const uint64_t APPEND = UINT64_MAX;
+
+	/// Constructor. Operations run on the shared I/O thread.
+	AsyncFile();
+
+	/// Constructor
+	/// @param[in] ioThread - the thread operations run on. Must outlive the file.
+	explicit AsyncFile(DelegateLib::DelegateThread& ioThread);
+
+	/// Destructor. Waits for the queued operations, then closes the file. Not
+	/// called on the I/O thread.
+	~AsyncFile();
+
+	/// Open the file for reading and writing, creating it if missing. A file
+	/// already open is closed first.
+	/// @param[in] fileName - the file to open
+	/// @param[in] truncate - true to discard the file's contents
+	/// @param[in] done - invoked with the result
+	void Open(const std::string& fileName, bool truncate, const CompletionDelegate& done);
+
+	/// Read from the file
+	/// @param[in] offset - the offset to read from
+	/// @param[in] size - the maximum number of bytes read
+	/// @param[in] done - invoked with the result holding the bytes read
+	void Read(uint64_t offset, size_t size, const CompletionDelegate& done);
+
+	/// Write to the file
+	/// @param[in] data - the bytes to write. Moved to the I/O thread, not copied.
+	/// @param[in] offset - the offset to write at, or APPEND
+	/// @param[in] done - invoked with the result
+	void Write(std::string data, uint64_t offset, const CompletionDelegate& done);
+
+	/// Write the file's data and metadata through to the storage device
+	/// @param[in] done - invoked with the result
+	void Sync(const CompletionDelegate& done);
+
+	/// Close the file
+	/// @param[in] done - invoked with the result
+	void Close(const CompletionDelegate& done);
+
+	/// Get the number of operations queued or running
+	size_t GetPending() const { return m_pending.load(std::memory_order_relaxed); }
+
+	/// Get the shared I/O thread, creating it on first use
+	static DelegateLib::DelegateThread& GetDefaultIoThread();
+
+private:
+	AsyncFile(const AsyncFile&) = delete;
+	AsyncFile& operator=(const AsyncFile&) = delete;
+
+	typedef std::shared_ptr<CompletionDelegate> Completion;
+
+	/// The operations, run on the I/O thread
+	void DoOpen(std::string fileName, bool truncate, Completion done);
+	void DoRead(uint64_t offset, size_t size, Completion done);
+	void DoWrite(std::shared_ptr<std::string> data, uint64_t offset, Completion done);
+	void DoSync(Completion done);
+	void DoClose(Completion done);
+
+	/// Invoke a completion and count the operation done
+	void Complete(const Completion& done, const Result& result);
+
+	/// Close the descriptor. Called on the I/O thread.
+	/// @return 0 or the errno value.
+	int CloseFile();
+
+	/// Copy a completion delegate for the I/O thread
+	static Completion Copy(const CompletionDelegate& done) { return Completion(done.Clone()); }
+
+	DelegateLib::DelegateThread& m_ioThread;
+
+	/// The file descriptor, or -1. Only used on the I/O thread.
+	int m_fd = -1;
+
+	std::atomic<size_t> m_pending{ 0 };
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef _CACHE_LINE_H
+#define _CACHE_LINE_H
+
+#include <cstddef>
+
+/// @brief The alignment keeping data written by different threads on separate
+/// cache lines, so a write by one thread does not invalidate the line another
+/// thread is reading (false sharing).
+///
+/// @details std::hardware_destructive_interference_size is not used since GCC
+/// warns that its value depends on the -mtune target, and a struct layout that
+/// changes with compiler flags breaks the ABI between libraries. Apple arm64
+/// cores fetch 128 byte lines, other supported targets 64 byte lines.
+#if defined(__APPLE__) && defined(__aarch64__)
+constexpr std::size_t CACHE_LINE_SIZE = 128;
+#else
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+#endif
+
+#endif
@@ -0,0 +1,438 @@
+#include "CoreGroup.h"
+#include "Fault.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Clock.h"
+#include "AtomicWait.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+using namespace DelegateLib;
+
+// Longest sleep of a core holding calls for a full ring, so it retries once
+// the target has drained it
+static const std::chrono::microseconds BACKLOG_RETRY(100);
+
+// The core running on the current thread, if any
+static thread_local CoreThread* currentCore = nullptr;
+
+//----------------------------------------------------------------------------
+// CoreThread
+//----------------------------------------------------------------------------
+CoreThread::CoreThread(CoreGroup& group, size_t index, unsigned cpu) :
+	m_group(group), m_index(index), m_cpu(cpu),
+	THREAD_NAME(group.GetName() + "." + std::to_string(index))
+{
+	m_timers.SetStartedHook(&CoreThread::WakeTimers, this);
+	Clock::AddAdvancedHook(&CoreThread::WakeTimers, this);
+}
+
+//----------------------------------------------------------------------------
+// ~CoreThread
+//----------------------------------------------------------------------------
+CoreThread::~CoreThread()
+{
+	Clock::RemoveAdvancedHook(&CoreThread::WakeTimers, this);
+	m_timers.SetStartedHook(nullptr, nullptr);
+}
+
+//----------------------------------------------------------------------------
+// GetScratchArena
+//----------------------------------------------------------------------------
+ScratchArena* CoreThread::GetScratchArena()
+{
+	return currentCore ? &currentCore->m_scratch : nullptr;
+}
+
+//----------------------------------------------------------------------------
+// GetQueueSize
+//----------------------------------------------------------------------------
+size_t CoreThread::GetQueueSize() const
+{
+	size_t size = m_externalSize.load(std::memory_order_relaxed);
+	for (const auto& ring : m_rings)
+		size += ring->Size();
+	return size;
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void CoreThread::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	DispatchDelegates(&msg, 1);
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegates
+//----------------------------------------------------------------------------
+void CoreThread::DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count)
+{
+	if (count == 0)
+		return;
+	if (!m_running.load(std::memory_order_acquire))
+	{
+#ifdef DELEGATE_NO_EXCEPTIONS
+		ReportDelegateError(DelegateError::THREAD_NOT_RUNNING);
+		return;
+#else
+		throw std::invalid_argument("Core group not started");
+#endif
+	}
+
+	CoreThread* source = currentCore;
+	if (!source || &source->m_group != &m_group)
+	{
+		lock_guard<mutex> lock(m_externalLock);
+		for (size_t i = 0; i < count; i++)
+			m_external.push_back(std::move(msgs[i]));
+		m_externalSize.store(m_external.size(), std::memory_order_relaxed);
+	}
+	else
+	{
+		// Calls already held for this core go first, keeping the call order
+		SpscRing<MsgPtr>& ring = *m_rings[source->m_index];
+		RingQueue<MsgPtr>& backlog = source->m_backlogs[m_index];
+		for (size_t i = 0; i < count; i++)
+		{
+			if (!backlog.empty() || !ring.TryPush(std::move(msgs[i])))
+			{
+				if (backlog.empty())
+					source->m_backlogCount++;
+				backlog.push(std::move(msgs[i]));
+				m_group.m_held.fetch_add(1, std::memory_order_relaxed);
+				m_backlogged.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+	}
+	Notify();
+}
+
+//----------------------------------------------------------------------------
+// FlushBacklogs
+//----------------------------------------------------------------------------
+bool CoreThread::FlushBacklogs()
+{
+	if (m_backlogCount == 0)
+		return true;
+
+	for (size_t target = 0; target < m_backlogs.size(); target++)
+	{
+		RingQueue<MsgPtr>& backlog = m_backlogs[target];
+		if (backlog.empty())
+			continue;
+		CoreThread& core = m_group.GetCore(target);
+		SpscRing<MsgPtr>& ring = *core.m_rings[m_index];
+		size_t moved = 0;
+		if (core.m_looping.load(std::memory_order_acquire))
+		{
+			while (!backlog.empty() && ring.TryPush(std::move(backlog.front())))
+			{
+				backlog.pop();
+				moved++;
+			}
+			if (moved)
+				core.Notify();
+		}
+		else
+		{
+			// The target stopped, so its calls would never be taken
+			while (!backlog.empty())
+			{
+				backlog.pop();
+				moved++;
+			}
+			core.m_dropped.fetch_add(moved, std::memory_order_relaxed);
+		}
+		m_group.m_held.fetch_sub(moved, std::memory_order_release);
+		if (backlog.empty())
+			m_backlogCount--;
+	}
+	return m_backlogCount == 0;
+}
+
+//----------------------------------------------------------------------------
+// Notify
+//----------------------------------------------------------------------------
+void CoreThread::Notify()
+{
+	// Pairs with the fence in Process() between setting m_sleeping and checking
+	// the rings, so either the caller sees the thread sleeping or the thread
+	// sees the message
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_sleeping.load(std::memory_order_relaxed))
+		Wake();
+}
+
+//----------------------------------------------------------------------------
+// Wake
+//----------------------------------------------------------------------------
+void CoreThread::Wake()
+{
+	m_wake.fetch_add(1, std::memory_order_release);
+	AtomicWake(m_wake);
+}
+
+//----------------------------------------------------------------------------
+// WakeTimers
+//----------------------------------------------------------------------------
+void CoreThread::WakeTimers(void* context)
+{
+	static_cast<CoreThread*>(context)->Wake();
+}
+
+//----------------------------------------------------------------------------
+// HasQueued
+//----------------------------------------------------------------------------
+bool CoreThread::HasQueued() const
+{
+	if (m_externalSize.load(std::memory_order_relaxed))
+		return true;
+	for (const auto& ring : m_rings)
+	{
+		if (!ring->Empty())
+			return true;
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+// DropQueued
+//----------------------------------------------------------------------------
+void CoreThread::DropQueued()
+{
+	uint64_t dropped = 0;
+	MsgPtr msg;
+	for (auto& ring : m_rings)
+	{
+		while (ring->TryPop(msg))
+			dropped++;
+	}
+	msg.reset();
+	{
+		lock_guard<mutex> lock(m_externalLock);
+		dropped += m_external.size();
+		m_external.clear();
+		m_externalSize.store(0, std::memory_order_relaxed);
+	}
+	for (auto& backlog : m_backlogs)
+	{
+		while (!backlog.empty())
+		{
+			backlog.pop();
+			m_group.m_held.fetch_sub(1, std::memory_order_relaxed);
+		}
+	}
+	m_backlogCount = 0;
+
+	if (dropped)
+	{
+		static MetricCounter& droppedMetric = Metrics::GetCounter("corethread.dropped");
+		droppedMetric.Add(dropped);
+		m_dropped.fetch_add(dropped, std::memory_order_relaxed);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Invoke
+//----------------------------------------------------------------------------
+void CoreThread::Invoke(MsgPtr& msg)
+{
+	// Discard a message cancelled or stale by the time the core takes it
+	if (msg->IsCancelled())
+		return;
+	auto deadline = msg->GetDeadline();
+	if (deadline != std::chrono::steady_clock::time_point::max() &&
+		std::chrono::steady_clock::now() > deadline)
+		return;
+
+	TRACE_SCOPE("CoreThread::Invoke");
+	static MetricCounter& invokedMetric = Metrics::GetCounter("corethread.invoked");
+	invokedMetric.Add();
+	auto invoker = msg->GetDelegateInvoker();
+	ASSERT_TRUE(invoker);
+	DelegateLib::TraceContextScope traceScope(msg->GetTraceContext());
+	bool success = invoker->Invoke(msg);
+	ASSERT_TRUE(success);
+	m_scratch.Reset();
+}
+
+//----------------------------------------------------------------------------
+// InvokeQueued
+//----------------------------------------------------------------------------
+bool CoreThread::InvokeQueued()
+{
+	bool taken = false;
+
+	// At most a ring's worth from each ring per pass, so a busy caller does
+	// not starve the others
+	MsgPtr msg;
+	for (auto& ring : m_rings)
+	{
+		for (size_t i = ring->Capacity(); i > 0 && ring->TryPop(msg); i--)
+		{
+			taken = true;
+			Invoke(msg);
+			msg.reset();
+		}
+	}
+
+	if (m_externalSize.load(std::memory_order_relaxed))
+	{
+		std::deque<MsgPtr> external;
+		{
+			lock_guard<mutex> lock(m_externalLock);
+			external.swap(m_external);
+			m_externalSize.store(0, std::memory_order_relaxed);
+		}
+		for (auto& queued : external)
+			Invoke(queued);
+		taken = true;
+	}
+	return taken;
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void CoreThread::Process(std::function<void(CoreThread&)> init)
+{
+	TRACE_THREAD_NAME(THREAD_NAME);
+	currentCore = this;
+	if (init)
+		init(*this);
+
+	while (1)
+	{
+		bool flushed = FlushBacklogs();
+		bool taken = InvokeQueued();
+		m_timers.ProcessTimers();
+		if (taken)
+			continue;
+
+		// Exit once no core holds a call, as a held call may be for this core.
+		// Until then retry as a core holding calls would.
+		bool exiting = m_exit.load(std::memory_order_acquire);
+		if (exiting && !HasQueued() && flushed && m_group.m_held.load(std::memory_order_acquire) == 0)
+			break;
+
+		// Sleep until a caller, a timer or a full ring's retry wakes the core
+		std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max();
+		std::chrono::microseconds next;
+		if (m_timers.GetNextExpiration(next) && !Clock::IsVirtual())
+			timeout = std::max(next - Timer::GetTime(), std::chrono::microseconds(1));
+		if (!flushed || exiting)
+			timeout = std::min(timeout, std::chrono::nanoseconds(BACKLOG_RETRY));
+
+		uint32_t word = m_wake.load(std::memory_order_acquire);
+		m_sleeping.store(1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!HasQueued())
+		{
+			static MetricCounter& sleepsMetric = Metrics::GetCounter("corethread.sleeps");
+			sleepsMetric.Add();
+			AtomicWait(m_wake, word, timeout == std::chrono::nanoseconds::max() ? nullptr : &timeout);
+		}
+		m_sleeping.store(0, std::memory_order_relaxed);
+	}
+
+	// Calls held from here on for this core are dropped by their callers
+	m_looping.store(false, std::memory_order_release);
+	currentCore = nullptr;
+}
+
+//----------------------------------------------------------------------------
+// CoreGroup
+//----------------------------------------------------------------------------
+CoreGroup::CoreGroup(const std::string& name, const std::vector<unsigned>& cpus, size_t ringCapacity) :
+	m_name(name)
+{
+	std::vector<unsigned> placement = cpus;
+	if (placement.empty())
+	{
+		unsigned count = std::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned cpu = 0; cpu < count; cpu++)
+			placement.push_back(cpu);
+	}
+
+	for (size_t i = 0; i < placement.size(); i++)
+		m_cores.emplace_back(new CoreThread(*this, i, placement[i]));
+
+	// One ring per ordered pair of cores, including a core calling itself
+	for (auto& core : m_cores)
+	{
+		for (size_t source = 0; source < m_cores.size(); source++)
+			core->m_rings.emplace_back(new SpscRing<CoreThread::MsgPtr>(ringCapacity));
+		core->m_backlogs.resize(m_cores.size());
+	}
+}
+
+//----------------------------------------------------------------------------
+// ~CoreGroup
+//----------------------------------------------------------------------------
+CoreGroup::~CoreGroup()
+{
+	Stop();
+}
+
+//----------------------------------------------------------------------------
+// Start
+//----------------------------------------------------------------------------
+void CoreGroup::Start(std::function<void(CoreThread&)> init)
+{
+	// Every core accepts calls before any starts, so an init function may call
+	// another core
+	for (auto& core : m_cores)
+	{
+		if (!core->m_thread)
+		{
+			core->m_looping.store(true, std::memory_order_relaxed);
+			core->m_running.store(true, std::memory_order_release);
+		}
+	}
+	for (auto& core : m_cores)
+	{
+		if (core->m_thread)
+			continue;
+		core->m_exit.store(false, std::memory_order_relaxed);
+		ThreadAttributes attributes;
+		attributes.cpus = { core->m_cpu };
+		core->m_thread = StartThread(attributes, &CoreThread::Process, core.get(), init);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Stop
+//----------------------------------------------------------------------------
+void CoreGroup::Stop()
+{
+	for (auto& core : m_cores)
+	{
+		core->m_exit.store(true, std::memory_order_release);
+		core->Wake();
+	}
+	for (auto& core : m_cores)
+	{
+		if (core->m_thread)
+		{
+			core->m_thread->join();
+			core->m_thread.reset();
+		}
+	}
+
+	// Calls which reached a core after it stopped are never invoked
+	for (auto& core : m_cores)
+	{
+		core->m_running.store(false, std::memory_order_release);
+		core->DropQueued();
+	}
+}
+
+//----------------------------------------------------------------------------
+// CurrentCore
+//----------------------------------------------------------------------------
+CoreThread* CoreGroup::CurrentCore()
+{
+	return currentCore;
+}
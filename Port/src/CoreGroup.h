@@ -0,0 +1,217 @@
+#ifndef _CORE_GROUP_H
+#define _CORE_GROUP_H
+
+/// @file
+/// @brief Thread-per-core deployment: one pinned delegate thread per core, with
+/// no lock shared between cores.
+///
+/// @details A CoreGroup starts a CoreThread on each of a set of CPUs. Each core
+/// owns its timers and its scratch arena, and an init function passed to Start()
+/// runs first on each core to set up the state it owns, e.g. a Logger shard. A
+/// CoreThread is a DelegateThread, so MakeDelegate() targets it as it targets a
+/// WorkerThread.
+///
+/// A delegate call from one core to another goes through the single producer,
+/// single consumer ring of that pair of cores, so cores never contend for a queue
+/// lock or a shared cache line. When the ring is full the calls are held in a
+/// backlog owned by the calling core and moved into the ring as the target drains
+/// it, so two cores calling each other never deadlock. Calls from threads outside
+/// the group share one locked queue per core, not taken by the cores' own calls.
+/// A core sleeps on a wake word only after finding every ring empty, and a caller
+/// wakes it only while it sleeps.
+///
+/// Calls are invoked in order per calling thread, but not across callers.
+
+#include "DelegateThread.h"
+#include "ThreadAttributes.h"
+#include "Timer.h"
+#include "ScratchArena.h"
+#include "SpscRing.h"
+#include "RingQueue.h"
+#include "CacheLine.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class CoreGroup;
+
+class CoreThread : public DelegateLib::DelegateThread
+{
+public:
+	/// Destructor
+	~CoreThread();
+
+	/// Get the index of the core within its group
+	size_t GetIndex() const { return m_index; }
+
+	/// Get the CPU the thread is pinned to
+	unsigned GetCpu() const { return m_cpu; }
+
+	/// Get thread name
+	std::string GetThreadName() const { return THREAD_NAME; }
+
+	/// Get the timers serviced by this core. Expired callbacks run on the core.
+	TimerSet& GetTimers() { return m_timers; }
+
+	/// Get the scratch arena of the core running the caller
+	/// @return The arena, reset after each delegate invoked, or nullptr if the
+	///		caller is not a core.
+	static ScratchArena* GetScratchArena();
+
+	/// Get the number of delegate messages queued to this core. A snapshot.
+	size_t GetQueueSize() const;
+
+	/// Get the number of calls held in backlogs because a ring was full
+	uint64_t GetBacklogged() const { return m_backlogged.load(std::memory_order_relaxed); }
+
+	/// Get the number of calls to this core not invoked because it had stopped
+	uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	/// Queue a delegate message on the ring of the calling core, or on the
+	/// external queue if the caller is not a core of the group. Reports
+	/// DelegateError::THREAD_NOT_RUNNING if the group is not started.
+	/// @param[in] msg - the delegate message
+	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg);
+
+	/// Queue several delegate messages with a single wakeup
+	/// @param[in] msgs - the delegate messages. The messages are moved from.
+	/// @param[in] count - the number of messages
+	virtual void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count);
+
+private:
+	friend class CoreGroup;
+
+	typedef std::shared_ptr<DelegateLib::DelegateMsg> MsgPtr;
+
+	CoreThread(CoreGroup& group, size_t index, unsigned cpu);
+	CoreThread(const CoreThread&) = delete;
+	CoreThread& operator=(const CoreThread&) = delete;
+
+	/// Entry point for the thread
+	void Process(std::function<void(CoreThread&)> init);
+
+	/// Invoke the messages queued on every ring and the external queue
+	/// @return True if any message was taken.
+	bool InvokeQueued();
+
+	/// Invoke a message unless cancelled or stale
+	void Invoke(MsgPtr& msg);
+
+	/// Move the calls held for each target into its ring
+	/// @return True if every backlog is empty.
+	bool FlushBacklogs();
+
+	/// Check if any ring or the external queue holds a message
+	bool HasQueued() const;
+
+	/// Discard the messages left queued once the thread has exited, counting
+	/// them as dropped
+	void DropQueued();
+
+	/// Wake the thread if it sleeps
+	void Notify();
+
+	/// Wake the thread whether or not it sleeps
+	void Wake();
+
+	/// Wake the thread after a timer is started or the clock advances
+	static void WakeTimers(void* context);
+
+	CoreGroup& m_group;
+	const size_t m_index;
+	const unsigned m_cpu;
+	const std::string THREAD_NAME;
+	std::unique_ptr<std::thread> m_thread;
+
+	/// Inbound rings, one per calling core of the group
+	std::vector<std::unique_ptr<SpscRing<MsgPtr>>> m_rings;
+
+	/// Calls to each core not yet fitting its ring, in call order. Only
+	/// touched by this core.
+	std::vector<RingQueue<MsgPtr>> m_backlogs;
+	size_t m_backlogCount = 0;
+	std::atomic<uint64_t> m_backlogged{ 0 };
+
+	/// Calls from threads outside the group. Protected by m_externalLock.
+	mutable std::mutex m_externalLock;
+	std::deque<MsgPtr> m_external;
+	std::atomic<size_t> m_externalSize{ 0 };
+
+	/// Timers and scratch memory owned by the core
+	TimerSet m_timers;
+	ScratchArena m_scratch;
+
+	/// Wake word slept on, and nonzero while the thread sleeps or is about to
+	alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> m_wake{ 0 };
+	std::atomic<uint32_t> m_sleeping{ 0 };
+	std::atomic<bool> m_exit{ false };
+
+	/// True from Start() until Stop() returns, and while the thread runs its loop
+	std::atomic<bool> m_running{ false };
+	std::atomic<bool> m_looping{ false };
+	std::atomic<uint64_t> m_dropped{ 0 };
+};
+
+/// @brief The cores of a thread-per-core deployment
+class CoreGroup
+{
+public:
+	/// Default capacity of each ring between two cores
+	static const size_t DEFAULT_RING_CAPACITY = 1024;
+
+	/// Constructor
+	/// @param[in] name - the group name. Core i's thread is named "name.i".
+	/// @param[in] cpus - the CPUs to run a core on, one core each. Empty for
+	///		one core per hardware thread.
+	/// @param[in] ringCapacity - the capacity of each ring, a power of 2
+	explicit CoreGroup(const std::string& name, const std::vector<unsigned>& cpus = {},
+		size_t ringCapacity = DEFAULT_RING_CAPACITY);
+
+	/// Destructor. Calls Stop().
+	~CoreGroup();
+
+	/// Start the core threads, pinned to their CPUs
+	/// @param[in] init - called first on each core thread, e.g. to create the
+	///		state owned by the core. May be empty.
+	void Start(std::function<void(CoreThread&)> init = nullptr);
+
+	/// Stop the core threads. Queued delegates are invoked first, including
+	/// the calls a core holds for another core. A core exits once no core holds
+	/// a call, so a call made while stopping may reach a core already stopped.
+	/// Such a call is not invoked and is counted by CoreThread::GetDropped().
+	void Stop();
+
+	/// Get the number of cores
+	size_t GetCoreCount() const { return m_cores.size(); }
+
+	/// Get a core
+	/// @param[in] index - the core index, less than GetCoreCount()
+	CoreThread& GetCore(size_t index) { return *m_cores[index]; }
+
+	/// Get the core running the caller
+	/// @return The core, or nullptr if the caller is not a core of any group.
+	static CoreThread* CurrentCore();
+
+	/// Get the group name
+	const std::string& GetName() const { return m_name; }
+
+private:
+	friend class CoreThread;
+
+	CoreGroup(const CoreGroup&) = delete;
+	CoreGroup& operator=(const CoreGroup&) = delete;
+
+	const std::string m_name;
+	std::vector<std::unique_ptr<CoreThread>> m_cores;
+
+	/// The number of calls held in the backlogs of every core
+	std::atomic<size_t> m_held{ 0 };
+};
+
+#endif
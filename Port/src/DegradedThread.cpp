@@ -0,0 +1,148 @@
+#include "DegradedThread.h"
+#include <thread>
+
+using namespace std;
+using namespace DelegateLib;
+
+//----------------------------------------------------------------------------
+// DegradedThread
+//----------------------------------------------------------------------------
+DegradedThread::DegradedThread(DelegateThread& thread, uint64_t seed) :
+	m_thread(thread), m_state(make_shared<State>(seed))
+{
+}
+
+//----------------------------------------------------------------------------
+// SetDispatchDelay
+//----------------------------------------------------------------------------
+void DegradedThread::SetDispatchDelay(const Delay& delay)
+{
+	lock_guard<mutex> lock(m_state->lock);
+	m_state->dispatchDelay = delay;
+}
+
+//----------------------------------------------------------------------------
+// SetExecutionDelay
+//----------------------------------------------------------------------------
+void DegradedThread::SetExecutionDelay(const Delay& delay)
+{
+	lock_guard<mutex> lock(m_state->lock);
+	m_state->executionDelay = delay;
+}
+
+//----------------------------------------------------------------------------
+// SetCapacity
+//----------------------------------------------------------------------------
+void DegradedThread::SetCapacity(size_t capacity, Overflow overflow)
+{
+	lock_guard<mutex> lock(m_state->lock);
+	m_state->capacity = capacity;
+	m_state->overflow = overflow;
+	m_state->released.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// GetInFlight
+//----------------------------------------------------------------------------
+size_t DegradedThread::GetInFlight() const
+{
+	lock_guard<mutex> lock(m_state->lock);
+	return m_state->inFlight;
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void DegradedThread::DispatchDelegate(std::shared_ptr<DelegateMsg> msg)
+{
+	chrono::microseconds delay;
+	{
+		unique_lock<mutex> lock(m_state->lock);
+		State& state = *m_state;
+		if (state.capacity && state.inFlight >= state.capacity)
+		{
+			if (state.overflow == Overflow::DROP)
+			{
+				state.dropped.fetch_add(1, memory_order_relaxed);
+				return;
+			}
+			state.blocked.fetch_add(1, memory_order_relaxed);
+			state.released.wait(lock, [&state]() { return !state.capacity || state.inFlight < state.capacity; });
+		}
+		state.inFlight++;
+		delay = state.Draw(state.dispatchDelay);
+	}
+
+	// Counted in flight from here so the released capacity is never overcommitted
+	auto degraded = make_shared<DegradedMsg>(m_state, std::move(msg));
+	if (delay.count() > 0)
+		this_thread::sleep_for(delay);
+	m_thread.DispatchDelegate(std::move(degraded));
+}
+
+//----------------------------------------------------------------------------
+// State::Invoke
+//----------------------------------------------------------------------------
+bool DegradedThread::State::Invoke(std::shared_ptr<DelegateMsg> msg)
+{
+	auto degraded = delegate_msg_cast<DegradedMsg>(msg);
+	if (!degraded)
+		return false;
+
+	chrono::microseconds delay;
+	{
+		lock_guard<mutex> guard(lock);
+		delay = Draw(executionDelay);
+	}
+	if (delay.count() > 0)
+		this_thread::sleep_for(delay);
+
+	// The sender may have cancelled the original message while it waited
+	auto original = degraded->GetMsg();
+	if (original->IsCancelled())
+		return true;
+	IDelegateInvoker* invoker = original->GetDelegateInvoker();
+	return invoker && invoker->Invoke(original);
+}
+
+//----------------------------------------------------------------------------
+// State::Draw
+//----------------------------------------------------------------------------
+std::chrono::microseconds DegradedThread::State::Draw(const Delay& delay)
+{
+	double extra = 0;
+	double spread = (double)delay.spread.count();
+	if (spread > 0 && delay.jitter == Jitter::UNIFORM)
+		extra = uniform_real_distribution<double>(0, spread)(random);
+	else if (spread > 0 && delay.jitter == Jitter::EXPONENTIAL)
+		extra = exponential_distribution<double>(1.0 / spread)(random);
+	return delay.base + chrono::microseconds((int64_t)extra);
+}
+
+//----------------------------------------------------------------------------
+// State::Release
+//----------------------------------------------------------------------------
+void DegradedThread::State::Release()
+{
+	lock_guard<mutex> guard(lock);
+	inFlight--;
+	released.notify_one();
+}
+
+//----------------------------------------------------------------------------
+// DegradedMsg
+//----------------------------------------------------------------------------
+DegradedThread::DegradedMsg::DegradedMsg(std::shared_ptr<State> state, std::shared_ptr<DelegateMsg> msg) :
+	DelegateMsg(state, type_id<DegradedMsg>()), m_state(std::move(state)), m_msg(std::move(msg))
+{
+	// The thread discards the message by the original deadline
+	SetDeadline(m_msg->GetDeadline());
+}
+
+//----------------------------------------------------------------------------
+// ~DegradedMsg
+//----------------------------------------------------------------------------
+DegradedThread::DegradedMsg::~DegradedMsg()
+{
+	m_state->Release();
+}
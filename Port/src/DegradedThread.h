@@ -0,0 +1,145 @@
+#ifndef _DEGRADED_THREAD_H
+#define _DEGRADED_THREAD_H
+
+#include "DelegateThread.h"
+#include "DelegateMsg.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+
+/// @brief A DelegateThread decorator that makes another thread, e.g. a WorkerThread
+/// or the Logger, behave like a slow subsystem. Delegates bound to the decorator
+/// instead of the thread have their calls delayed at dispatch, slowed before the
+/// target function runs on the thread, and limited to a number in flight, so
+/// integration tests can check backpressure, timeouts and batching against a
+/// degraded consumer without changing it.
+///
+/// @details Each dispatched message is wrapped in a message whose invoker sleeps
+/// for the execution delay on the thread, then invokes the original. A message
+/// is in flight from dispatch until the thread invokes or discards it. Delays
+/// are a base plus a random jitter drawn from a seeded generator, so a seed
+/// reproduces the same delays for the same call order. Wrapped messages are not
+/// recognized by thread-side message inspection such as coalescing. Injection
+/// settings may change at any time from any thread.
+///
+/// A sender blocked by Overflow::BLOCK waits for the thread, so the thread must
+/// not dispatch to its own decorator once full.
+class DegradedThread : public DelegateLib::DelegateThread
+{
+public:
+	/// Distribution of the random part of a delay
+	enum class Jitter
+	{
+		NONE,			///< No jitter. The delay is the base.
+		UNIFORM,		///< Uniform between zero and the spread
+		EXPONENTIAL		///< Exponential with the spread as its mean
+	};
+
+	/// What a dispatch does when the capacity is in flight
+	enum class Overflow
+	{
+		BLOCK,			///< Wait until a message completes
+		DROP			///< Discard the message
+	};
+
+	/// An injected delay
+	struct Delay
+	{
+		std::chrono::microseconds base = std::chrono::microseconds(0);
+		Jitter jitter = Jitter::NONE;
+		std::chrono::microseconds spread = std::chrono::microseconds(0);
+	};
+
+	/// Constructor
+	/// @param[in] thread - the thread messages are forwarded to. Must outlive
+	///		the messages dispatched through the decorator.
+	/// @param[in] seed - the jitter seed
+	explicit DegradedThread(DelegateLib::DelegateThread& thread, uint64_t seed = 1);
+
+	/// Set the delay of each dispatch, spent on the sending thread before the
+	/// message is forwarded
+	/// @param[in] delay - the delay
+	void SetDispatchDelay(const Delay& delay);
+
+	/// Set the delay spent on the thread before each target function runs
+	/// @param[in] delay - the delay
+	void SetExecutionDelay(const Delay& delay);
+
+	/// Limit the messages in flight
+	/// @param[in] capacity - the limit, or 0 for none
+	/// @param[in] overflow - what a dispatch does once the limit is reached
+	void SetCapacity(size_t capacity, Overflow overflow = Overflow::BLOCK);
+
+	/// Get the messages dispatched and not yet invoked or discarded
+	size_t GetInFlight() const;
+
+	/// Get the number of messages discarded by Overflow::DROP
+	uint64_t GetDropped() const { return m_state->dropped.load(std::memory_order_relaxed); }
+
+	/// Get the number of dispatches that waited for capacity
+	uint64_t GetBlocked() const { return m_state->blocked.load(std::memory_order_relaxed); }
+
+	/// Get the decorated thread
+	DelegateLib::DelegateThread& GetThread() const { return m_thread; }
+
+	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg) override;
+
+	/// Forwarded from the decorated thread
+	virtual int GetNumaNode() const override { return m_thread.GetNumaNode(); }
+	virtual std::pmr::memory_resource* GetMemoryResource() const override { return m_thread.GetMemoryResource(); }
+	virtual DelegateLib::DelegateRecorder* GetRecorder() const override { return m_thread.GetRecorder(); }
+	virtual DelegateLib::DelegateWaitStats* GetWaitStats() const override { return m_thread.GetWaitStats(); }
+
+private:
+	DegradedThread(const DegradedThread&) = delete;
+	DegradedThread& operator=(const DegradedThread&) = delete;
+
+	/// Settings and counters shared with the wrapped messages, which may outlive
+	/// the decorator. Invokes the wrapped messages on the thread.
+	struct State : public DelegateLib::IDelegateInvoker
+	{
+		explicit State(uint64_t seed) : random(seed) {}
+
+		virtual bool Invoke(std::shared_ptr<DelegateLib::DelegateMsg> msg) override;
+
+		/// Draw a delay. Called with lock held.
+		std::chrono::microseconds Draw(const Delay& delay);
+
+		/// Take a message out of flight
+		void Release();
+
+		std::mutex lock;
+		std::condition_variable released;
+		std::mt19937_64 random;
+		Delay dispatchDelay;
+		Delay executionDelay;
+		size_t capacity = 0;
+		Overflow overflow = Overflow::BLOCK;
+		size_t inFlight = 0;
+		std::atomic<uint64_t> dropped{ 0 };
+		std::atomic<uint64_t> blocked{ 0 };
+	};
+
+	/// The message forwarded to the thread in place of the original
+	class DegradedMsg : public DelegateLib::DelegateMsg
+	{
+	public:
+		DegradedMsg(std::shared_ptr<State> state, std::shared_ptr<DelegateLib::DelegateMsg> msg);
+		~DegradedMsg();
+
+		std::shared_ptr<DelegateLib::DelegateMsg> GetMsg() const { return m_msg; }
+
+	private:
+		std::shared_ptr<State> m_state;
+		std::shared_ptr<DelegateLib::DelegateMsg> m_msg;
+	};
+
+	DelegateLib::DelegateThread& m_thread;
+	std::shared_ptr<State> m_state;
+};
+
+#endif
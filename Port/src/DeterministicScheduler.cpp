@@ -0,0 +1,233 @@
+#include "DeterministicScheduler.h"
+#include "WorkerThreadStd.h"
+#include "Timer.h"
+#include <algorithm>
+
+using namespace std;
+
+std::atomic<DeterministicScheduler*> DeterministicScheduler::m_installed{ nullptr };
+
+//----------------------------------------------------------------------------
+// DeterministicScheduler
+//----------------------------------------------------------------------------
+DeterministicScheduler::DeterministicScheduler(uint64_t seed) :
+	m_seed(seed), m_random(seed), m_threadId(this_thread::get_id())
+{
+}
+
+//----------------------------------------------------------------------------
+// ~DeterministicScheduler
+//----------------------------------------------------------------------------
+DeterministicScheduler::~DeterministicScheduler()
+{
+	if (m_installed.load() == this)
+		Install(nullptr);
+}
+
+//----------------------------------------------------------------------------
+// Install
+//----------------------------------------------------------------------------
+void DeterministicScheduler::Install(DeterministicScheduler* scheduler)
+{
+	m_installed.store(scheduler);
+	DelegateLib::Clock::Set(scheduler ? &scheduler->m_clock : nullptr);
+}
+
+//----------------------------------------------------------------------------
+// GetInstalled
+//----------------------------------------------------------------------------
+DeterministicScheduler* DeterministicScheduler::GetInstalled()
+{
+	return m_installed.load();
+}
+
+//----------------------------------------------------------------------------
+// Attach
+//----------------------------------------------------------------------------
+void DeterministicScheduler::Attach(WorkerThread* thread)
+{
+	lock_guard<mutex> lock(m_lock);
+	m_threads.push_back(thread);
+}
+
+//----------------------------------------------------------------------------
+// Detach
+//----------------------------------------------------------------------------
+size_t DeterministicScheduler::Detach(WorkerThread* thread, std::chrono::steady_clock::time_point deadline)
+{
+	std::vector<std::shared_ptr<DelegateLib::DelegateMsg>> msgs;
+	{
+		lock_guard<mutex> lock(m_lock);
+		m_threads.erase(std::remove(m_threads.begin(), m_threads.end(), thread), m_threads.end());
+		for (auto it = m_queue.begin(); it != m_queue.end();)
+		{
+			if (it->thread == thread)
+			{
+				msgs.push_back(std::move(it->msg));
+				it = m_queue.erase(it);
+			}
+			else
+				++it;
+		}
+	}
+
+	// Invoke the thread's messages in order until the deadline
+	size_t discarded = 0;
+	for (auto& msg : msgs)
+	{
+		if (deadline != std::chrono::steady_clock::time_point::max() && 
+			(deadline == std::chrono::steady_clock::time_point::min() || std::chrono::steady_clock::now() >= deadline))
+			discarded++;
+		else
+			thread->InvokeScheduled(msg);
+	}
+	return discarded;
+}
+
+//----------------------------------------------------------------------------
+// Post
+//----------------------------------------------------------------------------
+void DeterministicScheduler::Post(WorkerThread* thread, std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	lock_guard<mutex> lock(m_lock);
+	m_queue.push_back(Entry{ thread, std::move(msg) });
+}
+
+//----------------------------------------------------------------------------
+// GetQueued
+//----------------------------------------------------------------------------
+size_t DeterministicScheduler::GetQueued(const WorkerThread* thread)
+{
+	lock_guard<mutex> lock(m_lock);
+	return (size_t)std::count_if(m_queue.begin(), m_queue.end(), 
+		[thread](const Entry& entry) { return entry.thread == thread; });
+}
+
+//----------------------------------------------------------------------------
+// NextRandom
+//----------------------------------------------------------------------------
+uint64_t DeterministicScheduler::NextRandom()
+{
+	// xorshift64*
+	m_random ^= m_random >> 12;
+	m_random ^= m_random << 25;
+	m_random ^= m_random >> 27;
+	return m_random * 2685821657736338717ULL;
+}
+
+//----------------------------------------------------------------------------
+// Take
+//----------------------------------------------------------------------------
+bool DeterministicScheduler::Take(Entry& entry)
+{
+	lock_guard<mutex> lock(m_lock);
+	if (m_queue.empty())
+		return false;
+
+	auto next = m_queue.begin();
+	if (m_seed != 0)
+	{
+		// Pick a thread with queued work, then take its oldest message
+		std::vector<WorkerThread*> ready;
+		for (auto& queued : m_queue)
+		{
+			if (std::find(ready.begin(), ready.end(), queued.thread) == ready.end())
+				ready.push_back(queued.thread);
+		}
+		WorkerThread* thread = ready[NextRandom() % ready.size()];
+		next = std::find_if(m_queue.begin(), m_queue.end(), 
+			[thread](const Entry& queued) { return queued.thread == thread; });
+	}
+
+	entry = std::move(*next);
+	m_queue.erase(next);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// ServiceTimers
+//----------------------------------------------------------------------------
+void DeterministicScheduler::ServiceTimers()
+{
+	std::vector<WorkerThread*> threads;
+	{
+		lock_guard<mutex> lock(m_lock);
+		threads = m_threads;
+	}
+	for (WorkerThread* thread : threads)
+		thread->ServiceScheduledTimers();
+}
+
+//----------------------------------------------------------------------------
+// GetNextExpiration
+//----------------------------------------------------------------------------
+bool DeterministicScheduler::GetNextExpiration(std::chrono::microseconds& time)
+{
+	bool running = Timer::GetDefaultTimers().GetNextExpiration(time);
+	lock_guard<mutex> lock(m_lock);
+	for (WorkerThread* thread : m_threads)
+	{
+		std::chrono::microseconds next;
+		if (thread->GetTimers().GetNextExpiration(next) && (!running || next < time))
+		{
+			time = next;
+			running = true;
+		}
+		if (thread->m_scheduled.GetNextDue(next) && (!running || next < time))
+		{
+			time = next;
+			running = true;
+		}
+	}
+	return running;
+}
+
+//----------------------------------------------------------------------------
+// Step
+//----------------------------------------------------------------------------
+bool DeterministicScheduler::Step()
+{
+	ServiceTimers();
+
+	Entry entry;
+	if (!Take(entry))
+		return false;
+	entry.thread->InvokeScheduled(entry.msg);
+	m_steps++;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// RunUntilIdle
+//----------------------------------------------------------------------------
+size_t DeterministicScheduler::RunUntilIdle()
+{
+	size_t invoked = 0;
+	while (Step())
+		invoked++;
+	return invoked;
+}
+
+//----------------------------------------------------------------------------
+// RunFor
+//----------------------------------------------------------------------------
+size_t DeterministicScheduler::RunFor(std::chrono::nanoseconds duration)
+{
+	auto end = Timer::GetTime() + std::chrono::duration_cast<std::chrono::microseconds>(duration);
+	size_t invoked = RunUntilIdle();
+
+	// Jump to each timer expiration in turn
+	std::chrono::microseconds next;
+	while (GetNextExpiration(next) && next <= end)
+	{
+		auto now = Timer::GetTime();
+		if (next > now)
+			m_clock.Advance(next - now);
+		invoked += RunUntilIdle();
+	}
+
+	auto now = Timer::GetTime();
+	if (end > now)
+		m_clock.Advance(end - now);
+	return invoked + RunUntilIdle();
+}
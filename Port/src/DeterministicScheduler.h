@@ -0,0 +1,141 @@
+#ifndef _DETERMINISTIC_SCHEDULER_H
+#define _DETERMINISTIC_SCHEDULER_H
+
+#include "DelegateMsg.h"
+#include "Clock.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerThread;
+
+/// @brief Runs WorkerThreads created with QueuePolicy::SCHEDULED cooperatively on
+/// the one OS thread calling Step(), RunUntilIdle() or RunFor(). A scheduled
+/// thread has no OS thread: each message dispatched to it is appended to the
+/// scheduler's run queue and invoked by the scheduler as if on the thread, and
+/// its timers are serviced between messages against the scheduler's virtual
+/// clock. Tests then run without context switches or sleeps.
+///
+/// @details With seed 0 messages run in global dispatch order. Any other seed
+/// picks the next thread to run pseudo-randomly among those with queued work,
+/// each thread still taking its own messages in order, so a seed explores one
+/// interleaving and the same seed replays it. Priority lanes are not used.
+/// Only traffic originating on the scheduler thread is deterministic; messages
+/// dispatched by other OS threads, e.g. Logger, are queued thread-safely but
+/// arrive in real time.
+class DeterministicScheduler
+{
+public:
+	/// Constructor. The calling thread drives the scheduler.
+	/// @param[in] seed - the interleaving seed, or 0 for dispatch order
+	explicit DeterministicScheduler(uint64_t seed = 0);
+
+	/// Destructor. Uninstalls the scheduler if installed.
+	~DeterministicScheduler();
+
+	/// Install the scheduler used by WorkerThread::CreateThread() for scheduled
+	/// threads, and its virtual clock as the Clock. Install before creating the
+	/// scheduled threads and uninstall once they exit.
+	/// @param[in] scheduler - the scheduler, or nullptr to uninstall and restore
+	///		the steady clock
+	static void Install(DeterministicScheduler* scheduler);
+
+	/// Get the installed scheduler
+	/// @return The scheduler, or nullptr if none is installed.
+	static DeterministicScheduler* GetInstalled();
+
+	/// Service due timers and invoke one queued message
+	/// @return True if a message was invoked.
+	bool Step();
+
+	/// Invoke queued messages and service due timers until no message is queued
+	/// @return The number of messages invoked.
+	size_t RunUntilIdle();
+
+	/// Run until idle, then advance the virtual clock to each timer expiration
+	/// within the duration in turn, running the work it causes, and finally to
+	/// the end of the duration
+	/// @param[in] duration - the virtual time to run
+	/// @return The number of messages invoked.
+	size_t RunFor(std::chrono::nanoseconds duration);
+
+	/// Get the interleaving seed
+	uint64_t GetSeed() const { return m_seed; }
+
+	/// Get the number of messages invoked
+	uint64_t GetSteps() const { return m_steps; }
+
+	/// Get the ID of the OS thread driving the scheduler
+	std::thread::id GetThreadId() const { return m_threadId; }
+
+	/// Get the virtual clock installed with the scheduler
+	DelegateLib::VirtualClock& GetClock() { return m_clock; }
+
+private:
+	DeterministicScheduler(const DeterministicScheduler&) = delete;
+	DeterministicScheduler& operator=(const DeterministicScheduler&) = delete;
+
+	friend class WorkerThread;
+
+	/// A message queued for a scheduled thread
+	struct Entry
+	{
+		WorkerThread* thread;
+		std::shared_ptr<DelegateLib::DelegateMsg> msg;
+	};
+
+	/// Add a scheduled thread. Called by WorkerThread::CreateThread().
+	void Attach(WorkerThread* thread);
+
+	/// Remove a scheduled thread and its queued messages. Called by
+	/// WorkerThread::ExitThread().
+	/// @param[in] thread - the thread
+	/// @param[in] deadline - invoke the thread's queued messages until this time,
+	///		then discard the rest
+	/// @return The number of messages discarded.
+	size_t Detach(WorkerThread* thread, std::chrono::steady_clock::time_point deadline);
+
+	/// Queue a message for a scheduled thread. Function call is thread-safe.
+	void Post(WorkerThread* thread, std::shared_ptr<DelegateLib::DelegateMsg> msg);
+
+	/// Get the number of messages queued for a thread. Function call is thread-safe.
+	size_t GetQueued(const WorkerThread* thread);
+
+	/// Take the next message to run
+	/// @param[out] entry - the message and its thread
+	/// @return True if a message was queued.
+	bool Take(Entry& entry);
+
+	/// Service the due timers of every scheduled thread
+	void ServiceTimers();
+
+	/// Get the earliest timer service or scheduled message due time of the 
+	/// scheduled threads
+	/// @param[out] time - the service time in Timer ticks
+	/// @return True if a timer is running or a message is scheduled.
+	bool GetNextExpiration(std::chrono::microseconds& time);
+
+	/// Advance the pseudo-random interleaving state
+	uint64_t NextRandom();
+
+	const uint64_t m_seed;
+	uint64_t m_random;
+	uint64_t m_steps = 0;
+	const std::thread::id m_threadId;
+
+	DelegateLib::VirtualClock m_clock;
+
+	/// Run queue in dispatch order and the scheduled threads. Protected by m_lock.
+	std::deque<Entry> m_queue;
+	std::vector<WorkerThread*> m_threads;
+	std::mutex m_lock;
+
+	static std::atomic<DeterministicScheduler*> m_installed;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef _DISPATCH_BATCH_H
+#define _DISPATCH_BATCH_H
+
+#include "DelegateThread.h"
+#include <vector>
+#include <memory>
+
+/// @brief A scoped batch of async delegate calls. Bind async delegates to the 
+/// batch instead of the destination thread. Calls are collected and dispatched
+/// together with DelegateThread::DispatchDelegates() when the batch is 
+/// committed or destroyed, so the destination thread is locked and woken once.
+/// DispatchBatch is not thread-safe.
+/// 
+/// @code
+/// {
+///     DispatchBatch batch(workerThread);
+///     auto delegate = MakeDelegate(&obj, &Obj::Func, batch);
+///     for (int i = 0; i < 100; i++)
+///         delegate(i);
+/// }   // 100 calls dispatched onto workerThread here
+/// @endcode
+class DispatchBatch : public DelegateLib::DelegateThread
+{
+public:
+	/// Constructor
+	/// @param[in] thread - the destination thread
+	explicit DispatchBatch(DelegateLib::DelegateThread& thread) : m_thread(thread) {}
+
+	/// Destructor. Commits the calls not yet dispatched.
+	~DispatchBatch() { Commit(); }
+
+	/// Dispatch the collected calls onto the destination thread
+	void Commit()
+	{
+		if (m_msgs.empty())
+			return;
+		m_thread.DispatchDelegates(m_msgs.data(), m_msgs.size());
+		m_msgs.clear();
+	}
+
+	/// Get the number of calls not yet dispatched
+	size_t Size() const { return m_msgs.size(); }
+
+	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+	{
+		m_msgs.push_back(std::move(msg));
+	}
+
+private:
+	DispatchBatch(const DispatchBatch&) = delete;
+	DispatchBatch& operator=(const DispatchBatch&) = delete;
+
+	DelegateLib::DelegateThread& m_thread;
+	std::vector<std::shared_ptr<DelegateLib::DelegateMsg>> m_msgs;
+};
+
+#endif
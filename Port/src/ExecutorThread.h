@@ -0,0 +1,144 @@
+#ifndef _EXECUTOR_THREAD_H
+#define _EXECUTOR_THREAD_H
+
+/// @file
+/// @brief A DelegateThread running asynchronous delegates on an external executor,
+/// e.g. an Asio io_context, a TBB task arena or an application thread pool.
+///
+/// @details ExecutorThread posts each dispatched DelegateMsg to the executor as a
+/// closure holding the message's shared pointer, so the arguments the message
+/// already owns are not copied again. The closure invokes the message on
+/// whichever executor thread runs it, so delegates run on the existing pool
+/// without a WorkerThread of their own. The executor is held by value, so pass
+/// a cheap handle such as an Asio executor, a reference wrapper or a pointer
+/// wrapping lambda.
+///
+/// The executor is called with one callable and may use the first of these forms
+/// it supports:
+///
+/// * `executor.execute(f)` - Asio executors such as io_context::get_executor()
+/// * `executor.post(f)` - io_context and strand in older Asio releases
+/// * `executor.enqueue(f)` - tbb::task_arena
+/// * `executor.run(f)` - tbb::task_group
+/// * `executor(f)` - any callable, e.g. a lambda forwarding to a pool
+///
+/// A closure never refers to the ExecutorThread, so the adapter may be destroyed
+/// while closures are still queued. A message cancelled while queued, i.e. a
+/// blocking call whose sender stopped waiting, is discarded unseen.
+
+#include "DelegateThread.h"
+#include "DelegateMsg.h"
+#include "DelegateInvoker.h"
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ExecutorDetail {
+
+template <class E, class F, class = void> struct HasExecute : std::false_type {};
+template <class E, class F> struct HasExecute<E, F, std::void_t<decltype(std::declval<E&>().execute(std::declval<F>()))>> : std::true_type {};
+template <class E, class F, class = void> struct HasPost : std::false_type {};
+template <class E, class F> struct HasPost<E, F, std::void_t<decltype(std::declval<E&>().post(std::declval<F>()))>> : std::true_type {};
+template <class E, class F, class = void> struct HasEnqueue : std::false_type {};
+template <class E, class F> struct HasEnqueue<E, F, std::void_t<decltype(std::declval<E&>().enqueue(std::declval<F>()))>> : std::true_type {};
+template <class E, class F, class = void> struct HasRun : std::false_type {};
+template <class E, class F> struct HasRun<E, F, std::void_t<decltype(std::declval<E&>().run(std::declval<F>()))>> : std::true_type {};
+
+/// Hand a callable to an executor using the first form it supports
+template <class Executor, class F>
+void Submit(Executor& executor, F&& f)
+{
+	if constexpr (HasExecute<Executor, F>::value)
+		executor.execute(std::forward<F>(f));
+	else if constexpr (HasPost<Executor, F>::value)
+		executor.post(std::forward<F>(f));
+	else if constexpr (HasEnqueue<Executor, F>::value)
+		executor.enqueue(std::forward<F>(f));
+	else if constexpr (HasRun<Executor, F>::value)
+		executor.run(std::forward<F>(f));
+	else
+	{
+		static_assert(std::is_invocable_v<Executor&, F>, "Executor has no execute(), post(), enqueue(), run() or operator()");
+		executor(std::forward<F>(f));
+	}
+}
+
+/// Invoke a message on the executor thread unless its sender cancelled it
+inline void Invoke(std::shared_ptr<DelegateLib::DelegateMsg>&& msg)
+{
+	if (msg->IsCancelled())
+		return;
+	auto invoker = msg->GetDelegateInvoker();
+	if (invoker)
+		invoker->Invoke(std::move(msg));
+}
+
+}
+
+template <class Executor>
+class ExecutorThread : public DelegateLib::DelegateThread
+{
+public:
+	/// Constructor
+	/// @param[in] executor - the executor the messages are posted to. Copied.
+	/// @param[in] ordered - true if the executor runs the closures one at a time
+	///		in posting order, e.g. an Asio strand or a single threaded io_context.
+	///		Reported by IsOrdered().
+	explicit ExecutorThread(Executor executor, bool ordered = false) :
+		m_executor(std::move(executor)), m_ordered(ordered)
+	{
+	}
+
+	/// Post a message to the executor
+	/// @param[in] msg - the message
+	void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg) override
+	{
+		ExecutorDetail::Submit(m_executor, [msg = std::move(msg)]() mutable {
+			ExecutorDetail::Invoke(std::move(msg));
+		});
+	}
+
+	/// Post several messages to the executor as one closure invoking them in order
+	/// @param[in] msgs - the messages. The messages are moved from.
+	/// @param[in] count - the number of messages
+	void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count) override
+	{
+		if (count == 1)
+		{
+			DispatchDelegate(std::move(msgs[0]));
+			return;
+		}
+		auto batch = std::make_shared<std::vector<std::shared_ptr<DelegateLib::DelegateMsg>>>(
+			std::make_move_iterator(msgs), std::make_move_iterator(msgs + count));
+		ExecutorDetail::Submit(m_executor, [batch]() {
+			for (auto& msg : *batch)
+				ExecutorDetail::Invoke(std::move(msg));
+		});
+	}
+
+	bool IsOrdered() const override { return m_ordered; }
+
+	/// Get the executor
+	Executor& GetExecutor() { return m_executor; }
+
+private:
+	ExecutorThread(const ExecutorThread&) = delete;
+	ExecutorThread& operator=(const ExecutorThread&) = delete;
+
+	Executor m_executor;
+	const bool m_ordered;
+};
+
+/// Create an ExecutorThread, deducing the executor type
+/// @param[in] executor - the executor. Copied.
+/// @param[in] ordered - true if the executor runs closures one at a time in order
+/// @return The thread adapter.
+template <class Executor>
+std::unique_ptr<ExecutorThread<std::decay_t<Executor>>> MakeExecutorThread(Executor&& executor, bool ordered = false)
+{
+	return std::make_unique<ExecutorThread<std::decay_t<Executor>>>(std::forward<Executor>(executor), ordered);
+}
+
+#endif
@@ -7,6 +7,16 @@
 
 using namespace std;
 
+static FaultHook faultHook = NULL;
+
+//----------------------------------------------------------------------------
+// SetFaultHook
+//----------------------------------------------------------------------------
+void SetFaultHook(FaultHook hook)
+{
+	faultHook = hook;
+}
+
 //----------------------------------------------------------------------------
 // FaultHandler
 //----------------------------------------------------------------------------
@@ -17,6 +27,10 @@ void FaultHandler(const char* file, unsigned short line)
     DebugBreak();
 #endif
 
+    // Save diagnostic data before the application is terminated
+    if (faultHook)
+        faultHook();
+
     cout << "FaultHandler called. Application terminated." << endl;
     cout << "File: " << file << " Line: " << line << endl;
 
@@ -16,6 +16,14 @@ extern "C" {
 	/// @param[in] line - the line number that the software assertion occurred on
 	void FaultHandler(const char* file, unsigned short line);
 
+	/// Function called by FaultHandler before the application is terminated
+	typedef void (*FaultHook)(void);
+
+	/// Register a function called by FaultHandler before the application is 
+	/// terminated, e.g. to save diagnostic data. 
+	/// @param[in] hook - the function to call, or NULL to remove the hook
+	void SetFaultHook(FaultHook hook);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,154 @@
+#include "HugePages.h"
+#include <new>
+#include <cstdint>
+
+#ifdef WIN32
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+#if defined(__linux__)
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+static const size_t GIGABYTE = 1024 * 1024 * 1024;
+
+//----------------------------------------------------------------------------
+// MapTransparent
+//----------------------------------------------------------------------------
+/// Map a region aligned to the huge page size and advise transparent huge pages
+static void* MapTransparent(size_t size, size_t pageSize)
+{
+	// Over-allocate by a page and unmap the unaligned head and tail
+	char* map = static_cast<char*>(mmap(nullptr, size + pageSize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (map == MAP_FAILED)
+		return nullptr;
+	char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(map) + pageSize - 1) & ~(uintptr_t)(pageSize - 1));
+	if (aligned > map)
+		munmap(map, aligned - map);
+	size_t tail = (map + size + pageSize) - (aligned + size);
+	if (tail > 0)
+		munmap(aligned + size, tail);
+	madvise(aligned, size, MADV_HUGEPAGE);
+	return aligned;
+}
+#endif
+
+//----------------------------------------------------------------------------
+// GetPageSize
+//----------------------------------------------------------------------------
+size_t HugePages::GetPageSize()
+{
+#ifdef WIN32
+	static const size_t pageSize = GetLargePageMinimum() ? GetLargePageMinimum() : DEFAULT_PAGE_SIZE;
+	return pageSize;
+#else
+	return DEFAULT_PAGE_SIZE;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// RoundUp
+//----------------------------------------------------------------------------
+size_t HugePages::RoundUp(size_t size)
+{
+	size_t pageSize = GetPageSize();
+	return (size + pageSize - 1) / pageSize * pageSize;
+}
+
+//----------------------------------------------------------------------------
+// Allocate
+//----------------------------------------------------------------------------
+HugePages::Ptr HugePages::Allocate(size_t size, bool huge)
+{
+	Deleter deleter;
+	if (size == 0)
+		return Ptr(nullptr, deleter);
+
+	if (!huge)
+	{
+		deleter.size = size;
+		return Ptr(new char[size], deleter);
+	}
+
+	deleter.size = RoundUp(size);
+	void* data = nullptr;
+#if defined(__linux__)
+	// Explicit huge pages fail at once if none are reserved
+	if (deleter.size % GIGABYTE == 0)
+	{
+		data = mmap(nullptr, deleter.size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_1GB, -1, 0);
+	}
+	if (!data || data == MAP_FAILED)
+	{
+		data = mmap(nullptr, deleter.size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	}
+	deleter.backing = Backing::EXPLICIT;
+	if (data == MAP_FAILED)
+	{
+		data = MapTransparent(deleter.size, GetPageSize());
+		deleter.backing = Backing::TRANSPARENT;
+	}
+#elif defined(WIN32)
+	// Large pages need the SeLockMemoryPrivilege, otherwise normal pages are used
+	data = VirtualAlloc(nullptr, deleter.size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+	deleter.backing = Backing::EXPLICIT;
+	if (!data)
+	{
+		data = VirtualAlloc(nullptr, deleter.size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+		deleter.backing = Backing::PAGES;
+	}
+#else
+	data = new char[deleter.size];
+	deleter.backing = Backing::HEAP;
+#endif
+	if (!data)
+		throw std::bad_alloc();
+	return Ptr(static_cast<char*>(data), deleter);
+}
+
+HugePages::Ptr HugePages::Allocate(size_t size, std::pmr::memory_resource& resource)
+{
+	Deleter deleter;
+	if (size == 0)
+		return Ptr(nullptr, deleter);
+
+	deleter.size = size;
+	deleter.backing = Backing::RESOURCE;
+	deleter.resource = &resource;
+	return Ptr(static_cast<char*>(resource.allocate(size)), deleter);
+}
+
+//----------------------------------------------------------------------------
+// Deleter
+//----------------------------------------------------------------------------
+void HugePages::Deleter::operator()(char* data) const
+{
+	if (!data)
+		return;
+	if (backing == Backing::RESOURCE)
+	{
+		resource->deallocate(data, size);
+		return;
+	}
+	if (backing == Backing::HEAP)
+	{
+		delete[] data;
+		return;
+	}
+#if defined(__linux__)
+	munmap(data, size);
+#elif defined(WIN32)
+	VirtualFree(data, 0, MEM_RELEASE);
+#endif
+}
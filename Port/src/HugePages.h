@@ -0,0 +1,78 @@
+#ifndef _HUGE_PAGES_H
+#define _HUGE_PAGES_H
+
+#include <memory>
+#include <memory_resource>
+#include <cstddef>
+
+/// @brief Allocates large buffers backed by huge pages where the platform
+/// provides them, so buffers spanning hundreds of MB need few TLB entries.
+///
+/// @details A huge page allocation tries, in order:
+///
+/// * explicit huge pages, MAP_HUGETLB on Linux and MEM_LARGE_PAGES on Windows.
+///   1 GB pages are tried first for regions of at least 1 GB. Requires pages
+///   reserved by the administrator, e.g. vm.nr_hugepages, or on Windows the
+///   SeLockMemoryPrivilege.
+/// * transparent huge pages on Linux, an aligned mapping advised with
+///   MADV_HUGEPAGE. The kernel backs it with huge pages when it can.
+/// * normal pages
+///
+/// The size is rounded up to whole huge pages. Memory is freed by the Ptr
+/// deleter however it was allocated.
+class HugePages
+{
+public:
+	/// Huge page size used where the platform does not report one
+	static const size_t DEFAULT_PAGE_SIZE = 2 * 1024 * 1024;
+
+	/// The memory backing an allocation
+	enum class Backing
+	{
+		HEAP,			///< operator new[]
+		PAGES,			///< Normal pages mapped from the operating system
+		TRANSPARENT,	///< Mapped and advised to use transparent huge pages
+		EXPLICIT,		///< Reserved huge pages
+		RESOURCE		///< A std::pmr::memory_resource
+	};
+
+	/// Frees memory from Allocate()
+	struct Deleter
+	{
+		size_t size = 0;
+		Backing backing = Backing::HEAP;
+		std::pmr::memory_resource* resource = nullptr;
+		void operator()(char* data) const;
+	};
+
+	typedef std::unique_ptr<char[], Deleter> Ptr;
+
+	/// Allocate a buffer
+	/// @param[in] size - the size in bytes
+	/// @param[in] huge - true to back the buffer with huge pages if possible,
+	///		false to allocate it from the heap
+	/// @return The buffer, or nullptr if size is 0.
+	/// @throws std::bad_alloc If no memory is available.
+	static Ptr Allocate(size_t size, bool huge);
+
+	/// Allocate a buffer from a memory resource, e.g. a bounded arena
+	/// @param[in] size - the size in bytes
+	/// @param[in] resource - the memory resource, which must outlive the buffer
+	/// @return The buffer, or nullptr if size is 0.
+	/// @throws std::bad_alloc If the resource is exhausted.
+	static Ptr Allocate(size_t size, std::pmr::memory_resource& resource);
+
+	/// Get the memory backing a buffer from Allocate()
+	static Backing GetBacking(const Ptr& ptr) { return ptr.get_deleter().backing; }
+
+	/// Get the huge page size
+	/// @return The size in bytes.
+	static size_t GetPageSize();
+
+	/// Round a size up to whole huge pages
+	/// @param[in] size - the size in bytes
+	/// @return The rounded size.
+	static size_t RoundUp(size_t size);
+};
+
+#endif
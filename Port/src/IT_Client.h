@@ -7,14 +7,98 @@
 
 // Allow production code to use delegate library
 #include "DelegateLib.h"
+#include <atomic>
+#include <mutex>
 
 // Allow integration tests to access production code private members
 #define IT_PRIVATE_ACCESS public
 
+template <class R>
+class IT_Hook; // Not defined
+
+/// @brief An integration test callback point within production code. A thread-safe
+/// delegate container that costs one relaxed atomic load to invoke while no
+/// integration test is subscribed. Invoke with IT_HOOK() so the arguments, e.g.
+/// timestamps, are only evaluated when a test is listening.
+template <class RetType, class... Args>
+class IT_Hook<RetType(Args...)>
+{
+public:
+	typedef DelegateLib::Delegate<RetType(Args...)> DelegateType;
+	typedef typename DelegateLib::MulticastDelegateSafe<RetType(Args...)>::Subscription Subscription;
+
+	/// Check if any test is subscribed
+	/// @return True if subscribed.
+	bool IsActive() const { return m_active.load(std::memory_order_relaxed); }
+
+	/// Invoke the subscribed delegates
+	/// @param[in] args - the arguments passed to each delegate
+	void operator()(Args... args)
+	{
+		if (IsActive())
+			m_delegates(std::forward<Args>(args)...);
+	}
+
+	/// Subscribe a delegate
+	/// @param[in] delegate - the delegate to insert
+	/// @return The handle removing the delegate.
+	Subscription operator+=(const DelegateType& delegate)
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		Subscription subscription = m_delegates += delegate;
+		m_active.store(true, std::memory_order_relaxed);
+		return subscription;
+	}
+
+	/// Unsubscribe a delegate
+	/// @param[in] delegate - the delegate to remove
+	void operator-=(const DelegateType& delegate)
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		m_delegates -= delegate;
+		m_active.store(!m_delegates.Empty(), std::memory_order_relaxed);
+	}
+
+	/// Unsubscribe a delegate
+	/// @param[in] subscription - the handle returned by operator+=
+	/// @return True if the delegate was subscribed.
+	bool Remove(const Subscription& subscription)
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		bool removed = m_delegates.Remove(subscription);
+		m_active.store(!m_delegates.Empty(), std::memory_order_relaxed);
+		return removed;
+	}
+
+	/// Unsubscribe every delegate
+	void Clear()
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		m_delegates.Clear();
+		m_active.store(false, std::memory_order_relaxed);
+	}
+
+	/// Get the number of subscribed delegates
+	/// @return The number of delegates.
+	size_t Size() const { return m_delegates.Size(); }
+
+private:
+	DelegateLib::MulticastDelegateSafe<RetType(Args...)> m_delegates;
+
+	/// True while m_delegates is not empty. Written with m_lock held.
+	std::atomic<bool> m_active{ false };
+
+	/// Serializes subscribes so m_active matches m_delegates
+	std::mutex m_lock;
+};
+
+/// Invoke an IT_Hook. The arguments are not evaluated unless a test is subscribed.
+#define IT_HOOK(hook, ...) do { if ((hook).IsActive()) (hook)(__VA_ARGS__); } while (0)
+
 #else
 
 #define IT_PRIVATE_ACCESS private
 
 #endif // IT_ENABLE
 
-#endif
\ No newline at end of file
+#endif
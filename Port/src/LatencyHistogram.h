@@ -0,0 +1,128 @@
+#ifndef _LATENCY_HISTOGRAM_H
+#define _LATENCY_HISTOGRAM_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/// @brief A log-linear histogram of durations in nanoseconds. Each power of 2 
+/// range is split into 8 buckets so percentiles are within 12.5%. Record() is 
+/// called by a single thread. Reads and Reset() are safe from any thread and 
+/// see an approximate snapshot.
+class LatencyHistogram
+{
+public:
+	static const int SUB_BITS = 3;
+	static const int SUB_BUCKETS = 1 << SUB_BITS;
+	static const int BUCKETS = (64 - SUB_BITS + 1) * SUB_BUCKETS;
+
+	/// Constructor
+	LatencyHistogram() { Reset(); }
+
+	/// Copy constructor. Copies an approximate snapshot of the other histogram.
+	LatencyHistogram(const LatencyHistogram& other) { Reset(); Merge(other); }
+
+	/// Assignment. Copies an approximate snapshot of the other histogram.
+	LatencyHistogram& operator=(const LatencyHistogram& other)
+	{
+		if (this != &other)
+		{
+			Reset();
+			Merge(other);
+		}
+		return *this;
+	}
+
+	/// Record a duration. Called by the owning thread only.
+	/// @param[in] duration - the duration to record
+	void Record(std::chrono::nanoseconds duration)
+	{
+		uint64_t value = duration.count() > 0 ? (uint64_t)duration.count() : 0;
+		std::atomic<uint64_t>& bucket = m_buckets[BucketIndex(value)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		m_count.store(m_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	/// Get the number of recorded durations
+	/// @return The sample count.
+	uint64_t GetCount() const { return m_count.load(std::memory_order_relaxed); }
+
+	/// Get a percentile of the recorded durations
+	/// @param[in] percentile - the percentile from 0 to 100, e.g. 99.9
+	/// @return The upper bound of the bucket holding the percentile, or 0 if empty.
+	std::chrono::nanoseconds GetPercentile(double percentile) const
+	{
+		uint64_t total = 0;
+		for (const auto& bucket : m_buckets)
+			total += bucket.load(std::memory_order_relaxed);
+		if (total == 0)
+			return std::chrono::nanoseconds(0);
+
+		uint64_t rank = (uint64_t)(percentile / 100.0 * (double)total);
+		if (rank >= total)
+			rank = total - 1;
+
+		uint64_t seen = 0;
+		for (int i = 0; i < BUCKETS; i++)
+		{
+			seen += m_buckets[i].load(std::memory_order_relaxed);
+			if (seen > rank)
+				return std::chrono::nanoseconds((int64_t)BucketUpperBound(i));
+		}
+		return std::chrono::nanoseconds((int64_t)BucketUpperBound(BUCKETS - 1));
+	}
+
+	/// Add the durations recorded by another histogram. Called by the owning 
+	/// thread only.
+	/// @param[in] other - the histogram to add
+	void Merge(const LatencyHistogram& other)
+	{
+		for (int i = 0; i < BUCKETS; i++)
+		{
+			uint64_t count = other.m_buckets[i].load(std::memory_order_relaxed);
+			m_buckets[i].store(m_buckets[i].load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+		}
+		m_count.store(m_count.load(std::memory_order_relaxed) + other.GetCount(), std::memory_order_relaxed);
+	}
+
+	/// Clear all recorded durations
+	void Reset()
+	{
+		for (auto& bucket : m_buckets)
+			bucket.store(0, std::memory_order_relaxed);
+		m_count.store(0, std::memory_order_relaxed);
+	}
+
+private:
+	static int HighestBit(uint64_t value)
+	{
+		int bit = 0;
+		while (value >>= 1)
+			bit++;
+		return bit;
+	}
+
+	static int BucketIndex(uint64_t value)
+	{
+		if (value < SUB_BUCKETS)
+			return (int)value;
+		int exponent = HighestBit(value);
+		int sub = (int)((value >> (exponent - SUB_BITS)) & (SUB_BUCKETS - 1));
+		return (exponent - SUB_BITS + 1) * SUB_BUCKETS + sub;
+	}
+
+	static uint64_t BucketUpperBound(int index)
+	{
+		if (index < SUB_BUCKETS)
+			return (uint64_t)index;
+		int exponent = index / SUB_BUCKETS + SUB_BITS - 1;
+		uint64_t sub = (uint64_t)(index % SUB_BUCKETS);
+		int shift = exponent - SUB_BITS;
+		return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+	}
+
+	std::atomic<uint64_t> m_buckets[BUCKETS];
+	std::atomic<uint64_t> m_count;
+};
+
+#endif
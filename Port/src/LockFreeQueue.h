@@ -0,0 +1,202 @@
+#ifndef _LOCK_FREE_QUEUE_H
+#define _LOCK_FREE_QUEUE_H
+
+#include "CacheLine.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <stdexcept>
+
+/// @brief A bounded lock-free ring queue for multiple producers and a single consumer.
+/// 
+/// @details Each ring cell carries a sequence number used to hand the cell between 
+/// producers and the consumer without a lock (D. Vyukov bounded queue algorithm). The 
+/// algorithm is safe for multiple consumers which allows a producer to discard the 
+/// oldest element when the OverflowPolicy::DROP_OLDEST policy is selected. Counters 
+/// record the number of dropped elements and the peak queue depth.
+/// @tparam T The element type. Must be default constructible and move assignable.
+template <class T>
+class LockFreeQueue
+{
+public:
+	/// Action taken by Push() when the queue is full
+	enum class OverflowPolicy
+	{
+		BLOCK,			///< Wait until the consumer frees a cell
+		DROP_NEWEST,	///< Discard the element being pushed
+		DROP_OLDEST		///< Discard the oldest queued element to make room
+	};
+
+	/// Constructor
+	/// @param[in] capacity - the maximum number of queued elements. Must be a power of 2.
+	/// @param[in] policy - the overflow policy
+	explicit LockFreeQueue(size_t capacity, OverflowPolicy policy = OverflowPolicy::BLOCK) :
+		m_cells(new Cell[capacity]), m_mask(capacity - 1), m_policy(policy)
+	{
+		if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+			throw std::invalid_argument("Capacity must be a power of 2");
+
+		for (size_t i = 0; i < capacity; i++)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/// Push an element applying the overflow policy when the queue is full. 
+	/// Safe to call from any thread.
+	/// @param[in] value - the element to push
+	/// @return True if the element was queued. False if dropped.
+	bool Push(T&& value)
+	{
+		while (!TryPush(std::move(value)))
+		{
+			switch (m_policy.load(std::memory_order_relaxed))
+			{
+				case OverflowPolicy::DROP_NEWEST:
+					m_dropCount.fetch_add(1, std::memory_order_relaxed);
+					return false;
+
+				case OverflowPolicy::DROP_OLDEST:
+				{
+					T oldest;
+					if (TryPop(oldest))
+						m_dropCount.fetch_add(1, std::memory_order_relaxed);
+					break;
+				}
+
+				case OverflowPolicy::BLOCK:
+				default:
+					std::this_thread::yield();
+					break;
+			}
+		}
+		return true;
+	}
+
+	/// Push an element if a cell is free. Safe to call from any thread.
+	/// @param[in] value - the element to push. Unchanged if the queue is full.
+	/// @return True if the element was queued. False if the queue is full.
+	bool TryPush(T&& value)
+	{
+		size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &m_cells[pos & m_mask];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+			if (diff == 0)
+			{
+				if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;	// Queue is full
+			else
+				pos = m_enqueuePos.load(std::memory_order_relaxed);
+		}
+
+		cell->data = std::move(value);
+		cell->sequence.store(pos + 1, std::memory_order_release);
+		UpdatePeakDepth(pos + 1);
+		return true;
+	}
+
+	/// Pop the oldest element. Called by the consumer thread.
+	/// @param[out] value - the popped element
+	/// @return True if an element was popped. False if the queue is empty.
+	bool TryPop(T& value)
+	{
+		size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &m_cells[pos & m_mask];
+			size_t seq = cell->sequence.load(std::memory_order_acquire);
+			intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+			if (diff == 0)
+			{
+				if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (diff < 0)
+				return false;	// Queue is empty
+			else
+				pos = m_dequeuePos.load(std::memory_order_relaxed);
+		}
+
+		value = std::move(cell->data);
+		cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Check if the queue is empty
+	/// @return True if no element is ready to pop.
+	bool Empty() const
+	{
+		size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+		size_t seq = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+		return (intptr_t)seq - (intptr_t)(pos + 1) < 0;
+	}
+
+	/// Get the approximate number of queued elements
+	/// @return The queue depth.
+	size_t Size() const
+	{
+		size_t enqueuePos = m_enqueuePos.load(std::memory_order_relaxed);
+		size_t dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+		return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+	}
+
+	/// Get the queue capacity
+	/// @return The maximum number of queued elements.
+	size_t Capacity() const { return m_mask + 1; }
+
+	/// Set the overflow policy. Safe to call from any thread.
+	/// @param[in] policy - the overflow policy
+	void SetOverflowPolicy(OverflowPolicy policy) { m_policy.store(policy, std::memory_order_relaxed); }
+
+	/// Get the overflow policy
+	/// @return The overflow policy.
+	OverflowPolicy GetOverflowPolicy() const { return m_policy.load(std::memory_order_relaxed); }
+
+	/// Get the number of elements dropped due to overflow
+	/// @return The drop count.
+	uint64_t GetDropCount() const { return m_dropCount.load(std::memory_order_relaxed); }
+
+	/// Get the peak queue depth observed
+	/// @return The peak depth.
+	size_t GetPeakDepth() const { return m_peakDepth.load(std::memory_order_relaxed); }
+
+private:
+	LockFreeQueue(const LockFreeQueue&) = delete;
+	LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T data;
+	};
+
+	/// Record the queue depth after an element is pushed at position enqueueEnd
+	void UpdatePeakDepth(size_t enqueueEnd)
+	{
+		size_t dequeuePos = m_dequeuePos.load(std::memory_order_relaxed);
+		size_t depth = enqueueEnd > dequeuePos ? enqueueEnd - dequeuePos : 0;
+		size_t peak = m_peakDepth.load(std::memory_order_relaxed);
+		while (depth > peak && !m_peakDepth.compare_exchange_weak(peak, depth, std::memory_order_relaxed)) { }
+	}
+
+	std::unique_ptr<Cell[]> m_cells;
+	const size_t m_mask;
+	std::atomic<OverflowPolicy> m_policy;
+
+	/// Written by producers
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_enqueuePos{ 0 };
+	std::atomic<uint64_t> m_dropCount{ 0 };
+	std::atomic<size_t> m_peakDepth{ 0 };
+
+	/// Written by the consumer
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_dequeuePos{ 0 };
+};
+
+#endif
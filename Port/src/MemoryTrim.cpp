@@ -0,0 +1,16 @@
+#include "MemoryTrim.h"
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+//----------------------------------------------------------------------------
+// ReleaseFreeMemory
+//----------------------------------------------------------------------------
+void ReleaseFreeMemory()
+{
+#if defined(__GLIBC__)
+	// Releases free pages within the heap, not only at its top, with madvise()
+	malloc_trim(0);
+#endif
+}
@@ -0,0 +1,28 @@
+#ifndef _MEMORY_TRIM_H
+#define _MEMORY_TRIM_H
+
+#include <chrono>
+#include <cstddef>
+
+/// @brief When a thread returns the memory it kept after a burst. Queues, log
+/// buffers and arenas keep their peak capacity so a steady load never
+/// allocates. A thread idle for the quiet period releases what exceeds the
+/// low-water marks, then returns free heap memory to the operating system, so
+/// a long-running process settles back to a small resident set.
+struct TrimPolicy
+{
+	/// Idle time after which memory is trimmed, or zero to never trim
+	std::chrono::milliseconds quietPeriod = std::chrono::milliseconds(0);
+
+	/// Slots kept by each message queue
+	size_t queueLowWater = 64;
+
+	/// Bytes kept by each buffer or arena
+	size_t bufferLowWater = 64 * 1024;
+};
+
+/// Return free heap memory to the operating system, malloc_trim() on glibc.
+/// Does nothing elsewhere.
+void ReleaseFreeMemory();
+
+#endif
@@ -0,0 +1,48 @@
+#include "MetricsExporter.h"
+
+using namespace DelegateLib;
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+MetricsExporter::MetricsExporter() : 
+	m_thread("MetricsExporterThread"), m_timer(m_thread.GetTimers())
+{
+	m_timer.Expired = MakeDelegate(this, &MetricsExporter::Export);
+}
+
+//------------------------------------------------------------------------------
+// Start
+//------------------------------------------------------------------------------
+void MetricsExporter::Start(std::chrono::milliseconds interval, ExportFunction exportFunction)
+{
+	Stop();
+
+	// Set before the thread is created so the timer callback never races it
+	m_export = std::move(exportFunction);
+	m_thread.CreateThread();
+	m_timer.Start(interval);
+	m_running = true;
+}
+
+//------------------------------------------------------------------------------
+// Stop
+//------------------------------------------------------------------------------
+void MetricsExporter::Stop()
+{
+	if (!m_running)
+		return;
+
+	m_timer.Stop();
+	m_thread.ExitThread();
+	m_running = false;
+}
+
+//------------------------------------------------------------------------------
+// Export
+//------------------------------------------------------------------------------
+void MetricsExporter::Export()
+{
+	if (m_export)
+		m_export(Metrics::Snapshot());
+}
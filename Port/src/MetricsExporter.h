@@ -0,0 +1,51 @@
+#ifndef _METRICS_EXPORTER_H
+#define _METRICS_EXPORTER_H
+
+#include "Metrics.h"
+#include "Timer.h"
+#include "WorkerThreadStd.h"
+#include <chrono>
+#include <functional>
+#include <vector>
+
+/// @brief Takes a metrics registry snapshot periodically on its own WorkerThread 
+/// and passes it to an export function, e.g. one writing Metrics::WriteText() to 
+/// a file or socket. Snapshots never run on the threads publishing the metrics.
+class MetricsExporter
+{
+public:
+	/// Called on the exporter thread with each snapshot
+	typedef std::function<void(const std::vector<DelegateLib::MetricSample>&)> ExportFunction;
+
+	/// Constructor
+	MetricsExporter();
+
+	/// Destructor
+	~MetricsExporter() { Stop(); }
+
+	/// Create the exporter thread and export a snapshot every interval. Restarts
+	/// the exporter if already running.
+	/// @param[in] interval - the time between snapshots
+	/// @param[in] exportFunction - the function receiving each snapshot
+	void Start(std::chrono::milliseconds interval, ExportFunction exportFunction);
+
+	/// Stop exporting and exit the exporter thread
+	void Stop();
+
+	/// Check if the exporter is running
+	bool IsRunning() const { return m_running; }
+
+private:
+	MetricsExporter(const MetricsExporter&) = delete;
+	MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+	/// Called by the timer on the exporter thread
+	void Export();
+
+	WorkerThread m_thread;
+	Timer m_timer;
+	ExportFunction m_export;
+	bool m_running = false;
+};
+
+#endif
@@ -0,0 +1,374 @@
+#include "ReactorThread.h"
+
+#ifdef __linux__
+
+#include "Fault.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "Clock.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <vector>
+
+using namespace std;
+using namespace DelegateLib;
+
+// epoll keys of the eventfd and the timerfd. Handler keys start at 1.
+static const uint64_t EVENT_KEY = 0;
+static const uint64_t TIMER_KEY = UINT64_MAX;
+
+// Maximum events taken per epoll_wait()
+static const int MAX_EVENTS = 64;
+
+// The ReactorThread instance running on the current thread, if any
+static thread_local const ReactorThread* currentReactor = nullptr;
+
+//----------------------------------------------------------------------------
+// ToEpoll
+//----------------------------------------------------------------------------
+static uint32_t ToEpoll(uint32_t events)
+{
+	uint32_t epollEvents = 0;
+	if (events & ReactorThread::READABLE)
+		epollEvents |= EPOLLIN;
+	if (events & ReactorThread::WRITABLE)
+		epollEvents |= EPOLLOUT;
+	return epollEvents;
+}
+
+//----------------------------------------------------------------------------
+// FromEpoll
+//----------------------------------------------------------------------------
+static uint32_t FromEpoll(uint32_t epollEvents)
+{
+	uint32_t events = 0;
+	if (epollEvents & EPOLLIN)
+		events |= ReactorThread::READABLE;
+	if (epollEvents & EPOLLOUT)
+		events |= ReactorThread::WRITABLE;
+	if (epollEvents & (EPOLLHUP | EPOLLERR | EPOLLRDHUP))
+		events |= ReactorThread::CLOSED;
+	return events;
+}
+
+//----------------------------------------------------------------------------
+// ReactorThread
+//----------------------------------------------------------------------------
+ReactorThread::ReactorThread(const std::string& threadName, const ThreadAttributes& attributes) :
+	THREAD_NAME(threadName), m_attributes(attributes), m_inlineCalls(false)
+{
+	m_epoll = epoll_create1(EPOLL_CLOEXEC);
+	m_event = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	m_timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (m_epoll >= 0 && m_event >= 0 && m_timer >= 0)
+	{
+		epoll_event ev = {};
+		ev.events = EPOLLIN;
+		ev.data.u64 = EVENT_KEY;
+		epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_event, &ev);
+		ev.data.u64 = TIMER_KEY;
+		epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_timer, &ev);
+	}
+
+	// Reprogram the timerfd when a timer is started earlier or the clock advances
+	m_timers.SetStartedHook(&ReactorThread::WakeTimers, this);
+	Clock::AddAdvancedHook(&ReactorThread::WakeTimers, this);
+}
+
+//----------------------------------------------------------------------------
+// ~ReactorThread
+//----------------------------------------------------------------------------
+ReactorThread::~ReactorThread()
+{
+	ExitThread();
+	Clock::RemoveAdvancedHook(&ReactorThread::WakeTimers, this);
+	m_timers.SetStartedHook(nullptr, nullptr);
+	if (m_timer >= 0)
+		close(m_timer);
+	if (m_event >= 0)
+		close(m_event);
+	if (m_epoll >= 0)
+		close(m_epoll);
+}
+
+//----------------------------------------------------------------------------
+// CreateThread
+//----------------------------------------------------------------------------
+bool ReactorThread::CreateThread()
+{
+	if (m_epoll < 0 || m_event < 0 || m_timer < 0)
+		return false;
+	if (!m_thread)
+		m_thread = StartThread(m_attributes, &ReactorThread::Process, this);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// ExitThread
+//----------------------------------------------------------------------------
+void ReactorThread::ExitThread()
+{
+	if (!m_thread)
+		return;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	Wake();
+	m_thread->join();
+	m_thread.reset();
+
+	lock_guard<mutex> lock(m_mutex);
+	m_exit = false;
+}
+
+//----------------------------------------------------------------------------
+// Add
+//----------------------------------------------------------------------------
+bool ReactorThread::Add(int fd, uint32_t events, IoCallback callback)
+{
+	lock_guard<mutex> lock(m_handlersLock);
+	if (m_epoll < 0 || m_keys.count(fd))
+		return false;
+
+	uint64_t key = m_nextKey++;
+	epoll_event ev = {};
+	ev.events = ToEpoll(events) | EPOLLRDHUP;
+	ev.data.u64 = key;
+	if (epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev) != 0)
+		return false;
+
+	m_handlers[key] = make_shared<Handler>(Handler{ fd, std::move(callback) });
+	m_keys[fd] = key;
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Modify
+//----------------------------------------------------------------------------
+bool ReactorThread::Modify(int fd, uint32_t events)
+{
+	lock_guard<mutex> lock(m_handlersLock);
+	auto it = m_keys.find(fd);
+	if (it == m_keys.end())
+		return false;
+
+	epoll_event ev = {};
+	ev.events = ToEpoll(events) | EPOLLRDHUP;
+	ev.data.u64 = it->second;
+	return epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+//----------------------------------------------------------------------------
+// Remove
+//----------------------------------------------------------------------------
+bool ReactorThread::Remove(int fd)
+{
+	lock_guard<mutex> lock(m_handlersLock);
+	auto it = m_keys.find(fd);
+	if (it == m_keys.end())
+		return false;
+
+	// The file descriptor may already be closed, so a failure is not an error
+	epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+	m_handlers.erase(it->second);
+	m_keys.erase(it);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// GetQueueSize
+//----------------------------------------------------------------------------
+size_t ReactorThread::GetQueueSize()
+{
+	lock_guard<mutex> lock(m_mutex);
+	return m_queue.size();
+}
+
+//----------------------------------------------------------------------------
+// IsInlineCall
+//----------------------------------------------------------------------------
+bool ReactorThread::IsInlineCall() const
+{
+	return m_inlineCalls.load(std::memory_order_relaxed) && currentReactor == this;
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void ReactorThread::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	DispatchDelegates(&msg, 1);
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegates
+//----------------------------------------------------------------------------
+void ReactorThread::DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count)
+{
+	if (count == 0)
+		return;
+
+	bool wasEmpty;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		wasEmpty = m_queue.empty();
+		for (size_t i = 0; i < count; i++)
+			m_queue.push_back(std::move(msgs[i]));
+	}
+
+	// The thread drains the whole queue per wakeup, so only the first message
+	// of a drain writes the eventfd
+	if (wasEmpty)
+		Wake();
+}
+
+//----------------------------------------------------------------------------
+// Wake
+//----------------------------------------------------------------------------
+void ReactorThread::Wake()
+{
+	uint64_t one = 1;
+	ssize_t written;
+	do
+	{
+		written = write(m_event, &one, sizeof(one));
+	} while (written < 0 && errno == EINTR);
+}
+
+//----------------------------------------------------------------------------
+// WakeTimers
+//----------------------------------------------------------------------------
+void ReactorThread::WakeTimers(void* context)
+{
+	static_cast<ReactorThread*>(context)->Wake();
+}
+
+//----------------------------------------------------------------------------
+// ServiceTimers
+//----------------------------------------------------------------------------
+void ReactorThread::ServiceTimers()
+{
+	m_timerGeneration = m_timers.GetGeneration();
+	m_clockAdvances = Clock::GetAdvances();
+	m_timers.ProcessTimers();
+
+	// A zero it_value disarms the timerfd, so a timer already due fires in 1 us.
+	// While a virtual clock is installed its advances wake the thread instead.
+	itimerspec spec = {};
+	std::chrono::microseconds next;
+	if (m_timers.GetNextExpiration(next) && !Clock::IsVirtual())
+	{
+		auto delay = std::max(next - Timer::GetTime(), std::chrono::microseconds(1));
+		spec.it_value.tv_sec = (time_t)(delay.count() / 1000000);
+		spec.it_value.tv_nsec = (long)(delay.count() % 1000000 * 1000);
+	}
+	timerfd_settime(m_timer, 0, &spec, nullptr);
+}
+
+//----------------------------------------------------------------------------
+// InvokeQueued
+//----------------------------------------------------------------------------
+void ReactorThread::InvokeQueued()
+{
+	std::deque<std::shared_ptr<DelegateMsg>> queue;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		queue.swap(m_queue);
+	}
+
+	static MetricCounter& invokedMetric = Metrics::GetCounter("reactorthread.invoked");
+	for (auto& msg : queue)
+	{
+		// Discard a message cancelled or stale by the time the thread takes it
+		if (msg->IsCancelled())
+			continue;
+		auto deadline = msg->GetDeadline();
+		if (deadline != std::chrono::steady_clock::time_point::max() &&
+			std::chrono::steady_clock::now() > deadline)
+			continue;
+
+		TRACE_SCOPE("ReactorThread::Invoke");
+		invokedMetric.Add();
+		auto invoker = msg->GetDelegateInvoker();
+		ASSERT_TRUE(invoker);
+		DelegateLib::TraceContextScope traceScope(msg->GetTraceContext());
+		bool success = invoker->Invoke(msg);
+		ASSERT_TRUE(success);
+	}
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void ReactorThread::Process()
+{
+	TRACE_THREAD_NAME(THREAD_NAME);
+	currentReactor = this;
+
+	epoll_event events[MAX_EVENTS];
+	while (1)
+	{
+		int count = epoll_wait(m_epoll, events, MAX_EVENTS, -1);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+
+		bool queued = false;
+		bool timerDue = false;
+		for (int i = 0; i < count; i++)
+		{
+			if (events[i].data.u64 == EVENT_KEY)
+			{
+				queued = true;
+				continue;
+			}
+			if (events[i].data.u64 == TIMER_KEY)
+			{
+				uint64_t expirations;
+				while (read(m_timer, &expirations, sizeof(expirations)) < 0 && errno == EINTR)
+					;
+				timerDue = true;
+				continue;
+			}
+
+			// Look up each handler just before its callback so one removed by
+			// an earlier callback of the batch is not invoked
+			shared_ptr<Handler> handler;
+			{
+				lock_guard<mutex> lock(m_handlersLock);
+				auto it = m_handlers.find(events[i].data.u64);
+				if (it != m_handlers.end())
+					handler = it->second;
+			}
+			if (handler && handler->callback)
+				handler->callback(handler->fd, FromEpoll(events[i].events));
+		}
+
+		if (queued)
+		{
+			// Reset the eventfd before draining so a later dispatch wakes the thread again
+			uint64_t value;
+			while (read(m_event, &value, sizeof(value)) < 0 && errno == EINTR)
+				;
+			InvokeQueued();
+
+			lock_guard<mutex> lock(m_mutex);
+			if (m_exit && m_queue.empty())
+				break;
+		}
+
+		if (timerDue || m_timers.GetGeneration() != m_timerGeneration || 
+			Clock::GetAdvances() != m_clockAdvances)
+			ServiceTimers();
+	}
+}
+
+#endif // __linux__
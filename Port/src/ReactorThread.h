@@ -0,0 +1,177 @@
+#ifndef _REACTOR_THREAD_H
+#define _REACTOR_THREAD_H
+
+/// @file
+/// @brief A delegate thread that also waits on file descriptors. Linux only.
+///
+/// @details ReactorThread blocks in one epoll_wait() for both file descriptor
+/// readiness and delegate messages. Dispatched messages are queued under a mutex
+/// and an eventfd registered with the epoll set wakes the thread, written only
+/// when the queue becomes non-empty. I/O callbacks and async delegates thus run on
+/// the same thread without a handoff between a delegate thread and an I/O thread.
+/// Readiness is level triggered.
+///
+/// The timers of GetTimers() expire on the reactor thread too. A timerfd in the
+/// same epoll set is programmed to the next expiration, so timers wake the thread
+/// on time with no polling and no timer thread.
+
+#ifdef __linux__
+
+#include "DelegateThread.h"
+#include "ThreadAttributes.h"
+#include "Timer.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+class ReactorThread : public DelegateLib::DelegateThread
+{
+public:
+	/// Readiness events of a file descriptor
+	static const uint32_t READABLE = 0x1;
+	static const uint32_t WRITABLE = 0x2;
+
+	/// Reported with the requested events when the peer hung up or the file
+	/// descriptor has an error. Always watched.
+	static const uint32_t CLOSED = 0x4;
+
+	/// Called on the reactor thread when a file descriptor is ready
+	/// @param[in] fd - the file descriptor
+	/// @param[in] events - the ready events
+	typedef std::function<void(int fd, uint32_t events)> IoCallback;
+
+	/// Constructor
+	/// @param[in] threadName - the thread name
+	/// @param[in] attributes - the CPU affinity, scheduling and stack size
+	///		applied when the thread is created
+	explicit ReactorThread(const std::string& threadName, const ThreadAttributes& attributes = ThreadAttributes());
+
+	/// Destructor
+	~ReactorThread();
+
+	/// Called once to create the reactor thread
+	/// @return True if the thread is created.
+	bool CreateThread();
+
+	/// Called once at program exit to exit the reactor thread. Queued delegates
+	/// are invoked before the thread exits. Watched file descriptors are not closed.
+	void ExitThread();
+
+	/// Get thread name
+	std::string GetThreadName() { return THREAD_NAME; }
+
+	/// Watch a file descriptor. Function call is thread-safe.
+	/// @param[in] fd - the file descriptor. Not owned.
+	/// @param[in] events - READABLE and/or WRITABLE
+	/// @param[in] callback - called on the reactor thread while the file
+	///		descriptor is ready
+	/// @return True if success. False if already watched or epoll rejects it.
+	bool Add(int fd, uint32_t events, IoCallback callback);
+
+	/// Change the events watched for a file descriptor. Function call is thread-safe.
+	/// @param[in] fd - the watched file descriptor
+	/// @param[in] events - READABLE and/or WRITABLE
+	/// @return True if success.
+	bool Modify(int fd, uint32_t events);
+
+	/// Stop watching a file descriptor. Function call is thread-safe. Called on
+	/// the reactor thread, e.g. from a callback, no further callback for the file
+	/// descriptor is invoked. Called on another thread, a callback already
+	/// running or about to run may complete after the call returns.
+	/// @param[in] fd - the watched file descriptor
+	/// @return True if the file descriptor was watched.
+	bool Remove(int fd);
+
+	/// Get the number of queued delegate messages
+	size_t GetQueueSize();
+
+	/// Get the timers serviced by this thread. Expired callbacks run on the
+	/// reactor thread.
+	TimerSet& GetTimers() { return m_timers; }
+
+	/// Invoke async and async wait delegates called from this thread directly
+	/// instead of dispatching them. See WorkerThread::SetInlineCalls().
+	/// @param[in] enable - true to invoke same-thread calls inline
+	void SetInlineCalls(bool enable) { m_inlineCalls.store(enable, std::memory_order_relaxed); }
+
+	/// Check if a delegate call targeting this thread is invoked inline
+	/// @return True if inline calls are enabled and the caller runs on this thread.
+	virtual bool IsInlineCall() const;
+
+	/// Queue a delegate message and wake the thread
+	/// @param[in] msg - the delegate message
+	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg);
+
+	/// Queue several delegate messages with one lock and a single wakeup
+	/// @param[in] msgs - the delegate messages. The messages are moved from.
+	/// @param[in] count - the number of messages
+	virtual void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count);
+
+private:
+	ReactorThread(const ReactorThread&) = delete;
+	ReactorThread& operator=(const ReactorThread&) = delete;
+
+	/// A watched file descriptor
+	struct Handler
+	{
+		int fd;
+		IoCallback callback;
+	};
+
+	/// Entry point for the thread
+	void Process();
+
+	/// Invoke the queued delegate messages
+	void InvokeQueued();
+
+	/// Write the eventfd so epoll_wait() returns
+	void Wake();
+
+	/// Expire the timers due and program the timerfd to the next service time
+	void ServiceTimers();
+
+	/// Wake the thread after a timer is started or the clock advances
+	static void WakeTimers(void* context);
+
+	const std::string THREAD_NAME;
+	const ThreadAttributes m_attributes;
+	std::unique_ptr<std::thread> m_thread;
+
+	/// epoll set, the eventfd signaling queued messages or exit and the timerfd
+	/// expiring at the next timer service time
+	int m_epoll = -1;
+	int m_event = -1;
+	int m_timer = -1;
+
+	/// Timers serviced by the thread, and the timer generation and clock
+	/// advances the timerfd was last programmed for. Only read by the thread.
+	TimerSet m_timers;
+	uint64_t m_timerGeneration = 0;
+	uint64_t m_clockAdvances = 0;
+
+	/// Queued messages and the exit request. Protected by m_mutex.
+	std::mutex m_mutex;
+	std::deque<std::shared_ptr<DelegateLib::DelegateMsg>> m_queue;
+	bool m_exit = false;
+
+	/// Watched file descriptors. An epoll event carries the handler key rather
+	/// than the file descriptor, so a stale event of a removed and reused file
+	/// descriptor finds no handler. Protected by m_handlersLock.
+	std::mutex m_handlersLock;
+	std::unordered_map<uint64_t, std::shared_ptr<Handler>> m_handlers;
+	std::unordered_map<int, uint64_t> m_keys;
+	uint64_t m_nextKey = 1;
+
+	/// Set by SetInlineCalls()
+	std::atomic<bool> m_inlineCalls;
+};
+
+#endif // __linux__
+
+#endif
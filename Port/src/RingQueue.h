@@ -0,0 +1,116 @@
+#ifndef _RING_QUEUE_H
+#define _RING_QUEUE_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+/// @brief A FIFO queue of values held in a power of 2 sized circular buffer.
+/// The buffer doubles when full and is never shrunk, so a queue reserved to its
+/// working depth, or one that has reached it, no longer allocates. Limiting the
+/// depth is left to the owner, which checks size() before push(). RingQueue is
+/// not thread-safe.
+template <typename T>
+class RingQueue
+{
+public:
+	/// Capacity allocated by the first push() into an unreserved queue
+	static const size_t INITIAL_CAPACITY = 64;
+
+	bool empty() const { return m_size == 0; }
+	size_t size() const { return m_size; }
+
+	/// Get the number of values held without allocating
+	size_t capacity() const { return m_buffer.size(); }
+
+	/// Allocate the buffer up front. The capacity is rounded up to a power of 2
+	/// and is never reduced.
+	/// @param[in] capacity - the number of values to hold without allocating
+	void Reserve(size_t capacity)
+	{
+		size_t rounded = m_buffer.empty() ? 1 : m_buffer.size();
+		while (rounded < capacity)
+			rounded *= 2;
+		if (rounded > m_buffer.size())
+			Resize(rounded);
+	}
+
+	/// Release capacity above a low-water mark, keeping the values
+	/// @param[in] lowWater - the capacity kept, rounded up to a power of 2 and
+	///		to the values held. 0 frees the buffer of an empty queue.
+	void Shrink(size_t lowWater)
+	{
+		size_t keep = lowWater > m_size ? lowWater : m_size;
+		size_t rounded = keep ? 1 : 0;
+		while (rounded < keep)
+			rounded *= 2;
+		if (rounded < m_buffer.size())
+			Resize(rounded);
+	}
+
+	/// Get the oldest value. The queue must not be empty.
+	T& front() { return m_buffer[m_head]; }
+
+	/// Get a value by its position from the oldest
+	T& operator[](size_t index) { return m_buffer[(m_head + index) & (m_buffer.size() - 1)]; }
+	const T& operator[](size_t index) const { return m_buffer[(m_head + index) & (m_buffer.size() - 1)]; }
+
+	/// Add a value to the back of the queue
+	/// @param[in] value - the value to move into the queue
+	void push(T&& value)
+	{
+		if (m_size == m_buffer.size())
+			Resize(m_buffer.empty() ? INITIAL_CAPACITY : m_buffer.size() * 2);
+		m_buffer[(m_head + m_size) & (m_buffer.size() - 1)] = std::move(value);
+		m_size++;
+	}
+
+	/// Remove the oldest value. The queue must not be empty.
+	void pop()
+	{
+		// Release the value's resources now rather than when the slot is reused
+		m_buffer[m_head] = T();
+		m_head = (m_head + 1) & (m_buffer.size() - 1);
+		m_size--;
+	}
+
+	/// Remove every value keeping the buffer
+	void clear()
+	{
+		while (m_size)
+			pop();
+		m_head = 0;
+	}
+
+	void swap(RingQueue& other)
+	{
+		m_buffer.swap(other.m_buffer);
+		std::swap(m_head, other.m_head);
+		std::swap(m_size, other.m_size);
+	}
+
+private:
+	/// Move the values in order into a new buffer
+	/// @param[in] capacity - the new capacity, a power of 2 of at least size(), 
+	///		or 0 if empty
+	void Resize(size_t capacity)
+	{
+		std::vector<T> buffer(capacity);
+		for (size_t i = 0; i < m_size; i++)
+			buffer[i] = std::move((*this)[i]);
+		m_buffer.swap(buffer);
+		m_head = 0;
+	}
+
+	std::vector<T> m_buffer;
+	size_t m_head = 0;
+	size_t m_size = 0;
+};
+
+template <typename T>
+void swap(RingQueue<T>& a, RingQueue<T>& b)
+{
+	a.swap(b);
+}
+
+#endif
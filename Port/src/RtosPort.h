@@ -0,0 +1,229 @@
+#ifndef _RTOS_PORT_H
+#define _RTOS_PORT_H
+
+/// @file
+/// @brief Statically allocated task, mutex and semaphore for StaticWorkerThread.
+///
+/// @details Built with USE_FREERTOS defined, each primitive is created with the
+/// FreeRTOS static API, xTaskCreateStatic(), xSemaphoreCreateMutexStatic() and
+/// xSemaphoreCreateCountingStatic(), on storage held within the object, so
+/// creating one does not use the FreeRTOS heap and configSUPPORT_STATIC_ALLOCATION
+/// is required. Timeouts round up to whole ticks. Otherwise the primitives use
+/// std::thread and atomic words slept on with AtomicWait(), so the same code
+/// runs and is tested on the host.
+
+#include "AtomicWait.h"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(USE_FREERTOS)
+#include "FreeRTOS.h"
+#include "semphr.h"
+#include "task.h"
+#else
+#include <mutex>
+#include <thread>
+#endif
+
+namespace RtosPort {
+
+/// Wait without a time limit
+constexpr std::chrono::microseconds WAIT_FOREVER = std::chrono::microseconds::max();
+
+#if defined(USE_FREERTOS)
+/// Convert a timeout to ticks, rounding up
+inline TickType_t ToTicks(std::chrono::microseconds timeout)
+{
+	if (timeout == WAIT_FOREVER)
+		return portMAX_DELAY;
+	if (timeout.count() <= 0)
+		return 0;
+	return (TickType_t)((timeout.count() * configTICK_RATE_HZ + 999999) / 1000000);
+}
+#endif
+
+/// @brief A mutex. Meets BasicLockable, so std::lock_guard locks it.
+class Mutex
+{
+public:
+#if defined(USE_FREERTOS)
+	Mutex() { m_handle = xSemaphoreCreateMutexStatic(&m_storage); }
+	~Mutex() { vSemaphoreDelete(m_handle); }
+	void lock() { xSemaphoreTake(m_handle, portMAX_DELAY); }
+	void unlock() { xSemaphoreGive(m_handle); }
+#else
+	Mutex() = default;
+	void lock() { m_mutex.lock(); }
+	void unlock() { m_mutex.unlock(); }
+#endif
+
+private:
+	Mutex(const Mutex&) = delete;
+	Mutex& operator=(const Mutex&) = delete;
+
+#if defined(USE_FREERTOS)
+	StaticSemaphore_t m_storage;
+	SemaphoreHandle_t m_handle;
+#else
+	std::mutex m_mutex;
+#endif
+};
+
+/// @brief A counting semaphore
+class Semaphore
+{
+public:
+	/// Constructor
+	/// @param[in] initial - the initial count
+	/// @param[in] maximum - the highest count
+	Semaphore(uint32_t initial, uint32_t maximum)
+	{
+#if defined(USE_FREERTOS)
+		m_handle = xSemaphoreCreateCountingStatic(maximum, initial, &m_storage);
+#else
+		(void)maximum;
+		m_count.store(initial, std::memory_order_relaxed);
+#endif
+	}
+
+#if defined(USE_FREERTOS)
+	~Semaphore() { vSemaphoreDelete(m_handle); }
+#endif
+
+	/// Decrement the count, waiting while it is zero
+	/// @param[in] timeout - the longest time to wait, or WAIT_FOREVER
+	/// @return True if the count was decremented, false on timeout.
+	bool Take(std::chrono::microseconds timeout)
+	{
+#if defined(USE_FREERTOS)
+		return xSemaphoreTake(m_handle, ToTicks(timeout)) == pdTRUE;
+#else
+		const bool infinite = timeout == WAIT_FOREVER;
+		const auto deadline = infinite ? std::chrono::steady_clock::time_point::max() :
+			std::chrono::steady_clock::now() + timeout;
+		uint32_t count = m_count.load(std::memory_order_relaxed);
+		while (1)
+		{
+			if (count > 0)
+			{
+				if (m_count.compare_exchange_weak(count, count - 1, std::memory_order_acquire,
+					std::memory_order_relaxed))
+					return true;
+				continue;
+			}
+			std::chrono::nanoseconds remaining;
+			if (!infinite)
+			{
+				auto now = std::chrono::steady_clock::now();
+				if (now >= deadline)
+					return false;
+				remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+			}
+
+			// Pairs with Give() so either the count is seen or the sleeper is
+			m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+			if (m_count.load(std::memory_order_seq_cst) == 0)
+				DelegateLib::AtomicWait(m_count, 0, infinite ? nullptr : &remaining);
+			m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+			count = m_count.load(std::memory_order_relaxed);
+		}
+#endif
+	}
+
+	/// Increment the count, waking a waiting thread
+	void Give()
+	{
+#if defined(USE_FREERTOS)
+		xSemaphoreGive(m_handle);
+#else
+		m_count.fetch_add(1, std::memory_order_seq_cst);
+		if (m_sleepers.load(std::memory_order_seq_cst) != 0)
+			DelegateLib::AtomicWake(m_count, false);
+#endif
+	}
+
+private:
+	Semaphore(const Semaphore&) = delete;
+	Semaphore& operator=(const Semaphore&) = delete;
+
+#if defined(USE_FREERTOS)
+	StaticSemaphore_t m_storage;
+	SemaphoreHandle_t m_handle;
+#else
+	std::atomic<uint32_t> m_count{ 0 };
+	std::atomic<uint32_t> m_sleepers{ 0 };
+#endif
+};
+
+/// @brief A task on a stack held within the object
+/// @tparam StackWords The FreeRTOS stack depth in words. Unused on the host.
+template <size_t StackWords>
+class Task
+{
+public:
+	typedef void (*Entry)(void* context);
+
+	Task() = default;
+
+	/// Start the task
+	/// @param[in] name - the task name
+	/// @param[in] priority - the FreeRTOS task priority. Unused on the host.
+	/// @param[in] entry - the task entry point
+	/// @param[in] context - the argument passed to the entry point
+	/// @return True if the task started.
+	bool Start(const char* name, int priority, Entry entry, void* context)
+	{
+		m_entry = entry;
+		m_context = context;
+#if defined(USE_FREERTOS)
+		return xTaskCreateStatic(&Task::Run, name, StackWords, this, (UBaseType_t)priority,
+			m_stack, &m_storage) != nullptr;
+#else
+		(void)name;
+		(void)priority;
+		m_thread = std::thread([this]() { m_entry(m_context); });
+		return true;
+#endif
+	}
+
+	/// Wait for the task's entry point to return
+	void Join()
+	{
+#if defined(USE_FREERTOS)
+		m_exited.Take(WAIT_FOREVER);
+#else
+		if (m_thread.joinable())
+			m_thread.join();
+#endif
+	}
+
+private:
+	Task(const Task&) = delete;
+	Task& operator=(const Task&) = delete;
+
+	Entry m_entry = nullptr;
+	void* m_context = nullptr;
+
+#if defined(USE_FREERTOS)
+	/// A FreeRTOS task must not return, so it signals its exit and deletes itself
+	static void Run(void* param)
+	{
+		Task* task = static_cast<Task*>(param);
+		task->m_entry(task->m_context);
+		task->m_exited.Give();
+		vTaskDelete(nullptr);
+	}
+
+	StaticTask_t m_storage;
+	StackType_t m_stack[StackWords];
+	Semaphore m_exited{ 0, 1 };
+#else
+	std::thread m_thread;
+#endif
+};
+
+}
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef _SCHEDULED_QUEUE_H
+#define _SCHEDULED_QUEUE_H
+
+#include "DelegateMsg.h"
+#include "CacheLine.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/// @brief Delegate messages held by a thread until their due time. Messages are
+/// kept on a binary heap ordered on the due tick, with messages due on the same
+/// tick in scheduling order. The servicing thread waits until the earliest due
+/// tick, alongside its timers, so a scheduled message needs no Timer of its own
+/// and is not delayed by a polling tick. Ticks are the Timer::GetTime()
+/// microseconds. ScheduledQueue is thread safe.
+class ScheduledQueue
+{
+public:
+	/// Called after a message is scheduled earlier than every message held
+	typedef void (*ScheduledHook)(void* context);
+
+	/// Constructor
+	ScheduledQueue() = default;
+
+	/// Hold a message until a due tick
+	/// @param[in] msg - the message
+	/// @param[in] due - the due tick
+	void Push(std::shared_ptr<DelegateLib::DelegateMsg> msg, std::chrono::microseconds due)
+	{
+		ScheduledHook hook = nullptr;
+		void* context = nullptr;
+		{
+			const std::lock_guard<std::mutex> lock(m_lock);
+			bool earliest = m_heap.empty() || due < m_heap.front().due;
+			m_heap.push_back(Entry{ due, m_sequence++, std::move(msg) });
+			std::push_heap(m_heap.begin(), m_heap.end(), Later());
+			if (!earliest)
+				return;
+			m_generation.fetch_add(1, std::memory_order_release);
+			hook = m_scheduledHook;
+			context = m_scheduledContext;
+		}
+		if (hook)
+			hook(context);
+	}
+
+	/// Take the messages due by a tick, earliest first
+	/// @param[in] now - the current tick
+	/// @param[out] due - the due messages are appended
+	/// @return The number of messages taken.
+	size_t PopDue(std::chrono::microseconds now, std::vector<std::shared_ptr<DelegateLib::DelegateMsg>>& due)
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		size_t count = 0;
+		while (!m_heap.empty() && m_heap.front().due <= now)
+		{
+			std::pop_heap(m_heap.begin(), m_heap.end(), Later());
+			due.push_back(std::move(m_heap.back().msg));
+			m_heap.pop_back();
+			count++;
+		}
+		return count;
+	}
+
+	/// Get the earliest due tick
+	/// @param[out] time - the due tick
+	/// @return TRUE if a message is held, FALSE otherwise.
+	bool GetNextDue(std::chrono::microseconds& time)
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		if (m_heap.empty())
+			return false;
+		time = m_heap.front().due;
+		return true;
+	}
+
+	/// Get a count incremented each time a message is scheduled earlier than
+	/// every message held. The servicing thread recomputes its wait deadline
+	/// when the count changes.
+	/// @return The schedule count.
+	uint64_t GetGeneration() const { return m_generation.load(std::memory_order_acquire); }
+
+	/// Discard every message held
+	/// @return The number of messages discarded.
+	size_t Clear()
+	{
+		std::vector<Entry> discarded;
+		{
+			const std::lock_guard<std::mutex> lock(m_lock);
+			discarded.swap(m_heap);
+		}
+		return discarded.size();
+	}
+
+	/// Get the number of messages held
+	size_t Size()
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		return m_heap.size();
+	}
+
+	/// Set the function called after a message is scheduled earliest
+	/// @param[in] hook - the function to call, or nullptr for none
+	/// @param[in] context - the argument passed to the hook
+	void SetScheduledHook(ScheduledHook hook, void* context)
+	{
+		const std::lock_guard<std::mutex> lock(m_lock);
+		m_scheduledHook = hook;
+		m_scheduledContext = context;
+	}
+
+private:
+	ScheduledQueue(const ScheduledQueue&) = delete;
+	ScheduledQueue& operator=(const ScheduledQueue&) = delete;
+
+	struct Entry
+	{
+		std::chrono::microseconds due;
+		uint64_t sequence;
+		std::shared_ptr<DelegateLib::DelegateMsg> msg;
+	};
+
+	/// Heap order placing the earliest due, then earliest scheduled, entry first
+	struct Later
+	{
+		bool operator()(const Entry& a, const Entry& b) const
+		{
+			return a.due != b.due ? a.due > b.due : a.sequence > b.sequence;
+		}
+	};
+
+	/// A lock to make this class thread safe.
+	std::mutex m_lock;
+
+	/// Messages held. Protected by m_lock.
+	std::vector<Entry> m_heap;
+	uint64_t m_sequence = 0;
+	ScheduledHook m_scheduledHook = nullptr;
+	void* m_scheduledContext = nullptr;
+
+	/// Polled by the servicing thread without m_lock
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_generation{ 0 };
+};
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef _SCRATCH_ARENA_H
+#define _SCRATCH_ARENA_H
+
+/// @file
+/// @brief Bump allocator for short-lived temporaries of one message handler.
+///
+/// @details A ScratchArena hands out memory by advancing an offset within a
+/// block, so an allocation costs a few instructions and a free costs nothing.
+/// Reset() releases every allocation at once and keeps the blocks, so once the
+/// arena has grown to a handler's peak use it no longer touches the heap. Each
+/// WorkerThread owns an arena reset after every delegate it invokes, see
+/// WorkerThread::GetScratchArena(). ScratchArena is not thread-safe.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+class ScratchArena
+{
+public:
+	/// Default size of each block taken from the heap
+	static const size_t DEFAULT_BLOCK_SIZE = 16 * 1024;
+
+	/// Constructor. No memory is allocated until the first Allocate().
+	/// @param[in] blockSize - the size of each block taken from the heap. Larger
+	///		allocations get a block of their own.
+	explicit ScratchArena(size_t blockSize = DEFAULT_BLOCK_SIZE) : m_blockSize(blockSize) {}
+
+	/// Allocate uninitialized memory valid until the next Reset()
+	/// @param[in] size - the number of bytes
+	/// @param[in] align - the alignment, a power of 2
+	/// @return The memory.
+	/// @throws std::bad_alloc If the heap is exhausted.
+	void* Allocate(size_t size, size_t align = alignof(std::max_align_t))
+	{
+		if (m_block < m_blocks.size())
+		{
+			Block& block = m_blocks[m_block];
+			uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+			size_t offset = ((base + m_offset + align - 1) & ~(uintptr_t)(align - 1)) - base;
+			if (offset + size <= block.size)
+			{
+				m_offset = offset + size;
+				m_used += size;
+				return block.data.get() + offset;
+			}
+		}
+		return AllocateSlow(size, align);
+	}
+
+	/// Release every allocation. The blocks are kept for reuse.
+	void Reset()
+	{
+		m_block = 0;
+		m_offset = 0;
+		m_used = 0;
+	}
+
+	/// Free blocks beyond a number of bytes. Call after Reset().
+	/// @param[in] keepBytes - the bytes of blocks kept, counted from the first
+	void Trim(size_t keepBytes)
+	{
+		size_t kept = 0;
+		size_t count = 0;
+		while (count < m_blocks.size() && kept + m_blocks[count].size <= keepBytes)
+			kept += m_blocks[count++].size;
+		m_blocks.erase(m_blocks.begin() + count, m_blocks.end());
+		m_blocks.shrink_to_fit();
+	}
+
+	/// Get the bytes allocated since the last Reset()
+	size_t GetUsed() const { return m_used; }
+
+	/// Get the total size of the blocks held
+	size_t GetCapacity() const
+	{
+		size_t capacity = 0;
+		for (const Block& block : m_blocks)
+			capacity += block.size;
+		return capacity;
+	}
+
+private:
+	ScratchArena(const ScratchArena&) = delete;
+	ScratchArena& operator=(const ScratchArena&) = delete;
+
+	struct Block
+	{
+		std::unique_ptr<char[]> data;
+		size_t size;
+	};
+
+	/// Move to the next block able to hold the allocation, inserting a new
+	/// block if none is
+	void* AllocateSlow(size_t size, size_t align)
+	{
+		// Leave room to align within a block
+		size_t needed = size + align - 1;
+		size_t next = m_blocks.empty() ? 0 : m_block + 1;
+		if (next >= m_blocks.size() || m_blocks[next].size < needed)
+		{
+			size_t blockSize = needed > m_blockSize ? needed : m_blockSize;
+			Block block{ std::unique_ptr<char[]>(new char[blockSize]), blockSize };
+			m_blocks.insert(m_blocks.begin() + next, std::move(block));
+		}
+
+		m_block = next;
+		m_offset = 0;
+		return Allocate(size, align);
+	}
+
+	const size_t m_blockSize;
+	std::vector<Block> m_blocks;
+
+	/// Current block and the offset of its first free byte
+	size_t m_block = 0;
+	size_t m_offset = 0;
+	size_t m_used = 0;
+};
+
+/// @brief A standard allocator taking storage from a ScratchArena. Deallocation
+/// does nothing; the memory is released by ScratchArena::Reset().
+/// @tparam T The allocated type.
+template <class T>
+class ScratchAllocator
+{
+public:
+	typedef T value_type;
+
+	/// Constructor
+	/// @param[in] arena - the arena to allocate from
+	explicit ScratchAllocator(ScratchArena& arena) noexcept : m_arena(&arena) {}
+
+	template <class U>
+	ScratchAllocator(const ScratchAllocator<U>& other) noexcept : m_arena(other.m_arena) {}
+
+	T* allocate(size_t n)
+	{
+		if (n > static_cast<size_t>(-1) / sizeof(T))
+			throw std::bad_array_new_length();
+		return static_cast<T*>(m_arena->Allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T*, size_t) noexcept {}
+
+	template <class U>
+	bool operator==(const ScratchAllocator<U>& other) const noexcept { return m_arena == other.m_arena; }
+
+	template <class U>
+	bool operator!=(const ScratchAllocator<U>& other) const noexcept { return m_arena != other.m_arena; }
+
+private:
+	template <class U>
+	friend class ScratchAllocator;
+
+	ScratchArena* m_arena;
+};
+
+#endif
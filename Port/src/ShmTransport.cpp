@@ -0,0 +1,295 @@
+#include "ShmTransport.h"
+
+#ifndef WIN32
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <new>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <climits>
+#include <ctime>
+#endif
+
+using namespace std;
+using namespace DelegateLib;
+
+/// Offset of the ring data within the region
+static const size_t DATA_OFFSET = 256;
+
+//----------------------------------------------------------------------------
+// Create
+//----------------------------------------------------------------------------
+std::unique_ptr<ShmRing> ShmRing::Create(const std::string& name, size_t capacity)
+{
+	static_assert(sizeof(Header) <= DATA_OFFSET, "Header does not fit");
+	if (capacity < 64 || (capacity & (capacity - 1)) != 0 || capacity > 0x80000000)
+		throw std::invalid_argument("Capacity must be a power of 2");
+
+	// Remove a region left behind by an earlier process
+	shm_unlink(name.c_str());
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0)
+		return nullptr;
+
+	size_t regionSize = DATA_OFFSET + capacity;
+	void* region = MAP_FAILED;
+	if (ftruncate(fd, (off_t)regionSize) == 0)
+		region = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (region == MAP_FAILED)
+	{
+		shm_unlink(name.c_str());
+		return nullptr;
+	}
+
+	Header* header = new(region) Header();
+	header->capacity = (uint32_t)capacity;
+	header->lock.store(0, std::memory_order_relaxed);
+	header->tail.store(0, std::memory_order_relaxed);
+	header->dropped.store(0, std::memory_order_relaxed);
+	header->head.store(0, std::memory_order_relaxed);
+	header->sleeping.store(0, std::memory_order_relaxed);
+	header->signal.store(0, std::memory_order_relaxed);
+
+	// Publish the initialized header to processes opening the region
+	std::atomic_thread_fence(std::memory_order_release);
+	header->magic = MAGIC;
+
+	return std::unique_ptr<ShmRing>(new ShmRing(name, region, regionSize, true));
+}
+
+//----------------------------------------------------------------------------
+// Open
+//----------------------------------------------------------------------------
+std::unique_ptr<ShmRing> ShmRing::Open(const std::string& name)
+{
+	int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if (fd < 0)
+		return nullptr;
+
+	struct stat st;
+	void* region = MAP_FAILED;
+	if (fstat(fd, &st) == 0 && (size_t)st.st_size > DATA_OFFSET)
+		region = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (region == MAP_FAILED)
+		return nullptr;
+
+	size_t regionSize = (size_t)st.st_size;
+	Header* header = static_cast<Header*>(region);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	if (header->magic != MAGIC || DATA_OFFSET + header->capacity != regionSize)
+	{
+		munmap(region, regionSize);
+		return nullptr;
+	}
+	return std::unique_ptr<ShmRing>(new ShmRing(name, region, regionSize, false));
+}
+
+//----------------------------------------------------------------------------
+// ShmRing
+//----------------------------------------------------------------------------
+ShmRing::ShmRing(const std::string& name, void* region, size_t regionSize, bool owner) :
+	m_name(name), m_region(region), m_regionSize(regionSize), m_owner(owner)
+{
+	m_header = static_cast<Header*>(region);
+	m_data = static_cast<unsigned char*>(region) + DATA_OFFSET;
+	m_capacity = m_header->capacity;
+	m_mask = m_capacity - 1;
+}
+
+//----------------------------------------------------------------------------
+// ~ShmRing
+//----------------------------------------------------------------------------
+ShmRing::~ShmRing()
+{
+	munmap(m_region, m_regionSize);
+	if (m_owner)
+		shm_unlink(m_name.c_str());
+}
+
+//----------------------------------------------------------------------------
+// Reserve
+//----------------------------------------------------------------------------
+unsigned char* ShmRing::Reserve(size_t size)
+{
+	if (size > GetMaxRecordSize())
+	{
+		m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	uint32_t unlocked = 0;
+	while (!m_header->lock.compare_exchange_weak(unlocked, 1, std::memory_order_acquire, std::memory_order_relaxed))
+	{
+		unlocked = 0;
+		std::this_thread::yield();
+	}
+
+	// A record never wraps. Fill the end of the ring if the record does not fit there.
+	const size_t space = RecordSpace(size);
+	uint64_t tail = m_header->tail.load(std::memory_order_relaxed);
+	uint64_t head = m_header->head.load(std::memory_order_acquire);
+	size_t offset = (size_t)(tail & m_mask);
+	size_t pad = m_capacity - offset < space ? m_capacity - offset : 0;
+	if (tail + pad + space - head > m_capacity)
+	{
+		m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+		m_header->lock.store(0, std::memory_order_release);
+		return nullptr;
+	}
+
+	if (pad)
+	{
+		auto filler = reinterpret_cast<RecordHeader*>(m_data + offset);
+		filler->size = (uint32_t)(pad - sizeof(RecordHeader));
+		filler->id.store(PAD_ID, std::memory_order_relaxed);
+		tail += pad;
+	}
+
+	// The record data is written after the lock is released, so a slow or dead
+	// producer does not hold up the others
+	auto record = reinterpret_cast<RecordHeader*>(m_data + (tail & m_mask));
+	record->size = (uint32_t)size;
+	record->id.store(PENDING_ID, std::memory_order_relaxed);
+	m_header->tail.store(tail + space, std::memory_order_release);
+	m_header->lock.store(0, std::memory_order_release);
+	return reinterpret_cast<unsigned char*>(record + 1);
+}
+
+//----------------------------------------------------------------------------
+// Commit
+//----------------------------------------------------------------------------
+void ShmRing::Commit(unsigned char* data, uint32_t id)
+{
+	auto record = reinterpret_cast<RecordHeader*>(data) - 1;
+	record->id.store(id, std::memory_order_release);
+
+	// Pairs with the fence in Wait() so either the consumer sees the record or
+	// the producer sees the consumer sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_header->sleeping.load(std::memory_order_relaxed))
+		Wake();
+}
+
+//----------------------------------------------------------------------------
+// IsReady
+//----------------------------------------------------------------------------
+bool ShmRing::IsReady() const
+{
+	uint64_t head = m_header->head.load(std::memory_order_relaxed);
+	if (head == m_header->tail.load(std::memory_order_acquire))
+		return false;
+	auto record = reinterpret_cast<const RecordHeader*>(m_data + (head & m_mask));
+	return record->id.load(std::memory_order_acquire) != PENDING_ID;
+}
+
+//----------------------------------------------------------------------------
+// Wait
+//----------------------------------------------------------------------------
+void ShmRing::Wait(std::chrono::milliseconds timeout)
+{
+#if defined(__linux__)
+	uint32_t signal = m_header->signal.load(std::memory_order_acquire);
+	m_header->sleeping.store(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (!IsReady())
+	{
+		struct timespec ts;
+		ts.tv_sec = (time_t)(timeout.count() / 1000);
+		ts.tv_nsec = (long)(timeout.count() % 1000) * 1000000;
+		syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_header->signal), FUTEX_WAIT, signal, &ts, nullptr, 0);
+	}
+	m_header->sleeping.store(0, std::memory_order_relaxed);
+#else
+	// Poll where no process shared wait primitive is available
+	if (!IsReady())
+		std::this_thread::sleep_for(std::min(timeout, std::chrono::milliseconds(1)));
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Wake
+//----------------------------------------------------------------------------
+void ShmRing::Wake()
+{
+	m_header->signal.fetch_add(1, std::memory_order_release);
+#if defined(__linux__)
+	syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_header->signal), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void ShmDelegateThread::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	auto remoteMsg = delegate_msg_cast<DelegateRemoteMsg>(msg);
+	if (remoteMsg == nullptr)
+		DELEGATE_THROW(DelegateError::INVALID_MESSAGE, std::invalid_argument("Not a remote delegate message"));
+
+	m_ring.Write(remoteMsg->GetId(), remoteMsg->GetSize(),
+		[remoteMsg](unsigned char* data) { remoteMsg->Serialize(data); });
+}
+
+//----------------------------------------------------------------------------
+// CreateThread
+//----------------------------------------------------------------------------
+bool ShmDelegateReceiver::CreateThread()
+{
+	if (!m_thread)
+	{
+		m_exit = false;
+		m_thread = std::unique_ptr<std::thread>(new thread(&ShmDelegateReceiver::Process, this));
+	}
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// ExitThread
+//----------------------------------------------------------------------------
+void ShmDelegateReceiver::ExitThread()
+{
+	if (!m_thread)
+		return;
+
+	m_exit = true;
+	m_ring.Wake();
+	m_thread->join();
+	m_thread = nullptr;
+}
+
+//----------------------------------------------------------------------------
+// Poll
+//----------------------------------------------------------------------------
+size_t ShmDelegateReceiver::Poll()
+{
+	return m_ring.Read([this](uint32_t id, const unsigned char* data, size_t size) {
+		if (!m_targets.Invoke(id, data, size))
+			m_rejected.fetch_add(1, std::memory_order_relaxed);
+	});
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void ShmDelegateReceiver::Process()
+{
+	while (!m_exit.load(std::memory_order_acquire))
+	{
+		if (Poll() == 0)
+			m_ring.Wait(std::chrono::milliseconds(100));
+	}
+
+	// Invoke the calls written before exit
+	Poll();
+}
+
+#endif // WIN32
@@ -0,0 +1,277 @@
+#ifndef _SHM_TRANSPORT_H
+#define _SHM_TRANSPORT_H
+
+/// @file
+/// @brief Delegate transport between processes over a shared memory ring. POSIX only.
+///
+/// @details The receiving process creates a named ShmRing and a ShmDelegateReceiver
+/// with the delegates to call, keyed on remote function ids. The sending process
+/// opens the ring and binds DelegateRemote<> delegates to a ShmDelegateThread. A call
+/// serializes its arguments directly into the ring, so a trivially copyable argument
+/// is copied once, from the caller into shared memory, and the receiver deserializes
+/// it in place. Any number of sending threads and processes may share a ring. The
+/// ring has one receiver.
+
+#ifndef WIN32
+
+#include "DelegateRemote.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/// @brief A bounded byte ring within a named shared memory region carrying
+/// variable sized records for multiple producers and a single consumer.
+///
+/// @details Producers reserve space for a record behind a spin lock held within
+/// the region only while the record header is written, then write the record data
+/// without the lock and publish the record by storing its id. The consumer reads
+/// published records in place, in reservation order, without a lock and advances
+/// the head to release their space. A record that does not fit is dropped and
+/// counted rather than blocking the producer, so a stalled or dead receiver never
+/// stalls the sender, and a producer that dies while writing a record blocks only
+/// the records behind it until the ring is full. On Linux the idle consumer sleeps
+/// on a futex in the region, woken by the producers.
+class ShmRing
+{
+public:
+	/// Create and own a named ring. The name is removed when the ring is destroyed.
+	/// @param[in] name - the shared memory name, e.g. "/logger"
+	/// @param[in] capacity - the ring size in bytes. Must be a power of 2.
+	/// @return The ring, or nullptr if the region cannot be created.
+	/// @throws std::invalid_argument If the capacity is not a power of 2.
+	static std::unique_ptr<ShmRing> Create(const std::string& name, size_t capacity);
+
+	/// Open a ring created by another process
+	/// @param[in] name - the shared memory name passed to Create()
+	/// @return The ring, or nullptr if the region does not exist or is not a ring.
+	static std::unique_ptr<ShmRing> Open(const std::string& name);
+
+	/// Destructor
+	~ShmRing();
+
+	/// Write a record. Safe to call from any thread of any process.
+	/// @param[in] id - the record id. 0xFFFFFFFE and 0xFFFFFFFF are reserved.
+	/// @param[in] size - the record data size in bytes
+	/// @param[in] fill - called as fill(unsigned char* data) to write the record data.
+	///		Called without the producer lock. If it throws, the record is skipped by
+	///		the consumer and the exception propagates.
+	/// @return True if written. False if the ring was full and the record dropped.
+	template <class Fill>
+	bool Write(uint32_t id, size_t size, Fill&& fill)
+	{
+		if (id >= PENDING_ID)
+		{
+			m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
+		unsigned char* data = Reserve(size);
+		if (!data)
+			return false;
+		DELEGATE_TRY
+		{
+			fill(data);
+		}
+		DELEGATE_CATCH(...)
+		{
+			Commit(data, PAD_ID);
+			DELEGATE_RETHROW();
+		}
+		Commit(data, id);
+		return true;
+	}
+
+	/// Read the records written so far. Called by the consumer only.
+	/// @param[in] handler - called as handler(uint32_t id, const unsigned char* data,
+	///		size_t size) for each record. The data is valid during the call.
+	/// @return The number of records read.
+	template <class Handler>
+	size_t Read(Handler&& handler)
+	{
+		size_t count = 0;
+		uint64_t head = m_header->head.load(std::memory_order_relaxed);
+		uint64_t tail = m_header->tail.load(std::memory_order_acquire);
+		while (head != tail)
+		{
+			auto record = reinterpret_cast<const RecordHeader*>(m_data + (head & m_mask));
+
+			// Records are read in reservation order, so stop at one still being written
+			uint32_t id = record->id.load(std::memory_order_acquire);
+			if (id == PENDING_ID)
+				break;
+
+			// A record overrunning the reserved space or the end of the ring was not
+			// written by a producer. Discard the rest, as the next record is unknown.
+			size_t space = RecordSpace(record->size);
+			if (record->size > GetMaxRecordSize() || head + space > tail ||
+				(head & m_mask) + space > m_capacity)
+			{
+				m_header->dropped.fetch_add(1, std::memory_order_relaxed);
+				m_header->head.store(tail, std::memory_order_release);
+				break;
+			}
+
+			if (id != PAD_ID)
+			{
+				handler(id, reinterpret_cast<const unsigned char*>(record + 1), (size_t)record->size);
+				count++;
+			}
+			head += space;
+			m_header->head.store(head, std::memory_order_release);
+		}
+		return count;
+	}
+
+	/// Check if a published record is waiting. Called by the consumer only.
+	bool IsReady() const;
+
+	/// Sleep until a record is written or the timeout expires. Called by the consumer only.
+	/// @param[in] timeout - the longest time to sleep
+	void Wait(std::chrono::milliseconds timeout);
+
+	/// Wake a consumer sleeping in Wait()
+	void Wake();
+
+	/// Get the number of records dropped because the ring was full or they were
+	/// malformed
+	uint64_t GetDropped() const { return m_header->dropped.load(std::memory_order_relaxed); }
+
+	/// Get the largest record data size
+	size_t GetMaxRecordSize() const { return m_capacity / 2 - sizeof(RecordHeader); }
+
+private:
+	/// Region header shared by every process. Counters are byte positions that only
+	/// increase. The tail is the end of the reserved records. Lock-free atomics are
+	/// address free, so they work across processes.
+	struct Header
+	{
+		uint32_t magic;
+		uint32_t capacity;
+		alignas(64) std::atomic<uint32_t> lock;
+		std::atomic<uint64_t> tail;
+		std::atomic<uint64_t> dropped;
+		alignas(64) std::atomic<uint64_t> head;
+		std::atomic<uint32_t> sleeping;
+		std::atomic<uint32_t> signal;
+	};
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory atomics must be lock-free");
+
+	/// Record header. Records are padded to 8 bytes. The id is PENDING_ID until
+	/// the record is published.
+	struct RecordHeader
+	{
+		uint32_t size;
+		std::atomic<uint32_t> id;
+	};
+	static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory atomics must be lock-free");
+
+	/// Id of a record reserved but not yet published
+	static const uint32_t PENDING_ID = 0xFFFFFFFE;
+
+	/// Id of the filler record written when a record would wrap, and of a record
+	/// abandoned by a producer
+	static const uint32_t PAD_ID = 0xFFFFFFFF;
+	static const uint32_t MAGIC = 0x44524E47;
+
+	ShmRing(const std::string& name, void* region, size_t regionSize, bool owner);
+	ShmRing(const ShmRing&) = delete;
+	ShmRing& operator=(const ShmRing&) = delete;
+
+	static size_t RecordSpace(size_t size) { return (sizeof(RecordHeader) + size + 7) & ~size_t(7); }
+
+	/// Reserve a record under the producer lock
+	/// @return The record data, or nullptr if the record does not fit.
+	unsigned char* Reserve(size_t size);
+
+	/// Publish a reserved record and wake the consumer
+	/// @param[in] data - the record data returned by Reserve()
+	/// @param[in] id - the record id, or PAD_ID to abandon the record
+	void Commit(unsigned char* data, uint32_t id);
+
+	const std::string m_name;
+	void* const m_region;
+	const size_t m_regionSize;
+	const bool m_owner;
+	Header* m_header;
+	unsigned char* m_data;
+	size_t m_capacity;
+	uint64_t m_mask;
+};
+
+/// @brief A DelegateThread sending DelegateRemote<> calls to another process
+/// through a ShmRing. DispatchDelegate() serializes the message before it returns.
+class ShmDelegateThread : public DelegateLib::DelegateThread
+{
+public:
+	/// Constructor
+	/// @param[in] ring - the ring opened to the receiving process
+	explicit ShmDelegateThread(ShmRing& ring) : m_ring(ring) {}
+
+	/// Serialize a DelegateRemoteMsg into the ring. A call that does not fit is
+	/// dropped and counted by ShmRing::GetDropped().
+	/// @param[in] msg - the message created by DelegateRemote<>
+	/// @throws std::invalid_argument If the message is not a DelegateRemoteMsg. Fatal
+	///		with DELEGATE_NO_EXCEPTIONS defined.
+	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg);
+
+private:
+	ShmRing& m_ring;
+};
+
+/// @brief Receives calls from a ShmRing and invokes the delegate registered for
+/// each remote function id on its own thread.
+class ShmDelegateReceiver
+{
+public:
+	/// Constructor
+	/// @param[in] ring - the ring to read
+	explicit ShmDelegateReceiver(ShmRing& ring) : m_ring(ring) {}
+
+	/// Destructor
+	~ShmDelegateReceiver() { ExitThread(); }
+
+	/// Register the delegate invoked for a remote function id. An async delegate
+	/// forwards the call onto a local thread. Call before CreateThread().
+	/// @param[in] id - the remote function id
+	/// @param[in] target - the delegate to invoke. Copied.
+	template <class... Args>
+	void Register(uint32_t id, const DelegateLib::Delegate<void(Args...)>& target)
+	{
+		m_targets.Register(id, target);
+	}
+
+	/// Called once to create the receiver thread
+	/// @return TRUE if thread is created. FALSE otherise.
+	bool CreateThread();
+
+	/// Called once at program exit to exit the receiver thread. Calls already in
+	/// the ring are invoked first.
+	void ExitThread();
+
+	/// Invoke the calls waiting in the ring on the calling thread. Use instead of
+	/// CreateThread() to receive on an existing thread.
+	/// @return The number of calls read.
+	size_t Poll();
+
+	/// Get the number of calls with an unregistered id or malformed arguments
+	uint64_t GetRejected() const { return m_rejected.load(std::memory_order_relaxed); }
+
+private:
+	ShmDelegateReceiver(const ShmDelegateReceiver&) = delete;
+	ShmDelegateReceiver& operator=(const ShmDelegateReceiver&) = delete;
+
+	/// Entry point for the thread
+	void Process();
+
+	ShmRing& m_ring;
+	DelegateLib::DelegateRemoteRegistry m_targets;
+	std::unique_ptr<std::thread> m_thread;
+	std::atomic<bool> m_exit{ false };
+	std::atomic<uint64_t> m_rejected{ 0 };
+};
+
+#endif // WIN32
+
+#endif
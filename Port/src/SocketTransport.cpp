@@ -0,0 +1,320 @@
+#include "SocketTransport.h"
+
+#ifndef WIN32
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <list>
+#include <stdexcept>
+
+using namespace std;
+using namespace DelegateLib;
+
+/// Frame header: argument size and remote function id
+static const size_t FRAME_HEADER = 2 * sizeof(uint32_t);
+
+/// Largest accepted frame argument size
+static const uint32_t MAX_FRAME = 16 * 1024 * 1024;
+
+/// Time the receiver waits before retrying a poll() or accept() that failed
+static const std::chrono::milliseconds RETRY_DELAY(10);
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+//----------------------------------------------------------------------------
+// SocketDelegateThread
+//----------------------------------------------------------------------------
+SocketDelegateThread::SocketDelegateThread(size_t maxPending) : MAX_PENDING(maxPending)
+{
+}
+
+//----------------------------------------------------------------------------
+// ~SocketDelegateThread
+//----------------------------------------------------------------------------
+SocketDelegateThread::~SocketDelegateThread()
+{
+	Close();
+}
+
+//----------------------------------------------------------------------------
+// Connect
+//----------------------------------------------------------------------------
+bool SocketDelegateThread::Connect(const std::string& host, uint16_t port)
+{
+	if (m_thread)
+		return false;
+
+	addrinfo hints = {};
+	hints.ai_family = AF_INET;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* addresses = nullptr;
+	if (getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addresses) != 0)
+		return false;
+
+	int s = -1;
+	for (addrinfo* address = addresses; address && s < 0; address = address->ai_next)
+	{
+		s = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+		if (s >= 0 && connect(s, address->ai_addr, address->ai_addrlen) != 0)
+		{
+			close(s);
+			s = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	if (s < 0)
+		return false;
+
+	// Frames are batched by the sender thread, so send each batch at once
+	int noDelay = 1;
+	setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+	m_socket = s;
+	m_exit = false;
+	m_connected = true;
+	m_thread = std::unique_ptr<std::thread>(new thread(&SocketDelegateThread::Process, this));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Close
+//----------------------------------------------------------------------------
+void SocketDelegateThread::Close()
+{
+	if (!m_thread)
+		return;
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_exit = true;
+	}
+	m_cv.notify_all();
+	m_thread->join();
+	m_thread = nullptr;
+
+	close(m_socket);
+	m_socket = -1;
+	m_connected = false;
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void SocketDelegateThread::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	auto remoteMsg = delegate_msg_cast<DelegateRemoteMsg>(msg);
+	if (remoteMsg == nullptr)
+		DELEGATE_THROW(DelegateError::INVALID_MESSAGE, std::invalid_argument("Not a remote delegate message"));
+
+	size_t size = remoteMsg->GetSize();
+	uint32_t header[2] = { htonl((uint32_t)size), htonl(remoteMsg->GetId()) };
+
+	unique_lock<mutex> lock(m_mutex);
+	m_cv.wait(lock, [this]() { return m_pending.size() < MAX_PENDING || !IsConnected(); });
+	if (!IsConnected() || m_exit)
+	{
+		m_dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	// Serialize the frame at the end of the pending batch
+	bool wake = m_pending.empty();
+	size_t offset = m_pending.size();
+	m_pending.resize(offset + FRAME_HEADER + size);
+	memcpy(m_pending.data() + offset, header, FRAME_HEADER);
+	remoteMsg->Serialize(m_pending.data() + offset + FRAME_HEADER);
+	lock.unlock();
+
+	if (wake)
+		m_cv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void SocketDelegateThread::Process()
+{
+	std::vector<unsigned char> sending;
+	while (1)
+	{
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_cv.wait(lock, [this]() { return !m_pending.empty() || m_exit; });
+			if (m_pending.empty())
+				return;
+
+			// Take the whole batch and let the senders refill the other buffer
+			sending.clear();
+			sending.swap(m_pending);
+		}
+		m_cv.notify_all();
+
+		size_t sent = 0;
+		while (sent < sending.size())
+		{
+			ssize_t n = send(m_socket, sending.data() + sent, sending.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0)
+			{
+				// The connection failed. Drop this batch and all later calls.
+				lock_guard<mutex> lock(m_mutex);
+				m_connected = false;
+				m_pending.clear();
+				m_cv.notify_all();
+				return;
+			}
+			sent += (size_t)n;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// Listen
+//----------------------------------------------------------------------------
+bool SocketDelegateReceiver::Listen(uint16_t port)
+{
+	if (m_thread)
+		return false;
+
+	int s = socket(AF_INET, SOCK_STREAM, 0);
+	if (s < 0)
+		return false;
+
+	int reuse = 1;
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(port);
+	socklen_t length = sizeof(address);
+	if (bind(s, (sockaddr*)&address, sizeof(address)) != 0 || listen(s, 16) != 0 ||
+		getsockname(s, (sockaddr*)&address, &length) != 0 || pipe(m_wakeup) != 0)
+	{
+		close(s);
+		return false;
+	}
+
+	m_listen = s;
+	m_port = ntohs(address.sin_port);
+	m_thread = std::unique_ptr<std::thread>(new thread(&SocketDelegateReceiver::Process, this));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// ExitThread
+//----------------------------------------------------------------------------
+void SocketDelegateReceiver::ExitThread()
+{
+	if (!m_thread)
+		return;
+
+	char exit = 0;
+	if (write(m_wakeup[1], &exit, 1) != 1)
+		return;
+	m_thread->join();
+	m_thread = nullptr;
+
+	close(m_listen);
+	close(m_wakeup[0]);
+	close(m_wakeup[1]);
+	m_listen = m_wakeup[0] = m_wakeup[1] = -1;
+}
+
+//----------------------------------------------------------------------------
+// Receive
+//----------------------------------------------------------------------------
+bool SocketDelegateReceiver::Receive(Connection& connection)
+{
+	const size_t READ_SIZE = 64 * 1024;
+	auto& buffer = connection.buffer;
+	size_t size = buffer.size();
+	buffer.resize(size + READ_SIZE);
+	ssize_t n = recv(connection.socket, buffer.data() + size, READ_SIZE, 0);
+	buffer.resize(size + (n > 0 ? (size_t)n : 0));
+	if (n <= 0)
+		return false;
+
+	// Invoke each complete frame and keep a partial frame for the next read
+	size_t pos = 0;
+	while (buffer.size() - pos >= FRAME_HEADER)
+	{
+		uint32_t header[2];
+		memcpy(header, buffer.data() + pos, FRAME_HEADER);
+		uint32_t size = ntohl(header[0]);
+		if (size > MAX_FRAME)
+			return false;
+		if (buffer.size() - pos - FRAME_HEADER < size)
+			break;
+
+		if (!m_targets.Invoke(ntohl(header[1]), buffer.data() + pos + FRAME_HEADER, size))
+			m_rejected.fetch_add(1, std::memory_order_relaxed);
+		pos += FRAME_HEADER + size;
+	}
+	buffer.erase(buffer.begin(), buffer.begin() + pos);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void SocketDelegateReceiver::Process()
+{
+	std::list<Connection> connections;
+	std::vector<pollfd> fds;
+	while (1)
+	{
+		fds.clear();
+		fds.push_back({ m_wakeup[0], POLLIN, 0 });
+		fds.push_back({ m_listen, POLLIN, 0 });
+		for (auto& connection : connections)
+			fds.push_back({ connection.socket, POLLIN, 0 });
+
+		// A persistent error, e.g. out of memory, is retried after a delay rather
+		// than in a busy loop
+		if (poll(fds.data(), fds.size(), -1) < 0)
+		{
+			if (errno != EINTR)
+				std::this_thread::sleep_for(RETRY_DELAY);
+			continue;
+		}
+		if (fds[0].revents)
+			break;
+
+		if (fds[1].revents)
+		{
+			// The pending connection stays queued when out of descriptors, so
+			// back off rather than poll it again at once
+			int s = accept(m_listen, nullptr, nullptr);
+			if (s >= 0)
+				connections.push_back({ s, {} });
+			else if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED)
+				std::this_thread::sleep_for(RETRY_DELAY);
+		}
+
+		size_t index = 2;
+		for (auto connection = connections.begin(); index < fds.size(); index++)
+		{
+			if (fds[index].revents && !Receive(*connection))
+			{
+				close(connection->socket);
+				connection = connections.erase(connection);
+			}
+			else
+				++connection;
+		}
+	}
+
+	for (auto& connection : connections)
+		close(connection.socket);
+}
+
+#endif // WIN32
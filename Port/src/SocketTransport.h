@@ -0,0 +1,151 @@
+#ifndef _SOCKET_TRANSPORT_H
+#define _SOCKET_TRANSPORT_H
+
+/// @file
+/// @brief Delegate transport between hosts over TCP. POSIX only.
+///
+/// @details The receiving node creates a SocketDelegateReceiver with the delegates
+/// to call, keyed on remote function ids, and listens on a port. The sending node
+/// connects a SocketDelegateThread and binds DelegateRemote<> delegates to it. A call
+/// serializes its arguments into the pending frame buffer and returns without waiting
+/// for the network. The sender thread writes every frame queued since its last write
+/// in one send, so calls made while a send is in progress are batched and pipelined.
+///
+/// A frame is the argument size and the remote function id as 32-bit network order
+/// values, followed by the serialized arguments. The arguments are serialized in host
+/// order, so both nodes must share byte order and argument layout.
+
+#ifndef WIN32
+
+#include "DelegateRemote.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// @brief A DelegateThread sending DelegateRemote<> calls to another node over a
+/// TCP connection.
+class SocketDelegateThread : public DelegateLib::DelegateThread
+{
+public:
+	/// Default limit of serialized bytes waiting to be sent
+	static const size_t DEFAULT_MAX_PENDING = 1024 * 1024;
+
+	/// Constructor
+	/// @param[in] maxPending - the pending byte limit. A call blocks while the limit
+	///		is exceeded, so a slow connection throttles the senders.
+	explicit SocketDelegateThread(size_t maxPending = DEFAULT_MAX_PENDING);
+
+	/// Destructor
+	~SocketDelegateThread();
+
+	/// Connect to a receiver and create the sender thread
+	/// @param[in] host - the receiver IPv4 address or host name
+	/// @param[in] port - the receiver port
+	/// @return True if connected.
+	bool Connect(const std::string& host, uint16_t port);
+
+	/// Send the pending calls, then close the connection and exit the sender thread
+	void Close();
+
+	/// Check if the connection is open. False once a send fails.
+	bool IsConnected() const { return m_connected.load(std::memory_order_acquire); }
+
+	/// Get the number of calls dropped because the connection was closed or failed
+	uint64_t GetDropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+	/// Serialize a DelegateRemoteMsg into the pending frame buffer
+	/// @param[in] msg - the message created by DelegateRemote<>
+	/// @throws std::invalid_argument If the message is not a DelegateRemoteMsg. Fatal
+	///		with DELEGATE_NO_EXCEPTIONS defined.
+	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg);
+
+private:
+	SocketDelegateThread(const SocketDelegateThread&) = delete;
+	SocketDelegateThread& operator=(const SocketDelegateThread&) = delete;
+
+	/// Entry point for the sender thread
+	void Process();
+
+	const size_t MAX_PENDING;
+	int m_socket = -1;
+	std::unique_ptr<std::thread> m_thread;
+	std::mutex m_mutex;
+	std::condition_variable m_cv;
+
+	/// Frames waiting for the sender thread. Protected by m_mutex.
+	std::vector<unsigned char> m_pending;
+	bool m_exit = false;
+
+	std::atomic<bool> m_connected{ false };
+	std::atomic<uint64_t> m_dropped{ 0 };
+};
+
+/// @brief Accepts TCP connections and invokes the delegate registered for each
+/// received call on its own thread. Any number of senders may connect.
+class SocketDelegateReceiver
+{
+public:
+	/// Constructor
+	SocketDelegateReceiver() = default;
+
+	/// Destructor
+	~SocketDelegateReceiver() { ExitThread(); }
+
+	/// Register the delegate invoked for a remote function id. An async delegate
+	/// forwards the call onto a local thread. Call before Listen().
+	/// @param[in] id - the remote function id
+	/// @param[in] target - the delegate to invoke. Copied.
+	template <class... Args>
+	void Register(uint32_t id, const DelegateLib::Delegate<void(Args...)>& target)
+	{
+		m_targets.Register(id, target);
+	}
+
+	/// Listen for connections and create the receiver thread
+	/// @param[in] port - the port, or 0 to pick a free port. See GetPort().
+	/// @return True if listening.
+	bool Listen(uint16_t port);
+
+	/// Get the listening port
+	uint16_t GetPort() const { return m_port; }
+
+	/// Called once at program exit to close all connections and exit the receiver thread
+	void ExitThread();
+
+	/// Get the number of calls with an unregistered id or malformed arguments
+	uint64_t GetRejected() const { return m_rejected.load(std::memory_order_relaxed); }
+
+private:
+	SocketDelegateReceiver(const SocketDelegateReceiver&) = delete;
+	SocketDelegateReceiver& operator=(const SocketDelegateReceiver&) = delete;
+
+	/// A connected sender and its partially received frames
+	struct Connection
+	{
+		int socket;
+		std::vector<unsigned char> buffer;
+	};
+
+	/// Entry point for the thread
+	void Process();
+
+	/// Read from a connection and invoke its complete frames
+	/// @return False if the connection closed or failed.
+	bool Receive(Connection& connection);
+
+	DelegateLib::DelegateRemoteRegistry m_targets;
+	int m_listen = -1;
+	int m_wakeup[2] = { -1, -1 };
+	uint16_t m_port = 0;
+	std::unique_ptr<std::thread> m_thread;
+	std::atomic<uint64_t> m_rejected{ 0 };
+};
+
+#endif // WIN32
+
+#endif
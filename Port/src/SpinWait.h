@@ -0,0 +1,168 @@
+#ifndef _SPIN_WAIT_H
+#define _SPIN_WAIT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+/// Selects how an idle thread waits for work
+enum class WaitPolicy
+{
+	BLOCK,				///< Sleep at once
+	SPIN_THEN_BLOCK,	///< Poll for the spin time, then sleep
+	BUSY_POLL,			///< Poll until work arrives. For threads on dedicated cores.
+	ADAPTIVE			///< Poll only while work recently arrived within the spin time
+};
+
+/// Wait policy and spin time of a thread
+struct WaitStrategy
+{
+	WaitPolicy policy = WaitPolicy::BLOCK;
+
+	/// Longest time polled before sleeping by SPIN_THEN_BLOCK and ADAPTIVE
+	std::chrono::nanoseconds spinTime = std::chrono::microseconds(50);
+};
+
+/// @brief The polling phase of a consumer thread's wait. The owning thread calls
+/// Spin() before sleeping on its wake word and skips the sleep if work
+/// arrived. SetStrategy() is safe from any thread.
+///
+/// @details ADAPTIVE keeps a moving average of the idle time between the start
+/// of a wait and the arrival of work. While the average is within the spin time
+/// the thread polls for up to twice the average, otherwise it sleeps at once.
+/// Each wait updates the average, so a thread starts polling again when the
+/// arrival rate rises.
+class SpinWait
+{
+public:
+	/// Constructor
+	/// @param[in] strategy - the initial wait strategy
+	explicit SpinWait(const WaitStrategy& strategy = WaitStrategy()) { SetStrategy(strategy); }
+
+	/// Set the wait strategy. Function call is thread-safe.
+	/// @param[in] strategy - the wait strategy
+	void SetStrategy(const WaitStrategy& strategy)
+	{
+		m_spinTime.store(strategy.spinTime.count(), std::memory_order_relaxed);
+		m_policy.store(strategy.policy, std::memory_order_relaxed);
+	}
+
+	/// Get the wait strategy
+	WaitStrategy GetStrategy() const
+	{
+		WaitStrategy strategy;
+		strategy.policy = m_policy.load(std::memory_order_relaxed);
+		strategy.spinTime = std::chrono::nanoseconds(m_spinTime.load(std::memory_order_relaxed));
+		return strategy;
+	}
+
+	/// Poll until work is ready, the deadline passes or the spin time is spent.
+	/// Called by the owning thread only.
+	/// @param[in] ready - returns true once work is ready. Called without locks.
+	/// @param[in] deadline - the time the caller must wake by
+	/// @return True if the caller need not sleep.
+	template <class Ready>
+	bool Spin(Ready ready, std::chrono::steady_clock::time_point deadline)
+	{
+		WaitPolicy policy = m_policy.load(std::memory_order_relaxed);
+		if (policy == WaitPolicy::BLOCK)
+			return false;
+
+		auto start = std::chrono::steady_clock::now();
+		m_waitStart = start;
+		auto end = deadline;
+		if (policy != WaitPolicy::BUSY_POLL)
+		{
+			auto budget = GetBudget(policy);
+			if (budget.count() == 0)
+				return false;
+			if (deadline - start > budget)
+				end = start + budget;
+		}
+
+		for (uint32_t i = 1; ; i++)
+		{
+			if (ready())
+			{
+				if (policy == WaitPolicy::ADAPTIVE)
+					Record(std::chrono::steady_clock::now() - start);
+				return true;
+			}
+
+			// Reading the clock costs more than a poll so check it periodically
+			if ((i & (CLOCK_INTERVAL - 1)) == 0 && std::chrono::steady_clock::now() >= end)
+				return end == deadline;
+			CpuRelax();
+		}
+	}
+
+	/// Record the end of a wait that slept after Spin() returned false. Called
+	/// by the owning thread only.
+	void Woken()
+	{
+		if (m_policy.load(std::memory_order_relaxed) == WaitPolicy::ADAPTIVE)
+			Record(std::chrono::steady_clock::now() - m_waitStart);
+	}
+
+	/// Get the average idle time measured by ADAPTIVE
+	std::chrono::nanoseconds GetAverageIdle() const
+	{
+		return std::chrono::nanoseconds(m_averageIdle.load(std::memory_order_relaxed));
+	}
+
+	/// Hint to the CPU that the caller is polling
+	static void CpuRelax()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		_mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#elif defined(__aarch64__)
+		asm volatile("yield");
+#else
+		std::this_thread::yield();
+#endif
+	}
+
+private:
+	/// Polls between clock reads. Must be a power of 2.
+	static const uint32_t CLOCK_INTERVAL = 16;
+
+	/// Weight of each new idle sample in the ADAPTIVE average is 1/2^AVERAGE_SHIFT
+	static const int AVERAGE_SHIFT = 3;
+
+	/// Get the time to poll for
+	std::chrono::nanoseconds GetBudget(WaitPolicy policy) const
+	{
+		int64_t spinTime = m_spinTime.load(std::memory_order_relaxed);
+		if (policy != WaitPolicy::ADAPTIVE)
+			return std::chrono::nanoseconds(spinTime);
+
+		int64_t average = m_averageIdle.load(std::memory_order_relaxed);
+		if (average > spinTime)
+			return std::chrono::nanoseconds(0);
+		return std::chrono::nanoseconds(average * 2 < spinTime ? average * 2 + 1 : spinTime);
+	}
+
+	/// Add an idle time to the ADAPTIVE average
+	void Record(std::chrono::nanoseconds idle)
+	{
+		int64_t average = m_averageIdle.load(std::memory_order_relaxed);
+		average += (idle.count() - average) >> AVERAGE_SHIFT;
+		m_averageIdle.store(average, std::memory_order_relaxed);
+	}
+
+	std::atomic<WaitPolicy> m_policy{ WaitPolicy::BLOCK };
+	std::atomic<int64_t> m_spinTime{ 0 };
+
+	/// ADAPTIVE state. Only written by the owning thread.
+	std::atomic<int64_t> m_averageIdle{ 0 };
+	std::chrono::steady_clock::time_point m_waitStart;
+};
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef _SPSC_RING_H
+#define _SPSC_RING_H
+
+#include "CacheLine.h"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+/// @brief A bounded lock-free ring queue for one producer thread and one consumer
+/// thread.
+///
+/// @details The producer only writes the tail index and the consumer only the head
+/// index, each on its own cache line. Each side keeps a cached copy of the other
+/// side's index and reloads it only when the ring looks full or empty, so while
+/// the ring is neither a push or pop touches no line written by the other thread.
+/// Unlike LockFreeQueue no cell sequence numbers are needed, as only one thread
+/// moves each index.
+/// @tparam T The element type. Must be default constructible and move assignable.
+template <class T>
+class SpscRing
+{
+public:
+	/// Constructor
+	/// @param[in] capacity - the maximum number of queued elements. Must be a power of 2.
+	explicit SpscRing(size_t capacity) : m_cells(new T[capacity]), m_mask(capacity - 1)
+	{
+		if (capacity < 2 || (capacity & (capacity - 1)) != 0)
+			throw std::invalid_argument("Capacity must be a power of 2");
+	}
+
+	/// Push an element if a cell is free. Called by the producer thread only.
+	/// @param[in] value - the element to push. Unchanged if the ring is full.
+	/// @return True if the element was queued. False if the ring is full.
+	bool TryPush(T&& value)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_cachedHead > m_mask)
+		{
+			m_cachedHead = m_head.load(std::memory_order_acquire);
+			if (tail - m_cachedHead > m_mask)
+				return false;
+		}
+		m_cells[tail & m_mask] = std::move(value);
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Pop the oldest element. Called by the consumer thread only.
+	/// @param[out] value - the popped element
+	/// @return True if an element was popped. False if the ring is empty.
+	bool TryPop(T& value)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_cachedTail)
+		{
+			m_cachedTail = m_tail.load(std::memory_order_acquire);
+			if (head == m_cachedTail)
+				return false;
+		}
+		value = std::move(m_cells[head & m_mask]);
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// Check if the ring holds no element. Exact when called by the consumer,
+	/// otherwise a snapshot.
+	bool Empty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+	/// Get the number of queued elements. A snapshot when called concurrently.
+	size_t Size() const
+	{
+		const size_t head = m_head.load(std::memory_order_acquire);
+		return m_tail.load(std::memory_order_acquire) - head;
+	}
+
+	/// Get the maximum number of queued elements
+	size_t Capacity() const { return m_mask + 1; }
+
+private:
+	SpscRing(const SpscRing&) = delete;
+	SpscRing& operator=(const SpscRing&) = delete;
+
+	const std::unique_ptr<T[]> m_cells;
+	const size_t m_mask;
+
+	/// Index of the next element popped. Written by the consumer.
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{ 0 };
+
+	/// The consumer's copy of m_tail
+	size_t m_cachedTail = 0;
+
+	/// Index of the next element pushed. Written by the producer.
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{ 0 };
+
+	/// The producer's copy of m_head
+	size_t m_cachedHead = 0;
+};
+
+#endif
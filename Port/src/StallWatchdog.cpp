@@ -0,0 +1,241 @@
+#include "StallWatchdog.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__) && defined(__GLIBC__)
+#include <execinfo.h>
+#include <signal.h>
+#include <cstdlib>
+#define STALL_WATCHDOG_STACKS
+#endif
+
+using namespace std;
+
+/// Watchdog state. The heartbeats are scanned with the registry lock held so an
+/// unregistered heartbeat is never accessed.
+struct WatchdogState
+{
+	mutex lock;
+	condition_variable cv;
+	unique_ptr<std::thread> watchdog;
+	bool exit = false;
+	chrono::milliseconds threshold{ 0 };
+	bool captureStacks = false;
+	StallWatchdog::StallCallback callback;
+};
+
+//----------------------------------------------------------------------------
+// GetState
+//----------------------------------------------------------------------------
+static WatchdogState& GetState()
+{
+	static WatchdogState* state = new WatchdogState();
+	return *state;
+}
+
+#ifdef STALL_WATCHDOG_STACKS
+// Signal asking a stuck thread for its stack. Ignored by default, so a signal
+// arriving after the handler is removed is harmless.
+static const int STACK_SIGNAL = SIGURG;
+static const int MAX_FRAMES = 64;
+static void* stackFrames[MAX_FRAMES];
+static atomic<int> stackFrameCount{ -1 };
+
+//----------------------------------------------------------------------------
+// StackHandler
+//----------------------------------------------------------------------------
+static void StackHandler(int)
+{
+	stackFrameCount.store(backtrace(stackFrames, MAX_FRAMES), memory_order_release);
+}
+#endif
+
+//----------------------------------------------------------------------------
+// Start
+//----------------------------------------------------------------------------
+bool StallWatchdog::Start(std::chrono::milliseconds stallThreshold, bool stacks)
+{
+	WatchdogState& state = GetState();
+	lock_guard<mutex> lock(state.lock);
+	if (state.watchdog || stallThreshold.count() <= 0)
+		return false;
+
+	state.threshold = stallThreshold;
+	state.captureStacks = stacks;
+#ifdef STALL_WATCHDOG_STACKS
+	if (state.captureStacks)
+	{
+		// Load the unwinder now since backtrace() may allocate on first use
+		void* frame;
+		backtrace(&frame, 1);
+
+		struct sigaction action = {};
+		action.sa_handler = StackHandler;
+		sigemptyset(&action.sa_mask);
+		action.sa_flags = SA_RESTART;
+		sigaction(STACK_SIGNAL, &action, nullptr);
+	}
+#endif
+
+	state.exit = false;
+	state.watchdog.reset(new thread(&StallWatchdog::Process));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Stop
+//----------------------------------------------------------------------------
+void StallWatchdog::Stop()
+{
+	WatchdogState& state = GetState();
+	unique_ptr<thread> stopping;
+	{
+		lock_guard<mutex> lock(state.lock);
+		state.exit = true;
+		stopping = std::move(state.watchdog);
+	}
+	state.cv.notify_one();
+	if (stopping)
+		stopping->join();
+
+#ifdef STALL_WATCHDOG_STACKS
+	if (state.captureStacks)
+	{
+		signal(STACK_SIGNAL, SIG_DFL);
+		state.captureStacks = false;
+	}
+#endif
+}
+
+//----------------------------------------------------------------------------
+// SetStallCallback
+//----------------------------------------------------------------------------
+void StallWatchdog::SetStallCallback(StallCallback callback)
+{
+	WatchdogState& state = GetState();
+	lock_guard<mutex> lock(state.lock);
+	state.callback = std::move(callback);
+}
+
+//----------------------------------------------------------------------------
+// CaptureStack
+//----------------------------------------------------------------------------
+std::vector<std::string> StallWatchdog::CaptureStack(Heartbeat& heartbeat)
+{
+	vector<string> stack;
+#ifdef STALL_WATCHDOG_STACKS
+	if (!heartbeat.m_bound.load(std::memory_order_acquire))
+		return stack;
+
+	// The stuck thread fills the frame buffer from its signal handler
+	stackFrameCount.store(-1, memory_order_relaxed);
+	if (pthread_kill(heartbeat.m_thread, STACK_SIGNAL) != 0)
+		return stack;
+
+	auto giveUp = chrono::steady_clock::now() + chrono::milliseconds(100);
+	int count;
+	while ((count = stackFrameCount.load(memory_order_acquire)) < 0)
+	{
+		if (chrono::steady_clock::now() > giveUp)
+			return stack;
+		this_thread::sleep_for(chrono::microseconds(100));
+	}
+
+	char** symbols = backtrace_symbols(stackFrames, count);
+	if (symbols)
+	{
+		// Skip the signal handler and signal trampoline frames
+		for (int i = std::min(2, count); i < count; i++)
+			stack.emplace_back(symbols[i]);
+		free(symbols);
+	}
+#else
+	(void)heartbeat;
+#endif
+	return stack;
+}
+
+//----------------------------------------------------------------------------
+// Scan
+//----------------------------------------------------------------------------
+size_t StallWatchdog::Scan()
+{
+	static DelegateLib::MetricCounter& stallMetric = DelegateLib::Metrics::GetCounter("watchdog.stalls");
+
+	WatchdogState& state = GetState();
+	StallCallback callback;
+	chrono::milliseconds threshold;
+	bool captureStacks;
+	{
+		lock_guard<mutex> lock(state.lock);
+		callback = state.callback;
+		threshold = state.threshold;
+		captureStacks = state.captureStacks;
+	}
+
+	vector<StallReport> reports;
+	{
+		lock_guard<mutex> lock(ThreadRegistry::GetLock());
+		int64_t now = chrono::steady_clock::now().time_since_epoch().count();
+		int64_t limit = chrono::duration_cast<chrono::steady_clock::duration>(threshold).count();
+		for (Heartbeat* heartbeat : ThreadRegistry::GetHeartbeats())
+		{
+			// Report each stalled message once
+			int64_t beat = heartbeat->m_beat.load(std::memory_order_relaxed);
+			if (beat == 0 || beat == heartbeat->m_reported || now - beat < limit)
+				continue;
+			heartbeat->m_reported = beat;
+
+			StallReport report;
+			report.name = heartbeat->m_name;
+			report.type = heartbeat->m_type.load(std::memory_order_relaxed);
+			report.stalled = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::duration(now - beat));
+			report.queueDepth = heartbeat->m_queueDepth ? heartbeat->m_queueDepth() : 0;
+			if (captureStacks)
+				report.stack = CaptureStack(*heartbeat);
+			reports.push_back(std::move(report));
+		}
+	}
+
+	// Report without the lock so the callback may create or destroy threads
+	for (const StallReport& report : reports)
+	{
+		stallMetric.Add();
+		if (callback)
+		{
+			callback(report);
+			continue;
+		}
+
+		cout << "Stall: " << report.name << " busy " << report.stalled.count()
+			<< " ms with message type " << report.type << ", " << report.queueDepth << " queued" << endl;
+		for (const string& frame : report.stack)
+			cout << "  " << frame << endl;
+	}
+	return reports.size();
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void StallWatchdog::Process()
+{
+	WatchdogState& state = GetState();
+	while (1)
+	{
+		// Scan several times per threshold so a stall is found soon after
+		{
+			unique_lock<mutex> lk(state.lock);
+			auto period = std::max(state.threshold / 4, chrono::milliseconds(1));
+			state.cv.wait_for(lk, period, [&state]() { return state.exit; });
+			if (state.exit)
+				return;
+		}
+		Scan();
+	}
+}
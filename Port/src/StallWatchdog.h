@@ -0,0 +1,77 @@
+#ifndef _STALL_WATCHDOG_H
+#define _STALL_WATCHDOG_H
+
+/// @file
+/// @brief Detects thread loops stuck within one message.
+///
+/// @details Each monitored loop owns a Heartbeat, see ThreadRegistry.h. The loop
+/// calls Beat() as it starts each message and Idle() before it blocks waiting for
+/// the next one. Both are relaxed atomic stores, so the loop takes no lock and 
+/// shares no cache line written by other threads. A single StallWatchdog thread 
+/// scans the heartbeats and reports a loop busy with one message for longer than
+/// the threshold, once per stalled message, with its queue depth and optionally 
+/// the stack of the stuck thread. Stack capture is only supported on Linux with
+/// glibc.
+
+#include "ThreadRegistry.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/// @brief A stalled loop found by the watchdog
+struct StallReport
+{
+	/// The loop name
+	std::string name;
+
+	/// The type passed to Heartbeat::Beat() or Busy() for the stalled work
+	uintptr_t type;
+
+	/// Time spent within the message so far
+	std::chrono::milliseconds stalled;
+
+	/// Messages queued behind the stalled one, or 0 if unknown
+	size_t queueDepth;
+
+	/// The stack of the stuck thread, one frame per entry. Empty unless stack
+	/// capture is enabled and supported.
+	std::vector<std::string> stack;
+};
+
+/// @brief Scans the registered heartbeats on a single thread
+class StallWatchdog
+{
+public:
+	/// Called on the watchdog thread for each stall found
+	typedef std::function<void(const StallReport&)> StallCallback;
+
+	/// Start the watchdog thread. Heartbeats registered before or after are
+	/// monitored. Stalls are written to std::cout if no callback is set.
+	/// @param[in] threshold - the time within one message reported as a stall
+	/// @param[in] captureStacks - true to capture the stack of a stuck thread
+	/// @return True if the watchdog was started.
+	static bool Start(std::chrono::milliseconds threshold, bool captureStacks = false);
+
+	/// Stop the watchdog thread
+	static void Stop();
+
+	/// Set the function called for each stall found. Function call is thread-safe.
+	/// @param[in] callback - the stall callback, or empty to write to std::cout
+	static void SetStallCallback(StallCallback callback);
+
+	/// Scan the heartbeats once on the calling thread. Called periodically by
+	/// the watchdog thread.
+	/// @return The number of new stalls found.
+	static size_t Scan();
+
+private:
+	/// Capture the stack of a thread
+	static std::vector<std::string> CaptureStack(Heartbeat& heartbeat);
+
+	/// Entry point for the watchdog thread
+	static void Process();
+};
+
+#endif
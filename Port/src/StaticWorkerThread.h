@@ -0,0 +1,295 @@
+#ifndef _STATIC_WORKER_THREAD_H
+#define _STATIC_WORKER_THREAD_H
+
+/// @file
+/// @brief A delegate thread whose queue, stack and message storage are sized at
+/// compile time, for RTOS targets.
+///
+/// @details StaticWorkerThread runs asynchronous delegates and the timers of its
+/// TimerSet on one task, like WorkerThread, without allocating once created.
+/// The queue is a ring of QueueDepth slots held within the object. A sender
+/// dispatching to a full queue waits for a slot. Messages are allocated from a
+/// pool of PoolBlocks blocks of BlockSize bytes, also held within the object and
+/// returned by GetMemoryResource(), so a message larger than a block or
+/// dispatched while the pool is empty fails with std::bad_alloc, or
+/// DelegateError::BAD_ALLOC with exceptions disabled. Declare the thread static
+/// so its storage is reserved at link time.
+///
+/// The task, mutex and semaphores are the RtosPort primitives, so defining
+/// USE_FREERTOS builds the thread on FreeRTOS static tasks and semaphores, and
+/// the host build runs the same code on std::thread. The thread services only
+/// its own TimerSet, not the default timers every WorkerThread services.
+
+#include "DelegateError.h"
+#include "DelegateMsg.h"
+#include "DelegateThread.h"
+#include "DelegateInvoker.h"
+#include "RtosPort.h"
+#include "Timer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+
+/// @brief A memory resource of fixed size blocks held within the object.
+/// Thread safe.
+/// @tparam BlockSize The size of each block in bytes.
+/// @tparam Blocks The number of blocks.
+template <size_t BlockSize, size_t Blocks>
+class StaticBlockResource : public std::pmr::memory_resource
+{
+public:
+	static_assert(BlockSize >= sizeof(void*), "A free block holds the free list link");
+
+	StaticBlockResource()
+	{
+		for (size_t i = 0; i < Blocks; i++)
+			Push(m_storage + i * BLOCK_STRIDE);
+	}
+
+	/// Get the number of blocks not allocated
+	size_t GetFree()
+	{
+		std::lock_guard<RtosPort::Mutex> lock(m_lock);
+		return m_free;
+	}
+
+private:
+	StaticBlockResource(const StaticBlockResource&) = delete;
+	StaticBlockResource& operator=(const StaticBlockResource&) = delete;
+
+	static const size_t BLOCK_STRIDE = (BlockSize + alignof(std::max_align_t) - 1) /
+		alignof(std::max_align_t) * alignof(std::max_align_t);
+
+	void* do_allocate(size_t bytes, size_t alignment) override
+	{
+		void* block = nullptr;
+		if (bytes <= BlockSize && alignment <= alignof(std::max_align_t))
+		{
+			std::lock_guard<RtosPort::Mutex> lock(m_lock);
+			if (m_head)
+			{
+				block = m_head;
+				m_head = *static_cast<void**>(block);
+				m_free--;
+			}
+		}
+		if (!block)
+			DELEGATE_THROW(DelegateLib::DelegateError::BAD_ALLOC, std::bad_alloc());
+		return block;
+	}
+
+	void do_deallocate(void* p, size_t, size_t) override
+	{
+		std::lock_guard<RtosPort::Mutex> lock(m_lock);
+		Push(p);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+	{
+		return this == &other;
+	}
+
+	void Push(void* block)
+	{
+		*static_cast<void**>(block) = m_head;
+		m_head = block;
+		m_free++;
+	}
+
+	alignas(std::max_align_t) unsigned char m_storage[BLOCK_STRIDE * Blocks];
+	void* m_head = nullptr;
+	size_t m_free = 0;
+	RtosPort::Mutex m_lock;
+};
+
+/// @tparam QueueDepth The number of messages queued before a sender waits.
+/// @tparam PoolBlocks The number of message blocks, shared by queued messages and
+///		messages held elsewhere, e.g. by a blocking call's sender.
+/// @tparam BlockSize The size of a message block in bytes.
+/// @tparam StackWords The FreeRTOS task stack depth in words. Unused on the host.
+template <size_t QueueDepth, size_t PoolBlocks = QueueDepth * 2, size_t BlockSize = 256, size_t StackWords = 1024>
+class StaticWorkerThread : public DelegateLib::DelegateThread
+{
+public:
+	static_assert(QueueDepth > 0, "The queue holds at least one message");
+
+	/// Constructor
+	/// @param[in] threadName - the task name. Must outlive the thread.
+	/// @param[in] priority - the FreeRTOS task priority. Unused on the host.
+	explicit StaticWorkerThread(const char* threadName, int priority = 1) :
+		THREAD_NAME(threadName), m_priority(priority)
+	{
+		m_timers.SetStartedHook(&StaticWorkerThread::WakeTimers, this);
+	}
+
+	/// Destructor. Exits the thread.
+	~StaticWorkerThread()
+	{
+		ExitThread();
+		m_timers.SetStartedHook(nullptr, nullptr);
+	}
+
+	/// Start the task
+	/// @return True if the task is running.
+	bool CreateThread()
+	{
+		if (m_running.load(std::memory_order_acquire))
+			return true;
+		m_running.store(true, std::memory_order_release);
+		if (!m_task.Start(THREAD_NAME, m_priority, &StaticWorkerThread::Run, this))
+			m_running.store(false, std::memory_order_release);
+		return m_running.load(std::memory_order_acquire);
+	}
+
+	/// Exit the task once the messages already queued are invoked, and wait for it
+	void ExitThread()
+	{
+		if (!m_running.exchange(false, std::memory_order_acq_rel))
+			return;
+		Push(nullptr);
+		m_task.Join();
+	}
+
+	/// Get the task name
+	const char* GetThreadName() const { return THREAD_NAME; }
+
+	/// Get the timers serviced by this thread
+	TimerSet& GetTimers() { return m_timers; }
+
+	/// Get the number of message blocks not allocated
+	size_t GetPoolFree() { return m_pool.GetFree(); }
+
+	/// Get the number of queued messages
+	size_t GetQueueSize()
+	{
+		std::lock_guard<RtosPort::Mutex> lock(m_lock);
+		return m_count;
+	}
+
+	void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg) override
+	{
+		if (!m_running.load(std::memory_order_acquire))
+		{
+#ifdef DELEGATE_NO_EXCEPTIONS
+			DelegateLib::ReportDelegateError(DelegateLib::DelegateError::THREAD_NOT_RUNNING);
+			return;
+#else
+			throw std::invalid_argument("Thread not created");
+#endif
+		}
+		Push(std::move(msg));
+	}
+
+	bool IsOrdered() const override { return true; }
+
+	std::pmr::memory_resource* GetMemoryResource() const override { return &m_pool; }
+
+private:
+	StaticWorkerThread(const StaticWorkerThread&) = delete;
+	StaticWorkerThread& operator=(const StaticWorkerThread&) = delete;
+
+	/// Queue a message, waiting for a free slot. A null message exits the task.
+	void Push(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+	{
+		m_space.Take(RtosPort::WAIT_FOREVER);
+		bool wake;
+		{
+			std::lock_guard<RtosPort::Mutex> lock(m_lock);
+			m_slots[(m_head + m_count) % QueueDepth] = std::move(msg);
+			wake = m_count++ == 0;
+		}
+		if (wake)
+			m_wake.Give();
+	}
+
+	/// Take the oldest message
+	/// @param[out] msg - the message
+	/// @return True if a message was queued.
+	bool Pop(std::shared_ptr<DelegateLib::DelegateMsg>& msg)
+	{
+		{
+			std::lock_guard<RtosPort::Mutex> lock(m_lock);
+			if (m_count == 0)
+				return false;
+			msg = std::move(m_slots[m_head]);
+			m_head = (m_head + 1) % QueueDepth;
+			m_count--;
+		}
+		m_space.Give();
+		return true;
+	}
+
+	/// Get the time until the next timer is due
+	std::chrono::microseconds GetTimerTimeout()
+	{
+		std::chrono::microseconds next;
+		if (!m_timers.GetNextExpiration(next))
+			return RtosPort::WAIT_FOREVER;
+		auto now = Timer::GetTime();
+		return next > now ? next - now : std::chrono::microseconds(0);
+	}
+
+	static void Run(void* context)
+	{
+		static_cast<StaticWorkerThread*>(context)->Process();
+	}
+
+	/// Task loop. Invokes the queued messages and the timers due until the exit
+	/// message is taken.
+	void Process()
+	{
+		std::shared_ptr<DelegateLib::DelegateMsg> msg;
+		while (1)
+		{
+			if (Pop(msg))
+			{
+				if (!msg)
+					break;
+				if (!msg->IsCancelled())
+				{
+					auto invoker = msg->GetDelegateInvoker();
+					if (invoker)
+						invoker->Invoke(std::move(msg));
+				}
+				msg = nullptr;
+			}
+			else
+				m_wake.Take(GetTimerTimeout());
+			m_timers.ProcessTimers();
+		}
+	}
+
+	/// Wake the task after a timer is started earlier than the next expiration
+	static void WakeTimers(void* context)
+	{
+		static_cast<StaticWorkerThread*>(context)->m_wake.Give();
+	}
+
+	const char* THREAD_NAME;
+	const int m_priority;
+	std::atomic<bool> m_running{ false };
+	RtosPort::Task<StackWords> m_task;
+
+	/// Queued messages. Protected by m_lock.
+	std::shared_ptr<DelegateLib::DelegateMsg> m_slots[QueueDepth];
+	size_t m_head = 0;
+	size_t m_count = 0;
+	RtosPort::Mutex m_lock;
+
+	/// Counts the free slots
+	RtosPort::Semaphore m_space{ QueueDepth, QueueDepth };
+
+	/// Given when the queue becomes non-empty or a timer is started
+	RtosPort::Semaphore m_wake{ 0, QueueDepth + 1 };
+
+	mutable StaticBlockResource<BlockSize, PoolBlocks> m_pool;
+	TimerSet m_timers;
+};
+
+#endif
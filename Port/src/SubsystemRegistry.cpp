@@ -0,0 +1,216 @@
+#include "SubsystemRegistry.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <thread>
+
+using namespace std;
+
+//----------------------------------------------------------------------------
+// GetState
+//----------------------------------------------------------------------------
+SubsystemRegistry::State& SubsystemRegistry::GetState()
+{
+	static State* state = new State();
+	return *state;
+}
+
+//----------------------------------------------------------------------------
+// Register
+//----------------------------------------------------------------------------
+bool SubsystemRegistry::Register(const std::string& name, const std::vector<std::string>& dependencies, StartFunc start)
+{
+	State& state = GetState();
+	lock_guard<mutex> lock(state.lock);
+	if (state.ready.count(name))
+		return false;
+	for (const Subsystem& subsystem : state.pending)
+	{
+		if (subsystem.name == name)
+			return false;
+	}
+	state.pending.push_back(Subsystem{ name, dependencies, std::move(start) });
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// Start
+//----------------------------------------------------------------------------
+std::vector<SubsystemRegistry::SubsystemInfo> SubsystemRegistry::Start(unsigned threads)
+{
+	State& state = GetState();
+	vector<Subsystem> subsystems;
+	set<string> started;
+	{
+		lock_guard<mutex> lock(state.lock);
+		subsystems.swap(state.pending);
+		started = state.ready;
+	}
+
+	const size_t count = subsystems.size();
+	vector<SubsystemInfo> infos(count);
+	map<string, size_t> index;
+	for (size_t i = 0; i < count; i++)
+	{
+		infos[i].name = subsystems[i].name;
+		infos[i].ready = false;
+		infos[i].waited = infos[i].startTime = infos[i].readyTime = std::chrono::microseconds(0);
+		index[subsystems[i].name] = i;
+	}
+
+	// The number of dependencies each subsystem waits on, and the subsystems
+	// waiting on each. A subsystem with an unknown dependency never starts.
+	vector<size_t> waiting(count, 0);
+	vector<vector<size_t>> dependents(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		for (const string& dependency : subsystems[i].dependencies)
+		{
+			auto found = index.find(dependency);
+			if (found != index.end())
+			{
+				waiting[i]++;
+				dependents[found->second].push_back(i);
+			}
+			else if (!started.count(dependency) && infos[i].error.empty())
+				infos[i].error = "unknown dependency " + dependency;
+		}
+	}
+
+	// Find the subsystems that will start: those whose dependencies all start
+	vector<bool> runnable(count, false);
+	{
+		vector<size_t> remaining = waiting;
+		deque<size_t> ready;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (remaining[i] == 0 && infos[i].error.empty())
+				ready.push_back(i);
+		}
+		while (!ready.empty())
+		{
+			size_t i = ready.front();
+			ready.pop_front();
+			runnable[i] = true;
+			for (size_t dependent : dependents[i])
+			{
+				if (--remaining[dependent] == 0 && infos[dependent].error.empty())
+					ready.push_back(dependent);
+			}
+		}
+	}
+
+	// Explain each subsystem that will not start. Following a dependency not
+	// started either ends at an unknown dependency or loops.
+	vector<bool> unknown(count);
+	for (size_t i = 0; i < count; i++)
+		unknown[i] = !infos[i].error.empty();
+	for (size_t i = 0; i < count; i++)
+	{
+		if (runnable[i] || unknown[i])
+			continue;
+		string blocker;
+		vector<bool> visited(count, false);
+		size_t at = i;
+		while (!visited[at] && !unknown[at])
+		{
+			visited[at] = true;
+			for (const string& dependency : subsystems[at].dependencies)
+			{
+				auto found = index.find(dependency);
+				if (found != index.end() && !runnable[found->second])
+				{
+					if (at == i)
+						blocker = dependency;
+					at = found->second;
+					break;
+				}
+			}
+		}
+		infos[i].error = at == i ? "dependency cycle through " + blocker : "dependency " + blocker + " not ready";
+	}
+
+	// Start the subsystems on the startup threads, each once its dependencies
+	// are ready
+	size_t toStart = (size_t)std::count(runnable.begin(), runnable.end(), true);
+	mutex lock;
+	condition_variable cv;
+	deque<size_t> ready;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (runnable[i] && waiting[i] == 0)
+			ready.push_back(i);
+	}
+
+	const auto begin = std::chrono::steady_clock::now();
+	auto since = [begin](std::chrono::steady_clock::time_point time) {
+		return std::chrono::duration_cast<std::chrono::microseconds>(time - begin);
+	};
+	auto work = [&]() {
+		unique_lock<mutex> lk(lock);
+		while (1)
+		{
+			cv.wait(lk, [&]() { return !ready.empty() || toStart == 0; });
+			if (ready.empty())
+				return;
+			size_t i = ready.front();
+			ready.pop_front();
+			lk.unlock();
+
+			auto called = std::chrono::steady_clock::now();
+			if (subsystems[i].start)
+				subsystems[i].start();
+			auto done = std::chrono::steady_clock::now();
+
+			lk.lock();
+			infos[i].ready = true;
+			infos[i].waited = since(called);
+			infos[i].startTime = std::chrono::duration_cast<std::chrono::microseconds>(done - called);
+			infos[i].readyTime = since(done);
+			toStart--;
+			for (size_t dependent : dependents[i])
+			{
+				if (--waiting[dependent] == 0 && runnable[dependent])
+					ready.push_back(dependent);
+			}
+			cv.notify_all();
+		}
+	};
+
+	if (threads == 0)
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	size_t helpers = std::min<size_t>(threads, toStart);
+	vector<thread> pool;
+	for (size_t i = 1; i < helpers; i++)
+		pool.emplace_back(work);
+	work();
+	for (thread& t : pool)
+		t.join();
+
+	{
+		lock_guard<mutex> lk(state.lock);
+		for (const SubsystemInfo& info : infos)
+		{
+			if (info.ready)
+				state.ready.insert(info.name);
+		}
+	}
+	return infos;
+}
+
+//----------------------------------------------------------------------------
+// Dump
+//----------------------------------------------------------------------------
+void SubsystemRegistry::Dump(std::ostream& os, const std::vector<SubsystemInfo>& subsystems)
+{
+	os << left << setw(24) << "Subsystem" << right << setw(12) << "Waited us" << setw(12) << "Start us"
+		<< setw(12) << "Ready us" << "  State" << endl;
+	for (const SubsystemInfo& info : subsystems)
+	{
+		os << left << setw(24) << info.name << right << setw(12) << info.waited.count() << setw(12)
+			<< info.startTime.count() << setw(12) << info.readyTime.count() << "  "
+			<< (info.ready ? "ready" : info.error) << endl;
+	}
+}
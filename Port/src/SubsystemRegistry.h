@@ -0,0 +1,92 @@
+#ifndef _SUBSYSTEM_REGISTRY_H
+#define _SUBSYSTEM_REGISTRY_H
+
+/// @file
+/// @brief Starts the registered subsystems in parallel in dependency order.
+///
+/// @details Each subsystem registers a start function and the names of the
+/// subsystems it depends on. Start() runs the start functions on a pool of
+/// startup threads. A subsystem starts as soon as every dependency has started,
+/// so independent subsystems start concurrently and startup takes about the
+/// longest dependency chain rather than the sum of every start time. Start()
+/// reports when each subsystem became ready. A subsystem with an unknown
+/// dependency, within a dependency cycle, or depending on such a subsystem is
+/// not started.
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+/// @brief The registry of subsystems to start
+class SubsystemRegistry
+{
+public:
+	/// Start a subsystem. Called on a startup thread.
+	typedef std::function<void()> StartFunc;
+
+	/// The startup of one subsystem
+	struct SubsystemInfo
+	{
+		/// The subsystem name
+		std::string name;
+
+		/// True if the subsystem started
+		bool ready;
+
+		/// Time from Start() until the start function was called, i.e. until
+		/// every dependency was ready and a startup thread was free
+		std::chrono::microseconds waited;
+
+		/// Time the start function took
+		std::chrono::microseconds startTime;
+
+		/// Time from Start() until the subsystem was ready
+		std::chrono::microseconds readyTime;
+
+		/// Why the subsystem was not started, or empty if ready
+		std::string error;
+	};
+
+	/// Register a subsystem. Function call is thread-safe.
+	/// @param[in] name - the unique subsystem name
+	/// @param[in] dependencies - the names of the subsystems started first
+	/// @param[in] start - the start function
+	/// @return False if a subsystem of the name is already registered.
+	static bool Register(const std::string& name, const std::vector<std::string>& dependencies, StartFunc start);
+
+	/// Start every subsystem registered since the last call and wait for them.
+	/// A dependency may name a subsystem started by an earlier call.
+	/// @param[in] threads - the number of startup threads. 0 uses one per core.
+	/// @return The subsystems in registration order.
+	static std::vector<SubsystemInfo> Start(unsigned threads = 0);
+
+	/// Write a table of subsystem startup, one line per subsystem
+	/// @param[in] os - the output stream
+	/// @param[in] subsystems - the subsystems returned by Start()
+	static void Dump(std::ostream& os, const std::vector<SubsystemInfo>& subsystems);
+
+private:
+	/// A registered subsystem not yet started
+	struct Subsystem
+	{
+		std::string name;
+		std::vector<std::string> dependencies;
+		StartFunc start;
+	};
+
+	/// Registry state. Never destroyed.
+	struct State
+	{
+		std::mutex lock;
+		std::vector<Subsystem> pending;
+		std::set<std::string> ready;
+	};
+
+	static State& GetState();
+};
+
+#endif
@@ -0,0 +1,259 @@
+#include "ThreadAttributes.h"
+#include <mutex>
+#include <set>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__) && defined(__GLIBC__) && __has_include(<sys/rseq.h>)
+#include <sys/rseq.h>
+#define HAVE_RSEQ
+#endif
+
+using namespace std;
+
+/// Serializes changes to the process default thread stack size
+static std::mutex stackLock;
+
+//----------------------------------------------------------------------------
+// GetNodeCpus
+//----------------------------------------------------------------------------
+static bool GetNodeCpus(int node, std::set<unsigned>& cpus)
+{
+#if defined(__linux__)
+	// The node CPU list has the form "0-3,8-11"
+	char path[64];
+	snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+	FILE* file = fopen(path, "r");
+	if (!file)
+		return false;
+
+	char list[1024] = {};
+	bool success = fgets(list, sizeof(list), file) != nullptr;
+	fclose(file);
+
+	for (char* p = list; success && *p && *p != '\n'; )
+	{
+		char* end;
+		unsigned first = (unsigned)strtoul(p, &end, 10);
+		unsigned last = first;
+		if (end == p)
+			break;
+		if (*end == '-')
+		{
+			p = end + 1;
+			last = (unsigned)strtoul(p, &end, 10);
+		}
+		for (unsigned cpu = first; cpu <= last; cpu++)
+			cpus.insert(cpu);
+		p = (*end == ',') ? end + 1 : end;
+	}
+	return success && !cpus.empty();
+#else
+	(void)node;
+	(void)cpus;
+	return false;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// ApplyThreadAttributes
+//----------------------------------------------------------------------------
+bool ApplyThreadAttributes(std::thread& thread, const ThreadAttributes& attributes)
+{
+	bool success = true;
+
+	// Restrict the CPUs to the NUMA node if one is selected
+	std::set<unsigned> cpus(attributes.cpus.begin(), attributes.cpus.end());
+#ifdef WIN32
+	GROUP_AFFINITY nodeAffinity = {};
+	if (attributes.numaNode >= 0)
+	{
+		if (GetNumaNodeProcessorMaskEx((USHORT)attributes.numaNode, &nodeAffinity))
+		{
+			if (!cpus.empty())
+			{
+				KAFFINITY mask = 0;
+				for (unsigned cpu : cpus)
+					if (cpu < sizeof(KAFFINITY) * 8)
+						mask |= KAFFINITY(1) << cpu;
+				nodeAffinity.Mask &= mask;
+			}
+			success &= nodeAffinity.Mask != 0 &&
+				SetThreadGroupAffinity(thread.native_handle(), &nodeAffinity, NULL);
+		}
+		else
+			success = false;
+	}
+	else if (!cpus.empty())
+	{
+		DWORD_PTR mask = 0;
+		for (unsigned cpu : cpus)
+			if (cpu < sizeof(DWORD_PTR) * 8)
+				mask |= DWORD_PTR(1) << cpu;
+		success &= mask != 0 && SetThreadAffinityMask(thread.native_handle(), mask) != 0;
+	}
+
+	if (attributes.policy != ThreadAttributes::SchedPolicy::DEFAULT)
+	{
+		int priority = attributes.priority;
+		if (attributes.policy == ThreadAttributes::SchedPolicy::IDLE)
+			priority = THREAD_PRIORITY_IDLE;
+		success &= SetThreadPriority(thread.native_handle(), priority) != 0;
+	}
+#else
+	if (attributes.numaNode >= 0)
+	{
+		std::set<unsigned> nodeCpus;
+		if (GetNodeCpus(attributes.numaNode, nodeCpus))
+		{
+			if (cpus.empty())
+				cpus = nodeCpus;
+			else
+			{
+				std::set<unsigned> both;
+				for (unsigned cpu : cpus)
+					if (nodeCpus.count(cpu))
+						both.insert(cpu);
+				cpus = both;
+				success &= !cpus.empty();
+			}
+		}
+		else
+			success = false;
+	}
+
+#if defined(__linux__)
+	if (!cpus.empty())
+	{
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (unsigned cpu : cpus)
+			if (cpu < CPU_SETSIZE)
+				CPU_SET(cpu, &set);
+		success &= pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+	}
+#else
+	success &= cpus.empty();
+#endif
+
+	if (attributes.policy != ThreadAttributes::SchedPolicy::DEFAULT)
+	{
+		int policy = SCHED_OTHER;
+		switch (attributes.policy)
+		{
+			case ThreadAttributes::SchedPolicy::FIFO: policy = SCHED_FIFO; break;
+			case ThreadAttributes::SchedPolicy::RR: policy = SCHED_RR; break;
+#if defined(__linux__)
+			case ThreadAttributes::SchedPolicy::BATCH: policy = SCHED_BATCH; break;
+			case ThreadAttributes::SchedPolicy::IDLE: policy = SCHED_IDLE; break;
+#endif
+			default: policy = SCHED_OTHER; break;
+		}
+
+		sched_param param = {};
+		param.sched_priority = attributes.priority;
+		success &= pthread_setschedparam(thread.native_handle(), policy, &param) == 0;
+	}
+#endif
+	return success;
+}
+
+//----------------------------------------------------------------------------
+// ThreadStackScope
+//----------------------------------------------------------------------------
+ThreadStackScope::ThreadStackScope(size_t stackSize)
+{
+#if defined(__GLIBC__)
+	if (stackSize == 0)
+		return;
+
+	stackLock.lock();
+	pthread_attr_t attr;
+	if (pthread_getattr_default_np(&attr) == 0)
+	{
+		pthread_attr_getstacksize(&attr, &m_previous);
+		if (pthread_attr_setstacksize(&attr, stackSize) == 0 && pthread_setattr_default_np(&attr) == 0)
+			m_set = true;
+		pthread_attr_destroy(&attr);
+	}
+	if (!m_set)
+		stackLock.unlock();
+#else
+	(void)stackSize;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// ~ThreadStackScope
+//----------------------------------------------------------------------------
+ThreadStackScope::~ThreadStackScope()
+{
+#if defined(__GLIBC__)
+	if (!m_set)
+		return;
+
+	// Restore the previous default for threads created after the scope
+	pthread_attr_t attr;
+	if (pthread_getattr_default_np(&attr) == 0)
+	{
+		pthread_attr_setstacksize(&attr, m_previous);
+		pthread_setattr_default_np(&attr);
+		pthread_attr_destroy(&attr);
+	}
+	stackLock.unlock();
+#endif
+}
+
+//----------------------------------------------------------------------------
+// GetCurrentNumaNode
+//----------------------------------------------------------------------------
+int GetCurrentNumaNode()
+{
+#if defined(WIN32)
+	PROCESSOR_NUMBER processor;
+	GetCurrentProcessorNumberEx(&processor);
+	USHORT node;
+	return GetNumaProcessorNodeEx(&processor, &node) ? (int)node : -1;
+#elif defined(__linux__)
+	unsigned cpu = 0, node = 0;
+	return syscall(SYS_getcpu, &cpu, &node, nullptr) == 0 ? (int)node : -1;
+#else
+	return -1;
+#endif
+}
+
+//----------------------------------------------------------------------------
+// GetCurrentCpu
+//----------------------------------------------------------------------------
+unsigned GetCurrentCpu()
+{
+#if defined(WIN32)
+	return GetCurrentProcessorNumber();
+#elif defined(__linux__)
+#ifdef HAVE_RSEQ
+	// glibc registers a restartable sequence area for each thread. The kernel
+	// updates its cpu_id before the thread resumes on another CPU, so a plain 
+	// load reads the current CPU.
+	if (__rseq_size > 0)
+	{
+		const volatile struct rseq* area = reinterpret_cast<const volatile struct rseq*>(
+			static_cast<char*>(__builtin_thread_pointer()) + __rseq_offset);
+		return area->cpu_id;
+	}
+#endif
+	int cpu = sched_getcpu();
+	return cpu < 0 ? 0 : (unsigned)cpu;
+#else
+	return 0;
+#endif
+}
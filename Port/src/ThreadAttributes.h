@@ -0,0 +1,95 @@
+#ifndef _THREAD_ATTRIBUTES_H
+#define _THREAD_ATTRIBUTES_H
+
+#include <thread>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+/// @brief Portable thread placement and scheduling attributes. Default values
+/// leave the operating system defaults unchanged.
+struct ThreadAttributes
+{
+	/// Scheduling policy. Real-time policies usually require elevated privileges.
+	enum class SchedPolicy
+	{
+		DEFAULT,	///< Leave the scheduling policy and priority unchanged
+		OTHER,		///< Normal time-sharing (SCHED_OTHER)
+		BATCH,		///< CPU-bound batch work (SCHED_BATCH). Linux only.
+		IDLE,		///< Only run when the CPU is otherwise idle (SCHED_IDLE)
+		FIFO,		///< Real-time first in, first out (SCHED_FIFO)
+		RR			///< Real-time round robin (SCHED_RR)
+	};
+
+	/// CPUs the thread may run on. Empty for no affinity.
+	std::vector<unsigned> cpus;
+
+	SchedPolicy policy = SchedPolicy::DEFAULT;
+
+	/// Scheduling priority. Linux: 1 to 99 for FIFO and RR, otherwise 0. Windows:
+	/// a THREAD_PRIORITY_* value applied when policy is not DEFAULT.
+	int priority = 0;
+
+	/// Stack size in bytes. 0 for the default stack size.
+	size_t stackSize = 0;
+
+	/// NUMA node the thread is placed on, or -1 for none. The thread runs on the
+	/// node's CPUs, or on the node's CPUs within cpus if both are set, so memory
+	/// it first touches is allocated on the node.
+	int numaNode = -1;
+};
+
+/// Apply the placement and scheduling attributes to a running thread. The stack 
+/// size applies only at creation, see StartThread().
+/// @param[in] thread - the thread
+/// @param[in] attributes - the attributes to apply
+/// @return True if all attributes were applied.
+bool ApplyThreadAttributes(std::thread& thread, const ThreadAttributes& attributes);
+
+/// Get the NUMA node of the CPU the calling thread runs on
+/// @return The NUMA node, or -1 if unknown.
+int GetCurrentNumaNode();
+
+/// Get the CPU the calling thread runs on. On Linux the CPU is read from the 
+/// thread's restartable sequence (rseq) area when glibc registered one, so the
+/// call costs a load rather than a system call. The thread may migrate as soon
+/// as the call returns.
+/// @return The CPU index, or 0 if unknown.
+unsigned GetCurrentCpu();
+
+/// @brief Sets the stack size of threads created within the scope. Only 
+/// supported with glibc, elsewhere the default stack size is used. Scopes are 
+/// serialized so concurrent StartThread() calls do not interfere.
+class ThreadStackScope
+{
+public:
+	explicit ThreadStackScope(size_t stackSize);
+	~ThreadStackScope();
+
+private:
+	ThreadStackScope(const ThreadStackScope&) = delete;
+	ThreadStackScope& operator=(const ThreadStackScope&) = delete;
+
+	size_t m_previous = 0;
+	bool m_set = false;
+};
+
+/// Create a thread with attributes
+/// @param[in] attributes - the thread attributes
+/// @param[in] func - the thread entry point
+/// @param[in] args - the entry point arguments
+/// @return The created thread.
+template <class Func, class... Args>
+std::unique_ptr<std::thread> StartThread(const ThreadAttributes& attributes, Func&& func, Args&&... args)
+{
+	std::unique_ptr<std::thread> thread;
+	{
+		ThreadStackScope stack(attributes.stackSize);
+		thread.reset(new std::thread(std::forward<Func>(func), std::forward<Args>(args)...));
+	}
+	ApplyThreadAttributes(*thread, attributes);
+	return thread;
+}
+
+#endif
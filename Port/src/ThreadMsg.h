@@ -1,8 +1,13 @@
 #ifndef _THREAD_MSG_H
 #define _THREAD_MSG_H
 
+#include "RingQueue.h"
+#include <memory>
+#include <chrono>
+
 /// @brief A class to hold a platform-specific thread messsage that will be passed 
-/// through the OS message queue. 
+/// through the OS message queue. A ThreadMsg is queued by value so dispatching
+/// allocates nothing beyond the delegate message.
 class ThreadMsg
 {
 public:
@@ -13,18 +18,26 @@ public:
 	/// @pre The data pointer argument *must* be created on the heap.
 	/// @port The destination thread will delete the heap allocated data once the 
 	///		callback is complete.  
-	ThreadMsg(int id, std::shared_ptr<DelegateLib::DelegateMsg> data) :
+	ThreadMsg(int id = 0, std::shared_ptr<DelegateLib::DelegateMsg> data = nullptr) :
 		m_id(id), 
-		m_data(data)
+		m_data(std::move(data))
 	{
 	}
 
 	int GetId() const { return m_id; } 
-    std::shared_ptr<DelegateLib::DelegateMsg> GetData() { return m_data; }
+    std::shared_ptr<DelegateLib::DelegateMsg>& GetData() { return m_data; }
+
+	/// Set the time the message was queued. Only set while statistics are enabled.
+	void SetEnqueueTime(std::chrono::steady_clock::time_point time) { m_enqueueTime = time; }
+	std::chrono::steady_clock::time_point GetEnqueueTime() const { return m_enqueueTime; }
 
 private:
 	int m_id;
     std::shared_ptr<DelegateLib::DelegateMsg> m_data;
+	std::chrono::steady_clock::time_point m_enqueueTime;
 };
 
+/// FIFO queue of ThreadMsg values. ThreadMsgQueue is not thread-safe.
+typedef RingQueue<ThreadMsg> ThreadMsgQueue;
+
 #endif
@@ -0,0 +1,139 @@
+#include "ThreadRegistry.h"
+#include <algorithm>
+#include <iomanip>
+#include <thread>
+#include <ctime>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+/// Registry state. Never destroyed so heartbeats of static objects unregister
+/// safely at exit.
+struct RegistryState
+{
+	mutex lock;
+	vector<Heartbeat*> heartbeats;
+};
+
+//----------------------------------------------------------------------------
+// GetState
+//----------------------------------------------------------------------------
+static RegistryState& GetState()
+{
+	static RegistryState* state = new RegistryState();
+	return *state;
+}
+
+//----------------------------------------------------------------------------
+// GetLock
+//----------------------------------------------------------------------------
+std::mutex& ThreadRegistry::GetLock()
+{
+	return GetState().lock;
+}
+
+//----------------------------------------------------------------------------
+// GetHeartbeats
+//----------------------------------------------------------------------------
+std::vector<Heartbeat*>& ThreadRegistry::GetHeartbeats()
+{
+	return GetState().heartbeats;
+}
+
+//----------------------------------------------------------------------------
+// Heartbeat
+//----------------------------------------------------------------------------
+Heartbeat::Heartbeat(const std::string& name, QueueDepth queueDepth) :
+	m_name(name), m_queueDepth(std::move(queueDepth))
+{
+	RegistryState& state = GetState();
+	lock_guard<mutex> lock(state.lock);
+	state.heartbeats.push_back(this);
+}
+
+//----------------------------------------------------------------------------
+// ~Heartbeat
+//----------------------------------------------------------------------------
+Heartbeat::~Heartbeat()
+{
+	RegistryState& state = GetState();
+	lock_guard<mutex> lock(state.lock);
+	state.heartbeats.erase(std::remove(state.heartbeats.begin(), state.heartbeats.end(), this), state.heartbeats.end());
+}
+
+//----------------------------------------------------------------------------
+// ThreadScope
+//----------------------------------------------------------------------------
+Heartbeat::ThreadScope::ThreadScope(Heartbeat& heartbeat) : m_heartbeat(heartbeat)
+{
+#ifndef WIN32
+	m_heartbeat.m_thread = pthread_self();
+#endif
+#ifdef __linux__
+	m_heartbeat.m_nativeId = (uint64_t)syscall(SYS_gettid);
+#else
+	m_heartbeat.m_nativeId = (uint64_t)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+	m_heartbeat.m_bound.store(true, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// ~ThreadScope
+//----------------------------------------------------------------------------
+Heartbeat::ThreadScope::~ThreadScope()
+{
+	// Unbind under the lock so no thread accesses an exited thread
+	lock_guard<mutex> lock(GetState().lock);
+	m_heartbeat.m_bound.store(false, std::memory_order_relaxed);
+	m_heartbeat.Idle();
+}
+
+//----------------------------------------------------------------------------
+// GetThreads
+//----------------------------------------------------------------------------
+std::vector<ThreadRegistry::ThreadInfo> ThreadRegistry::GetThreads()
+{
+	vector<ThreadInfo> threads;
+	RegistryState& state = GetState();
+	lock_guard<mutex> lock(state.lock);
+	for (Heartbeat* heartbeat : state.heartbeats)
+	{
+		if (!heartbeat->m_bound.load(std::memory_order_acquire))
+			continue;
+
+		ThreadInfo info;
+		info.name = heartbeat->m_name;
+		info.nativeId = heartbeat->m_nativeId;
+		info.queueDepth = heartbeat->m_queueDepth ? heartbeat->m_queueDepth() : 0;
+		info.processed = heartbeat->m_processed.load(std::memory_order_relaxed);
+		info.busy = heartbeat->m_beat.load(std::memory_order_relaxed) != 0;
+		info.cpuTime = std::chrono::nanoseconds(0);
+#ifndef WIN32
+		clockid_t clock;
+		timespec ts;
+		if (pthread_getcpuclockid(heartbeat->m_thread, &clock) == 0 && clock_gettime(clock, &ts) == 0)
+			info.cpuTime = std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+#endif
+		threads.push_back(std::move(info));
+	}
+	return threads;
+}
+
+//----------------------------------------------------------------------------
+// Dump
+//----------------------------------------------------------------------------
+void ThreadRegistry::Dump(std::ostream& os)
+{
+	os << left << setw(24) << "Thread" << right << setw(10) << "ID" << setw(10) << "Queued"
+		<< setw(14) << "Processed" << setw(12) << "CPU ms" << "  State" << endl;
+	for (const ThreadInfo& info : GetThreads())
+	{
+		os << left << setw(24) << info.name << right << setw(10) << info.nativeId << setw(10) << info.queueDepth
+			<< setw(14) << info.processed << setw(12) << std::chrono::duration_cast<std::chrono::milliseconds>(info.cpuTime).count()
+			<< "  " << (info.busy ? "busy" : "idle") << endl;
+	}
+}
@@ -0,0 +1,148 @@
+#ifndef _THREAD_REGISTRY_H
+#define _THREAD_REGISTRY_H
+
+/// @file
+/// @brief Registry of the running thread loops for live introspection.
+///
+/// @details Each thread loop, e.g. a WorkerThread or the Logger thread, owns a
+/// Heartbeat. The loop binds the heartbeat to its thread with a ThreadScope for
+/// the life of its entry point, so a loop is listed from CreateThread() until
+/// ExitThread(). ThreadRegistry::GetThreads() reports each listed loop's name,
+/// native thread ID, queue depth, messages processed and CPU time. Queue depths
+/// are read from lock-free counters, so a diagnostics call never waits on a
+/// loop's queue lock. The StallWatchdog scans the same heartbeats.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#ifndef WIN32
+#include <pthread.h>
+#endif
+
+/// @brief The progress of one thread loop. Registered for its lifetime.
+class Heartbeat
+{
+public:
+	/// Get the number of queued messages without taking the loop's queue lock
+	typedef std::function<size_t()> QueueDepth;
+
+	/// Constructor
+	/// @param[in] name - the loop name
+	/// @param[in] queueDepth - returns the loop's queue depth, or empty if unknown
+	Heartbeat(const std::string& name, QueueDepth queueDepth = QueueDepth());
+
+	/// Destructor
+	~Heartbeat();
+
+	/// Record the start of a message and count it as processed. Called by the
+	/// loop thread.
+	/// @param[in] type - the message type reported on a stall
+	void Beat(uintptr_t type)
+	{
+		// Single writer, so no read-modify-write is needed
+		m_processed.store(m_processed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		Busy(type);
+	}
+
+	/// Record the start of work other than a message, e.g. expiring timers.
+	/// Called by the loop thread.
+	/// @param[in] type - the work type reported on a stall
+	void Busy(uintptr_t type)
+	{
+		m_type.store(type, std::memory_order_relaxed);
+		m_beat.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+	}
+
+	/// Record that the loop is waiting for a message. Called by the loop thread.
+	void Idle() { m_beat.store(0, std::memory_order_relaxed); }
+
+	/// @brief Binds the heartbeat to the calling loop thread for the scope of
+	/// the thread's entry point
+	class ThreadScope
+	{
+	public:
+		explicit ThreadScope(Heartbeat& heartbeat);
+		~ThreadScope();
+
+	private:
+		Heartbeat& m_heartbeat;
+	};
+
+private:
+	Heartbeat(const Heartbeat&) = delete;
+	Heartbeat& operator=(const Heartbeat&) = delete;
+
+	friend class ThreadRegistry;
+	friend class StallWatchdog;
+
+	const std::string m_name;
+	const QueueDepth m_queueDepth;
+
+	/// Steady clock time the current message started, or 0 while idle
+	std::atomic<int64_t> m_beat{ 0 };
+	std::atomic<uintptr_t> m_type{ 0 };
+	std::atomic<uint64_t> m_processed{ 0 };
+
+	/// The bound thread. Written before m_bound is set.
+#ifndef WIN32
+	pthread_t m_thread;
+#endif
+	uint64_t m_nativeId = 0;
+	std::atomic<bool> m_bound{ false };
+
+	/// The beat last reported by the StallWatchdog. Only accessed by the
+	/// watchdog thread.
+	int64_t m_reported = 0;
+};
+
+/// @brief Lists the thread loops currently running
+class ThreadRegistry
+{
+public:
+	/// A snapshot of one thread loop
+	struct ThreadInfo
+	{
+		/// The loop name
+		std::string name;
+
+		/// The OS thread ID, e.g. the Linux TID shown by top -H
+		uint64_t nativeId;
+
+		/// Messages queued, or 0 if unknown
+		size_t queueDepth;
+
+		/// Messages processed since the loop object was created
+		uint64_t processed;
+
+		/// CPU time used by the thread. Zero where unsupported.
+		std::chrono::nanoseconds cpuTime;
+
+		/// True while the loop is within a message
+		bool busy;
+	};
+
+	/// Get a snapshot of every running thread loop. Function call is thread-safe.
+	/// @return The loops in creation order.
+	static std::vector<ThreadInfo> GetThreads();
+
+	/// Write a table of the running thread loops, one line per loop
+	/// @param[in] os - the output stream
+	static void Dump(std::ostream& os);
+
+private:
+	friend class Heartbeat;
+	friend class StallWatchdog;
+
+	/// The registry lock, held while a heartbeat is accessed by another thread
+	static std::mutex& GetLock();
+
+	/// The registered heartbeats. Protected by GetLock().
+	static std::vector<Heartbeat*>& GetHeartbeats();
+};
+
+#endif
@@ -1,28 +1,107 @@
 #include "Timer.h"
 #include "Fault.h"
+#include "Clock.h"
+#include "Trace.h"
+#include "Metrics.h"
 #include <chrono>
+#include <algorithm>
 
 using namespace std;
 
-std::mutex Timer::m_lock;
-bool Timer::m_timerStopped = false;
-xlist<Timer*> Timer::m_timers;
+//------------------------------------------------------------------------------
+// ProcessTimers
+//------------------------------------------------------------------------------
+void TimerSet::ProcessTimers()
+{
+	TRACE_SCOPE("TimerSet::ProcessTimers");
+	std::vector<Timer*> batch;
+	std::unique_lock<DelegateLib::SiteMutex> lock(m_lock);
+
+	// Reuse the storage of an earlier batch, so a set serviced by one thread
+	// stops allocating once its batches have grown
+	batch.swap(m_spare);
+
+	// Collect each timer due. Periodic timers are rescheduled at once.
+	uint64_t now = (uint64_t)Timer::GetTime().count();
+	m_wheel.Advance(now, [now, &batch](TimerWheel::Entry* entry) {
+		Timer* timer = static_cast<Timer*>(entry);
+		timer->OnExpired(now);
+		batch.push_back(timer);
+	});
+	if (batch.empty())
+	{
+		batch.swap(m_spare);
+		return;
+	}
+
+	// Call back without the lock so callbacks may start, stop or destroy other
+	// timers. Async callbacks are dispatched once per target thread at the end.
+	DelegateLib::DispatchScope scope;
+	m_batches.push_back(&batch);
+	for (Timer*& entry : batch)
+	{
+		Timer* timer = entry;
+		if (!timer)
+			continue;
+		timer->m_invoking++;
+		lock.unlock();
+		timer->Expired();
+		lock.lock();
+		if (--timer->m_invoking == 0)
+			m_invokeDone.notify_all();
+	}
+	m_batches.erase(std::find(m_batches.begin(), m_batches.end(), &batch));
+	if (batch.capacity() > m_spare.capacity())
+	{
+		batch.clear();
+		batch.swap(m_spare);
+	}
+}
+
+//------------------------------------------------------------------------------
+// CancelPending
+//------------------------------------------------------------------------------
+void TimerSet::CancelPending(Timer* timer)
+{
+	for (std::vector<Timer*>* batch : m_batches)
+		std::replace(batch->begin(), batch->end(), timer, (Timer*)nullptr);
+}
 
 //------------------------------------------------------------------------------
-// TimerDisabled
+// GetNextExpiration
 //------------------------------------------------------------------------------
-static bool TimerDisabled (Timer* value)
+bool TimerSet::GetNextExpiration(std::chrono::microseconds& time)
 {
-	return !(value->Enabled());
+	const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+
+	uint64_t tick;
+	if (!m_wheel.GetNextTick(tick))
+		return false;
+	time = std::chrono::microseconds(tick);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// GetDefaultTimers
+//------------------------------------------------------------------------------
+TimerSet& Timer::GetDefaultTimers()
+{
+	static TimerSet timers;
+	return timers;
 }
 
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
-Timer::Timer() 
+Timer::Timer() : m_timers(GetDefaultTimers())
+{
+}
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+Timer::Timer(TimerSet& timers) : m_timers(timers)
 {
-	const std::lock_guard<std::mutex> lock(m_lock);
-	m_enabled = false;
 }
 
 //------------------------------------------------------------------------------
@@ -30,29 +109,57 @@ Timer::Timer()
 //------------------------------------------------------------------------------
 Timer::~Timer()
 {
-	const std::lock_guard<std::mutex> lock(m_lock);
-	m_timers.remove(this);
+	std::unique_lock<DelegateLib::SiteMutex> lock(m_timers.m_lock);
+	m_timers.m_wheel.Remove(this);
+	m_timers.CancelPending(this);
+	m_timers.m_invokeDone.wait(lock, [this]() { return m_invoking == 0; });
 }
 
 //------------------------------------------------------------------------------
 // Start
 //------------------------------------------------------------------------------
-void Timer::Start(std::chrono::milliseconds timeout)
+void Timer::Start(std::chrono::microseconds timeout, bool periodic)
 {
-	if (timeout <= std::chrono::milliseconds(0))
+	if (timeout <= std::chrono::microseconds(0))
 		throw std::invalid_argument("Timeout cannot be 0");
 
-	const std::lock_guard<std::mutex> lock(m_lock);
-
-	m_timeout = timeout;
-	m_expireTime = GetTime();
-	m_enabled = true;
-
-	// Remove the existing entry, if any, to prevent duplicates in the list
-	m_timers.remove(this);
+	TimerSet::StartedHook hook;
+	void* context;
+	{
+		const std::lock_guard<DelegateLib::SiteMutex> lock(m_timers.m_lock);
+
+		m_timeout = timeout;
+		m_periodic = periodic;
+		m_enabled = true;
+
+		// Restart the timer if already running
+		TimerWheel& wheel = m_timers.m_wheel;
+		wheel.Remove(this);
+		m_timers.CancelPending(this);
+
+		// A rearm no earlier than the next service time, e.g. a watchdog pushed 
+		// out again, is found when the servicing thread wakes for that time, so 
+		// the thread is only woken for an earlier expiration
+		uint64_t now = (uint64_t)GetTime().count();
+		m_due = now + (uint64_t)m_timeout.count();
+		uint64_t expire = Coalesce(m_due);
+		uint64_t next;
+		bool earlier = !wheel.GetNextTick(next) || expire < next;
+
+		// Add this timer to the wheel for servicing
+		wheel.Reset(now);
+		wheel.Insert(this, expire);
+		if (!earlier)
+			return;
+		m_timers.m_generation++;
+
+		hook = m_timers.m_startedHook;
+		context = m_timers.m_startedContext;
+	}
 
-	// Add this timer to the list for servicing
-	m_timers.push_back(this);
+	// Let the servicing thread wait on the new expiration
+	if (hook)
+		hook(context);
 }
 
 //------------------------------------------------------------------------------
@@ -60,74 +167,80 @@ void Timer::Start(std::chrono::milliseconds timeout)
 //------------------------------------------------------------------------------
 void Timer::Stop()
 {
-	const std::lock_guard<std::mutex> lock(m_lock);
+	const std::lock_guard<DelegateLib::SiteMutex> lock(m_timers.m_lock);
 
 	m_enabled = false;
-	m_timerStopped = true;
+	m_timers.m_wheel.Remove(this);
+	m_timers.CancelPending(this);
 }
 
 //------------------------------------------------------------------------------
-// CheckExpired
+// SetSlack
 //------------------------------------------------------------------------------
-void Timer::CheckExpired()
+void Timer::SetSlack(std::chrono::microseconds slack)
 {
-	if (!m_enabled)
-		return;
-
-	// Has the timer expired?
-    if (Difference(m_expireTime, GetTime()) < m_timeout)
-        return;
-
-    // Increment the timer to the next expiration
-	m_expireTime += m_timeout;
-
-	// Is the timer already expired after we incremented above?
-    if (Difference(m_expireTime, GetTime()) > m_timeout)
-	{
-		// The timer has fallen behind so set time expiration further forward.
-		m_expireTime = GetTime();
-	}
-
-	// Call the client's expired callback function
-	if (Expired)
-		Expired();
+	const std::lock_guard<DelegateLib::SiteMutex> lock(m_timers.m_lock);
+	m_slack = slack > std::chrono::microseconds(0) ? slack : std::chrono::microseconds(0);
 }
 
 //------------------------------------------------------------------------------
-// Difference
+// Coalesce
 //------------------------------------------------------------------------------
-std::chrono::milliseconds Timer::Difference(std::chrono::milliseconds time1, std::chrono::milliseconds time2)
+uint64_t Timer::Coalesce(uint64_t due) const
 {
-	return (time2 - time1);
+	uint64_t slack = (uint64_t)m_slack.count();
+	if (slack == 0)
+		return due;
+
+	// Timers rounded up to the same power of two boundary share a tick
+	uint64_t align = 1;
+	while (align <= slack / 2)
+		align <<= 1;
+	return (due + align - 1) & ~(align - 1);
 }
 
 //------------------------------------------------------------------------------
-// ProcessTimers
+// OnExpired
 //------------------------------------------------------------------------------
-void Timer::ProcessTimers()
+void Timer::OnExpired(uint64_t now)
 {
-	const std::lock_guard<std::mutex> lock(m_lock);
+	static DelegateLib::MetricCounter& expiredMetric = DelegateLib::Metrics::GetCounter("timer.expired");
+	expiredMetric.Add();
 
-	// Remove disabled timer from the list if stopped
-	if (m_timerStopped)
+	// A one-shot timer is disabled rather than reinserted
+	if (!m_periodic)
 	{
-		m_timers.remove_if(TimerDisabled);
-		m_timerStopped = false;
+		m_enabled = false;
+		return;
 	}
 
-	// Iterate through each timer and check for expirations
-	TimersIterator it;
-	for (it = m_timers.begin() ; it != m_timers.end(); it++ )
+	// Increment the timer to the next nominal expiration so slack never drifts the period
+	uint64_t timeout = (uint64_t)m_timeout.count();
+	m_due += timeout;
+
+	// Is the timer already expired after we incremented above?
+	if (m_due <= now)
 	{
-		if ((*it) != NULL)
-			(*it)->CheckExpired();
+		// The timer has fallen behind so set time expiration further forward.
+		m_due = now + timeout;
 	}
+	m_timers.m_wheel.Insert(this, Coalesce(m_due));
 }
 
-std::chrono::milliseconds Timer::GetTime()
+//------------------------------------------------------------------------------
+// Difference
+//------------------------------------------------------------------------------
+std::chrono::microseconds Timer::Difference(std::chrono::microseconds time1, std::chrono::microseconds time2)
+{
+	return (time2 - time1);
+}
+
+//------------------------------------------------------------------------------
+// GetTime
+//------------------------------------------------------------------------------
+std::chrono::microseconds Timer::GetTime()
 {
-	auto duration = std::chrono::system_clock::now().time_since_epoch();
-	auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
-	return millis;
+	auto duration = DelegateLib::Clock::Now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::microseconds>(duration);
 }
 
@@ -2,69 +2,192 @@
 #define _TIMER_H
 
 #include "DelegateLib.h"
+#include "CacheLine.h"
+#include "LockProfile.h"
+#include "TimerWheel.h"
 #include <mutex>
-#include <list>
+#include <condition_variable>
+#include <vector>
+#include <atomic>
+#include <cstdint>
 
 using namespace DelegateLib;
 
-/// @brief A timer class provides periodic timer callbacks on the client's 
-/// thread of control. Timer is thread safe.
-class Timer 
+class Timer;
+
+/// @brief A set of timers serviced by one thread. Each WorkerThread owns a 
+/// TimerSet so its timers are serviced only by that thread. Timers not bound to 
+/// a set use the default set serviced by every WorkerThread. Running timers are 
+/// held on a timing wheel keyed on the steady clock so start, stop and 
+/// expiration are O(1) regardless of the number of timers. Wheel ticks are 
+/// microseconds, and the servicing thread waits until the next expiration, so
+/// timers resolve to the thread's wakeup latency. TimerSet is thread safe.
+///
+/// @details Timers due together are collected under the lock and their Expired
+/// callbacks are invoked after it is released, within one DispatchScope, so the
+/// async callbacks are dispatched in one batch per target thread. A timer 
+/// stopped, restarted or destroyed before its collected callback runs is skipped.
+class TimerSet
 {
 public:
-	/// Client's register with Expired to get timer callbacks
-	UnicastDelegate<void(void)> Expired;
+	/// Called after a timer within the set is started with an expiration earlier
+	/// than the next service time
+	typedef void (*StartedHook)(void* context);
 
 	/// Constructor
+	TimerSet() = default;
+
+	/// Called by the servicing thread to expire the timers due
+	void ProcessTimers();
+
+	/// Get the earliest time the running timers need servicing by ProcessTimers().
+	/// The time is the earliest expiration or an earlier timing wheel cascade.
+	/// @param[out] time - the service time in ticks
+	/// @return TRUE if a timer is enabled, FALSE otherwise.
+	bool GetNextExpiration(std::chrono::microseconds& time);
+
+	/// Get a count incremented each time a timer is started with an expiration 
+	/// earlier than the next service time. The servicing thread recomputes the 
+	/// next expiration when the count changes.
+	/// @return The timer start count.
+	uint64_t GetGeneration() const { return m_generation; }
+
+	/// Set the function called after a timer is started
+	/// @param[in] hook - the function to call, or nullptr for none
+	/// @param[in] context - the argument passed to the hook
+	void SetStartedHook(StartedHook hook, void* context)
+	{
+		const std::lock_guard<DelegateLib::SiteMutex> lock(m_lock);
+		m_startedHook = hook;
+		m_startedContext = context;
+	}
+
+private:
+	TimerSet(const TimerSet&) = delete;
+	TimerSet& operator=(const TimerSet&) = delete;
+
+	friend class Timer;
+
+	/// Drop a timer from the expired batches not yet invoked. Called with m_lock held.
+	/// @param[in] timer - the timer
+	void CancelPending(Timer* timer);
+
+	/// A lock to make this class thread safe.
+	DelegateLib::SiteMutex m_lock = DelegateLib::LockSite("TimerSet::m_lock");
+
+	/// Expired timers collected by each ProcessTimers() in progress, and the
+	/// signal a destroyed timer waits on while its callback runs. Protected by m_lock.
+	std::vector<std::vector<Timer*>*> m_batches;
+	DelegateLib::SiteCondition m_invokeDone;
+
+	/// Storage of a finished batch reused by the next ProcessTimers(). Protected
+	/// by m_lock.
+	std::vector<Timer*> m_spare;
+
+	/// All running timers within the set.
+	TimerWheel m_wheel;
+
+	/// Polled by the servicing thread without m_lock, so kept off the cache
+	/// line of m_lock, which every Start() and Stop() writes.
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_generation{ 0 };
+	StartedHook m_startedHook = nullptr;
+	void* m_startedContext = nullptr;
+};
+
+/// @brief A timer class provides periodic or one-shot timer callbacks on the 
+/// client's thread of control. Timer is thread safe.
+class Timer : private TimerWheel::Entry
+{
+public:
+	/// Client's register with Expired to get timer callbacks. May be reassigned
+	/// or cleared while the timer is being serviced.
+	UnicastDelegateSafe<void(void)> Expired;
+
+	/// Constructor. The timer is serviced by every WorkerThread.
 	Timer(void);
 
-	/// Destructor
+	/// Constructor
+	/// @param[in] timers - the timer set servicing this timer, e.g. 
+	///		WorkerThread::GetTimers(). Must outlive the timer.
+	explicit Timer(TimerSet& timers);
+
+	/// Destructor. Waits for an Expired callback running on another thread. Must
+	/// not be called from the timer's own Expired callback.
 	~Timer(void);
 
-	/// Starts a timer for callbacks on the specified timeout interval.
-	/// @param[in]	timeout - the timeout in milliseconds.
-	void Start(std::chrono::milliseconds timeout);
+	/// Starts a timer for callbacks on the specified timeout interval. A periodic 
+	/// timer that falls behind skips the missed expirations.
+	/// @param[in]	timeout - the timeout. Milliseconds and seconds convert implicitly.
+	/// @param[in]	periodic - TRUE to expire every timeout, FALSE to expire once
+	///		and stop.
+	void Start(std::chrono::microseconds timeout, bool periodic = true);
 
 	/// Stops a timer.
 	void Stop();
 
+	/// Allow the timer to expire up to slack late so it expires on the same tick
+	/// as other timers, coalescing their wakeups. Takes effect from the next start
+	/// or period. Periodic timers keep their nominal period.
+	/// @param[in]	slack - the allowed lateness, or zero to expire on time
+	void SetSlack(std::chrono::microseconds slack);
+
+	/// Get the allowed lateness
+	std::chrono::microseconds GetSlack() { return m_slack; }
+
 	/// Gets the enabled state of a timer.
 	/// @return		TRUE if the timer is enabled, FALSE otherwise.
 	bool Enabled() { return m_enabled; }
 
-	/// Get the current time in ticks. 
+	/// Get the current time in ticks. Ticks are microseconds of Clock::Now(), the
+	/// steady clock unless a VirtualClock is installed.
 	/// @return The current time in ticks. 
-    static std::chrono::milliseconds GetTime();
+    static std::chrono::microseconds GetTime();
 
 	/// Computes the time difference in ticks between two tick values taking into
 	/// account rollover.
 	/// @param[in] 	time1 - time stamp 1 in ticks.
 	/// @param[in] 	time2 - time stamp 2 in ticks.
 	/// @return		The time difference in ticks.
-	static std::chrono::milliseconds Difference(std::chrono::milliseconds time1, std::chrono::milliseconds time2);
+	static std::chrono::microseconds Difference(std::chrono::microseconds time1, std::chrono::microseconds time2);
+
+	/// Get the default set holding timers not bound to a thread
+	/// @return The default timer set.
+	static TimerSet& GetDefaultTimers();
 
-	/// Called on a periodic basic to service all timer instances. 
-	static void ProcessTimers();
+	/// Called on a periodic basic to service the timers of the default set. 
+	static void ProcessTimers() { GetDefaultTimers().ProcessTimers(); }
 
 private:
 	// Prevent inadvertent copying of this object
 	Timer(const Timer&);
 	Timer& operator=(const Timer&);
 
-	/// Called to check for expired timers and callback registered clients.
-	void CheckExpired();
+	friend class TimerSet;
 
-	/// List of all system timers to be serviced.
-	static xlist<Timer*> m_timers;
-	typedef xlist<Timer*>::iterator TimersIterator;
+	/// Called when the timer expires to restart a periodic timer. Called with
+	/// the set lock held; the registered clients are called back later.
+	/// @param[in] now - the current tick
+	void OnExpired(uint64_t now);
 
-	/// A lock to make this class thread safe.
-	static std::mutex m_lock;
+	/// Get the wheel tick of a nominal expiration, delayed within the slack to
+	/// a tick aligned to the largest power of two not above the slack
+	/// @param[in] due - the nominal expiration tick
+	/// @return The expiration tick.
+	uint64_t Coalesce(uint64_t due) const;
 
-	std::chrono::milliseconds m_timeout = std::chrono::milliseconds(0);		
-	std::chrono::milliseconds m_expireTime = std::chrono::milliseconds(0);
+	/// The set servicing this timer
+	TimerSet& m_timers;
+
+	std::chrono::microseconds m_timeout = std::chrono::microseconds(0);		
+	std::chrono::microseconds m_slack = std::chrono::microseconds(0);
+	bool m_periodic = true;
 	bool m_enabled = false;
-	static bool m_timerStopped;
+
+	/// Nominal expiration tick before coalescing
+	uint64_t m_due = 0;
+
+	/// Expired callbacks in progress. Protected by the set lock.
+	int m_invoking = 0;
 };
 
 #endif
@@ -0,0 +1,170 @@
+#include "TimerWheel.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+//----------------------------------------------------------------------------
+// LowestBit
+//----------------------------------------------------------------------------
+static int LowestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return (int)index;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// HighestBit
+//----------------------------------------------------------------------------
+static int HighestBit(uint64_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanReverse64(&index, value);
+	return (int)index;
+#else
+	return 63 - __builtin_clzll(value);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// Head
+//----------------------------------------------------------------------------
+TimerWheel::Entry** TimerWheel::Head(int level, int slot)
+{
+	return level < LEVELS ? &m_slots[level][slot] : &m_overflow;
+}
+
+//----------------------------------------------------------------------------
+// Insert
+//----------------------------------------------------------------------------
+void TimerWheel::Insert(Entry* entry, uint64_t expire)
+{
+	if (IsInserted(entry))
+		return;
+
+	entry->expire = expire > m_now ? expire : m_now + 1;
+	Place(entry);
+	m_size++;
+}
+
+//----------------------------------------------------------------------------
+// Place
+//----------------------------------------------------------------------------
+void TimerWheel::Place(Entry* entry)
+{
+	// The highest bit differing from the current tick selects the level
+	uint64_t diff = entry->expire ^ m_now;
+	int level = diff == 0 ? 0 : HighestBit(diff) / SLOT_BITS;
+	int slot = 0;
+	if (level < LEVELS)
+	{
+		slot = (int)((entry->expire >> (level * SLOT_BITS)) & SLOT_MASK);
+		m_occupied[level] |= uint64_t(1) << slot;
+	}
+	else
+		level = LEVELS;
+
+	Entry** head = Head(level, slot);
+	entry->level = (int8_t)level;
+	entry->slot = (uint8_t)slot;
+	entry->prev = nullptr;
+	entry->next = *head;
+	if (*head)
+		(*head)->prev = entry;
+	*head = entry;
+}
+
+//----------------------------------------------------------------------------
+// Remove
+//----------------------------------------------------------------------------
+void TimerWheel::Remove(Entry* entry)
+{
+	if (!IsInserted(entry))
+		return;
+
+	Entry** head = Head(entry->level, entry->slot);
+	if (entry->prev)
+		entry->prev->next = entry->next;
+	else
+		*head = entry->next;
+	if (entry->next)
+		entry->next->prev = entry->prev;
+
+	if (!*head && entry->level < LEVELS)
+		m_occupied[entry->level] &= ~(uint64_t(1) << entry->slot);
+
+	entry->next = entry->prev = nullptr;
+	entry->level = -1;
+	m_size--;
+}
+
+//----------------------------------------------------------------------------
+// Cascade
+//----------------------------------------------------------------------------
+void TimerWheel::Cascade(uint64_t tick)
+{
+	// Rescan the overflow list once per top level revolution
+	const uint64_t range = uint64_t(1) << (LEVELS * SLOT_BITS);
+	if ((tick & (range - 1)) == 0 && m_overflow)
+	{
+		Entry* entry = m_overflow;
+		m_overflow = nullptr;
+		while (entry)
+		{
+			Entry* next = entry->next;
+			Place(entry);
+			entry = next;
+		}
+	}
+
+	// Move the slots starting at this tick down, highest level first
+	for (int level = LEVELS - 1; level > 0; level--)
+	{
+		if ((tick & ((uint64_t(1) << (level * SLOT_BITS)) - 1)) != 0)
+			continue;
+
+		int slot = (int)((tick >> (level * SLOT_BITS)) & SLOT_MASK);
+		Entry* entry = m_slots[level][slot];
+		m_slots[level][slot] = nullptr;
+		m_occupied[level] &= ~(uint64_t(1) << slot);
+		while (entry)
+		{
+			Entry* next = entry->next;
+			Place(entry);
+			entry = next;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// GetNextTick
+//----------------------------------------------------------------------------
+bool TimerWheel::GetNextTick(uint64_t& tick) const
+{
+	if (m_size == 0)
+		return false;
+
+	// Every occupied slot is after the current tick's slot on its level, and
+	// lower level slots are always earlier than higher level slots
+	for (int level = 0; level < LEVELS; level++)
+	{
+		if (m_occupied[level] == 0)
+			continue;
+
+		int shift = level * SLOT_BITS;
+		uint64_t window = (m_now >> (shift + SLOT_BITS)) << (shift + SLOT_BITS);
+		tick = window | (uint64_t(LowestBit(m_occupied[level])) << shift);
+		return true;
+	}
+
+	// Only overflow entries remain
+	const int shift = LEVELS * SLOT_BITS;
+	tick = ((m_now >> shift) + 1) << shift;
+	return true;
+}
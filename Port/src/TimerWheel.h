@@ -0,0 +1,120 @@
+#ifndef _TIMER_WHEEL_H
+#define _TIMER_WHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+
+/// @brief A hierarchical timing wheel holding entries keyed on an expiration
+/// tick. Insert, remove and expire are O(1) per entry. TimerWheel is not
+/// thread-safe.
+///
+/// @details The wheel has LEVELS levels of SLOTS slots. Level 0 slots are one
+/// tick wide and each higher level slot is SLOTS times wider than the level
+/// below. An entry is placed on the lowest level whose slot width covers the
+/// distance to its expiration. When time reaches the start of a higher level
+/// slot its entries cascade to the lower levels. Entries beyond the top level
+/// range wait on an overflow list rescanned once per top level revolution. An
+/// occupancy bitmap per level finds the next non-empty slot without a scan.
+class TimerWheel
+{
+public:
+	static const int SLOT_BITS = 6;
+	static const int SLOTS = 1 << SLOT_BITS;
+	static const int LEVELS = 6;
+
+	/// An intrusive wheel entry. Derive from Entry to place an object on the wheel.
+	struct Entry
+	{
+		Entry* next = nullptr;
+		Entry* prev = nullptr;
+		uint64_t expire = 0;
+		int8_t level = -1;		///< -1 if not on the wheel
+		uint8_t slot = 0;
+	};
+
+	/// Constructor
+	/// @param[in] now - the current tick
+	explicit TimerWheel(uint64_t now = 0) : m_now(now) {}
+
+	/// Insert an entry. The entry must not be on a wheel.
+	/// @param[in] entry - the entry to insert
+	/// @param[in] expire - the expiration tick. A tick not after the current
+	///		tick expires on the next tick.
+	void Insert(Entry* entry, uint64_t expire);
+
+	/// Remove an entry. Does nothing if the entry is not on the wheel.
+	/// @param[in] entry - the entry to remove
+	void Remove(Entry* entry);
+
+	/// Check if an entry is on a wheel
+	/// @param[in] entry - the entry
+	/// @return True if the entry is inserted.
+	static bool IsInserted(const Entry* entry) { return entry->level >= 0; }
+
+	/// Advance time and expire the entries due
+	/// @param[in] now - the current tick
+	/// @param[in] expired - called with each expired entry after it is removed.
+	///		May insert or remove entries.
+	template <class F>
+	void Advance(uint64_t now, F expired)
+	{
+		uint64_t tick;
+		while (GetNextTick(tick) && tick <= now)
+		{
+			m_now = tick;
+			Cascade(tick);
+
+			Entry** slot = &m_slots[0][tick & SLOT_MASK];
+			while (*slot)
+			{
+				Entry* entry = *slot;
+				Remove(entry);
+				expired(entry);
+			}
+		}
+		if (now > m_now)
+			m_now = now;
+	}
+
+	/// Get the next tick at which Advance() has work to do. The tick is the
+	/// earliest expiration or an earlier cascade of a higher level slot.
+	/// @param[out] tick - the next tick
+	/// @return True if the wheel holds an entry.
+	bool GetNextTick(uint64_t& tick) const;
+
+	/// Set the current tick of an empty wheel
+	/// @param[in] now - the current tick
+	void Reset(uint64_t now) { if (m_size == 0) m_now = now; }
+
+	/// Get the current tick
+	/// @return The tick last advanced to.
+	uint64_t GetNow() const { return m_now; }
+
+	/// Get the number of entries on the wheel
+	/// @return The entry count.
+	size_t Size() const { return m_size; }
+
+	/// Check if the wheel is empty
+	/// @return True if no entry is inserted.
+	bool Empty() const { return m_size == 0; }
+
+private:
+	static const uint64_t SLOT_MASK = SLOTS - 1;
+
+	/// Link an entry onto its level and slot relative to the current tick
+	void Place(Entry* entry);
+
+	/// Move the entries of the slots starting at the tick to the lower levels
+	void Cascade(uint64_t tick);
+
+	/// Get the list head of an entry's slot
+	Entry** Head(int level, int slot);
+
+	Entry* m_slots[LEVELS][SLOTS] = {};
+	uint64_t m_occupied[LEVELS] = {};
+	Entry* m_overflow = nullptr;
+	uint64_t m_now;
+	size_t m_size = 0;
+};
+
+#endif
@@ -0,0 +1,445 @@
+#include "WorkerThreadPool.h"
+#include "DelegateMsg.h"
+#include "Metrics.h"
+#include <stdexcept>
+#include <functional>
+#include <algorithm>
+
+#ifdef WIN32
+#include <Windows.h>
+#endif
+
+using namespace std;
+using namespace DelegateLib;
+
+/// The pool and worker index of the calling thread if a pool worker
+static thread_local WorkerThreadPool* currentPool = nullptr;
+static thread_local size_t currentWorker = 0;
+
+//----------------------------------------------------------------------------
+// WorkerThreadPool
+//----------------------------------------------------------------------------
+WorkerThreadPool::WorkerThreadPool(const std::string& poolName, size_t threadCount, 
+	const ThreadAttributes& attributes) :
+	WorkerThreadPool(poolName, 
+		threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency()),
+		threadCount ? threadCount : std::max(1u, std::thread::hardware_concurrency()),
+		std::chrono::microseconds::zero(), std::chrono::milliseconds::zero(), attributes)
+{
+}
+
+//----------------------------------------------------------------------------
+// WorkerThreadPool
+//----------------------------------------------------------------------------
+WorkerThreadPool::WorkerThreadPool(const std::string& poolName, size_t minThreads, size_t maxThreads,
+	std::chrono::microseconds waitTarget, std::chrono::milliseconds idleTimeout,
+	const ThreadAttributes& attributes) :
+	POOL_NAME(poolName), m_attributes(attributes),
+	MIN_THREADS(std::max<size_t>(1, minThreads)),
+	MAX_THREADS(std::max(std::max<size_t>(1, minThreads), maxThreads)),
+	WAIT_TARGET(waitTarget), IDLE_TIMEOUT(idleTimeout)
+{
+	// Slots are allocated up front so workers never see the vector reallocate
+	for (size_t i = 0; i < MAX_THREADS; i++)
+		m_workers.emplace_back(new Worker());
+
+	// Ordered messages only go to workers that never retire
+	for (size_t i = 0; i < MIN_THREADS; i++)
+		m_orderedThreads.emplace_back(new OrderedThread(*this, i));
+}
+
+//----------------------------------------------------------------------------
+// ~WorkerThreadPool
+//----------------------------------------------------------------------------
+WorkerThreadPool::~WorkerThreadPool()
+{
+	ExitThread();
+}
+
+//----------------------------------------------------------------------------
+// CreateThread
+//----------------------------------------------------------------------------
+bool WorkerThreadPool::CreateThread()
+{
+	if (m_created)
+		return true;
+
+	m_exit = false;
+	m_created = true;
+	for (size_t i = 0; i < MIN_THREADS; i++)
+		AddWorker();
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// AddWorker
+//----------------------------------------------------------------------------
+void WorkerThreadPool::AddWorker()
+{
+	lock_guard<mutex> scaleLock(m_scaleMutex);
+
+	// Claim the slot first so the newest worker cannot retire meanwhile
+	size_t index;
+	{
+		lock_guard<mutex> lock(m_mutex);
+		if (m_exit || m_active >= MAX_THREADS)
+			return;
+		index = m_active++;
+	}
+
+	// A retired worker of the slot has left Process() so the join is short
+	Worker& worker = *m_workers[index];
+	if (worker.thread)
+		worker.thread->join();
+	worker.thread = StartThread(m_attributes, &WorkerThreadPool::Process, this, index);
+
+#ifdef WIN32
+	// Set the thread name so it shows in the Visual Studio Debug Location toolbar
+	std::string name = POOL_NAME + "." + std::to_string(index);
+	std::wstring wstr(name.begin(), name.end());
+	SetThreadDescription(worker.thread->native_handle(), wstr.c_str());
+#endif
+}
+
+//----------------------------------------------------------------------------
+// RetireWorker
+//----------------------------------------------------------------------------
+bool WorkerThreadPool::RetireWorker(size_t index)
+{
+	// Retire newest first so the running workers stay contiguous. A message
+	// queued on the slot after this check is stolen by the remaining workers.
+	Worker& self = *m_workers[index];
+	if (index < MIN_THREADS || index + 1 != m_active || m_exit ||
+		!self.sleeping || m_pending > 0 || self.orderedCount > 0)
+		return false;
+
+	self.sleeping = false;
+	m_sleepers--;
+	m_active--;
+
+	static MetricCounter& retiredMetric = Metrics::GetCounter("workerthreadpool.retired");
+	retiredMetric.Add();
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// CheckLoad
+//----------------------------------------------------------------------------
+void WorkerThreadPool::CheckLoad(std::chrono::steady_clock::time_point queued)
+{
+	auto now = std::chrono::steady_clock::now();
+	if (now - queued <= WAIT_TARGET)
+	{
+		if (m_overSince.load(std::memory_order_relaxed) != 0)
+			m_overSince.store(0, std::memory_order_relaxed);
+		return;
+	}
+
+	// Add a worker once the wait stayed above the target for the target duration
+	int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+	int64_t since = m_overSince.load(std::memory_order_relaxed);
+	if (since == 0)
+	{
+		m_overSince.compare_exchange_strong(since, nowUs, std::memory_order_relaxed);
+		return;
+	}
+	if (nowUs - since < WAIT_TARGET.count() || m_active >= MAX_THREADS)
+		return;
+
+	// Restart the window so the new worker takes effect before another is added
+	if (!m_overSince.compare_exchange_strong(since, nowUs, std::memory_order_relaxed))
+		return;
+
+	static MetricCounter& addedMetric = Metrics::GetCounter("workerthreadpool.added");
+	addedMetric.Add();
+	AddWorker();
+}
+
+//----------------------------------------------------------------------------
+// ExitThread
+//----------------------------------------------------------------------------
+void WorkerThreadPool::ExitThread()
+{
+	if (!m_created)
+		return;
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_exit = true;
+		for (auto& worker : m_workers)
+			worker->cv.notify_one();
+	}
+
+	// Join running and retired workers alike. The threads are joined without
+	// m_scaleMutex held since a worker may be blocked adding a worker.
+	std::vector<std::unique_ptr<std::thread>> threads;
+	{
+		lock_guard<mutex> scaleLock(m_scaleMutex);
+		for (auto& worker : m_workers)
+		{
+			if (worker->thread)
+				threads.push_back(std::move(worker->thread));
+		}
+	}
+	for (auto& thread : threads)
+		thread->join();
+	m_active = 0;
+	m_overSince = 0;
+	m_created = false;
+}
+
+//----------------------------------------------------------------------------
+// GetQueueSize
+//----------------------------------------------------------------------------
+size_t WorkerThreadPool::GetQueueSize()
+{
+	size_t size = m_pending;
+	for (auto& worker : m_workers)
+		size += worker->orderedCount;
+	return size;
+}
+
+//----------------------------------------------------------------------------
+// GetOrderedThread
+//----------------------------------------------------------------------------
+DelegateThread& WorkerThreadPool::GetOrderedThread(const void* key)
+{
+	size_t index = std::hash<const void*>()(key) % m_orderedThreads.size();
+	return *m_orderedThreads[index];
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void WorkerThreadPool::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	if (!m_created)
+		throw std::invalid_argument("Thread pointer is null");
+
+	bool elastic = MAX_THREADS > MIN_THREADS;
+	std::chrono::steady_clock::time_point queued, oldest;
+	if (elastic)
+		queued = std::chrono::steady_clock::now();
+
+	Worker& worker = *m_workers[SelectWorker()];
+	{
+		lock_guard<mutex> lock(worker.mutex);
+		worker.tasks.push_back({ std::move(msg), queued });
+		oldest = worker.tasks.front().queued;
+	}
+
+	// Pairs with the sleeper count increment in Process()
+	m_pending.fetch_add(1);
+	if (m_sleepers.load() > 0)
+		WakeWorker();
+	else if (elastic)
+		CheckLoad(oldest);
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegates
+//----------------------------------------------------------------------------
+void WorkerThreadPool::DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count)
+{
+	if (!m_created)
+		throw std::invalid_argument("Thread pointer is null");
+	if (count == 0)
+		return;
+
+	bool elastic = MAX_THREADS > MIN_THREADS;
+	std::chrono::steady_clock::time_point queued, oldest;
+	if (elastic)
+		queued = std::chrono::steady_clock::now();
+
+	Worker& worker = *m_workers[SelectWorker()];
+	{
+		lock_guard<mutex> lock(worker.mutex);
+		for (size_t i = 0; i < count; i++)
+			worker.tasks.push_back({ std::move(msgs[i]), queued });
+		oldest = worker.tasks.front().queued;
+	}
+
+	// Wake a sleeper per message, up to all sleepers, to spread the batch
+	m_pending.fetch_add(count);
+	for (size_t i = 0; i < count && m_sleepers.load() > 0; i++)
+		WakeWorker();
+	if (elastic && m_sleepers.load() == 0)
+		CheckLoad(oldest);
+}
+
+//----------------------------------------------------------------------------
+// SelectWorker
+//----------------------------------------------------------------------------
+size_t WorkerThreadPool::SelectWorker()
+{
+	// Keep work spawned by a worker local to that worker
+	if (currentPool == this)
+		return currentWorker;
+
+	// A worker retiring meanwhile may still be selected. Its messages are stolen.
+	size_t active = std::max<size_t>(1, m_active.load());
+	return m_nextWorker.fetch_add(1, std::memory_order_relaxed) % active;
+}
+
+//----------------------------------------------------------------------------
+// DispatchOrdered
+//----------------------------------------------------------------------------
+void WorkerThreadPool::DispatchOrdered(size_t index, std::shared_ptr<DelegateLib::DelegateMsg> msg)
+{
+	if (!m_created)
+		throw std::invalid_argument("Thread pointer is null");
+
+	Worker& worker = *m_workers[index];
+	{
+		lock_guard<mutex> lock(worker.mutex);
+		worker.ordered.push_back(std::move(msg));
+	}
+
+	// Only this worker may run the message so wake it specifically
+	worker.orderedCount.fetch_add(1);
+	if (worker.sleeping.load())
+	{
+		lock_guard<mutex> lock(m_mutex);
+		worker.cv.notify_one();
+	}
+}
+
+//----------------------------------------------------------------------------
+// WakeWorker
+//----------------------------------------------------------------------------
+void WorkerThreadPool::WakeWorker()
+{
+	lock_guard<mutex> lock(m_mutex);
+	for (auto& worker : m_workers)
+	{
+		if (worker->sleeping)
+		{
+			// Claim the sleeper so concurrent dispatches wake different workers
+			worker->sleeping = false;
+			m_sleepers--;
+			worker->cv.notify_one();
+			return;
+		}
+	}
+}
+
+//----------------------------------------------------------------------------
+// TakeMessage
+//----------------------------------------------------------------------------
+bool WorkerThreadPool::TakeMessage(size_t index, std::shared_ptr<DelegateLib::DelegateMsg>& msg,
+	std::chrono::steady_clock::time_point& queued)
+{
+	Worker& self = *m_workers[index];
+	{
+		lock_guard<mutex> lock(self.mutex);
+		if (!self.ordered.empty())
+		{
+			msg = std::move(self.ordered.front());
+			self.ordered.pop_front();
+			self.orderedCount--;
+			return true;
+		}
+		if (!self.tasks.empty())
+		{
+			msg = std::move(self.tasks.front().msg);
+			queued = self.tasks.front().queued;
+			self.tasks.pop_front();
+			m_pending--;
+			return true;
+		}
+	}
+
+	// Steal the most recently queued message of another worker. Every slot is 
+	// searched so messages left on a retired worker's slot are run.
+	for (size_t i = 1; i < m_workers.size() && m_pending > 0; i++)
+	{
+		Worker& victim = *m_workers[(index + i) % m_workers.size()];
+		lock_guard<mutex> lock(victim.mutex);
+		if (!victim.tasks.empty())
+		{
+			msg = std::move(victim.tasks.back().msg);
+			queued = victim.tasks.back().queued;
+			victim.tasks.pop_back();
+			m_pending--;
+			return true;
+		}
+	}
+	return false;
+}
+
+//----------------------------------------------------------------------------
+// Invoke
+//----------------------------------------------------------------------------
+void WorkerThreadPool::Invoke(std::shared_ptr<DelegateLib::DelegateMsg>& msg)
+{
+	ASSERT_TRUE(msg);
+
+	// Discard a message its sender cancelled while queued
+	if (msg->IsCancelled())
+		return;
+
+	auto invoker = msg->GetDelegateInvoker();
+	ASSERT_TRUE(invoker);
+
+	// Invoke the delegate destination target function within the caller's trace
+	DelegateLib::TraceContextScope traceScope(msg->GetTraceContext());
+	bool success = invoker->Invoke(msg);
+	ASSERT_TRUE(success);
+}
+
+//----------------------------------------------------------------------------
+// Process
+//----------------------------------------------------------------------------
+void WorkerThreadPool::Process(size_t index)
+{
+	currentPool = this;
+	currentWorker = index;
+	Worker& self = *m_workers[index];
+	bool elastic = MAX_THREADS > MIN_THREADS;
+
+	while (1)
+	{
+		std::shared_ptr<DelegateMsg> msg;
+		std::chrono::steady_clock::time_point queued;
+		if (TakeMessage(index, msg, queued))
+		{
+			if (elastic && queued != std::chrono::steady_clock::time_point())
+				CheckLoad(queued);
+			Invoke(msg);
+			continue;
+		}
+
+		// Sleep until a message is dispatched or the pool exits
+		std::unique_lock<std::mutex> lk(m_mutex);
+		if (m_exit && m_pending == 0 && self.orderedCount == 0)
+			break;
+		self.sleeping = true;
+		m_sleepers++;
+		auto wake = [this, &self]() {
+			return !self.sleeping || m_pending > 0 || self.orderedCount > 0 || m_exit;
+		};
+		bool retired = false;
+		if (elastic && index >= MIN_THREADS)
+		{
+			// A worker above the minimum retires once idle for the timeout
+			while (!self.cv.wait_for(lk, IDLE_TIMEOUT, wake))
+			{
+				if ((retired = RetireWorker(index)))
+					break;
+			}
+		}
+		else
+		{
+			self.cv.wait(lk, wake);
+		}
+		if (retired)
+			break;
+		if (self.sleeping)
+		{
+			self.sleeping = false;
+			m_sleepers--;
+		}
+	}
+
+	currentPool = nullptr;
+}
@@ -0,0 +1,213 @@
+#ifndef _WORKER_THREAD_POOL_H
+#define _WORKER_THREAD_POOL_H
+
+#include "DelegateOpt.h"
+#include "DelegateThread.h"
+#include "ThreadAttributes.h"
+#include <thread>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <string>
+#include <chrono>
+
+/// @brief A pool of worker threads dispatched to through the DelegateThread
+/// interface. Async delegates bound to the pool run concurrently on any worker.
+///
+/// @details Each worker owns a deque of delegate messages. A message dispatched
+/// from a pool worker is queued on that worker's deque. A message dispatched from
+/// any other thread is queued round-robin. Workers take from the front of their own
+/// deque and an idle worker steals from the back of another worker's deque, so no
+/// invocation order is guaranteed across the pool.
+///
+/// Delegates requiring FIFO order bind to GetOrderedThread() instead. All messages
+/// dispatched through the ordered thread of a key run on one worker in dispatch
+/// order and are never stolen. Use the delegate's target object as the key to keep
+/// the calls on each object ordered.
+///
+/// An elastic pool starts with a minimum number of workers and adds a worker, up
+/// to a maximum, while the oldest queued message has waited longer than a target
+/// for at least the target duration. A worker above the minimum retires after
+/// idling for a timeout, newest first. Ordered threads map only onto the minimum
+/// workers, which never retire.
+class WorkerThreadPool : public DelegateLib::DelegateThread
+{
+public:
+	/// Constructor
+	/// @param[in] poolName - the pool name. Workers are named <poolName>.<index>.
+	/// @param[in] threadCount - the number of worker threads. 0 uses one per core.
+	/// @param[in] attributes - the attributes applied to every worker thread
+	WorkerThreadPool(const std::string& poolName, size_t threadCount = 0, 
+		const ThreadAttributes& attributes = ThreadAttributes());
+
+	/// Constructor of an elastic pool
+	/// @param[in] poolName - the pool name. Workers are named <poolName>.<index>.
+	/// @param[in] minThreads - the number of workers always running. 0 uses one.
+	/// @param[in] maxThreads - the maximum number of workers
+	/// @param[in] waitTarget - the queue wait time above which a worker is added
+	/// @param[in] idleTimeout - the idle time after which a worker above the
+	///		minimum retires
+	/// @param[in] attributes - the attributes applied to every worker thread
+	WorkerThreadPool(const std::string& poolName, size_t minThreads, size_t maxThreads,
+		std::chrono::microseconds waitTarget, std::chrono::milliseconds idleTimeout,
+		const ThreadAttributes& attributes = ThreadAttributes());
+
+	/// Destructor
+	~WorkerThreadPool();
+
+	/// Called once to create the worker threads
+	/// @return TRUE if threads are created. FALSE otherise.
+	bool CreateThread();
+
+	/// Called once a program exit to exit the worker threads. Messages already
+	/// queued are invoked first.
+	void ExitThread();
+
+	/// Get the pool name
+	std::string GetThreadName() { return POOL_NAME; }
+
+	/// Get the number of running worker threads
+	size_t GetThreadCount() const { return m_active; }
+
+	/// Get the number of queued messages
+	size_t GetQueueSize();
+
+	/// Get a thread dispatching every message for a key onto the same worker in
+	/// FIFO order
+	/// @param[in] key - the ordering key, typically the delegate target object
+	/// @return The ordered thread of the key. Valid for the life of the pool.
+	DelegateLib::DelegateThread& GetOrderedThread(const void* key);
+
+	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg);
+
+	/// Dispatch several delegates onto one worker with one lock. Idle workers 
+	/// are woken to steal from the batch.
+	virtual void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count);
+
+private:
+	WorkerThreadPool(const WorkerThreadPool&) = delete;
+	WorkerThreadPool& operator=(const WorkerThreadPool&) = delete;
+
+	typedef std::deque<std::shared_ptr<DelegateLib::DelegateMsg>> MsgDeque;
+
+	/// A message any worker may run and the time it was queued. The time is
+	/// only taken by an elastic pool.
+	struct Task
+	{
+		std::shared_ptr<DelegateLib::DelegateMsg> msg;
+		std::chrono::steady_clock::time_point queued;
+	};
+	typedef std::deque<Task> TaskDeque;
+
+	struct Worker
+	{
+		/// The thread of the worker slot. Kept after the worker retires until 
+		/// joined by AddWorker() or ExitThread(). Protected by m_scaleMutex.
+		std::unique_ptr<std::thread> thread;
+
+		/// Protects tasks and ordered
+		std::mutex mutex;
+
+		/// Messages any worker may run
+		TaskDeque tasks;
+
+		/// Messages only this worker runs, in dispatch order
+		MsgDeque ordered;
+		std::atomic<size_t> orderedCount{ 0 };
+
+		/// Idle wait state. Protected by the pool m_mutex.
+		std::condition_variable cv;
+		std::atomic<bool> sleeping{ false };
+	};
+
+	/// Dispatches onto one worker's ordered messages
+	class OrderedThread : public DelegateLib::DelegateThread
+	{
+	public:
+		OrderedThread(WorkerThreadPool& pool, size_t index) : m_pool(pool), m_index(index) {}
+		virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+		{
+			m_pool.DispatchOrdered(m_index, std::move(msg));
+		}
+
+	private:
+		WorkerThreadPool& m_pool;
+		const size_t m_index;
+	};
+
+	/// Entry point for each worker thread
+	/// @param[in] index - the worker index
+	void Process(size_t index);
+
+	/// Take the next message for a worker to run
+	/// @param[in] index - the worker index
+	/// @param[out] msg - the message
+	/// @param[out] queued - the time the message was queued, if any worker may run it
+	/// @return True if a message was taken.
+	bool TakeMessage(size_t index, std::shared_ptr<DelegateLib::DelegateMsg>& msg,
+		std::chrono::steady_clock::time_point& queued);
+
+	/// Select the worker a message dispatched by the calling thread is queued on
+	size_t SelectWorker();
+
+	/// Add a worker if a queued message waited too long for too long
+	/// @param[in] queued - the time the oldest known queued message was queued
+	void CheckLoad(std::chrono::steady_clock::time_point queued);
+
+	/// Start a worker thread in the next free slot
+	void AddWorker();
+
+	/// Retire the calling worker if it is the newest above the minimum and
+	/// no work is queued. Called with m_mutex held.
+	/// @return True if the worker retired.
+	bool RetireWorker(size_t index);
+
+	/// Dispatch a message onto a worker's ordered messages
+	void DispatchOrdered(size_t index, std::shared_ptr<DelegateLib::DelegateMsg> msg);
+
+	/// Wake one sleeping worker to run or steal a message
+	void WakeWorker();
+
+	/// Invoke a delegate message
+	static void Invoke(std::shared_ptr<DelegateLib::DelegateMsg>& msg);
+
+	std::vector<std::unique_ptr<Worker>> m_workers;
+	std::vector<std::unique_ptr<OrderedThread>> m_orderedThreads;
+	const std::string POOL_NAME;
+	const ThreadAttributes m_attributes;
+	bool m_created = false;
+
+	/// Worker count bounds and the elastic scaling parameters. The pool is 
+	/// elastic if MAX_THREADS exceeds MIN_THREADS.
+	const size_t MIN_THREADS;
+	const size_t MAX_THREADS;
+	const std::chrono::microseconds WAIT_TARGET;
+	const std::chrono::milliseconds IDLE_TIMEOUT;
+
+	/// Number of running workers, always the slots 0 to m_active - 1. Changed 
+	/// with m_mutex held.
+	std::atomic<size_t> m_active{ 0 };
+
+	/// Steady clock time in microseconds since the queue wait first exceeded
+	/// WAIT_TARGET. 0 while below the target.
+	std::atomic<int64_t> m_overSince{ 0 };
+
+	/// Serializes starting and joining worker threads
+	std::mutex m_scaleMutex;
+
+	/// Round-robin index for messages dispatched from outside the pool
+	std::atomic<size_t> m_nextWorker{ 0 };
+
+	/// Number of messages in worker tasks deques
+	std::atomic<size_t> m_pending{ 0 };
+
+	/// Idle wait lock and the number of sleeping workers
+	std::mutex m_mutex;
+	std::atomic<size_t> m_sleepers{ 0 };
+	std::atomic<bool> m_exit{ false };
+};
+
+#endif
@@ -2,23 +2,78 @@
 #include "WorkerThreadStd.h"
 #include "ThreadMsg.h"
 #include "Timer.h"
+#include "Clock.h"
+#include "Trace.h"
+#include "Metrics.h"
+#include "MemoryTrim.h"
+#include <algorithm>
+#include <vector>
 
 #ifdef WIN32
 #include <Windows.h>
+#else
+#include <ctime>
 #endif
 
 using namespace std;
 using namespace DelegateLib;
 
+std::mutex WorkerThread::m_threadsLock;
+std::list<WorkerThread*> WorkerThread::m_threads;
+const int WorkerThread::LANE_WEIGHTS[PRIORITY_LANES] = { 16, 4, 1 };
+
+// The WorkerThread instance running on the current thread, if any
+static thread_local const WorkerThread* currentThread = nullptr;
+static thread_local ScratchArena* currentScratch = nullptr;
+
 #define MSG_DISPATCH_DELEGATE	1
 #define MSG_EXIT_THREAD			2
-#define MSG_TIMER				3
+
+//----------------------------------------------------------------------------
+// ThreadNotRunning
+//----------------------------------------------------------------------------
+/// Report a call on a thread not created. Throws std::invalid_argument unless
+/// exceptions are disabled, in which case the error handler is called and the
+/// caller discards the call. See DelegateError.h.
+static void ThreadNotRunning()
+{
+#ifdef DELEGATE_NO_EXCEPTIONS
+	ReportDelegateError(DelegateError::THREAD_NOT_RUNNING);
+#else
+	throw std::invalid_argument("Thread pointer is null");
+#endif
+}
 
 //----------------------------------------------------------------------------
 // WorkerThread
 //----------------------------------------------------------------------------
-WorkerThread::WorkerThread(const std::string& threadName) : m_thread(nullptr), m_timerExit(false), THREAD_NAME(threadName)
+WorkerThread::WorkerThread(const std::string& threadName, QueuePolicy policy, size_t ringCapacity,
+	const ThreadAttributes& attributes) : 
+	ActiveObject(threadName, [this]() { return GetQueuedCount(); }),
+	THREAD_NAME(threadName), m_policy(policy), m_attributes(attributes), m_queueCapacity(ringCapacity), m_overflow(QueueOverflow::GROW),
+	m_exitPending(false), m_discarded(0), m_queuedCount(0), m_statsEnabled(false), m_peakQueueSize(0), m_invoked(0), m_remoteDispatches(0),
+	m_deadlineBudget(0), m_expired(0), m_inlineCalls(false), m_trimTimer(m_timers)
 {
+	m_trimTimer.Expired = MakeDelegate(this, &WorkerThread::TrimIdle);
+
+	// A RING thread polls briefly to catch back-to-back messages without a kernel wakeup
+	WaitStrategy strategy;
+	if (m_policy == QueuePolicy::RING)
+		strategy.policy = WaitPolicy::SPIN_THEN_BLOCK;
+	m_spinWait.SetStrategy(strategy);
+
+	m_ownDeadline.timers = &m_timers;
+	m_timers.SetStartedHook(&WorkerThread::WakeThread, this);
+	m_scheduled.SetScheduledHook(&WorkerThread::WakeThread, this);
+	m_defaultDeadline.timers = &Timer::GetDefaultTimers();
+
+	for (int lane = 0; lane < PRIORITY_LANES; lane++)
+	{
+		if (m_policy == QueuePolicy::RING)
+			m_rings[lane].reset(new LockFreeQueue<RingMsg>(ringCapacity));
+		m_laneCredits[lane] = LANE_WEIGHTS[lane];
+		m_priorityThreads[lane].reset(new PriorityThread(*this, static_cast<Priority>(lane)));
+	}
 }
 
 //----------------------------------------------------------------------------
@@ -34,9 +89,40 @@ WorkerThread::~WorkerThread()
 //----------------------------------------------------------------------------
 bool WorkerThread::CreateThread()
 {
+	// A scheduled thread is run by the installed scheduler instead of an OS thread
+	if (m_policy == QueuePolicy::SCHEDULED)
+	{
+		if (!m_scheduler)
+		{
+			m_scheduler = DeterministicScheduler::GetInstalled();
+			if (!m_scheduler)
+				return false;
+			m_scheduler->Attach(this);
+			PublishMetrics(true);
+		}
+		return true;
+	}
+
 	if (!m_thread)
 	{
-		m_thread = std::unique_ptr<std::thread>(new thread(&WorkerThread::Process, this));
+		// Preallocate the lanes so dispatching within capacity never allocates
+		if (m_policy == QueuePolicy::MUTEX)
+		{
+			std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+			for (auto& queue : m_queue)
+				queue.Reserve(m_queueCapacity);
+		}
+
+		StartLoop(m_attributes, [this]() { Process(); });
+
+		// Wake this thread when a default timer is started or the clock advances
+		Timer::GetDefaultTimers().SetStartedHook(&WorkerThread::WakeTimers, nullptr);
+		DelegateLib::Clock::AddAdvancedHook(&WorkerThread::WakeTimers, nullptr);
+		PublishMetrics(true);
+		{
+			lock_guard<mutex> threadsLock(m_threadsLock);
+			m_threads.push_back(this);
+		}
 
 #ifdef WIN32
 		// Get the thread's native Windows handle
@@ -59,12 +145,36 @@ bool WorkerThread::CreateThread()
 //----------------------------------------------------------------------------
 std::thread::id WorkerThread::GetThreadId()
 {
+	if (m_scheduler)
+		return m_scheduler->GetThreadId();
 	if (m_thread == nullptr)
-		throw std::invalid_argument("Thread pointer is null");
+	{
+		ThreadNotRunning();
+		return std::thread::id();
+	}
 
 	return m_thread->get_id();
 }
 
+//----------------------------------------------------------------------------
+// IsInlineCall
+//----------------------------------------------------------------------------
+bool WorkerThread::IsInlineCall() const
+{
+	return m_inlineCalls.load(std::memory_order_relaxed) && currentThread == this;
+}
+
+//----------------------------------------------------------------------------
+// SetWaitStats
+//----------------------------------------------------------------------------
+void WorkerThread::SetWaitStats(bool enable)
+{
+	std::call_once(m_waitStatsOnce, [this]() {
+		m_waitStats.reset(new DelegateLib::DelegateWaitStats("delegate.async_wait." + THREAD_NAME));
+	});
+	m_activeWaitStats.store(enable ? m_waitStats.get() : nullptr, std::memory_order_release);
+}
+
 //----------------------------------------------------------------------------
 // GetCurrentThreadId
 //----------------------------------------------------------------------------
@@ -73,35 +183,153 @@ std::thread::id WorkerThread::GetCurrentThreadId()
 	return this_thread::get_id();
 }
 
+//----------------------------------------------------------------------------
+// GetScratchArena
+//----------------------------------------------------------------------------
+ScratchArena* WorkerThread::GetScratchArena()
+{
+	return currentScratch;
+}
+
 //----------------------------------------------------------------------------
 // GetQueueSize
 //----------------------------------------------------------------------------
 size_t WorkerThread::GetQueueSize()
 {
-	lock_guard<mutex> lock(m_mutex);
-	return m_queue.size();
+	size_t size = 0;
+	if (m_scheduler)
+		return m_scheduler->GetQueued(this);
+	if (m_policy == QueuePolicy::RING)
+	{
+		for (auto& ring : m_rings)
+			size += ring->Size();
+		return size;
+	}
+
+	std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+	for (auto& queue : m_queue)
+		size += queue.size();
+	return size;
+}
+
+//----------------------------------------------------------------------------
+// GetQueuedCount
+//----------------------------------------------------------------------------
+size_t WorkerThread::GetQueuedCount() const
+{
+	if (m_policy == QueuePolicy::MUTEX)
+		return m_queuedCount.load(std::memory_order_relaxed);
+
+	size_t size = 0;
+	for (auto& ring : m_rings)
+		size += ring->Size();
+	return size;
 }
 
 //----------------------------------------------------------------------------
 // ExitThread
 //----------------------------------------------------------------------------
-void WorkerThread::ExitThread()
+size_t WorkerThread::ExitThread(ExitMode mode, std::chrono::milliseconds timeout)
 {
+	if (m_scheduler)
+	{
+		PublishMetrics(false);
+		auto deadline = mode == ExitMode::DROP ? std::chrono::steady_clock::time_point::min() :
+			mode == ExitMode::DEADLINE ? std::chrono::steady_clock::now() + timeout : 
+			std::chrono::steady_clock::time_point::max();
+		m_discarded = m_scheduler->Detach(this, deadline) + m_scheduled.Clear();
+		m_scheduler = nullptr;
+		return m_discarded;
+	}
+
 	if (!m_thread)
-		return;
+		return 0;
 
-	// Create a new ThreadMsg
-	std::shared_ptr<ThreadMsg> threadMsg(new ThreadMsg(MSG_EXIT_THREAD, 0));
+	{
+		lock_guard<mutex> threadsLock(m_threadsLock);
+		m_threads.remove(this);
+	}
+	PublishMetrics(false);
+
+	m_discarded = 0;
+	switch (mode)
+	{
+		case ExitMode::DROP:
+			m_exitDeadline = std::chrono::steady_clock::time_point::min();
+			break;
+		case ExitMode::DEADLINE:
+			m_exitDeadline = std::chrono::steady_clock::now() + timeout;
+			break;
+		case ExitMode::DRAIN:
+		default:
+			m_exitDeadline = std::chrono::steady_clock::time_point::max();
+			break;
+	}
+
+	if (m_policy == QueuePolicy::RING)
+	{
+		// Thread exits once the messages already queued are invoked or discarded
+		m_exitPending = true;
+		NotifyWaiting();
+		JoinLoop();
+		m_exitPending = false;
+		m_discarded += m_scheduled.Clear();
+		return m_discarded;
+	}
 
 	// Put exit thread message into the queue
 	{
-		lock_guard<mutex> lock(m_mutex);
-		m_queue.push(threadMsg);
-		m_cv.notify_one();
+		std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+		m_exitPending = true;
+		m_queue[static_cast<int>(Priority::LOW)].push(ThreadMsg(MSG_EXIT_THREAD));
+		m_queuedCount.fetch_add(1, std::memory_order_relaxed);
+		WakeLoop();
 	}
 
-    m_thread->join();
-    m_thread = nullptr;
+	JoinLoop();
+	m_exitPending = false;
+	m_discarded += m_scheduled.Clear();
+	return m_discarded;
+}
+
+//----------------------------------------------------------------------------
+// IsExitDeadlinePassed
+//----------------------------------------------------------------------------
+bool WorkerThread::IsExitDeadlinePassed() const
+{
+	if (!m_exitPending || m_exitDeadline == std::chrono::steady_clock::time_point::max())
+		return false;
+	return m_exitDeadline == std::chrono::steady_clock::time_point::min() ||
+		std::chrono::steady_clock::now() >= m_exitDeadline;
+}
+
+//----------------------------------------------------------------------------
+// DiscardQueued
+//----------------------------------------------------------------------------
+size_t WorkerThread::DiscardQueued()
+{
+	size_t discarded = 0;
+	for (int lane = 0; lane < PRIORITY_LANES; lane++)
+	{
+		if (m_policy == QueuePolicy::RING)
+		{
+			RingMsg ringMsg;
+			while (m_rings[lane]->TryPop(ringMsg))
+				discarded++;
+			continue;
+		}
+
+		auto& queue = m_queue[lane];
+		for (; !queue.empty(); queue.pop())
+		{
+			if (queue.front().GetId() == MSG_DISPATCH_DELEGATE)
+				discarded++;
+		}
+	}
+	m_queuedCount.store(0, std::memory_order_relaxed);
+	m_queuedBytes.store(0, std::memory_order_relaxed);
+	m_spaceCv.notify_all();
+	return discarded;
 }
 
 //----------------------------------------------------------------------------
@@ -109,34 +337,816 @@ void WorkerThread::ExitThread()
 //----------------------------------------------------------------------------
 void WorkerThread::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
 {
+	DispatchDelegate(std::move(msg), Priority::NORMAL);
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegate
+//----------------------------------------------------------------------------
+void WorkerThread::DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg, Priority priority)
+{
+	if (m_scheduler)
+	{
+		if (m_deadlineBudget.load(std::memory_order_relaxed) != 0)
+			StampDeadline(*msg, std::chrono::steady_clock::now());
+		m_scheduler->Post(this, std::move(msg));
+		return;
+	}
 	if (m_thread == nullptr)
-		throw std::invalid_argument("Thread pointer is null");
+	{
+		ThreadNotRunning();
+		return;
+	}
+
+	bool budget = m_deadlineBudget.load(std::memory_order_relaxed) != 0;
+	if (budget)
+		StampDeadline(*msg, std::chrono::steady_clock::now());
 
-	// Create a new ThreadMsg
-    std::shared_ptr<ThreadMsg> threadMsg(new ThreadMsg(MSG_DISPATCH_DELEGATE, msg));
+	bool stats = m_statsEnabled.load(std::memory_order_relaxed);
+	if (stats)
+		CountRemoteDispatches(1);
 
-	// Add dispatch delegate msg to queue and notify worker thread
-	std::unique_lock<std::mutex> lk(m_mutex);
-	m_queue.push(threadMsg);
-	m_cv.notify_one();
+	int lane = static_cast<int>(priority);
+	if (m_policy == QueuePolicy::RING)
+	{
+		// Store the delegate message inline within the ring
+		RingMsg ringMsg{ std::move(msg), std::chrono::steady_clock::time_point() };
+		if (stats)
+			ringMsg.enqueueTime = std::chrono::steady_clock::now();
+		m_rings[lane]->Push(std::move(ringMsg));
+		NotifyWaiting();
+		return;
+	}
+
+	// Add dispatch delegate msg to queue and notify worker thread. A dropped
+	// message is released once the lock is.
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	if (!AdmitMsg(lk, lane, *msg))
+		return;
+	ThreadMsg threadMsg(MSG_DISPATCH_DELEGATE, std::move(msg));
+	if (stats)
+		threadMsg.SetEnqueueTime(std::chrono::steady_clock::now());
+	m_queue[lane].push(std::move(threadMsg));
+	m_queuedCount.fetch_add(1, std::memory_order_relaxed);
+	WakeLoop();
+
+	if (stats)
+	{
+		size_t size = 0;
+		for (auto& queue : m_queue)
+			size += queue.size();
+		if (size > m_peakQueueSize.load(std::memory_order_relaxed))
+			m_peakQueueSize.store(size, std::memory_order_relaxed);
+	}
 }
 
 //----------------------------------------------------------------------------
-// TimerThread
+// DispatchDelegates
 //----------------------------------------------------------------------------
-void WorkerThread::TimerThread()
+void WorkerThread::DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count)
 {
-    while (!m_timerExit)
-    {
-        std::this_thread::sleep_for(100ms);
+	DispatchDelegates(msgs, count, Priority::NORMAL);
+}
 
-        std::shared_ptr<ThreadMsg> threadMsg (new ThreadMsg(MSG_TIMER, 0));
+//----------------------------------------------------------------------------
+// DispatchDelegates
+//----------------------------------------------------------------------------
+void WorkerThread::DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count, Priority priority)
+{
+	if (m_scheduler)
+	{
+		for (size_t i = 0; i < count; i++)
+			DispatchDelegate(std::move(msgs[i]), priority);
+		return;
+	}
+	if (m_thread == nullptr)
+	{
+		ThreadNotRunning();
+		return;
+	}
+	if (count == 0)
+		return;
+
+	int lane = static_cast<int>(priority);
+	bool stats = m_statsEnabled.load(std::memory_order_relaxed);
+	bool budget = m_deadlineBudget.load(std::memory_order_relaxed) != 0;
+	std::chrono::steady_clock::time_point now;
+	if (stats || budget)
+		now = std::chrono::steady_clock::now();
+	if (stats)
+		CountRemoteDispatches(count);
+	if (budget)
+	{
+		for (size_t i = 0; i < count; i++)
+			StampDeadline(*msgs[i], now);
+	}
+
+	if (m_policy == QueuePolicy::RING)
+	{
+		for (size_t i = 0; i < count; i++)
+			m_rings[lane]->Push(RingMsg{ std::move(msgs[i]), now });
+		NotifyWaiting();
+		return;
+	}
+
+	// Add all dispatch delegate msgs to queue and notify worker thread once
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	size_t queued = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (!AdmitMsg(lk, lane, *msgs[i]))
+			continue;
+		ThreadMsg threadMsg(MSG_DISPATCH_DELEGATE, std::move(msgs[i]));
+		threadMsg.SetEnqueueTime(now);
+		m_queue[lane].push(std::move(threadMsg));
+		queued++;
+	}
+	m_queuedCount.fetch_add(queued, std::memory_order_relaxed);
+	WakeLoop();
+
+	if (stats)
+	{
+		size_t size = 0;
+		for (auto& queue : m_queue)
+			size += queue.size();
+		if (size > m_peakQueueSize.load(std::memory_order_relaxed))
+			m_peakQueueSize.store(size, std::memory_order_relaxed);
+	}
+}
+
+//----------------------------------------------------------------------------
+// AdmitMsg
+//----------------------------------------------------------------------------
+bool WorkerThread::AdmitMsg(std::unique_lock<DelegateLib::SiteMutex>& lk, int lane, const DelegateMsg& msg)
+{
+	size_t bytes = msg.GetPayloadSize();
+
+	// The lane has room and the bytes fit the budget, or the queue is empty
+	auto fits = [this, lane, bytes]() {
+		size_t budget = m_byteBudget.load(std::memory_order_relaxed);
+		size_t queued = m_queuedBytes.load(std::memory_order_relaxed);
+		return m_queue[lane].size() < m_queueCapacity && (budget == 0 || queued == 0 || queued + bytes <= budget);
+	};
+
+	// A retire message frees the invoker borrowed by the messages queued ahead
+	// of it, so is never dropped nor kept waiting
+	QueueOverflow overflow = m_overflow.load(std::memory_order_relaxed);
+	if (overflow != QueueOverflow::GROW && !fits() && currentThread != this &&
+		msg.GetTypeId() != type_id<DelegateRetireMsg>())
+	{
+		if (overflow == QueueOverflow::DROP)
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return false;
+		}
 
-        // Add timer msg to queue and notify worker thread
-        std::unique_lock<std::mutex> lk(m_mutex);
-        m_queue.push(threadMsg);
-        m_cv.notify_one();
-    }
+		// Released by the thread taking a message or by a policy change
+		m_spaceWaiters++;
+		m_spaceCv.wait(lk, [this, &fits]() {
+			return fits() || m_overflow.load(std::memory_order_relaxed) != QueueOverflow::BLOCK;
+		});
+		m_spaceWaiters--;
+	}
+
+	size_t queued = m_queuedBytes.load(std::memory_order_relaxed) + bytes;
+	m_queuedBytes.store(queued, std::memory_order_relaxed);
+	if (queued > m_peakQueuedBytes.load(std::memory_order_relaxed))
+		m_peakQueuedBytes.store(queued, std::memory_order_relaxed);
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// SetQueueOverflow
+//----------------------------------------------------------------------------
+void WorkerThread::SetQueueOverflow(QueueOverflow overflow)
+{
+	std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+	m_overflow = overflow;
+	m_spaceCv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// SetQueueByteBudget
+//----------------------------------------------------------------------------
+void WorkerThread::SetQueueByteBudget(size_t bytes)
+{
+	std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+	m_byteBudget = bytes;
+	m_spaceCv.notify_all();
+}
+
+//----------------------------------------------------------------------------
+// SetReclaimPolicy
+//----------------------------------------------------------------------------
+void WorkerThread::SetReclaimPolicy(ReclaimPolicy policy, size_t batch)
+{
+	m_reclaimBatch.store(std::max<size_t>(batch, 1), std::memory_order_relaxed);
+	m_reclaimPolicy.store(policy, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// FreeRetired
+//----------------------------------------------------------------------------
+static void FreeRetired(std::shared_ptr<std::vector<std::shared_ptr<DelegateLib::DelegateMsg>>> batch)
+{
+	batch->clear();
+}
+
+//----------------------------------------------------------------------------
+// GetReclaimer
+//----------------------------------------------------------------------------
+WorkerThread& WorkerThread::GetReclaimer()
+{
+	// Never destroyed, as threads hand off their last batch as they exit
+	static WorkerThread* reclaimer = [] {
+		ThreadAttributes attributes;
+		attributes.policy = ThreadAttributes::SchedPolicy::IDLE;
+		WorkerThread* thread = new WorkerThread("DelegateReclaimer", QueuePolicy::MUTEX, 
+			DEFAULT_RING_CAPACITY, attributes);
+		thread->CreateThread();
+		return thread;
+	}();
+	return *reclaimer;
+}
+
+//----------------------------------------------------------------------------
+// Retire
+//----------------------------------------------------------------------------
+void WorkerThread::Retire(std::shared_ptr<DelegateLib::DelegateMsg>& delegateMsg)
+{
+	// A message a sender still holds, e.g. by an async wait call, is freed by
+	// its last owner anyway
+	if (m_reclaimPolicy.load(std::memory_order_relaxed) == ReclaimPolicy::INLINE || 
+		delegateMsg.use_count() != 1)
+		return;
+
+	m_retired.push_back(std::move(delegateMsg));
+
+	// Single writer, so no read-modify-write is needed
+	m_reclaimDeferred.store(m_reclaimDeferred.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	if (m_retired.size() >= m_reclaimBatch.load(std::memory_order_relaxed))
+		ReclaimRetired();
+}
+
+//----------------------------------------------------------------------------
+// ReclaimRetired
+//----------------------------------------------------------------------------
+void WorkerThread::ReclaimRetired()
+{
+	if (m_retired.empty())
+		return;
+
+	if (m_reclaimPolicy.load(std::memory_order_relaxed) == ReclaimPolicy::BACKGROUND)
+	{
+		// One message carries the whole batch. The held vector keeps its capacity.
+		auto batch = std::make_shared<std::vector<std::shared_ptr<DelegateLib::DelegateMsg>>>();
+		batch->reserve(m_retired.size());
+		for (auto& msg : m_retired)
+			batch->push_back(std::move(msg));
+		m_retired.clear();
+		MakeDelegate(&FreeRetired, GetReclaimer()).AsyncInvoke(batch);
+	}
+	else
+		m_retired.clear();
+}
+
+//----------------------------------------------------------------------------
+// SetTrimPolicy
+//----------------------------------------------------------------------------
+void WorkerThread::SetTrimPolicy(const TrimPolicy& policy)
+{
+	{
+		std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+		m_trimPolicy = policy;
+	}
+	if (policy.quietPeriod.count() > 0)
+		m_trimTimer.Start(policy.quietPeriod);
+	else
+		m_trimTimer.Stop();
+}
+
+//----------------------------------------------------------------------------
+// TrimIdle
+//----------------------------------------------------------------------------
+void WorkerThread::TrimIdle()
+{
+	// Trim once per idle spell, a whole check period after the last message
+	if (m_taken != m_trimTaken)
+	{
+		m_trimTaken = m_taken;
+		m_trimmed = false;
+		return;
+	}
+	if (m_trimmed)
+		return;
+	m_trimmed = true;
+
+	TrimPolicy policy;
+	{
+		std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+		policy = m_trimPolicy;
+		for (auto& queue : m_queue)
+			queue.Shrink(policy.queueLowWater);
+	}
+	// Timer handlers run before this one have returned, so their scratch is dead
+	m_scratch.Reset();
+	m_scratch.Trim(policy.bufferLowWater);
+	ReleaseFreeMemory();
+}
+
+//----------------------------------------------------------------------------
+// CountRemoteDispatches
+//----------------------------------------------------------------------------
+void WorkerThread::CountRemoteDispatches(size_t count)
+{
+	int node = m_attributes.numaNode;
+	if (node >= 0 && GetCurrentNumaNode() != node)
+		m_remoteDispatches.fetch_add(count, std::memory_order_relaxed);
+}
+
+//----------------------------------------------------------------------------
+// SetStatsEnabled
+//----------------------------------------------------------------------------
+void WorkerThread::SetStatsEnabled(bool enable)
+{
+	if (enable)
+	{
+		std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+		m_queueWait.Reset();
+		m_service.Reset();
+		m_invoked = 0;
+		m_expired = 0;
+		m_remoteDispatches = 0;
+		m_peakQueueSize = 0;
+		m_statsStart = std::chrono::steady_clock::now();
+	}
+	m_statsEnabled = enable;
+}
+
+//----------------------------------------------------------------------------
+// GetStats
+//----------------------------------------------------------------------------
+WorkerThread::Stats WorkerThread::GetStats()
+{
+	Stats stats = {};
+	size_t size = 0;
+	{
+		std::lock_guard<DelegateLib::SiteMutex> lock(m_mutex);
+		for (int lane = 0; lane < PRIORITY_LANES; lane++)
+		{
+			stats.laneSize[lane] = m_policy == QueuePolicy::RING ? m_rings[lane]->Size() : m_queue[lane].size();
+			size += stats.laneSize[lane];
+		}
+
+		auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_statsStart);
+		stats.invoked = m_invoked;
+		stats.expired = m_expired;
+		stats.dropped = m_dropped;
+		stats.queuedBytes = m_queuedBytes;
+		stats.peakQueuedBytes = m_peakQueuedBytes;
+		stats.numaNode = m_attributes.numaNode;
+		stats.remoteDispatches = m_remoteDispatches;
+		stats.wakeups = GetWakeups();
+		stats.wakeupsAvoided = GetWakeupsAvoided();
+		stats.reclaimDeferred = m_reclaimDeferred.load(std::memory_order_relaxed);
+		stats.throughput = elapsed.count() > 0 ? (double)stats.invoked / elapsed.count() : 0;
+	}
+
+	stats.peakQueueSize = m_peakQueueSize;
+	if (m_policy == QueuePolicy::RING)
+	{
+		stats.peakQueueSize = 0;
+		for (auto& ring : m_rings)
+			stats.peakQueueSize += ring->GetPeakDepth();
+	}
+	stats.peakQueueSize = std::max(stats.peakQueueSize, size);
+
+	stats.queueWait = { m_queueWait.GetPercentile(50), m_queueWait.GetPercentile(99), m_queueWait.GetPercentile(99.9) };
+	stats.service = { m_service.GetPercentile(50), m_service.GetPercentile(99), m_service.GetPercentile(99.9) };
+	return stats;
+}
+
+//----------------------------------------------------------------------------
+// GetThreadCpuTime
+//----------------------------------------------------------------------------
+/// Get the CPU time the calling thread has used
+static std::chrono::nanoseconds GetThreadCpuTime()
+{
+#ifdef WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user))
+		return std::chrono::nanoseconds(0);
+	uint64_t ticks = ((uint64_t)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) + 
+		((uint64_t)user.dwHighDateTime << 32 | user.dwLowDateTime);
+	return std::chrono::nanoseconds(ticks * 100);
+#else
+	timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+		return std::chrono::nanoseconds(0);
+	return std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec);
+#endif
+}
+
+//----------------------------------------------------------------------------
+// SetOriginAccounting
+//----------------------------------------------------------------------------
+void WorkerThread::SetOriginAccounting(bool enable)
+{
+	if (enable)
+	{
+		for (auto& counters : m_originCounters)
+		{
+			counters.invoked.store(0, std::memory_order_relaxed);
+			counters.cpuNs.store(0, std::memory_order_relaxed);
+		}
+	}
+	m_originAccounting.store(enable, std::memory_order_release);
+}
+
+//----------------------------------------------------------------------------
+// GetOriginUsage
+//----------------------------------------------------------------------------
+std::vector<WorkerThread::OriginUsage> WorkerThread::GetOriginUsage() const
+{
+	std::vector<OriginUsage> usage;
+	for (size_t origin = 0; origin < DelegateLib::MAX_ORIGINS; origin++)
+	{
+		uint64_t invoked = m_originCounters[origin].invoked.load(std::memory_order_relaxed);
+		if (invoked == 0)
+			continue;
+		usage.push_back({ (OriginId)origin, GetOriginName((OriginId)origin), invoked, 
+			std::chrono::nanoseconds(m_originCounters[origin].cpuNs.load(std::memory_order_relaxed)) });
+	}
+	std::sort(usage.begin(), usage.end(), 
+		[](const OriginUsage& a, const OriginUsage& b) { return a.cpuTime > b.cpuTime; });
+	return usage;
+}
+
+//----------------------------------------------------------------------------
+// DispatchDelegateAt
+//----------------------------------------------------------------------------
+bool WorkerThread::DispatchDelegateAt(std::shared_ptr<DelegateLib::DelegateMsg> msg, std::chrono::steady_clock::time_point due)
+{
+	// Held in Timer ticks so scheduled messages follow a VirtualClock like timers
+	m_scheduled.Push(std::move(msg), std::chrono::duration_cast<std::chrono::microseconds>(due.time_since_epoch()));
+	return true;
+}
+
+//----------------------------------------------------------------------------
+// StampDeadline
+//----------------------------------------------------------------------------
+void WorkerThread::StampDeadline(DelegateLib::DelegateMsg& msg, std::chrono::steady_clock::time_point now) const
+{
+	if (msg.GetDeadline() == std::chrono::steady_clock::time_point::max())
+		msg.SetDeadline(now + std::chrono::nanoseconds(m_deadlineBudget.load(std::memory_order_relaxed)));
+}
+
+//----------------------------------------------------------------------------
+// Invoke
+//----------------------------------------------------------------------------
+void WorkerThread::Invoke(std::shared_ptr<DelegateLib::DelegateMsg>& delegateMsg, 
+	std::chrono::steady_clock::time_point enqueueTime)
+{
+	ASSERT_TRUE(delegateMsg);
+
+	// Discard a message its sender cancelled while queued, i.e. a blocking call
+	// the sender stopped waiting for
+	if (delegateMsg->IsCancelled())
+	{
+		if (DelegateLib::DelegateWaitStats* stats = GetWaitStats())
+			stats->Discarded();
+		return;
+	}
+
+	// Discard a message that is stale by the time the thread takes it
+	auto deadline = delegateMsg->GetDeadline();
+	if (deadline != std::chrono::steady_clock::time_point::max() && 
+		std::chrono::steady_clock::now() > deadline)
+	{
+		m_expired.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	m_heartbeat.Beat(reinterpret_cast<uintptr_t>(delegateMsg->GetTypeId()));
+
+	TRACE_SCOPE("WorkerThread::Invoke");
+	static DelegateLib::MetricCounter& invokedMetric = DelegateLib::Metrics::GetCounter("workerthread.invoked");
+	invokedMetric.Add();
+
+	auto invoker = delegateMsg->GetDelegateInvoker();
+	ASSERT_TRUE(invoker);
+
+	// Messages queued before statistics were enabled have no enqueue time
+	bool stats = m_statsEnabled.load(std::memory_order_relaxed) && 
+		enqueueTime != std::chrono::steady_clock::time_point();
+	std::chrono::steady_clock::time_point start;
+	if (stats)
+	{
+		start = std::chrono::steady_clock::now();
+		m_queueWait.Record(start - enqueueTime);
+	}
+
+	// The calls the target makes are attributed to the message's origin
+	OriginId origin = delegateMsg->GetOrigin();
+	OriginScope originScope(origin != NO_ORIGIN ? origin : GetThreadOrigin());
+	TraceContextScope traceScope(delegateMsg->GetTraceContext());
+	bool accounting = m_originAccounting.load(std::memory_order_relaxed) && origin < MAX_ORIGINS;
+	std::chrono::nanoseconds cpuStart;
+	if (accounting)
+		cpuStart = GetThreadCpuTime();
+
+	// Invoke the delegate destination target function
+	bool success = invoker->Invoke(delegateMsg);
+	ASSERT_TRUE(success);
+
+	if (accounting)
+	{
+		// Single writer, so no read-modify-write is needed
+		OriginCounters& counters = m_originCounters[origin];
+		counters.cpuNs.store(counters.cpuNs.load(std::memory_order_relaxed) + 
+			(uint64_t)(GetThreadCpuTime() - cpuStart).count(), std::memory_order_relaxed);
+		counters.invoked.store(counters.invoked.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	// Release the handler's scratch allocations
+	m_scratch.Reset();
+
+	if (stats)
+	{
+		m_service.Record(std::chrono::steady_clock::now() - start);
+		m_invoked.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+//----------------------------------------------------------------------------
+// InvokeScheduled
+//----------------------------------------------------------------------------
+void WorkerThread::InvokeScheduled(std::shared_ptr<DelegateLib::DelegateMsg>& delegateMsg)
+{
+	// Run as this thread while nested within another thread's message
+	const WorkerThread* previousThread = currentThread;
+	ScratchArena* previousScratch = currentScratch;
+	currentThread = this;
+	currentScratch = &m_scratch;
+	Invoke(delegateMsg, std::chrono::steady_clock::time_point());
+	currentThread = previousThread;
+	currentScratch = previousScratch;
+}
+
+//----------------------------------------------------------------------------
+// ServiceScheduledTimers
+//----------------------------------------------------------------------------
+void WorkerThread::ServiceScheduledTimers()
+{
+	const WorkerThread* previousThread = currentThread;
+	ScratchArena* previousScratch = currentScratch;
+	currentThread = this;
+	currentScratch = &m_scratch;
+	ServiceTimers();
+	currentThread = previousThread;
+	currentScratch = previousScratch;
+}
+
+//----------------------------------------------------------------------------
+// SelectLane
+//----------------------------------------------------------------------------
+int WorkerThread::SelectLane(unsigned readyLanes)
+{
+	if (readyLanes == 0)
+		return -1;
+
+	// Take from the highest priority ready lane with credit left this round
+	for (int round = 0; round < 2; round++)
+	{
+		for (int lane = 0; lane < PRIORITY_LANES; lane++)
+		{
+			if ((readyLanes & (1u << lane)) && m_laneCredits[lane] > 0)
+			{
+				m_laneCredits[lane]--;
+				return lane;
+			}
+		}
+
+		// All ready lanes used their credit so start a new round
+		for (int lane = 0; lane < PRIORITY_LANES; lane++)
+			m_laneCredits[lane] = LANE_WEIGHTS[lane];
+	}
+	return -1;
+}
+
+//----------------------------------------------------------------------------
+// GetQueuedLanes
+//----------------------------------------------------------------------------
+unsigned WorkerThread::GetQueuedLanes() const
+{
+	unsigned lanes = 0;
+	for (int lane = 0; lane < PRIORITY_LANES; lane++)
+	{
+		if (!m_queue[lane].empty())
+			lanes |= 1u << lane;
+	}
+	return lanes;
+}
+
+//----------------------------------------------------------------------------
+// GetRingLanes
+//----------------------------------------------------------------------------
+unsigned WorkerThread::GetRingLanes() const
+{
+	unsigned lanes = 0;
+	for (int lane = 0; lane < PRIORITY_LANES; lane++)
+	{
+		if (!m_rings[lane]->Empty())
+			lanes |= 1u << lane;
+	}
+	return lanes;
+}
+
+//----------------------------------------------------------------------------
+// WakeTimers
+//----------------------------------------------------------------------------
+void WorkerThread::WakeTimers(void*)
+{
+	// Each thread recomputes its timer deadline on wakeup
+	lock_guard<mutex> threadsLock(m_threadsLock);
+	for (WorkerThread* thread : m_threads)
+		WakeThread(thread);
+}
+
+//----------------------------------------------------------------------------
+// PublishMetrics
+//----------------------------------------------------------------------------
+void WorkerThread::PublishMetrics(bool publish)
+{
+	const std::string prefix = "workerthread." + THREAD_NAME;
+	if (!publish)
+	{
+		DelegateLib::Metrics::RemoveGauge(prefix + ".queue_size");
+		DelegateLib::Metrics::RemoveGauge(prefix + ".expired");
+		DelegateLib::Metrics::RemoveGauge(prefix + ".wakeups");
+		DelegateLib::Metrics::RemoveGauge(prefix + ".wakeups_avoided");
+		return;
+	}
+	DelegateLib::Metrics::SetGauge(prefix + ".queue_size", [this]() { return (double)GetQueueSize(); });
+	DelegateLib::Metrics::SetGauge(prefix + ".expired", [this]() { return (double)m_expired.load(std::memory_order_relaxed); });
+	DelegateLib::Metrics::SetGauge(prefix + ".wakeups", [this]() { return (double)GetWakeups(); });
+	DelegateLib::Metrics::SetGauge(prefix + ".wakeups_avoided", [this]() { return (double)GetWakeupsAvoided(); });
+}
+
+//----------------------------------------------------------------------------
+// WakeThread
+//----------------------------------------------------------------------------
+void WorkerThread::WakeThread(void* context)
+{
+	WorkerThread* thread = static_cast<WorkerThread*>(context);
+	std::lock_guard<DelegateLib::SiteMutex> lock(thread->m_mutex);
+	thread->WakeLoop();
+}
+
+//----------------------------------------------------------------------------
+// IsTimerChanged
+//----------------------------------------------------------------------------
+bool WorkerThread::IsTimerChanged() const
+{
+	return m_ownDeadline.timers->GetGeneration() != m_ownDeadline.generation ||
+		m_defaultDeadline.timers->GetGeneration() != m_defaultDeadline.generation ||
+		m_scheduled.GetGeneration() != m_scheduledGeneration ||
+		DelegateLib::Clock::GetAdvances() != m_clockAdvances;
+}
+
+//----------------------------------------------------------------------------
+// ServiceTimers
+//----------------------------------------------------------------------------
+std::chrono::steady_clock::time_point WorkerThread::ServiceTimers()
+{
+	m_clockAdvances = DelegateLib::Clock::GetAdvances();
+	auto deadline = std::min(ServiceTimers(m_ownDeadline), ServiceTimers(m_defaultDeadline));
+	return std::min(deadline, ServiceScheduled());
+}
+
+//----------------------------------------------------------------------------
+// ServiceScheduled
+//----------------------------------------------------------------------------
+std::chrono::steady_clock::time_point WorkerThread::ServiceScheduled()
+{
+	uint64_t generation = m_scheduled.GetGeneration();
+	bool expired = m_scheduledRunning && Timer::GetTime() >= m_scheduledDue;
+	if (expired)
+	{
+		m_scheduled.PopDue(Timer::GetTime(), m_dueMsgs);
+		for (auto& msg : m_dueMsgs)
+		{
+			// A scheduled thread's due messages join the scheduler's interleaving
+			if (m_scheduler)
+			{
+				m_scheduler->Post(this, std::move(msg));
+				continue;
+			}
+			m_taken++;
+			Invoke(msg, std::chrono::steady_clock::time_point());
+		}
+		m_dueMsgs.clear();
+	}
+
+	// Find the earliest due time once messages are invoked or one is scheduled earlier
+	if (expired || generation != m_scheduledGeneration)
+	{
+		m_scheduledGeneration = generation;
+		m_scheduledRunning = m_scheduled.GetNextDue(m_scheduledDue);
+	}
+
+	if (!m_scheduledRunning)
+		return std::chrono::steady_clock::time_point::max();
+	return std::chrono::steady_clock::now() + (m_scheduledDue - Timer::GetTime());
+}
+
+//----------------------------------------------------------------------------
+// ServiceTimers
+//----------------------------------------------------------------------------
+std::chrono::steady_clock::time_point WorkerThread::ServiceTimers(TimerDeadline& deadline)
+{
+	bool expired = deadline.running && Timer::GetTime() >= deadline.expiration;
+	if (expired)
+	{
+		m_heartbeat.Busy(0);
+		deadline.timers->ProcessTimers();
+		m_scratch.Reset();
+	}
+
+	// Find the earliest deadline once timers expire or a timer is started
+	uint64_t generation = deadline.timers->GetGeneration();
+	if (expired || generation != deadline.generation)
+	{
+		deadline.generation = generation;
+		deadline.running = deadline.timers->GetNextExpiration(deadline.expiration);
+	}
+
+	if (!deadline.running)
+		return std::chrono::steady_clock::time_point::max();
+	return std::chrono::steady_clock::now() + (deadline.expiration - Timer::GetTime());
+}
+
+//----------------------------------------------------------------------------
+// IsRingReady
+//----------------------------------------------------------------------------
+bool WorkerThread::IsRingReady() const
+{
+	return GetRingLanes() != 0 || m_exitPending || IsTimerChanged();
+}
+
+//----------------------------------------------------------------------------
+// IsQueueReady
+//----------------------------------------------------------------------------
+bool WorkerThread::IsQueueReady() const
+{
+	return m_queuedCount.load(std::memory_order_acquire) != 0 || IsTimerChanged();
+}
+
+//----------------------------------------------------------------------------
+// WaitRing
+//----------------------------------------------------------------------------
+void WorkerThread::WaitRing(std::chrono::steady_clock::time_point deadline)
+{
+	// Park until a producer wakes the thread or the next timer expires
+	auto ready = [this]() { return IsRingReady(); };
+	std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+	WaitReady(lk, deadline, ready, ready);
+}
+
+//----------------------------------------------------------------------------
+// ProcessRing
+//----------------------------------------------------------------------------
+void WorkerThread::ProcessRing()
+{
+	while (1)
+	{
+		// Expire timers and find the next timer deadline
+		std::chrono::steady_clock::time_point deadline = ServiceTimers();
+		if (!m_retired.empty() && GetQueuedCount() == 0)
+			ReclaimRetired();
+		m_heartbeat.Idle();
+
+		if (IsExitDeadlinePassed())
+		{
+			m_discarded = DiscardQueued();
+			return;
+		}
+
+		RingMsg ringMsg;
+		int lane = SelectLane(GetRingLanes());
+		if (lane >= 0 && m_rings[lane]->TryPop(ringMsg))
+		{
+			m_taken++;
+			Invoke(ringMsg.msg, ringMsg.enqueueTime);
+			Retire(ringMsg.msg);
+			continue;
+		}
+
+		if (m_exitPending)
+			return;
+
+		WaitRing(deadline);
+	}
 }
 
 //----------------------------------------------------------------------------
@@ -144,55 +1154,81 @@ void WorkerThread::TimerThread()
 //----------------------------------------------------------------------------
 void WorkerThread::Process()
 {
-    m_timerExit = false;
-    std::thread timerThread(&WorkerThread::TimerThread, this);
+	TRACE_THREAD_NAME(THREAD_NAME);
+	currentThread = this;
+	currentScratch = &m_scratch;
+
+	// Free the messages still held once the loop returns
+	struct RetiredScope
+	{
+		WorkerThread* thread;
+		~RetiredScope() { thread->ReclaimRetired(); }
+	} retiredScope{ this };
+
+	if (m_policy == QueuePolicy::RING)
+	{
+		ProcessRing();
+		return;
+	}
 
 	while (1)
 	{
-		std::shared_ptr<ThreadMsg> msg;
+		// Expire timers and find the next timer deadline
+		std::chrono::steady_clock::time_point deadline = ServiceTimers();
+		if (!m_retired.empty() && GetQueuedCount() == 0)
+			ReclaimRetired();
+		m_heartbeat.Idle();
+
+		ThreadMsg msg;
 		{
-			// Wait for a message to be added to the queue
-			std::unique_lock<std::mutex> lk(m_mutex);
-			while (m_queue.empty())
-				m_cv.wait(lk);
+			// Wait for a message, the next timer deadline or a timer start
+			std::unique_lock<DelegateLib::SiteMutex> lk(m_mutex);
+			WaitReady(lk, deadline, 
+				[this]() { return GetQueuedLanes() != 0 || IsTimerChanged(); },
+				[this]() { return IsQueueReady(); });
+
+			if (IsExitDeadlinePassed())
+			{
+				m_discarded = DiscardQueued();
+				return;
+			}
 
-			if (m_queue.empty())
+			int lane = SelectLane(GetQueuedLanes());
+			if (lane < 0)
 				continue;
 
-			msg = m_queue.front();
-			m_queue.pop();
+			msg = std::move(m_queue[lane].front());
+			m_queue[lane].pop();
+			m_taken++;
+			if (msg.GetData())
+				m_queuedBytes.fetch_sub(msg.GetData()->GetPayloadSize(), std::memory_order_relaxed);
+			if (m_spaceWaiters)
+				m_spaceCv.notify_all();
+
+			// Exit once the messages queued on the other lanes are invoked
+			if (msg.GetId() == MSG_EXIT_THREAD && GetQueuedLanes() != 0)
+			{
+				m_queue[lane].push(std::move(msg));
+				continue;
+			}
+			m_queuedCount.fetch_sub(1, std::memory_order_relaxed);
 		}
 
-		switch (msg->GetId())
+		switch (msg.GetId())
 		{
 			case MSG_DISPATCH_DELEGATE:
 			{
 				// Get pointer to DelegateMsg data from queue msg data
-                auto delegateMsg = msg->GetData();
-				ASSERT_TRUE(delegateMsg);
-
-				auto invoker = delegateMsg->GetDelegateInvoker();
-				ASSERT_TRUE(invoker);
-
-				// Invoke the delegate destination target function
-				bool success = invoker->Invoke(delegateMsg);
-				ASSERT_TRUE(success);
+				Invoke(msg.GetData(), msg.GetEnqueueTime());
+				Retire(msg.GetData());
 				break;
 			}
 
-            case MSG_TIMER:
-                Timer::ProcessTimers();
-                break;
-
 			case MSG_EXIT_THREAD:
-			{
-                m_timerExit = true;
-                timerThread.join();
-                return;
-			}
+				return;
 
 			default:
-				throw std::invalid_argument("Invalid message ID");
+				DELEGATE_THROW(DelegateError::INVALID_MESSAGE, std::invalid_argument("Invalid message ID"));
 		}
 	}
 }
@@ -6,19 +6,162 @@
 
 #include "DelegateOpt.h"
 #include "DelegateThread.h"
+#include "DelegateWaitStats.h"
+#include "ActiveObject.h"
+#include "LockFreeQueue.h"
+#include "Timer.h"
+#include "ScheduledQueue.h"
+#include "ThreadAttributes.h"
+#include "LatencyHistogram.h"
+#include "SpinWait.h"
+#include "ScratchArena.h"
+#include "ThreadMsg.h"
+#include "DeterministicScheduler.h"
+#include "MemoryTrim.h"
 #include <thread>
-#include <queue>
+#include <list>
+#include <vector>
+#include <array>
+#include <chrono>
 #include <mutex>
 #include <atomic>
 #include <condition_variable>
 
-class ThreadMsg;
+/// Number of WorkerThread priority lanes
+constexpr int WORKER_PRIORITY_LANES = 3;
 
-class WorkerThread : public DelegateLib::DelegateThread
+/// WorkerThread message queue, one ThreadMsgQueue per priority lane
+typedef std::array<ThreadMsgQueue, WORKER_PRIORITY_LANES> WorkerLaneQueues;
+
+class WorkerThread : public DelegateLib::DelegateThread, 
+	private ActiveObject<ThreadMsg, WorkerLaneQueues>
 {
 public:
+	/// Selects the queue holding messages dispatched to the thread
+	enum class QueuePolicy
+	{
+		MUTEX,		///< Ring queue per lane protected by a mutex.
+					///< Full lanes are handled by the QueueOverflow policy.
+		RING,		///< Bounded lock-free ring. A full ring blocks the sender.
+		SCHEDULED	///< No OS thread. Run by the installed DeterministicScheduler.
+	};
+
+	/// Message dispatch priority. Each priority has its own queue lane.
+	enum class Priority
+	{
+		HIGH,		///< Latency critical delegates
+		NORMAL,		///< Default priority
+		LOW			///< Bulk traffic
+	};
+
+	/// Selects what ExitThread() does with the messages still queued
+	enum class ExitMode
+	{
+		DRAIN,		///< Invoke every queued message before exiting
+		DROP,		///< Discard the queued messages and exit once the running delegate returns
+		DEADLINE	///< Invoke queued messages until the timeout, then discard the rest
+	};
+
+	/// Selects what a QueuePolicy::MUTEX dispatch does when its lane holds the
+	/// queue capacity
+	enum class QueueOverflow
+	{
+		GROW,		///< Queue the message, doubling the lane's buffer
+		BLOCK,		///< Wait until the thread takes a message from the lane
+		DROP		///< Discard the message
+	};
+
+	/// Selects when the thread frees the delegate messages it has invoked
+	enum class ReclaimPolicy
+	{
+		INLINE,		///< Free each message as its call returns
+		IDLE,		///< Free the messages in bulk once no message is queued
+		BACKGROUND	///< Hand the messages in batches to the shared reclaimer thread
+	};
+
+	/// Number of priority lanes
+	static const int PRIORITY_LANES = WORKER_PRIORITY_LANES;
+
+	/// Messages taken from each lane per scheduling round, highest priority first.
+	/// Every non-empty lane is served each round so no lane starves.
+	static const int LANE_WEIGHTS[PRIORITY_LANES];
+
+	/// Default queue capacity per priority lane
+	static const size_t DEFAULT_RING_CAPACITY = 1024;
+
+	/// Default number of invoked messages held before they are freed or handed off
+	static const size_t DEFAULT_RECLAIM_BATCH = 256;
+
+	/// Queue wait or service time percentiles
+	struct Percentiles
+	{
+		std::chrono::nanoseconds p50;
+		std::chrono::nanoseconds p99;
+		std::chrono::nanoseconds p999;
+	};
+
+	/// Thread statistics collected while statistics are enabled
+	struct Stats
+	{
+		/// Messages queued on each priority lane
+		size_t laneSize[PRIORITY_LANES];
+
+		/// Peak number of queued messages
+		size_t peakQueueSize;
+
+		/// Delegates invoked
+		uint64_t invoked;
+
+		/// Delegates invoked per second
+		double throughput;
+
+		/// Delegates discarded because their deadline passed before the thread 
+		/// took them. Counted even while statistics are disabled.
+		uint64_t expired;
+
+		/// The NUMA node the thread is placed on, or -1 for none
+		int numaNode;
+
+		/// Delegates discarded by QueueOverflow::DROP. Counted even while 
+		/// statistics are disabled.
+		uint64_t dropped;
+
+		/// Payload bytes of the queued messages, and the most seen. Counted 
+		/// for QueuePolicy::MUTEX even while statistics are disabled.
+		size_t queuedBytes;
+		size_t peakQueuedBytes;
+
+		/// Delegates dispatched from a CPU on another NUMA node than the thread's. 
+		/// Counted only if the thread is placed on a node.
+		uint64_t remoteDispatches;
+
+		/// Wakeups of the sleeping thread, and dispatches that found the thread
+		/// awake and so made none. Counted even while statistics are disabled.
+		uint64_t wakeups;
+		uint64_t wakeupsAvoided;
+
+		/// Invoked messages whose freeing was deferred by the reclaim policy. 
+		/// Counted even while statistics are disabled.
+		uint64_t reclaimDeferred;
+
+		/// Time from dispatch until the thread takes the message
+		Percentiles queueWait;
+
+		/// Time spent within Invoke()
+		Percentiles service;
+	};
+
 	/// Constructor
-	WorkerThread(const std::string& threadName);
+	/// @param[in] threadName - the thread name
+	/// @param[in] policy - the message queue policy
+	/// @param[in] ringCapacity - the maximum number of queued messages per 
+	///		priority lane. Must be a power of 2. For QueuePolicy::MUTEX the lanes 
+	///		are preallocated to this capacity by CreateThread(), so dispatching
+	///		within it never allocates queue memory.
+	/// @param[in] attributes - the CPU affinity, scheduling, stack size and NUMA
+	///		placement applied when the thread is created
+	WorkerThread(const std::string& threadName, QueuePolicy policy = QueuePolicy::MUTEX, 
+		size_t ringCapacity = DEFAULT_RING_CAPACITY, const ThreadAttributes& attributes = ThreadAttributes());
 
 	/// Destructor
 	~WorkerThread();
@@ -27,8 +170,14 @@ public:
 	/// @return TRUE if thread is created. FALSE otherise. 
 	bool CreateThread();
 
-	/// Called once a program exit to exit the worker thread
-	void ExitThread();
+	/// Called once a program exit to exit the worker thread. A delegate already 
+	/// running is never interrupted, so the timeout bounds the queued work only.
+	/// A sender blocked on a discarded async wait delegate waits for its own 
+	/// timeout. Scheduled messages not yet due are discarded in every mode.
+	/// @param[in] mode - how the queued messages are handled
+	/// @param[in] timeout - the time allowed to drain the queue for ExitMode::DEADLINE
+	/// @return The number of queued delegates discarded without being invoked.
+	size_t ExitThread(ExitMode mode = ExitMode::DRAIN, std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
 
 	/// Get the ID of this thread instance
 	std::thread::id GetThreadId();
@@ -36,30 +185,547 @@ public:
 	/// Get the ID of the currently executing thread
 	static std::thread::id GetCurrentThreadId();
 
+	/// Get the scratch arena of the calling WorkerThread. A delegate handler 
+	/// allocates temporaries from it, e.g. through a ScratchAllocator, and the
+	/// arena is reset once the handler, or a timer callback, returns. The memory
+	/// must not be kept beyond the handler.
+	/// @return The arena, or nullptr if not called on a WorkerThread.
+	static ScratchArena* GetScratchArena();
+
 	/// Get thread name
 	std::string GetThreadName() { return THREAD_NAME; }
 
 	/// Get size of thread message queue.
 	size_t GetQueueSize();
 
+	/// Enable or disable queue wait and service time statistics. Statistics 
+	/// are reset when enabled. Disabled statistics cost one relaxed atomic load
+	/// per message.
+	/// @param[in] enable - true to collect statistics
+	void SetStatsEnabled(bool enable);
+
+	/// Get the thread statistics. Function call is thread-safe.
+	/// @return The statistics collected since statistics were enabled.
+	Stats GetStats();
+
+	/// The work a thread did for one origin
+	struct OriginUsage
+	{
+		DelegateLib::OriginId origin;
+
+		/// The origin name. See DelegateLib::RegisterOrigin().
+		std::string name;
+
+		/// Delegates invoked
+		uint64_t invoked;
+
+		/// Thread CPU time spent within Invoke(). Zero where unsupported.
+		std::chrono::nanoseconds cpuTime;
+	};
+
+	/// Enable or disable accounting the thread CPU time of each invoked 
+	/// delegate to the origin of its message. The usage is reset when enabled.
+	/// Enabled accounting reads the thread CPU clock twice per message; 
+	/// disabled it costs one relaxed atomic load. Function call is thread-safe.
+	/// @param[in] enable - true to account usage per origin
+	void SetOriginAccounting(bool enable);
+
+	/// Get the usage of each origin accounted since SetOriginAccounting(true).
+	/// Function call is thread-safe.
+	/// @return The origins with delegates invoked, most CPU time first.
+	std::vector<OriginUsage> GetOriginUsage() const;
+
+	/// Set the deadline budget stamped on dispatched messages without a deadline.
+	/// A message still queued once the budget elapses is discarded when taken and 
+	/// counted in Stats::expired. Function call is thread-safe.
+	/// @param[in] budget - the time allowed from dispatch until the thread takes
+	///		the message, or zero for no deadline
+	void SetDeadlineBudget(std::chrono::nanoseconds budget) { m_deadlineBudget = budget.count(); }
+
+	/// Invoke async and async wait delegates called from this thread directly 
+	/// instead of dispatching them. Calls the thread makes to itself then skip 
+	/// the queue round trip, and an async wait call no longer blocks until its 
+	/// timeout. An inline call runs ahead of the messages already queued.
+	/// Disabled by default. Function call is thread-safe.
+	/// @param[in] enable - true to invoke same-thread calls inline
+	void SetInlineCalls(bool enable) { m_inlineCalls.store(enable, std::memory_order_relaxed); }
+
+	/// Check if a delegate call targeting this thread is invoked inline
+	/// @return True if inline calls are enabled and the caller runs on this thread.
+	virtual bool IsInlineCall() const;
+
+	/// Each priority lane is a FIFO queue handled by the one thread
+	/// @return True.
+	virtual bool IsOrdered() const { return true; }
+
+	/// Get the NUMA node from the thread attributes
+	/// @return The NUMA node, or -1 for none.
+	virtual int GetNumaNode() const { return m_attributes.numaNode; }
+
+	/// Allocate the asynchronous delegate messages dispatched to this thread from
+	/// a memory resource, e.g. a synchronized_pool_resource owned by the 
+	/// subsystem. Messages are freed by this thread, so the resource must be 
+	/// thread safe and outlive every message dispatched, including messages 
+	/// discarded by ExitThread(). Function call is thread-safe.
+	/// @param[in] resource - the memory resource, or nullptr for the fixed block allocator
+	void SetMemoryResource(std::pmr::memory_resource* resource) { m_resource.store(resource, std::memory_order_release); }
+
+	/// Get the memory resource set by SetMemoryResource()
+	/// @return The resource, or nullptr for the fixed block allocator.
+	virtual std::pmr::memory_resource* GetMemoryResource() const { return m_resource.load(std::memory_order_acquire); }
+
+	/// Capture the delegate calls queued onto this thread by delegates with a 
+	/// RecordPolicy. The recorder must outlive the capture, so stop the source 
+	/// threads before destroying it. Function call is thread-safe.
+	/// @param[in] recorder - the recorder, or nullptr to stop capturing
+	void SetRecorder(DelegateLib::DelegateRecorder* recorder) { m_recorder.store(recorder, std::memory_order_release); }
+
+	/// Get the recorder set by SetRecorder()
+	/// @return The recorder, or nullptr if not capturing.
+	virtual DelegateLib::DelegateRecorder* GetRecorder() const { return m_recorder.load(std::memory_order_acquire); }
+
+	/// Count the outcome and wait time of each blocking asynchronous call 
+	/// dispatched to this thread in the metrics registry, named 
+	/// "delegate.async_wait.<thread name>", see DelegateWaitStats.h. Function
+	/// call is thread-safe.
+	/// @param[in] enable - true to collect the statistics
+	void SetWaitStats(bool enable);
+
+	/// Get the statistics enabled by SetWaitStats()
+	/// @return The statistics, or nullptr if not collected.
+	virtual DelegateLib::DelegateWaitStats* GetWaitStats() const { return m_activeWaitStats.load(std::memory_order_acquire); }
+
+	/// Get the deadline budget
+	/// @return The budget, or zero if messages get no deadline.
+	std::chrono::nanoseconds GetDeadlineBudget() const { return std::chrono::nanoseconds(m_deadlineBudget.load()); }
+
+	/// Get the message queue policy
+	QueuePolicy GetQueuePolicy() const { return m_policy; }
+
+	/// Set what a QueuePolicy::MUTEX dispatch does when its lane is at capacity.
+	/// The default is QueueOverflow::GROW. A dispatch from the thread itself 
+	/// always grows the lane so the thread never blocks on its own queue. 
+	/// Function call is thread-safe.
+	/// @param[in] overflow - the overflow policy
+	void SetQueueOverflow(QueueOverflow overflow);
+
+	/// Get the overflow policy
+	QueueOverflow GetQueueOverflow() const { return m_overflow.load(std::memory_order_relaxed); }
+
+	/// Limit the payload bytes of the messages queued on a QueuePolicy::MUTEX 
+	/// thread, summed over every lane. Each message is charged its 
+	/// DelegateMsg::GetPayloadSize(), including the heap memory of its argument
+	/// copies, so a few large arguments count as much as many small ones. A
+	/// dispatch over the budget is handled by the QueueOverflow policy as if its
+	/// lane were full: QueueOverflow::BLOCK waits and QueueOverflow::DROP 
+	/// discards the message. QueueOverflow::GROW queues it regardless. A message
+	/// is always admitted to an empty queue, so one larger than the budget is 
+	/// not refused forever. Function call is thread-safe.
+	/// @param[in] bytes - the byte budget, or 0 for none
+	void SetQueueByteBudget(size_t bytes);
+
+	/// Get the byte budget
+	/// @return The budget, or 0 if none.
+	size_t GetQueueByteBudget() const { return m_byteBudget.load(std::memory_order_relaxed); }
+
+	/// Set when the thread returns memory kept since a burst. Once no message 
+	/// has been taken for at least the quiet period, the queue lanes shrink to
+	/// the queue low-water mark, the scratch arena to the buffer low-water mark,
+	/// and free heap memory is returned to the operating system. Checked on the
+	/// thread's own timers. Function call is thread-safe.
+	/// @param[in] policy - the trim policy
+	void SetTrimPolicy(const TrimPolicy& policy);
+
+	/// Set when the thread frees the messages it has invoked, i.e. the copies 
+	/// of their arguments and the cloned delegate. A message holding large or 
+	/// many arguments is costly to free, and INLINE frees it between one call
+	/// and the next. IDLE holds the messages and frees them once the queue is 
+	/// empty, BACKGROUND hands them to a low priority thread shared by all
+	/// worker threads. Either frees a batch at once when it fills. Only messages
+	/// this thread releases last are deferred, so argument destructors then run
+	/// later, and with BACKGROUND on the reclaimer thread. Keep INLINE for a 
+	/// thread whose arguments must be destroyed on it or at once. Function call 
+	/// is thread-safe.
+	/// @param[in] policy - the reclaim policy
+	/// @param[in] batch - the most messages held
+	void SetReclaimPolicy(ReclaimPolicy policy, size_t batch = DEFAULT_RECLAIM_BATCH);
+
+	/// Get the reclaim policy
+	ReclaimPolicy GetReclaimPolicy() const { return m_reclaimPolicy.load(std::memory_order_relaxed); }
+
+	/// Set how the thread waits while idle. QueuePolicy::MUTEX threads default 
+	/// to WaitPolicy::BLOCK and QueuePolicy::RING threads to 
+	/// WaitPolicy::SPIN_THEN_BLOCK. Function call is thread-safe.
+	/// @param[in] strategy - the wait strategy
+	void SetWaitStrategy(const WaitStrategy& strategy) { m_spinWait.SetStrategy(strategy); }
+
+	/// Get the idle wait strategy
+	WaitStrategy GetWaitStrategy() const { return m_spinWait.GetStrategy(); }
+
+	/// Get the timers serviced only by this thread. Bind a Timer to the set 
+	/// to have its expiration checked on this thread.
+	/// @return The thread's timer set.
+	TimerSet& GetTimers() { return m_timers; }
+
+	/// Get a thread dispatching delegates onto this thread at a priority. Bind
+	/// async delegates to the returned thread to set their priority.
+	/// @param[in] priority - the dispatch priority
+	/// @return The priority thread. Valid for the life of this thread.
+	DelegateLib::DelegateThread& GetPriorityThread(Priority priority) 
+	{ 
+		return *m_priorityThreads[static_cast<int>(priority)]; 
+	}
+
+	/// Dispatch a delegate at NORMAL priority
 	virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg);
 
+	/// Dispatch a delegate at a priority
+	/// @param[in] msg - the delegate message
+	/// @param[in] priority - the dispatch priority
+	void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg, Priority priority);
+
+	/// Dispatch several delegates at NORMAL priority with one lock and a single wakeup
+	virtual void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count);
+
+	/// Hold a delegate until a due time, then invoke it as the thread services its
+	/// timers, ahead of the queued messages. The thread waits until the earliest
+	/// due time, so the message runs without a Timer or a polling delay.
+	/// @param[in] msg - the delegate message
+	/// @param[in] due - the Clock::Now() time to invoke the message at
+	/// @return True.
+	virtual bool DispatchDelegateAt(std::shared_ptr<DelegateLib::DelegateMsg> msg, std::chrono::steady_clock::time_point due);
+
+	/// Get the number of delegates held until their due time
+	size_t GetScheduledSize() { return m_scheduled.Size(); }
+
+	/// Dispatch several delegates at a priority with one lock and a single wakeup
+	/// @param[in] msgs - the delegate messages. The messages are moved from.
+	/// @param[in] count - the number of messages
+	/// @param[in] priority - the dispatch priority
+	void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count, Priority priority);
+
 private:
 	WorkerThread(const WorkerThread&) = delete;
 	WorkerThread& operator=(const WorkerThread&) = delete;
 
+	/// Dispatches onto one priority lane of the thread
+	class PriorityThread : public DelegateLib::DelegateThread
+	{
+	public:
+		PriorityThread(WorkerThread& thread, Priority priority) : m_thread(thread), m_priority(priority) {}
+		virtual void DispatchDelegate(std::shared_ptr<DelegateLib::DelegateMsg> msg)
+		{
+			m_thread.DispatchDelegate(std::move(msg), m_priority);
+		}
+		virtual void DispatchDelegates(std::shared_ptr<DelegateLib::DelegateMsg>* msgs, size_t count)
+		{
+			m_thread.DispatchDelegates(msgs, count, m_priority);
+		}
+		virtual bool DispatchDelegateAt(std::shared_ptr<DelegateLib::DelegateMsg> msg, std::chrono::steady_clock::time_point due)
+		{
+			return m_thread.DispatchDelegateAt(std::move(msg), due);
+		}
+		virtual bool IsInlineCall() const
+		{
+			return m_thread.IsInlineCall();
+		}
+		virtual bool IsOrdered() const
+		{
+			return m_thread.IsOrdered();
+		}
+		virtual int GetNumaNode() const
+		{
+			return m_thread.GetNumaNode();
+		}
+		virtual std::pmr::memory_resource* GetMemoryResource() const
+		{
+			return m_thread.GetMemoryResource();
+		}
+		virtual DelegateLib::DelegateRecorder* GetRecorder() const
+		{
+			return m_thread.GetRecorder();
+		}
+		virtual DelegateLib::DelegateWaitStats* GetWaitStats() const
+		{
+			return m_thread.GetWaitStats();
+		}
+
+	private:
+		WorkerThread& m_thread;
+		const Priority m_priority;
+	};
+
+	/// A ring message and the time it was queued
+	struct RingMsg
+	{
+		std::shared_ptr<DelegateLib::DelegateMsg> msg;
+		std::chrono::steady_clock::time_point enqueueTime;
+	};
+
+	friend class DeterministicScheduler;
+
 	/// Entry point for the thread
 	void Process();
 
-    /// Entry point for timer thread
-    void TimerThread();
+	/// Invoke a message as the thread. Called by the DeterministicScheduler.
+	/// @param[in] delegateMsg - the message to invoke
+	void InvokeScheduled(std::shared_ptr<DelegateLib::DelegateMsg>& delegateMsg);
+
+	/// Service the thread's due timers as the thread. Called by the 
+	/// DeterministicScheduler.
+	void ServiceScheduledTimers();
+
+	/// Stamp a message without a deadline with the deadline budget, if any
+	/// @param[in] msg - the message being dispatched
+	/// @param[in] now - the dispatch time
+	void StampDeadline(DelegateLib::DelegateMsg& msg, std::chrono::steady_clock::time_point now) const;
+
+	/// Count messages dispatched from a CPU on another NUMA node than the thread's
+	/// @param[in] count - the number of messages being dispatched
+	void CountRemoteDispatches(size_t count);
+
+	/// Invoke a delegate message recording statistics if enabled. A cancelled 
+	/// message or one past its deadline is discarded.
+	/// @param[in] delegateMsg - the message to invoke
+	/// @param[in] enqueueTime - the time the message was queued
+	void Invoke(std::shared_ptr<DelegateLib::DelegateMsg>& delegateMsg, 
+		std::chrono::steady_clock::time_point enqueueTime);
+
+	/// Hold an invoked message for deferred freeing if the reclaim policy
+	/// defers and the thread holds its last reference
+	/// @param[in] delegateMsg - the invoked message. Moved from if held.
+	void Retire(std::shared_ptr<DelegateLib::DelegateMsg>& delegateMsg);
+
+	/// Free the held messages, or hand them to the reclaimer thread
+	void ReclaimRetired();
+
+	/// Get the thread freeing the batches of BACKGROUND threads
+	static WorkerThread& GetReclaimer();
+
+	/// Select the lane to take the next message from
+	/// @param[in] readyLanes - bit mask of the non-empty lanes
+	/// @return The lane index, or -1 if no lane is ready.
+	int SelectLane(unsigned readyLanes);
+
+	/// Apply the overflow policy before queuing a message on a full MUTEX lane.
+	/// A DelegateRetireMsg is always admitted. Called with m_mutex locked, which
+	/// BLOCK releases while waiting.
+	/// @param[in] lk - the m_mutex lock
+	/// @param[in] lane - the lane the message is queued on
+	/// @param[in] msg - the message
+	/// @return True to queue the message, false to discard it.
+	bool AdmitMsg(std::unique_lock<DelegateLib::SiteMutex>& lk, int lane, const DelegateLib::DelegateMsg& msg);
+
+	/// Get the non-empty MUTEX queue lanes. Called with m_mutex locked.
+	/// @return Bit mask of the non-empty lanes.
+	unsigned GetQueuedLanes() const;
+
+	/// Get the non-empty RING lanes
+	/// @return Bit mask of the non-empty lanes.
+	unsigned GetRingLanes() const;
+
+	/// Thread loop for QueuePolicy::RING
+	void ProcessRing();
+
+	/// Check if the thread is exiting and the exit deadline has passed
+	/// @return True if the queued messages must be discarded.
+	bool IsExitDeadlinePassed() const;
+
+	/// Discard every queued message. Called by the thread on exit, with m_mutex
+	/// locked for QueuePolicy::MUTEX.
+	/// @return The number of delegate messages discarded.
+	size_t DiscardQueued();
+
+	/// Get the number of queued messages without taking m_mutex
+	size_t GetQueuedCount() const;
+
+	/// Check if a MUTEX queue message or timer start is pending without taking
+	/// m_mutex. Used while spinning.
+	bool IsQueueReady() const;
+
+	/// Spin then park until a ring message, timer tick or exit request is pending
+	/// @param[in] deadline - the next timer deadline
+	void WaitRing(std::chrono::steady_clock::time_point deadline);
+
+	/// Check if a ring message, timer tick or exit request is pending
+	bool IsRingReady() const;
+
+
+	/// Timer deadline state of a timer set. Only accessed by the thread.
+	struct TimerDeadline
+	{
+		TimerSet* timers;
+		uint64_t generation = 0;
+		bool running = false;
+		std::chrono::microseconds expiration = std::chrono::microseconds(0);
+	};
+
+	/// Expire due timers and find the next timer deadline
+	/// @return The time to wait until, or time_point::max() if no timer is running.
+	std::chrono::steady_clock::time_point ServiceTimers();
+
+	/// Expire due timers of a set and find the set's next deadline
+	/// @param[in] deadline - the timer set deadline state
+	/// @return The time to wait until, or time_point::max() if no timer is running.
+	std::chrono::steady_clock::time_point ServiceTimers(TimerDeadline& deadline);
+
+	/// Invoke the scheduled messages due and find the next due time
+	/// @return The time to wait until, or time_point::max() if no message is held.
+	std::chrono::steady_clock::time_point ServiceScheduled();
+
+	/// Check if a timer was started or the clock advanced since the deadline 
+	/// was last found
+	/// @return True if the timer deadline must be recomputed.
+	bool IsTimerChanged() const;
+
+	/// Add or remove the thread's gauges in the metrics registry
+	/// @param[in] publish - true to add, false to remove
+	void PublishMetrics(bool publish);
+
+	/// Trim memory if no message was taken since the last check. Called on the
+	/// thread every quiet period.
+	void TrimIdle();
+
+	/// Wake all threads to recompute their timer deadline. Called when a 
+	/// default set timer starts or the clock advances.
+	static void WakeTimers(void* context);
+
+	/// Wake a thread to recompute its timer deadline. Called when a timer of
+	/// the thread's own set starts.
+	/// @param[in] context - the WorkerThread instance
+	static void WakeThread(void* context);
 
-	std::unique_ptr<std::thread> m_thread;
-	std::queue<std::shared_ptr<ThreadMsg>> m_queue;
-	std::mutex m_mutex;
-	std::condition_variable m_cv;
-    std::atomic<bool> m_timerExit;
 	const std::string THREAD_NAME;
+
+	const QueuePolicy m_policy;
+	const ThreadAttributes m_attributes;
+
+	/// Messages queued per lane, the ring size or the MUTEX lane capacity
+	const size_t m_queueCapacity;
+
+	/// Set by SetQueueOverflow()
+	std::atomic<QueueOverflow> m_overflow;
+
+	/// Senders waiting for lane space and the condition they wait on. Protected
+	/// by m_mutex.
+	size_t m_spaceWaiters = 0;
+	DelegateLib::SiteCondition m_spaceCv;
+
+	/// Delegates discarded by QueueOverflow::DROP
+	std::atomic<uint64_t> m_dropped{ 0 };
+
+	/// Set by SetQueueByteBudget(). The payload bytes in m_queue and the most
+	/// seen are only written with m_mutex held.
+	std::atomic<size_t> m_byteBudget{ 0 };
+	std::atomic<size_t> m_queuedBytes{ 0 };
+	std::atomic<size_t> m_peakQueuedBytes{ 0 };
+
+	/// Lock-free message ring per lane used for QueuePolicy::RING
+	std::unique_ptr<LockFreeQueue<RingMsg>> m_rings[PRIORITY_LANES];
+
+	/// Messages left to take from each lane this round. Only accessed by the thread.
+	int m_laneCredits[PRIORITY_LANES];
+
+	std::unique_ptr<PriorityThread> m_priorityThreads[PRIORITY_LANES];
+
+	std::atomic<bool> m_exitPending;
+
+	/// Time queued messages are discarded from once exiting. Written before
+	/// m_exitPending is set.
+	std::chrono::steady_clock::time_point m_exitDeadline;
+
+	/// Delegates discarded by the exiting thread. Read once the thread joins.
+	size_t m_discarded;
+
+	/// Number of messages in m_queue. Only written with m_mutex held.
+	alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_queuedCount;
+
+	/// Statistics state. Histograms are only recorded by the thread.
+	/// m_peakQueueSize is written by senders and m_invoked by the thread, so
+	/// they sit on separate cache lines.
+	std::atomic<bool> m_statsEnabled;
+	std::atomic<size_t> m_peakQueueSize;
+	alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> m_invoked;
+	std::atomic<uint64_t> m_remoteDispatches;
+	std::chrono::steady_clock::time_point m_statsStart;
+	LatencyHistogram m_queueWait;
+	LatencyHistogram m_service;
+
+	/// Deadline budget in nanoseconds and messages discarded past their deadline
+	std::atomic<int64_t> m_deadlineBudget;
+	std::atomic<uint64_t> m_expired;
+
+	/// Set by SetInlineCalls()
+	std::atomic<bool> m_inlineCalls;
+
+	/// Usage per origin, written only by the thread while m_originAccounting 
+	/// is set
+	struct OriginCounters
+	{
+		std::atomic<uint64_t> invoked{ 0 };
+		std::atomic<uint64_t> cpuNs{ 0 };
+	};
+	std::atomic<bool> m_originAccounting{ false };
+	OriginCounters m_originCounters[DelegateLib::MAX_ORIGINS];
+
+	/// The scheduler running a QueuePolicy::SCHEDULED thread once created
+	DeterministicScheduler* m_scheduler = nullptr;
+
+	/// Set by SetRecorder()
+	std::atomic<DelegateLib::DelegateRecorder*> m_recorder{ nullptr };
+
+	/// Set by SetMemoryResource()
+	std::atomic<std::pmr::memory_resource*> m_resource{ nullptr };
+
+	/// Created by the first SetWaitStats() and kept since delegates may still
+	/// hold the thread's pointer. m_activeWaitStats is null while disabled.
+	std::unique_ptr<DelegateLib::DelegateWaitStats> m_waitStats;
+	std::once_flag m_waitStatsOnce;
+	std::atomic<DelegateLib::DelegateWaitStats*> m_activeWaitStats{ nullptr };
+
+	/// Timers serviced only by this thread
+	TimerSet m_timers;
+
+	/// Deadline state of the thread's timers and the default timers
+	TimerDeadline m_ownDeadline;
+	TimerDeadline m_defaultDeadline;
+
+	/// Messages held until their due time, and their deadline state. The
+	/// deadline state and m_dueMsgs are only accessed by the thread.
+	ScheduledQueue m_scheduled;
+	uint64_t m_scheduledGeneration = 0;
+	bool m_scheduledRunning = false;
+	std::chrono::microseconds m_scheduledDue = std::chrono::microseconds(0);
+	std::vector<std::shared_ptr<DelegateLib::DelegateMsg>> m_dueMsgs;
+
+	/// Clock advance count when the timers were last serviced
+	uint64_t m_clockAdvances = 0;
+
+	/// Handler scratch memory. Only accessed by the thread.
+	ScratchArena m_scratch;
+
+	/// Set by SetReclaimPolicy(), and the invoked messages held. m_retired is
+	/// only accessed by the thread.
+	std::atomic<ReclaimPolicy> m_reclaimPolicy{ ReclaimPolicy::INLINE };
+	std::atomic<size_t> m_reclaimBatch{ DEFAULT_RECLAIM_BATCH };
+	std::vector<std::shared_ptr<DelegateLib::DelegateMsg>> m_retired;
+	std::atomic<uint64_t> m_reclaimDeferred{ 0 };
+
+	/// Set by SetTrimPolicy(). Protected by m_mutex.
+	TrimPolicy m_trimPolicy;
+
+	/// Checks for a quiet period on the thread's own timers
+	Timer m_trimTimer;
+
+	/// Messages taken, and the count at the last trim check. Only accessed by
+	/// the thread.
+	uint64_t m_taken = 0;
+	uint64_t m_trimTaken = 0;
+	bool m_trimmed = true;
+
+	/// All created threads woken when a timer starts
+	static std::mutex m_threadsLock;
+	static std::list<WorkerThread*> m_threads;
 };
 
 #endif 
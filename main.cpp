@@ -16,6 +16,7 @@
 // production code. 
 
 #include "Logger.h"
+#include "SubsystemRegistry.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -24,6 +25,8 @@
 #ifdef IT_ENABLE
 #include "IntegrationTest.h"
 extern void Logger_IT_ForceLink();
+extern void Port_IT_ForceLink();
+extern void Delegate_IT_ForceLink();
 using namespace DelegateLib;
 #endif
 
@@ -35,19 +38,32 @@ using namespace std;
 int main(void)
 {
 #ifdef IT_ENABLE
-	// Dummy function call to prevent linker from discarding Logger_IT code
+	// Dummy function calls to prevent linker from discarding the IT code
 	Logger_IT_ForceLink();
+	Port_IT_ForceLink();
+	Delegate_IT_ForceLink();
 
-	IntegrationTest::GetInstance();
+	// Construct the subsystems once, then fork the zygote children if enabled
+	Logger::GetInstance();
+	if (IntegrationTest::Zygote())
+		return 0;
 #endif
 
-	// Instantiate subsystems
-	Logger::GetInstance();
+	// Start subsystems in parallel, each once the subsystems it depends on are ready
+	SubsystemRegistry::Register("Logger", {}, []() { Logger::GetInstance().Start(); });
+#ifdef IT_ENABLE
+	SubsystemRegistry::Register("IntegrationTest", {}, []() { IntegrationTest::GetInstance(); });
+#endif
+	SubsystemRegistry::Dump(cout, SubsystemRegistry::Start());
+
+	// Save pending log data if the application crashes. Installed on the main 
+	// thread since Windows keeps some signal handlers per thread.
+	Logger::InstallCrashHandlers();
 
 #ifdef IT_ENABLE
-	// Wait for integration tests to complete
-	while (!IntegrationTest::GetInstance().IsComplete())
-		this_thread::sleep_for(std::chrono::seconds(1));
+	// All subsystems are ready. Run the integration tests and wait for completion.
+	IntegrationTest::GetInstance().Ready();
+	IntegrationTest::GetInstance().WaitComplete();
 #endif
 
 	return 0;